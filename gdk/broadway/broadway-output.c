@@ -14,44 +14,211 @@
  *                Basic I/O primitives                                  *
  ************************************************************************/
 
+/* Textures are sent as tiles, and the browser keeps the last
+ * MAX_CACHED_TILES of them around. We mirror that cache here, so
+ * tiles that the browser already has are sent as a reference
+ * instead of as pixels.
+ */
+#define TILE_SIZE 64
+#define MAX_CACHED_TILES 1024
+#define TILE_NEW 0x80000000
+
+typedef struct {
+  guint32 hash;
+  int width;
+  int height;
+  guchar *data;
+  guint32 slot;
+  GList link;
+} BroadwayTile;
+
+/* Frames are written to the socket by a thread per output, so that
+ * a slow client doesn't hold up the main loop. If more than
+ * MAX_QUEUED_BYTES are waiting to be written, we drop frames until
+ * the client has caught up, and then resync it from scratch.
+ */
+#define MAX_QUEUED_BYTES (8 * 1024 * 1024)
+
 struct BroadwayOutput {
   GOutputStream *out;
   GString *buf;
   int error;
   guint32 serial;
+
+  GThread *thread;
+  GCancellable *cancellable;
+  GMutex lock;
+  GCond cond;
+  GQueue queue;
+  gsize queued_bytes;
+  gboolean lagging;
+  gboolean closing;
+  guint caught_up_idle;
+  BroadwayOutputCaughtUpFunc caught_up_func;
+  gpointer caught_up_data;
+
+  GHashTable *tiles;
+  GQueue tile_lru;
+  guint32 n_slots;
+
+  /* Bandwidth statistics */
+  guint64 bytes_sent;
+  guint64 texture_bytes;
+  guint64 texture_bytes_sent;
+  guint64 tiles_sent;
+  guint64 tiles_reused;
 };
 
+static guint
+broadway_tile_hash (gconstpointer key)
+{
+  const BroadwayTile *tile = key;
+
+  return tile->hash;
+}
+
+static gboolean
+broadway_tile_equal (gconstpointer a,
+                     gconstpointer b)
+{
+  const BroadwayTile *ta = a;
+  const BroadwayTile *tb = b;
+
+  return ta->hash == tb->hash &&
+         ta->width == tb->width &&
+         ta->height == tb->height &&
+         memcmp (ta->data, tb->data, ta->width * ta->height * 4) == 0;
+}
+
+static void
+broadway_tile_free (BroadwayTile *tile)
+{
+  g_free (tile->data);
+  g_free (tile);
+}
+
+static gboolean
+caught_up_cb (gpointer data)
+{
+  BroadwayOutput *output = data;
+
+  g_mutex_lock (&output->lock);
+  output->caught_up_idle = 0;
+  output->lagging = FALSE;
+  g_mutex_unlock (&output->lock);
+
+  output->caught_up_func (output, output->caught_up_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+broadway_output_finalize (BroadwayOutput *output)
+{
+  g_queue_clear_full (&output->queue, (GDestroyNotify) g_bytes_unref);
+  g_mutex_clear (&output->lock);
+  g_cond_clear (&output->cond);
+  g_object_unref (output->cancellable);
+  g_object_unref (output->out);
+  g_free (output);
+}
+
+/* The thread owns the output once it is closing, so that the queued
+ * frames can still be written without blocking the main loop.
+ */
+static gpointer
+broadway_output_thread (gpointer data)
+{
+  BroadwayOutput *output = data;
+  GBytes *frame;
+  GError *error = NULL;
+  gboolean ok;
+
+  g_mutex_lock (&output->lock);
+  while (!g_cancellable_is_cancelled (output->cancellable))
+    {
+      frame = g_queue_pop_head (&output->queue);
+      if (frame == NULL)
+        {
+          if (output->closing)
+            break;
+
+          if (output->lagging && output->caught_up_idle == 0)
+            output->caught_up_idle = g_idle_add (caught_up_cb, output);
+
+          g_cond_wait (&output->cond, &output->lock);
+          continue;
+        }
+
+      g_mutex_unlock (&output->lock);
+
+      ok = g_output_stream_write_all (output->out,
+                                      g_bytes_get_data (frame, NULL),
+                                      g_bytes_get_size (frame),
+                                      NULL, output->cancellable, &error);
+
+      g_mutex_lock (&output->lock);
+      output->queued_bytes -= g_bytes_get_size (frame);
+      g_bytes_unref (frame);
+
+      if (!ok)
+        {
+          if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            output->error = TRUE;
+          g_clear_error (&error);
+          break;
+        }
+    }
+
+  /* After an error, wait for the main thread to let go of the output */
+  while (!output->closing)
+    g_cond_wait (&output->cond, &output->lock);
+  g_mutex_unlock (&output->lock);
+
+  broadway_output_finalize (output);
+
+  return NULL;
+}
+
 static void
 broadway_output_send_cmd (BroadwayOutput *output,
                           gboolean fin, BroadwayWSOpCode code,
                           const void *buf, gsize count)
 {
   gboolean mask = FALSE;
-  guchar header[16];
+  guchar *frame;
   size_t p;
 
   gboolean mid_header = count > 125 && count <= 65535;
   gboolean long_header = count > 65535;
 
+  frame = g_malloc (16 + count);
+
   /* NB. big-endian spec => bit 0 == MSB */
-  header[0] = ( (fin ? 0x80 : 0) | (code & 0x0f) );
-  header[1] = ( (mask ? 0x80 : 0) |
-                (mid_header ? 126 : long_header ? 127 : count) );
+  frame[0] = ( (fin ? 0x80 : 0) | (code & 0x0f) );
+  frame[1] = ( (mask ? 0x80 : 0) |
+               (mid_header ? 126 : long_header ? 127 : count) );
   p = 2;
   if (mid_header)
     {
-      *(guint16 *)(header + p) = GUINT16_TO_BE( (guint16)count );
+      *(guint16 *)(frame + p) = GUINT16_TO_BE( (guint16)count );
       p += 2;
     }
   else if (long_header)
     {
-      *(guint64 *)(header + p) = GUINT64_TO_BE( count );
+      *(guint64 *)(frame + p) = GUINT64_TO_BE( count );
       p += 8;
     }
   // FIXME: if we are paranoid we should 'mask' the data
-  // FIXME: we should really emit these as a single write
-  g_output_stream_write_all (output->out, header, p, NULL, NULL, NULL);
-  g_output_stream_write_all (output->out, buf, count, NULL, NULL, NULL);
+  memcpy (frame + p, buf, count);
+
+  g_mutex_lock (&output->lock);
+  g_queue_push_tail (&output->queue, g_bytes_new_take (frame, p + count));
+  output->queued_bytes += p + count;
+  g_cond_signal (&output->cond);
+  g_mutex_unlock (&output->lock);
+
+  output->bytes_sent += p + count;
 }
 
 void broadway_output_pong (BroadwayOutput *output)
@@ -62,20 +229,33 @@ void broadway_output_pong (BroadwayOutput *output)
 int
 broadway_output_flush (BroadwayOutput *output)
 {
+  gboolean drop, error;
+
+  g_mutex_lock (&output->lock);
+  if (output->queued_bytes > MAX_QUEUED_BYTES)
+    output->lagging = TRUE;
+  drop = output->lagging;
+  error = output->error;
+  g_mutex_unlock (&output->lock);
+
   if (output->buf->len == 0)
-    return TRUE;
+    return !error;
 
-  broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
-                            output->buf->str, output->buf->len);
+  /* The client will get a full resync once it has caught up */
+  if (!drop)
+    broadway_output_send_cmd (output, TRUE, BROADWAY_WS_BINARY,
+                              output->buf->str, output->buf->len);
 
   g_string_set_size (output->buf, 0);
 
-  return !output->error;
-
+  return !error;
 }
 
 BroadwayOutput *
-broadway_output_new (GOutputStream *out, guint32 serial)
+broadway_output_new (GOutputStream              *out,
+                     guint32                     serial,
+                     BroadwayOutputCaughtUpFunc  caught_up_func,
+                     gpointer                    caught_up_data)
 {
   BroadwayOutput *output;
 
@@ -84,6 +264,17 @@ broadway_output_new (GOutputStream *out, guint32 serial)
   output->out = g_object_ref (out);
   output->buf = g_string_new ("");
   output->serial = serial;
+  output->tiles = g_hash_table_new_full (broadway_tile_hash, broadway_tile_equal,
+                                         (GDestroyNotify) broadway_tile_free, NULL);
+  g_queue_init (&output->tile_lru);
+
+  output->caught_up_func = caught_up_func;
+  output->caught_up_data = caught_up_data;
+  output->cancellable = g_cancellable_new ();
+  g_mutex_init (&output->lock);
+  g_cond_init (&output->cond);
+  g_queue_init (&output->queue);
+  output->thread = g_thread_new ("broadway output", broadway_output_thread, output);
 
   return output;
 }
@@ -91,8 +282,30 @@ broadway_output_new (GOutputStream *out, guint32 serial)
 void
 broadway_output_free (BroadwayOutput *output)
 {
-  g_object_unref (output->out);
-  free (output);
+  g_debug ("Broadway output sent %" G_GUINT64_FORMAT " bytes, "
+           "textures: %" G_GUINT64_FORMAT " bytes as %" G_GUINT64_FORMAT " bytes, "
+           "%" G_GUINT64_FORMAT " tiles sent, %" G_GUINT64_FORMAT " tiles reused",
+           output->bytes_sent,
+           output->texture_bytes, output->texture_bytes_sent,
+           output->tiles_sent, output->tiles_reused);
+
+  g_hash_table_destroy (output->tiles);
+  g_string_free (output->buf, TRUE);
+
+  /* Let the thread write what's queued up, unless the client is stuck */
+  g_mutex_lock (&output->lock);
+  output->closing = TRUE;
+  if (output->queued_bytes > MAX_QUEUED_BYTES)
+    g_cancellable_cancel (output->cancellable);
+  if (output->caught_up_idle)
+    {
+      g_source_remove (output->caught_up_idle);
+      output->caught_up_idle = 0;
+    }
+  g_cond_signal (&output->cond);
+  g_mutex_unlock (&output->lock);
+
+  g_thread_unref (output->thread);
 }
 
 guint32
@@ -216,6 +429,18 @@ broadway_output_disconnected (BroadwayOutput *output)
   write_header (output, BROADWAY_OP_DISCONNECTED);
 }
 
+/* Makes the client forget everything it was sent so far */
+void
+broadway_output_reset (BroadwayOutput *output)
+{
+  g_hash_table_remove_all (output->tiles);
+  g_queue_init (&output->tile_lru);
+  output->n_slots = 0;
+
+  g_string_set_size (output->buf, 0);
+  write_header (output, BROADWAY_OP_RESET);
+}
+
 void
 broadway_output_show_surface(BroadwayOutput *output,  int id)
 {
@@ -599,16 +824,164 @@ broadway_output_surface_set_nodes (BroadwayOutput *output,
   patch_uint32 (output, (end - start) / 4, size_pos);
 }
 
+static guint32
+hash_tile (const guchar *data,
+           gsize         size)
+{
+  const guint32 *words = (const guint32 *) data;
+  guint32 h = 2166136261u;
+  gsize i;
+
+  /* FNV-1a, a word at a time. Collisions are caught by broadway_tile_equal() */
+  for (i = 0; i < size / 4; i++)
+    h = (h ^ words[i]) * 16777619u;
+
+  return h;
+}
+
+/* Returns the slot of the tile in the browser's cache, or'ed with
+ * TILE_NEW if its pixels need to be sent along.
+ */
+static guint32
+lookup_tile (BroadwayOutput *output,
+             const guchar   *data,
+             int             width,
+             int             height)
+{
+  BroadwayTile key = { hash_tile (data, width * height * 4), width, height, (guchar *) data, };
+  BroadwayTile *tile;
+
+  tile = g_hash_table_lookup (output->tiles, &key);
+  if (tile)
+    {
+      g_queue_unlink (&output->tile_lru, &tile->link);
+      g_queue_push_head_link (&output->tile_lru, &tile->link);
+      output->tiles_reused++;
+      return tile->slot;
+    }
+
+  tile = g_new0 (BroadwayTile, 1);
+  tile->hash = key.hash;
+  tile->width = width;
+  tile->height = height;
+  tile->data = g_memdup (data, width * height * 4);
+  tile->link.data = tile;
+
+  if (output->n_slots < MAX_CACHED_TILES)
+    tile->slot = output->n_slots++;
+  else
+    {
+      BroadwayTile *oldest = g_queue_peek_tail (&output->tile_lru);
+
+      tile->slot = oldest->slot;
+      g_queue_unlink (&output->tile_lru, &oldest->link);
+      g_hash_table_remove (output->tiles, oldest);
+    }
+
+  g_queue_push_head_link (&output->tile_lru, &tile->link);
+  g_hash_table_add (output->tiles, tile);
+  output->tiles_sent++;
+
+  return tile->slot | TILE_NEW;
+}
+
+static GBytes *
+compress_pixels (GByteArray *pixels)
+{
+  GConverter *compressor;
+  GByteArray *out;
+  GConverterResult res;
+  GError *error = NULL;
+  guchar buf[16384];
+  gsize pos, bytes_read, bytes_written;
+
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1));
+  out = g_byte_array_sized_new (pixels->len / 4 + 64);
+
+  pos = 0;
+  do
+    {
+      res = g_converter_convert (compressor,
+                                 pixels->data + pos, pixels->len - pos,
+                                 buf, sizeof (buf),
+                                 G_CONVERTER_INPUT_AT_END,
+                                 &bytes_read, &bytes_written,
+                                 &error);
+      if (res == G_CONVERTER_ERROR)
+        {
+          g_warning ("Failed to compress texture: %s", error->message);
+          g_error_free (error);
+          break;
+        }
+
+      pos += bytes_read;
+      g_byte_array_append (out, buf, bytes_written);
+    }
+  while (res != G_CONVERTER_FINISHED);
+
+  g_object_unref (compressor);
+
+  return g_byte_array_free_to_bytes (out);
+}
+
 void
 broadway_output_upload_texture (BroadwayOutput *output,
                                 guint32 id,
+                                int width,
+                                int height,
                                 GBytes *texture)
 {
-  gsize len = g_bytes_get_size (texture);
+  const guchar *data = g_bytes_get_data (texture, NULL);
+  GByteArray *new_pixels;
+  guchar *tile_data;
+  GBytes *compressed;
+  gsize start;
+  int x, y, row;
+
   write_header (output, BROADWAY_OP_UPLOAD_TEXTURE);
   append_uint32 (output, id);
-  append_uint32 (output, (guint32)len);
-  g_string_append_len (output->buf, g_bytes_get_data (texture, NULL), len);
+  append_uint32 (output, width);
+  append_uint32 (output, height);
+  append_uint32 (output, TILE_SIZE);
+
+  start = output->buf->len;
+
+  new_pixels = g_byte_array_new ();
+  tile_data = g_malloc (TILE_SIZE * TILE_SIZE * 4);
+
+  for (y = 0; y < height; y += TILE_SIZE)
+    for (x = 0; x < width; x += TILE_SIZE)
+      {
+        int tile_width = MIN (TILE_SIZE, width - x);
+        int tile_height = MIN (TILE_SIZE, height - y);
+        guint32 slot;
+
+        for (row = 0; row < tile_height; row++)
+          memcpy (tile_data + row * tile_width * 4,
+                  data + ((gsize) (y + row) * width + x) * 4,
+                  tile_width * 4);
+
+        slot = lookup_tile (output, tile_data, tile_width, tile_height);
+        if (slot & TILE_NEW)
+          g_byte_array_append (new_pixels, tile_data, tile_width * tile_height * 4);
+
+        append_uint32 (output, slot);
+      }
+
+  g_free (tile_data);
+
+  /* The pixels of the new tiles, in order, deflated */
+  compressed = compress_pixels (new_pixels);
+  append_uint32 (output, (guint32) g_bytes_get_size (compressed));
+  g_string_append_len (output->buf,
+                       g_bytes_get_data (compressed, NULL),
+                       g_bytes_get_size (compressed));
+
+  output->texture_bytes += g_bytes_get_size (texture);
+  output->texture_bytes_sent += output->buf->len - start;
+
+  g_bytes_unref (compressed);
+  g_byte_array_unref (new_pixels);
 }
 
 void
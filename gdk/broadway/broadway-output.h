@@ -17,8 +17,16 @@ typedef enum {
   BROADWAY_WS_CNX_PONG = 0xa
 } BroadwayWSOpCode;
 
+/* Called in the main thread when a client that had frames dropped
+ * has caught up, and needs to be resynced.
+ */
+typedef void (* BroadwayOutputCaughtUpFunc) (BroadwayOutput *output,
+                                             gpointer        user_data);
+
 BroadwayOutput *broadway_output_new                 (GOutputStream  *out,
-                                                     guint32         serial);
+                                                     guint32         serial,
+                                                     BroadwayOutputCaughtUpFunc caught_up_func,
+                                                     gpointer        caught_up_data);
 void            broadway_output_free                (BroadwayOutput *output);
 int             broadway_output_flush               (BroadwayOutput *output);
 int             broadway_output_has_error           (BroadwayOutput *output);
@@ -32,6 +40,7 @@ void            broadway_output_new_surface         (BroadwayOutput *output,
                                                      int             w,
                                                      int             h);
 void            broadway_output_disconnected        (BroadwayOutput *output);
+void            broadway_output_reset               (BroadwayOutput *output);
 void            broadway_output_show_surface        (BroadwayOutput *output,
                                                      int             id);
 void            broadway_output_hide_surface        (BroadwayOutput *output,
@@ -63,6 +72,8 @@ void            broadway_output_surface_set_nodes   (BroadwayOutput *output,
                                                      GHashTable     *old_node_lookup);
 void            broadway_output_upload_texture      (BroadwayOutput *output,
                                                      guint32         id,
+                                                     int             width,
+                                                     int             height,
                                                      GBytes         *texture);
 void            broadway_output_release_texture     (BroadwayOutput *output,
                                                      guint32         id);
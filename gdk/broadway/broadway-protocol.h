@@ -23,6 +23,7 @@ typedef enum { /* Sync changes with broadway.js and node_type_is_container() */
   BROADWAY_NODE_TRANSFORM = 11,
   BROADWAY_NODE_DEBUG = 12,
   BROADWAY_NODE_REUSE = 13,
+  BROADWAY_NODE_TEXT = 14,
 } BroadwayNodeType;
 
 typedef enum { /* Sync changes with broadway.js */
@@ -48,6 +49,7 @@ static const char *broadway_node_type_names[] G_GNUC_UNUSED =  {
   "TRANSFORM",
   "DEBUG",
   "REUSE",
+  "TEXT",
 };
 
 typedef enum {
@@ -86,6 +88,7 @@ typedef enum {
   BROADWAY_OP_RELEASE_TEXTURE = 14,
   BROADWAY_OP_SET_NODES = 15,
   BROADWAY_OP_ROUNDTRIP = 16,
+  BROADWAY_OP_RESET = 17,
 } BroadwayOpType;
 
 typedef struct {
@@ -238,9 +241,12 @@ typedef struct {
   guint32 parent;
 } BroadwayRequestSetTransientFor;
 
+/* The texture data is width * height RGBA pixels with premultiplied alpha */
 typedef struct {
   BroadwayRequestBase base;
   guint32 id;
+  guint32 width;
+  guint32 height;
   guint32 offset;
   guint32 size;
 } BroadwayRequestUploadTexture;
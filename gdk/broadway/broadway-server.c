@@ -52,10 +52,12 @@ struct _BroadwayServer {
   char *ssl_key;
   GSocketService *service;
   BroadwayOutput *output;
+  GPtrArray *outputs; /* All connected browsers, including output */
   guint32 id_counter;
   guint32 saved_serial;
   guint64 last_seen_time;
   BroadwayInput *input;
+  GList *viewers; /* Inputs of the browsers that are only watching */
   GList *input_messages;
   guint process_input_idle;
 
@@ -131,11 +133,16 @@ struct BroadwaySurface {
 struct _BroadwayTexture {
   grefcount refcount;
   guint32 id;
+  int width;
+  int height;
   GBytes *bytes;
 };
 
-static void broadway_server_resync_surfaces (BroadwayServer *server);
+static void broadway_server_resync_output (BroadwayServer *server,
+                                           BroadwayOutput *output);
 static void send_outstanding_roundtrips (BroadwayServer *server);
+static void broadway_server_remove_output (BroadwayServer *server,
+                                           BroadwayOutput *output);
 
 static void broadway_server_ref_texture (BroadwayServer   *server,
                                          guint32           id);
@@ -264,6 +271,7 @@ broadway_server_init (BroadwayServer *server)
   server->id_counter = 0;
   server->textures = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
                                             (GDestroyNotify)broadway_texture_free);
+  server->outputs = g_ptr_array_new ();
 
   root = g_new0 (BroadwaySurface, 1);
   root->id = server->id_counter++;
@@ -288,6 +296,7 @@ broadway_server_finalize (GObject *object)
   g_free (server->ssl_cert);
   g_free (server->ssl_key);
   g_hash_table_destroy (server->textures);
+  g_ptr_array_free (server->outputs, TRUE);
 
   G_OBJECT_CLASS (broadway_server_parent_class)->finalize (object);
 }
@@ -617,6 +626,10 @@ parse_input_message (BroadwayInput *input, const unsigned char *message)
   gint64 time_;
   GList *l;
 
+  /* Viewers can't interact with the session */
+  if (!input->active)
+    return;
+
   memset (&msg, 0, sizeof (msg));
 
   p = (guint32 *) message;
@@ -841,7 +854,8 @@ parse_input (BroadwayInput *input)
           }
         break;
       case BROADWAY_WS_CNX_PING:
-        broadway_output_pong (input->output);
+        if (input->output)
+          broadway_output_pong (input->output);
         break;
       case BROADWAY_WS_CNX_PONG:
         break; /* we never send pings, but tolerate pongs */
@@ -906,6 +920,12 @@ broadway_server_read_all_input_nonblocking (BroadwayInput *input)
 
           input->server->input = NULL;
         }
+      else
+        {
+          input->server->viewers = g_list_remove (input->server->viewers, input);
+          if (input->output)
+            broadway_server_remove_output (input->server, input->output);
+        }
       broadway_input_free (input);
       if (res < 0)
         {
@@ -986,17 +1006,48 @@ broadway_server_fake_roundtrip_reply (BroadwayServer *server,
   queue_process_input_at_idle (server);
 }
 
-void
-broadway_server_flush (BroadwayServer *server)
+static void
+broadway_server_remove_output (BroadwayServer *server,
+                               BroadwayOutput *output)
 {
-  if (server->output &&
-      !broadway_output_flush (server->output))
+  GList *l;
+
+  if (server->output == output)
     {
       server->saved_serial = broadway_output_get_next_serial (server->output);
-      broadway_output_free (server->output);
       server->output = NULL;
       send_outstanding_roundtrips (server);
     }
+
+  if (server->input && server->input->output == output)
+    server->input->output = NULL;
+
+  for (l = server->viewers; l != NULL; l = l->next)
+    {
+      BroadwayInput *viewer = l->data;
+
+      if (viewer->output == output)
+        viewer->output = NULL;
+    }
+
+  g_ptr_array_remove (server->outputs, output);
+  broadway_output_free (output);
+}
+
+void
+broadway_server_flush (BroadwayServer *server)
+{
+  guint i = 0;
+
+  while (i < server->outputs->len)
+    {
+      BroadwayOutput *output = g_ptr_array_index (server->outputs, i);
+
+      if (broadway_output_flush (output))
+        i++;
+      else
+        broadway_server_remove_output (server, output);
+    }
 }
 
 void
@@ -1082,6 +1133,18 @@ generate_handshake_response_wsietf_v7 (const char *key)
   return g_base64_encode (digest, digest_len);
 }
 
+static void
+output_caught_up (BroadwayOutput *output,
+                  gpointer        user_data)
+{
+  BroadwayServer *server = user_data;
+
+  /* Frames were dropped while the browser was lagging behind, so
+   * its state is stale. Start over from the current state. */
+  broadway_output_reset (output);
+  broadway_server_resync_output (server, output);
+}
+
 static void
 start_input (HttpRequest *request)
 {
@@ -1168,7 +1231,8 @@ start_input (HttpRequest *request)
   g_byte_array_append (input->buffer, data_buffer, data_buffer_size);
 
   input->output =
-    broadway_output_new (g_io_stream_get_output_stream (request->connection), 0);
+    broadway_output_new (g_io_stream_get_output_stream (request->connection), 0,
+                         output_caught_up, request->server);
 
   /* This will free and close the data input stream, but we got all the buffered content already */
   http_request_free (request);
@@ -1211,38 +1275,39 @@ start (BroadwayInput *input)
 
   server = BROADWAY_SERVER (input->server);
 
-  if (server->output)
-    {
-      send_outstanding_roundtrips (server);
-      broadway_output_disconnected (server->output);
-      broadway_output_flush (server->output);
-    }
+  if (server->output || server->input)
+    send_outstanding_roundtrips (server);
 
+  /* The last client to connect gets control. The previous one
+   * stays connected, but can only watch from now on.
+   */
   if (server->input != NULL)
     {
-      send_outstanding_roundtrips (server);
-      broadway_input_free (server->input);
+      server->input->active = FALSE;
+      if (server->input->output)
+        server->viewers = g_list_prepend (server->viewers, server->input);
+      else
+        broadway_input_free (server->input);
       server->input = NULL;
     }
+  else if (server->output)
+    {
+      broadway_output_disconnected (server->output);
+      broadway_output_flush (server->output);
+      broadway_server_remove_output (server, server->output);
+    }
 
   server->input = input;
 
   if (server->output)
-    {
-      server->saved_serial = broadway_output_get_next_serial (server->output);
-      broadway_output_free (server->output);
-    }
+    server->saved_serial = broadway_output_get_next_serial (server->output);
   server->output = input->output;
+  g_ptr_array_add (server->outputs, server->output);
 
   broadway_output_set_next_serial (server->output, server->saved_serial);
   broadway_output_flush (server->output);
 
-  broadway_server_resync_surfaces (server);
-
-  if (server->pointer_grab_surface_id != -1)
-    broadway_output_grab_pointer (server->output,
-                                  server->pointer_grab_surface_id,
-                                  server->pointer_grab_owner_events);
+  broadway_server_resync_output (server, server->output);
 
   process_input_messages (server);
 }
@@ -1568,6 +1633,7 @@ broadway_server_destroy_surface (BroadwayServer *server,
                                  int id)
 {
   BroadwaySurface *surface;
+  guint i;
 
   if (server->mouse_in_surface_id == id)
     {
@@ -1578,8 +1644,8 @@ broadway_server_destroy_surface (BroadwayServer *server,
   if (server->pointer_grab_surface_id == id)
     server->pointer_grab_surface_id = -1;
 
-  if (server->output)
-    broadway_output_destroy_surface (server->output,
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_destroy_surface (g_ptr_array_index (server->outputs, i),
                                      id);
 
   surface = broadway_server_lookup_surface (server, id);
@@ -1597,7 +1663,7 @@ broadway_server_surface_show (BroadwayServer *server,
                               int id)
 {
   BroadwaySurface *surface;
-  gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1605,13 +1671,10 @@ broadway_server_surface_show (BroadwayServer *server,
 
   surface->visible = TRUE;
 
-  if (server->output)
-    {
-      broadway_output_show_surface (server->output, surface->id);
-      sent = TRUE;
-    }
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_show_surface (g_ptr_array_index (server->outputs, i), surface->id);
 
-  return sent;
+  return server->output != NULL;
 }
 
 gboolean
@@ -1619,7 +1682,7 @@ broadway_server_surface_hide (BroadwayServer *server,
                               int id)
 {
   BroadwaySurface *surface;
-  gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1636,12 +1699,10 @@ broadway_server_surface_hide (BroadwayServer *server,
   if (server->pointer_grab_surface_id == id)
     server->pointer_grab_surface_id = -1;
 
-  if (server->output)
-    {
-      broadway_output_hide_surface (server->output, surface->id);
-      sent = TRUE;
-    }
-  return sent;
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_hide_surface (g_ptr_array_index (server->outputs, i), surface->id);
+
+  return server->output != NULL;
 }
 
 void
@@ -1649,6 +1710,7 @@ broadway_server_surface_raise (BroadwayServer *server,
                                int id)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1657,8 +1719,8 @@ broadway_server_surface_raise (BroadwayServer *server,
   server->surfaces = g_list_remove (server->surfaces, surface);
   server->surfaces = g_list_append (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_raise_surface (server->output, surface->id);
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_raise_surface (g_ptr_array_index (server->outputs, i), surface->id);
 }
 
 void
@@ -1679,6 +1741,7 @@ broadway_server_surface_lower (BroadwayServer *server,
                                int id)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1687,8 +1750,8 @@ broadway_server_surface_lower (BroadwayServer *server,
   server->surfaces = g_list_remove (server->surfaces, surface);
   server->surfaces = g_list_prepend (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_lower_surface (server->output, surface->id);
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_lower_surface (g_ptr_array_index (server->outputs, i), surface->id);
 }
 
 void
@@ -1696,6 +1759,7 @@ broadway_server_surface_set_transient_for (BroadwayServer *server,
                                            int id, int parent)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1703,11 +1767,10 @@ broadway_server_surface_set_transient_for (BroadwayServer *server,
 
   surface->transient_for = parent;
 
-  if (server->output)
-    {
-      broadway_output_set_transient_for (server->output, surface->id, surface->transient_for);
-      broadway_server_flush (server);
-    }
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_set_transient_for (g_ptr_array_index (server->outputs, i),
+                                       surface->id, surface->transient_for);
+  broadway_server_flush (server);
 }
 
 gboolean
@@ -1778,6 +1841,11 @@ decode_nodes (BroadwayServer *server,
     texture_offset = 4;
     size = 5;
     break;
+  case BROADWAY_NODE_TEXT:
+    texture_offset = NODE_SIZE_RECT + NODE_SIZE_COLOR + 1;
+    size = NODE_SIZE_RECT + NODE_SIZE_COLOR + 3;
+    size += data[*pos + size - 1] * 4;
+    break;
   case BROADWAY_NODE_CONTAINER:
     size = 1;
     n_children = data[*pos];
@@ -1873,6 +1941,7 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
   BroadwaySurface *surface;
   int pos = 0;
   BroadwayNode *root;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1880,8 +1949,9 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
 
   root = decode_nodes (server, surface, len, data, client_texture_map, &pos);
 
-  if (server->output != NULL)
-    broadway_output_surface_set_nodes (server->output, surface->id,
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_surface_set_nodes (g_ptr_array_index (server->outputs, i),
+                                       surface->id,
                                        root,
                                        surface->nodes,
                                        surface->node_lookup);
@@ -1897,21 +1967,29 @@ broadway_server_surface_update_nodes (BroadwayServer   *server,
 
 guint32
 broadway_server_upload_texture (BroadwayServer   *server,
+                                int               width,
+                                int               height,
                                 GBytes           *bytes)
 {
   BroadwayTexture *texture;
+  guint i;
 
   texture = g_new0 (BroadwayTexture, 1);
   g_ref_count_init (&texture->refcount);
   texture->id = ++server->next_texture_id;
+  texture->width = width;
+  texture->height = height;
   texture->bytes = g_bytes_ref (bytes);
 
   g_hash_table_replace (server->textures,
                         GINT_TO_POINTER (texture->id),
                         texture);
 
-  if (server->output)
-    broadway_output_upload_texture (server->output, texture->id, texture->bytes);
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_upload_texture (g_ptr_array_index (server->outputs, i),
+                                    texture->id,
+                                    texture->width, texture->height,
+                                    texture->bytes);
 
   return texture->id;
 }
@@ -1932,6 +2010,7 @@ broadway_server_release_texture (BroadwayServer   *server,
                                  guint32           id)
 {
   BroadwayTexture *texture;
+  guint i;
 
   texture = g_hash_table_lookup (server->textures, GINT_TO_POINTER (id));
 
@@ -1939,8 +2018,8 @@ broadway_server_release_texture (BroadwayServer   *server,
     {
       g_hash_table_remove (server->textures, GINT_TO_POINTER (id));
 
-      if (server->output)
-        broadway_output_release_texture (server->output, id);
+      for (i = 0; i < server->outputs->len; i++)
+        broadway_output_release_texture (g_ptr_array_index (server->outputs, i), id);
     }
 }
 
@@ -1956,6 +2035,7 @@ broadway_server_surface_move_resize (BroadwayServer *server,
   BroadwaySurface *surface;
   gboolean with_resize;
   gboolean sent = FALSE;
+  guint i;
 
   surface = broadway_server_lookup_surface (server, id);
   if (surface == NULL)
@@ -1965,14 +2045,14 @@ broadway_server_surface_move_resize (BroadwayServer *server,
   surface->width = width;
   surface->height = height;
 
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_move_resize_surface (g_ptr_array_index (server->outputs, i),
+                                         surface->id,
+                                         with_move, x, y,
+                                         with_resize, surface->width, surface->height);
+
   if (server->output != NULL)
-    {
-      broadway_output_move_resize_surface (server->output,
-                                           surface->id,
-                                           with_move, x, y,
-                                           with_resize, surface->width, surface->height);
-      sent = TRUE;
-    }
+    sent = TRUE;
   else
     {
       if (with_move)
@@ -2077,6 +2157,7 @@ broadway_server_new_surface (BroadwayServer *server,
                              int height)
 {
   BroadwaySurface *surface;
+  guint i;
 
   surface = g_new0 (BroadwaySurface, 1);
   surface->owner = client;
@@ -2093,36 +2174,37 @@ broadway_server_new_surface (BroadwayServer *server,
 
   server->surfaces = g_list_append (server->surfaces, surface);
 
-  if (server->output)
-    broadway_output_new_surface (server->output,
+  for (i = 0; i < server->outputs->len; i++)
+    broadway_output_new_surface (g_ptr_array_index (server->outputs, i),
                                  surface->id,
                                  surface->x,
                                  surface->y,
                                  surface->width,
                                  surface->height);
-  else
+
+  if (server->output == NULL)
     fake_configure_notify (server, surface);
 
   return surface->id;
 }
 
 static void
-broadway_server_resync_surfaces (BroadwayServer *server)
+broadway_server_resync_output (BroadwayServer *server,
+                               BroadwayOutput *output)
 {
   GHashTableIter iter;
   gpointer key, value;
   GList *l;
 
-  if (server->output == NULL)
-    return;
-
   /* First upload all textures */
   g_hash_table_iter_init (&iter, server->textures);
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
       BroadwayTexture *texture = value;
-      broadway_output_upload_texture (server->output,
+      broadway_output_upload_texture (output,
                                       GPOINTER_TO_INT (key),
+                                      texture->width,
+                                      texture->height,
                                       texture->bytes);
     }
 
@@ -2134,7 +2216,7 @@ broadway_server_resync_surfaces (BroadwayServer *server)
       if (surface->id == 0)
         continue; /* Skip root */
 
-      broadway_output_new_surface (server->output,
+      broadway_output_new_surface (output,
                                    surface->id,
                                    surface->x,
                                    surface->y,
@@ -2151,20 +2233,25 @@ broadway_server_resync_surfaces (BroadwayServer *server)
         continue; /* Skip root */
 
       if (surface->transient_for != -1)
-        broadway_output_set_transient_for (server->output, surface->id,
+        broadway_output_set_transient_for (output, surface->id,
                                            surface->transient_for);
 
       if (surface->nodes)
-        broadway_output_surface_set_nodes (server->output, surface->id,
+        broadway_output_surface_set_nodes (output, surface->id,
                                            surface->nodes,
                                            NULL, NULL);
 
       if (surface->visible)
-        broadway_output_show_surface (server->output, surface->id);
+        broadway_output_show_surface (output, surface->id);
     }
 
   if (server->show_keyboard)
-    broadway_output_set_show_keyboard (server->output, TRUE);
+    broadway_output_set_show_keyboard (output, TRUE);
+
+  if (output == server->output && server->pointer_grab_surface_id != -1)
+    broadway_output_grab_pointer (output,
+                                  server->pointer_grab_surface_id,
+                                  server->pointer_grab_owner_events);
 
   broadway_server_flush (server);
 }
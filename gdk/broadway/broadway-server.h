@@ -111,6 +111,8 @@ gboolean            broadway_server_surface_translate         (BroadwayServer  *
                                                                int              dx,
                                                                int              dy);
 guint32             broadway_server_upload_texture            (BroadwayServer  *server,
+                                                               int              width,
+                                                               int              height,
                                                                GBytes          *texture);
 void                broadway_server_release_texture           (BroadwayServer  *server,
                                                                guint32          id);
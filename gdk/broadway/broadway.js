@@ -14,6 +14,7 @@ const BROADWAY_NODE_CLIP = 10;
 const BROADWAY_NODE_TRANSFORM = 11;
 const BROADWAY_NODE_DEBUG = 12;
 const BROADWAY_NODE_REUSE = 13;
+const BROADWAY_NODE_TEXT = 14;
 
 const BROADWAY_NODE_OP_INSERT_NODE = 0;
 const BROADWAY_NODE_OP_REMOVE_NODE = 1;
@@ -38,6 +39,7 @@ const BROADWAY_OP_UPLOAD_TEXTURE = 13;
 const BROADWAY_OP_RELEASE_TEXTURE = 14;
 const BROADWAY_OP_SET_NODES = 15;
 const BROADWAY_OP_ROUNDTRIP = 16;
+const BROADWAY_OP_RESET = 17;
 
 const BROADWAY_EVENT_ENTER = 0;
 const BROADWAY_EVENT_LEAVE = 1;
@@ -91,60 +93,6 @@ const GDK_META_MASK     = 1 << 28;
 
 var useDataUrls = window.location.search.includes("datauri");
 
-/* This base64code is based on https://github.com/beatgammit/base64-js/blob/master/index.js which is MIT licensed */
-
-var b64_lookup = [];
-var base64_code = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
-for (var i = 0, len = base64_code.length; i < len; ++i) {
-    b64_lookup[i] = base64_code[i];
-}
-
-function tripletToBase64 (num) {
-    return b64_lookup[num >> 18 & 0x3F] +
-        b64_lookup[num >> 12 & 0x3F] +
-        b64_lookup[num >> 6 & 0x3F] +
-        b64_lookup[num & 0x3F];
-}
-
-function encodeBase64Chunk (uint8, start, end) {
-    var tmp;
-    var output = [];
-    for (var i = start; i < end; i += 3) {
-        tmp =
-            ((uint8[i] << 16) & 0xFF0000) +
-            ((uint8[i + 1] << 8) & 0xFF00) +
-            (uint8[i + 2] & 0xFF);
-        output.push(tripletToBase64(tmp));
-    }
-    return output.join('');
-}
-
-function bytesToDataUri(uint8) {
-    var tmp;
-    var len = uint8.length;
-    var extraBytes = len % 3; // if we have 1 byte left, pad 2 bytes
-    var parts = [];
-    var maxChunkLength = 16383; // must be multiple of 3
-
-    parts.push("data:image/png;base64,");
-
-    // go through the array every three bytes, we'll deal with trailing stuff later
-    for (var i = 0, len2 = len - extraBytes; i < len2; i += maxChunkLength) {
-        parts.push(encodeBase64Chunk(uint8, i, (i + maxChunkLength) > len2 ? len2 : (i + maxChunkLength)));
-    }
-
-    // pad the end with zeros, but make sure to not forget the extra bytes
-    if (extraBytes === 1) {
-        tmp = uint8[len - 1];
-        parts.push(b64_lookup[tmp >> 2] + b64_lookup[(tmp << 4) & 0x3F] + '==');
-    } else if (extraBytes === 2) {
-        tmp = (uint8[len - 2] << 8) + uint8[len - 1];
-        parts.push(b64_lookup[tmp >> 10] + b64_lookup[(tmp >> 4) & 0x3F] + b64_lookup[(tmp << 2) & 0x3F] + '=');
-    }
-
-    return parts.join('');
-}
-
 /* Helper functions for debugging */
 var logDiv = null;
 function log(str) {
@@ -229,6 +177,8 @@ var realSurfaceWithMouse = 0;
 var surfaceWithMouse = 0;
 var surfaces = {};
 var textures = {};
+var tileCache = [];
+var tileQueue = Promise.resolve();
 var stackingOrder = [];
 var outstandingCommands = new Array();
 var outstandingDisplayCommands = null;
@@ -253,23 +203,98 @@ function getButtonMask (button) {
     return 0;
 }
 
-function Texture(id, data) {
-    var url;
-    if (useDataUrls) {
-        url = bytesToDataUri(data);
-    } else {
-        var blob = new Blob([data],{type: "image/png"});
-        url = window.URL.createObjectURL(blob);
+const TILE_NEW = 0x80000000;
+
+function inflate(data) {
+    var stream = new Blob([data]).stream().pipeThrough(new DecompressionStream("deflate"));
+    return new Response(stream).arrayBuffer();
+}
+
+// The tile pixels are premultiplied, ImageData is not
+function storeTile(slot, pixels, offset, width, height) {
+    var imageData = new ImageData(width, height);
+    var data = imageData.data;
+    for (var i = 0; i < width * height * 4; i += 4) {
+        var a = pixels[offset + i + 3];
+        if (a == 255) {
+            data[i] = pixels[offset + i];
+            data[i + 1] = pixels[offset + i + 1];
+            data[i + 2] = pixels[offset + i + 2];
+        } else if (a != 0) {
+            data[i] = pixels[offset + i] * 255 / a;
+            data[i + 1] = pixels[offset + i + 1] * 255 / a;
+            data[i + 2] = pixels[offset + i + 2] * 255 / a;
+        }
+        data[i + 3] = a;
     }
+    tileCache[slot] = imageData;
+}
+
+function canvasToUrl(canvas) {
+    if (useDataUrls)
+        return Promise.resolve(canvas.toDataURL());
+
+    return new Promise(function(resolve, reject) {
+        canvas.toBlob(function(blob) {
+            if (blob)
+                resolve(window.URL.createObjectURL(blob));
+            else
+                reject();
+        });
+    });
+}
+
+function Texture(id, width, height, tileSize, slots, data) {
+    var texture = this;
+    var pixels = inflate(data);
 
-    this.url = url;
+    this.url = null;
     this.refcount = 1;
     this.id = id;
 
-    var image = new Image();
-    image.src = this.url;
-    this.image = image;
-    this.decoded = image.decode();
+    // Tiles are cached in the order the server sent them, so textures
+    // must be assembled in that order too, or we'd see reused slots.
+    var canvas = tileQueue.then(() => pixels).then(function(buffer) {
+        var pixels = new Uint8Array(buffer);
+        var canvas = document.createElement("canvas");
+        var context;
+        var offset = 0;
+        var i = 0;
+
+        canvas.width = width;
+        canvas.height = height;
+        context = canvas.getContext("2d");
+
+        for (var y = 0; y < height; y += tileSize) {
+            for (var x = 0; x < width; x += tileSize) {
+                var slot = slots[i++];
+                if (slot & TILE_NEW) {
+                    var w = Math.min(tileSize, width - x);
+                    var h = Math.min(tileSize, height - y);
+                    slot = slot & ~TILE_NEW;
+                    storeTile(slot, pixels, offset, w, h);
+                    offset += w * h * 4;
+                }
+                context.putImageData(tileCache[slot], x, y);
+            }
+        }
+        return canvas;
+    });
+    tileQueue = canvas.catch(() => {});
+
+    this.ready = canvas.then(canvasToUrl).then(function(url) {
+        texture.url = url;
+        if (texture.refcount == 0)
+            texture.revoke();
+    });
+
+    this.decoded = this.ready.then(function() {
+        var image = new Image();
+        image.src = texture.url;
+        texture.image = image;
+        return image.decode();
+    });
+
     textures[id] = this;
 }
 
@@ -278,16 +303,35 @@ Texture.prototype.ref = function() {
     return this;
 }
 
+Texture.prototype.revoke = function() {
+    if (this.url && this.url.startsWith("blob")) {
+        window.URL.revokeObjectURL(this.url);
+    }
+}
+
 Texture.prototype.unref = function() {
     this.refcount -= 1;
     if (this.refcount == 0) {
-        if (this.url.startsWith("blob")) {
-            window.URL.revokeObjectURL(this.url);
-        }
-        delete textures[this.id];
+        this.revoke();
+        if (textures[this.id] === this)
+            delete textures[this.id];
     }
 }
 
+// Takes over a reference to the texture until the image has loaded
+Texture.prototype.setImageSource = function(image) {
+    var texture = this;
+    var set = function() {
+        image.src = texture.url;
+        // Unref blob url when loaded
+        image.onload = function() { texture.unref(); };
+    };
+    if (this.url)
+        set();
+    else
+        this.ready.then(set);
+}
+
 function sendConfigureNotify(surface)
 {
     sendInput(BROADWAY_EVENT_CONFIGURE_NOTIFY, [surface.id, surface.x, surface.y, surface.width, surface.height]);
@@ -579,6 +623,31 @@ TransformNodes.prototype.createImage = function(id)
     return image;
 }
 
+TransformNodes.prototype.createCanvas = function(id)
+{
+    var canvas = document.createElement('canvas');
+    canvas.node_id = id;
+    this.nodes[id] = canvas;
+    return canvas;
+}
+
+// Draws glyphs from the white glyph atlas and tints them with the color
+function drawGlyphs(canvas, atlas, color, scale, glyphs)
+{
+    var context = canvas.getContext("2d");
+
+    for (var i = 0; i < glyphs.length; i += 6) {
+        context.drawImage(atlas,
+                          glyphs[i], glyphs[i + 1], glyphs[i + 2], glyphs[i + 3],
+                          Math.round(glyphs[i + 4] * scale), Math.round(glyphs[i + 5] * scale),
+                          glyphs[i + 2], glyphs[i + 3]);
+    }
+
+    context.globalCompositeOperation = "source-in";
+    context.fillStyle = color;
+    context.fillRect(0, 0, canvas.width, canvas.height);
+}
+
 TransformNodes.prototype.insertNode = function(parent, previousSibling, is_toplevel)
 {
     var type = this.decode_uint32();
@@ -605,14 +674,43 @@ TransformNodes.prototype.insertNode = function(parent, previousSibling, is_tople
             image.height = rect.height;
             image.style["position"] = "absolute";
             set_rect_style(image, rect);
-            var texture = textures[texture_id].ref();
-            image.src = texture.url;
-            // Unref blob url when loaded
-            image.onload = function() { texture.unref(); };
+            textures[texture_id].ref().setImageSource(image);
             newNode = image;
         }
         break;
 
+    case BROADWAY_NODE_TEXT:
+        {
+            var rect = this.decode_rect();
+            var c = this.decode_color ();
+            var scale = this.decode_uint32();
+            var texture = textures[this.decode_uint32()].ref();
+            var n_glyphs = this.decode_uint32();
+            var glyphs = new Array(n_glyphs * 6);
+            for (var i = 0; i < n_glyphs; i++) {
+                var pos = this.decode_uint32();
+                var size = this.decode_uint32();
+                glyphs[6 * i] = pos & 0xffff;
+                glyphs[6 * i + 1] = pos >>> 16;
+                glyphs[6 * i + 2] = size & 0xffff;
+                glyphs[6 * i + 3] = size >>> 16;
+                glyphs[6 * i + 4] = this.decode_float();
+                glyphs[6 * i + 5] = this.decode_float();
+            }
+            var canvas = this.createCanvas(id);
+            canvas.width = Math.ceil(rect.width * scale);
+            canvas.height = Math.ceil(rect.height * scale);
+            canvas.style["position"] = "absolute";
+            set_rect_style(canvas, rect);
+            texture.decoded.then(function() {
+                drawGlyphs(canvas, texture.image, c, scale, glyphs);
+            }).finally(function() {
+                texture.unref();
+            });
+            newNode = canvas;
+        }
+        break;
+
     case BROADWAY_NODE_COLOR:
         {
             var rect = this.decode_rect();
@@ -929,6 +1027,29 @@ function cmdUngrabPointer()
         doUngrab();
 }
 
+// The server dropped updates while we were behind and is about to
+// send the whole state again, so forget everything we know.
+function cmdReset()
+{
+    if (grab.surface != null)
+        doUngrab();
+
+    for (var id in surfaces) {
+        var div = surfaces[id].div;
+        if (div.parentNode)
+            div.parentNode.removeChild(div);
+    }
+    surfaces = {};
+    stackingOrder = [];
+
+    for (var id in textures)
+        textures[id].unref();
+    textures = {};
+
+    // Let pending tile decodes finish before dropping the cache
+    tileQueue = tileQueue.then(function() { tileCache = []; });
+}
+
 function handleDisplayCommands(display_commands)
 {
     var div, parent;
@@ -992,13 +1113,7 @@ function handleDisplayCommands(display_commands)
         case DISPLAY_OP_CHANGE_TEXTURE:
             var image = cmd[1];
             var texture = cmd[2];
-            // We need a new closure here to have a separate copy of "texture" for each iteration in the onload callback...
-            var block = function(t) {
-                image.src = t.url;
-                // Unref blob url when loaded
-                image.onload = function() { t.unref(); };
-            };
-            block(texture);
+            texture.setImageSource(image);
             break;
         case DISPLAY_OP_CHANGE_TRANSFORM:
             var div = cmd[1];
@@ -1027,6 +1142,16 @@ function handleCommands(cmd, display_commands, new_textures, modified_trees)
             inputSocket = null;
             break;
 
+        case BROADWAY_OP_RESET:
+            if (display_commands.length > 0 || new_textures.length > 0) {
+                // Apply what came before the reset first
+                cmd.pos = saved_pos;
+                res = false;
+            } else {
+                cmdReset();
+            }
+            break;
+
         case BROADWAY_OP_NEW_SURFACE:
             id = cmd.get_16();
             x = cmd.get_16s();
@@ -1129,8 +1254,15 @@ function handleCommands(cmd, display_commands, new_textures, modified_trees)
 
         case BROADWAY_OP_UPLOAD_TEXTURE:
             id = cmd.get_32();
+            var width = cmd.get_32();
+            var height = cmd.get_32();
+            var tileSize = cmd.get_32();
+            var n_tiles = Math.ceil(width / tileSize) * Math.ceil(height / tileSize);
+            var slots = new Array(n_tiles);
+            for (var i = 0; i < n_tiles; i++)
+                slots[i] = cmd.get_32();
             var data = cmd.get_data();
-            var texture = new Texture (id, data); // Stores a ref in global textures array
+            var texture = new Texture (id, width, height, tileSize, slots, data); // Stores a ref in global textures array
             new_textures.push(texture);
             break;
 
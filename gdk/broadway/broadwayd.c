@@ -58,6 +58,8 @@ typedef struct  {
   guint disconnect_idle;
   GList *fds;
   GHashTable *textures;
+  guint n_textures;
+  guint64 texture_bytes;
 } BroadwayClient;
 
 static void
@@ -110,6 +112,9 @@ client_disconnected (BroadwayClient *client)
   while (g_hash_table_iter_next (&iter, &key, &value))
     broadway_server_release_texture (server, GPOINTER_TO_INT (value));
 
+  g_debug ("Client %u uploaded %u textures, %" G_GUINT64_FORMAT " bytes",
+           client->id, client->n_textures, client->texture_bytes);
+
   broadway_server_flush (server);
 
   client_free (client);
@@ -308,7 +313,7 @@ client_handle_request (BroadwayClient *client,
           fd = GPOINTER_TO_INT (client->fds->data);
           client->fds = g_list_delete_link (client->fds, client->fds);
 
-          data = g_malloc (request->upload_texture.size);
+          data = g_malloc0 (request->upload_texture.size);
           to_read = request->upload_texture.size;
           lseek (fd, request->upload_texture.offset, SEEK_SET);
 
@@ -333,8 +338,21 @@ client_handle_request (BroadwayClient *client,
           while (to_read > 0);
           close (fd);
 
+          if (request->upload_texture.size != (gsize) request->upload_texture.width * request->upload_texture.height * 4)
+            {
+              g_warning ("Texture size mismatch for texture upload %d", request->upload_texture.id);
+              g_free (data);
+              break;
+            }
+
+          client->n_textures++;
+          client->texture_bytes += request->upload_texture.size;
+
           texture = g_bytes_new_take (data, request->upload_texture.size);
-          global_id = broadway_server_upload_texture (server, texture);
+          global_id = broadway_server_upload_texture (server,
+                                                      request->upload_texture.width,
+                                                      request->upload_texture.height,
+                                                      texture);
           g_bytes_unref (texture);
 
           g_hash_table_replace (client->textures,
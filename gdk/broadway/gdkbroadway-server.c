@@ -14,6 +14,7 @@
 
 #include "gdkprivate-broadway.h"
 #include <gdk/gdktextureprivate.h>
+#include <gdk/gdkmemorytextureprivate.h>
 
 #include <glib.h>
 #include <glib/gprintf.h>
@@ -607,32 +608,26 @@ open_shared_memory (void)
   return ret;
 }
 
-typedef struct {
-  int fd;
-  gsize size;
-} PngData;
-
-static cairo_status_t
-write_png_cb (void         *closure,
-              const guchar *data,
-              unsigned int  length)
+static gboolean
+write_all (int           fd,
+           const guchar *data,
+           gsize         length)
 {
-  PngData *png_data = closure;
-  int fd = png_data->fd;
-
   while (length)
     {
       gssize ret = write (fd, data, length);
 
+      if (ret < 0 && errno == EINTR)
+        continue;
+
       if (ret <= 0)
-        return CAIRO_STATUS_WRITE_ERROR;
+        return FALSE;
 
-      png_data->size += ret;
       length -= ret;
       data += ret;
     }
 
-  return CAIRO_STATUS_SUCCESS;
+  return TRUE;
 }
 
 guint32
@@ -642,21 +637,40 @@ gdk_broadway_server_upload_texture (GdkBroadwayServer *server,
   guint32 id;
   cairo_surface_t *surface = gdk_texture_download_surface (texture);
   BroadwayRequestUploadTexture msg;
-  PngData data;
+  int width, height;
+  guchar *data;
+  int fd;
 
   id = server->next_texture_id++;
 
-  data.fd = open_shared_memory ();
-  data.size = 0;
-  cairo_surface_write_to_png_stream (surface, write_png_cb, &data);
+  /* The daemon tiles and compresses the raw pixels itself, so that
+   * it can avoid resending tiles that the browser already has.
+   */
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  data = g_malloc ((gsize) width * height * 4);
+  gdk_memory_convert (data, width * 4,
+                      GDK_MEMORY_R8G8B8A8_PREMULTIPLIED,
+                      cairo_image_surface_get_data (surface),
+                      cairo_image_surface_get_stride (surface),
+                      GDK_MEMORY_DEFAULT,
+                      width, height);
+  cairo_surface_destroy (surface);
+
+  fd = open_shared_memory ();
+  if (!write_all (fd, data, (gsize) width * height * 4))
+    g_warning ("Failed to write texture data: %s", g_strerror (errno));
+  g_free (data);
 
   msg.id = id;
+  msg.width = width;
+  msg.height = height;
   msg.offset = 0;
-  msg.size = data.size;
+  msg.size = width * height * 4;
 
   /* This passes ownership of fd */
   gdk_broadway_server_send_fd_message (server, msg,
-                                       BROADWAY_REQUEST_UPLOAD_TEXTURE, data.fd);
+                                       BROADWAY_REQUEST_UPLOAD_TEXTURE, fd);
 
   return id;
 }
@@ -40,6 +40,8 @@ void           gdk_surface_set_widget (GdkSurface *surface,
                                        gpointer    widget);
 gpointer       gdk_surface_get_widget (GdkSurface *surface);
 
+const cairo_region_t * gdk_surface_get_repaint_region (GdkSurface *surface);
+
 typedef struct
 {
   const char *key;
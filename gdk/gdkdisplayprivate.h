@@ -99,6 +99,7 @@ struct _GdkDisplay
   VkDevice vk_device;
   VkQueue vk_queue;
   uint32_t vk_queue_family_index;
+  guint vk_dmabuf_import : 1;
 
   guint vulkan_refcount;
 #endif /* GDK_RENDERING_VULKAN */
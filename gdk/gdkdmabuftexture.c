@@ -0,0 +1,321 @@
+/* gdkdmabuftexture.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkdmabuftextureprivate.h"
+
+#include "gdkmemorytextureprivate.h"
+
+#include <errno.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_LINUX_DMA_BUF_H
+#include <sys/ioctl.h>
+#include <linux/dma-buf.h>
+#endif
+
+/**
+ * GdkDmabufTexture:
+ *
+ * A #GdkTexture representing a dma-buf, as used by video decoders,
+ * cameras and other devices to share buffers with the GPU.
+ *
+ * Renderers import the dma-buf directly, so its contents never get
+ * copied through the CPU. Downloading it with gdk_texture_download()
+ * is only supported for dma-bufs with a linear layout.
+ */
+struct _GdkDmabufTexture {
+  GdkTexture parent_instance;
+
+  guint32 fourcc;
+  guint64 modifier;
+  int fd;
+  guint32 offset;
+  guint32 stride;
+
+  GDestroyNotify destroy;
+  gpointer data;
+};
+
+struct _GdkDmabufTextureClass {
+  GdkTextureClass parent_class;
+};
+
+G_DEFINE_TYPE (GdkDmabufTexture, gdk_dmabuf_texture, GDK_TYPE_TEXTURE)
+
+static void
+gdk_dmabuf_texture_dispose (GObject *object)
+{
+  GdkDmabufTexture *self = GDK_DMABUF_TEXTURE (object);
+
+  if (self->destroy)
+    {
+      self->destroy (self->data);
+      self->destroy = NULL;
+      self->data = NULL;
+    }
+
+  self->fd = -1;
+
+  G_OBJECT_CLASS (gdk_dmabuf_texture_parent_class)->dispose (object);
+}
+
+#ifdef HAVE_LINUX_DMA_BUF_H
+static void
+gdk_dmabuf_texture_sync (GdkDmabufTexture *self,
+                         guint64           flags)
+{
+  struct dma_buf_sync sync = { flags | DMA_BUF_SYNC_READ };
+
+  /* Makes the reads coherent with the device writing to the buffer */
+  while (ioctl (self->fd, DMA_BUF_IOCTL_SYNC, &sync) == -1 &&
+         (errno == EINTR || errno == EAGAIN))
+    ;
+}
+#endif
+
+static void
+gdk_dmabuf_texture_download (GdkTexture         *texture,
+                             const GdkRectangle *area,
+                             guchar             *data,
+                             gsize               stride)
+{
+  GdkDmabufTexture *self = GDK_DMABUF_TEXTURE (texture);
+  static gboolean warned = FALSE;
+#ifdef HAVE_SYS_MMAN_H
+  gsize size;
+  guchar *map;
+
+  if (self->fd == -1 || self->modifier != GDK_DRM_FORMAT_MOD_LINEAR)
+    goto unsupported;
+
+  size = (gsize) self->offset + (gsize) self->stride * texture->height;
+  map = mmap (NULL, size, PROT_READ, MAP_SHARED, self->fd, 0);
+  if (map == MAP_FAILED)
+    goto unsupported;
+
+#ifdef HAVE_LINUX_DMA_BUF_H
+  gdk_dmabuf_texture_sync (self, DMA_BUF_SYNC_START);
+#endif
+
+  /* Both formats have their bytes in B, G, R, A order */
+  gdk_memory_convert (data, stride,
+                      GDK_MEMORY_CAIRO_FORMAT_ARGB32,
+                      map + self->offset + area->y * self->stride + area->x * 4,
+                      self->stride,
+                      GDK_MEMORY_B8G8R8A8_PREMULTIPLIED,
+                      area->width, area->height);
+
+#ifdef HAVE_LINUX_DMA_BUF_H
+  gdk_dmabuf_texture_sync (self, DMA_BUF_SYNC_END);
+#endif
+
+  munmap (map, size);
+
+  if (gdk_dmabuf_texture_is_opaque (self))
+    {
+      int x, y;
+
+      for (y = 0; y < area->height; y++)
+        {
+          guint32 *row = (guint32 *) (data + y * stride);
+
+          for (x = 0; x < area->width; x++)
+            row[x] |= 0xff000000;
+        }
+    }
+
+  return;
+
+unsupported:
+#endif
+  if (!warned)
+    {
+      g_warning ("Downloading dma-buf textures with modifier 0x%" G_GINT64_MODIFIER "x is not supported",
+                 self->modifier);
+      warned = TRUE;
+    }
+
+  for (int y = 0; y < area->height; y++)
+    memset (data + y * stride, 0, area->width * 4);
+}
+
+static void
+gdk_dmabuf_texture_class_init (GdkDmabufTextureClass *klass)
+{
+  GdkTextureClass *texture_class = GDK_TEXTURE_CLASS (klass);
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  texture_class->download = gdk_dmabuf_texture_download;
+  gobject_class->dispose = gdk_dmabuf_texture_dispose;
+}
+
+static void
+gdk_dmabuf_texture_init (GdkDmabufTexture *self)
+{
+  self->fd = -1;
+}
+
+/**
+ * gdk_dmabuf_texture_new:
+ * @width: the width of the texture
+ * @height: the height of the texture
+ * @fourcc: the DRM fourcc code of the buffer's format
+ * @modifier: the DRM format modifier of the buffer's layout
+ * @fd: a file descriptor of the dma-buf
+ * @offset: the offset of the first pixel in the dma-buf
+ * @stride: rowstride of the buffer
+ * @destroy: a destroy notify that will be called when the dma-buf
+ *           is no longer used
+ * @data: data that gets passed to @destroy
+ *
+ * Creates a new texture for an existing dma-buf.
+ *
+ * The supported formats are `DRM_FORMAT_ARGB8888`, with premultiplied
+ * alpha, and `DRM_FORMAT_XRGB8888`.
+ *
+ * Note that @fd must stay valid and the dma-buf must not be modified
+ * until @destroy is called, which will happen when the GdkTexture object
+ * is finalized.
+ *
+ * Return value: (transfer full): A newly-created #GdkTexture
+ */
+GdkTexture *
+gdk_dmabuf_texture_new (int             width,
+                        int             height,
+                        guint32         fourcc,
+                        guint64         modifier,
+                        int             fd,
+                        guint32         offset,
+                        guint32         stride,
+                        GDestroyNotify  destroy,
+                        gpointer        data)
+{
+  GdkDmabufTexture *self;
+
+  g_return_val_if_fail (width > 0, NULL);
+  g_return_val_if_fail (height > 0, NULL);
+  g_return_val_if_fail (fourcc == GDK_DRM_FORMAT_ARGB8888 || fourcc == GDK_DRM_FORMAT_XRGB8888, NULL);
+  g_return_val_if_fail (modifier != GDK_DRM_FORMAT_MOD_INVALID, NULL);
+  g_return_val_if_fail (fd >= 0, NULL);
+  g_return_val_if_fail (stride >= width * 4, NULL);
+
+  self = g_object_new (GDK_TYPE_DMABUF_TEXTURE,
+                       "width", width,
+                       "height", height,
+                       NULL);
+
+  self->fourcc = fourcc;
+  self->modifier = modifier;
+  self->fd = fd;
+  self->offset = offset;
+  self->stride = stride;
+  self->destroy = destroy;
+  self->data = data;
+
+  return GDK_TEXTURE (self);
+}
+
+/**
+ * gdk_dmabuf_texture_get_fourcc:
+ * @self: a #GdkDmabufTexture
+ *
+ * Gets the DRM fourcc code of the format of @self.
+ *
+ * Returns: the fourcc code
+ */
+guint32
+gdk_dmabuf_texture_get_fourcc (GdkDmabufTexture *self)
+{
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (self), 0);
+
+  return self->fourcc;
+}
+
+/**
+ * gdk_dmabuf_texture_get_modifier:
+ * @self: a #GdkDmabufTexture
+ *
+ * Gets the DRM format modifier of @self.
+ *
+ * Returns: the modifier
+ */
+guint64
+gdk_dmabuf_texture_get_modifier (GdkDmabufTexture *self)
+{
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (self), GDK_DRM_FORMAT_MOD_INVALID);
+
+  return self->modifier;
+}
+
+/**
+ * gdk_dmabuf_texture_get_fd:
+ * @self: a #GdkDmabufTexture
+ *
+ * Gets the file descriptor of the dma-buf of @self.
+ *
+ * The file descriptor is owned by @self, or whoever created it.
+ *
+ * Returns: the file descriptor, or -1 if it was released
+ */
+int
+gdk_dmabuf_texture_get_fd (GdkDmabufTexture *self)
+{
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (self), -1);
+
+  return self->fd;
+}
+
+/**
+ * gdk_dmabuf_texture_get_offset:
+ * @self: a #GdkDmabufTexture
+ *
+ * Gets the offset of the first pixel of @self in its dma-buf.
+ *
+ * Returns: the offset in bytes
+ */
+guint32
+gdk_dmabuf_texture_get_offset (GdkDmabufTexture *self)
+{
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (self), 0);
+
+  return self->offset;
+}
+
+/**
+ * gdk_dmabuf_texture_get_stride:
+ * @self: a #GdkDmabufTexture
+ *
+ * Gets the rowstride of @self.
+ *
+ * Returns: the stride in bytes
+ */
+guint32
+gdk_dmabuf_texture_get_stride (GdkDmabufTexture *self)
+{
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (self), 0);
+
+  return self->stride;
+}
+
+gboolean
+gdk_dmabuf_texture_is_opaque (GdkDmabufTexture *self)
+{
+  return self->fourcc == GDK_DRM_FORMAT_XRGB8888;
+}
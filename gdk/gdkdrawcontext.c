@@ -26,6 +26,8 @@
 #include "gdkintl.h"
 #include "gdkprofilerprivate.h"
 
+#include <string.h>
+
 /**
  * SECTION:gdkdrawcontext
  * @Title: GdkDrawContext
@@ -53,6 +55,12 @@ struct _GdkDrawContextPrivate {
   GdkSurface *surface;
 
   cairo_region_t *frame_region;
+
+  /* The update areas of the last frames, most recent first,
+   * to support buffer-age optimizations */
+  cairo_region_t *damage_history[GDK_DRAW_CONTEXT_DAMAGE_HISTORY];
+  /* The region that was actually repainted in the last frame */
+  cairo_region_t *repaint_region;
 };
 
 enum {
@@ -85,6 +93,9 @@ gdk_draw_context_dispose (GObject *gobject)
       g_clear_object (&priv->surface);
     }
 
+  gdk_draw_context_clear_damage_history (context);
+  g_clear_pointer (&priv->repaint_region, cairo_region_destroy);
+
   G_OBJECT_CLASS (gdk_draw_context_parent_class)->dispose (gobject);
 }
 
@@ -217,9 +228,102 @@ gdk_draw_context_is_in_frame (GdkDrawContext *context)
 void
 gdk_draw_context_surface_resized (GdkDrawContext *context)
 {
+  gdk_draw_context_clear_damage_history (context);
+
   GDK_DRAW_CONTEXT_GET_CLASS (context)->surface_resized (context);
 }
 
+/*< private >
+ * gdk_draw_context_push_damage:
+ * @context: a #GdkDrawContext
+ * @region: the update area of the frame that is being drawn
+ *
+ * Records the update area of a frame, so that later frames can use
+ * gdk_draw_context_get_damage_for_age() to find out what changed
+ * since the buffer they draw to was last presented.
+ */
+void
+gdk_draw_context_push_damage (GdkDrawContext       *context,
+                              const cairo_region_t *region)
+{
+  GdkDrawContextPrivate *priv = gdk_draw_context_get_instance_private (context);
+
+  g_clear_pointer (&priv->damage_history[GDK_DRAW_CONTEXT_DAMAGE_HISTORY - 1], cairo_region_destroy);
+  memmove (&priv->damage_history[1], &priv->damage_history[0],
+           sizeof (cairo_region_t *) * (GDK_DRAW_CONTEXT_DAMAGE_HISTORY - 1));
+  priv->damage_history[0] = cairo_region_copy (region);
+}
+
+/*< private >
+ * gdk_draw_context_get_damage_for_age:
+ * @context: a #GdkDrawContext
+ * @buffer_age: the age of the back buffer, as reported by
+ *   EGL_EXT_buffer_age and similar extensions
+ *
+ * Computes the area that needs to be repainted in a back buffer of
+ * the given age to bring it up to date, in addition to the update
+ * area of the current frame. Call this before pushing the current
+ * frame with gdk_draw_context_push_damage().
+ *
+ * Returns: (nullable): the damage, or %NULL if it is not known and
+ *   the whole surface has to be repainted
+ */
+cairo_region_t *
+gdk_draw_context_get_damage_for_age (GdkDrawContext *context,
+                                     int             buffer_age)
+{
+  GdkDrawContextPrivate *priv = gdk_draw_context_get_instance_private (context);
+  cairo_region_t *damage;
+  int i;
+
+  /* An age of 0 means the contents are undefined */
+  if (buffer_age < 1 || buffer_age > GDK_DRAW_CONTEXT_DAMAGE_HISTORY + 1)
+    return NULL;
+
+  damage = cairo_region_create ();
+  for (i = 0; i < buffer_age - 1; i++)
+    {
+      if (priv->damage_history[i] == NULL)
+        {
+          cairo_region_destroy (damage);
+          return NULL;
+        }
+
+      cairo_region_union (damage, priv->damage_history[i]);
+    }
+
+  return damage;
+}
+
+void
+gdk_draw_context_clear_damage_history (GdkDrawContext *context)
+{
+  GdkDrawContextPrivate *priv = gdk_draw_context_get_instance_private (context);
+  int i;
+
+  for (i = 0; i < GDK_DRAW_CONTEXT_DAMAGE_HISTORY; i++)
+    g_clear_pointer (&priv->damage_history[i], cairo_region_destroy);
+}
+
+/*< private >
+ * gdk_draw_context_get_repaint_region:
+ * @context: a #GdkDrawContext
+ *
+ * Returns the region that was repainted by the last frame, that is
+ * its update area plus what the context added to it to bring the
+ * back buffer up to date. This is used by the inspector to show
+ * how effective damage tracking is.
+ *
+ * Returns: (nullable) (transfer none): the repainted region
+ */
+const cairo_region_t *
+gdk_draw_context_get_repaint_region (GdkDrawContext *context)
+{
+  GdkDrawContextPrivate *priv = gdk_draw_context_get_instance_private (context);
+
+  return priv->repaint_region;
+}
+
 /**
  * gdk_draw_context_get_display:
  * @context: a #GdkDrawContext
@@ -319,6 +423,9 @@ gdk_draw_context_begin_frame (GdkDrawContext       *context,
   priv->surface->paint_context = g_object_ref (context);
 
   GDK_DRAW_CONTEXT_GET_CLASS (context)->begin_frame (context, priv->frame_region);
+
+  g_clear_pointer (&priv->repaint_region, cairo_region_destroy);
+  priv->repaint_region = cairo_region_copy (priv->frame_region);
 }
 
 #ifdef HAVE_SYSPROF
@@ -31,6 +31,10 @@ G_BEGIN_DECLS
 
 typedef struct _GdkDrawContextClass GdkDrawContextClass;
 
+/* The number of frames whose update area is remembered, so buffer
+ * ages up to GDK_DRAW_CONTEXT_DAMAGE_HISTORY + 1 can be handled */
+#define GDK_DRAW_CONTEXT_DAMAGE_HISTORY 4
+
 struct _GdkDrawContext
 {
   GObject parent_instance;
@@ -49,6 +53,13 @@ struct _GdkDrawContextClass
 
 void                    gdk_draw_context_surface_resized        (GdkDrawContext         *context);
 
+void                    gdk_draw_context_push_damage            (GdkDrawContext         *context,
+                                                                 const cairo_region_t   *region);
+cairo_region_t *        gdk_draw_context_get_damage_for_age     (GdkDrawContext         *context,
+                                                                 int                     buffer_age);
+void                    gdk_draw_context_clear_damage_history   (GdkDrawContext         *context);
+const cairo_region_t *  gdk_draw_context_get_repaint_region     (GdkDrawContext         *context);
+
 G_END_DECLS
 
 #endif /* __GDK__DRAW_CONTEXT_PRIVATE__ */
@@ -715,34 +715,69 @@ gdk_event_queue_handle_scroll_compression (GdkDisplay *display)
     }
 }
 
+static GArray **
+gdk_event_get_history_array (GdkEvent *event)
+{
+  if (GDK_IS_EVENT_TYPE (event, GDK_MOTION_NOTIFY))
+    return &((GdkMotionEvent *) event)->history;
+  else if (GDK_IS_EVENT_TYPE (event, GDK_TOUCH_UPDATE))
+    return &((GdkTouchEvent *) event)->history;
+
+  g_assert_not_reached ();
+  return NULL;
+}
+
 static void
-gdk_motion_event_push_history (GdkEvent *event,
-                               GdkEvent *history_event)
+gdk_event_push_history (GdkEvent *event,
+                        GdkEvent *history_event)
 {
-  GdkMotionEvent *self = (GdkMotionEvent *) event;
+  GArray **history = gdk_event_get_history_array (event);
+  GArray *old_history = *gdk_event_get_history_array (history_event);
   GdkDeviceTool *tool;
   GdkTimeCoord hist;
   int i;
 
-  g_assert (GDK_IS_EVENT_TYPE (event, GDK_MOTION_NOTIFY));
-  g_assert (GDK_IS_EVENT_TYPE (history_event, GDK_MOTION_NOTIFY));
+  if (G_UNLIKELY (!*history))
+    *history = g_array_new (FALSE, TRUE, sizeof (GdkTimeCoord));
 
-  if (!self->tool)
-    return;
+  /* The dropped event may carry history of its own, from a previous
+   * round of compression; keep it so no sample gets lost.
+   */
+  if (old_history)
+    g_array_append_vals (*history, old_history->data, old_history->len);
 
   tool = gdk_event_get_device_tool (history_event);
 
   memset (&hist, 0, sizeof (GdkTimeCoord));
   hist.time = gdk_event_get_time (history_event);
-  hist.flags = gdk_device_tool_get_axes (tool);
+  if (tool)
+    hist.flags = gdk_device_tool_get_axes (tool);
+  else
+    hist.flags = GDK_AXIS_FLAG_X | GDK_AXIS_FLAG_Y;
 
   for (i = GDK_AXIS_X; i < GDK_AXIS_LAST; i++)
     gdk_event_get_axis (history_event, i, &hist.axes[i]);
 
-  if (G_UNLIKELY (!self->history))
-    self->history = g_array_new (FALSE, TRUE, sizeof (GdkTimeCoord));
+  g_array_append_val (*history, hist);
+}
+
+static gboolean
+gdk_event_wants_history (GdkEvent *event)
+{
+  GdkModifierType state;
+
+  /* Touch points and styli are used for drawing and handwriting,
+   * where every sample matters, even while hovering. For other
+   * pointers, only keep the samples of drags.
+   */
+  if (GDK_IS_EVENT_TYPE (event, GDK_TOUCH_UPDATE) ||
+      gdk_event_get_device_tool (event) != NULL)
+    return TRUE;
+
+  state = gdk_event_get_modifier_state (event);
 
-  g_array_append_val (self->history, hist);
+  return (state & (GDK_BUTTON1_MASK | GDK_BUTTON2_MASK | GDK_BUTTON3_MASK |
+                   GDK_BUTTON4_MASK | GDK_BUTTON5_MASK)) != 0;
 }
 
 void
@@ -752,10 +787,14 @@ _gdk_event_queue_handle_motion_compression (GdkDisplay *display)
   GList *pending_motions = NULL;
   GdkSurface *pending_motion_surface = NULL;
   GdkDevice *pending_motion_device = NULL;
+  GdkEventSequence *pending_motion_sequence = NULL;
   GdkEvent *last_motion = NULL;
+  gboolean keep_history;
 
   /* If the last N events in the event queue are motion notify
-   * events for the same surface, drop all but the last */
+   * events (or touch updates of the same sequence) for the same
+   * surface, drop all but the last, and record the dropped ones
+   * in its history */
 
   tmp_list = g_queue_peek_tail_link (&display->queued_events);
 
@@ -766,7 +805,12 @@ _gdk_event_queue_handle_motion_compression (GdkDisplay *display)
       if (event->flags & GDK_EVENT_PENDING)
         break;
 
-      if (event->event_type != GDK_MOTION_NOTIFY)
+      if (event->event_type != GDK_MOTION_NOTIFY &&
+          event->event_type != GDK_TOUCH_UPDATE)
+        break;
+
+      if (last_motion != NULL &&
+          last_motion->event_type != event->event_type)
         break;
 
       if (pending_motion_surface != NULL &&
@@ -777,29 +821,30 @@ _gdk_event_queue_handle_motion_compression (GdkDisplay *display)
           pending_motion_device != event->device)
         break;
 
+      if (last_motion != NULL &&
+          event->event_type == GDK_TOUCH_UPDATE &&
+          pending_motion_sequence != gdk_event_get_event_sequence (event))
+        break;
+
       if (!last_motion)
         last_motion = event;
 
       pending_motion_surface = event->surface;
       pending_motion_device = event->device;
+      pending_motion_sequence = gdk_event_get_event_sequence (event);
       pending_motions = tmp_list;
 
       tmp_list = tmp_list->prev;
     }
 
+  keep_history = last_motion != NULL && gdk_event_wants_history (last_motion);
+
   while (pending_motions && pending_motions->next != NULL)
     {
       GList *next = pending_motions->next;
 
-      if (last_motion != NULL)
-        {
-          GdkModifierType state = gdk_event_get_modifier_state (last_motion);
-
-          if (state &
-              (GDK_BUTTON1_MASK | GDK_BUTTON2_MASK | GDK_BUTTON3_MASK |
-               GDK_BUTTON4_MASK | GDK_BUTTON5_MASK))
-           gdk_motion_event_push_history (last_motion, pending_motions->data);
-        }
+      if (keep_history)
+        gdk_event_push_history (last_motion, pending_motions->data);
 
       gdk_event_unref (pending_motions->data);
       g_queue_delete_link (&display->queued_events, pending_motions);
@@ -1895,6 +1940,8 @@ gdk_touch_event_finalize (GdkEvent *event)
   GdkTouchEvent *self = (GdkTouchEvent *) event;
 
   g_clear_pointer (&self->axes, g_free);
+  if (self->history)
+    g_array_free (self->history, TRUE);
 
   GDK_EVENT_SUPER (event)->finalize (event);
 }
@@ -2853,7 +2900,7 @@ gdk_motion_event_new (GdkSurface      *surface,
 
 /**
  * gdk_event_get_history:
- * @event: a motion or scroll #GdkEvent
+ * @event: a motion, touch update or scroll #GdkEvent
  * @out_n_coords: (out): Return location for the length of the returned array
  *
  * Retrieves the history of the @event, as a list of time and coordinates.
@@ -2861,8 +2908,9 @@ gdk_motion_event_new (GdkSurface      *surface,
  * The history includes events that are not delivered to the application
  * because they occurred in the same frame as @event.
  *
- * Note that only motion and scroll events record history, and motion
- * events only if one of the mouse buttons is down.
+ * Note that only motion, touch update and scroll events record history.
+ * Motion events of pointers without a #GdkDeviceTool only record history
+ * if one of the mouse buttons is down.
  *
  * Returns: (transfer container) (array length=out_n_coords) (nullable): an
  *   array of time and coordinates
@@ -2875,6 +2923,7 @@ gdk_event_get_history (GdkEvent *event,
 
   g_return_val_if_fail (GDK_IS_EVENT (event), NULL);
   g_return_val_if_fail (GDK_IS_EVENT_TYPE (event, GDK_MOTION_NOTIFY) ||
+                        GDK_IS_EVENT_TYPE (event, GDK_TOUCH_UPDATE) ||
                         GDK_IS_EVENT_TYPE (event, GDK_SCROLL), NULL);
   g_return_val_if_fail (out_n_coords != NULL, NULL);
 
@@ -2883,6 +2932,11 @@ gdk_event_get_history (GdkEvent *event,
       GdkMotionEvent *self = (GdkMotionEvent *) event;
       history = self->history;
     }
+  else if (GDK_IS_EVENT_TYPE (event, GDK_TOUCH_UPDATE))
+    {
+      GdkTouchEvent *self = (GdkTouchEvent *) event;
+      history = self->history;
+    }
   else
     {
       GdkScrollEvent *self = (GdkScrollEvent *) event;
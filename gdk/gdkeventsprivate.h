@@ -169,6 +169,9 @@ struct _GdkButtonEvent
  *   if @device is the mouse
  * @sequence: the event sequence that the event belongs to
  * @emulated: whether the event is the result of a pointer emulation
+ * @history: (element-type GdkTimeCoord): a list of time and coordinates
+ *   for other touch updates of the same sequence that were compressed
+ *   before delivering the current event
  *
  * Used for touch events.
  * @type field will be one of %GDK_TOUCH_BEGIN, %GDK_TOUCH_UPDATE,
@@ -192,6 +195,7 @@ struct _GdkTouchEvent
   GdkEventSequence *sequence;
   gboolean touch_emulating;
   gboolean pointer_emulated;
+  GArray *history; /* <GdkTimeCoord> */
 };
 
 /*
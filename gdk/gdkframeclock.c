@@ -27,6 +27,10 @@
 #include "gdkframeclockprivate.h"
 #include "gdkinternals.h"
 
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
 /**
  * SECTION:gdkframeclock
  * @Short_description: Frame clock syncs painting to a window or display
@@ -91,6 +95,9 @@ static guint fps_counter;
 
 #define FRAME_HISTORY_MAX_LENGTH 16
 
+/* How many frames the frame statistics look at */
+#define FRAME_STATS_LENGTH 128
+
 struct _GdkFrameClockPrivate
 {
   gint64 frame_counter;
@@ -98,6 +105,13 @@ struct _GdkFrameClockPrivate
   int current;
   GdkFrameTimings *timings[FRAME_HISTORY_MAX_LENGTH];
   int n_freeze_inhibitors;
+
+  /* The durations of the last completed frames, as a ring buffer */
+  gint64 frame_durations[FRAME_STATS_LENGTH];
+  int n_frame_durations;
+  int frame_durations_pos;
+  guint64 dropped_frames;
+  gint64 stats_frame_counter;
 };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (GdkFrameClock, gdk_frame_clock, G_TYPE_OBJECT)
@@ -442,6 +456,135 @@ gdk_frame_clock_get_history_start (GdkFrameClock *frame_clock)
   return priv->frame_counter + 1 - priv->n_timings;
 }
 
+/* Adds the frames that were completed since the last call to the
+ * frame statistics. This has to be called before their timings
+ * drop out of the history.
+ */
+static void
+gdk_frame_clock_update_stats (GdkFrameClock *frame_clock)
+{
+  GdkFrameClockPrivate *priv = frame_clock->priv;
+  GdkFrameTimings *timings, *previous;
+  gint64 i;
+
+  for (i = MAX (priv->stats_frame_counter + 1, gdk_frame_clock_get_history_start (frame_clock));
+       i <= priv->frame_counter;
+       i++)
+    {
+      timings = gdk_frame_clock_get_timings (frame_clock, i);
+      if (timings == NULL)
+        continue;
+
+      /* Frames complete in order, so wait for this one */
+      if (!timings->complete)
+        break;
+
+      priv->stats_frame_counter = i;
+
+      if (timings->frame_end_time == 0)
+        continue;
+
+      priv->frame_durations[priv->frame_durations_pos] = timings->frame_end_time - timings->frame_time;
+      priv->frame_durations_pos = (priv->frame_durations_pos + 1) % FRAME_STATS_LENGTH;
+      priv->n_frame_durations = MIN (priv->n_frame_durations + 1, FRAME_STATS_LENGTH);
+
+      /* Only frames that started before the previous frame was shown are
+       * part of a continuous sequence. Any vblank they miss is dropped.
+       */
+      previous = gdk_frame_clock_get_timings (frame_clock, i - 1);
+      if (previous != NULL &&
+          previous->presentation_time != 0 &&
+          timings->presentation_time != 0 &&
+          timings->refresh_interval != 0 &&
+          timings->frame_time < previous->presentation_time)
+        {
+          gint64 n_intervals;
+
+          n_intervals = (timings->presentation_time - previous->presentation_time +
+                         timings->refresh_interval / 2) / timings->refresh_interval;
+          if (n_intervals > 1)
+            priv->dropped_frames += n_intervals - 1;
+        }
+    }
+}
+
+static int
+compare_durations (gconstpointer a,
+                   gconstpointer b)
+{
+  gint64 da = *(const gint64 *) a;
+  gint64 db = *(const gint64 *) b;
+
+  return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+/**
+ * gdk_frame_clock_get_frame_duration_percentile:
+ * @frame_clock: a #GdkFrameClock
+ * @percentile: the percentile to compute, between 0 and 100
+ *
+ * Computes a percentile of the time it took to produce the last
+ * completed frames of @frame_clock, from the start of the frame
+ * to the end of the #GdkFrameClock::after-paint phase.
+ *
+ * For example, a @percentile of 99 returns a duration that 99% of
+ * the recent frames stayed below. Comparing this to the refresh
+ * interval shows how close an application is to dropping frames.
+ *
+ * Returns: the duration in microseconds, or 0 if no frames
+ *   were completed yet
+ */
+gint64
+gdk_frame_clock_get_frame_duration_percentile (GdkFrameClock *frame_clock,
+                                               double         percentile)
+{
+  GdkFrameClockPrivate *priv;
+  gint64 durations[FRAME_STATS_LENGTH];
+  int n, index;
+
+  g_return_val_if_fail (GDK_IS_FRAME_CLOCK (frame_clock), 0);
+  g_return_val_if_fail (percentile >= 0 && percentile <= 100, 0);
+
+  priv = frame_clock->priv;
+
+  gdk_frame_clock_update_stats (frame_clock);
+
+  n = priv->n_frame_durations;
+  if (n == 0)
+    return 0;
+
+  memcpy (durations, priv->frame_durations, n * sizeof (gint64));
+  qsort (durations, n, sizeof (gint64), compare_durations);
+
+  index = (int) ceil (percentile / 100 * n) - 1;
+
+  return durations[CLAMP (index, 0, n - 1)];
+}
+
+/**
+ * gdk_frame_clock_get_dropped_frames:
+ * @frame_clock: a #GdkFrameClock
+ *
+ * Gets the number of frames that were dropped since @frame_clock
+ * was created.
+ *
+ * A frame counts as dropped when a continuous sequence of frames,
+ * such as an animation, misses a vblank. This needs presentation
+ * times from the windowing system, so it may always be 0 on some
+ * platforms.
+ *
+ * Returns: the number of dropped frames
+ */
+guint64
+gdk_frame_clock_get_dropped_frames (GdkFrameClock *frame_clock)
+{
+  g_return_val_if_fail (GDK_IS_FRAME_CLOCK (frame_clock), 0);
+
+  gdk_frame_clock_update_stats (frame_clock);
+
+  return frame_clock->priv->dropped_frames;
+}
+
 void
 _gdk_frame_clock_begin_frame (GdkFrameClock *frame_clock)
 {
@@ -451,6 +594,8 @@ _gdk_frame_clock_begin_frame (GdkFrameClock *frame_clock)
 
   priv = frame_clock->priv;
 
+  gdk_frame_clock_update_stats (frame_clock);
+
   priv->frame_counter++;
   priv->current = (priv->current + 1) % FRAME_HISTORY_MAX_LENGTH;
 
@@ -571,6 +716,12 @@ _gdk_frame_clock_debug_print_timings (GdkFrameClock   *clock,
     g_string_append_printf (str, " present=%-4.1f", (timings->presentation_time - timings->frame_time) / 1000.);
   if (timings->predicted_presentation_time != 0)
     g_string_append_printf (str, " predicted=%-4.1f", (timings->predicted_presentation_time - timings->frame_time) / 1000.);
+  if (timings->render_cpu_time != 0)
+    g_string_append_printf (str, " render=%-4.1f", timings->render_cpu_time / 1000.);
+  if (timings->render_gpu_time != 0)
+    g_string_append_printf (str, " gpu=%-4.1f", timings->render_gpu_time / 1000.);
+  if (timings->presentation_time != 0 && timings->presentation_is_accurate)
+    g_string_append_printf (str, " latency=%-4.1f", (timings->presentation_time - timings->frame_time) / 1000.);
   if (timings->refresh_interval != 0)
     g_string_append_printf (str, " refresh_interval=%-4.1f", timings->refresh_interval / 1000.);
 
@@ -106,6 +106,17 @@ void gdk_frame_clock_get_refresh_info (GdkFrameClock *frame_clock,
 GDK_AVAILABLE_IN_ALL
 double gdk_frame_clock_get_fps (GdkFrameClock *frame_clock);
 
+GDK_AVAILABLE_IN_ALL
+gint64  gdk_frame_clock_get_frame_duration_percentile (GdkFrameClock *frame_clock,
+                                                       double         percentile);
+GDK_AVAILABLE_IN_ALL
+guint64 gdk_frame_clock_get_dropped_frames            (GdkFrameClock *frame_clock);
+
+/* Declared here because it needs GdkFrameClockPhase */
+GDK_AVAILABLE_IN_ALL
+gint64  gdk_frame_timings_get_phase_duration          (GdkFrameTimings    *timings,
+                                                       GdkFrameClockPhase  phase);
+
 G_END_DECLS
 
 #endif /* __GDK_FRAME_CLOCK_H__ */
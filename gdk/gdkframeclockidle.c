@@ -35,7 +35,10 @@
 #include <windows.h>
 #endif
 
-#define FRAME_INTERVAL 16667 /* microseconds */
+#define FRAME_INTERVAL 16667 /* microseconds, used until we know the monitor */
+
+/* How many frames to look at when estimating the time a frame takes */
+#define FRAME_DURATION_HISTORY 8
 
 typedef enum {
   SMOOTH_PHASE_STATE_VALID = 0,    /* explicit, since we count on zero-init */
@@ -51,6 +54,7 @@ struct _GdkFrameClockIdlePrivate
   gint64 smoothed_frame_time_reported; /* Ensures we are always monotonic */
   gint64 smoothed_frame_time_phase;    /* The offset of the first reported frame time, in the current animation sequence, from the preceding vsync */
   gint64 min_next_frame_time;          /* We're not synced to vblank, so wait at least until this before next cycle to avoid busy looping */
+  gint64 refresh_interval;             /* The refresh interval of the monitor we are on. With variable refresh, the shortest one */
   SmoothDeltaState smooth_phase_state; /* The state of smoothed_frame_time_phase - is it valid, awaiting vsync etc. Thanks to zero-init, the initial value
                                           of smoothed_frame_time_phase is `0`. This is valid, since we didn't get a "frame drawn" event yet. Accordingly,
                                           the initial value of smooth_phase_state is SMOOTH_PHASE_STATE_VALID. See the comment in gdk_frame_clock_paint_idle()
@@ -58,6 +62,7 @@ struct _GdkFrameClockIdlePrivate
 
   gint64 sleep_serial;
   gint64 freeze_time; /* in microseconds */
+  gint64 flush_events_duration; /* of the flush that happens before the next frame */
 
   guint flush_idle_id;
   guint paint_idle_id;
@@ -69,6 +74,7 @@ struct _GdkFrameClockIdlePrivate
 
   guint in_paint_idle : 1;
   guint paint_is_thaw : 1;
+  guint variable_refresh : 1;
 #ifdef G_OS_WIN32
   guint begin_period : 1;
 #endif
@@ -140,6 +146,7 @@ gdk_frame_clock_idle_init (GdkFrameClockIdle *frame_clock_idle)
     gdk_frame_clock_idle_get_instance_private (frame_clock_idle);
 
   priv->freeze_count = 0;
+  priv->refresh_interval = FRAME_INTERVAL;
   priv->smoothed_frame_time_period = FRAME_INTERVAL;
 }
 
@@ -347,12 +354,80 @@ maybe_stop_idle (GdkFrameClockIdle *clock_idle)
     }
 }
 
+/* Predicts when the next frame has to start so that it is done
+ * just in time for the compositor to show it at the next vblank.
+ * This uses the presentation times reported by the compositor and
+ * the time the last frames took to draw.
+ *
+ * Returns 0 if there isn't enough information for a prediction.
+ */
+static gint64
+compute_just_in_time_frame_start (GdkFrameClock *clock,
+                                  gint64         now)
+{
+  GdkFrameTimings *timings;
+  gint64 presentation_time = 0;
+  gint64 refresh_interval = 0;
+  gint64 frame_duration = 0;
+  gint64 next_vblank;
+  gint64 history_start;
+  gint64 i;
+  int n_frames = 0;
+
+  history_start = gdk_frame_clock_get_history_start (clock);
+
+  for (i = gdk_frame_clock_get_frame_counter (clock);
+       i >= history_start && n_frames < FRAME_DURATION_HISTORY;
+       i--)
+    {
+      timings = gdk_frame_clock_get_timings (clock, i);
+      if (timings == NULL || !timings->complete || timings->frame_end_time == 0)
+        continue;
+
+      if (presentation_time == 0)
+        {
+          if (!timings->presentation_is_accurate ||
+              timings->presentation_time == 0 ||
+              timings->refresh_interval == 0)
+            return 0;
+
+          presentation_time = timings->presentation_time;
+          refresh_interval = timings->refresh_interval;
+        }
+
+      /* Be pessimistic, a late frame costs a whole refresh cycle */
+      frame_duration = MAX (frame_duration, timings->frame_end_time - timings->frame_time);
+      n_frames++;
+    }
+
+  if (n_frames == 0 || presentation_time > now)
+    return 0;
+
+  next_vblank = presentation_time +
+                ((now - presentation_time) / refresh_interval + 1) * refresh_interval;
+
+  /* Leave the compositor half a refresh cycle to put the frame on screen */
+  return next_vblank - refresh_interval / 2 - frame_duration;
+}
+
+static void
+record_phase_duration (GdkFrameTimings    *timings,
+                       GdkFrameClockPhase  phase,
+                       gint64              start_time)
+{
+  if (timings == NULL)
+    return;
+
+  timings->phase_durations[g_bit_nth_lsf (phase, -1)] += g_get_monotonic_time () - start_time;
+}
+
 static gboolean
 gdk_frame_clock_flush_idle (void *data)
 {
   GdkFrameClock *clock = GDK_FRAME_CLOCK (data);
   GdkFrameClockIdle *clock_idle = GDK_FRAME_CLOCK_IDLE (clock);
   GdkFrameClockIdlePrivate *priv = clock_idle->priv;
+  gint64 start_time;
 
   priv->flush_idle_id = 0;
 
@@ -362,7 +437,9 @@ gdk_frame_clock_flush_idle (void *data)
   priv->phase = GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS;
   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS;
 
+  start_time = g_get_monotonic_time ();
   _gdk_frame_clock_emit_flush_events (clock);
+  priv->flush_events_duration += g_get_monotonic_time () - start_time;
 
   if ((priv->requested & ~GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS) != 0 ||
       priv->updating_count > 0)
@@ -400,6 +477,7 @@ gdk_frame_clock_paint_idle (void *data)
   GdkFrameClockIdlePrivate *priv = clock_idle->priv;
   gboolean skip_to_resume_events;
   GdkFrameTimings *timings = NULL;
+  gint64 start_time;
   gint64 before G_GNUC_UNUSED;
 
   before = GDK_PROFILER_CURRENT_TIME;
@@ -427,10 +505,10 @@ gdk_frame_clock_paint_idle (void *data)
         case GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT:
           if (priv->freeze_count == 0)
             {
-              gint64 frame_interval = FRAME_INTERVAL;
+              gint64 frame_interval = priv->refresh_interval;
               GdkFrameTimings *prev_timings = gdk_frame_clock_get_current_timings (clock);
 
-              if (prev_timings && prev_timings->refresh_interval)
+              if (prev_timings && prev_timings->refresh_interval && !priv->variable_refresh)
                 frame_interval = prev_timings->refresh_interval;
 
               priv->frame_time = g_get_monotonic_time ();
@@ -501,9 +579,13 @@ gdk_frame_clock_paint_idle (void *data)
                   priv->smooth_phase_state = SMOOTH_PHASE_STATE_VALID;
                 }
 
-              if (priv->smoothed_frame_time_base == 0)
+              if (priv->smoothed_frame_time_base == 0 || priv->variable_refresh)
                 {
-                  /* First frame ever, or first cycle in a new animation sequence. Ensure monotonicity */
+                  /* First frame ever, or first cycle in a new animation sequence. Ensure monotonicity.
+                   * With variable refresh, there is no vsync grid to align to, the frame is shown
+                   * when it is done.
+                   */
+                  priv->smoothed_frame_time_phase = 0;
                   priv->smoothed_frame_time_base = MAX (priv->frame_time, priv->smoothed_frame_time_reported);
                 }
               else
@@ -526,6 +608,8 @@ gdk_frame_clock_paint_idle (void *data)
               timings->frame_time = priv->frame_time;
               timings->smoothed_frame_time = priv->smoothed_frame_time_base;
               timings->slept_before = priv->sleep_serial != get_sleep_serial ();
+              timings->phase_durations[g_bit_nth_lsf (GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS, -1)] = priv->flush_events_duration;
+              priv->flush_events_duration = 0;
 
               priv->phase = GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
 
@@ -535,7 +619,9 @@ gdk_frame_clock_paint_idle (void *data)
                * in them.
                */
               priv->requested &= ~GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
+              start_time = g_get_monotonic_time ();
               _gdk_frame_clock_emit_before_paint (clock);
+              record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT, start_time);
               priv->phase = GDK_FRAME_CLOCK_PHASE_UPDATE;
             }
           G_GNUC_FALLTHROUGH;
@@ -547,7 +633,9 @@ gdk_frame_clock_paint_idle (void *data)
                   priv->updating_count > 0)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_UPDATE;
+                  start_time = g_get_monotonic_time ();
                   _gdk_frame_clock_emit_update (clock);
+                  record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_UPDATE, start_time);
                 }
             }
           G_GNUC_FALLTHROUGH;
@@ -572,12 +660,15 @@ gdk_frame_clock_paint_idle (void *data)
 	       * resizes and natural size changes.
 	       */
 	      iter = 0;
+              start_time = g_get_monotonic_time ();
               while ((priv->requested & GDK_FRAME_CLOCK_PHASE_LAYOUT) &&
 		     priv->freeze_count == 0 && iter++ < 4)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_LAYOUT;
                   _gdk_frame_clock_emit_layout (clock);
                 }
+              if (iter > 0)
+                record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_LAYOUT, start_time);
 	      if (iter == 5)
 		g_warning ("gdk-frame-clock: layout continuously requested, giving up after 4 tries");
             }
@@ -599,7 +690,9 @@ gdk_frame_clock_paint_idle (void *data)
               if (priv->requested & GDK_FRAME_CLOCK_PHASE_PAINT)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_PAINT;
+                  start_time = g_get_monotonic_time ();
                   _gdk_frame_clock_emit_paint (clock);
+                  record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_PAINT, start_time);
                 }
             }
           G_GNUC_FALLTHROUGH;
@@ -608,15 +701,15 @@ gdk_frame_clock_paint_idle (void *data)
           if (priv->freeze_count == 0)
             {
               priv->requested &= ~GDK_FRAME_CLOCK_PHASE_AFTER_PAINT;
+              start_time = g_get_monotonic_time ();
               _gdk_frame_clock_emit_after_paint (clock);
+              record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_AFTER_PAINT, start_time);
               /* the ::after-paint phase doesn't get repeated on freeze/thaw,
                */
               priv->phase = GDK_FRAME_CLOCK_PHASE_NONE;
             }
-#ifdef G_ENABLE_DEBUG
-            if (GDK_DEBUG_CHECK (FRAMES))
+            if (timings)
               timings->frame_end_time = g_get_monotonic_time ();
-#endif /* G_ENABLE_DEBUG */
           G_GNUC_FALLTHROUGH;
 
         case GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS:
@@ -628,7 +721,9 @@ gdk_frame_clock_paint_idle (void *data)
   if (priv->requested & GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS)
     {
       priv->requested &= ~GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS;
+      start_time = g_get_monotonic_time ();
       _gdk_frame_clock_emit_resume_events (clock);
+      record_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS, start_time);
     }
 
   if (priv->freeze_count == 0)
@@ -753,6 +848,12 @@ gdk_frame_clock_idle_thaw (GdkFrameClock *clock)
   priv->freeze_count--;
   if (priv->freeze_count == 0)
     {
+      /* Instead of painting right after the compositor released us,
+       * wait so that input that arrives in the meantime still makes
+       * it into the frame.
+       */
+      if (!priv->variable_refresh)
+        priv->min_next_frame_time = compute_just_in_time_frame_start (clock, g_get_monotonic_time ());
       maybe_start_idle (clock_idle, TRUE);
       /* If nothing is requested so we didn't start an idle, we need
        * to skip to the end of the state chain, since the idle won't
@@ -799,3 +900,39 @@ _gdk_frame_clock_idle_new (void)
 
   return GDK_FRAME_CLOCK (clock);
 }
+
+/*
+ * _gdk_frame_clock_idle_set_refresh_info:
+ * @clock: a #GdkFrameClockIdle
+ * @refresh_interval: the refresh interval of the monitor, in microseconds,
+ *   or 0 if unknown
+ * @variable_refresh: whether the monitor can show frames as soon as they
+ *   are ready
+ *
+ * Times the clock for the monitor its surface is on. With variable
+ * refresh, @refresh_interval is the shortest interval the monitor
+ * supports, and frames are not aligned to a vsync grid.
+ */
+void
+_gdk_frame_clock_idle_set_refresh_info (GdkFrameClockIdle *clock,
+                                        gint64             refresh_interval,
+                                        gboolean           variable_refresh)
+{
+  GdkFrameClockIdlePrivate *priv = clock->priv;
+
+  if (refresh_interval <= 0)
+    refresh_interval = FRAME_INTERVAL;
+
+  if (priv->refresh_interval == refresh_interval &&
+      priv->variable_refresh == !!variable_refresh)
+    return;
+
+  priv->refresh_interval = refresh_interval;
+  priv->variable_refresh = !!variable_refresh;
+
+  /* The vsync phase of the old monitor doesn't apply anymore,
+   * pick up the new one like at the start of an animation.
+   */
+  if (priv->updating_count > 0)
+    priv->smooth_phase_state = SMOOTH_PHASE_STATE_AWAIT_FIRST;
+}
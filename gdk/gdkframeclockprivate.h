@@ -82,6 +82,9 @@ struct _GdkFrameClockClass
   /* void (* resume_events)      (GdkFrameClock *clock); */
 };
 
+/* The number of phases in GdkFrameClockPhase, not counting NONE */
+#define GDK_FRAME_CLOCK_N_PHASES 7
+
 struct _GdkFrameTimings
 {
   /*< private >*/
@@ -95,15 +98,22 @@ struct _GdkFrameTimings
   gint64 presentation_time;
   gint64 refresh_interval;
   gint64 predicted_presentation_time;
+  gint64 frame_end_time;
+
+  /* indexed by the bit of the phase in GdkFrameClockPhase */
+  gint64 phase_durations[GDK_FRAME_CLOCK_N_PHASES];
+  gint64 render_cpu_time;
+  gint64 render_gpu_time;
 
 #ifdef G_ENABLE_DEBUG
   gint64 layout_start_time;
   gint64 paint_start_time;
-  gint64 frame_end_time;
 #endif /* G_ENABLE_DEBUG */
 
   guint complete : 1;
   guint slept_before : 1;
+  /* presentation_time was reported by the compositor, not guessed */
+  guint presentation_is_accurate : 1;
 };
 
 void _gdk_frame_clock_inhibit_freeze (GdkFrameClock *clock);
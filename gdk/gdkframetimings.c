@@ -233,3 +233,68 @@ gdk_frame_timings_get_refresh_interval (GdkFrameTimings *timings)
 
   return timings->refresh_interval;
 }
+
+/**
+ * gdk_frame_timings_get_phase_duration:
+ * @timings: a #GdkFrameTimings
+ * @phase: a single #GdkFrameClockPhase
+ *
+ * Gets the time that the frame clock spent in @phase for this
+ * frame, including the time spent in signal handlers.
+ *
+ * Returns: the duration in microseconds, or 0 if the phase
+ *   didn't run for this frame
+ */
+gint64
+gdk_frame_timings_get_phase_duration (GdkFrameTimings    *timings,
+                                      GdkFrameClockPhase  phase)
+{
+  int index;
+
+  g_return_val_if_fail (timings != NULL, 0);
+  g_return_val_if_fail (phase != GDK_FRAME_CLOCK_PHASE_NONE && (phase & (phase - 1)) == 0, 0);
+
+  index = g_bit_nth_lsf (phase, -1);
+  g_return_val_if_fail (index < GDK_FRAME_CLOCK_N_PHASES, 0);
+
+  return timings->phase_durations[index];
+}
+
+/**
+ * gdk_frame_timings_get_render_cpu_time:
+ * @timings: a #GdkFrameTimings
+ *
+ * Gets the CPU time that GSK spent rendering this frame. This is
+ * part of the duration of the #GDK_FRAME_CLOCK_PHASE_PAINT phase.
+ *
+ * Returns: the render time in microseconds, or 0 if nothing
+ *   was rendered
+ */
+gint64
+gdk_frame_timings_get_render_cpu_time (GdkFrameTimings *timings)
+{
+  g_return_val_if_fail (timings != NULL, 0);
+
+  return timings->render_cpu_time;
+}
+
+/**
+ * gdk_frame_timings_get_render_gpu_time:
+ * @timings: a #GdkFrameTimings
+ *
+ * Gets the GPU time that GSK spent rendering.
+ *
+ * GPU timer queries finish asynchronously, so this is the time
+ * of the latest frame whose results were available when this
+ * frame was rendered, usually a few frames earlier.
+ *
+ * Returns: the render time in microseconds, or 0 if the
+ *   renderer doesn't measure GPU time
+ */
+gint64
+gdk_frame_timings_get_render_gpu_time (GdkFrameTimings *timings)
+{
+  g_return_val_if_fail (timings != NULL, 0);
+
+  return timings->render_gpu_time;
+}
@@ -139,17 +139,6 @@ G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (GdkGLContext, gdk_gl_context, GDK_TYPE_DRAW
 
 static GPrivate thread_current_context = G_PRIVATE_INIT (g_object_unref);
 
-static void
-gdk_gl_context_clear_old_updated_area (GdkGLContext *context)
-{
-  int i;
-
-  for (i = 0; i < 2; i++)
-    {
-      g_clear_pointer (&context->old_updated_area[i], cairo_region_destroy);
-    }
-}
-
 static void
 gdk_gl_context_dispose (GObject *gobject)
 {
@@ -157,8 +146,6 @@ gdk_gl_context_dispose (GObject *gobject)
   GdkGLContextPrivate *priv = gdk_gl_context_get_instance_private (context);
   GdkGLContext *current;
 
-  gdk_gl_context_clear_old_updated_area (context);
-
   current = g_private_get (&thread_current_context);
   if (current == context)
     g_private_replace (&thread_current_context, NULL);
@@ -313,17 +300,13 @@ gdk_gl_context_real_begin_frame (GdkDrawContext *draw_context,
 
   damage = GDK_GL_CONTEXT_GET_CLASS (context)->get_damage (context);
 
-  if (context->old_updated_area[1])
-    cairo_region_destroy (context->old_updated_area[1]);
-  context->old_updated_area[1] = context->old_updated_area[0];
-  context->old_updated_area[0] = cairo_region_copy (region);
+  gdk_draw_context_push_damage (draw_context, region);
 
   cairo_region_union (region, damage);
   cairo_region_destroy (damage);
 
   surface = gdk_draw_context_get_surface (draw_context);
-  ww = gdk_surface_get_width (surface) * gdk_surface_get_scale_factor (surface);
-  wh = gdk_surface_get_height (surface) * gdk_surface_get_scale_factor (surface);
+  gdk_surface_get_unscaled_size (surface, &ww, &wh);
 
   gdk_gl_context_make_current (context);
 
@@ -351,14 +334,6 @@ gdk_gl_context_real_end_frame (GdkDrawContext *draw_context,
     }
 }
 
-static void
-gdk_gl_context_surface_resized (GdkDrawContext *draw_context)
-{
-  GdkGLContext *context = GDK_GL_CONTEXT (draw_context);
-
-  gdk_gl_context_clear_old_updated_area (context);
-}
-
 static void
 gdk_gl_context_class_init (GdkGLContextClass *klass)
 {
@@ -370,7 +345,6 @@ gdk_gl_context_class_init (GdkGLContextClass *klass)
 
   draw_context_class->begin_frame = gdk_gl_context_real_begin_frame;
   draw_context_class->end_frame = gdk_gl_context_real_end_frame;
-  draw_context_class->surface_resized = gdk_gl_context_surface_resized;
 
   /**
    * GdkGLContext:shared-context:
@@ -1195,6 +1169,26 @@ gdk_gl_context_has_debug (GdkGLContext *self)
   return priv->debug_enabled || priv->use_khr_debug;
 }
 
+/* This is currently private! */
+/* All contexts of a display share their resources, except that legacy
+ * and GLES contexts can't share with other kinds of contexts. So
+ * objects created in one context, maybe in another thread, can be
+ * used by @self without copying them.
+ */
+gboolean
+gdk_gl_context_is_shared (GdkGLContext *self,
+                          GdkGLContext *other)
+{
+  if (self == other)
+    return TRUE;
+
+  if (gdk_gl_context_get_display (self) != gdk_gl_context_get_display (other))
+    return FALSE;
+
+  return gdk_gl_context_is_legacy (self) == gdk_gl_context_is_legacy (other) &&
+         gdk_gl_context_get_use_es (self) == gdk_gl_context_get_use_es (other);
+}
+
 /* This is currently private! */
 /* When using GL/ES, don't flip the 'R' and 'B' bits on Windows/ANGLE for glReadPixels() */
 gboolean
@@ -1210,3 +1204,23 @@ gdk_gl_context_use_es_bgra (GdkGLContext *context)
 
   return FALSE;
 }
+
+/* This is currently private! */
+/* Makes the dma-buf of @texture the storage of the GL_TEXTURE_2D that
+ * is currently bound, without copying it. Returns %FALSE if the context
+ * can't import it, and the texture is left unchanged.
+ */
+gboolean
+gdk_gl_context_import_dmabuf (GdkGLContext     *context,
+                              GdkDmabufTexture *texture)
+{
+  GdkGLContextClass *klass = GDK_GL_CONTEXT_GET_CLASS (context);
+
+  g_return_val_if_fail (GDK_IS_GL_CONTEXT (context), FALSE);
+  g_return_val_if_fail (GDK_IS_DMABUF_TEXTURE (texture), FALSE);
+
+  if (klass->import_dmabuf == NULL)
+    return FALSE;
+
+  return klass->import_dmabuf (context, texture);
+}
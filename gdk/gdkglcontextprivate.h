@@ -22,6 +22,7 @@
 #define __GDK_GL_CONTEXT_PRIVATE_H__
 
 #include "gdkglcontext.h"
+#include "gdkdmabuftexture.h"
 #include "gdkdrawcontextprivate.h"
 
 G_BEGIN_DECLS
@@ -35,9 +36,6 @@ typedef struct _GdkGLContextClass       GdkGLContextClass;
 struct _GdkGLContext
 {
   GdkDrawContext parent_instance;
-
-  /* We store the old drawn areas to support buffer-age optimizations */
-  cairo_region_t *old_updated_area[2];
 };
 
 struct _GdkGLContextClass
@@ -52,6 +50,9 @@ struct _GdkGLContextClass
   gboolean (* texture_from_surface) (GdkGLContext    *context,
                                      cairo_surface_t *surface,
                                      cairo_region_t  *region);
+
+  gboolean (* import_dmabuf) (GdkGLContext     *context,
+                              GdkDmabufTexture *texture);
 };
 
 typedef struct {
@@ -106,8 +107,14 @@ void                    gdk_gl_context_label_object_printf      (GdkGLContext
 
 gboolean                gdk_gl_context_has_debug                (GdkGLContext    *self) G_GNUC_PURE;
 
+gboolean                gdk_gl_context_is_shared                (GdkGLContext    *self,
+                                                                 GdkGLContext    *other);
+
 gboolean                gdk_gl_context_use_es_bgra              (GdkGLContext    *context);
 
+gboolean                gdk_gl_context_import_dmabuf            (GdkGLContext     *context,
+                                                                 GdkDmabufTexture *texture);
+
 typedef struct {
   float x1, y1, x2, y2;
   float u1, v1, u2, v2;
@@ -21,6 +21,8 @@
 #include "gdkgltextureprivate.h"
 
 #include "gdkcairo.h"
+#include "gdkglcontextprivate.h"
+#include "gdksurfaceprivate.h"
 #include "gdktextureprivate.h"
 
 #include <epoxy/gl.h>
@@ -30,6 +32,7 @@ struct _GdkGLTexture {
 
   GdkGLContext *context;
   guint id;
+  GLsync sync;
 
   cairo_surface_t *saved;
 
@@ -57,6 +60,7 @@ gdk_gl_texture_dispose (GObject *object)
 
   g_clear_object (&self->context);
   self->id = 0;
+  self->sync = NULL;
 
   if (self->saved)
     {
@@ -67,6 +71,25 @@ gdk_gl_texture_dispose (GObject *object)
   G_OBJECT_CLASS (gdk_gl_texture_parent_class)->dispose (object);
 }
 
+/* Downloads go through the paint context of the surface, which
+ * has to wait for the contents to be complete.
+ */
+static void
+gdk_gl_texture_wait_sync (GdkGLTexture *self)
+{
+  GdkGLContext *paint_context;
+
+  if (self->sync == NULL)
+    return;
+
+  paint_context = gdk_surface_get_paint_gl_context (gdk_gl_context_get_surface (self->context), NULL);
+  if (paint_context == NULL)
+    return;
+
+  gdk_gl_context_make_current (paint_context);
+  glClientWaitSync (self->sync, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+}
+
 static void
 gdk_gl_texture_download (GdkTexture         *texture,
                          const GdkRectangle *area,
@@ -93,6 +116,8 @@ gdk_gl_texture_download (GdkTexture         *texture,
     {
       GdkSurface *gl_surface;
 
+      gdk_gl_texture_wait_sync (self);
+
       gl_surface = gdk_gl_context_get_surface (self->context);
       gdk_cairo_draw_from_gl (cr, gl_surface, self->id, GL_TEXTURE, 1, 
                               area->x, area->y,
@@ -131,6 +156,12 @@ gdk_gl_texture_get_id (GdkGLTexture *self)
   return self->id;
 }
 
+gpointer
+gdk_gl_texture_get_sync (GdkGLTexture *self)
+{
+  return self->sync;
+}
+
 /**
  * gdk_gl_texture_release:
  * @self: a #GdkTexture wrapping a GL texture
@@ -158,6 +189,8 @@ gdk_gl_texture_release (GdkGLTexture *self)
 
   cr = cairo_create (self->saved);
 
+  gdk_gl_texture_wait_sync (self);
+
   surface = gdk_gl_context_get_surface (self->context);
   gdk_cairo_draw_from_gl (cr, surface, self->id, GL_TEXTURE, 1, 0, 0,
                           texture->width, texture->height);
@@ -173,6 +206,7 @@ gdk_gl_texture_release (GdkGLTexture *self)
 
   g_clear_object (&self->context);
   self->id = 0;
+  self->sync = NULL;
 }
 
 /**
@@ -221,3 +255,49 @@ gdk_gl_texture_new (GdkGLContext   *context,
   return GDK_TEXTURE (self);
 }
 
+/**
+ * gdk_gl_texture_new_with_sync:
+ * @context: a #GdkGLContext
+ * @id: the ID of a texture that was created with @context
+ * @width: the nominal width of the texture
+ * @height: the nominal height of the texture
+ * @sync: (nullable): a GLsync fence that is signaled when the
+ *   contents of the texture are complete, or %NULL
+ * @destroy: a destroy notify that will be called when the GL resources
+ *           are released
+ * @data: data that gets passed to @destroy
+ *
+ * Like gdk_gl_texture_new(), but the texture may still be in the
+ * process of being rendered to. Users of the texture wait on the GPU
+ * for @sync to be signaled before reading from it.
+ *
+ * This allows rendering into textures in a thread. Create a context
+ * with gdk_surface_create_gl_context() and make it current in that
+ * thread with gdk_gl_context_make_current(). Renderers for surfaces
+ * of the same display use textures created in such a context directly,
+ * without downloading them.
+ *
+ * @sync must stay valid until @destroy is called.
+ *
+ * Return value: (transfer full): A newly-created #GdkTexture
+ */
+GdkTexture *
+gdk_gl_texture_new_with_sync (GdkGLContext   *context,
+                              guint           id,
+                              int             width,
+                              int             height,
+                              gpointer        sync,
+                              GDestroyNotify  destroy,
+                              gpointer        data)
+{
+  GdkGLTexture *self;
+
+  self = GDK_GL_TEXTURE (gdk_gl_texture_new (context, id, width, height, destroy, data));
+  if (self == NULL)
+    return NULL;
+
+  self->sync = sync;
+
+  return GDK_TEXTURE (self);
+}
+
@@ -49,6 +49,15 @@ GdkTexture *            gdk_gl_texture_new                     (GdkGLContext
                                                                 GDestroyNotify   destroy,
                                                                 gpointer         data);
 
+GDK_AVAILABLE_IN_ALL
+GdkTexture *            gdk_gl_texture_new_with_sync           (GdkGLContext    *context,
+                                                                guint            id,
+                                                                int              width,
+                                                                int              height,
+                                                                gpointer         sync,
+                                                                GDestroyNotify   destroy,
+                                                                gpointer         data);
+
 GDK_AVAILABLE_IN_ALL
 void                    gdk_gl_texture_release                 (GdkGLTexture    *self);
 
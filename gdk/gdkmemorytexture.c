@@ -140,6 +140,84 @@ gdk_memory_texture_new (int              width,
   return GDK_TEXTURE (self);
 }
 
+/**
+ * gdk_memory_texture_new_from_fd:
+ * @width: the width of the texture
+ * @height: the height of the texture
+ * @format: the format of the data
+ * @fd: a file descriptor of a file or memfd containing the pixel data
+ * @offset: offset of the pixel data in @fd
+ * @stride: rowstride for the data
+ * @error: Return location for an error
+ *
+ * Creates a new texture for image data in a file, without reading
+ * it into memory. The contents of @fd are mapped, starting at
+ * @offset, and must contain @stride x @height bytes in the given
+ * format.
+ *
+ * This is useful to display images that are stored already decoded,
+ * like in a thumbnail cache, or to share images between processes
+ * by passing a memfd. The contents of @fd must not change for as
+ * long as the texture exists, for a memfd it should be sealed.
+ *
+ * The GL renderer uploads textures in the %GDK_MEMORY_DEFAULT format
+ * directly from the mapping.
+ *
+ * @fd can be closed after this function returns.
+ *
+ * Returns: (nullable): A newly-created #GdkTexture or %NULL if an
+ *   error occurred.
+ */
+GdkTexture *
+gdk_memory_texture_new_from_fd (int               width,
+                                int               height,
+                                GdkMemoryFormat   format,
+                                int               fd,
+                                gsize             offset,
+                                gsize             stride,
+                                GError          **error)
+{
+  GMappedFile *mapped_file;
+  GBytes *file_bytes, *bytes;
+  GdkTexture *texture;
+  gsize size;
+
+  g_return_val_if_fail (width > 0, NULL);
+  g_return_val_if_fail (height > 0, NULL);
+  g_return_val_if_fail (format < GDK_MEMORY_N_FORMATS, NULL);
+  g_return_val_if_fail (stride >= width * gdk_memory_format_bytes_per_pixel (format), NULL);
+  g_return_val_if_fail (fd >= 0, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  mapped_file = g_mapped_file_new_from_fd (fd, FALSE, error);
+  if (mapped_file == NULL)
+    return NULL;
+
+  file_bytes = g_mapped_file_get_bytes (mapped_file);
+  g_mapped_file_unref (mapped_file);
+
+  /* The last row doesn't need the padding of the stride */
+  size = stride * (height - 1) + width * gdk_memory_format_bytes_per_pixel (format);
+
+  if (offset > g_bytes_get_size (file_bytes) ||
+      size > g_bytes_get_size (file_bytes) - offset)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "File too small for a %dx%d image at offset %" G_GSIZE_FORMAT,
+                   width, height, offset);
+      g_bytes_unref (file_bytes);
+      return NULL;
+    }
+
+  bytes = g_bytes_new_from_bytes (file_bytes, offset, size);
+  g_bytes_unref (file_bytes);
+
+  texture = gdk_memory_texture_new (width, height, format, bytes, stride);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
 GdkMemoryFormat 
 gdk_memory_texture_get_format (GdkMemoryTexture *self)
 {
@@ -287,6 +365,371 @@ static ConversionFunc converters[GDK_MEMORY_N_FORMATS][2] =
   { convert_swizzle_opaque_3012, convert_swizzle_opaque_0321 }
 };
 
+/* The conversions above, described as a byte shuffle: byte i of a
+ * destination pixel is byte shuffle[i] of the source pixel, or 0xFF
+ * for SHUFFLE_OPAQUE. This is what the vectorized converters use.
+ */
+#define SHUFFLE_OPAQUE 0xFF
+
+typedef struct {
+  guint8 shuffle[4];
+  guint8 src_bpp;
+  guint8 alpha;
+  guint8 premultiply;
+} ConversionInfo;
+
+static const ConversionInfo conversion_info[GDK_MEMORY_N_FORMATS][2] =
+{
+  { { { 0, 1, 2, 3 }, 4, 3, FALSE }, { { 3, 2, 1, 0 }, 4, 0, FALSE } },
+  { { { 3, 2, 1, 0 }, 4, 3, FALSE }, { { 0, 1, 2, 3 }, 4, 0, FALSE } },
+  { { { 0, 1, 2, 3 }, 4, 3, TRUE },  { { 3, 2, 1, 0 }, 4, 0, TRUE } },
+  { { { 3, 2, 1, 0 }, 4, 3, TRUE },  { { 0, 1, 2, 3 }, 4, 0, TRUE } },
+  { { { 2, 1, 0, 3 }, 4, 3, TRUE },  { { 3, 0, 1, 2 }, 4, 0, TRUE } },
+  { { { 1, 2, 3, 0 }, 4, 3, TRUE },  { { 0, 3, 2, 1 }, 4, 0, TRUE } },
+  { { { 2, 1, 0, SHUFFLE_OPAQUE }, 3, 3, FALSE }, { { SHUFFLE_OPAQUE, 0, 1, 2 }, 3, 0, FALSE } },
+  { { { 0, 1, 2, SHUFFLE_OPAQUE }, 3, 3, FALSE }, { { SHUFFLE_OPAQUE, 2, 1, 0 }, 3, 0, FALSE } },
+};
+
+/* Converts the start of a row and returns how many pixels it did;
+ * the scalar converters take care of the rest.
+ */
+typedef gsize (* ConvertRowFunc) (guchar               *dest_data,
+                                  const guchar         *src_data,
+                                  gsize                 width,
+                                  const ConversionInfo *info);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CONVERT_X86 1
+#include <immintrin.h>
+
+static void
+get_x86_masks (const ConversionInfo *info,
+               guint8                shuffle[16],
+               guint8                opaque[16],
+               guint8                alpha[16],
+               guint8                alpha_lo[16],
+               guint8                alpha_hi[16])
+{
+  int p, i;
+
+  for (p = 0; p < 4; p++)
+    {
+      for (i = 0; i < 4; i++)
+        {
+          guint8 s = info->shuffle[i];
+
+          shuffle[4 * p + i] = s == SHUFFLE_OPAQUE ? 0x80 : p * info->src_bpp + s;
+          opaque[4 * p + i] = s == SHUFFLE_OPAQUE ? 0xFF : 0;
+          alpha[4 * p + i] = i == info->alpha ? 0xFF : 0;
+        }
+    }
+
+  /* Spread the alpha of each pixel over the 16-bit lanes of its channels */
+  for (i = 0; i < 8; i++)
+    {
+      alpha_lo[2 * i] = 4 * (i / 4) + info->alpha;
+      alpha_lo[2 * i + 1] = 0x80;
+      alpha_hi[2 * i] = 4 * (i / 4 + 2) + info->alpha;
+      alpha_hi[2 * i + 1] = 0x80;
+    }
+}
+
+static __attribute__((target ("ssse3"))) __m128i
+premultiply_ssse3 (__m128i v,
+                   __m128i alpha,
+                   __m128i alpha_lo,
+                   __m128i alpha_hi)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i x80 = _mm_set1_epi16 (0x80);
+  __m128i lo, hi, t;
+
+  lo = _mm_unpacklo_epi8 (v, zero);
+  hi = _mm_unpackhi_epi8 (v, zero);
+
+  t = _mm_add_epi16 (_mm_mullo_epi16 (lo, _mm_shuffle_epi8 (v, alpha_lo)), x80);
+  lo = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+  t = _mm_add_epi16 (_mm_mullo_epi16 (hi, _mm_shuffle_epi8 (v, alpha_hi)), x80);
+  hi = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+
+  /* Keep the alpha itself */
+  return _mm_or_si128 (_mm_andnot_si128 (alpha, _mm_packus_epi16 (lo, hi)),
+                       _mm_and_si128 (alpha, v));
+}
+
+static __attribute__((target ("ssse3"))) gsize
+convert_row_ssse3 (guchar               *dest_data,
+                   const guchar         *src_data,
+                   gsize                 width,
+                   const ConversionInfo *info)
+{
+  guint8 masks[5][16];
+  __m128i shuffle, opaque, alpha, alpha_lo, alpha_hi;
+  gsize x;
+
+  get_x86_masks (info, masks[0], masks[1], masks[2], masks[3], masks[4]);
+  shuffle = _mm_loadu_si128 ((const __m128i *) masks[0]);
+  opaque = _mm_loadu_si128 ((const __m128i *) masks[1]);
+  alpha = _mm_loadu_si128 ((const __m128i *) masks[2]);
+  alpha_lo = _mm_loadu_si128 ((const __m128i *) masks[3]);
+  alpha_hi = _mm_loadu_si128 ((const __m128i *) masks[4]);
+
+  /* Each step reads 16 bytes, but only uses 4 pixels of them */
+  for (x = 0; x * info->src_bpp + 16 <= width * info->src_bpp; x += 4)
+    {
+      __m128i v;
+
+      v = _mm_loadu_si128 ((const __m128i *) (src_data + x * info->src_bpp));
+      v = _mm_or_si128 (_mm_shuffle_epi8 (v, shuffle), opaque);
+      if (info->premultiply)
+        v = premultiply_ssse3 (v, alpha, alpha_lo, alpha_hi);
+      _mm_storeu_si128 ((__m128i *) (dest_data + 4 * x), v);
+    }
+
+  return x;
+}
+
+static __attribute__((target ("avx2"))) gsize
+convert_row_avx2 (guchar               *dest_data,
+                  const guchar         *src_data,
+                  gsize                 width,
+                  const ConversionInfo *info)
+{
+  guint8 masks[5][16];
+  __m256i shuffle, opaque, alpha, alpha_lo, alpha_hi;
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i x80 = _mm256_set1_epi16 (0x80);
+  gsize x;
+
+  get_x86_masks (info, masks[0], masks[1], masks[2], masks[3], masks[4]);
+  shuffle = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[0]));
+  opaque = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[1]));
+  alpha = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[2]));
+  alpha_lo = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[3]));
+  alpha_hi = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) masks[4]));
+
+  /* Shuffles don't cross 128-bit lanes, so load 4 pixels into each lane */
+  for (x = 0; (x + 4) * info->src_bpp + 16 <= width * info->src_bpp; x += 8)
+    {
+      const guchar *src = src_data + x * info->src_bpp;
+      __m256i v;
+
+      v = _mm256_inserti128_si256 (_mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *) src)),
+                                   _mm_loadu_si128 ((const __m128i *) (src + 4 * info->src_bpp)),
+                                   1);
+      v = _mm256_or_si256 (_mm256_shuffle_epi8 (v, shuffle), opaque);
+
+      if (info->premultiply)
+        {
+          __m256i lo, hi, t;
+
+          lo = _mm256_unpacklo_epi8 (v, zero);
+          hi = _mm256_unpackhi_epi8 (v, zero);
+
+          t = _mm256_add_epi16 (_mm256_mullo_epi16 (lo, _mm256_shuffle_epi8 (v, alpha_lo)), x80);
+          lo = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+          t = _mm256_add_epi16 (_mm256_mullo_epi16 (hi, _mm256_shuffle_epi8 (v, alpha_hi)), x80);
+          hi = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+
+          v = _mm256_or_si256 (_mm256_andnot_si256 (alpha, _mm256_packus_epi16 (lo, hi)),
+                               _mm256_and_si256 (alpha, v));
+        }
+
+      _mm256_storeu_si256 ((__m256i *) (dest_data + 4 * x), v);
+    }
+
+  return x;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define HAVE_CONVERT_NEON 1
+#include <arm_neon.h>
+
+static inline uint8x16_t
+premultiply_neon (uint8x16_t c,
+                  uint8x16_t a)
+{
+  const uint16x8_t x80 = vdupq_n_u16 (0x80);
+  uint16x8_t lo, hi;
+
+  lo = vaddq_u16 (vmull_u8 (vget_low_u8 (c), vget_low_u8 (a)), x80);
+  hi = vaddq_u16 (vmull_u8 (vget_high_u8 (c), vget_high_u8 (a)), x80);
+
+  return vcombine_u8 (vshrn_n_u16 (vsraq_n_u16 (lo, lo, 8), 8),
+                      vshrn_n_u16 (vsraq_n_u16 (hi, hi, 8), 8));
+}
+
+static gsize
+convert_row_neon (guchar               *dest_data,
+                  const guchar         *src_data,
+                  gsize                 width,
+                  const ConversionInfo *info)
+{
+  gsize x;
+  int i;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    {
+      uint8x16_t src[4];
+      uint8x16x4_t dest;
+
+      if (info->src_bpp == 4)
+        {
+          uint8x16x4_t v = vld4q_u8 (src_data + 4 * x);
+          src[0] = v.val[0]; src[1] = v.val[1]; src[2] = v.val[2]; src[3] = v.val[3];
+        }
+      else
+        {
+          uint8x16x3_t v = vld3q_u8 (src_data + 3 * x);
+          src[0] = v.val[0]; src[1] = v.val[1]; src[2] = v.val[2]; src[3] = vdupq_n_u8 (0xFF);
+        }
+
+      for (i = 0; i < 4; i++)
+        dest.val[i] = info->shuffle[i] == SHUFFLE_OPAQUE ? vdupq_n_u8 (0xFF) : src[info->shuffle[i]];
+
+      if (info->premultiply)
+        {
+          for (i = 0; i < 4; i++)
+            {
+              if (i != info->alpha)
+                dest.val[i] = premultiply_neon (dest.val[i], dest.val[info->alpha]);
+            }
+        }
+
+      vst4q_u8 (dest_data + 4 * x, dest);
+    }
+
+  return x;
+}
+#endif
+
+static ConvertRowFunc
+get_convert_row_func (void)
+{
+  static gsize func = 0;
+
+  if (g_once_init_enter (&func))
+    {
+      ConvertRowFunc result = NULL;
+
+#if defined(HAVE_CONVERT_X86)
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        result = convert_row_avx2;
+      else if (__builtin_cpu_supports ("ssse3"))
+        result = convert_row_ssse3;
+#elif defined(HAVE_CONVERT_NEON)
+      result = convert_row_neon;
+#endif
+
+      g_once_init_leave (&func, result ? (gsize) result : 1);
+    }
+
+  return func == 1 ? NULL : (ConvertRowFunc) func;
+}
+
+static void
+convert_rows (guchar          *dest_data,
+              gsize            dest_stride,
+              GdkMemoryFormat  dest_format,
+              const guchar    *src_data,
+              gsize            src_stride,
+              GdkMemoryFormat  src_format,
+              gsize            width,
+              gsize            height)
+{
+  const ConversionInfo *info = &conversion_info[src_format][dest_format];
+  ConversionFunc convert = converters[src_format][dest_format];
+  ConvertRowFunc convert_row = get_convert_row_func ();
+  gsize y, done;
+
+  if (convert_row == NULL || convert == convert_memcpy)
+    {
+      convert (dest_data, dest_stride, src_data, src_stride, width, height);
+      return;
+    }
+
+  for (y = 0; y < height; y++)
+    {
+      done = convert_row (dest_data, src_data, width, info);
+      if (done < width)
+        convert (dest_data + 4 * done, dest_stride,
+                 src_data + info->src_bpp * done, src_stride,
+                 width - done, 1);
+
+      dest_data += dest_stride;
+      src_data += src_stride;
+    }
+}
+
+/* Large images, like screenshots, get split into bands of rows
+ * that are converted in parallel */
+#define PARALLEL_CONVERT_MIN_PIXELS (512 * 512)
+#define MAX_CONVERT_THREADS 8
+
+typedef struct {
+  GMutex lock;
+  GCond cond;
+  guint n_pending;
+} ConvertBatch;
+
+typedef struct {
+  guchar *dest_data;
+  gsize dest_stride;
+  GdkMemoryFormat dest_format;
+  const guchar *src_data;
+  gsize src_stride;
+  GdkMemoryFormat src_format;
+  gsize width;
+  gsize height;
+  ConvertBatch *batch;
+} ConvertJob;
+
+static void
+convert_job_run (ConvertJob *job)
+{
+  convert_rows (job->dest_data, job->dest_stride, job->dest_format,
+                job->src_data, job->src_stride, job->src_format,
+                job->width, job->height);
+}
+
+static void
+convert_job_threaded (gpointer data,
+                      gpointer user_data)
+{
+  ConvertJob *job = data;
+  ConvertBatch *batch = job->batch;
+
+  convert_job_run (job);
+
+  g_mutex_lock (&batch->lock);
+  batch->n_pending--;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+static GThreadPool *
+get_convert_pool (guint *n_threads)
+{
+  static GThreadPool *pool = NULL;
+  static guint max_threads = 0;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *result;
+
+      max_threads = CLAMP (g_get_num_processors () - 1, 1, MAX_CONVERT_THREADS);
+      result = g_thread_pool_new (convert_job_threaded, NULL, max_threads, FALSE, NULL);
+
+      g_once_init_leave (&pool, result);
+    }
+
+  *n_threads = max_threads;
+
+  return pool;
+}
+
 void
 gdk_memory_convert (guchar          *dest_data,
                     gsize            dest_stride,
@@ -297,8 +740,62 @@ gdk_memory_convert (guchar          *dest_data,
                     gsize            width,
                     gsize            height)
 {
+  ConvertJob jobs[MAX_CONVERT_THREADS + 1];
+  ConvertBatch batch;
+  GThreadPool *pool;
+  guint n_threads, n_jobs, i;
+  gsize rows_per_job, y;
+
   g_assert (dest_format < 2);
   g_assert (src_format < GDK_MEMORY_N_FORMATS);
 
-  converters[src_format][dest_format] (dest_data, dest_stride, src_data, src_stride, width, height);
+  if (width * height < PARALLEL_CONVERT_MIN_PIXELS ||
+      g_get_num_processors () < 2)
+    {
+      convert_rows (dest_data, dest_stride, dest_format,
+                    src_data, src_stride, src_format,
+                    width, height);
+      return;
+    }
+
+  pool = get_convert_pool (&n_threads);
+
+  /* The calling thread converts a band, too */
+  n_jobs = MIN (n_threads + 1, height);
+  rows_per_job = (height + n_jobs - 1) / n_jobs;
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.n_pending = 0;
+
+  for (i = 0, y = 0; y < height; i++, y += rows_per_job)
+    {
+      jobs[i].dest_data = dest_data + y * dest_stride;
+      jobs[i].dest_stride = dest_stride;
+      jobs[i].dest_format = dest_format;
+      jobs[i].src_data = src_data + y * src_stride;
+      jobs[i].src_stride = src_stride;
+      jobs[i].src_format = src_format;
+      jobs[i].width = width;
+      jobs[i].height = MIN (rows_per_job, height - y);
+      jobs[i].batch = &batch;
+    }
+  n_jobs = i;
+
+  g_mutex_lock (&batch.lock);
+  batch.n_pending = n_jobs - 1;
+  g_mutex_unlock (&batch.lock);
+
+  for (i = 1; i < n_jobs; i++)
+    g_thread_pool_push (pool, &jobs[i], NULL);
+
+  convert_job_run (&jobs[0]);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_mutex_clear (&batch.lock);
+  g_cond_clear (&batch.cond);
 }
@@ -106,6 +106,14 @@ GdkTexture *            gdk_memory_texture_new              (int
                                                              GdkMemoryFormat    format,
                                                              GBytes            *bytes,
                                                              gsize              stride);
+GDK_AVAILABLE_IN_ALL
+GdkTexture *            gdk_memory_texture_new_from_fd      (int                width,
+                                                             int                height,
+                                                             GdkMemoryFormat    format,
+                                                             int                fd,
+                                                             gsize              offset,
+                                                             gsize              stride,
+                                                             GError           **error);
 
 
 G_END_DECLS
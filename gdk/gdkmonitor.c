@@ -551,6 +551,32 @@ gdk_monitor_set_subpixel_layout (GdkMonitor        *monitor,
   g_object_notify (G_OBJECT (monitor), "subpixel-layout");
 }
 
+/* With variable refresh, the refresh rate is the highest one the
+ * monitor supports, and frames are shown as soon as they are ready.
+ */
+void
+gdk_monitor_set_variable_refresh (GdkMonitor *monitor,
+                                  gboolean    variable_refresh)
+{
+  variable_refresh = !!variable_refresh;
+
+  if (monitor->variable_refresh == variable_refresh)
+    return;
+
+  monitor->variable_refresh = variable_refresh;
+
+  /* This changes the meaning of the refresh rate */
+  g_object_notify (G_OBJECT (monitor), "refresh-rate");
+}
+
+gboolean
+gdk_monitor_get_variable_refresh (GdkMonitor *monitor)
+{
+  g_return_val_if_fail (GDK_IS_MONITOR (monitor), FALSE);
+
+  return monitor->variable_refresh;
+}
+
 void
 gdk_monitor_invalidate (GdkMonitor *monitor)
 {
@@ -44,6 +44,7 @@ struct _GdkMonitor {
   int refresh_rate;
   GdkSubpixelLayout subpixel_layout;
   gboolean valid;
+  gboolean variable_refresh;
 };
 
 struct _GdkMonitorClass {
@@ -69,6 +70,9 @@ void            gdk_monitor_set_refresh_rate    (GdkMonitor *monitor,
                                                  int         refresh_rate);
 void            gdk_monitor_set_subpixel_layout (GdkMonitor        *monitor,
                                                  GdkSubpixelLayout  subpixel);
+void            gdk_monitor_set_variable_refresh (GdkMonitor *monitor,
+                                                  gboolean    variable_refresh);
+gboolean        gdk_monitor_get_variable_refresh (GdkMonitor *monitor);
 void            gdk_monitor_invalidate          (GdkMonitor *monitor);
 
 G_END_DECLS
@@ -72,6 +72,25 @@ void    gdk_profiler_set_counter        (guint  id,
 void    gdk_profiler_set_int_counter    (guint  id,
                                          gint64 value);
 
+/* Tracepoints are meant for hot paths. When no profiler is attached,
+ * they cost a single check and don't read the clock. Without sysprof
+ * support, they compile to nothing.
+ *
+ *   gint64 before G_GNUC_UNUSED = gdk_profiler_trace_begin ();
+ *   ...
+ *   gdk_profiler_trace_end (before, "name");
+ */
+#ifdef HAVE_SYSPROF
+#define gdk_profiler_trace_begin() (GDK_PROFILER_IS_RUNNING ? GDK_PROFILER_CURRENT_TIME : 0)
+#define gdk_profiler_trace_end(b, n) G_STMT_START { \
+  if ((b) != 0) \
+    gdk_profiler_end_mark ((b), (n), NULL); \
+} G_STMT_END
+#else
+#define gdk_profiler_trace_begin() 0
+#define gdk_profiler_trace_end(b, n)
+#endif
+
 #ifndef HAVE_SYSPROF
 #define gdk_profiler_add_mark(b, d, n, m)
 #define gdk_profiler_end_mark(b, n, m)
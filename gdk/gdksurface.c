@@ -39,6 +39,7 @@
 #include "gdkinternals.h"
 #include "gdkintl.h"
 #include "gdkmarshalers.h"
+#include "gdkmonitorprivate.h"
 #include "gdkpopupprivate.h"
 #include "gdkrectangle.h"
 #include "gdktoplevelprivate.h"
@@ -105,6 +106,10 @@ static void gdk_surface_get_property (GObject      *object,
 static void update_cursor               (GdkDisplay *display,
                                          GdkDevice  *device);
 
+static void gdk_surface_update_refresh_info (GdkSurface *surface);
+static void monitor_refresh_rate_changed    (GdkMonitor *monitor,
+                                             GParamSpec *pspec,
+                                             GdkSurface *surface);
 static void gdk_surface_set_frame_clock (GdkSurface      *surface,
                                          GdkFrameClock  *clock);
 
@@ -688,6 +693,15 @@ gdk_surface_finalize (GObject *object)
   if (surface->devices_inside)
     g_list_free (surface->devices_inside);
 
+  while (surface->monitors)
+    {
+      GdkMonitor *monitor = surface->monitors->data;
+
+      g_signal_handlers_disconnect_by_func (monitor, monitor_refresh_rate_changed, surface);
+      g_object_unref (monitor);
+      surface->monitors = g_slist_delete_link (surface->monitors, surface->monitors);
+    }
+
   g_clear_object (&surface->display);
 
   if (surface->opaque_region)
@@ -995,6 +1009,26 @@ gdk_surface_get_widget (GdkSurface *surface)
   return surface->widget;
 }
 
+/* Returns the region that the last frame actually repainted,
+ * including what the draw context added to bring its back buffer
+ * up to date, or %NULL if nothing has been drawn yet.
+ */
+const cairo_region_t *
+gdk_surface_get_repaint_region (GdkSurface *surface)
+{
+  GSList *l;
+
+  for (l = surface->draw_contexts; l; l = l->next)
+    {
+      const cairo_region_t *region = gdk_draw_context_get_repaint_region (l->data);
+
+      if (region)
+        return region;
+    }
+
+  return NULL;
+}
+
 /**
  * gdk_surface_get_display:
  * @surface: a #GdkSurface
@@ -2455,6 +2489,8 @@ gdk_surface_set_frame_clock (GdkSurface     *surface,
     }
 
   surface->frame_clock = clock;
+
+  gdk_surface_update_refresh_info (surface);
 }
 
 /**
@@ -2511,6 +2547,37 @@ gdk_surface_get_scale_factor (GdkSurface *surface)
   return 1;
 }
 
+/**
+ * gdk_surface_get_scale:
+ * @surface: surface to get the scale of
+ *
+ * Returns the scale that maps from surface coordinates to device
+ * pixels of the buffers that the surface is drawn into.
+ *
+ * Unlike gdk_surface_get_scale_factor(), this can be a fractional
+ * value, if the windowing system supports drawing at fractional
+ * scales, like 1.5. Renderers use it to draw at the exact resolution
+ * of the output.
+ *
+ * Returns: the scale
+ */
+double
+gdk_surface_get_scale (GdkSurface *surface)
+{
+  GdkSurfaceClass *class;
+
+  g_return_val_if_fail (GDK_IS_SURFACE (surface), 1.0);
+
+  if (GDK_SURFACE_DESTROYED (surface))
+    return 1.0;
+
+  class = GDK_SURFACE_GET_CLASS (surface);
+  if (class->get_scale)
+    return class->get_scale (surface);
+
+  return gdk_surface_get_scale_factor (surface);
+}
+
 /* Returns the *real* unscaled size, which may be a fractional size
    in surface scale coordinates. We need this to properly handle GL
    coordinates which are y-flipped in the real coordinates. */
@@ -2541,6 +2608,41 @@ gdk_surface_get_unscaled_size (GdkSurface *surface,
     *unscaled_height = surface->height * scale;
 }
 
+/*< private >
+ * gdk_surface_offload_texture:
+ * @surface: a #GdkSurface
+ * @texture: (nullable): the texture to show, or %NULL
+ * @area: (nullable): the area of @surface covered by @texture
+ *
+ * Asks the windowing system to show @texture on top of @surface,
+ * without it being composited into the surface's contents. This
+ * allows the compositor to scan out fullscreen video directly.
+ *
+ * @area is in surface coordinates and must match the size of
+ * @texture at the surface's scale factor. Passing %NULL for
+ * @texture removes a previously offloaded texture.
+ *
+ * Returns: %TRUE if @texture is shown, and the caller must not
+ *   draw it itself
+ */
+gboolean
+gdk_surface_offload_texture (GdkSurface         *surface,
+                             GdkTexture         *texture,
+                             const GdkRectangle *area)
+{
+  GdkSurfaceClass *class;
+
+  g_return_val_if_fail (GDK_IS_SURFACE (surface), FALSE);
+  g_return_val_if_fail (texture == NULL || area != NULL, FALSE);
+
+  class = GDK_SURFACE_GET_CLASS (surface);
+
+  if (GDK_SURFACE_DESTROYED (surface) || class->offload_texture == NULL)
+    return texture == NULL;
+
+  return class->offload_texture (surface, texture, area);
+}
+
 
 /**
  * gdk_surface_set_opaque_region:
@@ -2951,10 +3053,64 @@ gdk_surface_get_seat_from_event (GdkSurface *surface,
   return gdk_display_get_default_seat (surface->display);
 }
 
+/* Times the frame clock for the monitors the surface is on. When
+ * it spans several, we follow the fastest one, so that it doesn't
+ * stutter. Popups share the frame clock of their parent, so only
+ * toplevels get to pick.
+ */
+static void
+gdk_surface_update_refresh_info (GdkSurface *surface)
+{
+  GdkMonitor *fastest = NULL;
+  GSList *l;
+
+  if (surface->parent != NULL ||
+      !GDK_IS_FRAME_CLOCK_IDLE (surface->frame_clock))
+    return;
+
+  for (l = surface->monitors; l; l = l->next)
+    {
+      GdkMonitor *monitor = l->data;
+
+      if (fastest == NULL ||
+          gdk_monitor_get_refresh_rate (monitor) > gdk_monitor_get_refresh_rate (fastest))
+        fastest = monitor;
+    }
+
+  if (fastest && gdk_monitor_get_refresh_rate (fastest) > 0)
+    {
+      /* The refresh rate is in millihertz */
+      _gdk_frame_clock_idle_set_refresh_info (GDK_FRAME_CLOCK_IDLE (surface->frame_clock),
+                                              G_GINT64_CONSTANT (1000000000) / gdk_monitor_get_refresh_rate (fastest),
+                                              gdk_monitor_get_variable_refresh (fastest));
+    }
+  else
+    {
+      _gdk_frame_clock_idle_set_refresh_info (GDK_FRAME_CLOCK_IDLE (surface->frame_clock),
+                                              0, FALSE);
+    }
+}
+
+static void
+monitor_refresh_rate_changed (GdkMonitor *monitor,
+                              GParamSpec *pspec,
+                              GdkSurface *surface)
+{
+  gdk_surface_update_refresh_info (surface);
+}
+
 void
 gdk_surface_enter_monitor (GdkSurface *surface,
                            GdkMonitor *monitor)
 {
+  if (!g_slist_find (surface->monitors, monitor))
+    {
+      surface->monitors = g_slist_prepend (surface->monitors, g_object_ref (monitor));
+      g_signal_connect (monitor, "notify::refresh-rate",
+                        G_CALLBACK (monitor_refresh_rate_changed), surface);
+      gdk_surface_update_refresh_info (surface);
+    }
+
   g_signal_emit (surface, signals[ENTER_MONITOR], 0, monitor);
 }
 
@@ -2962,5 +3118,13 @@ void
 gdk_surface_leave_monitor (GdkSurface *surface,
                            GdkMonitor *monitor)
 {
+  if (g_slist_find (surface->monitors, monitor))
+    {
+      surface->monitors = g_slist_remove (surface->monitors, monitor);
+      g_signal_handlers_disconnect_by_func (monitor, monitor_refresh_rate_changed, surface);
+      gdk_surface_update_refresh_info (surface);
+      g_object_unref (monitor);
+    }
+
   g_signal_emit (surface, signals[LEAVE_MONITOR], 0, monitor);
 }
@@ -96,6 +96,7 @@ struct _GdkSurface
   GList *devices_inside;
 
   GdkFrameClock *frame_clock; /* NULL to use from parent or default */
+  GSList *monitors;           /* the monitors we are on, they time the frame clock */
 
   GSList *draw_contexts;
   GdkDrawContext *paint_context;
@@ -154,6 +155,7 @@ struct _GdkSurfaceClass
                                          double              dy);
 
   int          (* get_scale_factor)       (GdkSurface      *surface);
+  double       (* get_scale)              (GdkSurface      *surface);
   void         (* get_unscaled_size)      (GdkSurface      *surface,
                                            int            *unscaled_width,
                                            int            *unscaled_height);
@@ -169,6 +171,9 @@ struct _GdkSurfaceClass
                                            gboolean        attached,
                                            GdkGLContext   *share,
                                            GError        **error);
+  gboolean     (* offload_texture)        (GdkSurface         *surface,
+                                           GdkTexture         *texture,
+                                           const GdkRectangle *area);
 };
 
 #define GDK_SURFACE_DESTROYED(d) (((GdkSurface *)(d))->destroyed)
@@ -268,6 +273,9 @@ GdkGLContext * gdk_surface_get_shared_data_gl_context (GdkSurface *surface);
 void gdk_surface_get_unscaled_size (GdkSurface *surface,
                                     int *unscaled_width,
                                     int *unscaled_height);
+gboolean gdk_surface_offload_texture (GdkSurface         *surface,
+                                      GdkTexture         *texture,
+                                      const GdkRectangle *area);
 gboolean gdk_surface_handle_event (GdkEvent       *event);
 GdkSeat * gdk_surface_get_seat_from_event (GdkSurface *surface,
                                            GdkEvent    *event);
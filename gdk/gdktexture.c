@@ -46,6 +46,7 @@
 #include "gdksnapshot.h"
 
 #include <graphene.h>
+#include <math.h>
 
 /* HACK: So we don't need to include any (not-yet-created) GSK or GTK headers */
 void
@@ -403,6 +404,226 @@ gdk_texture_new_from_file (GFile   *file,
   return texture;
 }
 
+#define LOAD_BUFFER_SIZE 65536
+
+typedef struct
+{
+  GFile *file;
+  int width;
+  int height;
+  int original_width;
+  int original_height;
+  gboolean scalable;
+} LoadData;
+
+static void
+load_data_free (gpointer data)
+{
+  LoadData *load = data;
+
+  g_object_unref (load->file);
+  g_slice_free (LoadData, load);
+}
+
+static void
+load_size_prepared (GdkPixbufLoader *loader,
+                    int              width,
+                    int              height,
+                    gpointer         data)
+{
+  LoadData *load = data;
+  GdkPixbufFormat *format;
+  double scale;
+
+  load->original_width = width;
+  load->original_height = height;
+
+  format = gdk_pixbuf_loader_get_format (loader);
+  load->scalable = format != NULL && gdk_pixbuf_format_is_scalable (format);
+
+  if (load->width <= 0 || load->height <= 0 || width <= 0 || height <= 0)
+    return;
+
+  scale = MIN ((double) load->width / width, (double) load->height / height);
+
+  /* Only scalable images get rendered at more than their natural size */
+  if (scale >= 1.0 && !load->scalable)
+    return;
+
+  /* Loaders like the JPEG one decode directly at a reduced size,
+   * so this is much cheaper than scaling the image afterwards.
+   */
+  gdk_pixbuf_loader_set_size (loader,
+                              MAX (1, (int) ceil (width * scale)),
+                              MAX (1, (int) ceil (height * scale)));
+}
+
+static void
+load_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  LoadData *load = task_data;
+  GdkPixbufLoader *loader;
+  GInputStream *stream;
+  GdkPixbuf *pixbuf;
+  GdkTexture *texture;
+  guchar *buffer;
+  gssize n_read;
+  GError *error = NULL;
+
+  stream = G_INPUT_STREAM (g_file_read (load->file, cancellable, &error));
+  if (stream == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (loader, "size-prepared", G_CALLBACK (load_size_prepared), load);
+
+  buffer = g_malloc (LOAD_BUFFER_SIZE);
+  while ((n_read = g_input_stream_read (stream, buffer, LOAD_BUFFER_SIZE, cancellable, &error)) > 0)
+    {
+      if (!gdk_pixbuf_loader_write (loader, buffer, n_read, &error))
+        break;
+    }
+  g_free (buffer);
+
+  /* The loader must be closed even if loading failed */
+  if (error)
+    gdk_pixbuf_loader_close (loader, NULL);
+  else
+    gdk_pixbuf_loader_close (loader, &error);
+
+  g_object_unref (stream);
+
+  if (error)
+    {
+      g_object_unref (loader);
+      g_task_return_error (task, error);
+      return;
+    }
+
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+  if (pixbuf == NULL)
+    {
+      g_object_unref (loader);
+      g_task_return_new_error (task,
+                               GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_FAILED,
+                               "Failed to load image");
+      return;
+    }
+
+  texture = gdk_texture_new_for_pixbuf (pixbuf);
+  g_object_unref (loader);
+
+  g_task_return_pointer (task, texture, g_object_unref);
+}
+
+/**
+ * gdk_texture_new_from_file_async:
+ * @file: #GFile to load
+ * @width: the width to load the image at, or -1
+ * @height: the height to load the image at, or -1
+ * @cancellable: (nullable): optional #GCancellable object
+ * @callback: (scope async): callback to call when the texture is loaded
+ * @user_data: (closure): the data to pass to @callback
+ *
+ * Asynchronously loads an image from a file into a new texture,
+ * without blocking the calling thread.
+ *
+ * If @width and @height are positive, the image is loaded at a size that
+ * fits into them while keeping its aspect ratio. Images are never loaded
+ * at more than their natural size, unless the image format is scalable.
+ * Loading an image at a reduced size is usually much faster and uses less
+ * memory than loading it at full size.
+ *
+ * When the operation is finished, @callback will be called. You can then
+ * call gdk_texture_new_from_file_finish() to get the result.
+ */
+void
+gdk_texture_new_from_file_async (GFile               *file,
+                                 int                  width,
+                                 int                  height,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  LoadData *load;
+  GTask *task;
+
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  load = g_slice_new0 (LoadData);
+  load->file = g_object_ref (file);
+  load->width = width;
+  load->height = height;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gdk_texture_new_from_file_async);
+  g_task_set_task_data (task, load, load_data_free);
+  g_task_run_in_thread (task, load_thread);
+  g_object_unref (task);
+}
+
+/**
+ * gdk_texture_new_from_file_finish:
+ * @result: a #GAsyncResult
+ * @error: Return location for an error
+ *
+ * Finishes an asynchronous texture load started with
+ * gdk_texture_new_from_file_async().
+ *
+ * Return value: (transfer full) (nullable): A newly-created #GdkTexture
+ *   or %NULL if an error occurred.
+ */
+GdkTexture *
+gdk_texture_new_from_file_finish (GAsyncResult  *result,
+                                  GError       **error)
+{
+  return gdk_texture_new_from_file_finish_full (result, NULL, NULL, NULL, error);
+}
+
+/*<private>
+ * gdk_texture_new_from_file_finish_full:
+ * @result: a #GAsyncResult
+ * @original_width: (out) (optional): the natural width of the image
+ * @original_height: (out) (optional): the natural height of the image
+ * @scalable: (out) (optional): whether the image format is scalable
+ * @error: Return location for an error
+ *
+ * Like gdk_texture_new_from_file_finish(), but also returns the
+ * size of the image in the file, which can differ from the size
+ * of the texture.
+ */
+GdkTexture *
+gdk_texture_new_from_file_finish_full (GAsyncResult  *result,
+                                       int           *original_width,
+                                       int           *original_height,
+                                       gboolean      *scalable,
+                                       GError       **error)
+{
+  LoadData *load;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gdk_texture_new_from_file_async, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  load = g_task_get_task_data (G_TASK (result));
+
+  if (original_width)
+    *original_width = load->original_width;
+  if (original_height)
+    *original_height = load->original_height;
+  if (scalable)
+    *scalable = load->scalable;
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * gdk_texture_get_width:
  * @texture: a #GdkTexture
@@ -36,6 +36,12 @@ gpointer                gdk_texture_new                 (const GdkTextureClass
                                                          int                     height);
 GdkTexture *            gdk_texture_new_for_surface     (cairo_surface_t        *surface);
 cairo_surface_t *       gdk_texture_download_surface    (GdkTexture             *texture);
+GdkTexture *            gdk_texture_new_from_file_finish_full
+                                                        (GAsyncResult           *result,
+                                                         int                    *original_width,
+                                                         int                    *original_height,
+                                                         gboolean               *scalable,
+                                                         GError                **error);
 void                    gdk_texture_download_area       (GdkTexture             *texture,
                                                          const GdkRectangle     *area,
                                                          guchar                 *data,
@@ -412,7 +412,8 @@ gdk_vulkan_context_check_swapchain (GdkVulkanContext  *context,
 }
 
 static gboolean
-device_supports_incremental_present (VkPhysicalDevice device)
+device_supports_extension (VkPhysicalDevice  device,
+                           const char       *name)
 {
   VkExtensionProperties *extensions;
   uint32_t n_device_extensions;
@@ -424,13 +425,27 @@ device_supports_incremental_present (VkPhysicalDevice device)
 
   for (uint32_t i = 0; i < n_device_extensions; i++)
     {
-      if (g_str_equal (extensions[i].extensionName, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME))
+      if (g_str_equal (extensions[i].extensionName, name))
         return TRUE;
     }
 
   return FALSE;
 }
 
+static gboolean
+device_supports_incremental_present (VkPhysicalDevice device)
+{
+  return device_supports_extension (device, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+}
+
+static gboolean
+device_supports_dmabuf_import (VkPhysicalDevice device)
+{
+  return device_supports_extension (device, VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME) &&
+         device_supports_extension (device, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME) &&
+         device_supports_extension (device, VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME);
+}
+
 static void
 gdk_vulkan_context_begin_frame (GdkDrawContext *draw_context,
                                 cairo_region_t *region)
@@ -753,6 +768,18 @@ gdk_vulkan_context_get_image_format (GdkVulkanContext *context)
  *
  * Returns: the number of images
  */
+/* This is currently private! */
+/* Whether dma-bufs can be imported as device memory, with
+ * VK_EXT_external_memory_dma_buf.
+ */
+gboolean
+gdk_vulkan_context_can_import_dmabuf (GdkVulkanContext *context)
+{
+  g_return_val_if_fail (GDK_IS_VULKAN_CONTEXT (context), FALSE);
+
+  return gdk_draw_context_get_display (GDK_DRAW_CONTEXT (context))->vk_dmabuf_import;
+}
+
 uint32_t
 gdk_vulkan_context_get_n_images (GdkVulkanContext *context)
 {
@@ -831,6 +858,7 @@ gdk_vulkan_context_get_draw_semaphore (GdkVulkanContext *context)
 
 static gboolean
 gdk_display_create_vulkan_device (GdkDisplay  *display,
+                                  gboolean     external_memory,
                                   GError     **error)
 {
   uint32_t i, j, k;
@@ -947,13 +975,21 @@ gdk_display_create_vulkan_device (GdkDisplay  *display,
             {
               GPtrArray *device_extensions;
               gboolean has_incremental_present;
+              gboolean has_dmabuf_import;
 
               has_incremental_present = device_supports_incremental_present (devices[i]);
+              has_dmabuf_import = external_memory && device_supports_dmabuf_import (devices[i]);
 
               device_extensions = g_ptr_array_new ();
               g_ptr_array_add (device_extensions, (gpointer) VK_KHR_SWAPCHAIN_EXTENSION_NAME);
               if (has_incremental_present)
                 g_ptr_array_add (device_extensions, (gpointer) VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+              if (has_dmabuf_import)
+                {
+                  g_ptr_array_add (device_extensions, (gpointer) VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+                  g_ptr_array_add (device_extensions, (gpointer) VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME);
+                  g_ptr_array_add (device_extensions, (gpointer) VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME);
+                }
 
               GDK_DISPLAY_NOTE (display, VULKAN, g_print ("Using Vulkan device %u, queue %u\n", i, j));
               if (GDK_VK_CHECK (vkCreateDevice, devices[i],
@@ -985,6 +1021,7 @@ gdk_display_create_vulkan_device (GdkDisplay  *display,
               display->vk_physical_device = devices[i];
               vkGetDeviceQueue(display->vk_device, j, 0, &display->vk_queue);
               display->vk_queue_family_index = j;
+              display->vk_dmabuf_import = has_dmabuf_import;
               return TRUE;
             }
         }
@@ -1027,6 +1064,7 @@ gdk_display_create_vulkan_instance (GdkDisplay  *display,
   GPtrArray *used_extensions;
   GPtrArray *used_layers;
   gboolean validate = FALSE, have_debug_report = FALSE;
+  gboolean have_external_memory_capabilities = FALSE, have_properties2 = FALSE;
   VkResult res;
 
   if (GDK_DISPLAY_GET_CLASS (display)->vk_extension_name == NULL)
@@ -1059,6 +1097,17 @@ gdk_display_create_vulkan_instance (GdkDisplay  *display,
           g_ptr_array_add (used_extensions, (gpointer) VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
           have_debug_report = TRUE;
         }
+      /* Needed for importing dma-bufs on Vulkan 1.0 */
+      else if (g_str_equal (extensions[i].extensionName, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME))
+        {
+          g_ptr_array_add (used_extensions, (gpointer) VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+          have_external_memory_capabilities = TRUE;
+        }
+      else if (g_str_equal (extensions[i].extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+        {
+          g_ptr_array_add (used_extensions, (gpointer) VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+          have_properties2 = TRUE;
+        }
     }
 
   uint32_t n_layers;
@@ -1141,7 +1190,9 @@ gdk_display_create_vulkan_instance (GdkDisplay  *display,
                                                     &display->vk_debug_callback);
     }
 
-  if (!gdk_display_create_vulkan_device (display, error))
+  if (!gdk_display_create_vulkan_device (display,
+                                         have_external_memory_capabilities && have_properties2,
+                                         error))
     {
       if (display->vk_debug_callback != VK_NULL_HANDLE)
         {
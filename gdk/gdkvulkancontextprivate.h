@@ -73,6 +73,8 @@ gboolean        gdk_display_ref_vulkan                          (GdkDisplay
                                                                  GError         **error);
 void            gdk_display_unref_vulkan                        (GdkDisplay      *display);
 
+gboolean        gdk_vulkan_context_can_import_dmabuf            (GdkVulkanContext *context);
+
 #else /* !GDK_RENDERING_VULKAN */
 
 
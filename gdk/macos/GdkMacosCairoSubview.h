@@ -19,17 +19,18 @@
  */
 
 #include <AppKit/AppKit.h>
+#include <IOSurface/IOSurface.h>
+#include <cairo.h>
 
 #define GDK_IS_MACOS_CAIRO_SUBVIEW(obj) ((obj) && [obj isKindOfClass:[GdkMacosCairoSubview class]])
 
 @interface GdkMacosCairoSubview : NSView
 {
   BOOL             _isOpaque;
-  cairo_surface_t *cairoSurface;
 }
 
 -(void)setOpaque:(BOOL)opaque;
--(void)setCairoSurface:(cairo_surface_t *)cairoSurface
-            withDamage:(cairo_region_t *)region;
+-(void)setIOSurface:(IOSurfaceRef)ioSurface
+         withDamage:(cairo_region_t *)region;
 
 @end
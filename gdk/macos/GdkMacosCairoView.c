@@ -22,7 +22,7 @@
 #include "config.h"
 
 #include <CoreGraphics/CoreGraphics.h>
-#include <cairo-quartz.h>
+#include <QuartzCore/QuartzCore.h>
 
 #include "gdkinternals.h"
 
@@ -53,12 +53,18 @@
   return YES;
 }
 
--(void)setCairoSurface:(cairo_surface_t *)cairoSurface
-            withDamage:(cairo_region_t *)cairoRegion
+-(void)setIOSurface:(IOSurfaceRef)ioSurface
+         withDamage:(cairo_region_t *)cairoRegion
 {
+  /* Swap the contents of all layers at once, without animating */
+  [CATransaction begin];
+  [CATransaction setDisableActions:YES];
+
   for (id view in [self subviews])
-    [(GdkMacosCairoSubview *)view setCairoSurface:cairoSurface
-                                       withDamage:cairoRegion];
+    [(GdkMacosCairoSubview *)view setIOSurface:ioSurface
+                                    withDamage:cairoRegion];
+
+  [CATransaction commit];
 }
 
 -(void)removeOpaqueChildren
@@ -144,6 +150,7 @@
        * matter much to have it here.
        */
       self->transparent = [[GdkMacosCairoSubview alloc] initWithFrame:frame];
+      [self->transparent setWantsLayer:YES];
       [self addSubview:self->transparent];
 
     }
@@ -20,6 +20,7 @@
  */
 
 #include <cairo.h>
+#include <IOSurface/IOSurface.h>
 
 #import "GdkMacosBaseView.h"
 
@@ -31,7 +32,7 @@
   GPtrArray *opaque;
 }
 
--(void)setCairoSurface:(cairo_surface_t *)cairoSurface
-            withDamage:(cairo_region_t *)region;
+-(void)setIOSurface:(IOSurfaceRef)ioSurface
+         withDamage:(cairo_region_t *)region;
 
 @end
@@ -23,17 +23,37 @@
 #include "gdkconfig.h"
 
 #include <CoreGraphics/CoreGraphics.h>
-#include <cairo-quartz.h>
+#include <IOSurface/IOSurface.h>
 
 #import "GdkMacosCairoView.h"
 
 #include "gdkmacoscairocontext-private.h"
 #include "gdkmacossurface-private.h"
 
+/* We draw into IOSurfaces, which the window server composites
+ * directly as the contents of the view's layers. There are two
+ * of them, so that we don't draw into the one being displayed.
+ */
+#define N_BUFFERS 2
+
+typedef struct
+{
+  IOSurfaceRef     iosurface;
+  /* What was drawn into the other buffers since this one was drawn */
+  cairo_region_t  *damage;
+} Buffer;
+
 struct _GdkMacosCairoContext
 {
   GdkCairoContext  parent_instance;
 
+  Buffer           buffers[N_BUFFERS];
+  guint            current;
+  int              width;
+  int              height;
+  int              scale;
+
+  /* Wraps the locked current buffer during a frame */
   cairo_surface_t *window_surface;
 };
 
@@ -44,26 +64,70 @@ struct _GdkMacosCairoContextClass
 
 G_DEFINE_TYPE (GdkMacosCairoContext, _gdk_macos_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
 
-static cairo_surface_t *
-create_cairo_surface_for_surface (GdkSurface *surface)
+static IOSurfaceRef
+create_iosurface (int width,
+                  int height)
 {
-  cairo_surface_t *cairo_surface;
-  int scale;
-  int width;
-  int height;
+  NSDictionary *props;
+  IOSurfaceRef iosurface;
 
-  g_assert (GDK_IS_MACOS_SURFACE (surface));
+  props = @{
+    (id)kIOSurfaceWidth: @(width),
+    (id)kIOSurfaceHeight: @(height),
+    (id)kIOSurfaceBytesPerElement: @(4),
+    (id)kIOSurfacePixelFormat: @((int)'BGRA'),
+    (id)kIOSurfaceBytesPerRow: @(IOSurfaceAlignProperty (kIOSurfaceBytesPerRow, width * 4)),
+  };
 
-  scale = gdk_surface_get_scale_factor (surface);
-  width = scale * gdk_surface_get_width (surface);
-  height = scale * gdk_surface_get_height (surface);
+  iosurface = IOSurfaceCreate ((CFDictionaryRef)props);
 
-  cairo_surface = cairo_quartz_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  return iosurface;
+}
 
-  if (cairo_surface != NULL)
-    cairo_surface_set_device_scale (cairo_surface, scale, scale);
+static void
+clear_buffers (GdkMacosCairoContext *self)
+{
+  for (guint i = 0; i < N_BUFFERS; i++)
+    {
+      if (self->buffers[i].iosurface != NULL)
+        {
+          CFRelease (self->buffers[i].iosurface);
+          self->buffers[i].iosurface = NULL;
+        }
 
-  return cairo_surface;
+      g_clear_pointer (&self->buffers[i].damage, cairo_region_destroy);
+    }
+}
+
+static void
+ensure_buffers (GdkMacosCairoContext *self,
+                GdkSurface           *surface)
+{
+  int scale = gdk_surface_get_scale_factor (surface);
+  int width = scale * gdk_surface_get_width (surface);
+  int height = scale * gdk_surface_get_height (surface);
+
+  if (self->buffers[0].iosurface != NULL &&
+      self->width == width &&
+      self->height == height &&
+      self->scale == scale)
+    return;
+
+  clear_buffers (self);
+
+  self->width = width;
+  self->height = height;
+  self->scale = scale;
+  self->current = 0;
+
+  for (guint i = 0; i < N_BUFFERS; i++)
+    {
+      cairo_rectangle_int_t all = { 0, 0, width, height };
+
+      self->buffers[i].iosurface = create_iosurface (width, height);
+      /* New buffers have no valid contents */
+      self->buffers[i].damage = cairo_region_create_rectangle (&all);
+    }
 }
 
 static cairo_t *
@@ -76,34 +140,81 @@ _gdk_macos_cairo_context_cairo_create (GdkCairoContext *cairo_context)
   return cairo_create (self->window_surface);
 }
 
+static cairo_surface_t *
+create_cairo_surface_for_buffer (GdkMacosCairoContext *self,
+                                 IOSurfaceRef          iosurface)
+{
+  cairo_surface_t *cairo_surface;
+
+  cairo_surface = cairo_image_surface_create_for_data (IOSurfaceGetBaseAddress (iosurface),
+                                                       CAIRO_FORMAT_ARGB32,
+                                                       self->width,
+                                                       self->height,
+                                                       IOSurfaceGetBytesPerRow (iosurface));
+  cairo_surface_set_device_scale (cairo_surface, self->scale, self->scale);
+
+  return cairo_surface;
+}
+
 static void
 _gdk_macos_cairo_context_begin_frame (GdkDrawContext *draw_context,
                                       cairo_region_t *region)
 {
   GdkMacosCairoContext *self = (GdkMacosCairoContext *)draw_context;
+  Buffer *buffer;
+  Buffer *front;
   GdkSurface *surface;
   NSWindow *nswindow;
+  cairo_t *cr;
 
   g_assert (GDK_IS_MACOS_CAIRO_CONTEXT (self));
+  g_assert (self->window_surface == NULL);
 
   surface = gdk_draw_context_get_surface (draw_context);
   nswindow = _gdk_macos_surface_get_native (GDK_MACOS_SURFACE (surface));
 
-  if (self->window_surface == NULL)
+  ensure_buffers (self, surface);
+
+  buffer = &self->buffers[self->current];
+  front = &self->buffers[(self->current + N_BUFFERS - 1) % N_BUFFERS];
+
+  IOSurfaceLock (buffer->iosurface, 0, NULL);
+  self->window_surface = create_cairo_surface_for_buffer (self, buffer->iosurface);
+
+  /* Bring what is not redrawn up to date from the displayed buffer.
+   * Areas that no buffer has valid contents for are redrawn.
+   */
+  cairo_region_subtract (buffer->damage, region);
+  cairo_region_subtract (buffer->damage, front->damage);
+  if (!cairo_region_is_empty (buffer->damage))
     {
-      self->window_surface = create_cairo_surface_for_surface (surface);
+      cairo_surface_t *front_surface;
+
+      IOSurfaceLock (front->iosurface, kIOSurfaceLockReadOnly, NULL);
+      front_surface = create_cairo_surface_for_buffer (self, front->iosurface);
+
+      cr = cairo_create (self->window_surface);
+      gdk_cairo_region (cr, buffer->damage);
+      cairo_clip (cr);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (cr, front_surface, 0, 0);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+
+      cairo_surface_destroy (front_surface);
+      IOSurfaceUnlock (front->iosurface, kIOSurfaceLockReadOnly, NULL);
     }
-  else
+
+  cairo_region_union (region, front->damage);
+
+  if (![nswindow isOpaque])
     {
-      if (![nswindow isOpaque])
-        {
-          cairo_t *cr = cairo_create (self->window_surface);
-          gdk_cairo_region (cr, region);
-          cairo_set_source_rgba (cr, 0, 0, 0, 0);
-          cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-          cairo_fill (cr);
-          cairo_destroy (cr);
-        }
+      cr = cairo_create (self->window_surface);
+      gdk_cairo_region (cr, region);
+      cairo_set_source_rgba (cr, 0, 0, 0, 0);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_fill (cr);
+      cairo_destroy (cr);
     }
 }
 
@@ -112,6 +223,7 @@ _gdk_macos_cairo_context_end_frame (GdkDrawContext *draw_context,
                                     cairo_region_t *painted)
 {
   GdkMacosCairoContext *self = (GdkMacosCairoContext *)draw_context;
+  Buffer *buffer;
   GdkSurface *surface;
   NSView *nsview;
 
@@ -120,10 +232,29 @@ _gdk_macos_cairo_context_end_frame (GdkDrawContext *draw_context,
 
   surface = gdk_draw_context_get_surface (draw_context);
   nsview = _gdk_macos_surface_get_view (GDK_MACOS_SURFACE (surface));
+  buffer = &self->buffers[self->current];
+
+  cairo_surface_flush (self->window_surface);
+  g_clear_pointer (&self->window_surface, cairo_surface_destroy);
+  IOSurfaceUnlock (buffer->iosurface, 0, NULL);
+
+  /* The other buffers now lack what was painted */
+  for (guint i = 0; i < N_BUFFERS; i++)
+    {
+      if (i == self->current)
+        {
+          cairo_region_destroy (self->buffers[i].damage);
+          self->buffers[i].damage = cairo_region_create ();
+        }
+      else
+        cairo_region_union (self->buffers[i].damage, painted);
+    }
 
   if (GDK_IS_MACOS_CAIRO_VIEW (nsview))
-    [(GdkMacosCairoView *)nsview setCairoSurface:self->window_surface
-                                      withDamage:painted];
+    [(GdkMacosCairoView *)nsview setIOSurface:buffer->iosurface
+                                   withDamage:painted];
+
+  self->current = (self->current + 1) % N_BUFFERS;
 }
 
 static void
@@ -133,7 +264,20 @@ _gdk_macos_cairo_context_surface_resized (GdkDrawContext *draw_context)
 
   g_assert (GDK_IS_MACOS_CAIRO_CONTEXT (self));
 
-  g_clear_pointer (&self->window_surface, cairo_surface_destroy);
+  /* The layers keep the displayed buffer alive until they get
+   * the next one, at the new size.
+   */
+  clear_buffers (self);
+}
+
+static void
+_gdk_macos_cairo_context_dispose (GObject *object)
+{
+  GdkMacosCairoContext *self = (GdkMacosCairoContext *)object;
+
+  clear_buffers (self);
+
+  G_OBJECT_CLASS (_gdk_macos_cairo_context_parent_class)->dispose (object);
 }
 
 static void
@@ -141,6 +285,9 @@ _gdk_macos_cairo_context_class_init (GdkMacosCairoContextClass *klass)
 {
   GdkCairoContextClass *cairo_context_class = GDK_CAIRO_CONTEXT_CLASS (klass);
   GdkDrawContextClass *draw_context_class = GDK_DRAW_CONTEXT_CLASS (klass);
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = _gdk_macos_cairo_context_dispose;
 
   draw_context_class->begin_frame = _gdk_macos_cairo_context_begin_frame;
   draw_context_class->end_frame = _gdk_macos_cairo_context_end_frame;
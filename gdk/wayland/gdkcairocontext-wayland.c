@@ -27,6 +27,10 @@
 
 static const cairo_user_data_key_t gdk_wayland_cairo_context_key;
 static const cairo_user_data_key_t gdk_wayland_cairo_region_key;
+static const cairo_user_data_key_t gdk_wayland_cairo_frame_key;
+
+/* How many buffers the compositor released that we keep around */
+#define MAX_RELEASED_SURFACES 3
 
 G_DEFINE_TYPE (GdkWaylandCairoContext, gdk_wayland_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
 
@@ -63,6 +67,22 @@ gdk_wayland_cairo_context_surface_get_region (cairo_surface_t *surface)
   return cairo_surface_get_user_data (surface, &gdk_wayland_cairo_region_key);
 }
 
+/* The frame the surface was last painted in, to find the surface
+ * that needs the least repainting.
+ */
+static guint
+gdk_wayland_cairo_context_surface_get_frame (cairo_surface_t *surface)
+{
+  return GPOINTER_TO_UINT (cairo_surface_get_user_data (surface, &gdk_wayland_cairo_frame_key));
+}
+
+static void
+gdk_wayland_cairo_context_surface_set_frame (cairo_surface_t *surface,
+                                             guint            frame)
+{
+  cairo_surface_set_user_data (surface, &gdk_wayland_cairo_frame_key, GUINT_TO_POINTER (frame), NULL);
+}
+
 static GdkWaylandCairoContext *
 gdk_wayland_cairo_context_get_from_surface (cairo_surface_t *surface)
 {
@@ -84,6 +104,7 @@ gdk_wayland_cairo_context_remove_surface (GdkWaylandCairoContext *self,
                                           cairo_surface_t        *surface)
 {
   self->surfaces = g_slist_remove (self->surfaces, surface);
+  self->released_surfaces = g_slist_remove (self->released_surfaces, surface);
 
   cairo_surface_set_user_data (surface, &gdk_wayland_cairo_context_key, NULL, NULL);
   cairo_surface_destroy (surface);
@@ -100,36 +121,76 @@ gdk_wayland_cairo_context_buffer_release (void             *_data,
   if (self == NULL)
     return;
 
-  /* Cache one surface for reuse when drawing */
-  if (self->cached_surface == NULL)
+  self->released_surfaces = g_slist_prepend (self->released_surfaces, cairo_surface);
+
+  /* Get rid of the oldest one if we have too many */
+  if (g_slist_length (self->released_surfaces) > MAX_RELEASED_SURFACES)
     {
-      self->cached_surface = cairo_surface;
-      return;
+      cairo_surface_t *oldest = NULL;
+      GSList *l;
+
+      for (l = self->released_surfaces; l; l = l->next)
+        {
+          if (oldest == NULL ||
+              gdk_wayland_cairo_context_surface_get_frame (l->data) <
+              gdk_wayland_cairo_context_surface_get_frame (oldest))
+            oldest = l->data;
+        }
+
+      gdk_wayland_cairo_context_remove_surface (self, oldest);
     }
-
-  /* Get rid of all the extra ones */
-  gdk_wayland_cairo_context_remove_surface (self, cairo_surface);
 }
 
 static const struct wl_buffer_listener buffer_listener = {
   gdk_wayland_cairo_context_buffer_release
 };
 
+static gboolean
+gdk_wayland_cairo_context_surface_has_size (cairo_surface_t *cairo_surface,
+                                            int              width,
+                                            int              height,
+                                            int              scale)
+{
+  double x_scale, y_scale;
+
+  cairo_surface_get_device_scale (cairo_surface, &x_scale, &y_scale);
+
+  return cairo_image_surface_get_width (cairo_surface) == width * scale &&
+         cairo_image_surface_get_height (cairo_surface) == height * scale &&
+         x_scale == scale;
+}
+
 static cairo_surface_t *
 gdk_wayland_cairo_context_create_surface (GdkWaylandCairoContext *self)
 {
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self)));
   GdkSurface *surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (self));
-  cairo_surface_t *cairo_surface;
+  cairo_surface_t *cairo_surface = NULL;
   struct wl_buffer *buffer;
   cairo_region_t *region;
-  int width, height;
+  int width, height, scale;
+  GSList *l;
 
   width = gdk_surface_get_width (surface);
   height = gdk_surface_get_height (surface);
-  cairo_surface = _gdk_wayland_display_create_shm_surface (display_wayland,
-                                                           width, height,
-                                                           gdk_surface_get_scale_factor (surface));
+  scale = gdk_surface_get_scale_factor (surface);
+
+  /* After a resize, try to fit the new size into the memory of a
+   * released buffer instead of allocating new shared memory.
+   */
+  for (l = self->released_surfaces; l; l = l->next)
+    {
+      cairo_surface = _gdk_wayland_shm_surface_resize (l->data, width, height, scale);
+      if (cairo_surface)
+        {
+          gdk_wayland_cairo_context_remove_surface (self, l->data);
+          break;
+        }
+    }
+
+  if (cairo_surface == NULL)
+    cairo_surface = _gdk_wayland_display_create_shm_surface (display_wayland,
+                                                             width, height, scale);
   buffer = _gdk_wayland_shm_surface_get_wl_buffer (cairo_surface);
   wl_buffer_add_listener (buffer, &buffer_listener, cairo_surface);
   gdk_wayland_cairo_context_add_surface (self, cairo_surface);
@@ -146,12 +207,33 @@ gdk_wayland_cairo_context_begin_frame (GdkDrawContext *draw_context,
                                        cairo_region_t *region)
 {
   GdkWaylandCairoContext *self = GDK_WAYLAND_CAIRO_CONTEXT (draw_context);
+  GdkSurface *surface = gdk_draw_context_get_surface (draw_context);
   const cairo_region_t *surface_region;
+  int width, height, scale;
   GSList *l;
   cairo_t *cr;
 
-  if (self->cached_surface)
-    self->paint_surface = g_steal_pointer (&self->cached_surface);
+  width = gdk_surface_get_width (surface);
+  height = gdk_surface_get_height (surface);
+  scale = gdk_surface_get_scale_factor (surface);
+
+  /* Reuse the released surface that was painted most recently,
+   * as it needs the least repainting
+   */
+  self->paint_surface = NULL;
+  for (l = self->released_surfaces; l; l = l->next)
+    {
+      if (!gdk_wayland_cairo_context_surface_has_size (l->data, width, height, scale))
+        continue;
+
+      if (self->paint_surface == NULL ||
+          gdk_wayland_cairo_context_surface_get_frame (l->data) >
+          gdk_wayland_cairo_context_surface_get_frame (self->paint_surface))
+        self->paint_surface = l->data;
+    }
+
+  if (self->paint_surface)
+    self->released_surfaces = g_slist_remove (self->released_surfaces, self->paint_surface);
   else
     self->paint_surface = gdk_wayland_cairo_context_create_surface (self);
 
@@ -188,25 +270,17 @@ gdk_wayland_cairo_context_end_frame (GdkDrawContext *draw_context,
   gdk_wayland_surface_notify_committed (surface);
 
   gdk_wayland_cairo_context_surface_clear_region (self->paint_surface);
+  gdk_wayland_cairo_context_surface_set_frame (self->paint_surface, ++self->frame_count);
   self->paint_surface = NULL;
 }
 
 static void
 gdk_wayland_cairo_context_clear_all_cairo_surfaces (GdkWaylandCairoContext *self)
 {
-  self->cached_surface = NULL;
   while (self->surfaces)
     gdk_wayland_cairo_context_remove_surface (self, self->surfaces->data);
 }
 
-static void
-gdk_wayland_cairo_context_surface_resized (GdkDrawContext *draw_context)
-{
-  GdkWaylandCairoContext *self = GDK_WAYLAND_CAIRO_CONTEXT (draw_context);
-
-  gdk_wayland_cairo_context_clear_all_cairo_surfaces (self);
-}
-
 static cairo_t *
 gdk_wayland_cairo_context_cairo_create (GdkCairoContext *context)
 {
@@ -236,7 +310,6 @@ gdk_wayland_cairo_context_class_init (GdkWaylandCairoContextClass *klass)
 
   draw_context_class->begin_frame = gdk_wayland_cairo_context_begin_frame;
   draw_context_class->end_frame = gdk_wayland_cairo_context_end_frame;
-  draw_context_class->surface_resized = gdk_wayland_cairo_context_surface_resized;
 
   cairo_context_class->cairo_create = gdk_wayland_cairo_context_cairo_create;
 }
@@ -40,8 +40,9 @@ struct _GdkWaylandCairoContext
   GdkCairoContext parent_instance;
 
   GSList *surfaces;
-  cairo_surface_t *cached_surface;
+  GSList *released_surfaces;
   cairo_surface_t *paint_surface;
+  guint frame_count;
 };
 
 struct _GdkWaylandCairoContextClass
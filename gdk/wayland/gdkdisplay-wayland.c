@@ -395,6 +395,71 @@ gdk_wayland_display_prefers_ssd (GdkDisplay *display)
   return FALSE;
 }
 
+static void
+linux_dmabuf_format (void                      *data,
+                     struct zwp_linux_dmabuf_v1 *linux_dmabuf,
+                     uint32_t                   format)
+{
+  /* Deprecated in favor of the modifier event */
+}
+
+static void
+linux_dmabuf_modifier (void                      *data,
+                       struct zwp_linux_dmabuf_v1 *linux_dmabuf,
+                       uint32_t                   format,
+                       uint32_t                   modifier_hi,
+                       uint32_t                   modifier_lo)
+{
+  GdkWaylandDisplay *display_wayland = data;
+  GdkWaylandDmabufFormat entry;
+
+  entry.fourcc = format;
+  entry.modifier = ((guint64) modifier_hi << 32) | modifier_lo;
+
+  g_array_append_val (display_wayland->linux_dmabuf_formats, entry);
+}
+
+static const struct zwp_linux_dmabuf_v1_listener linux_dmabuf_listener = {
+  linux_dmabuf_format,
+  linux_dmabuf_modifier,
+};
+
+gboolean
+gdk_wayland_display_supports_dmabuf (GdkWaylandDisplay *display_wayland,
+                                     guint32            fourcc,
+                                     guint64            modifier)
+{
+  guint i;
+
+  if (display_wayland->linux_dmabuf == NULL)
+    return FALSE;
+
+  for (i = 0; i < display_wayland->linux_dmabuf_formats->len; i++)
+    {
+      GdkWaylandDmabufFormat *entry = &g_array_index (display_wayland->linux_dmabuf_formats,
+                                                      GdkWaylandDmabufFormat, i);
+
+      if (entry->fourcc == fourcc && entry->modifier == modifier)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+presentation_clock_id (void                   *data,
+                       struct wp_presentation *presentation,
+                       uint32_t                clk_id)
+{
+  GdkWaylandDisplay *display_wayland = data;
+
+  display_wayland->presentation_clock_id = clk_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+  presentation_clock_id,
+};
+
 static void gdk_wayland_display_set_has_gtk_shell (GdkWaylandDisplay *display_wayland);
 static void gdk_wayland_display_add_output        (GdkWaylandDisplay *display_wayland,
                                                    guint32            id,
@@ -552,6 +617,38 @@ gdk_registry_handle_global (void               *data,
         wl_registry_bind (display_wayland->wl_registry, id,
                           &zwp_idle_inhibit_manager_v1_interface, 1);
     }
+  else if (strcmp (interface, "zwp_linux_dmabuf_v1") == 0 && version >= 3)
+    {
+      /* Only version 3 tells us which modifiers the compositor accepts */
+      display_wayland->linux_dmabuf =
+        wl_registry_bind (display_wayland->wl_registry, id,
+                          &zwp_linux_dmabuf_v1_interface, 3);
+      zwp_linux_dmabuf_v1_add_listener (display_wayland->linux_dmabuf,
+                                        &linux_dmabuf_listener,
+                                        display_wayland);
+      _gdk_wayland_display_async_roundtrip (display_wayland);
+    }
+  else if (strcmp (interface, "wp_presentation") == 0)
+    {
+      display_wayland->presentation =
+        wl_registry_bind (display_wayland->wl_registry, id,
+                          &wp_presentation_interface, 1);
+      wp_presentation_add_listener (display_wayland->presentation,
+                                    &presentation_listener,
+                                    display_wayland);
+    }
+  else if (strcmp (interface, "wp_viewporter") == 0)
+    {
+      display_wayland->viewporter =
+        wl_registry_bind (display_wayland->wl_registry, id,
+                          &wp_viewporter_interface, 1);
+    }
+  else if (strcmp (interface, "wp_fractional_scale_manager_v1") == 0)
+    {
+      display_wayland->fractional_scale =
+        wl_registry_bind (display_wayland->wl_registry, id,
+                          &wp_fractional_scale_manager_v1_interface, 1);
+    }
 
   g_hash_table_insert (display_wayland->known_globals,
                        GUINT_TO_POINTER (id), g_strdup (interface));
@@ -729,6 +826,12 @@ gdk_wayland_display_dispose (GObject *object)
 
   g_list_free_full (display_wayland->on_has_globals_closures, g_free);
 
+  if (display_wayland->settings_portal_cancellable)
+    {
+      g_cancellable_cancel (display_wayland->settings_portal_cancellable);
+      g_clear_object (&display_wayland->settings_portal_cancellable);
+    }
+
   G_OBJECT_CLASS (gdk_wayland_display_parent_class)->dispose (object);
 }
 
@@ -756,6 +859,9 @@ gdk_wayland_display_finalize (GObject *object)
     g_hash_table_destroy (display_wayland->settings);
 
   g_clear_object (&display_wayland->settings_portal);
+  g_clear_pointer (&display_wayland->cached_portal_settings, g_variant_unref);
+
+  g_array_unref (display_wayland->linux_dmabuf_formats);
 
   wl_display_disconnect (display_wayland->wl_display);
 
@@ -1029,6 +1135,7 @@ gdk_wayland_display_init (GdkWaylandDisplay *display)
   display->xkb_context = xkb_context_new (0);
 
   display->monitors = g_list_store_new (GDK_TYPE_MONITOR);
+  display->linux_dmabuf_formats = g_array_new (FALSE, FALSE, sizeof (GdkWaylandDmabufFormat));
 }
 
 GList *
@@ -1313,10 +1420,46 @@ gdk_wayland_cairo_surface_destroy (void *p)
   if (data->pool)
     wl_shm_pool_destroy (data->pool);
 
-  munmap (data->buf, data->buf_length);
+  if (data->buf)
+    munmap (data->buf, data->buf_length);
+
   g_free (data);
 }
 
+static cairo_surface_t *
+create_shm_surface_for_data (GdkWaylandCairoSurfaceData *data,
+                             int                         width,
+                             int                         height,
+                             int                         stride)
+{
+  cairo_surface_t *surface;
+  cairo_status_t status;
+
+  surface = cairo_image_surface_create_for_data (data->buf,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 width*data->scale,
+                                                 height*data->scale,
+                                                 stride);
+
+  data->buffer = wl_shm_pool_create_buffer (data->pool, 0,
+                                            width*data->scale, height*data->scale,
+                                            stride, WL_SHM_FORMAT_ARGB8888);
+
+  cairo_surface_set_user_data (surface, &gdk_wayland_shm_surface_cairo_key,
+                               data, gdk_wayland_cairo_surface_destroy);
+
+  cairo_surface_set_device_scale (surface, data->scale, data->scale);
+
+  status = cairo_surface_status (surface);
+  if (status != CAIRO_STATUS_SUCCESS)
+    {
+      g_critical (G_STRLOC ": Unable to create Cairo image surface: %s",
+                  cairo_status_to_string (status));
+    }
+
+  return surface;
+}
+
 cairo_surface_t *
 _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *display,
                                          int                width,
@@ -1324,8 +1467,6 @@ _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *display,
                                          guint              scale)
 {
   GdkWaylandCairoSurfaceData *data;
-  cairo_surface_t *surface = NULL;
-  cairo_status_t status;
   int stride;
 
   data = g_new (GdkWaylandCairoSurfaceData, 1);
@@ -1340,29 +1481,40 @@ _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *display,
                                 &data->buf_length,
                                 &data->buf);
 
-  surface = cairo_image_surface_create_for_data (data->buf,
-                                                 CAIRO_FORMAT_ARGB32,
-                                                 width*scale,
-                                                 height*scale,
-                                                 stride);
+  return create_shm_surface_for_data (data, width, height, stride);
+}
 
-  data->buffer = wl_shm_pool_create_buffer (data->pool, 0,
-                                            width*scale, height*scale,
-                                            stride, WL_SHM_FORMAT_ARGB8888);
+/* Creates a new shm surface of the given size that takes over the
+ * shared memory of @surface, if it is large enough. The wl_buffer
+ * of @surface stays valid until @surface is destroyed, but the two
+ * must not be drawn to at the same time.
+ */
+cairo_surface_t *
+_gdk_wayland_shm_surface_resize (cairo_surface_t *surface,
+                                 int              width,
+                                 int              height,
+                                 guint            scale)
+{
+  GdkWaylandCairoSurfaceData *old_data, *data;
+  int stride;
 
-  cairo_surface_set_user_data (surface, &gdk_wayland_shm_surface_cairo_key,
-                               data, gdk_wayland_cairo_surface_destroy);
+  old_data = cairo_surface_get_user_data (surface, &gdk_wayland_shm_surface_cairo_key);
+  if (old_data == NULL || old_data->pool == NULL)
+    return NULL;
 
-  cairo_surface_set_device_scale (surface, scale, scale);
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width*scale);
+  if ((size_t) height*scale*stride > old_data->buf_length)
+    return NULL;
 
-  status = cairo_surface_status (surface);
-  if (status != CAIRO_STATUS_SUCCESS)
-    {
-      g_critical (G_STRLOC ": Unable to create Cairo image surface: %s",
-                  cairo_status_to_string (status));
-    }
+  data = g_new (GdkWaylandCairoSurfaceData, 1);
+  data->display = old_data->display;
+  data->buf = g_steal_pointer (&old_data->buf);
+  data->buf_length = old_data->buf_length;
+  data->pool = g_steal_pointer (&old_data->pool);
+  data->buffer = NULL;
+  data->scale = scale;
 
-  return surface;
+  return create_shm_surface_for_data (data, width, height, stride);
 }
 
 struct wl_buffer *
@@ -1489,7 +1641,7 @@ update_xft_settings (GdkDisplay *display)
   GsdXftSettings xft_settings;
   double dpi;
 
-  if (display_wayland->settings_portal)
+  if (display_wayland->use_settings_portal)
     {
       TranslationEntry *entry;
 
@@ -1682,11 +1834,11 @@ static TranslationEntry translations[] = {
   { FALSE, "org.gnome.desktop.interface", "font-hinting", "gtk-xft-hinting", G_TYPE_NONE, { .i = 0 } },
   { FALSE, "org.gnome.desktop.interface", "font-hinting", "gtk-xft-hintstyle", G_TYPE_NONE, { .i = 0 } },
   { FALSE, "org.gnome.desktop.interface", "font-rgba-order", "gtk-xft-rgba", G_TYPE_NONE, { .i = 0 } },
-  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "antialiasing", "gtk-xft-antialias", G_TYPE_NONE, { .i = 0 } },
-  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "hinting", "gtk-xft-hinting", G_TYPE_NONE, { .i = 0 } },
-  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "hinting", "gtk-xft-hintstyle", G_TYPE_NONE, { .i = 0 } },
-  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "rgba-order", "gtk-xft-rgba", G_TYPE_NONE, { .i = 0 } },
-  { FALSE, "org.gnome.desktop.interface", "text-scaling-factor", "gtk-xft-dpi" , G_TYPE_NONE, { .i = 0 } }, /* We store the factor as 16.16 */
+  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "antialiasing", "gtk-xft-antialias", G_TYPE_NONE, { .i = GSD_FONT_ANTIALIASING_MODE_GRAYSCALE } },
+  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "hinting", "gtk-xft-hinting", G_TYPE_NONE, { .i = GSD_FONT_HINTING_MEDIUM } },
+  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "hinting", "gtk-xft-hintstyle", G_TYPE_NONE, { .i = GSD_FONT_HINTING_MEDIUM } },
+  { FALSE, "org.gnome.settings-daemon.plugins.xsettings", "rgba-order", "gtk-xft-rgba", G_TYPE_NONE, { .i = GSD_FONT_RGBA_ORDER_RGB } },
+  { FALSE, "org.gnome.desktop.interface", "text-scaling-factor", "gtk-xft-dpi" , G_TYPE_NONE, { .i = 65536 } }, /* We store the factor as 16.16 */
   { FALSE, "org.gnome.desktop.wm.preferences", "action-double-click-titlebar", "gtk-titlebar-double-click", G_TYPE_STRING, { .s = "toggle-maximize" } },
   { FALSE, "org.gnome.desktop.wm.preferences", "action-middle-click-titlebar", "gtk-titlebar-middle-click", G_TYPE_STRING, { .s = "none" } },
   { FALSE, "org.gnome.desktop.wm.preferences", "action-right-click-titlebar", "gtk-titlebar-right-click", G_TYPE_STRING, { .s = "menu" } },
@@ -1834,94 +1986,207 @@ settings_portal_changed (GDBusProxy *proxy,
 #define PORTAL_SETTINGS_INTERFACE "org.freedesktop.portal.Settings"
 
 static void
-init_settings (GdkDisplay *display)
+apply_portal_settings (GdkDisplay *display,
+                       GVariant   *settings,
+                       gboolean    notify)
+{
+  const char *schema_str;
+  GVariant *val;
+  GVariantIter *iter;
+
+  iter = g_variant_iter_new (settings);
+
+  while (g_variant_iter_loop (iter, "{s@a{sv}}", &schema_str, &val))
+    {
+      GVariantIter *iter2 = g_variant_iter_new (val);
+      const char *key;
+      GVariant *v;
+
+      while (g_variant_iter_loop (iter2, "{sv}", &key, &v))
+        {
+          TranslationEntry *entry = find_translation_entry_by_schema (schema_str, key);
+          if (entry)
+            {
+              char *a = g_variant_print (v, FALSE);
+              g_debug ("Using portal setting for %s %s: %s\n", schema_str, key, a);
+              g_free (a);
+              apply_portal_setting (entry, v, display);
+              if (notify)
+                gdk_display_setting_changed (display, entry->setting);
+            }
+          else
+            {
+              g_debug ("Ignoring portal setting for %s %s", schema_str, key);
+            }
+        }
+      g_variant_iter_free (iter2);
+    }
+  g_variant_iter_free (iter);
+}
+
+/* The settings read from the portal are cached, so the first
+ * frame can use them without waiting for the portal to reply.
+ */
+static char *
+get_portal_settings_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "portal-settings", NULL);
+}
+
+static GVariant *
+load_cached_portal_settings (void)
+{
+  char *path;
+  char *contents;
+  gsize length;
+  GVariant *settings = NULL;
+
+  path = get_portal_settings_cache_path ();
+
+  if (g_file_get_contents (path, &contents, &length, NULL))
+    settings = g_variant_ref_sink (g_variant_new_from_data (G_VARIANT_TYPE ("a{sa{sv}}"),
+                                                            contents, length,
+                                                            FALSE,
+                                                            g_free, contents));
+
+  g_free (path);
+
+  return settings;
+}
+
+static void
+save_cached_portal_settings (GVariant *settings)
+{
+  char *path;
+  char *dir;
+  GError *error = NULL;
+
+  path = get_portal_settings_cache_path ();
+  dir = g_path_get_dirname (path);
+
+  g_mkdir_with_parents (dir, 0755);
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (settings),
+                            g_variant_get_size (settings),
+                            &error))
+    {
+      g_debug ("Failed to cache portal settings: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+}
+
+static void init_gsettings (GdkDisplay *display);
+
+static void
+settings_portal_failed (GdkDisplay *display)
 {
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
-  GSettingsSchemaSource *source;
-  GSettingsSchema *schema;
-  GSettings *settings;
   int i;
 
-  if (gdk_should_use_portal ())
-    {
-      GVariant *ret;
-      GError *error = NULL;
-      const char *schema_str;
-      GVariant *val;
-      GVariantIter *iter;
-      const char *patterns[] = { "org.gnome.*", NULL }; 
-
-      display_wayland->settings_portal = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                                        G_DBUS_PROXY_FLAGS_NONE,
-                                                                        NULL,
-                                                                        PORTAL_BUS_NAME,
-                                                                        PORTAL_OBJECT_PATH,
-                                                                        PORTAL_SETTINGS_INTERFACE,
-                                                                        NULL,
-                                                                        &error);
-      if (error)
-        {
-          g_warning ("Settings portal not found: %s", error->message);
-          g_error_free (error);
+  g_debug ("Failed to use Settings portal; falling back to gsettings");
 
-          goto fallback;
-        }
+  g_clear_object (&display_wayland->settings_portal);
+  g_clear_pointer (&display_wayland->cached_portal_settings, g_variant_unref);
+  display_wayland->use_settings_portal = FALSE;
+
+  init_gsettings (display);
 
-      ret = g_dbus_proxy_call_sync (display_wayland->settings_portal,
-                                    "ReadAll",
-                                    g_variant_new ("(^as)", patterns),
-                                    G_DBUS_CALL_FLAGS_NONE,
-                                    G_MAXINT,
-                                    NULL,
-                                    &error);
+  /* Cached values may have been in use until now */
+  for (i = 0; i < G_N_ELEMENTS (translations); i++)
+    gdk_display_setting_changed (display, translations[i].setting);
+}
+
+static void
+settings_portal_read_all_cb (GObject      *source,
+                             GAsyncResult *result,
+                             gpointer      data)
+{
+  GdkDisplay *display = data;
+  GdkWaylandDisplay *display_wayland;
+  GVariant *ret;
+  GVariant *settings;
+  GError *error = NULL;
 
-      if (error)
+  ret = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
+  if (error)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
           g_warning ("Failed to read portal settings: %s", error->message);
-          g_error_free (error);
-          g_clear_object (&display_wayland->settings_portal);
-
-          goto fallback;
+          settings_portal_failed (display);
         }
 
-      g_variant_get (ret, "(a{sa{sv}})", &iter);
+      g_error_free (error);
+      return;
+    }
 
-      while (g_variant_iter_loop (iter, "{s@a{sv}}", &schema_str, &val))
-        {
-          GVariantIter *iter2 = g_variant_iter_new (val);
-          const char *key;
-          GVariant *v;
+  display_wayland = GDK_WAYLAND_DISPLAY (display);
 
-          while (g_variant_iter_loop (iter2, "{sv}", &key, &v))
-            {
-              TranslationEntry *entry = find_translation_entry_by_schema (schema_str, key);
-              if (entry)
-                {
-                  char *a = g_variant_print (v, FALSE);
-                  g_debug ("Using portal setting for %s %s: %s\n", schema_str, key, a);
-                  g_free (a);
-                  apply_portal_setting (entry, v, display);
-                }
-              else
-                {
-                  g_debug ("Ignoring portal setting for %s %s", schema_str, key);
-                }
-            }
-          g_variant_iter_free (iter2);
-        }
-      g_variant_iter_free (iter);
+  settings = g_variant_get_child_value (ret, 0);
 
-      g_variant_unref (ret);
+  apply_portal_settings (display, settings, TRUE);
 
-      g_signal_connect (display_wayland->settings_portal, "g-signal",
-                        G_CALLBACK (settings_portal_changed), display_wayland);
+  if (display_wayland->cached_portal_settings == NULL ||
+      !g_variant_equal (display_wayland->cached_portal_settings, settings))
+    save_cached_portal_settings (settings);
 
-      return;
+  g_clear_pointer (&display_wayland->cached_portal_settings, g_variant_unref);
+  g_variant_unref (settings);
+  g_variant_unref (ret);
+
+  g_signal_connect (display_wayland->settings_portal, "g-signal",
+                    G_CALLBACK (settings_portal_changed), display_wayland);
+}
+
+static void
+settings_portal_proxy_cb (GObject      *source,
+                          GAsyncResult *result,
+                          gpointer      data)
+{
+  GdkDisplay *display = data;
+  GdkWaylandDisplay *display_wayland;
+  GDBusProxy *proxy;
+  GError *error = NULL;
+  const char *patterns[] = { "org.gnome.*", NULL };
 
-fallback:
-      g_debug ("Failed to use Settings portal; falling back to gsettings");
+  proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+  if (error)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_warning ("Settings portal not found: %s", error->message);
+          settings_portal_failed (display);
+        }
+
+      g_error_free (error);
+      return;
     }
 
+  display_wayland = GDK_WAYLAND_DISPLAY (display);
+  display_wayland->settings_portal = proxy;
+
+  g_dbus_proxy_call (display_wayland->settings_portal,
+                     "ReadAll",
+                     g_variant_new ("(^as)", patterns),
+                     G_DBUS_CALL_FLAGS_NONE,
+                     G_MAXINT,
+                     display_wayland->settings_portal_cancellable,
+                     settings_portal_read_all_cb,
+                     display);
+}
+
+static void
+init_gsettings (GdkDisplay *display)
+{
+  GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
+  GSettingsSchemaSource *source;
+  GSettingsSchema *schema;
+  GSettings *settings;
+  int i;
+
   g_intern_static_string ("antialiasing");
   g_intern_static_string ("hinting");
   g_intern_static_string ("rgba-order");
@@ -1958,6 +2223,43 @@ fallback:
   update_xft_settings (display);
 }
 
+static void
+init_settings (GdkDisplay *display)
+{
+  GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
+
+  if (!gdk_should_use_portal ())
+    {
+      init_gsettings (display);
+      return;
+    }
+
+  /* Don't block on the portal, it can be slow to start together
+   * with the session. Until it replies, we use the values it gave
+   * us last time, or the defaults, and its reply is applied as
+   * setting changes.
+   */
+  display_wayland->use_settings_portal = TRUE;
+
+  display_wayland->cached_portal_settings = load_cached_portal_settings ();
+  if (display_wayland->cached_portal_settings)
+    apply_portal_settings (display, display_wayland->cached_portal_settings, FALSE);
+  else
+    update_xft_settings (display);
+
+  display_wayland->settings_portal_cancellable = g_cancellable_new ();
+
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                            G_DBUS_PROXY_FLAGS_NONE,
+                            NULL,
+                            PORTAL_BUS_NAME,
+                            PORTAL_OBJECT_PATH,
+                            PORTAL_SETTINGS_INTERFACE,
+                            display_wayland->settings_portal_cancellable,
+                            settings_portal_proxy_cb,
+                            display);
+}
+
 static void
 gtk_shell_handle_capabilities (void              *data,
                                struct gtk_shell1 *shell,
@@ -1993,7 +2295,7 @@ set_value_from_entry (GdkDisplay       *display,
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
   GSettings *settings;
 
-  if (display_wayland->settings_portal)
+  if (display_wayland->use_settings_portal)
     {
       switch (entry->type)
         {
@@ -2085,7 +2387,7 @@ set_decoration_layout_from_entry (GdkDisplay       *display,
   GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
   GSettings *settings = NULL;
 
-  if (display_wayland->settings_portal)
+  if (display_wayland->use_settings_portal)
     {
       g_value_set_string (value, entry->fallback.s);
       return;
@@ -36,6 +36,10 @@
 #include <gdk/wayland/server-decoration-client-protocol.h>
 #include <gdk/wayland/xdg-output-unstable-v1-client-protocol.h>
 #include <gdk/wayland/idle-inhibit-unstable-v1-client-protocol.h>
+#include <gdk/wayland/linux-dmabuf-unstable-v1-client-protocol.h>
+#include <gdk/wayland/presentation-time-client-protocol.h>
+#include <gdk/wayland/viewporter-client-protocol.h>
+#include <gdk/wayland/fractional-scale-v1-client-protocol.h>
 
 #include <glib.h>
 #include <gdk/gdkkeys.h>
@@ -69,6 +73,11 @@ typedef enum _GdkWaylandShellVariant
   GDK_WAYLAND_SHELL_VARIANT_ZXDG_SHELL_V6
 } GdkWaylandShellVariant;
 
+typedef struct {
+  guint32 fourcc;
+  guint64 modifier;
+} GdkWaylandDmabufFormat;
+
 struct _GdkWaylandDisplay
 {
   GdkDisplay parent_instance;
@@ -77,6 +86,9 @@ struct _GdkWaylandDisplay
   GHashTable *settings;
   GsdXftSettings xft_settings;
   GDBusProxy *settings_portal;
+  GCancellable *settings_portal_cancellable;
+  GVariant *cached_portal_settings;
+  gboolean use_settings_portal;
 
   guint32    shell_capabilities;
 
@@ -111,6 +123,16 @@ struct _GdkWaylandDisplay
   struct org_kde_kwin_server_decoration_manager *server_decoration_manager;
   struct zxdg_output_manager_v1 *xdg_output_manager;
   struct zwp_idle_inhibit_manager_v1 *idle_inhibit_manager;
+  struct zwp_linux_dmabuf_v1 *linux_dmabuf;
+
+  /* Pairs of DRM fourcc and modifier supported by linux_dmabuf */
+  GArray *linux_dmabuf_formats;
+
+  struct wp_presentation *presentation;
+  guint32 presentation_clock_id;
+
+  struct wp_viewporter *viewporter;
+  struct wp_fractional_scale_manager_v1 *fractional_scale;
 
   GList *async_roundtrips;
 
@@ -157,6 +179,8 @@ struct _GdkWaylandDisplay
   guint have_egl_buffer_age : 1;
   guint have_egl_swap_buffers_with_damage : 1;
   guint have_egl_surfaceless_context : 1;
+  guint have_egl_dma_buf_import : 1;
+  guint have_egl_dma_buf_import_modifiers : 1;
 };
 
 struct _GdkWaylandDisplayClass
@@ -29,12 +29,15 @@
 #include "gdkwaylandsurface.h"
 #include "gdkprivate-wayland.h"
 
+#include "gdkdmabuftextureprivate.h"
 #include "gdkinternals.h"
 #include "gdksurfaceprivate.h"
 #include "gdkprofilerprivate.h"
 
 #include "gdkintl.h"
 
+#include <epoxy/gl.h>
+
 G_DEFINE_TYPE (GdkWaylandGLContext, gdk_wayland_gl_context, GDK_TYPE_GL_CONTEXT)
 
 static void gdk_wayland_gl_context_dispose (GObject *gobject);
@@ -174,6 +177,7 @@ gdk_wayland_gl_context_get_damage (GdkGLContext *context)
   if (display_wayland->have_egl_buffer_age)
     {
       GdkGLContext *shared;
+      cairo_region_t *damage;
       GdkWaylandGLContext *shared_wayland;
 
       shared = gdk_gl_context_get_shared_context (context);
@@ -187,30 +191,9 @@ gdk_wayland_gl_context_get_damage (GdkGLContext *context)
       eglQuerySurface (display_wayland->egl_display, egl_surface,
                        EGL_BUFFER_AGE_EXT, &buffer_age);
 
-      switch (buffer_age)
-        {
-          case 1:
-            return cairo_region_create ();
-            break;
-
-          case 2:
-            if (context->old_updated_area[0])
-              return cairo_region_copy (context->old_updated_area[0]);
-            break;
-
-          case 3:
-            if (context->old_updated_area[0] &&
-                context->old_updated_area[1])
-              {
-                cairo_region_t *damage = cairo_region_copy (context->old_updated_area[0]);
-                cairo_region_union (damage, context->old_updated_area[1]);
-                return damage;
-              }
-            break;
-
-          default:
-            ;
-        }
+      damage = gdk_draw_context_get_damage_for_age (GDK_DRAW_CONTEXT (shared), buffer_age);
+      if (damage)
+        return damage;
     }
 
   return GDK_GL_CONTEXT_CLASS (gdk_wayland_gl_context_parent_class)->get_damage (context);
@@ -265,6 +248,67 @@ gdk_wayland_gl_context_end_frame (GdkDrawContext *draw_context,
   gdk_wayland_surface_notify_committed (surface);
 }
 
+static gboolean
+gdk_wayland_gl_context_import_dmabuf (GdkGLContext     *context,
+                                      GdkDmabufTexture *texture)
+{
+  GdkDisplay *display = gdk_gl_context_get_display (context);
+  GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (display);
+  guint64 modifier = gdk_dmabuf_texture_get_modifier (texture);
+  EGLint attribs[20];
+  EGLImageKHR image;
+  int i = 0;
+
+  if (!display_wayland->have_egl_dma_buf_import ||
+      !epoxy_has_gl_extension ("GL_OES_EGL_image"))
+    return FALSE;
+
+  /* Without the modifiers extension, the driver assumes its own layout */
+  if (modifier != GDK_DRM_FORMAT_MOD_LINEAR &&
+      !display_wayland->have_egl_dma_buf_import_modifiers)
+    return FALSE;
+
+  attribs[i++] = EGL_WIDTH;
+  attribs[i++] = gdk_texture_get_width (GDK_TEXTURE (texture));
+  attribs[i++] = EGL_HEIGHT;
+  attribs[i++] = gdk_texture_get_height (GDK_TEXTURE (texture));
+  attribs[i++] = EGL_LINUX_DRM_FOURCC_EXT;
+  attribs[i++] = gdk_dmabuf_texture_get_fourcc (texture);
+  attribs[i++] = EGL_DMA_BUF_PLANE0_FD_EXT;
+  attribs[i++] = gdk_dmabuf_texture_get_fd (texture);
+  attribs[i++] = EGL_DMA_BUF_PLANE0_OFFSET_EXT;
+  attribs[i++] = gdk_dmabuf_texture_get_offset (texture);
+  attribs[i++] = EGL_DMA_BUF_PLANE0_PITCH_EXT;
+  attribs[i++] = gdk_dmabuf_texture_get_stride (texture);
+  if (display_wayland->have_egl_dma_buf_import_modifiers)
+    {
+      attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT;
+      attribs[i++] = modifier & 0xffffffff;
+      attribs[i++] = EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT;
+      attribs[i++] = modifier >> 32;
+    }
+  attribs[i++] = EGL_NONE;
+
+  image = eglCreateImageKHR (display_wayland->egl_display,
+                             EGL_NO_CONTEXT,
+                             EGL_LINUX_DMA_BUF_EXT,
+                             (EGLClientBuffer) NULL,
+                             attribs);
+  if (image == EGL_NO_IMAGE_KHR)
+    {
+      GDK_DISPLAY_NOTE (display, OPENGL,
+                        g_message ("Importing dma-buf failed: 0x%x", eglGetError ()));
+      return FALSE;
+    }
+
+  glEGLImageTargetTexture2DOES (GL_TEXTURE_2D, image);
+
+  /* The texture keeps the buffer alive */
+  eglDestroyImageKHR (display_wayland->egl_display, image);
+
+  return TRUE;
+}
+
 static void
 gdk_wayland_gl_context_class_init (GdkWaylandGLContextClass *klass)
 {
@@ -278,6 +322,7 @@ gdk_wayland_gl_context_class_init (GdkWaylandGLContextClass *klass)
 
   context_class->realize = gdk_wayland_gl_context_realize;
   context_class->get_damage = gdk_wayland_gl_context_get_damage;
+  context_class->import_dmabuf = gdk_wayland_gl_context_import_dmabuf;
 }
 
 static void
@@ -358,6 +403,12 @@ gdk_wayland_display_init_gl (GdkDisplay *display)
   display_wayland->have_egl_surfaceless_context =
     epoxy_has_egl_extension (dpy, "EGL_KHR_surfaceless_context");
 
+  display_wayland->have_egl_dma_buf_import =
+    epoxy_has_egl_extension (dpy, "EGL_EXT_image_dma_buf_import");
+
+  display_wayland->have_egl_dma_buf_import_modifiers =
+    epoxy_has_egl_extension (dpy, "EGL_EXT_image_dma_buf_import_modifiers");
+
   GDK_DISPLAY_NOTE (display, OPENGL,
             g_message ("EGL API version %d.%d found\n"
                        " - Vendor: %s\n"
@@ -78,6 +78,10 @@ gboolean   _gdk_wayland_display_supports_cursor_color (GdkDisplay *display);
 void       gdk_wayland_display_system_bell (GdkDisplay *display,
                                             GdkSurface  *surface);
 
+gboolean   gdk_wayland_display_supports_dmabuf (GdkWaylandDisplay *display_wayland,
+                                                guint32            fourcc,
+                                                guint64            modifier);
+
 struct wl_buffer *_gdk_wayland_cursor_get_buffer (GdkWaylandDisplay *display,
                                                   GdkCursor         *cursor,
                                                   guint              desired_scale,
@@ -177,6 +181,10 @@ cairo_surface_t * _gdk_wayland_display_create_shm_surface (GdkWaylandDisplay *di
                                                            int                width,
                                                            int                height,
                                                            guint              scale);
+cairo_surface_t * _gdk_wayland_shm_surface_resize (cairo_surface_t *surface,
+                                                   int              width,
+                                                   int              height,
+                                                   guint            scale);
 struct wl_buffer *_gdk_wayland_shm_surface_get_wl_buffer (cairo_surface_t *surface);
 gboolean _gdk_wayland_is_shm_surface (cairo_surface_t *surface);
 
@@ -37,6 +37,7 @@
 #include "gdksurfaceprivate.h"
 #include "gdktoplevelprivate.h"
 #include "gdkdevice-wayland-private.h"
+#include "gdkdmabuftextureprivate.h"
 
 #include <wayland/xdg-shell-unstable-v6-client-protocol.h>
 
@@ -44,6 +45,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <math.h>
 
 #define SURFACE_IS_TOPLEVEL(surface)  TRUE
 
@@ -81,6 +84,8 @@ struct _GdkWaylandSurface
     struct wl_egl_window *dummy_egl_window;
     struct zxdg_exported_v1 *xdg_exported;
     struct org_kde_kwin_server_decoration *server_decoration;
+    struct wp_fractional_scale_v1 *fractional_scale;
+    struct wp_viewport *viewport;
   } display_server;
 
   struct wl_event_queue *event_queue;
@@ -122,7 +127,9 @@ struct _GdkWaylandSurface
   GdkSeat *grab_input_seat;
 
   gint64 pending_frame_counter;
+  GList *presentation_feedbacks;
   guint32 scale;
+  guint32 fractional_scale; /* in 120ths, 0 until the compositor sent one */
 
   int margin_left;
   int margin_right;
@@ -196,6 +203,14 @@ struct _GdkWaylandSurface
 
   struct zwp_idle_inhibitor_v1 *idle_inhibitor;
   size_t idle_inhibitor_refcount;
+
+  struct {
+    struct wl_surface *wl_surface;
+    struct wl_subsurface *wl_subsurface;
+    GdkTexture *texture;
+    GdkRectangle area;
+    guint32 scale;
+  } offload;
 };
 
 typedef struct _GdkWaylandSurfaceClass GdkWaylandSurfaceClass;
@@ -352,6 +367,47 @@ _gdk_wayland_surface_clear_saved_size (GdkSurface *surface)
   impl->saved_height = -1;
 }
 
+/* With fractional-scale-v1, buffers are drawn at the scale the
+ * compositor prefers, which may be fractional, and a viewport maps
+ * them to the surface size. The buffer scale stays at 1 then.
+ * Otherwise, buffers use the integer scale of the outputs.
+ */
+static gboolean
+gdk_wayland_surface_use_fractional_scale (GdkWaylandSurface *impl)
+{
+  return impl->display_server.viewport != NULL && impl->fractional_scale != 0;
+}
+
+static void
+gdk_wayland_surface_update_buffer_geometry (GdkSurface *surface)
+{
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+  int width, height;
+
+  if (impl->display_server.wl_surface == NULL)
+    return;
+
+  if (gdk_wayland_surface_use_fractional_scale (impl))
+    {
+      wl_surface_set_buffer_scale (impl->display_server.wl_surface, 1);
+      if (surface->width > 0 && surface->height > 0)
+        wp_viewport_set_destination (impl->display_server.viewport,
+                                     surface->width, surface->height);
+    }
+  else
+    {
+      wl_surface_set_buffer_scale (impl->display_server.wl_surface, impl->scale);
+      if (impl->display_server.viewport)
+        wp_viewport_set_destination (impl->display_server.viewport, -1, -1);
+    }
+
+  if (impl->display_server.egl_window)
+    {
+      gdk_surface_get_unscaled_size (surface, &width, &height);
+      wl_egl_window_resize (impl->display_server.egl_window, width, height, 0, 0);
+    }
+}
+
 static void
 gdk_wayland_surface_update_size (GdkSurface *surface,
                                  int32_t     width,
@@ -369,10 +425,7 @@ gdk_wayland_surface_update_size (GdkSurface *surface,
   surface->height = height;
   impl->scale = scale;
 
-  if (impl->display_server.egl_window)
-    wl_egl_window_resize (impl->display_server.egl_window, width * scale, height * scale, 0, 0);
-  if (impl->display_server.wl_surface)
-    wl_surface_set_buffer_scale (impl->display_server.wl_surface, scale);
+  gdk_wayland_surface_update_buffer_geometry (surface);
 
   gdk_surface_invalidate_rect (surface, NULL);
 }
@@ -435,6 +488,159 @@ fill_presentation_time_from_frame_time (GdkFrameTimings *timings,
     }
 }
 
+typedef struct {
+  GdkSurface *surface;
+  struct wp_presentation_feedback *feedback;
+  gint64 frame_counter;
+} PresentationFeedback;
+
+static void
+fill_refresh_interval_from_outputs (GdkSurface      *surface,
+                                    GdkFrameTimings *timings)
+{
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+  GdkWaylandDisplay *display_wayland =
+    GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
+
+  timings->refresh_interval = 16667; /* default to 1/60th of a second */
+  if (impl->display_server.outputs)
+    {
+      /* We pick a random output out of the outputs that the surface touches
+       * The rate here is in milli-hertz */
+      int refresh_rate =
+        gdk_wayland_display_get_output_refresh_rate (display_wayland,
+                                                     impl->display_server.outputs->data);
+      if (refresh_rate != 0)
+        timings->refresh_interval = G_GINT64_CONSTANT(1000000000) / refresh_rate;
+    }
+}
+
+static void
+complete_frame_timings (GdkSurface      *surface,
+                        GdkFrameTimings *timings)
+{
+  GdkFrameClock *clock = gdk_surface_get_frame_clock (surface);
+
+  timings->complete = TRUE;
+
+#ifdef G_ENABLE_DEBUG
+  if ((_gdk_debug_flags & GDK_DEBUG_FRAMES) != 0)
+    _gdk_frame_clock_debug_print_timings (clock, timings);
+#endif
+
+  if (GDK_PROFILER_IS_RUNNING)
+    _gdk_frame_clock_add_timings_to_profiler (clock, timings);
+}
+
+static PresentationFeedback *
+find_presentation_feedback (GdkWaylandSurface *impl,
+                            gint64             frame_counter)
+{
+  GList *l;
+
+  for (l = impl->presentation_feedbacks; l; l = l->next)
+    {
+      PresentationFeedback *pf = l->data;
+
+      if (pf->frame_counter == frame_counter)
+        return pf;
+    }
+
+  return NULL;
+}
+
+static void
+presentation_feedback_free (PresentationFeedback *pf)
+{
+  wp_presentation_feedback_destroy (pf->feedback);
+  g_free (pf);
+}
+
+static void
+presentation_feedback_done (PresentationFeedback *pf)
+{
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (pf->surface);
+
+  impl->presentation_feedbacks = g_list_remove (impl->presentation_feedbacks, pf);
+  presentation_feedback_free (pf);
+}
+
+static void
+presentation_feedback_sync_output (void                            *data,
+                                   struct wp_presentation_feedback *feedback,
+                                   struct wl_output                *output)
+{
+}
+
+static void
+presentation_feedback_presented (void                            *data,
+                                 struct wp_presentation_feedback *feedback,
+                                 uint32_t                         tv_sec_hi,
+                                 uint32_t                         tv_sec_lo,
+                                 uint32_t                         tv_nsec,
+                                 uint32_t                         refresh,
+                                 uint32_t                         seq_hi,
+                                 uint32_t                         seq_lo,
+                                 uint32_t                         flags)
+{
+  PresentationFeedback *pf = data;
+  GdkSurface *surface = pf->surface;
+  GdkWaylandDisplay *display_wayland =
+    GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
+  GdkFrameClock *clock = gdk_surface_get_frame_clock (surface);
+  GdkFrameTimings *timings;
+
+  gdk_profiler_add_mark (GDK_PROFILER_CURRENT_TIME, 0, "wayland", "presented");
+
+  timings = gdk_frame_clock_get_timings (clock, pf->frame_counter);
+  presentation_feedback_done (pf);
+
+  if (timings == NULL)
+    return;
+
+  if (refresh != 0)
+    timings->refresh_interval = refresh / 1000;
+  else
+    fill_refresh_interval_from_outputs (surface, timings);
+
+  /* We can only compare the time to our own clock if it is the same */
+  if (display_wayland->presentation_clock_id == CLOCK_MONOTONIC)
+    {
+      guint64 tv_sec = ((guint64) tv_sec_hi << 32) | tv_sec_lo;
+
+      timings->presentation_time = tv_sec * G_USEC_PER_SEC + tv_nsec / 1000;
+      timings->presentation_is_accurate = TRUE;
+    }
+
+  complete_frame_timings (surface, timings);
+}
+
+static void
+presentation_feedback_discarded (void                            *data,
+                                 struct wp_presentation_feedback *feedback)
+{
+  PresentationFeedback *pf = data;
+  GdkSurface *surface = pf->surface;
+  GdkFrameClock *clock = gdk_surface_get_frame_clock (surface);
+  GdkFrameTimings *timings;
+
+  timings = gdk_frame_clock_get_timings (clock, pf->frame_counter);
+  presentation_feedback_done (pf);
+
+  if (timings == NULL)
+    return;
+
+  /* The frame was never shown, so there is no presentation time */
+  fill_refresh_interval_from_outputs (surface, timings);
+  complete_frame_timings (surface, timings);
+}
+
+static const struct wp_presentation_feedback_listener presentation_feedback_listener = {
+  presentation_feedback_sync_output,
+  presentation_feedback_presented,
+  presentation_feedback_discarded,
+};
+
 static GdkSurface *
 get_popup_toplevel (GdkSurface *surface)
 {
@@ -480,13 +686,11 @@ frame_callback (void               *data,
 {
   GdkSurface *surface = data;
   GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
-  GdkWaylandDisplay *display_wayland =
-    GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
   GdkFrameClock *clock = gdk_surface_get_frame_clock (surface);
   GdkFrameTimings *timings;
 
   gdk_profiler_add_mark (GDK_PROFILER_CURRENT_TIME, 0, "wayland", "frame event");
-  GDK_DISPLAY_NOTE (GDK_DISPLAY (display_wayland), EVENTS, g_message ("frame %p", surface));
+  GDK_DISPLAY_NOTE (gdk_surface_get_display (surface), EVENTS, g_message ("frame %p", surface));
 
   wl_callback_destroy (callback);
 
@@ -517,34 +721,20 @@ frame_callback (void               *data,
     }
 
   timings = gdk_frame_clock_get_timings (clock, impl->pending_frame_counter);
+
+  /* The presentation feedback completes the timings, if we asked for it */
+  if (find_presentation_feedback (impl, impl->pending_frame_counter))
+    timings = NULL;
+
   impl->pending_frame_counter = 0;
 
   if (timings == NULL)
     return;
 
-  timings->refresh_interval = 16667; /* default to 1/60th of a second */
-  if (impl->display_server.outputs)
-    {
-      /* We pick a random output out of the outputs that the surface touches
-       * The rate here is in milli-hertz */
-      int refresh_rate =
-        gdk_wayland_display_get_output_refresh_rate (display_wayland,
-                                                     impl->display_server.outputs->data);
-      if (refresh_rate != 0)
-        timings->refresh_interval = G_GINT64_CONSTANT(1000000000) / refresh_rate;
-    }
-
+  fill_refresh_interval_from_outputs (surface, timings);
   fill_presentation_time_from_frame_time (timings, time);
 
-  timings->complete = TRUE;
-
-#ifdef G_ENABLE_DEBUG
-  if ((_gdk_debug_flags & GDK_DEBUG_FRAMES) != 0)
-    _gdk_frame_clock_debug_print_timings (clock, timings);
-#endif
-
-  if (GDK_PROFILER_IS_RUNNING)
-    _gdk_frame_clock_add_timings_to_profiler (clock, timings);
+  complete_frame_timings (surface, timings);
 }
 
 static const struct wl_callback_listener frame_listener = {
@@ -588,6 +778,8 @@ void
 gdk_wayland_surface_request_frame (GdkSurface *surface)
 {
   GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+  GdkWaylandDisplay *display_wayland =
+    GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
   struct wl_callback *callback;
   GdkFrameClock *clock;
 
@@ -601,6 +793,22 @@ gdk_wayland_surface_request_frame (GdkSurface *surface)
   wl_callback_add_listener (callback, &frame_listener, surface);
   impl->pending_frame_counter = gdk_frame_clock_get_frame_counter (clock);
   impl->awaiting_frame = TRUE;
+
+  if (display_wayland->presentation)
+    {
+      PresentationFeedback *pf;
+
+      pf = g_new (PresentationFeedback, 1);
+      pf->surface = surface;
+      pf->frame_counter = impl->pending_frame_counter;
+      pf->feedback = wp_presentation_feedback (display_wayland->presentation,
+                                               impl->display_server.wl_surface);
+      wl_proxy_set_queue ((struct wl_proxy *) pf->feedback, NULL);
+      wp_presentation_feedback_add_listener (pf->feedback,
+                                             &presentation_feedback_listener,
+                                             pf);
+      impl->presentation_feedbacks = g_list_prepend (impl->presentation_feedbacks, pf);
+    }
 }
 
 void
@@ -653,11 +861,19 @@ gdk_wayland_surface_update_scale (GdkSurface *surface)
       return;
     }
 
-  scale = 1;
-  for (l = impl->display_server.outputs; l != NULL; l = l->next)
+  if (gdk_wayland_surface_use_fractional_scale (impl))
+    {
+      /* For code that can only draw at integer scales */
+      scale = (impl->fractional_scale + 119) / 120;
+    }
+  else
     {
-      guint32 output_scale = gdk_wayland_display_get_output_scale (display_wayland, l->data);
-      scale = MAX (scale, output_scale);
+      scale = 1;
+      for (l = impl->display_server.outputs; l != NULL; l = l->next)
+        {
+          guint32 output_scale = gdk_wayland_display_get_output_scale (display_wayland, l->data);
+          scale = MAX (scale, output_scale);
+        }
     }
 
   /* Notify app that scale changed */
@@ -785,9 +1001,12 @@ gdk_wayland_surface_attach_image (GdkSurface           *surface,
   impl->pending_buffer_offset_x = 0;
   impl->pending_buffer_offset_y = 0;
 
-  /* Only set the buffer scale if supported by the compositor */
+  /* Only set the buffer scale if supported by the compositor. With
+   * a fractional scale, the viewport scales the buffer instead.
+   */
   display = GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
-  if (display->compositor_version >= WL_SURFACE_HAS_BUFFER_SCALE)
+  if (display->compositor_version >= WL_SURFACE_HAS_BUFFER_SCALE &&
+      !gdk_wayland_surface_use_fractional_scale (impl))
     wl_surface_set_buffer_scale (impl->display_server.wl_surface, impl->scale);
 
   n = cairo_region_num_rectangles (damage);
@@ -1238,6 +1457,32 @@ static const struct wl_surface_listener surface_listener = {
   surface_leave
 };
 
+static void
+fractional_scale_preferred_scale (void                          *data,
+                                  struct wp_fractional_scale_v1 *fractional_scale,
+                                  uint32_t                       scale)
+{
+  GdkSurface *surface = GDK_SURFACE (data);
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+
+  GDK_DISPLAY_NOTE (gdk_surface_get_display (surface), EVENTS,
+            g_message ("preferred fractional scale, surface %p scale %f", surface, scale / 120.0));
+
+  if (impl->fractional_scale == scale)
+    return;
+
+  impl->fractional_scale = scale;
+
+  /* The integer scale may stay the same, but the buffer size changes */
+  gdk_wayland_surface_update_scale (surface);
+  gdk_wayland_surface_update_buffer_geometry (surface);
+  gdk_surface_invalidate_rect (surface, NULL);
+}
+
+static const struct wp_fractional_scale_v1_listener fractional_scale_listener = {
+  fractional_scale_preferred_scale
+};
+
 static void
 gdk_wayland_surface_create_surface (GdkSurface *surface)
 {
@@ -1250,6 +1495,20 @@ gdk_wayland_surface_create_surface (GdkSurface *surface)
   wl_surface_add_listener (wl_surface, &surface_listener, surface);
 
   impl->display_server.wl_surface = wl_surface;
+
+  if (display_wayland->fractional_scale && display_wayland->viewporter)
+    {
+      impl->display_server.fractional_scale =
+        wp_fractional_scale_manager_v1_get_fractional_scale (display_wayland->fractional_scale,
+                                                             wl_surface);
+      wl_proxy_set_queue ((struct wl_proxy *) impl->display_server.fractional_scale,
+                          impl->event_queue);
+      wp_fractional_scale_v1_add_listener (impl->display_server.fractional_scale,
+                                           &fractional_scale_listener, surface);
+
+      impl->display_server.viewport =
+        wp_viewporter_get_viewport (display_wayland->viewporter, wl_surface);
+    }
 }
 
 static void
@@ -2657,6 +2916,15 @@ unmap_popups_for_surface (GdkSurface *surface)
     }
 }
 
+static void
+gdk_wayland_surface_destroy_offload (GdkWaylandSurface *impl)
+{
+  g_clear_pointer (&impl->offload.wl_subsurface, wl_subsurface_destroy);
+  g_clear_pointer (&impl->offload.wl_surface, wl_surface_destroy);
+  g_clear_object (&impl->offload.texture);
+  impl->offload.area = (GdkRectangle) { 0, 0, 0, 0 };
+}
+
 static void
 gdk_wayland_surface_hide_surface (GdkSurface *surface)
 {
@@ -2773,6 +3041,16 @@ gdk_wayland_surface_hide_surface (GdkSurface *surface)
           impl->application.was_set = FALSE;
         }
 
+      gdk_wayland_surface_destroy_offload (impl);
+
+      g_list_free_full (impl->presentation_feedbacks,
+                        (GDestroyNotify) presentation_feedback_free);
+      impl->presentation_feedbacks = NULL;
+
+      g_clear_pointer (&impl->display_server.fractional_scale, wp_fractional_scale_v1_destroy);
+      g_clear_pointer (&impl->display_server.viewport, wp_viewport_destroy);
+      impl->fractional_scale = 0;
+
       wl_surface_destroy (impl->display_server.wl_surface);
       impl->display_server.wl_surface = NULL;
 
@@ -3881,6 +4159,180 @@ gdk_wayland_surface_get_scale_factor (GdkSurface *surface)
   return impl->scale;
 }
 
+static double
+gdk_wayland_surface_get_scale (GdkSurface *surface)
+{
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+
+  if (GDK_SURFACE_DESTROYED (surface))
+    return 1.0;
+
+  if (gdk_wayland_surface_use_fractional_scale (impl))
+    return impl->fractional_scale / 120.0;
+
+  return impl->scale;
+}
+
+static void
+gdk_wayland_surface_get_unscaled_size (GdkSurface *surface,
+                                       int        *unscaled_width,
+                                       int        *unscaled_height)
+{
+  double scale = gdk_wayland_surface_get_scale (surface);
+
+  /* Rounded halfway away from zero, as fractional-scale-v1 asks */
+  if (unscaled_width)
+    *unscaled_width = round (surface->width * scale);
+
+  if (unscaled_height)
+    *unscaled_height = round (surface->height * scale);
+}
+
+static void
+offload_buffer_release (void             *data,
+                        struct wl_buffer *wl_buffer)
+{
+  GdkTexture *texture = data;
+
+  wl_buffer_destroy (wl_buffer);
+  g_object_unref (texture);
+}
+
+static const struct wl_buffer_listener offload_buffer_listener = {
+  offload_buffer_release
+};
+
+static struct wl_buffer *
+create_dmabuf_buffer (GdkWaylandDisplay *display_wayland,
+                      GdkDmabufTexture  *texture)
+{
+  struct zwp_linux_buffer_params_v1 *params;
+  struct wl_buffer *wl_buffer;
+  guint64 modifier;
+
+  modifier = gdk_dmabuf_texture_get_modifier (texture);
+
+  params = zwp_linux_dmabuf_v1_create_params (display_wayland->linux_dmabuf);
+  zwp_linux_buffer_params_v1_add (params,
+                                  gdk_dmabuf_texture_get_fd (texture),
+                                  0,
+                                  gdk_dmabuf_texture_get_offset (texture),
+                                  gdk_dmabuf_texture_get_stride (texture),
+                                  modifier >> 32,
+                                  modifier & 0xffffffff);
+  wl_buffer = zwp_linux_buffer_params_v1_create_immed (params,
+                                                       gdk_texture_get_width (GDK_TEXTURE (texture)),
+                                                       gdk_texture_get_height (GDK_TEXTURE (texture)),
+                                                       gdk_dmabuf_texture_get_fourcc (texture),
+                                                       0);
+  zwp_linux_buffer_params_v1_destroy (params);
+
+  /* The compositor may keep reading from the dma-buf until it
+   * releases the buffer, so keep it alive until then.
+   */
+  wl_buffer_add_listener (wl_buffer, &offload_buffer_listener, g_object_ref (texture));
+
+  return wl_buffer;
+}
+
+static gboolean
+gdk_wayland_surface_offload_texture (GdkSurface         *surface,
+                                     GdkTexture         *texture,
+                                     const GdkRectangle *area)
+{
+  GdkWaylandSurface *impl = GDK_WAYLAND_SURFACE (surface);
+  GdkWaylandDisplay *display_wayland = GDK_WAYLAND_DISPLAY (gdk_surface_get_display (surface));
+  GdkDmabufTexture *dmabuf;
+  struct wl_buffer *wl_buffer;
+
+  if (texture == NULL)
+    {
+      if (impl->offload.texture)
+        {
+          wl_surface_attach (impl->offload.wl_surface, NULL, 0, 0);
+          wl_surface_commit (impl->offload.wl_surface);
+          g_clear_object (&impl->offload.texture);
+        }
+
+      return TRUE;
+    }
+
+  if (!GDK_IS_DMABUF_TEXTURE (texture) ||
+      !impl->display_server.wl_surface ||
+      !display_wayland->subcompositor)
+    return FALSE;
+
+  dmabuf = GDK_DMABUF_TEXTURE (texture);
+
+  if (gdk_dmabuf_texture_get_fd (dmabuf) == -1 ||
+      !gdk_wayland_display_supports_dmabuf (display_wayland,
+                                            gdk_dmabuf_texture_get_fourcc (dmabuf),
+                                            gdk_dmabuf_texture_get_modifier (dmabuf)))
+    return FALSE;
+
+  /* Only offload if the compositor doesn't have to scale the buffer */
+  if (area->width * impl->scale != gdk_texture_get_width (texture) ||
+      area->height * impl->scale != gdk_texture_get_height (texture))
+    return FALSE;
+
+  if (impl->offload.texture == texture &&
+      impl->offload.scale == impl->scale &&
+      gdk_rectangle_equal (&impl->offload.area, area))
+    return TRUE;
+
+  if (impl->offload.wl_surface == NULL)
+    {
+      struct wl_region *region;
+
+      impl->offload.wl_surface = wl_compositor_create_surface (display_wayland->compositor);
+      impl->offload.wl_subsurface =
+        wl_subcompositor_get_subsurface (display_wayland->subcompositor,
+                                         impl->offload.wl_surface,
+                                         impl->display_server.wl_surface);
+      wl_subsurface_place_above (impl->offload.wl_subsurface,
+                                 impl->display_server.wl_surface);
+
+      /* Video frames arrive independently of the rest of the surface,
+       * so let them be shown without waiting for the parent to commit.
+       */
+      wl_subsurface_set_desync (impl->offload.wl_subsurface);
+
+      /* Input goes to the parent surface */
+      region = wl_compositor_create_region (display_wayland->compositor);
+      wl_surface_set_input_region (impl->offload.wl_surface, region);
+      wl_region_destroy (region);
+    }
+
+  wl_buffer = create_dmabuf_buffer (display_wayland, dmabuf);
+
+  if (!gdk_rectangle_equal (&impl->offload.area, area))
+    wl_subsurface_set_position (impl->offload.wl_subsurface, area->x, area->y);
+
+  wl_surface_set_buffer_scale (impl->offload.wl_surface, impl->scale);
+  wl_surface_attach (impl->offload.wl_surface, wl_buffer, 0, 0);
+  wl_surface_damage (impl->offload.wl_surface, 0, 0, area->width, area->height);
+
+  if (gdk_dmabuf_texture_is_opaque (dmabuf))
+    {
+      struct wl_region *region;
+
+      region = wl_compositor_create_region (display_wayland->compositor);
+      wl_region_add (region, 0, 0, area->width, area->height);
+      wl_surface_set_opaque_region (impl->offload.wl_surface, region);
+      wl_region_destroy (region);
+    }
+  else
+    wl_surface_set_opaque_region (impl->offload.wl_surface, NULL);
+
+  wl_surface_commit (impl->offload.wl_surface);
+
+  g_set_object (&impl->offload.texture, texture);
+  impl->offload.area = *area;
+  impl->offload.scale = impl->scale;
+
+  return TRUE;
+}
+
 static void
 gdk_wayland_surface_set_opaque_region (GdkSurface     *surface,
                                        cairo_region_t *region)
@@ -4006,9 +4458,12 @@ gdk_wayland_surface_class_init (GdkWaylandSurfaceClass *klass)
   impl_class->destroy_notify = gdk_wayland_surface_destroy_notify;
   impl_class->drag_begin = _gdk_wayland_surface_drag_begin;
   impl_class->get_scale_factor = gdk_wayland_surface_get_scale_factor;
+  impl_class->get_scale = gdk_wayland_surface_get_scale;
+  impl_class->get_unscaled_size = gdk_wayland_surface_get_unscaled_size;
   impl_class->set_opaque_region = gdk_wayland_surface_set_opaque_region;
   impl_class->set_shadow_width = gdk_wayland_surface_set_shadow_width;
   impl_class->create_gl_context = gdk_wayland_surface_create_gl_context;
+  impl_class->offload_texture = gdk_wayland_surface_offload_texture;
 }
 
 void
@@ -4061,11 +4516,12 @@ gdk_wayland_surface_get_wl_egl_window (GdkSurface *surface)
 
   if (impl->display_server.egl_window == NULL)
     {
+      int width, height;
+
+      gdk_surface_get_unscaled_size (surface, &width, &height);
       impl->display_server.egl_window =
-        wl_egl_window_create (impl->display_server.wl_surface,
-                              surface->width * impl->scale,
-                              surface->height * impl->scale);
-      wl_surface_set_buffer_scale (impl->display_server.wl_surface, impl->scale);
+        wl_egl_window_create (impl->display_server.wl_surface, width, height);
+      gdk_wayland_surface_update_buffer_geometry (surface);
     }
 
   return impl->display_server.egl_window;
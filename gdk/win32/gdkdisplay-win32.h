@@ -142,6 +142,8 @@ struct _GdkWin32Display
 #ifdef GDK_WIN32_ENABLE_EGL
   guint hasEglKHRCreateContext : 1;
   guint hasEglSurfacelessContext : 1;
+  guint hasEglBufferAge : 1;
+  guint hasEglSwapBuffersWithDamage : 1;
   EGLint egl_min_swap_interval;
 #endif
 
@@ -188,11 +188,71 @@ gdk_win32_gl_context_end_frame (GdkDrawContext *draw_context,
           _reset_egl_force_redraw (surface);
         }
 
-      eglSwapBuffers (display->egl_disp, egl_surface);
+      /* With the damage, ANGLE presents only the dirty rectangles of
+       * its flip-model swapchain (IDXGISwapChain1::Present1), so DWM
+       * only has to recompose the parts of the window that changed.
+       */
+      if (display->hasEglSwapBuffersWithDamage && !force_egl_redraw_all)
+        {
+          int i, j, n_rects = cairo_region_num_rectangles (painted);
+          EGLint *rects = g_new (EGLint, n_rects * 4);
+          cairo_rectangle_int_t rect;
+          int surface_height = gdk_surface_get_height (surface);
+          int scale = gdk_surface_get_scale_factor (surface);
+
+          for (i = 0, j = 0; i < n_rects; i++)
+            {
+              cairo_region_get_rectangle (painted, i, &rect);
+              rects[j++] = rect.x * scale;
+              rects[j++] = (surface_height - rect.height - rect.y) * scale;
+              rects[j++] = rect.width * scale;
+              rects[j++] = rect.height * scale;
+            }
+          eglSwapBuffersWithDamageKHR (display->egl_disp, egl_surface, rects, n_rects);
+          g_free (rects);
+        }
+      else
+        eglSwapBuffers (display->egl_disp, egl_surface);
     }
 #endif
 }
 
+#ifdef GDK_WIN32_ENABLE_EGL
+static cairo_region_t *
+gdk_win32_gl_context_get_damage (GdkGLContext *context)
+{
+  GdkWin32Display *display = GDK_WIN32_DISPLAY (gdk_gl_context_get_display (context));
+  GdkSurface *surface = gdk_gl_context_get_surface (context);
+
+  if (gdk_gl_context_get_use_es (context) &&
+      display->hasEglBufferAge &&
+      !_get_is_egl_force_redraw (surface))
+    {
+      GdkGLContext *shared;
+      cairo_region_t *damage;
+      GdkWin32GLContext *shared_win32;
+      EGLSurface egl_surface;
+      int buffer_age = 0;
+
+      shared = gdk_gl_context_get_shared_context (context);
+      if (shared == NULL)
+        shared = context;
+      shared_win32 = GDK_WIN32_GL_CONTEXT (shared);
+
+      egl_surface = _gdk_win32_surface_get_egl_surface (surface, shared_win32->egl_config, FALSE);
+      gdk_gl_context_make_current (shared);
+      eglQuerySurface (display->egl_disp, egl_surface,
+                       EGL_BUFFER_AGE_EXT, &buffer_age);
+
+      damage = gdk_draw_context_get_damage_for_age (GDK_DRAW_CONTEXT (shared), buffer_age);
+      if (damage)
+        return damage;
+    }
+
+  return GDK_GL_CONTEXT_CLASS (gdk_win32_gl_context_parent_class)->get_damage (context);
+}
+#endif
+
 static void
 gdk_win32_gl_context_begin_frame (GdkDrawContext *draw_context,
                                   cairo_region_t *update_area)
@@ -552,16 +612,24 @@ _gdk_win32_display_init_gl (GdkDisplay *display)
 
       display_win32->hasEglSurfacelessContext =
       epoxy_has_egl_extension (egl_disp, "EGL_KHR_surfaceless_context");
+      display_win32->hasEglBufferAge =
+      epoxy_has_egl_extension (egl_disp, "EGL_EXT_buffer_age");
+      display_win32->hasEglSwapBuffersWithDamage =
+      epoxy_has_egl_extension (egl_disp, "EGL_KHR_swap_buffers_with_damage");
 
       GDK_NOTE (OPENGL,
             g_print ("EGL API version %d.%d found\n"
                      " - Vendor: %s\n"
                      " - Checked extensions:\n"
-                     "\t* EGL_KHR_surfaceless_context: %s\n",
+                     "\t* EGL_KHR_surfaceless_context: %s\n"
+                     "\t* EGL_EXT_buffer_age: %s\n"
+                     "\t* EGL_KHR_swap_buffers_with_damage: %s\n",
                      display_win32->egl_version / 10,
                      display_win32->egl_version % 10,
                      eglQueryString (display_win32->egl_disp, EGL_VENDOR),
-                     display_win32->hasEglSurfacelessContext ? "yes" : "no"));
+                     display_win32->hasEglSurfacelessContext ? "yes" : "no",
+                     display_win32->hasEglBufferAge ? "yes" : "no",
+                     display_win32->hasEglSwapBuffersWithDamage ? "yes" : "no"));
     }
 #endif
 
@@ -1026,6 +1094,9 @@ gdk_win32_gl_context_class_init (GdkWin32GLContextClass *klass)
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
   gl_context_class->realize = gdk_win32_gl_context_realize;
+#ifdef GDK_WIN32_ENABLE_EGL
+  gl_context_class->get_damage = gdk_win32_gl_context_get_damage;
+#endif
 
   draw_context_class->begin_frame = gdk_win32_gl_context_begin_frame;
   draw_context_class->end_frame = gdk_win32_gl_context_end_frame;
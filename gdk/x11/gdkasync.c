@@ -56,6 +56,7 @@ typedef struct _ListChildrenState ListChildrenState;
 typedef struct _SendEventState SendEventState;
 typedef struct _SetInputFocusState SetInputFocusState;
 typedef struct _RoundtripState RoundtripState;
+typedef struct _GetPropertyState GetPropertyState;
 
 typedef enum {
   CHILD_INFO_GET_PROPERTY,
@@ -121,6 +122,21 @@ struct _RoundtripState
   gpointer data;
 };
 
+struct _GetPropertyState
+{
+  Display *dpy;
+  _XAsyncHandler async;
+  gulong get_property_req;
+  GdkDisplay *display;
+  Window window;
+  Atom type;
+  int format;
+  gulong nitems;
+  guchar *data;
+  GdkGetPropertyCallback callback;
+  gpointer user_data;
+};
+
 static gboolean
 callback_idle (gpointer data)
 {
@@ -755,3 +771,162 @@ _gdk_x11_roundtrip_async (GdkDisplay           *display,
   UnlockDisplay(dpy);
   SyncHandle();
 }
+
+static gboolean
+get_property_callback_idle (gpointer data)
+{
+  GetPropertyState *state = (GetPropertyState *)data;
+
+  state->callback (state->display, state->window,
+                   state->type, state->format, state->nitems, state->data,
+                   state->user_data);
+
+  g_free (state->data);
+  g_free (state);
+
+  return FALSE;
+}
+
+static Bool
+get_property_handler (Display *dpy,
+                      xReply  *rep,
+                      char    *buf,
+                      int      len,
+                      XPointer data)
+{
+  GetPropertyState *state = (GetPropertyState *)data;
+  guint id;
+
+  if (dpy->last_request_read != state->get_property_req)
+    return False;
+
+  /* Errors, such as BadWindow for a window that went away in the
+   * meantime, are reported like a missing property.
+   */
+  if (rep->generic.type != X_Error)
+    {
+      xGetPropertyReply replbuf;
+      xGetPropertyReply *repl;
+      gsize item_size;
+      gsize nbytes;
+
+      repl = (xGetPropertyReply *)
+        _XGetAsyncReply(dpy, (char *)&replbuf, rep, buf, len,
+                        (sizeof(xGetPropertyReply) - sizeof(xReply)) >> 2,
+                        False);
+
+      switch (repl->format)
+        {
+        case 8:
+        case 16:
+        case 32:
+          item_size = repl->format / 8;
+          break;
+        default:
+          item_size = 0;
+          break;
+        }
+
+      nbytes = item_size * repl->nItems;
+      if (repl->propertyType != None && nbytes > 0 &&
+          nbytes <= (gsize) repl->length << 2)
+        {
+          guchar *raw = g_malloc (nbytes);
+
+          _XGetAsyncData (dpy, (char *)raw, buf, len,
+                          sizeof (xGetPropertyReply), nbytes,
+                          repl->length << 2);
+
+          /* Match XGetWindowProperty(), which returns 32 bit items
+           * as longs
+           */
+          if (repl->format == 32)
+            {
+              gulong *items = g_new (gulong, repl->nItems);
+              guint32 *raw32 = (guint32 *)raw;
+              gulong i;
+
+              for (i = 0; i < repl->nItems; i++)
+                items[i] = raw32[i];
+
+              g_free (raw);
+              state->data = (guchar *)items;
+            }
+          else
+            state->data = raw;
+
+          state->type = repl->propertyType;
+          state->format = repl->format;
+          state->nitems = repl->nItems;
+        }
+      else if (repl->length > 0)
+        {
+          _XGetAsyncData (dpy, NULL, buf, len,
+                          sizeof (xGetPropertyReply), 0,
+                          repl->length << 2);
+        }
+    }
+
+  id = g_idle_add (get_property_callback_idle, state);
+  g_source_set_name_by_id (id, "[gtk] get_property_callback_idle");
+
+  DeqAsyncHandler(state->dpy, &state->async);
+
+  return True;
+}
+
+/*
+ * _gdk_x11_get_window_property_async:
+ *
+ * Like XGetWindowProperty(), but without waiting for the reply. When
+ * the reply arrives, @callback is called from an idle with the
+ * property's contents, or with a type of None if the property or
+ * the window do not exist. Requests made in a row get pipelined, so
+ * their round-trips overlap.
+ *
+ * The data passed to @callback is freed after it returns.
+ */
+void
+_gdk_x11_get_window_property_async (GdkDisplay             *display,
+                                    Window                  window,
+                                    Atom                    property,
+                                    Atom                    type,
+                                    glong                   length,
+                                    GdkGetPropertyCallback  callback,
+                                    gpointer                user_data)
+{
+  Display *dpy;
+  GetPropertyState *state;
+  xGetPropertyReq *req;
+
+  dpy = GDK_DISPLAY_XDISPLAY (display);
+
+  state = g_new0 (GetPropertyState, 1);
+
+  state->display = display;
+  state->dpy = dpy;
+  state->window = window;
+  state->type = None;
+  state->callback = callback;
+  state->user_data = user_data;
+
+  LockDisplay(dpy);
+
+  state->async.next = dpy->async_handlers;
+  state->async.handler = get_property_handler;
+  state->async.data = (XPointer) state;
+  dpy->async_handlers = &state->async;
+
+  GetReq (GetProperty, req);
+  req->window = window;
+  req->property = property;
+  req->type = type;
+  req->delete = False;
+  req->longOffset = 0;
+  req->longLength = length;
+
+  state->get_property_req = dpy->request;
+
+  UnlockDisplay(dpy);
+  SyncHandle();
+}
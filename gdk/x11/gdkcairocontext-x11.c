@@ -30,8 +30,164 @@
 
 #include <X11/Xlib.h>
 
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
 G_DEFINE_TYPE (GdkX11CairoContext, gdk_x11_cairo_context, GDK_TYPE_CAIRO_CONTEXT)
 
+#ifdef HAVE_XSHM
+/* If the server supports MIT-SHM, frames are drawn into an image in
+ * memory shared with the server, and only the painted parts of it
+ * are put on the window. This way, the pixels don't have to be sent
+ * through the connection, which matters for servers like VNC that
+ * don't accelerate XRender. The image is kept across frames.
+ */
+static void
+gdk_x11_cairo_context_free_shm_image (GdkX11CairoContext *self)
+{
+  GdkDisplay *display;
+
+  if (self->shm_image == NULL)
+    return;
+
+  display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+
+  XShmDetach (gdk_x11_display_get_xdisplay (display), &self->shm_info);
+  XDestroyImage (self->shm_image);
+  shmdt (self->shm_info.shmaddr);
+  self->shm_image = NULL;
+}
+
+static gboolean
+gdk_x11_cairo_context_ensure_shm_image (GdkX11CairoContext *self,
+                                        GdkSurface         *surface,
+                                        int                 width,
+                                        int                 height)
+{
+  GdkX11Display *display_x11;
+  Display *xdisplay;
+  XImage *image;
+  gboolean attached;
+  int depth;
+
+  if (self->shm_image &&
+      self->shm_image->width == width &&
+      self->shm_image->height == height)
+    return TRUE;
+
+  gdk_x11_cairo_context_free_shm_image (self);
+
+  display_x11 = GDK_X11_DISPLAY (gdk_surface_get_display (surface));
+  xdisplay = display_x11->xdisplay;
+
+  if (!display_x11->have_shm)
+    return FALSE;
+
+  depth = gdk_x11_display_get_window_depth (display_x11);
+  if (depth != 24 && depth != 32)
+    return FALSE;
+
+  image = XShmCreateImage (xdisplay,
+                           gdk_x11_display_get_window_visual (display_x11),
+                           depth, ZPixmap, NULL,
+                           &self->shm_info,
+                           width, height);
+  if (image == NULL)
+    return FALSE;
+
+  /* cairo draws 32bpp in native byte order */
+  if (image->bits_per_pixel != 32 ||
+      image->byte_order != (G_BYTE_ORDER == G_LITTLE_ENDIAN ? LSBFirst : MSBFirst))
+    {
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  self->shm_info.shmid = shmget (IPC_PRIVATE,
+                                 image->bytes_per_line * image->height,
+                                 IPC_CREAT | 0600);
+  if (self->shm_info.shmid < 0)
+    {
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  self->shm_info.shmaddr = image->data = shmat (self->shm_info.shmid, NULL, 0);
+  if (self->shm_info.shmaddr == (char *) -1)
+    {
+      shmctl (self->shm_info.shmid, IPC_RMID, NULL);
+      XDestroyImage (image);
+      return FALSE;
+    }
+
+  self->shm_info.readOnly = False;
+
+  gdk_x11_display_error_trap_push (GDK_DISPLAY (display_x11));
+  XShmAttach (xdisplay, &self->shm_info);
+  XSync (xdisplay, False);
+  attached = gdk_x11_display_error_trap_pop (GDK_DISPLAY (display_x11)) == 0;
+
+  /* The segment is freed once both sides have detached */
+  shmctl (self->shm_info.shmid, IPC_RMID, NULL);
+
+  if (!attached)
+    {
+      /* Most likely the server is on another machine */
+      display_x11->have_shm = FALSE;
+      XDestroyImage (image);
+      shmdt (self->shm_info.shmaddr);
+      return FALSE;
+    }
+
+  if (self->shm_gc == NULL)
+    self->shm_gc = XCreateGC (xdisplay, GDK_SURFACE_XID (surface), 0, NULL);
+
+  self->shm_image = image;
+
+  return TRUE;
+}
+
+static void
+gdk_x11_cairo_context_put_shm_image (GdkX11CairoContext *self,
+                                     cairo_region_t     *painted)
+{
+  GdkSurface *surface;
+  Display *xdisplay;
+  XImage *image = self->shm_image;
+  int scale, i, n;
+
+  surface = gdk_draw_context_get_surface (GDK_DRAW_CONTEXT (self));
+  xdisplay = gdk_x11_display_get_xdisplay (gdk_surface_get_display (surface));
+  scale = gdk_surface_get_scale_factor (surface);
+
+  cairo_surface_flush (self->paint_surface);
+
+  n = cairo_region_num_rectangles (painted);
+  for (i = 0; i < n; i++)
+    {
+      cairo_rectangle_int_t rect;
+      int x0, y0, x1, y1;
+
+      cairo_region_get_rectangle (painted, i, &rect);
+
+      x0 = CLAMP (rect.x * scale, 0, image->width);
+      y0 = CLAMP (rect.y * scale, 0, image->height);
+      x1 = CLAMP ((rect.x + rect.width) * scale, 0, image->width);
+      y1 = CLAMP ((rect.y + rect.height) * scale, 0, image->height);
+
+      if (x1 > x0 && y1 > y0)
+        XShmPutImage (xdisplay, GDK_SURFACE_XID (surface), self->shm_gc, image,
+                      x0, y0, x0, y0, x1 - x0, y1 - y0,
+                      False);
+    }
+
+  /* We must not draw into the image before the server has read it */
+  XSync (xdisplay, False);
+}
+#endif
+
 static cairo_surface_t *
 create_cairo_surface_for_surface (GdkSurface *surface)
 {
@@ -66,6 +222,38 @@ gdk_x11_cairo_context_begin_frame (GdkDrawContext *draw_context,
   surface = gdk_draw_context_get_surface (draw_context);
   cairo_region_get_extents (region, &clip_box);
 
+#ifdef HAVE_XSHM
+  {
+    int scale = gdk_surface_get_scale_factor (surface);
+
+    if (gdk_x11_cairo_context_ensure_shm_image (self, surface,
+                                                MAX (gdk_surface_get_width (surface) * scale, 1),
+                                                MAX (gdk_surface_get_height (surface) * scale, 1)))
+      {
+        XImage *image = self->shm_image;
+        cairo_t *cr;
+
+        self->paint_surface = cairo_image_surface_create_for_data ((guchar *) image->data,
+                                                                   image->depth == 32
+                                                                   ? CAIRO_FORMAT_ARGB32
+                                                                   : CAIRO_FORMAT_RGB24,
+                                                                   image->width,
+                                                                   image->height,
+                                                                   image->bytes_per_line);
+        cairo_surface_set_device_scale (self->paint_surface, scale, scale);
+
+        /* The image still contains the last frame */
+        cr = cairo_create (self->paint_surface);
+        gdk_cairo_region (cr, region);
+        cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+        cairo_fill (cr);
+        cairo_destroy (cr);
+
+        return;
+      }
+  }
+#endif
+
   self->window_surface = create_cairo_surface_for_surface (surface);
   self->paint_surface = gdk_surface_create_similar_surface (surface,
                                                             cairo_surface_get_content (self->window_surface),
@@ -84,6 +272,15 @@ gdk_x11_cairo_context_end_frame (GdkDrawContext *draw_context,
   GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (draw_context);
   cairo_t *cr;
 
+#ifdef HAVE_XSHM
+  if (self->window_surface == NULL)
+    {
+      gdk_x11_cairo_context_put_shm_image (self, painted);
+      g_clear_pointer (&self->paint_surface, cairo_surface_destroy);
+      return;
+    }
+#endif
+
   cr = cairo_create (self->window_surface);
 
   cairo_set_source_surface (cr, self->paint_surface, 0, 0);
@@ -109,12 +306,35 @@ gdk_x11_cairo_context_cairo_create (GdkCairoContext *context)
   return cairo_create (self->paint_surface);
 }
 
+static void
+gdk_x11_cairo_context_dispose (GObject *object)
+{
+#ifdef HAVE_XSHM
+  GdkX11CairoContext *self = GDK_X11_CAIRO_CONTEXT (object);
+
+  gdk_x11_cairo_context_free_shm_image (self);
+
+  if (self->shm_gc)
+    {
+      GdkDisplay *display = gdk_draw_context_get_display (GDK_DRAW_CONTEXT (self));
+
+      XFreeGC (gdk_x11_display_get_xdisplay (display), self->shm_gc);
+      self->shm_gc = NULL;
+    }
+#endif
+
+  G_OBJECT_CLASS (gdk_x11_cairo_context_parent_class)->dispose (object);
+}
+
 static void
 gdk_x11_cairo_context_class_init (GdkX11CairoContextClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GdkDrawContextClass *draw_context_class = GDK_DRAW_CONTEXT_CLASS (klass);
   GdkCairoContextClass *cairo_context_class = GDK_CAIRO_CONTEXT_CLASS (klass);
 
+  gobject_class->dispose = gdk_x11_cairo_context_dispose;
+
   draw_context_class->begin_frame = gdk_x11_cairo_context_begin_frame;
   draw_context_class->end_frame = gdk_x11_cairo_context_end_frame;
 
@@ -25,6 +25,12 @@
 
 #include "gdkcairocontextprivate.h"
 
+#include <X11/Xlib.h>
+
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 G_BEGIN_DECLS
 
 #define GDK_TYPE_X11_CAIRO_CONTEXT		(gdk_x11_cairo_context_get_type ())
@@ -43,6 +49,13 @@ struct _GdkX11CairoContext
 
   cairo_surface_t *window_surface;
   cairo_surface_t *paint_surface;
+
+#ifdef HAVE_XSHM
+  /* Kept across frames, NULL if shared memory can't be used */
+  XImage *shm_image;
+  XShmSegmentInfo shm_info;
+  GC shm_gc;
+#endif
 };
 
 struct _GdkX11CairoContextClass
@@ -77,6 +77,10 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 enum {
   XEVENT,
   LAST_SIGNAL
@@ -435,33 +439,18 @@ do_net_wm_state_changes (GdkSurface *surface)
 }
 
 static void
-gdk_check_wm_desktop_changed (GdkSurface *surface)
+handle_wm_desktop (GdkSurface *surface,
+                   Atom        type,
+                   int         format,
+                   gulong      nitems,
+                   guchar     *data)
 {
   GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
-  GdkDisplay *display = GDK_SURFACE_DISPLAY (surface);
-
-  Atom type;
-  int format;
-  gulong nitems;
-  gulong bytes_after;
-  guchar *data;
-  gulong *desktop;
 
-  type = None;
-  gdk_x11_display_error_trap_push (display);
-  XGetWindowProperty (GDK_DISPLAY_XDISPLAY (display),
-                      GDK_SURFACE_XID (surface),
-                      gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_DESKTOP"),
-                      0, G_MAXLONG, False, XA_CARDINAL, &type,
-                      &format, &nitems,
-                      &bytes_after, &data);
-  gdk_x11_display_error_trap_pop_ignored (display);
-
-  if (type != None)
+  if (type != None && format == 32 && nitems > 0)
     {
-      desktop = (gulong *)data;
+      gulong *desktop = (gulong *)data;
       toplevel->on_all_desktops = ((*desktop & 0xFFFFFFFF) == 0xFFFFFFFF);
-      XFree (desktop);
     }
   else
     toplevel->on_all_desktops = FALSE;
@@ -470,18 +459,15 @@ gdk_check_wm_desktop_changed (GdkSurface *surface)
 }
 
 static void
-gdk_check_wm_state_changed (GdkSurface *surface)
+handle_wm_state (GdkSurface *surface,
+                 Atom        type,
+                 int         format,
+                 gulong      nitems,
+                 guchar     *data)
 {
   GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
   GdkDisplay *display = GDK_SURFACE_DISPLAY (surface);
   GdkX11Screen *screen = GDK_SURFACE_SCREEN (surface);
-
-  Atom type;
-  int format;
-  gulong nitems;
-  gulong bytes_after;
-  guchar *data;
-  Atom *atoms = NULL;
   gulong i;
 
   toplevel->have_maxvert = FALSE;
@@ -490,23 +476,14 @@ gdk_check_wm_state_changed (GdkSurface *surface)
   toplevel->have_focused = FALSE;
   toplevel->have_hidden = FALSE;
 
-  type = None;
-  gdk_x11_display_error_trap_push (display);
-  XGetWindowProperty (GDK_DISPLAY_XDISPLAY (display), GDK_SURFACE_XID (surface),
-		      gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE"),
-		      0, G_MAXLONG, False, XA_ATOM, &type, &format, &nitems,
-		      &bytes_after, &data);
-  gdk_x11_display_error_trap_pop_ignored (display);
-
-  if (type != None)
+  if (type != None && format == 32)
     {
       Atom maxvert_atom = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_MAXIMIZED_VERT");
       Atom maxhorz_atom	= gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_MAXIMIZED_HORZ");
       Atom fullscreen_atom = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_FULLSCREEN");
       Atom focused_atom = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_FOCUSED");
       Atom hidden_atom = gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE_HIDDEN");
-
-      atoms = (Atom *)data;
+      Atom *atoms = (Atom *)data;
 
       i = 0;
       while (i < nitems)
@@ -524,8 +501,6 @@ gdk_check_wm_state_changed (GdkSurface *surface)
 
           ++i;
         }
-
-      XFree (atoms);
     }
 
   if (!gdk_x11_screen_supports_net_wm_hint (screen,
@@ -536,39 +511,23 @@ gdk_check_wm_state_changed (GdkSurface *surface)
 }
 
 static void
-gdk_check_edge_constraints_changed (GdkSurface *surface)
+handle_edge_constraints (GdkSurface *surface,
+                         Atom        type,
+                         int         format,
+                         gulong      nitems,
+                         guchar     *data)
 {
   GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
-  GdkDisplay *display = GDK_SURFACE_DISPLAY (surface);
-
-  Atom type;
-  int format;
-  gulong nitems;
-  gulong bytes_after;
-  guchar *data;
-  gulong *constraints;
-
-  type = None;
-  gdk_x11_display_error_trap_push (display);
-  XGetWindowProperty (GDK_DISPLAY_XDISPLAY (display),
-                      GDK_SURFACE_XID (surface),
-                      gdk_x11_get_xatom_by_name_for_display (display, "_GTK_EDGE_CONSTRAINTS"),
-                      0, G_MAXLONG, False, XA_CARDINAL, &type,
-                      &format, &nitems,
-                      &bytes_after, &data);
-  gdk_x11_display_error_trap_pop_ignored (display);
 
-  if (type != None)
+  if (type != None && format == 32 && nitems > 0)
     {
-      constraints = (gulong *)data;
+      gulong *constraints = (gulong *)data;
 
       /* The GDK enum for these states does not begin at zero so, to avoid
        * messing around with shifts, just make the passed value and GDK's
        * enum values match by shifting to the first tiled state.
        */
       toplevel->edge_constraints = constraints[0] << 9;
-
-      XFree (constraints);
     }
   else
     {
@@ -578,6 +537,120 @@ gdk_check_edge_constraints_changed (GdkSurface *surface)
   do_net_wm_state_changes (surface);
 }
 
+static void
+handle_frame_extents (GdkSurface *surface,
+                      Atom        type,
+                      int         format,
+                      gulong      nitems,
+                      guchar     *data)
+{
+  GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
+  int i;
+
+  toplevel->have_frame_extents = type == XA_CARDINAL && format == 32 && nitems == 4;
+
+  if (toplevel->have_frame_extents)
+    {
+      for (i = 0; i < 4; i++)
+        toplevel->frame_extents[i] = ((gulong *)data)[i];
+    }
+}
+
+/* Properties that the window manager changes on our toplevels. They
+ * are fetched without blocking on the round-trip, since they change
+ * in bursts, e.g. when maximizing, and round-trips are expensive on
+ * remote displays.
+ */
+static const struct {
+  const char *name;
+  Atom type;
+  void (* handle) (GdkSurface *surface,
+                   Atom        type,
+                   int         format,
+                   gulong      nitems,
+                   guchar     *data);
+} watched_properties[] = {
+  { "_NET_WM_STATE", XA_ATOM, handle_wm_state },
+  { "_NET_WM_DESKTOP", XA_CARDINAL, handle_wm_desktop },
+  { "_GTK_EDGE_CONSTRAINTS", XA_CARDINAL, handle_edge_constraints },
+  { "_NET_FRAME_EXTENTS", XA_CARDINAL, handle_frame_extents },
+};
+
+typedef struct {
+  GdkSurface *surface;
+  guint property;
+} PropertyFetch;
+
+static void fetch_watched_property (GdkSurface *surface,
+                                    guint       property);
+
+static void
+watched_property_received (GdkDisplay *display,
+                           Window      window,
+                           Atom        type,
+                           int         format,
+                           gulong      nitems,
+                           guchar     *data,
+                           gpointer    user_data)
+{
+  PropertyFetch *fetch = user_data;
+  GdkSurface *surface = fetch->surface;
+  guint mask = 1 << fetch->property;
+
+  if (!GDK_SURFACE_DESTROYED (surface))
+    {
+      GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
+
+      toplevel->property_fetches_pending &= ~mask;
+
+      /* The property changed again while the reply was in flight, so
+       * the reply may be stale; wait for the next one instead.
+       */
+      if (toplevel->property_fetches_dirty & mask)
+        {
+          toplevel->property_fetches_dirty &= ~mask;
+          fetch_watched_property (surface, fetch->property);
+        }
+      else
+        {
+          watched_properties[fetch->property].handle (surface, type, format, nitems, data);
+        }
+    }
+
+  g_object_unref (surface);
+  g_free (fetch);
+}
+
+static void
+fetch_watched_property (GdkSurface *surface,
+                        guint       property)
+{
+  GdkToplevelX11 *toplevel = _gdk_x11_surface_get_toplevel (surface);
+  GdkDisplay *display = GDK_SURFACE_DISPLAY (surface);
+  guint mask = 1 << property;
+  PropertyFetch *fetch;
+
+  if (toplevel->property_fetches_pending & mask)
+    {
+      toplevel->property_fetches_dirty |= mask;
+      return;
+    }
+
+  toplevel->property_fetches_pending |= mask;
+
+  fetch = g_new (PropertyFetch, 1);
+  fetch->surface = g_object_ref (surface);
+  fetch->property = property;
+
+  _gdk_x11_get_window_property_async (display,
+                                      GDK_SURFACE_XID (surface),
+                                      gdk_x11_get_xatom_by_name_for_display (display, watched_properties[property].name),
+                                      watched_properties[property].type,
+                                      G_MAXLONG,
+                                      watched_property_received,
+                                      fetch);
+}
+
 static Window
 get_event_xwindow (const XEvent *xevent)
 {
@@ -1002,20 +1075,23 @@ gdk_x11_display_translate_event (GdkEventTranslator *translator,
       if (surface == NULL)
         break;
 
-      /* We compare with the serial of the last time we mapped the
-       * window to avoid refetching properties that we set ourselves
-       */
-      if (toplevel &&
-	  xevent->xproperty.serial >= toplevel->map_serial)
-	{
-	  if (xevent->xproperty.atom == gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_STATE"))
-	    gdk_check_wm_state_changed (surface);
+      if (toplevel)
+        {
+          guint i;
 
-	  if (xevent->xproperty.atom == gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_DESKTOP"))
-	    gdk_check_wm_desktop_changed (surface);
+          for (i = 0; i < G_N_ELEMENTS (watched_properties); i++)
+            {
+              if (xevent->xproperty.atom != gdk_x11_get_xatom_by_name_for_display (display, watched_properties[i].name))
+                continue;
 
-	  if (xevent->xproperty.atom == gdk_x11_get_xatom_by_name_for_display (display, "_GTK_EDGE_CONSTRAINTS"))
-	    gdk_check_edge_constraints_changed (surface);
+              /* We compare with the serial of the last time we mapped the
+               * window to avoid refetching properties that we set ourselves.
+               * Frame extents are only ever set by the window manager.
+               */
+              if (xevent->xproperty.serial >= toplevel->map_serial ||
+                  watched_properties[i].handle == handle_frame_extents)
+                fetch_watched_property (surface, i);
+            }
 	}
       break;
 
@@ -1611,6 +1687,10 @@ gdk_x11_display_open (const char *display_name)
     display_x11->have_damage = TRUE;
 #endif
 
+#ifdef HAVE_XSHM
+  display_x11->have_shm = XShmQueryExtension (display_x11->xdisplay);
+#endif
+
   display->clipboard = gdk_x11_clipboard_new (display, "CLIPBOARD");
   display->primary_clipboard = gdk_x11_clipboard_new (display, "PRIMARY");
 
@@ -156,6 +156,10 @@ struct _GdkX11Display
   int damage_error_base;
   guint have_damage;
 #endif
+
+#ifdef HAVE_XSHM
+  guint have_shm : 1;
+#endif
 };
 
 struct _GdkX11DisplayClass
@@ -435,6 +435,48 @@ translate_subpixel_order (int subpixel)
     }
 }
 
+#ifdef HAVE_RANDR
+/* Drivers that support variable refresh rates set the
+ * vrr_capable property on the outputs that can do it.
+ */
+static gboolean
+output_is_vrr_capable (GdkDisplay *display,
+                       RROutput    output)
+{
+  Display *xdisplay = GDK_DISPLAY_XDISPLAY (display);
+  Atom actual_type, vrr_atom;
+  int actual_format;
+  unsigned char *prop = NULL;
+  unsigned long nitems, bytes_left;
+  gboolean capable = FALSE;
+
+  vrr_atom = XInternAtom (xdisplay, "vrr_capable", True);
+  if (vrr_atom == None)
+    return FALSE;
+
+  gdk_x11_display_error_trap_push (display);
+  XRRGetOutputProperty (xdisplay, output,
+                        vrr_atom,
+                        0, 1,
+                        False, False,
+                        XA_INTEGER,
+                        &actual_type,
+                        &actual_format,
+                        &nitems,
+                        &bytes_left,
+                        &prop);
+  gdk_x11_display_error_trap_pop_ignored (display);
+
+  if (actual_type == XA_INTEGER && actual_format == 32 && nitems == 1)
+    capable = *(long *) prop != 0;
+
+  if (prop)
+    XFree (prop);
+
+  return capable;
+}
+#endif
+
 static gboolean
 init_randr15 (GdkX11Screen *x11_screen)
 {
@@ -589,6 +631,8 @@ init_randr15 (GdkX11Screen *x11_screen)
                                      rr_monitors[i].mheight);
       gdk_monitor_set_subpixel_layout (GDK_MONITOR (monitor),
                                        translate_subpixel_order (output_info->subpixel_order));
+      gdk_monitor_set_variable_refresh (GDK_MONITOR (monitor),
+                                        output_is_vrr_capable (display, output));
       gdk_monitor_set_refresh_rate (GDK_MONITOR (monitor), refresh_rate);
       gdk_monitor_set_scale_factor (GDK_MONITOR (monitor), x11_screen->surface_scale);
       gdk_monitor_set_model (GDK_MONITOR (monitor), name);
@@ -738,6 +782,8 @@ init_randr13 (GdkX11Screen *x11_screen)
                                          output_info->mm_height);
           gdk_monitor_set_subpixel_layout (GDK_MONITOR (monitor),
                                            translate_subpixel_order (output_info->subpixel_order));
+          gdk_monitor_set_variable_refresh (GDK_MONITOR (monitor),
+                                            output_is_vrr_capable (display, output));
           gdk_monitor_set_refresh_rate (GDK_MONITOR (monitor), refresh_rate);
           gdk_monitor_set_scale_factor (GDK_MONITOR (monitor), x11_screen->surface_scale);
           gdk_monitor_set_model (GDK_MONITOR (monitor), name);
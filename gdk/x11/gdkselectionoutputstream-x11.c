@@ -188,6 +188,20 @@ gdk_x11_selection_output_stream_needs_flush_unlocked (GdkX11SelectionOutputStrea
   return priv->data->len >= gdk_x11_display_get_max_request_size (priv->display);
 }
 
+/* Only take as much as fits into one property change. Callers like
+ * g_output_stream_write_all() loop over short writes, and this way
+ * huge payloads get sent in chunks instead of being copied into our
+ * buffer in one go.
+ */
+static gsize
+gdk_x11_selection_output_stream_get_write_size (GdkX11SelectionOutputStream *stream,
+                                                gsize                        count)
+{
+  GdkX11SelectionOutputStreamPrivate *priv = gdk_x11_selection_output_stream_get_instance_private (stream);
+
+  return MIN (count, gdk_x11_display_get_max_request_size (priv->display));
+}
+
 static gboolean
 gdk_x11_selection_output_stream_needs_flush (GdkX11SelectionOutputStream *stream)
 {
@@ -334,6 +348,8 @@ gdk_x11_selection_output_stream_write (GOutputStream  *output_stream,
   GdkX11SelectionOutputStream *stream = GDK_X11_SELECTION_OUTPUT_STREAM (output_stream);
   GdkX11SelectionOutputStreamPrivate *priv = gdk_x11_selection_output_stream_get_instance_private (stream);
 
+  count = gdk_x11_selection_output_stream_get_write_size (stream, count);
+
   g_mutex_lock (&priv->mutex);
   g_byte_array_append (priv->data, buffer, count);
   GDK_NOTE (SELECTION, g_printerr ("%s:%s: wrote %zu bytes, %u total now\n",
@@ -367,6 +383,8 @@ gdk_x11_selection_output_stream_write_async (GOutputStream        *output_stream
   g_task_set_source_tag (task, gdk_x11_selection_output_stream_write_async);
   g_task_set_priority (task, io_priority);
 
+  count = gdk_x11_selection_output_stream_get_write_size (stream, count);
+
   g_mutex_lock (&priv->mutex);
   g_byte_array_append (priv->data, buffer, count);
   GDK_NOTE (SELECTION, g_printerr ("%s:%s: async wrote %zu bytes, %u total now\n",
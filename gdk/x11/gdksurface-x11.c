@@ -1328,6 +1328,9 @@ set_initial_hints (GdkSurface *surface)
 		       gdk_x11_get_xatom_by_name_for_display (display, "_NET_WM_DESKTOP"));
     }
 
+  /* The window manager may give the window a different frame */
+  toplevel->have_frame_extents = FALSE;
+
   toplevel->map_serial = NextRequest (xdisplay);
 }
 
@@ -2513,6 +2516,7 @@ gdk_x11_surface_get_frame_extents (GdkSurface    *surface,
   guint ww, wh, wb, wd;
   int wx, wy;
   gboolean got_frame_extents = FALSE;
+  gulong frame_extents[4];
 
   g_return_if_fail (rect != NULL);
 
@@ -2541,46 +2545,59 @@ gdk_x11_surface_get_frame_extents (GdkSurface    *surface,
 
   xwindow = GDK_SURFACE_XID (surface);
 
-  /* first try: use _NET_FRAME_EXTENTS */
-  if (gdk_x11_screen_supports_net_wm_hint (GDK_SURFACE_SCREEN (surface),
-                                           g_intern_static_string ("_NET_FRAME_EXTENTS")) &&
-      XGetWindowProperty (GDK_DISPLAY_XDISPLAY (display), xwindow,
-                          gdk_x11_get_xatom_by_name_for_display (display,
-                                                                  "_NET_FRAME_EXTENTS"),
-                          0, G_MAXLONG, False, XA_CARDINAL, &type_return,
-                          &format_return, &nitems_return, &bytes_after_return,
-                          &data)
-      == Success)
+  /* first try: use _NET_FRAME_EXTENTS, which we normally have already
+   * from watching its changes */
+  if (impl->toplevel && impl->toplevel->have_frame_extents)
+    {
+      for (i = 0; i < 4; i++)
+        frame_extents[i] = impl->toplevel->frame_extents[i];
+      got_frame_extents = TRUE;
+    }
+  else if (gdk_x11_screen_supports_net_wm_hint (GDK_SURFACE_SCREEN (surface),
+                                                g_intern_static_string ("_NET_FRAME_EXTENTS")) &&
+           XGetWindowProperty (GDK_DISPLAY_XDISPLAY (display), xwindow,
+                               gdk_x11_get_xatom_by_name_for_display (display,
+                                                                       "_NET_FRAME_EXTENTS"),
+                               0, G_MAXLONG, False, XA_CARDINAL, &type_return,
+                               &format_return, &nitems_return, &bytes_after_return,
+                               &data)
+           == Success)
     {
       if ((type_return == XA_CARDINAL) && (format_return == 32) &&
 	  (nitems_return == 4) && (data))
         {
 	  gulong *ldata = (gulong *) data;
-	  got_frame_extents = TRUE;
-
-	  /* try to get the real client window geometry */
-	  if (XGetGeometry (GDK_DISPLAY_XDISPLAY (display), xwindow,
-			    &root, &wx, &wy, &ww, &wh, &wb, &wd) &&
-              XTranslateCoordinates (GDK_DISPLAY_XDISPLAY (display),
-	  			     xwindow, root, 0, 0, &wx, &wy, &child))
-            {
-	      rect->x = wx;
-	      rect->y = wy;
-	      rect->width = ww;
-	      rect->height = wh;
-	    }
 
-	  /* _NET_FRAME_EXTENTS format is left, right, top, bottom */
-	  rect->x -= ldata[0];
-	  rect->y -= ldata[2];
-	  rect->width += ldata[0] + ldata[1];
-	  rect->height += ldata[2] + ldata[3];
+	  for (i = 0; i < 4; i++)
+	    frame_extents[i] = ldata[i];
+	  got_frame_extents = TRUE;
 	}
 
       if (data)
 	XFree (data);
     }
 
+  if (got_frame_extents)
+    {
+      /* try to get the real client window geometry */
+      if (XGetGeometry (GDK_DISPLAY_XDISPLAY (display), xwindow,
+                        &root, &wx, &wy, &ww, &wh, &wb, &wd) &&
+          XTranslateCoordinates (GDK_DISPLAY_XDISPLAY (display),
+                                 xwindow, root, 0, 0, &wx, &wy, &child))
+        {
+          rect->x = wx;
+          rect->y = wy;
+          rect->width = ww;
+          rect->height = wh;
+        }
+
+      /* _NET_FRAME_EXTENTS format is left, right, top, bottom */
+      rect->x -= frame_extents[0];
+      rect->y -= frame_extents[2];
+      rect->width += frame_extents[0] + frame_extents[1];
+      rect->height += frame_extents[2] + frame_extents[3];
+    }
+
   if (got_frame_extents)
     goto out;
 
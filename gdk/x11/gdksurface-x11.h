@@ -156,6 +156,15 @@ struct _GdkToplevelX11
   /* Constrained edge information */
   guint edge_constraints;
 
+  /* Window manager properties being fetched asynchronously, and the
+   * ones that changed again while their fetch was in flight */
+  guint property_fetches_pending;
+  guint property_fetches_dirty;
+
+  /* _NET_FRAME_EXTENTS, as left, right, top, bottom */
+  int frame_extents[4];
+  guint have_frame_extents : 1;
+
 #ifdef HAVE_XSYNC
   XID update_counter;
   XID extended_update_counter;
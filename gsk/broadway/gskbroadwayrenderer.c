@@ -9,6 +9,9 @@
 #include "gskrendererprivate.h"
 #include "gskrendernodeprivate.h"
 #include "gdk/gdktextureprivate.h"
+#include "gdk/gdkmemorytextureprivate.h"
+
+#include <pango/pangocairo.h>
 
 struct _GskBroadwayRenderer
 {
@@ -24,6 +27,12 @@ struct _GskBroadwayRenderer
   /* Kept from last frame */
   GHashTable *last_node_lookup;
   GskRenderNode *last_root; /* Owning refs to the things in last_node_lookup */
+
+  /* Rasterized glyphs, shared by all text nodes */
+  cairo_surface_t *glyph_atlas;
+  GHashTable *glyphs;
+  int atlas_x, atlas_y, atlas_row_height;
+  GArray *atlas_refs; /* Positions in nodes that refer to the current atlas */
 };
 
 struct _GskBroadwayRendererClass
@@ -57,6 +66,9 @@ gsk_broadway_renderer_unrealize (GskRenderer *renderer)
 {
   GskBroadwayRenderer *self = GSK_BROADWAY_RENDERER (renderer);
   g_clear_object (&self->draw_context);
+  g_clear_pointer (&self->glyph_atlas, cairo_surface_destroy);
+  g_clear_pointer (&self->glyphs, g_hash_table_unref);
+  g_clear_pointer (&self->atlas_refs, g_array_unref);
 }
 
 static GdkTexture *
@@ -532,6 +544,284 @@ get_colorized_texture (GdkTexture *texture,
 }
 
 
+#define GLYPH_ATLAS_SIZE 512
+
+typedef struct {
+  PangoFont *font;
+  PangoGlyph glyph;
+  int scale;
+} GlyphKey;
+
+typedef struct {
+  GlyphKey key;
+
+  /* Location in the atlas, in pixels */
+  int x, y;
+  int width, height;
+
+  /* Offset of the top left corner from the glyph origin, in pixels */
+  int ink_x, ink_y;
+} GlyphInfo;
+
+static guint
+glyph_key_hash (gconstpointer data)
+{
+  const GlyphKey *key = data;
+
+  return GPOINTER_TO_UINT (key->font) ^ (key->glyph << 8) ^ key->scale;
+}
+
+static gboolean
+glyph_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const GlyphKey *ka = a;
+  const GlyphKey *kb = b;
+
+  return ka->font == kb->font &&
+         ka->glyph == kb->glyph &&
+         ka->scale == kb->scale;
+}
+
+static void
+glyph_info_free (GlyphInfo *info)
+{
+  g_object_unref (info->key.font);
+  g_free (info);
+}
+
+/* Uploads the current contents of the atlas, and points the text
+ * nodes that have been added since the last upload at it.
+ */
+static void
+flush_glyph_atlas (GskBroadwayRenderer *self,
+                   GdkDisplay          *display)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+  guint32 texture_id;
+  guint i;
+
+  if (self->atlas_refs == NULL || self->atlas_refs->len == 0)
+    return;
+
+  cairo_surface_flush (self->glyph_atlas);
+  bytes = g_bytes_new (cairo_image_surface_get_data (self->glyph_atlas),
+                       cairo_image_surface_get_stride (self->glyph_atlas) * GLYPH_ATLAS_SIZE);
+  texture = gdk_memory_texture_new (GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE,
+                                    GDK_MEMORY_CAIRO_FORMAT_ARGB32,
+                                    bytes,
+                                    cairo_image_surface_get_stride (self->glyph_atlas));
+  g_bytes_unref (bytes);
+
+  g_ptr_array_add (self->node_textures, texture); /* Transfers ownership to node_textures */
+  texture_id = gdk_broadway_display_ensure_texture (display, texture);
+
+  for (i = 0; i < self->atlas_refs->len; i++)
+    set_uint32_at (self->nodes, g_array_index (self->atlas_refs, guint, i), texture_id);
+
+  g_array_set_size (self->atlas_refs, 0);
+}
+
+static void
+reset_glyph_atlas (GskBroadwayRenderer *self,
+                   GdkDisplay          *display)
+{
+  cairo_t *cr;
+
+  flush_glyph_atlas (self, display);
+
+  cr = cairo_create (self->glyph_atlas);
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  g_hash_table_remove_all (self->glyphs);
+  self->atlas_x = 0;
+  self->atlas_y = 0;
+  self->atlas_row_height = 0;
+}
+
+/* Returns NULL if the glyph doesn't fit into the atlas */
+static const GlyphInfo *
+lookup_glyph (GskBroadwayRenderer *self,
+              PangoFont           *font,
+              PangoGlyph           glyph,
+              int                  scale)
+{
+  GlyphKey key = { font, glyph, scale };
+  GlyphInfo *info;
+  PangoRectangle ink_rect;
+  int x0, y0, x1, y1;
+  cairo_t *cr;
+
+  info = g_hash_table_lookup (self->glyphs, &key);
+  if (info)
+    return info;
+
+  pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
+
+  /* Leave a pixel around the ink for antialiasing */
+  x0 = floor ((double) ink_rect.x * scale / PANGO_SCALE) - 1;
+  y0 = floor ((double) ink_rect.y * scale / PANGO_SCALE) - 1;
+  x1 = ceil ((double) (ink_rect.x + ink_rect.width) * scale / PANGO_SCALE) + 1;
+  y1 = ceil ((double) (ink_rect.y + ink_rect.height) * scale / PANGO_SCALE) + 1;
+
+  if (x1 - x0 > GLYPH_ATLAS_SIZE || y1 - y0 > GLYPH_ATLAS_SIZE)
+    return NULL;
+
+  if (self->atlas_x + (x1 - x0) > GLYPH_ATLAS_SIZE)
+    {
+      self->atlas_x = 0;
+      self->atlas_y += self->atlas_row_height;
+      self->atlas_row_height = 0;
+    }
+
+  if (self->atlas_y + (y1 - y0) > GLYPH_ATLAS_SIZE)
+    return NULL;
+
+  info = g_new0 (GlyphInfo, 1);
+  info->key.font = g_object_ref (font);
+  info->key.glyph = glyph;
+  info->key.scale = scale;
+  info->ink_x = x0;
+  info->ink_y = y0;
+
+  if (ink_rect.width > 0 && ink_rect.height > 0)
+    {
+      cairo_glyph_t cairo_glyph = { glyph, 0, 0 };
+
+      info->x = self->atlas_x;
+      info->y = self->atlas_y;
+      info->width = x1 - x0;
+      info->height = y1 - y0;
+
+      /* White, so that the browser can tint it with the text color */
+      cr = cairo_create (self->glyph_atlas);
+      cairo_rectangle (cr, info->x, info->y, info->width, info->height);
+      cairo_clip (cr);
+      cairo_translate (cr, info->x - x0, info->y - y0);
+      cairo_scale (cr, scale, scale);
+      cairo_set_scaled_font (cr, pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font)));
+      cairo_set_source_rgba (cr, 1, 1, 1, 1);
+      cairo_show_glyphs (cr, &cairo_glyph, 1);
+      cairo_destroy (cr);
+
+      self->atlas_x += info->width;
+      self->atlas_row_height = MAX (self->atlas_row_height, info->height);
+    }
+
+  g_hash_table_insert (self->glyphs, &info->key, info);
+
+  return info;
+}
+
+static gboolean
+text_node_is_supported (GskRenderNode *node)
+{
+  const PangoGlyphInfo *glyphs;
+  guint i, n_glyphs;
+
+  if (gsk_text_node_has_color_glyphs (node))
+    return FALSE;
+
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      /* Hex boxes are drawn by pango, not by the font */
+      if (glyphs[i].glyph & PANGO_GLYPH_UNKNOWN_FLAG)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Makes sure all glyphs of the node are in the atlas at the same time */
+static gboolean
+ensure_text_node_glyphs (GskBroadwayRenderer *self,
+                         GdkDisplay          *display,
+                         GskRenderNode       *node,
+                         int                  scale)
+{
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const PangoGlyphInfo *glyphs;
+  guint i, n_glyphs;
+  int attempt;
+
+  if (self->glyph_atlas == NULL)
+    {
+      self->glyph_atlas = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                      GLYPH_ATLAS_SIZE, GLYPH_ATLAS_SIZE);
+      self->glyphs = g_hash_table_new_full (glyph_key_hash, glyph_key_equal,
+                                            NULL, (GDestroyNotify) glyph_info_free);
+      self->atlas_refs = g_array_new (FALSE, FALSE, sizeof (guint));
+    }
+
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+
+  for (attempt = 0; attempt < 2; attempt++)
+    {
+      for (i = 0; i < n_glyphs; i++)
+        {
+          if (glyphs[i].glyph == PANGO_GLYPH_EMPTY)
+            continue;
+
+          if (lookup_glyph (self, font, glyphs[i].glyph, scale) == NULL)
+            break;
+        }
+
+      if (i == n_glyphs)
+        return TRUE;
+
+      /* Full, start over with an empty atlas */
+      reset_glyph_atlas (self, display);
+    }
+
+  return FALSE;
+}
+
+static void
+add_text_glyphs (GskBroadwayRenderer *self,
+                 GskRenderNode       *node,
+                 int                  scale)
+{
+  PangoFont *font = gsk_text_node_peek_font (node);
+  const graphene_point_t *offset = gsk_text_node_get_offset (node);
+  const PangoGlyphInfo *glyphs;
+  guint i, n_glyphs, placeholder;
+  guint32 n_added = 0;
+  float x, y;
+
+  glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+
+  /* Glyph positions are relative to the node bounds */
+  x = offset->x - node->bounds.origin.x;
+  y = offset->y - node->bounds.origin.y;
+
+  placeholder = add_uint32_placeholder (self->nodes);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      const PangoGlyphInfo *gi = &glyphs[i];
+      const GlyphInfo *info;
+
+      if (gi->glyph != PANGO_GLYPH_EMPTY)
+        {
+          info = lookup_glyph (self, font, gi->glyph, scale);
+          if (info->width > 0)
+            {
+              add_uint32 (self->nodes, info->x | (info->y << 16));
+              add_uint32 (self->nodes, info->width | (info->height << 16));
+              add_float (self->nodes, x + (float) gi->geometry.x_offset / PANGO_SCALE + (float) info->ink_x / scale);
+              add_float (self->nodes, y + (float) gi->geometry.y_offset / PANGO_SCALE + (float) info->ink_y / scale);
+              n_added++;
+            }
+        }
+
+      x += (float) gi->geometry.width / PANGO_SCALE;
+    }
+  set_uint32_at (self->nodes, placeholder, n_added);
+}
+
 /* Note: This tracks the offset so that we can convert
  * the absolute coordinates of the GskRenderNodes to
  * parent-relative which is what the dom uses, and
@@ -842,6 +1132,27 @@ gsk_broadway_renderer_add_node (GskRenderer *renderer,
       break; /* Fallback */
 
     case GSK_TEXT_NODE:
+      {
+        int scale = broadway_display->scale_factor;
+        guint atlas_ref;
+
+        if (text_node_is_supported (node) &&
+            ensure_text_node_glyphs (self, display, node, scale))
+          {
+            if (add_new_node (renderer, node, BROADWAY_NODE_TEXT, clip_bounds))
+              {
+                add_rect (nodes, &node->bounds, offset_x, offset_y);
+                add_rgba (nodes, gsk_text_node_peek_color (node));
+                add_uint32 (nodes, scale);
+                atlas_ref = add_uint32_placeholder (nodes);
+                g_array_append_val (self->atlas_refs, atlas_ref);
+                add_text_glyphs (self, node, scale);
+              }
+            return;
+          }
+      }
+      break; /* Fallback */
+
     case GSK_REPEATING_LINEAR_GRADIENT_NODE:
     case GSK_REPEAT_NODE:
     case GSK_BLEND_NODE:
@@ -906,6 +1217,7 @@ gsk_broadway_renderer_render (GskRenderer          *renderer,
   self->node_textures = self->draw_context->node_textures;
 
   gsk_broadway_renderer_add_node (renderer, root, 0, 0, NULL);
+  flush_glyph_atlas (self, gdk_surface_get_display (gsk_renderer_get_surface (renderer)));
 
   self->nodes = NULL;
   self->node_textures = NULL;
@@ -7,6 +7,8 @@
 #include "gdk/gdkglcontextprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdkgltextureprivate.h"
+#include "gdk/gdkmemorytextureprivate.h"
+#include "gdk/gdkdmabuftextureprivate.h"
 
 #include <gdk/gdk.h>
 #include <epoxy/gl.h>
@@ -16,6 +18,28 @@
   GLuint depth_stencil_id;
 } Fbo;
 
+/* Large textures are streamed through a pixel buffer object, a
+ * band of rows per frame, so that uploading them does not stall
+ * the frame they first appear in.
+ */
+#define STREAMING_MIN_BYTES (1024 * 1024)
+#define UPLOAD_BYTES_PER_FRAME (8 * 1024 * 1024)
+
+/* Render targets that were used for offscreens are kept in a pool
+ * once their frame is done, together with their framebuffer, so the
+ * next frame can render into them again instead of allocating new
+ * ones. Pooled render targets that have not been reused for a while
+ * are deleted.
+ */
+#define MAX_POOLED_RENDER_TARGETS 32
+#define RENDER_TARGET_MAX_UNUSED_FRAMES 10
+
+typedef struct {
+  GLuint pbo_id;
+  GLsync fence;
+  int uploaded_rows;
+} Upload;
+
 typedef struct {
   GLuint texture_id;
   int width;
@@ -26,6 +50,13 @@ typedef struct {
   GdkTexture *user;
   guint in_use : 1;
   guint permanent : 1;
+  guint render_target : 1;
+
+  /* Frames spent in the render target pool */
+  int unused_frames;
+
+  /* Set while the texture is being streamed */
+  Upload *upload;
 
   /* TODO: Make this optional and not for every texture... */
   TextureSlice *slices;
@@ -42,17 +73,23 @@ struct _GskGLDriver
     GQuark created_textures;
     GQuark reused_textures;
     GQuark surface_uploads;
+    GQuark created_render_targets;
+    GQuark reused_render_targets;
   } counters;
 
   Fbo default_fbo;
 
   GHashTable *textures;         /* texture_id -> Texture */
   GHashTable *pointer_textures; /* pointer -> texture_id */
+  GPtrArray *render_target_pool; /* Texture, not in self->textures */
 
   const Texture *bound_source_texture;
 
   int max_texture_size;
 
+  /* Bytes that may still be streamed this frame */
+  gsize upload_budget;
+
   gboolean in_frame : 1;
 };
 
@@ -73,6 +110,17 @@ fbo_clear (const Fbo *f)
   glDeleteFramebuffers (1, &f->fbo_id);
 }
 
+static void
+upload_free (Upload *upload)
+{
+  if (upload->fence)
+    glDeleteSync (upload->fence);
+
+  glDeleteBuffers (1, &upload->pbo_id);
+
+  g_slice_free (Upload, upload);
+}
+
 static void
 texture_free (gpointer data)
 {
@@ -82,6 +130,8 @@ texture_free (gpointer data)
   if (t->user)
     gdk_texture_clear_render_data (t->user);
 
+  g_clear_pointer (&t->upload, upload_free);
+
   if (t->fbo.fbo_id != 0)
     fbo_clear (&t->fbo);
 
@@ -112,6 +162,47 @@ gsk_gl_driver_set_texture_parameters (GskGLDriver *self,
   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
+static gboolean
+filter_uses_mipmaps (int filter)
+{
+  return filter != GL_NEAREST && filter != GL_LINEAR;
+}
+
+/* GLES 2 can't generate mipmaps for textures whose size is not
+ * a power of two, which is almost all of ours.
+ */
+static int
+gsk_gl_driver_check_min_filter (GskGLDriver *self,
+                                int          min_filter)
+{
+  int major, minor;
+
+  if (!filter_uses_mipmaps (min_filter) ||
+      !gdk_gl_context_get_use_es (self->gl_context))
+    return min_filter;
+
+  gdk_gl_context_get_version (self->gl_context, &major, &minor);
+  if (major >= 3)
+    return min_filter;
+
+  return GL_LINEAR;
+}
+
+/* Once a texture has mipmaps, they are kept. Using them for
+ * linear minification gives the same or better results.
+ */
+static gboolean
+texture_filters_match (const Texture *t,
+                       int            min_filter,
+                       int            mag_filter)
+{
+  if (t->mag_filter != mag_filter)
+    return FALSE;
+
+  return t->min_filter == min_filter ||
+         (min_filter == GL_LINEAR && t->min_filter == GL_LINEAR_MIPMAP_LINEAR);
+}
+
 static void
 gsk_gl_driver_finalize (GObject *gobject)
 {
@@ -121,6 +212,7 @@ gsk_gl_driver_finalize (GObject *gobject)
 
   g_clear_pointer (&self->textures, g_hash_table_unref);
   g_clear_pointer (&self->pointer_textures, g_hash_table_unref);
+  g_clear_pointer (&self->render_target_pool, g_ptr_array_unref);
   g_clear_object (&self->profiler);
 
   if (self->gl_context == gdk_gl_context_get_current ())
@@ -141,6 +233,7 @@ static void
 gsk_gl_driver_init (GskGLDriver *self)
 {
   self->textures = g_hash_table_new_full (NULL, NULL, NULL, texture_free);
+  self->render_target_pool = g_ptr_array_new_with_free_func (texture_free);
 
   self->max_texture_size = -1;
 
@@ -158,6 +251,14 @@ gsk_gl_driver_init (GskGLDriver *self)
                                                              "surface_uploads",
                                                              "Texture uploads from surfaces this frame",
                                                              TRUE);
+  self->counters.created_render_targets = gsk_profiler_add_counter (self->profiler,
+                                                                    "created_render_targets",
+                                                                    "Render targets created this frame",
+                                                                    TRUE);
+  self->counters.reused_render_targets = gsk_profiler_add_counter (self->profiler,
+                                                                   "reused_render_targets",
+                                                                   "Render targets reused from the pool this frame",
+                                                                   TRUE);
 #endif
 }
 
@@ -176,6 +277,8 @@ gsk_gl_driver_new (GdkGLContext *context)
 void
 gsk_gl_driver_begin_frame (GskGLDriver *self)
 {
+  guint i;
+
   g_return_if_fail (GSK_IS_GL_DRIVER (self));
   g_return_if_fail (!self->in_frame);
 
@@ -200,6 +303,17 @@ gsk_gl_driver_begin_frame (GskGLDriver *self)
 
   glActiveTexture (GL_TEXTURE0);
 
+  self->upload_budget = UPLOAD_BYTES_PER_FRAME;
+
+  gsk_gl_driver_trim_render_target_pool (self, RENDER_TARGET_MAX_UNUSED_FRAMES);
+
+  for (i = 0; i < self->render_target_pool->len; i++)
+    {
+      Texture *t = g_ptr_array_index (self->render_target_pool, i);
+
+      t->unused_frames ++;
+    }
+
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_reset (self->profiler);
 #endif
@@ -225,15 +339,20 @@ gsk_gl_driver_end_frame (GskGLDriver *self)
   GSK_NOTE (OPENGL,
             g_message ("Textures created: %" G_GINT64_FORMAT "\n"
                      " Textures reused: %" G_GINT64_FORMAT "\n"
-                     " Surface uploads: %" G_GINT64_FORMAT,
+                     " Surface uploads: %" G_GINT64_FORMAT "\n"
+                     " Render targets created: %" G_GINT64_FORMAT "\n"
+                     " Render targets reused: %" G_GINT64_FORMAT,
                      gsk_profiler_counter_get (self->profiler, self->counters.created_textures),
                      gsk_profiler_counter_get (self->profiler, self->counters.reused_textures),
-                     gsk_profiler_counter_get (self->profiler, self->counters.surface_uploads)));
+                     gsk_profiler_counter_get (self->profiler, self->counters.surface_uploads),
+                     gsk_profiler_counter_get (self->profiler, self->counters.created_render_targets),
+                     gsk_profiler_counter_get (self->profiler, self->counters.reused_render_targets)));
 #endif
 
   GSK_NOTE (OPENGL,
-            g_message ("*** Frame end: textures=%d",
-                     g_hash_table_size (self->textures)));
+            g_message ("*** Frame end: textures=%d, pooled render targets=%u",
+                     g_hash_table_size (self->textures),
+                     self->render_target_pool->len));
 
   self->in_frame = FALSE;
 }
@@ -258,7 +377,15 @@ gsk_gl_driver_collect_textures (GskGLDriver *self)
       if (t->user || t->permanent)
         continue;
 
-      if (t->in_use)
+      if (t->in_use && t->render_target &&
+          self->render_target_pool->len < MAX_POOLED_RENDER_TARGETS)
+        {
+          t->in_use = FALSE;
+          t->unused_frames = 0;
+          g_hash_table_iter_steal (&iter);
+          g_ptr_array_add (self->render_target_pool, t);
+        }
+      else if (t->in_use)
         {
           t->in_use = FALSE;
 
@@ -296,6 +423,65 @@ gsk_gl_driver_collect_textures (GskGLDriver *self)
   return old_size - g_hash_table_size (self->textures);
 }
 
+/* Deletes the pooled render targets that have not been reused
+ * in the last @max_unused_frames frames.
+ */
+guint
+gsk_gl_driver_trim_render_target_pool (GskGLDriver *self,
+                                       int          max_unused_frames)
+{
+  guint dropped = 0;
+  guint i;
+
+  g_return_val_if_fail (GSK_IS_GL_DRIVER (self), 0);
+
+  for (i = self->render_target_pool->len; i > 0; i--)
+    {
+      Texture *t = g_ptr_array_index (self->render_target_pool, i - 1);
+
+      if (t->unused_frames > max_unused_frames)
+        {
+          g_ptr_array_remove_index_fast (self->render_target_pool, i - 1);
+          dropped ++;
+        }
+    }
+
+  GSK_NOTE (OPENGL, if (dropped > 0) g_message ("Dropped %u pooled render targets", dropped));
+
+  return dropped;
+}
+
+/* Returns an estimate of the video memory used by the textures
+ * owned by the driver, assuming 4 bytes per pixel.
+ */
+gsize
+gsk_gl_driver_get_texture_memory (GskGLDriver *self)
+{
+  GHashTableIter iter;
+  gpointer value_p = NULL;
+  gsize size = 0;
+  guint i;
+
+  g_return_val_if_fail (GSK_IS_GL_DRIVER (self), 0);
+
+  g_hash_table_iter_init (&iter, self->textures);
+  while (g_hash_table_iter_next (&iter, NULL, &value_p))
+    {
+      const Texture *t = value_p;
+
+      size += (gsize) t->width * t->height * 4;
+    }
+
+  for (i = 0; i < self->render_target_pool->len; i++)
+    {
+      const Texture *t = g_ptr_array_index (self->render_target_pool, i);
+
+      size += (gsize) t->width * t->height * 4;
+    }
+
+  return size;
+}
+
 
 GdkGLContext *
 gsk_gl_driver_get_gl_context (GskGLDriver *self)
@@ -479,6 +665,147 @@ gsk_gl_driver_slice_texture (GskGLDriver   *self,
   *out_n_slices = cols * rows;
 }
 
+/* Imports the dma-buf as the storage of @t, which must be bound.
+ * No pixels are copied, so this needs to happen again only when
+ * the filters change.
+ */
+static gboolean
+gsk_gl_driver_import_dmabuf (GskGLDriver      *self,
+                             Texture          *t,
+                             GdkDmabufTexture *texture,
+                             int               min_filter,
+                             int               mag_filter)
+{
+  if (!gdk_gl_context_import_dmabuf (self->gl_context, texture))
+    return FALSE;
+
+  gsk_gl_driver_set_texture_parameters (self, min_filter, mag_filter);
+
+  t->min_filter = min_filter;
+  t->mag_filter = mag_filter;
+
+  return TRUE;
+}
+
+static gboolean
+gsk_gl_driver_can_stream (GskGLDriver *self,
+                          GdkTexture  *texture)
+{
+  int major, minor;
+
+  if (GDK_IS_GL_TEXTURE (texture) || GDK_IS_DMABUF_TEXTURE (texture))
+    return FALSE;
+
+  if ((gsize) gdk_texture_get_width (texture) * gdk_texture_get_height (texture) * 4 < STREAMING_MIN_BYTES)
+    return FALSE;
+
+  /* We need pixel buffer objects, fences and BGRA uploads */
+  if (gdk_gl_context_get_use_es (self->gl_context))
+    return FALSE;
+
+  gdk_gl_context_get_version (self->gl_context, &major, &minor);
+
+  return major > 3 || (major == 3 && minor >= 2);
+}
+
+/* Copies the next band of rows of @texture into the pixel buffer and
+ * from there into @t, as far as this frame's budget allows.
+ */
+static void
+gsk_gl_driver_stream_rows (GskGLDriver *self,
+                           Texture     *t,
+                           GdkTexture  *texture)
+{
+  Upload *upload = t->upload;
+  gsize stride = t->width * 4;
+  int rows;
+  guchar *data;
+
+  rows = MIN (self->upload_budget / stride, t->height - upload->uploaded_rows);
+  if (rows <= 0)
+    return;
+
+  glBindBuffer (GL_PIXEL_UNPACK_BUFFER, upload->pbo_id);
+
+  /* Each band is written only once, so there is nothing to synchronize */
+  data = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER,
+                           upload->uploaded_rows * stride,
+                           rows * stride,
+                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  if (data == NULL)
+    {
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+      return;
+    }
+
+  gdk_texture_download_area (texture,
+                             &(GdkRectangle) { 0, upload->uploaded_rows, t->width, rows },
+                             data,
+                             stride);
+  glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+
+  gsk_gl_driver_bind_source_texture (self, t->texture_id);
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D (GL_TEXTURE_2D, 0,
+                   0, upload->uploaded_rows, t->width, rows,
+                   GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                   GSIZE_TO_POINTER (upload->uploaded_rows * stride));
+
+  glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+
+  upload->uploaded_rows += rows;
+  self->upload_budget -= rows * stride;
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_inc (self->profiler, self->counters.surface_uploads);
+#endif
+
+  if (upload->uploaded_rows == t->height)
+    {
+      if (filter_uses_mipmaps (t->min_filter))
+        {
+          glGenerateMipmap (GL_TEXTURE_2D);
+          glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, t->min_filter);
+        }
+
+      /* The buffer can go once the GPU has copied out of it */
+      upload->fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+static cairo_user_data_key_t texture_key;
+
+/* Memory textures in the format GL uploads from, like ones mapped
+ * from a file, don't need to be copied before uploading them.
+ */
+static cairo_surface_t *
+download_texture_for_upload (GdkTexture *texture)
+{
+  GdkMemoryTexture *memory_texture;
+  cairo_surface_t *surface;
+  gsize stride;
+
+  if (!GDK_IS_MEMORY_TEXTURE (texture))
+    return gdk_texture_download_surface (texture);
+
+  memory_texture = GDK_MEMORY_TEXTURE (texture);
+  stride = gdk_memory_texture_get_stride (memory_texture);
+
+  if (gdk_memory_texture_get_format (memory_texture) != GDK_MEMORY_CAIRO_FORMAT_ARGB32 ||
+      stride % 4 != 0 || stride > G_MAXINT)
+    return gdk_texture_download_surface (texture);
+
+  /* The data is only read from, so it's fine if it is read-only */
+  surface = cairo_image_surface_create_for_data ((guchar *) gdk_memory_texture_get_data (memory_texture),
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 gdk_texture_get_width (texture),
+                                                 gdk_texture_get_height (texture),
+                                                 stride);
+  cairo_surface_set_user_data (surface, &texture_key, g_object_ref (texture), g_object_unref);
+
+  return surface;
+}
+
 int
 gsk_gl_driver_get_texture_for_texture (GskGLDriver *self,
                                        GdkTexture  *texture,
@@ -488,11 +815,71 @@ gsk_gl_driver_get_texture_for_texture (GskGLDriver *self,
   Texture *t;
   cairo_surface_t *surface;
 
+  if (GDK_IS_DMABUF_TEXTURE (texture))
+    {
+      /* Mipmaps can't be generated for the imported buffer */
+      if (filter_uses_mipmaps (min_filter))
+        min_filter = GL_LINEAR;
+
+      t = gdk_texture_get_render_data (texture, self);
+
+      if (t)
+        {
+          if (t->min_filter != min_filter || t->mag_filter != mag_filter)
+            {
+              gsk_gl_driver_bind_source_texture (self, t->texture_id);
+              gsk_gl_driver_set_texture_parameters (self, min_filter, mag_filter);
+              t->min_filter = min_filter;
+              t->mag_filter = mag_filter;
+            }
+
+          return t->texture_id;
+        }
+
+      t = create_texture (self, gdk_texture_get_width (texture), gdk_texture_get_height (texture));
+
+      if (gdk_texture_set_render_data (texture, self, t, gsk_gl_driver_release_texture))
+        t->user = texture;
+
+      gsk_gl_driver_bind_source_texture (self, t->texture_id);
+      if (gsk_gl_driver_import_dmabuf (self, t, (GdkDmabufTexture *) texture, min_filter, mag_filter))
+        {
+          gdk_gl_context_label_object_printf (self->gl_context, GL_TEXTURE, t->texture_id,
+                                              "GdkTexture<%p> %d (dma-buf)", texture, t->texture_id);
+          return t->texture_id;
+        }
+
+      /* The context can't import it, so it has to go through memory */
+      surface = gdk_texture_download_surface (texture);
+      gsk_gl_driver_init_texture_with_surface (self,
+                                               t->texture_id,
+                                               surface,
+                                               min_filter,
+                                               mag_filter);
+      gdk_gl_context_label_object_printf (self->gl_context, GL_TEXTURE, t->texture_id,
+                                          "GdkTexture<%p> %d", texture, t->texture_id);
+      cairo_surface_destroy (surface);
+
+      return t->texture_id;
+    }
+
   if (GDK_IS_GL_TEXTURE (texture))
     {
       GdkGLContext *texture_context = gdk_gl_texture_get_context ((GdkGLTexture *)texture);
 
-      if (texture_context != self->gl_context)
+      if (texture_context != NULL &&
+          gdk_gl_context_is_shared (texture_context, self->gl_context))
+        {
+          /* The texture may come from a context in another thread, and
+           * its contents are only there once the fence is signaled. */
+          GLsync sync = gdk_gl_texture_get_sync ((GdkGLTexture *)texture);
+
+          if (sync)
+            glWaitSync (sync, 0, GL_TIMEOUT_IGNORED);
+
+          return gdk_gl_texture_get_id ((GdkGLTexture *)texture);
+        }
+      else
         {
           /* In this case, we have to temporarily make the texture's context the current one,
            * download its data into our context and then create a texture from it. */
@@ -503,25 +890,44 @@ gsk_gl_driver_get_texture_for_texture (GskGLDriver *self,
 
           gdk_gl_context_make_current (self->gl_context);
         }
-      else
-        {
-          /* A GL texture from the same GL context is a simple task... */
-          return gdk_gl_texture_get_id ((GdkGLTexture *)texture);
-        }
     }
   else
     {
       t = gdk_texture_get_render_data (texture, self);
 
-      if (t)
+      if (t && t->texture_id != 0)
         {
-          if (t->min_filter == min_filter && t->mag_filter == mag_filter)
+          /* Callers of this function need all of the texture now */
+          if (t->upload && t->upload->uploaded_rows < t->height)
+            {
+              gsize budget = self->upload_budget;
+
+              self->upload_budget = G_MAXSIZE;
+              gsk_gl_driver_stream_rows (self, t, texture);
+              self->upload_budget = budget;
+            }
+
+          min_filter = gsk_gl_driver_check_min_filter (self, min_filter);
+
+          if (texture_filters_match (t, min_filter, mag_filter))
             return t->texture_id;
+
+          /* The contents are already there, only the sampling changes */
+          gsk_gl_driver_bind_source_texture (self, t->texture_id);
+          gsk_gl_driver_set_texture_parameters (self, min_filter, mag_filter);
+          if (filter_uses_mipmaps (min_filter) && !filter_uses_mipmaps (t->min_filter))
+            glGenerateMipmap (GL_TEXTURE_2D);
+          t->min_filter = min_filter;
+          t->mag_filter = mag_filter;
+
+          return t->texture_id;
         }
 
-      surface = gdk_texture_download_surface (texture);
+      surface = download_texture_for_upload (texture);
     }
 
+  min_filter = gsk_gl_driver_check_min_filter (self, min_filter);
+
   t = create_texture (self, gdk_texture_get_width (texture), gdk_texture_get_height (texture));
 
   if (gdk_texture_set_render_data (texture, self, t, gsk_gl_driver_release_texture))
@@ -541,6 +947,98 @@ gsk_gl_driver_get_texture_for_texture (GskGLDriver *self,
   return t->texture_id;
 }
 
+/*
+ * gsk_gl_driver_stream_texture:
+ * @self: a #GskGLDriver
+ * @texture: the texture to upload
+ * @min_filter: minification filter
+ * @mag_filter: magnification filter
+ * @out_uploaded_rows: (out): how many rows of the texture, starting
+ *   from the top, have been uploaded
+ *
+ * Like gsk_gl_driver_get_texture_for_texture(), but large textures
+ * are uploaded over several frames, keeping within a per-frame budget.
+ * Until *@out_uploaded_rows reaches the height of @texture, only
+ * that many rows of the returned texture have valid contents, and
+ * the caller should draw another frame.
+ *
+ * Returns: the id of the GL texture
+ */
+int
+gsk_gl_driver_stream_texture (GskGLDriver *self,
+                              GdkTexture  *texture,
+                              int          min_filter,
+                              int          mag_filter,
+                              int         *out_uploaded_rows)
+{
+  Texture *t;
+
+  if (!gsk_gl_driver_can_stream (self, texture))
+    {
+      *out_uploaded_rows = gdk_texture_get_height (texture);
+      return gsk_gl_driver_get_texture_for_texture (self, texture, min_filter, mag_filter);
+    }
+
+  min_filter = gsk_gl_driver_check_min_filter (self, min_filter);
+
+  t = gdk_texture_get_render_data (texture, self);
+
+  if (t == NULL)
+    {
+      t = create_texture (self, gdk_texture_get_width (texture), gdk_texture_get_height (texture));
+
+      if (gdk_texture_set_render_data (texture, self, t, gsk_gl_driver_release_texture))
+        t->user = texture;
+
+      /* Without all its mipmaps, the texture can't be sampled with a
+       * mipmap filter. They are generated when the upload is done.
+       */
+      gsk_gl_driver_bind_source_texture (self, t->texture_id);
+      gsk_gl_driver_set_texture_parameters (self,
+                                            filter_uses_mipmaps (min_filter) ? GL_LINEAR : min_filter,
+                                            mag_filter);
+      t->min_filter = min_filter;
+      t->mag_filter = mag_filter;
+      glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, t->width, t->height, 0,
+                    GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL);
+      gdk_gl_context_label_object_printf (self->gl_context, GL_TEXTURE, t->texture_id,
+                                          "GdkTexture<%p> %d (streamed)", texture, t->texture_id);
+
+      t->upload = g_slice_new0 (Upload);
+      glGenBuffers (1, &t->upload->pbo_id);
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, t->upload->pbo_id);
+      glBufferData (GL_PIXEL_UNPACK_BUFFER, (gsize) t->width * 4 * t->height, NULL, GL_STREAM_DRAW);
+      glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+  else if (!texture_filters_match (t, min_filter, mag_filter))
+    {
+      gboolean complete = t->upload == NULL || t->upload->uploaded_rows == t->height;
+
+      gsk_gl_driver_bind_source_texture (self, t->texture_id);
+      gsk_gl_driver_set_texture_parameters (self,
+                                            complete || !filter_uses_mipmaps (min_filter) ? min_filter : GL_LINEAR,
+                                            mag_filter);
+      if (filter_uses_mipmaps (min_filter) && !filter_uses_mipmaps (t->min_filter) && complete)
+        glGenerateMipmap (GL_TEXTURE_2D);
+      t->min_filter = min_filter;
+      t->mag_filter = mag_filter;
+    }
+
+  if (t->upload)
+    {
+      if (t->upload->uploaded_rows < t->height)
+        gsk_gl_driver_stream_rows (self, t, texture);
+
+      if (t->upload->fence &&
+          glClientWaitSync (t->upload->fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+        g_clear_pointer (&t->upload, upload_free);
+    }
+
+  *out_uploaded_rows = t->upload ? t->upload->uploaded_rows : t->height;
+
+  return t->texture_id;
+}
+
 static guint
 texture_key_hash (gconstpointer v)
 {
@@ -627,10 +1125,37 @@ gsk_gl_driver_create_render_target (GskGLDriver *self,
 {
   GLuint fbo_id;
   Texture *texture;
+  guint i;
 
   g_return_if_fail (self->in_frame);
 
+  width = MIN (width, self->max_texture_size);
+  height = MIN (height, self->max_texture_size);
+
+  for (i = 0; i < self->render_target_pool->len; i++)
+    {
+      texture = g_ptr_array_index (self->render_target_pool, i);
+
+      if (texture->width == width &&
+          texture->height == height &&
+          texture->min_filter == min_filter &&
+          texture->mag_filter == mag_filter)
+        {
+          g_ptr_array_steal_index_fast (self->render_target_pool, i);
+          texture->in_use = TRUE;
+          g_hash_table_insert (self->textures, GINT_TO_POINTER (texture->texture_id), texture);
+#ifdef G_ENABLE_DEBUG
+          gsk_profiler_counter_inc (self->profiler, self->counters.reused_render_targets);
+#endif
+
+          *out_texture_id = texture->texture_id;
+          *out_render_target_id = texture->fbo.fbo_id;
+          return;
+        }
+    }
+
   texture = create_texture (self, width, height);
+  texture->render_target = TRUE;
   gsk_gl_driver_bind_source_texture (self, texture->texture_id);
   gsk_gl_driver_init_texture_empty (self, texture->texture_id, min_filter, mag_filter);
 
@@ -674,6 +1199,10 @@ gsk_gl_driver_create_render_target (GskGLDriver *self,
 
   glBindFramebuffer (GL_FRAMEBUFFER, self->default_fbo.fbo_id);
 
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_inc (self->profiler, self->counters.created_render_targets);
+#endif
+
   *out_texture_id = texture->texture_id;
   *out_render_target_id = fbo_id;
 }
@@ -762,12 +1291,6 @@ gsk_gl_driver_init_texture_empty (GskGLDriver *self,
   glBindTexture (GL_TEXTURE_2D, 0);
 }
 
-static gboolean
-filter_uses_mipmaps (int filter)
-{
-  return filter != GL_NEAREST && filter != GL_LINEAR;
-}
-
 void
 gsk_gl_driver_init_texture_with_surface (GskGLDriver     *self,
                                          int              texture_id,
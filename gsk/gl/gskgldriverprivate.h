@@ -39,6 +39,11 @@ int             gsk_gl_driver_get_texture_for_texture   (GskGLDriver     *driver
                                                          GdkTexture      *texture,
                                                          int              min_filter,
                                                          int              mag_filter);
+int             gsk_gl_driver_stream_texture            (GskGLDriver     *driver,
+                                                         GdkTexture      *texture,
+                                                         int              min_filter,
+                                                         int              mag_filter,
+                                                         int             *out_uploaded_rows);
 int             gsk_gl_driver_get_texture_for_key       (GskGLDriver     *driver,
                                                          GskTextureKey   *key);
 void            gsk_gl_driver_set_texture_for_key       (GskGLDriver     *driver,
@@ -73,6 +78,9 @@ void            gsk_gl_driver_destroy_texture           (GskGLDriver     *driver
                                                          int              texture_id);
 
 int             gsk_gl_driver_collect_textures          (GskGLDriver     *driver);
+guint           gsk_gl_driver_trim_render_target_pool   (GskGLDriver     *driver,
+                                                         int              max_unused_frames);
+gsize           gsk_gl_driver_get_texture_memory        (GskGLDriver     *driver);
 void            gsk_gl_driver_slice_texture             (GskGLDriver     *self,
                                                          GdkTexture      *texture,
                                                          TextureSlice   **out_slices,
@@ -28,8 +28,31 @@
  * own texture, but they are still cached.
  */
 
+/* Rasterization
+ *
+ * The space for new glyphs is allocated right away, but the
+ * rasterization with cairo is handed to a thread pool. The
+ * renderer keeps building ops in the meantime and calls
+ * gsk_gl_glyph_cache_flush() before it submits the frame,
+ * which waits for the pending glyphs and uploads them.
+ *
+ * Glyphs that pango has to draw itself (hex boxes for unknown
+ * glyphs) are always rendered on the main thread.
+ */
+
 #define MAX_FRAME_AGE (60)
 #define MAX_GLYPH_SIZE 128 /* Will get its own texture if bigger */
+#define MAX_RENDER_THREADS 4
+
+typedef struct
+{
+  GlyphCacheKey *key;
+  GskGLCachedGlyph *value;
+  cairo_scaled_font_t *scaled_font;
+
+  GskImageRegion region;
+  gboolean success;
+} RenderJob;
 
 static guint    glyph_cache_hash       (gconstpointer v);
 static gboolean glyph_cache_equal      (gconstpointer v1,
@@ -71,6 +94,12 @@ gsk_gl_glyph_cache_unref (GskGLGlyphCache *self)
 
   if (self->ref_count == 1)
     {
+      gsk_gl_glyph_cache_flush (self);
+      if (self->render_pool)
+        {
+          g_thread_pool_free (self->render_pool, FALSE, TRUE);
+          g_async_queue_unref (self->finished_jobs);
+        }
       gsk_gl_texture_atlases_unref (self->atlases);
       g_hash_table_unref (self->hash_table);
       g_free (self);
@@ -109,6 +138,85 @@ glyph_cache_value_free (gpointer v)
   g_free (v);
 }
 
+static cairo_surface_t *
+create_glyph_surface (const GlyphCacheKey    *key,
+                      const GskGLCachedGlyph *value,
+                      unsigned char         **data_out)
+{
+  cairo_surface_t *surface;
+  int surface_width, surface_height;
+  int stride;
+
+  surface_width = value->draw_width * key->data.scale / 1024;
+  surface_height = value->draw_height * key->data.scale / 1024;
+
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, surface_width);
+  *data_out = g_malloc0 (stride * surface_height);
+  surface = cairo_image_surface_create_for_data (*data_out, CAIRO_FORMAT_ARGB32,
+                                                 surface_width, surface_height,
+                                                 stride);
+  cairo_surface_set_device_scale (surface, key->data.scale / 1024.0, key->data.scale / 1024.0);
+
+  return surface;
+}
+
+static void
+finish_glyph_surface (cairo_surface_t        *surface,
+                      unsigned char          *data,
+                      const GskGLCachedGlyph *value,
+                      GskImageRegion         *region)
+{
+  cairo_surface_flush (surface);
+
+  region->width = cairo_image_surface_get_width (surface);
+  region->height = cairo_image_surface_get_height (surface);
+  region->stride = cairo_image_surface_get_stride (surface);
+  region->data = data;
+  if (value->atlas)
+    {
+      region->x = (gsize)(value->tx * value->atlas->width);
+      region->y = (gsize)(value->ty * value->atlas->height);
+    }
+  else
+    {
+      region->x = 0;
+      region->y = 0;
+    }
+
+  cairo_surface_destroy (surface);
+}
+
+/* Only uses cairo, so this is safe to call from the render threads */
+static void
+render_glyph_threaded (gpointer data,
+                       gpointer user_data)
+{
+  RenderJob *job = data;
+  GskGLGlyphCache *self = user_data;
+  cairo_surface_t *surface;
+  unsigned char *surface_data;
+  cairo_t *cr;
+
+  surface = create_glyph_surface (job->key, job->value, &surface_data);
+  cr = cairo_create (surface);
+
+  cairo_set_scaled_font (cr, job->scaled_font);
+  cairo_set_source_rgba (cr, 1, 1, 1, 1);
+  cairo_show_glyphs (cr,
+                     &(cairo_glyph_t) {
+                       job->key->data.glyph,
+                       - job->value->draw_x,
+                       - job->value->draw_y
+                     },
+                     1);
+  cairo_destroy (cr);
+
+  finish_glyph_surface (surface, surface_data, job->value, &job->region);
+  job->success = TRUE;
+
+  g_async_queue_push (self->finished_jobs, job);
+}
+
 static gboolean
 render_glyph (GlyphCacheKey    *key,
               GskGLCachedGlyph *value,
@@ -119,8 +227,6 @@ render_glyph (GlyphCacheKey    *key,
   cairo_scaled_font_t *scaled_font;
   PangoGlyphString glyph_string;
   PangoGlyphInfo glyph_info;
-  int surface_width, surface_height;
-  int stride;
   unsigned char *data;
 
   scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)key->data.font);
@@ -130,16 +236,7 @@ render_glyph (GlyphCacheKey    *key,
       return FALSE;
     }
 
-  surface_width = value->draw_width * key->data.scale / 1024;
-  surface_height = value->draw_height * key->data.scale / 1024;
-
-  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, surface_width);
-  data = g_malloc0 (stride * surface_height);
-  surface = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
-                                                 surface_width, surface_height,
-                                                 stride);
-  cairo_surface_set_device_scale (surface, key->data.scale / 1024.0, key->data.scale / 1024.0);
-
+  surface = create_glyph_surface (key, value, &data);
   cr = cairo_create (surface);
 
   cairo_set_scaled_font (cr, scaled_font);
@@ -159,56 +256,102 @@ render_glyph (GlyphCacheKey    *key,
   pango_cairo_show_glyph_string (cr, key->data.font, &glyph_string);
   cairo_destroy (cr);
 
-  cairo_surface_flush (surface);
-
-  region->width = cairo_image_surface_get_width (surface);
-  region->height = cairo_image_surface_get_height (surface);
-  region->stride = cairo_image_surface_get_stride (surface);
-  region->data = data;
-  if (value->atlas)
-    {
-      region->x = (gsize)(value->tx * value->atlas->width);
-      region->y = (gsize)(value->ty * value->atlas->height);
-    }
-  else
-    {
-      region->x = 0;
-      region->y = 0;
-    }
-
-  cairo_surface_destroy (surface);
+  finish_glyph_surface (surface, data, value, region);
 
   return TRUE;
 }
 
 static void
-upload_glyph (GlyphCacheKey    *key,
-              GskGLCachedGlyph *value)
+upload_glyph_region (GlyphCacheKey        *key,
+                     GskGLCachedGlyph     *value,
+                     const GskImageRegion *region)
 {
-  GskImageRegion r;
+  const GskImageRegion r = *region;
 
   gdk_gl_context_push_debug_group_printf (gdk_gl_context_get_current (),
                                           "Uploading glyph %d",
                                           key->data.glyph);
 
-  if (render_glyph (key, value, &r))
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, r.stride / 4);
+  glBindTexture (GL_TEXTURE_2D, value->texture_id);
+
+  if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
+    glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
+                     GL_RGBA, GL_UNSIGNED_BYTE,
+                     r.data);
+  else
+    glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
+                     GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                     r.data);
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+  g_free (r.data);
+
+  gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+}
+
+static void
+queue_glyph (GskGLGlyphCache  *self,
+             GlyphCacheKey    *key,
+             GskGLCachedGlyph *value)
+{
+  GskImageRegion r;
+  cairo_scaled_font_t *scaled_font;
+  RenderJob *job;
+
+  scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *)key->data.font);
+
+  if ((key->data.glyph & PANGO_GLYPH_UNKNOWN_FLAG) ||
+      G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
     {
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, r.stride / 4);
-      glBindTexture (GL_TEXTURE_2D, value->texture_id);
-
-      if (gdk_gl_context_get_use_es (gdk_gl_context_get_current ()))
-        glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
-                         GL_RGBA, GL_UNSIGNED_BYTE,
-                         r.data);
-      else
-        glTexSubImage2D (GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height,
-                         GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
-                         r.data);
-      glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
-      g_free (r.data);
+      if (render_glyph (key, value, &r))
+        upload_glyph_region (key, value, &r);
+      return;
     }
 
-  gdk_gl_context_pop_debug_group (gdk_gl_context_get_current ());
+  if (self->render_pool == NULL)
+    {
+      self->finished_jobs = g_async_queue_new ();
+      self->render_pool = g_thread_pool_new (render_glyph_threaded, self,
+                                             CLAMP (g_get_num_processors () - 1, 1, MAX_RENDER_THREADS),
+                                             FALSE, NULL);
+    }
+
+  job = g_slice_new0 (RenderJob);
+  job->key = key;
+  job->value = value;
+  job->scaled_font = cairo_scaled_font_reference (scaled_font);
+
+  self->n_pending_jobs++;
+  g_thread_pool_push (self->render_pool, job, NULL);
+}
+
+/**
+ * gsk_gl_glyph_cache_flush:
+ * @self: a #GskGLGlyphCache
+ *
+ * Waits for all glyphs that are still being rasterized and uploads
+ * them. This needs to be called with the GL context current, before
+ * any of the glyphs handed out since the last flush are drawn.
+ */
+void
+gsk_gl_glyph_cache_flush (GskGLGlyphCache *self)
+{
+  if (self->n_pending_jobs == 0)
+    return;
+
+  GSK_NOTE (GLYPH_CACHE, g_message ("Waiting for %u glyphs", self->n_pending_jobs));
+
+  while (self->n_pending_jobs > 0)
+    {
+      RenderJob *job = g_async_queue_pop (self->finished_jobs);
+
+      if (job->success)
+        upload_glyph_region (job->key, job->value, &job->region);
+
+      cairo_scaled_font_destroy (job->scaled_font);
+      g_slice_free (RenderJob, job);
+      self->n_pending_jobs--;
+    }
 }
 
 static void
@@ -252,7 +395,7 @@ add_to_cache (GskGLGlyphCache  *self,
       value->th = 1.0f;
     }
 
-  upload_glyph (key, value);
+  queue_glyph (self, key, value);
 }
 
 void
@@ -317,6 +460,36 @@ gsk_gl_glyph_cache_lookup_or_add (GskGLGlyphCache         *cache,
   }
 }
 
+static gboolean
+move_glyph (GskGLGlyphCache  *self,
+            GskGLCachedGlyph *value)
+{
+  GskGLTextureAtlas *from = value->atlas;
+  GskGLTextureAtlas *atlas;
+  int x, y, width, height;
+  int packed_x, packed_y;
+
+  /* Include the 1px border around the glyph */
+  x = (int) roundf (value->tx * from->width) - 1;
+  y = (int) roundf (value->ty * from->height) - 1;
+  width = (int) roundf (value->tw * from->width) + 2;
+  height = (int) roundf (value->th * from->height) + 2;
+
+  if (!gsk_gl_texture_atlases_move (self->atlases, from,
+                                    x, y, width, height,
+                                    &atlas, &packed_x, &packed_y))
+    return FALSE;
+
+  value->tx = (float)(packed_x + 1) / atlas->width;
+  value->ty = (float)(packed_y + 1) / atlas->height;
+  value->tw = (float)(width - 2) / atlas->width;
+  value->th = (float)(height - 2) / atlas->height;
+  value->atlas = atlas;
+  value->texture_id = atlas->texture_id;
+
+  return TRUE;
+}
+
 void
 gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
                                 GskGLDriver     *driver,
@@ -327,6 +500,9 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
   GskGLCachedGlyph *value;
   guint dropped = 0;
 
+  /* Pending jobs point into the hash table */
+  gsk_gl_glyph_cache_flush (self);
+
   self->timestamp++;
 
   if (removed_atlases->len > 0)
@@ -342,6 +518,28 @@ gsk_gl_glyph_cache_begin_frame (GskGLGlyphCache *self,
         }
     }
 
+  if (self->atlases->compacting->len > 0)
+    {
+      guint moved = 0;
+
+      g_hash_table_iter_init (&iter, self->hash_table);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value))
+        {
+          if (!gsk_gl_texture_atlases_is_compacting (self->atlases, value->atlas))
+            continue;
+
+          if (!value->used)
+            {
+              g_hash_table_iter_remove (&iter);
+              dropped++;
+            }
+          else if (move_glyph (self, value))
+            moved++;
+        }
+
+      GSK_NOTE(GLYPH_CACHE, if (moved > 0) g_message ("Moved %d glyphs", moved));
+    }
+
   if (self->timestamp % MAX_FRAME_AGE == 30)
     {
       g_hash_table_iter_init (&iter, self->hash_table);
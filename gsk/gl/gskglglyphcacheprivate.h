@@ -15,6 +15,10 @@ typedef struct
   GHashTable *hash_table;
   GskGLTextureAtlases *atlases;
 
+  GThreadPool *render_pool;
+  GAsyncQueue *finished_jobs;
+  guint n_pending_jobs;
+
   int timestamp;
 } GskGLGlyphCache;
 
@@ -88,5 +92,6 @@ void                     gsk_gl_glyph_cache_lookup_or_add   (GskGLGlyphCache
                                                              GlyphCacheKey          *lookup,
                                                              GskGLDriver            *driver,
                                                              const GskGLCachedGlyph **cached_glyph_out);
+void                     gsk_gl_glyph_cache_flush           (GskGLGlyphCache        *self);
 
 #endif
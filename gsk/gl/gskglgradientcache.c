@@ -0,0 +1,189 @@
+#include "config.h"
+
+#include "gskglgradientcacheprivate.h"
+
+#include <epoxy/gl.h>
+#include <string.h>
+#include <math.h>
+
+/* Gradients are rendered by looking up their color in a ramp, which
+ * has the color stops already interpolated. All ramps live in rows
+ * of a single texture, so gradients with the same stops share a
+ * ramp, there is no limit on the number of stops and the shaders
+ * don't need to be sent the stops every time.
+ *
+ * The first and last texel of a ramp are at offset 0 and 1. Like
+ * the shaders did before, we interpolate premultiplied colors.
+ */
+
+static guint
+stops_hash (const GskColorStop *stops,
+            gsize               n_stops)
+{
+  const guint32 *words = (const guint32 *) stops;
+  guint hash = n_stops;
+  gsize i;
+
+  for (i = 0; i < n_stops * sizeof (GskColorStop) / sizeof (guint32); i++)
+    hash = (hash << 5) + hash + words[i];
+
+  return hash;
+}
+
+static inline void
+premultiply (const GdkRGBA *color,
+             float          result[4])
+{
+  result[0] = color->red * color->alpha;
+  result[1] = color->green * color->alpha;
+  result[2] = color->blue * color->alpha;
+  result[3] = color->alpha;
+}
+
+static void
+fill_ramp (guchar             *data,
+           const GskColorStop *stops,
+           gsize               n_stops)
+{
+  int x, c;
+
+  for (x = 0; x < GSK_GL_GRADIENT_RAMP_WIDTH; x++)
+    {
+      const float offset = x / (float) (GSK_GL_GRADIENT_RAMP_WIDTH - 1);
+      gsize i, from = 0, to = 0;
+      float f = 0;
+      float c1[4], c2[4];
+
+      for (i = 1; i < n_stops; i++)
+        {
+          if (offset >= stops[i - 1].offset)
+            {
+              float range = stops[i].offset - stops[i - 1].offset;
+
+              from = i - 1;
+              to = i;
+              f = range > 0 ? CLAMP ((offset - stops[i - 1].offset) / range, 0, 1) : 1;
+            }
+        }
+
+      premultiply (&stops[from].color, c1);
+      premultiply (&stops[to].color, c2);
+
+      for (c = 0; c < 4; c++)
+        data[4 * x + c] = roundf ((c1[c] + (c2[c] - c1[c]) * f) * 255.f);
+    }
+}
+
+void
+gsk_gl_gradient_cache_init (GskGLGradientCache *self)
+{
+  memset (self, 0, sizeof (GskGLGradientCache));
+}
+
+void
+gsk_gl_gradient_cache_free (GskGLGradientCache *self,
+                            GskGLDriver        *gl_driver)
+{
+  guint i;
+
+  for (i = 0; i < GSK_GL_GRADIENT_N_RAMPS; i++)
+    g_clear_pointer (&self->ramps[i].stops, g_free);
+
+  if (self->texture_id != 0)
+    {
+      gsk_gl_driver_destroy_texture (gl_driver, self->texture_id);
+      self->texture_id = 0;
+    }
+}
+
+void
+gsk_gl_gradient_cache_begin_frame (GskGLGradientCache *self)
+{
+  guint i;
+
+  for (i = 0; i < GSK_GL_GRADIENT_N_RAMPS; i++)
+    {
+      if (self->ramps[i].stops != NULL)
+        self->ramps[i].unused_frames ++;
+    }
+}
+
+/* Returns FALSE if all ramps are in use by the current frame */
+gboolean
+gsk_gl_gradient_cache_lookup_or_add (GskGLGradientCache *self,
+                                     GskGLDriver        *gl_driver,
+                                     const GskColorStop *stops,
+                                     gsize               n_stops,
+                                     int                *out_texture_id,
+                                     float              *out_ramp_y)
+{
+  const guint hash = stops_hash (stops, n_stops);
+  GskGLGradientRamp *ramp = NULL;
+  guchar data[GSK_GL_GRADIENT_RAMP_WIDTH * 4];
+  guint i, index = 0;
+
+  for (i = 0; i < GSK_GL_GRADIENT_N_RAMPS; i++)
+    {
+      GskGLGradientRamp *r = &self->ramps[i];
+
+      if (r->stops != NULL &&
+          r->hash == hash &&
+          r->n_stops == n_stops &&
+          memcmp (r->stops, stops, n_stops * sizeof (GskColorStop)) == 0)
+        {
+          r->unused_frames = 0;
+          *out_texture_id = self->texture_id;
+          *out_ramp_y = (i + 0.5f) / GSK_GL_GRADIENT_N_RAMPS;
+          return TRUE;
+        }
+
+      /* Prefer free ramps, then the one unused for the longest time */
+      if (r->stops == NULL)
+        {
+          if (ramp == NULL || ramp->stops != NULL)
+            {
+              ramp = r;
+              index = i;
+            }
+        }
+      else if (r->unused_frames > 0 &&
+               (ramp == NULL || (ramp->stops != NULL && r->unused_frames > ramp->unused_frames)))
+        {
+          ramp = r;
+          index = i;
+        }
+    }
+
+  if (ramp == NULL)
+    return FALSE;
+
+  if (self->texture_id == 0)
+    {
+      self->texture_id = gsk_gl_driver_create_texture (gl_driver,
+                                                       GSK_GL_GRADIENT_RAMP_WIDTH,
+                                                       GSK_GL_GRADIENT_N_RAMPS);
+      gsk_gl_driver_mark_texture_permanent (gl_driver, self->texture_id);
+      gsk_gl_driver_bind_source_texture (gl_driver, self->texture_id);
+      gsk_gl_driver_init_texture_empty (gl_driver, self->texture_id, GL_LINEAR, GL_LINEAR);
+    }
+
+  g_free (ramp->stops);
+  ramp->stops = g_memdup (stops, n_stops * sizeof (GskColorStop));
+  ramp->n_stops = n_stops;
+  ramp->hash = hash;
+  ramp->unused_frames = 0;
+
+  fill_ramp (data, stops, n_stops);
+
+  gsk_gl_driver_bind_source_texture (gl_driver, self->texture_id);
+  glTexSubImage2D (GL_TEXTURE_2D, 0,
+                   0, index,
+                   GSK_GL_GRADIENT_RAMP_WIDTH, 1,
+                   GL_RGBA, GL_UNSIGNED_BYTE,
+                   data);
+
+  *out_texture_id = self->texture_id;
+  *out_ramp_y = (index + 0.5f) / GSK_GL_GRADIENT_N_RAMPS;
+
+  return TRUE;
+}
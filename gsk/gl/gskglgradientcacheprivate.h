@@ -0,0 +1,39 @@
+#ifndef __GSK_GL_GRADIENT_CACHE_H__
+#define __GSK_GL_GRADIENT_CACHE_H__
+
+#include <glib.h>
+#include "gskgldriverprivate.h"
+#include "gskrendernode.h"
+
+/* Keep in sync with RAMP_WIDTH in the gradient shaders */
+#define GSK_GL_GRADIENT_RAMP_WIDTH 1024
+#define GSK_GL_GRADIENT_N_RAMPS    128
+
+typedef struct
+{
+  guint hash;
+  GskColorStop *stops; /* NULL if the ramp is unused */
+  gsize n_stops;
+  int unused_frames;
+} GskGLGradientRamp;
+
+typedef struct
+{
+  int texture_id;
+  GskGLGradientRamp ramps[GSK_GL_GRADIENT_N_RAMPS];
+} GskGLGradientCache;
+
+
+void     gsk_gl_gradient_cache_init          (GskGLGradientCache *self);
+void     gsk_gl_gradient_cache_free          (GskGLGradientCache *self,
+                                              GskGLDriver        *gl_driver);
+void     gsk_gl_gradient_cache_begin_frame   (GskGLGradientCache *self);
+gboolean gsk_gl_gradient_cache_lookup_or_add (GskGLGradientCache *self,
+                                              GskGLDriver        *gl_driver,
+                                              const GskColorStop *stops,
+                                              gsize               n_stops,
+                                              int                *out_texture_id,
+                                              float              *out_ramp_y);
+
+
+#endif
@@ -4,6 +4,7 @@
 #include "gdk/gdkglcontextprivate.h"
 
 #include <epoxy/gl.h>
+#include <math.h>
 
 #define MAX_FRAME_AGE 60
 
@@ -54,6 +55,34 @@ gsk_gl_icon_cache_unref (GskGLIconCache *self)
   self->ref_count--;
 }
 
+static gboolean
+move_icon (GskGLIconCache *self,
+           IconData       *icon_data)
+{
+  GskGLTextureAtlas *from = icon_data->atlas;
+  const int width = icon_data->source_texture->width;
+  const int height = icon_data->source_texture->height;
+  GskGLTextureAtlas *atlas;
+  int packed_x, packed_y;
+
+  /* Include the 1px border around the icon */
+  if (!gsk_gl_texture_atlases_move (self->atlases, from,
+                                    (int) roundf (icon_data->x * from->width) - 1,
+                                    (int) roundf (icon_data->y * from->height) - 1,
+                                    width + 2, height + 2,
+                                    &atlas, &packed_x, &packed_y))
+    return FALSE;
+
+  icon_data->atlas = atlas;
+  icon_data->texture_id = atlas->texture_id;
+  icon_data->x = (float)(packed_x + 1) / atlas->width;
+  icon_data->y = (float)(packed_y + 1) / atlas->height;
+  icon_data->x2 = icon_data->x + (float)width / atlas->width;
+  icon_data->y2 = icon_data->y + (float)height / atlas->height;
+
+  return TRUE;
+}
+
 void
 gsk_gl_icon_cache_begin_frame (GskGLIconCache *self,
                                GPtrArray      *removed_atlases)
@@ -82,6 +111,26 @@ gsk_gl_icon_cache_begin_frame (GskGLIconCache *self,
       GSK_NOTE(GLYPH_CACHE, if (dropped > 0) g_message ("Dropped %d icons", dropped));
     }
 
+  /* Move icons that are still in use off atlases that are being compacted */
+  if (self->atlases->compacting->len > 0)
+    {
+      guint moved = 0;
+
+      g_hash_table_iter_init (&iter, self->icons);
+      while (g_hash_table_iter_next (&iter, (gpointer *)&texture, (gpointer *)&icon_data))
+        {
+          if (!gsk_gl_texture_atlases_is_compacting (self->atlases, icon_data->atlas))
+            continue;
+
+          if (!icon_data->used)
+            g_hash_table_iter_remove (&iter);
+          else if (move_icon (self, icon_data))
+            moved++;
+        }
+
+      GSK_NOTE(GLYPH_CACHE, if (moved > 0) g_message ("Moved %d icons", moved));
+    }
+
   if (self->timestamp % MAX_FRAME_AGE == 0)
     {
       g_hash_table_iter_init (&iter, self->icons);
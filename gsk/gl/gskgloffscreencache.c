@@ -0,0 +1,189 @@
+#include "config.h"
+
+#include "gskgloffscreencacheprivate.h"
+
+#include "gskdebugprivate.h"
+#include "gskrendernodeprivate.h"
+
+/* Offscreens are usually a lot bigger than shadows, so
+ * don't keep them around for as long */
+#define MAX_UNUSED_FRAMES 60
+
+/* Render nodes are immutable, so the same node rendered at the
+ * same scale with the same filter always results in the same
+ * texture. The modelview used for offscreens only ever contains
+ * the scale, so the rest of the transform doesn't matter.
+ * Blurred versions of a node are cached with their blur radius,
+ * plain offscreens use a radius of 0.
+ *
+ * We keep a reference on the node for as long as it is in the
+ * cache, so its address can't be reused by a different node.
+ */
+typedef struct
+{
+  GskRenderNode *node;
+  float scale;
+  int filter;
+  float blur_radius;
+} CacheKey;
+
+typedef struct
+{
+  CacheKey key;
+
+  int texture_id;
+  int unused_frames;
+} CacheItem;
+
+static guint
+key_hash (gconstpointer v)
+{
+  const CacheKey *k = v;
+
+  return GPOINTER_TO_UINT (k->node) ^
+         ((guint) (k->scale * 100) << 16) ^
+         ((guint) k->blur_radius << 8) ^
+         k->filter;
+}
+
+static gboolean
+key_equal (gconstpointer x,
+           gconstpointer y)
+{
+  const CacheKey *a = x;
+  const CacheKey *b = y;
+
+  return a->node == b->node &&
+         a->scale == b->scale &&
+         a->filter == b->filter &&
+         a->blur_radius == b->blur_radius;
+}
+
+static void
+cache_item_free (gpointer data)
+{
+  CacheItem *item = data;
+
+  gsk_render_node_unref (item->key.node);
+  g_slice_free (CacheItem, item);
+}
+
+void
+gsk_gl_offscreen_cache_init (GskGLOffscreenCache *self)
+{
+  self->textures = g_hash_table_new_full (key_hash, key_equal, NULL, cache_item_free);
+}
+
+void
+gsk_gl_offscreen_cache_free (GskGLOffscreenCache *self,
+                             GskGLDriver         *gl_driver)
+{
+  GHashTableIter iter;
+  CacheItem *item;
+
+  g_hash_table_iter_init (&iter, self->textures);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&item))
+    gsk_gl_driver_destroy_texture (gl_driver, item->texture_id);
+
+  g_clear_pointer (&self->textures, g_hash_table_unref);
+}
+
+void
+gsk_gl_offscreen_cache_begin_frame (GskGLOffscreenCache *self,
+                                    GskGLDriver         *gl_driver)
+{
+  GHashTableIter iter;
+  CacheItem *item;
+
+  gsk_gl_offscreen_cache_trim (self, gl_driver, MAX_UNUSED_FRAMES);
+
+  g_hash_table_iter_init (&iter, self->textures);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&item))
+    item->unused_frames ++;
+}
+
+/* Drops all offscreens that have not been used in the
+ * last @max_unused_frames frames.
+ */
+guint
+gsk_gl_offscreen_cache_trim (GskGLOffscreenCache *self,
+                             GskGLDriver         *gl_driver,
+                             int                  max_unused_frames)
+{
+  GHashTableIter iter;
+  CacheItem *item;
+  guint dropped = 0;
+
+  g_hash_table_iter_init (&iter, self->textures);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&item))
+    {
+      if (item->unused_frames > max_unused_frames)
+        {
+          gsk_gl_driver_destroy_texture (gl_driver, item->texture_id);
+          g_hash_table_iter_remove (&iter);
+          dropped ++;
+        }
+    }
+
+  GSK_NOTE (OPENGL, if (dropped > 0) g_message ("Dropped %u cached offscreens", dropped));
+
+  return dropped;
+}
+
+int
+gsk_gl_offscreen_cache_get_texture_id (GskGLOffscreenCache *self,
+                                       GskRenderNode       *node,
+                                       float                scale,
+                                       int                  filter,
+                                       float                blur_radius)
+{
+  CacheItem *item;
+
+  g_assert (self != NULL);
+  g_assert (node != NULL);
+
+  item = g_hash_table_lookup (self->textures,
+                              &(CacheKey) { node, scale, filter, blur_radius });
+
+  if (item == NULL)
+    return 0;
+
+  item->unused_frames = 0;
+
+  g_assert (item->texture_id != 0);
+
+  return item->texture_id;
+}
+
+void
+gsk_gl_offscreen_cache_commit (GskGLOffscreenCache *self,
+                               GskGLDriver         *gl_driver,
+                               GskRenderNode       *node,
+                               float                scale,
+                               int                  filter,
+                               float                blur_radius,
+                               int                  texture_id)
+{
+  CacheItem *item;
+
+  g_assert (self != NULL);
+  g_assert (node != NULL);
+  g_assert (texture_id > 0);
+
+  item = g_hash_table_lookup (self->textures,
+                              &(CacheKey) { node, scale, filter, blur_radius });
+  if (item != NULL && item->texture_id != texture_id)
+    gsk_gl_driver_destroy_texture (gl_driver, item->texture_id);
+
+  gsk_gl_driver_mark_texture_permanent (gl_driver, texture_id);
+
+  item = g_slice_new (CacheItem);
+  item->key.node = gsk_render_node_ref (node);
+  item->key.scale = scale;
+  item->key.filter = filter;
+  item->key.blur_radius = blur_radius;
+  item->texture_id = texture_id;
+  item->unused_frames = 0;
+
+  g_hash_table_replace (self->textures, &item->key, item);
+}
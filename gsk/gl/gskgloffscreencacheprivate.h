@@ -0,0 +1,36 @@
+#ifndef __GSK_GL_OFFSCREEN_CACHE_H__
+#define __GSK_GL_OFFSCREEN_CACHE_H__
+
+#include <glib.h>
+#include "gskgldriverprivate.h"
+#include "gskrendernode.h"
+
+typedef struct
+{
+  GHashTable *textures;
+} GskGLOffscreenCache;
+
+
+void gsk_gl_offscreen_cache_init           (GskGLOffscreenCache *self);
+void gsk_gl_offscreen_cache_free           (GskGLOffscreenCache *self,
+                                            GskGLDriver         *gl_driver);
+void gsk_gl_offscreen_cache_begin_frame    (GskGLOffscreenCache *self,
+                                            GskGLDriver         *gl_driver);
+guint gsk_gl_offscreen_cache_trim          (GskGLOffscreenCache *self,
+                                            GskGLDriver         *gl_driver,
+                                            int                  max_unused_frames);
+int  gsk_gl_offscreen_cache_get_texture_id (GskGLOffscreenCache *self,
+                                            GskRenderNode       *node,
+                                            float                scale,
+                                            int                  filter,
+                                            float                blur_radius);
+void gsk_gl_offscreen_cache_commit         (GskGLOffscreenCache *self,
+                                            GskGLDriver         *gl_driver,
+                                            GskRenderNode       *node,
+                                            float                scale,
+                                            int                  filter,
+                                            float                blur_radius,
+                                            int                  texture_id);
+
+
+#endif
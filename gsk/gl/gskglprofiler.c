@@ -3,9 +3,15 @@
 #include "gskglprofilerprivate.h"
 
 #include <epoxy/gl.h>
+#include <string.h>
 
 #define N_QUERIES       4
 
+typedef struct {
+  GLuint query;
+  int subregion;
+} Timestamp;
+
 struct _GskGLProfiler
 {
   GObject parent_instance;
@@ -18,6 +24,15 @@ struct _GskGLProfiler
   GLuint gl_queries[N_QUERIES];
   GLuint active_query;
 
+  /* Timestamps taken whenever the subregion changes, for each
+   * frame in flight, and the queries we can reuse for them
+   */
+  GArray *timestamps[N_QUERIES];
+  GArray *free_queries;
+
+  /* Per subregion times of the last frame with results, in nsec */
+  guint64 subregion_times[GSK_GL_PROFILER_MAX_SUBREGIONS];
+
   gboolean has_timer : 1;
   gboolean first_frame : 1;
 };
@@ -36,9 +51,21 @@ static void
 gsk_gl_profiler_finalize (GObject *gobject)
 {
   GskGLProfiler *self = GSK_GL_PROFILER (gobject);
+  guint i, j;
 
   glDeleteQueries (N_QUERIES, self->gl_queries);
 
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      for (j = 0; j < self->timestamps[i]->len; j++)
+        glDeleteQueries (1, &g_array_index (self->timestamps[i], Timestamp, j).query);
+      g_array_unref (self->timestamps[i]);
+    }
+
+  if (self->free_queries->len > 0)
+    glDeleteQueries (self->free_queries->len, (GLuint *) self->free_queries->data);
+  g_array_unref (self->free_queries);
+
   g_clear_object (&self->gl_context);
 
   G_OBJECT_CLASS (gsk_gl_profiler_parent_class)->finalize (gobject);
@@ -106,8 +133,14 @@ gsk_gl_profiler_class_init (GskGLProfilerClass *klass)
 static void
 gsk_gl_profiler_init (GskGLProfiler *self)
 {
+  guint i;
+
   glGenQueries (N_QUERIES, self->gl_queries);
 
+  for (i = 0; i < N_QUERIES; i++)
+    self->timestamps[i] = g_array_new (FALSE, FALSE, sizeof (Timestamp));
+  self->free_queries = g_array_new (FALSE, FALSE, sizeof (GLuint));
+
   self->first_frame = TRUE;
   self->has_timer = epoxy_gl_version () >= 33 || epoxy_has_gl_extension ("GL_ARB_timer_query");
 }
@@ -120,6 +153,52 @@ gsk_gl_profiler_new (GdkGLContext *context)
   return g_object_new (GSK_TYPE_GL_PROFILER, "gl-context", context, NULL);
 }
 
+static void
+gsk_gl_profiler_recycle_timestamps (GskGLProfiler *profiler,
+                                    GArray        *timestamps)
+{
+  guint i;
+
+  for (i = 0; i < timestamps->len; i++)
+    g_array_append_val (profiler->free_queries, g_array_index (timestamps, Timestamp, i).query);
+
+  g_array_set_size (timestamps, 0);
+}
+
+static void
+gsk_gl_profiler_collect_subregions (GskGLProfiler *profiler,
+                                    GArray        *timestamps)
+{
+  GLuint64 prev, next;
+  GLint res;
+  guint i;
+
+  memset (profiler->subregion_times, 0, sizeof (profiler->subregion_times));
+
+  if (timestamps->len < 2)
+    goto out;
+
+  /* All timestamps are done once the last one is */
+  glGetQueryObjectiv (g_array_index (timestamps, Timestamp, timestamps->len - 1).query,
+                      GL_QUERY_RESULT_AVAILABLE, &res);
+  if (res != 1)
+    goto out;
+
+  glGetQueryObjectui64v (g_array_index (timestamps, Timestamp, 0).query, GL_QUERY_RESULT, &prev);
+  for (i = 1; i < timestamps->len; i++)
+    {
+      const Timestamp *t = &g_array_index (timestamps, Timestamp, i - 1);
+
+      glGetQueryObjectui64v (g_array_index (timestamps, Timestamp, i).query, GL_QUERY_RESULT, &next);
+      if (t->subregion >= 0 && next > prev)
+        profiler->subregion_times[t->subregion] += next - prev;
+      prev = next;
+    }
+
+out:
+  gsk_gl_profiler_recycle_timestamps (profiler, timestamps);
+}
+
 void
 gsk_gl_profiler_begin_gpu_region (GskGLProfiler *profiler)
 {
@@ -130,6 +209,9 @@ gsk_gl_profiler_begin_gpu_region (GskGLProfiler *profiler)
   if (!profiler->has_timer)
     return;
 
+  /* Results for this frame slot that never became available */
+  gsk_gl_profiler_recycle_timestamps (profiler, profiler->timestamps[profiler->active_query]);
+
   query_id = profiler->gl_queries[profiler->active_query];
   glBeginQuery (GL_TIME_ELAPSED, query_id);
 }
@@ -153,6 +235,8 @@ gsk_gl_profiler_end_gpu_region (GskGLProfiler *profiler)
   else
     last_query_id = profiler->active_query - 1;
 
+  gsk_gl_profiler_collect_subregions (profiler, profiler->timestamps[last_query_id]);
+
   /* Advance iterator */
   profiler->active_query += 1;
   if (profiler->active_query == N_QUERIES)
@@ -173,3 +257,71 @@ gsk_gl_profiler_end_gpu_region (GskGLProfiler *profiler)
 
   return elapsed / 1000; /* Convert to usec to match other profiler APIs */
 }
+
+/*< private >
+ * gsk_gl_profiler_switch_subregion:
+ * @profiler: a #GskGLProfiler
+ * @subregion: the subregion that the following GL commands belong to,
+ *   or -1 to not account them to any subregion
+ *
+ * Splits the current GPU region into subregions, so that the time the
+ * GPU spends on each of them can be queried with
+ * gsk_gl_profiler_get_subregion_time().
+ *
+ * The times of all the parts of the frame that belong to the same
+ * subregion are added up.
+ */
+void
+gsk_gl_profiler_switch_subregion (GskGLProfiler *profiler,
+                                  int            subregion)
+{
+  GArray *timestamps;
+  Timestamp t;
+
+  g_return_if_fail (GSK_IS_GL_PROFILER (profiler));
+  g_return_if_fail (subregion < GSK_GL_PROFILER_MAX_SUBREGIONS);
+
+  if (!profiler->has_timer)
+    return;
+
+  timestamps = profiler->timestamps[profiler->active_query];
+
+  /* Nothing to measure if we're not in a subregion */
+  if (subregion < 0 &&
+      (timestamps->len == 0 ||
+       g_array_index (timestamps, Timestamp, timestamps->len - 1).subregion < 0))
+    return;
+
+  if (profiler->free_queries->len > 0)
+    {
+      t.query = g_array_index (profiler->free_queries, GLuint, profiler->free_queries->len - 1);
+      g_array_set_size (profiler->free_queries, profiler->free_queries->len - 1);
+    }
+  else
+    glGenQueries (1, &t.query);
+
+  t.subregion = subregion;
+  glQueryCounter (t.query, GL_TIMESTAMP);
+  g_array_append_val (timestamps, t);
+}
+
+/*< private >
+ * gsk_gl_profiler_get_subregion_time:
+ * @profiler: a #GskGLProfiler
+ * @subregion: a subregion
+ *
+ * Retrieves the GPU time spent in @subregion, for the same frame
+ * that the last call to gsk_gl_profiler_end_gpu_region() returned
+ * the time of.
+ *
+ * Returns: the time in usec, or 0 if it isn't known
+ */
+guint64
+gsk_gl_profiler_get_subregion_time (GskGLProfiler *profiler,
+                                    int            subregion)
+{
+  g_return_val_if_fail (GSK_IS_GL_PROFILER (profiler), 0);
+  g_return_val_if_fail (subregion >= 0 && subregion < GSK_GL_PROFILER_MAX_SUBREGIONS, 0);
+
+  return profiler->subregion_times[subregion] / 1000;
+}
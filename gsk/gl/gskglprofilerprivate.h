@@ -5,6 +5,8 @@
 
 G_BEGIN_DECLS
 
+#define GSK_GL_PROFILER_MAX_SUBREGIONS 16
+
 #define GSK_TYPE_GL_PROFILER (gsk_gl_profiler_get_type ())
 G_DECLARE_FINAL_TYPE (GskGLProfiler, gsk_gl_profiler, GSK, GL_PROFILER, GObject)
 
@@ -13,6 +15,11 @@ GskGLProfiler * gsk_gl_profiler_new                     (GdkGLContext  *context)
 void            gsk_gl_profiler_begin_gpu_region        (GskGLProfiler *profiler);
 guint64         gsk_gl_profiler_end_gpu_region          (GskGLProfiler *profiler);
 
+void            gsk_gl_profiler_switch_subregion        (GskGLProfiler *profiler,
+                                                         int            subregion);
+guint64         gsk_gl_profiler_get_subregion_time      (GskGLProfiler *profiler,
+                                                         int            subregion);
+
 G_END_DECLS
 
 #endif /* __GSK_GL_PROFILER_PRIVATE_H__ */
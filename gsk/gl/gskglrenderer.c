@@ -16,6 +16,8 @@
 #include "gskglrenderopsprivate.h"
 #include "gskcairoblurprivate.h"
 #include "gskglshadowcacheprivate.h"
+#include "gskgloffscreencacheprivate.h"
+#include "gskglgradientcacheprivate.h"
 #include "gskglnodesampleprivate.h"
 #include "gsktransform.h"
 #include "glutilsprivate.h"
@@ -26,6 +28,7 @@
 #include "gdk/gdkglcontextprivate.h"
 #include "gdk/gdkprofilerprivate.h"
 #include "gdk/gdkrgbaprivate.h"
+#include "gdk/gdksurfaceprivate.h"
 
 #include <epoxy/gl.h>
 
@@ -41,6 +44,21 @@
 
 #define SHADOW_EXTRA_SIZE  4
 
+#define MAX_FALLBACK_THREADS 4
+
+/* Containers with at least this many children may have the ops of
+ * some of their children built on other threads, in jobs of between
+ * MIN and MAX_THREADED_BUILD_NODES nodes */
+#define MIN_THREADED_BUILD_CHILDREN 16
+#define MIN_THREADED_BUILD_NODES    128
+#define MAX_THREADED_BUILD_NODES    1024
+#define MAX_BUILD_THREADS           4
+
+/* Blurs are done at up to 1/MAX_BLUR_DOWNSCALE of the size, as long
+ * as the radius stays at least MIN_DOWNSCALED_BLUR_RADIUS */
+#define MAX_BLUR_DOWNSCALE         8
+#define MIN_DOWNSCALED_BLUR_RADIUS 8
+
 #if DEBUG_OPS
 #define OP_PRINT(format, ...) g_print(format, ## __VA_ARGS__)
 #else
@@ -49,12 +67,12 @@
 
 #define INIT_PROGRAM_UNIFORM_LOCATION(program_name, uniform_basename) \
               G_STMT_START{\
-                programs->program_name ## _program.program_name.uniform_basename ## _location = \
-                              glGetUniformLocation(programs->program_name ## _program.id, "u_" #uniform_basename);\
-                if (programs->program_name ## _program.program_name.uniform_basename ## _location == -1) \
+                if (prog == &programs->program_name ## _program) \
                   { \
-                    g_clear_pointer (&programs, gsk_gl_renderer_programs_unref); \
-                    goto out; \
+                    prog->program_name.uniform_basename ## _location = \
+                                  glGetUniformLocation(prog->id, "u_" #uniform_basename);\
+                    if (prog->program_name.uniform_basename ## _location == -1) \
+                      goto error; \
                   } \
               }G_STMT_END
 
@@ -230,38 +248,6 @@ _graphene_rect_contains_rect (const graphene_rect_t *r1,
   return false;
 }
 
-static inline void
-sort_border_sides (const GdkRGBA *colors,
-                   int           *indices)
-{
-  gboolean done[4] = {0, 0, 0, 0};
-  int i, k;
-  int cur = 0;
-
-  for (i = 0; i < 3; i ++)
-    {
-      if (done[i])
-        continue;
-
-      indices[cur] = i;
-      done[i] = TRUE;
-      cur ++;
-
-      for (k = i + 1; k < 4; k ++)
-        {
-          if (gdk_rgba_equal (&colors[k], &colors[i]))
-            {
-              indices[cur] = k;
-              done[k] = TRUE;
-              cur ++;
-            }
-        }
-
-      if (cur >= 4)
-        break;
-    }
-}
-
 static inline gboolean G_GNUC_PURE
 color_matrix_modifies_alpha (GskRenderNode *node)
 {
@@ -456,11 +442,24 @@ static void gsk_gl_renderer_add_render_ops     (GskGLRenderer   *self,
                                                 GskRenderNode   *node,
                                                 RenderOpBuilder *builder);
 
+/* Shared by all GL renderers of a display */
+typedef struct
+{
+  int ref_count;
+
+  gsize budget; /* in bytes, 0 for no limit */
+  GPtrArray *renderers;
+
+  GMemoryMonitor *monitor;
+  gulong low_memory_handler;
+  guint low_memory_serial;
+} GskGLMemoryBudget;
+
 struct _GskGLRenderer
 {
   GskRenderer parent_instance;
 
-  int scale_factor;
+  float scale_factor;
 
   GdkGLContext *gl_context;
   GskGLDriver *gl_driver;
@@ -474,14 +473,33 @@ struct _GskGLRenderer
   GskGLGlyphCache *glyph_cache;
   GskGLIconCache *icon_cache;
   GskGLShadowCache shadow_cache;
+  GskGLOffscreenCache offscreen_cache;
+  GskGLGradientCache gradient_cache;
+
+  GskGLMemoryBudget *memory_budget;
+  guint low_memory_serial;
+
+  GThreadPool *fallback_pool;
+  GAsyncQueue *finished_fallbacks;
+  guint n_pending_fallbacks;
+
+  GThreadPool *build_pool;
+  GMutex build_lock;
+  GCond build_cond;
+
+  /* Textures drawn this frame that are still being streamed */
+  guint n_incomplete_uploads;
 
 #ifdef G_ENABLE_DEBUG
   struct {
     GQuark frames;
+    GQuark merged_draws;
+    GQuark texture_memory;
   } profile_counters;
   struct {
     GQuark cpu_time;
     GQuark gpu_time;
+    GQuark program_gpu_time[GL_N_PROGRAMS];
   } profile_timers;
 #endif
 
@@ -559,39 +577,29 @@ transform_rect (GskGLRenderer        *self,
   return r;
 }
 
-static inline void
-render_fallback_node (GskGLRenderer   *self,
-                      GskRenderNode   *node,
-                      RenderOpBuilder *builder)
+typedef struct
+{
+  GskRenderNode *node;
+  float scale;
+  int width;
+  int height;
+  int texture_id;
+  gboolean debug;
+  cairo_surface_t *surface;
+} FallbackJob;
+
+/* Only uses cairo, so this can run on the fallback threads
+ * for nodes that pass gsk_render_node_can_draw_threaded() */
+static cairo_surface_t *
+draw_fallback_surface (GskRenderNode *node,
+                       float          scale,
+                       int            surface_width,
+                       int            surface_height,
+                       gboolean       debug)
 {
-  const float scale = ops_get_scale (builder);
-  const int surface_width = ceilf (node->bounds.size.width * scale);
-  const int surface_height = ceilf (node->bounds.size.height * scale);
   cairo_surface_t *surface;
   cairo_surface_t *rendered_surface;
   cairo_t *cr;
-  int cached_id;
-  int texture_id;
-  GskTextureKey key;
-
-  if (surface_width <= 0 ||
-      surface_height <= 0)
-    return;
-
-  key.pointer = node;
-  key.scale = scale;
-  key.filter = GL_NEAREST;
-
-  cached_id = gsk_gl_driver_get_texture_for_key (self->gl_driver, &key);
-
-  if (cached_id != 0)
-    {
-      ops_set_program (builder, &self->programs->blit_program);
-      ops_set_texture (builder, cached_id);
-      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
-      return;
-    }
-
 
   /* We first draw the recording surface on an image surface,
    * just because the scaleY(-1) later otherwise screws up the
@@ -626,8 +634,7 @@ render_fallback_node (GskGLRenderer   *self,
   cairo_fill (cr);
   cairo_restore (cr);
 
-#ifdef G_ENABLE_DEBUG
-  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), FALLBACK))
+  if (debug)
     {
       cairo_move_to (cr, 0, 0);
       cairo_rectangle (cr, 0, 0, node->bounds.size.width, node->bounds.size.height);
@@ -642,13 +649,33 @@ render_fallback_node (GskGLRenderer   *self,
         cairo_set_source_rgba (cr, 1, 0, 0, 1);
       cairo_stroke (cr);
     }
-#endif
   cairo_destroy (cr);
 
-  /* Upload the Cairo surface to a GL texture */
-  texture_id = gsk_gl_driver_create_texture (self->gl_driver,
-                                             surface_width,
-                                             surface_height);
+  cairo_surface_destroy (rendered_surface);
+
+  return surface;
+}
+
+static void
+draw_fallback_threaded (gpointer data,
+                        gpointer user_data)
+{
+  FallbackJob *job = data;
+  GskGLRenderer *self = user_data;
+
+  job->surface = draw_fallback_surface (job->node, job->scale,
+                                        job->width, job->height,
+                                        job->debug);
+
+  g_async_queue_push (self->finished_fallbacks, job);
+}
+
+static void
+upload_fallback_surface (GskGLRenderer   *self,
+                         GskRenderNode   *node,
+                         int              texture_id,
+                         cairo_surface_t *surface)
+{
   gsk_gl_driver_bind_source_texture (self->gl_driver, texture_id);
   gsk_gl_driver_init_texture_with_surface (self->gl_driver,
                                            texture_id,
@@ -660,9 +687,96 @@ render_fallback_node (GskGLRenderer   *self,
                                          "Fallback %s %d",
                                          g_type_name_from_instance ((GTypeInstance *) node),
                                          texture_id);
+}
 
-  cairo_surface_destroy (surface);
-  cairo_surface_destroy (rendered_surface);
+/* Waits for the fallback nodes that are still being drawn and uploads
+ * them. Needs to happen before the ops that use them are rendered. */
+static void
+gsk_gl_renderer_upload_fallbacks (GskGLRenderer *self)
+{
+  while (self->n_pending_fallbacks > 0)
+    {
+      FallbackJob *job = g_async_queue_pop (self->finished_fallbacks);
+
+      upload_fallback_surface (self, job->node, job->texture_id, job->surface);
+
+      cairo_surface_destroy (job->surface);
+      gsk_render_node_unref (job->node);
+      g_slice_free (FallbackJob, job);
+      self->n_pending_fallbacks--;
+    }
+}
+
+static inline void
+render_fallback_node (GskGLRenderer   *self,
+                      GskRenderNode   *node,
+                      RenderOpBuilder *builder)
+{
+  const float scale = ops_get_scale (builder);
+  const int surface_width = ceilf (node->bounds.size.width * scale);
+  const int surface_height = ceilf (node->bounds.size.height * scale);
+  gboolean debug = FALSE;
+  cairo_surface_t *surface;
+  int cached_id;
+  int texture_id;
+  GskTextureKey key;
+
+  if (surface_width <= 0 ||
+      surface_height <= 0)
+    return;
+
+  key.pointer = node;
+  key.scale = scale;
+  key.filter = GL_NEAREST;
+
+  cached_id = gsk_gl_driver_get_texture_for_key (self->gl_driver, &key);
+
+  if (cached_id != 0)
+    {
+      ops_set_program (builder, &self->programs->blit_program);
+      ops_set_texture (builder, cached_id);
+      load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder);
+      return;
+    }
+
+#ifdef G_ENABLE_DEBUG
+  debug = GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), FALLBACK);
+#endif
+
+  texture_id = gsk_gl_driver_create_texture (self->gl_driver,
+                                             surface_width,
+                                             surface_height);
+
+  if (gsk_render_node_can_draw_threaded (node))
+    {
+      FallbackJob *job;
+
+      /* The texture gets its contents in gsk_gl_renderer_upload_fallbacks() */
+      if (self->fallback_pool == NULL)
+        {
+          self->finished_fallbacks = g_async_queue_new ();
+          self->fallback_pool = g_thread_pool_new (draw_fallback_threaded, self,
+                                                   CLAMP (g_get_num_processors () - 1, 1, MAX_FALLBACK_THREADS),
+                                                   FALSE, NULL);
+        }
+
+      job = g_slice_new0 (FallbackJob);
+      job->node = gsk_render_node_ref (node);
+      job->scale = scale;
+      job->width = surface_width;
+      job->height = surface_height;
+      job->texture_id = texture_id;
+      job->debug = debug;
+
+      self->n_pending_fallbacks++;
+      g_thread_pool_push (self->fallback_pool, job, NULL);
+    }
+  else
+    {
+      surface = draw_fallback_surface (node, scale, surface_width, surface_height, debug);
+      upload_fallback_surface (self, node, texture_id, surface);
+      cairo_surface_destroy (surface);
+    }
 
   gsk_gl_driver_set_texture_for_key (self->gl_driver, &key, texture_id);
 
@@ -710,6 +824,7 @@ render_text_node (GskGLRenderer   *self,
     {
       const PangoGlyphInfo *gi = &glyphs[i];
       const GskGLCachedGlyph *glyph;
+      GskQuadVertex *vertices;
       float glyph_x, glyph_y, glyph_x2, glyph_y2;
       float tx, ty, tx2, ty2;
       float cx;
@@ -743,15 +858,16 @@ render_text_node (GskGLRenderer   *self,
       glyph_x2 = glyph_x + glyph->draw_width;
       glyph_y2 = glyph_y + glyph->draw_height;
 
-      ops_draw (builder, (GskQuadVertex[GL_N_VERTICES]) {
-        { { glyph_x,  glyph_y  }, { tx,  ty  }, },
-        { { glyph_x,  glyph_y2 }, { tx,  ty2 }, },
-        { { glyph_x2, glyph_y  }, { tx2, ty  }, },
+      /* Write the quad straight into the vertex array, this loop
+       * is hot for text-heavy nodes */
+      vertices = ops_draw (builder, NULL);
+      vertices[0] = (GskQuadVertex) { { glyph_x,  glyph_y  }, { tx,  ty  }, };
+      vertices[1] = (GskQuadVertex) { { glyph_x,  glyph_y2 }, { tx,  ty2 }, };
+      vertices[2] = (GskQuadVertex) { { glyph_x2, glyph_y  }, { tx2, ty  }, };
 
-        { { glyph_x2, glyph_y2 }, { tx2, ty2 }, },
-        { { glyph_x,  glyph_y2 }, { tx,  ty2 }, },
-        { { glyph_x2, glyph_y  }, { tx2, ty  }, },
-      });
+      vertices[3] = (GskQuadVertex) { { glyph_x2, glyph_y2 }, { tx2, ty2 }, };
+      vertices[4] = (GskQuadVertex) { { glyph_x,  glyph_y2 }, { tx,  ty2 }, };
+      vertices[5] = (GskQuadVertex) { { glyph_x2, glyph_y  }, { tx2, ty  }, };
 
 next:
       x_position += gi->geometry.width;
@@ -832,68 +948,65 @@ render_border_node (GskGLRenderer   *self,
     const float min_y = builder->dy + node->bounds.origin.y;
     const float max_x = min_x + node->bounds.size.width;
     const float max_y = min_y + node->bounds.size.height;
+    /* The x texture coordinate is the index of the side,
+     * so that the shader can pick its color */
     const GskQuadVertex side_data[4][6] = {
       /* Top */
       {
-        { { min_x,              min_y              }, { 0, 1 }, }, /* Upper left */
+        { { min_x,              min_y              }, { 0, 0 }, }, /* Upper left */
         { { min_x + sizes[0].w, min_y + sizes[0].h }, { 0, 0 }, }, /* Lower left */
-        { { max_x,              min_y              }, { 1, 1 }, }, /* Upper right */
+        { { max_x,              min_y              }, { 0, 0 }, }, /* Upper right */
 
-        { { max_x - sizes[1].w, min_y + sizes[1].h }, { 1, 0 }, }, /* Lower right */
+        { { max_x - sizes[1].w, min_y + sizes[1].h }, { 0, 0 }, }, /* Lower right */
         { { min_x + sizes[0].w, min_y + sizes[0].h }, { 0, 0 }, }, /* Lower left */
-        { { max_x,              min_y              }, { 1, 1 }, }, /* Upper right */
+        { { max_x,              min_y              }, { 0, 0 }, }, /* Upper right */
       },
       /* Right */
       {
-        { { max_x - sizes[1].w, min_y + sizes[1].h }, { 0, 1 }, }, /* Upper left */
-        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 0, 0 }, }, /* Lower left */
-        { { max_x,              min_y              }, { 1, 1 }, }, /* Upper right */
+        { { max_x - sizes[1].w, min_y + sizes[1].h }, { 1, 0 }, }, /* Upper left */
+        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 1, 0 }, }, /* Lower left */
+        { { max_x,              min_y              }, { 1, 0 }, }, /* Upper right */
 
         { { max_x,              max_y              }, { 1, 0 }, }, /* Lower right */
-        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 0, 0 }, }, /* Lower left */
-        { { max_x,              min_y              }, { 1, 1 }, }, /* Upper right */
+        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 1, 0 }, }, /* Lower left */
+        { { max_x,              min_y              }, { 1, 0 }, }, /* Upper right */
       },
       /* Bottom */
       {
-        { { min_x + sizes[3].w, max_y - sizes[3].h }, { 0, 1 }, }, /* Upper left */
-        { { min_x,              max_y              }, { 0, 0 }, }, /* Lower left */
-        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 1, 1 }, }, /* Upper right */
+        { { min_x + sizes[3].w, max_y - sizes[3].h }, { 2, 0 }, }, /* Upper left */
+        { { min_x,              max_y              }, { 2, 0 }, }, /* Lower left */
+        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 2, 0 }, }, /* Upper right */
 
-        { { max_x,              max_y              }, { 1, 0 }, }, /* Lower right */
-        { { min_x            ,  max_y              }, { 0, 0 }, }, /* Lower left */
-        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 1, 1 }, }, /* Upper right */
+        { { max_x,              max_y              }, { 2, 0 }, }, /* Lower right */
+        { { min_x            ,  max_y              }, { 2, 0 }, }, /* Lower left */
+        { { max_x - sizes[2].w, max_y - sizes[2].h }, { 2, 0 }, }, /* Upper right */
       },
       /* Left */
       {
-        { { min_x,              min_y              }, { 0, 1 }, }, /* Upper left */
-        { { min_x,              max_y              }, { 0, 0 }, }, /* Lower left */
-        { { min_x + sizes[0].w, min_y + sizes[0].h }, { 1, 1 }, }, /* Upper right */
+        { { min_x,              min_y              }, { 3, 0 }, }, /* Upper left */
+        { { min_x,              max_y              }, { 3, 0 }, }, /* Lower left */
+        { { min_x + sizes[0].w, min_y + sizes[0].h }, { 3, 0 }, }, /* Upper right */
 
-        { { min_x + sizes[3].w, max_y - sizes[3].h }, { 1, 0 }, }, /* Lower right */
-        { { min_x,              max_y              }, { 0, 0 }, }, /* Lower left */
-        { { min_x + sizes[0].w, min_y + sizes[0].h }, { 1, 1 }, }, /* Upper right */
+        { { min_x + sizes[3].w, max_y - sizes[3].h }, { 3, 0 }, }, /* Lower right */
+        { { min_x,              max_y              }, { 3, 0 }, }, /* Lower left */
+        { { min_x + sizes[0].w, min_y + sizes[0].h }, { 3, 0 }, }, /* Upper right */
       }
     };
-    int indices[4] = { 0, 1, 2, 3 };
     GskRoundedRect outline;
 
-    /* We sort them by color */
-    sort_border_sides (colors, indices);
-
     /* Prepare outline */
     outline = transform_rect (self, builder, rounded_outline);
 
     ops_set_program (builder, &self->programs->border_program);
     ops_set_border_width (builder, widths);
     ops_set_border (builder, &outline);
+    ops_set_border_colors (builder, colors);
 
+    /* All sides end up in the same draw call */
     for (i = 0; i < 4; i ++)
       {
-        if (widths[indices[i]] > 0)
-          {
-            ops_set_border_color (builder, &colors[indices[i]]);
-            ops_draw (builder, side_data[indices[i]]);
-          }
+        if (widths[i] > 0)
+          ops_draw (builder, side_data[i]);
       }
   }
 }
@@ -915,7 +1028,8 @@ upload_texture (GskGLRenderer *self,
 {
   if (texture->width <= 128 &&
       texture->height <= 128 &&
-      !GDK_IS_GL_TEXTURE (texture))
+      !GDK_IS_GL_TEXTURE (texture) &&
+      !GDK_IS_DMABUF_TEXTURE (texture))
     {
       const IconData *icon_data;
 
@@ -990,6 +1104,53 @@ render_texture_node (GskGLRenderer       *self,
           });
         }
     }
+  else if (texture->width > 128 || texture->height > 128)
+    {
+      const float scale = ops_get_scale (builder);
+      int texture_id, uploaded_rows;
+      float x1, x2, y1, y2, v;
+      int min_filter;
+
+      /* Linear filtering skips texels when drawing at less than half
+       * the size, which aliases, so use mipmaps for that.
+       */
+      if (node->bounds.size.width * scale * 2 <= texture->width &&
+          node->bounds.size.height * scale * 2 <= texture->height)
+        min_filter = GL_LINEAR_MIPMAP_LINEAR;
+      else
+        min_filter = GL_LINEAR;
+
+      texture_id = gsk_gl_driver_stream_texture (self->gl_driver,
+                                                 texture,
+                                                 min_filter,
+                                                 GL_LINEAR,
+                                                 &uploaded_rows);
+
+      if (uploaded_rows < texture->height)
+        self->n_incomplete_uploads++;
+
+      /* Until it is complete, draw the part that has arrived */
+      if (uploaded_rows == 0)
+        return;
+
+      v = (float) uploaded_rows / texture->height;
+      x1 = builder->dx + node->bounds.origin.x;
+      x2 = x1 + node->bounds.size.width;
+      y1 = builder->dy + node->bounds.origin.y;
+      y2 = y1 + node->bounds.size.height * v;
+
+      ops_set_program (builder, &self->programs->blit_program);
+      ops_set_texture (builder, texture_id);
+      ops_draw (builder, (GskQuadVertex[GL_N_VERTICES]) {
+        { { x1, y1 }, { 0, 0 }, },
+        { { x1, y2 }, { 0, v }, },
+        { { x2, y1 }, { 1, 0 }, },
+
+        { { x2, y2 }, { 1, v }, },
+        { { x1, y2 }, { 0, v }, },
+        { { x2, y1 }, { 1, 0 }, },
+      });
+    }
   else
     {
       TextureRegion r;
@@ -1175,15 +1336,25 @@ render_linear_gradient_node (GskGLRenderer   *self,
                              GskRenderNode   *node,
                              RenderOpBuilder *builder)
 {
-  const int n_color_stops = MIN (8, gsk_linear_gradient_node_get_n_color_stops (node));
+  const int n_color_stops = gsk_linear_gradient_node_get_n_color_stops (node);
   const GskColorStop *stops = gsk_linear_gradient_node_peek_color_stops (node, NULL);
   const graphene_point_t *start = gsk_linear_gradient_node_peek_start (node);
   const graphene_point_t *end = gsk_linear_gradient_node_peek_end (node);
+  int texture_id;
+  float ramp_y;
+
+  if (!gsk_gl_gradient_cache_lookup_or_add (&self->gradient_cache, self->gl_driver,
+                                            stops, n_color_stops,
+                                            &texture_id, &ramp_y))
+    {
+      render_fallback_node (self, node, builder);
+      return;
+    }
 
   ops_set_program (builder, &self->programs->linear_gradient_program);
+  ops_set_texture (builder, texture_id);
   ops_set_linear_gradient (builder,
-                           n_color_stops,
-                           stops,
+                           ramp_y,
                            builder->dx + start->x,
                            builder->dy + start->y,
                            builder->dx + end->x,
@@ -1198,18 +1369,28 @@ render_radial_gradient_node (GskGLRenderer   *self,
                              RenderOpBuilder *builder)
 {
   const float scale = ops_get_scale (builder);
-  const int n_color_stops = MIN (8, gsk_radial_gradient_node_get_n_color_stops (node));
+  const int n_color_stops = gsk_radial_gradient_node_get_n_color_stops (node);
   const GskColorStop *stops = gsk_radial_gradient_node_peek_color_stops (node, NULL);
   const graphene_point_t *center = gsk_radial_gradient_node_peek_center (node);
   const float start = gsk_radial_gradient_node_get_start (node);
   const float end = gsk_radial_gradient_node_get_end (node);
   const float hradius = gsk_radial_gradient_node_get_hradius (node);
   const float vradius = gsk_radial_gradient_node_get_vradius (node);
+  int texture_id;
+  float ramp_y;
+
+  if (!gsk_gl_gradient_cache_lookup_or_add (&self->gradient_cache, self->gl_driver,
+                                            stops, n_color_stops,
+                                            &texture_id, &ramp_y))
+    {
+      render_fallback_node (self, node, builder);
+      return;
+    }
 
   ops_set_program (builder, &self->programs->radial_gradient_program);
+  ops_set_texture (builder, texture_id);
   ops_set_radial_gradient (builder,
-                           n_color_stops,
-                           stops,
+                           ramp_y,
                            builder->dx + center->x,
                            builder->dy + center->y,
                            start, end,
@@ -1317,7 +1498,7 @@ render_clipped_child (GskGLRenderer         *self,
                                   &builder->current_clip->bounds,
                                   &intersection.bounds);
 
-      ops_push_clip (builder, &intersection);
+      ops_push_nested_clip (builder, &intersection);
       gsk_gl_renderer_add_render_ops (self, child, builder);
       ops_pop_clip (builder);
     }
@@ -1325,7 +1506,7 @@ render_clipped_child (GskGLRenderer         *self,
                                           builder->current_clip,
                                           &intersection))
     {
-      ops_push_clip (builder, &intersection);
+      ops_push_nested_clip (builder, &intersection);
       gsk_gl_renderer_add_render_ops (self, child, builder);
       ops_pop_clip (builder);
     }
@@ -1400,7 +1581,7 @@ render_rounded_clip_node (GskGLRenderer       *self,
                                          &transformed_clip,
                                          &intersected_clip))
         {
-          ops_push_clip (builder, &intersected_clip);
+          ops_push_nested_clip (builder, &intersected_clip);
           gsk_gl_renderer_add_render_ops (self, child, builder);
           ops_pop_clip (builder);
           return;
@@ -1432,7 +1613,19 @@ render_rounded_clip_node (GskGLRenderer       *self,
         }
 
       /* TODO: Intersect current and new clip */
-      ops_push_clip (builder, &transformed_clip);
+      ops_push_nested_clip (builder, &transformed_clip);
+      gsk_gl_renderer_add_render_ops (self, child, builder);
+      ops_pop_clip (builder);
+    }
+  else if (!ops_has_outer_clip (builder))
+    {
+      /* The shaders can clip to two rounded rects at once, so we make
+       * the current clip the outer clip instead of using an offscreen.
+       * Nested clips only get intersected with the new clip, and keep
+       * the outer one. */
+      const GskRoundedRect outer_clip = *builder->current_clip;
+
+      ops_push_clip_with_outer (builder, &transformed_clip, &outer_clip);
       gsk_gl_renderer_add_render_ops (self, child, builder);
       ops_pop_clip (builder);
     }
@@ -1507,6 +1700,88 @@ render_color_matrix_node (GskGLRenderer       *self,
                                 is_offscreen);
 }
 
+/* Large blurs are done on a downscaled copy of the texture. That is
+ * a lot cheaper, since the cost of the blur shader grows with the
+ * radius, and looks the same, as the blur removes the detail that is
+ * lost by downscaling anyway. The blurred result is drawn scaled up
+ * with linear filtering.
+ *
+ * Textures that get blurred should use linear filtering when they get
+ * downscaled, so that every halving averages 2x2 texels.
+ */
+static inline int
+get_blur_downscale (float blur_radius)
+{
+  int downscale = 1;
+
+  while (downscale < MAX_BLUR_DOWNSCALE &&
+         blur_radius / (downscale * 2) >= MIN_DOWNSCALED_BLUR_RADIUS)
+    downscale *= 2;
+
+  return downscale;
+}
+
+static inline int
+get_blur_source_filter (float blur_radius)
+{
+  return get_blur_downscale (blur_radius) > 1 ? GL_LINEAR : GL_NEAREST;
+}
+
+/* Draws @region into a new texture of @width x @height */
+static int
+downscale_texture (GskGLRenderer       *self,
+                   RenderOpBuilder     *builder,
+                   const TextureRegion *region,
+                   const int            width,
+                   const int            height)
+{
+  int texture_id, render_target;
+  int prev_render_target;
+  graphene_matrix_t prev_projection;
+  graphene_rect_t prev_viewport;
+  graphene_matrix_t item_proj;
+  float prev_opacity;
+
+  gsk_gl_driver_create_render_target (self->gl_driver,
+                                      width, height,
+                                      GL_LINEAR, GL_LINEAR,
+                                      &texture_id, &render_target);
+
+  graphene_matrix_init_ortho (&item_proj,
+                              0, width, 0, height,
+                              ORTHO_NEAR_PLANE, ORTHO_FAR_PLANE);
+  graphene_matrix_scale (&item_proj, 1, -1, 1);
+
+  prev_projection = ops_set_projection (builder, &item_proj);
+  ops_set_modelview (builder, NULL);
+  prev_viewport = ops_set_viewport (builder, &GRAPHENE_RECT_INIT (0, 0, width, height));
+  ops_push_clip (builder, &GSK_ROUNDED_RECT_INIT (0, 0, width, height));
+  prev_opacity = ops_set_opacity (builder, 1.0f);
+
+  prev_render_target = ops_set_render_target (builder, render_target);
+  ops_begin (builder, OP_CLEAR);
+  ops_set_program (builder, &self->programs->blit_program);
+  ops_set_texture (builder, region->texture_id);
+  ops_draw (builder, (GskQuadVertex[GL_N_VERTICES]) {
+    { { 0,                   }, { region->x,  region->y2 }, },
+    { { 0,     height        }, { region->x,  region->y  }, },
+    { { width,               }, { region->x2, region->y2 }, },
+
+    { { width, height        }, { region->x2, region->y  }, },
+    { { 0,     height        }, { region->x,  region->y  }, },
+    { { width,               }, { region->x2, region->y2 }, },
+  });
+
+  ops_set_render_target (builder, prev_render_target);
+  ops_set_opacity (builder, prev_opacity);
+  ops_set_viewport (builder, &prev_viewport);
+  ops_set_projection (builder, &prev_projection);
+  ops_pop_modelview (builder);
+  ops_pop_clip (builder);
+
+  return texture_id;
+}
+
 static inline int
 blur_texture (GskGLRenderer       *self,
               RenderOpBuilder     *builder,
@@ -1515,6 +1790,11 @@ blur_texture (GskGLRenderer       *self,
               const int            texture_to_blur_height,
               float                blur_radius)
 {
+  int downscale = get_blur_downscale (blur_radius);
+  int width = texture_to_blur_width;
+  int height = texture_to_blur_height;
+  int filter = GL_NEAREST;
+  TextureRegion source = *region;
   int pass1_texture_id, pass1_render_target;
   int pass2_texture_id, pass2_render_target;
   int prev_render_target;
@@ -1525,46 +1805,59 @@ blur_texture (GskGLRenderer       *self,
 
   g_assert (blur_radius > 0);
 
+  /* Halve the size one step at a time, so no texel gets skipped */
+  while (downscale > 1)
+    {
+      width = MAX ((width + 1) / 2, 1);
+      height = MAX ((height + 1) / 2, 1);
+      init_full_texture_region (&source,
+                                downscale_texture (self, builder, &source, width, height));
+
+      blur_radius /= 2;
+      downscale /= 2;
+      filter = GL_LINEAR;
+    }
+
   gsk_gl_driver_create_render_target (self->gl_driver,
-                                      texture_to_blur_width, texture_to_blur_height,
+                                      width, height,
                                       GL_NEAREST, GL_NEAREST,
                                       &pass1_texture_id, &pass1_render_target);
 
   gsk_gl_driver_create_render_target (self->gl_driver,
-                                      texture_to_blur_width, texture_to_blur_height,
-                                      GL_NEAREST, GL_NEAREST,
+                                      width, height,
+                                      filter, filter,
                                       &pass2_texture_id, &pass2_render_target);
 
   graphene_matrix_init_ortho (&item_proj,
-                              0, texture_to_blur_width, 0, texture_to_blur_height,
+                              0, width, 0, height,
                               ORTHO_NEAR_PLANE, ORTHO_FAR_PLANE);
   graphene_matrix_scale (&item_proj, 1, -1, 1);
 
   prev_projection = ops_set_projection (builder, &item_proj);
   ops_set_modelview (builder, NULL);
-  prev_viewport = ops_set_viewport (builder, &GRAPHENE_RECT_INIT (0, 0, texture_to_blur_width, texture_to_blur_height));
-  ops_push_clip (builder, &GSK_ROUNDED_RECT_INIT (0, 0, texture_to_blur_width, texture_to_blur_height));
+  prev_viewport = ops_set_viewport (builder, &GRAPHENE_RECT_INIT (0, 0, width, height));
+  ops_push_clip (builder, &GSK_ROUNDED_RECT_INIT (0, 0, width, height));
 
   prev_render_target = ops_set_render_target (builder, pass1_render_target);
   ops_begin (builder, OP_CLEAR);
   ops_set_program (builder, &self->programs->blur_program);
 
   op = ops_begin (builder, OP_CHANGE_BLUR);
-  op->size.width = texture_to_blur_width;
-  op->size.height = texture_to_blur_height;
+  op->size.width = width;
+  op->size.height = height;
   op->radius = blur_radius;
   op->dir[0] = 1;
   op->dir[1] = 0;
-  ops_set_texture (builder, region->texture_id);
+  ops_set_texture (builder, source.texture_id);
 
   ops_draw (builder, (GskQuadVertex[GL_N_VERTICES]) {
-    { { 0,                                            }, { region->x,  region->y2 }, },
-    { { 0,                     texture_to_blur_height }, { region->x,  region->y }, },
-    { { texture_to_blur_width,                        }, { region->x2, region->y2 }, },
+    { { 0,                   }, { source.x,  source.y2 }, },
+    { { 0,     height        }, { source.x,  source.y  }, },
+    { { width,               }, { source.x2, source.y2 }, },
 
-    { { texture_to_blur_width, texture_to_blur_height }, { region->x2, region->y }, },
-    { { 0,                     texture_to_blur_height }, { region->x,  region->y }, },
-    { { texture_to_blur_width,                        }, { region->x2, region->y2 }, },
+    { { width, height        }, { source.x2, source.y  }, },
+    { { 0,     height        }, { source.x,  source.y  }, },
+    { { width,               }, { source.x2, source.y2 }, },
   });
 
 #if 0
@@ -1572,13 +1865,13 @@ blur_texture (GskGLRenderer       *self,
     static int k;
     ops_dump_framebuffer (builder,
                           g_strdup_printf ("pass1_%d.png", k++),
-                          texture_to_blur_width,
-                          texture_to_blur_height);
+                          width,
+                          height);
   }
 #endif
   op = ops_begin (builder, OP_CHANGE_BLUR);
-  op->size.width = texture_to_blur_width;
-  op->size.height = texture_to_blur_height;
+  op->size.width = width;
+  op->size.height = height;
   op->radius = blur_radius;
   op->dir[0] = 0;
   op->dir[1] = 1;
@@ -1586,13 +1879,13 @@ blur_texture (GskGLRenderer       *self,
   ops_set_render_target (builder, pass2_render_target);
   ops_begin (builder, OP_CLEAR);
   ops_draw (builder, (GskQuadVertex[GL_N_VERTICES]) { /* render pass 2 */
-    { { 0,                                            }, { 0, 1 }, },
-    { { 0,                     texture_to_blur_height }, { 0, 0 }, },
-    { { texture_to_blur_width,                        }, { 1, 1 }, },
+    { { 0,                   }, { 0, 1 }, },
+    { { 0,     height        }, { 0, 0 }, },
+    { { width,               }, { 1, 1 }, },
 
-    { { texture_to_blur_width, texture_to_blur_height }, { 1, 0 }, },
-    { { 0,                     texture_to_blur_height }, { 0, 0 }, },
-    { { texture_to_blur_width,                        }, { 1, 1 }, },
+    { { width, height        }, { 1, 0 }, },
+    { { 0,     height        }, { 0, 0 }, },
+    { { width,               }, { 1, 1 }, },
   });
 
 #if 0
@@ -1600,8 +1893,8 @@ blur_texture (GskGLRenderer       *self,
     static int k;
     ops_dump_framebuffer (builder,
                           g_strdup_printf ("blurred%d.png", k++),
-                          texture_to_blur_width,
-                          texture_to_blur_height);
+                          width,
+                          height);
   }
 #endif
 
@@ -1642,7 +1935,8 @@ blur_node (GskGLRenderer   *self,
                                                texture_width, texture_height),
                           node,
                           &region, &is_offscreen,
-                          RESET_CLIP | RESET_OPACITY | FORCE_OFFSCREEN | extra_flags))
+                          RESET_CLIP | RESET_OPACITY | FORCE_OFFSCREEN | extra_flags |
+                          (get_blur_downscale (blur_radius * scale) > 1 ? LINEAR_FILTER : 0)))
     g_assert_not_reached ();
 
   blurred_texture_id = blur_texture (self, builder,
@@ -1669,7 +1963,7 @@ render_blur_node (GskGLRenderer   *self,
   const float blur_radius = gsk_blur_node_get_radius (node);
   GskRenderNode *child = gsk_blur_node_get_child (node);
   TextureRegion blurred_region;
-  GskTextureKey key;
+  float scale;
 
   if (node_is_invisible (child))
     return;
@@ -1680,12 +1974,18 @@ render_blur_node (GskGLRenderer   *self,
       return;
     }
 
-  key.pointer = node;
-  key.scale = ops_get_scale (builder);
-  key.filter = GL_NEAREST;
-  blurred_region.texture_id = gsk_gl_driver_get_texture_for_key (self->gl_driver, &key);
+  scale = ops_get_scale (builder);
+  blurred_region.texture_id = gsk_gl_offscreen_cache_get_texture_id (&self->offscreen_cache,
+                                                                     child, scale, GL_NEAREST,
+                                                                     blur_radius);
   if (blurred_region.texture_id == 0)
-    blur_node (self, child, builder, blur_radius, 0, &blurred_region, NULL);
+    {
+      /* Only the blurred result is worth keeping around */
+      blur_node (self, child, builder, blur_radius, NO_CACHE_PLZ, &blurred_region, NULL);
+      gsk_gl_offscreen_cache_commit (&self->offscreen_cache, self->gl_driver,
+                                     child, scale, GL_NEAREST, blur_radius,
+                                     blurred_region.texture_id);
+    }
 
   g_assert (blurred_region.texture_id != 0);
 
@@ -1693,9 +1993,6 @@ render_blur_node (GskGLRenderer   *self,
   ops_set_program (builder, &self->programs->blit_program);
   ops_set_texture (builder, blurred_region.texture_id);
   load_offscreen_vertex_data (ops_draw (builder, NULL), node, builder); /* Render result to screen */
-
-  /* Add to cache for the blur node */
-  gsk_gl_driver_set_texture_for_key (self->gl_driver, &key, blurred_region.texture_id);
 }
 
 static inline void
@@ -1753,6 +2050,7 @@ render_inset_shadow_node (GskGLRenderer   *self,
       graphene_matrix_t prev_projection;
       graphene_rect_t prev_viewport;
       graphene_matrix_t item_proj;
+      const int filter = get_blur_source_filter (blur_radius * scale);
       int i;
 
       /* TODO: In the following code, we have to be careful about where we apply the scale.
@@ -1782,7 +2080,7 @@ render_inset_shadow_node (GskGLRenderer   *self,
 
       gsk_gl_driver_create_render_target (self->gl_driver,
                                           texture_width, texture_height,
-                                          GL_NEAREST, GL_NEAREST,
+                                          filter, filter,
                                           &texture_id, &render_target);
 
       graphene_matrix_init_ortho (&item_proj,
@@ -1900,8 +2198,8 @@ render_outset_shadow_node (GskGLRenderer   *self,
   GskRoundedRect scaled_outline;
   int texture_width, texture_height;
   OpOutsetShadow *shadow;
+  const GskGLCachedShadow *cached;
   int blurred_texture_id;
-  int cached_tid;
   bool do_slicing;
 
   /* scaled_outline is the minimal outline we need to draw the given drop shadow,
@@ -1943,22 +2241,23 @@ render_outset_shadow_node (GskGLRenderer   *self,
       scaled_outline.corner[i].height *= scale;
     }
 
-  cached_tid = gsk_gl_shadow_cache_get_texture_id (&self->shadow_cache,
-                                                   self->gl_driver,
-                                                   &scaled_outline,
-                                                   blur_radius);
+  cached = gsk_gl_shadow_cache_lookup (&self->shadow_cache,
+                                       self->gl_driver,
+                                       &scaled_outline,
+                                       blur_radius);
 
-  if (cached_tid == 0)
+  if (cached == NULL)
     {
       int texture_id, render_target;
       int prev_render_target;
       graphene_matrix_t prev_projection;
       graphene_rect_t prev_viewport;
       graphene_matrix_t item_proj;
+      const int filter = get_blur_source_filter (blur_radius * scale);
 
       gsk_gl_driver_create_render_target (self->gl_driver,
                                           texture_width, texture_height,
-                                          GL_NEAREST, GL_NEAREST,
+                                          filter, filter,
                                           &texture_id, &render_target);
       if (gdk_gl_context_has_debug (self->gl_context))
         {
@@ -2007,14 +2306,17 @@ render_outset_shadow_node (GskGLRenderer   *self,
                                          blur_radius * scale);
 
       gsk_gl_driver_mark_texture_permanent (self->gl_driver, blurred_texture_id);
-      gsk_gl_shadow_cache_commit (&self->shadow_cache,
-                                  &scaled_outline,
-                                  blur_radius,
-                                  blurred_texture_id);
+      cached = gsk_gl_shadow_cache_commit (&self->shadow_cache,
+                                           &scaled_outline,
+                                           blur_radius,
+                                           blurred_texture_id,
+                                           texture_width,
+                                           texture_height,
+                                           extra_blur_pixels);
     }
   else
     {
-      blurred_texture_id = cached_tid;
+      blurred_texture_id = cached->texture_id;
     }
 
 
@@ -2068,14 +2370,9 @@ render_outset_shadow_node (GskGLRenderer   *self,
                                (blur_extra / 2.0) + dx + spread);
     const float max_y = ceilf (builder->dy + outline->bounds.origin.y + outline->bounds.size.height +
                                (blur_extra / 2.0) + dy + spread);
+    const cairo_rectangle_int_t *slices = cached->slices;
+    const TextureRegion *tregs = cached->regions;
     float x1, x2, y1, y2, tx1, tx2, ty1, ty2;
-    cairo_rectangle_int_t slices[9];
-    TextureRegion tregs[9];
-
-    /* TODO: The slicing never changes and could just go into the cache */
-    nine_slice_rounded_rect (&scaled_outline, slices);
-    nine_slice_grow (slices, extra_blur_pixels);
-    nine_slice_to_texture_coords (slices, texture_width, texture_height, tregs);
 
     /* Our texture coordinates MUST be scaled, while the actual vertex coords
      * MUST NOT be scaled. */
@@ -2708,6 +3005,12 @@ apply_clip_op (const Program *program,
     }
 
   glUniform4fv (program->clip_rect_location, count, (float *)&op->clip.bounds);
+
+  if (op->send_outer_clip)
+    {
+      OP_PRINT (" -> Outer clip: %s", gsk_rounded_rect_to_string (&op->outer_clip));
+      glUniform4fv (program->outer_clip_rect_location, 3, (float *)&op->outer_clip.bounds);
+    }
 }
 
 static inline void
@@ -2775,13 +3078,8 @@ apply_linear_gradient_op (const Program          *program,
                           const OpLinearGradient *op)
 {
   OP_PRINT (" -> Linear gradient");
-  if (op->n_color_stops.send)
-    glUniform1i (program->linear_gradient.num_color_stops_location, op->n_color_stops.value);
-
-  if (op->color_stops.send)
-    glUniform1fv (program->linear_gradient.color_stops_location,
-                  op->n_color_stops.value * 5,
-                  (float *)op->color_stops.value);
+  if (op->ramp_y.send)
+    glUniform1f (program->linear_gradient.ramp_y_location, op->ramp_y.value);
 
   glUniform2f (program->linear_gradient.start_point_location, op->start_point[0], op->start_point[1]);
   glUniform2f (program->linear_gradient.end_point_location, op->end_point[0], op->end_point[1]);
@@ -2792,13 +3090,8 @@ apply_radial_gradient_op (const Program          *program,
                           const OpRadialGradient *op)
 {
   OP_PRINT (" -> Radial gradient");
-  if (op->n_color_stops.send)
-    glUniform1i (program->radial_gradient.num_color_stops_location, op->n_color_stops.value);
-
-  if (op->color_stops.send)
-    glUniform1fv (program->radial_gradient.color_stops_location,
-                  op->n_color_stops.value * 5,
-                  (float *)op->color_stops.value);
+  if (op->ramp_y.send)
+    glUniform1f (program->radial_gradient.ramp_y_location, op->ramp_y.value);
 
   glUniform1f (program->radial_gradient.start_location, op->start);
   glUniform1f (program->radial_gradient.end_location, op->end);
@@ -2829,8 +3122,10 @@ static inline void
 apply_border_color_op (const Program  *program,
                        const OpBorder *op)
 {
-  OP_PRINT (" -> Border color: %s", gdk_rgba_to_string (op->color));
-  glUniform4fv (program->border.color_location, 1, (float *)op->color);
+  OP_PRINT (" -> Border colors: %s, %s, %s, %s",
+            gdk_rgba_to_string (&op->colors[0]), gdk_rgba_to_string (&op->colors[1]),
+            gdk_rgba_to_string (&op->colors[2]), gdk_rgba_to_string (&op->colors[3]));
+  glUniform4fv (program->border.colors_location, 4, (float *)op->colors);
 }
 
 static inline void
@@ -2883,6 +3178,9 @@ gsk_gl_renderer_dispose (GObject *gobject)
 
   ops_free (&self->op_builder);
 
+  g_mutex_clear (&self->build_lock);
+  g_cond_clear (&self->build_cond);
+
   G_OBJECT_CLASS (gsk_gl_renderer_parent_class)->dispose (gobject);
 }
 
@@ -2923,97 +3221,57 @@ gsk_gl_renderer_programs_unref (GskGLRendererPrograms *programs)
             glDeleteProgram (programs->programs[i].id);
           gsk_transform_unref (programs->state[i].modelview);
         }
+      gsk_gl_shader_builder_finish (&programs->shader_builder);
       g_free (programs);
     }
 }
 
-static GskGLRendererPrograms *
-gsk_gl_renderer_create_programs (GskGLRenderer  *self,
-                                 GError        **error)
+static const struct {
+  const char *resource_path;
+  const char *name;
+} program_definitions[] = {
+  { "/org/gtk/libgsk/glsl/blend.glsl",                     "blend" },
+  { "/org/gtk/libgsk/glsl/blit.glsl",                      "blit" },
+  { "/org/gtk/libgsk/glsl/blur.glsl",                      "blur" },
+  { "/org/gtk/libgsk/glsl/border.glsl",                    "border" },
+  { "/org/gtk/libgsk/glsl/color_matrix.glsl",              "color matrix" },
+  { "/org/gtk/libgsk/glsl/color.glsl",                     "color" },
+  { "/org/gtk/libgsk/glsl/coloring.glsl",                  "coloring" },
+  { "/org/gtk/libgsk/glsl/cross_fade.glsl",                "cross fade" },
+  { "/org/gtk/libgsk/glsl/inset_shadow.glsl",              "inset shadow" },
+  { "/org/gtk/libgsk/glsl/linear_gradient.glsl",           "linear gradient" },
+  { "/org/gtk/libgsk/glsl/radial_gradient.glsl",           "radial gradient" },
+  { "/org/gtk/libgsk/glsl/outset_shadow.glsl",             "outset shadow" },
+  { "/org/gtk/libgsk/glsl/repeat.glsl",                    "repeat" },
+  { "/org/gtk/libgsk/glsl/unblurred_outset_shadow.glsl",   "unblurred_outset shadow" },
+};
+
+/* Must be called with the context current */
+gboolean
+gsk_gl_renderer_programs_link (GskGLRendererPrograms  *programs,
+                               int                     index,
+                               GError                **error)
 {
-  GskGLShaderBuilder shader_builder;
-  GskGLRendererPrograms *programs = NULL;
-  int i;
-  static const struct {
-    const char *resource_path;
-    const char *name;
-  } program_definitions[] = {
-    { "/org/gtk/libgsk/glsl/blend.glsl",                     "blend" },
-    { "/org/gtk/libgsk/glsl/blit.glsl",                      "blit" },
-    { "/org/gtk/libgsk/glsl/blur.glsl",                      "blur" },
-    { "/org/gtk/libgsk/glsl/border.glsl",                    "border" },
-    { "/org/gtk/libgsk/glsl/color_matrix.glsl",              "color matrix" },
-    { "/org/gtk/libgsk/glsl/color.glsl",                     "color" },
-    { "/org/gtk/libgsk/glsl/coloring.glsl",                  "coloring" },
-    { "/org/gtk/libgsk/glsl/cross_fade.glsl",                "cross fade" },
-    { "/org/gtk/libgsk/glsl/inset_shadow.glsl",              "inset shadow" },
-    { "/org/gtk/libgsk/glsl/linear_gradient.glsl",           "linear gradient" },
-    { "/org/gtk/libgsk/glsl/radial_gradient.glsl",           "radial gradient" },
-    { "/org/gtk/libgsk/glsl/outset_shadow.glsl",             "outset shadow" },
-    { "/org/gtk/libgsk/glsl/repeat.glsl",                    "repeat" },
-    { "/org/gtk/libgsk/glsl/unblurred_outset_shadow.glsl",   "unblurred_outset shadow" },
-  };
+  Program *prog = &programs->programs[index];
 
-  gsk_gl_shader_builder_init (&shader_builder,
-                              "/org/gtk/libgsk/glsl/preamble.glsl",
-                              "/org/gtk/libgsk/glsl/preamble.vs.glsl",
-                              "/org/gtk/libgsk/glsl/preamble.fs.glsl");
-
-  g_assert (G_N_ELEMENTS (program_definitions) == GL_N_PROGRAMS);
+  g_assert (prog->id == 0);
 
-#ifdef G_ENABLE_DEBUG
-  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), SHADERS))
-    shader_builder.debugging = TRUE;
-#endif
+  GSK_NOTE (SHADERS, g_message ("Linking %s program", program_definitions[index].name));
 
-  if (gdk_gl_context_get_use_es (self->gl_context))
-    {
+  prog->id = gsk_gl_shader_builder_create_program (&programs->shader_builder,
+                                                   program_definitions[index].resource_path,
+                                                   error);
+  if (prog->id < 0)
+    goto error;
 
-      gsk_gl_shader_builder_set_glsl_version (&shader_builder, SHADER_VERSION_GLES);
-      shader_builder.gles = TRUE;
-    }
-  else if (gdk_gl_context_is_legacy (self->gl_context))
-    {
-      int maj, min;
+  INIT_COMMON_UNIFORM_LOCATION (prog, alpha);
+  INIT_COMMON_UNIFORM_LOCATION (prog, source);
+  INIT_COMMON_UNIFORM_LOCATION (prog, clip_rect);
+  INIT_COMMON_UNIFORM_LOCATION (prog, outer_clip_rect);
+  INIT_COMMON_UNIFORM_LOCATION (prog, viewport);
+  INIT_COMMON_UNIFORM_LOCATION (prog, projection);
+  INIT_COMMON_UNIFORM_LOCATION (prog, modelview);
 
-      gdk_gl_context_get_version (self->gl_context, &maj, &min);
-
-      if (maj == 3)
-        gsk_gl_shader_builder_set_glsl_version (&shader_builder, SHADER_VERSION_GL3_LEGACY);
-      else
-        gsk_gl_shader_builder_set_glsl_version (&shader_builder, SHADER_VERSION_GL2_LEGACY);
-
-      shader_builder.legacy = TRUE;
-    }
-  else
-    {
-      gsk_gl_shader_builder_set_glsl_version (&shader_builder, SHADER_VERSION_GL3);
-      shader_builder.gl3 = TRUE;
-    }
-
-  programs = gsk_gl_renderer_programs_new ();
-
-  for (i = 0; i < GL_N_PROGRAMS; i ++)
-    {
-      Program *prog = &programs->programs[i];
-
-      prog->index = i;
-      prog->id = gsk_gl_shader_builder_create_program (&shader_builder,
-                                                       program_definitions[i].resource_path,
-                                                       error);
-      if (prog->id < 0)
-        {
-          g_clear_pointer (&programs, gsk_gl_renderer_programs_unref);
-          goto out;
-        }
-
-      INIT_COMMON_UNIFORM_LOCATION (prog, alpha);
-      INIT_COMMON_UNIFORM_LOCATION (prog, source);
-      INIT_COMMON_UNIFORM_LOCATION (prog, clip_rect);
-      INIT_COMMON_UNIFORM_LOCATION (prog, viewport);
-      INIT_COMMON_UNIFORM_LOCATION (prog, projection);
-      INIT_COMMON_UNIFORM_LOCATION (prog, modelview);
-    }
   /* color */
   INIT_PROGRAM_UNIFORM_LOCATION (color, color);
 
@@ -3025,14 +3283,12 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
   INIT_PROGRAM_UNIFORM_LOCATION (color_matrix, color_offset);
 
   /* linear gradient */
-  INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, color_stops);
-  INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, num_color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, ramp_y);
   INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, start_point);
   INIT_PROGRAM_UNIFORM_LOCATION (linear_gradient, end_point);
 
   /* radial gradient */
-  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, color_stops);
-  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, num_color_stops);
+  INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, ramp_y);
   INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, center);
   INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, start);
   INIT_PROGRAM_UNIFORM_LOCATION (radial_gradient, end);
@@ -3060,7 +3316,7 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
   INIT_PROGRAM_UNIFORM_LOCATION (unblurred_outset_shadow, outline_rect);
 
   /* border */
-  INIT_PROGRAM_UNIFORM_LOCATION (border, color);
+  INIT_PROGRAM_UNIFORM_LOCATION (border, colors);
   INIT_PROGRAM_UNIFORM_LOCATION (border, widths);
   INIT_PROGRAM_UNIFORM_LOCATION (border, outline_rect);
 
@@ -3076,22 +3332,99 @@ gsk_gl_renderer_create_programs (GskGLRenderer  *self,
   INIT_PROGRAM_UNIFORM_LOCATION (repeat, child_bounds);
   INIT_PROGRAM_UNIFORM_LOCATION (repeat, texture_rect);
 
-
   /* We initialize the alpha uniform here, since the default value is important.
    * We can't do it in the shader like a reasonable person would because that doesn't
    * work in gles. */
-  for (i = 0; i < GL_N_PROGRAMS; i++)
-    {
-      glUseProgram(programs->programs[i].id);
-      glUniform1f (programs->programs[i].alpha_location, 1.0);
-    }
+  glUseProgram (prog->id);
+  glUniform1f (prog->alpha_location, 1.0);
+
+  return TRUE;
 
-out:
-  gsk_gl_shader_builder_finish (&shader_builder);
+error:
+  if (prog->id > 0)
+    glDeleteProgram (prog->id);
+  prog->id = -1;
 
   if (error && !(*error))
     g_set_error (error, GDK_GL_ERROR, GDK_GL_ERROR_COMPILATION_FAILED,
-                 "Failed to compile all shader programs"); /* Probably, eh. */
+                 "Failed to compile the %s program", program_definitions[index].name);
+
+  return FALSE;
+}
+
+static GskGLRendererPrograms *
+gsk_gl_renderer_create_programs (GskGLRenderer  *self,
+                                 GError        **error)
+{
+  GskGLShaderBuilder *shader_builder;
+  GskGLRendererPrograms *programs;
+  int i;
+
+  g_assert (G_N_ELEMENTS (program_definitions) == GL_N_PROGRAMS);
+
+  programs = gsk_gl_renderer_programs_new ();
+  shader_builder = &programs->shader_builder;
+
+  gsk_gl_shader_builder_init (shader_builder,
+                              "/org/gtk/libgsk/glsl/preamble.glsl",
+                              "/org/gtk/libgsk/glsl/preamble.vs.glsl",
+                              "/org/gtk/libgsk/glsl/preamble.fs.glsl");
+
+#ifdef G_ENABLE_DEBUG
+  if (GSK_RENDERER_DEBUG_CHECK (GSK_RENDERER (self), SHADERS))
+    shader_builder->debugging = TRUE;
+#endif
+
+  if (gdk_gl_context_get_use_es (self->gl_context))
+    {
+
+      gsk_gl_shader_builder_set_glsl_version (shader_builder, SHADER_VERSION_GLES);
+      shader_builder->gles = TRUE;
+    }
+  else if (gdk_gl_context_is_legacy (self->gl_context))
+    {
+      int maj, min;
+
+      gdk_gl_context_get_version (self->gl_context, &maj, &min);
+
+      if (maj == 3)
+        gsk_gl_shader_builder_set_glsl_version (shader_builder, SHADER_VERSION_GL3_LEGACY);
+      else
+        gsk_gl_shader_builder_set_glsl_version (shader_builder, SHADER_VERSION_GL2_LEGACY);
+
+      shader_builder->legacy = TRUE;
+    }
+  else
+    {
+      gsk_gl_shader_builder_set_glsl_version (shader_builder, SHADER_VERSION_GL3);
+      shader_builder->gl3 = TRUE;
+    }
+
+  gsk_gl_shader_builder_init_binary_cache (shader_builder);
+
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    programs->programs[i].index = i;
+
+  /* Programs we have a binary for are cheap to load, so we do it
+   * right away. Everything else gets compiled and linked when it is
+   * used for the first time. The blit program is needed by every
+   * frame, and linking it up front still lets us fail realize on
+   * drivers that can't handle our shaders. */
+  for (i = 0; i < GL_N_PROGRAMS; i ++)
+    {
+      Program *prog = &programs->programs[i];
+
+      if (prog != &programs->blit_program &&
+          !gsk_gl_shader_builder_has_cached_program (shader_builder,
+                                                     program_definitions[i].resource_path))
+        continue;
+
+      if (!gsk_gl_renderer_programs_link (programs, i, error))
+        {
+          g_clear_pointer (&programs, gsk_gl_renderer_programs_unref);
+          break;
+        }
+    }
 
   return programs;
 }
@@ -3184,6 +3517,107 @@ get_icon_cache_for_display (GdkDisplay *display,
   return gsk_gl_icon_cache_ref (icon_cache);
 }
 
+static void
+low_memory_warning_cb (GMemoryMonitor             *monitor,
+                       GMemoryMonitorWarningLevel  level,
+                       gpointer                    user_data)
+{
+  GskGLMemoryBudget *budget = user_data;
+
+  /* Renderers trim their caches at the start of their next frame,
+   * when their GL context is current.
+   */
+  budget->low_memory_serial++;
+}
+
+static GskGLMemoryBudget *
+gsk_gl_memory_budget_new (void)
+{
+  GskGLMemoryBudget *budget;
+  const char *env;
+
+  budget = g_new0 (GskGLMemoryBudget, 1);
+  budget->ref_count = 1;
+  budget->renderers = g_ptr_array_new ();
+
+  env = g_getenv ("GSK_GL_MEMORY_BUDGET");
+  if (env != NULL)
+    budget->budget = (gsize) g_ascii_strtoull (env, NULL, 10) * 1024 * 1024;
+
+  budget->monitor = g_memory_monitor_dup_default ();
+  budget->low_memory_handler = g_signal_connect (budget->monitor, "low-memory-warning",
+                                                 G_CALLBACK (low_memory_warning_cb), budget);
+
+  return budget;
+}
+
+static GskGLMemoryBudget *
+gsk_gl_memory_budget_ref (GskGLMemoryBudget *budget)
+{
+  budget->ref_count++;
+
+  return budget;
+}
+
+static void
+gsk_gl_memory_budget_unref (GskGLMemoryBudget *budget)
+{
+  g_assert (budget->ref_count > 0);
+
+  if (budget->ref_count == 1)
+    {
+      g_clear_signal_handler (&budget->low_memory_handler, budget->monitor);
+      g_object_unref (budget->monitor);
+      g_ptr_array_unref (budget->renderers);
+      g_free (budget);
+      return;
+    }
+
+  budget->ref_count--;
+}
+
+static GskGLMemoryBudget *
+get_memory_budget_for_display (GdkDisplay *display)
+{
+  GskGLMemoryBudget *budget;
+
+  if (g_getenv ("GSK_NO_SHARED_CACHES"))
+    return gsk_gl_memory_budget_new ();
+
+  budget = (GskGLMemoryBudget *)g_object_get_data (G_OBJECT (display), "gsk-gl-memory-budget");
+  if (budget == NULL)
+    {
+      budget = gsk_gl_memory_budget_new ();
+      g_object_set_data_full (G_OBJECT (display), "gsk-gl-memory-budget",
+                              budget,
+                              (GDestroyNotify) gsk_gl_memory_budget_unref);
+    }
+
+  return gsk_gl_memory_budget_ref (budget);
+}
+
+/* The texture atlases are shared by all renderers of the display,
+ * everything else is owned by the renderers' drivers.
+ */
+static gsize
+gsk_gl_memory_budget_get_usage (GskGLMemoryBudget   *budget,
+                                GskGLTextureAtlases *atlases)
+{
+  gsize usage;
+  guint i;
+
+  usage = gsk_gl_texture_atlases_get_memory (atlases);
+
+  for (i = 0; i < budget->renderers->len; i++)
+    {
+      GskGLRenderer *renderer = g_ptr_array_index (budget->renderers, i);
+
+      usage += gsk_gl_driver_get_texture_memory (renderer->gl_driver);
+    }
+
+  return usage;
+}
+
 static gboolean
 gsk_gl_renderer_realize (GskRenderer  *renderer,
                          GdkSurface    *surface,
@@ -3217,11 +3651,18 @@ gsk_gl_renderer_realize (GskRenderer  *renderer,
   if (self->programs == NULL)
     return FALSE;
   self->op_builder.programs = self->programs;
+  self->op_builder.program_state = self->programs->state;
 
   self->atlases = get_texture_atlases_for_display (gdk_surface_get_display (surface));
   self->glyph_cache = get_glyph_cache_for_display (gdk_surface_get_display (surface), self->atlases);
   self->icon_cache = get_icon_cache_for_display (gdk_surface_get_display (surface), self->atlases);
   gsk_gl_shadow_cache_init (&self->shadow_cache);
+  gsk_gl_offscreen_cache_init (&self->offscreen_cache);
+  gsk_gl_gradient_cache_init (&self->gradient_cache);
+
+  self->memory_budget = get_memory_budget_for_display (gdk_surface_get_display (surface));
+  self->low_memory_serial = self->memory_budget->low_memory_serial;
+  g_ptr_array_add (self->memory_budget->renderers, self);
 
   gdk_profiler_end_mark (before, "gl renderer realize", NULL);
 
@@ -3243,12 +3684,35 @@ gsk_gl_renderer_unrealize (GskRenderer *renderer)
    */
   ops_reset (&self->op_builder);
   self->op_builder.programs = NULL;
+  self->op_builder.program_state = NULL;
+
+  if (self->build_pool)
+    {
+      g_thread_pool_free (self->build_pool, FALSE, TRUE);
+      self->build_pool = NULL;
+    }
+
+  if (self->fallback_pool)
+    {
+      g_thread_pool_free (self->fallback_pool, FALSE, TRUE);
+      gsk_gl_renderer_upload_fallbacks (self);
+      g_clear_pointer (&self->finished_fallbacks, g_async_queue_unref);
+      self->fallback_pool = NULL;
+    }
 
   g_clear_pointer (&self->programs, gsk_gl_renderer_programs_unref);
   g_clear_pointer (&self->glyph_cache, gsk_gl_glyph_cache_unref);
   g_clear_pointer (&self->icon_cache, gsk_gl_icon_cache_unref);
   g_clear_pointer (&self->atlases, gsk_gl_texture_atlases_unref);
   gsk_gl_shadow_cache_free (&self->shadow_cache, self->gl_driver);
+  gsk_gl_offscreen_cache_free (&self->offscreen_cache, self->gl_driver);
+  gsk_gl_gradient_cache_free (&self->gradient_cache, self->gl_driver);
+
+  if (self->memory_budget)
+    {
+      g_ptr_array_remove (self->memory_budget->renderers, self);
+      g_clear_pointer (&self->memory_budget, gsk_gl_memory_budget_unref);
+    }
 
   g_clear_object (&self->gl_profiler);
   g_clear_object (&self->gl_driver);
@@ -3297,20 +3761,257 @@ gsk_gl_renderer_setup_render_mode (GskGLRenderer *self)
       GdkSurface *surface = gsk_renderer_get_surface (GSK_RENDERER (self));
       cairo_rectangle_int_t extents;
       int surface_height;
+      int x0, y0, x1, y1;
 
       g_assert (cairo_region_num_rectangles (self->render_region) == 1);
 
-      surface_height = gdk_surface_get_height (surface) * self->scale_factor;
+      gdk_surface_get_unscaled_size (surface, NULL, &surface_height);
       cairo_region_get_rectangle (self->render_region, 0, &extents);
 
+      /* The scale may be fractional, so grow the scissor to whole pixels */
+      x0 = floorf (extents.x * self->scale_factor);
+      y0 = floorf (extents.y * self->scale_factor);
+      x1 = ceilf ((extents.x + extents.width) * self->scale_factor);
+      y1 = ceilf ((extents.y + extents.height) * self->scale_factor);
+
       glEnable (GL_SCISSOR_TEST);
-      glScissor (extents.x * self->scale_factor,
-                 surface_height - (extents.height * self->scale_factor) - (extents.y * self->scale_factor),
-                 extents.width * self->scale_factor,
-                 extents.height * self->scale_factor);
+      glScissor (x0, surface_height - y1, x1 - x0, y1 - y0);
     }
 }
 
+/* Returns the number of nodes in @node, or 0 if building its ops
+ * needs more than the op builder, like the driver, one of the caches
+ * or GL. Only subtrees that need nothing else can be built on other
+ * threads.
+ *
+ * This assumes that the clip is rectilinear and has no outer clip,
+ * so that clip nodes never need an offscreen.
+ */
+static guint
+count_threadable_nodes (GskRenderNode *node)
+{
+  GskTransformCategory category;
+  guint i, n, count;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_COLOR_NODE:
+    case GSK_BORDER_NODE:
+      return 1;
+
+    case GSK_INSET_SHADOW_NODE:
+      return gsk_inset_shadow_node_get_blur_radius (node) > 0 ? 0 : 1;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      return gsk_outset_shadow_node_get_blur_radius (node) > 0 ? 0 : 1;
+
+    case GSK_CONTAINER_NODE:
+      count = 1;
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          n = count_threadable_nodes (gsk_container_node_get_child (node, i));
+          if (n == 0)
+            return 0;
+          count += n;
+        }
+      return count;
+
+    case GSK_TRANSFORM_NODE:
+      category = gsk_transform_get_category (gsk_transform_node_get_transform (node));
+      if (category != GSK_TRANSFORM_CATEGORY_IDENTITY &&
+          category != GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+        return 0;
+      n = count_threadable_nodes (gsk_transform_node_get_child (node));
+      return n > 0 ? n + 1 : 0;
+
+    case GSK_CLIP_NODE:
+      n = count_threadable_nodes (gsk_clip_node_get_child (node));
+      return n > 0 ? n + 1 : 0;
+
+    case GSK_DEBUG_NODE:
+      n = count_threadable_nodes (gsk_debug_node_get_child (node));
+      return n > 0 ? n + 1 : 0;
+
+    default:
+      return 0;
+    }
+}
+
+typedef struct
+{
+  GskGLRenderer *renderer;
+  GskRenderNode *node;
+  guint start; /* First child of node */
+  guint end;   /* Last child + 1 */
+  guint n_nodes;
+  RenderOpBuilder builder;
+  gboolean done;
+} BuildJob;
+
+static void
+build_ops_threaded (gpointer data,
+                    gpointer user_data)
+{
+  BuildJob *job = data;
+  GskGLRenderer *self = job->renderer;
+  guint i;
+
+  for (i = job->start; i < job->end; i++)
+    gsk_gl_renderer_add_render_ops (self,
+                                    gsk_container_node_get_child (job->node, i),
+                                    &job->builder);
+
+  g_mutex_lock (&self->build_lock);
+  job->done = TRUE;
+  g_cond_broadcast (&self->build_cond);
+  g_mutex_unlock (&self->build_lock);
+}
+
+/* The programs used by threadable nodes must be linked up front,
+ * linking needs GL */
+static gboolean
+ensure_threadable_programs (GskGLRenderer *self)
+{
+  const Program *programs[] = {
+    &self->programs->color_program,
+    &self->programs->border_program,
+    &self->programs->inset_shadow_program,
+    &self->programs->unblurred_outset_shadow_program,
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (programs); i++)
+    {
+      GError *error = NULL;
+
+      if (programs[i]->id != 0)
+        continue;
+
+      if (!gsk_gl_renderer_programs_link (self->programs, programs[i]->index, &error))
+        {
+          g_critical ("%s", error->message);
+          g_error_free (error);
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+queue_build_job (GskGLRenderer    *self,
+                 RenderOpBuilder  *builder,
+                 BuildJob        **jobs,
+                 BuildJob        **job)
+{
+  BuildJob *j = *job;
+
+  if (j == NULL)
+    return;
+
+  *job = NULL;
+
+  /* Not worth it, build it in place */
+  if (j->n_nodes < MIN_THREADED_BUILD_NODES)
+    {
+      jobs[j->start] = NULL;
+      g_slice_free (BuildJob, j);
+      return;
+    }
+
+  if (self->build_pool == NULL)
+    self->build_pool = g_thread_pool_new (build_ops_threaded, NULL,
+                                          CLAMP (g_get_num_processors () - 1, 1, MAX_BUILD_THREADS),
+                                          FALSE, NULL);
+
+  ops_fork (&j->builder, builder);
+  g_thread_pool_push (self->build_pool, j, NULL);
+}
+
+/* Children of big containers that only need the op builder are built
+ * into forked builders on other threads, in runs of siblings, while
+ * the remaining children are built here. The results are joined in
+ * order, which also tells the builder about the program state they
+ * leave behind.
+ */
+static void
+render_container_node (GskGLRenderer   *self,
+                       GskRenderNode   *node,
+                       RenderOpBuilder *builder)
+{
+  const guint n_children = gsk_container_node_get_n_children (node);
+  BuildJob **jobs;
+  BuildJob *job = NULL;
+  guint i;
+
+  /* Containers inside of a forked builder are built where they are */
+  if (builder != &self->op_builder ||
+      n_children < MIN_THREADED_BUILD_CHILDREN ||
+      g_get_num_processors () < 2 ||
+      !builder->clip_is_rectilinear ||
+      ops_has_outer_clip (builder) ||
+      !ensure_threadable_programs (self))
+    {
+      for (i = 0; i < n_children; i++)
+        gsk_gl_renderer_add_render_ops (self, gsk_container_node_get_child (node, i), builder);
+      return;
+    }
+
+  jobs = g_new0 (BuildJob *, n_children);
+
+  for (i = 0; i < n_children; i++)
+    {
+      guint n_nodes = count_threadable_nodes (gsk_container_node_get_child (node, i));
+
+      if (n_nodes == 0)
+        {
+          queue_build_job (self, builder, jobs, &job);
+          continue;
+        }
+
+      if (job == NULL)
+        {
+          job = g_slice_new0 (BuildJob);
+          job->renderer = self;
+          job->node = node;
+          job->start = i;
+          jobs[i] = job;
+        }
+
+      job->end = i + 1;
+      job->n_nodes += n_nodes;
+
+      if (job->n_nodes >= MAX_THREADED_BUILD_NODES)
+        queue_build_job (self, builder, jobs, &job);
+    }
+
+  queue_build_job (self, builder, jobs, &job);
+
+  for (i = 0; i < n_children; )
+    {
+      job = jobs[i];
+
+      if (job == NULL)
+        {
+          gsk_gl_renderer_add_render_ops (self, gsk_container_node_get_child (node, i), builder);
+          i++;
+          continue;
+        }
+
+      g_mutex_lock (&self->build_lock);
+      while (!job->done)
+        g_cond_wait (&self->build_cond, &self->build_lock);
+      g_mutex_unlock (&self->build_lock);
+
+      ops_join (builder, &job->builder);
+
+      i = job->end;
+      g_slice_free (BuildJob, job);
+    }
+
+  g_free (jobs);
+}
+
 static void
 gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
                                 GskRenderNode   *node,
@@ -3341,16 +4042,7 @@ gsk_gl_renderer_add_render_ops (GskGLRenderer   *self,
       g_assert_not_reached ();
 
     case GSK_CONTAINER_NODE:
-      {
-        guint i, p;
-
-        for (i = 0, p = gsk_container_node_get_n_children (node); i < p; i ++)
-          {
-            GskRenderNode *child = gsk_container_node_get_child (node, i);
-
-            gsk_gl_renderer_add_render_ops (self, child, builder);
-          }
-      }
+      render_container_node (self, node, builder);
     break;
 
     case GSK_DEBUG_NODE:
@@ -3475,9 +4167,11 @@ add_offscreen_ops (GskGLRenderer         *self,
   float prev_opacity = 1.0;
   int texture_id = 0;
   int max_texture_size;
+  guint n_incomplete_uploads;
   int filter;
   GskTextureKey key;
   int cached_id;
+  gboolean keep_for_later_frames;
 
   if (node_is_invisible (child_node))
     {
@@ -3504,11 +4198,19 @@ add_offscreen_ops (GskGLRenderer         *self,
   else
     filter = GL_NEAREST;
 
+  /* Offscreens that don't depend on the clip and opacity they are
+   * drawn with can be reused in later frames, too. */
+  keep_for_later_frames = (flags & (RESET_CLIP | RESET_OPACITY | NO_CACHE_PLZ)) == (RESET_CLIP | RESET_OPACITY);
+
   /* Check if we've already cached the drawn texture. */
   key.pointer = child_node;
   key.scale = ops_get_scale (builder);
   key.filter = filter;
-  cached_id = gsk_gl_driver_get_texture_for_key (self->gl_driver, &key);
+  if (keep_for_later_frames)
+    cached_id = gsk_gl_offscreen_cache_get_texture_id (&self->offscreen_cache,
+                                                       child_node, key.scale, filter, 0);
+  else
+    cached_id = gsk_gl_driver_get_texture_for_key (self->gl_driver, &key);
 
   if (cached_id != 0)
     {
@@ -3581,6 +4283,7 @@ add_offscreen_ops (GskGLRenderer         *self,
   if (flags & RESET_OPACITY)
     prev_opacity = ops_set_opacity (builder, 1.0);
 
+  n_incomplete_uploads = self->n_incomplete_uploads;
   gsk_gl_renderer_add_render_ops (self, child_node, builder);
 
 #ifdef G_ENABLE_DEBUG
@@ -3613,7 +4316,13 @@ add_offscreen_ops (GskGLRenderer         *self,
   *is_offscreen = TRUE;
   init_full_texture_region (texture_region_out, texture_id);
 
-  if ((flags & NO_CACHE_PLZ) == 0)
+  /* Don't keep around offscreens of textures that are still being streamed */
+  if (self->n_incomplete_uploads != n_incomplete_uploads)
+    ;
+  else if (keep_for_later_frames)
+    gsk_gl_offscreen_cache_commit (&self->offscreen_cache, self->gl_driver,
+                                   child_node, key.scale, filter, 0, texture_id);
+  else if ((flags & NO_CACHE_PLZ) == 0)
     gsk_gl_driver_set_texture_for_key (self->gl_driver, &key, texture_id);
 
   return TRUE;
@@ -3684,6 +4393,9 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
             const OpProgram *op = ptr;
             apply_program_op (program, op);
             program = op->program;
+#ifdef G_ENABLE_DEBUG
+            gsk_gl_profiler_switch_subregion (self->gl_profiler, program->index);
+#endif
             break;
           }
 
@@ -3816,12 +4528,92 @@ gsk_gl_renderer_render_ops (GskGLRenderer *self)
   glDeleteBuffers (1, &buffer_id);
 }
 
+/* Caches only keep entries around as long as they are used every few
+ * frames. If the display goes over its memory budget, or the system
+ * runs low on memory, we evict entries that have been used less
+ * recently as well, the least recently used ones first.
+ */
+static void
+gsk_gl_renderer_enforce_memory_budget (GskGLRenderer *self)
+{
+  GskGLMemoryBudget *budget = self->memory_budget;
+  gboolean low_memory;
+  gsize usage;
+  int max_unused_frames;
+
+  low_memory = self->low_memory_serial != budget->low_memory_serial;
+  self->low_memory_serial = budget->low_memory_serial;
+
+  usage = gsk_gl_memory_budget_get_usage (budget, self->atlases);
+
+  if (low_memory)
+    {
+      GSK_RENDERER_NOTE (GSK_RENDERER (self), OPENGL,
+                         g_message ("Low memory, trimming caches (%" G_GSIZE_FORMAT " kB used)", usage / 1024));
+
+      gsk_gl_shadow_cache_trim (&self->shadow_cache, self->gl_driver, 1);
+      gsk_gl_offscreen_cache_trim (&self->offscreen_cache, self->gl_driver, 1);
+      gsk_gl_driver_trim_render_target_pool (self->gl_driver, 0);
+      gsk_gl_texture_atlases_trim (self->atlases);
+    }
+  else if (budget->budget > 0 && usage > budget->budget)
+    {
+      GSK_RENDERER_NOTE (GSK_RENDERER (self), OPENGL,
+                         g_message ("Over memory budget (%" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " kB used)",
+                                    usage / 1024, budget->budget / 1024));
+
+      for (max_unused_frames = 32; max_unused_frames >= 1; max_unused_frames /= 2)
+        {
+          guint dropped;
+
+          dropped = gsk_gl_shadow_cache_trim (&self->shadow_cache, self->gl_driver, max_unused_frames);
+          dropped += gsk_gl_offscreen_cache_trim (&self->offscreen_cache, self->gl_driver, max_unused_frames);
+          dropped += gsk_gl_driver_trim_render_target_pool (self->gl_driver, max_unused_frames);
+
+          if (dropped == 0)
+            continue;
+
+          usage = gsk_gl_memory_budget_get_usage (budget, self->atlases);
+          if (usage <= budget->budget)
+            break;
+        }
+
+      if (usage > budget->budget)
+        gsk_gl_texture_atlases_trim (self->atlases);
+    }
+
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_set (gsk_renderer_get_profiler (GSK_RENDERER (self)),
+                            self->profile_counters.texture_memory,
+                            usage / 1024);
+#endif
+}
+
+static void
+gsk_gl_renderer_begin_frame (GskGLRenderer *self)
+{
+  GPtrArray *removed;
+
+  gsk_gl_driver_begin_frame (self->gl_driver);
+
+  removed = g_ptr_array_new ();
+  gsk_gl_texture_atlases_begin_frame (self->atlases, removed);
+  gsk_gl_glyph_cache_begin_frame (self->glyph_cache, self->gl_driver, removed);
+  gsk_gl_icon_cache_begin_frame (self->icon_cache, removed);
+  gsk_gl_texture_atlases_end_moves (self->atlases);
+  gsk_gl_shadow_cache_begin_frame (&self->shadow_cache, self->gl_driver);
+  gsk_gl_offscreen_cache_begin_frame (&self->offscreen_cache, self->gl_driver);
+  gsk_gl_gradient_cache_begin_frame (&self->gradient_cache);
+  gsk_gl_renderer_enforce_memory_budget (self);
+  g_ptr_array_unref (removed);
+}
+
 static void
 gsk_gl_renderer_do_render (GskRenderer           *renderer,
                            GskRenderNode         *root,
                            const graphene_rect_t *viewport,
                            int                    fbo_id,
-                           int                    scale_factor)
+                           float                  scale_factor)
 {
   GskGLRenderer *self = GSK_GL_RENDERER (renderer);
   graphene_matrix_t projection;
@@ -3830,7 +4622,8 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   gint64 gpu_time, cpu_time;
   gint64 start_time G_GNUC_UNUSED;
 #endif
-  GPtrArray *removed;
+  guint n_merged G_GNUC_UNUSED;
+  gint64 before G_GNUC_UNUSED;
 
 #ifdef G_ENABLE_DEBUG
   profiler = gsk_renderer_get_profiler (renderer);
@@ -3854,13 +4647,6 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
                               ORTHO_FAR_PLANE);
   graphene_matrix_scale (&projection, 1, -1, 1);
 
-  removed = g_ptr_array_new ();
-  gsk_gl_texture_atlases_begin_frame (self->atlases, removed);
-  gsk_gl_glyph_cache_begin_frame (self->glyph_cache, self->gl_driver, removed);
-  gsk_gl_icon_cache_begin_frame (self->icon_cache, removed);
-  gsk_gl_shadow_cache_begin_frame (&self->shadow_cache, self->gl_driver);
-  g_ptr_array_unref (removed);
-
   ops_set_projection (&self->op_builder, &projection);
   ops_set_viewport (&self->op_builder, viewport);
   ops_set_modelview (&self->op_builder, gsk_transform_scale (NULL, scale_factor, scale_factor));
@@ -3897,9 +4683,11 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   if (fbo_id != 0)
     ops_set_render_target (&self->op_builder, fbo_id);
 
+  before = gdk_profiler_trace_begin ();
   gdk_gl_context_push_debug_group (self->gl_context, "Adding render ops");
   gsk_gl_renderer_add_render_ops (self, root, &self->op_builder);
   gdk_gl_context_pop_debug_group (self->gl_context);
+  gdk_profiler_trace_end (before, "GL build ops");
 
   /* We correctly reset the state everywhere */
   g_assert_cmpint (self->op_builder.current_render_target, ==, fbo_id);
@@ -3909,6 +4697,18 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
 
   /*g_message ("Ops: %u", self->render_ops->len);*/
 
+  /* Glyphs and fallback nodes were rasterized in the background
+   * while we built the ops */
+  gsk_gl_glyph_cache_flush (self->glyph_cache);
+  gsk_gl_renderer_upload_fallbacks (self);
+
+  n_merged = op_buffer_merge_draws (ops_get_buffer (&self->op_builder),
+                                    self->op_builder.vertices);
+  GSK_RENDERER_NOTE (renderer, OPENGL, g_message ("Merged %u draws", n_merged));
+#ifdef G_ENABLE_DEBUG
+  gsk_profiler_counter_set (profiler, self->profile_counters.merged_draws, n_merged);
+#endif
+
   /* Now actually draw things... */
 #ifdef G_ENABLE_DEBUG
   gsk_gl_profiler_begin_gpu_region (self->gl_profiler);
@@ -3931,9 +4731,11 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
   glBlendEquation (GL_FUNC_ADD);
 
+  before = gdk_profiler_trace_begin ();
   gdk_gl_context_push_debug_group (self->gl_context, "Rendering ops");
   gsk_gl_renderer_render_ops (self);
   gdk_gl_context_pop_debug_group (self->gl_context);
+  gdk_profiler_trace_end (before, "GL submit ops");
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
@@ -3942,8 +4744,13 @@ gsk_gl_renderer_do_render (GskRenderer           *renderer,
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
   gsk_profiler_timer_set (profiler, self->profile_timers.cpu_time, cpu_time);
 
+  gsk_gl_profiler_switch_subregion (self->gl_profiler, -1);
   gpu_time = gsk_gl_profiler_end_gpu_region (self->gl_profiler);
   gsk_profiler_timer_set (profiler, self->profile_timers.gpu_time, gpu_time);
+  for (int i = 0; i < GL_N_PROGRAMS; i++)
+    gsk_profiler_timer_set (profiler, self->profile_timers.program_gpu_time[i],
+                            gsk_gl_profiler_get_subregion_time (self->gl_profiler, i));
+  gsk_renderer_set_gpu_time (renderer, gpu_time);
 
   gsk_profiler_push_samples (profiler);
 
@@ -3973,10 +4780,10 @@ gsk_gl_renderer_render_texture (GskRenderer           *renderer,
   width = ceilf (viewport->size.width);
   height = ceilf (viewport->size.height);
 
-  self->scale_factor = gdk_surface_get_scale_factor (gsk_renderer_get_surface (renderer));
+  self->scale_factor = gdk_surface_get_scale (gsk_renderer_get_surface (renderer));
 
   /* Prepare our framebuffer */
-  gsk_gl_driver_begin_frame (self->gl_driver);
+  gsk_gl_renderer_begin_frame (self);
   glGenTextures (1, &texture_id);
   glBindTexture (GL_TEXTURE_2D, texture_id);
 
@@ -4021,6 +4828,34 @@ gsk_gl_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+#define MAX_DAMAGE_RECTS 4
+
+/* Whether the damage is made up of a few rectangles that cover
+ * a lot less than their extents. */
+static gboolean
+damage_is_sparse (const cairo_region_t *damage)
+{
+  GdkRectangle extents;
+  gint64 area = 0;
+  int i, n_rects;
+
+  n_rects = cairo_region_num_rectangles (damage);
+  if (n_rects < 2 || n_rects > MAX_DAMAGE_RECTS)
+    return FALSE;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GdkRectangle rect;
+
+      cairo_region_get_rectangle (damage, i, &rect);
+      area += (gint64) rect.width * rect.height;
+    }
+
+  cairo_region_get_extents (damage, &extents);
+
+  return area * 2 < (gint64) extents.width * extents.height;
+}
+
 static void
 gsk_gl_renderer_render (GskRenderer          *renderer,
                         GskRenderNode        *root,
@@ -4040,20 +4875,52 @@ gsk_gl_renderer_render (GskRenderer          *renderer,
                                           "Render root node %p", root);
 
   surface = gsk_renderer_get_surface (renderer);
-  whole_surface = (GdkRectangle) {
-                      0, 0,
-                      gdk_surface_get_width (surface) * self->scale_factor,
-                      gdk_surface_get_height (surface) * self->scale_factor
-                  };
+  whole_surface.x = 0;
+  whole_surface.y = 0;
+  gdk_surface_get_unscaled_size (surface, &whole_surface.width, &whole_surface.height);
 
   gdk_draw_context_begin_frame (GDK_DRAW_CONTEXT (self->gl_context),
                                 update_area);
 
   damage = gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->gl_context));
 
+  self->scale_factor = gdk_surface_get_scale (surface);
+  gdk_gl_context_make_current (self->gl_context);
+
+  viewport.origin.x = 0;
+  viewport.origin.y = 0;
+  viewport.size.width = whole_surface.width;
+  viewport.size.height = whole_surface.height;
+
+  gsk_gl_renderer_begin_frame (self);
+  self->n_incomplete_uploads = 0;
+
   if (cairo_region_contains_rectangle (damage, &whole_surface) == CAIRO_REGION_OVERLAP_IN)
     {
       self->render_region = NULL;
+      gsk_gl_renderer_do_render (renderer, root, &viewport, 0, self->scale_factor);
+    }
+  else if (damage_is_sparse (damage))
+    {
+      int i;
+
+      /* Small, far apart damage areas, e.g. a blinking cursor and a
+       * clock. Rendering them one by one is cheaper than redrawing
+       * everything between them, since we cull everything outside
+       * of the clip anyway. */
+      for (i = 0; i < cairo_region_num_rectangles (damage); i++)
+        {
+          GdkRectangle rect;
+
+          cairo_region_get_rectangle (damage, i, &rect);
+
+          if (i > 0)
+            ops_reset (&self->op_builder);
+
+          self->render_region = cairo_region_create_rectangle (&rect);
+          gsk_gl_renderer_do_render (renderer, root, &viewport, 0, self->scale_factor);
+          g_clear_pointer (&self->render_region, cairo_region_destroy);
+        }
     }
   else
     {
@@ -4065,23 +4932,19 @@ gsk_gl_renderer_render (GskRenderer          *renderer,
         self->render_region = NULL;
       else
         self->render_region = cairo_region_create_rectangle (&extents);
-    }
-
-  self->scale_factor = gdk_surface_get_scale_factor (surface);
-  gdk_gl_context_make_current (self->gl_context);
 
-  viewport.origin.x = 0;
-  viewport.origin.y = 0;
-  viewport.size.width = gdk_surface_get_width (surface) * self->scale_factor;
-  viewport.size.height = gdk_surface_get_height (surface) * self->scale_factor;
+      gsk_gl_renderer_do_render (renderer, root, &viewport, 0, self->scale_factor);
+    }
 
-  gsk_gl_driver_begin_frame (self->gl_driver);
-  gsk_gl_renderer_do_render (renderer, root, &viewport, 0, self->scale_factor);
   gsk_gl_driver_end_frame (self->gl_driver);
 
   gsk_gl_renderer_clear_tree (self);
 
   gdk_draw_context_end_frame (GDK_DRAW_CONTEXT (self->gl_context));
+
+  /* Keep drawing frames until the streamed textures are complete */
+  if (self->n_incomplete_uploads > 0)
+    gdk_surface_invalidate_rect (surface, NULL);
   gdk_gl_context_make_current (self->gl_context);
 
   gdk_gl_context_pop_debug_group (self->gl_context);
@@ -4111,14 +4974,31 @@ gsk_gl_renderer_init (GskGLRenderer *self)
   ops_init (&self->op_builder);
   self->op_builder.renderer = self;
 
+  g_mutex_init (&self->build_lock);
+  g_cond_init (&self->build_cond);
+
 #ifdef G_ENABLE_DEBUG
   {
     GskProfiler *profiler = gsk_renderer_get_profiler (GSK_RENDERER (self));
 
     self->profile_counters.frames = gsk_profiler_add_counter (profiler, "frames", "Frames", FALSE);
+    self->profile_counters.merged_draws = gsk_profiler_add_counter (profiler, "merged-draws", "Merged draws", TRUE);
+    self->profile_counters.texture_memory = gsk_profiler_add_counter (profiler, "texture-memory", "Texture memory (kB)", FALSE);
 
     self->profile_timers.cpu_time = gsk_profiler_add_timer (profiler, "cpu-time", "CPU time", FALSE, TRUE);
     self->profile_timers.gpu_time = gsk_profiler_add_timer (profiler, "gpu-time", "GPU time", FALSE, TRUE);
+
+    G_STATIC_ASSERT (GL_N_PROGRAMS <= GSK_GL_PROFILER_MAX_SUBREGIONS);
+    for (int i = 0; i < GL_N_PROGRAMS; i++)
+      {
+        char *name = g_strdup_printf ("gpu-time-%s", program_definitions[i].name);
+        char *description = g_strdup_printf ("GPU time (%s)", program_definitions[i].name);
+
+        self->profile_timers.program_gpu_time[i] = gsk_profiler_add_timer (profiler, name, description, FALSE, TRUE);
+
+        g_free (description);
+        g_free (name);
+      }
   }
 #endif
 }
@@ -4,9 +4,17 @@
 typedef struct
 {
   GskRoundedRect rect;
+  /* Fragments are additionally clipped to this. It is
+   * NO_OUTER_CLIP unless has_outer_clip is set */
+  GskRoundedRect outer_clip;
   bool is_rectilinear;
+  bool has_outer_clip;
 } ClipStackEntry;
 
+/* Large enough to cover any render target */
+static const GskRoundedRect NO_OUTER_CLIP =
+  GSK_ROUNDED_RECT_INIT (-1e7, -1e7, 2e7, 2e7);
+
 static inline gboolean
 rect_equal (const graphene_rect_t *a,
             const graphene_rect_t *b)
@@ -60,7 +68,7 @@ get_current_program_state (RenderOpBuilder *builder)
   if (!builder->current_program)
     return NULL;
 
-  return &builder->programs->state[builder->current_program->index];
+  return &builder->program_state[builder->current_program->index];
 }
 
 void
@@ -80,6 +88,7 @@ ops_finish (RenderOpBuilder *builder)
   builder->scale_y = 1;
   builder->current_modelview = NULL;
   builder->current_clip = NULL;
+  builder->current_outer_clip = NULL;
   builder->clip_is_rectilinear = TRUE;
   builder->current_render_target = 0;
   builder->current_texture = 0;
@@ -226,12 +235,23 @@ ops_set_program (RenderOpBuilder *builder,
   if (builder->current_program == program)
     return;
 
+  if (G_UNLIKELY (program->id == 0))
+    {
+      GError *error = NULL;
+
+      if (!gsk_gl_renderer_programs_link (builder->programs, program->index, &error))
+        {
+          g_critical ("%s", error->message);
+          g_error_free (error);
+        }
+    }
+
   op = ops_begin (builder, OP_CHANGE_PROGRAM);
   op->program = program;
 
   builder->current_program = program;
 
-  program_state = &builder->programs->state[program->index];
+  program_state = &builder->program_state[program->index];
 
   if (memcmp (&builder->current_projection, &program_state->projection, sizeof (graphene_matrix_t)) != 0)
     {
@@ -262,14 +282,18 @@ ops_set_program (RenderOpBuilder *builder,
       program_state->viewport = builder->current_viewport;
     }
 
-  if (!rounded_rect_equal (builder->current_clip, &program_state->clip))
+  if (!rounded_rect_equal (builder->current_clip, &program_state->clip) ||
+      !rounded_rect_equal (builder->current_outer_clip, &program_state->outer_clip))
     {
       OpClip *opc;
 
       opc = ops_begin (builder, OP_CHANGE_CLIP);
       opc->clip = *builder->current_clip;
+      opc->outer_clip = *builder->current_outer_clip;
       opc->send_corners = !rounded_rect_corners_equal (builder->current_clip, &program_state->clip);
+      opc->send_outer_clip = !rounded_rect_equal (builder->current_outer_clip, &program_state->outer_clip);
       program_state->clip = *builder->current_clip;
+      program_state->outer_clip = *builder->current_outer_clip;
     }
 
   if (program_state->opacity != builder->current_opacity)
@@ -284,13 +308,19 @@ ops_set_program (RenderOpBuilder *builder,
 
 static void
 ops_set_clip (RenderOpBuilder      *builder,
-              const GskRoundedRect *clip)
+              const GskRoundedRect *clip,
+              const GskRoundedRect *outer_clip)
 {
   ProgramState *current_program_state = get_current_program_state (builder);
+  gboolean clip_changed, outer_clip_changed;
   OpClip *op;
 
-  if (current_program_state &&
-      rounded_rect_equal (&current_program_state->clip, clip))
+  clip_changed = !current_program_state ||
+                 !rounded_rect_equal (&current_program_state->clip, clip);
+  outer_clip_changed = !current_program_state ||
+                       !rounded_rect_equal (&current_program_state->outer_clip, outer_clip);
+
+  if (!clip_changed && !outer_clip_changed)
     return;
 
   if (!(op = op_buffer_peek_tail_checked (&builder->render_ops, OP_CHANGE_CLIP)))
@@ -298,37 +328,99 @@ ops_set_clip (RenderOpBuilder      *builder,
       op = op_buffer_add (&builder->render_ops, OP_CHANGE_CLIP);
       op->send_corners = !current_program_state ||
                          !rounded_rect_corners_equal (&current_program_state->clip, clip);
+      op->send_outer_clip = outer_clip_changed;
     }
   else
     {
       /* If the op before sent the corners, this one needs, too */
       op->send_corners |= !current_program_state ||
                           !rounded_rect_corners_equal (&current_program_state->clip, clip);
+      op->send_outer_clip |= outer_clip_changed;
     }
 
   op->clip = *clip;
+  op->outer_clip = *outer_clip;
 
   if (current_program_state)
-    current_program_state->clip = *clip;
+    {
+      current_program_state->clip = *clip;
+      current_program_state->outer_clip = *outer_clip;
+    }
 }
 
-void
-ops_push_clip (RenderOpBuilder      *self,
-               const GskRoundedRect *clip)
+static void
+ops_push_clip_entry (RenderOpBuilder      *self,
+                     const ClipStackEntry *entry)
 {
-  ClipStackEntry entry;
+  const ClipStackEntry *head;
 
   if (G_UNLIKELY (self->clip_stack == NULL))
     self->clip_stack = g_array_new (FALSE, TRUE, sizeof (ClipStackEntry));
 
   g_assert (self->clip_stack != NULL);
 
+  g_array_append_val (self->clip_stack, *entry);
+  head = &g_array_index (self->clip_stack, ClipStackEntry, self->clip_stack->len - 1);
+  self->current_clip = &head->rect;
+  self->current_outer_clip = &head->outer_clip;
+  self->clip_is_rectilinear = head->is_rectilinear;
+  ops_set_clip (self, &head->rect, &head->outer_clip);
+}
+
+/* Replaces the current clip, e.g. when switching to an offscreen */
+void
+ops_push_clip (RenderOpBuilder      *self,
+               const GskRoundedRect *clip)
+{
+  ClipStackEntry entry;
+
   entry.rect = *clip;
+  entry.outer_clip = NO_OUTER_CLIP;
   entry.is_rectilinear = gsk_rounded_rect_is_rectilinear (clip);
-  g_array_append_val (self->clip_stack, entry);
-  self->current_clip = &g_array_index (self->clip_stack, ClipStackEntry, self->clip_stack->len - 1).rect;
-  self->clip_is_rectilinear = entry.is_rectilinear;
-  ops_set_clip (self, clip);
+  entry.has_outer_clip = FALSE;
+
+  ops_push_clip_entry (self, &entry);
+}
+
+/* Pushes a clip that is contained in the current clip, keeping
+ * the current outer clip, if any */
+void
+ops_push_nested_clip (RenderOpBuilder      *self,
+                      const GskRoundedRect *clip)
+{
+  const ClipStackEntry *head;
+
+  if (self->clip_stack == NULL || self->clip_stack->len == 0)
+    {
+      ops_push_clip (self, clip);
+      return;
+    }
+
+  head = &g_array_index (self->clip_stack, ClipStackEntry, self->clip_stack->len - 1);
+  if (!head->has_outer_clip)
+    {
+      ops_push_clip (self, clip);
+      return;
+    }
+
+  ops_push_clip_with_outer (self, clip, &head->outer_clip);
+}
+
+/* Clips to the intersection of @clip and @outer_clip. Both are
+ * evaluated in the shaders, so this doesn't need an offscreen */
+void
+ops_push_clip_with_outer (RenderOpBuilder      *self,
+                          const GskRoundedRect *clip,
+                          const GskRoundedRect *outer_clip)
+{
+  ClipStackEntry entry;
+
+  entry.rect = *clip;
+  entry.outer_clip = *outer_clip;
+  entry.is_rectilinear = FALSE;
+  entry.has_outer_clip = TRUE;
+
+  ops_push_clip_entry (self, &entry);
 }
 
 void
@@ -345,12 +437,14 @@ ops_pop_clip (RenderOpBuilder *self)
   if (self->clip_stack->len >= 1)
     {
       self->current_clip = &head->rect;
+      self->current_outer_clip = &head->outer_clip;
       self->clip_is_rectilinear = head->is_rectilinear;
-      ops_set_clip (self, &head->rect);
+      ops_set_clip (self, &head->rect, &head->outer_clip);
     }
   else
     {
       self->current_clip = NULL;
+      self->current_outer_clip = NULL;
       self->clip_is_rectilinear = TRUE;
     }
 }
@@ -362,6 +456,14 @@ ops_has_clip (RenderOpBuilder *self)
          self->clip_stack->len > 1;
 }
 
+gboolean
+ops_has_outer_clip (RenderOpBuilder *self)
+{
+  return self->clip_stack != NULL &&
+         self->clip_stack->len > 0 &&
+         g_array_index (self->clip_stack, ClipStackEntry, self->clip_stack->len - 1).has_outer_clip;
+}
+
 static void
 ops_set_modelview_internal (RenderOpBuilder *builder,
                             GskTransform    *transform)
@@ -697,19 +799,19 @@ ops_set_border_width (RenderOpBuilder *builder,
 }
 
 void
-ops_set_border_color (RenderOpBuilder *builder,
-                      const GdkRGBA   *color)
+ops_set_border_colors (RenderOpBuilder *builder,
+                       const GdkRGBA    colors[4])
 {
   ProgramState *current_program_state = get_current_program_state (builder);
   OpBorder *op;
 
-  if (gdk_rgba_equal (color, &current_program_state->border.color))
+  if (memcmp (colors, current_program_state->border.colors, sizeof (GdkRGBA) * 4) == 0)
     return;
 
   op = op_buffer_add (&builder->render_ops, OP_CHANGE_BORDER_COLOR);
-  op->color = color;
+  op->colors = colors;
 
-  current_program_state->border.color = *color;
+  memcpy (current_program_state->border.colors, colors, sizeof (GdkRGBA) * 4);
 }
 
 GskQuadVertex *
@@ -771,6 +873,131 @@ ops_get_buffer (RenderOpBuilder *builder)
   return &builder->render_ops;
 }
 
+/* Makes the next use of the program send all of its state */
+static void
+program_state_invalidate (ProgramState *state)
+{
+  gsk_transform_unref (state->modelview);
+
+  /* All floats become NaN, which never compares equal */
+  memset (state, 0xff, sizeof (ProgramState));
+  state->modelview = NULL;
+}
+
+/**
+ * ops_fork:
+ * @builder: an uninitialized #RenderOpBuilder
+ * @parent: the builder to fork from
+ *
+ * Sets up @builder to build the ops for a subtree on another thread,
+ * starting from the state @parent is in now. The subtree must pop
+ * everything it pushes and may not change the render target, the
+ * viewport, the projection or the opacity.
+ *
+ * The state of the programs is unknown to @builder, so the first use
+ * of each program sends all of its state. Use ops_join() to append
+ * the result to @parent.
+ */
+void
+ops_fork (RenderOpBuilder       *builder,
+          const RenderOpBuilder *parent)
+{
+  MatrixStackEntry mv_entry;
+  ClipStackEntry clip_entry;
+  guint i;
+
+  g_assert (parent->mv_stack != NULL && parent->mv_stack->len >= 1);
+  g_assert (parent->clip_stack != NULL && parent->clip_stack->len >= 1);
+
+  ops_init (builder);
+
+  builder->programs = parent->programs;
+  builder->renderer = parent->renderer;
+  builder->program_state = g_new (ProgramState, GL_N_PROGRAMS);
+  for (i = 0; i < GL_N_PROGRAMS; i++)
+    {
+      builder->program_state[i].modelview = NULL;
+      program_state_invalidate (&builder->program_state[i]);
+    }
+
+  builder->current_render_target = parent->current_render_target;
+  builder->current_texture = parent->current_texture;
+  builder->current_projection = parent->current_projection;
+  builder->current_viewport = parent->current_viewport;
+  builder->current_opacity = parent->current_opacity;
+  builder->dx = parent->dx;
+  builder->dy = parent->dy;
+  builder->scale_x = parent->scale_x;
+  builder->scale_y = parent->scale_y;
+
+  /* Only the top of the stacks is needed */
+  mv_entry = g_array_index (parent->mv_stack, MatrixStackEntry, parent->mv_stack->len - 1);
+  gsk_transform_ref (mv_entry.transform);
+  builder->mv_stack = g_array_new (FALSE, TRUE, sizeof (MatrixStackEntry));
+  g_array_append_val (builder->mv_stack, mv_entry);
+  builder->current_modelview = mv_entry.transform;
+
+  clip_entry = g_array_index (parent->clip_stack, ClipStackEntry, parent->clip_stack->len - 1);
+  builder->clip_stack = g_array_new (FALSE, TRUE, sizeof (ClipStackEntry));
+  g_array_append_val (builder->clip_stack, clip_entry);
+  builder->current_clip = &g_array_index (builder->clip_stack, ClipStackEntry, 0).rect;
+  builder->current_outer_clip = &g_array_index (builder->clip_stack, ClipStackEntry, 0).outer_clip;
+  builder->clip_is_rectilinear = clip_entry.is_rectilinear;
+}
+
+/**
+ * ops_join:
+ * @builder: a #RenderOpBuilder
+ * @forked: a builder forked from @builder with ops_fork()
+ *
+ * Appends the ops and vertices built by @forked to @builder and
+ * frees @forked. Afterwards, @builder knows the state the programs
+ * used by @forked were left in.
+ */
+void
+ops_join (RenderOpBuilder *builder,
+          RenderOpBuilder *forked)
+{
+  guint i;
+
+  g_assert (forked->mv_stack->len == 1);
+  g_assert (forked->clip_stack->len == 1);
+
+  if (op_buffer_n_ops (&forked->render_ops) > 0)
+    {
+      /* Ops that @forked added before choosing a program apply to the
+       * program that is current here */
+      if (builder->current_program)
+        program_state_invalidate (&builder->program_state[builder->current_program->index]);
+
+      op_buffer_append (&builder->render_ops, &forked->render_ops, builder->vertices->len);
+      g_array_append_vals (builder->vertices, forked->vertices->data, forked->vertices->len);
+
+      /* Every program that was used got its modelview set */
+      for (i = 0; i < GL_N_PROGRAMS; i++)
+        {
+          if (forked->program_state[i].modelview == NULL)
+            continue;
+
+          gsk_transform_unref (builder->program_state[i].modelview);
+          builder->program_state[i] = forked->program_state[i];
+          forked->program_state[i].modelview = NULL;
+        }
+
+      builder->current_program = forked->current_program;
+    }
+
+  for (i = 0; i < GL_N_PROGRAMS; i++)
+    gsk_transform_unref (forked->program_state[i].modelview);
+  g_free (forked->program_state);
+
+  gsk_transform_unref (g_array_index (forked->mv_stack, MatrixStackEntry, 0).transform);
+  g_array_free (forked->mv_stack, TRUE);
+  g_array_free (forked->clip_stack, TRUE);
+
+  ops_free (forked);
+}
+
 void
 ops_set_inset_shadow (RenderOpBuilder      *self,
                       const GskRoundedRect  outline,
@@ -899,61 +1126,24 @@ ops_set_unblurred_outset_shadow (RenderOpBuilder      *self,
 }
 
 void
-ops_set_linear_gradient (RenderOpBuilder     *self,
-                         guint                n_color_stops,
-                         const GskColorStop  *color_stops,
-                         float                start_x,
-                         float                start_y,
-                         float                end_x,
-                         float                end_y)
+ops_set_linear_gradient (RenderOpBuilder *self,
+                         float            ramp_y,
+                         float            start_x,
+                         float            start_y,
+                         float            end_x,
+                         float            end_y)
 {
   ProgramState *current_program_state = get_current_program_state (self);
   OpLinearGradient *op;
-  const guint real_n_color_stops = MIN (MAX_GRADIENT_STOPS, n_color_stops);
 
   g_assert (current_program_state);
 
   op = ops_begin (self, OP_CHANGE_LINEAR_GRADIENT);
 
-  /* We always save the n_color_stops value in the op so the renderer can use it in
-   * cases where we send the color stops, but not n_color_stops */
-  op->n_color_stops.value = real_n_color_stops;
-  if (current_program_state->linear_gradient.n_color_stops != real_n_color_stops)
-    {
-      op->n_color_stops.send = TRUE;
-      current_program_state->linear_gradient.n_color_stops = real_n_color_stops;
-    }
-  else
-    op->n_color_stops.send = FALSE;
-
-  op->color_stops.send = FALSE;
-  if (!op->n_color_stops.send)
-    {
-      g_assert (current_program_state->linear_gradient.n_color_stops == real_n_color_stops);
-
-      for (guint i = 0; i < real_n_color_stops; i ++)
-        {
-          const GskColorStop *s1 = &color_stops[i];
-          const GskColorStop *s2 = &current_program_state->linear_gradient.color_stops[i];
-
-          if (s1->offset != s2->offset ||
-              !gdk_rgba_equal (&s1->color, &s2->color))
-            {
-              op->color_stops.send = TRUE;
-              break;
-            }
-        }
-    }
-  else
-    op->color_stops.send = TRUE;
-
-  if (op->color_stops.send)
-    {
-      op->color_stops.value = color_stops;
-      memcpy (&current_program_state->linear_gradient.color_stops,
-              color_stops,
-              sizeof (GskColorStop) * real_n_color_stops);
-    }
+  /* Gradients with the same stops share their ramp */
+  op->ramp_y.value = ramp_y;
+  op->ramp_y.send = current_program_state->linear_gradient.ramp_y != ramp_y;
+  current_program_state->linear_gradient.ramp_y = ramp_y;
 
   op->start_point[0] = start_x;
   op->start_point[1] = start_y;
@@ -962,26 +1152,24 @@ ops_set_linear_gradient (RenderOpBuilder     *self,
 }
 
 void
-ops_set_radial_gradient (RenderOpBuilder    *self,
-                         guint               n_color_stops,
-                         const GskColorStop *color_stops,
-                         float               center_x,
-                         float               center_y,
-                         float               start,
-                         float               end,
-                         float               hradius,
-                         float               vradius)
-{
-  const guint real_n_color_stops = MIN (MAX_GRADIENT_STOPS, n_color_stops);
+ops_set_radial_gradient (RenderOpBuilder *self,
+                         float            ramp_y,
+                         float            center_x,
+                         float            center_y,
+                         float            start,
+                         float            end,
+                         float            hradius,
+                         float            vradius)
+{
+  ProgramState *current_program_state = get_current_program_state (self);
   OpRadialGradient *op;
 
-  /* TODO: State tracking? */
+  g_assert (current_program_state);
 
   op = ops_begin (self, OP_CHANGE_RADIAL_GRADIENT);
-  op->n_color_stops.value = real_n_color_stops;
-  op->n_color_stops.send = true;
-  op->color_stops.value = color_stops;
-  op->color_stops.send = true;
+  op->ramp_y.value = ramp_y;
+  op->ramp_y.send = current_program_state->radial_gradient.ramp_y != ramp_y;
+  current_program_state->radial_gradient.ramp_y = ramp_y;
   op->center[0] = center_x;
   op->center[1] = center_y;
   op->radius[0] = hradius;
@@ -8,13 +8,13 @@
 #include "gskgldriverprivate.h"
 #include "gskroundedrectprivate.h"
 #include "gskglrenderer.h"
+#include "gskglshaderbuilderprivate.h"
 #include "gskrendernodeprivate.h"
 
 #include "opbuffer.h"
 
 #define GL_N_VERTICES 6
 #define GL_N_PROGRAMS 14
-#define MAX_GRADIENT_STOPS 8
 
 typedef struct
 {
@@ -45,6 +45,7 @@ struct _Program
   int projection_location;
   int modelview_location;
   int clip_rect_location;
+  int outer_clip_rect_location;
   union {
     struct {
       int color_location;
@@ -57,14 +58,12 @@ struct _Program
       int color_offset_location;
     } color_matrix;
     struct {
-      int num_color_stops_location;
-      int color_stops_location;
+      int ramp_y_location;
       int start_point_location;
       int end_point_location;
     } linear_gradient;
     struct {
-      int num_color_stops_location;
-      int color_stops_location;
+      int ramp_y_location;
       int center_location;
       int start_location;
       int end_location;
@@ -92,7 +91,7 @@ struct _Program
       int offset_location;
     } unblurred_outset_shadow;
     struct {
-      int color_location;
+      int colors_location;
       int widths_location;
       int outline_rect_location;
     } border;
@@ -115,6 +114,7 @@ typedef struct
 {
   GskTransform *modelview;
   GskRoundedRect clip;
+  GskRoundedRect outer_clip;
   graphene_matrix_t projection;
   int source_texture;
   graphene_rect_t viewport;
@@ -128,7 +128,7 @@ typedef struct
     } color_matrix;
     struct {
       float widths[4];
-      GdkRGBA color;
+      GdkRGBA colors[4];
       GskRoundedRect outline;
     } border;
     struct {
@@ -146,18 +146,10 @@ typedef struct
       GdkRGBA color;
     } unblurred_outset_shadow;
     struct {
-      int n_color_stops;
-      GskColorStop color_stops[MAX_GRADIENT_STOPS];
-      float start_point[2];
-      float end_point[2];
+      float ramp_y;
     } linear_gradient;
     struct {
-      int n_color_stops;
-      GskColorStop color_stops[MAX_GRADIENT_STOPS];
-      float center[2];
-      float start;
-      float end;
-      float radius[2]; /* h/v */
+      float ramp_y;
     } radial_gradient;
   };
 } ProgramState;
@@ -184,11 +176,20 @@ typedef struct {
     };
   };
   ProgramState state[GL_N_PROGRAMS];
+
+  /* Kept around to link the remaining programs on first use */
+  GskGLShaderBuilder shader_builder;
 } GskGLRendererPrograms;
 
+gboolean          gsk_gl_renderer_programs_link (GskGLRendererPrograms  *programs,
+                                                 int                     index,
+                                                 GError                **error);
+
 typedef struct
 {
   GskGLRendererPrograms *programs;
+  /* GL_N_PROGRAMS entries, programs->state unless forked */
+  ProgramState *program_state;
   const Program *current_program;
   int current_render_target;
   int current_texture;
@@ -210,8 +211,9 @@ typedef struct
 
   /* Same thing */
   GArray *clip_stack;
-  /* Pointer into clip_stack */
+  /* Pointers into clip_stack */
   const GskRoundedRect *current_clip;
+  const GskRoundedRect *current_outer_clip;
   bool clip_is_rectilinear;
 } RenderOpBuilder;
 
@@ -223,6 +225,10 @@ void              ops_dump_framebuffer   (RenderOpBuilder         *builder,
 void              ops_init               (RenderOpBuilder         *builder);
 void              ops_free               (RenderOpBuilder         *builder);
 void              ops_reset              (RenderOpBuilder         *builder);
+void              ops_fork               (RenderOpBuilder         *builder,
+                                          const RenderOpBuilder   *parent);
+void              ops_join               (RenderOpBuilder         *builder,
+                                          RenderOpBuilder         *forked);
 void              ops_push_debug_group    (RenderOpBuilder         *builder,
                                            const char              *text);
 void              ops_pop_debug_group     (RenderOpBuilder         *builder);
@@ -240,8 +246,14 @@ void              ops_set_program        (RenderOpBuilder         *builder,
 
 void              ops_push_clip          (RenderOpBuilder         *builder,
                                           const GskRoundedRect    *clip);
+void              ops_push_nested_clip   (RenderOpBuilder         *builder,
+                                          const GskRoundedRect    *clip);
+void              ops_push_clip_with_outer (RenderOpBuilder       *builder,
+                                          const GskRoundedRect    *clip,
+                                          const GskRoundedRect    *outer_clip);
 void              ops_pop_clip           (RenderOpBuilder         *builder);
 gboolean          ops_has_clip           (RenderOpBuilder         *builder);
+gboolean          ops_has_outer_clip     (RenderOpBuilder         *builder);
 
 void              ops_transform_bounds_modelview (const RenderOpBuilder *builder,
                                                   const graphene_rect_t *src,
@@ -273,8 +285,8 @@ void              ops_set_border         (RenderOpBuilder         *builder,
 void              ops_set_border_width   (RenderOpBuilder         *builder,
                                           const float             *widths);
 
-void              ops_set_border_color   (RenderOpBuilder         *builder,
-                                          const GdkRGBA           *color);
+void              ops_set_border_colors  (RenderOpBuilder         *builder,
+                                          const GdkRGBA            colors[4]);
 void              ops_set_inset_shadow   (RenderOpBuilder         *self,
                                           const GskRoundedRect     outline,
                                           float                    spread,
@@ -289,15 +301,13 @@ void              ops_set_unblurred_outset_shadow   (RenderOpBuilder         *se
                                                      float                    dy);
 
 void              ops_set_linear_gradient (RenderOpBuilder     *self,
-                                           guint                n_color_stops,
-                                           const GskColorStop  *color_stops,
+                                           float                ramp_y,
                                            float                start_x,
                                            float                start_y,
                                            float                end_x,
                                            float                end_y);
 void              ops_set_radial_gradient (RenderOpBuilder        *self,
-                                           guint                   n_color_stops,
-                                           const GskColorStop     *color_stops,
+                                           float                   ramp_y,
                                            float                   center_x,
                                            float                   center_y,
                                            float                   start,
@@ -6,6 +6,17 @@
 
 #include <gdk/gdk.h>
 #include <epoxy/gl.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define PROGRAM_BINARY_MAGIC 0x47534b50 /* GSKP */
+
+typedef struct
+{
+  guint32 magic;
+  guint32 format;
+} ProgramBinaryHeader;
 
 void
 gsk_gl_shader_builder_init (GskGLShaderBuilder *self,
@@ -30,6 +41,171 @@ gsk_gl_shader_builder_finish (GskGLShaderBuilder *self)
   g_bytes_unref (self->preamble);
   g_bytes_unref (self->vs_preamble);
   g_bytes_unref (self->fs_preamble);
+  g_free (self->binary_cache_dir);
+  g_free (self->driver_id);
+}
+
+/* Must be called with the context current, after the
+ * other builder settings are in place */
+void
+gsk_gl_shader_builder_init_binary_cache (GskGLShaderBuilder *self)
+{
+  gboolean supported;
+  int n_formats = 0;
+
+  if (g_getenv ("GSK_NO_PROGRAM_CACHE"))
+    return;
+
+  if (self->gles)
+    supported = epoxy_gl_version () >= 30 || epoxy_has_gl_extension ("GL_OES_get_program_binary");
+  else
+    supported = epoxy_gl_version () >= 41 || epoxy_has_gl_extension ("GL_ARB_get_program_binary");
+
+  if (!supported)
+    return;
+
+  /* Some drivers advertise the extension without supporting any format */
+  glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+  if (n_formats == 0)
+    return;
+
+  self->binary_cache_dir = g_build_filename (g_get_user_cache_dir (),
+                                             "gtk-4.0", "gsk", "programs",
+                                             NULL);
+  self->driver_id = g_strdup_printf ("%s\n%s\n%s\n",
+                                     (const char *) glGetString (GL_VENDOR),
+                                     (const char *) glGetString (GL_RENDERER),
+                                     (const char *) glGetString (GL_VERSION));
+}
+
+static char *
+get_binary_cache_path (GskGLShaderBuilder *self,
+                       GBytes             *source_bytes)
+{
+  GChecksum *checksum;
+  char *filename;
+  char *path;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+
+  g_checksum_update (checksum, (const guchar *) self->driver_id, -1);
+  g_checksum_update (checksum, (const guchar *) &self->version, sizeof (self->version));
+  g_checksum_update (checksum,
+                     (const guchar[]) {
+                       self->debugging, self->legacy, self->gl3, self->gles
+                     },
+                     4);
+  g_checksum_update (checksum, g_bytes_get_data (self->preamble, NULL), g_bytes_get_size (self->preamble));
+  g_checksum_update (checksum, g_bytes_get_data (self->vs_preamble, NULL), g_bytes_get_size (self->vs_preamble));
+  g_checksum_update (checksum, g_bytes_get_data (self->fs_preamble, NULL), g_bytes_get_size (self->fs_preamble));
+  g_checksum_update (checksum, g_bytes_get_data (source_bytes, NULL), g_bytes_get_size (source_bytes));
+
+  filename = g_strconcat (g_checksum_get_string (checksum), ".bin", NULL);
+  path = g_build_filename (self->binary_cache_dir, filename, NULL);
+
+  g_free (filename);
+  g_checksum_free (checksum);
+
+  return path;
+}
+
+static int
+load_program_binary (const char *path)
+{
+  char *contents;
+  gsize length;
+  ProgramBinaryHeader header;
+  int program_id;
+  int status;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    return -1;
+
+  if (length <= sizeof (header))
+    goto invalid;
+
+  memcpy (&header, contents, sizeof (header));
+  if (header.magic != PROGRAM_BINARY_MAGIC)
+    goto invalid;
+
+  program_id = glCreateProgram ();
+  glProgramBinary (program_id, header.format,
+                   contents + sizeof (header), length - sizeof (header));
+
+  /* The driver may reject binaries from before an update */
+  glGetProgramiv (program_id, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE)
+    {
+      glDeleteProgram (program_id);
+      goto invalid;
+    }
+
+  g_free (contents);
+
+  return program_id;
+
+invalid:
+  GSK_NOTE (SHADERS, g_message ("Discarding stale program binary %s", path));
+  g_unlink (path);
+  g_free (contents);
+
+  return -1;
+}
+
+static void
+save_program_binary (GskGLShaderBuilder *self,
+                     const char         *path,
+                     int                 program_id)
+{
+  ProgramBinaryHeader header;
+  GError *error = NULL;
+  char *contents;
+  int length = 0;
+  GLenum format;
+
+  glGetProgramiv (program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  contents = g_malloc (sizeof (header) + length);
+  glGetProgramBinary (program_id, length, &length, &format, contents + sizeof (header));
+
+  header.magic = PROGRAM_BINARY_MAGIC;
+  header.format = format;
+  memcpy (contents, &header, sizeof (header));
+
+  if (g_mkdir_with_parents (self->binary_cache_dir, 0700) != 0 ||
+      !g_file_set_contents (path, contents, sizeof (header) + length, &error))
+    {
+      GSK_NOTE (SHADERS, g_message ("Failed to save program binary %s: %s",
+                                    path, error ? error->message : g_strerror (errno)));
+      g_clear_error (&error);
+    }
+
+  g_free (contents);
+}
+
+gboolean
+gsk_gl_shader_builder_has_cached_program (GskGLShaderBuilder *self,
+                                          const char         *resource_path)
+{
+  GBytes *source_bytes;
+  char *path;
+  gboolean result;
+
+  if (self->binary_cache_dir == NULL)
+    return FALSE;
+
+  source_bytes = g_resources_lookup_data (resource_path, 0, NULL);
+  g_assert (source_bytes);
+
+  path = get_binary_cache_path (self, source_bytes);
+  result = g_file_test (path, G_FILE_TEST_IS_REGULAR);
+
+  g_free (path);
+  g_bytes_unref (source_bytes);
+
+  return result;
 }
 
 void
@@ -80,6 +256,7 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
 {
 
   GBytes *source_bytes = g_resources_lookup_data (resource_path, 0, NULL);
+  char *binary_path = NULL;
   char version_buffer[64];
   const char *source;
   const char *vertex_shader_start;
@@ -91,6 +268,14 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
 
   g_assert (source_bytes);
 
+  if (self->binary_cache_dir)
+    {
+      binary_path = get_binary_cache_path (self, source_bytes);
+      program_id = load_program_binary (binary_path);
+      if (program_id > 0)
+        goto out;
+    }
+
   source = g_bytes_get_data (source_bytes, NULL);
   vertex_shader_start = strstr (source, "VERTEX_SHADER");
   fragment_shader_start = strstr (source, "FRAGMENT_SHADER");
@@ -168,6 +353,8 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   program_id = glCreateProgram ();
   glAttachShader (program_id, vertex_id);
   glAttachShader (program_id, fragment_id);
+  if (binary_path && (!self->gles || epoxy_gl_version () >= 30))
+    glProgramParameteri (program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram (program_id);
 
   glGetProgramiv (program_id, GL_LINK_STATUS, &status);
@@ -188,6 +375,7 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
       g_free (buffer);
 
       glDeleteProgram (program_id);
+      program_id = -1;
 
       goto out;
     }
@@ -198,7 +386,11 @@ gsk_gl_shader_builder_create_program (GskGLShaderBuilder  *self,
   glDetachShader (program_id, fragment_id);
   glDeleteShader (fragment_id);
 
+  if (binary_path)
+    save_program_binary (self, binary_path, program_id);
+
 out:
+  g_free (binary_path);
   g_bytes_unref (source_bytes);
 
   return program_id;
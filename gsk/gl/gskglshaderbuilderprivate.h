@@ -14,6 +14,11 @@ typedef struct
 
   int version;
 
+  /* Where linked program binaries are kept, or %NULL if
+   * the driver can't give them to us */
+  char *binary_cache_dir;
+  char *driver_id;
+
   guint debugging: 1;
   guint gles: 1;
   guint gl3: 1;
@@ -31,6 +36,10 @@ void   gsk_gl_shader_builder_finish           (GskGLShaderBuilder  *self);
 void   gsk_gl_shader_builder_set_glsl_version (GskGLShaderBuilder  *self,
                                                int                  version);
 
+void     gsk_gl_shader_builder_init_binary_cache (GskGLShaderBuilder *self);
+gboolean gsk_gl_shader_builder_has_cached_program (GskGLShaderBuilder *self,
+                                                   const char         *resource_path);
+
 int    gsk_gl_shader_builder_create_program   (GskGLShaderBuilder  *self,
                                                const char          *resource_path,
                                                GError             **error);
@@ -14,7 +14,7 @@ typedef struct
   GskRoundedRect outline;
   float blur_radius;
 
-  int texture_id;
+  GskGLCachedShadow shadow;
   int unused_frames;
 } CacheItem;
 
@@ -49,7 +49,7 @@ gsk_gl_shadow_cache_free (GskGLShadowCache *self,
     {
       const CacheItem *item = &g_array_index (self->textures, CacheItem, i);
 
-      gsk_gl_driver_destroy_texture (gl_driver, item->texture_id);
+      gsk_gl_driver_destroy_texture (gl_driver, item->shadow.texture_id);
     }
 
   g_array_free (self->textures, TRUE);
@@ -59,36 +59,54 @@ gsk_gl_shadow_cache_free (GskGLShadowCache *self,
 void
 gsk_gl_shadow_cache_begin_frame (GskGLShadowCache *self,
                                  GskGLDriver      *gl_driver)
+{
+  guint i;
+
+  gsk_gl_shadow_cache_trim (self, gl_driver, MAX_UNUSED_FRAMES);
+
+  for (i = 0; i < self->textures->len; i ++)
+    g_array_index (self->textures, CacheItem, i).unused_frames ++;
+}
+
+/* Drops all shadows that have not been used in the
+ * last @max_unused_frames frames.
+ */
+guint
+gsk_gl_shadow_cache_trim (GskGLShadowCache *self,
+                          GskGLDriver      *gl_driver,
+                          int               max_unused_frames)
 {
   guint i, p;
+  guint dropped = 0;
 
   for (i = 0, p = self->textures->len; i < p; i ++)
     {
       CacheItem *item = &g_array_index (self->textures, CacheItem, i);
 
-      if (item->unused_frames > MAX_UNUSED_FRAMES)
+      if (item->unused_frames > max_unused_frames)
         {
-          gsk_gl_driver_destroy_texture (gl_driver, item->texture_id);
+          gsk_gl_driver_destroy_texture (gl_driver, item->shadow.texture_id);
           g_array_remove_index_fast (self->textures, i);
           p --;
           i --;
-        }
-      else
-        {
-          item->unused_frames ++;
+          dropped ++;
         }
     }
+
+  return dropped;
 }
 
-/* XXX
- * The offset origin should always be at 0/0, or the blur radius should just go
- * away since it defines the origin position anyway?
+/* Shadows that get drawn as nine slices are keyed on an outline that
+ * has been shrunk to the minimum size that still holds its corners, so
+ * the key only depends on the corner radii, the spread and the blur
+ * radius. The same texture and slices get reused whatever the size of
+ * the shadowed widget is, e.g. while a window is being resized.
  */
-int
-gsk_gl_shadow_cache_get_texture_id (GskGLShadowCache     *self,
-                                    GskGLDriver          *gl_driver,
-                                    const GskRoundedRect *shadow_rect,
-                                    float                 blur_radius)
+const GskGLCachedShadow *
+gsk_gl_shadow_cache_lookup (GskGLShadowCache     *self,
+                            GskGLDriver          *gl_driver,
+                            const GskRoundedRect *shadow_rect,
+                            float                 blur_radius)
 {
   CacheItem *item= NULL;
   guint i;
@@ -110,20 +128,27 @@ gsk_gl_shadow_cache_get_texture_id (GskGLShadowCache     *self,
     }
 
   if (item == NULL)
-    return 0;
+    return NULL;
 
   item->unused_frames = 0;
 
-  g_assert (item->texture_id != 0);
+  g_assert (item->shadow.texture_id != 0);
 
-  return item->texture_id;
+  return &item->shadow;
 }
 
-void
+/* The nine slices of the shadow are computed from @shadow_rect, grown
+ * by @slice_grow pixels, and stored alongside the texture. The returned
+ * shadow is only valid until the next commit.
+ */
+const GskGLCachedShadow *
 gsk_gl_shadow_cache_commit (GskGLShadowCache     *self,
                             const GskRoundedRect *shadow_rect,
                             float                 blur_radius,
-                            int                   texture_id)
+                            int                   texture_id,
+                            int                   texture_width,
+                            int                   texture_height,
+                            int                   slice_grow)
 {
   CacheItem *item;
 
@@ -137,5 +162,13 @@ gsk_gl_shadow_cache_commit (GskGLShadowCache     *self,
   item->outline = *shadow_rect;
   item->blur_radius = blur_radius;
   item->unused_frames = 0;
-  item->texture_id = texture_id;
+  item->shadow.texture_id = texture_id;
+
+  nine_slice_rounded_rect (shadow_rect, item->shadow.slices);
+  nine_slice_grow (item->shadow.slices, slice_grow);
+  nine_slice_to_texture_coords (item->shadow.slices,
+                                texture_width, texture_height,
+                                item->shadow.regions);
+
+  return &item->shadow;
 }
@@ -7,25 +7,43 @@
 #include "gskgldriverprivate.h"
 #include "gskroundedrect.h"
 
+#include <stdbool.h>
+#include "glutilsprivate.h"
+
 typedef struct
 {
   GArray *textures;
 } GskGLShadowCache;
 
+typedef struct
+{
+  int texture_id;
+  cairo_rectangle_int_t slices[NINE_SLICE_SIZE];
+  TextureRegion regions[NINE_SLICE_SIZE];
+} GskGLCachedShadow;
+
 
 void gsk_gl_shadow_cache_init           (GskGLShadowCache     *self);
 void gsk_gl_shadow_cache_free           (GskGLShadowCache     *self,
                                          GskGLDriver          *gl_driver);
 void gsk_gl_shadow_cache_begin_frame    (GskGLShadowCache     *self,
                                          GskGLDriver          *gl_driver);
-int  gsk_gl_shadow_cache_get_texture_id (GskGLShadowCache     *self,
+guint gsk_gl_shadow_cache_trim          (GskGLShadowCache     *self,
+                                         GskGLDriver          *gl_driver,
+                                         int                   max_unused_frames);
+const GskGLCachedShadow *
+     gsk_gl_shadow_cache_lookup         (GskGLShadowCache     *self,
                                          GskGLDriver          *gl_driver,
                                          const GskRoundedRect *shadow_rect,
                                          float                 blur_radius);
-void gsk_gl_shadow_cache_commit         (GskGLShadowCache     *self,
+const GskGLCachedShadow *
+     gsk_gl_shadow_cache_commit         (GskGLShadowCache     *self,
                                          const GskRoundedRect *shadow_rect,
                                          float                 blur_radius,
-                                         int                   texture_id);
+                                         int                   texture_id,
+                                         int                   texture_width,
+                                         int                   texture_height,
+                                         int                   slice_grow);
 
 
 #endif
@@ -7,6 +7,8 @@
 
 #define ATLAS_SIZE (512)
 #define MAX_OLD_RATIO 0.5
+#define COMPACT_FRAMES 8
+#define MAX_MOVED_PIXELS_PER_FRAME (ATLAS_SIZE * ATLAS_SIZE / 4)
 
 static void
 free_atlas (gpointer v)
@@ -23,8 +25,9 @@ gsk_gl_texture_atlases_new (void)
 {
   GskGLTextureAtlases *self;
 
-  self = g_new (GskGLTextureAtlases, 1);
+  self = g_new0 (GskGLTextureAtlases, 1);
   self->atlases = g_ptr_array_new_with_free_func (free_atlas);
+  self->compacting = g_ptr_array_new_with_free_func (free_atlas);
 
   self->ref_count = 1;
 
@@ -47,6 +50,7 @@ gsk_gl_texture_atlases_unref (GskGLTextureAtlases *self)
   if (self->ref_count == 1)
     {
       g_ptr_array_unref (self->atlases);
+      g_ptr_array_unref (self->compacting);
       g_free (self);
       return;
     }
@@ -79,6 +83,29 @@ gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
 {
   int i;
 
+  self->moved_pixels = 0;
+
+  /* Atlases whose live regions did not all get moved in time are
+   * dropped, together with whatever the caches still keep on them.
+   */
+  for (i = self->compacting->len - 1; i >= 0; i--)
+    {
+      GskGLTextureAtlas *atlas = g_ptr_array_index (self->compacting, i);
+
+      if (--atlas->compact_frames > 0)
+        continue;
+
+      GSK_NOTE(GLYPH_CACHE, g_message ("Dropping compacted atlas %d", atlas->texture_id));
+
+      g_ptr_array_add (removed, atlas);
+      g_ptr_array_remove_index (self->compacting, i);
+    }
+
+  /* Instead of dropping atlases that are mostly old, which makes the
+   * caches re-render everything that was on them in a single frame,
+   * we stop packing into them and let the caches move the regions
+   * that are still in use over a few frames.
+   */
   for (i = self->atlases->len - 1; i >= 0; i--)
     {
       GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
@@ -86,17 +113,11 @@ gsk_gl_texture_atlases_begin_frame (GskGLTextureAtlases *self,
       if (gsk_gl_texture_atlas_get_unused_ratio (atlas) > MAX_OLD_RATIO)
         {
           GSK_NOTE(GLYPH_CACHE,
-                   g_message ("Dropping atlas %d (%g.2%% old)", i,
+                   g_message ("Compacting atlas %d (%g.2%% old)", i,
                               100.0 * gsk_gl_texture_atlas_get_unused_ratio (atlas)));
 
-          if (atlas->texture_id != 0)
-            {
-              glDeleteTextures (1, &atlas->texture_id);
-              atlas->texture_id = 0;
-            }
-
-          g_ptr_array_add (removed, atlas);
-          g_ptr_array_remove_index (self->atlases, i);
+          atlas->compact_frames = COMPACT_FRAMES;
+          g_ptr_array_add (self->compacting, g_ptr_array_steal_index (self->atlases, i));
        }
     }
 
@@ -179,6 +200,101 @@ gsk_gl_texture_atlases_pack (GskGLTextureAtlases *self,
   return TRUE;
 }
 
+gboolean
+gsk_gl_texture_atlases_is_compacting (GskGLTextureAtlases     *self,
+                                      const GskGLTextureAtlas *atlas)
+{
+  return atlas != NULL &&
+         self->compacting->len > 0 &&
+         g_ptr_array_find (self->compacting, atlas, NULL);
+}
+
+/* Packs a new region for the @width x @height region at @x, @y on @from
+ * and copies its contents over on the GPU. Returns %FALSE if the move
+ * budget for this frame has been used up.
+ */
+gboolean
+gsk_gl_texture_atlases_move (GskGLTextureAtlases *self,
+                             GskGLTextureAtlas   *from,
+                             int                  x,
+                             int                  y,
+                             int                  width,
+                             int                  height,
+                             GskGLTextureAtlas  **atlas_out,
+                             int                 *out_x,
+                             int                 *out_y)
+{
+  GskGLTextureAtlas *atlas;
+  int packed_x, packed_y;
+
+  g_assert (gsk_gl_texture_atlases_is_compacting (self, from));
+
+  if (self->moved_pixels + width * height > MAX_MOVED_PIXELS_PER_FRAME)
+    return FALSE;
+
+  gsk_gl_texture_atlases_pack (self, width, height, &atlas, &packed_x, &packed_y);
+
+  if (self->copy_fbo == 0)
+    {
+      glGetIntegerv (GL_FRAMEBUFFER_BINDING, &self->saved_fbo);
+      glGenFramebuffers (1, &self->copy_fbo);
+      glBindFramebuffer (GL_FRAMEBUFFER, self->copy_fbo);
+    }
+
+  glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                          GL_TEXTURE_2D, from->texture_id, 0);
+  glBindTexture (GL_TEXTURE_2D, atlas->texture_id);
+  glCopyTexSubImage2D (GL_TEXTURE_2D, 0, packed_x, packed_y, x, y, width, height);
+
+  self->moved_pixels += width * height;
+
+  *atlas_out = atlas;
+  *out_x = packed_x;
+  *out_y = packed_y;
+
+  return TRUE;
+}
+
+void
+gsk_gl_texture_atlases_end_moves (GskGLTextureAtlases *self)
+{
+  if (self->copy_fbo == 0)
+    return;
+
+  glBindTexture (GL_TEXTURE_2D, 0);
+  glBindFramebuffer (GL_FRAMEBUFFER, self->saved_fbo);
+  glDeleteFramebuffers (1, &self->copy_fbo);
+  self->copy_fbo = 0;
+
+  GSK_NOTE(GLYPH_CACHE, g_message ("Moved %d pixels between atlases", self->moved_pixels));
+}
+
+/* Starts compacting all atlases that have unused regions,
+ * regardless of how much of them is still in use.
+ */
+void
+gsk_gl_texture_atlases_trim (GskGLTextureAtlases *self)
+{
+  int i;
+
+  for (i = self->atlases->len - 1; i >= 0; i--)
+    {
+      GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+      if (atlas->unused_pixels > 0)
+        {
+          atlas->compact_frames = COMPACT_FRAMES;
+          g_ptr_array_add (self->compacting, g_ptr_array_steal_index (self->atlases, i));
+        }
+    }
+}
+
+gsize
+gsk_gl_texture_atlases_get_memory (GskGLTextureAtlases *self)
+{
+  return (gsize) (self->atlases->len + self->compacting->len) * ATLAS_SIZE * ATLAS_SIZE * 4;
+}
+
 void
 gsk_gl_texture_atlas_init (GskGLTextureAtlas *self,
                            int                width,
@@ -19,6 +19,8 @@ struct _GskGLTextureAtlas
   int unused_pixels; /* Pixels of rects that have been used at some point,
                         But are now unused. */
 
+  int compact_frames; /* Frames left until a retired atlas gets dropped */
+
   void *user_data;
 };
 typedef struct _GskGLTextureAtlas GskGLTextureAtlas;
@@ -28,6 +30,14 @@ struct _GskGLTextureAtlases
   int ref_count;
 
   GPtrArray *atlases;
+
+  /* Atlases that are no longer packed into, and whose live
+   * regions are being moved over to the ones in @atlases */
+  GPtrArray *compacting;
+
+  int moved_pixels;
+  guint copy_fbo;
+  int saved_fbo;
 };
 typedef struct _GskGLTextureAtlases GskGLTextureAtlases;
 
@@ -43,6 +53,20 @@ gboolean             gsk_gl_texture_atlases_pack        (GskGLTextureAtlases *at
                                                          GskGLTextureAtlas  **atlas_out,
                                                          int                 *out_x,
                                                          int                 *out_y);
+gboolean             gsk_gl_texture_atlases_is_compacting (GskGLTextureAtlases     *atlases,
+                                                           const GskGLTextureAtlas *atlas);
+gboolean             gsk_gl_texture_atlases_move        (GskGLTextureAtlases *atlases,
+                                                         GskGLTextureAtlas   *from,
+                                                         int                  x,
+                                                         int                  y,
+                                                         int                  width,
+                                                         int                  height,
+                                                         GskGLTextureAtlas  **atlas_out,
+                                                         int                 *out_x,
+                                                         int                 *out_y);
+void                 gsk_gl_texture_atlases_end_moves   (GskGLTextureAtlases *atlases);
+void                 gsk_gl_texture_atlases_trim        (GskGLTextureAtlases *atlases);
+gsize                gsk_gl_texture_atlases_get_memory  (GskGLTextureAtlases *atlases);
 
 void        gsk_gl_texture_atlas_init              (GskGLTextureAtlas       *self,
                                                     int                      width,
@@ -132,3 +132,371 @@ op_buffer_add (OpBuffer *buffer,
 
   return &buffer->buf[entry.pos];
 }
+
+/* Appends the ops of @other to @buffer. The vertices used by the
+ * draws in @other must have been appended to the vertices of @buffer
+ * at @vertex_offset.
+ */
+void
+op_buffer_append (OpBuffer       *buffer,
+                  const OpBuffer *other,
+                  gsize           vertex_offset)
+{
+  guint i;
+
+  for (i = 1; i < other->index->len; i++)
+    {
+      const OpBufferEntry *entry = &g_array_index (other->index, OpBufferEntry, i);
+      gpointer op = op_buffer_add (buffer, entry->kind);
+
+      memcpy (op, &other->buf[entry->pos], op_sizes[entry->kind]);
+
+      if (entry->kind == OP_DRAW)
+        ((OpDraw *) op)->vao_offset += vertex_offset;
+    }
+}
+
+/* How many draws we look back at when trying to find an
+ * earlier draw with the same state to merge into.
+ */
+#define MAX_MERGE_DISTANCE 128
+
+typedef struct
+{
+  gconstpointer program;
+  guint serial;
+  guint uses_source2 : 1;
+} ProgramSerial;
+
+typedef struct
+{
+  OpDraw *op;
+  guint index_pos;
+
+  /* Two draws with the same key render with identical state */
+  guint serial;
+  int texture_id;
+  guint source2_serial;
+
+  graphene_rect_t bounds;
+
+  int head;   /* The draw we got merged into, or ourselves */
+  int next;   /* Next draw merged into our head */
+  int tail;   /* Only valid for heads */
+  guint mergeable : 1;
+} DrawInfo;
+
+static inline ProgramSerial *
+get_program_serial (GArray        *programs,
+                    gconstpointer  program,
+                    guint         *serial)
+{
+  ProgramSerial *p;
+  guint i;
+
+  for (i = 0; i < programs->len; i++)
+    {
+      p = &g_array_index (programs, ProgramSerial, i);
+      if (p->program == program)
+        return p;
+    }
+
+  g_array_set_size (programs, programs->len + 1);
+  p = &g_array_index (programs, ProgramSerial, programs->len - 1);
+  p->program = program;
+  p->serial = ++(*serial);
+  p->uses_source2 = FALSE;
+
+  return p;
+}
+
+static inline void
+compute_draw_bounds (const OpDraw            *op,
+                     const GArray            *vertices,
+                     const graphene_matrix_t *modelview,
+                     const graphene_matrix_t *projection,
+                     DrawInfo                *info)
+{
+  const GskQuadVertex *v = &g_array_index (vertices, GskQuadVertex, op->vao_offset);
+  float min_x, min_y, max_x, max_y;
+  graphene_matrix_t mvp;
+  graphene_rect_t r;
+  gsize i;
+
+  /* We can't reason about overlap after perspective projection,
+   * so such draws stay where they are and act as a barrier.
+   */
+  if (!graphene_matrix_is_2d (modelview))
+    {
+      info->mergeable = FALSE;
+      graphene_rect_init (&info->bounds, -G_MAXFLOAT / 2, -G_MAXFLOAT / 2, G_MAXFLOAT, G_MAXFLOAT);
+      return;
+    }
+
+  min_x = max_x = v[0].position[0];
+  min_y = max_y = v[0].position[1];
+
+  for (i = 1; i < op->vao_size; i++)
+    {
+      min_x = MIN (min_x, v[i].position[0]);
+      min_y = MIN (min_y, v[i].position[1]);
+      max_x = MAX (max_x, v[i].position[0]);
+      max_y = MAX (max_y, v[i].position[1]);
+    }
+
+  graphene_rect_init (&r, min_x, min_y, max_x - min_x, max_y - min_y);
+  graphene_matrix_multiply (modelview, projection, &mvp);
+  graphene_matrix_transform_bounds (&mvp, &r, &info->bounds);
+  info->mergeable = TRUE;
+}
+
+static inline gboolean
+draw_keys_equal (const DrawInfo *a,
+                 const DrawInfo *b)
+{
+  return a->serial == b->serial &&
+         a->texture_id == b->texture_id &&
+         a->source2_serial == b->source2_serial;
+}
+
+/* Looks for an earlier draw in the same segment that @draw can be
+ * merged into. Moving @draw back is only allowed if it doesn't
+ * overlap any other draw it gets moved across.
+ */
+static int
+find_merge_head (GArray *draws,
+                 guint   segment_start,
+                 guint   n)
+{
+  const DrawInfo *draw = &g_array_index (draws, DrawInfo, n);
+  int head = -1;
+  guint i;
+
+  if (!draw->mergeable)
+    return -1;
+
+  for (i = n; i > segment_start && n - i < MAX_MERGE_DISTANCE; i--)
+    {
+      const DrawInfo *other = &g_array_index (draws, DrawInfo, i - 1);
+
+      if (draw_keys_equal (draw, other))
+        {
+          /* The first draw with the same key we find belongs to the
+           * most recent group for this key, so that's where we'd go. */
+          if (head == -1)
+            head = other->head;
+
+          if ((int)(i - 1) == head)
+            return head;
+        }
+      else if (graphene_rect_intersection (&draw->bounds, &other->bounds, NULL))
+        {
+          return -1;
+        }
+    }
+
+  return -1;
+}
+
+/* Reorders the vertices of all draws in @buffer so that draws which
+ * share program, uniforms and source texture are submitted as a single
+ * glDrawArrays(), as long as doing so doesn't change the result.
+ *
+ * The stream is cut into segments at everything that changes the
+ * framebuffer or viewport. Inside a segment, every op that changes
+ * the uniforms of a program gives that program a new serial, so two
+ * draws with the same serial and texture see the exact same state.
+ * A draw can then be merged into an earlier one with the same state
+ * if its bounds don't overlap any draw in between.
+ *
+ * Merged draws are turned into OP_NONE, the state ops in front of
+ * them are left alone since later draws may depend on them.
+ *
+ * Returns: the number of draws that were merged away
+ */
+guint
+op_buffer_merge_draws (OpBuffer *buffer,
+                       GArray   *vertices)
+{
+  GArray *draws;
+  GArray *programs;
+  ProgramSerial *program = NULL;
+  graphene_matrix_t modelview;
+  graphene_matrix_t projection;
+  graphene_rect_t viewport;
+  gboolean have_viewport = FALSE;
+  int texture_id = 0;
+  guint source2_serial = 0;
+  guint serial = 0;
+  guint segment_start = 0;
+  guint n_merged = 0;
+  guint i;
+
+  draws = g_array_new (FALSE, FALSE, sizeof (DrawInfo));
+  programs = g_array_new (FALSE, FALSE, sizeof (ProgramSerial));
+  graphene_matrix_init_identity (&modelview);
+  graphene_matrix_init_identity (&projection);
+
+  for (i = 1; i < buffer->index->len; i++)
+    {
+      OpBufferEntry *entry = &g_array_index (buffer->index, OpBufferEntry, i);
+      gpointer ptr = &buffer->buf[entry->pos];
+
+      /* The modelview and projection ops always carry the builder's
+       * current values, even when no program is bound. */
+      if (entry->kind == OP_CHANGE_MODELVIEW)
+        modelview = ((const OpMatrix *)ptr)->matrix;
+      else if (entry->kind == OP_CHANGE_PROJECTION)
+        projection = ((const OpMatrix *)ptr)->matrix;
+
+      switch (entry->kind)
+        {
+        case OP_NONE:
+        case OP_PUSH_DEBUG_GROUP:
+        case OP_POP_DEBUG_GROUP:
+          break;
+
+        case OP_CHANGE_PROGRAM:
+          program = get_program_serial (programs, ((const OpProgram *)ptr)->program, &serial);
+          break;
+
+        case OP_CHANGE_RENDER_TARGET:
+        case OP_CLEAR:
+        case OP_DUMP_FRAMEBUFFER:
+          segment_start = draws->len;
+          break;
+
+        case OP_CHANGE_SOURCE_TEXTURE:
+          /* Ops without a program are skipped when rendering */
+          if (program != NULL)
+            texture_id = ((const OpTexture *)ptr)->texture_id;
+          break;
+
+        case OP_CHANGE_VIEWPORT:
+          {
+            const OpViewport *op = ptr;
+
+            /* This changes glViewport(), nothing can be moved across it */
+            if (!have_viewport || !graphene_rect_equal (&viewport, &op->viewport))
+              segment_start = draws->len;
+
+            viewport = op->viewport;
+            have_viewport = TRUE;
+          }
+          G_GNUC_FALLTHROUGH;
+
+        case OP_CHANGE_OPACITY:
+        case OP_CHANGE_COLOR:
+        case OP_CHANGE_PROJECTION:
+        case OP_CHANGE_MODELVIEW:
+        case OP_CHANGE_CLIP:
+        case OP_CHANGE_REPEAT:
+        case OP_CHANGE_LINEAR_GRADIENT:
+        case OP_CHANGE_RADIAL_GRADIENT:
+        case OP_CHANGE_COLOR_MATRIX:
+        case OP_CHANGE_BLUR:
+        case OP_CHANGE_INSET_SHADOW:
+        case OP_CHANGE_OUTSET_SHADOW:
+        case OP_CHANGE_BORDER:
+        case OP_CHANGE_BORDER_COLOR:
+        case OP_CHANGE_BORDER_WIDTH:
+        case OP_CHANGE_UNBLURRED_OUTSET_SHADOW:
+          if (program != NULL)
+            program->serial = ++serial;
+          break;
+
+        case OP_CHANGE_CROSS_FADE:
+        case OP_CHANGE_BLEND:
+          /* These bind a second texture unit that is shared between programs */
+          if (program != NULL)
+            {
+              program->serial = ++serial;
+              program->uses_source2 = TRUE;
+              source2_serial = serial;
+            }
+          break;
+
+        case OP_DRAW:
+          {
+            DrawInfo *draw;
+            int head;
+
+            if (program == NULL)
+              break;
+
+            g_array_set_size (draws, draws->len + 1);
+            draw = &g_array_index (draws, DrawInfo, draws->len - 1);
+            draw->op = ptr;
+            draw->index_pos = i;
+            draw->serial = program->serial;
+            draw->texture_id = texture_id;
+            draw->source2_serial = program->uses_source2 ? source2_serial : 0;
+            draw->head = draws->len - 1;
+            draw->next = -1;
+            draw->tail = draws->len - 1;
+            compute_draw_bounds (draw->op, vertices, &modelview, &projection, draw);
+
+            head = find_merge_head (draws, segment_start, draws->len - 1);
+            if (head != -1)
+              {
+                DrawInfo *h = &g_array_index (draws, DrawInfo, head);
+
+                g_array_index (draws, DrawInfo, h->tail).next = draws->len - 1;
+                h->tail = draws->len - 1;
+                draw->head = head;
+                entry->kind = OP_NONE;
+                n_merged++;
+              }
+          }
+          break;
+
+        case OP_LAST:
+        default:
+          g_warn_if_reached ();
+        }
+    }
+
+  if (n_merged > 0)
+    {
+      GskQuadVertex *new_vertices;
+      gsize offset = 0;
+
+      /* Lay out the vertices of each group contiguously, in the
+       * order the draws were originally submitted in. */
+      new_vertices = g_new (GskQuadVertex, vertices->len);
+
+      for (i = 0; i < draws->len; i++)
+        {
+          DrawInfo *draw = &g_array_index (draws, DrawInfo, i);
+          gsize start = offset;
+          int n;
+
+          if (draw->head != (int)i)
+            continue;
+
+          for (n = i; n != -1; n = g_array_index (draws, DrawInfo, n).next)
+            {
+              const OpDraw *op = g_array_index (draws, DrawInfo, n).op;
+
+              memcpy (&new_vertices[offset],
+                      &g_array_index (vertices, GskQuadVertex, op->vao_offset),
+                      op->vao_size * sizeof (GskQuadVertex));
+              offset += op->vao_size;
+            }
+
+          draw->op->vao_offset = start;
+          draw->op->vao_size = offset - start;
+        }
+
+      /* Draws without a program never made it into @draws and are
+       * skipped when rendering, so we can safely drop their vertices. */
+      g_array_set_size (vertices, offset);
+      memcpy (vertices->data, new_vertices, offset * sizeof (GskQuadVertex));
+      g_free (new_vertices);
+    }
+
+  g_array_unref (programs);
+  g_array_unref (draws);
+
+  return n_merged;
+}
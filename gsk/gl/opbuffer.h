@@ -49,7 +49,6 @@ typedef struct { float value[2]; guint send: 1; } Float2UniformValue;
 typedef struct { GskRoundedRect value; guint send: 1; guint send_corners: 1; } RRUniformValue;
 typedef struct { const GdkRGBA *value; guint send: 1; } RGBAUniformValue;
 typedef struct { const graphene_vec4_t *value; guint send: 1; } Vec4UniformValue;
-typedef struct { const GskColorStop *value; guint send: 1; } ColorStopUniformValue;
 
 /* OpNode are allocated within OpBuffer.pos, but we keep
  * a secondary index into the locations of that buffer
@@ -111,7 +110,9 @@ typedef struct
 typedef struct
 {
   GskRoundedRect clip;
+  GskRoundedRect outer_clip;
   guint send_corners: 1;
+  guint send_outer_clip: 1;
 } OpClip;
 
 typedef struct
@@ -132,16 +133,14 @@ typedef struct
 
 typedef struct
 {
-  ColorStopUniformValue color_stops;
-  IntUniformValue n_color_stops;
+  FloatUniformValue ramp_y;
   float start_point[2];
   float end_point[2];
 } OpLinearGradient;
 
 typedef struct
 {
-  ColorStopUniformValue color_stops;
-  IntUniformValue n_color_stops;
+  FloatUniformValue ramp_y;
   float start;
   float end;
   float radius[2];
@@ -164,7 +163,7 @@ typedef struct
 typedef struct
 {
   float widths[4];
-  const GdkRGBA *color;
+  const GdkRGBA *colors;
   GskRoundedRect outline;
 } OpBorder;
 
@@ -203,6 +202,11 @@ void     op_buffer_destroy         (OpBuffer *buffer);
 void     op_buffer_clear           (OpBuffer *buffer);
 gpointer op_buffer_add             (OpBuffer *buffer,
                                     OpKind    kind);
+guint    op_buffer_merge_draws     (OpBuffer *buffer,
+                                    GArray   *vertices);
+void     op_buffer_append          (OpBuffer       *buffer,
+                                    const OpBuffer *other,
+                                    gsize           vertex_offset);
 
 typedef struct
 {
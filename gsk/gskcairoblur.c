@@ -51,6 +51,15 @@
 #define BOX_FILTER_SIZE_9 16
 #define BOX_FILTER_SIZE_10 18
 
+/* Only split blurs across threads if there is enough work to make up
+ * for handing it out, and give each thread at least this many rows or
+ * columns to work on.
+ */
+#define MIN_THREADED_PIXELS (256 * 256)
+#define MIN_BAND_SIZE 64
+
+#define COLUMN_BLOCK_SIZE 64
+
 /* This applies a single box blur pass to a horizontal range of pixels;
  * since the box blur has the same weight for all pixels, we can
  * implement an efficient sliding window algorithm where we add
@@ -71,6 +80,7 @@ blur_xspan (guchar *row,
   int offset;
   int sum = 0;
   int i;
+  float inv_d = 1.0f / d;
 
   if (d % 2 == 1)
     offset = d / 2;
@@ -80,14 +90,16 @@ blur_xspan (guchar *row,
   /* All the conditionals in here look slow, but the branches will
    * be well predicted and there are enough different possibilities
    * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
+   * is hard and not an obvious win.
+   *
+   * For the filter sizes we unroll, the compiler turns the division
+   * into a multiplication. For the others, we multiply by the float
+   * reciprocal; (n + 0.5) / d is always at least 0.5 / d away from
+   * an integer, which is far more than the rounding error, so this
+   * gives the same result as the integer division.
    */
 
-#define BLUR_ROW_KERNEL(D)                                      \
+#define BLUR_ROW_KERNEL(D, DIVIDE)                              \
   for (i = -(D) + offset; i < row_width + offset; i++)		\
     {                                                           \
       if (i >= 0 && i < row_width)                              \
@@ -98,40 +110,129 @@ blur_xspan (guchar *row,
 	  if (i >= (D))						\
 	    sum -= row[i - (D)];				\
                                                                 \
-	  tmp_buffer[i - offset] = (sum + (D) / 2) / (D);	\
+	  tmp_buffer[i - offset] = DIVIDE (sum + (D) / 2, D);	\
 	}							\
     }								\
   break;
 
+#define DIVIDE_CONSTANT(n, D) ((n) / (D))
+#define DIVIDE_RECIPROCAL(n, D) ((guchar) (((n) + 0.5f) * inv_d))
+
   /* We unroll the values for d for radius 2-10 to avoid a generic
    * divide operation (not radius 1, because its a no-op) */
   switch (d)
     {
-    case BOX_FILTER_SIZE_2: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_2);
-    case BOX_FILTER_SIZE_3: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_3);
-    case BOX_FILTER_SIZE_4: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_4);
-    case BOX_FILTER_SIZE_5: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_5);
-    case BOX_FILTER_SIZE_6: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_6);
-    case BOX_FILTER_SIZE_7: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_7);
-    case BOX_FILTER_SIZE_8: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_8);
-    case BOX_FILTER_SIZE_9: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_9);
-    case BOX_FILTER_SIZE_10: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_10);
-    default: BLUR_ROW_KERNEL (d);
+    case BOX_FILTER_SIZE_2: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_2, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_3: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_3, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_4: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_4, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_5: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_5, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_6: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_6, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_7: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_7, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_8: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_8, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_9: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_9, DIVIDE_CONSTANT);
+    case BOX_FILTER_SIZE_10: BLUR_ROW_KERNEL (BOX_FILTER_SIZE_10, DIVIDE_CONSTANT);
+    default: BLUR_ROW_KERNEL (d, DIVIDE_RECIPROCAL);
     }
 
+#undef DIVIDE_RECIPROCAL
+#undef DIVIDE_CONSTANT
+#undef BLUR_ROW_KERNEL
+
   memcpy (row, tmp_buffer, row_width);
 }
 
+/* This is the same sliding window as blur_xspan(), applied to
+ * @n_columns columns starting at @first_column at once. Instead of
+ * transposing the buffer and blurring its rows, we keep a running
+ * sum per column and walk down the rows, so that the inner loops
+ * run over consecutive bytes and can be vectorized by the compiler.
+ */
+static inline void
+blur_yspan_block (guchar       *dst_buffer,
+                  const guchar *src_buffer,
+                  int           buffer_width,
+                  int           buffer_height,
+                  int           first_column,
+                  int           n_columns,
+                  int           d,
+                  int           offset)
+{
+  const int half_d = d / 2;
+  const float inv_d = 1.0f / d;
+  int sums[COLUMN_BLOCK_SIZE] = { 0, };
+  int i, x;
+
+  for (i = -d + offset; i < buffer_height + offset; i++)
+    {
+      if (i >= 0 && i < buffer_height)
+        {
+          const guchar *in = src_buffer + i * buffer_width + first_column;
+
+          for (x = 0; x < n_columns; x++)
+            sums[x] += in[x];
+        }
+
+      if (i >= offset)
+        {
+          guchar *out = dst_buffer + (i - offset) * buffer_width + first_column;
+
+          if (i >= d)
+            {
+              const guchar *in = src_buffer + (i - d) * buffer_width + first_column;
+
+              for (x = 0; x < n_columns; x++)
+                sums[x] -= in[x];
+            }
+
+          /* See blur_xspan() for why this is exact */
+          for (x = 0; x < n_columns; x++)
+            out[x] = (guchar) ((sums[x] + half_d + 0.5f) * inv_d);
+        }
+    }
+}
+
+static void
+blur_yspan (guchar       *dst_buffer,
+            const guchar *src_buffer,
+            int           buffer_width,
+            int           buffer_height,
+            int           first_column,
+            int           last_column,
+            int           d,
+            int           shift)
+{
+  int offset;
+  int x;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  /* Work on blocks of a constant number of columns, the compiler only
+   * vectorizes loops with an unknown trip count at higher optimization
+   * levels. This also keeps the sums in the cache.
+   */
+  for (x = first_column; x + COLUMN_BLOCK_SIZE <= last_column; x += COLUMN_BLOCK_SIZE)
+    blur_yspan_block (dst_buffer, src_buffer, buffer_width, buffer_height,
+                      x, COLUMN_BLOCK_SIZE, d, offset);
+
+  if (x < last_column)
+    blur_yspan_block (dst_buffer, src_buffer, buffer_width, buffer_height,
+                      x, last_column - x, d, offset);
+}
+
 static void
 blur_rows (guchar *dst_buffer,
            guchar *tmp_buffer,
            int     buffer_width,
-           int     buffer_height,
+           int     first_row,
+           int     last_row,
            int     d)
 {
   int i;
 
-  for (i = 0; i < buffer_height; i++)
+  for (i = first_row; i < last_row; i++)
     {
       guchar *row = dst_buffer + i * buffer_width;
 
@@ -156,33 +257,167 @@ blur_rows (guchar *dst_buffer,
     }
 }
 
-/* Swaps width and height.
- */
 static void
-flip_buffer (guchar *dst_buffer,
-             guchar *src_buffer,
-             int     width,
-             int     height)
+blur_columns (guchar *buffer,
+              guchar *tmp_buffer,
+              int     buffer_width,
+              int     buffer_height,
+              int     first_column,
+              int     last_column,
+              int     d)
 {
-  /* Working in blocks increases cache efficiency, compared to reading
-   * or writing an entire column at once
+  int i;
+
+  /* Same passes as in blur_rows(), going back and forth between
+   * the two buffers, since a pass can't be done in place.
    */
-#define BLOCK_SIZE 16
-
-  int i0, j0;
-
-  for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
-    for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-      {
-        int max_j = MIN(j0 + BLOCK_SIZE, height);
-        int max_i = MIN(i0 + BLOCK_SIZE, width);
-        int i, j;
-
-        for (i = i0; i < max_i; i++)
-          for (j = j0; j < max_j; j++)
-            dst_buffer[i * height + j] = src_buffer[j * width + i];
-      }
-#undef BLOCK_SIZE
+  if (d % 2 == 1)
+    {
+      blur_yspan (tmp_buffer, buffer, buffer_width, buffer_height, first_column, last_column, d, 0);
+      blur_yspan (buffer, tmp_buffer, buffer_width, buffer_height, first_column, last_column, d, 0);
+      blur_yspan (tmp_buffer, buffer, buffer_width, buffer_height, first_column, last_column, d, 0);
+    }
+  else
+    {
+      blur_yspan (tmp_buffer, buffer, buffer_width, buffer_height, first_column, last_column, d, 1);
+      blur_yspan (buffer, tmp_buffer, buffer_width, buffer_height, first_column, last_column, d, -1);
+      blur_yspan (tmp_buffer, buffer, buffer_width, buffer_height, first_column, last_column, d + 1, 0);
+    }
+
+  for (i = 0; i < buffer_height; i++)
+    memcpy (buffer + i * buffer_width + first_column,
+            tmp_buffer + i * buffer_width + first_column,
+            last_column - first_column);
+}
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  int n_pending;
+
+  guchar *buffer;
+  guchar *tmp_buffer;
+  int width;
+  int height;
+  int d;
+  gboolean vertical;
+} BlurJob;
+
+typedef struct
+{
+  BlurJob *job;
+  int start;
+  int end;
+} BlurBand;
+
+static void
+blur_band (BlurBand *band)
+{
+  BlurJob *job = band->job;
+
+  if (job->vertical)
+    {
+      blur_columns (job->buffer, job->tmp_buffer,
+                    job->width, job->height,
+                    band->start, band->end, job->d);
+    }
+  else
+    {
+      /* The rows are blurred in place, each band only needs a row
+       * of scratch space, which we take from its own rows in the
+       * otherwise unused temporary buffer.
+       */
+      blur_rows (job->buffer, job->tmp_buffer + band->start * job->width,
+                 job->width, band->start, band->end, job->d);
+    }
+}
+
+static void
+blur_band_thread_func (gpointer data,
+                       gpointer user_data)
+{
+  BlurBand *band = data;
+  BlurJob *job = band->job;
+
+  blur_band (band);
+
+  g_mutex_lock (&job->lock);
+  job->n_pending--;
+  if (job->n_pending == 0)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static GThreadPool *
+get_blur_pool (void)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *p = g_thread_pool_new (blur_band_thread_func, NULL,
+                                          MAX (1, (int) g_get_num_processors () - 1),
+                                          FALSE, NULL);
+      g_once_init_leave (&pool, p);
+    }
+
+  return pool;
+}
+
+/* Splits the rows or columns of the buffer into bands, hands all but
+ * the first to the thread pool and blurs the first one while waiting.
+ */
+static void
+blur_job_run (BlurJob *job)
+{
+  BlurBand bands[32];
+  int size, n_bands, band_size;
+  int i;
+
+  size = job->vertical ? job->width : job->height;
+
+  if ((gsize) job->width * job->height < MIN_THREADED_PIXELS)
+    n_bands = 1;
+  else
+    n_bands = CLAMP (size / MIN_BAND_SIZE, 1, MIN ((int) g_get_num_processors (), (int) G_N_ELEMENTS (bands)));
+
+  band_size = (size + n_bands - 1) / n_bands;
+  /* Keep column bands on separate cache lines */
+  if (job->vertical)
+    band_size = (band_size + COLUMN_BLOCK_SIZE - 1) & ~(COLUMN_BLOCK_SIZE - 1);
+
+  n_bands = 0;
+  for (i = 0; i < size; i += band_size)
+    {
+      bands[n_bands].job = job;
+      bands[n_bands].start = i;
+      bands[n_bands].end = MIN (i + band_size, size);
+      n_bands++;
+    }
+
+  if (n_bands == 1)
+    {
+      blur_band (&bands[0]);
+      return;
+    }
+
+  g_mutex_init (&job->lock);
+  g_cond_init (&job->cond);
+  job->n_pending = n_bands - 1;
+
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (get_blur_pool (), &bands[i], NULL);
+
+  blur_band (&bands[0]);
+
+  g_mutex_lock (&job->lock);
+  while (job->n_pending > 0)
+    g_cond_wait (&job->cond, &job->lock);
+  g_mutex_unlock (&job->lock);
+
+  g_cond_clear (&job->cond);
+  g_mutex_clear (&job->lock);
 }
 
 static void
@@ -192,30 +427,27 @@ _boxblur (guchar      *buffer,
           int          radius,
           GskBlurFlags flags)
 {
-  guchar *flipped_buffer;
-  int d = get_box_filter_size (radius);
+  BlurJob job;
 
-  flipped_buffer = g_malloc (width * height);
+  job.buffer = buffer;
+  job.tmp_buffer = g_malloc (width * height);
+  job.width = width;
+  job.height = height;
+  job.d = get_box_filter_size (radius);
 
   if (flags & GSK_BLUR_Y)
     {
-      /* Step 1: swap rows and columns */
-      flip_buffer (flipped_buffer, buffer, width, height);
-
-      /* Step 2: blur rows (really columns) */
-      blur_rows (flipped_buffer, buffer, height, width, d);
-
-      /* Step 3: swap rows and columns */
-      flip_buffer (buffer, flipped_buffer, height, width);
+      job.vertical = TRUE;
+      blur_job_run (&job);
     }
 
   if (flags & GSK_BLUR_X)
     {
-      /* Step 4: blur rows */
-      blur_rows (buffer, flipped_buffer, width, height, d);
+      job.vertical = FALSE;
+      blur_job_run (&job);
     }
 
-  g_free (flipped_buffer);
+  g_free (job.tmp_buffer);
 }
 
 /*
@@ -72,10 +72,213 @@ gsk_cairo_renderer_unrealize (GskRenderer *renderer)
   g_clear_object (&self->cairo_context);
 }
 
+/* Large frames drawn to image surfaces are split into tiles that get
+ * drawn in parallel, each with its own cairo context. Tiles are
+ * aligned to device pixels, so they never touch the same pixels.
+ */
+#define TILE_SIZE 128
+#define MIN_TILED_PIXELS (256 * 256)
+#define MAX_TILE_THREADS 8
+
+typedef struct {
+  GMutex lock;
+  GCond cond;
+  int n_pending;
+
+  GskRenderNode *root;
+  const cairo_region_t *region;
+  cairo_matrix_t matrix;
+  guchar *data;
+  int stride;
+  cairo_format_t format;
+  double x_scale, y_scale;
+  double x_offset, y_offset;
+
+  cairo_rectangle_int_t *tiles;
+  int n_tiles;
+  int next_tile;
+} TileBatch;
+
+static void
+draw_tile (TileBatch                   *batch,
+           const cairo_rectangle_int_t *tile)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create_for_data (batch->data + tile->y * batch->stride + tile->x * 4,
+                                                 batch->format,
+                                                 tile->width, tile->height,
+                                                 batch->stride);
+  cairo_surface_set_device_scale (surface, batch->x_scale, batch->y_scale);
+  cairo_surface_set_device_offset (surface,
+                                   batch->x_offset - tile->x,
+                                   batch->y_offset - tile->y);
+
+  cr = cairo_create (surface);
+  gdk_cairo_region (cr, batch->region);
+  cairo_clip (cr);
+  cairo_set_matrix (cr, &batch->matrix);
+
+  gsk_render_node_draw (batch->root, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+}
+
+static void
+draw_tiles (TileBatch *batch)
+{
+  int i;
+
+  while ((i = g_atomic_int_add (&batch->next_tile, 1)) < batch->n_tiles)
+    draw_tile (batch, &batch->tiles[i]);
+}
+
+static void
+draw_tiles_threaded (gpointer data,
+                     gpointer user_data)
+{
+  TileBatch *batch = data;
+
+  draw_tiles (batch);
+
+  g_mutex_lock (&batch->lock);
+  batch->n_pending--;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+static GThreadPool *
+get_tile_pool (int *n_threads)
+{
+  static GThreadPool *pool = NULL;
+  static int max_threads = 0;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *result;
+
+      max_threads = CLAMP ((int) g_get_num_processors () - 1, 1, MAX_TILE_THREADS);
+      result = g_thread_pool_new (draw_tiles_threaded, NULL, max_threads, FALSE, NULL);
+
+      g_once_init_leave (&pool, result);
+    }
+
+  *n_threads = max_threads;
+
+  return pool;
+}
+
+static gboolean
+gsk_cairo_renderer_draw_tiled (cairo_t              *cr,
+                               GskRenderNode        *root,
+                               const cairo_region_t *region)
+{
+  cairo_surface_t *target = cairo_get_target (cr);
+  cairo_rectangle_int_t extents;
+  TileBatch batch;
+  GArray *tiles;
+  GThreadPool *pool;
+  int width, height;
+  int x0, y0, x1, y1, x, y;
+  int n_threads, i;
+
+  if (region == NULL ||
+      g_get_num_processors () < 2 ||
+      cairo_surface_get_type (target) != CAIRO_SURFACE_TYPE_IMAGE)
+    return FALSE;
+
+  batch.format = cairo_image_surface_get_format (target);
+  if (batch.format != CAIRO_FORMAT_ARGB32 && batch.format != CAIRO_FORMAT_RGB24)
+    return FALSE;
+
+  cairo_surface_get_device_scale (target, &batch.x_scale, &batch.y_scale);
+  cairo_surface_get_device_offset (target, &batch.x_offset, &batch.y_offset);
+  width = cairo_image_surface_get_width (target);
+  height = cairo_image_surface_get_height (target);
+
+  /* The region's extents in device pixels */
+  cairo_region_get_extents (region, &extents);
+  x0 = MAX (0, floor (extents.x * batch.x_scale + batch.x_offset));
+  y0 = MAX (0, floor (extents.y * batch.y_scale + batch.y_offset));
+  x1 = MIN (width, ceil ((extents.x + extents.width) * batch.x_scale + batch.x_offset));
+  y1 = MIN (height, ceil ((extents.y + extents.height) * batch.y_scale + batch.y_offset));
+
+  if (x1 <= x0 || y1 <= y0 ||
+      (gsize) (x1 - x0) * (y1 - y0) < MIN_TILED_PIXELS)
+    return FALSE;
+
+  if (!gsk_render_node_can_draw_tiled (root))
+    return FALSE;
+
+  tiles = g_array_new (FALSE, FALSE, sizeof (cairo_rectangle_int_t));
+
+  for (y = y0 - y0 % TILE_SIZE; y < y1; y += TILE_SIZE)
+    for (x = x0 - x0 % TILE_SIZE; x < x1; x += TILE_SIZE)
+      {
+        cairo_rectangle_int_t tile, area;
+
+        tile.x = MAX (x, x0);
+        tile.y = MAX (y, y0);
+        tile.width = MIN (x + TILE_SIZE, x1) - tile.x;
+        tile.height = MIN (y + TILE_SIZE, y1) - tile.y;
+
+        /* Cull tiles outside the region, in surface coordinates */
+        area.x = floor ((tile.x - batch.x_offset) / batch.x_scale);
+        area.y = floor ((tile.y - batch.y_offset) / batch.y_scale);
+        area.width = ceil ((tile.x + tile.width - batch.x_offset) / batch.x_scale) - area.x;
+        area.height = ceil ((tile.y + tile.height - batch.y_offset) / batch.y_scale) - area.y;
+
+        if (cairo_region_contains_rectangle (region, &area) != CAIRO_REGION_OVERLAP_OUT)
+          g_array_append_val (tiles, tile);
+      }
+
+  cairo_surface_flush (target);
+
+  batch.root = root;
+  batch.region = region;
+  cairo_get_matrix (cr, &batch.matrix);
+  batch.data = cairo_image_surface_get_data (target);
+  batch.stride = cairo_image_surface_get_stride (target);
+  batch.tiles = (cairo_rectangle_int_t *) tiles->data;
+  batch.n_tiles = tiles->len;
+  batch.next_tile = 0;
+
+  pool = get_tile_pool (&n_threads);
+
+  /* The calling thread draws tiles, too */
+  n_threads = CLAMP (batch.n_tiles - 1, 0, n_threads);
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.n_pending = n_threads;
+
+  for (i = 0; i < n_threads; i++)
+    g_thread_pool_push (pool, &batch, NULL);
+
+  draw_tiles (&batch);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.lock);
+  g_array_free (tiles, TRUE);
+
+  cairo_surface_mark_dirty (target);
+
+  return TRUE;
+}
+
 static void
-gsk_cairo_renderer_do_render (GskRenderer   *renderer,
-                              cairo_t       *cr,
-                              GskRenderNode *root)
+gsk_cairo_renderer_do_render (GskRenderer          *renderer,
+                              cairo_t              *cr,
+                              GskRenderNode        *root,
+                              const cairo_region_t *region)
 {
 #ifdef G_ENABLE_DEBUG
   GskCairoRenderer *self = GSK_CAIRO_RENDERER (renderer);
@@ -88,7 +291,8 @@ gsk_cairo_renderer_do_render (GskRenderer   *renderer,
   gsk_profiler_timer_begin (profiler, self->profile_timers.cpu_time);
 #endif
 
-  gsk_render_node_draw (root, cr);
+  if (!gsk_cairo_renderer_draw_tiled (cr, root, region))
+    gsk_render_node_draw (root, cr);
 
 #ifdef G_ENABLE_DEBUG
   cpu_time = gsk_profiler_timer_end (profiler, self->profile_timers.cpu_time);
@@ -112,7 +316,7 @@ gsk_cairo_renderer_render_texture (GskRenderer           *renderer,
 
   cairo_translate (cr, - viewport->origin.x, - viewport->origin.y);
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, root, NULL);
 
   cairo_destroy (cr);
 
@@ -152,7 +356,8 @@ gsk_cairo_renderer_render (GskRenderer          *renderer,
     }
 #endif
 
-  gsk_cairo_renderer_do_render (renderer, cr, root);
+  gsk_cairo_renderer_do_render (renderer, cr, root,
+                                gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->cairo_context)));
 
   cairo_destroy (cr);
 
@@ -11,11 +11,15 @@ static const GdkDebugKey gsk_debug_keys[] = {
   { "surface", GSK_DEBUG_SURFACE, "Information about surfaces" },
   { "fallback", GSK_DEBUG_FALLBACK, "Information about fallbacks" },
   { "glyphcache", GSK_DEBUG_GLYPH_CACHE, "Information about glyph caching" },
+  { "optimizer", GSK_DEBUG_OPTIMIZER, "Information about render node optimization" },
   { "geometry", GSK_DEBUG_GEOMETRY, "Show borders (when using cairo)" },
   { "full-redraw", GSK_DEBUG_FULL_REDRAW, "Force full redraws" },
   { "sync", GSK_DEBUG_SYNC, "Sync after each frame" },
   { "vulkan-staging-image", GSK_DEBUG_VULKAN_STAGING_IMAGE, "Use a staging image for Vulkan texture upload" },
-  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER, "Use a staging buffer for Vulkan texture upload" }
+  { "vulkan-staging-buffer", GSK_DEBUG_VULKAN_STAGING_BUFFER, "Use a staging buffer for Vulkan texture upload" },
+  { "no-offload", GSK_DEBUG_NO_OFFLOAD, "Don't offload textures to subsurfaces" },
+  { "no-optimize", GSK_DEBUG_NO_OPTIMIZE, "Don't optimize render node trees" },
+  { "no-intern", GSK_DEBUG_NO_INTERN, "Don't share identical render nodes" }
 };
 #endif
 
@@ -180,6 +180,22 @@ typedef enum {
   GSK_SERIALIZATION_INVALID_DATA
 } GskSerializationError;
 
+/**
+ * GskSerializationFormat:
+ * @GSK_SERIALIZATION_FORMAT_TEXT: A human readable text format that
+ *     can be edited and is stable enough to be used in tests
+ * @GSK_SERIALIZATION_FORMAT_BINARY: A compact binary format that is
+ *     fast to create and load, but only works with the same version
+ *     of GTK on a machine with the same byte order
+ *
+ * The formats that gsk_render_node_serialize_to_format() can produce.
+ * gsk_render_node_deserialize() detects the format automatically.
+ */
+typedef enum {
+  GSK_SERIALIZATION_FORMAT_TEXT,
+  GSK_SERIALIZATION_FORMAT_BINARY
+} GskSerializationFormat;
+
 /**
  * GskTransformCategory:
  * @GSK_TRANSFORM_CATEGORY_UNKNOWN: The category of the matrix has not been
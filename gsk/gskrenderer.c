@@ -44,6 +44,10 @@
 
 #include "gskenumtypes.h"
 
+#include "gdk/gdkdmabuftextureprivate.h"
+#include "gdk/gdkframeclockprivate.h"
+#include "gdk/gdksurfaceprivate.h"
+
 #include <graphene-gobject.h>
 #include <cairo-gobject.h>
 #include <gdk/gdk.h>
@@ -80,6 +84,7 @@ typedef struct
   GskRenderNode *root_node;
 
   GskProfiler *profiler;
+  gint64 gpu_time;
 
   GskDebugFlags debug_flags;
 
@@ -318,6 +323,9 @@ gsk_renderer_unrealize (GskRenderer *renderer)
 
   GSK_RENDERER_GET_CLASS (renderer)->unrealize (renderer);
 
+  if (priv->surface)
+    gdk_surface_offload_texture (priv->surface, NULL, NULL);
+
   g_clear_pointer (&priv->prev_node, gsk_render_node_unref);
 
   priv->is_realized = FALSE;
@@ -386,6 +394,168 @@ gsk_renderer_render_texture (GskRenderer           *renderer,
   return texture;
 }
 
+/* Finds a dma-buf texture node that is drawn on top of everything
+ * else, and returns a copy of @node without it. Only translations
+ * and clips that don't affect the texture are allowed on the way,
+ * so the texture can be shown as-is by the compositor.
+ */
+static GskRenderNode *
+remove_offload_node (GskRenderNode    *node,
+                     float             dx,
+                     float             dy,
+                     GdkTexture      **texture,
+                     graphene_rect_t  *bounds)
+{
+  GskRenderNode *child, *result;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_TEXTURE_NODE:
+      if (!GDK_IS_DMABUF_TEXTURE (gsk_texture_node_get_texture (node)))
+        return NULL;
+
+      *texture = gsk_texture_node_get_texture (node);
+      graphene_rect_offset_r (&node->bounds, dx, dy, bounds);
+      return gsk_container_node_new (NULL, 0);
+
+    case GSK_CONTAINER_NODE:
+      {
+        guint i, n_children;
+        GskRenderNode **children;
+
+        n_children = gsk_container_node_get_n_children (node);
+        if (n_children == 0)
+          return NULL;
+
+        child = remove_offload_node (gsk_container_node_get_child (node, n_children - 1),
+                                     dx, dy, texture, bounds);
+        if (child == NULL)
+          return NULL;
+
+        children = g_new (GskRenderNode *, n_children);
+        for (i = 0; i < n_children - 1; i++)
+          children[i] = gsk_container_node_get_child (node, i);
+        children[n_children - 1] = child;
+
+        result = gsk_container_node_new (children, n_children);
+
+        g_free (children);
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      child = remove_offload_node (gsk_debug_node_get_child (node), dx, dy, texture, bounds);
+      if (child == NULL)
+        return NULL;
+
+      result = gsk_debug_node_new (child, g_strdup (gsk_debug_node_get_message (node)));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform = gsk_transform_node_get_transform (node);
+        float tx, ty;
+
+        if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+          return NULL;
+
+        gsk_transform_to_translate (transform, &tx, &ty);
+        child = remove_offload_node (gsk_transform_node_get_child (node),
+                                     dx + tx, dy + ty, texture, bounds);
+        if (child == NULL)
+          return NULL;
+
+        result = gsk_transform_node_new (child, transform);
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      if (!graphene_rect_contains_rect (gsk_clip_node_get_clip (node),
+                                        &gsk_clip_node_get_child (node)->bounds))
+        return NULL;
+
+      child = remove_offload_node (gsk_clip_node_get_child (node), dx, dy, texture, bounds);
+      if (child == NULL)
+        return NULL;
+
+      result = gsk_clip_node_new (child, gsk_clip_node_get_clip (node));
+      break;
+
+    default:
+      return NULL;
+    }
+
+  gsk_render_node_unref (child);
+
+  return result;
+}
+
+/* Tries to hand the topmost texture of @root to the surface, and
+ * returns the nodes that are left to render.
+ */
+static GskRenderNode *
+gsk_renderer_offload (GskRenderer   *renderer,
+                      GskRenderNode *root)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+  GskRenderNode *reduced = NULL;
+  GdkTexture *texture = NULL;
+  graphene_rect_t bounds;
+
+  if (!GSK_RENDERER_DEBUG_CHECK (renderer, NO_OFFLOAD))
+    reduced = remove_offload_node (root, 0, 0, &texture, &bounds);
+
+  if (reduced)
+    {
+      GdkRectangle area = {
+        bounds.origin.x, bounds.origin.y,
+        bounds.size.width, bounds.size.height
+      };
+
+      /* The subsurface can't be clipped, so it must lie on pixel
+       * boundaries inside the surface.
+       */
+      if (area.x == bounds.origin.x && area.y == bounds.origin.y &&
+          area.width == bounds.size.width && area.height == bounds.size.height &&
+          area.x >= 0 && area.y >= 0 &&
+          area.x + area.width <= gdk_surface_get_width (priv->surface) &&
+          area.y + area.height <= gdk_surface_get_height (priv->surface) &&
+          gdk_surface_offload_texture (priv->surface, texture, &area))
+        return reduced;
+
+      gsk_render_node_unref (reduced);
+    }
+
+  gdk_surface_offload_texture (priv->surface, NULL, NULL);
+
+  return gsk_render_node_ref (root);
+}
+
+/* Returns the tree that actually gets rendered. Diffing still uses the
+ * tree as it was passed in, so that it can rely on the nodes that
+ * didn't change being identical.
+ */
+static GskRenderNode *
+gsk_renderer_optimize (GskRenderer   *renderer,
+                       GskRenderNode *root)
+{
+  GskRenderNode *optimized;
+
+  if (GSK_RENDERER_DEBUG_CHECK (renderer, NO_OPTIMIZE))
+    return gsk_render_node_ref (root);
+
+  optimized = gsk_render_node_optimize (root);
+  if (optimized == NULL)
+    optimized = gsk_container_node_new (NULL, 0);
+
+  GSK_RENDERER_NOTE (renderer, OPTIMIZER,
+                     g_message ("Optimized render nodes: %u before, %u after",
+                                gsk_render_node_count_nodes (root),
+                                gsk_render_node_count_nodes (optimized)));
+
+  return optimized;
+}
+
 /**
  * gsk_renderer_render:
  * @renderer: a #GskRenderer
@@ -410,13 +580,18 @@ gsk_renderer_render (GskRenderer          *renderer,
                      const cairo_region_t *region)
 {
   GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+  GdkFrameTimings *timings;
+  GskRenderNode *optimized;
   cairo_region_t *clip;
+  gint64 start_time;
 
   g_return_if_fail (GSK_IS_RENDERER (renderer));
   g_return_if_fail (priv->is_realized);
   g_return_if_fail (GSK_IS_RENDER_NODE (root));
   g_return_if_fail (priv->root_node == NULL);
 
+  root = gsk_renderer_offload (renderer, root);
+
   if (region == NULL || priv->prev_node == NULL || GSK_RENDERER_DEBUG_CHECK (renderer, FULL_REDRAW))
     {
       clip = cairo_region_create_rectangle (&(GdkRectangle) {
@@ -433,13 +608,26 @@ gsk_renderer_render (GskRenderer          *renderer,
       if (cairo_region_is_empty (clip))
         {
           cairo_region_destroy (clip);
+          gsk_render_node_unref (root);
           return;
         }
     }
 
-  priv->root_node = gsk_render_node_ref (root);
+  priv->root_node = root;
+
+  priv->gpu_time = 0;
+  start_time = g_get_monotonic_time ();
+
+  optimized = gsk_renderer_optimize (renderer, root);
+  GSK_RENDERER_GET_CLASS (renderer)->render (renderer, optimized, clip);
+  gsk_render_node_unref (optimized);
 
-  GSK_RENDERER_GET_CLASS (renderer)->render (renderer, root, clip);
+  timings = gdk_frame_clock_get_current_timings (gdk_surface_get_frame_clock (priv->surface));
+  if (timings)
+    {
+      timings->render_cpu_time += g_get_monotonic_time () - start_time;
+      timings->render_gpu_time += priv->gpu_time;
+    }
 
 #ifdef G_ENABLE_DEBUG
   if (GSK_RENDERER_DEBUG_CHECK (renderer, RENDERER))
@@ -482,6 +670,26 @@ gsk_renderer_get_profiler (GskRenderer *renderer)
   return priv->profiler;
 }
 
+/*< private >
+ * gsk_renderer_set_gpu_time:
+ * @renderer: a #GskRenderer
+ * @gpu_time: the GPU time in microseconds
+ *
+ * Lets the renderer report how much GPU time the frame it is
+ * currently rendering took, so it can be recorded in the frame
+ * timings.
+ */
+void
+gsk_renderer_set_gpu_time (GskRenderer *renderer,
+                           gint64       gpu_time)
+{
+  GskRendererPrivate *priv = gsk_renderer_get_instance_private (renderer);
+
+  g_return_if_fail (GSK_IS_RENDERER (renderer));
+
+  priv->gpu_time = gpu_time;
+}
+
 static GType
 get_renderer_for_name (const char *renderer_name)
 {
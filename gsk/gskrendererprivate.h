@@ -54,6 +54,8 @@ struct _GskRendererClass
 GskRenderNode *         gsk_renderer_get_root_node              (GskRenderer    *renderer);
 
 GskProfiler *           gsk_renderer_get_profiler               (GskRenderer    *renderer);
+void                    gsk_renderer_set_gpu_time               (GskRenderer    *renderer,
+                                                                 gint64          gpu_time);
 
 GskDebugFlags           gsk_renderer_get_debug_flags            (GskRenderer    *renderer);
 void                    gsk_renderer_set_debug_flags            (GskRenderer    *renderer,
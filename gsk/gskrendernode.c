@@ -142,6 +142,9 @@ value_render_node_lcopy_value (const GValue *value,
 static void
 gsk_render_node_finalize (GskRenderNode *self)
 {
+  if (self->optimized != self)
+    g_clear_pointer (&self->optimized, gsk_render_node_unref);
+
   g_type_free_instance ((GTypeInstance *) self);
 }
 
@@ -473,6 +476,119 @@ gsk_render_node_draw (GskRenderNode *node,
     }
 }
 
+static gboolean
+can_draw_threaded (GskRenderNode *node,
+                   gboolean       text_is_safe)
+{
+  guint i;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      return TRUE;
+
+    case GSK_TEXTURE_NODE:
+      return GDK_IS_MEMORY_TEXTURE (gsk_texture_node_get_texture (node));
+
+    case GSK_CONTAINER_NODE:
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        {
+          if (!can_draw_threaded (gsk_container_node_get_child (node, i), text_is_safe))
+            return FALSE;
+        }
+      return TRUE;
+
+    case GSK_TRANSFORM_NODE:
+      return can_draw_threaded (gsk_transform_node_get_child (node), text_is_safe);
+
+    case GSK_OPACITY_NODE:
+      return can_draw_threaded (gsk_opacity_node_get_child (node), text_is_safe);
+
+    case GSK_COLOR_MATRIX_NODE:
+      return can_draw_threaded (gsk_color_matrix_node_get_child (node), text_is_safe);
+
+    case GSK_REPEAT_NODE:
+      return can_draw_threaded (gsk_repeat_node_get_child (node), text_is_safe);
+
+    case GSK_CLIP_NODE:
+      return can_draw_threaded (gsk_clip_node_get_child (node), text_is_safe);
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return can_draw_threaded (gsk_rounded_clip_node_get_child (node), text_is_safe);
+
+    case GSK_SHADOW_NODE:
+      return can_draw_threaded (gsk_shadow_node_get_child (node), text_is_safe);
+
+    case GSK_BLUR_NODE:
+      return can_draw_threaded (gsk_blur_node_get_child (node), text_is_safe);
+
+    case GSK_DEBUG_NODE:
+      return can_draw_threaded (gsk_debug_node_get_child (node), text_is_safe);
+
+    case GSK_BLEND_NODE:
+      return can_draw_threaded (gsk_blend_node_get_bottom_child (node), text_is_safe) &&
+             can_draw_threaded (gsk_blend_node_get_top_child (node), text_is_safe);
+
+    case GSK_CROSS_FADE_NODE:
+      return can_draw_threaded (gsk_cross_fade_node_get_start_child (node), text_is_safe) &&
+             can_draw_threaded (gsk_cross_fade_node_get_end_child (node), text_is_safe);
+
+    case GSK_TEXT_NODE:
+      return text_is_safe;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * gsk_render_node_can_draw_threaded:
+ * @node: a #GskRenderNode
+ *
+ * Checks if gsk_render_node_draw() can be called for @node from
+ * a thread other than the one the renderer runs in.
+ *
+ * Text needs Pango, which may not be used from multiple threads,
+ * and textures other than memory textures may need a GL context
+ * to be downloaded.
+ *
+ * Returns: %TRUE if @node can be drawn from another thread
+ **/
+gboolean
+gsk_render_node_can_draw_threaded (GskRenderNode *node)
+{
+  return can_draw_threaded (node, FALSE);
+}
+
+/*
+ * gsk_render_node_can_draw_tiled:
+ * @node: a #GskRenderNode
+ *
+ * Checks if parts of @node can be drawn with gsk_render_node_draw()
+ * from several threads at once, while the thread the renderer runs
+ * in waits for them.
+ *
+ * This is like gsk_render_node_can_draw_threaded(), but allows text:
+ * Pango is not used elsewhere while the renderer waits, and the text
+ * nodes serialize their drawing.
+ *
+ * Returns: %TRUE if @node can be drawn in tiles from several threads
+ **/
+gboolean
+gsk_render_node_can_draw_tiled (GskRenderNode *node)
+{
+  return can_draw_threaded (node, TRUE);
+}
+
 /*
  * gsk_render_node_can_diff:
  * @node1: a #GskRenderNode
@@ -554,6 +670,39 @@ gsk_render_node_diff (GskRenderNode  *node1,
   return GSK_RENDER_NODE_GET_CLASS (node1)->diff (node1, node2, region);
 }
 
+/**
+ * gsk_render_node_serialize_to_format:
+ * @node: a #GskRenderNode
+ * @format: the format to use
+ *
+ * Serializes the @node like gsk_render_node_serialize(), but allows
+ * selecting the format.
+ *
+ * %GSK_SERIALIZATION_FORMAT_BINARY is considerably faster to create
+ * and load than the text format, because textures are stored
+ * uncompressed and only once. This makes it suitable for recording
+ * many frames. The data can be passed to gsk_render_node_deserialize()
+ * as-is, including from a mapped file.
+ *
+ * Returns: a #GBytes representing the node.
+ **/
+GBytes *
+gsk_render_node_serialize_to_format (GskRenderNode          *node,
+                                     GskSerializationFormat  format)
+{
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  switch (format)
+    {
+    case GSK_SERIALIZATION_FORMAT_BINARY:
+      return gsk_render_node_serialize_binary (node);
+
+    case GSK_SERIALIZATION_FORMAT_TEXT:
+    default:
+      return gsk_render_node_serialize (node);
+    }
+}
+
 /**
  * gsk_render_node_write_to_file:
  * @node: a #GskRenderNode
@@ -597,8 +746,10 @@ gsk_render_node_write_to_file (GskRenderNode *node,
  * @error_func: (nullable) (scope call): Callback on parsing errors or %NULL
  * @user_data: (closure error_func): user_data for @error_func
  *
- * Loads data previously created via gsk_render_node_serialize(). For a
- * discussion of the supported format, see that function.
+ * Loads data previously created via gsk_render_node_serialize() or
+ * gsk_render_node_serialize_to_format(). The format is detected
+ * automatically. For a discussion of the supported format, see
+ * gsk_render_node_serialize().
  *
  * Returns: (nullable) (transfer full): a new #GskRenderNode or %NULL on
  *     error.
@@ -610,7 +761,10 @@ gsk_render_node_deserialize (GBytes            *bytes,
 {
   GskRenderNode *node = NULL;
 
-  node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
+  if (gsk_render_node_is_binary_data (bytes))
+    node = gsk_render_node_deserialize_binary (bytes, error_func, user_data);
+  else
+    node = gsk_render_node_deserialize_from_bytes (bytes, error_func, user_data);
 
   return node;
 }
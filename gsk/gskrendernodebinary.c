@@ -0,0 +1,1448 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskrendernodeparserprivate.h"
+
+#include "gskrendernodeprivate.h"
+#include "gsktransformprivate.h"
+
+#include <gtk/css/gtkcss.h>
+
+#include <math.h>
+#include <string.h>
+
+/* The binary format is meant for capturing and replaying frames quickly,
+ * so it is a plain dump of the node tree in host byte order:
+ *
+ *   header         magic, byte order mark, version, number of fonts
+ *                  and number of textures
+ *   fonts          font descriptions as strings
+ *   textures       width and height, followed by the pixels in
+ *                  GDK_MEMORY_DEFAULT format, 16-byte aligned
+ *   node           the root node, children are written recursively
+ *
+ * All values are 32bit wide. Textures and fonts are written only once,
+ * nodes refer to them by index. Texture pixels are not copied when
+ * loading, so deserializing mapped files gives textures that point
+ * straight into the mapping.
+ */
+
+#define BINARY_VERSION 1
+#define BYTE_ORDER_MARK 0x01020304
+#define TEXTURE_ALIGNMENT 16
+
+static const guint8 binary_magic[8] = { 0x89, 'G', 'S', 'K', '\r', '\n', 0x1a, '\n' };
+
+typedef struct
+{
+  guint8 magic[8];
+  guint32 byte_order;
+  guint32 version;
+  guint32 n_fonts;
+  guint32 n_textures;
+} BinaryHeader;
+
+gboolean
+gsk_render_node_is_binary_data (GBytes *bytes)
+{
+  gsize size;
+  const guchar *data = g_bytes_get_data (bytes, &size);
+
+  return size >= sizeof (binary_magic) &&
+         memcmp (data, binary_magic, sizeof (binary_magic)) == 0;
+}
+
+/*** WRITING ***/
+
+typedef struct
+{
+  GByteArray *nodes;
+  GHashTable *texture_indices;
+  GPtrArray *textures;
+  GHashTable *font_indices;
+  GPtrArray *fonts;
+} Writer;
+
+static void
+write_uint32 (GByteArray *array,
+              guint32     value)
+{
+  g_byte_array_append (array, (guint8 *) &value, sizeof (guint32));
+}
+
+static void
+write_float (GByteArray *array,
+             float       value)
+{
+  g_byte_array_append (array, (guint8 *) &value, sizeof (float));
+}
+
+static void
+write_floats (GByteArray  *array,
+              const float *values,
+              guint        n_values)
+{
+  g_byte_array_append (array, (guint8 *) values, n_values * sizeof (float));
+}
+
+static void
+write_padding (GByteArray *array,
+               gsize       alignment)
+{
+  static const guint8 zeroes[TEXTURE_ALIGNMENT] = { 0, };
+  gsize padding = (alignment - array->len % alignment) % alignment;
+
+  g_byte_array_append (array, zeroes, padding);
+}
+
+static void
+write_string (GByteArray *array,
+              const char *string)
+{
+  gsize len = string ? strlen (string) : 0;
+
+  write_uint32 (array, len);
+  g_byte_array_append (array, (const guint8 *) string, len);
+  write_padding (array, 4);
+}
+
+static void
+write_point (GByteArray             *array,
+             const graphene_point_t *point)
+{
+  write_float (array, point->x);
+  write_float (array, point->y);
+}
+
+static void
+write_rect (GByteArray            *array,
+            const graphene_rect_t *rect)
+{
+  write_float (array, rect->origin.x);
+  write_float (array, rect->origin.y);
+  write_float (array, rect->size.width);
+  write_float (array, rect->size.height);
+}
+
+static void
+write_rounded_rect (GByteArray           *array,
+                    const GskRoundedRect *rect)
+{
+  guint i;
+
+  write_rect (array, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      write_float (array, rect->corner[i].width);
+      write_float (array, rect->corner[i].height);
+    }
+}
+
+static void
+write_rgba (GByteArray    *array,
+            const GdkRGBA *rgba)
+{
+  write_float (array, rgba->red);
+  write_float (array, rgba->green);
+  write_float (array, rgba->blue);
+  write_float (array, rgba->alpha);
+}
+
+static void
+write_color_stops (GByteArray         *array,
+                   const GskColorStop *stops,
+                   gsize               n_stops)
+{
+  gsize i;
+
+  write_uint32 (array, n_stops);
+  for (i = 0; i < n_stops; i++)
+    {
+      write_float (array, stops[i].offset);
+      write_rgba (array, &stops[i].color);
+    }
+}
+
+static void
+write_transform (GByteArray   *array,
+                 GskTransform *transform)
+{
+  GskTransformCategory category = gsk_transform_get_category (transform);
+
+  write_uint32 (array, category);
+
+  switch (category)
+    {
+    case GSK_TRANSFORM_CATEGORY_IDENTITY:
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_2D_TRANSLATE:
+      {
+        float dx, dy;
+
+        gsk_transform_to_translate (transform, &dx, &dy);
+        write_float (array, dx);
+        write_float (array, dy);
+      }
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_2D_AFFINE:
+      {
+        float sx, sy, dx, dy;
+
+        gsk_transform_to_affine (transform, &sx, &sy, &dx, &dy);
+        write_float (array, sx);
+        write_float (array, sy);
+        write_float (array, dx);
+        write_float (array, dy);
+      }
+      break;
+
+    case GSK_TRANSFORM_CATEGORY_UNKNOWN:
+    case GSK_TRANSFORM_CATEGORY_ANY:
+    case GSK_TRANSFORM_CATEGORY_3D:
+    case GSK_TRANSFORM_CATEGORY_2D:
+    default:
+      {
+        graphene_matrix_t matrix;
+        float values[16];
+
+        gsk_transform_to_matrix (transform, &matrix);
+        graphene_matrix_to_float (&matrix, values);
+        write_floats (array, values, 16);
+      }
+      break;
+    }
+}
+
+static guint32
+writer_add_texture (Writer     *writer,
+                    GdkTexture *texture)
+{
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (writer->texture_indices, texture, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  index = GUINT_TO_POINTER (writer->textures->len);
+  g_ptr_array_add (writer->textures, g_object_ref (texture));
+  g_hash_table_insert (writer->texture_indices, texture, index);
+
+  return GPOINTER_TO_UINT (index);
+}
+
+static guint32
+writer_add_font (Writer    *writer,
+                 PangoFont *font)
+{
+  PangoFontDescription *desc;
+  gpointer index;
+
+  if (g_hash_table_lookup_extended (writer->font_indices, font, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  index = GUINT_TO_POINTER (writer->fonts->len);
+  desc = pango_font_describe (font);
+  g_ptr_array_add (writer->fonts, pango_font_description_to_string (desc));
+  g_hash_table_insert (writer->font_indices, font, index);
+  pango_font_description_free (desc);
+
+  return GPOINTER_TO_UINT (index);
+}
+
+static void
+write_surface (GByteArray            *array,
+               cairo_surface_t       *surface,
+               const graphene_rect_t *bounds)
+{
+  cairo_surface_t *image;
+  cairo_t *cr;
+  int width, height;
+  gsize offset;
+
+  width = ceilf (bounds->size.width);
+  height = ceilf (bounds->size.height);
+  if (surface == NULL || width <= 0 || height <= 0)
+    {
+      write_uint32 (array, 0);
+      write_uint32 (array, 0);
+      return;
+    }
+
+  write_uint32 (array, width);
+  write_uint32 (array, height);
+
+  offset = array->len;
+  g_byte_array_set_size (array, offset + (gsize) width * height * 4);
+  image = cairo_image_surface_create_for_data (array->data + offset,
+                                               CAIRO_FORMAT_ARGB32,
+                                               width, height,
+                                               width * 4);
+  cr = cairo_create (image);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_rgba (cr, 0, 0, 0, 0);
+  cairo_paint (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+  cairo_set_source_surface (cr, surface, - bounds->origin.x, - bounds->origin.y);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  cairo_surface_finish (image);
+  cairo_surface_destroy (image);
+}
+
+static void
+write_node (Writer        *writer,
+            GskRenderNode *node)
+{
+  GByteArray *array = writer->nodes;
+  GskRenderNodeType type = gsk_render_node_get_node_type (node);
+
+  write_uint32 (array, type);
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      {
+        guint i, n = gsk_container_node_get_n_children (node);
+
+        write_uint32 (array, n);
+        for (i = 0; i < n; i++)
+          write_node (writer, gsk_container_node_get_child (node, i));
+      }
+      break;
+
+    case GSK_CAIRO_NODE:
+      write_rect (array, &node->bounds);
+      write_surface (array, gsk_cairo_node_peek_surface (node), &node->bounds);
+      break;
+
+    case GSK_COLOR_NODE:
+      write_rect (array, &node->bounds);
+      write_rgba (array, gsk_color_node_peek_color (node));
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      write_rect (array, &node->bounds);
+      write_point (array, gsk_linear_gradient_node_peek_start (node));
+      write_point (array, gsk_linear_gradient_node_peek_end (node));
+      write_color_stops (array,
+                         gsk_linear_gradient_node_peek_color_stops (node, NULL),
+                         gsk_linear_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      write_rect (array, &node->bounds);
+      write_point (array, gsk_radial_gradient_node_peek_center (node));
+      write_float (array, gsk_radial_gradient_node_get_hradius (node));
+      write_float (array, gsk_radial_gradient_node_get_vradius (node));
+      write_float (array, gsk_radial_gradient_node_get_start (node));
+      write_float (array, gsk_radial_gradient_node_get_end (node));
+      write_color_stops (array,
+                         gsk_radial_gradient_node_peek_color_stops (node, NULL),
+                         gsk_radial_gradient_node_get_n_color_stops (node));
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        const GdkRGBA *colors = gsk_border_node_peek_colors (node);
+        guint i;
+
+        write_rounded_rect (array, gsk_border_node_peek_outline (node));
+        write_floats (array, gsk_border_node_peek_widths (node), 4);
+        for (i = 0; i < 4; i++)
+          write_rgba (array, &colors[i]);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      write_rect (array, &node->bounds);
+      write_uint32 (array, writer_add_texture (writer, gsk_texture_node_get_texture (node)));
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+      write_rounded_rect (array, gsk_inset_shadow_node_peek_outline (node));
+      write_rgba (array, gsk_inset_shadow_node_peek_color (node));
+      write_float (array, gsk_inset_shadow_node_get_dx (node));
+      write_float (array, gsk_inset_shadow_node_get_dy (node));
+      write_float (array, gsk_inset_shadow_node_get_spread (node));
+      write_float (array, gsk_inset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_OUTSET_SHADOW_NODE:
+      write_rounded_rect (array, gsk_outset_shadow_node_peek_outline (node));
+      write_rgba (array, gsk_outset_shadow_node_peek_color (node));
+      write_float (array, gsk_outset_shadow_node_get_dx (node));
+      write_float (array, gsk_outset_shadow_node_get_dy (node));
+      write_float (array, gsk_outset_shadow_node_get_spread (node));
+      write_float (array, gsk_outset_shadow_node_get_blur_radius (node));
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      write_transform (array, gsk_transform_node_get_transform (node));
+      write_node (writer, gsk_transform_node_get_child (node));
+      break;
+
+    case GSK_OPACITY_NODE:
+      write_float (array, gsk_opacity_node_get_opacity (node));
+      write_node (writer, gsk_opacity_node_get_child (node));
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        float values[16];
+
+        graphene_matrix_to_float (gsk_color_matrix_node_peek_color_matrix (node), values);
+        write_floats (array, values, 16);
+        graphene_vec4_to_float (gsk_color_matrix_node_peek_color_offset (node), values);
+        write_floats (array, values, 4);
+        write_node (writer, gsk_color_matrix_node_get_child (node));
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      write_rect (array, &node->bounds);
+      write_rect (array, gsk_repeat_node_peek_child_bounds (node));
+      write_node (writer, gsk_repeat_node_get_child (node));
+      break;
+
+    case GSK_CLIP_NODE:
+      write_rect (array, gsk_clip_node_peek_clip (node));
+      write_node (writer, gsk_clip_node_get_child (node));
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      write_rounded_rect (array, gsk_rounded_clip_node_peek_clip (node));
+      write_node (writer, gsk_rounded_clip_node_get_child (node));
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        gsize i, n = gsk_shadow_node_get_n_shadows (node);
+
+        write_uint32 (array, n);
+        for (i = 0; i < n; i++)
+          {
+            const GskShadow *shadow = gsk_shadow_node_peek_shadow (node, i);
+
+            write_rgba (array, &shadow->color);
+            write_float (array, shadow->dx);
+            write_float (array, shadow->dy);
+            write_float (array, shadow->radius);
+          }
+        write_node (writer, gsk_shadow_node_get_child (node));
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      write_uint32 (array, gsk_blend_node_get_blend_mode (node));
+      write_node (writer, gsk_blend_node_get_bottom_child (node));
+      write_node (writer, gsk_blend_node_get_top_child (node));
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      write_float (array, gsk_cross_fade_node_get_progress (node));
+      write_node (writer, gsk_cross_fade_node_get_start_child (node));
+      write_node (writer, gsk_cross_fade_node_get_end_child (node));
+      break;
+
+    case GSK_TEXT_NODE:
+      {
+        guint i, n_glyphs;
+        const PangoGlyphInfo *glyphs = gsk_text_node_peek_glyphs (node, &n_glyphs);
+
+        write_uint32 (array, writer_add_font (writer, gsk_text_node_peek_font (node)));
+        write_rgba (array, gsk_text_node_peek_color (node));
+        write_point (array, gsk_text_node_get_offset (node));
+        write_uint32 (array, n_glyphs);
+        for (i = 0; i < n_glyphs; i++)
+          {
+            write_uint32 (array, glyphs[i].glyph);
+            write_uint32 (array, glyphs[i].geometry.width);
+            write_uint32 (array, glyphs[i].geometry.x_offset);
+            write_uint32 (array, glyphs[i].geometry.y_offset);
+            write_uint32 (array, glyphs[i].attr.is_cluster_start);
+          }
+      }
+      break;
+
+    case GSK_BLUR_NODE:
+      write_float (array, gsk_blur_node_get_radius (node));
+      write_node (writer, gsk_blur_node_get_child (node));
+      break;
+
+    case GSK_DEBUG_NODE:
+      write_string (array, gsk_debug_node_get_message (node));
+      write_node (writer, gsk_debug_node_get_child (node));
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+}
+
+GBytes *
+gsk_render_node_serialize_binary (GskRenderNode *node)
+{
+  BinaryHeader header;
+  GByteArray *result;
+  Writer writer;
+  guint i;
+
+  writer.nodes = g_byte_array_new ();
+  writer.texture_indices = g_hash_table_new (NULL, NULL);
+  writer.textures = g_ptr_array_new_with_free_func (g_object_unref);
+  writer.font_indices = g_hash_table_new (NULL, NULL);
+  writer.fonts = g_ptr_array_new_with_free_func (g_free);
+
+  write_node (&writer, node);
+
+  memcpy (header.magic, binary_magic, sizeof (binary_magic));
+  header.byte_order = BYTE_ORDER_MARK;
+  header.version = BINARY_VERSION;
+  header.n_fonts = writer.fonts->len;
+  header.n_textures = writer.textures->len;
+
+  result = g_byte_array_new ();
+  g_byte_array_append (result, (guint8 *) &header, sizeof (BinaryHeader));
+
+  for (i = 0; i < writer.fonts->len; i++)
+    write_string (result, g_ptr_array_index (writer.fonts, i));
+
+  for (i = 0; i < writer.textures->len; i++)
+    {
+      GdkTexture *texture = g_ptr_array_index (writer.textures, i);
+      int width = gdk_texture_get_width (texture);
+      int height = gdk_texture_get_height (texture);
+      gsize offset;
+
+      write_uint32 (result, width);
+      write_uint32 (result, height);
+      write_padding (result, TEXTURE_ALIGNMENT);
+
+      offset = result->len;
+      g_byte_array_set_size (result, offset + (gsize) width * height * 4);
+      gdk_texture_download (texture, result->data + offset, width * 4);
+    }
+
+  g_byte_array_append (result, writer.nodes->data, writer.nodes->len);
+
+  g_byte_array_free (writer.nodes, TRUE);
+  g_hash_table_unref (writer.texture_indices);
+  g_ptr_array_unref (writer.textures);
+  g_hash_table_unref (writer.font_indices);
+  g_ptr_array_unref (writer.fonts);
+
+  return g_byte_array_free_to_bytes (result);
+}
+
+/*** READING ***/
+
+typedef struct
+{
+  GBytes *bytes;
+  const guchar *data;
+  gsize size;
+  gsize pos;
+  gboolean failed;
+
+  GPtrArray *textures;
+  GPtrArray *fonts;
+
+  GskParseErrorFunc error_func;
+  gpointer user_data;
+} Reader;
+
+static void
+reader_error (Reader     *reader,
+              GQuark      domain,
+              int         code,
+              const char *message)
+{
+  GtkCssLocation location = { 0, };
+  GtkCssSection *section;
+  GError *error;
+
+  if (reader->failed)
+    return;
+
+  reader->failed = TRUE;
+
+  if (reader->error_func == NULL)
+    return;
+
+  location.bytes = reader->pos;
+  location.line_bytes = reader->pos;
+  section = gtk_css_section_new (NULL, &location, &location);
+  error = g_error_new_literal (domain, code, message);
+
+  reader->error_func (section, error, reader->user_data);
+
+  g_error_free (error);
+  gtk_css_section_unref (section);
+}
+
+static gboolean
+reader_has_data (Reader *reader,
+                 gsize   n_items,
+                 gsize   item_size)
+{
+  if (reader->failed)
+    return FALSE;
+
+  if (n_items > (reader->size - reader->pos) / item_size)
+    {
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Unexpected end of data");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint32
+read_uint32 (Reader *reader)
+{
+  guint32 value;
+
+  if (!reader_has_data (reader, 1, sizeof (guint32)))
+    return 0;
+
+  memcpy (&value, reader->data + reader->pos, sizeof (guint32));
+  reader->pos += sizeof (guint32);
+
+  return value;
+}
+
+static float
+read_float (Reader *reader)
+{
+  float value;
+
+  if (!reader_has_data (reader, 1, sizeof (float)))
+    return 0.f;
+
+  memcpy (&value, reader->data + reader->pos, sizeof (float));
+  reader->pos += sizeof (float);
+
+  return value;
+}
+
+static void
+read_floats (Reader *reader,
+             float  *values,
+             guint   n_values)
+{
+  if (!reader_has_data (reader, n_values, sizeof (float)))
+    {
+      memset (values, 0, n_values * sizeof (float));
+      return;
+    }
+
+  memcpy (values, reader->data + reader->pos, n_values * sizeof (float));
+  reader->pos += n_values * sizeof (float);
+}
+
+static void
+reader_align (Reader *reader,
+              gsize   alignment)
+{
+  gsize padding = (alignment - reader->pos % alignment) % alignment;
+
+  if (reader_has_data (reader, padding, 1))
+    reader->pos += padding;
+}
+
+static char *
+read_string (Reader *reader)
+{
+  guint32 len = read_uint32 (reader);
+  char *result;
+
+  if (!reader_has_data (reader, len, 1))
+    return NULL;
+
+  result = g_strndup ((const char *) reader->data + reader->pos, len);
+  reader->pos += len;
+  reader_align (reader, 4);
+
+  return result;
+}
+
+static void
+read_point (Reader           *reader,
+            graphene_point_t *point)
+{
+  point->x = read_float (reader);
+  point->y = read_float (reader);
+}
+
+static void
+read_rect (Reader          *reader,
+           graphene_rect_t *rect)
+{
+  rect->origin.x = read_float (reader);
+  rect->origin.y = read_float (reader);
+  rect->size.width = read_float (reader);
+  rect->size.height = read_float (reader);
+}
+
+static void
+read_rounded_rect (Reader         *reader,
+                   GskRoundedRect *rect)
+{
+  guint i;
+
+  read_rect (reader, &rect->bounds);
+  for (i = 0; i < 4; i++)
+    {
+      rect->corner[i].width = read_float (reader);
+      rect->corner[i].height = read_float (reader);
+    }
+}
+
+static void
+read_rgba (Reader  *reader,
+           GdkRGBA *rgba)
+{
+  rgba->red = read_float (reader);
+  rgba->green = read_float (reader);
+  rgba->blue = read_float (reader);
+  rgba->alpha = read_float (reader);
+}
+
+static GskColorStop *
+read_color_stops (Reader *reader,
+                  gsize  *n_stops)
+{
+  GskColorStop *stops;
+  guint32 i, n;
+
+  n = read_uint32 (reader);
+  if (!reader_has_data (reader, n, 5 * sizeof (float)))
+    return NULL;
+
+  if (n < 2)
+    {
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Gradients need at least 2 color stops");
+      return NULL;
+    }
+
+  stops = g_new (GskColorStop, n);
+  for (i = 0; i < n; i++)
+    {
+      stops[i].offset = read_float (reader);
+      read_rgba (reader, &stops[i].color);
+    }
+
+  *n_stops = n;
+
+  return stops;
+}
+
+static GskTransform *
+read_transform (Reader *reader)
+{
+  GskTransformCategory category = read_uint32 (reader);
+
+  switch (category)
+    {
+    case GSK_TRANSFORM_CATEGORY_IDENTITY:
+      return NULL;
+
+    case GSK_TRANSFORM_CATEGORY_2D_TRANSLATE:
+      {
+        graphene_point_t offset;
+
+        read_point (reader, &offset);
+
+        return gsk_transform_translate (NULL, &offset);
+      }
+
+    case GSK_TRANSFORM_CATEGORY_2D_AFFINE:
+      {
+        float sx, sy;
+        graphene_point_t offset;
+
+        sx = read_float (reader);
+        sy = read_float (reader);
+        read_point (reader, &offset);
+
+        return gsk_transform_scale (gsk_transform_translate (NULL, &offset), sx, sy);
+      }
+
+    case GSK_TRANSFORM_CATEGORY_UNKNOWN:
+    case GSK_TRANSFORM_CATEGORY_ANY:
+    case GSK_TRANSFORM_CATEGORY_3D:
+    case GSK_TRANSFORM_CATEGORY_2D:
+      {
+        graphene_matrix_t matrix;
+        float values[16];
+
+        read_floats (reader, values, 16);
+        graphene_matrix_init_from_float (&matrix, values);
+
+        return gsk_transform_matrix (NULL, &matrix);
+      }
+
+    default:
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Invalid transform category");
+      return NULL;
+    }
+}
+
+static GdkTexture *
+read_texture_index (Reader *reader)
+{
+  guint32 index = read_uint32 (reader);
+
+  if (reader->failed)
+    return NULL;
+
+  if (index >= reader->textures->len)
+    {
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Invalid texture index");
+      return NULL;
+    }
+
+  return g_ptr_array_index (reader->textures, index);
+}
+
+static PangoFont *
+read_font_index (Reader *reader)
+{
+  guint32 index = read_uint32 (reader);
+
+  if (reader->failed)
+    return NULL;
+
+  if (index >= reader->fonts->len)
+    {
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Invalid font index");
+      return NULL;
+    }
+
+  return g_ptr_array_index (reader->fonts, index);
+}
+
+static GdkTexture *
+read_texture (Reader *reader)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+  guint32 width, height;
+
+  width = read_uint32 (reader);
+  height = read_uint32 (reader);
+  reader_align (reader, TEXTURE_ALIGNMENT);
+
+  if (width == 0 || height == 0 || width > G_MAXINT / 4 ||
+      !reader_has_data (reader, height, (gsize) width * 4))
+    {
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Invalid texture size");
+      return NULL;
+    }
+
+  bytes = g_bytes_new_from_bytes (reader->bytes, reader->pos, (gsize) width * height * 4);
+  reader->pos += (gsize) width * height * 4;
+
+  texture = gdk_memory_texture_new (width, height,
+                                    GDK_MEMORY_DEFAULT,
+                                    bytes,
+                                    width * 4);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
+static PangoFont *
+read_font (Reader *reader)
+{
+  PangoFontDescription *desc;
+  PangoFontMap *font_map;
+  PangoContext *context;
+  PangoFont *font;
+  char *string;
+
+  string = read_string (reader);
+  if (string == NULL)
+    return NULL;
+
+  desc = pango_font_description_from_string (string);
+  font_map = pango_cairo_font_map_get_default ();
+  context = pango_font_map_create_context (font_map);
+  font = pango_font_map_load_font (font_map, context, desc);
+
+  pango_font_description_free (desc);
+  g_object_unref (context);
+  g_free (string);
+
+  if (font == NULL)
+    reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                  "This font does not exist.");
+
+  return font;
+}
+
+static GskRenderNode *
+read_surface_node (Reader                *reader,
+                   const graphene_rect_t *bounds)
+{
+  GskRenderNode *node;
+  guint32 width, height;
+
+  width = read_uint32 (reader);
+  height = read_uint32 (reader);
+  if (reader->failed)
+    return NULL;
+
+  node = gsk_cairo_node_new (bounds);
+
+  if (width > 0 && height > 0)
+    {
+      cairo_surface_t *surface;
+      cairo_t *cr;
+
+      if (width > G_MAXINT / 4 ||
+          !reader_has_data (reader, height, (gsize) width * 4))
+        {
+          gsk_render_node_unref (node);
+          return NULL;
+        }
+
+      surface = cairo_image_surface_create_for_data ((guchar *) reader->data + reader->pos,
+                                                     CAIRO_FORMAT_ARGB32,
+                                                     width, height,
+                                                     width * 4);
+      reader->pos += (gsize) width * height * 4;
+
+      cr = gsk_cairo_node_get_draw_context (node);
+      cairo_set_source_surface (cr, surface, bounds->origin.x, bounds->origin.y);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+
+      cairo_surface_destroy (surface);
+    }
+
+  return node;
+}
+
+static GskRenderNode *read_node (Reader *reader);
+
+static GskRenderNode *
+read_container_node (Reader *reader)
+{
+  GskRenderNode **children;
+  GskRenderNode *node;
+  guint32 i, n;
+
+  n = read_uint32 (reader);
+  /* every child needs at least its node type */
+  if (!reader_has_data (reader, n, sizeof (guint32)))
+    return NULL;
+
+  children = g_new (GskRenderNode *, n);
+  for (i = 0; i < n; i++)
+    {
+      children[i] = read_node (reader);
+      if (children[i] == NULL)
+        break;
+    }
+
+  if (i == n)
+    node = gsk_container_node_new (children, n);
+  else
+    node = NULL;
+
+  while (i-- > 0)
+    gsk_render_node_unref (children[i]);
+  g_free (children);
+
+  return node;
+}
+
+static GskRenderNode *
+read_text_node (Reader *reader)
+{
+  PangoGlyphString *glyphs;
+  GskRenderNode *node;
+  graphene_point_t offset;
+  PangoFont *font;
+  GdkRGBA color;
+  guint32 i, n_glyphs;
+
+  font = read_font_index (reader);
+  read_rgba (reader, &color);
+  read_point (reader, &offset);
+  n_glyphs = read_uint32 (reader);
+  if (!reader_has_data (reader, n_glyphs, 5 * sizeof (guint32)))
+    return NULL;
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, n_glyphs);
+  for (i = 0; i < n_glyphs; i++)
+    {
+      PangoGlyphInfo *gi = &glyphs->glyphs[i];
+
+      gi->glyph = read_uint32 (reader);
+      gi->geometry.width = (gint32) read_uint32 (reader);
+      gi->geometry.x_offset = (gint32) read_uint32 (reader);
+      gi->geometry.y_offset = (gint32) read_uint32 (reader);
+      gi->attr.is_cluster_start = read_uint32 (reader) ? 1 : 0;
+    }
+
+  node = gsk_text_node_new (font, glyphs, &color, &offset);
+  pango_glyph_string_free (glyphs);
+
+  if (node == NULL)
+    reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                  "Invalid text node");
+
+  return node;
+}
+
+static GskRenderNode *
+read_node (Reader *reader)
+{
+  GskRenderNodeType type;
+  GskRenderNode *node = NULL;
+
+  type = read_uint32 (reader);
+  if (reader->failed)
+    return NULL;
+
+  switch (type)
+    {
+    case GSK_CONTAINER_NODE:
+      return read_container_node (reader);
+
+    case GSK_CAIRO_NODE:
+      {
+        graphene_rect_t bounds;
+
+        read_rect (reader, &bounds);
+        return read_surface_node (reader, &bounds);
+      }
+
+    case GSK_COLOR_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkRGBA color;
+
+        read_rect (reader, &bounds);
+        read_rgba (reader, &color);
+        if (!reader->failed)
+          node = gsk_color_node_new (&color, &bounds);
+      }
+      break;
+
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t start, end;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (reader, &bounds);
+        read_point (reader, &start);
+        read_point (reader, &end);
+        stops = read_color_stops (reader, &n_stops);
+        if (stops == NULL)
+          return NULL;
+
+        if (type == GSK_REPEATING_LINEAR_GRADIENT_NODE)
+          node = gsk_repeating_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        else
+          node = gsk_linear_gradient_node_new (&bounds, &start, &end, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+      {
+        graphene_rect_t bounds;
+        graphene_point_t center;
+        float hradius, vradius, start, end;
+        GskColorStop *stops;
+        gsize n_stops;
+
+        read_rect (reader, &bounds);
+        read_point (reader, &center);
+        hradius = read_float (reader);
+        vradius = read_float (reader);
+        start = read_float (reader);
+        end = read_float (reader);
+        stops = read_color_stops (reader, &n_stops);
+        if (stops == NULL)
+          return NULL;
+
+        if (type == GSK_REPEATING_RADIAL_GRADIENT_NODE)
+          node = gsk_repeating_radial_gradient_node_new (&bounds, &center, hradius, vradius,
+                                                         start, end, stops, n_stops);
+        else
+          node = gsk_radial_gradient_node_new (&bounds, &center, hradius, vradius,
+                                               start, end, stops, n_stops);
+        g_free (stops);
+      }
+      break;
+
+    case GSK_BORDER_NODE:
+      {
+        GskRoundedRect outline;
+        float widths[4];
+        GdkRGBA colors[4];
+        guint i;
+
+        read_rounded_rect (reader, &outline);
+        read_floats (reader, widths, 4);
+        for (i = 0; i < 4; i++)
+          read_rgba (reader, &colors[i]);
+        if (!reader->failed)
+          node = gsk_border_node_new (&outline, widths, colors);
+      }
+      break;
+
+    case GSK_TEXTURE_NODE:
+      {
+        graphene_rect_t bounds;
+        GdkTexture *texture;
+
+        read_rect (reader, &bounds);
+        texture = read_texture_index (reader);
+        if (texture)
+          node = gsk_texture_node_new (texture, &bounds);
+      }
+      break;
+
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+      {
+        GskRoundedRect outline;
+        GdkRGBA color;
+        float dx, dy, spread, blur_radius;
+
+        read_rounded_rect (reader, &outline);
+        read_rgba (reader, &color);
+        dx = read_float (reader);
+        dy = read_float (reader);
+        spread = read_float (reader);
+        blur_radius = read_float (reader);
+        if (reader->failed)
+          return NULL;
+
+        if (type == GSK_INSET_SHADOW_NODE)
+          node = gsk_inset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+        else
+          node = gsk_outset_shadow_node_new (&outline, &color, dx, dy, spread, blur_radius);
+      }
+      break;
+
+    case GSK_TRANSFORM_NODE:
+      {
+        GskTransform *transform;
+        GskRenderNode *child;
+
+        transform = read_transform (reader);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_transform_node_new (child, transform);
+            gsk_render_node_unref (child);
+          }
+        gsk_transform_unref (transform);
+      }
+      break;
+
+    case GSK_OPACITY_NODE:
+      {
+        GskRenderNode *child;
+        float opacity;
+
+        opacity = read_float (reader);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_opacity_node_new (child, opacity);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_COLOR_MATRIX_NODE:
+      {
+        graphene_matrix_t matrix;
+        graphene_vec4_t offset;
+        GskRenderNode *child;
+        float values[16];
+
+        read_floats (reader, values, 16);
+        graphene_matrix_init_from_float (&matrix, values);
+        read_floats (reader, values, 4);
+        graphene_vec4_init_from_float (&offset, values);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_color_matrix_node_new (child, &matrix, &offset);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_REPEAT_NODE:
+      {
+        graphene_rect_t bounds, child_bounds;
+        GskRenderNode *child;
+
+        read_rect (reader, &bounds);
+        read_rect (reader, &child_bounds);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_repeat_node_new (&bounds, child, &child_bounds);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_CLIP_NODE:
+      {
+        graphene_rect_t clip;
+        GskRenderNode *child;
+
+        read_rect (reader, &clip);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_clip_node_new (child, &clip);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_ROUNDED_CLIP_NODE:
+      {
+        GskRoundedRect clip;
+        GskRenderNode *child;
+
+        read_rounded_rect (reader, &clip);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_rounded_clip_node_new (child, &clip);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_SHADOW_NODE:
+      {
+        GskShadow *shadows;
+        GskRenderNode *child;
+        guint32 i, n;
+
+        n = read_uint32 (reader);
+        if (!reader_has_data (reader, n, 7 * sizeof (float)))
+          return NULL;
+
+        shadows = g_new (GskShadow, n);
+        for (i = 0; i < n; i++)
+          {
+            read_rgba (reader, &shadows[i].color);
+            shadows[i].dx = read_float (reader);
+            shadows[i].dy = read_float (reader);
+            shadows[i].radius = read_float (reader);
+          }
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_shadow_node_new (child, shadows, n);
+            gsk_render_node_unref (child);
+          }
+        g_free (shadows);
+      }
+      break;
+
+    case GSK_BLEND_NODE:
+      {
+        GskRenderNode *bottom, *top;
+        GskBlendMode mode;
+
+        mode = read_uint32 (reader);
+        if (mode > GSK_BLEND_MODE_LUMINOSITY)
+          {
+            reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                          "Invalid blend mode");
+            return NULL;
+          }
+
+        bottom = read_node (reader);
+        top = bottom ? read_node (reader) : NULL;
+        if (top)
+          {
+            node = gsk_blend_node_new (bottom, top, mode);
+            gsk_render_node_unref (top);
+          }
+        g_clear_pointer (&bottom, gsk_render_node_unref);
+      }
+      break;
+
+    case GSK_CROSS_FADE_NODE:
+      {
+        GskRenderNode *start, *end;
+        float progress;
+
+        progress = read_float (reader);
+        start = read_node (reader);
+        end = start ? read_node (reader) : NULL;
+        if (end)
+          {
+            node = gsk_cross_fade_node_new (start, end, progress);
+            gsk_render_node_unref (end);
+          }
+        g_clear_pointer (&start, gsk_render_node_unref);
+      }
+      break;
+
+    case GSK_TEXT_NODE:
+      return read_text_node (reader);
+
+    case GSK_BLUR_NODE:
+      {
+        GskRenderNode *child;
+        float radius;
+
+        radius = read_float (reader);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_blur_node_new (child, radius);
+            gsk_render_node_unref (child);
+          }
+      }
+      break;
+
+    case GSK_DEBUG_NODE:
+      {
+        GskRenderNode *child;
+        char *message;
+
+        message = read_string (reader);
+        child = read_node (reader);
+        if (child)
+          {
+            node = gsk_debug_node_new (child, message);
+            gsk_render_node_unref (child);
+          }
+        else
+          g_free (message);
+      }
+      break;
+
+    case GSK_NOT_A_RENDER_NODE:
+    default:
+      reader_error (reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_INVALID_DATA,
+                    "Invalid node type");
+      return NULL;
+    }
+
+  if (reader->failed)
+    g_clear_pointer (&node, gsk_render_node_unref);
+
+  return node;
+}
+
+GskRenderNode *
+gsk_render_node_deserialize_binary (GBytes            *bytes,
+                                    GskParseErrorFunc  error_func,
+                                    gpointer           user_data)
+{
+  GskRenderNode *root = NULL;
+  BinaryHeader header;
+  Reader reader;
+  guint32 i;
+
+  reader.bytes = bytes;
+  reader.data = g_bytes_get_data (bytes, &reader.size);
+  reader.pos = 0;
+  reader.failed = FALSE;
+  reader.textures = g_ptr_array_new_with_free_func (g_object_unref);
+  reader.fonts = g_ptr_array_new_with_free_func (g_object_unref);
+  reader.error_func = error_func;
+  reader.user_data = user_data;
+
+  if (!reader_has_data (&reader, 1, sizeof (BinaryHeader)))
+    goto out;
+
+  memcpy (&header, reader.data, sizeof (BinaryHeader));
+  reader.pos = sizeof (BinaryHeader);
+
+  if (memcmp (header.magic, binary_magic, sizeof (binary_magic)) != 0 ||
+      header.byte_order != BYTE_ORDER_MARK)
+    {
+      reader_error (&reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_FORMAT,
+                    "Not a binary render node file for this byte order");
+      goto out;
+    }
+
+  if (header.version != BINARY_VERSION)
+    {
+      reader_error (&reader, GSK_SERIALIZATION_ERROR, GSK_SERIALIZATION_UNSUPPORTED_VERSION,
+                    "Unsupported binary render node version");
+      goto out;
+    }
+
+  for (i = 0; i < header.n_fonts; i++)
+    {
+      PangoFont *font = read_font (&reader);
+
+      if (font == NULL)
+        goto out;
+
+      g_ptr_array_add (reader.fonts, font);
+    }
+
+  for (i = 0; i < header.n_textures; i++)
+    {
+      GdkTexture *texture = read_texture (&reader);
+
+      if (texture == NULL)
+        goto out;
+
+      g_ptr_array_add (reader.textures, texture);
+    }
+
+  root = read_node (&reader);
+
+out:
+  g_ptr_array_unref (reader.textures);
+  g_ptr_array_unref (reader.fonts);
+
+  return root;
+}
@@ -49,6 +49,95 @@ rectangle_init_from_graphene (cairo_rectangle_int_t *cairo,
   cairo->height = ceilf (graphene->origin.y + graphene->size.height) - cairo->y;
 }
 
+/*** Interning ***/
+
+/* Small leaf nodes with identical parameters get created over and over,
+ * for every row separator or button border. We keep the most recently
+ * created ones in a small direct-mapped cache and hand out references to
+ * them instead of new nodes. Nodes are immutable, so sharing them is
+ * invisible to users, and it lets renderers and diffing use pointer
+ * identity.
+ *
+ * The cache owns a reference on each node, and an entry simply gets
+ * replaced when another node hashes to the same slot, so its size is
+ * bounded.
+ */
+#define INTERN_CACHE_SIZE 1024
+#define INTERN_MAX_STOPS 8
+
+typedef struct {
+  guint hash;
+  GskRenderNode *node;
+} GskInternEntry;
+
+typedef gboolean (* GskInternEqualFunc) (GskRenderNode *node,
+                                         gconstpointer  key);
+
+static GMutex intern_lock;
+static GskInternEntry intern_cache[INTERN_CACHE_SIZE];
+
+static inline guint
+intern_hash (guint         hash,
+             gconstpointer data,
+             gsize         size)
+{
+  const guint32 *words = data;
+  gsize i;
+
+  /* All keys are made of floats, so hashing their bits is enough */
+  for (i = 0; i < size / sizeof (guint32); i++)
+    hash = (hash << 5) + hash + words[i];
+
+  return hash;
+}
+
+static gboolean
+gsk_render_node_intern_enabled (void)
+{
+  return !GSK_DEBUG_CHECK (NO_INTERN);
+}
+
+static GskRenderNode *
+gsk_render_node_intern_lookup (GskRenderNodeType   node_type,
+                               guint               hash,
+                               GskInternEqualFunc  equal,
+                               gconstpointer       key)
+{
+  GskInternEntry *entry = &intern_cache[hash % INTERN_CACHE_SIZE];
+  GskRenderNode *result = NULL;
+
+  g_mutex_lock (&intern_lock);
+
+  if (entry->node != NULL &&
+      entry->hash == hash &&
+      gsk_render_node_get_node_type (entry->node) == node_type &&
+      equal (entry->node, key))
+    result = gsk_render_node_ref (entry->node);
+
+  g_mutex_unlock (&intern_lock);
+
+  return result;
+}
+
+static void
+gsk_render_node_intern_insert (guint          hash,
+                               GskRenderNode *node)
+{
+  GskInternEntry *entry = &intern_cache[hash % INTERN_CACHE_SIZE];
+  GskRenderNode *old;
+
+  g_mutex_lock (&intern_lock);
+
+  old = entry->node;
+  entry->node = gsk_render_node_ref (node);
+  entry->hash = hash;
+
+  g_mutex_unlock (&intern_lock);
+
+  if (old)
+    gsk_render_node_unref (old);
+}
+
 /*** GSK_COLOR_NODE ***/
 
 struct _GskColorNode
@@ -85,6 +174,22 @@ gsk_color_node_diff (GskRenderNode  *node1,
   gsk_render_node_diff_impossible (node1, node2, region);
 }
 
+typedef struct {
+  const GdkRGBA *color;
+  const graphene_rect_t *bounds;
+} GskColorNodeKey;
+
+static gboolean
+gsk_color_node_equal (GskRenderNode *node,
+                      gconstpointer  data)
+{
+  GskColorNode *self = (GskColorNode *) node;
+  const GskColorNodeKey *key = data;
+
+  return memcmp (&self->color, key->color, sizeof (GdkRGBA)) == 0 &&
+         memcmp (&node->bounds, key->bounds, sizeof (graphene_rect_t)) == 0;
+}
+
 /**
  * gsk_color_node_peek_color:
  * @node: (type GskColorNode): a #GskColorNode
@@ -119,16 +224,34 @@ gsk_color_node_new (const GdkRGBA         *rgba,
 {
   GskColorNode *self;
   GskRenderNode *node;
+  gboolean intern;
+  guint hash = 0;
 
   g_return_val_if_fail (rgba != NULL, NULL);
   g_return_val_if_fail (bounds != NULL, NULL);
 
+  intern = gsk_render_node_intern_enabled ();
+  if (intern)
+    {
+      GskColorNodeKey key = { rgba, bounds };
+
+      hash = intern_hash (GSK_COLOR_NODE, rgba, sizeof (GdkRGBA));
+      hash = intern_hash (hash, bounds, sizeof (graphene_rect_t));
+
+      node = gsk_render_node_intern_lookup (GSK_COLOR_NODE, hash, gsk_color_node_equal, &key);
+      if (node)
+        return node;
+    }
+
   self = gsk_render_node_alloc (GSK_COLOR_NODE);
   node = (GskRenderNode *) self;
 
   self->color = *rgba;
   graphene_rect_init_from_rect (&node->bounds, bounds);
 
+  if (intern)
+    gsk_render_node_intern_insert (hash, node);
+
   return node;
 }
 
@@ -220,6 +343,73 @@ gsk_linear_gradient_node_diff (GskRenderNode  *node1,
   gsk_render_node_diff_impossible (node1, node2, region);
 }
 
+typedef struct {
+  const graphene_rect_t *bounds;
+  const graphene_point_t *start;
+  const graphene_point_t *end;
+  const GskColorStop *stops;
+  gsize n_stops;
+} GskLinearGradientNodeKey;
+
+static gboolean
+gsk_linear_gradient_node_equal (GskRenderNode *node,
+                                gconstpointer  data)
+{
+  GskLinearGradientNode *self = (GskLinearGradientNode *) node;
+  const GskLinearGradientNodeKey *key = data;
+
+  return self->n_stops == key->n_stops &&
+         memcmp (&node->bounds, key->bounds, sizeof (graphene_rect_t)) == 0 &&
+         memcmp (&self->start, key->start, sizeof (graphene_point_t)) == 0 &&
+         memcmp (&self->end, key->end, sizeof (graphene_point_t)) == 0 &&
+         memcmp (self->stops, key->stops, key->n_stops * sizeof (GskColorStop)) == 0;
+}
+
+static GskRenderNode *
+gsk_linear_gradient_node_new_internal (GskRenderNodeType       node_type,
+                                       const graphene_rect_t  *bounds,
+                                       const graphene_point_t *start,
+                                       const graphene_point_t *end,
+                                       const GskColorStop     *color_stops,
+                                       gsize                   n_color_stops)
+{
+  GskLinearGradientNode *self;
+  GskRenderNode *node;
+  gboolean intern;
+  guint hash = 0;
+
+  intern = n_color_stops <= INTERN_MAX_STOPS && gsk_render_node_intern_enabled ();
+  if (intern)
+    {
+      GskLinearGradientNodeKey key = { bounds, start, end, color_stops, n_color_stops };
+
+      hash = intern_hash (node_type, bounds, sizeof (graphene_rect_t));
+      hash = intern_hash (hash, start, sizeof (graphene_point_t));
+      hash = intern_hash (hash, end, sizeof (graphene_point_t));
+      hash = intern_hash (hash, color_stops, n_color_stops * sizeof (GskColorStop));
+
+      node = gsk_render_node_intern_lookup (node_type, hash, gsk_linear_gradient_node_equal, &key);
+      if (node)
+        return node;
+    }
+
+  self = gsk_render_node_alloc (node_type);
+  node = (GskRenderNode *) self;
+
+  graphene_rect_init_from_rect (&node->bounds, bounds);
+  graphene_point_init_from_point (&self->start, start);
+  graphene_point_init_from_point (&self->end, end);
+
+  self->n_stops = n_color_stops;
+  self->stops = g_malloc_n (n_color_stops, sizeof (GskColorStop));
+  memcpy (self->stops, color_stops, n_color_stops * sizeof (GskColorStop));
+
+  if (intern)
+    gsk_render_node_intern_insert (hash, node);
+
+  return node;
+}
+
 /**
  * gsk_linear_gradient_node_new:
  * @bounds: the rectangle to render the linear gradient into
@@ -242,8 +432,6 @@ gsk_linear_gradient_node_new (const graphene_rect_t  *bounds,
                               const GskColorStop     *color_stops,
                               gsize                   n_color_stops)
 {
-  GskLinearGradientNode *self;
-  GskRenderNode *node;
   gsize i;
 
   g_return_val_if_fail (bounds != NULL, NULL);
@@ -256,18 +444,9 @@ gsk_linear_gradient_node_new (const graphene_rect_t  *bounds,
     g_return_val_if_fail (color_stops[i].offset >= color_stops[i - 1].offset, NULL);
   g_return_val_if_fail (color_stops[n_color_stops - 1].offset <= 1, NULL);
 
-  self = gsk_render_node_alloc (GSK_LINEAR_GRADIENT_NODE);
-  node = (GskRenderNode *) self;
-
-  graphene_rect_init_from_rect (&node->bounds, bounds);
-  graphene_point_init_from_point (&self->start, start);
-  graphene_point_init_from_point (&self->end, end);
-
-  self->n_stops = n_color_stops;
-  self->stops = g_malloc_n (n_color_stops, sizeof (GskColorStop));
-  memcpy (self->stops, color_stops, n_color_stops * sizeof (GskColorStop));
-
-  return node;
+  return gsk_linear_gradient_node_new_internal (GSK_LINEAR_GRADIENT_NODE,
+                                                bounds, start, end,
+                                                color_stops, n_color_stops);
 }
 
 /**
@@ -293,8 +472,6 @@ gsk_repeating_linear_gradient_node_new (const graphene_rect_t  *bounds,
                                         const GskColorStop     *color_stops,
                                         gsize                   n_color_stops)
 {
-  GskLinearGradientNode *self;
-  GskRenderNode *node;
   gsize i;
 
   g_return_val_if_fail (bounds != NULL, NULL);
@@ -307,18 +484,9 @@ gsk_repeating_linear_gradient_node_new (const graphene_rect_t  *bounds,
     g_return_val_if_fail (color_stops[i].offset >= color_stops[i - 1].offset, NULL);
   g_return_val_if_fail (color_stops[n_color_stops - 1].offset <= 1, NULL);
 
-  self = gsk_render_node_alloc (GSK_REPEATING_LINEAR_GRADIENT_NODE);
-  node = (GskRenderNode *) self;
-
-  graphene_rect_init_from_rect (&node->bounds, bounds);
-  graphene_point_init_from_point (&self->start, start);
-  graphene_point_init_from_point (&self->end, end);
-
-  self->stops = g_malloc_n (n_color_stops, sizeof (GskColorStop));
-  memcpy (self->stops, color_stops, n_color_stops * sizeof (GskColorStop));
-  self->n_stops = n_color_stops;
-
-  return node;
+  return gsk_linear_gradient_node_new_internal (GSK_REPEATING_LINEAR_GRADIENT_NODE,
+                                                bounds, start, end,
+                                                color_stops, n_color_stops);
 }
 
 /**
@@ -911,6 +1079,24 @@ gsk_border_node_peek_colors (GskRenderNode *node)
   return self->border_color;
 }
 
+typedef struct {
+  const GskRoundedRect *outline;
+  const float *border_width;
+  const GdkRGBA *border_color;
+} GskBorderNodeKey;
+
+static gboolean
+gsk_border_node_equal (GskRenderNode *node,
+                       gconstpointer  data)
+{
+  GskBorderNode *self = (GskBorderNode *) node;
+  const GskBorderNodeKey *key = data;
+
+  return memcmp (&self->outline, key->outline, sizeof (GskRoundedRect)) == 0 &&
+         memcmp (self->border_width, key->border_width, sizeof (self->border_width)) == 0 &&
+         memcmp (self->border_color, key->border_color, sizeof (self->border_color)) == 0;
+}
+
 /**
  * gsk_border_node_new:
  * @outline: a #GskRoundedRect describing the outline of the border
@@ -932,11 +1118,27 @@ gsk_border_node_new (const GskRoundedRect *outline,
 {
   GskBorderNode *self;
   GskRenderNode *node;
+  gboolean intern;
+  guint hash = 0;
 
   g_return_val_if_fail (outline != NULL, NULL);
   g_return_val_if_fail (border_width != NULL, NULL);
   g_return_val_if_fail (border_color != NULL, NULL);
 
+  intern = gsk_render_node_intern_enabled ();
+  if (intern)
+    {
+      GskBorderNodeKey key = { outline, border_width, border_color };
+
+      hash = intern_hash (GSK_BORDER_NODE, outline, sizeof (GskRoundedRect));
+      hash = intern_hash (hash, border_width, 4 * sizeof (float));
+      hash = intern_hash (hash, border_color, 4 * sizeof (GdkRGBA));
+
+      node = gsk_render_node_intern_lookup (GSK_BORDER_NODE, hash, gsk_border_node_equal, &key);
+      if (node)
+        return node;
+    }
+
   self = gsk_render_node_alloc (GSK_BORDER_NODE);
   node = (GskRenderNode *) self;
 
@@ -957,6 +1159,9 @@ gsk_border_node_new (const GskRoundedRect *outline,
 
   graphene_rect_init_from_rect (&node->bounds, &self->outline.bounds);
 
+  if (intern)
+    gsk_render_node_intern_insert (hash, node);
+
   return node;
 }
 
@@ -1177,6 +1382,7 @@ draw_shadow_corner (cairo_t               *cr,
   cairo_matrix_t matrix;
   float sx, sy;
   static GHashTable *corner_mask_cache = NULL;
+  static GMutex corner_mask_lock;
   float max_other;
   CornerMask key;
   gboolean overlapped;
@@ -1264,6 +1470,8 @@ draw_shadow_corner (cairo_t               *cr,
    * mask, so we cache rendered masks based on the blur radius and the
    * corner radius.
    */
+  g_mutex_lock (&corner_mask_lock);
+
   if (corner_mask_cache == NULL)
     corner_mask_cache = g_hash_table_new_full ((GHashFunc)corner_mask_hash,
                                                (GEqualFunc)corner_mask_equal,
@@ -1288,6 +1496,9 @@ draw_shadow_corner (cairo_t               *cr,
       g_hash_table_insert (corner_mask_cache, g_memdup (&key, sizeof (key)), mask);
     }
 
+  /* Masks never get removed from the cache, so we can keep using it */
+  g_mutex_unlock (&corner_mask_lock);
+
   gdk_cairo_set_source_rgba (cr, color);
   pattern = cairo_pattern_create_for_surface (mask);
   cairo_matrix_init_identity (&matrix);
@@ -2106,10 +2317,20 @@ gsk_container_node_draw (GskRenderNode *node,
                          cairo_t       *cr)
 {
   GskContainerNode *container = (GskContainerNode *) node;
+  graphene_rect_t clip;
+  double x1, y1, x2, y2;
   guint i;
 
+  /* Skip children outside the clip, which matters a lot when the
+   * cairo renderer draws the tree once per tile */
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+  graphene_rect_init (&clip, x1, y1, x2 - x1, y2 - y1);
+
   for (i = 0; i < container->n_children; i++)
     {
+      if (!graphene_rect_intersection (&clip, &container->children[i]->bounds, NULL))
+        continue;
+
       gsk_render_node_draw (container->children[i], cr);
     }
 }
@@ -3801,6 +4022,8 @@ gsk_text_node_finalize (GskRenderNode *node)
   parent_class->finalize (node);
 }
 
+static GMutex text_draw_lock;
+
 static void
 gsk_text_node_draw (GskRenderNode *node,
                     cairo_t       *cr)
@@ -3816,7 +4039,12 @@ gsk_text_node_draw (GskRenderNode *node,
 
   gdk_cairo_set_source_rgba (cr, &self->color);
   cairo_translate (cr, self->offset.x, self->offset.y);
+
+  /* Pango is not threadsafe, but the cairo renderer draws text
+   * from multiple threads, see gsk_render_node_can_draw_tiled() */
+  g_mutex_lock (&text_draw_lock);
   pango_cairo_show_glyph_string (cr, self->font, &glyphs);
+  g_mutex_unlock (&text_draw_lock);
 
   cairo_restore (cr);
 }
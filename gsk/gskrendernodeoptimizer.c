@@ -0,0 +1,443 @@
+/* GSK - The GTK Scene Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskrendernodeprivate.h"
+
+#include "gskroundedrectprivate.h"
+
+/* The optimizer removes nodes that don't change the rendering from
+ * a tree, so that renderers don't have to special-case them:
+ *
+ * - containers with zero or one child, and containers nested in
+ *   containers
+ * - identity transforms, and translations of translations
+ * - opacity nodes with an opacity of 1, and blurs with radius 0
+ * - clips that contain their child
+ * - debug nodes
+ *
+ * Nodes that draw nothing, because they are fully clipped, fully
+ * transparent or empty, are dropped, and adjacent color nodes of the
+ * same color that together form a rectangle are merged.
+ *
+ * The result is cached on the node, so optimizing the same tree again
+ * in the next frame is cheap, and returns the same nodes. This matters
+ * because renderers cache offscreens by node and diff the nodes of
+ * consecutive frames.
+ */
+
+static gboolean
+rect_is_empty (const graphene_rect_t *rect)
+{
+  return rect->size.width <= 0 || rect->size.height <= 0;
+}
+
+static GskRenderNode *
+merge_color_nodes (GskRenderNode *first,
+                   GskRenderNode *second)
+{
+  const graphene_rect_t *a = &first->bounds;
+  const graphene_rect_t *b = &second->bounds;
+  graphene_rect_t bounds;
+
+  if (!gdk_rgba_equal (gsk_color_node_peek_color (first), gsk_color_node_peek_color (second)))
+    return NULL;
+
+  if (a->origin.y == b->origin.y && a->size.height == b->size.height &&
+      (a->origin.x + a->size.width == b->origin.x || b->origin.x + b->size.width == a->origin.x))
+    ;
+  else if (a->origin.x == b->origin.x && a->size.width == b->size.width &&
+           (a->origin.y + a->size.height == b->origin.y || b->origin.y + b->size.height == a->origin.y))
+    ;
+  else
+    return NULL;
+
+  graphene_rect_union (a, b, &bounds);
+
+  return gsk_color_node_new (gsk_color_node_peek_color (first), &bounds);
+}
+
+static GskRenderNode *
+optimize_container_node (GskRenderNode *node)
+{
+  GPtrArray *children;
+  GskRenderNode *result;
+  gboolean changed = FALSE;
+  guint i, j;
+
+  children = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+
+  for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+    {
+      GskRenderNode *child = gsk_container_node_get_child (node, i);
+      GskRenderNode *optimized = gsk_render_node_optimize (child);
+
+      if (optimized != child)
+        changed = TRUE;
+
+      if (optimized == NULL)
+        continue;
+
+      if (gsk_render_node_get_node_type (optimized) == GSK_CONTAINER_NODE)
+        {
+          for (j = 0; j < gsk_container_node_get_n_children (optimized); j++)
+            g_ptr_array_add (children, gsk_render_node_ref (gsk_container_node_get_child (optimized, j)));
+
+          gsk_render_node_unref (optimized);
+          changed = TRUE;
+          continue;
+        }
+
+      if (gsk_render_node_get_node_type (optimized) == GSK_COLOR_NODE && children->len > 0)
+        {
+          GskRenderNode *last = g_ptr_array_index (children, children->len - 1);
+
+          if (gsk_render_node_get_node_type (last) == GSK_COLOR_NODE)
+            {
+              GskRenderNode *merged = merge_color_nodes (last, optimized);
+
+              if (merged)
+                {
+                  gsk_render_node_unref (optimized);
+                  gsk_render_node_unref (last);
+                  g_ptr_array_index (children, children->len - 1) = merged;
+                  changed = TRUE;
+                  continue;
+                }
+            }
+        }
+
+      g_ptr_array_add (children, optimized);
+    }
+
+  if (children->len == 0)
+    result = NULL;
+  else if (children->len == 1)
+    result = gsk_render_node_ref (g_ptr_array_index (children, 0));
+  else if (!changed)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_container_node_new ((GskRenderNode **) children->pdata, children->len);
+
+  g_ptr_array_unref (children);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_transform_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_transform_node_get_child (node);
+  GskTransform *transform = gsk_transform_node_get_transform (node);
+  GskRenderNode *optimized;
+  GskRenderNode *result;
+
+  optimized = gsk_render_node_optimize (child);
+  if (optimized == NULL)
+    return NULL;
+
+  if (gsk_transform_get_category (transform) == GSK_TRANSFORM_CATEGORY_IDENTITY)
+    return optimized;
+
+  if (gsk_transform_get_category (transform) == GSK_TRANSFORM_CATEGORY_2D_TRANSLATE &&
+      gsk_render_node_get_node_type (optimized) == GSK_TRANSFORM_NODE &&
+      gsk_transform_get_category (gsk_transform_node_get_transform (optimized)) == GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+    {
+      GskRenderNode *grandchild = gsk_transform_node_get_child (optimized);
+      float dx1, dy1, dx2, dy2;
+
+      gsk_transform_to_translate (transform, &dx1, &dy1);
+      gsk_transform_to_translate (gsk_transform_node_get_transform (optimized), &dx2, &dy2);
+
+      if (dx1 + dx2 == 0 && dy1 + dy2 == 0)
+        {
+          result = gsk_render_node_ref (grandchild);
+        }
+      else
+        {
+          GskTransform *translate;
+
+          translate = gsk_transform_translate (NULL, &GRAPHENE_POINT_INIT (dx1 + dx2, dy1 + dy2));
+          result = gsk_transform_node_new (grandchild, translate);
+          gsk_transform_unref (translate);
+        }
+    }
+  else if (optimized == child)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_transform_node_new (optimized, transform);
+
+  gsk_render_node_unref (optimized);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_opacity_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_opacity_node_get_child (node);
+  float opacity = gsk_opacity_node_get_opacity (node);
+  GskRenderNode *optimized;
+  GskRenderNode *result;
+
+  if (opacity <= 0)
+    return NULL;
+
+  optimized = gsk_render_node_optimize (child);
+  if (optimized == NULL || opacity >= 1)
+    return optimized;
+
+  if (optimized == child)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_opacity_node_new (optimized, opacity);
+
+  gsk_render_node_unref (optimized);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_clip_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_clip_node_get_child (node);
+  const graphene_rect_t *clip = gsk_clip_node_peek_clip (node);
+  GskRenderNode *optimized;
+  GskRenderNode *result;
+
+  optimized = gsk_render_node_optimize (child);
+  if (optimized == NULL || graphene_rect_contains_rect (clip, &optimized->bounds))
+    return optimized;
+
+  if (!graphene_rect_intersection (clip, &optimized->bounds, NULL))
+    result = NULL;
+  else if (optimized == child)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_clip_node_new (optimized, clip);
+
+  gsk_render_node_unref (optimized);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_rounded_clip_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_rounded_clip_node_get_child (node);
+  const GskRoundedRect *clip = gsk_rounded_clip_node_peek_clip (node);
+  GskRenderNode *optimized;
+  GskRenderNode *result;
+
+  optimized = gsk_render_node_optimize (child);
+  if (optimized == NULL || gsk_rounded_rect_contains_rect (clip, &optimized->bounds))
+    return optimized;
+
+  if (!gsk_rounded_rect_intersects_rect (clip, &optimized->bounds))
+    result = NULL;
+  else if (optimized == child)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_rounded_clip_node_new (optimized, clip);
+
+  gsk_render_node_unref (optimized);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_blur_node (GskRenderNode *node)
+{
+  GskRenderNode *child = gsk_blur_node_get_child (node);
+  float radius = gsk_blur_node_get_radius (node);
+  GskRenderNode *optimized;
+  GskRenderNode *result;
+
+  optimized = gsk_render_node_optimize (child);
+  if (optimized == NULL || radius <= 0)
+    return optimized;
+
+  if (optimized == child)
+    result = gsk_render_node_ref (node);
+  else
+    result = gsk_blur_node_new (optimized, radius);
+
+  gsk_render_node_unref (optimized);
+
+  return result;
+}
+
+static GskRenderNode *
+optimize_node (GskRenderNode *node)
+{
+  if (rect_is_empty (&node->bounds))
+    return NULL;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      return optimize_container_node (node);
+
+    case GSK_TRANSFORM_NODE:
+      return optimize_transform_node (node);
+
+    case GSK_OPACITY_NODE:
+      return optimize_opacity_node (node);
+
+    case GSK_CLIP_NODE:
+      return optimize_clip_node (node);
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return optimize_rounded_clip_node (node);
+
+    case GSK_BLUR_NODE:
+      return optimize_blur_node (node);
+
+    case GSK_DEBUG_NODE:
+      return gsk_render_node_optimize (gsk_debug_node_get_child (node));
+
+    case GSK_COLOR_NODE:
+      if (gsk_color_node_peek_color (node)->alpha <= 0)
+        return NULL;
+      return gsk_render_node_ref (node);
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_COLOR_MATRIX_NODE:
+    case GSK_REPEAT_NODE:
+    case GSK_SHADOW_NODE:
+    case GSK_BLEND_NODE:
+    case GSK_CROSS_FADE_NODE:
+    case GSK_TEXT_NODE:
+    default:
+      return gsk_render_node_ref (node);
+    }
+}
+
+/*< private >
+ * gsk_render_node_optimize:
+ * @node: a #GskRenderNode
+ *
+ * Returns a render node that renders the same as @node, with the
+ * nodes that don't contribute to the rendering removed.
+ *
+ * Returns: (transfer full) (nullable): the optimized node, or %NULL
+ *   if @node doesn't draw anything
+ */
+GskRenderNode *
+gsk_render_node_optimize (GskRenderNode *node)
+{
+  g_return_val_if_fail (GSK_IS_RENDER_NODE (node), NULL);
+
+  if (!node->optimized_valid)
+    {
+      GskRenderNode *optimized = optimize_node (node);
+
+      /* Don't keep a reference on ourselves */
+      if (optimized == node)
+        gsk_render_node_unref (optimized);
+
+      node->optimized = optimized;
+      node->optimized_valid = TRUE;
+    }
+
+  if (node->optimized == NULL)
+    return NULL;
+
+  return gsk_render_node_ref (node->optimized);
+}
+
+/*< private >
+ * gsk_render_node_count_nodes:
+ * @node: a #GskRenderNode
+ *
+ * Counts the nodes in the tree below @node, including @node.
+ *
+ * Returns: the number of nodes
+ */
+guint
+gsk_render_node_count_nodes (GskRenderNode *node)
+{
+  guint i, n;
+
+  switch (gsk_render_node_get_node_type (node))
+    {
+    case GSK_CONTAINER_NODE:
+      n = 1;
+      for (i = 0; i < gsk_container_node_get_n_children (node); i++)
+        n += gsk_render_node_count_nodes (gsk_container_node_get_child (node, i));
+      return n;
+
+    case GSK_TRANSFORM_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_transform_node_get_child (node));
+
+    case GSK_OPACITY_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_opacity_node_get_child (node));
+
+    case GSK_COLOR_MATRIX_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_color_matrix_node_get_child (node));
+
+    case GSK_REPEAT_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_repeat_node_get_child (node));
+
+    case GSK_CLIP_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_clip_node_get_child (node));
+
+    case GSK_ROUNDED_CLIP_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_rounded_clip_node_get_child (node));
+
+    case GSK_SHADOW_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_shadow_node_get_child (node));
+
+    case GSK_BLUR_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_blur_node_get_child (node));
+
+    case GSK_DEBUG_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_debug_node_get_child (node));
+
+    case GSK_BLEND_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_blend_node_get_bottom_child (node))
+               + gsk_render_node_count_nodes (gsk_blend_node_get_top_child (node));
+
+    case GSK_CROSS_FADE_NODE:
+      return 1 + gsk_render_node_count_nodes (gsk_cross_fade_node_get_start_child (node))
+               + gsk_render_node_count_nodes (gsk_cross_fade_node_get_end_child (node));
+
+    case GSK_NOT_A_RENDER_NODE:
+    case GSK_CAIRO_NODE:
+    case GSK_COLOR_NODE:
+    case GSK_LINEAR_GRADIENT_NODE:
+    case GSK_REPEATING_LINEAR_GRADIENT_NODE:
+    case GSK_RADIAL_GRADIENT_NODE:
+    case GSK_REPEATING_RADIAL_GRADIENT_NODE:
+    case GSK_BORDER_NODE:
+    case GSK_TEXTURE_NODE:
+    case GSK_INSET_SHADOW_NODE:
+    case GSK_OUTSET_SHADOW_NODE:
+    case GSK_TEXT_NODE:
+    default:
+      return 1;
+    }
+}
@@ -8,4 +8,10 @@ GskRenderNode * gsk_render_node_deserialize_from_bytes  (GBytes            *byte
                                                          GskParseErrorFunc  error_func,
                                                          gpointer           user_data);
 
+gboolean        gsk_render_node_is_binary_data          (GBytes            *bytes);
+GBytes *        gsk_render_node_serialize_binary        (GskRenderNode     *node);
+GskRenderNode * gsk_render_node_deserialize_binary      (GBytes            *bytes,
+                                                         GskParseErrorFunc  error_func,
+                                                         gpointer           user_data);
+
 #endif
@@ -27,6 +27,11 @@ struct _GskRenderNode
   gatomicrefcount ref_count;
 
   graphene_rect_t bounds;
+
+  /* Cached result of gsk_render_node_optimize(), owned unless
+   * it is the node itself */
+  GskRenderNode *optimized;
+  guint optimized_valid : 1;
 };
 
 struct _GskRenderNodeClass
@@ -94,6 +99,12 @@ void            gsk_render_node_diff_impossible         (GskRenderNode
                                                          GskRenderNode               *node2,
                                                          cairo_region_t              *region);
 
+gboolean        gsk_render_node_can_draw_threaded       (GskRenderNode               *node);
+gboolean        gsk_render_node_can_draw_tiled          (GskRenderNode               *node);
+
+GskRenderNode * gsk_render_node_optimize                (GskRenderNode               *node);
+guint           gsk_render_node_count_nodes             (GskRenderNode               *node);
+
 bool            gsk_border_node_get_uniform             (GskRenderNode               *self);
 
 G_END_DECLS
@@ -38,6 +38,7 @@
 #include "gsktransformprivate.h"
 
 typedef struct _GskTransformClass GskTransformClass;
+typedef struct _GskTransformCache GskTransformCache;
 
 struct _GskTransform
 {
@@ -45,6 +46,17 @@ struct _GskTransform
 
   GskTransformCategory category;
   GskTransform *next;
+
+  GskTransformCache *cache; /* created on demand, never changes once set */
+};
+
+/* The composed values of a whole chain of transforms. Computing them
+ * means walking the chain, so chains remember them once asked. */
+struct _GskTransformCache
+{
+  float matrix[16];
+  /* only set for 2D transforms */
+  float xx, yx, xy, yy, dx, dy;
 };
 
 struct _GskTransformClass
@@ -1343,6 +1355,49 @@ gsk_transform_finalize (GskTransform *self)
   self->transform_class->finalize (self);
 
   gsk_transform_unref (self->next);
+  g_free (self->cache);
+}
+
+/* Transforms are immutable and may be shared between threads, so the
+ * cache is computed completely before it is published and the thread
+ * losing a race to publish it uses the winner's.
+ */
+static const GskTransformCache *
+gsk_transform_get_cache (GskTransform *self)
+{
+  GskTransformCache *cache;
+  graphene_matrix_t m, next_m;
+
+  cache = g_atomic_pointer_get (&self->cache);
+  if (cache != NULL)
+    return cache;
+
+  cache = g_new (GskTransformCache, 1);
+
+  gsk_transform_to_matrix (self->next, &next_m);
+  self->transform_class->to_matrix (self, &m);
+  graphene_matrix_multiply (&m, &next_m, &m);
+  graphene_matrix_to_float (&m, cache->matrix);
+
+  if (self->category >= GSK_TRANSFORM_CATEGORY_2D)
+    {
+      gsk_transform_to_2d (self->next,
+                           &cache->xx, &cache->yx,
+                           &cache->xy, &cache->yy,
+                           &cache->dx, &cache->dy);
+      self->transform_class->apply_2d (self,
+                                       &cache->xx, &cache->yx,
+                                       &cache->xy, &cache->yy,
+                                       &cache->dx, &cache->dy);
+    }
+
+  if (!g_atomic_pointer_compare_and_exchange (&self->cache, NULL, cache))
+    {
+      g_free (cache);
+      cache = g_atomic_pointer_get (&self->cache);
+    }
+
+  return cache;
 }
 
 /**
@@ -1445,17 +1500,19 @@ void
 gsk_transform_to_matrix (GskTransform      *self,
                          graphene_matrix_t *out_matrix)
 {
-  graphene_matrix_t m;
-
   if (self == NULL)
     {
       graphene_matrix_init_identity (out_matrix);
       return;
     }
 
-  gsk_transform_to_matrix (self->next, out_matrix);
-  self->transform_class->to_matrix (self, &m);
-  graphene_matrix_multiply (&m, out_matrix, out_matrix);
+  if (self->next == NULL)
+    {
+      self->transform_class->to_matrix (self, out_matrix);
+      return;
+    }
+
+  graphene_matrix_init_from_float (out_matrix, gsk_transform_get_cache (self)->matrix);
 }
 
 /**
@@ -1513,10 +1570,25 @@ gsk_transform_to_2d (GskTransform *self,
       return;
     }
 
-  gsk_transform_to_2d (self->next,
-                       out_xx, out_yx,
-                       out_xy, out_yy,
-                       out_dx, out_dy);
+  if (self->next != NULL)
+    {
+      const GskTransformCache *cache = gsk_transform_get_cache (self);
+
+      *out_xx = cache->xx;
+      *out_yx = cache->yx;
+      *out_xy = cache->xy;
+      *out_yy = cache->yy;
+      *out_dx = cache->dx;
+      *out_dy = cache->dy;
+      return;
+    }
+
+  *out_xx = 1.0f;
+  *out_yx = 0.0f;
+  *out_xy = 0.0f;
+  *out_yy = 1.0f;
+  *out_dx = 0.0f;
+  *out_dy = 0.0f;
 
   self->transform_class->apply_2d (self,
                                    out_xx, out_yx,
@@ -1,5 +1,6 @@
 // VERTEX_SHADER:
-uniform vec4 u_color;
+// The x texture coordinate is the index of the side
+uniform vec4[4] u_colors;
 uniform vec4 u_widths;
 uniform vec4[3] u_outline_rect;
 
@@ -10,7 +11,7 @@ _OUT_ _ROUNDED_RECT_UNIFORM_ transformed_inside_outline;
 void main() {
   gl_Position = u_projection * u_modelview * vec4(aPosition, 0.0, 1.0);
 
-  final_color = premultiply(u_color) * u_alpha;
+  final_color = premultiply(u_colors[int(aUv.x)]) * u_alpha;
 
   RoundedRect outside = create_rect(u_outline_rect);
   RoundedRect inside = rounded_rect_shrink (outside, u_widths);
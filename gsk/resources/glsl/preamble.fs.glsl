@@ -4,6 +4,7 @@ uniform mat4 u_modelview;
 uniform float u_alpha;// = 1.0;
 uniform vec4 u_viewport;
 uniform vec4[3] u_clip_rect;
+uniform vec4[3] u_outer_clip_rect;
 
 #if GSK_GLES
 #elif GSK_LEGACY
@@ -84,6 +85,16 @@ vec4 Texture(sampler2D sampler, vec2 texCoords) {
 #endif
 }
 
+// Looks up the color at offset in the gradient ramp in row y of u_source.
+// The first and last texel are at offset 0 and 1.
+// Keep in sync with GSK_GL_GRADIENT_RAMP_WIDTH.
+#define RAMP_WIDTH 1024.0
+vec4 gradient_ramp_color(float y, float offset) {
+  float x = (0.5 + clamp(offset, 0.0, 1.0) * (RAMP_WIDTH - 1.0)) / RAMP_WIDTH;
+
+  return Texture(u_source, vec2(x, y));
+}
+
 #ifdef GSK_GL3
 layout(origin_upper_left) in vec4 gl_FragCoord;
 #endif
@@ -106,10 +117,14 @@ void setOutputColor(vec4 color) {
 
   // We do *NOT* transform the clip rect here since we already
   // need to do that on the CPU.
+  // The outer clip lets us clip to two rounded rects without
+  // an offscreen. It covers everything if it isn't used.
+  float coverage = rounded_rect_coverage(create_rect(u_clip_rect), f) *
+                   rounded_rect_coverage(create_rect(u_outer_clip_rect), f);
 #if defined(GSK_GLES) || defined(GSK_LEGACY)
-  gl_FragColor = color * rounded_rect_coverage(create_rect(u_clip_rect), f);
+  gl_FragColor = color * coverage;
 #else
-  outputColor = color * rounded_rect_coverage(create_rect(u_clip_rect), f);
+  outputColor = color * coverage;
 #endif
   /*outputColor = color;*/
 }
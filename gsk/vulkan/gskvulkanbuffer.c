@@ -77,6 +77,60 @@ gsk_vulkan_buffer_new_download (GdkVulkanContext  *context,
 {
   return gsk_vulkan_buffer_new_internal (context, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
 }
+
+/* A buffer to copy from that uses the memory of the dma-buf @fd,
+ * or %NULL if it can't be imported.
+ */
+GskVulkanBuffer *
+gsk_vulkan_buffer_new_for_dmabuf (GdkVulkanContext  *context,
+                                  int                fd,
+                                  gsize              size)
+{
+  VkMemoryRequirements requirements;
+  GskVulkanBuffer *self;
+
+  self = g_slice_new0 (GskVulkanBuffer);
+
+  self->vulkan = g_object_ref (context);
+  self->size = size;
+
+  GSK_VK_CHECK (vkCreateBuffer, gdk_vulkan_context_get_device (context),
+                                &(VkBufferCreateInfo) {
+                                    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                    .pNext = &(VkExternalMemoryBufferCreateInfoKHR) {
+                                        .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR,
+                                        .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT,
+                                    },
+                                    .size = size,
+                                    .flags = 0,
+                                    .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+                                },
+                                NULL,
+                                &self->vk_buffer);
+
+  vkGetBufferMemoryRequirements (gdk_vulkan_context_get_device (context),
+                                 self->vk_buffer,
+                                 &requirements);
+
+  self->memory = gsk_vulkan_memory_new_for_dmabuf (context,
+                                                   requirements.memoryTypeBits,
+                                                   fd,
+                                                   MAX (size, requirements.size));
+  if (self->memory == NULL)
+    {
+      vkDestroyBuffer (gdk_vulkan_context_get_device (context), self->vk_buffer, NULL);
+      g_object_unref (self->vulkan);
+      g_slice_free (GskVulkanBuffer, self);
+      return NULL;
+    }
+
+  GSK_VK_CHECK (vkBindBufferMemory, gdk_vulkan_context_get_device (context),
+                                    self->vk_buffer,
+                                    gsk_vulkan_memory_get_device_memory (self->memory),
+                                    0);
+  return self;
+}
 void
 gsk_vulkan_buffer_free (GskVulkanBuffer *self)
 {
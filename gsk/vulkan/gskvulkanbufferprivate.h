@@ -13,6 +13,9 @@ GskVulkanBuffer *       gsk_vulkan_buffer_new_staging                   (GdkVulk
                                                                          gsize                   size);
 GskVulkanBuffer *       gsk_vulkan_buffer_new_download                  (GdkVulkanContext       *context,
                                                                          gsize                   size);
+GskVulkanBuffer *       gsk_vulkan_buffer_new_for_dmabuf                (GdkVulkanContext       *context,
+                                                                         int                     fd,
+                                                                         gsize                   size);
 void                    gsk_vulkan_buffer_free                          (GskVulkanBuffer        *buffer);
 
 VkBuffer                gsk_vulkan_buffer_get_buffer                    (GskVulkanBuffer        *self);
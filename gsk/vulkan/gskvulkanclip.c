@@ -186,3 +186,24 @@ gsk_vulkan_clip_contains_rect (const GskVulkanClip   *self,
       return gsk_rounded_rect_contains_rect (&self->rect, rect);
     }
 }
+
+gboolean
+gsk_vulkan_clip_may_intersect_rect (const GskVulkanClip   *self,
+                                    const graphene_rect_t *rect)
+{
+  switch (self->type)
+    {
+    default:
+      g_assert_not_reached();
+    case GSK_VULKAN_CLIP_ALL_CLIPPED:
+      return FALSE;
+
+    case GSK_VULKAN_CLIP_NONE:
+      return TRUE;
+
+    case GSK_VULKAN_CLIP_RECT:
+    case GSK_VULKAN_CLIP_ROUNDED_CIRCULAR:
+    case GSK_VULKAN_CLIP_ROUNDED:
+      return graphene_rect_intersection (&self->rect.bounds, rect, NULL);
+    }
+}
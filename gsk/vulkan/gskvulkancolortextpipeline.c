@@ -102,18 +102,16 @@ gsk_vulkan_color_text_pipeline_collect_vertex_data (GskVulkanColorTextPipeline *
                                                     const PangoGlyphInfo       *glyphs,
                                                     const graphene_point_t     *offset,
                                                     guint                       start_glyph,
+                                                    int                         start_x,
                                                     guint                       num_glyphs,
                                                     float                       scale)
 {
   GskVulkanColorTextInstance *instances = (GskVulkanColorTextInstance *) data;
   int i;
   int count = 0;
-  int x_position = 0;
+  int x_position = start_x;
 
-  for (i = 0; i < start_glyph; i++)
-    x_position += glyphs[i].geometry.width;
-
-  for (; i < total_glyphs && count < num_glyphs; i++)
+  for (i = start_glyph; i < total_glyphs && count < num_glyphs; i++)
     {
       const PangoGlyphInfo *gi = &glyphs[i];
 
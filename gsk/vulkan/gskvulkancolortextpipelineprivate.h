@@ -30,6 +30,7 @@ void                    gsk_vulkan_color_text_pipeline_collect_vertex_data   (Gs
                                                                               const PangoGlyphInfo           *glyphs,
                                                                               const graphene_point_t         *offset,
                                                                               guint                           start_glyph,
+                                                                              int                             start_x,
                                                                               guint                           num_glyphs,
                                                                               float                           scale);
 gsize                   gsk_vulkan_color_text_pipeline_draw                  (GskVulkanColorTextPipeline     *pipeline,
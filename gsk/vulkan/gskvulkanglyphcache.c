@@ -22,6 +22,20 @@
 #define CHECK_INTERVAL 10
 #define MAX_OLD 0.333
 
+/* Rasterization
+ *
+ * The space for new glyphs is allocated right away, but they are
+ * rasterized by a thread pool while the render passes are being
+ * built. When the atlas image is needed, we wait for the pending
+ * glyphs and upload all of them with a single copy from one staging
+ * buffer. Glyphs are rasterized straight into memory that has the
+ * layout of the staging buffer, so no extra surfaces are involved.
+ *
+ * Glyphs that pango has to draw itself (hex boxes for unknown
+ * glyphs) are always rendered on the main thread.
+ */
+
+#define MAX_RENDER_THREADS 4
 
 typedef struct {
   GskVulkanImage *image;
@@ -41,6 +55,10 @@ struct _GskVulkanGlyphCache {
   GHashTable *hash_table;
   GPtrArray *atlases;
 
+  GThreadPool *render_pool;
+  GAsyncQueue *finished_glyphs;
+  guint n_pending_glyphs;
+
   guint64 timestamp;
 };
 
@@ -56,6 +74,7 @@ static gboolean glyph_cache_equal      (gconstpointer v1,
 static void     glyph_cache_key_free   (gpointer      v);
 static void     glyph_cache_value_free (gpointer      v);
 static void     dirty_glyph_free       (gpointer      v);
+static void     wait_for_glyphs        (GskVulkanGlyphCache *cache);
 
 static Atlas *
 create_atlas (GskVulkanGlyphCache *cache)
@@ -98,6 +117,13 @@ gsk_vulkan_glyph_cache_finalize (GObject *object)
 {
   GskVulkanGlyphCache *cache = GSK_VULKAN_GLYPH_CACHE (object);
 
+  wait_for_glyphs (cache);
+  if (cache->render_pool)
+    {
+      g_thread_pool_free (cache->render_pool, FALSE, TRUE);
+      g_async_queue_unref (cache->finished_glyphs);
+    }
+
   g_ptr_array_unref (cache->atlases);
   g_hash_table_unref (cache->hash_table);
 
@@ -159,7 +185,8 @@ glyph_cache_value_free (gpointer v)
 typedef struct {
   GlyphCacheKey *key;
   GskVulkanCachedGlyph *value;
-  cairo_surface_t *surface;
+  cairo_scaled_font_t *scaled_font; /* NULL unless rendered on a thread */
+  GskImageRegion region;
 } DirtyGlyph;
 
 static void
@@ -167,11 +194,13 @@ dirty_glyph_free (gpointer v)
 {
   DirtyGlyph *glyph = v;
 
-  if (glyph->surface)
-    cairo_surface_destroy (glyph->surface);
+  g_free (glyph->region.data);
   g_free (glyph);
 }
 
+static void queue_glyph (GskVulkanGlyphCache *cache,
+                         DirtyGlyph          *glyph);
+
 static void
 add_to_cache (GskVulkanGlyphCache  *cache,
               GlyphCacheKey        *key,
@@ -221,9 +250,14 @@ add_to_cache (GskVulkanGlyphCache  *cache,
 
   value->texture_index = i;
 
-  dirty = g_new (DirtyGlyph, 1);
+  dirty = g_new0 (DirtyGlyph, 1);
   dirty->key = key;
   dirty->value = value;
+  dirty->region.width = width;
+  dirty->region.height = height;
+  dirty->region.stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+  dirty->region.x = atlas->x;
+  dirty->region.y = atlas->y0;
   atlas->dirty_glyphs = g_list_prepend (atlas->dirty_glyphs, dirty);
 
   atlas->x = atlas->x + width + 1;
@@ -231,6 +265,8 @@ add_to_cache (GskVulkanGlyphCache  *cache,
 
   atlas->num_glyphs++;
 
+  queue_glyph (cache, dirty);
+
 #ifdef G_ENABLE_DEBUG
   if (GSK_RENDERER_DEBUG_CHECK (cache->renderer, GLYPH_CACHE))
     {
@@ -248,10 +284,57 @@ add_to_cache (GskVulkanGlyphCache  *cache,
 #endif
 }
 
+static cairo_surface_t *
+create_glyph_surface (DirtyGlyph *glyph)
+{
+  cairo_surface_t *surface;
+  double scale = glyph->key->scale / 1024.0;
+
+  glyph->region.data = g_malloc0 (glyph->region.stride * glyph->region.height);
+  surface = cairo_image_surface_create_for_data (glyph->region.data,
+                                                 CAIRO_FORMAT_ARGB32,
+                                                 glyph->region.width,
+                                                 glyph->region.height,
+                                                 glyph->region.stride);
+  cairo_surface_set_device_scale (surface, scale, scale);
+
+  return surface;
+}
+
+/* Only uses cairo, so this is safe to call from the render threads */
+static void
+render_glyph_threaded (gpointer data,
+                       gpointer user_data)
+{
+  DirtyGlyph *glyph = data;
+  GskVulkanGlyphCache *cache = user_data;
+  GlyphCacheKey *key = glyph->key;
+  GskVulkanCachedGlyph *value = glyph->value;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = create_glyph_surface (glyph);
+  cr = cairo_create (surface);
+
+  cairo_set_scaled_font (cr, glyph->scaled_font);
+  cairo_set_source_rgba (cr, 1, 1, 1, 1);
+  cairo_show_glyphs (cr,
+                     &(cairo_glyph_t) {
+                       key->glyph,
+                       key->xshift / 4.0 - value->draw_x,
+                       key->yshift / 4.0 - value->draw_y
+                     },
+                     1);
+  cairo_destroy (cr);
+
+  cairo_surface_flush (surface);
+  cairo_surface_destroy (surface);
+
+  g_async_queue_push (cache->finished_glyphs, glyph);
+}
+
 static void
-render_glyph (Atlas          *atlas,
-              DirtyGlyph     *glyph,
-              GskImageRegion *region)
+render_glyph (DirtyGlyph *glyph)
 {
   GlyphCacheKey *key = glyph->key;
   GskVulkanCachedGlyph *value = glyph->value;
@@ -260,11 +343,7 @@ render_glyph (Atlas          *atlas,
   PangoGlyphString glyphs;
   PangoGlyphInfo gi;
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                        value->draw_width * key->scale / 1024,
-                                        value->draw_height * key->scale / 1024);
-  cairo_surface_set_device_scale (surface, key->scale / 1024.0, key->scale / 1024.0);
-
+  surface = create_glyph_surface (glyph);
   cr = cairo_create (surface);
   cairo_set_source_rgba (cr, 1, 1, 1, 1);
 
@@ -283,14 +362,56 @@ render_glyph (Atlas          *atlas,
 
   cairo_destroy (cr);
 
-  glyph->surface = surface;
+  cairo_surface_flush (surface);
+  cairo_surface_destroy (surface);
+}
+
+static void
+queue_glyph (GskVulkanGlyphCache *cache,
+             DirtyGlyph          *glyph)
+{
+  cairo_scaled_font_t *scaled_font;
+
+  scaled_font = pango_cairo_font_get_scaled_font ((PangoCairoFont *) glyph->key->font);
+
+  if ((glyph->key->glyph & PANGO_GLYPH_UNKNOWN_FLAG) ||
+      G_UNLIKELY (!scaled_font || cairo_scaled_font_status (scaled_font) != CAIRO_STATUS_SUCCESS))
+    {
+      render_glyph (glyph);
+      return;
+    }
+
+  if (cache->render_pool == NULL)
+    {
+      cache->finished_glyphs = g_async_queue_new ();
+      cache->render_pool = g_thread_pool_new (render_glyph_threaded, cache,
+                                              CLAMP (g_get_num_processors () - 1, 1, MAX_RENDER_THREADS),
+                                              FALSE, NULL);
+    }
 
-  region->data = cairo_image_surface_get_data (surface);
-  region->width = cairo_image_surface_get_width (surface);
-  region->height = cairo_image_surface_get_height (surface);
-  region->stride = cairo_image_surface_get_stride (surface);
-  region->x = (gsize)(value->tx * atlas->width);
-  region->y = (gsize)(value->ty * atlas->height);
+  glyph->scaled_font = cairo_scaled_font_reference (scaled_font);
+
+  cache->n_pending_glyphs++;
+  g_thread_pool_push (cache->render_pool, glyph, NULL);
+}
+
+/* Waits until all glyphs that are being rasterized are done */
+static void
+wait_for_glyphs (GskVulkanGlyphCache *cache)
+{
+  if (cache->n_pending_glyphs == 0)
+    return;
+
+  GSK_RENDERER_NOTE (cache->renderer, GLYPH_CACHE,
+            g_message ("Waiting for %u glyphs", cache->n_pending_glyphs));
+
+  while (cache->n_pending_glyphs > 0)
+    {
+      DirtyGlyph *glyph = g_async_queue_pop (cache->finished_glyphs);
+
+      g_clear_pointer (&glyph->scaled_font, cairo_scaled_font_destroy);
+      cache->n_pending_glyphs--;
+    }
 }
 
 static void
@@ -303,17 +424,20 @@ upload_dirty_glyphs (GskVulkanGlyphCache *cache,
   GskImageRegion *regions;
   int i;
 
+  wait_for_glyphs (cache);
+
   num_regions = g_list_length (atlas->dirty_glyphs);
-  regions = alloca (sizeof (GskImageRegion) * num_regions);
+  regions = g_new (GskImageRegion, num_regions);
 
   for (l = atlas->dirty_glyphs, i = 0; l; l = l->next, i++)
-    render_glyph (atlas, (DirtyGlyph *)l->data, &regions[i]);
+    regions[i] = ((DirtyGlyph *) l->data)->region;
 
   GSK_RENDERER_NOTE (cache->renderer, GLYPH_CACHE,
             g_message ("uploading %d glyphs to cache", num_regions));
 
   gsk_vulkan_image_upload_regions (atlas->image, uploader, num_regions, regions);
 
+  g_free (regions);
   g_list_free_full (atlas->dirty_glyphs, dirty_glyph_free);
   atlas->dirty_glyphs = NULL;
 }
@@ -434,6 +558,9 @@ gsk_vulkan_glyph_cache_begin_frame (GskVulkanGlyphCache *cache)
   GskVulkanCachedGlyph *value;
   guint dropped = 0;
 
+  /* Glyphs of dropped atlases must not be rendered anymore */
+  wait_for_glyphs (cache);
+
   cache->timestamp++;
 
   if (cache->timestamp % CHECK_INTERVAL != 0)
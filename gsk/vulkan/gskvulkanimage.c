@@ -6,7 +6,11 @@
 #include "gskvulkanmemoryprivate.h"
 #include "gskvulkanpipelineprivate.h"
 
+#include "gdk/gdkdmabuftextureprivate.h"
+#include "gdk/gdkvulkancontextprivate.h"
+
 #include <string.h>
+#include <unistd.h>
 
 struct _GskVulkanUploader
 {
@@ -290,8 +294,9 @@ gsk_vulkan_image_upload_data (GskVulkanImage *self,
 }
 
 static void
-gsk_vulkan_image_ensure_view (GskVulkanImage *self,
-                              VkFormat        format)
+gsk_vulkan_image_ensure_view_full (GskVulkanImage     *self,
+                                   VkFormat            format,
+                                   VkComponentSwizzle  alpha)
 {
   if (self->vk_image_view == VK_NULL_HANDLE)
     GSK_VK_CHECK (vkCreateImageView, gdk_vulkan_context_get_device (self->vulkan),
@@ -304,7 +309,7 @@ gsk_vulkan_image_ensure_view (GskVulkanImage *self,
                                            .r = VK_COMPONENT_SWIZZLE_R,
                                            .g = VK_COMPONENT_SWIZZLE_G,
                                            .b = VK_COMPONENT_SWIZZLE_B,
-                                           .a = VK_COMPONENT_SWIZZLE_A,
+                                           .a = alpha,
                                        },
                                        .subresourceRange = {
                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -318,6 +323,13 @@ gsk_vulkan_image_ensure_view (GskVulkanImage *self,
                                    &self->vk_image_view);
 }
 
+static void
+gsk_vulkan_image_ensure_view (GskVulkanImage *self,
+                              VkFormat        format)
+{
+  gsk_vulkan_image_ensure_view_full (self, format, VK_COMPONENT_SWIZZLE_A);
+}
+
 static GskVulkanImage *
 gsk_vulkan_image_new_from_data_via_staging_buffer (GskVulkanUploader *uploader,
                                                    guchar            *data,
@@ -542,6 +554,118 @@ gsk_vulkan_image_new_from_data (GskVulkanUploader *uploader,
     return gsk_vulkan_image_new_from_data_directly (uploader, data, width, height, stride);
 }
 
+/* Copies the dma-buf into a new image on the GPU, without it ever
+ * going through the CPU. Returns %NULL if the dma-buf can't be
+ * imported, in which case it has to be downloaded.
+ *
+ * The copy is needed because without VK_EXT_image_drm_format_modifier
+ * the dma-buf's layout can't be described to Vulkan, so only linear
+ * dma-bufs are supported, as buffers.
+ */
+GskVulkanImage *
+gsk_vulkan_image_new_from_dmabuf (GskVulkanUploader *uploader,
+                                  GdkDmabufTexture  *texture)
+{
+  GskVulkanImage *self;
+  GskVulkanBuffer *buffer;
+  gsize width, height, offset, stride, size;
+  off_t fd_size;
+  int fd;
+
+  if (!gdk_vulkan_context_can_import_dmabuf (uploader->vulkan) ||
+      gdk_dmabuf_texture_get_modifier (texture) != GDK_DRM_FORMAT_MOD_LINEAR)
+    return NULL;
+
+  width = gdk_texture_get_width (GDK_TEXTURE (texture));
+  height = gdk_texture_get_height (GDK_TEXTURE (texture));
+  offset = gdk_dmabuf_texture_get_offset (texture);
+  stride = gdk_dmabuf_texture_get_stride (texture);
+  fd = gdk_dmabuf_texture_get_fd (texture);
+
+  /* Copies from buffers work in whole texels */
+  if (fd == -1 || offset % 4 != 0 || stride % 4 != 0)
+    return NULL;
+
+  fd_size = lseek (fd, 0, SEEK_END);
+  if (fd_size > 0)
+    size = fd_size;
+  else
+    size = offset + stride * height;
+
+  buffer = gsk_vulkan_buffer_new_for_dmabuf (uploader->vulkan, fd, size);
+  if (buffer == NULL)
+    return NULL;
+
+  gsk_vulkan_uploader_add_buffer_barrier (uploader,
+                                          FALSE,
+                                          &(VkBufferMemoryBarrier) {
+                                             .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                                             .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+                                             .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+                                             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                             .buffer = gsk_vulkan_buffer_get_buffer (buffer),
+                                             .offset = 0,
+                                             .size = size,
+                                         });
+
+  self = gsk_vulkan_image_new (uploader->vulkan,
+                               width,
+                               height,
+                               VK_IMAGE_TILING_OPTIMAL,
+                               VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                               VK_IMAGE_USAGE_SAMPLED_BIT,
+                               VK_IMAGE_LAYOUT_UNDEFINED,
+                               VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  gsk_vulkan_uploader_add_image_barrier (uploader,
+                                         FALSE,
+                                         self,
+                                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                         VK_ACCESS_TRANSFER_WRITE_BIT);
+
+  /* DRM_FORMAT_ARGB8888 is VK_FORMAT_B8G8R8A8_UNORM */
+  vkCmdCopyBufferToImage (gsk_vulkan_uploader_get_copy_buffer (uploader),
+                          gsk_vulkan_buffer_get_buffer (buffer),
+                          self->vk_image,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          1,
+                          (VkBufferImageCopy[1]) {
+                               {
+                                   .bufferOffset = offset,
+                                   .bufferRowLength = stride / 4,
+                                   .imageSubresource = {
+                                       .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                       .mipLevel = 0,
+                                       .baseArrayLayer = 0,
+                                       .layerCount = 1
+                                   },
+                                   .imageOffset = { 0, 0, 0 },
+                                   .imageExtent = {
+                                       .width = width,
+                                       .height = height,
+                                       .depth = 1
+                                   }
+                               }
+                          });
+
+  gsk_vulkan_uploader_add_image_barrier (uploader,
+                                         TRUE,
+                                         self,
+                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                         VK_ACCESS_SHADER_READ_BIT);
+
+  uploader->staging_buffer_free_list = g_slist_prepend (uploader->staging_buffer_free_list, buffer);
+
+  gsk_vulkan_image_ensure_view_full (self,
+                                     VK_FORMAT_B8G8R8A8_UNORM,
+                                     gdk_dmabuf_texture_is_opaque (texture) ? VK_COMPONENT_SWIZZLE_ONE
+                                                                            : VK_COMPONENT_SWIZZLE_A);
+
+  return self;
+}
+
 GskVulkanImage *
 gsk_vulkan_image_new_for_swapchain (GdkVulkanContext *context,
                                     VkImage           image,
@@ -718,7 +842,7 @@ gsk_vulkan_image_upload_regions (GskVulkanImage    *self,
         }
       else
         {
-          for (gsize r = 0; r < regions[i].height; i++)
+          for (gsize r = 0; r < regions[i].height; r++)
             memcpy (m + r * regions[i].width * 4, regions[i].data + r * regions[i].stride, regions[i].width * 4);
         }
 
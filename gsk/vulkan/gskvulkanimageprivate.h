@@ -30,6 +30,8 @@ GskVulkanImage *        gsk_vulkan_image_new_from_data                  (GskVulk
                                                                          gsize                   width,
                                                                          gsize                   height,
                                                                          gsize                   stride);
+GskVulkanImage *        gsk_vulkan_image_new_from_dmabuf                (GskVulkanUploader      *uploader,
+                                                                         GdkDmabufTexture       *texture);
 
 typedef struct {
   guchar *data;
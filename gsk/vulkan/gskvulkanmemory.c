@@ -3,6 +3,8 @@
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanmemoryprivate.h"
 
+#include <unistd.h>
+
 struct _GskVulkanMemory
 {
   GdkVulkanContext *vulkan;
@@ -53,6 +55,75 @@ gsk_vulkan_memory_new (GdkVulkanContext      *context,
   return self;
 }
 
+/* Imports the dma-buf @fd as device memory. The memory holds on to
+ * the dma-buf, so @fd can be closed afterwards. Returns %NULL if the
+ * dma-buf can't be imported.
+ */
+GskVulkanMemory *
+gsk_vulkan_memory_new_for_dmabuf (GdkVulkanContext *context,
+                                  uint32_t          allowed_types,
+                                  int               fd,
+                                  gsize             size)
+{
+  PFN_vkGetMemoryFdPropertiesKHR vkGetMemoryFdPropertiesKHR;
+  VkMemoryFdPropertiesKHR fd_properties = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_FD_PROPERTIES_KHR,
+  };
+  VkDevice device = gdk_vulkan_context_get_device (context);
+  GskVulkanMemory *self;
+  VkDeviceMemory vk_memory;
+  uint32_t i;
+  int dup_fd;
+
+  vkGetMemoryFdPropertiesKHR = (PFN_vkGetMemoryFdPropertiesKHR) vkGetDeviceProcAddr (device, "vkGetMemoryFdPropertiesKHR");
+  if (vkGetMemoryFdPropertiesKHR == NULL)
+    return NULL;
+
+  if (GSK_VK_CHECK (vkGetMemoryFdPropertiesKHR, device,
+                                                VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT,
+                                                fd,
+                                                &fd_properties) != VK_SUCCESS)
+    return NULL;
+
+  allowed_types &= fd_properties.memoryTypeBits;
+  if (allowed_types == 0)
+    return NULL;
+
+  for (i = 0; !(allowed_types & (1 << i)); i++)
+    ;
+
+  /* A successful import takes ownership of the fd */
+  dup_fd = dup (fd);
+  if (dup_fd == -1)
+    return NULL;
+
+  if (GSK_VK_CHECK (vkAllocateMemory, device,
+                                      &(VkMemoryAllocateInfo) {
+                                          .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                          .pNext = &(VkImportMemoryFdInfoKHR) {
+                                              .sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR,
+                                              .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT,
+                                              .fd = dup_fd,
+                                          },
+                                          .allocationSize = size,
+                                          .memoryTypeIndex = i
+                                      },
+                                      NULL,
+                                      &vk_memory) != VK_SUCCESS)
+    {
+      close (dup_fd);
+      return NULL;
+    }
+
+  self = g_slice_new0 (GskVulkanMemory);
+
+  self->vulkan = g_object_ref (context);
+  self->size = size;
+  self->vk_memory = vk_memory;
+
+  return self;
+}
+
 void
 gsk_vulkan_memory_free (GskVulkanMemory *self)
 {
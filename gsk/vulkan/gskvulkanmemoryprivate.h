@@ -11,6 +11,10 @@ GskVulkanMemory *       gsk_vulkan_memory_new                           (GdkVulk
                                                                          uint32_t                allowed_types,
                                                                          VkMemoryPropertyFlags   properties,
                                                                          gsize                   size);
+GskVulkanMemory *       gsk_vulkan_memory_new_for_dmabuf                (GdkVulkanContext       *context,
+                                                                         uint32_t                allowed_types,
+                                                                         int                     fd,
+                                                                         gsize                   size);
 void                    gsk_vulkan_memory_free                          (GskVulkanMemory        *memory);
 
 VkDeviceMemory          gsk_vulkan_memory_get_device_memory             (GskVulkanMemory        *self);
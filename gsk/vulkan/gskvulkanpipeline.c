@@ -6,6 +6,25 @@
 #include "gskvulkanshaderprivate.h"
 
 #include <graphene.h>
+#include <string.h>
+
+#define PIPELINE_CACHE_KEY "gsk-vulkan-pipeline-cache"
+
+typedef struct
+{
+  VkPipelineCache cache;
+  gsize initial_size;
+} PipelineCache;
+
+/* The layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE */
+typedef struct
+{
+  guint32 header_size;
+  guint32 header_version;
+  guint32 vendor_id;
+  guint32 device_id;
+  guint8 uuid[VK_UUID_SIZE];
+} PipelineCacheHeader;
 
 typedef struct _GskVulkanPipelinePrivate GskVulkanPipelinePrivate;
 
@@ -53,6 +72,137 @@ gsk_vulkan_pipeline_init (GskVulkanPipeline *self)
 {
 }
 
+static char *
+get_pipeline_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "gsk", "vulkan-pipelines.bin", NULL);
+}
+
+static gboolean
+pipeline_cache_data_is_valid (GdkVulkanContext *context,
+                              const char       *data,
+                              gsize             size)
+{
+  VkPhysicalDeviceProperties props;
+  PipelineCacheHeader header;
+
+  if (size < sizeof (header))
+    return FALSE;
+
+  memcpy (&header, data, sizeof (header));
+  vkGetPhysicalDeviceProperties (gdk_vulkan_context_get_physical_device (context), &props);
+
+  return header.header_size >= sizeof (header) &&
+         header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendor_id == props.vendorID &&
+         header.device_id == props.deviceID &&
+         memcmp (header.uuid, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+/**
+ * gsk_vulkan_pipeline_cache_init:
+ * @context: a #GdkVulkanContext
+ *
+ * Creates the pipeline cache that all pipelines created for @context
+ * share, seeded with the data saved by a previous run.
+ */
+void
+gsk_vulkan_pipeline_cache_init (GdkVulkanContext *context)
+{
+  PipelineCache *self;
+  char *path;
+  char *data = NULL;
+  gsize size = 0;
+
+  g_return_if_fail (g_object_get_data (G_OBJECT (context), PIPELINE_CACHE_KEY) == NULL);
+
+  path = get_pipeline_cache_path ();
+  if (g_file_get_contents (path, &data, &size, NULL) &&
+      !pipeline_cache_data_is_valid (context, data, size))
+    {
+      GSK_NOTE (VULKAN, g_message ("Ignoring pipeline cache for a different device"));
+      g_clear_pointer (&data, g_free);
+      size = 0;
+    }
+  g_free (path);
+
+  self = g_new0 (PipelineCache, 1);
+  self->initial_size = size;
+
+  if (GSK_VK_CHECK (vkCreatePipelineCache, gdk_vulkan_context_get_device (context),
+                                           &(VkPipelineCacheCreateInfo) {
+                                               .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                                               .initialDataSize = size,
+                                               .pInitialData = data,
+                                           },
+                                           NULL,
+                                           &self->cache) != VK_SUCCESS)
+    self->cache = VK_NULL_HANDLE;
+
+  g_free (data);
+
+  g_object_set_data (G_OBJECT (context), PIPELINE_CACHE_KEY, self);
+}
+
+/**
+ * gsk_vulkan_pipeline_cache_finish:
+ * @context: a #GdkVulkanContext
+ *
+ * Saves the pipeline cache of @context to disk if new pipelines were
+ * added to it and frees it. All pipelines must be created by now.
+ */
+void
+gsk_vulkan_pipeline_cache_finish (GdkVulkanContext *context)
+{
+  PipelineCache *self;
+  VkDevice device;
+  size_t size = 0;
+
+  self = g_object_steal_data (G_OBJECT (context), PIPELINE_CACHE_KEY);
+  if (self == NULL)
+    return;
+
+  device = gdk_vulkan_context_get_device (context);
+
+  if (self->cache != VK_NULL_HANDLE &&
+      vkGetPipelineCacheData (device, self->cache, &size, NULL) == VK_SUCCESS &&
+      size > self->initial_size)
+    {
+      char *data = g_malloc (size);
+
+      if (GSK_VK_CHECK (vkGetPipelineCacheData, device, self->cache, &size, data) == VK_SUCCESS)
+        {
+          GError *error = NULL;
+          char *path = get_pipeline_cache_path ();
+          char *dir = g_path_get_dirname (path);
+
+          g_mkdir_with_parents (dir, 0700);
+          if (!g_file_set_contents (path, data, size, &error))
+            {
+              GSK_NOTE (VULKAN, g_message ("Failed to save pipeline cache: %s", error->message));
+              g_error_free (error);
+            }
+
+          g_free (dir);
+          g_free (path);
+        }
+
+      g_free (data);
+    }
+
+  if (self->cache != VK_NULL_HANDLE)
+    vkDestroyPipelineCache (device, self->cache, NULL);
+  g_free (self);
+}
+
+static VkPipelineCache
+get_pipeline_cache (GdkVulkanContext *context)
+{
+  PipelineCache *self = g_object_get_data (G_OBJECT (context), PIPELINE_CACHE_KEY);
+
+  return self ? self->cache : VK_NULL_HANDLE;
+}
+
 GskVulkanPipeline *
 gsk_vulkan_pipeline_new (GType                    pipeline_type,
                          GdkVulkanContext        *context,
@@ -96,7 +246,7 @@ gsk_vulkan_pipeline_new_full (GType                    pipeline_type,
   priv->fragment_shader = gsk_vulkan_shader_new_from_resource (context, GSK_VULKAN_SHADER_FRAGMENT, shader_name, NULL);
 
   GSK_VK_CHECK (vkCreateGraphicsPipelines, device,
-                                           VK_NULL_HANDLE,
+                                           get_pipeline_cache (context),
                                            1,
                                            &(VkGraphicsPipelineCreateInfo) {
                                                .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -32,6 +32,9 @@ gsk_vulkan_handle_result (VkResult    res,
 
 #define GSK_VK_CHECK(func, ...) gsk_vulkan_handle_result (func (__VA_ARGS__), G_STRINGIFY (func))
 
+void                    gsk_vulkan_pipeline_cache_init                  (GdkVulkanContext               *context);
+void                    gsk_vulkan_pipeline_cache_finish                (GdkVulkanContext               *context);
+
 GskVulkanPipeline *     gsk_vulkan_pipeline_new                         (GType                           pipeline_type,
                                                                          GdkVulkanContext               *context,
                                                                          VkPipelineLayout                layout,
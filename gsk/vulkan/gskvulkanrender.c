@@ -8,6 +8,7 @@
 #include "gskvulkanbufferprivate.h"
 #include "gskvulkancommandpoolprivate.h"
 #include "gskvulkanpipelineprivate.h"
+#include "gskvulkanrendererprivate.h"
 #include "gskvulkanrenderpassprivate.h"
 
 #include "gskvulkanblendmodepipelineprivate.h"
@@ -26,6 +27,37 @@
 #define DESCRIPTOR_POOL_MAXSETS 128
 #define DESCRIPTOR_POOL_MAXSETS_INCREASE 128
 
+#define MAX_RECORD_THREADS 4
+
+/* Everything the GPU may still be using while the next frame is
+ * prepared. Each frame in flight has its own set, which is only
+ * reused once the fence of the frame has been waited for.
+ */
+typedef struct
+{
+  /* The first one is also used for uploads, the others are only
+   * created when command buffers get recorded in parallel */
+  GskVulkanCommandPool *command_pools[MAX_RECORD_THREADS + 1];
+  VkFence fence;
+  GskVulkanUploader *uploader;
+
+  GHashTable *descriptor_set_indexes;
+  VkDescriptorPool descriptor_pool;
+  uint32_t descriptor_pool_maxsets;
+  VkDescriptorSet *descriptor_sets;
+  gsize n_descriptor_sets;
+
+  GList *render_passes;
+  GSList *cleanup_images;
+
+  /* Vertex data for all passes, persistently mapped */
+  GskVulkanBuffer *vertex_buffer;
+  guchar *vertex_buffer_data;
+  gsize vertex_buffer_size;
+  gsize vertex_buffer_used;
+  GSList *retired_vertex_buffers;
+} GskVulkanRenderFrame;
+
 struct _GskVulkanRender
 {
   GskRenderer *renderer;
@@ -35,33 +67,63 @@ struct _GskVulkanRender
   graphene_rect_t viewport;
   cairo_region_t *clip;
 
+  GMutex framebuffer_lock;
   GHashTable *framebuffers;
-  GskVulkanCommandPool *command_pool;
-  VkFence fence;
   VkRenderPass render_pass;
   VkDescriptorSetLayout descriptor_set_layout;
   VkPipelineLayout pipeline_layout[3]; /* indexed by number of textures */
-  GskVulkanUploader *uploader;
 
-  GHashTable *descriptor_set_indexes;
-  VkDescriptorPool descriptor_pool;
-  uint32_t descriptor_pool_maxsets;
-  VkDescriptorSet *descriptor_sets;
-  gsize n_descriptor_sets;
+  GskVulkanRenderFrame frames[GSK_VULKAN_MAX_FRAMES_IN_FLIGHT];
+  guint n_frames;
+  guint frame_index;
+  GskVulkanRenderFrame *frame;
+
   GskVulkanPipeline *pipelines[GSK_VULKAN_N_PIPELINES];
+  gboolean async_pipelines;
+  GThreadPool *pipeline_pool;
+  GAsyncQueue *finished_pipelines;
+  guint64 pending_pipelines;
 
   GskVulkanImage *target;
 
   VkSampler sampler;
   VkSampler repeating_sampler;
 
-  GList *render_passes;
-  GSList *cleanup_images;
-
   GQuark render_pass_counter;
   GQuark gpu_time_timer;
 };
 
+#define MAX_DAMAGE_RECTS 4
+
+#define VERTEX_BUFFER_MIN_SIZE (64 * 1024)
+#define VERTEX_DATA_ALIGNMENT 16
+
+/* Whether the damage is made up of a few rectangles that cover
+ * a lot less than their extents. */
+static gboolean
+damage_is_sparse (const cairo_region_t *damage)
+{
+  cairo_rectangle_int_t extents;
+  gint64 area = 0;
+  int i, n_rects;
+
+  n_rects = cairo_region_num_rectangles (damage);
+  if (n_rects < 2 || n_rects > MAX_DAMAGE_RECTS)
+    return FALSE;
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (damage, i, &rect);
+      area += (gint64) rect.width * rect.height;
+    }
+
+  cairo_region_get_extents (damage, &extents);
+
+  return area * 2 < (gint64) extents.width * extents.height;
+}
+
 static void
 gsk_vulkan_render_setup (GskVulkanRender       *self,
                          GskVulkanImage        *target,
@@ -84,7 +146,13 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
                                            gdk_surface_get_width (window) * self->scale_factor,
                                            gdk_surface_get_height (window) * self->scale_factor);
     }
-  if (clip)
+  if (clip && damage_is_sparse (clip))
+    {
+      /* The render pass draws each rectangle on its own, which is a lot
+       * cheaper than drawing everything in between them */
+      self->clip = cairo_region_copy (clip);
+    }
+  else if (clip)
     {
       cairo_rectangle_int_t extents;
       cairo_region_get_extents (clip, &extents);
@@ -106,46 +174,61 @@ gsk_vulkan_render_setup (GskVulkanRender       *self,
 static guint desc_set_index_hash (gconstpointer v);
 static gboolean desc_set_index_equal (gconstpointer v1, gconstpointer v2);
 
-GskVulkanRender *
-gsk_vulkan_render_new (GskRenderer      *renderer,
-                       GdkVulkanContext *context)
+static void
+gsk_vulkan_render_frame_init (GskVulkanRender      *self,
+                              GskVulkanRenderFrame *frame)
 {
-  GskVulkanRender *self;
-  VkDevice device;
-
-  self = g_slice_new0 (GskVulkanRender);
-
-  self->vulkan = context;
-  self->renderer = renderer;
-  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
-  self->descriptor_set_indexes = g_hash_table_new_full (desc_set_index_hash, desc_set_index_equal, NULL, g_free);
-
-  device = gdk_vulkan_context_get_device (self->vulkan);
+  VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
 
-  self->command_pool = gsk_vulkan_command_pool_new (self->vulkan);
+  frame->command_pools[0] = gsk_vulkan_command_pool_new (self->vulkan);
   GSK_VK_CHECK (vkCreateFence, device,
                                &(VkFenceCreateInfo) {
                                    .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
                                    .flags = VK_FENCE_CREATE_SIGNALED_BIT
                                },
                                NULL,
-                               &self->fence);
+                               &frame->fence);
 
-  self->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
+  frame->descriptor_set_indexes = g_hash_table_new_full (desc_set_index_hash, desc_set_index_equal, NULL, g_free);
+  frame->descriptor_pool_maxsets = DESCRIPTOR_POOL_MAXSETS;
   GSK_VK_CHECK (vkCreateDescriptorPool, device,
                                         &(VkDescriptorPoolCreateInfo) {
                                             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                                            .maxSets = self->descriptor_pool_maxsets,
+                                            .maxSets = frame->descriptor_pool_maxsets,
                                             .poolSizeCount = 1,
                                             .pPoolSizes = (VkDescriptorPoolSize[1]) {
                                                 {
                                                     .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                    .descriptorCount = self->descriptor_pool_maxsets
+                                                    .descriptorCount = frame->descriptor_pool_maxsets
                                                 }
                                             }
                                         },
                                         NULL,
-                                        &self->descriptor_pool);
+                                        &frame->descriptor_pool);
+
+  frame->uploader = gsk_vulkan_uploader_new (self->vulkan, frame->command_pools[0]);
+}
+
+GskVulkanRender *
+gsk_vulkan_render_new (GskRenderer      *renderer,
+                       GdkVulkanContext *context)
+{
+  GskVulkanRender *self;
+  VkDevice device;
+
+  self = g_slice_new0 (GskVulkanRender);
+
+  self->vulkan = context;
+  self->renderer = renderer;
+  g_mutex_init (&self->framebuffer_lock);
+  self->framebuffers = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  device = gdk_vulkan_context_get_device (self->vulkan);
+
+  self->n_frames = 1;
+  self->frame_index = 0;
+  self->frame = &self->frames[0];
+  gsk_vulkan_render_frame_init (self, self->frame);
 
   GSK_VK_CHECK (vkCreateRenderPass, gdk_vulkan_context_get_device (self->vulkan),
                                     &(VkRenderPassCreateInfo) {
@@ -253,8 +336,6 @@ gsk_vulkan_render_new (GskRenderer      *renderer,
                                  NULL,
                                  &self->repeating_sampler);
 
-  self->uploader = gsk_vulkan_uploader_new (self->vulkan, self->command_pool);
-
 #ifdef G_ENABLE_DEBUG
   self->render_pass_counter = g_quark_from_static_string ("render-passes");
   self->gpu_time_timer = g_quark_from_static_string ("gpu-time");
@@ -274,8 +355,10 @@ gsk_vulkan_render_remove_framebuffer_from_image (gpointer  data,
   GskVulkanRender *self = data;
   HashFramebufferEntry *fb;
 
+  g_mutex_lock (&self->framebuffer_lock);
   fb = g_hash_table_lookup (self->framebuffers, image);
   g_hash_table_remove (self->framebuffers, image);
+  g_mutex_unlock (&self->framebuffer_lock);
 
   vkDestroyFramebuffer (gdk_vulkan_context_get_device (self->vulkan),
                         fb->framebuffer,
@@ -284,15 +367,22 @@ gsk_vulkan_render_remove_framebuffer_from_image (gpointer  data,
   g_slice_free (HashFramebufferEntry, fb);
 }
 
+/* This is called while recording command buffers, which may
+ * happen on multiple threads */
 VkFramebuffer
 gsk_vulkan_render_get_framebuffer (GskVulkanRender *self,
                                    GskVulkanImage  *image)
 {
   HashFramebufferEntry *fb;
 
+  g_mutex_lock (&self->framebuffer_lock);
+
   fb = g_hash_table_lookup (self->framebuffers, image);
   if (fb)
-    return fb->framebuffer;
+    {
+      g_mutex_unlock (&self->framebuffer_lock);
+      return fb->framebuffer;
+    }
 
   fb = g_slice_new0 (HashFramebufferEntry);
   GSK_VK_CHECK (vkCreateFramebuffer, gdk_vulkan_context_get_device (self->vulkan),
@@ -312,6 +402,8 @@ gsk_vulkan_render_get_framebuffer (GskVulkanRender *self,
   g_hash_table_insert (self->framebuffers, image, fb);
   g_object_weak_ref (G_OBJECT (image), gsk_vulkan_render_remove_framebuffer_from_image, self);
 
+  g_mutex_unlock (&self->framebuffer_lock);
+
   return fb->framebuffer;
 }
 
@@ -319,14 +411,14 @@ void
 gsk_vulkan_render_add_cleanup_image (GskVulkanRender *self,
                                      GskVulkanImage  *image)
 {
-  self->cleanup_images = g_slist_prepend (self->cleanup_images, image);
+  self->frame->cleanup_images = g_slist_prepend (self->frame->cleanup_images, image);
 }
 
 void
 gsk_vulkan_render_add_render_pass (GskVulkanRender     *self,
                                    GskVulkanRenderPass *pass)
 {
-  self->render_passes = g_list_prepend (self->render_passes, pass);
+  self->frame->render_passes = g_list_prepend (self->frame->render_passes, pass);
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (gsk_renderer_get_profiler (self->renderer), self->render_pass_counter);
@@ -339,9 +431,19 @@ gsk_vulkan_render_add_node (GskVulkanRender *self,
 {
   GskVulkanRenderPass *pass;
   graphene_matrix_t mv;
+  cairo_rectangle_int_t extents;
+  gboolean partial;
 
   graphene_matrix_init_scale (&mv, self->scale_factor, self->scale_factor, 1.0);
 
+  cairo_region_get_extents (self->clip, &extents);
+  partial = cairo_region_contains_rectangle (self->clip,
+                                             &(cairo_rectangle_int_t) {
+                                                 0, 0,
+                                                 gsk_vulkan_image_get_width (self->target) / self->scale_factor,
+                                                 gsk_vulkan_image_get_height (self->target) / self->scale_factor
+                                             }) != CAIRO_REGION_OVERLAP_IN;
+
   pass = gsk_vulkan_render_pass_new (self->vulkan,
                                      self->target,
                                      self->scale_factor,
@@ -352,7 +454,64 @@ gsk_vulkan_render_add_node (GskVulkanRender *self,
 
   gsk_vulkan_render_add_render_pass (self, pass);
 
-  gsk_vulkan_render_pass_add (pass, self, node);
+  gsk_vulkan_render_pass_add (pass, self, node,
+                              partial ? &GRAPHENE_RECT_INIT (extents.x, extents.y,
+                                                             extents.width, extents.height)
+                                      : NULL);
+}
+
+static void
+free_vertex_buffer (GskVulkanBuffer *buffer)
+{
+  gsk_vulkan_buffer_unmap (buffer);
+  gsk_vulkan_buffer_free (buffer);
+}
+
+/*
+ * gsk_vulkan_render_alloc_vertex_data:
+ *
+ * Hands out @size bytes of vertex data from a buffer that stays mapped
+ * for the lifetime of the frame. The space is reused once the fence
+ * of the frame has been waited for, so the returned buffer and data
+ * are only valid until that frame is reset again.
+ */
+GskVulkanBuffer *
+gsk_vulkan_render_alloc_vertex_data (GskVulkanRender  *self,
+                                     gsize             size,
+                                     gsize            *offset,
+                                     guchar          **data)
+{
+  GskVulkanRenderFrame *frame = self->frame;
+  gsize start;
+
+  start = (frame->vertex_buffer_used + VERTEX_DATA_ALIGNMENT - 1) & ~(gsize) (VERTEX_DATA_ALIGNMENT - 1);
+
+  if (frame->vertex_buffer == NULL || start + size > frame->vertex_buffer_size)
+    {
+      gsize new_size = MAX (VERTEX_BUFFER_MIN_SIZE, frame->vertex_buffer_size * 2);
+
+      while (new_size < size)
+        new_size *= 2;
+
+      /* Earlier passes of this frame may still use the old one */
+      if (frame->vertex_buffer)
+        frame->retired_vertex_buffers = g_slist_prepend (frame->retired_vertex_buffers, frame->vertex_buffer);
+
+      GSK_RENDERER_NOTE (self->renderer, VULKAN,
+                         g_message ("Growing vertex buffer to %" G_GSIZE_FORMAT " bytes", new_size));
+
+      frame->vertex_buffer = gsk_vulkan_buffer_new (self->vulkan, new_size);
+      frame->vertex_buffer_data = gsk_vulkan_buffer_map (frame->vertex_buffer);
+      frame->vertex_buffer_size = new_size;
+      start = 0;
+    }
+
+  frame->vertex_buffer_used = start + size;
+
+  *offset = start;
+  *data = frame->vertex_buffer_data + start;
+
+  return frame->vertex_buffer;
 }
 
 void
@@ -364,80 +523,178 @@ gsk_vulkan_render_upload (GskVulkanRender *self)
    * prepending new render passes to the list. Therefore, we walk the list from
    * the end.
    */
-  for (l = g_list_last (self->render_passes); l; l = l->prev)
+  for (l = g_list_last (self->frame->render_passes); l; l = l->prev)
     {
       GskVulkanRenderPass *pass = l->data;
-      gsk_vulkan_render_pass_upload (pass, self, self->uploader);
+      gsk_vulkan_render_pass_upload (pass, self, self->frame->uploader);
     }
 
-  gsk_vulkan_uploader_upload (self->uploader);
+  gsk_vulkan_renderer_upload_texture_atlases (GSK_VULKAN_RENDERER (self->renderer), self->frame->uploader);
+
+  gsk_vulkan_uploader_upload (self->frame->uploader);
+}
+
+static const struct {
+  const char *name;
+  guint num_textures;
+  GskVulkanPipeline * (* create_func) (GdkVulkanContext *context, VkPipelineLayout layout, const char *name, VkRenderPass render_pass);
+} pipeline_info[GSK_VULKAN_N_PIPELINES] = {
+  { "texture",                    1, gsk_vulkan_texture_pipeline_new },
+  { "texture-clip",               1, gsk_vulkan_texture_pipeline_new },
+  { "texture-clip-rounded",       1, gsk_vulkan_texture_pipeline_new },
+  { "color",                      0, gsk_vulkan_color_pipeline_new },
+  { "color-clip",                 0, gsk_vulkan_color_pipeline_new },
+  { "color-clip-rounded",         0, gsk_vulkan_color_pipeline_new },
+  { "linear",                     0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "linear-clip",                0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "linear-clip-rounded",        0, gsk_vulkan_linear_gradient_pipeline_new },
+  { "color-matrix",               1, gsk_vulkan_effect_pipeline_new },
+  { "color-matrix-clip",          1, gsk_vulkan_effect_pipeline_new },
+  { "color-matrix-clip-rounded",  1, gsk_vulkan_effect_pipeline_new },
+  { "border",                     0, gsk_vulkan_border_pipeline_new },
+  { "border-clip",                0, gsk_vulkan_border_pipeline_new },
+  { "border-clip-rounded",        0, gsk_vulkan_border_pipeline_new },
+  { "inset-shadow",               0, gsk_vulkan_box_shadow_pipeline_new },
+  { "inset-shadow-clip",          0, gsk_vulkan_box_shadow_pipeline_new },
+  { "inset-shadow-clip-rounded",  0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow",              0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow-clip",         0, gsk_vulkan_box_shadow_pipeline_new },
+  { "outset-shadow-clip-rounded", 0, gsk_vulkan_box_shadow_pipeline_new },
+  { "blur",                       1, gsk_vulkan_blur_pipeline_new },
+  { "blur-clip",                  1, gsk_vulkan_blur_pipeline_new },
+  { "blur-clip-rounded",          1, gsk_vulkan_blur_pipeline_new },
+  { "mask",                       1, gsk_vulkan_text_pipeline_new },
+  { "mask-clip",                  1, gsk_vulkan_text_pipeline_new },
+  { "mask-clip-rounded",          1, gsk_vulkan_text_pipeline_new },
+  { "texture",                    1, gsk_vulkan_color_text_pipeline_new },
+  { "texture-clip",               1, gsk_vulkan_color_text_pipeline_new },
+  { "texture-clip-rounded",       1, gsk_vulkan_color_text_pipeline_new },
+  { "crossfade",                  2, gsk_vulkan_cross_fade_pipeline_new },
+  { "crossfade-clip",             2, gsk_vulkan_cross_fade_pipeline_new },
+  { "crossfade-clip-rounded",     2, gsk_vulkan_cross_fade_pipeline_new },
+  { "blendmode",                  2, gsk_vulkan_blend_mode_pipeline_new },
+  { "blendmode-clip",             2, gsk_vulkan_blend_mode_pipeline_new },
+  { "blendmode-clip-rounded",     2, gsk_vulkan_blend_mode_pipeline_new },
+};
+
+typedef struct
+{
+  GskVulkanPipelineType type;
+  GskVulkanPipeline *pipeline;
+} PipelineJob;
+
+static GskVulkanPipeline *
+gsk_vulkan_render_create_pipeline (GskVulkanRender       *self,
+                                   GskVulkanPipelineType  type)
+{
+  return pipeline_info[type].create_func (self->vulkan,
+                                          self->pipeline_layout[pipeline_info[type].num_textures],
+                                          pipeline_info[type].name,
+                                          self->render_pass);
+}
+
+static void
+gsk_vulkan_render_create_pipeline_threaded (gpointer data,
+                                            gpointer user_data)
+{
+  PipelineJob *job = data;
+  GskVulkanRender *self = user_data;
+
+  job->pipeline = gsk_vulkan_render_create_pipeline (self, job->type);
+
+  g_async_queue_push (self->finished_pipelines, job);
+}
+
+static void
+gsk_vulkan_render_collect_pipelines (GskVulkanRender *self)
+{
+  PipelineJob *job;
+
+  if (self->finished_pipelines == NULL)
+    return;
+
+  while ((job = g_async_queue_try_pop (self->finished_pipelines)))
+    {
+      self->pending_pipelines &= ~(G_GUINT64_CONSTANT (1) << job->type);
+
+      /* Somebody needed it right away and didn't wait for us */
+      if (self->pipelines[job->type])
+        g_object_unref (job->pipeline);
+      else
+        self->pipelines[job->type] = job->pipeline;
+
+      g_slice_free (PipelineJob, job);
+    }
 }
 
 GskVulkanPipeline *
 gsk_vulkan_render_get_pipeline (GskVulkanRender       *self,
                                 GskVulkanPipelineType  type)
 {
-  static const struct {
-    const char *name;
-    guint num_textures;
-    GskVulkanPipeline * (* create_func) (GdkVulkanContext *context, VkPipelineLayout layout, const char *name, VkRenderPass render_pass);
-  } pipeline_info[GSK_VULKAN_N_PIPELINES] = {
-    { "texture",                    1, gsk_vulkan_texture_pipeline_new },
-    { "texture-clip",               1, gsk_vulkan_texture_pipeline_new },
-    { "texture-clip-rounded",       1, gsk_vulkan_texture_pipeline_new },
-    { "color",                      0, gsk_vulkan_color_pipeline_new },
-    { "color-clip",                 0, gsk_vulkan_color_pipeline_new },
-    { "color-clip-rounded",         0, gsk_vulkan_color_pipeline_new },
-    { "linear",                     0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "linear-clip",                0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "linear-clip-rounded",        0, gsk_vulkan_linear_gradient_pipeline_new },
-    { "color-matrix",               1, gsk_vulkan_effect_pipeline_new },
-    { "color-matrix-clip",          1, gsk_vulkan_effect_pipeline_new },
-    { "color-matrix-clip-rounded",  1, gsk_vulkan_effect_pipeline_new },
-    { "border",                     0, gsk_vulkan_border_pipeline_new },
-    { "border-clip",                0, gsk_vulkan_border_pipeline_new },
-    { "border-clip-rounded",        0, gsk_vulkan_border_pipeline_new },
-    { "inset-shadow",               0, gsk_vulkan_box_shadow_pipeline_new },
-    { "inset-shadow-clip",          0, gsk_vulkan_box_shadow_pipeline_new },
-    { "inset-shadow-clip-rounded",  0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow",              0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow-clip",         0, gsk_vulkan_box_shadow_pipeline_new },
-    { "outset-shadow-clip-rounded", 0, gsk_vulkan_box_shadow_pipeline_new },
-    { "blur",                       1, gsk_vulkan_blur_pipeline_new },
-    { "blur-clip",                  1, gsk_vulkan_blur_pipeline_new },
-    { "blur-clip-rounded",          1, gsk_vulkan_blur_pipeline_new },
-    { "mask",                       1, gsk_vulkan_text_pipeline_new },
-    { "mask-clip",                  1, gsk_vulkan_text_pipeline_new },
-    { "mask-clip-rounded",          1, gsk_vulkan_text_pipeline_new },
-    { "texture",                    1, gsk_vulkan_color_text_pipeline_new },
-    { "texture-clip",               1, gsk_vulkan_color_text_pipeline_new },
-    { "texture-clip-rounded",       1, gsk_vulkan_color_text_pipeline_new },
-    { "crossfade",                  2, gsk_vulkan_cross_fade_pipeline_new },
-    { "crossfade-clip",             2, gsk_vulkan_cross_fade_pipeline_new },
-    { "crossfade-clip-rounded",     2, gsk_vulkan_cross_fade_pipeline_new },
-    { "blendmode",                  2, gsk_vulkan_blend_mode_pipeline_new },
-    { "blendmode-clip",             2, gsk_vulkan_blend_mode_pipeline_new },
-    { "blendmode-clip-rounded",     2, gsk_vulkan_blend_mode_pipeline_new },
-  };
-
   g_return_val_if_fail (type < GSK_VULKAN_N_PIPELINES, NULL);
 
   if (self->pipelines[type] == NULL)
-    self->pipelines[type] = pipeline_info[type].create_func (self->vulkan,
-                                                             self->pipeline_layout[pipeline_info[type].num_textures],
-                                                             pipeline_info[type].name,
-                                                             self->render_pass);
+    self->pipelines[type] = gsk_vulkan_render_create_pipeline (self, type);
 
   return self->pipelines[type];
 }
 
+/*
+ * gsk_vulkan_render_peek_pipeline:
+ *
+ * Like gsk_vulkan_render_get_pipeline(), but for pipelines that are
+ * rarely needed. If async pipelines are enabled, the pipeline is
+ * created on a background thread and %NULL is returned until it is
+ * ready, so callers need to fall back to something else meanwhile.
+ */
+GskVulkanPipeline *
+gsk_vulkan_render_peek_pipeline (GskVulkanRender       *self,
+                                 GskVulkanPipelineType  type)
+{
+  PipelineJob *job;
+
+  g_return_val_if_fail (type < GSK_VULKAN_N_PIPELINES, NULL);
+
+  if (!self->async_pipelines)
+    return gsk_vulkan_render_get_pipeline (self, type);
+
+  gsk_vulkan_render_collect_pipelines (self);
+
+  if (self->pipelines[type] != NULL ||
+      self->pending_pipelines & (G_GUINT64_CONSTANT (1) << type))
+    return self->pipelines[type];
+
+  if (self->pipeline_pool == NULL)
+    {
+      self->finished_pipelines = g_async_queue_new ();
+      self->pipeline_pool = g_thread_pool_new (gsk_vulkan_render_create_pipeline_threaded,
+                                               self,
+                                               1, FALSE, NULL);
+    }
+
+  job = g_slice_new0 (PipelineJob);
+  job->type = type;
+
+  self->pending_pipelines |= G_GUINT64_CONSTANT (1) << type;
+  g_thread_pool_push (self->pipeline_pool, job, NULL);
+
+  return NULL;
+}
+
+void
+gsk_vulkan_render_set_async_pipelines (GskVulkanRender *self,
+                                       gboolean         async_pipelines)
+{
+  self->async_pipelines = async_pipelines;
+}
+
 VkDescriptorSet
 gsk_vulkan_render_get_descriptor_set (GskVulkanRender *self,
                                       gsize            id)
 {
-  g_assert (id < self->n_descriptor_sets);
+  g_assert (id < self->frame->n_descriptor_sets);
 
-  return self->descriptor_sets[id];
+  return self->frame->descriptor_sets[id];
 }
 
 typedef struct {
@@ -476,15 +733,15 @@ gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
   lookup.image = source;
   lookup.repeat = repeat;
 
-  entry = g_hash_table_lookup (self->descriptor_set_indexes, &lookup);
+  entry = g_hash_table_lookup (self->frame->descriptor_set_indexes, &lookup);
   if (entry)
     return entry->index;
 
   entry = g_new (HashDescriptorSetIndexEntry, 1);
   entry->image = source;
   entry->repeat = repeat;
-  entry->index = g_hash_table_size (self->descriptor_set_indexes);
-  g_hash_table_add (self->descriptor_set_indexes, entry);
+  entry->index = g_hash_table_size (self->frame->descriptor_set_indexes);
+  g_hash_table_add (self->frame->descriptor_set_indexes, entry);
 
   return entry->index;
 }
@@ -492,6 +749,7 @@ gsk_vulkan_render_reserve_descriptor_set (GskVulkanRender *self,
 static void
 gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
 {
+  GskVulkanRenderFrame *frame = self->frame;
   GHashTableIter iter;
   gpointer key;
   VkDevice device;
@@ -500,49 +758,49 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
 
   device = gdk_vulkan_context_get_device (self->vulkan);
 
-  for (l = self->render_passes; l; l = l->next)
+  for (l = frame->render_passes; l; l = l->next)
     {
       GskVulkanRenderPass *pass = l->data;
       gsk_vulkan_render_pass_reserve_descriptor_sets (pass, self);
     }
   
-  needed_sets = g_hash_table_size (self->descriptor_set_indexes);
-  if (needed_sets > self->n_descriptor_sets)
+  needed_sets = g_hash_table_size (frame->descriptor_set_indexes);
+  if (needed_sets > frame->n_descriptor_sets)
     {
-      if (needed_sets > self->descriptor_pool_maxsets)
+      if (needed_sets > frame->descriptor_pool_maxsets)
         {
-          guint added_sets = needed_sets - self->descriptor_pool_maxsets;
+          guint added_sets = needed_sets - frame->descriptor_pool_maxsets;
           added_sets = added_sets + DESCRIPTOR_POOL_MAXSETS_INCREASE - 1;
           added_sets -= added_sets % DESCRIPTOR_POOL_MAXSETS_INCREASE;
 
           vkDestroyDescriptorPool (device,
-                                   self->descriptor_pool,
+                                   frame->descriptor_pool,
                                    NULL);
-          self->descriptor_pool_maxsets += added_sets;
+          frame->descriptor_pool_maxsets += added_sets;
           GSK_VK_CHECK (vkCreateDescriptorPool, device,
                                                 &(VkDescriptorPoolCreateInfo) {
                                                     .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                                                    .maxSets = self->descriptor_pool_maxsets,
+                                                    .maxSets = frame->descriptor_pool_maxsets,
                                                     .poolSizeCount = 1,
                                                     .pPoolSizes = (VkDescriptorPoolSize[1]) {
                                                         {
                                                             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                            .descriptorCount = self->descriptor_pool_maxsets
+                                                            .descriptorCount = frame->descriptor_pool_maxsets
                                                         }
                                                     }
                                                 },
                                                 NULL,
-                                                &self->descriptor_pool);
+                                                &frame->descriptor_pool);
         }
       else
         {
           GSK_VK_CHECK (vkResetDescriptorPool, device,
-                                               self->descriptor_pool,
+                                               frame->descriptor_pool,
                                                0);
         }
 
-      self->n_descriptor_sets = needed_sets;
-      self->descriptor_sets = g_renew (VkDescriptorSet, self->descriptor_sets, needed_sets);
+      frame->n_descriptor_sets = needed_sets;
+      frame->descriptor_sets = g_renew (VkDescriptorSet, frame->descriptor_sets, needed_sets);
     }
 
   VkDescriptorSetLayout *layouts = g_newa (VkDescriptorSetLayout, needed_sets);
@@ -552,13 +810,13 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
   GSK_VK_CHECK (vkAllocateDescriptorSets, device,
                                           &(VkDescriptorSetAllocateInfo) {
                                               .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-                                              .descriptorPool = self->descriptor_pool,
+                                              .descriptorPool = frame->descriptor_pool,
                                               .descriptorSetCount = needed_sets,
                                               .pSetLayouts = layouts
                                           },
-                                          self->descriptor_sets);
+                                          frame->descriptor_sets);
 
-  g_hash_table_iter_init (&iter, self->descriptor_set_indexes);
+  g_hash_table_iter_init (&iter, frame->descriptor_set_indexes);
   while (g_hash_table_iter_next (&iter, &key, NULL))
     {
       HashDescriptorSetIndexEntry *entry = key;
@@ -571,7 +829,7 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
                               (VkWriteDescriptorSet[1]) {
                                   {
                                       .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                      .dstSet = self->descriptor_sets[id],
+                                      .dstSet = frame->descriptor_sets[id],
                                       .dstBinding = 0,
                                       .dstArrayElement = 0,
                                       .descriptorCount = 1,
@@ -587,9 +845,144 @@ gsk_vulkan_render_prepare_descriptor_sets (GskVulkanRender *self)
     }
 }
 
+typedef struct {
+  GMutex lock;
+  GCond cond;
+  int n_pending;
+} RecordBatch;
+
+typedef struct {
+  GskVulkanRender *render;
+  GskVulkanCommandPool *command_pool;
+  GskVulkanRenderPass **passes;
+  VkCommandBuffer *command_buffers;
+  guint start;
+  guint end;
+  RecordBatch *batch;
+} RecordJob;
+
+static void
+record_job_run (RecordJob *job)
+{
+  GskVulkanRender *self = job->render;
+  guint i;
+
+  for (i = job->start; i < job->end; i++)
+    {
+      job->command_buffers[i] = gsk_vulkan_command_pool_get_buffer (job->command_pool);
+      gsk_vulkan_render_pass_draw (job->passes[i], self, 3, self->pipeline_layout, job->command_buffers[i]);
+    }
+}
+
+static void
+record_job_threaded (gpointer data,
+                     gpointer user_data)
+{
+  RecordJob *job = data;
+  RecordBatch *batch = job->batch;
+
+  record_job_run (job);
+
+  g_mutex_lock (&batch->lock);
+  batch->n_pending--;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+static GThreadPool *
+get_record_pool (guint *n_threads)
+{
+  static GThreadPool *pool = NULL;
+  static guint max_threads = 0;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *result;
+
+      max_threads = CLAMP (g_get_num_processors () - 1, 1, MAX_RECORD_THREADS);
+      result = g_thread_pool_new (record_job_threaded, NULL, max_threads, FALSE, NULL);
+
+      g_once_init_leave (&pool, result);
+    }
+
+  *n_threads = max_threads;
+
+  return pool;
+}
+
+/* Records the command buffers of all passes. Offscreen passes don't
+ * depend on each other while recording, so with multiple passes the
+ * recording is split over worker threads. Each of them uses its own
+ * command pool, as command pools must not be used concurrently.
+ */
+static void
+gsk_vulkan_render_record_passes (GskVulkanRender      *self,
+                                 GskVulkanRenderPass **passes,
+                                 VkCommandBuffer      *command_buffers,
+                                 guint                 n_passes)
+{
+  GskVulkanRenderFrame *frame = self->frame;
+  RecordJob jobs[MAX_RECORD_THREADS + 1];
+  RecordBatch batch;
+  GThreadPool *pool;
+  guint n_threads, n_jobs, per_job, i;
+
+  if (n_passes < 2 || g_get_num_processors () < 2)
+    {
+      jobs[0] = (RecordJob) { self, frame->command_pools[0], passes, command_buffers, 0, n_passes, NULL };
+      record_job_run (&jobs[0]);
+      return;
+    }
+
+  pool = get_record_pool (&n_threads);
+
+  /* The calling thread records, too */
+  n_jobs = MIN (n_threads + 1, n_passes);
+  per_job = (n_passes + n_jobs - 1) / n_jobs;
+  n_jobs = (n_passes + per_job - 1) / per_job;
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      if (frame->command_pools[i] == NULL)
+        frame->command_pools[i] = gsk_vulkan_command_pool_new (self->vulkan);
+
+      jobs[i] = (RecordJob) {
+        self,
+        frame->command_pools[i],
+        passes,
+        command_buffers,
+        i * per_job,
+        MIN ((i + 1) * per_job, n_passes),
+        &batch
+      };
+    }
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+  batch.n_pending = n_jobs - 1;
+
+  for (i = 1; i < n_jobs; i++)
+    g_thread_pool_push (pool, &jobs[i], NULL);
+
+  record_job_run (&jobs[0]);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_cond_clear (&batch.cond);
+  g_mutex_clear (&batch.lock);
+}
+
 void
 gsk_vulkan_render_draw (GskVulkanRender *self)
 {
+  GskVulkanRenderFrame *frame = self->frame;
+  GskVulkanRenderPass **passes;
+  VkCommandBuffer *command_buffers;
+  guint n_passes, i;
   GList *l;
 
 #ifdef G_ENABLE_DEBUG
@@ -599,29 +992,33 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 
   gsk_vulkan_render_prepare_descriptor_sets (self);
 
-  for (l = self->render_passes; l; l = l->next)
+  n_passes = g_list_length (frame->render_passes);
+  passes = g_newa (GskVulkanRenderPass *, n_passes);
+  command_buffers = g_newa (VkCommandBuffer, n_passes);
+
+  for (l = frame->render_passes, i = 0; l; l = l->next, i++)
+    passes[i] = l->data;
+
+  gsk_vulkan_render_record_passes (self, passes, command_buffers, n_passes);
+
+  /* Command buffers can only be submitted from one thread, and in order */
+  for (i = 0; i < n_passes; i++)
     {
-      GskVulkanRenderPass *pass = l->data;
-      VkCommandBuffer command_buffer;
       gsize wait_semaphore_count;
       gsize signal_semaphore_count;
       VkSemaphore *wait_semaphores;
       VkSemaphore *signal_semaphores;
 
-      wait_semaphore_count = gsk_vulkan_render_pass_get_wait_semaphores (pass, &wait_semaphores);
-      signal_semaphore_count = gsk_vulkan_render_pass_get_signal_semaphores (pass, &signal_semaphores);
-
-      command_buffer = gsk_vulkan_command_pool_get_buffer (self->command_pool);
+      wait_semaphore_count = gsk_vulkan_render_pass_get_wait_semaphores (passes[i], &wait_semaphores);
+      signal_semaphore_count = gsk_vulkan_render_pass_get_signal_semaphores (passes[i], &signal_semaphores);
 
-      gsk_vulkan_render_pass_draw (pass, self, 3, self->pipeline_layout, command_buffer);
-
-      gsk_vulkan_command_pool_submit_buffer (self->command_pool,
-                                             command_buffer,
+      gsk_vulkan_command_pool_submit_buffer (frame->command_pools[0],
+                                             command_buffers[i],
                                              wait_semaphore_count,
                                              wait_semaphores,
                                              signal_semaphore_count,
                                              signal_semaphores,
-                                             l->next != NULL ? VK_NULL_HANDLE : self->fence);
+                                             i + 1 < n_passes ? VK_NULL_HANDLE : frame->fence);
     }
 
 #ifdef G_ENABLE_DEBUG
@@ -632,7 +1029,7 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 
       GSK_VK_CHECK (vkWaitForFences, gdk_vulkan_context_get_device (self->vulkan),
                                      1,
-                                     &self->fence,
+                                     &frame->fence,
                                      VK_TRUE,
                                      INT64_MAX);
 
@@ -646,43 +1043,76 @@ gsk_vulkan_render_draw (GskVulkanRender *self)
 GdkTexture *
 gsk_vulkan_render_download_target (GskVulkanRender *self)
 {
-  gsk_vulkan_uploader_reset (self->uploader);
+  gsk_vulkan_uploader_reset (self->frame->uploader);
 
-  return gsk_vulkan_image_download (self->target, self->uploader);
+  return gsk_vulkan_image_download (self->target, self->frame->uploader);
 }
 
 static void
-gsk_vulkan_render_cleanup (GskVulkanRender *self)
+gsk_vulkan_render_frame_cleanup (GskVulkanRender      *self,
+                                 GskVulkanRenderFrame *frame)
 {
   VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
+  guint i;
 
-  /* XXX: Wait for fence here or just in reset()? */
   GSK_VK_CHECK (vkWaitForFences, device,
                                  1,
-                                 &self->fence,
+                                 &frame->fence,
                                  VK_TRUE,
                                  INT64_MAX);
 
   GSK_VK_CHECK (vkResetFences, device,
                                1,
-                               &self->fence);
+                               &frame->fence);
 
-  gsk_vulkan_uploader_reset (self->uploader);
+  gsk_vulkan_uploader_reset (frame->uploader);
 
-  gsk_vulkan_command_pool_reset (self->command_pool);
+  for (i = 0; i < G_N_ELEMENTS (frame->command_pools); i++)
+    {
+      if (frame->command_pools[i])
+        gsk_vulkan_command_pool_reset (frame->command_pools[i]);
+    }
 
-  g_hash_table_remove_all (self->descriptor_set_indexes);
+  g_hash_table_remove_all (frame->descriptor_set_indexes);
   GSK_VK_CHECK (vkResetDescriptorPool, device,
-                                       self->descriptor_pool,
+                                       frame->descriptor_pool,
                                        0);
 
-  g_list_free_full (self->render_passes, (GDestroyNotify) gsk_vulkan_render_pass_free);
-  self->render_passes = NULL;
-  g_slist_free_full (self->cleanup_images, g_object_unref);
-  self->cleanup_images = NULL;
+  g_list_free_full (frame->render_passes, (GDestroyNotify) gsk_vulkan_render_pass_free);
+  frame->render_passes = NULL;
+  g_slist_free_full (frame->cleanup_images, g_object_unref);
+  frame->cleanup_images = NULL;
 
-  g_clear_pointer (&self->clip, cairo_region_destroy);
-  g_clear_object (&self->target);
+  g_slist_free_full (frame->retired_vertex_buffers, (GDestroyNotify) free_vertex_buffer);
+  frame->retired_vertex_buffers = NULL;
+  frame->vertex_buffer_used = 0;
+}
+
+static void
+gsk_vulkan_render_frame_finish (GskVulkanRender      *self,
+                                GskVulkanRenderFrame *frame)
+{
+  VkDevice device = gdk_vulkan_context_get_device (self->vulkan);
+  guint i;
+
+  gsk_vulkan_render_frame_cleanup (self, frame);
+
+  g_clear_pointer (&frame->uploader, gsk_vulkan_uploader_free);
+
+  g_clear_pointer (&frame->vertex_buffer, free_vertex_buffer);
+
+  vkDestroyDescriptorPool (device,
+                           frame->descriptor_pool,
+                           NULL);
+  g_free (frame->descriptor_sets);
+  g_hash_table_unref (frame->descriptor_set_indexes);
+
+  vkDestroyFence (device,
+                  frame->fence,
+                  NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (frame->command_pools); i++)
+    g_clear_pointer (&frame->command_pools[i], gsk_vulkan_command_pool_free);
 }
 
 void
@@ -692,8 +1122,15 @@ gsk_vulkan_render_free (GskVulkanRender *self)
   gpointer key, value;
   VkDevice device;
   guint i;
-  
-  gsk_vulkan_render_cleanup (self);
+
+  for (i = 0; i < GSK_VULKAN_MAX_FRAMES_IN_FLIGHT; i++)
+    {
+      if (self->frames[i].command_pools[0] != NULL)
+        gsk_vulkan_render_frame_finish (self, &self->frames[i]);
+    }
+
+  g_clear_pointer (&self->clip, cairo_region_destroy);
+  g_clear_object (&self->target);
 
   device = gdk_vulkan_context_get_device (self->vulkan);
 
@@ -710,12 +1147,18 @@ gsk_vulkan_render_free (GskVulkanRender *self)
       g_hash_table_iter_remove (&iter);
     }
   g_hash_table_unref (self->framebuffers);
+  g_mutex_clear (&self->framebuffer_lock);
+
+  if (self->pipeline_pool)
+    {
+      g_thread_pool_free (self->pipeline_pool, FALSE, TRUE);
+      gsk_vulkan_render_collect_pipelines (self);
+      g_async_queue_unref (self->finished_pipelines);
+    }
 
   for (i = 0; i < GSK_VULKAN_N_PIPELINES; i++)
     g_clear_object (&self->pipelines[i]);
 
-  g_clear_pointer (&self->uploader, gsk_vulkan_uploader_free);
-
   for (i = 0; i < 3; i++)
     vkDestroyPipelineLayout (device,
                              self->pipeline_layout[i],
@@ -725,20 +1168,10 @@ gsk_vulkan_render_free (GskVulkanRender *self)
                        self->render_pass,
                        NULL);
 
-  vkDestroyDescriptorPool (device,
-                           self->descriptor_pool,
-                           NULL);
-  g_free (self->descriptor_sets);
-  g_hash_table_unref (self->descriptor_set_indexes);
-
   vkDestroyDescriptorSetLayout (device,
                                 self->descriptor_set_layout,
                                 NULL);
 
-  vkDestroyFence (device,
-                  self->fence,
-                  NULL);
-
   vkDestroySampler (device,
                     self->sampler,
                     NULL);
@@ -747,15 +1180,35 @@ gsk_vulkan_render_free (GskVulkanRender *self)
                     self->repeating_sampler,
                     NULL);
 
-  gsk_vulkan_command_pool_free (self->command_pool);
-
   g_slice_free (GskVulkanRender, self);
 }
 
+/* Whether the frame that would be used by the next reset is still
+ * being rendered */
 gboolean
 gsk_vulkan_render_is_busy (GskVulkanRender *self)
 {
-  return vkGetFenceStatus (gdk_vulkan_context_get_device (self->vulkan), self->fence) != VK_SUCCESS;
+  GskVulkanRenderFrame *next = &self->frames[(self->frame_index + 1) % self->n_frames];
+
+  if (next->command_pools[0] == NULL)
+    return FALSE;
+
+  return vkGetFenceStatus (gdk_vulkan_context_get_device (self->vulkan), next->fence) != VK_SUCCESS;
+}
+
+/*
+ * gsk_vulkan_render_set_frames_in_flight:
+ *
+ * Sets how many frames may be rendered by the GPU while the next one
+ * is prepared. Every frame in flight gets its own command buffers,
+ * descriptor sets and vertex data, so the CPU only has to wait when
+ * all of them are still in use.
+ */
+void
+gsk_vulkan_render_set_frames_in_flight (GskVulkanRender *self,
+                                        guint            n_frames)
+{
+  self->n_frames = CLAMP (n_frames, 1, GSK_VULKAN_MAX_FRAMES_IN_FLIGHT);
 }
 
 void
@@ -764,7 +1217,16 @@ gsk_vulkan_render_reset (GskVulkanRender       *self,
                          const graphene_rect_t *rect,
                          const cairo_region_t  *clip)
 {
-  gsk_vulkan_render_cleanup (self);
+  g_clear_pointer (&self->clip, cairo_region_destroy);
+  g_clear_object (&self->target);
+
+  self->frame_index = (self->frame_index + 1) % self->n_frames;
+  self->frame = &self->frames[self->frame_index];
+
+  if (self->frame->command_pools[0] == NULL)
+    gsk_vulkan_render_frame_init (self, self->frame);
+  else
+    gsk_vulkan_render_frame_cleanup (self, self->frame);
 
   gsk_vulkan_render_setup (self, target, rect, clip);
 }
@@ -16,13 +16,34 @@
 #include "gdk/gdkprofilerprivate.h"
 
 #include <graphene.h>
+#include <string.h>
+
+/* Textures up to this size are packed into shared atlases, so that
+ * the many small icons in a typical frame don't each need their own
+ * image and upload.
+ */
+#define MAX_ATLAS_ITEM_SIZE 128
+#define ATLAS_SIZE 512
 
 typedef struct _GskVulkanTextureData GskVulkanTextureData;
+typedef struct _GskVulkanTextureAtlas GskVulkanTextureAtlas;
+
+struct _GskVulkanTextureAtlas {
+  GskVulkanImage *image;
+  int x, y, y0;
+  guint n_textures;
+  GArray *pending_regions; /* GskImageRegion, owning their data */
+};
 
 struct _GskVulkanTextureData {
   GdkTexture *texture;
   GskVulkanImage *image;
   GskVulkanRenderer *renderer;
+
+  /* Set if the texture was put in an atlas. image is only
+   * created when the texture is needed on its own, too. */
+  GskVulkanTextureAtlas *atlas;
+  graphene_rect_t atlas_rect;
 };
 
 #ifdef G_ENABLE_DEBUG
@@ -54,6 +75,7 @@ struct _GskVulkanRenderer
   GskVulkanRender *render;
 
   GSList *textures;
+  GPtrArray *texture_atlases;
 
   GskVulkanGlyphCache *glyph_cache;
 
@@ -112,6 +134,32 @@ gsk_vulkan_renderer_update_images_cb (GdkVulkanContext  *context,
     }
 }
 
+static void
+gsk_vulkan_texture_atlas_free (GskVulkanTextureAtlas *atlas)
+{
+  guint i;
+
+  for (i = 0; i < atlas->pending_regions->len; i++)
+    g_free (g_array_index (atlas->pending_regions, GskImageRegion, i).data);
+  g_array_unref (atlas->pending_regions);
+  g_object_unref (atlas->image);
+  g_slice_free (GskVulkanTextureAtlas, atlas);
+}
+
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+
+static guint
+get_frames_in_flight (void)
+{
+  const char *env;
+
+  env = g_getenv ("GSK_VULKAN_FRAMES_IN_FLIGHT");
+  if (env != NULL)
+    return CLAMP (g_ascii_strtoull (env, NULL, 10), 1, GSK_VULKAN_MAX_FRAMES_IN_FLIGHT);
+
+  return DEFAULT_FRAMES_IN_FLIGHT;
+}
+
 static gboolean
 gsk_vulkan_renderer_realize (GskRenderer  *renderer,
                              GdkSurface    *window,
@@ -129,9 +177,14 @@ gsk_vulkan_renderer_realize (GskRenderer  *renderer,
                     self);
   gsk_vulkan_renderer_update_images_cb (self->vulkan, self);
 
+  gsk_vulkan_pipeline_cache_init (self->vulkan);
+
   self->render = gsk_vulkan_render_new (renderer, self->vulkan);
+  gsk_vulkan_render_set_async_pipelines (self->render, TRUE);
+  gsk_vulkan_render_set_frames_in_flight (self->render, get_frames_in_flight ());
 
   self->glyph_cache = gsk_vulkan_glyph_cache_new (renderer, self->vulkan);
+  self->texture_atlases = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_vulkan_texture_atlas_free);
 
   return TRUE;
 }
@@ -153,8 +206,12 @@ gsk_vulkan_renderer_unrealize (GskRenderer *renderer)
     }
   g_clear_pointer (&self->textures, g_slist_free);
 
+  g_clear_pointer (&self->texture_atlases, g_ptr_array_unref);
+
   g_clear_pointer (&self->render, gsk_vulkan_render_free);
 
+  gsk_vulkan_pipeline_cache_finish (self->vulkan);
+
   gsk_vulkan_renderer_free_targets (self);
   g_signal_handlers_disconnect_by_func(self->vulkan,
                                        gsk_vulkan_renderer_update_images_cb,
@@ -233,6 +290,7 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
   GskVulkanRenderer *self = GSK_VULKAN_RENDERER (renderer);
   GskVulkanRender *render;
   const cairo_region_t *clip;
+  gint64 before G_GNUC_UNUSED;
 #ifdef G_ENABLE_DEBUG
   GskProfiler *profiler;
   gint64 cpu_time;
@@ -252,11 +310,15 @@ gsk_vulkan_renderer_render (GskRenderer          *renderer,
   clip = gdk_draw_context_get_frame_region (GDK_DRAW_CONTEXT (self->vulkan));
   gsk_vulkan_render_reset (render, self->targets[gdk_vulkan_context_get_draw_index (self->vulkan)], NULL, clip);
 
+  before = gdk_profiler_trace_begin ();
   gsk_vulkan_render_add_node (render, root);
+  gdk_profiler_trace_end (before, "Vulkan build ops");
 
   gsk_vulkan_render_upload (render);
 
+  before = gdk_profiler_trace_begin ();
   gsk_vulkan_render_draw (render);
+  gdk_profiler_trace_end (before, "Vulkan submit ops");
 
 #ifdef G_ENABLE_DEBUG
   gsk_profiler_counter_inc (profiler, self->profile_counters.frames);
@@ -315,25 +377,35 @@ gsk_vulkan_renderer_clear_texture (gpointer p)
   GskVulkanTextureData *data = p;
 
   if (data->renderer != NULL)
-    data->renderer->textures = g_slist_remove (data->renderer->textures, data);
+    {
+      data->renderer->textures = g_slist_remove (data->renderer->textures, data);
+
+      /* Space in atlases isn't reused, but once all the textures
+       * in an atlas are gone, the whole atlas can go. Frames that
+       * are still in flight hold their own reference to the image.
+       */
+      if (data->atlas && --data->atlas->n_textures == 0)
+        g_ptr_array_remove_fast (data->renderer->texture_atlases, data->atlas);
+    }
 
-  g_object_unref (data->image);
+  g_clear_object (&data->image);
 
   g_slice_free (GskVulkanTextureData, data);
 }
 
-GskVulkanImage *
-gsk_vulkan_renderer_ref_texture_image (GskVulkanRenderer *self,
-                                       GdkTexture        *texture,
-                                       GskVulkanUploader *uploader)
+static GskVulkanImage *
+gsk_vulkan_renderer_upload_texture (GdkTexture        *texture,
+                                    GskVulkanUploader *uploader)
 {
-  GskVulkanTextureData *data;
   cairo_surface_t *surface;
   GskVulkanImage *image;
 
-  data = gdk_texture_get_render_data (texture, self);
-  if (data)
-    return g_object_ref (data->image);
+  if (GDK_IS_DMABUF_TEXTURE (texture))
+    {
+      image = gsk_vulkan_image_new_from_dmabuf (uploader, GDK_DMABUF_TEXTURE (texture));
+      if (image)
+        return image;
+    }
 
   surface = gdk_texture_download_surface (texture);
   image = gsk_vulkan_image_new_from_data (uploader,
@@ -343,22 +415,216 @@ gsk_vulkan_renderer_ref_texture_image (GskVulkanRenderer *self,
                                           cairo_image_surface_get_stride (surface));
   cairo_surface_destroy (surface);
 
+  return image;
+}
+
+static GskVulkanTextureAtlas *
+gsk_vulkan_renderer_allocate_atlas_area (GskVulkanRenderer *self,
+                                         int                width,
+                                         int                height,
+                                         int               *out_x,
+                                         int               *out_y)
+{
+  GskVulkanTextureAtlas *atlas;
+  guint i;
+
+  for (i = 0; i < self->texture_atlases->len; i++)
+    {
+      int x, y0;
+
+      atlas = g_ptr_array_index (self->texture_atlases, i);
+      x = atlas->x;
+      y0 = atlas->y0;
+
+      if (x + width > ATLAS_SIZE)
+        {
+          /* start a new row */
+          x = 0;
+          y0 = atlas->y;
+        }
+
+      if (y0 + height > ATLAS_SIZE)
+        continue;
+
+      atlas->x = x + width;
+      atlas->y0 = y0;
+      atlas->y = MAX (atlas->y, y0 + height);
+
+      *out_x = x;
+      *out_y = y0;
+      return atlas;
+    }
+
+  atlas = g_slice_new0 (GskVulkanTextureAtlas);
+  atlas->image = gsk_vulkan_image_new_for_atlas (self->vulkan, ATLAS_SIZE, ATLAS_SIZE);
+  atlas->pending_regions = g_array_new (FALSE, FALSE, sizeof (GskImageRegion));
+  atlas->x = width;
+  atlas->y = height;
+  g_ptr_array_add (self->texture_atlases, atlas);
+
+  GSK_RENDERER_NOTE (GSK_RENDERER (self), VULKAN,
+                     g_message ("Vulkan texture atlas %u created", self->texture_atlases->len));
+
+  *out_x = 0;
+  *out_y = 0;
+  return atlas;
+}
+
+/* Adds the texture with a 1 pixel border that repeats its edge
+ * pixels, so linear filtering doesn't pick up the neighbors.
+ * The pixels get uploaded by gsk_vulkan_renderer_upload_texture_atlases().
+ */
+static void
+gsk_vulkan_renderer_add_texture_to_atlas (GskVulkanRenderer    *self,
+                                          GskVulkanTextureData *data)
+{
+  cairo_surface_t *surface;
+  GskImageRegion region;
+  const guchar *src;
+  guchar *padded;
+  int width, height, padded_stride, src_stride, x, y, row;
+
+  surface = gdk_texture_download_surface (data->texture);
+  src = cairo_image_surface_get_data (surface);
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  src_stride = cairo_image_surface_get_stride (surface);
+
+  padded_stride = (width + 2) * 4;
+  padded = g_malloc (padded_stride * (height + 2));
+
+  for (row = 0; row < height + 2; row++)
+    {
+      const guchar *s = src + CLAMP (row - 1, 0, height - 1) * src_stride;
+      guchar *d = padded + row * padded_stride;
+
+      memcpy (d, s, 4);
+      memcpy (d + 4, s, width * 4);
+      memcpy (d + (width + 1) * 4, s + (width - 1) * 4, 4);
+    }
+
+  cairo_surface_destroy (surface);
+
+  data->atlas = gsk_vulkan_renderer_allocate_atlas_area (self, width + 2, height + 2, &x, &y);
+  data->atlas->n_textures++;
+  data->atlas_rect = GRAPHENE_RECT_INIT ((float) (x + 1) / ATLAS_SIZE,
+                                         (float) (y + 1) / ATLAS_SIZE,
+                                         (float) width / ATLAS_SIZE,
+                                         (float) height / ATLAS_SIZE);
+
+  region.data = padded;
+  region.width = width + 2;
+  region.height = height + 2;
+  region.stride = padded_stride;
+  region.x = x;
+  region.y = y;
+  g_array_append_val (data->atlas->pending_regions, region);
+}
+
+/* Uploads all textures that were added to atlases since the last call.
+ * This needs to happen in one go per atlas, as every upload transitions
+ * the whole image.
+ */
+void
+gsk_vulkan_renderer_upload_texture_atlases (GskVulkanRenderer *self,
+                                            GskVulkanUploader *uploader)
+{
+  guint i, j;
+
+  for (i = 0; i < self->texture_atlases->len; i++)
+    {
+      GskVulkanTextureAtlas *atlas = g_ptr_array_index (self->texture_atlases, i);
+      GArray *pending = atlas->pending_regions;
+
+      if (pending->len == 0)
+        continue;
+
+      gsk_vulkan_image_upload_regions (atlas->image,
+                                       uploader,
+                                       pending->len,
+                                       (GskImageRegion *) pending->data);
+
+      for (j = 0; j < pending->len; j++)
+        g_free (g_array_index (pending, GskImageRegion, j).data);
+      g_array_set_size (pending, 0);
+    }
+}
+
+static GskVulkanTextureData *
+gsk_vulkan_renderer_get_texture_data (GskVulkanRenderer *self,
+                                      GdkTexture        *texture)
+{
+  GskVulkanTextureData *data;
+
+  data = gdk_texture_get_render_data (texture, self);
+  if (data)
+    return data;
+
   data = g_slice_new0 (GskVulkanTextureData);
-  data->image = image;
   data->texture = texture;
   data->renderer = self;
 
-  if (gdk_texture_set_render_data (texture, self, data, gsk_vulkan_renderer_clear_texture))
+  if (!gdk_texture_set_render_data (texture, self, data, gsk_vulkan_renderer_clear_texture))
     {
-      g_object_ref (data->image);
-      self->textures = g_slist_prepend (self->textures, data);
+      g_slice_free (GskVulkanTextureData, data);
+      return NULL;
     }
-  else
+
+  self->textures = g_slist_prepend (self->textures, data);
+
+  return data;
+}
+
+/* Returns an image with only the contents of @texture, as needed
+ * when the whole image gets sampled, for example when repeating it.
+ */
+GskVulkanImage *
+gsk_vulkan_renderer_ref_texture_image (GskVulkanRenderer *self,
+                                       GdkTexture        *texture,
+                                       GskVulkanUploader *uploader)
+{
+  GskVulkanTextureData *data;
+
+  data = gsk_vulkan_renderer_get_texture_data (self, texture);
+  if (data == NULL)
+    return gsk_vulkan_renderer_upload_texture (texture, uploader);
+
+  if (data->image == NULL)
+    data->image = gsk_vulkan_renderer_upload_texture (texture, uploader);
+
+  return g_object_ref (data->image);
+}
+
+/* Like gsk_vulkan_renderer_ref_texture_image(), but small textures
+ * may be returned inside an atlas. @tex_rect is set to the area of
+ * the image that contains @texture, in normalized coordinates.
+ */
+GskVulkanImage *
+gsk_vulkan_renderer_ref_texture_image_region (GskVulkanRenderer *self,
+                                              GdkTexture        *texture,
+                                              GskVulkanUploader *uploader,
+                                              graphene_rect_t   *tex_rect)
+{
+  GskVulkanTextureData *data;
+
+  data = gsk_vulkan_renderer_get_texture_data (self, texture);
+
+  /* Atlases are filled from memory, dma-bufs are imported instead */
+  if (data && data->atlas == NULL && data->image == NULL &&
+      !GDK_IS_DMABUF_TEXTURE (texture) &&
+      gdk_texture_get_width (texture) <= MAX_ATLAS_ITEM_SIZE &&
+      gdk_texture_get_height (texture) <= MAX_ATLAS_ITEM_SIZE)
+    gsk_vulkan_renderer_add_texture_to_atlas (self, data);
+
+  if (data && data->atlas)
     {
-      g_slice_free (GskVulkanTextureData, data);
+      *tex_rect = data->atlas_rect;
+      return g_object_ref (data->atlas->image);
     }
 
-  return image;
+  *tex_rect = GRAPHENE_RECT_INIT (0, 0, 1, 1);
+
+  return gsk_vulkan_renderer_ref_texture_image (self, texture, uploader);
 }
 
 GskVulkanImage *
@@ -9,6 +9,12 @@ G_BEGIN_DECLS
 GskVulkanImage *        gsk_vulkan_renderer_ref_texture_image           (GskVulkanRenderer      *self,
                                                                          GdkTexture             *texture,
                                                                          GskVulkanUploader      *uploader);
+GskVulkanImage *        gsk_vulkan_renderer_ref_texture_image_region    (GskVulkanRenderer      *self,
+                                                                         GdkTexture             *texture,
+                                                                         GskVulkanUploader      *uploader,
+                                                                         graphene_rect_t        *tex_rect);
+void                    gsk_vulkan_renderer_upload_texture_atlases      (GskVulkanRenderer      *self,
+                                                                         GskVulkanUploader      *uploader);
 
 typedef struct
 {
@@ -87,6 +87,7 @@ struct _GskVulkanOpText
   gsize                descriptor_set_index; /* index into descriptor sets array for the right descriptor set to bind */
   guint                texture_index; /* index of the texture in the glyph cache */
   guint                start_glyph; /* the first glyph in nodes glyphstring that we render */
+  int                  start_x; /* the x position of start_glyph, in Pango units */
   guint                num_glyphs; /* number of *non-empty* glyphs (== instances) we render */
   float                scale;
 };
@@ -122,7 +123,9 @@ struct _GskVulkanRenderPass
   VkRenderPass render_pass;
   VkSemaphore signal_semaphore;
   GArray *wait_semaphores;
+  /* Owned by the render, valid until it is reset */
   GskVulkanBuffer *vertex_data;
+  gsize vertex_offset;
 
   GQuark fallback_pixels;
   GQuark texture_pixels;
@@ -222,8 +225,6 @@ gsk_vulkan_render_pass_free (GskVulkanRenderPass *self)
   vkDestroyRenderPass (gdk_vulkan_context_get_device (self->vulkan),
                        self->render_pass,
                        NULL);
-  if (self->vertex_data)
-    gsk_vulkan_buffer_free (self->vertex_data);
   if (self->signal_semaphore != VK_NULL_HANDLE)
     vkDestroySemaphore (gdk_vulkan_context_get_device (self->vulkan),
                         self->signal_semaphore,
@@ -251,6 +252,9 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
   };
   GskVulkanPipelineType pipeline_type;
 
+  if (!gsk_vulkan_clip_may_intersect_rect (&constants->clip, &node->bounds))
+    return;
+
   switch (gsk_render_node_get_node_type (node))
     {
     case GSK_NOT_A_RENDER_NODE:
@@ -286,7 +290,9 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
       else
         FALLBACK ("Blend nodes can't deal with clip type %u", constants->clip.type);
       op.type = GSK_VULKAN_OP_BLEND_MODE;
-      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      op.render.pipeline = gsk_vulkan_render_peek_pipeline (render, pipeline_type);
+      if (op.render.pipeline == NULL)
+        FALLBACK ("Blend mode pipeline not ready yet");
       g_array_append_val (self->render_ops, op);
        return;
 
@@ -300,7 +306,9 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
       else
         FALLBACK ("Cross fade nodes can't deal with clip type %u", constants->clip.type);
       op.type = GSK_VULKAN_OP_CROSS_FADE;
-      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      op.render.pipeline = gsk_vulkan_render_peek_pipeline (render, pipeline_type);
+      if (op.render.pipeline == NULL)
+        FALLBACK ("Cross fade pipeline not ready yet");
       g_array_append_val (self->render_ops, op);
       return;
 
@@ -384,6 +392,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
         op.text.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
 
         op.text.start_glyph = 0;
+        op.text.start_x = 0;
         op.text.texture_index = G_MAXUINT;
         op.text.scale = self->scale_factor;
 
@@ -408,6 +417,7 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
 
                 count = 1;
                 op.text.start_glyph = i;
+                op.text.start_x = x_position;
                 op.text.texture_index = texture_index;
               }
             else
@@ -496,7 +506,9 @@ gsk_vulkan_render_pass_add_node (GskVulkanRenderPass           *self,
       else
         FALLBACK ("Blur nodes can't deal with clip type %u", constants->clip.type);
       op.type = GSK_VULKAN_OP_BLUR;
-      op.render.pipeline = gsk_vulkan_render_get_pipeline (render, pipeline_type);
+      op.render.pipeline = gsk_vulkan_render_peek_pipeline (render, pipeline_type);
+      if (op.render.pipeline == NULL)
+        FALLBACK ("Blur pipeline not ready yet");
       g_array_append_val (self->render_ops, op);
       return;
 
@@ -637,7 +649,8 @@ fallback:
 void
 gsk_vulkan_render_pass_add (GskVulkanRenderPass     *self,
                             GskVulkanRender         *render,
-                            GskRenderNode           *node)
+                            GskRenderNode           *node,
+                            const graphene_rect_t   *damage)
 {
   GskVulkanOp op = { 0, };
   graphene_matrix_t mvp;
@@ -645,6 +658,13 @@ gsk_vulkan_render_pass_add (GskVulkanRenderPass     *self,
   graphene_matrix_multiply (&self->mv, &self->p, &mvp);
   op.type = GSK_VULKAN_OP_PUSH_VERTEX_CONSTANTS;
   gsk_vulkan_push_constants_init (&op.constants.constants, &mvp, &self->viewport);
+
+  /* Everything outside the damage is scissored away anyway,
+   * so make sure we don't even bother with those nodes */
+  if (damage &&
+      !gsk_vulkan_push_constants_intersect_rect (&op.constants.constants, &op.constants.constants, damage))
+    g_assert_not_reached ();
+
   g_array_append_val (self->render_ops, op);
 
   gsk_vulkan_render_pass_add_node (self, render, &op.constants.constants, node);
@@ -747,7 +767,7 @@ gsk_vulkan_render_pass_get_node_as_texture (GskVulkanRenderPass   *self,
         cairo_region_destroy (clip);
 
         gsk_vulkan_render_add_render_pass (render, pass);
-        gsk_vulkan_render_pass_add (pass, render, node);
+        gsk_vulkan_render_pass_add (pass, render, node, NULL);
         gsk_vulkan_render_add_cleanup_image (render, result);
 
         /* assuming the unclipped bounds should go to texture coordinates 0..1,
@@ -803,39 +823,32 @@ gsk_vulkan_render_pass_get_node_as_texture (GskVulkanRenderPass   *self,
   return result;
 }
 
-static void
-gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
-                                        GskVulkanOpRender    *op,
-                                        GskVulkanRender      *render,
-                                        GskVulkanUploader    *uploader)
+typedef struct
 {
-  GskRenderNode *node;
+  GskVulkanOpRender *op;
+  int scale_factor;
+  GAsyncQueue *finished;
   cairo_surface_t *surface;
-  cairo_t *cr;
+  gboolean done;
+} FallbackJob;
 
-  node = op->node;
+#define MAX_FALLBACK_THREADS 4
 
-  GSK_RENDERER_NOTE (gsk_vulkan_render_get_renderer (render), FALLBACK,
-            g_message ("Upload op=%s, node %s[%p], bounds %gx%g",
-                     op->type == GSK_VULKAN_OP_FALLBACK_CLIP ? "fallback-clip" :
-                     (op->type == GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP ? "fallback-rounded-clip" : "fallback"),
-                     g_type_name_from_instance ((GTypeInstance *) node), node,
-                     ceil (node->bounds.size.width),
-                     ceil (node->bounds.size.height)));
-#ifdef G_ENABLE_DEBUG
-  {
-    GskProfiler *profiler = gsk_renderer_get_profiler (gsk_vulkan_render_get_renderer (render));
-    gsk_profiler_counter_add (profiler,
-                              self->fallback_pixels,
-                              ceil (node->bounds.size.width) * ceil (node->bounds.size.height));
-  }
-#endif
+/* Only uses cairo, so this can run on the fallback threads
+ * for nodes that pass gsk_render_node_can_draw_threaded() */
+static cairo_surface_t *
+draw_fallback_surface (GskVulkanOpRender *op,
+                       int                scale_factor)
+{
+  GskRenderNode *node = op->node;
+  cairo_surface_t *surface;
+  cairo_t *cr;
 
   /* XXX: We could intersect bounds with clip bounds here */
   surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                        ceil (node->bounds.size.width * self->scale_factor),
-                                        ceil (node->bounds.size.height * self->scale_factor));
-  cairo_surface_set_device_scale (surface, self->scale_factor, self->scale_factor);
+                                        ceil (node->bounds.size.width * scale_factor),
+                                        ceil (node->bounds.size.height * scale_factor));
+  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
   cr = cairo_create (surface);
   cairo_translate (cr, -node->bounds.origin.x, -node->bounds.origin.y);
 
@@ -860,6 +873,123 @@ gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
 
   cairo_destroy (cr);
 
+  return surface;
+}
+
+static void
+draw_fallback_threaded (gpointer data,
+                        gpointer user_data)
+{
+  FallbackJob *job = data;
+
+  job->surface = draw_fallback_surface (job->op, job->scale_factor);
+
+  g_async_queue_push (job->finished, job);
+}
+
+static GThreadPool *
+get_fallback_pool (void)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool = g_thread_pool_new (draw_fallback_threaded, NULL,
+                                                 CLAMP (g_get_num_processors () - 1, 1, MAX_FALLBACK_THREADS),
+                                                 FALSE, NULL);
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/* Starts drawing all fallback nodes of the pass that can be drawn
+ * on another thread. Returns a table mapping ops to their jobs,
+ * or %NULL if there are none. */
+static GHashTable *
+gsk_vulkan_render_pass_queue_fallbacks (GskVulkanRenderPass *self,
+                                        GAsyncQueue         *finished)
+{
+  GHashTable *jobs = NULL;
+  GskVulkanOp *op;
+  guint i;
+
+  for (i = 0; i < self->render_ops->len; i++)
+    {
+      FallbackJob *job;
+
+      op = &g_array_index (self->render_ops, GskVulkanOp, i);
+
+      if (op->type != GSK_VULKAN_OP_FALLBACK &&
+          op->type != GSK_VULKAN_OP_FALLBACK_CLIP &&
+          op->type != GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP)
+        continue;
+
+      if (!gsk_render_node_can_draw_threaded (op->render.node))
+        continue;
+
+      if (jobs == NULL)
+        jobs = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+      job = g_new0 (FallbackJob, 1);
+      job->op = &op->render;
+      job->scale_factor = self->scale_factor;
+      job->finished = finished;
+      g_hash_table_insert (jobs, job->op, job);
+
+      g_thread_pool_push (get_fallback_pool (), job, NULL);
+    }
+
+  return jobs;
+}
+
+static cairo_surface_t *
+wait_for_fallback (GAsyncQueue *finished,
+                   FallbackJob *job)
+{
+  while (!job->done)
+    {
+      FallbackJob *done = g_async_queue_pop (finished);
+      done->done = TRUE;
+    }
+
+  return job->surface;
+}
+
+static void
+gsk_vulkan_render_pass_upload_fallback (GskVulkanRenderPass  *self,
+                                        GskVulkanOpRender    *op,
+                                        GskVulkanRender      *render,
+                                        GskVulkanUploader    *uploader,
+                                        GAsyncQueue          *finished,
+                                        FallbackJob          *job)
+{
+  GskRenderNode *node;
+  cairo_surface_t *surface;
+
+  node = op->node;
+
+  GSK_RENDERER_NOTE (gsk_vulkan_render_get_renderer (render), FALLBACK,
+            g_message ("Upload op=%s, node %s[%p], bounds %gx%g",
+                     op->type == GSK_VULKAN_OP_FALLBACK_CLIP ? "fallback-clip" :
+                     (op->type == GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP ? "fallback-rounded-clip" : "fallback"),
+                     g_type_name_from_instance ((GTypeInstance *) node), node,
+                     ceil (node->bounds.size.width),
+                     ceil (node->bounds.size.height)));
+#ifdef G_ENABLE_DEBUG
+  {
+    GskProfiler *profiler = gsk_renderer_get_profiler (gsk_vulkan_render_get_renderer (render));
+    gsk_profiler_counter_add (profiler,
+                              self->fallback_pixels,
+                              ceil (node->bounds.size.width) * ceil (node->bounds.size.height));
+  }
+#endif
+
+  if (job)
+    surface = wait_for_fallback (finished, job);
+  else
+    surface = draw_fallback_surface (op, self->scale_factor);
+
   op->source = gsk_vulkan_image_new_from_data (uploader,
                                                cairo_image_surface_get_data (surface),
                                                cairo_image_surface_get_width (surface),
@@ -881,6 +1011,12 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
   GskVulkanOp *op;
   guint i;
   GskVulkanClip *clip = NULL;
+  GAsyncQueue *finished;
+  GHashTable *fallback_jobs;
+
+  /* Fallbacks get drawn in parallel while we take care of the rest */
+  finished = g_async_queue_new ();
+  fallback_jobs = gsk_vulkan_render_pass_queue_fallbacks (self, finished);
 
   for (i = 0; i < self->render_ops->len; i++)
     {
@@ -891,7 +1027,9 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
         case GSK_VULKAN_OP_FALLBACK:
         case GSK_VULKAN_OP_FALLBACK_CLIP:
         case GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP:
-          gsk_vulkan_render_pass_upload_fallback (self, &op->render, render, uploader);
+          gsk_vulkan_render_pass_upload_fallback (self, &op->render, render, uploader,
+                                                  finished,
+                                                  fallback_jobs ? g_hash_table_lookup (fallback_jobs, &op->render) : NULL);
           break;
 
         case GSK_VULKAN_OP_TEXT:
@@ -906,10 +1044,10 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
 
         case GSK_VULKAN_OP_TEXTURE:
           {
-            op->render.source = gsk_vulkan_renderer_ref_texture_image (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
-                                                                       gsk_texture_node_get_texture (op->render.node),
-                                                                       uploader);
-            op->render.source_rect = GRAPHENE_RECT_INIT(0, 0, 1, 1);
+            op->render.source = gsk_vulkan_renderer_ref_texture_image_region (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
+                                                                              gsk_texture_node_get_texture (op->render.node),
+                                                                              uploader,
+                                                                              &op->render.source_rect);
             gsk_vulkan_render_add_cleanup_image (render, op->render.source);
           }
           break;
@@ -918,13 +1056,22 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           {
             GskRenderNode *child = gsk_opacity_node_get_child (op->render.node);
 
-            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
-                                                                            render,
-                                                                            uploader,
-                                                                            child,
-                                                                            &child->bounds,
-                                                                            clip,
-                                                                            &op->render.source_rect);
+            if (gsk_render_node_get_node_type (child) == GSK_TEXTURE_NODE)
+              {
+                op->render.source = gsk_vulkan_renderer_ref_texture_image_region (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
+                                                                                  gsk_texture_node_get_texture (child),
+                                                                                  uploader,
+                                                                                  &op->render.source_rect);
+                gsk_vulkan_render_add_cleanup_image (render, op->render.source);
+              }
+            else
+              op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                              render,
+                                                                              uploader,
+                                                                              child,
+                                                                              &child->bounds,
+                                                                              clip,
+                                                                              &op->render.source_rect);
           }
           break;
 
@@ -967,13 +1114,22 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           {
             GskRenderNode *child = gsk_color_matrix_node_get_child (op->render.node);
 
-            op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
-                                                                            render,
-                                                                            uploader,
-                                                                            child,
-                                                                            &child->bounds,
-                                                                            clip,
-                                                                            &op->render.source_rect);
+            if (gsk_render_node_get_node_type (child) == GSK_TEXTURE_NODE)
+              {
+                op->render.source = gsk_vulkan_renderer_ref_texture_image_region (GSK_VULKAN_RENDERER (gsk_vulkan_render_get_renderer (render)),
+                                                                                  gsk_texture_node_get_texture (child),
+                                                                                  uploader,
+                                                                                  &op->render.source_rect);
+                gsk_vulkan_render_add_cleanup_image (render, op->render.source);
+              }
+            else
+              op->render.source = gsk_vulkan_render_pass_get_node_as_texture (self,
+                                                                              render,
+                                                                              uploader,
+                                                                              child,
+                                                                              &child->bounds,
+                                                                              clip,
+                                                                              &op->render.source_rect);
           }
           break;
 
@@ -1055,6 +1211,10 @@ gsk_vulkan_render_pass_upload (GskVulkanRenderPass  *self,
           break;
         }
     }
+
+  /* Every queued job had its op uploaded above */
+  g_clear_pointer (&fallback_jobs, g_hash_table_unref);
+  g_async_queue_unref (finished);
 }
 
 static gsize
@@ -1201,6 +1361,7 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
                                                           gsk_text_node_peek_color (op->text.node),
                                                           gsk_text_node_get_offset (op->text.node),
                                                           op->text.start_glyph,
+                                                          op->text.start_x,
                                                           op->text.num_glyphs,
                                                           op->text.scale);
             n_bytes += op->text.vertex_count;
@@ -1219,6 +1380,7 @@ gsk_vulkan_render_pass_collect_vertex_data (GskVulkanRenderPass *self,
                                                                 gsk_text_node_peek_glyphs (op->text.node, NULL),
                                                                 gsk_text_node_get_offset (op->text.node),
                                                                 op->text.start_glyph,
+                                                                op->text.start_x,
                                                                 op->text.num_glyphs,
                                                                 op->text.scale);
             n_bytes += op->text.vertex_count;
@@ -1391,10 +1553,10 @@ gsk_vulkan_render_pass_get_vertex_data (GskVulkanRenderPass *self,
       guchar *data;
 
       n_bytes = gsk_vulkan_render_pass_count_vertex_data (self);
-      self->vertex_data = gsk_vulkan_buffer_new (self->vulkan, n_bytes);
-      data = gsk_vulkan_buffer_map (self->vertex_data);
+      self->vertex_data = gsk_vulkan_render_alloc_vertex_data (render, n_bytes,
+                                                               &self->vertex_offset,
+                                                               &data);
       gsk_vulkan_render_pass_collect_vertex_data (self, render, data, 0, n_bytes);
-      gsk_vulkan_buffer_unmap (self->vertex_data);
     }
 
   return self->vertex_data;
@@ -1473,6 +1635,52 @@ gsk_vulkan_render_pass_reserve_descriptor_sets (GskVulkanRenderPass *self,
     }
 }
 
+typedef struct {
+  VkPipelineLayout layout;
+  VkDescriptorSet sets[2];
+} BoundDescriptorSets;
+
+/* Descriptor sets stay bound across draws, so only bind them when
+ * they change. Most draws reuse the glyph cache or a texture atlas.
+ */
+static inline void
+bind_descriptor_sets (VkCommandBuffer      command_buffer,
+                      GskVulkanPipeline   *pipeline,
+                      BoundDescriptorSets *bound,
+                      VkDescriptorSet      set,
+                      VkDescriptorSet      set2)
+{
+  VkPipelineLayout layout = gsk_vulkan_pipeline_get_pipeline_layout (pipeline);
+
+  if (bound->layout == layout &&
+      bound->sets[0] == set &&
+      bound->sets[1] == set2)
+    return;
+
+  vkCmdBindDescriptorSets (command_buffer,
+                           VK_PIPELINE_BIND_POINT_GRAPHICS,
+                           layout,
+                           0,
+                           set2 != VK_NULL_HANDLE ? 2 : 1,
+                           (VkDescriptorSet[2]) { set, set2 },
+                           0,
+                           NULL);
+
+  bound->layout = layout;
+  bound->sets[0] = set;
+  bound->sets[1] = set2;
+}
+
+static inline gboolean
+op_is_texture (const GskVulkanOp *op)
+{
+  return op->type == GSK_VULKAN_OP_FALLBACK ||
+         op->type == GSK_VULKAN_OP_FALLBACK_CLIP ||
+         op->type == GSK_VULKAN_OP_FALLBACK_ROUNDED_CLIP ||
+         op->type == GSK_VULKAN_OP_TEXTURE ||
+         op->type == GSK_VULKAN_OP_REPEAT;
+}
+
 static void
 gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                   GskVulkanRender         *render,
@@ -1481,9 +1689,11 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                   VkCommandBuffer          command_buffer)
 {
   GskVulkanPipeline *current_pipeline = NULL;
+  BoundDescriptorSets bound = { VK_NULL_HANDLE, };
   gsize current_draw_index = 0;
   GskVulkanOp *op;
   guint i, step;
+  gsize num_glyphs;
   GskVulkanBuffer *vertex_buffer;
 
   vertex_buffer = gsk_vulkan_render_pass_get_vertex_data (self, render);
@@ -1514,24 +1724,28 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   1,
-                                   (VkDescriptorSet[1]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                VK_NULL_HANDLE);
 
+          /* Textures from the same image, like icons in an atlas,
+           * can be drawn with a single draw call */
+          for (step = 1; step + i < self->render_ops->len; step++)
+            {
+              GskVulkanOp *cmp = &g_array_index (self->render_ops, GskVulkanOp, i + step);
+              if (!op_is_texture (cmp) ||
+                  cmp->render.source == NULL ||
+                  cmp->render.pipeline != current_pipeline ||
+                  cmp->render.descriptor_set_index != op->render.descriptor_set_index)
+                break;
+            }
           current_draw_index += gsk_vulkan_texture_pipeline_draw (GSK_VULKAN_TEXTURE_PIPELINE (current_pipeline),
                                                                   command_buffer,
-                                                                  current_draw_index, 1);
+                                                                  current_draw_index, step);
           break;
 
         case GSK_VULKAN_OP_TEXT:
@@ -1547,24 +1761,27 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->text.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->text.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   1,
-                                   (VkDescriptorSet[1]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->text.descriptor_set_index)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->text.descriptor_set_index),
+                                VK_NULL_HANDLE);
 
+          num_glyphs = op->text.num_glyphs;
+          for (step = 1; step + i < self->render_ops->len; step++)
+            {
+              GskVulkanOp *cmp = &g_array_index (self->render_ops, GskVulkanOp, i + step);
+              if (cmp->type != GSK_VULKAN_OP_TEXT ||
+                  cmp->text.pipeline != current_pipeline ||
+                  cmp->text.descriptor_set_index != op->text.descriptor_set_index)
+                break;
+              num_glyphs += cmp->text.num_glyphs;
+            }
           current_draw_index += gsk_vulkan_text_pipeline_draw (GSK_VULKAN_TEXT_PIPELINE (current_pipeline),
                                                                command_buffer,
-                                                               current_draw_index, op->text.num_glyphs);
+                                                               current_draw_index, num_glyphs);
           break;
 
         case GSK_VULKAN_OP_COLOR_TEXT:
@@ -1580,24 +1797,27 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->text.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->text.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   1,
-                                   (VkDescriptorSet[1]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->text.descriptor_set_index)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->text.descriptor_set_index),
+                                VK_NULL_HANDLE);
 
+          num_glyphs = op->text.num_glyphs;
+          for (step = 1; step + i < self->render_ops->len; step++)
+            {
+              GskVulkanOp *cmp = &g_array_index (self->render_ops, GskVulkanOp, i + step);
+              if (cmp->type != GSK_VULKAN_OP_COLOR_TEXT ||
+                  cmp->text.pipeline != current_pipeline ||
+                  cmp->text.descriptor_set_index != op->text.descriptor_set_index)
+                break;
+              num_glyphs += cmp->text.num_glyphs;
+            }
           current_draw_index += gsk_vulkan_color_text_pipeline_draw (GSK_VULKAN_COLOR_TEXT_PIPELINE (current_pipeline),
                                                                      command_buffer,
-                                                                     current_draw_index, op->text.num_glyphs);
+                                                                     current_draw_index, num_glyphs);
           break;
 
         case GSK_VULKAN_OP_OPACITY:
@@ -1616,20 +1836,13 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   1,
-                                   (VkDescriptorSet[1]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                VK_NULL_HANDLE);
 
           current_draw_index += gsk_vulkan_effect_pipeline_draw (GSK_VULKAN_EFFECT_PIPELINE (current_pipeline),
                                                                  command_buffer,
@@ -1651,20 +1864,13 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   1,
-                                   (VkDescriptorSet[1]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                VK_NULL_HANDLE);
 
           current_draw_index += gsk_vulkan_blur_pipeline_draw (GSK_VULKAN_BLUR_PIPELINE (current_pipeline),
                                                                command_buffer,
@@ -1684,7 +1890,7 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
@@ -1713,7 +1919,7 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
           current_draw_index += gsk_vulkan_linear_gradient_pipeline_draw (GSK_VULKAN_LINEAR_GRADIENT_PIPELINE (current_pipeline),
@@ -1734,7 +1940,7 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
           current_draw_index += gsk_vulkan_border_pipeline_draw (GSK_VULKAN_BORDER_PIPELINE (current_pipeline),
@@ -1756,7 +1962,7 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
           current_draw_index += gsk_vulkan_box_shadow_pipeline_draw (GSK_VULKAN_BOX_SHADOW_PIPELINE (current_pipeline),
@@ -1786,21 +1992,13 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   2,
-                                   (VkDescriptorSet[2]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2));
 
           current_draw_index += gsk_vulkan_cross_fade_pipeline_draw (GSK_VULKAN_CROSS_FADE_PIPELINE (current_pipeline),
                                                                      command_buffer,
@@ -1822,21 +2020,13 @@ gsk_vulkan_render_pass_draw_rect (GskVulkanRenderPass     *self,
                                       (VkBuffer[1]) {
                                           gsk_vulkan_buffer_get_buffer (vertex_buffer)
                                       },
-                                      (VkDeviceSize[1]) { op->render.vertex_offset });
+                                      (VkDeviceSize[1]) { self->vertex_offset + op->render.vertex_offset });
               current_draw_index = 0;
             }
 
-          vkCmdBindDescriptorSets (command_buffer,
-                                   VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                   gsk_vulkan_pipeline_get_pipeline_layout (current_pipeline),
-                                   0,
-                                   2,
-                                   (VkDescriptorSet[2]) {
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
-                                       gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2)
-                                   },
-                                   0,
-                                   NULL);
+          bind_descriptor_sets (command_buffer, current_pipeline, &bound,
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index),
+                                gsk_vulkan_render_get_descriptor_set (render, op->render.descriptor_set_index2));
 
           current_draw_index += gsk_vulkan_blend_mode_pipeline_draw (GSK_VULKAN_BLEND_MODE_PIPELINE (current_pipeline),
                                                                      command_buffer,
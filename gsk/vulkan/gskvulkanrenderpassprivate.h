@@ -23,7 +23,8 @@ void                    gsk_vulkan_render_pass_free                     (GskVulk
 
 void                    gsk_vulkan_render_pass_add                      (GskVulkanRenderPass    *self,
                                                                          GskVulkanRender        *render,
-                                                                         GskRenderNode          *node);
+                                                                         GskRenderNode          *node,
+                                                                         const graphene_rect_t  *damage);
 
 void                    gsk_vulkan_render_pass_upload                   (GskVulkanRenderPass    *self,
                                                                          GskVulkanRender        *render,
@@ -4,6 +4,7 @@
 #include <gdk/gdk.h>
 #include <gsk/gskrendernode.h>
 
+#include "gskvulkanbufferprivate.h"
 #include "gskvulkanimageprivate.h"
 #include "gskvulkanpipelineprivate.h"
 #include "gskvulkanrenderpassprivate.h"
@@ -11,6 +12,8 @@
 
 G_BEGIN_DECLS
 
+#define GSK_VULKAN_MAX_FRAMES_IN_FLIGHT 4
+
 typedef enum {
   GSK_VULKAN_PIPELINE_TEXTURE,
   GSK_VULKAN_PIPELINE_TEXTURE_CLIP,
@@ -57,6 +60,8 @@ GskVulkanRender *       gsk_vulkan_render_new                           (GskRend
 void                    gsk_vulkan_render_free                          (GskVulkanRender        *self);
 
 gboolean                gsk_vulkan_render_is_busy                       (GskVulkanRender        *self);
+void                    gsk_vulkan_render_set_frames_in_flight          (GskVulkanRender        *self,
+                                                                         guint                   n_frames);
 void                    gsk_vulkan_render_reset                         (GskVulkanRender        *self,
                                                                          GskVulkanImage         *target,
                                                                          const graphene_rect_t  *rect,
@@ -75,8 +80,17 @@ void                    gsk_vulkan_render_add_render_pass               (GskVulk
 
 void                    gsk_vulkan_render_upload                        (GskVulkanRender        *self);
 
+GskVulkanBuffer *       gsk_vulkan_render_alloc_vertex_data             (GskVulkanRender        *self,
+                                                                         gsize                   size,
+                                                                         gsize                  *offset,
+                                                                         guchar                **data);
+
 GskVulkanPipeline *     gsk_vulkan_render_get_pipeline                  (GskVulkanRender        *self,
                                                                          GskVulkanPipelineType   pipeline_type);
+GskVulkanPipeline *     gsk_vulkan_render_peek_pipeline                 (GskVulkanRender        *self,
+                                                                         GskVulkanPipelineType   pipeline_type);
+void                    gsk_vulkan_render_set_async_pipelines           (GskVulkanRender        *self,
+                                                                         gboolean                async_pipelines);
 VkDescriptorSet         gsk_vulkan_render_get_descriptor_set            (GskVulkanRender        *self,
                                                                          gsize                   id);
 gsize                   gsk_vulkan_render_reserve_descriptor_set        (GskVulkanRender        *self,
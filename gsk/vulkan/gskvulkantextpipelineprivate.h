@@ -31,6 +31,7 @@ void                    gsk_vulkan_text_pipeline_collect_vertex_data   (GskVulka
                                                                         const GdkRGBA                  *color,
                                                                         const graphene_point_t         *offset,
                                                                         guint                           start_glyph,
+                                                                        int                             start_x,
                                                                         guint                           num_glyphs,
                                                                         float                           scale);
 gsize                   gsk_vulkan_text_pipeline_draw                  (GskVulkanTextPipeline         *pipeline,
@@ -35,8 +35,18 @@ struct _GtkCssTokenizer
   const char            *end;
 
   GtkCssLocation         position;
+
+  /* only set for precompiled data, see gtk_css_tokenizer_precompile() */
+  const char            *strings;
+  gsize                  strings_len;
+  guint                  precompiled : 1;
 };
 
+/* Magic marker and version of precompiled token streams */
+#define PRECOMPILED_MAGIC "GCS\0"
+#define PRECOMPILED_MAGIC_LEN 4
+#define PRECOMPILED_VERSION 1
+
 void
 gtk_css_token_clear (GtkCssToken *token)
 {
@@ -540,6 +550,12 @@ gtk_css_tokenizer_new (GBytes *bytes)
 
   gtk_css_location_init (&tokenizer->position);
 
+  if (gtk_css_tokenizer_is_precompiled (bytes))
+    {
+      tokenizer->precompiled = TRUE;
+      tokenizer->data += PRECOMPILED_MAGIC_LEN;
+    }
+
   return tokenizer;
 }
 
@@ -790,12 +806,75 @@ gtk_css_tokenizer_consume_char (GtkCssTokenizer *tokenizer,
     }
 }
 
+/* Comment bodies, strings and names are mostly long runs of plain
+ * ASCII. These are skipped in one go, a word at a time where possible,
+ * instead of going through gtk_css_tokenizer_consume_char() for every
+ * byte. A run ends at newlines, non-ASCII and the given stop bytes.
+ */
+#define ONE_BYTES  G_GUINT64_CONSTANT (0x0101010101010101)
+#define HIGH_BYTES G_GUINT64_CONSTANT (0x8080808080808080)
+
+static inline guint64
+word_has_byte (guint64 word,
+               guchar  c)
+{
+  guint64 v = word ^ (ONE_BYTES * c);
+
+  return (v - ONE_BYTES) & ~v & HIGH_BYTES;
+}
+
+static gsize
+gtk_css_tokenizer_scan_ascii (GtkCssTokenizer *tokenizer,
+                              char             stop1,
+                              char             stop2)
+{
+  const char *p = tokenizer->data;
+
+  while ((gsize) (tokenizer->end - p) >= sizeof (guint64))
+    {
+      guint64 word;
+
+      memcpy (&word, p, sizeof (word));
+
+      if ((word & HIGH_BYTES) ||
+          word_has_byte (word, '\n') ||
+          word_has_byte (word, '\r') ||
+          word_has_byte (word, '\f') ||
+          word_has_byte (word, stop1) ||
+          word_has_byte (word, stop2))
+        break;
+
+      p += sizeof (guint64);
+    }
+
+  while (p < tokenizer->end &&
+         !is_multibyte (*p) &&
+         !is_newline (*p) &&
+         *p != stop1 &&
+         *p != stop2)
+    p++;
+
+  return p - tokenizer->data;
+}
+
 static void
 gtk_css_tokenizer_read_whitespace (GtkCssTokenizer *tokenizer,
                                    GtkCssToken     *token)
 {
   do {
-    gtk_css_tokenizer_consume_whitespace (tokenizer);
+    if (is_newline (*tokenizer->data))
+      {
+        gtk_css_tokenizer_consume_newline (tokenizer);
+      }
+    else
+      {
+        const char *p = tokenizer->data;
+
+        while (p < tokenizer->end && (*p == ' ' || *p == '\t'))
+          p++;
+
+        gtk_css_tokenizer_consume (tokenizer, p - tokenizer->data, p - tokenizer->data);
+      }
   } while (tokenizer->data != tokenizer->end &&
            is_whitespace (*tokenizer->data));
 
@@ -843,7 +922,25 @@ gtk_css_tokenizer_read_escape (GtkCssTokenizer *tokenizer)
 static char *
 gtk_css_tokenizer_read_name (GtkCssTokenizer *tokenizer)
 {
-  GString *string = g_string_new (NULL);
+  const char *p = tokenizer->data;
+  GString *string;
+  gsize n;
+
+  /* Most names are plain ASCII without escapes, copy those directly */
+  while (p < tokenizer->end && is_name (*p) && !is_multibyte (*p))
+    p++;
+
+  n = p - tokenizer->data;
+  if (p == tokenizer->end || (*p != '\\' && !is_multibyte (*p)))
+    {
+      char *name = g_strndup (tokenizer->data, n);
+
+      gtk_css_tokenizer_consume (tokenizer, n, n);
+      return name;
+    }
+
+  string = g_string_new_len (tokenizer->data, n);
+  gtk_css_tokenizer_consume (tokenizer, n, n);
 
   do {
       if (*tokenizer->data == '\\')
@@ -1191,7 +1288,15 @@ gtk_css_tokenizer_read_string (GtkCssTokenizer  *tokenizer,
         }
       else
         {
-          gtk_css_tokenizer_consume_char (tokenizer, string);
+          gsize n = gtk_css_tokenizer_scan_ascii (tokenizer, end, '\\');
+
+          if (n > 0)
+            {
+              g_string_append_len (string, tokenizer->data, n);
+              gtk_css_tokenizer_consume (tokenizer, n, n);
+            }
+          else
+            gtk_css_tokenizer_consume_char (tokenizer, string);
         }
     }
   
@@ -1209,6 +1314,14 @@ gtk_css_tokenizer_read_comment (GtkCssTokenizer  *tokenizer,
 
   while (tokenizer->data < tokenizer->end)
     {
+      gsize n = gtk_css_tokenizer_scan_ascii (tokenizer, '*', '*');
+
+      if (n > 0)
+        {
+          gtk_css_tokenizer_consume (tokenizer, n, n);
+          continue;
+        }
+
       if (gtk_css_tokenizer_remaining (tokenizer) > 1 &&
           tokenizer->data[0] == '*' && tokenizer->data[1] == '/')
         {
@@ -1240,11 +1353,233 @@ gtk_css_tokenizer_read_match (GtkCssTokenizer *tokenizer,
     }
 }
 
+/* Replaying precompiled token streams, see gtk_css_tokenizer_precompile()
+ * for the format. The data may come from untrusted files, so everything
+ * is bounds-checked and a corrupt stream ends in an EOF token.
+ */
+static gboolean
+gtk_css_tokenizer_replay_uint32 (GtkCssTokenizer *tokenizer,
+                                 guint32         *value)
+{
+  const guchar *p = (const guchar *) tokenizer->data;
+  gsize remaining = gtk_css_tokenizer_remaining (tokenizer);
+  gsize len;
+
+  if (remaining == 0)
+    return FALSE;
+
+  if (p[0] < 0x80)
+    len = 1;
+  else if ((p[0] & 0xc0) == 0x80)
+    len = 2;
+  else if ((p[0] & 0xe0) == 0xc0)
+    len = 3;
+  else if ((p[0] & 0xf0) == 0xe0)
+    len = 4;
+  else
+    len = 5;
+
+  if (remaining < len)
+    return FALSE;
+
+  switch (len)
+    {
+    case 1:
+      *value = p[0];
+      break;
+    case 2:
+      *value = (p[0] & 0x3f) << 8 | p[1];
+      break;
+    case 3:
+      *value = (p[0] & 0x1f) << 16 | p[1] << 8 | p[2];
+      break;
+    case 4:
+      *value = (guint32) (p[0] & 0xf) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+      break;
+    default:
+      *value = (guint32) p[1] << 24 | p[2] << 16 | p[3] << 8 | p[4];
+      break;
+    }
+
+  tokenizer->data += len;
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_double (GtkCssTokenizer *tokenizer,
+                                 double          *value)
+{
+  guint64 bits;
+
+  if (gtk_css_tokenizer_remaining (tokenizer) < sizeof (bits))
+    return FALSE;
+
+  memcpy (&bits, tokenizer->data, sizeof (bits));
+  bits = GUINT64_FROM_BE (bits);
+  memcpy (value, &bits, sizeof (bits));
+
+  tokenizer->data += sizeof (bits);
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_string (GtkCssTokenizer  *tokenizer,
+                                 char            **value)
+{
+  guint32 offset;
+
+  if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &offset) ||
+      offset >= tokenizer->strings_len)
+    return FALSE;
+
+  *value = g_strdup (tokenizer->strings + offset);
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_header (GtkCssTokenizer *tokenizer)
+{
+  guint32 version, strings_len;
+
+  if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &version) ||
+      version != PRECOMPILED_VERSION ||
+      !gtk_css_tokenizer_replay_uint32 (tokenizer, &strings_len) ||
+      strings_len == 0 ||
+      gtk_css_tokenizer_remaining (tokenizer) < strings_len ||
+      tokenizer->data[strings_len - 1] != '\0')
+    return FALSE;
+
+  tokenizer->strings = tokenizer->data;
+  tokenizer->strings_len = strings_len;
+  tokenizer->data += strings_len;
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_location (GtkCssTokenizer *tokenizer)
+{
+  GtkCssLocation *position = &tokenizer->position;
+  guint32 bytes, chars, lines, line_bytes, line_chars;
+
+  if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &bytes) ||
+      !gtk_css_tokenizer_replay_uint32 (tokenizer, &chars) ||
+      !gtk_css_tokenizer_replay_uint32 (tokenizer, &lines))
+    return FALSE;
+
+  if (lines > 0)
+    {
+      if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &line_bytes) ||
+          !gtk_css_tokenizer_replay_uint32 (tokenizer, &line_chars))
+        return FALSE;
+
+      position->lines += lines;
+      position->line_bytes = line_bytes;
+      position->line_chars = line_chars;
+    }
+  else
+    {
+      position->line_bytes += bytes;
+      position->line_chars += chars;
+    }
+
+  position->bytes += bytes;
+  position->chars += chars;
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_tokenizer_replay_token (GtkCssTokenizer  *tokenizer,
+                                GtkCssToken      *token,
+                                GError          **error)
+{
+  guint32 type, delim;
+  double number;
+  char *string;
+
+  if (tokenizer->data == tokenizer->end)
+    {
+      gtk_css_token_init (token, GTK_CSS_TOKEN_EOF);
+      return TRUE;
+    }
+
+  if (tokenizer->strings == NULL &&
+      !gtk_css_tokenizer_replay_header (tokenizer))
+    goto corrupt;
+
+  if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &type) ||
+      type == GTK_CSS_TOKEN_EOF ||
+      type > GTK_CSS_TOKEN_DIMENSION)
+    goto corrupt;
+
+  switch (type)
+    {
+    case GTK_CSS_TOKEN_STRING:
+    case GTK_CSS_TOKEN_IDENT:
+    case GTK_CSS_TOKEN_FUNCTION:
+    case GTK_CSS_TOKEN_AT_KEYWORD:
+    case GTK_CSS_TOKEN_HASH_UNRESTRICTED:
+    case GTK_CSS_TOKEN_HASH_ID:
+    case GTK_CSS_TOKEN_URL:
+      if (!gtk_css_tokenizer_replay_string (tokenizer, &string))
+        goto corrupt;
+      gtk_css_token_init (token, type, string);
+      break;
+
+    case GTK_CSS_TOKEN_DELIM:
+      if (!gtk_css_tokenizer_replay_uint32 (tokenizer, &delim))
+        goto corrupt;
+      gtk_css_token_init (token, type, (gunichar) delim);
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER:
+    case GTK_CSS_TOKEN_SIGNED_NUMBER:
+    case GTK_CSS_TOKEN_SIGNLESS_NUMBER:
+    case GTK_CSS_TOKEN_PERCENTAGE:
+      if (!gtk_css_tokenizer_replay_double (tokenizer, &number))
+        goto corrupt;
+      gtk_css_token_init (token, type, number);
+      break;
+
+    case GTK_CSS_TOKEN_SIGNED_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_SIGNLESS_INTEGER_DIMENSION:
+    case GTK_CSS_TOKEN_DIMENSION:
+      if (!gtk_css_tokenizer_replay_double (tokenizer, &number) ||
+          !gtk_css_tokenizer_replay_string (tokenizer, &string))
+        goto corrupt;
+      gtk_css_token_init (token, type, number, string);
+      break;
+
+    default:
+      gtk_css_token_init (token, type);
+      break;
+    }
+
+  if (!gtk_css_tokenizer_replay_location (tokenizer))
+    {
+      gtk_css_token_clear (token);
+      goto corrupt;
+    }
+
+  return TRUE;
+
+corrupt:
+  tokenizer->data = tokenizer->end;
+  gtk_css_token_init (token, GTK_CSS_TOKEN_EOF);
+  gtk_css_tokenizer_parse_error (error, "Precompiled CSS data is corrupt or has an unsupported version");
+  return FALSE;
+}
+
 gboolean
 gtk_css_tokenizer_read_token (GtkCssTokenizer  *tokenizer,
                               GtkCssToken      *token,
                               GError          **error)
 {
+  if (tokenizer->precompiled)
+    return gtk_css_tokenizer_replay_token (tokenizer, token, error);
+
   if (tokenizer->data == tokenizer->end)
     {
       gtk_css_token_init (token, GTK_CSS_TOKEN_EOF);
@@ -1442,3 +1777,219 @@ gtk_css_tokenizer_read_token (GtkCssTokenizer  *tokenizer,
     }
 }
 
+
+/**
+ * gtk_css_tokenizer_is_precompiled:
+ * @bytes: the data to check
+ *
+ * Checks if @bytes contains a token stream created by
+ * gtk_css_tokenizer_precompile().
+ *
+ * Returns: %TRUE if @bytes is precompiled
+ **/
+gboolean
+gtk_css_tokenizer_is_precompiled (GBytes *bytes)
+{
+  gsize size;
+  const char *data = g_bytes_get_data (bytes, &size);
+
+  return size >= PRECOMPILED_MAGIC_LEN &&
+         memcmp (data, PRECOMPILED_MAGIC, PRECOMPILED_MAGIC_LEN) == 0;
+}
+
+static void
+marshal_uint32 (GString *str,
+                guint32  v)
+{
+  /* Same variable length encoding as the GtkBuilder precompiler */
+  if (v < 128)
+    {
+      g_string_append_c (str, (guchar)v);
+    }
+  else if (v < (1<<14))
+    {
+      g_string_append_c (str, (guchar)(v >> 8) | 0x80);
+      g_string_append_c (str, (guchar)(v & 0xff));
+    }
+  else if (v < (1<<21))
+    {
+      g_string_append_c (str, (guchar)(v >> 16) | 0xc0);
+      g_string_append_c (str, (guchar)((v >> 8) & 0xff));
+      g_string_append_c (str, (guchar)(v & 0xff));
+    }
+  else if (v < (1<<28))
+    {
+      g_string_append_c (str, (guchar)(v >> 24) | 0xe0);
+      g_string_append_c (str, (guchar)((v >> 16) & 0xff));
+      g_string_append_c (str, (guchar)((v >> 8) & 0xff));
+      g_string_append_c (str, (guchar)(v & 0xff));
+    }
+  else
+    {
+      g_string_append_c (str, 0xf0);
+      g_string_append_c (str, (guchar)((v >> 24) & 0xff));
+      g_string_append_c (str, (guchar)((v >> 16) & 0xff));
+      g_string_append_c (str, (guchar)((v >> 8) & 0xff));
+      g_string_append_c (str, (guchar)(v & 0xff));
+    }
+}
+
+static void
+marshal_double (GString *str,
+                double   d)
+{
+  guint64 bits;
+
+  memcpy (&bits, &d, sizeof (bits));
+  bits = GUINT64_TO_BE (bits);
+  g_string_append_len (str, (const char *) &bits, sizeof (bits));
+}
+
+static void
+marshal_string (GString    *str,
+                GHashTable *offsets,
+                GString    *strings,
+                const char *string)
+{
+  gpointer offset;
+
+  if (!g_hash_table_lookup_extended (offsets, string, NULL, &offset))
+    {
+      offset = GSIZE_TO_POINTER (strings->len);
+      g_string_append_len (strings, string, strlen (string) + 1);
+      g_hash_table_insert (offsets, g_strdup (string), offset);
+    }
+
+  marshal_uint32 (str, GPOINTER_TO_SIZE (offset));
+}
+
+static void
+marshal_location (GString              *str,
+                  const GtkCssLocation *start,
+                  const GtkCssLocation *end)
+{
+  marshal_uint32 (str, end->bytes - start->bytes);
+  marshal_uint32 (str, end->chars - start->chars);
+  marshal_uint32 (str, end->lines - start->lines);
+
+  if (end->lines != start->lines)
+    {
+      marshal_uint32 (str, end->line_bytes);
+      marshal_uint32 (str, end->line_chars);
+    }
+}
+
+/**
+ * gtk_css_tokenizer_precompile:
+ * @bytes: CSS text
+ * @error: return location for an error
+ *
+ * Tokenizes @bytes and stores the result in a compact binary form
+ * that gtk_css_tokenizer_new() detects and replays without having
+ * to tokenize the text again. Token locations are kept, so errors
+ * and #GtkCssSection<!-- -->s still refer to the original text.
+ *
+ * The data starts with the magic marker, the format version and
+ * the string table. Every string is stored once, so repeated
+ * identifiers like property names cost only a table offset. It is
+ * followed by one record per token: the type, the token's value and
+ * the location of the token's end relative to its start.
+ *
+ * If @bytes is already precompiled, it is returned unchanged.
+ *
+ * Returns: (nullable): the precompiled data or %NULL if @bytes
+ *     could not be tokenized
+ **/
+GBytes *
+gtk_css_tokenizer_precompile (GBytes  *bytes,
+                              GError **error)
+{
+  GtkCssTokenizer *tokenizer;
+  GHashTable *offsets;
+  GString *strings, *tokens, *result;
+  GtkCssLocation start;
+  GtkCssToken token;
+
+  if (gtk_css_tokenizer_is_precompiled (bytes))
+    return g_bytes_ref (bytes);
+
+  tokenizer = gtk_css_tokenizer_new (bytes);
+  offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  /* Never empty, so the replay can rely on a terminating NUL */
+  strings = g_string_new_len ("", 1);
+  tokens = g_string_new (NULL);
+
+  while (TRUE)
+    {
+      start = tokenizer->position;
+
+      if (!gtk_css_tokenizer_read_token (tokenizer, &token, error))
+        {
+          g_prefix_error (error, "%" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT ": ",
+                          start.lines + 1, start.line_chars + 1);
+          gtk_css_token_clear (&token);
+          g_string_free (tokens, TRUE);
+          g_string_free (strings, TRUE);
+          g_hash_table_unref (offsets);
+          gtk_css_tokenizer_unref (tokenizer);
+          return NULL;
+        }
+
+      if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+        break;
+
+      marshal_uint32 (tokens, token.type);
+
+      switch (token.type)
+        {
+        case GTK_CSS_TOKEN_STRING:
+        case GTK_CSS_TOKEN_IDENT:
+        case GTK_CSS_TOKEN_FUNCTION:
+        case GTK_CSS_TOKEN_AT_KEYWORD:
+        case GTK_CSS_TOKEN_HASH_UNRESTRICTED:
+        case GTK_CSS_TOKEN_HASH_ID:
+        case GTK_CSS_TOKEN_URL:
+          marshal_string (tokens, offsets, strings, token.string.string);
+          break;
+
+        case GTK_CSS_TOKEN_DELIM:
+          marshal_uint32 (tokens, token.delim.delim);
+          break;
+
+        case GTK_CSS_TOKEN_SIGNED_INTEGER:
+        case GTK_CSS_TOKEN_SIGNLESS_INTEGER:
+        case GTK_CSS_TOKEN_SIGNED_NUMBER:
+        case GTK_CSS_TOKEN_SIGNLESS_NUMBER:
+        case GTK_CSS_TOKEN_PERCENTAGE:
+          marshal_double (tokens, token.number.number);
+          break;
+
+        case GTK_CSS_TOKEN_SIGNED_INTEGER_DIMENSION:
+        case GTK_CSS_TOKEN_SIGNLESS_INTEGER_DIMENSION:
+        case GTK_CSS_TOKEN_DIMENSION:
+          marshal_double (tokens, token.dimension.value);
+          marshal_string (tokens, offsets, strings, token.dimension.dimension);
+          break;
+
+        default:
+          break;
+        }
+
+      marshal_location (tokens, &start, &tokenizer->position);
+      gtk_css_token_clear (&token);
+    }
+
+  result = g_string_sized_new (PRECOMPILED_MAGIC_LEN + 10 + strings->len + tokens->len);
+  g_string_append_len (result, PRECOMPILED_MAGIC, PRECOMPILED_MAGIC_LEN);
+  marshal_uint32 (result, PRECOMPILED_VERSION);
+  marshal_uint32 (result, strings->len);
+  g_string_append_len (result, strings->str, strings->len);
+  g_string_append_len (result, tokens->str, tokens->len);
+
+  g_string_free (tokens, TRUE);
+  g_string_free (strings, TRUE);
+  g_hash_table_unref (offsets);
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return g_string_free_to_bytes (result);
+}
@@ -25,18 +25,69 @@
 #include "gtkbitmaskprivate.h"
 #include "gtkenums.h"
 
+#include <string.h>
+
+/* Only the attributes in @attributes_set have a slot in @attribute_values,
+ * ordered by attribute; everything else reads from the defaults, which are
+ * shared by all the sets using the same @default_func.
+ */
 struct _GtkAccessibleAttributeSet
 {
   gsize n_attributes;
 
   GtkAccessibleAttributeDefaultFunc default_func;
+  GtkAccessibleValue **default_values;
 
   GtkBitmask *attributes_set;
 
-  char **attribute_names;
+  const char **attribute_names;
   GtkAccessibleValue **attribute_values;
+  guint n_values;
 };
 
+static GHashTable *default_values_cache;
+
+static GtkAccessibleValue **
+get_default_values (gsize                              n_attributes,
+                    GtkAccessibleAttributeDefaultFunc  default_func)
+{
+  GtkAccessibleValue **values;
+
+  if (G_UNLIKELY (default_values_cache == NULL))
+    default_values_cache = g_hash_table_new (NULL, NULL);
+
+  values = g_hash_table_lookup (default_values_cache, default_func);
+  if (values == NULL)
+    {
+      values = g_new (GtkAccessibleValue *, n_attributes);
+
+      for (gsize i = 0; i < n_attributes; i++)
+        values[i] = (* default_func) (i);
+
+      g_hash_table_insert (default_values_cache, default_func, values);
+    }
+
+  return values;
+}
+
+/* Returns the position of @attribute in attribute_values, which
+ * is the number of attributes in the set that come before it
+ */
+static guint
+gtk_accessible_attribute_set_get_slot (GtkAccessibleAttributeSet *self,
+                                       int                        attribute)
+{
+  guint slot = 0;
+
+  for (int i = 0; i < attribute; i++)
+    {
+      if (_gtk_bitmask_get (self->attributes_set, i))
+        slot++;
+    }
+
+  return slot;
+}
+
 static GtkAccessibleAttributeSet *
 gtk_accessible_attribute_set_init (GtkAccessibleAttributeSet          *self,
                                    gsize                               n_attributes,
@@ -45,20 +96,28 @@ gtk_accessible_attribute_set_init (GtkAccessibleAttributeSet          *self,
 {
   self->n_attributes = n_attributes;
   self->default_func = default_func;
-  self->attribute_names = g_new (char *, n_attributes);
-  self->attribute_values = g_new (GtkAccessibleValue *, n_attributes);
+  self->default_values = get_default_values (n_attributes, default_func);
+  self->attribute_names = attribute_names;
+  self->attribute_values = NULL;
+  self->n_values = 0;
   self->attributes_set = _gtk_bitmask_new ();
 
-  /* Initialize all attribute values, so we can always get the full attribute */
-  for (int i = 0; i < self->n_attributes; i++)
-    {
-      self->attribute_names[i] = g_strdup (attribute_names[i]);
-      self->attribute_values[i] = (* self->default_func) (i);
-    }
-
   return self;
 }
 
+/*< private >
+ * gtk_accessible_attribute_set_new:
+ * @n_attributes: the number of attributes
+ * @attribute_names: (array length=n_attributes): the names of the attributes
+ * @default_func: the function returning the default value of an attribute
+ *
+ * Creates a new, empty #GtkAccessibleAttributeSet.
+ *
+ * @attribute_names is not copied, and must stay valid for the lifetime
+ * of the set.
+ *
+ * Returns: (transfer full): the newly created #GtkAccessibleAttributeSet
+ */
 GtkAccessibleAttributeSet *
 gtk_accessible_attribute_set_new (gsize                               n_attributes,
                                   const char                        **attribute_names,
@@ -82,15 +141,9 @@ gtk_accessible_attribute_set_free (gpointer data)
 {
   GtkAccessibleAttributeSet *self = data;
 
-  for (int i = 0; i < self->n_attributes; i++)
-    {
-      g_free (self->attribute_names[i]);
+  for (guint i = 0; i < self->n_values; i++)
+    gtk_accessible_value_unref (self->attribute_values[i]);
 
-      if (self->attribute_values[i] != NULL)
-        gtk_accessible_value_unref (self->attribute_values[i]);
-    }
-
-  g_free (self->attribute_names);
   g_free (self->attribute_values);
 
   _gtk_bitmask_free (self->attributes_set);
@@ -122,11 +175,13 @@ gtk_accessible_attribute_set_add (GtkAccessibleAttributeSet *self,
                                   int                        attribute,
                                   GtkAccessibleValue        *value)
 {
+  guint slot;
+
   g_return_val_if_fail (attribute >= 0 && attribute < self->n_attributes, FALSE);
 
   if (value != NULL)
     {
-      if (gtk_accessible_value_equal (value, self->attribute_values[attribute]))
+      if (gtk_accessible_value_equal (value, gtk_accessible_attribute_set_get_value (self, attribute)))
         return FALSE;
     }
   else
@@ -135,12 +190,26 @@ gtk_accessible_attribute_set_add (GtkAccessibleAttributeSet *self,
         return FALSE;
     }
 
-  g_clear_pointer (&(self->attribute_values[attribute]), gtk_accessible_value_unref);
-
   if (value != NULL)
-    self->attribute_values[attribute] = gtk_accessible_value_ref (value);
+    gtk_accessible_value_ref (value);
   else
-    self->attribute_values[attribute] = (* self->default_func) (attribute);
+    value = gtk_accessible_value_ref (self->default_values[attribute]);
+
+  slot = gtk_accessible_attribute_set_get_slot (self, attribute);
+
+  if (_gtk_bitmask_get (self->attributes_set, attribute))
+    {
+      gtk_accessible_value_unref (self->attribute_values[slot]);
+      self->attribute_values[slot] = value;
+      return TRUE;
+    }
+
+  self->attribute_values = g_renew (GtkAccessibleValue *, self->attribute_values, self->n_values + 1);
+  memmove (&self->attribute_values[slot + 1],
+           &self->attribute_values[slot],
+           (self->n_values - slot) * sizeof (GtkAccessibleValue *));
+  self->attribute_values[slot] = value;
+  self->n_values += 1;
 
   self->attributes_set = _gtk_bitmask_set (self->attributes_set, attribute, TRUE);
 
@@ -160,14 +229,24 @@ gboolean
 gtk_accessible_attribute_set_remove (GtkAccessibleAttributeSet *self,
                                      int                        attribute)
 {
+  guint slot;
+
   g_return_val_if_fail (attribute >= 0 && attribute < self->n_attributes, FALSE);
 
   if (!_gtk_bitmask_get (self->attributes_set, attribute))
     return FALSE;
 
-  g_clear_pointer (&(self->attribute_values[attribute]), gtk_accessible_value_unref);
+  slot = gtk_accessible_attribute_set_get_slot (self, attribute);
+
+  gtk_accessible_value_unref (self->attribute_values[slot]);
+  memmove (&self->attribute_values[slot],
+           &self->attribute_values[slot + 1],
+           (self->n_values - slot - 1) * sizeof (GtkAccessibleValue *));
+  self->n_values -= 1;
+
+  if (self->n_values == 0)
+    g_clear_pointer (&self->attribute_values, g_free);
 
-  self->attribute_values[attribute] = (* self->default_func) (attribute);
   self->attributes_set = _gtk_bitmask_set (self->attributes_set, attribute, FALSE);
 
   return TRUE;
@@ -197,7 +276,10 @@ gtk_accessible_attribute_set_get_value (GtkAccessibleAttributeSet *self,
 {
   g_return_val_if_fail (attribute >= 0 && attribute < self->n_attributes, NULL);
 
-  return self->attribute_values[attribute];
+  if (!_gtk_bitmask_get (self->attributes_set, attribute))
+    return self->default_values[attribute];
+
+  return self->attribute_values[gtk_accessible_attribute_set_get_slot (self, attribute)];
 }
 
 gsize
@@ -250,7 +332,7 @@ gtk_accessible_attribute_set_print (GtkAccessibleAttributeSet *self,
       g_string_append (buffer, self->attribute_names[i]);
       g_string_append (buffer, ": ");
 
-      gtk_accessible_value_print (self->attribute_values[i], buffer);
+      gtk_accessible_value_print (gtk_accessible_attribute_set_get_value (self, i), buffer);
 
       g_string_append (buffer, ",\n");
     }
@@ -161,6 +161,10 @@ struct _GtkActionMuxer
   GtkAccels primary_accels;
 
   GtkBitmask *widget_actions_disabled;
+
+  /* action name => ResolvedAction, valid for resolved_generation */
+  GHashTable *resolved_actions;
+  guint resolved_generation;
 };
 
 G_DEFINE_TYPE_WITH_CODE (GtkActionMuxer, gtk_action_muxer, G_TYPE_OBJECT,
@@ -192,6 +196,29 @@ typedef struct
   gulong        handler_ids[4];
 } Group;
 
+/* Where an action name was found when looking it up from a muxer,
+ * through its parents.
+ */
+typedef struct
+{
+  GtkActionMuxer  *muxer;  /* %NULL if the action was not found */
+  GtkWidgetAction *action; /* set for class actions of muxer's widget */
+  Group           *group;  /* set for actions of one of muxer's groups */
+} ResolvedAction;
+
+/* Bumped whenever the result of resolving a name may change, ie
+ * when groups, their actions or parents of any muxer change. This
+ * is rare compared to lookups, so we don't bother with tracking the
+ * affected muxers.
+ */
+static guint resolve_generation = 1;
+
+static inline void
+gtk_action_muxer_invalidate_resolved (void)
+{
+  resolve_generation++;
+}
+
 static inline guint
 get_action_position (GtkWidgetAction *action)
 {
@@ -311,6 +338,83 @@ gtk_action_muxer_find (GtkActionMuxer  *muxer,
   return NULL;
 }
 
+static gboolean
+gtk_action_muxer_resolve_local (GtkActionMuxer *muxer,
+                                const char     *action_name,
+                                ResolvedAction *resolved)
+{
+  resolved->muxer = muxer;
+  resolved->action = NULL;
+  resolved->group = NULL;
+
+  if (muxer->widget)
+    {
+      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
+      GtkWidgetClassPrivate *priv = klass->priv;
+      GtkWidgetAction *action;
+
+      for (action = priv->actions; action; action = action->next)
+        {
+          if (strcmp (action->name, action_name) == 0)
+            {
+              resolved->action = action;
+              return TRUE;
+            }
+        }
+    }
+
+  resolved->group = gtk_action_muxer_find_group (muxer, action_name, NULL);
+  if (resolved->group)
+    return TRUE;
+
+  resolved->muxer = NULL;
+  return FALSE;
+}
+
+static gboolean
+gtk_action_muxer_resolve (GtkActionMuxer *muxer,
+                          const char     *action_name,
+                          ResolvedAction *resolved)
+{
+  ResolvedAction *cached;
+  GtkActionMuxer *m;
+
+  if (muxer->resolved_actions == NULL)
+    muxer->resolved_actions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  else if (muxer->resolved_generation != resolve_generation)
+    g_hash_table_remove_all (muxer->resolved_actions);
+
+  muxer->resolved_generation = resolve_generation;
+
+  cached = g_hash_table_lookup (muxer->resolved_actions, action_name);
+
+  /* Groups emit ::action-removed before the action is gone, so a
+   * lookup from a handler may have cached it. Double-check.
+   */
+  if (cached != NULL &&
+      (cached->group == NULL ||
+       g_action_group_has_action (cached->group->group, strchr (action_name, '.') + 1)))
+    {
+      *resolved = *cached;
+      return resolved->muxer != NULL;
+    }
+
+  if (cached == NULL)
+    {
+      cached = g_new (ResolvedAction, 1);
+      g_hash_table_insert (muxer->resolved_actions, g_strdup (action_name), cached);
+    }
+
+  for (m = muxer; m != NULL; m = m->parent)
+    {
+      if (gtk_action_muxer_resolve_local (m, action_name, cached))
+        break;
+    }
+
+  *resolved = *cached;
+  return resolved->muxer != NULL;
+}
+
 static inline Action *
 find_observers (GtkActionMuxer *muxer,
                 const char     *action_name)
@@ -507,6 +611,8 @@ gtk_action_muxer_action_added_to_group (GActionGroup *action_group,
   GVariant *state;
   char *fullname;
 
+  gtk_action_muxer_invalidate_resolved ();
+
   fullname = g_strconcat (group->prefix, ".", action_name, NULL);
 
    if (muxer->parent)
@@ -551,6 +657,8 @@ gtk_action_muxer_action_removed_from_group (GActionGroup *action_group,
   char *fullname;
   Action *action;
 
+  gtk_action_muxer_invalidate_resolved ();
+
   fullname = g_strconcat (group->prefix, ".", action_name, NULL);
   gtk_action_muxer_action_removed (muxer, fullname);
   g_free (fullname);
@@ -727,60 +835,52 @@ action_muxer_query_action (GtkActionMuxer      *muxer,
                            GVariant           **state,
                            gboolean             recurse)
 {
-  GtkWidgetAction *action;
-  Group *group;
-  const char *unprefixed_name;
+  ResolvedAction resolved;
 
-  if (muxer->widget)
+  if (recurse)
     {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
+      if (!gtk_action_muxer_resolve (muxer, action_name, &resolved))
+        return FALSE;
+    }
+  else
+    {
+      if (!gtk_action_muxer_resolve_local (muxer, action_name, &resolved))
+        return FALSE;
+    }
 
-      for (action = priv->actions; action; action = action->next)
-        {
-          guint position;
+  if (resolved.action)
+    {
+      GtkWidgetAction *action = resolved.action;
+      guint position;
 
-          if (strcmp (action->name, action_name) != 0)
-            continue;
+      muxer = resolved.muxer;
+      position = get_action_position (action);
 
-          position = get_action_position (action);
+      if (enabled)
+        *enabled = !_gtk_bitmask_get (muxer->widget_actions_disabled, position);
+      if (parameter_type)
+        *parameter_type = action->parameter_type;
+      if (state_type)
+        *state_type = action->state_type;
 
-          if (enabled)
-            *enabled = !_gtk_bitmask_get (muxer->widget_actions_disabled, position);
-          if (parameter_type)
-            *parameter_type = action->parameter_type;
-          if (state_type)
-            *state_type = action->state_type;
+      if (state_hint)
+        *state_hint = NULL;
+      if (state)
+        *state = NULL;
 
-          if (state_hint)
-            *state_hint = NULL;
+      if (action->pspec)
+        {
           if (state)
-            *state = NULL;
-
-          if (action->pspec)
-            {
-              if (state)
-                *state = prop_action_get_state (muxer->widget, action);
-              if (state_hint)
-                *state_hint = prop_action_get_state_hint (muxer->widget, action);
-            }
-
-          return TRUE;
+            *state = prop_action_get_state (muxer->widget, action);
+          if (state_hint)
+            *state_hint = prop_action_get_state_hint (muxer->widget, action);
         }
-    }
-
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
-
-  if (group)
-    return g_action_group_query_action (group->group, unprefixed_name, enabled,
-                                        parameter_type, state_type, state_hint, state);
 
-  if (muxer->parent && recurse)
-    return gtk_action_muxer_query_action (muxer->parent, action_name,
-                                          enabled, parameter_type,
-                                          state_type, state_hint, state);
+      return TRUE;
+    }
 
-  return FALSE;
+  return g_action_group_query_action (resolved.group->group, strchr (action_name, '.') + 1,
+                                      enabled, parameter_type, state_type, state_hint, state);
 }
 
 gboolean
@@ -812,40 +912,28 @@ gtk_action_muxer_activate_action (GtkActionMuxer *muxer,
                                   const char     *action_name,
                                   GVariant       *parameter)
 {
-  const char *unprefixed_name;
-  Group *group;
+  ResolvedAction resolved;
 
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
-      GtkWidgetAction *action;
+  if (!gtk_action_muxer_resolve (muxer, action_name, &resolved))
+    return;
 
-      for (action = priv->actions; action; action = action->next)
-        {
-          if (strcmp (action->name, action_name) == 0)
-            {
-              guint position = get_action_position (action);
+  if (resolved.action)
+    {
+      GtkWidgetAction *action = resolved.action;
+      guint position = get_action_position (action);
 
-              if (!_gtk_bitmask_get (muxer->widget_actions_disabled, position))
-                {
-                  if (action->activate)
-                    action->activate (muxer->widget, action->name, parameter);
-                  else if (action->pspec)
-                    prop_action_activate (muxer->widget, action, parameter);
-                }
+      muxer = resolved.muxer;
 
-              return;
-            }
+      if (!_gtk_bitmask_get (muxer->widget_actions_disabled, position))
+        {
+          if (action->activate)
+            action->activate (muxer->widget, action->name, parameter);
+          else if (action->pspec)
+            prop_action_activate (muxer->widget, action, parameter);
         }
     }
-
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
-
-  if (group)
-    g_action_group_activate_action (group->group, unprefixed_name, parameter);
-  else if (muxer->parent)
-    gtk_action_muxer_activate_action (muxer->parent, action_name, parameter);
+  else
+    g_action_group_activate_action (resolved.group->group, strchr (action_name, '.') + 1, parameter);
 }
 
 void
@@ -853,33 +941,18 @@ gtk_action_muxer_change_action_state (GtkActionMuxer *muxer,
                                       const char     *action_name,
                                       GVariant       *state)
 {
-  GtkWidgetAction *action;
-  const char *unprefixed_name;
-  Group *group;
-
-  if (muxer->widget)
-    {
-      GtkWidgetClass *klass = GTK_WIDGET_GET_CLASS (muxer->widget);
-      GtkWidgetClassPrivate *priv = klass->priv;
+  ResolvedAction resolved;
 
-      for (action = priv->actions; action; action = action->next)
-        {
-          if (strcmp (action->name, action_name) == 0)
-            {
-              if (action->pspec)
-                prop_action_set_state (muxer->widget, action, state);
+  if (!gtk_action_muxer_resolve (muxer, action_name, &resolved))
+    return;
 
-              return;
-            }
-        }
+  if (resolved.action)
+    {
+      if (resolved.action->pspec)
+        prop_action_set_state (resolved.muxer->widget, resolved.action, state);
     }
-
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
-
-  if (group)
-    g_action_group_change_action_state (group->group, unprefixed_name, state);
-  else if (muxer->parent)
-    gtk_action_muxer_change_action_state (muxer->parent, action_name, state);
+  else
+    g_action_group_change_action_state (resolved.group->group, strchr (action_name, '.') + 1, state);
 }
 
 static void
@@ -925,6 +998,7 @@ gtk_action_muxer_register_observer (GtkActionObservable *observable,
 {
   GtkActionMuxer *muxer = GTK_ACTION_MUXER (observable);
   Action *action;
+  gboolean is_new;
   gboolean enabled;
   const GVariantType *parameter_type;
   GVariant *state;
@@ -933,8 +1007,9 @@ gtk_action_muxer_register_observer (GtkActionObservable *observable,
     muxer->observed_actions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, gtk_action_muxer_free_action);
 
   action = g_hash_table_lookup (muxer->observed_actions, name);
+  is_new = action == NULL;
 
-  if (action == NULL)
+  if (is_new)
     {
       action = g_slice_new (Action);
       action->muxer = muxer;
@@ -947,27 +1022,27 @@ gtk_action_muxer_register_observer (GtkActionObservable *observable,
   action->watchers = g_slist_prepend (action->watchers, observer);
   g_object_weak_ref (G_OBJECT (observer), gtk_action_muxer_weak_notify, action);
 
-  if (action_muxer_query_action (muxer, name,
-                                 &enabled, &parameter_type,
-                                 NULL, NULL, &state, FALSE))
-    {
-      gtk_action_muxer_action_added (muxer, name, parameter_type, enabled, state);
-      g_clear_pointer (&state, g_variant_unref);
-    }
-  else if (muxer->parent)
+  if (is_new && muxer->parent &&
+      !action_muxer_query_action (muxer, name,
+                                  NULL, NULL, NULL, NULL, NULL, FALSE))
     {
-      if (action_muxer_query_action (muxer->parent, name,
-                                     &enabled, &parameter_type,
-                                     NULL, NULL, &state, FALSE))
-        {
-          gtk_action_muxer_action_added (muxer, name, parameter_type, enabled, state);
-          g_clear_pointer (&state, g_variant_unref);
-        }
-
+      /* All observers of an action share a single registration
+       * with the parent. It tells us about the action right away,
+       * which we forward to the observer.
+       */
       gtk_action_observable_register_observer (GTK_ACTION_OBSERVABLE (muxer->parent),
                                                name,
                                                GTK_ACTION_OBSERVER (muxer));
     }
+  else if (action_muxer_query_action (muxer, name,
+                                      &enabled, &parameter_type,
+                                      NULL, NULL, &state, TRUE))
+    {
+      /* Only tell the new observer, the others already know */
+      gtk_action_observer_action_added (observer, observable,
+                                        name, parameter_type, enabled, state);
+      g_clear_pointer (&state, g_variant_unref);
+    }
 }
 
 static void
@@ -1029,6 +1104,8 @@ gtk_action_muxer_finalize (GObject *object)
     }
   if (muxer->groups)
     g_hash_table_unref (muxer->groups);
+  if (muxer->resolved_actions)
+    g_hash_table_unref (muxer->resolved_actions);
 
   gtk_accels_clear (&muxer->primary_accels);
 
@@ -1047,6 +1124,7 @@ gtk_action_muxer_dispose (GObject *object)
     g_hash_table_remove_all (muxer->observed_actions);
 
   muxer->widget = NULL;
+  gtk_action_muxer_invalidate_resolved ();
 
   G_OBJECT_CLASS (gtk_action_muxer_parent_class)->dispose (object);
 }
@@ -1244,6 +1322,7 @@ gtk_action_muxer_insert (GtkActionMuxer *muxer,
   group->prefix = g_strdup (prefix);
 
   g_hash_table_insert (muxer->groups, group->prefix, group);
+  gtk_action_muxer_invalidate_resolved ();
 
   actions = g_action_group_list_actions (group->group);
   for (i = 0; actions[i]; i++)
@@ -1287,6 +1366,7 @@ gtk_action_muxer_remove (GtkActionMuxer *muxer,
       int i;
 
       g_hash_table_steal (muxer->groups, prefix);
+      gtk_action_muxer_invalidate_resolved ();
 
       actions = g_action_group_list_actions (group->group);
       for (i = 0; actions[i]; i++)
@@ -1349,6 +1429,7 @@ gtk_action_muxer_set_parent (GtkActionMuxer *muxer,
     }
 
   muxer->parent = parent;
+  gtk_action_muxer_invalidate_resolved ();
 
   if (muxer->parent != NULL)
     {
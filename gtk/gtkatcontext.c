@@ -39,6 +39,8 @@
 #include "gtktestatcontextprivate.h"
 #include "gtktypebuiltins.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 G_DEFINE_ABSTRACT_TYPE (GtkATContext, gtk_at_context, G_TYPE_OBJECT)
 
 enum
@@ -60,11 +62,19 @@ static GParamSpec *obj_props[N_PROPS];
 
 static guint obj_signals[LAST_SIGNAL];
 
+/* Contexts with accumulated changes, flushed together once per frame */
+static GSList *pending_contexts;
+static guint pending_contexts_id;
+static guint updates_counter;
+
 static void
 gtk_at_context_finalize (GObject *gobject)
 {
   GtkATContext *self = GTK_AT_CONTEXT (gobject);
 
+  if (self->update_queued)
+    pending_contexts = g_slist_remove (pending_contexts, self);
+
   gtk_accessible_attribute_set_unref (self->properties);
   gtk_accessible_attribute_set_unref (self->relations);
   gtk_accessible_attribute_set_unref (self->states);
@@ -138,6 +148,8 @@ gtk_at_context_class_init (GtkATContextClass *klass)
   gobject_class->get_property = gtk_at_context_get_property;
   gobject_class->finalize = gtk_at_context_finalize;
 
+  updates_counter = gdk_profiler_define_int_counter ("a11y-updates", "Accessibility Updates Per Frame");
+
   klass->state_change = gtk_at_context_real_state_change;
 
   /**
@@ -405,17 +417,10 @@ gtk_at_context_create (GtkAccessibleRole  accessible_role,
   return gtk_test_at_context_new (accessible_role, accessible);
 }
 
-/*< private >
- * gtk_at_context_update:
- * @self: a #GtkATContext
- *
- * Notifies the AT connected to this #GtkATContext that the accessible
- * state and its properties have changed.
- */
-void
-gtk_at_context_update (GtkATContext *self)
+static void
+gtk_at_context_flush (GtkATContext *self)
 {
-  g_return_if_fail (GTK_IS_AT_CONTEXT (self));
+  self->update_queued = FALSE;
 
   /* There's no point in notifying of state changes if there weren't any */
   if (self->updated_properties == 0 &&
@@ -440,6 +445,68 @@ gtk_at_context_update (GtkATContext *self)
   self->updated_states = 0;
 }
 
+static gboolean
+gtk_at_context_flush_pending (gpointer data)
+{
+  guint n_updates = 0;
+
+  pending_contexts_id = 0;
+
+  /* Contexts queued while flushing are handled in this same pass */
+  while (pending_contexts != NULL)
+    {
+      GtkATContext *self = pending_contexts->data;
+
+      pending_contexts = g_slist_delete_link (pending_contexts, pending_contexts);
+
+      g_object_ref (self);
+      gtk_at_context_flush (self);
+      g_object_unref (self);
+
+      n_updates++;
+    }
+
+  if (GDK_PROFILER_IS_RUNNING)
+    gdk_profiler_set_int_counter (updates_counter, n_updates);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*< private >
+ * gtk_at_context_update:
+ * @self: a #GtkATContext
+ *
+ * Notifies the AT connected to this #GtkATContext that the accessible
+ * state and its properties have changed.
+ *
+ * The notification is deferred, so that all the changes made to a
+ * #GtkATContext during a frame are delivered in a single batch.
+ */
+void
+gtk_at_context_update (GtkATContext *self)
+{
+  g_return_if_fail (GTK_IS_AT_CONTEXT (self));
+
+  if (self->update_queued)
+    return;
+
+  if (self->updated_properties == 0 &&
+      self->updated_relations == 0 &&
+      self->updated_states == 0)
+    return;
+
+  self->update_queued = TRUE;
+  pending_contexts = g_slist_prepend (pending_contexts, self);
+
+  if (pending_contexts_id == 0)
+    {
+      pending_contexts_id = g_idle_add_full (GDK_PRIORITY_REDRAW + 10,
+                                             gtk_at_context_flush_pending,
+                                             NULL, NULL);
+      g_source_set_name_by_id (pending_contexts_id, "[gtk] gtk_at_context_flush_pending");
+    }
+}
+
 /*< private >
  * gtk_at_context_set_accessible_state:
  * @self: a #GtkATContext
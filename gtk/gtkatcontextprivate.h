@@ -94,6 +94,8 @@ struct _GtkATContext
   GtkAccessibleStateChange updated_states;
   GtkAccessiblePropertyChange updated_properties;
   GtkAccessibleRelationChange updated_relations;
+
+  guint update_queued : 1;
 };
 
 struct _GtkATContextClass
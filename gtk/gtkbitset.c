@@ -19,7 +19,7 @@
 
 #include "config.h"
 
-#include "gtkbitset.h"
+#include "gtkbitsetprivate.h"
 
 #include "roaring/roaring.c"
 
@@ -61,6 +61,115 @@ G_DEFINE_BOXED_TYPE (GtkBitset, gtk_bitset,
                      gtk_bitset_ref,
                      gtk_bitset_unref)
 
+/* Returns the last value of the run of consecutive values
+ * starting at @low in @container, which must contain @low.
+ */
+static guint16
+container_get_run_end (const void *container,
+                       uint8_t     typecode,
+                       guint16     low)
+{
+  switch (typecode)
+    {
+    case BITSET_CONTAINER_TYPE_CODE:
+      {
+        const uint64_t *words = ((const bitset_container_t *) container)->array;
+        guint i = low / 64;
+        uint64_t word = ~words[i] & (UINT64_MAX << (low % 64));
+
+        while (word == 0)
+          {
+            if (++i == BITSET_CONTAINER_SIZE_IN_WORDS)
+              return 0xFFFF;
+            word = ~words[i];
+          }
+
+        return i * 64 + __builtin_ctzll (word) - 1;
+      }
+
+    case ARRAY_CONTAINER_TYPE_CODE:
+      {
+        const array_container_t *array = container;
+        int32_t first, lo, hi;
+
+        /* values are consecutive exactly as long as value - index stays the same */
+        first = binarySearch (array->array, array->cardinality, low);
+        g_assert (first >= 0);
+        lo = first;
+        hi = array->cardinality - 1;
+        while (lo < hi)
+          {
+            int32_t mid = (lo + hi + 1) / 2;
+
+            if (array->array[mid] - mid == low - first)
+              lo = mid;
+            else
+              hi = mid - 1;
+          }
+
+        return array->array[lo];
+      }
+
+    case RUN_CONTAINER_TYPE_CODE:
+      {
+        const run_container_t *run = container;
+        int32_t i;
+
+        i = rle16_find_run (run->runs, run->n_runs, low);
+        g_assert (i >= 0);
+
+        return run->runs[i].value + run->runs[i].length;
+      }
+
+    default:
+      g_assert_not_reached ();
+      return low;
+    }
+}
+
+/* Returns the last value of the run of consecutive values in @self
+ * that starts at @value, which must be part of @self.
+ */
+static guint
+gtk_bitset_get_run_end (const GtkBitset *self,
+                        guint            value)
+{
+  const roaring_array_t *ra = &self->roaring.high_low_container;
+  guint key, end;
+  int32_t i;
+
+  key = value >> 16;
+  i = ra_get_index (ra, key);
+  g_assert (i >= 0);
+
+  for (;;)
+    {
+      const void *container;
+      uint8_t typecode;
+
+      typecode = ra->typecodes[i];
+      container = container_unwrap_shared (ra->containers[i], &typecode);
+      end = container_get_run_end (container, typecode, value & 0xFFFF);
+      if (end < 0xFFFF || key == 0xFFFF)
+        break;
+
+      /* the run continues if the next container starts with 0 */
+      i++;
+      key++;
+      if (i >= ra->size || ra->keys[i] != key)
+        break;
+
+      typecode = ra->typecodes[i];
+      container = container_unwrap_shared (ra->containers[i], &typecode);
+      if (!container_contains (container, 0, typecode))
+        break;
+
+      value = key << 16;
+    }
+
+  return (value & ~0xFFFFu) | end;
+}
+
 /**
  * gtk_bitset_ref:
  * @self: (allow-none): a #GtkBitset
@@ -648,8 +757,7 @@ gtk_bitset_shift_left (GtkBitset *self,
                        guint      amount)
 {
   GtkBitset *original;
-  GtkBitsetIter iter;
-  guint value;
+  guint first, last;
   gboolean loop;
 
   g_return_if_fail (self != NULL);
@@ -660,11 +768,11 @@ gtk_bitset_shift_left (GtkBitset *self,
   original = gtk_bitset_copy (self);
   gtk_bitset_remove_all (self);
 
-  for (loop = gtk_bitset_iter_init_at (&iter, original, amount, &value);
+  for (loop = gtk_bitset_find_range (original, amount, &first, &last);
        loop;
-       loop = gtk_bitset_iter_next (&iter, &value))
+       loop = last < G_MAXUINT && gtk_bitset_find_range (original, last + 1, &first, &last))
     {
-      gtk_bitset_add (self, value - amount);
+      gtk_bitset_add_range_closed (self, first - amount, last - amount);
     }
 
   gtk_bitset_unref (original);
@@ -683,8 +791,7 @@ gtk_bitset_shift_right (GtkBitset *self,
                         guint      amount)
 {
   GtkBitset *original;
-  GtkBitsetIter iter;
-  guint value;
+  guint first, last;
   gboolean loop;
 
   g_return_if_fail (self != NULL);
@@ -695,11 +802,11 @@ gtk_bitset_shift_right (GtkBitset *self,
   original = gtk_bitset_copy (self);
   gtk_bitset_remove_all (self);
 
-  for (loop = gtk_bitset_iter_init_first (&iter, original, &value);
-       loop && value <= G_MAXUINT - amount;
-       loop = gtk_bitset_iter_next (&iter, &value))
+  for (loop = gtk_bitset_find_range (original, 0, &first, &last);
+       loop && first <= G_MAXUINT - amount;
+       loop = last < G_MAXUINT && gtk_bitset_find_range (original, last + 1, &first, &last))
     {
-      gtk_bitset_add (self, value + amount);
+      gtk_bitset_add_range_closed (self, first + amount, MIN (last, G_MAXUINT - amount) + amount);
     }
 
   gtk_bitset_unref (original);
@@ -955,3 +1062,43 @@ gtk_bitset_iter_is_valid (const GtkBitsetIter *iter)
 
   return riter->has_value;
 }
+
+/*<private>
+ * gtk_bitset_find_range:
+ * @self: a #GtkBitset
+ * @from: the value to start looking at
+ * @first: (out): set to the first value of the range
+ * @last: (out): set to the last value of the range
+ *
+ * Finds the first range of consecutive values in @self that are
+ * larger or equal to @from. This allows iterating over a set
+ * without having to look at every single value:
+ *
+ * |[
+ *   for (more = gtk_bitset_find_range (set, 0, &first, &last);
+ *        more;
+ *        more = last < G_MAXUINT && gtk_bitset_find_range (set, last + 1, &first, &last))
+ *     ...
+ * ]|
+ *
+ * Returns: %TRUE if a range was found
+ **/
+gboolean
+gtk_bitset_find_range (const GtkBitset *self,
+                       guint            from,
+                       guint           *first,
+                       guint           *last)
+{
+  roaring_uint32_iterator_t riter;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+
+  roaring_init_iterator (&self->roaring, &riter);
+  if (!roaring_move_uint32_iterator_equalorlarger (&riter, from))
+    return FALSE;
+
+  *first = riter.current_value;
+  *last = gtk_bitset_get_run_end (self, riter.current_value);
+
+  return TRUE;
+}
@@ -523,6 +523,124 @@ object_properties_get_value (const ObjectProperties *self,
   return &g_array_index (self->values, GValue, idx);
 }
 
+#define MAX_CACHED_VALUES 1024
+
+typedef struct
+{
+  GType type;
+  char *string;
+  GValue value;
+} CachedValue;
+
+static guint
+cached_value_hash (gconstpointer data)
+{
+  const CachedValue *cached = data;
+
+  return g_str_hash (cached->string) ^ (guint) cached->type;
+}
+
+static gboolean
+cached_value_equal (gconstpointer a,
+                    gconstpointer b)
+{
+  const CachedValue *ca = a;
+  const CachedValue *cb = b;
+
+  return ca->type == cb->type && strcmp (ca->string, cb->string) == 0;
+}
+
+static void
+cached_value_free (gpointer data)
+{
+  CachedValue *cached = data;
+
+  g_free (cached->string);
+  g_value_unset (&cached->value);
+  g_slice_free (CachedValue, cached);
+}
+
+/* Only values whose conversion depends on nothing but the string */
+static gboolean
+value_type_is_cacheable (GParamSpec *pspec)
+{
+  if (G_IS_PARAM_SPEC_UNICHAR (pspec))
+    return FALSE;
+
+  switch (G_TYPE_FUNDAMENTAL (G_PARAM_SPEC_VALUE_TYPE (pspec)))
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+/* Instantiating the same template many times converts the same
+ * strings over and over, so remember the results of the conversions
+ * that are pure functions of the string. Parsing enums and flags in
+ * particular is expensive.
+ */
+static gboolean
+gtk_builder_value_from_string_cached (GtkBuilder  *builder,
+                                      GParamSpec  *pspec,
+                                      const char  *string,
+                                      GValue      *value,
+                                      GError     **error)
+{
+  static GHashTable *value_cache = NULL;
+  CachedValue key, *cached;
+
+  if (!value_type_is_cacheable (pspec))
+    return gtk_builder_value_from_string (builder, pspec, string, value, error);
+
+  if (value_cache == NULL)
+    value_cache = g_hash_table_new_full (cached_value_hash, cached_value_equal,
+                                         cached_value_free, NULL);
+
+  key.type = G_PARAM_SPEC_VALUE_TYPE (pspec);
+  key.string = (char *) string;
+
+  cached = g_hash_table_lookup (value_cache, &key);
+  if (cached == NULL)
+    {
+      GValue converted = G_VALUE_INIT;
+
+      if (!gtk_builder_value_from_string (builder, pspec, string, &converted, error))
+        {
+          if (G_IS_VALUE (&converted))
+            g_value_unset (&converted);
+          return FALSE;
+        }
+
+      if (g_hash_table_size (value_cache) >= MAX_CACHED_VALUES)
+        g_hash_table_remove_all (value_cache);
+
+      cached = g_slice_new0 (CachedValue);
+      cached->type = key.type;
+      cached->string = g_strdup (string);
+      cached->value = converted;
+      g_hash_table_add (value_cache, cached);
+    }
+
+  g_value_init (value, G_VALUE_TYPE (&cached->value));
+  g_value_copy (&cached->value, value);
+
+  return TRUE;
+}
+
 static void
 gtk_builder_get_parameters (GtkBuilder         *builder,
                             GType               object_type,
@@ -596,10 +714,10 @@ gtk_builder_get_parameters (GtkBuilder         *builder,
               continue;
             }
         }
-      else if (!gtk_builder_value_from_string (builder, prop->pspec,
-                                               prop->text->str,
-                                               &property_value,
-                                               &error))
+      else if (!gtk_builder_value_from_string_cached (builder, prop->pspec,
+                                                      prop->text->str,
+                                                      &property_value,
+                                                      &error))
         {
           g_warning ("Failed to set property %s.%s to %s: %s",
                      g_type_name (object_type), prop->pspec->name, prop->text->str,
@@ -1358,6 +1476,51 @@ gtk_builder_extend_with_template (GtkBuilder   *builder,
   return TRUE;
 }
 
+/*
+ * Like gtk_builder_extend_with_template(), but with a template that
+ * was already decoded, for callers that instantiate it many times.
+ */
+gboolean
+_gtk_builder_extend_with_precompiled_template (GtkBuilder              *builder,
+                                               GObject                 *object,
+                                               GType                    template_type,
+                                               GtkBuildablePrecompiled *precompiled,
+                                               GError                 **error)
+{
+  GtkBuilderPrivate *priv = gtk_builder_get_instance_private (builder);
+  GError *tmp_error;
+  char *filename;
+
+  g_return_val_if_fail (GTK_IS_BUILDER (builder), 0);
+  g_return_val_if_fail (G_IS_OBJECT (object), 0);
+  g_return_val_if_fail (g_type_name (template_type) != NULL, 0);
+  g_return_val_if_fail (g_type_is_a (G_OBJECT_TYPE (object), template_type), 0);
+  g_return_val_if_fail (precompiled != NULL, 0);
+
+  tmp_error = NULL;
+
+  g_free (priv->filename);
+  g_free (priv->resource_prefix);
+  priv->filename = g_strdup (".");
+  priv->resource_prefix = NULL;
+  priv->template_type = template_type;
+
+  filename = g_strconcat ("<", g_type_name (template_type), " template>", NULL);
+  gtk_builder_expose_object (builder, g_type_name (template_type), object);
+  _gtk_builder_parser_parse_precompiled (builder, filename,
+                                         precompiled,
+                                         &tmp_error);
+  g_free (filename);
+
+  if (tmp_error != NULL)
+    {
+      g_propagate_error (error, tmp_error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 /**
  * gtk_builder_add_from_resource:
  * @builder: a #GtkBuilder
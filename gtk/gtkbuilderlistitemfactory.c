@@ -63,6 +63,7 @@ struct _GtkBuilderListItemFactory
   GtkBuilderScope *scope;
   GBytes *bytes;
   GBytes *data;
+  GtkBuildablePrecompiled *precompiled;
   char *resource;
 };
 
@@ -101,10 +102,14 @@ gtk_builder_list_item_factory_setup (GtkListItemFactory *factory,
   if (self->scope)
     gtk_builder_set_scope (builder, self->scope);
 
-  if (!gtk_builder_extend_with_template (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
-                                         (const char *)g_bytes_get_data (self->data, NULL),
-                                         g_bytes_get_size (self->data),
-                                         &error))
+  if (self->precompiled
+      ? !_gtk_builder_extend_with_precompiled_template (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
+                                                        self->precompiled,
+                                                        &error)
+      : !gtk_builder_extend_with_template (builder, G_OBJECT (list_item), G_OBJECT_TYPE (list_item),
+                                           (const char *)g_bytes_get_data (self->data, NULL),
+                                           g_bytes_get_size (self->data),
+                                           &error))
     {
       g_critical ("Error building template for list item: %s", error->message);
       g_error_free (error);
@@ -181,6 +186,14 @@ gtk_builder_list_item_factory_set_bytes (GtkBuilderListItemFactory *self,
           self->data = data;
         }
     }
+  else
+    {
+      self->data = g_bytes_ref (bytes);
+    }
+
+  /* Every row instantiates the template, so only decode it once */
+  if (_gtk_buildable_parser_is_precompiled (g_bytes_get_data (self->data, NULL), g_bytes_get_size (self->data)))
+    self->precompiled = _gtk_buildable_precompiled_new (self->data);
 
   return TRUE;
 }
@@ -242,6 +255,7 @@ gtk_builder_list_item_factory_finalize (GObject *object)
   g_clear_object (&self->scope);
   g_bytes_unref (self->bytes);
   g_bytes_unref (self->data);
+  g_clear_pointer (&self->precompiled, _gtk_buildable_precompiled_free);
   g_free (self->resource);
 
   G_OBJECT_CLASS (gtk_builder_list_item_factory_parent_class)->finalize (object);
@@ -843,6 +843,73 @@ free_child_info (ChildInfo *info)
   g_slice_free (ChildInfo, info);
 }
 
+typedef struct {
+  GType type;
+  char *name;
+} PropertyKey;
+
+static guint
+property_key_hash (gconstpointer data)
+{
+  const PropertyKey *key = data;
+
+  return g_str_hash (key->name) ^ (guint) key->type;
+}
+
+static gboolean
+property_key_equal (gconstpointer a,
+                    gconstpointer b)
+{
+  const PropertyKey *ka = a;
+  const PropertyKey *kb = b;
+
+  return ka->type == kb->type && strcmp (ka->name, kb->name) == 0;
+}
+
+static void
+property_key_free (gpointer data)
+{
+  PropertyKey *key = data;
+
+  g_free (key->name);
+  g_slice_free (PropertyKey, key);
+}
+
+/* Looking a property up in the param spec pool takes a lock and
+ * walks up the type hierarchy, and templates that are instantiated
+ * many times look up the same properties every time.
+ */
+static GParamSpec *
+builder_find_property (GObjectClass *oclass,
+                       const char   *name)
+{
+  static GHashTable *pspec_cache = NULL;
+  PropertyKey key, *new_key;
+  GParamSpec *pspec;
+
+  if (pspec_cache == NULL)
+    pspec_cache = g_hash_table_new_full (property_key_hash, property_key_equal,
+                                         property_key_free, NULL);
+
+  key.type = G_OBJECT_CLASS_TYPE (oclass);
+  key.name = (char *) name;
+
+  pspec = g_hash_table_lookup (pspec_cache, &key);
+  if (pspec)
+    return pspec;
+
+  pspec = g_object_class_find_property (oclass, name);
+  if (pspec)
+    {
+      new_key = g_slice_new (PropertyKey);
+      new_key->type = key.type;
+      new_key->name = g_strdup (name);
+      g_hash_table_insert (pspec_cache, new_key, pspec);
+    }
+
+  return pspec;
+}
+
 static void
 parse_property (ParserData   *data,
                 const char   *element_name,
@@ -885,7 +952,7 @@ parse_property (ParserData   *data,
       return;
     }
 
-  pspec = g_object_class_find_property (object_info->oclass, name);
+  pspec = builder_find_property (object_info->oclass, name);
 
   if (!pspec)
     {
@@ -977,7 +1044,7 @@ parse_binding (ParserData   *data,
       return;
     }
 
-  pspec = g_object_class_find_property (object_info->oclass, name);
+  pspec = builder_find_property (object_info->oclass, name);
 
   if (!pspec)
     {
@@ -2157,13 +2224,14 @@ static const GtkBuildableParser parser = {
   NULL,
 };
 
-void
-_gtk_builder_parser_parse_buffer (GtkBuilder   *builder,
-                                  const char   *filename,
-                                  const char   *buffer,
-                                  gssize        length,
-                                  const char  **requested_objs,
-                                  GError      **error)
+static void
+parse_buffer_or_precompiled (GtkBuilder              *builder,
+                             const char              *filename,
+                             const char              *buffer,
+                             gssize                   length,
+                             GtkBuildablePrecompiled *precompiled,
+                             const char             **requested_objs,
+                             GError                 **error)
 {
   const char * domain;
   ParserData data;
@@ -2197,8 +2265,16 @@ _gtk_builder_parser_parse_buffer (GtkBuilder   *builder,
 
   gtk_buildable_parse_context_init (&data.ctx, &parser, &data);
 
-  if (!gtk_buildable_parse_context_parse (&data.ctx, buffer, length, error))
-    goto out;
+  if (precompiled)
+    {
+      if (!_gtk_buildable_parser_replay_decoded (&data.ctx, precompiled, error))
+        goto out;
+    }
+  else
+    {
+      if (!gtk_buildable_parse_context_parse (&data.ctx, buffer, length, error))
+        goto out;
+    }
 
   if (_gtk_builder_lookup_failed (builder, error))
     goto out;
@@ -2253,3 +2329,23 @@ _gtk_builder_parser_parse_buffer (GtkBuilder   *builder,
         }
     }
 }
+
+void
+_gtk_builder_parser_parse_buffer (GtkBuilder   *builder,
+                                  const char   *filename,
+                                  const char   *buffer,
+                                  gssize        length,
+                                  const char  **requested_objs,
+                                  GError      **error)
+{
+  parse_buffer_or_precompiled (builder, filename, buffer, length, NULL, requested_objs, error);
+}
+
+void
+_gtk_builder_parser_parse_precompiled (GtkBuilder              *builder,
+                                       const char              *filename,
+                                       GtkBuildablePrecompiled *precompiled,
+                                       GError                 **error)
+{
+  parse_buffer_or_precompiled (builder, filename, NULL, 0, precompiled, NULL, error);
+}
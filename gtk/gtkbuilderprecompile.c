@@ -416,6 +416,31 @@ propagate_error (GtkBuildableParseContext *context,
   g_propagate_error (dest, src);
 }
 
+static gboolean
+emit_start_element (GtkBuildableParseContext *context,
+                    const char *element_name,
+                    const char **attr_names,
+                    const char **attr_values,
+                    GError **error)
+{
+  GError *tmp_error = NULL;
+
+  (* context->internal_callbacks->start_element) (NULL,
+                                                  element_name,
+                                                  attr_names,
+                                                  attr_values,
+                                                  context,
+                                                  &tmp_error);
+
+  if (tmp_error)
+    {
+      propagate_error (context, error, tmp_error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
 static gboolean
 replay_start_element (GtkBuildableParseContext *context,
                       const char **tree,
@@ -426,7 +451,6 @@ replay_start_element (GtkBuildableParseContext *context,
   guint32 i, n_attrs;
   const char **attr_names;
   const char **attr_values;
-  GError *tmp_error = NULL;
 
   element_name = demarshal_string (tree, strings);
   n_attrs = demarshal_uint32 (tree);
@@ -441,13 +465,19 @@ replay_start_element (GtkBuildableParseContext *context,
   attr_names[i] = NULL;
   attr_values[i] = NULL;
 
-  (* context->internal_callbacks->start_element) (NULL,
-                                                  element_name,
-                                                  attr_names,
-                                                  attr_values,
-                                                  context,
-                                                  &tmp_error);
+  return emit_start_element (context, element_name, attr_names, attr_values, error);
+}
 
+static gboolean
+emit_end_element (GtkBuildableParseContext *context,
+                  GError **error)
+{
+  GError *tmp_error = NULL;
+
+  (* context->internal_callbacks->end_element) (NULL,
+                                                gtk_buildable_parse_context_get_element (context),
+                                                context,
+                                                &tmp_error);
   if (tmp_error)
     {
       propagate_error (context, error, tmp_error);
@@ -462,13 +492,24 @@ replay_end_element (GtkBuildableParseContext *context,
                     const char **tree,
                     const char *strings,
                     GError **error)
+{
+  return emit_end_element (context, error);
+}
+
+static gboolean
+emit_text (GtkBuildableParseContext *context,
+           const char *text,
+           gsize text_len,
+           GError **error)
 {
   GError *tmp_error = NULL;
 
-  (* context->internal_callbacks->end_element) (NULL,
-                                                gtk_buildable_parse_context_get_element (context),
-                                                context,
-                                                &tmp_error);
+  (*context->internal_callbacks->text) (NULL,
+                                        text,
+                                        text_len,
+                                        context,
+                                        &tmp_error);
+
   if (tmp_error)
     {
       propagate_error (context, error, tmp_error);
@@ -485,23 +526,10 @@ replay_text (GtkBuildableParseContext *context,
              GError **error)
 {
   const char *text;
-  GError *tmp_error = NULL;
 
   text = demarshal_string (tree, strings);
 
-  (*context->internal_callbacks->text) (NULL,
-                                        text,
-                                        strlen (text),
-                                        context,
-                                        &tmp_error);
-
-  if (tmp_error)
-    {
-      propagate_error (context, error, tmp_error);
-      return FALSE;
-    }
-
-  return TRUE;
+  return emit_text (context, text, strlen (text), error);
 }
 
 gboolean
@@ -561,3 +589,164 @@ _gtk_buildable_parser_replay_precompiled (GtkBuildableParseContext *context,
 
   return TRUE;
 }
+
+/*****************************************  Decoded precompiled data ***************************/
+
+typedef struct {
+  RecordTreeType type;
+  const char *data; /* Element name or text */
+  gsize len; /* Length of text */
+  const char **attr_names; /* NULL terminated */
+  const char **attr_values;
+} DecodedRecord;
+
+/* The records of precompiled data, demarshaled once so that
+ * instantiating the same template many times only has to walk
+ * an array. All strings point into the precompiled data.
+ */
+struct _GtkBuildablePrecompiled {
+  GBytes *bytes;
+  guint n_records;
+  DecodedRecord *records;
+  const char **attrs;
+};
+
+/**
+ * _gtk_buildable_precompiled_new:
+ * @bytes: precompiled data, as returned by _gtk_buildable_parser_precompile()
+ *
+ * Decodes @bytes into a form that can be replayed repeatedly
+ * without demarshaling it again.
+ *
+ * Returns: (transfer full): the decoded data
+ **/
+GtkBuildablePrecompiled *
+_gtk_buildable_precompiled_new (GBytes *bytes)
+{
+  GtkBuildablePrecompiled *precompiled;
+  const char *data, *data_end, *strings, *tree;
+  guint32 len, type, n_attrs, i;
+  guint n_records, n_attrs_total;
+  const char **attrs;
+
+  data = g_bytes_get_data (bytes, NULL);
+  data_end = data + g_bytes_get_size (bytes);
+
+  g_return_val_if_fail (_gtk_buildable_parser_is_precompiled (data, data_end - data), NULL);
+
+  data = data + 4; /* Skip header */
+  len = demarshal_uint32 (&data);
+  strings = data;
+  data = data + len;
+
+  /* Count first, so that everything fits into two allocations */
+  n_records = 0;
+  n_attrs_total = 0;
+  for (tree = data; tree < data_end; n_records++)
+    {
+      type = demarshal_uint32 (&tree);
+      switch (type)
+        {
+        case RECORD_TYPE_ELEMENT:
+          demarshal_uint32 (&tree);
+          n_attrs = demarshal_uint32 (&tree);
+          for (i = 0; i < 2 * n_attrs; i++)
+            demarshal_uint32 (&tree);
+          n_attrs_total += 2 * (n_attrs + 1);
+          break;
+        case RECORD_TYPE_END_ELEMENT:
+          break;
+        case RECORD_TYPE_TEXT:
+          demarshal_uint32 (&tree);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  precompiled = g_new0 (GtkBuildablePrecompiled, 1);
+  precompiled->bytes = g_bytes_ref (bytes);
+  precompiled->n_records = n_records;
+  precompiled->records = g_new0 (DecodedRecord, n_records);
+  precompiled->attrs = g_new (const char *, n_attrs_total);
+
+  attrs = precompiled->attrs;
+  for (tree = data, n_records = 0; tree < data_end; n_records++)
+    {
+      DecodedRecord *record = &precompiled->records[n_records];
+
+      record->type = demarshal_uint32 (&tree);
+      switch (record->type)
+        {
+        case RECORD_TYPE_ELEMENT:
+          record->data = demarshal_string (&tree, strings);
+          n_attrs = demarshal_uint32 (&tree);
+          record->attr_names = attrs;
+          record->attr_values = attrs + n_attrs + 1;
+          for (i = 0; i < n_attrs; i++)
+            {
+              record->attr_names[i] = demarshal_string (&tree, strings);
+              record->attr_values[i] = demarshal_string (&tree, strings);
+            }
+          record->attr_names[n_attrs] = NULL;
+          record->attr_values[n_attrs] = NULL;
+          attrs += 2 * (n_attrs + 1);
+          break;
+        case RECORD_TYPE_END_ELEMENT:
+          break;
+        case RECORD_TYPE_TEXT:
+          record->data = demarshal_string (&tree, strings);
+          record->len = strlen (record->data);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+    }
+
+  return precompiled;
+}
+
+void
+_gtk_buildable_precompiled_free (GtkBuildablePrecompiled *precompiled)
+{
+  g_bytes_unref (precompiled->bytes);
+  g_free (precompiled->records);
+  g_free (precompiled->attrs);
+  g_free (precompiled);
+}
+
+gboolean
+_gtk_buildable_parser_replay_decoded (GtkBuildableParseContext *context,
+                                      GtkBuildablePrecompiled  *precompiled,
+                                      GError                  **error)
+{
+  guint i;
+
+  for (i = 0; i < precompiled->n_records; i++)
+    {
+      const DecodedRecord *record = &precompiled->records[i];
+      gboolean res;
+
+      switch (record->type)
+        {
+        case RECORD_TYPE_ELEMENT:
+          res = emit_start_element (context, record->data,
+                                    record->attr_names, record->attr_values,
+                                    error);
+          break;
+        case RECORD_TYPE_END_ELEMENT:
+          res = emit_end_element (context, error);
+          break;
+        case RECORD_TYPE_TEXT:
+          res = emit_text (context, record->data, record->len, error);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+
+      if (!res)
+        return FALSE;
+    }
+
+  return TRUE;
+}
@@ -202,12 +202,27 @@ gboolean _gtk_buildable_parser_replay_precompiled (GtkBuildableParseContext *con
                                                    const char           *data,
                                                    gssize                data_len,
                                                    GError              **error);
+typedef struct _GtkBuildablePrecompiled GtkBuildablePrecompiled;
+GtkBuildablePrecompiled * _gtk_buildable_precompiled_new (GBytes *bytes);
+void _gtk_buildable_precompiled_free (GtkBuildablePrecompiled *precompiled);
+gboolean _gtk_buildable_parser_replay_decoded (GtkBuildableParseContext *context,
+                                               GtkBuildablePrecompiled  *precompiled,
+                                               GError                  **error);
 void _gtk_builder_parser_parse_buffer (GtkBuilder *builder,
                                        const char *filename,
                                        const char *buffer,
                                        gssize length,
                                        const char **requested_objs,
                                        GError **error);
+void _gtk_builder_parser_parse_precompiled (GtkBuilder              *builder,
+                                            const char              *filename,
+                                            GtkBuildablePrecompiled *precompiled,
+                                            GError                 **error);
+gboolean _gtk_builder_extend_with_precompiled_template (GtkBuilder              *builder,
+                                                        GObject                 *object,
+                                                        GType                    template_type,
+                                                        GtkBuildablePrecompiled *precompiled,
+                                                        GError                 **error);
 GObject * _gtk_builder_construct (GtkBuilder *builder,
                                   ObjectInfo *info,
 				  GError    **error);
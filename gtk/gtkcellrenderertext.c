@@ -25,6 +25,7 @@
 #include "gtkentryprivate.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
+#include "gtkpango.h"
 #include "gtkprivate.h"
 #include "gtksizerequest.h"
 #include "gtksnapshot.h"
@@ -1423,6 +1424,32 @@ add_attr (PangoAttrList  *attr_list,
   pango_attr_list_insert (attr_list, attr);
 }
 
+/* Cells in the rows of a view are drawn and measured over and over
+ * while scrolling, and many of them show the same text. Layouts that
+ * don't depend on the width of the cell can come from the cache that
+ * is shared with labels, so they are only laid out once. They must not
+ * be modified.
+ */
+static PangoLayout *
+share_layout (GtkCellRendererText *celltext,
+              PangoLayout         *layout)
+{
+  GtkCellRendererTextPrivate *priv = gtk_cell_renderer_text_get_instance_private (celltext);
+  PangoLayout *shared;
+
+  if (priv->wrap_width != -1 ||
+      (priv->ellipsize_set && priv->ellipsize != PANGO_ELLIPSIZE_NONE))
+    return layout;
+
+  shared = gtk_pango_layout_cache_lookup (layout);
+  if (shared == NULL)
+    return layout;
+
+  g_object_unref (layout);
+
+  return shared;
+}
+
 static PangoLayout*
 get_layout (GtkCellRendererText *celltext,
             GtkWidget           *widget,
@@ -1703,7 +1730,7 @@ gtk_cell_renderer_text_snapshot (GtkCellRenderer      *cell,
   int xpad, ypad;
   PangoRectangle rect;
 
-  layout = get_layout (celltext, widget, cell_area, flags);
+  layout = share_layout (celltext, get_layout (celltext, widget, cell_area, flags));
   get_size (cell, widget, cell_area, layout, &x_offset, &y_offset, NULL, NULL);
   context = gtk_widget_get_style_context (widget);
 
@@ -1722,9 +1749,6 @@ gtk_cell_renderer_text_snapshot (GtkCellRenderer      *cell,
   if (priv->ellipsize_set && priv->ellipsize != PANGO_ELLIPSIZE_NONE)
     pango_layout_set_width (layout,
 			    (cell_area->width - x_offset - 2 * xpad) * PANGO_SCALE);
-  else if (priv->wrap_width == -1)
-    pango_layout_set_width (layout, -1);
-
   pango_layout_get_pixel_extents (layout, NULL, &rect);
   x_offset = x_offset - rect.x;
 
@@ -1910,7 +1934,10 @@ gtk_cell_renderer_text_get_preferred_width (GtkCellRenderer *cell,
   layout = get_layout (celltext, widget, NULL, 0);
 
   /* Fetch the length of the complete unwrapped text */
-  pango_layout_set_width (layout, -1);
+  if (priv->wrap_width == -1)
+    layout = share_layout (celltext, layout);
+  else
+    pango_layout_set_width (layout, -1);
   pango_layout_get_extents (layout, NULL, &rect);
   text_width = rect.width;
 
@@ -2023,7 +2050,7 @@ gtk_cell_renderer_text_get_aligned_area (GtkCellRenderer       *cell,
   int x_offset = 0;
   int y_offset = 0;
 
-  layout = get_layout (celltext, widget, cell_area, flags);
+  layout = share_layout (celltext, get_layout (celltext, widget, cell_area, flags));
   get_size (cell, widget, cell_area, layout, &x_offset, &y_offset, 
 	    &aligned_area->width, &aligned_area->height);
 
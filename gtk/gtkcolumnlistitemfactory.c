@@ -102,6 +102,12 @@ gtk_column_list_item_factory_update (GtkListItemFactory *factory,
        child;
        child = gtk_widget_get_next_sibling (child))
     {
+      GtkColumnViewColumn *column = gtk_column_view_cell_get_column (GTK_COLUMN_VIEW_CELL (child));
+
+      /* Cells of columns out of view get updated when they come into view */
+      if (!gtk_column_view_column_get_in_view (column))
+        continue;
+
       gtk_list_item_widget_update (GTK_LIST_ITEM_WIDGET (child), position, item, selected);
     }
 }
@@ -143,6 +149,10 @@ gtk_column_list_item_factory_add_column (GtkColumnListItemFactory *factory,
 
   cell = gtk_column_view_cell_new (column);
   gtk_list_item_widget_add_child (GTK_LIST_ITEM_WIDGET (list_item), GTK_WIDGET (cell));
+
+  if (!gtk_column_view_column_get_in_view (column))
+    return;
+
   gtk_list_item_widget_update (GTK_LIST_ITEM_WIDGET (cell),
                                gtk_list_item_widget_get_position (list_item),
                                gtk_list_item_widget_get_item (list_item),
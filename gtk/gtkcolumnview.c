@@ -348,6 +348,33 @@ gtk_column_view_allocate_columns (GtkColumnView *self,
   return x;
 }
 
+/* Columns more than a page away from the visible area are out of view */
+static void
+gtk_column_view_update_columns_in_view (GtkColumnView *self,
+                                        int            x,
+                                        int            width)
+{
+  guint i, n;
+
+  n = g_list_model_get_n_items (G_LIST_MODEL (self->columns));
+
+  for (i = 0; i < n; i++)
+    {
+      GtkColumnViewColumn *column;
+      int col_x, col_width;
+
+      column = g_list_model_get_item (G_LIST_MODEL (self->columns), i);
+      gtk_column_view_column_get_allocation (column, &col_x, &col_width);
+
+      gtk_column_view_column_set_in_view (column,
+                                          width <= 0 ||
+                                          (col_x + col_width >= x - width &&
+                                           col_x <= x + 2 * width));
+
+      g_object_unref (column);
+    }
+}
+
 static void
 gtk_column_view_allocate (GtkWidget *widget,
                           int        width,
@@ -359,6 +386,7 @@ gtk_column_view_allocate (GtkWidget *widget,
 
   x = gtk_adjustment_get_value (self->hadjustment);
   full_width = gtk_column_view_allocate_columns (self, width);
+  gtk_column_view_update_columns_in_view (self, x, width);
 
   gtk_widget_measure (self->header, GTK_ORIENTATION_VERTICAL, full_width, &min, &nat, NULL, NULL);
   if (gtk_scrollable_get_vscroll_policy (GTK_SCROLLABLE (self->listview)) == GTK_SCROLL_MINIMUM)
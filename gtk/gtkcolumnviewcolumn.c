@@ -74,6 +74,7 @@ struct _GtkColumnViewColumn
   guint visible     : 1;
   guint resizable   : 1;
   guint expand      : 1;
+  guint in_view     : 1;
 
   GMenuModel *menu;
 
@@ -351,6 +352,7 @@ gtk_column_view_column_init (GtkColumnViewColumn *self)
   self->visible = TRUE;
   self->resizable = FALSE;
   self->expand = FALSE;
+  self->in_view = TRUE;
   self->fixed_width = -1;
 }
 
@@ -523,6 +525,47 @@ gtk_column_view_column_get_allocation (GtkColumnViewColumn *self,
     *size = self->allocation_size;
 }
 
+/*
+ * Columns far away from the visible part of the view are not in view.
+ * Their cells don't get bound to new items and are not considered when
+ * measuring rows, so scrolling through rows of wide tables only binds
+ * the cells that can be seen. They are updated once the column comes
+ * into view again.
+ */
+void
+gtk_column_view_column_set_in_view (GtkColumnViewColumn *self,
+                                    gboolean             in_view)
+{
+  GtkColumnViewCell *cell;
+
+  if (self->in_view == in_view)
+    return;
+
+  self->in_view = in_view;
+
+  if (!in_view)
+    return;
+
+  for (cell = self->first_cell; cell; cell = gtk_column_view_cell_get_next (cell))
+    {
+      GtkListItemWidget *list_item;
+
+      list_item = GTK_LIST_ITEM_WIDGET (gtk_widget_get_parent (GTK_WIDGET (cell)));
+      gtk_list_item_widget_update (GTK_LIST_ITEM_WIDGET (cell),
+                                   gtk_list_item_widget_get_position (list_item),
+                                   gtk_list_item_widget_get_item (list_item),
+                                   gtk_list_item_widget_get_selected (list_item));
+    }
+
+  gtk_column_view_column_queue_resize (self);
+}
+
+gboolean
+gtk_column_view_column_get_in_view (GtkColumnViewColumn *self)
+{
+  return self->in_view;
+}
+
 static void
 gtk_column_view_column_create_cells (GtkColumnViewColumn *self)
 {
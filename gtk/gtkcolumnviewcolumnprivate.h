@@ -49,6 +49,10 @@ void                    gtk_column_view_column_get_allocation           (GtkColu
                                                                          int                    *offset,
                                                                          int                    *size);
 
+void                    gtk_column_view_column_set_in_view              (GtkColumnViewColumn    *self,
+                                                                         gboolean                in_view);
+gboolean                gtk_column_view_column_get_in_view              (GtkColumnViewColumn    *self);
+
 void                    gtk_column_view_column_notify_sort              (GtkColumnViewColumn    *self);
 
 void                    gtk_column_view_column_set_header_position      (GtkColumnViewColumn    *self,
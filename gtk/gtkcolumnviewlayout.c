@@ -69,6 +69,10 @@ gtk_column_view_layout_measure_along (GtkColumnViewLayout *self,
       if (!gtk_widget_should_layout (child))
         continue;
 
+      if (GTK_IS_COLUMN_VIEW_CELL (child) &&
+          !gtk_column_view_column_get_in_view (gtk_column_view_cell_get_column (GTK_COLUMN_VIEW_CELL (child))))
+        continue;
+
       gtk_widget_measure (child, orientation,
                           for_size > -1 ? sizes[i].minimum_size : -1,
                           &child_min, &child_nat,
@@ -23,6 +23,8 @@
 
 #include "gtkcolumnviewcolumnprivate.h"
 #include "gtkintl.h"
+#include "gtksorterprivate.h"
+#include "gtksortkeysprivate.h"
 #include "gtktypebuiltins.h"
 
 typedef struct
@@ -53,6 +55,186 @@ struct _GtkColumnViewSorter
 
 G_DEFINE_TYPE (GtkColumnViewSorter, gtk_column_view_sorter, GTK_TYPE_SORTER)
 
+typedef struct _GtkColumnViewSortKey GtkColumnViewSortKey;
+typedef struct _GtkColumnViewSortKeys GtkColumnViewSortKeys;
+
+struct _GtkColumnViewSortKey
+{
+  gsize offset;
+  GtkSortKeys *keys;
+  gboolean inverted;
+};
+
+/* The keys of all columns, one after another, so sorting by
+ * multiple columns can use keys just like sorting by one */
+struct _GtkColumnViewSortKeys
+{
+  GtkSortKeys parent_keys;
+
+  guint n_keys;
+  GtkColumnViewSortKey keys[];
+};
+
+static void
+gtk_column_view_sort_keys_free (GtkSortKeys *keys)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) keys;
+  gsize i;
+
+  for (i = 0; i < self->n_keys; i++)
+    gtk_sort_keys_unref (self->keys[i].keys);
+
+  g_slice_free1 (sizeof (GtkColumnViewSortKeys) + self->n_keys * sizeof (GtkColumnViewSortKey), self);
+}
+
+static int
+gtk_column_view_sort_keys_compare (gconstpointer a,
+                                   gconstpointer b,
+                                   gpointer      data)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) data;
+  gsize i;
+
+  for (i = 0; i < self->n_keys; i++)
+    {
+      GtkOrdering result = gtk_sort_keys_compare (self->keys[i].keys,
+                                                  ((const char *) a) + self->keys[i].offset,
+                                                  ((const char *) b) + self->keys[i].offset);
+      if (result != GTK_ORDERING_EQUAL)
+        return self->keys[i].inverted ? - result : result;
+    }
+
+  return GTK_ORDERING_EQUAL;
+}
+
+static gboolean
+gtk_column_view_sort_keys_is_compatible (GtkSortKeys *keys,
+                                         GtkSortKeys *other)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) keys;
+  GtkColumnViewSortKeys *compare = (GtkColumnViewSortKeys *) other;
+  gsize i;
+
+  if (keys->klass != other->klass)
+    return FALSE;
+
+  if (self->n_keys != compare->n_keys)
+    return FALSE;
+
+  for (i = 0; i < self->n_keys; i++)
+    {
+      if (self->keys[i].inverted != compare->keys[i].inverted ||
+          !gtk_sort_keys_is_compatible (self->keys[i].keys, compare->keys[i].keys))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+gtk_column_view_sort_keys_init_key (GtkSortKeys *keys,
+                                    gpointer     item,
+                                    gpointer     key_memory)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) keys;
+  char *key = (char *) key_memory;
+  gsize i;
+
+  for (i = 0; i < self->n_keys; i++)
+    gtk_sort_keys_init_key (self->keys[i].keys, item, key + self->keys[i].offset);
+}
+
+static void
+gtk_column_view_sort_keys_clear_key (GtkSortKeys *keys,
+                                     gpointer     key_memory)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) keys;
+  char *key = (char *) key_memory;
+  gsize i;
+
+  for (i = 0; i < self->n_keys; i++)
+    gtk_sort_keys_clear_key (self->keys[i].keys, key + self->keys[i].offset);
+}
+
+static guint64
+gtk_column_view_sort_keys_prefix (GtkSortKeys   *keys,
+                                  gconstpointer  key_memory)
+{
+  GtkColumnViewSortKeys *self = (GtkColumnViewSortKeys *) keys;
+  guint64 prefix;
+
+  prefix = gtk_sort_keys_get_prefix (self->keys[0].keys,
+                                     ((const char *) key_memory) + self->keys[0].offset);
+
+  /* Inverting all bits inverts the order */
+  return self->keys[0].inverted ? ~prefix : prefix;
+}
+
+static const GtkSortKeysClass GTK_COLUMN_VIEW_SORT_KEYS_CLASS =
+{
+  gtk_column_view_sort_keys_free,
+  gtk_column_view_sort_keys_compare,
+  gtk_column_view_sort_keys_is_compatible,
+  gtk_column_view_sort_keys_init_key,
+  gtk_column_view_sort_keys_clear_key,
+};
+
+static const GtkSortKeysClass GTK_COLUMN_VIEW_SORT_KEYS_PREFIX_CLASS =
+{
+  gtk_column_view_sort_keys_free,
+  gtk_column_view_sort_keys_compare,
+  gtk_column_view_sort_keys_is_compatible,
+  gtk_column_view_sort_keys_init_key,
+  gtk_column_view_sort_keys_clear_key,
+  gtk_column_view_sort_keys_prefix,
+};
+
+static GtkSortKeys *
+gtk_column_view_sort_keys_new (GtkColumnViewSorter *self)
+{
+  GtkColumnViewSortKeys *result;
+  GtkSortKeys *keys;
+  GSequenceIter *iter;
+  Sorter *first;
+  guint i, n_keys;
+
+  n_keys = g_sequence_get_length (self->sorters);
+  if (n_keys == 0)
+    return gtk_sort_keys_new_equal ();
+
+  first = g_sequence_get (g_sequence_get_begin_iter (self->sorters));
+  if (n_keys == 1 && !first->inverted)
+    return gtk_sorter_get_keys (first->sorter);
+
+  keys = gtk_sort_keys_alloc (&GTK_COLUMN_VIEW_SORT_KEYS_CLASS,
+                              sizeof (GtkColumnViewSortKeys) + n_keys * sizeof (GtkColumnViewSortKey),
+                              0, 1);
+  result = (GtkColumnViewSortKeys *) keys;
+  result->n_keys = n_keys;
+
+  for (iter = g_sequence_get_begin_iter (self->sorters), i = 0;
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter), i++)
+    {
+      Sorter *s = g_sequence_get (iter);
+
+      result->keys[i].keys = gtk_sorter_get_keys (s->sorter);
+      result->keys[i].inverted = s->inverted;
+      result->keys[i].offset = GTK_SORT_KEYS_ALIGN (keys->key_size, gtk_sort_keys_get_key_align (result->keys[i].keys));
+      keys->key_size = result->keys[i].offset + gtk_sort_keys_get_key_size (result->keys[i].keys);
+      keys->key_align = MAX (keys->key_align, gtk_sort_keys_get_key_align (result->keys[i].keys));
+      keys->thread_unsafe |= !gtk_sort_keys_is_thread_safe (result->keys[i].keys);
+    }
+
+  if (gtk_sort_keys_has_prefix (result->keys[0].keys))
+    {
+      keys->klass = &GTK_COLUMN_VIEW_SORT_KEYS_PREFIX_CLASS;
+      keys->prefix_is_key = n_keys == 1 && result->keys[0].keys->prefix_is_key;
+    }
+
+  return keys;
+}
+
 static GtkOrdering
 gtk_column_view_sorter_compare (GtkSorter *sorter,
                                 gpointer   item1,
@@ -144,6 +326,10 @@ static void
 gtk_column_view_sorter_init (GtkColumnViewSorter *self)
 {
   self->sorters = g_sequence_new (free_sorter);
+
+  gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_sort_keys_new_equal ());
 }
 
 GtkColumnViewSorter *
@@ -155,7 +341,11 @@ gtk_column_view_sorter_new (void)
 static void
 gtk_column_view_sorter_changed_cb (GtkSorter *sorter, int change, gpointer data)
 {
-  gtk_sorter_changed (GTK_SORTER (data), GTK_SORTER_CHANGE_DIFFERENT);
+  GtkColumnViewSorter *self = GTK_COLUMN_VIEW_SORTER (data);
+
+  gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_column_view_sort_keys_new (self));
 }
 
 static gboolean
@@ -223,7 +413,9 @@ gtk_column_view_sorter_add_column (GtkColumnViewSorter *self,
     gtk_column_view_column_notify_sort (first->column);
 
 out:
-  gtk_sorter_changed (GTK_SORTER (self), GTK_SORTER_CHANGE_DIFFERENT);
+  gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_column_view_sort_keys_new (self));
 
   gtk_column_view_column_notify_sort (column);
 
@@ -239,7 +431,9 @@ gtk_column_view_sorter_remove_column (GtkColumnViewSorter *self,
 
   if (remove_column (self, column))
     {
-      gtk_sorter_changed (GTK_SORTER (self), GTK_SORTER_CHANGE_DIFFERENT);
+      gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_column_view_sort_keys_new (self));
       gtk_column_view_column_notify_sort (column);
       return TRUE;
     }
@@ -275,7 +469,9 @@ gtk_column_view_sorter_set_column (GtkColumnViewSorter *self,
  
   g_sequence_prepend (self->sorters, s);
 
-  gtk_sorter_changed (GTK_SORTER (self), GTK_SORTER_CHANGE_DIFFERENT);
+  gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_column_view_sort_keys_new (self));
 
   gtk_column_view_column_notify_sort (column);
 
@@ -303,7 +499,9 @@ gtk_column_view_sorter_clear (GtkColumnViewSorter *self)
 
   g_sequence_remove_range (iter, g_sequence_get_end_iter (self->sorters));
 
-  gtk_sorter_changed (GTK_SORTER (self), GTK_SORTER_CHANGE_DIFFERENT);
+  gtk_sorter_changed_with_keys (GTK_SORTER (self),
+                                GTK_SORTER_CHANGE_DIFFERENT,
+                                gtk_column_view_sort_keys_new (self));
 
   gtk_column_view_column_notify_sort (column);
 
@@ -30,7 +30,21 @@
 
 
 #define GTK_COMPOSE_TABLE_MAGIC "GtkComposeTable"
-#define GTK_COMPOSE_TABLE_VERSION (1)
+#define GTK_COMPOSE_TABLE_VERSION (2)
+
+/* Cache files are written in the native byte order, so they can be
+ * mapped into memory and used without any parsing. The nodes of the
+ * trie follow the header.
+ */
+typedef struct {
+  char     magic[16];
+  guint16  version;
+  guint16  byte_order;
+  guint16  max_seq_len;
+  guint16  padding;
+  guint32  n_seqs;
+  guint32  n_nodes;
+} GtkComposeCacheHeader;
 
 typedef struct {
   gunichar     *sequence;
@@ -538,59 +552,25 @@ static char *
 gtk_compose_table_serialize (GtkComposeTable *compose_table,
                              gsize           *count)
 {
-  char *p, *contents;
-  gsize length, total_length;
-  guint16 bytes;
-  const char *header = GTK_COMPOSE_TABLE_MAGIC;
-  const guint16 version = GTK_COMPOSE_TABLE_VERSION;
-  guint16 max_seq_len = compose_table->max_seq_len;
-  guint16 index_stride = max_seq_len + 2;
-  guint16 n_seqs = compose_table->n_seqs;
-  guint32 i;
+  GtkComposeCacheHeader header = { GTK_COMPOSE_TABLE_MAGIC, };
+  gsize nodes_size;
+  char *contents;
 
   g_return_val_if_fail (compose_table != NULL, NULL);
-  g_return_val_if_fail (max_seq_len > 0, NULL);
-  g_return_val_if_fail (index_stride > 0, NULL);
-
-  length = strlen (header);
-  total_length = length + sizeof (guint16) * (3 +  index_stride * n_seqs);
-  if (count)
-    *count = total_length;
-
-  p = contents = g_slice_alloc (total_length);
-
-  memcpy (p, header, length);
-  p += length;
-
-  /* Copy by byte for endian */
-#define BYTE_COPY_FROM_BUF(element)                                           \
-  bytes = GUINT16_TO_BE ((element));                                          \
-  memcpy (p, &bytes, length);                                                 \
-  p += length;                                                                \
-  if (p - contents > total_length)                                            \
-    {                                                                         \
-      g_warning ("data size %lld is bigger than %" G_GSIZE_FORMAT,            \
-                 (long long) (p - contents), total_length);                   \
-      g_free (contents);                                                      \
-      if (count)                                                              \
-        {                                                                     \
-          *count = 0;                                                         \
-        }                                                                     \
-      return NULL;                                                            \
-    }
+  g_return_val_if_fail (compose_table->max_seq_len > 0, NULL);
 
-  length = sizeof (guint16);
+  header.version = GTK_COMPOSE_TABLE_VERSION;
+  header.byte_order = G_BYTE_ORDER;
+  header.max_seq_len = compose_table->max_seq_len;
+  header.n_seqs = compose_table->n_seqs;
+  header.n_nodes = compose_table->n_nodes;
 
-  BYTE_COPY_FROM_BUF (version);
-  BYTE_COPY_FROM_BUF (max_seq_len);
-  BYTE_COPY_FROM_BUF (n_seqs);
-
-  for (i = 0; i < (guint32) index_stride * n_seqs; i++)
-    {
-      BYTE_COPY_FROM_BUF (compose_table->data[i]);
-    }
+  nodes_size = sizeof (GtkComposeNode) * compose_table->n_nodes;
+  *count = sizeof (GtkComposeCacheHeader) + nodes_size;
 
-#undef BYTE_COPY_FROM_BUF
+  contents = g_malloc (*count);
+  memcpy (contents, &header, sizeof (GtkComposeCacheHeader));
+  memcpy (contents + sizeof (GtkComposeCacheHeader), compose_table->nodes, nodes_size);
 
   return contents;
 }
@@ -609,20 +589,13 @@ gtk_compose_table_load_cache (const char *compose_file)
 {
   guint32 hash;
   char *path = NULL;
-  char *contents = NULL;
-  char *p;
   GStatBuf original_buf;
   GStatBuf cache_buf;
-  gsize total_length;
+  GMappedFile *mapped_file = NULL;
+  const GtkComposeCacheHeader *header;
+  const char *contents;
   gsize length;
   GError *error = NULL;
-  guint16 bytes;
-  guint16 version;
-  guint16 max_seq_len;
-  guint16 index_stride;
-  guint16 n_seqs;
-  guint32 i;
-  guint16 *gtk_compose_seqs = NULL;
   GtkComposeTable *retval;
 
   hash = g_str_hash (compose_file);
@@ -635,81 +608,55 @@ gtk_compose_table_load_cache (const char *compose_file)
   g_stat (path, &cache_buf);
   if (original_buf.st_mtime > cache_buf.st_mtime)
     goto out_load_cache;
-  if (!g_file_get_contents (path, &contents, &total_length, &error))
+
+  /* The pages of the mapping are shared by all processes using the cache */
+  mapped_file = g_mapped_file_new (path, FALSE, &error);
+  if (mapped_file == NULL)
     {
-      g_warning ("Failed to get cache content %s: %s", path, error->message);
+      g_warning ("Failed to map cache content %s: %s", path, error->message);
       g_error_free (error);
       goto out_load_cache;
     }
 
-  /* Copy by byte for endian */
-#define BYTE_COPY_TO_BUF(element)                                       \
-  memcpy (&bytes, p, length);                                           \
-  element = GUINT16_FROM_BE (bytes);                                    \
-  p += length;                                                          \
-  if (p - contents > total_length)                                      \
-    {                                                                   \
-      g_warning ("Broken cache content %s in %s", path, #element);      \
-      goto out_load_cache;                                              \
-    }
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+  header = (const GtkComposeCacheHeader *) contents;
 
-  p = contents;
-  if (g_ascii_strncasecmp (p, GTK_COMPOSE_TABLE_MAGIC,
-                           strlen (GTK_COMPOSE_TABLE_MAGIC)) != 0)
+  if (length < sizeof (GtkComposeCacheHeader) ||
+      strncmp (header->magic, GTK_COMPOSE_TABLE_MAGIC, sizeof (header->magic)) != 0)
     {
       g_warning ("The file is not a GtkComposeTable cache file %s", path);
       goto out_load_cache;
     }
-  p += strlen (GTK_COMPOSE_TABLE_MAGIC);
-  if (p - contents > total_length)
-    {
-      g_warning ("Broken cache content %s at head", path);
-      goto out_load_cache;
-    }
 
-  length = sizeof (guint16);
-
-  BYTE_COPY_TO_BUF (version);
-  if (version != GTK_COMPOSE_TABLE_VERSION)
-    {
-      g_warning ("cache version is different %u != %u",
-                 version, GTK_COMPOSE_TABLE_VERSION);
-      goto out_load_cache;
-    }
-
-  BYTE_COPY_TO_BUF (max_seq_len);
-  BYTE_COPY_TO_BUF (n_seqs);
+  /* Caches written by other versions or on other machines are just
+   * replaced with a new one.
+   */
+  if (header->version != GTK_COMPOSE_TABLE_VERSION ||
+      header->byte_order != G_BYTE_ORDER)
+    goto out_load_cache;
 
-  if (max_seq_len == 0 || n_seqs == 0)
+  if (header->max_seq_len == 0 || header->n_nodes == 0 ||
+      length - sizeof (GtkComposeCacheHeader) != (gsize) header->n_nodes * sizeof (GtkComposeNode))
     {
-      g_warning ("cache size is not correct %d %d", max_seq_len, n_seqs);
+      g_warning ("Broken cache content %s", path);
       goto out_load_cache;
     }
 
-  index_stride = max_seq_len + 2;
-  gtk_compose_seqs = g_new0 (guint16, n_seqs * index_stride);
-
-  for (i = 0; i < (guint32) index_stride * n_seqs; i++)
-    {
-      BYTE_COPY_TO_BUF (gtk_compose_seqs[i]);
-    }
-
   retval = g_new0 (GtkComposeTable, 1);
-  retval->data = gtk_compose_seqs;
-  retval->max_seq_len = max_seq_len;
-  retval->n_seqs = n_seqs;
+  retval->nodes = (const GtkComposeNode *) (contents + sizeof (GtkComposeCacheHeader));
+  retval->n_nodes = header->n_nodes;
+  retval->max_seq_len = header->max_seq_len;
+  retval->n_seqs = header->n_seqs;
   retval->id = hash;
+  retval->mapped_file = mapped_file;
 
-  g_free (contents);
   g_free (path);
 
   return retval;
 
-#undef BYTE_COPY_TO_BUF
-
 out_load_cache:
-  g_free (gtk_compose_seqs);
-  g_free (contents);
+  g_clear_pointer (&mapped_file, g_mapped_file_unref);
   g_free (path);
   return NULL;
 }
@@ -739,10 +686,118 @@ gtk_compose_table_save_cache (GtkComposeTable *compose_table)
     }
 
 out_save_cache:
-  g_slice_free1 (length, contents);
+  g_free (contents);
   g_free (path);
 }
 
+static int
+gtk_compose_table_compare_rows (gconstpointer a,
+                                gconstpointer b,
+                                gpointer      data)
+{
+  const guint16 *row_a = a;
+  const guint16 *row_b = b;
+  int max_seq_len = GPOINTER_TO_INT (data);
+  int i;
+
+  for (i = 0; i < max_seq_len; i++)
+    {
+      if (row_a[i] != row_b[i])
+        return row_a[i] < row_b[i] ? -1 : 1;
+    }
+
+  return 0;
+}
+
+typedef struct {
+  guint start;
+  guint end;
+  int depth;
+} GtkComposeRange;
+
+/* Builds the trie from @data, which has rows of max_seq_len keysyms,
+ * padded with 0, followed by the two halves of the value.
+ */
+static GtkComposeTable *
+gtk_compose_table_new_with_data (const guint16 *data,
+                                 int            max_seq_len,
+                                 int            n_seqs,
+                                 guint32        hash)
+{
+  const int row_stride = max_seq_len + 2;
+  GtkComposeTable *retval;
+  GtkComposeRange root = { 0, n_seqs, 0 };
+  GArray *nodes, *ranges;
+  guint16 *rows;
+  guint i;
+
+  rows = g_memdup (data, sizeof (guint16) * row_stride * n_seqs);
+  g_qsort_with_data (rows, n_seqs, sizeof (guint16) * row_stride,
+                     gtk_compose_table_compare_rows,
+                     GINT_TO_POINTER (max_seq_len));
+
+  nodes = g_array_new (FALSE, TRUE, sizeof (GtkComposeNode));
+  ranges = g_array_new (FALSE, FALSE, sizeof (GtkComposeRange));
+
+  g_array_set_size (nodes, 1);
+  g_array_append_val (ranges, root);
+
+  /* Nodes get appended breadth-first, so siblings end up next to each other */
+  for (i = 0; i < nodes->len; i++)
+    {
+      GtkComposeRange range = g_array_index (ranges, GtkComposeRange, i);
+      guint first_child = nodes->len;
+      guint row = range.start;
+      guint16 n_children = 0;
+
+#define ROW(r) (rows + (gsize) (r) * row_stride)
+
+      if (row < range.end &&
+          (range.depth == max_seq_len || ROW (row)[range.depth] == 0))
+        {
+          /* The first duplicate of a sequence wins */
+          g_array_index (nodes, GtkComposeNode, i).value =
+            0x10000 * ROW (row)[max_seq_len] + ROW (row)[max_seq_len + 1];
+
+          while (row < range.end &&
+                 (range.depth == max_seq_len || ROW (row)[range.depth] == 0))
+            row++;
+        }
+
+      while (row < range.end)
+        {
+          GtkComposeNode child = { ROW (row)[range.depth], };
+          GtkComposeRange child_range = { row, row, range.depth + 1 };
+
+          while (child_range.end < range.end &&
+                 ROW (child_range.end)[range.depth] == child.keysym)
+            child_range.end++;
+
+          g_array_append_val (nodes, child);
+          g_array_append_val (ranges, child_range);
+          n_children++;
+          row = child_range.end;
+        }
+
+#undef ROW
+
+      g_array_index (nodes, GtkComposeNode, i).first_child = first_child;
+      g_array_index (nodes, GtkComposeNode, i).n_children = n_children;
+    }
+
+  retval = g_new0 (GtkComposeTable, 1);
+  retval->n_nodes = nodes->len;
+  retval->nodes = (GtkComposeNode *) g_array_free (nodes, FALSE);
+  retval->max_seq_len = max_seq_len;
+  retval->n_seqs = n_seqs;
+  retval->id = hash;
+
+  g_array_free (ranges, TRUE);
+  g_free (rows);
+
+  return retval;
+}
+
 static GtkComposeTable *
 gtk_compose_table_new_with_list (GList   *compose_list,
                                  int      max_compose_len,
@@ -780,11 +835,9 @@ gtk_compose_table_new_with_list (GList   *compose_list,
       gtk_compose_seqs[n++] = (guint16) compose_data->value[1];
     }
 
-  retval = g_new0 (GtkComposeTable, 1);
-  retval->data = gtk_compose_seqs;
-  retval->max_seq_len = max_compose_len;
-  retval->n_seqs = length;
-  retval->id = hash;
+  retval = gtk_compose_table_new_with_data (gtk_compose_seqs, max_compose_len, length, hash);
+
+  g_free (gtk_compose_seqs);
 
   return retval;
 }
@@ -837,8 +890,6 @@ gtk_compose_table_list_add_array (GSList        *compose_tables,
   GtkComposeTable *compose_table;
   gsize n_index_stride;
   gsize length;
-  int i;
-  guint16 *gtk_compose_seqs = NULL;
 
   g_return_val_if_fail (data != NULL, compose_tables);
   g_return_val_if_fail (max_seq_len <= GTK_MAX_COMPOSE_LEN, compose_tables);
@@ -855,15 +906,7 @@ gtk_compose_table_list_add_array (GSList        *compose_tables,
   if (g_slist_find_custom (compose_tables, GINT_TO_POINTER (hash), gtk_compose_table_find) != NULL)
     return compose_tables;
 
-  gtk_compose_seqs = g_new0 (guint16, length);
-  for (i = 0; i < length; i++)
-    gtk_compose_seqs[i] = data[i];
-
-  compose_table = g_new (GtkComposeTable, 1);
-  compose_table->data = gtk_compose_seqs;
-  compose_table->max_seq_len = max_seq_len;
-  compose_table->n_seqs = n_seqs;
-  compose_table->id = hash;
+  compose_table = gtk_compose_table_new_with_data (data, max_seq_len, n_seqs, hash);
 
   return g_slist_prepend (compose_tables, compose_table);
 }
@@ -891,3 +934,68 @@ gtk_compose_table_list_add_file (GSList      *compose_tables,
   gtk_compose_table_save_cache (compose_table);
   return g_slist_prepend (compose_tables, compose_table);
 }
+
+/*
+ * gtk_compose_table_check:
+ * @table: a compose table
+ * @compose_buffer: the keysyms typed so far
+ * @n_compose: the number of keysyms in @compose_buffer
+ * @value: (out): return location for the character that @compose_buffer
+ *   composes to, or 0 if it is not a complete sequence
+ * @is_prefix: (out): return location for whether longer sequences
+ *   start with @compose_buffer
+ *
+ * Walks the trie of @table, so this only takes one step per keysym.
+ *
+ * Returns: %TRUE if any sequence in @table starts with @compose_buffer
+ */
+gboolean
+gtk_compose_table_check (const GtkComposeTable *table,
+                         const guint16         *compose_buffer,
+                         int                    n_compose,
+                         gunichar              *value,
+                         gboolean              *is_prefix)
+{
+  const GtkComposeNode *node;
+  int i;
+
+  node = &table->nodes[0];
+
+  for (i = 0; i < n_compose; i++)
+    {
+      const GtkComposeNode *children;
+      guint lo, hi;
+
+      /* Don't trust the cache file blindly */
+      if ((gsize) node->first_child + node->n_children > table->n_nodes)
+        return FALSE;
+
+      children = table->nodes + node->first_child;
+      lo = 0;
+      hi = node->n_children;
+      node = NULL;
+
+      while (lo < hi)
+        {
+          guint mid = (lo + hi) / 2;
+
+          if (children[mid].keysym < compose_buffer[i])
+            lo = mid + 1;
+          else if (children[mid].keysym > compose_buffer[i])
+            hi = mid;
+          else
+            {
+              node = &children[mid];
+              break;
+            }
+        }
+
+      if (node == NULL)
+        return FALSE;
+    }
+
+  *value = node->value;
+  *is_prefix = node->n_children > 0;
+
+  return TRUE;
+}
@@ -25,13 +25,29 @@ G_BEGIN_DECLS
 
 typedef struct _GtkComposeTable GtkComposeTable;
 typedef struct _GtkComposeTableCompact GtkComposeTableCompact;
+typedef struct _GtkComposeNode GtkComposeNode;
+
+/* The sequences of a table are stored as a trie. The children of a
+ * node are stored next to each other, sorted by keysym, and the root
+ * is the first node. The layout is also the layout of the cache files,
+ * which get mapped into memory as they are.
+ */
+struct _GtkComposeNode
+{
+  guint16 keysym;
+  guint16 n_children;
+  guint32 first_child;
+  guint32 value; /* 0 if no sequence ends here */
+};
 
 struct _GtkComposeTable
 {
-  guint16 *data;
+  const GtkComposeNode *nodes;
+  guint32 n_nodes;
   int max_seq_len;
   int n_seqs;
   guint32 id;
+  GMappedFile *mapped_file; /* NULL if we own nodes */
 };
 
 struct _GtkComposeTableCompact
@@ -49,6 +65,11 @@ GSList *gtk_compose_table_list_add_array          (GSList        *compose_tables
                                                    int            n_seqs);
 GSList *gtk_compose_table_list_add_file           (GSList        *compose_tables,
                                                    const char    *compose_file);
+gboolean gtk_compose_table_check                  (const GtkComposeTable *table,
+                                                   const guint16 *compose_buffer,
+                                                   int            n_compose,
+                                                   gunichar      *value,
+                                                   gboolean      *is_prefix);
 
 G_END_DECLS
 
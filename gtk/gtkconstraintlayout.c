@@ -246,6 +246,13 @@ struct _GtkConstraintLayout
    */
   GHashTable *bound_attributes;
 
+  /* Required stays keeping the origin of the layout at (0, 0); unlike
+   * the size of the layout, it never changes between allocations, so
+   * they stay in the solver while the layout is rooted.
+   */
+  GtkConstraintRef *stay_top;
+  GtkConstraintRef *stay_left;
+
   /* HashSet<GtkConstraint>; the set of constraints on the
    * parent widget, using the public API objects.
    */
@@ -1012,7 +1019,7 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
                                 int               baseline)
 {
   GtkConstraintLayout *self = GTK_CONSTRAINT_LAYOUT (manager);
-  GtkConstraintRef *stay_w, *stay_h, *stay_t, *stay_l;
+  GtkConstraintRef *stay_w, *stay_h;
   GtkConstraintSolver *solver;
   GtkConstraintVariable *layout_top, *layout_height;
   GtkConstraintVariable *layout_left, *layout_width;
@@ -1030,14 +1037,20 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
   layout_width = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_WIDTH);
   layout_height = get_layout_attribute (self, widget, GTK_CONSTRAINT_ATTRIBUTE_HEIGHT);
 
-  gtk_constraint_variable_set_value (layout_top, 0.0);
-  stay_t = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_top,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
-  gtk_constraint_variable_set_value (layout_left, 0.0);
-  stay_l = gtk_constraint_solver_add_stay_variable (solver,
-                                                    layout_left,
-                                                    GTK_CONSTRAINT_STRENGTH_REQUIRED);
+  if (self->stay_top == NULL)
+    {
+      gtk_constraint_variable_set_value (layout_top, 0.0);
+      self->stay_top = gtk_constraint_solver_add_stay_variable (solver,
+                                                                layout_top,
+                                                                GTK_CONSTRAINT_STRENGTH_REQUIRED);
+    }
+  if (self->stay_left == NULL)
+    {
+      gtk_constraint_variable_set_value (layout_left, 0.0);
+      self->stay_left = gtk_constraint_solver_add_stay_variable (solver,
+                                                                 layout_left,
+                                                                 GTK_CONSTRAINT_STRENGTH_REQUIRED);
+    }
   gtk_constraint_variable_set_value (layout_width, width);
   stay_w = gtk_constraint_solver_add_stay_variable (solver,
                                                     layout_width,
@@ -1119,11 +1132,9 @@ gtk_constraint_layout_allocate (GtkLayoutManager *manager,
     }
 #endif
 
-  /* The allocation stay constraints are not needed any more */
+  /* The allocation size stay constraints are not needed any more */
   gtk_constraint_solver_remove_constraint (solver, stay_w);
   gtk_constraint_solver_remove_constraint (solver, stay_h);
-  gtk_constraint_solver_remove_constraint (solver, stay_t);
-  gtk_constraint_solver_remove_constraint (solver, stay_l);
 }
 
 static void
@@ -1181,6 +1192,17 @@ gtk_constraint_layout_unroot (GtkLayoutManager *manager)
       gtk_constraint_guide_detach (guide);
     }
 
+  if (self->stay_top != NULL)
+    {
+      gtk_constraint_solver_remove_constraint (self->solver, self->stay_top);
+      self->stay_top = NULL;
+    }
+  if (self->stay_left != NULL)
+    {
+      gtk_constraint_solver_remove_constraint (self->solver, self->stay_left);
+      self->stay_left = NULL;
+    }
+
   self->solver = NULL;
 }
 
@@ -26,6 +26,8 @@
 
 #include "gdk/gdkrgbaprivate.h"
 
+#include <math.h>
+
 typedef enum {
   COLOR_TYPE_LITERAL,
   COLOR_TYPE_NAME,
@@ -61,6 +63,37 @@ struct _GtkCssValue
   } sym_col;
 };
 
+/* Literal colors that aren't singletons, so that equal colors are
+ * usually the same object. The table doesn't hold a reference, colors
+ * remove themselves when they are freed.
+ */
+static GHashTable *literal_colors;
+
+static guint
+gtk_css_color_value_literal_hash (gconstpointer data)
+{
+  const GtkCssValue *color = data;
+
+  return gdk_rgba_hash (&color->sym_col.rgba);
+}
+
+static gboolean
+gtk_css_color_value_literal_equal (gconstpointer data1,
+                                   gconstpointer data2)
+{
+  const GtkCssValue *color1 = data1;
+  const GtkCssValue *color2 = data2;
+
+  return gdk_rgba_equal (&color1->sym_col.rgba, &color2->sym_col.rgba);
+}
+
+static gboolean
+gtk_css_color_value_can_intern (const GdkRGBA *rgba)
+{
+  return !isnan (rgba->red) && !isnan (rgba->green) &&
+         !isnan (rgba->blue) && !isnan (rgba->alpha);
+}
+
 static void
 gtk_css_value_color_free (GtkCssValue *color)
 {
@@ -83,6 +116,10 @@ gtk_css_value_color_free (GtkCssValue *color)
       _gtk_css_value_unref (color->sym_col.mix.color2);
       break;
     case COLOR_TYPE_LITERAL:
+      if (literal_colors != NULL &&
+          g_hash_table_lookup (literal_colors, color) == color)
+        g_hash_table_remove (literal_colors, color);
+      break;
     case COLOR_TYPE_CURRENT_COLOR:
     default:
       break;
@@ -513,11 +550,29 @@ _gtk_css_color_value_new_literal (const GdkRGBA *color)
   if (gdk_rgba_equal (color, &transparent_black_singleton.sym_col.rgba))
     return _gtk_css_value_ref (&transparent_black_singleton);
 
+  if (gtk_css_color_value_can_intern (color))
+    {
+      GtkCssValue key;
+
+      if (literal_colors == NULL)
+        literal_colors = g_hash_table_new (gtk_css_color_value_literal_hash,
+                                           gtk_css_color_value_literal_equal);
+
+      key.sym_col.rgba = *color;
+
+      value = g_hash_table_lookup (literal_colors, &key);
+      if (value)
+        return _gtk_css_value_ref (value);
+    }
+
   value = _gtk_css_value_new (GtkCssValue, &GTK_CSS_VALUE_COLOR);
   value->type = COLOR_TYPE_LITERAL;
   value->is_computed = TRUE;
   value->sym_col.rgba = *color;
 
+  if (gtk_css_color_value_can_intern (color))
+    g_hash_table_add (literal_colors, value);
+
   return value;
 }
 
@@ -121,9 +121,29 @@ gtk_css_image_real_is_computed (GtkCssImage *image)
   return FALSE;
 }
 
+static void
+gtk_css_image_dispose (GObject *object)
+{
+  GtkCssImage *image = GTK_CSS_IMAGE (object);
+  guint i;
+
+  if (image->cache)
+    {
+      for (i = 0; i < GTK_CSS_IMAGE_N_CACHED_NODES; i++)
+        g_clear_pointer (&image->cache[i].node, gsk_render_node_unref);
+      g_clear_pointer (&image->cache, g_free);
+    }
+
+  G_OBJECT_CLASS (_gtk_css_image_parent_class)->dispose (object);
+}
+
 static void
 _gtk_css_image_class_init (GtkCssImageClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = gtk_css_image_dispose;
+
   klass->get_width = gtk_css_image_real_get_width;
   klass->get_height = gtk_css_image_real_get_height;
   klass->get_aspect_ratio = gtk_css_image_real_get_aspect_ratio;
@@ -271,6 +291,50 @@ _gtk_css_image_draw (GtkCssImage        *image,
   cairo_restore (cr);
 }
 
+/* Computed images are shared by all widgets with the same style, so
+ * keeping their render nodes lets all of them append the same node.
+ * That saves creating the nodes, and lets renderers reuse what they
+ * cache for a node, like the recolored texture of a symbolic icon.
+ */
+static void
+gtk_css_image_snapshot_cached (GtkCssImage *image,
+                               GtkSnapshot *snapshot,
+                               double       width,
+                               double       height)
+{
+  GtkCssImageCachedNode *cached;
+  GtkSnapshot *image_snapshot;
+  guint i;
+
+  if (image->cache == NULL)
+    image->cache = g_new0 (GtkCssImageCachedNode, GTK_CSS_IMAGE_N_CACHED_NODES);
+
+  for (i = 0; i < GTK_CSS_IMAGE_N_CACHED_NODES; i++)
+    {
+      cached = &image->cache[i];
+
+      if (cached->node && cached->width == width && cached->height == height)
+        {
+          gtk_snapshot_append_node (snapshot, cached->node);
+          return;
+        }
+    }
+
+  image_snapshot = gtk_snapshot_new ();
+  GTK_CSS_IMAGE_GET_CLASS (image)->snapshot (image, image_snapshot, width, height);
+
+  cached = &image->cache[image->next_cache_slot];
+  image->next_cache_slot = (image->next_cache_slot + 1) % GTK_CSS_IMAGE_N_CACHED_NODES;
+
+  g_clear_pointer (&cached->node, gsk_render_node_unref);
+  cached->node = gtk_snapshot_free_to_node (image_snapshot);
+  cached->width = width;
+  cached->height = height;
+
+  if (cached->node)
+    gtk_snapshot_append_node (snapshot, cached->node);
+}
+
 void
 gtk_css_image_snapshot (GtkCssImage *image,
                         GtkSnapshot *snapshot,
@@ -286,6 +350,12 @@ gtk_css_image_snapshot (GtkCssImage *image,
 
   klass = GTK_CSS_IMAGE_GET_CLASS (image);
 
+  if (klass->cache_snapshots && !gtk_css_image_is_dynamic (image))
+    {
+      gtk_css_image_snapshot_cached (image, snapshot, width, height);
+      return;
+    }
+
   klass->snapshot (image, snapshot, width, height);
 }
 
@@ -441,6 +441,7 @@ gtk_css_image_cross_fade_class_init (GtkCssImageCrossFadeClass *klass)
   image_class->compute = gtk_css_image_cross_fade_compute;
   image_class->equal = gtk_css_image_cross_fade_equal;
   image_class->snapshot = gtk_css_image_cross_fade_snapshot;
+  image_class->cache_snapshots = TRUE;
   image_class->is_dynamic = gtk_css_image_cross_fade_is_dynamic;
   image_class->get_dynamic_image = gtk_css_image_cross_fade_get_dynamic_image;
   image_class->parse = gtk_css_image_cross_fade_parse;
@@ -698,6 +698,7 @@ _gtk_css_image_linear_class_init (GtkCssImageLinearClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   image_class->snapshot = gtk_css_image_linear_snapshot;
+  image_class->cache_snapshots = TRUE;
   image_class->parse = gtk_css_image_linear_parse;
   image_class->print = gtk_css_image_linear_print;
   image_class->compute = gtk_css_image_linear_compute;
@@ -40,9 +40,22 @@ G_BEGIN_DECLS
 typedef struct _GtkCssImage           GtkCssImage;
 typedef struct _GtkCssImageClass      GtkCssImageClass;
 
+#define GTK_CSS_IMAGE_N_CACHED_NODES 4
+
+typedef struct
+{
+  GskRenderNode *node;
+  double width;
+  double height;
+} GtkCssImageCachedNode;
+
 struct _GtkCssImage
 {
   GObject parent;
+
+  /* Snapshots of images that set cache_snapshots, by size */
+  GtkCssImageCachedNode *cache;
+  guint next_cache_slot;
 };
 
 struct _GtkCssImageClass
@@ -90,6 +103,9 @@ struct _GtkCssImageClass
   void         (* print)                           (GtkCssImage                *image,
                                                     GString                    *string);
   gboolean     (* is_computed)                     (GtkCssImage                *image);
+
+  /* if the result of snapshot() only depends on the size and can be reused */
+  gboolean     cache_snapshots;
 };
 
 GType          _gtk_css_image_get_type             (void) G_GNUC_CONST;
@@ -21,6 +21,7 @@
 
 #include "gtkcssstaticstyleprivate.h"
 #include "gtkcssanimatedstyleprivate.h"
+#include "gtkcssselectorprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkintl.h"
 #include "gtkmarshalers.h"
@@ -96,6 +97,9 @@
  */
 #define GTK_CSS_CHANGE_NEEDS_RECOMPUTE (GTK_CSS_RADICAL_CHANGE & ~GTK_CSS_CHANGE_PARENT_STYLE)
 
+/* The changes of a node that its next siblings can depend on */
+#define GTK_CSS_SIBLING_CHANGE (GTK_CSS_CHANGE_ANY_SIBLING | GTK_CSS_CHANGE_NTH_CHILD | GTK_CSS_CHANGE_NTH_LAST_CHILD)
+
 G_DEFINE_TYPE (GtkCssNode, gtk_css_node, G_TYPE_OBJECT)
 
 enum {
@@ -126,8 +130,13 @@ gtk_css_node_get_style_provider_or_null (GtkCssNode *cssnode)
 
 static int invalidated_nodes;
 static int created_styles;
+static int animated_nodes;
+static guint style_cache_hits;
+static guint style_cache_misses;
+static guint style_cache_shared;
 static guint invalidated_nodes_counter;
 static guint created_styles_counter;
+static guint animated_nodes_counter;
 
 static void
 gtk_css_node_set_invalid (GtkCssNode *node,
@@ -304,6 +313,33 @@ may_use_global_parent_cache (GtkCssNode *node)
   return TRUE;
 }
 
+/* Creates the cache for the children of a node whose style did not
+ * come from its parent's cache.
+ */
+static GtkCssNodeStyleCache *
+gtk_css_node_create_style_cache (GtkCssNode *node)
+{
+  GtkCssNode *parent = node->parent;
+  GtkCssNodeStyleCache *cache;
+  gboolean reused;
+
+  if (parent == NULL ||
+      parent->cache == NULL ||
+      !may_use_global_parent_cache (node))
+    return gtk_css_node_style_cache_new (node->style);
+
+  cache = gtk_css_node_style_cache_share (parent->cache,
+                                          node->decl,
+                                          gtk_css_node_is_first_child (node),
+                                          gtk_css_node_is_last_child (node),
+                                          node->style,
+                                          &reused);
+  if (reused)
+    style_cache_shared++;
+
+  return cache;
+}
+
 static GtkCssStyle *
 lookup_in_global_parent_cache (GtkCssNode                  *node,
                                const GtkCssNodeDeclaration *decl)
@@ -317,7 +353,7 @@ lookup_in_global_parent_cache (GtkCssNode                  *node,
     return NULL;
 
   if (parent->cache == NULL)
-    return NULL;
+    parent->cache = gtk_css_node_create_style_cache (parent);
 
   g_assert (node->cache == NULL);
   node->cache = gtk_css_node_style_cache_lookup (parent->cache,
@@ -325,7 +361,12 @@ lookup_in_global_parent_cache (GtkCssNode                  *node,
                                                  gtk_css_node_is_first_child (node),
                                                  gtk_css_node_is_last_child (node));
   if (node->cache == NULL)
-    return NULL;
+    {
+      style_cache_misses++;
+      return NULL;
+    }
+
+  style_cache_hits++;
 
   return gtk_css_node_style_cache_get_style (node->cache);
 }
@@ -346,7 +387,7 @@ store_in_global_parent_cache (GtkCssNode                  *node,
     return;
 
   if (parent->cache == NULL)
-    parent->cache = gtk_css_node_style_cache_new (parent->style);
+    parent->cache = gtk_css_node_create_style_cache (parent);
 
   node->cache = gtk_css_node_style_cache_insert (parent->cache,
                                                  (GtkCssNodeDeclaration *) decl,
@@ -355,12 +396,55 @@ store_in_global_parent_cache (GtkCssNode                  *node,
                                                  style);
 }
 
+/* Matching selectors only reads the node tree and the style providers,
+ * so when many siblings need new styles - like after a theme change -
+ * we match them in parallel before validating them one after another.
+ * Computing the values stays on the main thread.
+ */
+#define MIN_PARALLEL_LOOKUPS 16
+#define MAX_PARALLEL_LOOKUPS 256
+#define MAX_SCANNED_SIBLINGS 1024
+#define MAX_LOOKUP_THREADS 4
+
+struct _GtkCssNodeLookup
+{
+  GtkCssNode *node;
+  GtkStyleProvider *provider;
+  GtkCssChange pending_changes;
+  GtkCssChange style_change;
+  GtkCssChange change;
+  GtkCssLookup lookup;
+};
+
+static GtkCssChange
+gtk_css_node_get_style_change (GtkCssNode   *cssnode,
+                               GtkCssChange  change)
+{
+  if (change & GTK_CSS_CHANGE_NEEDS_RECOMPUTE)
+    {
+      /* Need to recompute the change flags, unless a sibling
+       * that only differs in state or position did that already */
+      if (cssnode->parent == NULL ||
+          cssnode->parent->cache == NULL ||
+          !may_use_global_parent_cache (cssnode))
+        return 0;
+
+      return gtk_css_node_style_cache_lookup_change (cssnode->parent->cache, cssnode->decl);
+    }
+  else
+    {
+      return gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
+    }
+}
+
 static GtkCssStyle *
 gtk_css_node_create_style (GtkCssNode                   *cssnode,
                            const GtkCountingBloomFilter *filter,
                            GtkCssChange                  change)
 {
   const GtkCssNodeDeclaration *decl;
+  GtkCssNodeLookup *lookup;
+  GtkStyleProvider *provider;
   GtkCssStyle *style;
   GtkCssChange style_change;
 
@@ -372,20 +456,38 @@ gtk_css_node_create_style (GtkCssNode                   *cssnode,
 
   created_styles++;
 
-  if (change & GTK_CSS_CHANGE_NEEDS_RECOMPUTE)
+  style_change = gtk_css_node_get_style_change (cssnode, change);
+  provider = gtk_css_node_get_style_provider (cssnode);
+
+  lookup = cssnode->lookup;
+  cssnode->lookup = NULL;
+
+  /* A sibling may have cached the change flags after the lookup
+   * was done, the ones from the lookup are just as good. */
+  if (lookup &&
+      lookup->provider == provider &&
+      lookup->pending_changes == change &&
+      (lookup->style_change == style_change || lookup->style_change == 0))
     {
-      /* Need to recompute the change flags */
-      style_change = 0;
+      style_change = lookup->style_change;
+      style = gtk_css_static_style_new_from_lookup (provider,
+                                                    cssnode,
+                                                    &lookup->lookup,
+                                                    style_change ? style_change : lookup->change);
     }
   else
-    {
-      style_change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
-    }
-
-  style = gtk_css_static_style_new_compute (gtk_css_node_get_style_provider (cssnode),
-                                            filter,
-                                            cssnode,
-                                            style_change);
+    style = gtk_css_static_style_new_compute (provider,
+                                              filter,
+                                              cssnode,
+                                              style_change);
+
+  if (style_change == 0 &&
+      cssnode->parent &&
+      cssnode->parent->cache &&
+      may_use_global_parent_cache (cssnode))
+    gtk_css_node_style_cache_insert_change (cssnode->parent->cache,
+                                            (GtkCssNodeDeclaration *) decl,
+                                            gtk_css_static_style_get_change (GTK_CSS_STATIC_STYLE (style)));
 
   store_in_global_parent_cache (cssnode, decl, style);
 
@@ -414,6 +516,216 @@ gtk_css_style_needs_recreation (GtkCssStyle  *style,
     return FALSE;
 }
 
+typedef struct
+{
+  const GtkCountingBloomFilter *filter;
+  GtkCssNodeLookup *lookups;
+  int n_lookups;
+  int next_lookup; /* (atomic) */
+  int n_workers;
+  GMutex mutex;
+  GCond cond;
+} GtkCssLookupBatch;
+
+static void
+gtk_css_lookup_batch_run (GtkCssLookupBatch *batch)
+{
+  int i;
+
+  while ((i = g_atomic_int_add (&batch->next_lookup, 1)) < batch->n_lookups)
+    {
+      GtkCssNodeLookup *lookup = &batch->lookups[i];
+
+      gtk_style_provider_lookup (lookup->provider,
+                                 batch->filter,
+                                 lookup->node,
+                                 &lookup->lookup,
+                                 lookup->style_change == 0 ? &lookup->change : NULL);
+    }
+}
+
+static void
+gtk_css_lookup_batch_worker (gpointer data,
+                             gpointer user_data)
+{
+  GtkCssLookupBatch *batch = data;
+
+  gtk_css_lookup_batch_run (batch);
+
+  g_mutex_lock (&batch->mutex);
+  batch->n_workers--;
+  g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->mutex);
+}
+
+static GThreadPool *
+gtk_css_node_get_lookup_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      int n_threads = MIN (g_get_num_processors () - 1, MAX_LOOKUP_THREADS);
+
+      if (n_threads > 0 && g_getenv ("GTK_CSS_NO_THREADS") == NULL)
+        pool = g_thread_pool_new (gtk_css_lookup_batch_worker, NULL,
+                                  n_threads, FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+static gboolean
+gtk_css_node_wants_lookup (GtkCssNode *cssnode,
+                           GHashTable *decls)
+{
+  GtkCssNodeDeclaration *decl = cssnode->decl;
+  GtkCssNode *parent = cssnode->parent;
+
+  if (!cssnode->style_is_invalid ||
+      cssnode->lookup != NULL ||
+      !gtk_css_style_needs_recreation (GTK_CSS_STYLE (gtk_css_style_get_static_style (cssnode->style)),
+                                       cssnode->pending_changes))
+    return FALSE;
+
+  if (parent && may_use_global_parent_cache (cssnode))
+    {
+      /* The style of identical siblings will be shared, no need to
+       * match them more than once. */
+      if (g_hash_table_contains (decls, decl))
+        return FALSE;
+
+      if (parent->cache)
+        {
+          GtkCssNodeStyleCache *cache;
+
+          cache = gtk_css_node_style_cache_lookup (parent->cache,
+                                                   decl,
+                                                   gtk_css_node_is_first_child (cssnode),
+                                                   gtk_css_node_is_last_child (cssnode));
+          if (cache)
+            {
+              gtk_css_node_style_cache_unref (cache);
+              return FALSE;
+            }
+        }
+
+      g_hash_table_add (decls, decl);
+    }
+
+  return TRUE;
+}
+
+static void
+gtk_css_lookup_batch_free (GtkCssLookupBatch *batch)
+{
+  int i;
+
+  for (i = 0; i < batch->n_lookups; i++)
+    {
+      GtkCssNodeLookup *lookup = &batch->lookups[i];
+
+      if (lookup->node->lookup == lookup)
+        lookup->node->lookup = NULL;
+      _gtk_css_lookup_destroy (&lookup->lookup);
+      g_object_unref (lookup->node);
+    }
+
+  g_free (batch->lookups);
+  g_mutex_clear (&batch->mutex);
+  g_cond_clear (&batch->cond);
+  g_free (batch);
+}
+
+/* Scans the siblings starting at @first and does the selector matching
+ * for the ones that will need a new style. @next_scan is set to the
+ * first visible sibling that was not looked at.
+ */
+static GtkCssLookupBatch *
+gtk_css_lookup_batch_new (GtkCssNode                   *first,
+                          const GtkCountingBloomFilter *filter,
+                          GtkCssNode                  **next_scan)
+{
+  GtkCssLookupBatch *batch;
+  GThreadPool *pool;
+  GPtrArray *nodes;
+  GHashTable *decls;
+  GtkCssNode *node;
+  int i, n_scanned;
+
+  *next_scan = NULL;
+
+  pool = gtk_css_node_get_lookup_pool ();
+  if (pool == NULL)
+    return NULL;
+
+  nodes = g_ptr_array_new ();
+  decls = g_hash_table_new (gtk_css_node_declaration_hash, gtk_css_node_declaration_equal);
+
+  for (node = first, n_scanned = 0;
+       node && n_scanned < MAX_SCANNED_SIBLINGS && nodes->len < MAX_PARALLEL_LOOKUPS;
+       node = node->next_sibling)
+    {
+      if (!node->visible)
+        continue;
+
+      n_scanned++;
+      if (gtk_css_node_wants_lookup (node, decls))
+        g_ptr_array_add (nodes, node);
+    }
+
+  while (node && !node->visible)
+    node = node->next_sibling;
+  *next_scan = node;
+
+  g_hash_table_unref (decls);
+
+  if (nodes->len < MIN_PARALLEL_LOOKUPS)
+    {
+      g_ptr_array_unref (nodes);
+      return NULL;
+    }
+
+  batch = g_new0 (GtkCssLookupBatch, 1);
+  batch->filter = filter;
+  batch->n_lookups = nodes->len;
+  batch->lookups = g_new (GtkCssNodeLookup, nodes->len);
+  g_mutex_init (&batch->mutex);
+  g_cond_init (&batch->cond);
+
+  for (i = 0; i < batch->n_lookups; i++)
+    {
+      GtkCssNodeLookup *lookup = &batch->lookups[i];
+
+      node = g_ptr_array_index (nodes, i);
+      lookup->node = g_object_ref (node);
+      lookup->provider = gtk_css_node_get_style_provider (node);
+      lookup->pending_changes = node->pending_changes;
+      lookup->style_change = gtk_css_node_get_style_change (node, node->pending_changes);
+      lookup->change = 0;
+      _gtk_css_lookup_init (&lookup->lookup);
+      node->lookup = lookup;
+    }
+  g_ptr_array_unref (nodes);
+
+  batch->n_workers = MIN (g_thread_pool_get_max_threads (pool),
+                          batch->n_lookups / MIN_PARALLEL_LOOKUPS);
+  for (i = 0; i < batch->n_workers; i++)
+    g_thread_pool_push (pool, batch, NULL);
+
+  gtk_css_lookup_batch_run (batch);
+
+  g_mutex_lock (&batch->mutex);
+  while (batch->n_workers > 0)
+    g_cond_wait (&batch->cond, &batch->mutex);
+  g_mutex_unlock (&batch->mutex);
+
+  return batch;
+}
+
 static GtkCssStyle *
 gtk_css_node_real_update_style (GtkCssNode                   *cssnode,
                                 const GtkCountingBloomFilter *filter,
@@ -448,6 +760,7 @@ gtk_css_node_real_update_style (GtkCssNode                   *cssnode,
       new_style = gtk_css_animated_style_new_advance (GTK_CSS_ANIMATED_STYLE (style),
                                                       static_style,
                                                       timestamp);
+      animated_nodes++;
     }
   else
     {
@@ -631,6 +944,7 @@ gtk_css_node_class_init (GtkCssNodeClass *klass)
     {
       invalidated_nodes_counter = gdk_profiler_define_int_counter ("invalidated-nodes", "CSS Node Invalidations");
       created_styles_counter = gdk_profiler_define_int_counter ("created-styles", "CSS Style Creations");
+      animated_nodes_counter = gdk_profiler_define_int_counter ("animated-nodes", "CSS Nodes Advanced By Animations");
     }
 }
 
@@ -708,6 +1022,25 @@ gtk_css_node_invalidate_style (GtkCssNode *cssnode)
     gtk_css_node_invalidate_style (cssnode->next_sibling);
 }
 
+/* Lets the ancestors of @cssnode know which of their changes the
+ * styles below them depend on. This is never reset, so it may
+ * contain more than necessary.
+ */
+static void
+gtk_css_node_update_descendant_change (GtkCssNode *cssnode)
+{
+  GtkCssChange change;
+  GtkCssNode *parent;
+
+  change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
+  change = (change | cssnode->descendant_change) & (GTK_CSS_CHANGE_ANY_PARENT | GTK_CSS_CHANGE_ANY_PARENT_SIBLING);
+
+  for (parent = cssnode->parent;
+       parent && (parent->descendant_change & change) != change;
+       parent = parent->parent)
+    parent->descendant_change |= change;
+}
+
 static void
 gtk_css_node_reposition (GtkCssNode *node,
                          GtkCssNode *new_parent,
@@ -772,6 +1105,7 @@ gtk_css_node_reposition (GtkCssNode *node,
   if (new_parent)
     {
       g_signal_emit (new_parent, cssnode_signals[NODE_ADDED], 0, node, previous);
+      gtk_css_node_update_descendant_change (node);
       if (node->visible)
         gtk_css_node_invalidate (new_parent->first_child, GTK_CSS_CHANGE_NTH_LAST_CHILD);
     }
@@ -915,11 +1249,26 @@ gtk_css_node_set_style (GtkCssNode  *cssnode,
   return style_changed;
 }
 
+/* Checks if the style of @cssnode or one of its descendants may
+ * depend on the changes of its previous siblings in @change.
+ */
+static gboolean
+gtk_css_node_depends_on_siblings (GtkCssNode   *cssnode,
+                                  GtkCssChange  change)
+{
+  GtkCssChange style_change;
+
+  style_change = gtk_css_static_style_get_change (gtk_css_style_get_static_style (cssnode->style));
+
+  return (style_change & change) != 0 ||
+         (cssnode->descendant_change & _gtk_css_change_for_child (change)) != 0;
+}
+
 static void
 gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
                                         gboolean    style_changed)
 {
-  GtkCssChange change, child_change;
+  GtkCssChange change, sibling_change, child_change;
   GtkCssNode *child;
 
   change = _gtk_css_change_for_child (cssnode->pending_changes);
@@ -929,14 +1278,22 @@ gtk_css_node_propagate_pending_changes (GtkCssNode *cssnode,
   if (!cssnode->needs_propagation && change == 0)
     return;
 
+  /* Changes of previous siblings, like inserting one, only go to
+   * the nodes whose styles depend on them. Changes of the parent
+   * reach all children through @change already. */
+  sibling_change = 0;
+
   for (child = gtk_css_node_get_first_child (cssnode);
        child;
        child = gtk_css_node_get_next_sibling (child))
     {
       child_change = child->pending_changes;
-      gtk_css_node_invalidate (child, change);
+      if (sibling_change != 0 && gtk_css_node_depends_on_siblings (child, sibling_change))
+        gtk_css_node_invalidate (child, change | sibling_change);
+      else
+        gtk_css_node_invalidate (child, change);
       if (child->visible)
-        change |= _gtk_css_change_for_sibling (child_change);
+        sibling_change |= _gtk_css_change_for_sibling (child_change) & GTK_CSS_SIBLING_CHANGE;
     }
 
   cssnode->needs_propagation = FALSE;
@@ -976,6 +1333,7 @@ gtk_css_node_do_ensure_style (GtkCssNode                   *cssnode,
     }
 
   gtk_css_node_propagate_pending_changes (cssnode, style_changed);
+  gtk_css_node_update_descendant_change (cssnode);
 
   cssnode->pending_changes = 0;
   cssnode->style_is_invalid = FALSE;
@@ -1271,6 +1629,32 @@ gtk_css_node_invalidate_style_provider (GtkCssNode *cssnode)
     }
 }
 
+/* Like gtk_css_node_invalidate_style_provider(), for when only the
+ * rulesets with the given selectors changed. Nodes that none of them
+ * may match keep their style. The style caches are dropped for all
+ * nodes though, as they can hold styles for other states of the
+ * children that the changed rulesets apply to.
+ */
+void
+gtk_css_node_invalidate_style_provider_selectors (GtkCssNode               *cssnode,
+                                                  const GtkCssSelectorTree *selectors)
+{
+  GtkCssNode *child;
+
+  g_clear_pointer (&cssnode->cache, gtk_css_node_style_cache_unref);
+
+  if (gtk_css_selector_tree_may_match (selectors, cssnode))
+    gtk_css_node_invalidate (cssnode, GTK_CSS_CHANGE_SOURCE);
+
+  for (child = cssnode->first_child;
+       child;
+       child = child->next_sibling)
+    {
+      if (gtk_css_node_get_style_provider_or_null (child) == NULL)
+        gtk_css_node_invalidate_style_provider_selectors (child, selectors);
+    }
+}
+
 static void
 gtk_css_node_invalidate_timestamp (GtkCssNode *cssnode)
 {
@@ -1313,6 +1697,8 @@ gtk_css_node_invalidate (GtkCssNode   *cssnode,
     return;
 
   cssnode->pending_changes |= change;
+  /* The selectors matched ahead of time may not apply anymore */
+  cssnode->lookup = NULL;
 
   if (cssnode->parent)
     cssnode->parent->needs_propagation = TRUE;
@@ -1324,7 +1710,8 @@ gtk_css_node_validate_internal (GtkCssNode             *cssnode,
                                 GtkCountingBloomFilter *filter,
                                 gint64                  timestamp)
 {
-  GtkCssNode *child;
+  GtkCssLookupBatch *batch = NULL;
+  GtkCssNode *child, *next_scan = NULL;
   gboolean bloomed = FALSE;
 
   if (!cssnode->invalid)
@@ -1350,11 +1737,20 @@ gtk_css_node_validate_internal (GtkCssNode             *cssnode,
         {
           gtk_css_node_declaration_add_bloom_hashes (cssnode->decl, filter);
           bloomed = TRUE;
+          next_scan = child;
+        }
+
+      if (child == next_scan)
+        {
+          g_clear_pointer (&batch, gtk_css_lookup_batch_free);
+          batch = gtk_css_lookup_batch_new (child, filter, &next_scan);
         }
 
       gtk_css_node_validate_internal (child, filter, timestamp);
     }
 
+  g_clear_pointer (&batch, gtk_css_lookup_batch_free);
+
   if (bloomed)
     gtk_css_node_declaration_remove_bloom_hashes (cssnode->decl, filter);
 }
@@ -1366,7 +1762,7 @@ gtk_css_node_validate (GtkCssNode *cssnode)
   gint64 timestamp;
   gint64 before G_GNUC_UNUSED;
 
-  before = GDK_PROFILER_CURRENT_TIME;
+  before = gdk_profiler_trace_begin ();
 
   g_assert (cssnode->parent == NULL);
 
@@ -1374,16 +1770,40 @@ gtk_css_node_validate (GtkCssNode *cssnode)
 
   gtk_css_node_validate_internal (cssnode, &filter, timestamp);
 
-  if (GDK_PROFILER_IS_RUNNING)
+  if (before != 0)
     {
-      gdk_profiler_end_mark (before,  "css validation", "");
+      if (animated_nodes > 0)
+        gdk_profiler_end_markf (before, "css validation", "%d animated nodes", animated_nodes);
+      else
+        gdk_profiler_end_mark (before,  "css validation", "");
       gdk_profiler_set_int_counter (invalidated_nodes_counter, invalidated_nodes);
       gdk_profiler_set_int_counter (created_styles_counter, created_styles);
+      gdk_profiler_set_int_counter (animated_nodes_counter, animated_nodes);
       invalidated_nodes = 0;
       created_styles = 0;
+      animated_nodes = 0;
     }
 }
 
+/*
+ * gtk_css_node_get_style_cache_statistics:
+ * @hits: (out): number of styles found in the style caches
+ * @misses: (out): number of styles that had to be computed
+ * @shared: (out): number of style caches shared between siblings
+ *
+ * Gets the number of style cache lookups since the application
+ * started, for debugging purposes.
+ */
+void
+gtk_css_node_get_style_cache_statistics (guint *hits,
+                                         guint *misses,
+                                         guint *shared)
+{
+  *hits = style_cache_hits;
+  *misses = style_cache_misses;
+  *shared = style_cache_shared;
+}
+
 GtkStyleProvider *
 gtk_css_node_get_style_provider (GtkCssNode *cssnode)
 {
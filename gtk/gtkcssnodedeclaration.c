@@ -347,7 +347,7 @@ gtk_css_node_declaration_remove_bloom_hashes (const GtkCssNodeDeclaration *decl,
 }
 
 guint
-gtk_css_node_declaration_hash (gconstpointer elem)
+gtk_css_node_declaration_hash_without_state (gconstpointer elem)
 {
   const GtkCssNodeDeclaration *decl = elem;
   guint hash, i;
@@ -362,14 +362,23 @@ gtk_css_node_declaration_hash (gconstpointer elem)
       hash += decl->classes[i];
     }
 
-  hash ^= decl->state;
-
   return hash;
 }
 
+guint
+gtk_css_node_declaration_hash (gconstpointer elem)
+{
+  const GtkCssNodeDeclaration *decl = elem;
+
+  return gtk_css_node_declaration_hash_without_state (decl) ^ decl->state;
+}
+
+/* Compares everything that selectors can match without
+ * looking at the state, for caching the change flags.
+ */
 gboolean
-gtk_css_node_declaration_equal (gconstpointer elem1,
-                                gconstpointer elem2)
+gtk_css_node_declaration_equal_without_state (gconstpointer elem1,
+                                              gconstpointer elem2)
 {
   const GtkCssNodeDeclaration *decl1 = elem1;
   const GtkCssNodeDeclaration *decl2 = elem2;
@@ -381,9 +390,6 @@ gtk_css_node_declaration_equal (gconstpointer elem1,
   if (decl1->name != decl2->name)
     return FALSE;
 
-  if (decl1->state != decl2->state)
-    return FALSE;
-
   if (decl1->id != decl2->id)
     return FALSE;
 
@@ -399,6 +405,22 @@ gtk_css_node_declaration_equal (gconstpointer elem1,
   return TRUE;
 }
 
+gboolean
+gtk_css_node_declaration_equal (gconstpointer elem1,
+                                gconstpointer elem2)
+{
+  const GtkCssNodeDeclaration *decl1 = elem1;
+  const GtkCssNodeDeclaration *decl2 = elem2;
+
+  if (decl1 == decl2)
+    return TRUE;
+
+  if (decl1->state != decl2->state)
+    return FALSE;
+
+  return gtk_css_node_declaration_equal_without_state (decl1, decl2);
+}
+
 static int
 cmpstr (gconstpointer a,
         gconstpointer b,
@@ -56,6 +56,9 @@ void                    gtk_css_node_declaration_remove_bloom_hashes    (const G
 guint                   gtk_css_node_declaration_hash                   (gconstpointer                  elem);
 gboolean                gtk_css_node_declaration_equal                  (gconstpointer                  elem1,
                                                                          gconstpointer                  elem2);
+guint                   gtk_css_node_declaration_hash_without_state     (gconstpointer                  elem);
+gboolean                gtk_css_node_declaration_equal_without_state    (gconstpointer                  elem1,
+                                                                         gconstpointer                  elem2);
 
 void                    gtk_css_node_declaration_print                  (const GtkCssNodeDeclaration   *decl,
                                                                          GString                       *string);
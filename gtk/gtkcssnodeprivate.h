@@ -36,6 +36,7 @@ G_BEGIN_DECLS
 #define GTK_CSS_NODE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GTK_TYPE_CSS_NODE, GtkCssNodeClass))
 
 typedef struct _GtkCssNodeClass         GtkCssNodeClass;
+typedef struct _GtkCssNodeLookup        GtkCssNodeLookup;
 
 struct _GtkCssNode
 {
@@ -50,8 +51,10 @@ struct _GtkCssNode
   GtkCssNodeDeclaration *decl;
   GtkCssStyle           *style;
   GtkCssNodeStyleCache  *cache;                 /* cache for children to look up styles */
+  GtkCssNodeLookup      *lookup;                /* selector matches done ahead of time while validating */
 
   GtkCssChange           pending_changes;       /* changes that accumulated since the style was last computed */
+  GtkCssChange           descendant_change;     /* changes to this node or its siblings that descendants may depend on */
 
   guint                  visible :1;            /* node will be skipped when validating or computing styles */
   guint                  invalid :1;            /* node or a child needs to be validated (even if just for animation) */
@@ -143,12 +146,19 @@ GtkCssStyle *           gtk_css_node_get_style          (GtkCssNode            *
 
 void                    gtk_css_node_invalidate_style_provider
                                                         (GtkCssNode            *cssnode);
+void                    gtk_css_node_invalidate_style_provider_selectors
+                                                        (GtkCssNode            *cssnode,
+                                                         const GtkCssSelectorTree *selectors);
 void                    gtk_css_node_invalidate_frame_clock
                                                         (GtkCssNode            *cssnode,
                                                          gboolean               just_timestamp);
 void                    gtk_css_node_invalidate         (GtkCssNode            *cssnode,
                                                          GtkCssChange           change);
 void                    gtk_css_node_validate           (GtkCssNode            *cssnode);
+void                    gtk_css_node_get_style_cache_statistics
+                                                        (guint                 *hits,
+                                                         guint                 *misses,
+                                                         guint                 *shared);
 
 GtkStyleProvider *      gtk_css_node_get_style_provider (GtkCssNode            *cssnode) G_GNUC_PURE;
 
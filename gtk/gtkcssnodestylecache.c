@@ -21,11 +21,28 @@
 
 #include "gtkdebug.h"
 #include "gtkcssstaticstyleprivate.h"
+#include "gtkcssvalueprivate.h"
+
+/* Caches are nested following the declarations of the node tree, so
+ * children of nodes with the same style can share their styles.
+ *
+ * Nodes whose style could not be stored in their parent's cache - for
+ * example because it depends on :nth-child() - still get a cache for
+ * their children. Those caches are shared between siblings if the
+ * siblings have equal declarations and styles. Styles stored below
+ * such a shared cache must not depend on the position or siblings of
+ * their ancestors, as those differ between the siblings.
+ */
+
+#define MAX_SHARED_VARIANTS 8
 
 struct _GtkCssNodeStyleCache {
   guint        ref_count;
   GtkCssStyle *style;
   GHashTable  *children;
+  GHashTable  *shared;     /* decl => GPtrArray of caches for differing styles */
+  GHashTable  *changes;    /* decl without state => GtkCssChange of the children */
+  guint        below_shared : 1;
 };
 
 #define UNPACK_DECLARATION(packed) ((GtkCssNodeDeclaration *) (GPOINTER_TO_SIZE (packed) & ~0x3))
@@ -64,6 +81,10 @@ gtk_css_node_style_cache_unref (GtkCssNodeStyleCache *cache)
   g_object_unref (cache->style);
   if (cache->children)
     g_hash_table_unref (cache->children);
+  if (cache->shared)
+    g_hash_table_unref (cache->shared);
+  if (cache->changes)
+    g_hash_table_unref (cache->changes);
 
   g_slice_free (GtkCssNodeStyleCache, cache);
 }
@@ -75,7 +96,8 @@ gtk_css_node_style_cache_get_style (GtkCssNodeStyleCache *cache)
 }
 
 static gboolean
-may_be_stored_in_cache (GtkCssStyle *style)
+may_be_stored_in_cache (GtkCssNodeStyleCache *parent,
+                        GtkCssStyle          *style)
 {
   GtkCssChange change;
 
@@ -108,6 +130,13 @@ may_be_stored_in_cache (GtkCssStyle *style)
   if (change & (GTK_CSS_CHANGE_NTH_CHILD | GTK_CSS_CHANGE_NTH_LAST_CHILD))
     return FALSE;
 
+  /* Shared caches are used by siblings in different positions. */
+  if (parent->below_shared &&
+      (change & (GTK_CSS_CHANGE_PARENT_NTH_CHILD |
+                 GTK_CSS_CHANGE_PARENT_NTH_LAST_CHILD |
+                 GTK_CSS_CHANGE_ANY_PARENT_SIBLING)))
+    return FALSE;
+
   return TRUE;
 }
 
@@ -144,7 +173,7 @@ gtk_css_node_style_cache_insert (GtkCssNodeStyleCache   *parent,
 {
   GtkCssNodeStyleCache *result;
 
-  if (!may_be_stored_in_cache (style))
+  if (!may_be_stored_in_cache (parent, style))
     return NULL;
 
   if (parent->children == NULL)
@@ -154,6 +183,7 @@ gtk_css_node_style_cache_insert (GtkCssNodeStyleCache   *parent,
                                               (GDestroyNotify) gtk_css_node_style_cache_unref);
 
   result = gtk_css_node_style_cache_new (style);
+  result->below_shared = parent->below_shared;
 
   g_hash_table_insert (parent->children,
                        PACK (gtk_css_node_declaration_ref (decl), is_first, is_last),
@@ -180,3 +210,137 @@ gtk_css_node_style_cache_lookup (GtkCssNodeStyleCache        *parent,
   return gtk_css_node_style_cache_ref (result);
 }
 
+
+static gboolean
+gtk_css_style_values_equal (GtkCssStyle *style1,
+                            GtkCssStyle *style2)
+{
+  guint i;
+
+  if (style1 == style2)
+    return TRUE;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (!_gtk_css_value_equal (gtk_css_style_get_value (style1, i),
+                                 gtk_css_style_get_value (style2, i)))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * gtk_css_node_style_cache_share:
+ * @parent: the cache of the parent node
+ * @decl: the declaration of the node
+ * @is_first: if the node is the first child
+ * @is_last: if the node is the last child
+ * @style: the style of the node
+ * @out_reused: (out): set to %TRUE if a sibling's cache was returned
+ *
+ * Gets a cache for the children of a node whose @style could not be
+ * inserted into @parent. If a previous sibling with the same
+ * declaration and equal style exists, its cache is returned.
+ *
+ * Returns: (transfer full): the cache to use for the node's children
+ */
+GtkCssNodeStyleCache *
+gtk_css_node_style_cache_share (GtkCssNodeStyleCache  *parent,
+                                GtkCssNodeDeclaration *decl,
+                                gboolean               is_first,
+                                gboolean               is_last,
+                                GtkCssStyle           *style,
+                                gboolean              *out_reused)
+{
+  GtkCssNodeStyleCache *result;
+  GPtrArray *variants;
+  guint i;
+
+  *out_reused = FALSE;
+
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return gtk_css_node_style_cache_new (style);
+#endif
+
+  if (!GTK_IS_CSS_STATIC_STYLE (style))
+    return gtk_css_node_style_cache_new (style);
+
+  if (parent->shared == NULL)
+    parent->shared = g_hash_table_new_full (gtk_css_node_style_cache_decl_hash,
+                                            gtk_css_node_style_cache_decl_equal,
+                                            gtk_css_node_style_cache_decl_free,
+                                            (GDestroyNotify) g_ptr_array_unref);
+
+  variants = g_hash_table_lookup (parent->shared, PACK (decl, is_first, is_last));
+  if (variants == NULL)
+    {
+      variants = g_ptr_array_new_with_free_func ((GDestroyNotify) gtk_css_node_style_cache_unref);
+      g_hash_table_insert (parent->shared,
+                           PACK (gtk_css_node_declaration_ref (decl), is_first, is_last),
+                           variants);
+    }
+
+  for (i = 0; i < variants->len; i++)
+    {
+      result = g_ptr_array_index (variants, i);
+
+      if (gtk_css_style_values_equal (result->style, style))
+        {
+          *out_reused = TRUE;
+          return gtk_css_node_style_cache_ref (result);
+        }
+    }
+
+  result = gtk_css_node_style_cache_new (style);
+  result->below_shared = TRUE;
+
+  if (variants->len < MAX_SHARED_VARIANTS)
+    g_ptr_array_add (variants, gtk_css_node_style_cache_ref (result));
+
+  return result;
+}
+
+/* The change flags of a style only depend on the name, id and classes
+ * of the node and on its ancestors, not on its state or position. So
+ * they can be shared between all children with those, even if their
+ * styles can't be, like for :nth-child() or when the state differs.
+ */
+void
+gtk_css_node_style_cache_insert_change (GtkCssNodeStyleCache  *parent,
+                                        GtkCssNodeDeclaration *decl,
+                                        GtkCssChange           change)
+{
+#ifdef G_ENABLE_DEBUG
+  if (GTK_DEBUG_CHECK (NO_CSS_CACHE))
+    return;
+#endif
+
+  if (parent->changes == NULL)
+    parent->changes = g_hash_table_new_full (gtk_css_node_declaration_hash_without_state,
+                                             gtk_css_node_declaration_equal_without_state,
+                                             (GDestroyNotify) gtk_css_node_declaration_unref,
+                                             g_free);
+
+  g_hash_table_insert (parent->changes,
+                       gtk_css_node_declaration_ref (decl),
+                       g_memdup (&change, sizeof (GtkCssChange)));
+}
+
+/* Returns 0 if the change flags are not known */
+GtkCssChange
+gtk_css_node_style_cache_lookup_change (GtkCssNodeStyleCache        *parent,
+                                        const GtkCssNodeDeclaration *decl)
+{
+  GtkCssChange *change;
+
+  if (parent->changes == NULL)
+    return 0;
+
+  change = g_hash_table_lookup (parent->changes, decl);
+  if (change == NULL)
+    return 0;
+
+  return *change;
+}
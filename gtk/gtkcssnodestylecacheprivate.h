@@ -40,6 +40,18 @@ GtkCssNodeStyleCache *  gtk_css_node_style_cache_lookup         (GtkCssNodeStyle
                                                                  const GtkCssNodeDeclaration *decl,
                                                                  gboolean                     is_first,
                                                                  gboolean                     is_last);
+GtkCssNodeStyleCache *  gtk_css_node_style_cache_share          (GtkCssNodeStyleCache   *parent,
+                                                                 GtkCssNodeDeclaration  *decl,
+                                                                 gboolean                is_first,
+                                                                 gboolean                is_last,
+                                                                 GtkCssStyle            *style,
+                                                                 gboolean               *out_reused);
+
+void                    gtk_css_node_style_cache_insert_change  (GtkCssNodeStyleCache        *parent,
+                                                                 GtkCssNodeDeclaration       *decl,
+                                                                 GtkCssChange                 change);
+GtkCssChange            gtk_css_node_style_cache_lookup_change  (GtkCssNodeStyleCache        *parent,
+                                                                 const GtkCssNodeDeclaration *decl);
 
 G_END_DECLS
 
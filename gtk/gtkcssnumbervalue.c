@@ -70,9 +70,39 @@ gtk_css_calc_value_new_from_array (GtkCssValue **values,
 }
 
 
+/* Dimensions that aren't singletons, so that equal values are usually
+ * the same object. The table doesn't hold a reference, values remove
+ * themselves when they are freed.
+ */
+static GHashTable *dimension_values;
+
+static guint
+gtk_css_dimension_value_hash (gconstpointer data)
+{
+  const GtkCssValue *value = data;
+
+  return g_double_hash (&value->dimension.value) ^ value->dimension.unit;
+}
+
+static gboolean
+gtk_css_dimension_value_equal (gconstpointer data1,
+                               gconstpointer data2)
+{
+  const GtkCssValue *value1 = data1;
+  const GtkCssValue *value2 = data2;
+
+  return value1->dimension.unit == value2->dimension.unit &&
+         value1->dimension.value == value2->dimension.value;
+}
+
 static void
 gtk_css_value_number_free (GtkCssValue *value)
 {
+  if (value->type == TYPE_DIMENSION &&
+      dimension_values != NULL &&
+      g_hash_table_lookup (dimension_values, value) == value)
+    g_hash_table_remove (dimension_values, value);
+
   g_slice_free (GtkCssValue, value);
 }
 
@@ -451,6 +481,24 @@ gtk_css_dimension_value_new (double     value,
       ;
     }
 
+  /* Zeros are left out so that 0 and -0 don't get merged */
+  if (value != 0 && !isnan (value))
+    {
+      GtkCssValue key;
+
+      if (dimension_values == NULL)
+        dimension_values = g_hash_table_new (gtk_css_dimension_value_hash,
+                                             gtk_css_dimension_value_equal);
+
+      key.type = TYPE_DIMENSION;
+      key.dimension.unit = unit;
+      key.dimension.value = value;
+
+      result = g_hash_table_lookup (dimension_values, &key);
+      if (result)
+        return _gtk_css_value_ref (result);
+    }
+
   result = _gtk_css_value_new (GtkCssValue, &GTK_CSS_VALUE_NUMBER);
   result->type = TYPE_DIMENSION;
   result->dimension.unit = unit;
@@ -460,6 +508,10 @@ gtk_css_dimension_value_new (double     value,
                         unit == GTK_CSS_PX ||
                         unit == GTK_CSS_DEG ||
                         unit == GTK_CSS_S;
+
+  if (value != 0 && !isnan (value))
+    g_hash_table_add (dimension_values, result);
+
   return result;
 }
 
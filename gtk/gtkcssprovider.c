@@ -151,6 +151,12 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
                                 GtkCssScanner  *scanner,
                                 GFile          *file,
                                 GBytes         *bytes);
+static void gtk_css_ruleset_print            (const GtkCssRuleset *ruleset,
+                                              GString             *str);
+static void gtk_css_provider_print_colors    (GHashTable          *colors,
+                                              GString             *str);
+static void gtk_css_provider_print_keyframes (GHashTable          *keyframes,
+                                              GString             *str);
 
 G_DEFINE_TYPE_EXTENDED (GtkCssProvider, gtk_css_provider, G_TYPE_OBJECT, 0,
                         G_ADD_PRIVATE (GtkCssProvider)
@@ -1075,6 +1081,230 @@ gtk_css_provider_load_internal (GtkCssProvider *self,
     }
 }
 
+/* Reloading a provider often changes just a few rulesets, for
+ * example when an application updates an accent color. To avoid
+ * restyling everything then, we take a snapshot of the printed
+ * rulesets before reloading and compare it with the new ones.
+ * Only nodes that a changed ruleset may apply to get restyled.
+ */
+typedef struct
+{
+  char *globals;          /* the colors and keyframes */
+  GPtrArray *rulesets;    /* the printed rulesets, in order */
+  GPtrArray *selectors;   /* the printed selectors of the rulesets */
+} GtkCssProviderSnapshot;
+
+static GtkCssProviderSnapshot *
+gtk_css_provider_snapshot_new (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+  GtkCssProviderSnapshot *snapshot;
+  GString *str;
+  guint i;
+
+  snapshot = g_slice_new (GtkCssProviderSnapshot);
+  snapshot->rulesets = g_ptr_array_new_full (priv->rulesets->len, g_free);
+  snapshot->selectors = g_ptr_array_new_full (priv->rulesets->len, g_free);
+
+  str = g_string_new (NULL);
+
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      const GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      gtk_css_ruleset_print (ruleset, str);
+      g_ptr_array_add (snapshot->rulesets, g_strdup (str->str));
+      g_string_truncate (str, 0);
+
+      _gtk_css_selector_tree_match_print (ruleset->selector_match, str);
+      g_ptr_array_add (snapshot->selectors, g_strdup (str->str));
+      g_string_truncate (str, 0);
+    }
+
+  gtk_css_provider_print_colors (priv->symbolic_colors, str);
+  gtk_css_provider_print_keyframes (priv->keyframes, str);
+  snapshot->globals = g_string_free (str, FALSE);
+
+  return snapshot;
+}
+
+static void
+gtk_css_provider_snapshot_free (GtkCssProviderSnapshot *snapshot)
+{
+  g_free (snapshot->globals);
+  g_ptr_array_unref (snapshot->rulesets);
+  g_ptr_array_unref (snapshot->selectors);
+  g_slice_free (GtkCssProviderSnapshot, snapshot);
+}
+
+/* Matches the rulesets of @from against the ones in @to, marking the
+ * ones without a counterpart as changed. Returns the unchanged ones,
+ * in order.
+ */
+static GPtrArray *
+collect_unchanged_rulesets (GtkCssProviderSnapshot *from,
+                            GtkCssProviderSnapshot *to,
+                            GPtrArray              *changed)
+{
+  GHashTable *counts;
+  GPtrArray *unchanged;
+  guint i;
+
+  counts = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < to->rulesets->len; i++)
+    {
+      gpointer ruleset = g_ptr_array_index (to->rulesets, i);
+
+      g_hash_table_insert (counts, ruleset,
+                           GUINT_TO_POINTER (GPOINTER_TO_UINT (g_hash_table_lookup (counts, ruleset)) + 1));
+    }
+
+  unchanged = g_ptr_array_new ();
+  for (i = 0; i < from->rulesets->len; i++)
+    {
+      gpointer ruleset = g_ptr_array_index (from->rulesets, i);
+      guint count = GPOINTER_TO_UINT (g_hash_table_lookup (counts, ruleset));
+
+      if (count > 0)
+        {
+          g_hash_table_insert (counts, ruleset, GUINT_TO_POINTER (count - 1));
+          g_ptr_array_add (unchanged, ruleset);
+        }
+      else
+        {
+          g_ptr_array_add (changed, g_ptr_array_index (from->selectors, i));
+        }
+    }
+
+  g_hash_table_unref (counts);
+
+  return unchanged;
+}
+
+/* Returns a tree of the selectors in @changed, or %NULL if
+ * that was not possible.
+ */
+static GtkCssSelectorTree *
+build_changed_tree (GPtrArray *changed)
+{
+  GtkCssSelectorTreeBuilder *builder;
+  GtkCssSelectorTree **matches;
+  GtkCssSelector **selectors;
+  GtkCssSelectorTree *tree = NULL;
+  guint i;
+
+  selectors = g_new0 (GtkCssSelector *, changed->len);
+  matches = g_new0 (GtkCssSelectorTree *, changed->len);
+
+  for (i = 0; i < changed->len; i++)
+    {
+      const char *text = g_ptr_array_index (changed, i);
+      GtkCssParser *parser;
+      GBytes *bytes;
+
+      bytes = g_bytes_new_static (text, strlen (text));
+      parser = gtk_css_parser_new_for_bytes (bytes, NULL, NULL, NULL, NULL, NULL);
+      selectors[i] = _gtk_css_selector_parse (parser);
+      gtk_css_parser_unref (parser);
+      g_bytes_unref (bytes);
+
+      if (selectors[i] == NULL)
+        goto out;
+    }
+
+  builder = _gtk_css_selector_tree_builder_new ();
+  for (i = 0; i < changed->len; i++)
+    _gtk_css_selector_tree_builder_add (builder, selectors[i], &matches[i], selectors[i]);
+  tree = _gtk_css_selector_tree_builder_build (builder);
+  _gtk_css_selector_tree_builder_free (builder);
+
+out:
+  for (i = 0; i < changed->len; i++)
+    g_clear_pointer (&selectors[i], _gtk_css_selector_free);
+  g_free (selectors);
+  g_free (matches);
+
+  return tree;
+}
+
+/* Emits the change since @old, which may be %NULL for a full change.
+ * Takes ownership of @old.
+ */
+static void
+gtk_css_provider_emit_changed (GtkCssProvider         *css_provider,
+                               GtkCssProviderSnapshot *old)
+{
+  GtkCssProviderSnapshot *new;
+  GPtrArray *changed, *old_unchanged, *new_unchanged;
+  GtkCssSelectorTree *tree = NULL;
+  gboolean reordered;
+  guint i;
+
+  if (old == NULL)
+    {
+      gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+      return;
+    }
+
+  new = gtk_css_provider_snapshot_new (css_provider);
+
+  /* Colors and keyframes are referenced by name, so there is no
+   * telling which rulesets a change to them affects.
+   */
+  if (!g_str_equal (old->globals, new->globals))
+    {
+      gtk_css_provider_snapshot_free (old);
+      gtk_css_provider_snapshot_free (new);
+      gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+      return;
+    }
+
+  changed = g_ptr_array_new ();
+  old_unchanged = collect_unchanged_rulesets (old, new, changed);
+  new_unchanged = collect_unchanged_rulesets (new, old, changed);
+
+  /* The order decides between rulesets of the same specificity, so if
+   * unchanged rulesets were reordered, any node may be affected.
+   */
+  reordered = FALSE;
+  for (i = 0; i < old_unchanged->len; i++)
+    {
+      if (!g_str_equal (g_ptr_array_index (old_unchanged, i),
+                        g_ptr_array_index (new_unchanged, i)))
+        {
+          reordered = TRUE;
+          break;
+        }
+    }
+
+  if (!reordered && changed->len > 0)
+    tree = build_changed_tree (changed);
+
+  if (reordered || (changed->len > 0 && tree == NULL))
+    gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+  else if (tree != NULL)
+    gtk_style_provider_changed_selectors (GTK_STYLE_PROVIDER (css_provider), tree);
+
+  g_clear_pointer (&tree, _gtk_css_selector_tree_free);
+  g_ptr_array_unref (old_unchanged);
+  g_ptr_array_unref (new_unchanged);
+  g_ptr_array_unref (changed);
+  gtk_css_provider_snapshot_free (old);
+  gtk_css_provider_snapshot_free (new);
+}
+
+static GtkCssProviderSnapshot *
+gtk_css_provider_take_snapshot (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = gtk_css_provider_get_instance_private (css_provider);
+
+  /* Nothing to compare with */
+  if (priv->rulesets->len == 0)
+    return NULL;
+
+  return gtk_css_provider_snapshot_new (css_provider);
+}
+
 /**
  * gtk_css_provider_load_from_data:
  * @css_provider: a #GtkCssProvider
@@ -1091,6 +1321,7 @@ gtk_css_provider_load_from_data (GtkCssProvider  *css_provider,
                                  const char      *data,
                                  gssize           length)
 {
+  GtkCssProviderSnapshot *snapshot;
   GBytes *bytes;
 
   g_return_if_fail (GTK_IS_CSS_PROVIDER (css_provider));
@@ -1101,13 +1332,14 @@ gtk_css_provider_load_from_data (GtkCssProvider  *css_provider,
 
   bytes = g_bytes_new_static (data, length);
 
+  snapshot = gtk_css_provider_take_snapshot (css_provider);
   gtk_css_provider_reset (css_provider);
 
   g_bytes_ref (bytes);
   gtk_css_provider_load_internal (css_provider, NULL, NULL, bytes);
   g_bytes_unref (bytes);
 
-  gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+  gtk_css_provider_emit_changed (css_provider, snapshot);
 }
 
 /**
@@ -1122,14 +1354,17 @@ void
 gtk_css_provider_load_from_file (GtkCssProvider  *css_provider,
                                  GFile           *file)
 {
+  GtkCssProviderSnapshot *snapshot;
+
   g_return_if_fail (GTK_IS_CSS_PROVIDER (css_provider));
   g_return_if_fail (G_IS_FILE (file));
 
+  snapshot = gtk_css_provider_take_snapshot (css_provider);
   gtk_css_provider_reset (css_provider);
 
   gtk_css_provider_load_internal (css_provider, NULL, file, NULL);
 
-  gtk_style_provider_changed (GTK_STYLE_PROVIDER (css_provider));
+  gtk_css_provider_emit_changed (css_provider, snapshot);
 }
 
 /**
@@ -126,6 +126,37 @@ struct _GtkCssSelectorTree
   gint32 matches_offset; /* pointers that we return as matches if selector matches */
 };
 
+/* The roots of a tree are indexed by their simple selector, so matching
+ * only has to look at the roots for the node's name, id and classes.
+ * The index is allocated right before the first root. Roots that are
+ * not radical (like :hover or *) have to be checked for every node.
+ * All offsets are relative to the index.
+ */
+typedef struct _GtkCssSelectorTreeIndex GtkCssSelectorTreeIndex;
+struct _GtkCssSelectorTreeIndex
+{
+  guint32 bucket_mask;
+  guint32 n_unbucketed;
+  gint32 buckets_offset; /* bucket_mask + 2 positions in the roots */
+  gint32 roots_offset; /* offsets of the roots, unbucketed ones first */
+};
+
+G_STATIC_ASSERT (sizeof (GtkCssSelectorTreeIndex) % sizeof (gpointer) == 0);
+
+/* Statistics about how many checks the index and the bloom filter save */
+static guint n_roots_total;
+static guint n_roots_checked;
+static guint n_filter_checks;
+static guint n_filter_rejections;
+
+typedef struct
+{
+  guint roots_total;
+  guint roots_checked;
+  guint filter_checks;
+  guint filter_rejections;
+} GtkCssSelectorTreeStats;
+
 static gboolean
 gtk_css_selector_equal (const GtkCssSelector *a,
 			const GtkCssSelector *b)
@@ -1894,14 +1925,21 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
                              const GtkCountingBloomFilter  *filter,
                              gboolean                       match_filter,
                              GtkCssNode                    *node,
-                             GtkCssSelectorMatches         *results)
+                             GtkCssSelectorMatches         *results,
+                             GtkCssSelectorTreeStats       *stats)
 {
   const GtkCssSelectorTree *prev;
   GtkCssNode *child;
 
-  if (match_filter && tree->selector.class->category == GTK_CSS_SELECTOR_CATEGORY_SIMPLE_RADICAL &&
-      !gtk_counting_bloom_filter_may_contain (filter, gtk_css_selector_hash_one (&tree->selector)))
-    return FALSE;
+  if (match_filter && tree->selector.class->category == GTK_CSS_SELECTOR_CATEGORY_SIMPLE_RADICAL)
+    {
+      stats->filter_checks++;
+      if (!gtk_counting_bloom_filter_may_contain (filter, gtk_css_selector_hash_one (&tree->selector)))
+        {
+          stats->filter_rejections++;
+          return FALSE;
+        }
+    }
 
   if (!gtk_css_selector_match_one (&tree->selector, node))
     return TRUE;
@@ -1919,7 +1957,7 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
            child;
            child = gtk_css_selector_iterator (&tree->selector, node, child))
         {
-          if (!gtk_css_selector_tree_match (prev, filter, match_filter, child, results))
+          if (!gtk_css_selector_tree_match (prev, filter, match_filter, child, results, stats))
             break;
         }
     }
@@ -1927,20 +1965,132 @@ gtk_css_selector_tree_match (const GtkCssSelectorTree      *tree,
   return TRUE;
 }
 
+static inline const GtkCssSelectorTreeIndex *
+gtk_css_selector_tree_get_index (const GtkCssSelectorTree *tree)
+{
+  return (const GtkCssSelectorTreeIndex *) ((const guint8 *) tree - sizeof (GtkCssSelectorTreeIndex));
+}
+
+static inline guint
+gtk_css_selector_tree_index_get_bucket (const GtkCssSelectorTreeIndex *index,
+                                        guint                          hash)
+{
+  return ((hash * 2654435761u) >> 16) & index->bucket_mask;
+}
+
+static inline const gint32 *
+gtk_css_selector_tree_index_get_roots (const GtkCssSelectorTreeIndex *index)
+{
+  return (const gint32 *) ((const guint8 *) index + index->roots_offset);
+}
+
+static inline const guint32 *
+gtk_css_selector_tree_index_get_buckets (const GtkCssSelectorTreeIndex *index)
+{
+  return (const guint32 *) ((const guint8 *) index + index->buckets_offset);
+}
+
+static inline const GtkCssSelectorTree *
+gtk_css_selector_tree_index_get_root (const GtkCssSelectorTreeIndex *index,
+                                      guint                          i)
+{
+  return (const GtkCssSelectorTree *) ((const guint8 *) index + gtk_css_selector_tree_index_get_roots (index)[i]);
+}
+
+/* Collects the buckets with roots that can match @node. Buckets are only
+ * returned once, even if several of the node's hashes end up in them.
+ * @buckets must have room for the number of classes + 2.
+ */
+static guint
+gtk_css_selector_tree_index_collect_buckets (const GtkCssSelectorTreeIndex *index,
+                                             GtkCssNode                    *node,
+                                             guint                         *buckets)
+{
+  const GtkCssNodeDeclaration *decl = gtk_css_node_get_declaration (node);
+  const GQuark *classes;
+  guint n_classes, n_buckets, i, j, bucket;
+  guint hashes[2];
+  guint n_hashes = 0;
+
+  classes = gtk_css_node_declaration_get_classes (decl, &n_classes);
+
+  if (gtk_css_node_declaration_get_name (decl))
+    hashes[n_hashes++] = gtk_css_hash_name (gtk_css_node_declaration_get_name (decl));
+  if (gtk_css_node_declaration_get_id (decl))
+    hashes[n_hashes++] = gtk_css_hash_id (gtk_css_node_declaration_get_id (decl));
+
+  n_buckets = 0;
+  for (i = 0; i < n_hashes + n_classes; i++)
+    {
+      if (i < n_hashes)
+        bucket = gtk_css_selector_tree_index_get_bucket (index, hashes[i]);
+      else
+        bucket = gtk_css_selector_tree_index_get_bucket (index, gtk_css_hash_class (classes[i - n_hashes]));
+
+      for (j = 0; j < n_buckets; j++)
+        {
+          if (buckets[j] == bucket)
+            break;
+        }
+
+      if (j == n_buckets)
+        buckets[n_buckets++] = bucket;
+    }
+
+  return n_buckets;
+}
+
+static void
+gtk_css_selector_tree_stats_commit (const GtkCssSelectorTreeStats *stats)
+{
+  /* Matching happens on worker threads, too */
+  g_atomic_int_add (&n_roots_total, stats->roots_total);
+  g_atomic_int_add (&n_roots_checked, stats->roots_checked);
+  g_atomic_int_add (&n_filter_checks, stats->filter_checks);
+  g_atomic_int_add (&n_filter_rejections, stats->filter_rejections);
+}
+
 void
 _gtk_css_selector_tree_match_all (const GtkCssSelectorTree     *tree,
                                   const GtkCountingBloomFilter *filter,
                                   GtkCssNode                   *node,
                                   GtkCssSelectorMatches        *out_tree_rules)
 {
-  const GtkCssSelectorTree *iter;
+  const GtkCssSelectorTreeIndex *index;
+  GtkCssSelectorTreeStats stats = { 0, };
+  const guint32 *bucket_starts;
+  guint *buckets;
+  guint i, j, n_buckets, n_classes;
+
+  if (tree == NULL)
+    return;
+
+  index = gtk_css_selector_tree_get_index (tree);
+  bucket_starts = gtk_css_selector_tree_index_get_buckets (index);
+  stats.roots_total = bucket_starts[index->bucket_mask + 1];
 
-  for (iter = tree;
-       iter != NULL;
-       iter = gtk_css_selector_tree_get_sibling (iter))
+  for (i = 0; i < index->n_unbucketed; i++)
     {
-      gtk_css_selector_tree_match (iter, filter, FALSE, node, out_tree_rules);
+      gtk_css_selector_tree_match (gtk_css_selector_tree_index_get_root (index, i),
+                                   filter, FALSE, node, out_tree_rules, &stats);
     }
+  stats.roots_checked = index->n_unbucketed;
+
+  gtk_css_node_declaration_get_classes (gtk_css_node_get_declaration (node), &n_classes);
+  buckets = g_newa (guint, n_classes + 2);
+  n_buckets = gtk_css_selector_tree_index_collect_buckets (index, node, buckets);
+
+  for (i = 0; i < n_buckets; i++)
+    {
+      for (j = bucket_starts[buckets[i]]; j < bucket_starts[buckets[i] + 1]; j++)
+        {
+          gtk_css_selector_tree_match (gtk_css_selector_tree_index_get_root (index, j),
+                                       filter, FALSE, node, out_tree_rules, &stats);
+        }
+      stats.roots_checked += bucket_starts[buckets[i] + 1] - bucket_starts[buckets[i]];
+    }
+
+  gtk_css_selector_tree_stats_commit (&stats);
 }
 
 gboolean
@@ -1949,19 +2099,104 @@ _gtk_css_selector_tree_is_empty (const GtkCssSelectorTree *tree)
   return tree == NULL;
 }
 
+static GtkCssChange
+gtk_css_selector_tree_collect_change (const GtkCssSelectorTree     *tree,
+                                      const GtkCountingBloomFilter *filter,
+                                      GtkCssNode                   *node)
+{
+  const GtkCssSelectorTreeIndex *index;
+  const guint32 *bucket_starts;
+  GtkCssChange change = 0;
+  guint *buckets;
+  guint i, j, n_buckets, n_classes;
+
+  index = gtk_css_selector_tree_get_index (tree);
+  bucket_starts = gtk_css_selector_tree_index_get_buckets (index);
+
+  /* Without a node, any radical root may match */
+  if (node == NULL)
+    {
+      for (i = 0; i < bucket_starts[index->bucket_mask + 1]; i++)
+        change |= gtk_css_selector_tree_get_change (gtk_css_selector_tree_index_get_root (index, i),
+                                                    filter, node, FALSE);
+
+      return change;
+    }
+
+  for (i = 0; i < index->n_unbucketed; i++)
+    change |= gtk_css_selector_tree_get_change (gtk_css_selector_tree_index_get_root (index, i),
+                                                filter, node, FALSE);
+
+  gtk_css_node_declaration_get_classes (gtk_css_node_get_declaration (node), &n_classes);
+  buckets = g_newa (guint, n_classes + 2);
+  n_buckets = gtk_css_selector_tree_index_collect_buckets (index, node, buckets);
+
+  for (i = 0; i < n_buckets; i++)
+    {
+      for (j = bucket_starts[buckets[i]]; j < bucket_starts[buckets[i] + 1]; j++)
+        change |= gtk_css_selector_tree_get_change (gtk_css_selector_tree_index_get_root (index, j),
+                                                    filter, node, FALSE);
+    }
+
+  return change;
+}
+
 GtkCssChange
 gtk_css_selector_tree_get_change_all (const GtkCssSelectorTree     *tree,
                                       const GtkCountingBloomFilter *filter,
 				      GtkCssNode                   *node)
 {
-  GtkCssChange change = 0;
-
-  for (; tree != NULL;
-       tree = gtk_css_selector_tree_get_sibling (tree))
-    change |= gtk_css_selector_tree_get_change (tree, filter, node, FALSE);
+  if (tree == NULL)
+    return 0;
 
   /* Never return reserved bit set */
-  return change & ~GTK_CSS_CHANGE_RESERVED_BIT;
+  return gtk_css_selector_tree_collect_change (tree, filter, node) & ~GTK_CSS_CHANGE_RESERVED_BIT;
+}
+
+/**
+ * gtk_css_selector_tree_may_match:
+ * @tree: (nullable): a selector tree
+ * @node: a node
+ *
+ * Checks if any selector in @tree may match @node, now or after a
+ * change of its state, position or ancestors. Only the names, ids
+ * and classes of @node itself are checked.
+ *
+ * Returns: %FALSE if no selector in @tree can match @node
+ */
+gboolean
+gtk_css_selector_tree_may_match (const GtkCssSelectorTree *tree,
+                                 GtkCssNode               *node)
+{
+  if (tree == NULL)
+    return FALSE;
+
+  return (gtk_css_selector_tree_collect_change (tree, NULL, node) & GTK_CSS_CHANGE_GOT_MATCH) != 0;
+}
+
+/**
+ * gtk_css_selector_tree_get_statistics:
+ * @roots_total: (out): number of selector tree roots that would have
+ *     been checked without the index
+ * @roots_checked: (out): number of roots that were actually checked
+ * @filter_checks: (out): number of ancestor selectors that were
+ *     checked against the bloom filter
+ * @filter_rejections: (out): number of those that the bloom filter
+ *     rejected without walking the ancestors
+ *
+ * Gets statistics about selector matching since the start of the
+ * program, for use in the inspector.
+ */
+void
+gtk_css_selector_tree_get_statistics (guint *roots_total,
+                                      guint *roots_checked,
+                                      guint *filter_checks,
+                                      guint *filter_rejections)
+{
+  *roots_total = g_atomic_int_get (&n_roots_total);
+  *roots_checked = g_atomic_int_get (&n_roots_checked);
+  *filter_checks = g_atomic_int_get (&n_filter_checks);
+  *filter_rejections = g_atomic_int_get (&n_filter_rejections);
 }
 
 #ifdef PRINT_TREE
@@ -2073,7 +2308,7 @@ _gtk_css_selector_tree_free (GtkCssSelectorTree *tree)
   if (tree == NULL)
     return;
 
-  g_free (tree);
+  g_free ((gpointer) gtk_css_selector_tree_get_index (tree));
 }
 
 
@@ -2269,6 +2504,78 @@ fixup_offsets (GtkCssSelectorTree *tree, guint8 *data)
     }
 }
 
+static void
+build_index (GByteArray *array,
+             gint32      root_offset)
+{
+  GtkCssSelectorTreeIndex *index;
+  GArray *bucketed, *unbucketed;
+  guint32 *bucket_starts;
+  gint32 offset, buckets_offset, roots_offset;
+  guint32 bucket_mask;
+  guint i;
+
+  bucketed = g_array_new (FALSE, FALSE, sizeof (gint32));
+  unbucketed = g_array_new (FALSE, FALSE, sizeof (gint32));
+
+  for (offset = root_offset;
+       offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET;
+       offset = get_tree (array, offset)->sibling_offset)
+    {
+      if (get_tree (array, offset)->selector.class->category == GTK_CSS_SELECTOR_CATEGORY_SIMPLE_RADICAL)
+        g_array_append_val (bucketed, offset);
+      else
+        g_array_append_val (unbucketed, offset);
+    }
+
+  bucket_mask = 0;
+  while (bucket_mask + 1 < bucketed->len)
+    bucket_mask = (bucket_mask << 1) | 1;
+
+  buckets_offset = array->len;
+  g_byte_array_set_size (array, array->len + (bucket_mask + 2) * sizeof (guint32));
+  roots_offset = array->len;
+  g_byte_array_set_size (array, array->len + (bucketed->len + unbucketed->len) * sizeof (gint32));
+
+  index = (GtkCssSelectorTreeIndex *) array->data;
+  index->bucket_mask = bucket_mask;
+  index->n_unbucketed = unbucketed->len;
+  index->buckets_offset = buckets_offset;
+  index->roots_offset = roots_offset;
+
+  /* Count the roots per bucket, then turn the counts into positions */
+  bucket_starts = (guint32 *) (array->data + buckets_offset);
+  memset (bucket_starts, 0, (bucket_mask + 2) * sizeof (guint32));
+  for (i = 0; i < bucketed->len; i++)
+    {
+      const GtkCssSelectorTree *tree = get_tree (array, g_array_index (bucketed, gint32, i));
+      bucket_starts[gtk_css_selector_tree_index_get_bucket (index, gtk_css_selector_hash_one (&tree->selector)) + 1]++;
+    }
+  bucket_starts[0] = unbucketed->len;
+  for (i = 1; i < bucket_mask + 2; i++)
+    bucket_starts[i] += bucket_starts[i - 1];
+
+  memcpy (array->data + roots_offset, unbucketed->data, unbucketed->len * sizeof (gint32));
+  for (i = 0; i < bucketed->len; i++)
+    {
+      gint32 tree_offset = g_array_index (bucketed, gint32, i);
+      const GtkCssSelectorTree *tree = get_tree (array, tree_offset);
+      guint bucket = gtk_css_selector_tree_index_get_bucket (index, gtk_css_selector_hash_one (&tree->selector));
+
+      /* bucket_starts[bucket] is used as the fill position here and
+       * ends up at the start of the next bucket */
+      ((gint32 *) (array->data + roots_offset))[bucket_starts[bucket]++] = tree_offset;
+    }
+
+  /* Shift the positions back, so every bucket starts where it should */
+  for (i = bucket_mask + 1; i > 0; i--)
+    bucket_starts[i] = bucket_starts[i - 1];
+  bucket_starts[0] = unbucketed->len;
+
+  g_array_unref (bucketed);
+  g_array_unref (unbucketed);
+}
+
 GtkCssSelectorTree *
 _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 {
@@ -2278,14 +2585,21 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
   guint len;
   guint i;
   GtkCssSelectorRuleSetInfo **infos_array;
+  gint32 root_offset;
+
+  if (builder->infos->len == 0)
+    return NULL;
 
   array = g_byte_array_new ();
+  g_byte_array_set_size (array, sizeof (GtkCssSelectorTreeIndex));
 
   infos_array = g_alloca (sizeof (GtkCssSelectorRuleSetInfo *) * builder->infos->len);
   for (i = 0; i < builder->infos->len; i++)
     infos_array[i] = &g_array_index (builder->infos, GtkCssSelectorRuleSetInfo, i);
 
-  subdivide_infos (array, infos_array, builder->infos->len, GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET);
+  root_offset = subdivide_infos (array, infos_array, builder->infos->len, GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET);
+
+  build_index (array, root_offset);
 
   len = array->len;
   data = g_byte_array_free (array, FALSE);
@@ -2293,7 +2607,7 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
   /* shrink to final size */
   data = g_realloc (data, len);
 
-  tree = (GtkCssSelectorTree *)data;
+  tree = (GtkCssSelectorTree *) (data + root_offset);
 
   fixup_offsets (tree, data);
 
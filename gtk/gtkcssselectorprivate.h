@@ -31,7 +31,6 @@
 G_BEGIN_DECLS
 
 typedef union _GtkCssSelector GtkCssSelector;
-typedef struct _GtkCssSelectorTree GtkCssSelectorTree;
 typedef struct _GtkCssSelectorTreeBuilder GtkCssSelectorTreeBuilder;
 
 GtkCssSelector *  _gtk_css_selector_parse           (GtkCssParser           *parser);
@@ -55,9 +54,15 @@ void         _gtk_css_selector_tree_match_all        (const GtkCssSelectorTree *
 GtkCssChange gtk_css_selector_tree_get_change_all    (const GtkCssSelectorTree *tree,
                                                       const GtkCountingBloomFilter *filter,
 						      GtkCssNode               *node);
+gboolean     gtk_css_selector_tree_may_match         (const GtkCssSelectorTree *tree,
+                                                      GtkCssNode               *node);
 void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *tree,
 						      GString                  *str);
 gboolean     _gtk_css_selector_tree_is_empty         (const GtkCssSelectorTree *tree) G_GNUC_CONST;
+void         gtk_css_selector_tree_get_statistics    (guint                    *roots_total,
+                                                      guint                    *roots_checked,
+                                                      guint                    *filter_checks,
+                                                      guint                    *filter_rejections);
 
 
 
@@ -213,6 +213,8 @@ gtk_css_ ## NAME ## _values_new_compute (GtkCssStaticStyle *sstyle, \
                                           lookup->values[id].value, \
                                           lookup->values[id].section); \
     } \
+\
+  style->NAME = (GtkCss ## TYPE ## Values *)gtk_css_values_share ((GtkCssValues *)style->NAME); \
 } \
 static GtkBitmask * gtk_css_ ## NAME ## _values_mask; \
 static GtkCssValues * gtk_css_ ## NAME ## _initial_values; \
@@ -988,9 +990,8 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                   GtkCssNode                   *node,
                                   GtkCssChange                  change)
 {
-  GtkCssStaticStyle *result;
+  GtkCssStyle *result;
   GtkCssLookup lookup;
-  GtkCssNode *parent;
 
   _gtk_css_lookup_init (&lookup);
 
@@ -1001,6 +1002,29 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
                                &lookup,
                                change == 0 ? &change : NULL);
 
+  result = gtk_css_static_style_new_from_lookup (provider, node, &lookup, change);
+
+  _gtk_css_lookup_destroy (&lookup);
+
+  return result;
+}
+
+/*
+ * gtk_css_static_style_new_from_lookup:
+ *
+ * Computes the style for @node from the results of
+ * gtk_style_provider_lookup() that were gathered before.
+ * @change must be the change returned from that lookup.
+ */
+GtkCssStyle *
+gtk_css_static_style_new_from_lookup (GtkStyleProvider *provider,
+                                      GtkCssNode       *node,
+                                      GtkCssLookup     *lookup,
+                                      GtkCssChange      change)
+{
+  GtkCssStaticStyle *result;
+  GtkCssNode *parent;
+
   result = g_object_new (GTK_TYPE_CSS_STATIC_STYLE, NULL);
 
   result->change = change;
@@ -1010,13 +1034,11 @@ gtk_css_static_style_new_compute (GtkStyleProvider             *provider,
   else
     parent = NULL;
 
-  gtk_css_lookup_resolve (&lookup,
+  gtk_css_lookup_resolve (lookup,
                           provider,
                           result,
                           parent ? gtk_css_node_get_style (parent) : NULL);
 
-  _gtk_css_lookup_destroy (&lookup);
-
   return GTK_CSS_STYLE (result);
 }
 
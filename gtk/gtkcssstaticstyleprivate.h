@@ -23,6 +23,7 @@
 #include "gtk/gtkcssstyleprivate.h"
 
 #include "gtk/gtkcountingbloomfilterprivate.h"
+#include "gtk/gtkcsslookupprivate.h"
 
 G_BEGIN_DECLS
 
@@ -57,6 +58,10 @@ GtkCssStyle *           gtk_css_static_style_new_compute        (GtkStyleProvide
                                                                  const GtkCountingBloomFilter   *filter,
                                                                  GtkCssNode                     *node,
                                                                  GtkCssChange                    change);
+GtkCssStyle *           gtk_css_static_style_new_from_lookup    (GtkStyleProvider               *provider,
+                                                                 GtkCssNode                     *node,
+                                                                 GtkCssLookup                   *lookup,
+                                                                 GtkCssChange                    change);
 GtkCssChange            gtk_css_static_style_get_change         (GtkCssStaticStyle              *style);
 
 G_END_DECLS
@@ -39,6 +39,8 @@
 #include "gtkstylepropertyprivate.h"
 #include "gtkstyleproviderprivate.h"
 
+#include <string.h>
+
 G_DEFINE_ABSTRACT_TYPE (GtkCssStyle, gtk_css_style, G_TYPE_OBJECT)
 
 static GtkCssSection *
@@ -705,6 +707,41 @@ static const int values_size[] = {
 
 #define GET_VALUES(v) (GtkCssValue **)((guint8 *)(v) + sizeof (GtkCssValues))
 
+/* Groups that were handed to gtk_css_values_share(), by type index.
+ * The tables don't hold a reference, groups remove themselves when
+ * they are freed.
+ */
+static GHashTable *shared_values[G_N_ELEMENTS (values_size)];
+
+static guint
+gtk_css_values_hash (gconstpointer data)
+{
+  const GtkCssValues *values = data;
+  GtkCssValue **v = GET_VALUES (values);
+  guint hash = values->type;
+  int i;
+
+  for (i = 0; i < N_VALUES (values->type); i++)
+    hash = (hash << 5) - hash + GPOINTER_TO_SIZE (v[i]) / sizeof (gpointer);
+
+  return hash;
+}
+
+static gboolean
+gtk_css_values_equal (gconstpointer data1,
+                      gconstpointer data2)
+{
+  const GtkCssValues *values1 = data1;
+  const GtkCssValues *values2 = data2;
+
+  if (TYPE_INDEX (values1->type) != TYPE_INDEX (values2->type))
+    return FALSE;
+
+  return memcmp (GET_VALUES (values1),
+                 GET_VALUES (values2),
+                 N_VALUES (values1->type) * sizeof (GtkCssValue *)) == 0;
+}
+
 GtkCssValues *gtk_css_values_ref (GtkCssValues *values)
 {
   values->ref_count++;
@@ -718,6 +755,9 @@ gtk_css_values_free (GtkCssValues *values)
   int i;
   GtkCssValue **v = GET_VALUES (values);
 
+  if (values->shared)
+    g_hash_table_remove (shared_values[values->type / 2], values);
+
   for (i = 0; i < N_VALUES (values->type); i++)
     {
       if (v[i])
@@ -759,6 +799,48 @@ gtk_css_values_copy (GtkCssValues *values)
   return copy;
 }
 
+/*
+ * gtk_css_values_share:
+ * @values: (transfer full): a freshly computed group
+ *
+ * Looks for a live group of the same type that holds the exact same
+ * values and returns that one instead, so that styles with identical
+ * groups share their memory, and GtkCssStyleChange can skip comparing
+ * them value by value.
+ *
+ * Values are immutable, so a shared group is only ever replaced, never
+ * modified. Animated styles copy groups before changing them.
+ *
+ * Returns: (transfer full): @values or an equal group
+ */
+GtkCssValues *
+gtk_css_values_share (GtkCssValues *values)
+{
+  GHashTable *table;
+  GtkCssValues *existing;
+
+  g_assert (!values->shared);
+
+  table = shared_values[values->type / 2];
+  if (table == NULL)
+    {
+      table = g_hash_table_new (gtk_css_values_hash, gtk_css_values_equal);
+      shared_values[values->type / 2] = table;
+    }
+
+  existing = g_hash_table_lookup (table, values);
+  if (existing)
+    {
+      gtk_css_values_unref (values);
+      return gtk_css_values_ref (existing);
+    }
+
+  values->shared = TRUE;
+  g_hash_table_add (table, values);
+
+  return values;
+}
+
 GtkCssValues *
 gtk_css_values_new (GtkCssValuesType type)
 {
@@ -55,6 +55,17 @@
 /* random number that everyone else seems to use, too */
 #define FILES_PER_QUERY 100
 
+/* The number of files per query adapts so that each query takes
+ * about this long, which keeps slow network mounts responsive and
+ * fast local disks efficient.
+ */
+#define QUERY_TIME_BUDGET (20 * G_TIME_SPAN_MILLISECOND)
+#define MIN_FILES_PER_QUERY 16
+#define MAX_FILES_PER_QUERY (100 * FILES_PER_QUERY)
+
+/* Loaded files are added at most once per frame */
+#define ITEMS_CHANGED_INTERVAL 16
+
 enum {
   PROP_0,
   PROP_ATTRIBUTES,
@@ -80,6 +91,11 @@ struct _GtkDirectoryList
   GCancellable *cancellable;
   GError *error; /* Error while loading */
   GSequence *items; /* Use GPtrArray or GListStore here? */
+
+  guint files_per_query;
+  gint64 query_start;
+  GPtrArray *pending; /* Loaded infos not yet added to items */
+  guint pending_source;
 };
 
 struct _GtkDirectoryListClass
@@ -205,9 +221,52 @@ gtk_directory_list_get_property (GObject     *object,
     }
 }
 
+static void
+gtk_directory_list_flush_pending (GtkDirectoryList *self)
+{
+  guint i, n;
+
+  g_clear_handle_id (&self->pending_source, g_source_remove);
+
+  n = self->pending->len;
+  if (n == 0)
+    return;
+
+  for (i = 0; i < n; i++)
+    g_sequence_append (self->items, g_ptr_array_index (self->pending, i));
+  g_ptr_array_set_size (self->pending, 0);
+
+  g_list_model_items_changed (G_LIST_MODEL (self), g_sequence_get_length (self->items) - n, 0, n);
+}
+
+static gboolean
+gtk_directory_list_pending_cb (gpointer data)
+{
+  GtkDirectoryList *self = data;
+
+  self->pending_source = 0;
+  gtk_directory_list_flush_pending (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_directory_list_clear_pending (GtkDirectoryList *self)
+{
+  g_clear_handle_id (&self->pending_source, g_source_remove);
+
+  if (self->pending == NULL)
+    return;
+
+  g_ptr_array_foreach (self->pending, (GFunc) g_object_unref, NULL);
+  g_ptr_array_set_size (self->pending, 0);
+}
+
 static gboolean
 gtk_directory_list_stop_loading (GtkDirectoryList *self)
 {
+  gtk_directory_list_clear_pending (self);
+
   if (self->cancellable == NULL)
     return FALSE;
 
@@ -243,6 +302,7 @@ gtk_directory_list_dispose (GObject *object)
 
   g_clear_error (&self->error);
   g_clear_pointer (&self->items, g_sequence_free);
+  g_clear_pointer (&self->pending, g_ptr_array_unref);
 
   G_OBJECT_CLASS (gtk_directory_list_parent_class)->dispose (object);
 }
@@ -347,6 +407,7 @@ static void
 gtk_directory_list_init (GtkDirectoryList *self)
 {
   self->items = g_sequence_new (g_object_unref);
+  self->pending = g_ptr_array_new ();
   self->io_priority = G_PRIORITY_DEFAULT;
   self->monitored = TRUE;
 }
@@ -429,6 +490,8 @@ gtk_directory_list_got_files_cb (GObject      *source,
                                      gtk_directory_list_enumerator_closed_cb,
                                      NULL);
 
+      gtk_directory_list_flush_pending (self);
+
       g_object_freeze_notify (G_OBJECT (self));
 
       g_clear_object (&self->cancellable);
@@ -444,7 +507,18 @@ gtk_directory_list_got_files_cb (GObject      *source,
       return;
     }
 
-  n = 0;
+  /* Only adapt when the query was full, a short one was the end of the directory */
+  n = g_list_length (files);
+  if (n == self->files_per_query)
+    {
+      gint64 elapsed = g_get_monotonic_time () - self->query_start;
+
+      if (elapsed < QUERY_TIME_BUDGET / 2)
+        self->files_per_query = MIN (2 * self->files_per_query, MAX_FILES_PER_QUERY);
+      else if (elapsed > 2 * QUERY_TIME_BUDGET)
+        self->files_per_query = MAX (self->files_per_query / 2, MIN_FILES_PER_QUERY);
+    }
+
   for (l = files; l; l = l->next)
     {
       GFileInfo *info;
@@ -454,20 +528,23 @@ gtk_directory_list_got_files_cb (GObject      *source,
       file = g_file_enumerator_get_child (enumerator, info);
       g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
       g_object_unref (file);
-      g_sequence_append (self->items, info);
-      n++;
+      g_ptr_array_add (self->pending, info);
     }
   g_list_free (files);
 
+  self->query_start = g_get_monotonic_time ();
   g_file_enumerator_next_files_async (enumerator,
-                                      g_file_is_native (self->file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY,
+                                      self->files_per_query,
                                       self->io_priority,
                                       self->cancellable,
                                       gtk_directory_list_got_files_cb,
                                       self);
 
-  if (n > 0)
-    g_list_model_items_changed (G_LIST_MODEL (self), g_sequence_get_length (self->items) - n, 0, n);
+  if (self->pending_source == 0)
+    {
+      self->pending_source = g_timeout_add (ITEMS_CHANGED_INTERVAL, gtk_directory_list_pending_cb, self);
+      g_source_set_name_by_id (self->pending_source, "[gtk] gtk_directory_list_pending_cb");
+    }
 }
 
 static void
@@ -498,8 +575,10 @@ gtk_directory_list_got_enumerator_cb (GObject      *source,
       return;
     }
 
+  self->files_per_query = g_file_is_native (file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY;
+  self->query_start = g_get_monotonic_time ();
   g_file_enumerator_next_files_async (enumerator,
-                                      g_file_is_native (file) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY,
+                                      self->files_per_query,
                                       self->io_priority,
                                       self->cancellable,
                                       gtk_directory_list_got_files_cb,
@@ -550,6 +629,7 @@ got_new_file_info_cb (GObject      *source,
     return;
 
   g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
+  gtk_directory_list_flush_pending (self);
   position = g_sequence_get_length (self->items);
   g_sequence_append (self->items, info);
   g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
@@ -570,6 +650,7 @@ got_existing_file_info_cb (GObject      *source,
     return;
 
   g_file_info_set_attribute_object (info, "standard::file", G_OBJECT (file));
+  gtk_directory_list_flush_pending (self);
 
   for (iter = g_sequence_get_begin_iter (self->items);
        !g_sequence_iter_is_end (iter);
@@ -593,6 +674,8 @@ gtk_directory_list_remove_file (GtkDirectoryList *self,
 {
   GSequenceIter *iter;
 
+  gtk_directory_list_flush_pending (self);
+
   for (iter = g_sequence_get_begin_iter (self->items);
        !g_sequence_iter_is_end (iter);
        iter = g_sequence_iter_next (iter))
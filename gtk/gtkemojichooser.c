@@ -78,6 +78,8 @@ typedef struct
 {
   GtkFlowBoxChild parent;
   GtkWidget *variations;
+  int width;
+  int height;
 } GtkEmojiChooserChild;
 
 typedef struct
@@ -115,6 +117,26 @@ gtk_emoji_chooser_child_size_allocate (GtkWidget *widget,
     gtk_native_check_resize (GTK_NATIVE (child->variations));
 }
 
+/* All emoji have the size of a typical one, so the label only
+ * gets shaped when it is drawn, and only visible emoji are.
+ */
+static void
+gtk_emoji_chooser_child_measure (GtkWidget      *widget,
+                                 GtkOrientation  orientation,
+                                 int             for_size,
+                                 int            *minimum,
+                                 int            *natural,
+                                 int            *minimum_baseline,
+                                 int            *natural_baseline)
+{
+  GtkEmojiChooserChild *child = (GtkEmojiChooserChild *)widget;
+
+  if (orientation == GTK_ORIENTATION_HORIZONTAL)
+    *minimum = *natural = child->width;
+  else
+    *minimum = *natural = child->height;
+}
+
 static gboolean
 gtk_emoji_chooser_child_focus (GtkWidget        *widget,
                                GtkDirectionType  direction)
@@ -162,6 +184,7 @@ gtk_emoji_chooser_child_class_init (GtkEmojiChooserChildClass *class)
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (class);
 
   object_class->dispose = gtk_emoji_chooser_child_dispose;
+  widget_class->measure = gtk_emoji_chooser_child_measure;
   widget_class->size_allocate = gtk_emoji_chooser_child_size_allocate;
   widget_class->focus = gtk_emoji_chooser_child_focus;
   widget_class->grab_focus = gtk_emoji_chooser_child_grab_focus;
@@ -198,6 +221,12 @@ struct _GtkEmojiChooser
   GtkWidget *scrolled_window;
 
   int emoji_max_width;
+  int emoji_width;
+  int emoji_height;
+
+  /* Used to check if an emoji renders as expected */
+  PangoLayout *layout;
+  PangoAttrList *attrs;
 
   EmojiSection recent;
   EmojiSection people;
@@ -241,6 +270,8 @@ gtk_emoji_chooser_finalize (GObject *object)
 
   g_clear_pointer (&chooser->data, g_variant_unref);
   g_clear_object (&chooser->settings);
+  g_clear_object (&chooser->layout);
+  g_clear_pointer (&chooser->attrs, pango_attr_list_unref);
 
   G_OBJECT_CLASS (gtk_emoji_chooser_parent_class)->finalize (object);
 }
@@ -512,14 +543,12 @@ add_emoji (GtkWidget    *box,
            gunichar      modifier,
            GtkEmojiChooser *chooser)
 {
-  GtkWidget *child;
+  GtkEmojiChooserChild *child;
   GtkWidget *label;
-  PangoAttrList *attrs;
   GVariant *codes;
   char text[64];
   char *p = text;
   int i;
-  PangoLayout *layout;
   PangoRectangle rect;
 
   codes = g_variant_get_child_value (item, 0);
@@ -537,25 +566,20 @@ add_emoji (GtkWidget    *box,
   p += g_unichar_to_utf8 (0xFE0F, p); /* U+FE0F is the Emoji variation selector */
   p[0] = 0;
 
-  label = gtk_label_new (text);
-  attrs = pango_attr_list_new ();
-  pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
-  gtk_label_set_attributes (GTK_LABEL (label), attrs);
-  pango_attr_list_unref (attrs);
-
-  layout = gtk_label_get_layout (GTK_LABEL (label));
-  pango_layout_get_extents (layout, &rect, NULL);
+  pango_layout_set_text (chooser->layout, text, -1);
+  pango_layout_get_extents (chooser->layout, &rect, NULL);
 
   /* Check for fallback rendering that generates too wide items */
-  if (pango_layout_get_unknown_glyphs_count (layout) > 0 ||
+  if (pango_layout_get_unknown_glyphs_count (chooser->layout) > 0 ||
       rect.width >= 1.5 * chooser->emoji_max_width)
-    {
-      g_object_ref_sink (label);
-      g_object_unref (label);
-      return;
-    }
+    return;
+
+  label = gtk_label_new (text);
+  gtk_label_set_attributes (GTK_LABEL (label), chooser->attrs);
 
   child = g_object_new (GTK_TYPE_EMOJI_CHOOSER_CHILD, NULL);
+  child->width = chooser->emoji_width;
+  child->height = chooser->emoji_height;
   g_object_set_data_full (G_OBJECT (child), "emoji-data",
                           g_variant_ref (item),
                           (GDestroyNotify)g_variant_unref);
@@ -563,7 +587,7 @@ add_emoji (GtkWidget    *box,
     g_object_set_data (G_OBJECT (child), "modifier", GUINT_TO_POINTER (modifier));
 
   gtk_flow_box_child_set_child (GTK_FLOW_BOX_CHILD (child), label);
-  gtk_flow_box_insert (GTK_FLOW_BOX (box), child, prepend ? 0 : -1);
+  gtk_flow_box_insert (GTK_FLOW_BOX (box), GTK_WIDGET (child), prepend ? 0 : -1);
 }
 
 static gboolean
@@ -818,19 +842,18 @@ gtk_emoji_chooser_init (GtkEmojiChooser *chooser)
    * as multiply glyphs.
    */
   {
-    PangoLayout *layout = gtk_widget_create_pango_layout (GTK_WIDGET (chooser), "🙂");
-    PangoAttrList *attrs;
-    PangoRectangle rect;
+    PangoRectangle rect, logical;
 
-    attrs = pango_attr_list_new ();
-    pango_attr_list_insert (attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
-    pango_layout_set_attributes (layout, attrs);
-    pango_attr_list_unref (attrs);
+    chooser->attrs = pango_attr_list_new ();
+    pango_attr_list_insert (chooser->attrs, pango_attr_scale_new (PANGO_SCALE_X_LARGE));
 
-    pango_layout_get_extents (layout, &rect, NULL);
-    chooser->emoji_max_width = rect.width;
+    chooser->layout = gtk_widget_create_pango_layout (GTK_WIDGET (chooser), "🙂");
+    pango_layout_set_attributes (chooser->layout, chooser->attrs);
 
-    g_object_unref (layout);
+    pango_layout_get_extents (chooser->layout, &rect, &logical);
+    chooser->emoji_max_width = rect.width;
+    chooser->emoji_width = PANGO_PIXELS_CEIL (logical.width);
+    chooser->emoji_height = PANGO_PIXELS_CEIL (logical.height);
   }
 
   adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (chooser->scrolled_window));
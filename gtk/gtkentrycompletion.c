@@ -680,6 +680,7 @@ gtk_entry_completion_dispose (GObject *object)
     gtk_entry_set_completion (GTK_ENTRY (completion->entry), NULL);
 
   g_clear_object (&completion->cell_area);
+  gtk_entry_completion_set_index_model (completion, NULL);
 
   G_OBJECT_CLASS (gtk_entry_completion_parent_class)->dispose (object);
 }
@@ -743,6 +744,208 @@ gtk_entry_completion_default_completion_func (GtkEntryCompletion *completion,
   return ret;
 }
 
+/* For flat models and the default match function, we keep the
+ * case-normalized strings sorted, so the matches for a key are a
+ * range that we find by binary search. When the key grows, the new
+ * range is inside the previous one. The visible function then only
+ * needs to look at index_visible.
+ */
+typedef struct
+{
+  char *key;
+  guint row;
+} IndexEntry;
+
+static void
+index_entry_clear (gpointer data)
+{
+  IndexEntry *entry = data;
+
+  g_free (entry->key);
+}
+
+static int
+index_entry_compare (gconstpointer a,
+                     gconstpointer b)
+{
+  const IndexEntry *ea = a;
+  const IndexEntry *eb = b;
+
+  return strcmp (ea->key, eb->key);
+}
+
+static void
+gtk_entry_completion_clear_index (GtkEntryCompletion *completion)
+{
+  g_clear_pointer (&completion->index, g_array_unref);
+  g_clear_pointer (&completion->index_visible, g_free);
+  g_clear_pointer (&completion->index_key, g_free);
+  completion->index_start = 0;
+  completion->index_end = 0;
+}
+
+static void
+gtk_entry_completion_model_changed (GtkEntryCompletion *completion)
+{
+  gtk_entry_completion_clear_index (completion);
+}
+
+/* The filter model calls the visible function for changed rows, so
+ * we need to drop the index before it does. This is why we connect
+ * to the model before the filter model is created.
+ */
+static void
+gtk_entry_completion_set_index_model (GtkEntryCompletion *completion,
+                                      GtkTreeModel       *model)
+{
+  guint i;
+
+  gtk_entry_completion_clear_index (completion);
+
+  if (completion->index_model)
+    {
+      for (i = 0; i < G_N_ELEMENTS (completion->index_handler_ids); i++)
+        g_clear_signal_handler (&completion->index_handler_ids[i], completion->index_model);
+    }
+
+  completion->index_model = model;
+
+  if (model)
+    {
+      completion->index_handler_ids[0] = g_signal_connect_swapped (model, "row-changed",
+                                                                   G_CALLBACK (gtk_entry_completion_model_changed), completion);
+      completion->index_handler_ids[1] = g_signal_connect_swapped (model, "row-inserted",
+                                                                   G_CALLBACK (gtk_entry_completion_model_changed), completion);
+      completion->index_handler_ids[2] = g_signal_connect_swapped (model, "row-deleted",
+                                                                   G_CALLBACK (gtk_entry_completion_model_changed), completion);
+      completion->index_handler_ids[3] = g_signal_connect_swapped (model, "rows-reordered",
+                                                                   G_CALLBACK (gtk_entry_completion_model_changed), completion);
+    }
+}
+
+static void
+gtk_entry_completion_build_index (GtkEntryCompletion *completion)
+{
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  guint row;
+
+  model = gtk_tree_model_filter_get_model (completion->filter_model);
+
+  if (completion->match_func != NULL ||
+      completion->text_column < 0 ||
+      (gtk_tree_model_get_flags (model) & GTK_TREE_MODEL_LIST_ONLY) == 0 ||
+      gtk_tree_model_get_column_type (model, completion->text_column) != G_TYPE_STRING)
+    return;
+
+  completion->index = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+  g_array_set_clear_func (completion->index, index_entry_clear);
+
+  row = 0;
+  if (gtk_tree_model_get_iter_first (model, &iter))
+    {
+      do
+        {
+          char *item;
+
+          gtk_tree_model_get (model, &iter, completion->text_column, &item, -1);
+
+          if (item != NULL)
+            {
+              char *normalized_string = g_utf8_normalize (item, -1, G_NORMALIZE_ALL);
+
+              if (normalized_string != NULL)
+                {
+                  IndexEntry entry;
+
+                  entry.key = g_utf8_casefold (normalized_string, -1);
+                  entry.row = row;
+                  g_array_append_val (completion->index, entry);
+                }
+
+              g_free (normalized_string);
+            }
+
+          g_free (item);
+          row++;
+        }
+      while (gtk_tree_model_iter_next (model, &iter));
+    }
+
+  g_array_sort (completion->index, index_entry_compare);
+  completion->index_visible = g_new0 (guchar, MAX (row, 1));
+}
+
+/* Returns the first position in [start, end) whose key is not
+ * smaller than @key, or that does not start with @key if
+ * @past_prefix is set.
+ */
+static guint
+gtk_entry_completion_index_search (GtkEntryCompletion *completion,
+                                   const char         *key,
+                                   gsize               key_len,
+                                   gboolean            past_prefix,
+                                   guint               start,
+                                   guint               end)
+{
+  while (start < end)
+    {
+      guint mid = start + (end - start) / 2;
+      const IndexEntry *entry = &g_array_index (completion->index, IndexEntry, mid);
+      int cmp;
+
+      if (past_prefix)
+        cmp = strncmp (entry->key, key, key_len) <= 0 ? -1 : 1;
+      else
+        cmp = strcmp (entry->key, key) < 0 ? -1 : 1;
+
+      if (cmp < 0)
+        start = mid + 1;
+      else
+        end = mid;
+    }
+
+  return start;
+}
+
+static void
+gtk_entry_completion_update_index (GtkEntryCompletion *completion)
+{
+  const char *key = completion->case_normalized_key;
+  gsize key_len = strlen (key);
+  guint start, end, i;
+
+  if (completion->index == NULL)
+    gtk_entry_completion_build_index (completion);
+
+  if (completion->index == NULL)
+    return;
+
+  if (completion->index_key && g_str_has_prefix (key, completion->index_key))
+    {
+      start = completion->index_start;
+      end = completion->index_end;
+    }
+  else
+    {
+      start = 0;
+      end = completion->index->len;
+    }
+
+  start = gtk_entry_completion_index_search (completion, key, key_len, FALSE, start, end);
+  end = gtk_entry_completion_index_search (completion, key, key_len, TRUE, start, end);
+
+  for (i = completion->index_start; i < completion->index_end; i++)
+    completion->index_visible[g_array_index (completion->index, IndexEntry, i).row] = FALSE;
+  for (i = start; i < end; i++)
+    completion->index_visible[g_array_index (completion->index, IndexEntry, i).row] = TRUE;
+
+  completion->index_start = start;
+  completion->index_end = end;
+  g_free (completion->index_key);
+  completion->index_key = g_strdup (key);
+}
+
 static gboolean
 gtk_entry_completion_visible_func (GtkTreeModel *model,
                                    GtkTreeIter  *iter,
@@ -755,6 +958,16 @@ gtk_entry_completion_visible_func (GtkTreeModel *model,
   if (!completion->case_normalized_key)
     return ret;
 
+  if (completion->index_key)
+    {
+      GtkTreePath *path = gtk_tree_model_get_path (model, iter);
+
+      ret = completion->index_visible[gtk_tree_path_get_indices (path)[0]];
+      gtk_tree_path_free (path);
+
+      return ret;
+    }
+
   if (completion->match_func)
     ret = (* completion->match_func) (completion,
                                             completion->case_normalized_key,
@@ -881,6 +1094,8 @@ gtk_entry_completion_set_model (GtkEntryCompletion *completion,
   g_return_if_fail (GTK_IS_ENTRY_COMPLETION (completion));
   g_return_if_fail (model == NULL || GTK_IS_TREE_MODEL (model));
 
+  gtk_entry_completion_set_index_model (completion, model);
+
   if (!model)
     {
       gtk_tree_view_set_model (GTK_TREE_VIEW (completion->tree_view),
@@ -954,6 +1169,8 @@ gtk_entry_completion_set_match_func (GtkEntryCompletion          *completion,
   completion->match_func = func;
   completion->match_data = func_data;
   completion->match_notify = func_notify;
+
+  gtk_entry_completion_clear_index (completion);
 }
 
 /**
@@ -1025,6 +1242,8 @@ gtk_entry_completion_complete (GtkEntryCompletion *completion)
   completion->case_normalized_key = g_utf8_casefold (tmp, -1);
   g_free (tmp);
 
+  gtk_entry_completion_update_index (completion);
+
   gtk_tree_model_filter_refilter (completion->filter_model);
 
   if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (completion->filter_model), &iter))
@@ -1062,6 +1281,7 @@ gtk_entry_completion_set_text_column (GtkEntryCompletion *completion,
     return;
 
   completion->text_column = column;
+  gtk_entry_completion_clear_index (completion);
 
   cell = gtk_cell_renderer_text_new ();
   gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (completion),
@@ -52,6 +52,15 @@ struct _GtkEntryCompletion
 
   char *case_normalized_key;
 
+  /* Sorted prefix index of a flat model, for the default match function */
+  GtkTreeModel *index_model;
+  gulong index_handler_ids[4];
+  GArray *index;
+  guint index_start;
+  guint index_end;
+  char *index_key;
+  guchar *index_visible;
+
   GtkEventController *entry_key_controller;
   GtkEventController *entry_focus_controller;
 
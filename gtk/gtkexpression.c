@@ -20,7 +20,7 @@
 
 #include "config.h"
 
-#include "gtkexpression.h"
+#include "gtkexpressionprivate.h"
 
 #include <gobject/gvaluecollector.h>
 
@@ -1051,6 +1051,10 @@ struct _GtkPropertyExpression
   GtkExpression *expr;
 
   GParamSpec *pspec;
+
+  /* The pspec to dispatch to for objects of resolved_type */
+  GType resolved_type;
+  GParamSpec *resolved_pspec;
 };
 
 static void
@@ -1069,6 +1073,71 @@ gtk_property_expression_is_static (GtkExpression *expr)
   return FALSE;
 }
 
+/* Finds the pspec that objects of @type actually implement @pspec with,
+ * taking overrides into account, or %NULL if the property has to be read
+ * through g_object_get_property().
+ */
+static GParamSpec *
+gtk_property_expression_resolve (GParamSpec *pspec,
+                                 GType       type)
+{
+  GParamSpec **pspecs;
+  GParamSpec *result = NULL;
+  guint i, n_pspecs;
+
+  if ((pspec->flags & G_PARAM_READABLE) == 0 ||
+      (pspec->flags & G_PARAM_DEPRECATED) != 0)
+    return NULL;
+
+  pspecs = g_object_class_list_properties (g_type_class_peek (type), &n_pspecs);
+  for (i = 0; i < n_pspecs; i++)
+    {
+      if (pspecs[i] == pspec ||
+          g_param_spec_get_redirect_target (pspecs[i]) == pspec)
+        {
+          result = pspecs[i];
+          break;
+        }
+    }
+  g_free (pspecs);
+
+  return result;
+}
+
+/* Like g_object_get_property(), but without looking up the property by
+ * name every time. This is what sorters and filters end up calling for
+ * every item.
+ */
+static void
+gtk_property_expression_read (GtkPropertyExpression *self,
+                              GObject               *object,
+                              GValue                *value)
+{
+  GObjectClass *class;
+  GParamSpec *pspec;
+
+  if (G_OBJECT_TYPE (object) != self->resolved_type)
+    {
+      self->resolved_type = G_OBJECT_TYPE (object);
+      self->resolved_pspec = gtk_property_expression_resolve (self->pspec, self->resolved_type);
+    }
+
+  pspec = self->resolved_pspec;
+  if (pspec == NULL ||
+      (G_VALUE_TYPE (value) != G_TYPE_INVALID &&
+       G_VALUE_TYPE (value) != self->pspec->value_type))
+    {
+      g_object_get_property (object, self->pspec->name, value);
+      return;
+    }
+
+  if (G_VALUE_TYPE (value) == G_TYPE_INVALID)
+    g_value_init (value, self->pspec->value_type);
+
+  class = g_type_class_peek (pspec->owner_type);
+  class->get_property (object, pspec->param_id, value, self->pspec);
+}
+
 static GObject *
 gtk_property_expression_get_object (GtkPropertyExpression *self,
                                     gpointer               this)
@@ -1084,7 +1153,23 @@ gtk_property_expression_get_object (GtkPropertyExpression *self,
         return NULL;
     }
 
-  if (!gtk_expression_evaluate (self->expr, this, &expr_value))
+  if (G_TYPE_CHECK_INSTANCE_TYPE (self->expr, GTK_TYPE_PROPERTY_EXPRESSION))
+    {
+      /* Walk chains of property lookups directly */
+      GtkPropertyExpression *inner = (GtkPropertyExpression *) self->expr;
+      GObject *inner_object;
+
+      if (!g_type_is_a (inner->pspec->value_type, G_TYPE_OBJECT))
+        return NULL;
+
+      inner_object = gtk_property_expression_get_object (inner, this);
+      if (inner_object == NULL)
+        return NULL;
+
+      gtk_property_expression_read (inner, inner_object, &expr_value);
+      g_object_unref (inner_object);
+    }
+  else if (!gtk_expression_evaluate (self->expr, this, &expr_value))
     return NULL;
 
   if (!G_VALUE_HOLDS_OBJECT (&expr_value))
@@ -1119,7 +1204,7 @@ gtk_property_expression_evaluate (GtkExpression *expr,
   if (object == NULL)
     return FALSE;
 
-  g_object_get_property (object, self->pspec->name, value);
+  gtk_property_expression_read (self, object, value);
   g_object_unref (object);
   return TRUE;
 }
@@ -1133,49 +1218,161 @@ struct _GtkPropertyExpressionWatch
 
   GtkPropertyExpression *expr;
   gpointer               this;
-  GClosure              *closure;
+  GObject               *object;
+  GHook                 *hook;
   guchar                 sub[0];
 };
 
+/* All the watches for the same property of an object share a single
+ * notify handler. They are kept in a hook list, so that watches can be
+ * added and removed while a notification is being dispatched.
+ */
+typedef struct
+{
+  GParamSpec *pspec;
+  gulong      handler_id;
+  guint       in_emission;
+  GHookList   hooks;
+} GtkPropertyWatchers;
+
+static GQuark property_watchers_quark;
+
 static void
-gtk_property_expression_watch_destroy_closure (GtkPropertyExpressionWatch *pwatch)
+gtk_property_watchers_free (gpointer data)
 {
-  if (pwatch->closure == NULL)
-    return;
+  GtkPropertyWatchers *watchers = data;
+  GHook *hook;
+
+  /* The object is being finalized, its handlers are gone already */
+  for (hook = g_hook_first_valid (&watchers->hooks, TRUE);
+       hook != NULL;
+       hook = g_hook_next_valid (&watchers->hooks, hook, TRUE))
+    {
+      GtkPropertyExpressionWatch *pwatch = hook->data;
+
+      pwatch->object = NULL;
+      pwatch->hook = NULL;
+    }
 
-  g_closure_invalidate (pwatch->closure);
-  g_closure_unref (pwatch->closure);
-  pwatch->closure = NULL;
+  g_hook_list_clear (&watchers->hooks);
+  g_slice_free (GtkPropertyWatchers, watchers);
 }
 
 static void
-gtk_property_expression_watch_notify_cb (GObject                    *object,
-                                         GParamSpec                 *pspec,
-                                         GtkPropertyExpressionWatch *pwatch)
+gtk_property_watchers_notify_cb (GObject             *object,
+                                 GParamSpec          *pspec,
+                                 GtkPropertyWatchers *watchers)
 {
+  watchers->in_emission++;
+  g_hook_list_invoke (&watchers->hooks, TRUE);
+  watchers->in_emission--;
+
+  if (watchers->in_emission == 0 &&
+      g_hook_first_valid (&watchers->hooks, TRUE) == NULL)
+    {
+      g_signal_handler_disconnect (object, watchers->handler_id);
+      g_hash_table_remove (g_object_get_qdata (object, property_watchers_quark), watchers->pspec);
+    }
+}
+
+static void
+gtk_property_expression_watch_hook_cb (gpointer data)
+{
+  GtkPropertyExpressionWatch *pwatch = data;
+
   pwatch->notify (pwatch->user_data);
 }
 
 static void
-gtk_property_expression_watch_create_closure (GtkPropertyExpressionWatch *pwatch)
+gtk_property_expression_watch_attach (GtkPropertyExpressionWatch *pwatch,
+                                      GObject                    *object)
 {
+  GParamSpec *pspec = pwatch->expr->pspec;
+  GtkPropertyWatchers *watchers;
+  GHashTable *table;
+  GHook *hook;
+
+  if (G_UNLIKELY (property_watchers_quark == 0))
+    property_watchers_quark = g_quark_from_static_string ("gtk-property-expression-watchers");
+
+  table = g_object_get_qdata (object, property_watchers_quark);
+  if (table == NULL)
+    {
+      table = g_hash_table_new_full (NULL, NULL, NULL, gtk_property_watchers_free);
+      g_object_set_qdata_full (object, property_watchers_quark, table, (GDestroyNotify) g_hash_table_unref);
+    }
+
+  watchers = g_hash_table_lookup (table, pspec);
+  if (watchers == NULL)
+    {
+      watchers = g_slice_new0 (GtkPropertyWatchers);
+      watchers->pspec = pspec;
+      g_hook_list_init (&watchers->hooks, sizeof (GHook));
+      watchers->handler_id =
+        g_signal_connect_closure_by_id (object,
+                                        g_signal_lookup ("notify", G_OBJECT_TYPE (object)),
+                                        g_quark_from_string (pspec->name),
+                                        g_cclosure_new (G_CALLBACK (gtk_property_watchers_notify_cb), watchers, NULL),
+                                        FALSE);
+      g_assert (watchers->handler_id != 0);
+      g_hash_table_insert (table, pspec, watchers);
+    }
+
+  hook = g_hook_alloc (&watchers->hooks);
+  hook->func = gtk_property_expression_watch_hook_cb;
+  hook->data = pwatch;
+  g_hook_append (&watchers->hooks, hook);
+
+  pwatch->object = object;
+  pwatch->hook = hook;
+}
+
+static void
+gtk_property_expression_watch_detach (GtkPropertyExpressionWatch *pwatch)
+{
+  GtkPropertyWatchers *watchers;
+  GHashTable *table;
   GObject *object;
 
-  object = gtk_property_expression_get_object (pwatch->expr, pwatch->this);
-  if (object == NULL)
+  if (pwatch->object == NULL)
     return;
 
-  pwatch->closure = g_cclosure_new (G_CALLBACK (gtk_property_expression_watch_notify_cb), pwatch, NULL);
-  if (!g_signal_connect_closure_by_id (object,
-                                       g_signal_lookup ("notify", G_OBJECT_TYPE (object)),
-                                       g_quark_from_string (pwatch->expr->pspec->name),
-                                       g_closure_ref (pwatch->closure),
-                                       FALSE))
+  object = pwatch->object;
+  table = g_object_get_qdata (object, property_watchers_quark);
+  watchers = g_hash_table_lookup (table, pwatch->expr->pspec);
+
+  g_hook_destroy_link (&watchers->hooks, pwatch->hook);
+  pwatch->object = NULL;
+  pwatch->hook = NULL;
+
+  /* If we're inside the notify handler, it cleans up after itself */
+  if (watchers->in_emission == 0 &&
+      g_hook_first_valid (&watchers->hooks, TRUE) == NULL)
     {
-      g_assert_not_reached ();
+      g_signal_handler_disconnect (object, watchers->handler_id);
+      g_hash_table_remove (table, watchers->pspec);
     }
+}
 
-  g_object_unref (object);
+static void
+gtk_property_expression_watch_retarget (GtkPropertyExpressionWatch *pwatch)
+{
+  GObject *object;
+
+  object = gtk_property_expression_get_object (pwatch->expr, pwatch->this);
+  if (object == pwatch->object)
+    {
+      g_clear_object (&object);
+      return;
+    }
+
+  gtk_property_expression_watch_detach (pwatch);
+
+  if (object)
+    {
+      gtk_property_expression_watch_attach (pwatch, object);
+      g_object_unref (object);
+    }
 }
 
 static void
@@ -1183,8 +1380,7 @@ gtk_property_expression_watch_expr_notify_cb (gpointer data)
 {
   GtkPropertyExpressionWatch *pwatch = data;
 
-  gtk_property_expression_watch_destroy_closure (pwatch);
-  gtk_property_expression_watch_create_closure (pwatch);
+  gtk_property_expression_watch_retarget (pwatch);
   pwatch->notify (pwatch->user_data);
 }
 
@@ -1215,6 +1411,8 @@ gtk_property_expression_watch (GtkExpression         *expr,
   pwatch->user_data = user_data;
   pwatch->expr = self;
   pwatch->this = this_;
+  pwatch->object = NULL;
+  pwatch->hook = NULL;
   if (self->expr && !gtk_expression_is_static (self->expr))
     {
       gtk_expression_subwatch_init (self->expr,
@@ -1224,7 +1422,7 @@ gtk_property_expression_watch (GtkExpression         *expr,
                                     pwatch);
     }
 
-  gtk_property_expression_watch_create_closure (pwatch);
+  gtk_property_expression_watch_retarget (pwatch);
 }
 
 static void
@@ -1234,7 +1432,7 @@ gtk_property_expression_unwatch (GtkExpression         *expr,
   GtkPropertyExpressionWatch *pwatch = (GtkPropertyExpressionWatch *) watch;
   GtkPropertyExpression *self = (GtkPropertyExpression *) expr;
 
-  gtk_property_expression_watch_destroy_closure (pwatch);
+  gtk_property_expression_watch_detach (pwatch);
 
   if (self->expr && !gtk_expression_is_static (self->expr))
     gtk_expression_subwatch_finish (self->expr, (GtkExpressionSubWatch *) pwatch->sub);
@@ -1802,6 +2000,35 @@ gtk_expression_is_static (GtkExpression *self)
   return GTK_EXPRESSION_GET_CLASS (self)->is_static (self);
 }
 
+/*<private>
+ * gtk_expression_is_thread_safe:
+ * @self: (nullable): a #GtkExpression
+ *
+ * Checks if @self only reads properties, so it can be evaluated in
+ * a thread while the main thread keeps running. Closures can run
+ * arbitrary application code, so expressions using them are not
+ * thread-safe.
+ *
+ * Returns: %TRUE if @self can be evaluated in a thread
+ **/
+gboolean
+gtk_expression_is_thread_safe (GtkExpression *self)
+{
+  while (self)
+    {
+      if (G_TYPE_CHECK_INSTANCE_TYPE (self, GTK_TYPE_CLOSURE_EXPRESSION) ||
+          G_TYPE_CHECK_INSTANCE_TYPE (self, GTK_TYPE_CCLOSURE_EXPRESSION))
+        return FALSE;
+
+      if (!G_TYPE_CHECK_INSTANCE_TYPE (self, GTK_TYPE_PROPERTY_EXPRESSION))
+        return TRUE;
+
+      self = gtk_property_expression_get_expression (self);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 gtk_expression_watch_is_watching (GtkExpressionWatch *watch)
 {
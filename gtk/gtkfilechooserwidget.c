@@ -222,6 +222,8 @@ struct _GtkFileChooserWidget
   GtkSearchEngine *search_engine;
   GtkQuery *search_query;
   GtkFileSystemModel *search_model;
+  GList *pending_search_hits;
+  guint search_hits_tick_id;
   GtkFileSystemModel *model_for_search;
 
   /* OPERATION_MODE_RECENT */
@@ -6451,19 +6453,26 @@ get_selected_infos (GtkFileChooserWidget *impl)
   return result;
 }
 
-/* Callback used from GtkSearchEngine when we get new hits */
+/* Adds the hits that arrived since the last frame to the search model */
 static void
-search_engine_hits_added_cb (GtkSearchEngine      *engine,
-                             GList                *hits,
-                             GtkFileChooserWidget *impl)
+search_flush_hits (GtkFileChooserWidget *impl)
 {
   GList *l, *files, *files_with_info, *infos;
   GFile *file;
 
+  if (impl->search_hits_tick_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (impl), impl->search_hits_tick_id);
+      impl->search_hits_tick_id = 0;
+    }
+
+  if (impl->pending_search_hits == NULL)
+    return;
+
   files = NULL;
   files_with_info = NULL;
   infos = NULL;
-  for (l = hits; l; l = l->next)
+  for (l = impl->pending_search_hits; l; l = l->next)
     {
       GtkSearchHit *hit = (GtkSearchHit *)l->data;
       file = g_object_ref (hit->file);
@@ -6484,10 +6493,48 @@ search_engine_hits_added_cb (GtkSearchEngine      *engine,
   g_list_free_full (files, g_object_unref);
   g_list_free_full (files_with_info, g_object_unref);
   g_list_free_full (infos, g_object_unref);
+  g_list_free_full (impl->pending_search_hits, (GDestroyNotify) _gtk_search_hit_free);
+  impl->pending_search_hits = NULL;
 
   gtk_stack_set_visible_child_name (GTK_STACK (impl->browse_files_stack), "list");
 }
 
+static gboolean
+search_hits_tick_cb (GtkWidget     *widget,
+                     GdkFrameClock *frame_clock,
+                     gpointer       data)
+{
+  GtkFileChooserWidget *impl = data;
+
+  impl->search_hits_tick_id = 0;
+  search_flush_hits (impl);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Callback used from GtkSearchEngine when we get new hits. Engines
+ * deliver hits in small batches while they are searching, so we add
+ * them to the model once per frame, sorting it only once.
+ */
+static void
+search_engine_hits_added_cb (GtkSearchEngine      *engine,
+                             GList                *hits,
+                             GtkFileChooserWidget *impl)
+{
+  GList *l;
+
+  for (l = hits; l; l = l->next)
+    impl->pending_search_hits = g_list_prepend (impl->pending_search_hits,
+                                                _gtk_search_hit_dup (l->data));
+
+  if (!gtk_widget_get_mapped (GTK_WIDGET (impl)))
+    search_flush_hits (impl);
+  else if (impl->search_hits_tick_id == 0)
+    impl->search_hits_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (impl),
+                                                              search_hits_tick_cb,
+                                                              impl, NULL);
+}
+
 /* Callback used from GtkSearchEngine when the query is done running */
 static void
 search_engine_finished_cb (GtkSearchEngine *engine,
@@ -6496,6 +6543,8 @@ search_engine_finished_cb (GtkSearchEngine *engine,
 {
   GtkFileChooserWidget *impl = GTK_FILE_CHOOSER_WIDGET (data);
 
+  search_flush_hits (impl);
+
   set_busy_cursor (impl, FALSE);
   gtk_widget_hide (impl->search_spinner);
 
@@ -6548,6 +6597,14 @@ search_stop_searching (GtkFileChooserWidget *impl,
       gtk_editable_set_text (GTK_EDITABLE (impl->search_entry), "");
     }
 
+  if (impl->search_hits_tick_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (impl), impl->search_hits_tick_id);
+      impl->search_hits_tick_id = 0;
+    }
+  g_list_free_full (impl->pending_search_hits, (GDestroyNotify) _gtk_search_hit_free);
+  impl->pending_search_hits = NULL;
+
   if (impl->search_engine)
     {
       _gtk_search_engine_stop (impl->search_engine);
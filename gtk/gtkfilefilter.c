@@ -101,6 +101,9 @@ struct _GtkFileFilter
   GSList *rules;
 
   char **attributes;
+
+  /* content type => GINT_TO_POINTER (TRUE + 1) or (FALSE + 1) */
+  GHashTable *content_type_matches;
 };
 
 struct _FilterRule
@@ -111,6 +114,9 @@ struct _FilterRule
     char *pattern;
     char **content_types;
   } u;
+
+  /* For patterns like "*.png", which only need a suffix comparison */
+  const char *suffix;
 };
 
 enum {
@@ -201,6 +207,7 @@ gtk_file_filter_finalize (GObject  *object)
 
   g_slist_free_full (filter->rules, (GDestroyNotify)filter_rule_free);
   g_strfreev (filter->attributes);
+  g_clear_pointer (&filter->content_type_matches, g_hash_table_unref);
 
   g_free (filter->name);
 
@@ -487,6 +494,9 @@ file_filter_add_rule (GtkFileFilter *filter,
 {
   filter->rules = g_slist_append (filter->rules, rule);
 
+  if (filter->content_type_matches)
+    g_hash_table_remove_all (filter->content_type_matches);
+
   gtk_filter_changed (GTK_FILTER (filter), GTK_FILTER_CHANGE_LESS_STRICT);
 }
 
@@ -526,7 +536,7 @@ gtk_file_filter_add_mime_type (GtkFileFilter *filter,
   g_return_if_fail (GTK_IS_FILE_FILTER (filter));
   g_return_if_fail (mime_type != NULL);
 
-  rule = g_slice_new (FilterRule);
+  rule = g_slice_new0 (FilterRule);
   rule->type = FILTER_RULE_MIME_TYPE;
   rule->u.content_types = g_new0 (char *, 2);
   rule->u.content_types[0] = g_content_type_from_mime_type (mime_type);
@@ -551,9 +561,13 @@ gtk_file_filter_add_pattern (GtkFileFilter *filter,
   g_return_if_fail (GTK_IS_FILE_FILTER (filter));
   g_return_if_fail (pattern != NULL);
 
-  rule = g_slice_new (FilterRule);
+  rule = g_slice_new0 (FilterRule);
   rule->type = FILTER_RULE_PATTERN;
   rule->u.pattern = g_strdup (pattern);
+  if (rule->u.pattern[0] == '*' &&
+      rule->u.pattern[1] != '\0' &&
+      strpbrk (rule->u.pattern + 1, "*?[\\") == NULL)
+    rule->suffix = rule->u.pattern + 1;
 
   file_filter_add_attribute (filter, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME);
   file_filter_add_rule (filter, rule);
@@ -578,7 +592,7 @@ gtk_file_filter_add_pixbuf_formats (GtkFileFilter *filter)
 
   g_return_if_fail (GTK_IS_FILE_FILTER (filter));
 
-  rule = g_slice_new (FilterRule);
+  rule = g_slice_new0 (FilterRule);
   rule->type = FILTER_RULE_PIXBUF_FORMATS;
 
   array = g_ptr_array_new ();
@@ -778,6 +792,51 @@ gtk_file_filter_get_strictness (GtkFilter *filter)
   return GTK_FILTER_MATCH_SOME;
 }
 
+static gboolean
+gtk_file_filter_match_content_type (GtkFileFilter *filter,
+                                    const char    *content_type)
+{
+  GSList *tmp_list;
+  gpointer cached;
+  gboolean result;
+
+  /* g_content_type_is_a() walks the mime type hierarchy, and the
+   * files in a directory have only a few distinct content types.
+   */
+  if (filter->content_type_matches == NULL)
+    filter->content_type_matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  cached = g_hash_table_lookup (filter->content_type_matches, content_type);
+  if (cached)
+    return GPOINTER_TO_INT (cached) - 1;
+
+  result = FALSE;
+  for (tmp_list = filter->rules; tmp_list && !result; tmp_list = tmp_list->next)
+    {
+      FilterRule *rule = tmp_list->data;
+      int i;
+
+      if (rule->type != FILTER_RULE_MIME_TYPE &&
+          rule->type != FILTER_RULE_PIXBUF_FORMATS)
+        continue;
+
+      for (i = 0; rule->u.content_types[i]; i++)
+        {
+          if (g_content_type_is_a (content_type, rule->u.content_types[i]))
+            {
+              result = TRUE;
+              break;
+            }
+        }
+    }
+
+  g_hash_table_insert (filter->content_type_matches,
+                       g_strdup (content_type),
+                       GINT_TO_POINTER (result + 1));
+
+  return result;
+}
+
 static gboolean
 gtk_file_filter_match (GtkFilter *filter,
                        gpointer   item)
@@ -785,6 +844,7 @@ gtk_file_filter_match (GtkFilter *filter,
   GtkFileFilter *file_filter = GTK_FILE_FILTER (filter);
   GFileInfo *info = item;
   GSList *tmp_list;
+  gboolean has_content_type_rules = FALSE;
 
   if (!G_IS_FILE_INFO (item))
     return TRUE;
@@ -802,7 +862,9 @@ gtk_file_filter_match (GtkFilter *filter,
             display_name = g_file_info_get_display_name (info);
             if (display_name)
               {
-                if (_gtk_fnmatch (rule->u.pattern, display_name, FALSE))
+                if (rule->suffix
+                    ? g_str_has_suffix (display_name, rule->suffix)
+                    : _gtk_fnmatch (rule->u.pattern, display_name, FALSE))
                   return TRUE;
               }
           }
@@ -810,21 +872,8 @@ gtk_file_filter_match (GtkFilter *filter,
 
         case FILTER_RULE_MIME_TYPE:
         case FILTER_RULE_PIXBUF_FORMATS:
-          {
-            const char *filter_content_type;
-
-            filter_content_type = g_file_info_get_content_type (info);
-            if (filter_content_type)
-              {
-                int i;
-
-                for (i = 0; rule->u.content_types[i]; i++)
-                  {
-                    if (g_content_type_is_a (filter_content_type, rule->u.content_types[i]))
-                      return TRUE;
-                  }
-              }
-          }
+          /* Matched all at once below, the order of rules doesn't matter */
+          has_content_type_rules = TRUE;
           break;
 
         default:
@@ -832,6 +881,16 @@ gtk_file_filter_match (GtkFilter *filter,
         }
     }
 
+  if (has_content_type_rules)
+    {
+      const char *filter_content_type;
+
+      filter_content_type = g_file_info_get_content_type (info);
+      if (filter_content_type &&
+          gtk_file_filter_match_content_type (file_filter, filter_content_type))
+        return TRUE;
+    }
+
   return FALSE;
 }
 
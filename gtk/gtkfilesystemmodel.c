@@ -128,6 +128,14 @@
 /* random number that everyone else seems to use, too */
 #define FILES_PER_QUERY 100
 
+/* While loading a directory, the model is thawed after this many
+ * milliseconds, so the first files show up quickly. Every thaw resorts
+ * all files, so the interval doubles each time, up to the maximum, to
+ * keep huge directories from being resorted over and over.
+ */
+#define MIN_THAW_INTERVAL 50
+#define MAX_THAW_INTERVAL 2000
+
 typedef struct _FileModelNode           FileModelNode;
 typedef struct _GtkFileSystemModelClass GtkFileSystemModelClass;
 
@@ -153,6 +161,7 @@ struct _GtkFileSystemModel
 
   GFile *               dir;            /* directory that's displayed */
   guint                 dir_thaw_source;/* GSource id for unfreezing the model */
+  guint                 dir_thaw_interval;/* ms until the next unfreeze while loading */
   char *                attributes;     /* attributes the file info must contain, or NULL for all attributes */
   GFileMonitor *        dir_monitor;    /* directory that is monitored, or NULL if monitoring was not supported */
 
@@ -1091,11 +1100,12 @@ gtk_file_system_model_got_files (GObject *object, GAsyncResult *res, gpointer da
       if (model->dir_thaw_source == 0)
         {
           freeze_updates (model);
-          model->dir_thaw_source = g_timeout_add_full (IO_PRIORITY + 1, 50,
+          model->dir_thaw_source = g_timeout_add_full (IO_PRIORITY + 1, model->dir_thaw_interval,
                                                        thaw_func,
                                                        model,
                                                        NULL);
           g_source_set_name_by_id (model->dir_thaw_source, "[gtk] thaw_func");
+          model->dir_thaw_interval = MIN (2 * model->dir_thaw_interval, MAX_THAW_INTERVAL);
         }
 
       for (walk = files; walk; walk = walk->next)
@@ -1161,11 +1171,23 @@ query_done_helper (GObject *     object,
   GtkFileSystemModel *model;
   GFile *file = G_FILE (object);
   GFileInfo *info;
+  GError *error = NULL;
   guint id;
 
-  info = g_file_query_info_finish (file, res, NULL);
+  info = g_file_query_info_finish (file, res, &error);
   if (info == NULL)
-    return;
+    {
+      /* The model is gone if the query was cancelled. Otherwise,
+       * it still needs to be thawed, or files added later would
+       * never show up.
+       */
+      if (do_thaw_updates &&
+          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        thaw_updates (GTK_FILE_SYSTEM_MODEL (data));
+
+      g_error_free (error);
+      return;
+    }
 
   model = GTK_FILE_SYSTEM_MODEL (data);
 
@@ -1244,6 +1266,7 @@ gtk_file_system_model_got_enumerator (GObject *dir, GAsyncResult *res, gpointer
     }
   else
     {
+      model->dir_thaw_interval = MIN_THAW_INTERVAL;
       g_file_enumerator_next_files_async (enumerator,
                                           g_file_is_native (model->dir) ? 50 * FILES_PER_QUERY : FILES_PER_QUERY,
                                           IO_PRIORITY,
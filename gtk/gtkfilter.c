@@ -19,9 +19,13 @@
 
 #include "config.h"
 
-#include "gtkfilter.h"
+#include "gtkfilterprivate.h"
 
+#include "gtkboolfilter.h"
+#include "gtkexpressionprivate.h"
 #include "gtkintl.h"
+#include "gtkstringfilter.h"
+#include "gtkstringlistprivate.h"
 #include "gtktypebuiltins.h"
 
 /**
@@ -180,3 +184,116 @@ gtk_filter_changed (GtkFilter       *self,
   g_signal_emit (self, signals[CHANGED], 0, change);
 }
 
+
+/*<private>
+ * gtk_filter_copy_for_thread:
+ * @self: a #GtkFilter
+ *
+ * Creates a copy of @self that matches the same items and can be
+ * used with gtk_filter_match() from another thread, while @self
+ * keeps being changed on the main thread. The copy must be
+ * unreffed on the main thread.
+ *
+ * This is only possible for filters that don't run application
+ * code while matching, so it returns %NULL for everything else.
+ *
+ * Returns: (nullable) (transfer full): a copy of @self or %NULL
+ **/
+GtkFilter *
+gtk_filter_copy_for_thread (GtkFilter *self)
+{
+  GtkExpression *expression;
+
+  g_return_val_if_fail (GTK_IS_FILTER (self), NULL);
+
+  if (GTK_IS_STRING_FILTER (self))
+    {
+      GtkStringFilter *filter = GTK_STRING_FILTER (self);
+      GtkStringFilter *copy;
+
+      expression = gtk_string_filter_get_expression (filter);
+      if (!gtk_expression_is_thread_safe (expression))
+        return NULL;
+
+      copy = gtk_string_filter_new (expression ? gtk_expression_ref (expression) : NULL);
+      gtk_string_filter_set_ignore_case (copy, gtk_string_filter_get_ignore_case (filter));
+      gtk_string_filter_set_match_mode (copy, gtk_string_filter_get_match_mode (filter));
+      gtk_string_filter_set_search (copy, gtk_string_filter_get_search (filter));
+
+      return GTK_FILTER (copy);
+    }
+  else if (GTK_IS_BOOL_FILTER (self))
+    {
+      GtkBoolFilter *filter = GTK_BOOL_FILTER (self);
+      GtkBoolFilter *copy;
+
+      expression = gtk_bool_filter_get_expression (filter);
+      if (!gtk_expression_is_thread_safe (expression))
+        return NULL;
+
+      copy = gtk_bool_filter_new (expression ? gtk_expression_ref (expression) : NULL);
+      gtk_bool_filter_set_invert (copy, gtk_bool_filter_get_invert (filter));
+
+      return GTK_FILTER (copy);
+    }
+
+  return NULL;
+}
+
+/*<private>
+ * gtk_filter_find_candidates:
+ * @self: a #GtkFilter
+ * @model: the model to filter
+ *
+ * Uses an index of @model if one exists to find the items that
+ * @self can possibly match. Items not in the result are known to
+ * not match, the others need to be checked with gtk_filter_match().
+ *
+ * This works for #GtkStringFilter on an indexed #GtkStringList,
+ * when searching the strings of the list.
+ *
+ * Returns: (nullable) (transfer full): the positions of the
+ *     candidates or %NULL if all items need to be checked
+ **/
+GtkBitset *
+gtk_filter_find_candidates (GtkFilter  *self,
+                            GListModel *model)
+{
+  GtkStringFilter *filter;
+  GtkExpression *expression;
+  GParamSpec *pspec;
+  GtkBitset *result;
+  char *search;
+
+  g_return_val_if_fail (GTK_IS_FILTER (self), NULL);
+  g_return_val_if_fail (G_IS_LIST_MODEL (model), NULL);
+
+  if (!GTK_IS_STRING_FILTER (self) || !GTK_IS_STRING_LIST (model))
+    return NULL;
+
+  filter = GTK_STRING_FILTER (self);
+  if (gtk_string_filter_get_search (filter) == NULL)
+    return NULL;
+
+  /* only the GtkStringObject:string property is in the index */
+  expression = gtk_string_filter_get_expression (filter);
+  if (expression == NULL ||
+      !G_TYPE_CHECK_INSTANCE_TYPE (expression, GTK_TYPE_PROPERTY_EXPRESSION) ||
+      gtk_property_expression_get_expression (expression) != NULL)
+    return NULL;
+
+  pspec = gtk_property_expression_get_pspec (expression);
+  if (pspec->owner_type != GTK_TYPE_STRING_OBJECT ||
+      !g_str_equal (pspec->name, "string"))
+    return NULL;
+
+  /* Exact and prefix matches are substring matches, too */
+  search = g_utf8_normalize (gtk_string_filter_get_search (filter), -1, G_NORMALIZE_ALL);
+  if (search == NULL)
+    return NULL;
+
+  result = gtk_string_list_find_substring (GTK_STRING_LIST (model), search);
+  g_free (search);
+
+  return result;
+}
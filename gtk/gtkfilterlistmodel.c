@@ -22,7 +22,9 @@
 #include "gtkfilterlistmodel.h"
 
 #include "gtkbitset.h"
+#include "gtkfilterprivate.h"
 #include "gtkintl.h"
+#include "gtklistmodelbulkprivate.h"
 #include "gtkprivate.h"
 
 /**
@@ -41,6 +43,53 @@
  * gtk_filter_list_model_set_incremental() for details.
  */
 
+/* Filtering in threads
+ *
+ * When filtering incrementally with a filter that can be copied with
+ * gtk_filter_copy_for_thread(), large amounts of pending items are
+ * split into chunks that get matched by a thread pool. The items are
+ * fetched from the model in the main thread when the job starts.
+ * Finished chunks are merged into the matches in an idle, so results
+ * show up while the rest is still being filtered.
+ *
+ * When the filter changes or items before the end of the job change
+ * position, the job is cancelled and a new one is started for
+ * everything still pending.
+ */
+#define GTK_FILTER_THREAD_MIN_ITEMS 10000
+#define GTK_FILTER_THREAD_CHUNK_SIZE 4096
+#define GTK_FILTER_MAX_THREADS 8
+
+typedef struct _GtkFilterJob GtkFilterJob;
+typedef struct _GtkFilterJobChunk GtkFilterJobChunk;
+
+struct _GtkFilterJobChunk
+{
+  GtkFilterJob *job;
+  GtkBitset *positions; /* of the items in this chunk */
+  gpointer *items;
+  GtkBitset *matches; /* only used by the thread until the chunk is finished */
+};
+
+struct _GtkFilterJob
+{
+  GtkFilterListModel *model; /* only used in the main thread */
+  GtkFilter *filter; /* a copy that is not used in the main thread */
+  guint last; /* largest position in the job */
+
+  guint n_chunks;
+  guint n_merged;
+  GtkFilterJobChunk *chunks;
+
+  int cancelled; /* atomic */
+
+  GMutex lock;
+  GCond cond;
+  guint n_finished; /* protected by lock */
+  GSList *finished; /* protected by lock, finished chunks not merged yet */
+  guint merge_cb; /* protected by lock */
+};
+
 enum {
   PROP_0,
   PROP_FILTER,
@@ -60,8 +109,10 @@ struct _GtkFilterListModel
   gboolean incremental;
 
   GtkBitset *matches; /* NULL if strictness != GTK_FILTER_MATCH_SOME */
-  GtkBitset *pending; /* not yet filtered items or NULL if all filtered */
+  GtkBitset *pending; /* not yet filtered items or NULL if all filtered,
+                         pending items in matches matched a less strict filter */
   guint pending_cb; /* idle callback handle */
+  GtkFilterJob *filter_job; /* filtering pending items in threads */
 };
 
 struct _GtkFilterListModelClass
@@ -139,28 +190,12 @@ gtk_filter_list_model_model_init (GListModelInterface *iface)
 G_DEFINE_TYPE_WITH_CODE (GtkFilterListModel, gtk_filter_list_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_filter_list_model_model_init))
 
-static gboolean
-gtk_filter_list_model_run_filter_on_item (GtkFilterListModel *self,
-                                          guint               position)
-{
-  gpointer item;
-  gboolean visible;
-
-  /* all other cases should have beeen optimized away */
-  g_assert (self->strictness == GTK_FILTER_MATCH_SOME);
-
-  item = g_list_model_get_item (self->model, position);
-  visible = gtk_filter_match (self->filter, item);
-  g_object_unref (item);
-
-  return visible;
-}
-
 static void
 gtk_filter_list_model_run_filter (GtkFilterListModel *self,
                                   guint               n_steps)
 {
   GtkBitsetIter iter;
+  GtkListModelReader reader;
   guint i, pos;
   gboolean more;
 
@@ -169,13 +204,20 @@ gtk_filter_list_model_run_filter (GtkFilterListModel *self,
   if (self->pending == NULL)
     return;
 
+  gtk_list_model_reader_init (&reader, self->model);
   for (i = 0, more = gtk_bitset_iter_init_first (&iter, self->pending, &pos);
        i < n_steps && more;
        i++, more = gtk_bitset_iter_next (&iter, &pos))
     {
-      if (gtk_filter_list_model_run_filter_on_item (self, pos))
+      /* all other cases should have beeen optimized away */
+      g_assert (self->strictness == GTK_FILTER_MATCH_SOME);
+
+      if (gtk_filter_match (self->filter, gtk_list_model_reader_get (&reader, pos)))
         gtk_bitset_add (self->matches, pos);
+      else
+        gtk_bitset_remove (self->matches, pos);
     }
+  gtk_list_model_reader_clear (&reader);
 
   if (more)
     gtk_bitset_remove_range_closed (self->pending, 0, pos - 1);
@@ -186,11 +228,175 @@ gtk_filter_list_model_run_filter (GtkFilterListModel *self,
   return;
 }
 
+static gboolean gtk_filter_list_model_merge_cb (gpointer data);
+
+static void
+gtk_filter_job_chunk_run (gpointer data,
+                          gpointer unused)
+{
+  GtkFilterJobChunk *chunk = data;
+  GtkFilterJob *job = chunk->job;
+  GtkBitsetIter iter;
+  guint i, pos;
+
+  for (i = 0, gtk_bitset_iter_init_first (&iter, chunk->positions, &pos);
+       gtk_bitset_iter_is_valid (&iter);
+       i++, gtk_bitset_iter_next (&iter, &pos))
+    {
+      if (i % 512 == 0 && g_atomic_int_get (&job->cancelled))
+        break;
+
+      if (gtk_filter_match (job->filter, chunk->items[i]))
+        gtk_bitset_add (chunk->matches, pos);
+    }
+
+  g_mutex_lock (&job->lock);
+  job->n_finished++;
+  if (!g_atomic_int_get (&job->cancelled))
+    {
+      job->finished = g_slist_prepend (job->finished, chunk);
+      if (job->merge_cb == 0)
+        job->merge_cb = g_idle_add (gtk_filter_list_model_merge_cb, job);
+    }
+  if (job->n_finished == job->n_chunks)
+    g_cond_broadcast (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static GThreadPool *
+get_filter_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (gtk_filter_job_chunk_run, NULL,
+                                    CLAMP (g_get_num_processors (), 1, GTK_FILTER_MAX_THREADS),
+                                    FALSE, NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+static void
+gtk_filter_job_chunk_clear (GtkFilterJobChunk *chunk)
+{
+  guint i, n_items;
+
+  if (chunk->items)
+    {
+      n_items = gtk_bitset_get_size (chunk->positions);
+      for (i = 0; i < n_items; i++)
+        g_object_unref (chunk->items[i]);
+      g_clear_pointer (&chunk->items, g_free);
+    }
+  g_clear_pointer (&chunk->positions, gtk_bitset_unref);
+  g_clear_pointer (&chunk->matches, gtk_bitset_unref);
+}
+
+static void
+gtk_filter_job_free (GtkFilterJob *job)
+{
+  guint i;
+
+  for (i = 0; i < job->n_chunks; i++)
+    gtk_filter_job_chunk_clear (&job->chunks[i]);
+  g_free (job->chunks);
+  g_slist_free (job->finished);
+  g_object_unref (job->filter);
+  g_mutex_clear (&job->lock);
+  g_cond_clear (&job->cond);
+  g_free (job);
+}
+
+static gboolean
+gtk_filter_list_model_start_filter_job (GtkFilterListModel *self)
+{
+  GtkFilterJob *job;
+  GtkFilter *filter;
+  GtkBitsetIter iter;
+  GtkListModelReader reader;
+  guint i, j, pos, n_items;
+
+  g_assert (self->filter_job == NULL);
+
+  n_items = gtk_bitset_get_size (self->pending);
+  if (n_items < GTK_FILTER_THREAD_MIN_ITEMS)
+    return FALSE;
+
+  filter = gtk_filter_copy_for_thread (self->filter);
+  if (filter == NULL)
+    return FALSE;
+
+  job = g_new0 (GtkFilterJob, 1);
+  job->model = self;
+  job->filter = filter;
+  job->last = gtk_bitset_get_maximum (self->pending);
+  job->n_chunks = (n_items + GTK_FILTER_THREAD_CHUNK_SIZE - 1) / GTK_FILTER_THREAD_CHUNK_SIZE;
+  job->chunks = g_new0 (GtkFilterJobChunk, job->n_chunks);
+  g_mutex_init (&job->lock);
+  g_cond_init (&job->cond);
+
+  /* The model and its items may only be accessed in the main thread */
+  gtk_list_model_reader_init (&reader, self->model);
+  gtk_bitset_iter_init_first (&iter, self->pending, &pos);
+  for (i = 0; i < job->n_chunks; i++)
+    {
+      GtkFilterJobChunk *chunk = &job->chunks[i];
+
+      chunk->job = job;
+      chunk->positions = gtk_bitset_new_empty ();
+      chunk->matches = gtk_bitset_new_empty ();
+      chunk->items = g_new (gpointer, MIN (GTK_FILTER_THREAD_CHUNK_SIZE, n_items - i * GTK_FILTER_THREAD_CHUNK_SIZE));
+      for (j = 0;
+           j < GTK_FILTER_THREAD_CHUNK_SIZE && gtk_bitset_iter_is_valid (&iter);
+           j++, gtk_bitset_iter_next (&iter, &pos))
+        {
+          gtk_bitset_add (chunk->positions, pos);
+          chunk->items[j] = g_object_ref (gtk_list_model_reader_get (&reader, pos));
+        }
+    }
+  gtk_list_model_reader_clear (&reader);
+
+  self->filter_job = job;
+
+  for (i = 0; i < job->n_chunks; i++)
+    g_thread_pool_push (get_filter_pool (), &job->chunks[i], NULL);
+
+  return TRUE;
+}
+
+/* Unmerged results are dropped, the items stay pending */
+static void
+gtk_filter_list_model_cancel_filter_job (GtkFilterListModel *self)
+{
+  GtkFilterJob *job = self->filter_job;
+
+  if (job == NULL)
+    return;
+
+  g_atomic_int_set (&job->cancelled, TRUE);
+
+  g_mutex_lock (&job->lock);
+  while (job->n_finished < job->n_chunks)
+    g_cond_wait (&job->cond, &job->lock);
+  g_clear_handle_id (&job->merge_cb, g_source_remove);
+  g_mutex_unlock (&job->lock);
+
+  self->filter_job = NULL;
+  gtk_filter_job_free (job);
+}
+
 static void
 gtk_filter_list_model_stop_filtering (GtkFilterListModel *self)
 {
   gboolean notify_pending = self->pending != NULL;
 
+  gtk_filter_list_model_cancel_filter_job (self);
   g_clear_pointer (&self->pending, gtk_bitset_unref);
   g_clear_handle_id (&self->pending_cb, g_source_remove);
 
@@ -238,6 +444,69 @@ gtk_filter_list_model_run_filter_cb (gpointer data)
   return G_SOURCE_CONTINUE;
 }
 
+static void
+gtk_filter_list_model_continue_filtering (GtkFilterListModel *self)
+{
+  if (self->pending == NULL || self->filter_job != NULL || self->pending_cb != 0)
+    return;
+
+  if (gtk_filter_list_model_start_filter_job (self))
+    return;
+
+  self->pending_cb = g_idle_add (gtk_filter_list_model_run_filter_cb, self);
+  g_source_set_name_by_id (self->pending_cb, "[gtk] gtk_filter_list_model_run_filter_cb");
+}
+
+static gboolean
+gtk_filter_list_model_merge_cb (gpointer data)
+{
+  GtkFilterJob *job = data;
+  GtkFilterListModel *self = job->model;
+  GSList *finished, *l;
+  GtkBitset *old;
+
+  /* Everything that gets rid of the job removes this callback first */
+  g_assert (self->filter_job == job);
+
+  g_mutex_lock (&job->lock);
+  job->merge_cb = 0;
+  finished = job->finished;
+  job->finished = NULL;
+  g_mutex_unlock (&job->lock);
+
+  old = gtk_bitset_copy (self->matches);
+
+  for (l = finished; l; l = l->next)
+    {
+      GtkFilterJobChunk *chunk = l->data;
+
+      gtk_bitset_subtract (self->matches, chunk->positions);
+      gtk_bitset_union (self->matches, chunk->matches);
+      gtk_bitset_subtract (self->pending, chunk->positions);
+      gtk_filter_job_chunk_clear (chunk);
+      job->n_merged++;
+    }
+  g_slist_free (finished);
+
+  if (job->n_merged == job->n_chunks)
+    gtk_filter_list_model_cancel_filter_job (self);
+
+  if (gtk_bitset_is_empty (self->pending))
+    {
+      gtk_filter_list_model_stop_filtering (self);
+    }
+  else
+    {
+      /* items added while the job was running */
+      gtk_filter_list_model_continue_filtering (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+    }
+
+  gtk_filter_list_model_emit_items_changed_for_changes (self, old);
+
+  return G_SOURCE_REMOVE;
+}
+
 /* NB: bitset is (transfer full) */
 static void
 gtk_filter_list_model_start_filtering (GtkFilterListModel *self,
@@ -267,9 +536,8 @@ gtk_filter_list_model_start_filtering (GtkFilterListModel *self,
     }
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
-  g_assert (self->pending_cb == 0);
-  self->pending_cb = g_idle_add (gtk_filter_list_model_run_filter_cb, self);
-  g_source_set_name_by_id (self->pending_cb, "[gtk] gtk_filter_list_model_run_filter_cb");
+  g_assert (self->pending_cb == 0 && self->filter_job == NULL);
+  gtk_filter_list_model_continue_filtering (self);
 }
 
 static void
@@ -302,6 +570,10 @@ gtk_filter_list_model_items_changed_cb (GListModel         *model,
   else
     filter_removed = 0;
 
+  /* The job's positions would be wrong after the splice */
+  if (self->filter_job && position <= self->filter_job->last)
+    gtk_filter_list_model_cancel_filter_job (self);
+
   gtk_bitset_splice (self->matches, position, removed, added);
   if (self->pending)
     gtk_bitset_splice (self->pending, position, removed, added);
@@ -314,6 +586,8 @@ gtk_filter_list_model_items_changed_cb (GListModel         *model,
   else
     filter_added = 0;
 
+  gtk_filter_list_model_continue_filtering (self);
+
   if (filter_removed > 0 || filter_added > 0)
     g_list_model_items_changed (G_LIST_MODEL (self),
                                 position > 0 ? gtk_bitset_get_size_in_range (self->matches, 0, position - 1) : 0,
@@ -476,7 +750,7 @@ gtk_filter_list_model_refilter (GtkFilterListModel *self,
 
     case GTK_FILTER_MATCH_SOME:
       {
-        GtkBitset *old, *pending;
+        GtkBitset *old, *pending, *candidates;
       
         if (self->matches == NULL)
           {
@@ -490,6 +764,8 @@ gtk_filter_list_model_refilter (GtkFilterListModel *self,
             old = self->matches;
           }
         self->strictness = new_strictness;
+        /* the job is using the old filter */
+        gtk_filter_list_model_cancel_filter_job (self);
         switch (change)
           {
           default:
@@ -505,10 +781,23 @@ gtk_filter_list_model_refilter (GtkFilterListModel *self,
             gtk_bitset_subtract (pending, self->matches);
             break;
           case GTK_FILTER_CHANGE_MORE_STRICT:
-            self->matches = gtk_bitset_new_empty ();
+            /* Only matches can still match. Keep them until they are
+             * filtered again, so incremental filtering only removes items.
+             */
+            self->matches = gtk_bitset_copy (old);
             pending = gtk_bitset_copy (old);
             break;
           }
+
+        candidates = gtk_filter_find_candidates (self->filter, self->model);
+        if (candidates)
+          {
+            /* everything else is known to not match */
+            gtk_bitset_intersect (pending, candidates);
+            if (change == GTK_FILTER_CHANGE_MORE_STRICT)
+              gtk_bitset_intersect (self->matches, candidates);
+            gtk_bitset_unref (candidates);
+          }
         gtk_filter_list_model_start_filtering (self, pending);
 
         gtk_filter_list_model_emit_items_changed_for_changes (self, old);
@@ -785,6 +1074,10 @@ gtk_filter_list_model_get_model (GtkFilterListModel *self)
  * turning this on. Depending on your model and filters, this may become
  * interesting around 10,000 to 100,000 items.
  *
+ * For large models, #GtkStringFilter and #GtkBoolFilter are evaluated
+ * in threads then, as long as their expression doesn't use closures.
+ * Property getters of the items then need to be thread-safe.
+ *
  * By default, incremental filtering is disabled.
  *
  * See gtk_filter_list_model_get_pending() for progress information
@@ -804,6 +1097,7 @@ gtk_filter_list_model_set_incremental (GtkFilterListModel *self,
   if (!incremental)
     {
       GtkBitset *old;
+      gtk_filter_list_model_cancel_filter_job (self);
       gtk_filter_list_model_run_filter (self, G_MAXUINT);
 
       old = gtk_bitset_copy (self->matches);
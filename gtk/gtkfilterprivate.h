@@ -0,0 +1,32 @@
+/*
+ * Copyright © 2020 Benjamin Otte
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_FILTER_PRIVATE_H__
+#define __GTK_FILTER_PRIVATE_H__
+
+#include <gtk/gtkbitset.h>
+#include <gtk/gtkfilter.h>
+
+G_BEGIN_DECLS
+
+GtkFilter *             gtk_filter_copy_for_thread              (GtkFilter              *self);
+GtkBitset *             gtk_filter_find_candidates              (GtkFilter              *self,
+                                                                 GListModel             *model);
+
+G_END_DECLS
+
+#endif /* __GTK_FILTER_PRIVATE_H__ */
@@ -376,3 +376,43 @@ gtk_fixed_remove (GtkFixed  *fixed,
 
   gtk_widget_unparent (widget);
 }
+
+/**
+ * gtk_fixed_set_indexed_picking:
+ * @fixed: a #GtkFixed
+ * @indexed_picking: whether to use a spatial index for picking
+ *
+ * Sets whether @fixed keeps a spatial index of its children to
+ * find the child under a point, instead of checking all of them.
+ *
+ * This makes input handling faster when @fixed has a large number
+ * of children. With the index, children are only picked inside the
+ * bounds of their border box, including their transform. Children
+ * that have descendants outside of their own bounds should not be
+ * used with it.
+ */
+void
+gtk_fixed_set_indexed_picking (GtkFixed *fixed,
+                               gboolean  indexed_picking)
+{
+  g_return_if_fail (GTK_IS_FIXED (fixed));
+
+  gtk_widget_set_pick_index_enabled (GTK_WIDGET (fixed), indexed_picking);
+}
+
+/**
+ * gtk_fixed_get_indexed_picking:
+ * @fixed: a #GtkFixed
+ *
+ * Returns whether @fixed uses a spatial index for picking.
+ * See gtk_fixed_set_indexed_picking().
+ *
+ * Returns: %TRUE if @fixed uses a spatial index
+ */
+gboolean
+gtk_fixed_get_indexed_picking (GtkFixed *fixed)
+{
+  g_return_val_if_fail (GTK_IS_FIXED (fixed), FALSE);
+
+  return gtk_widget_get_pick_index_enabled (GTK_WIDGET (fixed));
+}
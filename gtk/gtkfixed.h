@@ -91,6 +91,12 @@ GDK_AVAILABLE_IN_ALL
 GskTransform *  gtk_fixed_get_child_transform   (GtkFixed     *fixed,
                                                  GtkWidget    *widget);
 
+GDK_AVAILABLE_IN_ALL
+void            gtk_fixed_set_indexed_picking   (GtkFixed     *fixed,
+                                                 gboolean      indexed_picking);
+GDK_AVAILABLE_IN_ALL
+gboolean        gtk_fixed_get_indexed_picking   (GtkFixed     *fixed);
+
 G_END_DECLS
 
 #endif /* __GTK_FIXED_H__ */
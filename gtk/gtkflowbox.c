@@ -54,6 +54,11 @@
  *
  * Also see #GtkListBox.
  *
+ * GtkFlowBox creates and keeps a widget for every child, also when it
+ * is bound to a model with gtk_flow_box_bind_model(). For large numbers
+ * of items, consider using #GtkGridView instead, which only creates
+ * widgets for the items that are visible.
+ *
  * # CSS nodes
  *
  * |[<!-- language="plain" -->
@@ -2132,7 +2137,6 @@ gtk_flow_box_measure (GtkWidget      *widget,
                                                              &nat_item_width);
 
                   /* Round up how many lines we need to allocate for */
-                  n_children = get_visible_children (box);
                   lines = n_children / line_length;
                   if ((n_children % line_length) > 0)
                     lines++;
@@ -150,6 +150,8 @@ typedef struct {
   int width;
   int height;
   GdkTexture *holder;
+  /* Signaled when rendering to the texture is done */
+  GLsync sync;
 } Texture;
 
 typedef struct {
@@ -164,6 +166,8 @@ typedef struct {
   guint depth_stencil_buffer;
   Texture *texture;
   GList *textures;
+  /* The texture of the last rendered frame */
+  GdkTexture *last_holder;
 
   gboolean has_depth_buffer;
   gboolean has_stencil_buffer;
@@ -391,6 +395,12 @@ delete_one_texture (gpointer data)
   if (texture->holder)
     gdk_gl_texture_release (GDK_GL_TEXTURE (texture->holder));
 
+  if (texture->sync)
+    {
+      glDeleteSync (texture->sync);
+      texture->sync = NULL;
+    }
+
   if (texture->id != 0)
     {
       glDeleteTextures (1, &texture->id);
@@ -428,7 +438,14 @@ gtk_gl_area_ensure_texture (GtkGLArea *area)
           priv->textures = g_list_delete_link (priv->textures, link);
 
           if (priv->texture == NULL)
-            priv->texture = texture;
+            {
+              priv->texture = texture;
+              if (texture->sync)
+                {
+                  glDeleteSync (texture->sync);
+                  texture->sync = NULL;
+                }
+            }
           else
             delete_one_texture (texture);
         }
@@ -441,6 +458,7 @@ gtk_gl_area_ensure_texture (GtkGLArea *area)
       priv->texture->width = 0;
       priv->texture->height = 0;
       priv->texture->holder = NULL;
+      priv->texture->sync = NULL;
 
       glGenTextures (1, &priv->texture->id);
     }
@@ -595,6 +613,8 @@ gtk_gl_area_delete_textures (GtkGLArea *area)
 {
   GtkGLAreaPrivate *priv = gtk_gl_area_get_instance_private (area);
 
+  g_clear_object (&priv->last_holder);
+
   if (priv->texture)
     {
       delete_one_texture (priv->texture);
@@ -678,6 +698,21 @@ release_texture (gpointer data)
   texture->holder = NULL;
 }
 
+static gboolean
+gtk_gl_area_has_sync (GtkGLArea *area)
+{
+  GtkGLAreaPrivate *priv = gtk_gl_area_get_instance_private (area);
+  int major, minor;
+
+  gdk_gl_context_get_version (priv->context, &major, &minor);
+
+  if (gdk_gl_context_get_use_es (priv->context))
+    return major >= 3;
+
+  return major > 3 || (major == 3 && minor >= 2) ||
+         epoxy_has_gl_extension ("GL_ARB_sync");
+}
+
 static void
 gtk_gl_area_snapshot (GtkWidget   *widget,
                       GtkSnapshot *snapshot)
@@ -721,7 +756,11 @@ gtk_gl_area_snapshot (GtkWidget   *widget,
     {
       Texture *texture;
 
-      if (priv->needs_render || priv->auto_render)
+      /* Without a new frame, the same texture is shown again, so
+       * the renderer can tell that nothing changed.
+       */
+      if (priv->needs_render || priv->auto_render || priv->needs_resize ||
+          priv->last_holder == NULL)
         {
           if (priv->needs_resize)
             {
@@ -730,27 +769,38 @@ gtk_gl_area_snapshot (GtkWidget   *widget,
             }
 
           g_signal_emit (area, area_signals[RENDER], 0, priv->context, &unused);
-        }
 
-      priv->needs_render = FALSE;
+          priv->needs_render = FALSE;
 
-      texture = priv->texture;
-      priv->texture = NULL;
-      priv->textures = g_list_prepend (priv->textures, texture);
+          texture = priv->texture;
+          priv->texture = NULL;
+          priv->textures = g_list_prepend (priv->textures, texture);
 
-      texture->holder = gdk_gl_texture_new (priv->context,
-                                            texture->id,
-                                            texture->width,
-                                            texture->height,
-                                            release_texture, texture);
+          /* The renderer waits for the fence on the GPU instead of
+           * the CPU waiting for rendering to finish.
+           */
+          if (gtk_gl_area_has_sync (area))
+            {
+              texture->sync = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+              glFlush ();
+            }
+
+          texture->holder = gdk_gl_texture_new_with_sync (priv->context,
+                                                          texture->id,
+                                                          texture->width,
+                                                          texture->height,
+                                                          texture->sync,
+                                                          release_texture, texture);
+
+          g_clear_object (&priv->last_holder);
+          priv->last_holder = texture->holder;
+        }
 
       gtk_snapshot_append_texture (snapshot,
-                                   texture->holder,
+                                   priv->last_holder,
                                    &GRAPHENE_RECT_INIT (0, 0,
                                                         gtk_widget_get_width (widget),
                                                         gtk_widget_get_height (widget)));
-
-      g_object_unref (texture->holder);
     }
   else
     {
@@ -48,6 +48,7 @@
 #include "gtkdebug.h"
 #include "gtkintl.h"
 #include "gtklayoutchild.h"
+#include "gtklayoutmanagerprivate.h"
 #include "gtkorientable.h"
 #include "gtkprivate.h"
 #include "gtksizerequest.h"
@@ -428,6 +429,19 @@ typedef struct {
   GridLines lines[2];
 } GridRequest;
 
+/* The line requisitions computed by the last request run for one
+ * orientation. They depend on the children's sizes and, for a
+ * contextual run, on the size available in the other orientation,
+ * which is @for_size.
+ */
+typedef struct {
+  GridLine *lines;
+  int min, max;
+  int for_size;
+  guint serial;
+  guint valid : 1;
+} GridLinesCache;
+
 struct _GtkGridLayout
 {
   GtkLayoutManager parent_instance;
@@ -439,6 +453,9 @@ struct _GtkGridLayout
   int baseline_row;
 
   GridLineData linedata[2];
+
+  /* [contextual][orientation] */
+  GridLinesCache cache[2][2];
 };
 
 enum {
@@ -1071,6 +1088,65 @@ grid_request_run (GridRequest    *request,
   grid_request_homogeneous (request, orientation);
 }
 
+static void
+gtk_grid_layout_clear_cache (GtkGridLayout *self)
+{
+  int i, j;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+      {
+        g_clear_pointer (&self->cache[i][j].lines, g_free);
+        self->cache[i][j].valid = FALSE;
+      }
+}
+
+/* Like grid_request_run(), but reuses the result of the last run if
+ * no child has queued a resize since. Measuring the children is cheap
+ * then, but the grid still walks all of them several times per run,
+ * and it gets run for every measure and again for every allocation.
+ */
+static void
+grid_request_run_cached (GridRequest    *request,
+                         GtkOrientation  orientation,
+                         gboolean        contextual,
+                         int             for_size)
+{
+  GtkGridLayout *self = request->layout;
+  GridLinesCache *cache = &self->cache[contextual ? 1 : 0][orientation];
+  GridLines *lines = &request->lines[orientation];
+  guint serial = gtk_layout_manager_get_serial (GTK_LAYOUT_MANAGER (self));
+  gsize n_lines = lines->max - lines->min;
+
+  if (!contextual)
+    for_size = -1;
+
+  if (cache->valid &&
+      cache->serial == serial &&
+      cache->for_size == for_size &&
+      cache->min == lines->min &&
+      cache->max == lines->max &&
+      !request->widget->priv->resize_needed)
+    {
+      memcpy (lines->lines, cache->lines, n_lines * sizeof (GridLine));
+      return;
+    }
+
+  grid_request_run (request, orientation, contextual);
+
+  if (cache->lines == NULL || cache->max - cache->min != lines->max - lines->min)
+    {
+      g_free (cache->lines);
+      cache->lines = g_new (GridLine, n_lines);
+    }
+  memcpy (cache->lines, lines->lines, n_lines * sizeof (GridLine));
+  cache->min = lines->min;
+  cache->max = lines->max;
+  cache->for_size = for_size;
+  cache->serial = serial;
+  cache->valid = TRUE;
+}
+
 static void
 grid_distribute_non_homogeneous (GridLines *lines,
                                  int        nonempty,
@@ -1375,7 +1451,7 @@ gtk_grid_layout_get_size (GtkGridLayout  *self,
   lines->lines = g_newa (GridLine, lines->max - lines->min);
   memset (lines->lines, 0, (lines->max - lines->min) * sizeof (GridLine));
 
-  grid_request_run (&request, orientation, FALSE);
+  grid_request_run_cached (&request, orientation, FALSE, -1);
   grid_request_sum (&request, orientation,
                     minimum, natural,
                     minimum_baseline, natural_baseline);
@@ -1418,11 +1494,11 @@ gtk_grid_layout_get_size_for_size (GtkGridLayout  *self,
   lines->lines = g_newa (GridLine, lines->max - lines->min);
   memset (lines->lines, 0, (lines->max - lines->min) * sizeof (GridLine));
 
-  grid_request_run (&request, 1 - orientation, FALSE);
+  grid_request_run_cached (&request, 1 - orientation, FALSE, -1);
   grid_request_sum (&request, 1 - orientation, &min_size, &nat_size, NULL, NULL);
   grid_request_allocate (&request, 1 - orientation, MAX (size, min_size));
 
-  grid_request_run (&request, orientation, TRUE);
+  grid_request_run_cached (&request, orientation, TRUE, MAX (size, min_size));
   grid_request_sum (&request, orientation,
                     minimum, natural,
                     minimum_baseline, natural_baseline);
@@ -1551,11 +1627,12 @@ gtk_grid_layout_allocate (GtkLayoutManager *manager,
   else
     orientation = GTK_ORIENTATION_VERTICAL;
 
-  grid_request_run (&request, OPPOSITE_ORIENTATION (orientation), FALSE);
+  grid_request_run_cached (&request, OPPOSITE_ORIENTATION (orientation), FALSE, -1);
   grid_request_allocate (&request, OPPOSITE_ORIENTATION (orientation),
                          GET_SIZE (width, height, OPPOSITE_ORIENTATION (orientation)));
 
-  grid_request_run (&request, orientation, TRUE);
+  grid_request_run_cached (&request, orientation, TRUE,
+                           GET_SIZE (width, height, OPPOSITE_ORIENTATION (orientation)));
   grid_request_allocate (&request, orientation, GET_SIZE (width, height, orientation));
 
   grid_request_position (&request, 0);
@@ -1641,6 +1718,7 @@ gtk_grid_layout_finalize (GObject *gobject)
   GtkGridLayout *self = GTK_GRID_LAYOUT (gobject);
 
   g_clear_pointer (&self->row_properties, g_array_unref);
+  gtk_grid_layout_clear_cache (self);
 
   G_OBJECT_CLASS (gtk_grid_layout_parent_class)->finalize (gobject);
 }
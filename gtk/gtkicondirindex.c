@@ -0,0 +1,376 @@
+/* GTK - The GIMP Toolkit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkicondirindexprivate.h"
+
+#include "gtkdebug.h"
+
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+
+/* A per-user index of the contents of icon theme directories that
+ * don't have an up-to-date icon-theme.cache. Without it, every
+ * application start has to read all of these directories.
+ *
+ * The index is a single file for all themes in
+ * $XDG_CACHE_HOME/gtk-4.0/icon-theme-index. It is mapped into memory
+ * and looked up by directory. Each entry carries the mtime of the
+ * directory it was made from, and is ignored when that doesn't match
+ * anymore. Directories that were missing or stale get scanned as
+ * before, and the updated index is written in a thread once loading
+ * the themes is done, for the next time.
+ *
+ * The file format is, in native byte order:
+ *
+ *   char    magic[8]          "GTKIDXv1"
+ *   guint32 n_entries
+ *   entries
+ *
+ * with each entry being:
+ *
+ *   guint32 size              of the whole entry
+ *   gint64  mtime
+ *   guint32 n_icons
+ *   char    directory[]       nul-terminated
+ *   n_icons times:
+ *     guint8  flags           IconCacheFlag
+ *     char    name[]          nul-terminated, without suffix
+ */
+
+#define INDEX_MAGIC "GTKIDXv1"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_HEADER_SIZE (INDEX_MAGIC_LEN + 4)
+#define ENTRY_HEADER_SIZE (4 + 8 + 4)
+
+struct _GtkIconDirIndex {
+  GMappedFile *map;
+  GHashTable *mapped; /* directory -> entry in map */
+  GHashTable *used;   /* directory (owned) -> GBytes with the entry */
+  gboolean dirty;
+};
+
+static char *
+get_index_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gtk-4.0", "icon-theme-index", NULL);
+}
+
+static guint32
+get_uint32 (const char *data)
+{
+  guint32 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return value;
+}
+
+static gint64
+get_int64 (const char *data)
+{
+  gint64 value;
+
+  memcpy (&value, data, sizeof (value));
+
+  return value;
+}
+
+static void
+load_index (GtkIconDirIndex *index)
+{
+  const char *data;
+  char *filename;
+  gsize size, pos;
+  guint32 i, n_entries;
+
+  filename = get_index_filename ();
+  index->map = g_mapped_file_new (filename, FALSE, NULL);
+  g_free (filename);
+
+  if (index->map == NULL)
+    return;
+
+  data = g_mapped_file_get_contents (index->map);
+  size = g_mapped_file_get_length (index->map);
+
+  if (size < INDEX_HEADER_SIZE ||
+      memcmp (data, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0)
+    goto invalid;
+
+  n_entries = get_uint32 (data + INDEX_MAGIC_LEN);
+  pos = INDEX_HEADER_SIZE;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      const char *entry = data + pos;
+      guint32 entry_size;
+
+      if (size - pos < ENTRY_HEADER_SIZE)
+        goto invalid;
+
+      entry_size = get_uint32 (entry);
+      if (entry_size <= ENTRY_HEADER_SIZE || entry_size > size - pos ||
+          memchr (entry + ENTRY_HEADER_SIZE, 0, entry_size - ENTRY_HEADER_SIZE) == NULL)
+        goto invalid;
+
+      g_hash_table_insert (index->mapped, (char *) entry + ENTRY_HEADER_SIZE, (char *) entry);
+      pos += entry_size;
+    }
+
+  GTK_NOTE (ICONTHEME, g_message ("mapped icon directory index with %u directories", n_entries));
+
+  return;
+
+invalid:
+  GTK_NOTE (ICONTHEME, g_message ("icon directory index is invalid, ignoring it"));
+  g_hash_table_remove_all (index->mapped);
+  g_clear_pointer (&index->map, g_mapped_file_unref);
+}
+
+GtkIconDirIndex *
+gtk_icon_dir_index_new (void)
+{
+  GtkIconDirIndex *index;
+
+  index = g_new0 (GtkIconDirIndex, 1);
+  index->mapped = g_hash_table_new (g_str_hash, g_str_equal);
+  index->used = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_bytes_unref);
+
+  load_index (index);
+
+  return index;
+}
+
+void
+gtk_icon_dir_index_free (GtkIconDirIndex *index)
+{
+  g_hash_table_unref (index->used);
+  g_hash_table_unref (index->mapped);
+  g_clear_pointer (&index->map, g_mapped_file_unref);
+  g_free (index);
+}
+
+/*
+ * gtk_icon_dir_index_list_icons:
+ * @index: an index
+ * @directory: the directory to list
+ * @mtime: the current mtime of @directory
+ * @set: the string set to intern icon names into
+ * @found: return location for whether @directory is in the index
+ *
+ * Returns the icons in @directory, in the same form as scanning the
+ * directory would, if the index has an entry for it that is up to date.
+ * Otherwise, @found is set to %FALSE and the caller has to scan the
+ * directory and add it with gtk_icon_dir_index_add().
+ *
+ * Returns: (nullable): a hash table of icon names to IconCacheFlags,
+ *   or %NULL if the directory has no icons
+ */
+GHashTable *
+gtk_icon_dir_index_list_icons (GtkIconDirIndex *index,
+                               const char      *directory,
+                               time_t           mtime,
+                               GtkStringSet    *set,
+                               gboolean        *found)
+{
+  const char *entry, *p, *end;
+  GHashTable *icons = NULL;
+  guint32 entry_size, i, n_icons;
+
+  *found = FALSE;
+
+  entry = g_hash_table_lookup (index->mapped, directory);
+  if (entry == NULL)
+    return NULL;
+
+  if (get_int64 (entry + 4) != (gint64) mtime)
+    {
+      GTK_NOTE (ICONTHEME, g_message ("icon directory index outdated for %s", directory));
+      return NULL;
+    }
+
+  entry_size = get_uint32 (entry);
+  n_icons = get_uint32 (entry + 4 + 8);
+  end = entry + entry_size;
+  p = entry + ENTRY_HEADER_SIZE + strlen (directory) + 1;
+
+  for (i = 0; i < n_icons; i++)
+    {
+      guint flags;
+      const char *name;
+
+      if (end - p < 2 || memchr (p + 1, 0, end - p - 1) == NULL)
+        {
+          g_clear_pointer (&icons, g_hash_table_unref);
+          return NULL;
+        }
+
+      flags = (guint8) p[0];
+      name = gtk_string_set_add (set, p + 1);
+      p += 1 + strlen (p + 1) + 1;
+
+      if (!icons)
+        icons = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+      flags |= GPOINTER_TO_UINT (g_hash_table_lookup (icons, name));
+      g_hash_table_replace (icons, (char *) name, GUINT_TO_POINTER (flags));
+    }
+
+  *found = TRUE;
+  /* The map outlives the entries in used, see gtk_icon_dir_index_save() */
+  g_hash_table_replace (index->used, g_strdup (directory), g_bytes_new_static (entry, entry_size));
+
+  return icons;
+}
+
+/*
+ * gtk_icon_dir_index_add:
+ * @index: an index
+ * @directory: the directory that was scanned
+ * @mtime: the mtime of @directory
+ * @icons: (nullable): the result of scanning @directory
+ *
+ * Records the contents of @directory, so they will be in the index
+ * after the next gtk_icon_dir_index_save().
+ */
+void
+gtk_icon_dir_index_add (GtkIconDirIndex *index,
+                        const char      *directory,
+                        time_t           mtime,
+                        GHashTable      *icons)
+{
+  GByteArray *entry;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint32 size, n_icons;
+  gint64 mtime64;
+
+  entry = g_byte_array_new ();
+  g_byte_array_set_size (entry, ENTRY_HEADER_SIZE);
+  g_byte_array_append (entry, (const guint8 *) directory, strlen (directory) + 1);
+
+  n_icons = 0;
+  if (icons)
+    {
+      g_hash_table_iter_init (&iter, icons);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          guint8 flags = GPOINTER_TO_UINT (value);
+
+          g_byte_array_append (entry, &flags, 1);
+          g_byte_array_append (entry, key, strlen (key) + 1);
+          n_icons++;
+        }
+    }
+
+  size = entry->len;
+  mtime64 = mtime;
+  memcpy (entry->data, &size, 4);
+  memcpy (entry->data + 4, &mtime64, 8);
+  memcpy (entry->data + 4 + 8, &n_icons, 4);
+
+  g_hash_table_replace (index->used, g_strdup (directory), g_byte_array_free_to_bytes (entry));
+  index->dirty = TRUE;
+}
+
+static void
+save_index_thread (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+  GBytes *bytes = task_data;
+  GError *error = NULL;
+  char *filename, *dirname;
+
+  filename = get_index_filename ();
+  dirname = g_path_get_dirname (filename);
+
+  if (g_mkdir_with_parents (dirname, 0700) != 0 ||
+      !g_file_set_contents (filename,
+                            g_bytes_get_data (bytes, NULL),
+                            g_bytes_get_size (bytes),
+                            &error))
+    {
+      GTK_NOTE (ICONTHEME, g_message ("failed to write icon directory index: %s",
+                                      error ? error->message : g_strerror (errno)));
+      g_clear_error (&error);
+    }
+
+  g_free (dirname);
+  g_free (filename);
+}
+
+/*
+ * gtk_icon_dir_index_save:
+ * @index: an index
+ *
+ * If directories were added to @index, writes out the updated index
+ * in a thread. Entries for directories that weren't looked at, for
+ * example from other themes, are kept.
+ */
+void
+gtk_icon_dir_index_save (GtkIconDirIndex *index)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GByteArray *data;
+  guint32 n_entries;
+  GTask *task;
+
+  if (!index->dirty)
+    return;
+
+  data = g_byte_array_new ();
+  g_byte_array_append (data, (const guint8 *) INDEX_MAGIC, INDEX_MAGIC_LEN);
+  g_byte_array_set_size (data, INDEX_HEADER_SIZE);
+  n_entries = 0;
+
+  g_hash_table_iter_init (&iter, index->used);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      gsize size;
+      gconstpointer entry = g_bytes_get_data (value, &size);
+
+      g_byte_array_append (data, entry, size);
+      n_entries++;
+    }
+
+  g_hash_table_iter_init (&iter, index->mapped);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (g_hash_table_contains (index->used, key))
+        continue;
+
+      g_byte_array_append (data, value, get_uint32 (value));
+      n_entries++;
+    }
+
+  memcpy (data->data + INDEX_MAGIC_LEN, &n_entries, 4);
+
+  GTK_NOTE (ICONTHEME, g_message ("writing icon directory index with %u directories", n_entries));
+
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, gtk_icon_dir_index_save);
+  g_task_set_task_data (task, g_byte_array_free_to_bytes (data), (GDestroyNotify) g_bytes_unref);
+  g_task_run_in_thread (task, save_index_thread);
+  g_object_unref (task);
+
+  index->dirty = FALSE;
+}
@@ -0,0 +1,44 @@
+/* GTK - The GIMP Toolkit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_ICON_DIR_INDEX_PRIVATE_H__
+#define __GTK_ICON_DIR_INDEX_PRIVATE_H__
+
+#include <gtk/gtkiconthemeprivate.h>
+#include <time.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GtkIconDirIndex GtkIconDirIndex;
+
+GtkIconDirIndex *gtk_icon_dir_index_new          (void);
+void             gtk_icon_dir_index_free         (GtkIconDirIndex *index);
+
+GHashTable *     gtk_icon_dir_index_list_icons   (GtkIconDirIndex *index,
+                                                  const char      *directory,
+                                                  time_t           mtime,
+                                                  GtkStringSet    *set,
+                                                  gboolean        *found);
+void             gtk_icon_dir_index_add          (GtkIconDirIndex *index,
+                                                  const char      *directory,
+                                                  time_t           mtime,
+                                                  GHashTable      *icons);
+
+void             gtk_icon_dir_index_save         (GtkIconDirIndex *index);
+
+G_END_DECLS
+
+#endif /* __GTK_ICON_DIR_INDEX_PRIVATE_H__ */
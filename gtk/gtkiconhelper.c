@@ -177,6 +177,36 @@ gtk_icon_helper_ensure_paintable (GtkIconHelper *self, gboolean preload)
   self->texture_is_symbolic = symbolic;
 }
 
+/* How long snapshots may wait for icons to load in each frame, in
+ * microseconds. Once that is used up, icons that aren't loaded yet
+ * are left out, and their widgets redrawn when they are.
+ */
+#define ICON_LOAD_BUDGET_PER_FRAME 4000
+
+static gint64 icon_load_budget_frame = -1;
+static gint64 icon_load_budget_used;
+
+static gboolean
+gtk_icon_helper_may_wait_for_icon (GtkIconHelper *self)
+{
+  GdkFrameClock *frame_clock;
+  gint64 frame;
+
+  /* Not drawing to a surface, there are no frames to spread loads over */
+  frame_clock = gtk_widget_get_frame_clock (self->owner);
+  if (frame_clock == NULL)
+    return TRUE;
+
+  frame = gdk_frame_clock_get_frame_counter (frame_clock);
+  if (frame != icon_load_budget_frame)
+    {
+      icon_load_budget_frame = frame;
+      icon_load_budget_used = 0;
+    }
+
+  return icon_load_budget_used < ICON_LOAD_BUDGET_PER_FRAME;
+}
+
 static void
 gtk_icon_helper_paintable_snapshot (GdkPaintable *paintable,
                                     GdkSnapshot  *snapshot,
@@ -185,6 +215,7 @@ gtk_icon_helper_paintable_snapshot (GdkPaintable *paintable,
 {
   GtkIconHelper *self = GTK_ICON_HELPER (paintable);
   GtkCssStyle *style;
+  gint64 load_start = 0;
 
   style = gtk_css_node_get_style (self->node);
 
@@ -192,6 +223,18 @@ gtk_icon_helper_paintable_snapshot (GdkPaintable *paintable,
   if (self->paintable == NULL)
     return;
 
+  if (GTK_IS_ICON_PAINTABLE (self->paintable) &&
+      !gtk_icon_paintable_is_loaded (GTK_ICON_PAINTABLE (self->paintable)))
+    {
+      if (!gtk_icon_helper_may_wait_for_icon (self))
+        {
+          gtk_icon_paintable_queue_load (GTK_ICON_PAINTABLE (self->paintable), TRUE, self->owner);
+          return;
+        }
+
+      load_start = g_get_monotonic_time ();
+    }
+
   switch (gtk_image_definition_get_storage_type (self->def))
     {
     case GTK_IMAGE_ICON_NAME:
@@ -285,6 +328,9 @@ gtk_icon_helper_paintable_snapshot (GdkPaintable *paintable,
       }
       break;
     }
+
+  if (load_start != 0)
+    icon_load_budget_used += g_get_monotonic_time () - load_start;
 }
 
 static GdkPaintable *
@@ -43,6 +43,7 @@
 #include "gtkcsscolorvalueprivate.h"
 #include "gtkdebug.h"
 #include "gtkiconcacheprivate.h"
+#include "gtkicondirindexprivate.h"
 #include "gtkintl.h"
 #include "gtkmain.h"
 #include "gtksettingsprivate.h"
@@ -335,6 +336,9 @@ struct _GtkIconTheme
   gint64 last_stat_time;
   GArray *dir_mtimes;
 
+  /* Only set while loading the themes */
+  GtkIconDirIndex *dir_index;
+
   gulong theme_changed_idle;
 
   int serial;
@@ -1969,12 +1973,17 @@ load_themes (GtkIconTheme *self)
   GStatBuf stat_buf;
   int j;
 
+  self->dir_index = gtk_icon_dir_index_new ();
+
   if (self->current_theme)
     insert_theme (self, self->current_theme);
 
   insert_theme (self, FALLBACK_ICON_THEME);
   self->themes = g_list_reverse (self->themes);
 
+  gtk_icon_dir_index_save (self->dir_index);
+  g_clear_pointer (&self->dir_index, gtk_icon_dir_index_free);
+
   self->unthemed_icons = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                 g_free, (GDestroyNotify)free_unthemed_icon);
 
@@ -2410,18 +2419,185 @@ choose_icon (GtkIconTheme      *self,
   return icon;
 }
 
+/* Icons are loaded on a small pool of threads of their own, so that a
+ * view full of icons doesn't flood the default GTask pool. Icons that
+ * are needed for a snapshot go before preloads. Requests don't keep
+ * the icon alive, so icons that were dropped in the meantime, like ones
+ * that were scrolled out of view, are skipped.
+ *
+ * Widgets that asked for an icon are redrawn when it is loaded. That
+ * is done in batches, from one idle for all icons that finished.
+ */
+#define ICON_LOAD_MAX_THREADS 4
+
+typedef struct
+{
+  GWeakRef icon;
+  GWeakRef widget;
+  gboolean visible;
+  guint serial;
+} IconLoadRequest;
+
+static GMutex icon_load_lock;
+static GPtrArray *icon_load_done;  /* IconLoadRequest, protected by icon_load_lock */
+static guint icon_load_done_idle;  /* protected by icon_load_lock */
+
+static void
+icon_load_request_free (IconLoadRequest *request)
+{
+  g_weak_ref_clear (&request->icon);
+  g_weak_ref_clear (&request->widget);
+  g_free (request);
+}
+
+static int
+icon_load_request_compare (gconstpointer a,
+                           gconstpointer b,
+                           gpointer      user_data)
+{
+  const IconLoadRequest *ra = a;
+  const IconLoadRequest *rb = b;
+
+  if (ra->visible != rb->visible)
+    return ra->visible ? -1 : 1;
+
+  /* Wraps around safely */
+  return (int) (ra->serial - rb->serial);
+}
+
+static gboolean
+icon_load_done_cb (gpointer data)
+{
+  GPtrArray *done;
+  guint i;
+
+  g_mutex_lock (&icon_load_lock);
+  done = g_steal_pointer (&icon_load_done);
+  icon_load_done_idle = 0;
+  g_mutex_unlock (&icon_load_lock);
+
+  for (i = 0; done && i < done->len; i++)
+    {
+      IconLoadRequest *request = g_ptr_array_index (done, i);
+      GtkWidget *widget = g_weak_ref_get (&request->widget);
+
+      if (widget)
+        {
+          gtk_widget_queue_draw (widget);
+          g_object_unref (widget);
+        }
+    }
+
+  g_clear_pointer (&done, g_ptr_array_unref);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
-load_icon_thread (GTask        *task,
-                  gpointer      source_object,
-                  gpointer      task_data,
-                  GCancellable *cancellable)
+load_icon_thread (gpointer data,
+                  gpointer user_data)
 {
-  GtkIconPaintable *self = GTK_ICON_PAINTABLE (source_object);
+  IconLoadRequest *request = data;
+  GtkIconPaintable *self;
+
+  self = g_weak_ref_get (&request->icon);
+  if (self == NULL)
+    {
+      icon_load_request_free (request);
+      return;
+    }
 
   g_mutex_lock (&self->texture_lock);
   icon_ensure_texture__locked (self, TRUE);
   g_mutex_unlock (&self->texture_lock);
-  g_task_return_pointer (task, NULL, NULL);
+
+  g_object_unref (self);
+
+  if (!g_weak_ref_get_is_set (&request->widget))
+    {
+      icon_load_request_free (request);
+      return;
+    }
+
+  g_mutex_lock (&icon_load_lock);
+  if (icon_load_done == NULL)
+    icon_load_done = g_ptr_array_new_with_free_func ((GDestroyNotify) icon_load_request_free);
+  g_ptr_array_add (icon_load_done, request);
+  if (icon_load_done_idle == 0)
+    {
+      icon_load_done_idle = g_idle_add (icon_load_done_cb, NULL);
+      g_source_set_name_by_id (icon_load_done_idle, "[gtk] icon_load_done_cb");
+    }
+  g_mutex_unlock (&icon_load_lock);
+}
+
+static GThreadPool *
+get_icon_load_pool (void)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (load_icon_thread, NULL,
+                                    CLAMP (g_get_num_processors () - 1, 1, ICON_LOAD_MAX_THREADS),
+                                    FALSE, NULL);
+      g_thread_pool_set_sort_function (new_pool, icon_load_request_compare, NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/*
+ * gtk_icon_paintable_queue_load:
+ * @icon: a #GtkIconPaintable
+ * @visible: %TRUE if the icon is needed on screen now
+ * @widget: (nullable): a widget to redraw once the icon is loaded
+ *
+ * Queues loading the texture of @icon in a thread. Loads for visible
+ * icons are done before other ones.
+ */
+void
+gtk_icon_paintable_queue_load (GtkIconPaintable *icon,
+                               gboolean          visible,
+                               GtkWidget        *widget)
+{
+  static int serial;
+  IconLoadRequest *request;
+
+  request = g_new0 (IconLoadRequest, 1);
+  g_weak_ref_init (&request->icon, icon);
+  g_weak_ref_init (&request->widget, widget);
+  request->visible = visible;
+  request->serial = (guint) g_atomic_int_add (&serial, 1);
+
+  g_thread_pool_push (get_icon_load_pool (), request, NULL);
+}
+
+/*
+ * gtk_icon_paintable_is_loaded:
+ * @icon: a #GtkIconPaintable
+ *
+ * Returns whether snapshotting @icon can be done without waiting
+ * for its texture to be loaded.
+ */
+gboolean
+gtk_icon_paintable_is_loaded (GtkIconPaintable *icon)
+{
+  gboolean loaded;
+
+  /* If we fail to get the lock it is because some other thread is
+     currently loading the icon */
+  if (!g_mutex_trylock (&icon->texture_lock))
+    return FALSE;
+
+  loaded = icon->texture != NULL;
+  g_mutex_unlock (&icon->texture_lock);
+
+  return loaded;
 }
 
 /**
@@ -2499,21 +2675,16 @@ gtk_icon_theme_lookup_icon (GtkIconTheme       *self,
 
   if (flags & GTK_ICON_LOOKUP_PRELOAD)
     {
-      gboolean has_texture = FALSE;
-
       /* If we fail to get the lock it is because some other thread is
          currently loading the icon, so we need to do nothing */
       if (g_mutex_trylock (&icon->texture_lock))
         {
-          has_texture = icon->texture != NULL;
+          gboolean has_texture = icon->texture != NULL;
+
           g_mutex_unlock (&icon->texture_lock);
 
           if (!has_texture)
-            {
-              GTask *task = g_task_new (icon, NULL, NULL, NULL);
-              g_task_run_in_thread (task, load_icon_thread);
-              g_object_unref (task);
-            }
+            gtk_icon_paintable_queue_load (icon, FALSE, NULL);
         }
     }
 
@@ -3299,6 +3470,7 @@ theme_subdir_load (GtkIconTheme *self,
   GError *error = NULL;
   guint32 dir_size_index;
   IconThemeDirSize *dir_size;
+  GStatBuf stat_buf;
   int scale;
   guint i;
 
@@ -3359,9 +3531,11 @@ theme_subdir_load (GtkIconTheme *self,
       full_dir = g_build_filename (dir_mtime->dir, subdir, NULL);
 
       /* First, see if we have a cache for the directory */
-      if (dir_mtime->cache != NULL || g_file_test (full_dir, G_FILE_TEST_IS_DIR))
+      if (dir_mtime->cache != NULL ||
+          (g_stat (full_dir, &stat_buf) == 0 && S_ISDIR (stat_buf.st_mode)))
         {
           GHashTable *icons = NULL;
+          gboolean found;
 
           if (dir_mtime->cache == NULL)
             {
@@ -3372,7 +3546,16 @@ theme_subdir_load (GtkIconTheme *self,
           if (dir_mtime->cache != NULL)
             icons = gtk_icon_cache_list_icons_in_directory (dir_mtime->cache, subdir, &theme->icons);
           else
-            icons = scan_directory (self, full_dir, &theme->icons);
+            {
+              /* Next, the per-user index, and only then read the directory */
+              icons = gtk_icon_dir_index_list_icons (self->dir_index, full_dir, stat_buf.st_mtime,
+                                                     &theme->icons, &found);
+              if (!found)
+                {
+                  icons = scan_directory (self, full_dir, &theme->icons);
+                  gtk_icon_dir_index_add (self->dir_index, full_dir, stat_buf.st_mtime, icons);
+                }
+            }
 
           if (icons)
             {
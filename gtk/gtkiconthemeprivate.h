@@ -32,6 +32,12 @@ void gtk_icon_theme_lookup_symbolic_colors   (GtkCssStyle      *style,
                                               GdkRGBA          *success_out,
                                               GdkRGBA          *warning_out,
                                               GdkRGBA          *error_out);
+
+gboolean gtk_icon_paintable_is_loaded        (GtkIconPaintable *icon);
+void     gtk_icon_paintable_queue_load       (GtkIconPaintable *icon,
+                                              gboolean          visible,
+                                              GtkWidget        *widget);
+
 void gtk_icon_paintable_snapshot_with_colors (GtkIconPaintable *icon,
                                               GtkSnapshot      *snapshot,
                                               double            width,
@@ -79,6 +79,13 @@
 
 #define SCROLL_EDGE_SIZE 15
 
+/* Models with more items than this only measure a sample of
+ * GTK_ICON_VIEW_SAMPLE_ITEMS items or rows, and give all rows the
+ * same height. Measuring every item makes resizing unusably slow.
+ */
+#define GTK_ICON_VIEW_ESTIMATE_ITEMS 10000
+#define GTK_ICON_VIEW_SAMPLE_ITEMS   64
+
 typedef struct _GtkIconViewChild GtkIconViewChild;
 struct _GtkIconViewChild
 {
@@ -1255,6 +1262,18 @@ gtk_icon_view_get_n_items (GtkIconView *icon_view)
   return gtk_tree_model_iter_n_children (priv->model, NULL);
 }
 
+/* Returns the distance between the items that get measured */
+static int
+gtk_icon_view_get_sample_stride (GtkIconView *icon_view)
+{
+  int n_items = gtk_icon_view_get_n_items (icon_view);
+
+  if (n_items <= GTK_ICON_VIEW_ESTIMATE_ITEMS)
+    return 1;
+
+  return n_items / GTK_ICON_VIEW_SAMPLE_ITEMS;
+}
+
 static void
 adjust_wrap_width (GtkIconView *icon_view)
 {
@@ -1384,29 +1403,37 @@ gtk_icon_view_get_preferred_item_size (GtkIconView    *icon_view,
   GtkIconViewPrivate *priv = icon_view->priv;
   GtkCellAreaContext *context;
   GList *items;
+  int i, stride;
 
   g_assert (!gtk_icon_view_is_empty (icon_view));
 
   context = gtk_cell_area_create_context (priv->cell_area);
+  stride = gtk_icon_view_get_sample_stride (icon_view);
 
   for_size -= 2 * priv->item_padding;
 
   if (for_size > 0)
     {
       /* This is necessary for the context to work properly */
-      for (items = priv->items; items; items = items->next)
+      for (items = priv->items, i = 0; items; items = items->next, i++)
         {
           GtkIconViewItem *item = items->data;
 
+          if (i % stride != 0)
+            continue;
+
           _gtk_icon_view_set_cell_data (icon_view, item);
           cell_area_get_preferred_size (icon_view, context, 1 - orientation, -1, NULL, NULL);
         }
     }
 
-  for (items = priv->items; items; items = items->next)
+  for (items = priv->items, i = 0; items; items = items->next, i++)
     {
       GtkIconViewItem *item = items->data;
 
+      if (i % stride != 0)
+        continue;
+
       _gtk_icon_view_set_cell_data (icon_view, item);
       if (items == priv->items)
         adjust_wrap_width (icon_view);
@@ -1686,6 +1713,10 @@ gtk_icon_view_snapshot (GtkWidget   *widget,
       GtkIconViewItem *item = icons->data;
       graphene_rect_t area;
 
+      /* Items are laid out top to bottom */
+      if (item->cell_area.y > offset_y + height)
+        break;
+
       graphene_rect_init (&area,
                           item->cell_area.x - icon_view->priv->item_padding,
                           item->cell_area.y - icon_view->priv->item_padding,
@@ -2674,6 +2705,93 @@ compare_sizes (gconstpointer p1,
        - GPOINTER_TO_INT (((const GtkRequestedSize *) p2)->data);
 }
 
+static void
+gtk_icon_view_layout_row (GtkIconView *icon_view,
+                          GList      **items,
+                          int          row,
+                          int          n_columns,
+                          int          item_width,
+                          int          row_height,
+                          gboolean     rtl)
+{
+  GtkIconViewPrivate *priv = icon_view->priv;
+  int col;
+
+  priv->height += priv->item_padding;
+
+  for (col = 0; col < n_columns && *items; col++, *items = (*items)->next)
+    {
+      GtkIconViewItem *item = (*items)->data;
+
+      item->cell_area.x = priv->margin + (col * 2 + 1) * priv->item_padding + col * (priv->column_spacing + item_width);
+      item->cell_area.width = item_width;
+      item->cell_area.y = priv->height;
+      item->cell_area.height = row_height;
+      item->row = row;
+      item->col = col;
+      if (rtl)
+        {
+          item->cell_area.x = priv->width - item_width - item->cell_area.x;
+          item->col = n_columns - 1 - col;
+        }
+    }
+
+  priv->height += row_height + priv->item_padding + priv->row_spacing;
+}
+
+/* Lays out models with many items. Only a sample of the rows is
+ * measured, and all rows get the height of the tallest of them.
+ */
+static void
+gtk_icon_view_layout_uniform (GtkIconView *icon_view,
+                              int          n_rows,
+                              int          n_columns,
+                              int          item_width,
+                              gboolean     rtl)
+{
+  GtkIconViewPrivate *priv = icon_view->priv;
+  GtkWidget *widget = GTK_WIDGET (icon_view);
+  GtkCellAreaContext *context;
+  GList *items;
+  int row, col, row_stride, row_height;
+
+  row_stride = MAX (1, n_rows / GTK_ICON_VIEW_SAMPLE_ITEMS);
+  context = gtk_cell_area_copy_context (priv->cell_area, priv->cell_area_context);
+
+  for (items = priv->items, row = 0; items; row++)
+    {
+      for (col = 0; col < n_columns && items; col++, items = items->next)
+        {
+          if (row % row_stride != 0)
+            continue;
+
+          _gtk_icon_view_set_cell_data (icon_view, items->data);
+          gtk_cell_area_get_preferred_height_for_width (priv->cell_area,
+                                                        context,
+                                                        widget,
+                                                        item_width,
+                                                        NULL, NULL);
+        }
+    }
+
+  gtk_cell_area_context_get_preferred_height_for_width (context,
+                                                        item_width,
+                                                        &row_height,
+                                                        NULL);
+  gtk_cell_area_context_allocate (context, item_width, row_height);
+
+  items = priv->items;
+  priv->height = priv->margin;
+
+  for (row = 0; row < n_rows; row++)
+    {
+      g_ptr_array_add (priv->row_contexts, g_object_ref (context));
+      gtk_icon_view_layout_row (icon_view, &items, row, n_columns, item_width, row_height, rtl);
+    }
+
+  g_object_unref (context);
+}
+
 static void
 gtk_icon_view_layout (GtkIconView *icon_view)
 {
@@ -2682,7 +2800,7 @@ gtk_icon_view_layout (GtkIconView *icon_view)
   GList *items;
   int item_width = 0; /* this doesn't include item_padding */
   int n_columns, n_rows, n_items;
-  int col, row;
+  int row, col, i, stride;
   GtkRequestedSize *sizes;
   gboolean rtl;
   int width, height;
@@ -2692,6 +2810,7 @@ gtk_icon_view_layout (GtkIconView *icon_view)
 
   rtl = gtk_widget_get_direction (GTK_WIDGET (icon_view)) == GTK_TEXT_DIR_RTL;
   n_items = gtk_icon_view_get_n_items (icon_view);
+  stride = gtk_icon_view_get_sample_stride (icon_view);
 
   width = gtk_widget_get_width (widget);
   height = gtk_widget_get_height (widget);
@@ -2714,8 +2833,11 @@ gtk_icon_view_layout (GtkIconView *icon_view)
   /* because layouting is complicated. We designed an API
    * that is O(N²) and nonsensical.
    * And we're proud of it. */
-  for (items = priv->items; items; items = items->next)
+  for (items = priv->items, i = 0; items; items = items->next, i++)
     {
+      if (i % stride != 0)
+        continue;
+
       _gtk_icon_view_set_cell_data (icon_view, items->data);
       gtk_cell_area_get_preferred_width (priv->cell_area,
                                          priv->cell_area_context,
@@ -2723,75 +2845,63 @@ gtk_icon_view_layout (GtkIconView *icon_view)
                                          NULL, NULL);
     }
 
-  sizes = g_newa (GtkRequestedSize, n_rows);
-  items = priv->items;
-  priv->height = priv->margin;
-
-  /* Collect the heights for all rows */
-  for (row = 0; row < n_rows; row++)
+  if (stride > 1)
     {
-      GtkCellAreaContext *context = gtk_cell_area_copy_context (priv->cell_area, priv->cell_area_context);
-      g_ptr_array_add (priv->row_contexts, context);
+      gtk_icon_view_layout_uniform (icon_view, n_rows, n_columns, item_width, rtl);
+    }
+  else
+    {
+      sizes = g_newa (GtkRequestedSize, n_rows);
+      items = priv->items;
+      priv->height = priv->margin;
 
-      for (col = 0; col < n_columns && items; col++, items = items->next)
+      /* Collect the heights for all rows */
+      for (row = 0; row < n_rows; row++)
         {
-          GtkIconViewItem *item = items->data;
+          GtkCellAreaContext *context = gtk_cell_area_copy_context (priv->cell_area, priv->cell_area_context);
+          g_ptr_array_add (priv->row_contexts, context);
 
-          _gtk_icon_view_set_cell_data (icon_view, item);
-          gtk_cell_area_get_preferred_height_for_width (priv->cell_area,
-                                                        context,
-                                                        widget,
-                                                        item_width, 
-                                                        NULL, NULL);
+          for (col = 0; col < n_columns && items; col++, items = items->next)
+            {
+              GtkIconViewItem *item = items->data;
+
+              _gtk_icon_view_set_cell_data (icon_view, item);
+              gtk_cell_area_get_preferred_height_for_width (priv->cell_area,
+                                                            context,
+                                                            widget,
+                                                            item_width, 
+                                                            NULL, NULL);
+            }
+          
+          sizes[row].data = GINT_TO_POINTER (row);
+          gtk_cell_area_context_get_preferred_height_for_width (context,
+                                                                item_width,
+                                                                &sizes[row].minimum_size,
+                                                                &sizes[row].natural_size);
+          priv->height += sizes[row].minimum_size + 2 * priv->item_padding + priv->row_spacing;
         }
-      
-      sizes[row].data = GINT_TO_POINTER (row);
-      gtk_cell_area_context_get_preferred_height_for_width (context,
-                                                            item_width,
-                                                            &sizes[row].minimum_size,
-                                                            &sizes[row].natural_size);
-      priv->height += sizes[row].minimum_size + 2 * priv->item_padding + priv->row_spacing;
-    }
-
-  priv->height -= priv->row_spacing;
-  priv->height += priv->margin;
-  priv->height = MIN (priv->height, height);
-
-  gtk_distribute_natural_allocation (height - priv->height,
-                                     n_rows,
-                                     sizes);
 
-  /* Actually allocate the rows */
-  g_qsort_with_data (sizes, n_rows, sizeof (GtkRequestedSize), compare_sizes, NULL);
-  
-  items = priv->items;
-  priv->height = priv->margin;
+      priv->height -= priv->row_spacing;
+      priv->height += priv->margin;
+      priv->height = MIN (priv->height, height);
 
-  for (row = 0; row < n_rows; row++)
-    {
-      GtkCellAreaContext *context = g_ptr_array_index (priv->row_contexts, row);
-      gtk_cell_area_context_allocate (context, item_width, sizes[row].minimum_size);
+      gtk_distribute_natural_allocation (height - priv->height,
+                                         n_rows,
+                                         sizes);
 
-      priv->height += priv->item_padding;
+      /* Actually allocate the rows */
+      g_qsort_with_data (sizes, n_rows, sizeof (GtkRequestedSize), compare_sizes, NULL);
+      
+      items = priv->items;
+      priv->height = priv->margin;
 
-      for (col = 0; col < n_columns && items; col++, items = items->next)
+      for (row = 0; row < n_rows; row++)
         {
-          GtkIconViewItem *item = items->data;
+          GtkCellAreaContext *context = g_ptr_array_index (priv->row_contexts, row);
+          gtk_cell_area_context_allocate (context, item_width, sizes[row].minimum_size);
 
-          item->cell_area.x = priv->margin + (col * 2 + 1) * priv->item_padding + col * (priv->column_spacing + item_width);
-          item->cell_area.width = item_width;
-          item->cell_area.y = priv->height;
-          item->cell_area.height = sizes[row].minimum_size;
-          item->row = row;
-          item->col = col;
-          if (rtl)
-            {
-              item->cell_area.x = priv->width - item_width - item->cell_area.x;
-              item->col = n_columns - 1 - col;
-            }
+          gtk_icon_view_layout_row (icon_view, &items, row, n_columns, item_width, sizes[row].minimum_size, rtl);
         }
-
-      priv->height += sizes[row].minimum_size + priv->item_padding + priv->row_spacing;
     }
 
   priv->height -= priv->row_spacing;
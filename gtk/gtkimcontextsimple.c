@@ -361,67 +361,33 @@ check_table (GtkIMContextSimple    *context_simple,
 	     int                    n_compose)
 {
   GtkIMContextSimplePrivate *priv = context_simple->priv;
-  int row_stride = table->max_seq_len + 2; 
-  guint16 *seq; 
-  
-  /* Will never match, if the sequence in the compose buffer is longer
-   * than the sequences in the table.  Further, compare_seq (key, val)
-   * will overrun val if key is longer than val. */
-  if (n_compose > table->max_seq_len)
+  gunichar value;
+  gboolean is_prefix;
+
+  if (!gtk_compose_table_check (table, priv->compose_buffer, n_compose,
+                                &value, &is_prefix))
     return FALSE;
-  
-  seq = bsearch (priv->compose_buffer,
-		 table->data, table->n_seqs,
-		 sizeof (guint16) *  row_stride, 
-		 compare_seq);
 
-  if (seq)
+  if (value != 0) /* complete sequence */
     {
-      guint16 *prev_seq;
-
-      /* Back up to the first sequence that matches to make sure
-       * we find the exact match if there is one.
+      /* We found a tentative match, if there are longer
+       * sequences containing this subsequence
        */
-      while (seq > table->data)
-	{
-	  prev_seq = seq - row_stride;
-	  if (compare_seq (priv->compose_buffer, prev_seq) != 0)
-	    break;
-	  seq = prev_seq;
-	}
-      
-      if (n_compose == table->max_seq_len ||
-	  seq[n_compose] == 0) /* complete sequence */
-	{
-	  guint16 *next_seq;
-	  gunichar value = 
-	    0x10000 * seq[table->max_seq_len] + seq[table->max_seq_len + 1];
-
-	  /* We found a tentative match. See if there are any longer
-	   * sequences containing this subsequence
-	   */
-	  next_seq = seq + row_stride;
-	  if (next_seq < table->data + row_stride * table->n_seqs)
-	    {
-	      if (compare_seq (priv->compose_buffer, next_seq) == 0)
-		{
-		  priv->tentative_match = value;
-		  priv->tentative_match_len = n_compose;
+      if (is_prefix)
+        {
+          priv->tentative_match = value;
+          priv->tentative_match_len = n_compose;
 
-		  g_signal_emit_by_name (context_simple, "preedit-changed");
+          g_signal_emit_by_name (context_simple, "preedit-changed");
 
-		  return TRUE;
-		}
-	    }
+          return TRUE;
+        }
 
-	  gtk_im_context_simple_commit_char (GTK_IM_CONTEXT (context_simple), value);
-	  priv->compose_buffer[0] = 0;
-	}
-      
-      return TRUE;
+      gtk_im_context_simple_commit_char (GTK_IM_CONTEXT (context_simple), value);
+      priv->compose_buffer[0] = 0;
     }
 
-  return FALSE;
+  return TRUE;
 }
 
 /* Checks if a keysym is a dead key. Dead key keysym values are defined in
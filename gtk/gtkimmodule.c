@@ -36,6 +36,7 @@
 #include "gtkimcontextsimple.h"
 #include "gtkmodulesprivate.h"
 #include "gtksettings.h"
+#include "gdk/gdkprofilerprivate.h"
 #include "gtkprivate.h"
 #include "gtkintl.h"
 
@@ -91,6 +92,8 @@ _gtk_im_module_create (const char *context_id)
   if (strcmp (context_id, NONE_ID) == 0)
     return NULL;
 
+  gtk_im_modules_init ();
+
   ep = g_io_extension_point_lookup (GTK_IM_MODULE_EXTENSION_POINT_NAME);
   ext = g_io_extension_point_get_extension_by_name (ep, context_id);
   if (ext)
@@ -190,6 +193,8 @@ _gtk_im_module_get_default_context_id (GdkDisplay *display)
   GList *l;
   char *tmp;
 
+  gtk_im_modules_init ();
+
   envvar = g_getenv ("GTK_IM_MODULE");
   if (envvar)
     {
@@ -254,9 +259,18 @@ gtk_im_module_ensure_extension_point (void)
 void
 gtk_im_modules_init (void)
 {
+  static gboolean initialized = FALSE;
   GIOModuleScope *scope;
   char **paths;
   int i;
+  gint64 before;
+
+  if (initialized)
+    return;
+
+  initialized = TRUE;
+
+  before = GDK_PROFILER_CURRENT_TIME;
 
   gtk_im_module_ensure_extension_point ();
 
@@ -302,4 +316,5 @@ gtk_im_modules_init (void)
                    g_type_name (g_io_extension_get_type (ext)));
         }
     }
+  gdk_profiler_end_mark (before, "im modules init", NULL);
 }
@@ -46,7 +46,7 @@
 #include "gtkshortcutcontroller.h"
 #include "gtkshortcuttrigger.h"
 #include "gtkshow.h"
-#include "gtksnapshot.h"
+#include "gtksnapshotprivate.h"
 #include "gtkstylecontextprivate.h"
 #include "gtktextutil.h"
 #include "gtktooltip.h"
@@ -264,6 +264,21 @@ struct _GtkLabel
   PangoAttrList *markup_attrs;
   PangoLayout   *layout;
 
+  /* The last copy of layout made for measuring, which can
+   * replace it if the label is allocated that width
+   */
+  PangoLayout   *measuring_layout;
+  guint          measuring_layout_serial;
+
+  /* The text of layout, as long as neither it nor the style change */
+  GskRenderNode *text_node;
+  guint          text_node_serial;
+
+  /* The serial of the widget's PangoContext when layout was taken
+   * from the shared layout cache, see gtk_label_ensure_layout()
+   */
+  guint          context_serial;
+
   GtkWidget *popup_menu;
   GMenuModel *extra_menu;
 
@@ -283,6 +298,8 @@ struct _GtkLabel
   guint    single_line_mode   : 1;
   guint    in_click           : 1;
   guint    track_links        : 1;
+  guint    layout_shared      : 1;
+  guint    layout_unshareable : 1;
 
   guint    mnemonic_keyval;
 
@@ -2743,6 +2760,8 @@ gtk_label_finalize (GObject *object)
   g_free (self->text);
 
   g_clear_object (&self->layout);
+  g_clear_object (&self->measuring_layout);
+  g_clear_pointer (&self->text_node, gsk_render_node_unref);
   g_clear_pointer (&self->attrs, pango_attr_list_unref);
   g_clear_pointer (&self->markup_attrs, pango_attr_list_unref);
 
@@ -2762,6 +2781,9 @@ static void
 gtk_label_clear_layout (GtkLabel *self)
 {
   g_clear_object (&self->layout);
+  self->layout_shared = FALSE;
+  g_clear_object (&self->measuring_layout);
+  g_clear_pointer (&self->text_node, gsk_render_node_unref);
 }
 
 /**
@@ -2807,7 +2829,7 @@ gtk_label_get_measuring_layout (GtkLabel    *self,
    * because we don't need it to be properly setup at that point.
    * This way we can make use of caching upon the label's creation.
    */
-  if (gtk_widget_get_width (GTK_WIDGET (self)) <= 1)
+  if (gtk_widget_get_width (GTK_WIDGET (self)) <= 1 && !self->layout_shared)
     {
       g_object_ref (self->layout);
       pango_layout_set_width (self->layout, width);
@@ -2834,6 +2856,14 @@ gtk_label_get_measuring_layout (GtkLabel    *self,
 
   copy = pango_layout_copy (self->layout);
   pango_layout_set_width (copy, width);
+
+  /* Measuring is usually followed by allocating one of the measured
+   * widths, keep the copy around so it doesn't have to be laid out
+   * again then.
+   */
+  g_set_object (&self->measuring_layout, copy);
+  self->measuring_layout_serial = pango_layout_get_serial (self->layout);
+
   return copy;
 }
 
@@ -2851,6 +2881,14 @@ gtk_label_update_layout_attributes (GtkLabel      *self,
       return;
     }
 
+  /* Shared layouts can't be changed, look up a new one instead */
+  if (self->layout_shared)
+    {
+      g_clear_pointer (&style_attrs, pango_attr_list_unref);
+      gtk_label_clear_layout (self);
+      return;
+    }
+
   if (self->select_info && self->select_info->links)
     {
       guint i;
@@ -2919,12 +2957,17 @@ gtk_label_ensure_layout (GtkLabel *self)
   PangoAlignment align;
   gboolean rtl;
 
+  if (self->layout && self->layout_shared &&
+      pango_context_get_serial (gtk_widget_get_pango_context (GTK_WIDGET (self))) != self->context_serial)
+    gtk_label_clear_layout (self);
+
   if (self->layout)
     return;
 
   align = PANGO_ALIGN_LEFT; /* Quiet gcc */
   rtl = _gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL;
   self->layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), self->text);
+  self->layout_shared = FALSE;
 
   gtk_label_update_layout_attributes (self, NULL);
 
@@ -2956,6 +2999,24 @@ gtk_label_ensure_layout (GtkLabel *self)
 
   if (self->ellipsize || self->wrap)
     pango_layout_set_width (self->layout, gtk_widget_get_width (GTK_WIDGET (self)) * PANGO_SCALE);
+
+  /* Labels that only show some text, like the ones in the rows of a
+   * list, often show the same text as other labels. Those can all use
+   * the same layout, and it only needs to be laid out once.
+   */
+  if (!self->wrap && !self->ellipsize && !self->select_info && !self->layout_unshareable)
+    {
+      PangoLayout *shared;
+
+      shared = gtk_pango_layout_cache_lookup (self->layout);
+      if (shared)
+        {
+          g_object_unref (self->layout);
+          self->layout = shared;
+          self->layout_shared = TRUE;
+          self->context_serial = pango_context_get_serial (gtk_widget_get_pango_context (GTK_WIDGET (self)));
+        }
+    }
 }
 
 static GtkSizeRequestMode
@@ -3251,9 +3312,22 @@ gtk_label_size_allocate (GtkWidget *widget,
   if (self->layout)
     {
       if (self->ellipsize || self->wrap)
-        pango_layout_set_width (self->layout, width * PANGO_SCALE);
+        {
+          if (pango_layout_get_width (self->layout) != width * PANGO_SCALE &&
+              self->measuring_layout != NULL &&
+              pango_layout_get_width (self->measuring_layout) == width * PANGO_SCALE &&
+              pango_layout_get_serial (self->layout) == self->measuring_layout_serial)
+            {
+              g_set_object (&self->layout, self->measuring_layout);
+              g_clear_pointer (&self->text_node, gsk_render_node_unref);
+            }
+          else
+            pango_layout_set_width (self->layout, width * PANGO_SCALE);
+        }
       else
         pango_layout_set_width (self->layout, -1);
+
+      g_clear_object (&self->measuring_layout);
     }
 
   if (self->popup_menu)
@@ -3339,6 +3413,9 @@ gtk_label_css_changed (GtkWidget         *widget,
 
   GTK_WIDGET_CLASS (gtk_label_parent_class)->css_changed (widget, change);
 
+  /* The text node has the color and shadows baked in */
+  g_clear_pointer (&self->text_node, gsk_render_node_unref);
+
   if (gtk_css_style_change_affects (change, GTK_CSS_AFFECTS_TEXT_ATTRS))
     {
       new_attrs = gtk_css_style_get_pango_attributes (gtk_css_style_change_get_new_style (change));
@@ -3437,7 +3514,24 @@ gtk_label_snapshot (GtkWidget   *widget,
     {
       get_layout_location (self, &lx, &ly);
 
-      gtk_snapshot_render_layout (snapshot, context, lx, ly, self->layout);
+      if (self->text_node == NULL ||
+          self->text_node_serial != pango_layout_get_serial (self->layout))
+        {
+          g_clear_pointer (&self->text_node, gsk_render_node_unref);
+
+          gtk_snapshot_push_collect (snapshot);
+          gtk_snapshot_render_layout (snapshot, context, 0, 0, self->layout);
+          self->text_node = gtk_snapshot_pop_collect (snapshot);
+          self->text_node_serial = pango_layout_get_serial (self->layout);
+        }
+
+      if (self->text_node)
+        {
+          gtk_snapshot_save (snapshot);
+          gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (lx, ly));
+          gtk_snapshot_append_node (snapshot, self->text_node);
+          gtk_snapshot_restore (snapshot);
+        }
 
       if (info && (info->selection_anchor != info->selection_end))
         {
@@ -4778,6 +4872,14 @@ gtk_label_get_layout (GtkLabel *self)
 {
   g_return_val_if_fail (GTK_IS_LABEL (self), NULL);
 
+  /* The layout may be modified, so it can't be shared anymore */
+  if (!self->layout_unshareable)
+    {
+      self->layout_unshareable = TRUE;
+      if (self->layout_shared)
+        gtk_label_clear_layout (self);
+    }
+
   gtk_label_ensure_layout (self);
 
   return self->layout;
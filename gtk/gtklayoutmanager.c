@@ -69,6 +69,18 @@
  * layout properties; each #GtkLayoutChild instance should call
  * gtk_layout_manager_layout_changed() every time a property is updated, in
  * order to queue a new size measuring and allocation.
+ *
+ * ## Measuring children
+ *
+ * Layout managers are only ever used from the main thread, like the
+ * rest of GTK. Measuring a child can create Pango layouts, look up CSS
+ * styles and run code of the child's own layout manager, none of which
+ * may happen in another thread, so children can't be measured in parallel.
+ *
+ * gtk_widget_measure() caches the sizes it returns until the child queues
+ * a resize, so a layout manager can measure the same child repeatedly,
+ * for example once for each size it is trying to distribute, without
+ * the child having to compute its size again.
  */
 
 #include "config.h"
@@ -95,6 +107,8 @@ typedef struct {
 
   /* HashTable<Widget, LayoutChild> */
   GHashTable *layout_children;
+
+  guint serial;
 } GtkLayoutManagerPrivate;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (GtkLayoutManager, gtk_layout_manager, G_TYPE_OBJECT)
@@ -459,6 +473,41 @@ gtk_layout_manager_layout_changed (GtkLayoutManager *manager)
     gtk_widget_queue_resize (priv->widget);
 }
 
+/*< private >
+ * gtk_layout_manager_invalidate:
+ * @manager: a #GtkLayoutManager
+ *
+ * Called when the widget using @manager discards its cached sizes,
+ * because it or one of its children queued a resize.
+ */
+void
+gtk_layout_manager_invalidate (GtkLayoutManager *manager)
+{
+  GtkLayoutManagerPrivate *priv = gtk_layout_manager_get_instance_private (manager);
+
+  priv->serial++;
+}
+
+/*< private >
+ * gtk_layout_manager_get_serial:
+ * @manager: a #GtkLayoutManager
+ *
+ * Gets a number that changes whenever the sizes of the widget
+ * using @manager or its children may have changed.
+ *
+ * Layout managers can use it to tell whether data they cached
+ * while measuring is still valid.
+ *
+ * Returns: the serial
+ */
+guint
+gtk_layout_manager_get_serial (GtkLayoutManager *manager)
+{
+  GtkLayoutManagerPrivate *priv = gtk_layout_manager_get_instance_private (manager);
+
+  return priv->serial;
+}
+
 /*< private >
  * gtk_layout_manager_remove_layout_child:
  * @manager: a #GtkLayoutManager
@@ -13,4 +13,7 @@ void gtk_layout_manager_remove_layout_child (GtkLayoutManager *manager,
 void gtk_layout_manager_set_root (GtkLayoutManager *manager,
                                   GtkRoot          *root);
 
+void  gtk_layout_manager_invalidate (GtkLayoutManager *manager);
+guint gtk_layout_manager_get_serial (GtkLayoutManager *manager);
+
 G_END_DECLS
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtklazypageprivate.h"
+
+#include "gtkbinlayout.h"
+#include "gtkwidgetprivate.h"
+
+/* A page of a GtkStack or GtkNotebook whose contents are only
+ * created when it is shown for the first time. Until then, pages
+ * that are never looked at don't cost anything for styling,
+ * accessibility or measuring.
+ */
+
+struct _GtkLazyPage
+{
+  GtkWidget parent_instance;
+
+  GtkLazyPageFunc create_func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+
+  GtkWidget *child;
+};
+
+G_DEFINE_TYPE (GtkLazyPage, gtk_lazy_page, GTK_TYPE_WIDGET)
+
+static void
+gtk_lazy_page_clear_func (GtkLazyPage *self)
+{
+  if (self->destroy)
+    self->destroy (self->user_data);
+
+  self->create_func = NULL;
+  self->user_data = NULL;
+  self->destroy = NULL;
+}
+
+static void
+gtk_lazy_page_map (GtkWidget *widget)
+{
+  GtkLazyPage *self = GTK_LAZY_PAGE (widget);
+
+  if (self->create_func)
+    {
+      GtkWidget *child;
+
+      child = self->create_func (self->user_data);
+      gtk_lazy_page_clear_func (self);
+
+      if (child)
+        {
+          self->child = child;
+          gtk_widget_set_parent (child, widget);
+        }
+    }
+
+  GTK_WIDGET_CLASS (gtk_lazy_page_parent_class)->map (widget);
+}
+
+static void
+gtk_lazy_page_compute_expand (GtkWidget *widget,
+                              gboolean  *hexpand,
+                              gboolean  *vexpand)
+{
+  GtkLazyPage *self = GTK_LAZY_PAGE (widget);
+
+  if (self->child)
+    {
+      *hexpand = gtk_widget_compute_expand (self->child, GTK_ORIENTATION_HORIZONTAL);
+      *vexpand = gtk_widget_compute_expand (self->child, GTK_ORIENTATION_VERTICAL);
+    }
+  else
+    {
+      *hexpand = FALSE;
+      *vexpand = FALSE;
+    }
+}
+
+static void
+gtk_lazy_page_dispose (GObject *object)
+{
+  GtkLazyPage *self = GTK_LAZY_PAGE (object);
+
+  g_clear_pointer (&self->child, gtk_widget_unparent);
+  gtk_lazy_page_clear_func (self);
+
+  G_OBJECT_CLASS (gtk_lazy_page_parent_class)->dispose (object);
+}
+
+static void
+gtk_lazy_page_class_init (GtkLazyPageClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = gtk_lazy_page_dispose;
+
+  widget_class->map = gtk_lazy_page_map;
+  widget_class->compute_expand = gtk_lazy_page_compute_expand;
+
+  gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BIN_LAYOUT);
+}
+
+static void
+gtk_lazy_page_init (GtkLazyPage *self)
+{
+}
+
+GtkWidget *
+gtk_lazy_page_new (GtkLazyPageFunc create_func,
+                   gpointer        user_data,
+                   GDestroyNotify  destroy)
+{
+  GtkLazyPage *self;
+
+  self = g_object_new (GTK_TYPE_LAZY_PAGE, NULL);
+  self->create_func = create_func;
+  self->user_data = user_data;
+  self->destroy = destroy;
+
+  return GTK_WIDGET (self);
+}
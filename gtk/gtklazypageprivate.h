@@ -0,0 +1,37 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_LAZY_PAGE_PRIVATE_H__
+#define __GTK_LAZY_PAGE_PRIVATE_H__
+
+#include "gtkwidget.h"
+
+G_BEGIN_DECLS
+
+#define GTK_TYPE_LAZY_PAGE (gtk_lazy_page_get_type ())
+
+G_DECLARE_FINAL_TYPE (GtkLazyPage, gtk_lazy_page, GTK, LAZY_PAGE, GtkWidget)
+
+typedef GtkWidget * (* GtkLazyPageFunc) (gpointer user_data);
+
+GtkWidget *     gtk_lazy_page_new               (GtkLazyPageFunc  create_func,
+                                                 gpointer         user_data,
+                                                 GDestroyNotify   destroy);
+
+G_END_DECLS
+
+#endif /* __GTK_LAZY_PAGE_PRIVATE_H__ */
@@ -38,6 +38,12 @@
 #include "gtktypebuiltins.h"
 #include "gtkwidgetprivate.h"
 
+/* While scrolling, items that will be scrolled into view within this
+ * time at the current speed get widgets ahead of time */
+#define GTK_LIST_BASE_PREFETCH_USEC (G_USEC_PER_SEC / 4)
+/* Scroll events further apart than this don't tell the speed */
+#define GTK_LIST_BASE_SCROLL_IDLE_USEC (G_USEC_PER_SEC / 10)
+
 typedef struct _RubberbandData RubberbandData;
 
 struct _RubberbandData
@@ -68,6 +74,9 @@ struct _GtkListBasePrivate
   GtkPackType anchor_side_across;
   guint center_widgets;
   guint above_below_widgets;
+  /* extra widgets in the direction of scrolling, negative when scrolling up */
+  int prefetch_widgets;
+  gint64 scroll_time;
   /* the last item that was selected - basically the location to extend selections from */
   GtkListItemTracker *selected;
   /* the item that has input focus */
@@ -169,6 +178,40 @@ gtk_list_base_get_adjustment_values (GtkListBase    *self,
     *page_size = ps;
 }
 
+/* Sizes the prefetch area from how fast the anchor moves. A jump
+ * further than the widgets around the anchor reach skips the items in
+ * between, so none are prefetched then.
+ */
+static void
+gtk_list_base_update_prefetch (GtkListBase *self,
+                               guint        pos)
+{
+  GtkListBasePrivate *priv = gtk_list_base_get_instance_private (self);
+  gint64 now, delta, prefetch;
+  guint old_pos, max_prefetch;
+
+  now = g_get_monotonic_time ();
+  old_pos = gtk_list_item_tracker_get_position (priv->item_manager, priv->anchor);
+  max_prefetch = priv->center_widgets;
+
+  if (old_pos == GTK_INVALID_LIST_POSITION ||
+      now - priv->scroll_time > GTK_LIST_BASE_SCROLL_IDLE_USEC)
+    {
+      prefetch = 0;
+    }
+  else
+    {
+      delta = (gint64) pos - old_pos;
+      if (ABS (delta) > priv->center_widgets + 2 * priv->above_below_widgets)
+        prefetch = 0;
+      else
+        prefetch = delta * GTK_LIST_BASE_PREFETCH_USEC / MAX (now - priv->scroll_time, 1);
+    }
+
+  priv->prefetch_widgets = CLAMP (prefetch, - (gint64) max_prefetch, (gint64) max_prefetch);
+  priv->scroll_time = now;
+}
+
 static void
 gtk_list_base_adjustment_value_changed_cb (GtkAdjustment *adjustment,
                                            GtkListBase   *self)
@@ -238,6 +281,7 @@ gtk_list_base_adjustment_value_changed_cb (GtkAdjustment *adjustment,
   else
     align_along = (double) (cell_area.y + cell_area.height - area.y) / area.height;
 
+  gtk_list_base_update_prefetch (self, pos);
   gtk_list_base_set_anchor (self,
                             pos,
                             align_across, side_across,
@@ -1972,7 +2016,8 @@ gtk_list_base_get_anchor (GtkListBase *self)
  * around.
  *
  * The anchor will also ensure that enough widgets are created according
- * to gtk_list_base_set_anchor_max_widgets().
+ * to gtk_list_base_set_anchor_max_widgets(). While scrolling, widgets are
+ * also created for the items that will be scrolled into view next.
  **/
 void
 gtk_list_base_set_anchor (GtkListBase *self,
@@ -1983,14 +2028,21 @@ gtk_list_base_set_anchor (GtkListBase *self,
                           GtkPackType  anchor_side_along)
 {
   GtkListBasePrivate *priv = gtk_list_base_get_instance_private (self);
-  guint items_before;
+  guint items_before, n_before, n_after;
 
   items_before = round (priv->center_widgets * CLAMP (anchor_align_along, 0, 1));
+  n_before = items_before + priv->above_below_widgets;
+  n_after = priv->center_widgets - items_before + priv->above_below_widgets;
+  if (priv->prefetch_widgets > 0)
+    n_after += priv->prefetch_widgets;
+  else
+    n_before += - priv->prefetch_widgets;
+
   gtk_list_item_tracker_set_position (priv->item_manager,
                                       priv->anchor,
                                       anchor_pos,
-                                      items_before + priv->above_below_widgets,
-                                      priv->center_widgets - items_before + priv->above_below_widgets);
+                                      n_before,
+                                      n_after);
 
   priv->anchor_align_across = anchor_align_across;
   priv->anchor_side_across = anchor_side_across;
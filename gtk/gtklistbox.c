@@ -59,6 +59,11 @@
  * gtk_list_box_append() and gtk_list_box_insert() and a #GtkListBoxRow
  * widget will automatically be inserted between the list and the widget.
  *
+ * GtkListBox creates and keeps a widget for every row, also when it is
+ * bound to a model with gtk_list_box_bind_model(). For large numbers of
+ * items, consider using #GtkListView instead, which only creates widgets
+ * for the items that are visible.
+ *
  * #GtkListBoxRows can be marked as activatable or selectable. If a row
  * is activatable, #GtkListBox::row-activated will be emitted for it when
  * the user tries to activate it. If it is selectable, the row will be marked
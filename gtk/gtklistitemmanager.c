@@ -21,11 +21,26 @@
 
 #include "gtklistitemmanagerprivate.h"
 
+#include "gtkbuilderlistitemfactory.h"
+#include "gtklistitemfactoryprivate.h"
 #include "gtklistitemwidgetprivate.h"
+#include "gtksignallistitemfactory.h"
 #include "gtkwidgetprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 #define GTK_LIST_VIEW_MAX_LIST_ITEMS 200
 
+/* fraction of a frame that may be spent binding list items */
+#define GTK_LIST_ITEM_BIND_BUDGET_DIVISOR 2
+
+/* number of unused list items kept around for all managers */
+#define GTK_LIST_ITEM_POOL_SIZE 200
+/* seconds after which unused list items are dropped */
+#define GTK_LIST_ITEM_POOL_TIMEOUT 10
+/* number of list items to set up before a list becomes visible */
+#define GTK_LIST_ITEM_POOL_PREWARM 50
+
 struct _GtkListItemManager
 {
   GObject parent_instance;
@@ -38,6 +53,13 @@ struct _GtkListItemManager
 
   GtkRbTree *items;
   GSList *trackers;
+
+  guint prewarm_id;
+
+  /* time spent binding list items in the frame with counter bind_frame */
+  gint64 bind_frame;
+  gint64 bind_time;
+  guint bind_tick_id;
 };
 
 struct _GtkListItemManagerClass
@@ -73,6 +95,163 @@ static void             gtk_list_item_manager_release_list_item (GtkListItemMana
                                                                  GtkWidget              *widget);
 G_DEFINE_TYPE (GtkListItemManager, gtk_list_item_manager, G_TYPE_OBJECT)
 
+/* The pool keeps list items that are no longer used, but that are still
+ * set up, so that they can be picked up by any manager using the same
+ * factory. This way switching models or views doesn't need to set up
+ * all list items again.
+ * The most recently released items are at the head of the queue.
+ */
+static GQueue list_item_pool = G_QUEUE_INIT;
+static guint list_item_pool_timeout_id;
+
+/* Only the public factories are known to create interchangeable widgets */
+static gboolean
+gtk_list_item_pool_can_recycle (GtkListItemFactory *factory)
+{
+  return GTK_IS_SIGNAL_LIST_ITEM_FACTORY (factory) ||
+         GTK_IS_BUILDER_LIST_ITEM_FACTORY (factory);
+}
+
+static void
+gtk_list_item_pool_drop (GtkWidget *widget)
+{
+  gtk_list_item_widget_set_factory (GTK_LIST_ITEM_WIDGET (widget), NULL);
+  g_object_unref (widget);
+}
+
+static gboolean
+gtk_list_item_pool_timeout (gpointer unused)
+{
+  GtkWidget *widget;
+
+  while ((widget = g_queue_pop_head (&list_item_pool)))
+    gtk_list_item_pool_drop (widget);
+
+  list_item_pool_timeout_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_list_item_pool_push (GtkWidget *widget)
+{
+  g_object_ref_sink (widget);
+  gtk_list_item_widget_recycle (GTK_LIST_ITEM_WIDGET (widget));
+  if (_gtk_widget_get_parent (widget))
+    gtk_widget_unparent (widget);
+
+  g_queue_push_head (&list_item_pool, widget);
+  if (list_item_pool.length > GTK_LIST_ITEM_POOL_SIZE)
+    gtk_list_item_pool_drop (g_queue_pop_tail (&list_item_pool));
+
+  if (list_item_pool_timeout_id)
+    g_source_remove (list_item_pool_timeout_id);
+  list_item_pool_timeout_id = g_timeout_add_seconds (GTK_LIST_ITEM_POOL_TIMEOUT,
+                                                     gtk_list_item_pool_timeout,
+                                                     NULL);
+  g_source_set_name_by_id (list_item_pool_timeout_id, "[gtk] gtk_list_item_pool_timeout");
+}
+
+static GList *
+gtk_list_item_pool_find (GtkListItemFactory *factory,
+                         const char         *css_name)
+{
+  GList *l;
+
+  for (l = list_item_pool.head; l; l = l->next)
+    {
+      if (gtk_list_item_widget_get_factory (l->data) == factory &&
+          g_str_equal (gtk_widget_get_css_name (l->data), css_name))
+        return l;
+    }
+
+  return NULL;
+}
+
+static guint
+gtk_list_item_pool_count (GtkListItemFactory *factory,
+                          const char         *css_name)
+{
+  GList *l;
+  guint result = 0;
+
+  for (l = gtk_list_item_pool_find (factory, css_name); l; l = l->next)
+    {
+      if (gtk_list_item_widget_get_factory (l->data) == factory &&
+          g_str_equal (gtk_widget_get_css_name (l->data), css_name))
+        result++;
+    }
+
+  return result;
+}
+
+/* Returns a list item that is set up, but not bound, or %NULL */
+static GtkWidget *
+gtk_list_item_pool_pop (GtkListItemFactory *factory,
+                        const char         *css_name)
+{
+  GtkWidget *result;
+  GList *l;
+
+  l = gtk_list_item_pool_find (factory, css_name);
+  if (l == NULL)
+    return NULL;
+
+  result = l->data;
+  g_queue_delete_link (&list_item_pool, l);
+
+  return result;
+}
+
+/* Releases a list item that is no longer used by a manager */
+static void
+gtk_list_item_manager_recycle_widget (GtkWidget *widget)
+{
+  GtkListItemFactory *factory = gtk_list_item_widget_get_factory (GTK_LIST_ITEM_WIDGET (widget));
+
+  if (factory && gtk_list_item_pool_can_recycle (factory))
+    gtk_list_item_pool_push (widget);
+  else
+    gtk_widget_unparent (widget);
+}
+
+static gboolean
+gtk_list_item_manager_prewarm_cb (gpointer data)
+{
+  GtkListItemManager *self = data;
+  guint n_wanted;
+
+  if (self->model == NULL ||
+      gtk_widget_get_mapped (self->widget))
+    goto out;
+
+  n_wanted = MIN (g_list_model_get_n_items (G_LIST_MODEL (self->model)), GTK_LIST_ITEM_POOL_PREWARM);
+  if (gtk_list_item_pool_count (self->factory, self->item_css_name) >= n_wanted)
+    goto out;
+
+  /* one item per iteration, setting up an item can be expensive */
+  gtk_list_item_pool_push (gtk_list_item_widget_new (self->factory, self->item_css_name));
+
+  return G_SOURCE_CONTINUE;
+
+out:
+  self->prewarm_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_list_item_manager_start_prewarm (GtkListItemManager *self)
+{
+  if (self->prewarm_id != 0 ||
+      self->factory == NULL ||
+      !gtk_list_item_pool_can_recycle (self->factory) ||
+      gtk_widget_get_mapped (self->widget))
+    return;
+
+  self->prewarm_id = g_idle_add_full (G_PRIORITY_LOW, gtk_list_item_manager_prewarm_cb, self, NULL);
+  g_source_set_name_by_id (self->prewarm_id, "[gtk] gtk_list_item_manager_prewarm_cb");
+}
+
 void
 gtk_list_item_manager_augment_node (GtkRbTree *tree,
                                     gpointer   node_augment,
@@ -471,24 +650,121 @@ gtk_list_item_manager_release_items (GtkListItemManager *self,
     }
 }
 
-static void
-gtk_list_item_manager_ensure_items (GtkListItemManager *self,
-                                    GHashTable         *change,
-                                    guint               update_start)
+/* Returns the first position in [start, end) that a tracker is
+ * positioned at, or G_MAXUINT if there is none.
+ */
+static guint
+gtk_list_item_manager_find_tracker_position (GtkListItemManager *self,
+                                             guint               start,
+                                             guint               end)
+{
+  GSList *l;
+  guint result = G_MAXUINT;
+
+  for (l = self->trackers; l; l = l->next)
+    {
+      GtkListItemTracker *tracker = l->data;
+
+      if (tracker->position != GTK_INVALID_LIST_POSITION &&
+          tracker->position >= start && tracker->position < end)
+        result = MIN (result, tracker->position);
+    }
+
+  return result;
+}
+
+/* Returns the time in µs that may still be spent binding items in
+ * the current frame. When the widget isn't shown, there's no frame
+ * to be late for.
+ */
+static gint64
+gtk_list_item_manager_get_bind_budget (GtkListItemManager *self)
+{
+  GdkFrameClock *frame_clock;
+  gint64 frame, refresh_interval;
+
+  frame_clock = gtk_widget_get_frame_clock (self->widget);
+  if (frame_clock == NULL || !gtk_widget_get_mapped (self->widget))
+    return G_MAXINT64;
+
+  frame = gdk_frame_clock_get_frame_counter (frame_clock);
+  if (frame != self->bind_frame)
+    {
+      self->bind_frame = frame;
+      self->bind_time = 0;
+    }
+
+  gdk_frame_clock_get_refresh_info (frame_clock,
+                                    gdk_frame_clock_get_frame_time (frame_clock),
+                                    &refresh_interval, NULL);
+  if (refresh_interval <= 0)
+    refresh_interval = G_USEC_PER_SEC / 60;
+
+  return refresh_interval / GTK_LIST_ITEM_BIND_BUDGET_DIVISOR - self->bind_time;
+}
+
+static void gtk_list_item_manager_ensure_items (GtkListItemManager *self,
+                                                GHashTable         *change,
+                                                guint               update_start);
+
+static gboolean
+gtk_list_item_manager_bind_tick_cb (GtkWidget     *widget,
+                                    GdkFrameClock *frame_clock,
+                                    gpointer       data)
+{
+  GtkListItemManager *self = data;
+
+  self->bind_tick_id = 0;
+  gtk_list_item_manager_ensure_items (self, NULL, G_MAXUINT);
+  gtk_widget_queue_resize (self->widget);
+
+  return G_SOURCE_REMOVE;
+}
+
+static guint
+gtk_list_item_manager_get_tracker_distance (GtkListItemManager *self,
+                                            guint               position)
+{
+  GSList *l;
+  guint result = G_MAXUINT;
+
+  for (l = self->trackers; l; l = l->next)
+    {
+      GtkListItemTracker *tracker = l->data;
+
+      if (tracker->position == GTK_INVALID_LIST_POSITION)
+        continue;
+
+      if (tracker->position > position)
+        result = MIN (result, tracker->position - position);
+      else
+        result = MIN (result, position - tracker->position);
+    }
+
+  return result;
+}
+
+/* Creates widgets for the tracked items that are at most @radius
+ * items away from a tracker's position, and for those only until
+ * @deadline. Returns %TRUE if any tracked items were skipped.
+ */
+static gboolean
+gtk_list_item_manager_ensure_items_near (GtkListItemManager *self,
+                                         GHashTable         *change,
+                                         guint               update_start,
+                                         GQueue             *released,
+                                         guint               radius,
+                                         gint64              deadline,
+                                         guint              *n_bound)
 {
   GtkListItemManagerItem *item, *new_item;
-  GtkWidget *widget, *insert_after;
+  GtkWidget *insert_after;
   guint position, i, n_items, query_n_items, offset;
-  GQueue released = G_QUEUE_INIT;
-  gboolean tracked;
-
-  if (self->model == NULL)
-    return;
+  gboolean tracked, skipped;
 
   n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
   position = 0;
-
-  gtk_list_item_manager_release_items (self, &released);
+  skipped = FALSE;
 
   while (position < n_items)
     {
@@ -516,6 +792,39 @@ gtk_list_item_manager_ensure_items (GtkListItemManager *self,
 
       for (i = 0; i < query_n_items; i++)
         {
+          if (item->widget == NULL)
+            {
+              guint distance, r, skip, tracked_position;
+
+              distance = gtk_list_item_manager_get_tracker_distance (self, position + i);
+              r = g_get_monotonic_time () > deadline ? 0 : radius;
+
+              if (distance > r)
+                {
+                  /* skip until the end of the item or the next item within @r */
+                  skip = MIN (item->n_items, query_n_items - i);
+                  tracked_position = gtk_list_item_manager_find_tracker_position (self, position + i, position + i + skip + r);
+                  if (tracked_position != G_MAXUINT)
+                    skip = MIN (skip, tracked_position - r - position - i);
+
+                  if (skip < item->n_items)
+                    {
+                      new_item = gtk_rb_tree_insert_before (self->items, item);
+                      new_item->n_items = skip;
+                      item->n_items -= skip;
+                      gtk_rb_tree_node_mark_dirty (item);
+                    }
+                  else
+                    {
+                      item = gtk_rb_tree_node_get_next (item);
+                    }
+
+                  skipped = TRUE;
+                  i += skip - 1;
+                  continue;
+                }
+            }
+
           if (item->n_items > 1)
             {
               new_item = gtk_rb_tree_insert_before (self->items, item);
@@ -539,7 +848,7 @@ gtk_list_item_manager_ensure_items (GtkListItemManager *self,
                 }
               if (new_item->widget == NULL)
                 {
-                  new_item->widget = g_queue_pop_head (&released);
+                  new_item->widget = g_queue_pop_head (released);
                   if (new_item->widget)
                     {
                       gtk_list_item_manager_move_list_item (self,
@@ -553,6 +862,7 @@ gtk_list_item_manager_ensure_items (GtkListItemManager *self,
                                                                                   position + i,
                                                                                   insert_after);
                     }
+                  (*n_bound)++;
                 }
             }
           else
@@ -565,8 +875,89 @@ gtk_list_item_manager_ensure_items (GtkListItemManager *self,
       position += query_n_items;
     }
 
+  return skipped;
+}
+
+/*
+ * gtk_list_item_manager_ensure_items:
+ * @self: a #GtkListItemManager
+ * @change: (allow-none): the change to reacquire list items from
+ * @update_start: the first position to update list items from
+ *
+ * Makes sure that all tracked items have a widget and releases the
+ * widgets of all other items.
+ *
+ * Binding list items can be expensive, so when the list is shown,
+ * only a part of every frame is spent on creating widgets for items
+ * that don't have one. Items closest to the position of a tracker -
+ * like the anchor in the middle of the view - get theirs first. The
+ * remaining items are left without a widget, which lists show as empty
+ * space, and get their widget in the next frame. The positions of the
+ * trackers themselves always get a widget right away.
+ */
+static void
+gtk_list_item_manager_ensure_items (GtkListItemManager *self,
+                                    GHashTable         *change,
+                                    guint               update_start)
+{
+  GtkWidget *widget;
+  GQueue released = G_QUEUE_INIT;
+  gint64 start_time, budget, deadline, profiler_start;
+  guint n_items, radius, n_bound;
+  gboolean deferred;
+
+  if (self->model == NULL)
+    return;
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
+  start_time = g_get_monotonic_time ();
+  profiler_start = GDK_PROFILER_CURRENT_TIME;
+  n_bound = 0;
+  deferred = FALSE;
+
+  gtk_list_item_manager_release_items (self, &released);
+
+  /* list items from changes are reused without binding them, so don't
+   * risk losing them */
+  budget = change ? G_MAXINT64 : gtk_list_item_manager_get_bind_budget (self);
+  if (budget == G_MAXINT64)
+    {
+      gtk_list_item_manager_ensure_items_near (self, change, update_start, &released,
+                                               G_MAXUINT, G_MAXINT64, &n_bound);
+    }
+  else
+    {
+      deadline = start_time + budget;
+
+      /* bind from the trackers outwards, doubling the distance every time */
+      for (radius = 0; ; radius = radius ? radius * 2 : 1)
+        {
+          if (!gtk_list_item_manager_ensure_items_near (self, change,
+                                                        radius == 0 ? update_start : G_MAXUINT,
+                                                        &released, radius, deadline, &n_bound))
+            break;
+
+          if (g_get_monotonic_time () > deadline || radius >= n_items)
+            {
+              deferred = TRUE;
+              break;
+            }
+        }
+
+      self->bind_time += g_get_monotonic_time () - start_time;
+    }
+
   while ((widget = g_queue_pop_head (&released)))
     gtk_list_item_manager_release_list_item (self, NULL, widget);
+
+  if (GDK_PROFILER_IS_RUNNING && n_bound > 0)
+    gdk_profiler_add_markf (profiler_start, GDK_PROFILER_CURRENT_TIME - profiler_start,
+                            "list item bind", "%u items%s", n_bound, deferred ? ", more deferred" : "");
+
+  if (deferred && self->bind_tick_id == 0)
+    self->bind_tick_id = gtk_widget_add_tick_callback (self->widget,
+                                                       gtk_list_item_manager_bind_tick_cb,
+                                                       self, NULL);
 }
 
 static void
@@ -581,7 +972,7 @@ gtk_list_item_manager_model_items_changed_cb (GListModel         *model,
   guint n_items;
 
   n_items = g_list_model_get_n_items (G_LIST_MODEL (self->model));
-  change = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify )gtk_widget_unparent);
+  change = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) gtk_list_item_manager_recycle_widget);
 
   gtk_list_item_manager_remove_items (self, change, position, removed);
   gtk_list_item_manager_add_items (self, position, added);
@@ -791,6 +1182,12 @@ gtk_list_item_manager_dispose (GObject *object)
 
   gtk_list_item_manager_clear_model (self);
 
+  g_clear_handle_id (&self->prewarm_id, g_source_remove);
+  if (self->bind_tick_id)
+    {
+      gtk_widget_remove_tick_callback (self->widget, self->bind_tick_id);
+      self->bind_tick_id = 0;
+    }
   g_clear_object (&self->factory);
 
   g_clear_pointer (&self->items, gtk_rb_tree_unref);
@@ -828,6 +1225,8 @@ gtk_list_item_manager_set_factory (GtkListItemManager *self,
   gtk_list_item_manager_remove_items (self, NULL, 0, n_items);
 
   g_set_object (&self->factory, factory);
+  g_clear_handle_id (&self->prewarm_id, g_source_remove);
+  gtk_list_item_manager_start_prewarm (self);
 
   gtk_list_item_manager_add_items (self, 0, n_items);
 
@@ -881,6 +1280,7 @@ gtk_list_item_manager_set_model (GtkListItemManager *self,
                         self);
 
       gtk_list_item_manager_add_items (self, 0, g_list_model_get_n_items (G_LIST_MODEL (model)));
+      gtk_list_item_manager_start_prewarm (self);
     }
 }
 
@@ -922,8 +1322,13 @@ gtk_list_item_manager_acquire_list_item (GtkListItemManager *self,
   g_return_val_if_fail (GTK_IS_LIST_ITEM_MANAGER (self), NULL);
   g_return_val_if_fail (prev_sibling == NULL || GTK_IS_WIDGET (prev_sibling), NULL);
 
-  result = gtk_list_item_widget_new (self->factory,
-                                     self->item_css_name);
+  /* the pool owns a reference, new widgets are floating */
+  result = gtk_list_item_pool_pop (self->factory, self->item_css_name);
+  if (result)
+    g_object_force_floating (G_OBJECT (result));
+  else
+    result = gtk_list_item_widget_new (self->factory,
+                                       self->item_css_name);
 
   gtk_list_item_widget_set_single_click_activate (GTK_LIST_ITEM_WIDGET (result), self->single_click_activate);
 
@@ -1073,7 +1478,7 @@ gtk_list_item_manager_release_list_item (GtkListItemManager *self,
       return;
     }
 
-  gtk_widget_unparent (item);
+  gtk_list_item_manager_recycle_widget (item);
 }
 
 void
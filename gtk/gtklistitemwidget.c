@@ -45,6 +45,8 @@ struct _GtkListItemWidgetPrivate
   guint position;
   gboolean selected;
   gboolean single_click_activate;
+  /* stays setup while unrooted, see gtk_list_item_widget_recycle() */
+  gboolean recycled;
 };
 
 enum {
@@ -149,7 +151,9 @@ gtk_list_item_widget_root (GtkWidget *widget)
 
   GTK_WIDGET_CLASS (gtk_list_item_widget_parent_class)->root (widget);
 
-  if (priv->factory)
+  priv->recycled = FALSE;
+
+  if (priv->factory && priv->list_item == NULL)
     gtk_list_item_factory_setup (priv->factory, self);
 }
 
@@ -161,7 +165,7 @@ gtk_list_item_widget_unroot (GtkWidget *widget)
 
   GTK_WIDGET_CLASS (gtk_list_item_widget_parent_class)->unroot (widget);
 
-  if (priv->list_item)
+  if (priv->list_item && !priv->recycled)
       gtk_list_item_factory_teardown (priv->factory, self);
 }
 
@@ -568,7 +572,7 @@ gtk_list_item_widget_set_factory (GtkListItemWidget  *self,
   if (priv->factory)
     {
       if (priv->list_item)
-        gtk_list_item_factory_teardown (factory, self);
+        gtk_list_item_factory_teardown (priv->factory, self);
       g_clear_object (&priv->factory);
     }
 
@@ -642,6 +646,40 @@ gtk_list_item_widget_remove_child (GtkListItemWidget *self,
   gtk_widget_unparent (child);
 }
 
+/*
+ * gtk_list_item_widget_recycle:
+ * @self: a #GtkListItemWidget
+ *
+ * Unbinds @self from its item and keeps it setup when it gets
+ * unrooted, so it can be reused for a different item - possibly in a
+ * different view - without setting it up again. If it is not set up
+ * yet, this is done now.
+ *
+ * The caller must either root the widget again or tear it down with
+ * gtk_list_item_widget_set_factory() before dropping it.
+ **/
+void
+gtk_list_item_widget_recycle (GtkListItemWidget *self)
+{
+  GtkListItemWidgetPrivate *priv = gtk_list_item_widget_get_instance_private (self);
+
+  g_return_if_fail (priv->factory != NULL);
+
+  if (priv->list_item == NULL)
+    gtk_list_item_factory_setup (priv->factory, self);
+
+  gtk_list_item_widget_update (self, GTK_INVALID_LIST_POSITION, NULL, FALSE);
+  priv->recycled = TRUE;
+}
+
+GtkListItemFactory *
+gtk_list_item_widget_get_factory (GtkListItemWidget *self)
+{
+  GtkListItemWidgetPrivate *priv = gtk_list_item_widget_get_instance_private (self);
+
+  return priv->factory;
+}
+
 GtkListItem *
 gtk_list_item_widget_get_list_item (GtkListItemWidget *self)
 {
@@ -57,6 +57,7 @@ void                    gtk_list_item_widget_update             (GtkListItemWidg
                                                                  gpointer                item,
                                                                  gboolean                selected);
 GtkListItem *           gtk_list_item_widget_get_list_item      (GtkListItemWidget      *self);
+void                    gtk_list_item_widget_recycle            (GtkListItemWidget      *self);
 
 void                    gtk_list_item_widget_default_setup      (GtkListItemWidget      *self,
                                                                  GtkListItem            *list_item);
@@ -70,6 +71,7 @@ void                    gtk_list_item_widget_default_update     (GtkListItemWidg
 
 void                    gtk_list_item_widget_set_factory        (GtkListItemWidget      *self,
                                                                  GtkListItemFactory     *factory);
+GtkListItemFactory *    gtk_list_item_widget_get_factory        (GtkListItemWidget      *self);
 void                    gtk_list_item_widget_set_single_click_activate
                                                                 (GtkListItemWidget     *self,
                                                                  gboolean               single_click_activate);
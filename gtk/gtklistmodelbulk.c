@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtklistmodelbulkprivate.h"
+
+/*
+ * GtkListModelBulk is implemented by list models that can hand out a
+ * range of their items in one call without taking a reference on each
+ * of them, usually because they keep their items in an array anyway.
+ *
+ * Borrowed items stay valid until the model changes, so they must not
+ * be kept across anything that could modify the model, or the main
+ * loop.
+ *
+ * Models that pass through the items of another model implement the
+ * interface by forwarding to gtk_list_model_get_items(), which falls
+ * back to g_list_model_get_item() for models that don't implement it.
+ */
+
+G_DEFINE_INTERFACE (GtkListModelBulk, gtk_list_model_bulk, G_TYPE_LIST_MODEL)
+
+static void
+gtk_list_model_bulk_default_init (GtkListModelBulkInterface *iface)
+{
+}
+
+/*< private >
+ * gtk_list_model_get_items:
+ * @model: a #GListModel
+ * @position: the position of the first item
+ * @n_items: the number of items to get
+ * @items: (out caller-allocates) (array length=n_items): return location
+ *   for the items
+ *
+ * Gets @n_items items starting at @position, which must all exist.
+ *
+ * Returns: %TRUE if the items are borrowed from the model, %FALSE if
+ *   references were taken that must be released with
+ *   gtk_list_model_release_items()
+ */
+gboolean
+gtk_list_model_get_items (GListModel *model,
+                          guint       position,
+                          guint       n_items,
+                          gpointer   *items)
+{
+  guint i;
+
+  if (GTK_IS_LIST_MODEL_BULK (model))
+    return GTK_LIST_MODEL_BULK_GET_IFACE (model)->get_items (GTK_LIST_MODEL_BULK (model),
+                                                             position,
+                                                             n_items,
+                                                             items);
+
+  for (i = 0; i < n_items; i++)
+    items[i] = g_list_model_get_item (model, position + i);
+
+  return FALSE;
+}
+
+void
+gtk_list_model_release_items (gpointer *items,
+                              guint     n_items,
+                              gboolean  borrowed)
+{
+  guint i;
+
+  if (borrowed)
+    return;
+
+  for (i = 0; i < n_items; i++)
+    g_object_unref (items[i]);
+}
+
+/*< private >
+ * gtk_list_model_reader_init:
+ * @reader: a #GtkListModelReader
+ * @model: the model to read
+ *
+ * Prepares @reader for reading items of @model with increasing
+ * positions, like when walking a #GtkBitset. Models implementing
+ * #GtkListModelBulk are read in ranges, other models one item at
+ * a time.
+ *
+ * The model must not change until gtk_list_model_reader_clear()
+ * is called.
+ */
+void
+gtk_list_model_reader_init (GtkListModelReader *reader,
+                            GListModel         *model)
+{
+  reader->model = model;
+  reader->start = 0;
+  reader->n_items = 0;
+  reader->borrowed = TRUE;
+}
+
+/*< private >
+ * gtk_list_model_reader_get:
+ * @reader: a #GtkListModelReader
+ * @position: the position of the item
+ *
+ * Gets the item at @position, which must exist.
+ *
+ * Returns: (transfer none): the item. It is only valid until the next
+ *   call to this function or gtk_list_model_reader_clear().
+ */
+gpointer
+gtk_list_model_reader_get (GtkListModelReader *reader,
+                           guint               position)
+{
+  if (position >= reader->start &&
+      position < reader->start + reader->n_items)
+    return reader->items[position - reader->start];
+
+  gtk_list_model_release_items (reader->items, reader->n_items, reader->borrowed);
+
+  reader->start = position;
+  if (GTK_IS_LIST_MODEL_BULK (reader->model))
+    reader->n_items = MIN (GTK_LIST_MODEL_READER_SIZE,
+                           g_list_model_get_n_items (reader->model) - position);
+  else
+    reader->n_items = 1;
+
+  reader->borrowed = gtk_list_model_get_items (reader->model,
+                                               reader->start,
+                                               reader->n_items,
+                                               reader->items);
+
+  return reader->items[0];
+}
+
+void
+gtk_list_model_reader_clear (GtkListModelReader *reader)
+{
+  gtk_list_model_release_items (reader->items, reader->n_items, reader->borrowed);
+  reader->n_items = 0;
+}
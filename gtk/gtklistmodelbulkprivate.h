@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_LIST_MODEL_BULK_PRIVATE_H__
+#define __GTK_LIST_MODEL_BULK_PRIVATE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GTK_TYPE_LIST_MODEL_BULK                (gtk_list_model_bulk_get_type ())
+#define GTK_LIST_MODEL_BULK(inst)               (G_TYPE_CHECK_INSTANCE_CAST ((inst),                     \
+                                                 GTK_TYPE_LIST_MODEL_BULK, GtkListModelBulk))
+#define GTK_IS_LIST_MODEL_BULK(inst)            (G_TYPE_CHECK_INSTANCE_TYPE ((inst),                     \
+                                                 GTK_TYPE_LIST_MODEL_BULK))
+#define GTK_LIST_MODEL_BULK_GET_IFACE(inst)     (G_TYPE_INSTANCE_GET_INTERFACE ((inst),                  \
+                                                 GTK_TYPE_LIST_MODEL_BULK,                               \
+                                                 GtkListModelBulkInterface))
+
+typedef struct _GtkListModelBulk                GtkListModelBulk;
+typedef struct _GtkListModelBulkInterface       GtkListModelBulkInterface;
+
+struct _GtkListModelBulkInterface
+{
+  GTypeInterface g_iface;
+
+  /* Returns TRUE if the items are borrowed, FALSE if they are references */
+  gboolean (* get_items) (GtkListModelBulk *self,
+                          guint             position,
+                          guint             n_items,
+                          gpointer         *items);
+};
+
+#define GTK_LIST_MODEL_READER_SIZE 256
+
+typedef struct _GtkListModelReader GtkListModelReader;
+
+struct _GtkListModelReader
+{
+  /*< private >*/
+  GListModel *model;
+  guint start;
+  guint n_items;
+  gboolean borrowed;
+  gpointer items[GTK_LIST_MODEL_READER_SIZE];
+};
+
+GType                   gtk_list_model_bulk_get_type            (void);
+
+gboolean                gtk_list_model_get_items                (GListModel             *model,
+                                                                 guint                   position,
+                                                                 guint                   n_items,
+                                                                 gpointer               *items);
+void                    gtk_list_model_release_items            (gpointer               *items,
+                                                                 guint                   n_items,
+                                                                 gboolean                borrowed);
+
+void                    gtk_list_model_reader_init              (GtkListModelReader     *reader,
+                                                                 GListModel             *model);
+gpointer                gtk_list_model_reader_get               (GtkListModelReader     *reader,
+                                                                 guint                   position);
+void                    gtk_list_model_reader_clear             (GtkListModelReader     *reader);
+
+G_END_DECLS
+
+#endif /* __GTK_LIST_MODEL_BULK_PRIVATE_H__ */
@@ -1228,6 +1228,61 @@ gtk_list_store_remove (GtkListStore *list_store,
     }
 }
 
+/**
+ * gtk_list_store_remove_rows:
+ * @list_store: A #GtkListStore
+ * @position: position of the first row to remove
+ * @n_rows: the number of rows to remove
+ *
+ * Removes @n_rows rows starting at @position from the list store.
+ * Rows past the end of the list are ignored.
+ *
+ * This is faster than removing the rows one by one with
+ * gtk_list_store_remove(). A #GtkTreeModel::row-deleted signal is
+ * still emitted for every row, and handlers of it must not modify
+ * @list_store.
+ */
+void
+gtk_list_store_remove_rows (GtkListStore *list_store,
+                            int           position,
+                            int           n_rows)
+{
+  GtkListStorePrivate *priv;
+  GtkTreePath *path;
+  GSequenceIter *ptr, *next;
+  int i;
+
+  g_return_if_fail (GTK_IS_LIST_STORE (list_store));
+  g_return_if_fail (position >= 0);
+  g_return_if_fail (n_rows >= 0);
+
+  priv = list_store->priv;
+
+  if (position >= priv->length)
+    return;
+
+  n_rows = MIN (n_rows, priv->length - position);
+  ptr = g_sequence_get_iter_at_pos (priv->seq, position);
+  path = gtk_tree_path_new_from_indices (position, -1);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      next = g_sequence_iter_next (ptr);
+
+      _gtk_tree_data_list_free (g_sequence_get (ptr), priv->column_headers);
+      g_sequence_remove (ptr);
+
+      priv->length--;
+
+      /* The following rows move up, so the path stays the same */
+      gtk_tree_model_row_deleted (GTK_TREE_MODEL (list_store), path);
+
+      ptr = next;
+    }
+
+  gtk_tree_path_free (path);
+}
+
 /**
  * gtk_list_store_insert:
  * @list_store: A #GtkListStore
@@ -2318,6 +2373,92 @@ gtk_list_store_insert_with_valuesv (GtkListStore *list_store,
   gtk_tree_path_free (path);
 }
 
+/**
+ * gtk_list_store_insert_rows_with_valuesv:
+ * @list_store: A #GtkListStore
+ * @position: position to insert the new rows, or -1 for last
+ * @n_rows: the number of rows to insert
+ * @columns: (array length=n_values): an array of column numbers
+ * @values: (array): an array of @n_rows times @n_values GValues,
+ *     holding the values of the first row, followed by those of
+ *     the second row and so on
+ * @n_values: the length of the @columns array
+ *
+ * Inserts @n_rows new rows at @position, filled with the given values.
+ *
+ * This has the same effect as calling
+ * gtk_list_store_insert_with_valuesv() for every row, but is faster
+ * when adding many rows, since the insertion position only needs to
+ * be looked up once. A #GtkTreeModel::row-inserted signal is still
+ * emitted for every row, and handlers of it must not modify @list_store.
+ */
+void
+gtk_list_store_insert_rows_with_valuesv (GtkListStore *list_store,
+                                         int           position,
+                                         int           n_rows,
+                                         int          *columns,
+                                         GValue       *values,
+                                         int           n_values)
+{
+  GtkListStorePrivate *priv;
+  GtkTreePath *path;
+  GSequenceIter *next;
+  GtkTreeIter iter;
+  int length, i;
+
+  g_return_if_fail (GTK_IS_LIST_STORE (list_store));
+  g_return_if_fail (n_rows >= 0);
+  g_return_if_fail (n_values == 0 || (columns != NULL && values != NULL));
+
+  priv = list_store->priv;
+
+  priv->columns_dirty = TRUE;
+
+  length = g_sequence_get_length (priv->seq);
+  if (position > length || position < 0)
+    position = length;
+
+  next = g_sequence_get_iter_at_pos (priv->seq, position);
+  path = gtk_tree_path_new_from_indices (position, -1);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      gboolean changed = FALSE;
+      gboolean maybe_need_sort = FALSE;
+
+      iter.stamp = priv->stamp;
+      iter.user_data = g_sequence_insert_before (next, NULL);
+
+      priv->length++;
+
+      gtk_list_store_set_vector_internal (list_store, &iter,
+                                          &changed, &maybe_need_sort,
+                                          columns, values + i * n_values, n_values);
+
+      if (GTK_LIST_STORE_IS_SORTED (list_store))
+        {
+          GtkTreePath *sorted_path;
+
+          /* Don't emit rows_reordered here */
+          if (maybe_need_sort)
+            g_sequence_sort_changed_iter (iter.user_data,
+                                          gtk_list_store_compare_func,
+                                          list_store);
+
+          sorted_path = gtk_list_store_get_path (GTK_TREE_MODEL (list_store), &iter);
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (list_store), sorted_path, &iter);
+          gtk_tree_path_free (sorted_path);
+        }
+      else
+        {
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (list_store), path, &iter);
+          gtk_tree_path_next (path);
+        }
+    }
+
+  gtk_tree_path_free (path);
+}
+
 /* GtkBuildable custom tag implementation
  *
  * <columns>
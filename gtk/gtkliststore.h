@@ -96,6 +96,10 @@ GDK_AVAILABLE_IN_ALL
 gboolean      gtk_list_store_remove           (GtkListStore *list_store,
 					       GtkTreeIter  *iter);
 GDK_AVAILABLE_IN_ALL
+void          gtk_list_store_remove_rows      (GtkListStore *list_store,
+                                               int           position,
+                                               int           n_rows);
+GDK_AVAILABLE_IN_ALL
 void          gtk_list_store_insert           (GtkListStore *list_store,
 					       GtkTreeIter  *iter,
 					       int           position);
@@ -120,6 +124,13 @@ void          gtk_list_store_insert_with_valuesv (GtkListStore *list_store,
 						  GValue       *values,
 						  int           n_values);
 GDK_AVAILABLE_IN_ALL
+void          gtk_list_store_insert_rows_with_valuesv (GtkListStore *list_store,
+                                                       int           position,
+                                                       int           n_rows,
+                                                       int          *columns,
+                                                       GValue       *values,
+                                                       int           n_values);
+GDK_AVAILABLE_IN_ALL
 void          gtk_list_store_prepend          (GtkListStore *list_store,
 					       GtkTreeIter  *iter);
 GDK_AVAILABLE_IN_ALL
@@ -148,6 +148,11 @@ struct _GtkListView
   gboolean show_separators;
 
   int list_width;
+
+  /* sum and number of the heights measured for rows, used to
+   * estimate the height of rows without a widget */
+  guint64 measured_height;
+  guint n_measured;
 };
 
 struct _GtkListViewClass
@@ -159,6 +164,7 @@ struct _ListRow
 {
   GtkListItemManagerItem parent;
   guint height; /* per row */
+  guint measured : 1; /* height is included in measured_height */
 };
 
 struct _ListRowAugment
@@ -481,6 +487,38 @@ gtk_list_view_get_unknown_row_height (GtkListView *self,
   return g_array_index (heights, int, heights->len / 2);
 }
 
+/* Returns a stable estimate for rows that have never been measured.
+ * The median of the rows that are currently realized changes with
+ * every scroll, which in turn makes the scrollbar jump around, so
+ * this is the average of all rows that were measured since the width
+ * of the list last changed.
+ */
+static guint
+gtk_list_view_get_estimated_row_height (GtkListView *self,
+                                        GArray      *heights)
+{
+  if (self->n_measured > 0)
+    return (self->measured_height + self->n_measured / 2) / self->n_measured;
+
+  return gtk_list_view_get_unknown_row_height (self, heights);
+}
+
+static void
+gtk_list_view_forget_measured_heights (GtkListView *self)
+{
+  ListRow *row;
+
+  for (row = gtk_list_item_manager_get_first (self->item_manager);
+       row != NULL;
+       row = gtk_rb_tree_node_get_next (row))
+    {
+      row->measured = FALSE;
+    }
+
+  self->measured_height = 0;
+  self->n_measured = 0;
+}
+
 static void
 gtk_list_view_measure_across (GtkWidget      *widget,
                               GtkOrientation  orientation,
@@ -598,6 +636,7 @@ gtk_list_view_size_allocate (GtkWidget *widget,
   int x, y;
   GtkOrientation orientation, opposite_orientation;
   GtkScrollablePolicy scroll_policy;
+  int list_width;
 
   orientation = gtk_list_base_get_orientation (GTK_LIST_BASE (self));
   opposite_orientation = OPPOSITE_ORIENTATION (orientation);
@@ -611,11 +650,18 @@ gtk_list_view_size_allocate (GtkWidget *widget,
   gtk_widget_measure (widget, opposite_orientation,
                       -1,
                       &min, &nat, NULL, NULL);
-  self->list_width = orientation == GTK_ORIENTATION_VERTICAL ? width : height;
+  list_width = orientation == GTK_ORIENTATION_VERTICAL ? width : height;
   if (scroll_policy == GTK_SCROLL_MINIMUM)
-    self->list_width = MAX (min, self->list_width);
+    list_width = MAX (min, list_width);
   else
-    self->list_width = MAX (nat, self->list_width);
+    list_width = MAX (nat, list_width);
+
+  /* heights measured for a different width are no good estimate */
+  if (self->list_width != list_width)
+    {
+      self->list_width = list_width;
+      gtk_list_view_forget_measured_heights (self);
+    }
 
   /* step 2: determine height of known list items */
   heights = g_array_new (FALSE, FALSE, sizeof (int));
@@ -634,6 +680,19 @@ gtk_list_view_size_allocate (GtkWidget *widget,
         row_height = min;
       else
         row_height = nat;
+
+      if (!row->measured)
+        {
+          self->measured_height += row_height;
+          self->n_measured++;
+          row->measured = TRUE;
+        }
+      else
+        {
+          self->measured_height += row_height;
+          self->measured_height -= row->height;
+        }
+
       if (row->height != row_height)
         {
           row->height = row_height;
@@ -643,7 +702,7 @@ gtk_list_view_size_allocate (GtkWidget *widget,
     }
 
   /* step 3: determine height of unknown items */
-  row_height = gtk_list_view_get_unknown_row_height (self, heights);
+  row_height = gtk_list_view_get_estimated_row_height (self, heights);
   g_array_free (heights, TRUE);
 
   for (row = gtk_list_item_manager_get_first (self->item_manager);
@@ -653,6 +712,9 @@ gtk_list_view_size_allocate (GtkWidget *widget,
       if (row->parent.widget)
         continue;
 
+      /* the row lost its widget, measure it again when it gets a new one */
+      row->measured = FALSE;
+
       if (row->height != row_height)
         {
           row->height = row_height;
@@ -1001,6 +1063,8 @@ gtk_list_view_set_model (GtkListView       *self,
   if (!gtk_list_base_set_model (GTK_LIST_BASE (self), model))
     return;
 
+  gtk_list_view_forget_measured_heights (self);
+
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODEL]);
 }
 
@@ -1038,6 +1102,7 @@ gtk_list_view_set_factory (GtkListView        *self,
     return;
 
   gtk_list_item_manager_set_factory (self->item_manager, factory);
+  gtk_list_view_forget_measured_heights (self);
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_FACTORY]);
 }
@@ -93,6 +93,7 @@
 
 #include "gdk/gdk.h"
 #include "gdk/gdk-private.h"
+#include "gdk/gdkprofilerprivate.h"
 #include "gsk/gskprivate.h"
 #include "gsk/gskrendernodeprivate.h"
 #include "gtknative.h"
@@ -119,7 +120,6 @@
 #include "gtkdebug.h"
 #include "gtkdropprivate.h"
 #include "gtkmain.h"
-#include "gtkmediafileprivate.h"
 #include "gtkmodulesprivate.h"
 #include "gtkprivate.h"
 #include "gtkrecentmanager.h"
@@ -128,8 +128,6 @@
 #include "gtkwidgetprivate.h"
 #include "gtkwindowprivate.h"
 #include "gtkwindowgroup.h"
-#include "gtkprintbackendprivate.h"
-#include "gtkimmodule.h"
 #include "gtkroot.h"
 #include "gtknative.h"
 
@@ -535,6 +533,7 @@ do_pre_parse_initialization (void)
 {
   const char *env_string;
   double slowdown;
+  gint64 before;
 
   if (pre_initialized)
     return;
@@ -564,7 +563,9 @@ do_pre_parse_initialization (void)
     }
 
   /* Trigger fontconfig initialization early */
+  before = GDK_PROFILER_CURRENT_TIME;
   pango_cairo_font_map_get_default ();
+  gdk_profiler_end_mark (before, "fontconfig init", NULL);
 }
 
 static void
@@ -592,6 +593,7 @@ static void
 do_post_parse_initialization (void)
 {
   GdkDisplayManager *display_manager;
+  gint64 before;
 
   if (gtk_initialized)
     return;
@@ -604,18 +606,22 @@ do_post_parse_initialization (void)
 
   gtk_widget_set_default_direction (gtk_get_locale_direction ());
 
+  before = GDK_PROFILER_CURRENT_TIME;
   gdk_event_init_types ();
-  gsk_ensure_resources ();
   gsk_render_node_init_types ();
+  gdk_profiler_end_mark (before, "type init", NULL);
+
+  before = GDK_PROFILER_CURRENT_TIME;
+  gsk_ensure_resources ();
   _gtk_ensure_resources ();
+  gdk_profiler_end_mark (before, "resources init", NULL);
 
   gtk_initialized = TRUE;
 
-#ifdef G_OS_UNIX
-  gtk_print_backends_init ();
-#endif
-  gtk_im_modules_init ();
-  gtk_media_file_extension_init ();
+  /* Input method, print backend and media modules are loaded
+   * when they are first needed, since they are not required to
+   * show the first frame.
+   */
 
   display_manager = gdk_display_manager_get ();
   if (gdk_display_manager_get_default_display (display_manager) != NULL)
@@ -648,6 +654,7 @@ gboolean
 gtk_init_check (void)
 {
   gboolean ret;
+  gint64 before;
 
   if (gtk_initialized)
     return TRUE;
@@ -660,7 +667,9 @@ gtk_init_check (void)
   do_pre_parse_initialization ();
   do_post_parse_initialization ();
 
+  before = GDK_PROFILER_CURRENT_TIME;
   ret = gdk_display_open_default () != NULL;
+  gdk_profiler_end_mark (before, "display open", NULL);
 
   if (ret && (gtk_get_debug_flags () & GTK_DEBUG_INTERACTIVE))
     gtk_window_set_interactive_debugging (TRUE);
@@ -1862,22 +1871,38 @@ gtk_propagate_event_internal (GtkWidget *widget,
   int handled_event = FALSE;
   GtkWidget *target = widget;
   GtkWidgetStack widget_array;
+  gboolean is_motion;
   int i;
 
+  is_motion = gdk_event_get_event_type (event) == GDK_MOTION_NOTIFY;
+
   /* First, propagate event down */
   gtk_widget_stack_init (&widget_array);
-  gtk_widget_stack_append (&widget_array, g_object_ref (widget));
 
   for (;;)
     {
+      /* Motion events are frequent and most widgets don't care about
+       * them. Insensitive and unrealized widgets stop propagation, so
+       * they can't be skipped.
+       */
+      if (!is_motion ||
+          _gtk_widget_has_motion_controllers (widget) ||
+          !_gtk_widget_is_sensitive (widget) ||
+          !_gtk_widget_get_realized (widget))
+        gtk_widget_stack_append (&widget_array, g_object_ref (widget));
+
+      if (widget != target && widget == topmost)
+        break;
+
       widget = _gtk_widget_get_parent (widget);
       if (!widget)
         break;
+    }
 
-      gtk_widget_stack_append (&widget_array, g_object_ref (widget));
-
-      if (widget == topmost)
-        break;
+  if (gtk_widget_stack_get_size (&widget_array) == 0)
+    {
+      gtk_widget_stack_clear (&widget_array);
+      return FALSE;
     }
 
   i = gtk_widget_stack_get_size (&widget_array) - 1;
@@ -23,8 +23,20 @@
 
 #include "gtkrbtreeprivate.h"
 #include "gtkintl.h"
+#include "gtklistmodelbulkprivate.h"
 #include "gtkprivate.h"
 
+/* The minimum number of items to map in threads
+ *
+ * When many items are requested at once and the map function may be
+ * called in threads, they are mapped in parallel if at least this
+ * many of them haven't been mapped yet.
+ */
+#define GTK_MAP_THREAD_MIN_ITEMS (64)
+
+/* The maximum number of threads to map in */
+#define GTK_MAP_MAX_THREADS (8)
+
 /**
  * SECTION:gtkmaplistmodel
  * @title: GtkMapListModel
@@ -57,12 +69,21 @@
  * ]|
  *
  * #GtkMapListModel will attempt to discard the mapped objects as soon as
- * they are no longer needed and recreate them if necessary.
+ * they are no longer needed and recreate them if necessary. If mapping
+ * is expensive, gtk_map_list_model_set_cache_size() can be used to keep
+ * the most recently used mapped objects around.
+ *
+ * If the map function can be called from any thread, this can be
+ * declared with gtk_map_list_model_set_map_in_threads(). When a model
+ * using this one, like a #GtkSortListModel or #GtkFilterListModel,
+ * reads many items at once, they are then mapped in parallel.
  */
 
 enum {
   PROP_0,
+  PROP_CACHE_SIZE,
   PROP_HAS_MAP,
+  PROP_MAP_IN_THREADS,
   PROP_MODEL,
   NUM_PROPERTIES
 };
@@ -91,6 +112,37 @@ struct _GtkMapListModel
   GDestroyNotify user_destroy;
 
   GtkRbTree *items; /* NULL if map_func == NULL */
+
+  gboolean map_in_threads;
+  guint cache_size;
+  GQueue cache; /* strong refs to the mapped items, most recently used first */
+  GHashTable *cache_links; /* item => link in cache */
+};
+
+typedef struct _GtkMapJob GtkMapJob;
+typedef struct _GtkMapJobChunk GtkMapJobChunk;
+
+/* Maps a range of items in threads, while the main thread waits */
+struct _GtkMapJobChunk
+{
+  GtkMapJob *job;
+  guint start;
+  guint end;
+};
+
+struct _GtkMapJob
+{
+  GtkMapListModelMapFunc map_func;
+  gpointer user_data;
+
+  gpointer *items; /* the items to map, replaced by the mapped items */
+
+  guint n_chunks;
+  GtkMapJobChunk chunks[GTK_MAP_MAX_THREADS];
+
+  GMutex lock;
+  GCond cond;
+  guint n_running; /* protected by lock */
 };
 
 struct _GtkMapListModelClass
@@ -157,26 +209,67 @@ gtk_map_list_model_get_n_items (GListModel *list)
   return g_list_model_get_n_items (self->model);
 }
 
-static gpointer
-gtk_map_list_model_get_item (GListModel *list,
-                             guint       position)
+static void
+gtk_map_list_model_cache_item (GtkMapListModel *self,
+                               gpointer         item)
 {
-  GtkMapListModel *self = GTK_MAP_LIST_MODEL (list);
-  MapNode *node;
-  guint offset;
+  GList *link;
 
-  if (self->model == NULL)
-    return NULL;
+  if (self->cache_size == 0)
+    return;
 
-  if (self->items == NULL)
-    return g_list_model_get_item (self->model, position);
+  link = g_hash_table_lookup (self->cache_links, item);
+  if (link)
+    {
+      g_queue_unlink (&self->cache, link);
+      g_queue_push_head_link (&self->cache, link);
+      return;
+    }
 
-  node = gtk_map_list_model_get_nth (self->items, position, &offset);
-  if (node == NULL)
-    return NULL;
+  g_queue_push_head (&self->cache, g_object_ref (item));
+  g_hash_table_insert (self->cache_links, item, self->cache.head);
 
-  if (node->item)
-    return g_object_ref (node->item);
+  while (self->cache.length > self->cache_size)
+    {
+      gpointer evicted = g_queue_pop_tail (&self->cache);
+
+      g_hash_table_remove (self->cache_links, evicted);
+      g_object_unref (evicted);
+    }
+}
+
+static void
+gtk_map_list_model_uncache_item (GtkMapListModel *self,
+                                 gpointer         item)
+{
+  GList *link;
+
+  link = g_hash_table_lookup (self->cache_links, item);
+  if (link == NULL)
+    return;
+
+  g_hash_table_remove (self->cache_links, item);
+  g_queue_delete_link (&self->cache, link);
+  g_object_unref (item);
+}
+
+static void
+gtk_map_list_model_clear_cache (GtkMapListModel *self)
+{
+  g_hash_table_remove_all (self->cache_links);
+  g_queue_clear_full (&self->cache, g_object_unref);
+}
+
+/* Stores @item as the mapped item of the unmapped item at @position,
+ * which is in @node, starting at @offset. */
+static void
+gtk_map_list_model_set_nth_item (GtkMapListModel *self,
+                                 MapNode         *node,
+                                 guint            offset,
+                                 guint            position,
+                                 gpointer         item)
+{
+  g_assert (node->item == NULL);
 
   if (offset != position)
     {
@@ -194,10 +287,40 @@ gtk_map_list_model_get_item (GListModel *list,
       gtk_rb_tree_node_mark_dirty (node);
     }
 
-  node->item = self->map_func (g_list_model_get_item (self->model, position), self->user_data);
+  node->item = item;
   g_object_add_weak_pointer (node->item, &node->item);
+}
+
+static gpointer
+gtk_map_list_model_get_item (GListModel *list,
+                             guint       position)
+{
+  GtkMapListModel *self = GTK_MAP_LIST_MODEL (list);
+  MapNode *node;
+  guint offset;
+  gpointer item;
+
+  if (self->model == NULL)
+    return NULL;
+
+  if (self->items == NULL)
+    return g_list_model_get_item (self->model, position);
+
+  node = gtk_map_list_model_get_nth (self->items, position, &offset);
+  if (node == NULL)
+    return NULL;
+
+  if (node->item)
+    {
+      gtk_map_list_model_cache_item (self, node->item);
+      return g_object_ref (node->item);
+    }
 
-  return node->item;
+  item = self->map_func (g_list_model_get_item (self->model, position), self->user_data);
+  gtk_map_list_model_set_nth_item (self, node, offset, position, item);
+  gtk_map_list_model_cache_item (self, item);
+
+  return item;
 }
 
 static void
@@ -208,8 +331,152 @@ gtk_map_list_model_model_init (GListModelInterface *iface)
   iface->get_item = gtk_map_list_model_get_item;
 }
 
+static void
+gtk_map_job_chunk_run (gpointer data,
+                       gpointer unused)
+{
+  GtkMapJobChunk *chunk = data;
+  GtkMapJob *job = chunk->job;
+  guint i;
+
+  for (i = chunk->start; i < chunk->end; i++)
+    job->items[i] = job->map_func (job->items[i], job->user_data);
+
+  g_mutex_lock (&job->lock);
+  job->n_running--;
+  if (job->n_running == 0)
+    g_cond_signal (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static GThreadPool *
+get_map_pool (void)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (gtk_map_job_chunk_run, NULL,
+                                    CLAMP (g_get_num_processors (), 1, GTK_MAP_MAX_THREADS),
+                                    FALSE, NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+/* Maps @items in threads and waits for the result */
+static void
+gtk_map_list_model_map_in_threads (GtkMapListModel *self,
+                                   gpointer        *items,
+                                   guint            n_items)
+{
+  GtkMapJob job;
+  guint i, chunk_size;
+
+  job.map_func = self->map_func;
+  job.user_data = self->user_data;
+  job.items = items;
+  g_mutex_init (&job.lock);
+  g_cond_init (&job.cond);
+
+  job.n_chunks = CLAMP (g_get_num_processors (), 1, GTK_MAP_MAX_THREADS);
+  chunk_size = (n_items + job.n_chunks - 1) / job.n_chunks;
+  job.n_chunks = (n_items + chunk_size - 1) / chunk_size;
+  job.n_running = job.n_chunks;
+
+  for (i = 0; i < job.n_chunks; i++)
+    {
+      job.chunks[i].job = &job;
+      job.chunks[i].start = i * chunk_size;
+      job.chunks[i].end = MIN ((i + 1) * chunk_size, n_items);
+      g_thread_pool_push (get_map_pool (), &job.chunks[i], NULL);
+    }
+
+  g_mutex_lock (&job.lock);
+  while (job.n_running > 0)
+    g_cond_wait (&job.cond, &job.lock);
+  g_mutex_unlock (&job.lock);
+
+  g_mutex_clear (&job.lock);
+  g_cond_clear (&job.cond);
+}
+
+static gboolean
+gtk_map_list_model_get_items (GtkListModelBulk *list,
+                              guint             position,
+                              guint             n_items,
+                              gpointer         *items)
+{
+  GtkMapListModel *self = GTK_MAP_LIST_MODEL (list);
+  guint i, n_unmapped;
+  guint *unmapped;
+  gpointer *mapped;
+
+  if (self->items == NULL)
+    return gtk_list_model_get_items (self->model, position, n_items, items);
+
+  if (!self->map_in_threads)
+    {
+      for (i = 0; i < n_items; i++)
+        items[i] = gtk_map_list_model_get_item (G_LIST_MODEL (self), position + i);
+      return FALSE;
+    }
+
+  unmapped = g_new (guint, n_items);
+  n_unmapped = 0;
+  for (i = position; i < position + n_items; i++)
+    {
+      MapNode *node = gtk_map_list_model_get_nth (self->items, i, NULL);
+
+      if (node->item == NULL)
+        unmapped[n_unmapped++] = i;
+    }
+
+  if (n_unmapped < GTK_MAP_THREAD_MIN_ITEMS)
+    n_unmapped = 0;
+
+  /* The model and its items may only be accessed in the main thread */
+  mapped = g_new (gpointer, n_unmapped);
+  for (i = 0; i < n_unmapped; i++)
+    mapped[i] = g_list_model_get_item (self->model, unmapped[i]);
+
+  if (n_unmapped > 0)
+    gtk_map_list_model_map_in_threads (self, mapped, n_unmapped);
+
+  for (i = 0; i < n_unmapped; i++)
+    {
+      MapNode *node;
+      guint offset;
+
+      node = gtk_map_list_model_get_nth (self->items, unmapped[i], &offset);
+      gtk_map_list_model_set_nth_item (self, node, offset, unmapped[i], mapped[i]);
+    }
+
+  /* The mapped items are kept alive until here, so they are found */
+  for (i = 0; i < n_items; i++)
+    items[i] = gtk_map_list_model_get_item (G_LIST_MODEL (self), position + i);
+
+  for (i = 0; i < n_unmapped; i++)
+    g_object_unref (mapped[i]);
+  g_free (mapped);
+  g_free (unmapped);
+
+  return FALSE;
+}
+
+static void
+gtk_map_list_model_bulk_init (GtkListModelBulkInterface *iface)
+{
+  iface->get_items = gtk_map_list_model_get_items;
+}
+
 G_DEFINE_TYPE_WITH_CODE (GtkMapListModel, gtk_map_list_model, G_TYPE_OBJECT,
-                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_map_list_model_model_init))
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_map_list_model_model_init)
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_LIST_MODEL_BULK, gtk_map_list_model_bulk_init))
 
 static void
 gtk_map_list_model_items_changed_cb (GListModel      *model,
@@ -237,6 +504,8 @@ gtk_map_list_model_items_changed_cb (GListModel      *model,
         {
           MapNode *next = gtk_rb_tree_node_get_next (node);
           removed -= node->n_items;
+          if (node->item)
+            gtk_map_list_model_uncache_item (self, node->item);
           gtk_rb_tree_remove (self->items, node);
           node = next;
         }
@@ -284,6 +553,14 @@ gtk_map_list_model_set_property (GObject      *object,
 
   switch (prop_id)
     {
+    case PROP_CACHE_SIZE:
+      gtk_map_list_model_set_cache_size (self, g_value_get_uint (value));
+      break;
+
+    case PROP_MAP_IN_THREADS:
+      gtk_map_list_model_set_map_in_threads (self, g_value_get_boolean (value));
+      break;
+
     case PROP_MODEL:
       gtk_map_list_model_set_model (self, g_value_get_object (value));
       break;
@@ -304,10 +581,18 @@ gtk_map_list_model_get_property (GObject     *object,
 
   switch (prop_id)
     {
+    case PROP_CACHE_SIZE:
+      g_value_set_uint (value, self->cache_size);
+      break;
+
     case PROP_HAS_MAP:
       g_value_set_boolean (value, self->items != NULL);
       break;
 
+    case PROP_MAP_IN_THREADS:
+      g_value_set_boolean (value, self->map_in_threads);
+      break;
+
     case PROP_MODEL:
       g_value_set_object (value, self->model);
       break;
@@ -339,11 +624,22 @@ gtk_map_list_model_dispose (GObject *object)
   self->map_func = NULL;
   self->user_data = NULL;
   self->user_destroy = NULL;
+  gtk_map_list_model_clear_cache (self);
   g_clear_pointer (&self->items, gtk_rb_tree_unref);
 
   G_OBJECT_CLASS (gtk_map_list_model_parent_class)->dispose (object);
 }
 
+static void
+gtk_map_list_model_finalize (GObject *object)
+{
+  GtkMapListModel *self = GTK_MAP_LIST_MODEL (object);
+
+  g_hash_table_unref (self->cache_links);
+
+  G_OBJECT_CLASS (gtk_map_list_model_parent_class)->finalize (object);
+}
+
 static void
 gtk_map_list_model_class_init (GtkMapListModelClass *class)
 {
@@ -352,6 +648,19 @@ gtk_map_list_model_class_init (GtkMapListModelClass *class)
   gobject_class->set_property = gtk_map_list_model_set_property;
   gobject_class->get_property = gtk_map_list_model_get_property;
   gobject_class->dispose = gtk_map_list_model_dispose;
+  gobject_class->finalize = gtk_map_list_model_finalize;
+
+  /**
+   * GtkMapListModel:cache-size:
+   *
+   * The number of mapped items to keep around
+   */
+  properties[PROP_CACHE_SIZE] =
+      g_param_spec_uint ("cache-size",
+                         P_("Cache size"),
+                         P_("The number of mapped items to keep around"),
+                         0, G_MAXUINT, 0,
+                         GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
   /**
    * GtkMapListModel:has-map:
@@ -365,6 +674,18 @@ gtk_map_list_model_class_init (GtkMapListModelClass *class)
                             FALSE,
                             GTK_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * GtkMapListModel:map-in-threads:
+   *
+   * If the map function may be called in threads
+   */
+  properties[PROP_MAP_IN_THREADS] =
+      g_param_spec_boolean ("map-in-threads",
+                            P_("Map in threads"),
+                            P_("If the map function may be called in threads"),
+                            FALSE,
+                            GTK_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /**
    * GtkMapListModel:model:
    *
@@ -383,6 +704,8 @@ gtk_map_list_model_class_init (GtkMapListModelClass *class)
 static void
 gtk_map_list_model_init (GtkMapListModel *self)
 {
+  g_queue_init (&self->cache);
+  self->cache_links = g_hash_table_new (NULL, NULL);
 }
 
 
@@ -456,6 +779,8 @@ gtk_map_list_model_clear_node (gpointer _node)
 static void
 gtk_map_list_model_init_items (GtkMapListModel *self)
 {
+  gtk_map_list_model_clear_cache (self);
+
   if (self->map_func && self->model)
     {
       guint n_items;
@@ -619,3 +944,94 @@ gtk_map_list_model_has_map (GtkMapListModel *self)
 
   return self->map_func != NULL;
 }
+
+/**
+ * gtk_map_list_model_set_map_in_threads:
+ * @self: a #GtkMapListModel
+ * @map_in_threads: %TRUE if the map function may be called in threads
+ *
+ * Sets whether the map function may be called in threads.
+ *
+ * If it may, items that are requested together, like when a model
+ * sorting or filtering @self reads them, are mapped in parallel. The
+ * map function must then not access anything but the item it is given
+ * and data that is safe to use from several threads at once.
+ **/
+void
+gtk_map_list_model_set_map_in_threads (GtkMapListModel *self,
+                                       gboolean         map_in_threads)
+{
+  g_return_if_fail (GTK_IS_MAP_LIST_MODEL (self));
+
+  if (self->map_in_threads == map_in_threads)
+    return;
+
+  self->map_in_threads = map_in_threads;
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MAP_IN_THREADS]);
+}
+
+/**
+ * gtk_map_list_model_get_map_in_threads:
+ * @self: a #GtkMapListModel
+ *
+ * Gets whether the map function may be called in threads.
+ *
+ * Returns: %TRUE if the map function may be called in threads
+ **/
+gboolean
+gtk_map_list_model_get_map_in_threads (GtkMapListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_MAP_LIST_MODEL (self), FALSE);
+
+  return self->map_in_threads;
+}
+
+/**
+ * gtk_map_list_model_set_cache_size:
+ * @self: a #GtkMapListModel
+ * @cache_size: the number of mapped items to keep
+ *
+ * Sets the number of mapped items that @self keeps around after
+ * they are no longer used, so they don't need to be mapped again.
+ *
+ * The most recently requested items are kept. By default, no items
+ * are kept.
+ **/
+void
+gtk_map_list_model_set_cache_size (GtkMapListModel *self,
+                                   guint            cache_size)
+{
+  g_return_if_fail (GTK_IS_MAP_LIST_MODEL (self));
+
+  if (self->cache_size == cache_size)
+    return;
+
+  self->cache_size = cache_size;
+
+  while (self->cache.length > self->cache_size)
+    {
+      gpointer evicted = g_queue_pop_tail (&self->cache);
+
+      g_hash_table_remove (self->cache_links, evicted);
+      g_object_unref (evicted);
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_CACHE_SIZE]);
+}
+
+/**
+ * gtk_map_list_model_get_cache_size:
+ * @self: a #GtkMapListModel
+ *
+ * Gets the number of mapped items that @self keeps around.
+ *
+ * Returns: the cache size
+ **/
+guint
+gtk_map_list_model_get_cache_size (GtkMapListModel *self)
+{
+  g_return_val_if_fail (GTK_IS_MAP_LIST_MODEL (self), 0);
+
+  return self->cache_size;
+}
@@ -26,6 +26,8 @@
 #include "gtkmodulesprivate.h"
 #include "gtknomediafileprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 /**
  * SECTION:gtkmediafile
  * @Short_description: Open media files for use in GTK
@@ -190,6 +192,8 @@ gtk_media_file_get_extension (void)
   GIOExtension *e;
   GIOExtensionPoint *ep;
 
+  gtk_media_file_extension_init ();
+
   GTK_NOTE (MODULES, g_print ("Looking up MediaFile extension\n"));
 
   ep = g_io_extension_point_lookup (GTK_MEDIA_FILE_EXTENSION_POINT_NAME);
@@ -600,10 +604,19 @@ gtk_media_file_get_input_stream (GtkMediaFile *self)
 void
 gtk_media_file_extension_init (void)
 {
+  static gboolean initialized = FALSE;
   GIOExtensionPoint *ep;
   GIOModuleScope *scope;
   char **paths;
   int i;
+  gint64 before;
+
+  if (initialized)
+    return;
+
+  initialized = TRUE;
+
+  before = GDK_PROFILER_CURRENT_TIME;
 
   GTK_NOTE (MODULES,
             g_print ("Registering extension point %s\n", GTK_MEDIA_FILE_EXTENSION_POINT_NAME));
@@ -639,4 +652,6 @@ gtk_media_file_extension_init (void)
                    g_type_name (g_io_extension_get_type (ext)));
         }
     }
+
+  gdk_profiler_end_mark (before, "media modules init", NULL);
 }
@@ -42,6 +42,7 @@ struct _GtkMenuSectionBox
 
   GtkMenuSectionBox   *toplevel;
   GtkMenuTracker      *tracker;
+  GtkMenuTrackerItem  *submenu_item; /* set until the submenu is populated */
   GtkBox              *item_box;
   GtkWidget           *separator;
   guint                separator_sync_idle;
@@ -311,7 +312,7 @@ gtk_menu_section_box_insert_func (GtkMenuTrackerItem *item,
 
           model = _gtk_menu_tracker_item_get_link (item, G_MENU_LINK_SUBMENU);
 
-          submenu = gtk_popover_menu_new_from_model_full (model, box->flags);
+          submenu = gtk_popover_menu_new_submenu (model, box->flags);
           gtk_popover_set_has_arrow (GTK_POPOVER (submenu), FALSE);
           gtk_widget_set_valign (submenu, GTK_ALIGN_START);
 
@@ -451,6 +452,7 @@ gtk_menu_section_box_dispose (GObject *object)
     }
 
   g_clear_object (&box->separator);
+  g_clear_object (&box->submenu_item);
 
   if (box->tracker)
     {
@@ -514,6 +516,29 @@ gtk_menu_section_box_new_toplevel (GtkPopoverMenu      *popover,
   g_signal_connect (G_OBJECT (popover), "notify::position", G_CALLBACK (update_popover_position_cb), box);
 }
 
+static void
+gtk_menu_section_box_populate (GtkMenuSectionBox *box)
+{
+  GtkMenuTrackerItem *item = box->submenu_item;
+
+  if (item == NULL)
+    return;
+
+  box->submenu_item = NULL;
+  box->tracker = gtk_menu_tracker_new_for_item_link (item, G_MENU_LINK_SUBMENU, FALSE, FALSE,
+                                                     gtk_menu_section_box_insert_func,
+                                                     gtk_menu_section_box_remove_func,
+                                                     box);
+  g_object_unref (item);
+}
+
+/* The items of a submenu are only created once its page is shown */
+static void
+gtk_menu_section_box_submenu_mapped (GtkWidget *widget)
+{
+  gtk_menu_section_box_populate (GTK_MENU_SECTION_BOX (widget));
+}
+
 static void
 gtk_menu_section_box_new_submenu (GtkMenuTrackerItem *item,
                                   GtkMenuSectionBox  *toplevel,
@@ -546,10 +571,51 @@ gtk_menu_section_box_new_submenu (GtkMenuTrackerItem *item,
   gtk_stack_add_named (GTK_STACK (gtk_widget_get_ancestor (GTK_WIDGET (toplevel), GTK_TYPE_STACK)),
                        GTK_WIDGET (box), gtk_menu_tracker_item_get_label (item));
 
-  box->tracker = gtk_menu_tracker_new_for_item_link (item, G_MENU_LINK_SUBMENU, FALSE, FALSE,
-                                                     gtk_menu_section_box_insert_func,
-                                                     gtk_menu_section_box_remove_func,
-                                                     box);
+  box->submenu_item = g_object_ref (item);
+  g_signal_connect (box, "map", G_CALLBACK (gtk_menu_section_box_submenu_mapped), NULL);
+}
+
+static void
+populate_nested_submenus (GtkWidget *widget)
+{
+  GtkWidget *child;
+
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (GTK_IS_POPOVER_MENU (child))
+        gtk_popover_menu_populate (GTK_POPOVER_MENU (child));
+      else
+        populate_nested_submenus (child);
+    }
+}
+
+/* Populates the submenus one level below the main menu of @popover */
+void
+gtk_menu_section_box_populate_submenus (GtkPopoverMenu *popover)
+{
+  GtkWidget *stack, *child;
+  GPtrArray *pages;
+  guint i;
+
+  stack = gtk_popover_get_child (GTK_POPOVER (popover));
+
+  /* Populating a page adds pages for its own submenus, those
+   * are left alone.
+   */
+  pages = g_ptr_array_new ();
+  for (child = gtk_widget_get_first_child (stack);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    g_ptr_array_add (pages, child);
+
+  for (i = 0; i < pages->len; i++)
+    gtk_menu_section_box_populate (g_ptr_array_index (pages, i));
+
+  g_ptr_array_unref (pages);
+
+  populate_nested_submenus (stack);
 }
 
 static GtkWidget *
@@ -44,6 +44,7 @@ GType                   gtk_menu_section_box_get_type                   (void) G
 void                    gtk_menu_section_box_new_toplevel               (GtkPopoverMenu      *popover,
                                                                          GMenuModel          *model,
                                                                          GtkPopoverMenuFlags  flags);
+void                    gtk_menu_section_box_populate_submenus          (GtkPopoverMenu      *popover);
 
 G_END_DECLS
 
@@ -21,7 +21,7 @@
 
 #include "gtkmultiselection.h"
 
-#include "gtkbitset.h"
+#include "gtkbitsetprivate.h"
 #include "gtkintl.h"
 #include "gtkselectionmodel.h"
 
@@ -158,6 +158,44 @@ gtk_multi_selection_toggle_selection (GtkMultiSelection *self,
   gtk_bitset_unref (selected);
 }
 
+/* Selections that change in more ranges than this are reported as one
+ * change covering all of them */
+#define GTK_MULTI_SELECTION_MAX_CHANGED_RANGES 16
+
+/* Emits a selection-changed signal for every range of @changes, so
+ * views don't update all the items in between that didn't change.
+ */
+static void
+gtk_multi_selection_emit_changes (GtkMultiSelection *self,
+                                  GtkBitset         *changes)
+{
+  GtkSelectionModel *model = GTK_SELECTION_MODEL (self);
+  guint first, last, n_ranges;
+  gboolean more;
+
+  n_ranges = 0;
+  for (more = gtk_bitset_find_range (changes, 0, &first, &last);
+       more && n_ranges <= GTK_MULTI_SELECTION_MAX_CHANGED_RANGES;
+       more = last < G_MAXUINT && gtk_bitset_find_range (changes, last + 1, &first, &last))
+    n_ranges++;
+
+  if (n_ranges == 0)
+    return;
+
+  if (n_ranges > GTK_MULTI_SELECTION_MAX_CHANGED_RANGES)
+    {
+      first = gtk_bitset_get_minimum (changes);
+      last = gtk_bitset_get_maximum (changes);
+      gtk_selection_model_selection_changed (model, first, last - first + 1);
+      return;
+    }
+
+  for (more = gtk_bitset_find_range (changes, 0, &first, &last);
+       more;
+       more = last < G_MAXUINT && gtk_bitset_find_range (changes, last + 1, &first, &last))
+    gtk_selection_model_selection_changed (model, first, last - first + 1);
+}
+
 static gboolean
 gtk_multi_selection_set_selection (GtkSelectionModel *model,
                                    GtkBitset         *selected,
@@ -165,7 +203,7 @@ gtk_multi_selection_set_selection (GtkSelectionModel *model,
 {
   GtkMultiSelection *self = GTK_MULTI_SELECTION (model);
   GtkBitset *changes;
-  guint min, max, n_items;
+  guint max, n_items;
 
   /* changes = (self->selected XOR selected) AND mask
    * But doing it this way avoids looking at all values outside the mask
@@ -174,24 +212,19 @@ gtk_multi_selection_set_selection (GtkSelectionModel *model,
   gtk_bitset_difference (changes, self->selected);
   gtk_bitset_intersect (changes, mask);
 
-  min = gtk_bitset_get_minimum (changes);
   max = gtk_bitset_get_maximum (changes);
 
   /* sanity check */
   n_items = self->model ? g_list_model_get_n_items (self->model) : 0;
   if (max >= n_items)
-    {
-      gtk_bitset_remove_range_closed (changes, n_items, max);
-      max = gtk_bitset_get_maximum (changes);
-    }
+    gtk_bitset_remove_range_closed (changes, n_items, max);
 
   /* actually do the change */
   gtk_multi_selection_toggle_selection (self, changes);
 
-  gtk_bitset_unref (changes);
+  gtk_multi_selection_emit_changes (self, changes);
 
-  if (min <= max)
-    gtk_selection_model_selection_changed (model, min, max - min + 1);
+  gtk_bitset_unref (changes);
 
   return TRUE;
 }
@@ -41,6 +41,7 @@
 #include "gtkbuiltiniconprivate.h"
 #include "gtkintl.h"
 #include "gtklabel.h"
+#include "gtklazypageprivate.h"
 #include "gtkmain.h"
 #include "gtkmarshalers.h"
 #include "gtkpopovermenuprivate.h"
@@ -5538,6 +5539,44 @@ gtk_notebook_append_page (GtkNotebook *notebook,
   return gtk_notebook_insert_page_menu (notebook, child, tab_label, NULL, -1);
 }
 
+/**
+ * gtk_notebook_append_lazy_page:
+ * @notebook: a #GtkNotebook
+ * @tab_label: (allow-none): the #GtkWidget to be used as the label
+ *     for the page, or %NULL to use the default label, “page N”
+ * @create_func: function that creates the contents of the page
+ * @user_data: (closure): user data passed to @create_func
+ * @user_data_free_func: function for freeing @user_data
+ *
+ * Appends a page to @notebook whose contents are only created
+ * when the page is shown for the first time.
+ *
+ * Pages that are never shown don't need to be styled or
+ * measured, which makes notebooks with many pages cheaper.
+ * Until it is shown, the page is empty and has no size.
+ *
+ * The child of the page is a container for the widget that
+ * @create_func returns, not the widget itself.
+ *
+ * Returns: the index (starting from 0) of the appended
+ *     page in the notebook, or -1 if function fails
+ */
+int
+gtk_notebook_append_lazy_page (GtkNotebook                *notebook,
+                               GtkWidget                  *tab_label,
+                               GtkNotebookCreateChildFunc  create_func,
+                               gpointer                    user_data,
+                               GDestroyNotify              user_data_free_func)
+{
+  g_return_val_if_fail (GTK_IS_NOTEBOOK (notebook), -1);
+  g_return_val_if_fail (tab_label == NULL || GTK_IS_WIDGET (tab_label), -1);
+  g_return_val_if_fail (create_func != NULL, -1);
+
+  return gtk_notebook_insert_page_menu (notebook,
+                                        gtk_lazy_page_new (create_func, user_data, user_data_free_func),
+                                        tab_label, NULL, -1);
+}
+
 /**
  * gtk_notebook_append_page_menu:
  * @notebook: a #GtkNotebook
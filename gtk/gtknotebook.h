@@ -54,6 +54,18 @@ typedef enum
 
 typedef struct _GtkNotebook GtkNotebook;
 
+/**
+ * GtkNotebookCreateChildFunc:
+ * @user_data: (closure): user data
+ *
+ * Called by #GtkNotebook to create the child of a page that was
+ * added with gtk_notebook_append_lazy_page(), the first time it
+ * is shown.
+ *
+ * Returns: (transfer full) (nullable): the child of the page
+ */
+typedef GtkWidget * (*GtkNotebookCreateChildFunc) (gpointer user_data);
+
 /***********************************************************
  *           Creation, insertion, deletion                 *
  ***********************************************************/
@@ -72,6 +84,12 @@ int gtk_notebook_append_page_menu   (GtkNotebook *notebook,
 				     GtkWidget   *tab_label,
 				     GtkWidget   *menu_label);
 GDK_AVAILABLE_IN_ALL
+int gtk_notebook_append_lazy_page   (GtkNotebook                *notebook,
+                                     GtkWidget                  *tab_label,
+                                     GtkNotebookCreateChildFunc  create_func,
+                                     gpointer                    user_data,
+                                     GDestroyNotify              user_data_free_func);
+GDK_AVAILABLE_IN_ALL
 int gtk_notebook_prepend_page       (GtkNotebook *notebook,
 				     GtkWidget   *child,
 				     GtkWidget   *tab_label);
@@ -21,11 +21,14 @@
 
 #include "gtknumericsorter.h"
 
+#include "gtkexpressionprivate.h"
 #include "gtkintl.h"
 #include "gtksorterprivate.h"
 #include "gtktypebuiltins.h"
 
+#include <limits.h>
 #include <math.h>
+#include <string.h>
 
 /**
  * SECTION:gtknumericsorter
@@ -144,6 +147,67 @@ COMPARE_FUNCS(gulong)
 COMPARE_FUNCS(gint64)
 COMPARE_FUNCS(guint64)
 
+/* Prefixes are the numbers mapped to guint64 so that they sort the same */
+static inline guint64
+signed_to_prefix (gint64 num)
+{
+  return ((guint64) num) ^ G_GUINT64_CONSTANT (0x8000000000000000);
+}
+
+static inline guint64
+unsigned_to_prefix (guint64 num)
+{
+  return num;
+}
+
+static inline guint64
+double_to_prefix (double num)
+{
+  guint64 bits;
+
+  /* all NaNs sort last, and -0 == 0 */
+  if (isnan (num))
+    return G_MAXUINT64;
+  if (num == 0)
+    num = 0;
+
+  memcpy (&bits, &num, sizeof (bits));
+
+  if (bits & G_GUINT64_CONSTANT (0x8000000000000000))
+    return ~bits;
+  else
+    return bits | G_GUINT64_CONSTANT (0x8000000000000000);
+}
+
+#define PREFIX_FUNCS(type, to_prefix) \
+static guint64 \
+gtk_ ## type ## _sort_keys_prefix_ascending (GtkSortKeys   *keys, \
+                                             gconstpointer  key_memory) \
+{ \
+  return to_prefix (*(type *) key_memory); \
+} \
+static guint64 \
+gtk_ ## type ## _sort_keys_prefix_descending (GtkSortKeys   *keys, \
+                                              gconstpointer  key_memory) \
+{ \
+  return ~to_prefix (*(type *) key_memory); \
+}
+
+#if CHAR_MIN < 0
+PREFIX_FUNCS(char, signed_to_prefix)
+#else
+PREFIX_FUNCS(char, unsigned_to_prefix)
+#endif
+PREFIX_FUNCS(guchar, unsigned_to_prefix)
+PREFIX_FUNCS(int, signed_to_prefix)
+PREFIX_FUNCS(guint, unsigned_to_prefix)
+PREFIX_FUNCS(float, double_to_prefix)
+PREFIX_FUNCS(double, double_to_prefix)
+PREFIX_FUNCS(long, signed_to_prefix)
+PREFIX_FUNCS(gulong, unsigned_to_prefix)
+PREFIX_FUNCS(gint64, signed_to_prefix)
+PREFIX_FUNCS(guint64, unsigned_to_prefix)
+
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 
 #define NUMERIC_SORT_KEYS(TYPE, key_type, type, default_value) \
@@ -174,7 +238,8 @@ static const GtkSortKeysClass GTK_ASCENDING_ ## TYPE ## _SORT_KEYS_CLASS = \
   gtk_ ## key_type ## _sort_keys_compare_ascending, \
   gtk_ ## type ## _sort_keys_is_compatible, \
   gtk_ ## type ## _sort_keys_init_key, \
-  NULL \
+  NULL, \
+  gtk_ ## key_type ## _sort_keys_prefix_ascending, \
 }; \
 \
 static const GtkSortKeysClass GTK_DESCENDING_ ## TYPE ## _SORT_KEYS_CLASS = \
@@ -183,7 +248,8 @@ static const GtkSortKeysClass GTK_DESCENDING_ ## TYPE ## _SORT_KEYS_CLASS = \
   gtk_ ## key_type ## _sort_keys_compare_descending, \
   gtk_ ## type ## _sort_keys_is_compatible, \
   gtk_ ## type ## _sort_keys_init_key, \
-  NULL \
+  NULL, \
+  gtk_ ## key_type ## _sort_keys_prefix_descending, \
 }; \
 \
 static gboolean \
@@ -329,6 +395,8 @@ gtk_numeric_sort_keys_new (GtkNumericSorter *self)
     }
 
   result->expression = gtk_expression_ref (self->expression);
+  result->keys.thread_unsafe = !gtk_expression_is_thread_safe (self->expression);
+  result->keys.prefix_is_key = TRUE;
 
   return (GtkSortKeys *) result;
 }
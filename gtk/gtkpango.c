@@ -27,6 +27,8 @@
 #include <pango/pangocairo.h>
 #include "gtkintl.h"
 #include "gtkbuilderprivate.h"
+#include "gdk/gdkprofilerprivate.h"
+#include <string.h>
 
 static gboolean
 attr_list_merge_filter (PangoAttribute *attribute,
@@ -60,6 +62,309 @@ _gtk_pango_attr_list_merge (PangoAttrList *into,
   return into;
 }
 
+/*
+ * gtk_pango_context_equivalent:
+ * @a: a #PangoContext
+ * @b: a #PangoContext
+ *
+ * Checks whether laying out text with @a and @b gives the same result.
+ *
+ * Returns: %TRUE if @a and @b are equivalent
+ */
+gboolean
+gtk_pango_context_equivalent (PangoContext *a,
+                              PangoContext *b)
+{
+  const PangoMatrix *ma, *mb;
+  const cairo_font_options_t *oa, *ob;
+
+  if (a == b)
+    return TRUE;
+
+  if (pango_context_get_font_map (a) != pango_context_get_font_map (b) ||
+      pango_context_get_base_dir (a) != pango_context_get_base_dir (b) ||
+      pango_context_get_base_gravity (a) != pango_context_get_base_gravity (b) ||
+      pango_context_get_gravity_hint (a) != pango_context_get_gravity_hint (b) ||
+      pango_context_get_language (a) != pango_context_get_language (b) ||
+      pango_context_get_round_glyph_positions (a) != pango_context_get_round_glyph_positions (b) ||
+      pango_cairo_context_get_resolution (a) != pango_cairo_context_get_resolution (b) ||
+      !pango_font_description_equal (pango_context_get_font_description (a),
+                                     pango_context_get_font_description (b)))
+    return FALSE;
+
+  ma = pango_context_get_matrix (a);
+  mb = pango_context_get_matrix (b);
+  if (ma == NULL || mb == NULL)
+    {
+      if (ma != mb)
+        return FALSE;
+    }
+  else if (memcmp (ma, mb, sizeof (PangoMatrix)) != 0)
+    return FALSE;
+
+  oa = pango_cairo_context_get_font_options (a);
+  ob = pango_cairo_context_get_font_options (b);
+  if (oa == NULL || ob == NULL)
+    return oa == ob;
+
+  return cairo_font_options_equal (oa, ob);
+}
+
+static gboolean
+pango_tab_arrays_equal (PangoTabArray *a,
+                        PangoTabArray *b)
+{
+  int i;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  if (pango_tab_array_get_size (a) != pango_tab_array_get_size (b) ||
+      pango_tab_array_get_positions_in_pixels (a) != pango_tab_array_get_positions_in_pixels (b))
+    return FALSE;
+
+  for (i = 0; i < pango_tab_array_get_size (a); i++)
+    {
+      PangoTabAlign align_a, align_b;
+      int location_a, location_b;
+
+      pango_tab_array_get_tab (a, i, &align_a, &location_a);
+      pango_tab_array_get_tab (b, i, &align_b, &location_b);
+
+      if (align_a != align_b || location_a != location_b)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+pango_font_descriptions_equal (const PangoFontDescription *a,
+                               const PangoFontDescription *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return pango_font_description_equal (a, b);
+}
+
+/*
+ * gtk_pango_layout_equivalent:
+ * @a: a #PangoLayout
+ * @b: a #PangoLayout
+ *
+ * Checks whether @a and @b will come out the same when they are laid
+ * out, so that one can be used in place of the other.
+ *
+ * Returns: %TRUE if @a and @b are equivalent
+ */
+gboolean
+gtk_pango_layout_equivalent (PangoLayout *a,
+                             PangoLayout *b)
+{
+  PangoAttrList *attrs_a, *attrs_b;
+  PangoTabArray *tabs_a, *tabs_b;
+  gboolean equal;
+
+  if (a == b)
+    return TRUE;
+
+  if (pango_layout_get_width (a) != pango_layout_get_width (b) ||
+      pango_layout_get_height (a) != pango_layout_get_height (b) ||
+      pango_layout_get_wrap (a) != pango_layout_get_wrap (b) ||
+      pango_layout_get_ellipsize (a) != pango_layout_get_ellipsize (b) ||
+      pango_layout_get_indent (a) != pango_layout_get_indent (b) ||
+      pango_layout_get_spacing (a) != pango_layout_get_spacing (b) ||
+      pango_layout_get_line_spacing (a) != pango_layout_get_line_spacing (b) ||
+      pango_layout_get_justify (a) != pango_layout_get_justify (b) ||
+      pango_layout_get_alignment (a) != pango_layout_get_alignment (b) ||
+      pango_layout_get_auto_dir (a) != pango_layout_get_auto_dir (b) ||
+      pango_layout_get_single_paragraph_mode (a) != pango_layout_get_single_paragraph_mode (b) ||
+      strcmp (pango_layout_get_text (a), pango_layout_get_text (b)) != 0 ||
+      !pango_font_descriptions_equal (pango_layout_get_font_description (a),
+                                      pango_layout_get_font_description (b)) ||
+      !gtk_pango_context_equivalent (pango_layout_get_context (a), pango_layout_get_context (b)))
+    return FALSE;
+
+  attrs_a = pango_layout_get_attributes (a);
+  attrs_b = pango_layout_get_attributes (b);
+  if (attrs_a == NULL || attrs_b == NULL)
+    {
+      if (attrs_a != attrs_b)
+        return FALSE;
+    }
+  else if (!pango_attr_list_equal (attrs_a, attrs_b))
+    return FALSE;
+
+  tabs_a = pango_layout_get_tabs (a);
+  tabs_b = pango_layout_get_tabs (b);
+  equal = pango_tab_arrays_equal (tabs_a, tabs_b);
+  g_clear_pointer (&tabs_a, pango_tab_array_free);
+  g_clear_pointer (&tabs_b, pango_tab_array_free);
+
+  return equal;
+}
+
+/* A process-wide cache of laid out PangoLayouts for short texts that
+ * many widgets show at the same time, like the labels in the rows of a
+ * list or the units next to spin buttons. Every widget that shows such
+ * a text would otherwise shape it again.
+ *
+ * The cached layouts have their own copy of the PangoContext they were
+ * made for, so they don't change when the widget's context does. Users
+ * must not modify them, and have to look up a new layout when their
+ * context changes.
+ */
+#define LAYOUT_CACHE_SIZE 256
+#define LAYOUT_CACHE_MAX_TEXT_LEN 256
+
+static GHashTable *layout_cache; /* PangoLayout -> GList link in layout_lru */
+static GQueue layout_lru = G_QUEUE_INIT;
+static guint layout_cache_hits;
+static guint layout_cache_misses;
+static guint hits_counter;
+static guint misses_counter;
+
+static guint
+layout_hash (gconstpointer data)
+{
+  PangoLayout *layout = (PangoLayout *) data;
+
+  return g_str_hash (pango_layout_get_text (layout)) ^
+         pango_font_description_hash (pango_context_get_font_description (pango_layout_get_context (layout)));
+}
+
+static gboolean
+layout_equal (gconstpointer a,
+              gconstpointer b)
+{
+  return gtk_pango_layout_equivalent ((PangoLayout *) a, (PangoLayout *) b);
+}
+
+static PangoContext *
+copy_pango_context (PangoContext *context)
+{
+  PangoContext *copy;
+
+  copy = pango_font_map_create_context (pango_context_get_font_map (context));
+  pango_context_set_font_description (copy, pango_context_get_font_description (context));
+  pango_context_set_base_dir (copy, pango_context_get_base_dir (context));
+  pango_context_set_base_gravity (copy, pango_context_get_base_gravity (context));
+  pango_context_set_gravity_hint (copy, pango_context_get_gravity_hint (context));
+  pango_context_set_language (copy, pango_context_get_language (context));
+  pango_context_set_matrix (copy, pango_context_get_matrix (context));
+  pango_context_set_round_glyph_positions (copy, pango_context_get_round_glyph_positions (context));
+  pango_cairo_context_set_resolution (copy, pango_cairo_context_get_resolution (context));
+  pango_cairo_context_set_font_options (copy, pango_cairo_context_get_font_options (context));
+
+  return copy;
+}
+
+static PangoLayout *
+copy_pango_layout (PangoLayout *layout)
+{
+  PangoContext *context;
+  PangoLayout *copy;
+  PangoAttrList *attrs;
+  PangoTabArray *tabs;
+
+  context = copy_pango_context (pango_layout_get_context (layout));
+  copy = pango_layout_new (context);
+  g_object_unref (context);
+
+  pango_layout_set_text (copy, pango_layout_get_text (layout), -1);
+  attrs = pango_layout_get_attributes (layout);
+  if (attrs)
+    {
+      attrs = pango_attr_list_copy (attrs);
+      pango_layout_set_attributes (copy, attrs);
+      pango_attr_list_unref (attrs);
+    }
+  pango_layout_set_font_description (copy, pango_layout_get_font_description (layout));
+  pango_layout_set_width (copy, pango_layout_get_width (layout));
+  pango_layout_set_height (copy, pango_layout_get_height (layout));
+  pango_layout_set_wrap (copy, pango_layout_get_wrap (layout));
+  pango_layout_set_ellipsize (copy, pango_layout_get_ellipsize (layout));
+  pango_layout_set_indent (copy, pango_layout_get_indent (layout));
+  pango_layout_set_spacing (copy, pango_layout_get_spacing (layout));
+  pango_layout_set_line_spacing (copy, pango_layout_get_line_spacing (layout));
+  pango_layout_set_justify (copy, pango_layout_get_justify (layout));
+  pango_layout_set_alignment (copy, pango_layout_get_alignment (layout));
+  pango_layout_set_auto_dir (copy, pango_layout_get_auto_dir (layout));
+  pango_layout_set_single_paragraph_mode (copy, pango_layout_get_single_paragraph_mode (layout));
+  tabs = pango_layout_get_tabs (layout);
+  if (tabs)
+    {
+      pango_layout_set_tabs (copy, tabs);
+      pango_tab_array_free (tabs);
+    }
+
+  return copy;
+}
+
+/*
+ * gtk_pango_layout_cache_lookup:
+ * @layout: a #PangoLayout that has not been laid out yet
+ *
+ * Looks for a cached layout that is equivalent to @layout, and adds
+ * one if there is none. Only layouts for short texts that are not
+ * given a width are cached.
+ *
+ * The returned layout is shared and must not be modified.
+ *
+ * Returns: (transfer full) (nullable): a cached layout equivalent
+ *   to @layout, or %NULL if @layout can't be cached
+ */
+PangoLayout *
+gtk_pango_layout_cache_lookup (PangoLayout *layout)
+{
+  PangoLayout *cached;
+  GList *link;
+
+  if (pango_layout_get_width (layout) != -1 ||
+      strlen (pango_layout_get_text (layout)) > LAYOUT_CACHE_MAX_TEXT_LEN)
+    return NULL;
+
+  if (layout_cache == NULL)
+    {
+      layout_cache = g_hash_table_new (layout_hash, layout_equal);
+      hits_counter = gdk_profiler_define_int_counter ("shared-layout-hits", "Shared Layout Cache Hits");
+      misses_counter = gdk_profiler_define_int_counter ("shared-layout-misses", "Shared Layout Cache Misses");
+    }
+
+  link = g_hash_table_lookup (layout_cache, layout);
+  if (link)
+    {
+      g_queue_unlink (&layout_lru, link);
+      g_queue_push_head_link (&layout_lru, link);
+      cached = link->data;
+      layout_cache_hits++;
+    }
+  else
+    {
+      cached = copy_pango_layout (layout);
+      g_queue_push_head (&layout_lru, cached);
+      g_hash_table_insert (layout_cache, cached, layout_lru.head);
+      layout_cache_misses++;
+
+      while (layout_lru.length > LAYOUT_CACHE_SIZE)
+        {
+          PangoLayout *evicted = g_queue_pop_tail (&layout_lru);
+
+          g_hash_table_remove (layout_cache, evicted);
+          g_object_unref (evicted);
+        }
+    }
+
+  if (GDK_PROFILER_IS_RUNNING)
+    {
+      gdk_profiler_set_int_counter (hits_counter, layout_cache_hits);
+      gdk_profiler_set_int_counter (misses_counter, layout_cache_misses);
+    }
+
+  return g_object_ref (cached);
+}
+
 static PangoAttribute *
 attribute_from_text (GtkBuilder  *builder,
                      const char  *name,
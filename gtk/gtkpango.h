@@ -33,6 +33,13 @@ G_BEGIN_DECLS
 PangoAttrList *_gtk_pango_attr_list_merge (PangoAttrList *into,
                                            PangoAttrList *from);
 
+gboolean       gtk_pango_context_equivalent   (PangoContext  *a,
+                                               PangoContext  *b);
+gboolean       gtk_pango_layout_equivalent    (PangoLayout   *a,
+                                               PangoLayout   *b);
+
+PangoLayout *  gtk_pango_layout_cache_lookup  (PangoLayout   *layout);
+
 gboolean gtk_buildable_attribute_tag_start (GtkBuildable       *buildable,
                                             GtkBuilder         *builder,
                                             GObject            *child,
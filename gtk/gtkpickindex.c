@@ -0,0 +1,293 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkpickindexprivate.h"
+
+#include "gtkwidgetprivate.h"
+
+#include <math.h>
+
+/* A uniform grid over the bounds of the children of a widget, so that
+ * picking only looks at the children near the point instead of all of
+ * them.
+ *
+ * Cells are kept in a hash table, so the grid doesn't need to know the
+ * size of the widget. Children that cover too many cells go into a list
+ * that is always checked.
+ */
+
+#define CELL_SIZE 128
+#define MAX_CELLS 64
+
+typedef struct {
+  GtkWidget *child;
+  graphene_rect_t bounds;
+  int x0, y0, x1, y1; /* covered cells, inclusive */
+  guint large : 1;
+  guint order;
+} GtkPickIndexEntry;
+
+struct _GtkPickIndex
+{
+  GHashTable *entries; /* GtkWidget => GtkPickIndexEntry */
+  GHashTable *cells;   /* cell key => GPtrArray of GtkPickIndexEntry */
+  GPtrArray *large;
+  guint order_dirty : 1;
+};
+
+static inline gpointer
+cell_key (int x,
+          int y)
+{
+  /* Collisions only cost a few extra bounds checks */
+  return GUINT_TO_POINTER (((guint) x & 0xffff) | ((guint) y << 16));
+}
+
+static inline int
+cell_coord (double value)
+{
+  return (int) floor (value / CELL_SIZE);
+}
+
+GtkPickIndex *
+gtk_pick_index_new (void)
+{
+  GtkPickIndex *self;
+
+  self = g_new0 (GtkPickIndex, 1);
+  self->entries = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  self->cells = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+  self->large = g_ptr_array_new ();
+
+  return self;
+}
+
+void
+gtk_pick_index_free (GtkPickIndex *self)
+{
+  g_hash_table_unref (self->cells);
+  g_hash_table_unref (self->entries);
+  g_ptr_array_unref (self->large);
+  g_free (self);
+}
+
+static void
+gtk_pick_index_link (GtkPickIndex      *self,
+                     GtkPickIndexEntry *entry)
+{
+  const graphene_rect_t *r = &entry->bounds;
+  int x, y;
+
+  if (!isfinite (r->origin.x) || !isfinite (r->origin.y) ||
+      !isfinite (r->size.width) || !isfinite (r->size.height) ||
+      (floor ((r->origin.x + r->size.width) / CELL_SIZE) - floor (r->origin.x / CELL_SIZE) + 1) *
+      (floor ((r->origin.y + r->size.height) / CELL_SIZE) - floor (r->origin.y / CELL_SIZE) + 1) > MAX_CELLS)
+    {
+      entry->large = TRUE;
+      g_ptr_array_add (self->large, entry);
+      return;
+    }
+
+  entry->large = FALSE;
+  entry->x0 = cell_coord (r->origin.x);
+  entry->y0 = cell_coord (r->origin.y);
+  entry->x1 = cell_coord (r->origin.x + r->size.width);
+  entry->y1 = cell_coord (r->origin.y + r->size.height);
+
+  for (y = entry->y0; y <= entry->y1; y++)
+    for (x = entry->x0; x <= entry->x1; x++)
+      {
+        GPtrArray *cell = g_hash_table_lookup (self->cells, cell_key (x, y));
+
+        if (cell == NULL)
+          {
+            cell = g_ptr_array_new ();
+            g_hash_table_insert (self->cells, cell_key (x, y), cell);
+          }
+
+        g_ptr_array_add (cell, entry);
+      }
+}
+
+static void
+gtk_pick_index_unlink (GtkPickIndex      *self,
+                       GtkPickIndexEntry *entry)
+{
+  int x, y;
+
+  if (entry->large)
+    {
+      g_ptr_array_remove_fast (self->large, entry);
+      return;
+    }
+
+  for (y = entry->y0; y <= entry->y1; y++)
+    for (x = entry->x0; x <= entry->x1; x++)
+      {
+        GPtrArray *cell = g_hash_table_lookup (self->cells, cell_key (x, y));
+
+        g_ptr_array_remove_fast (cell, entry);
+        if (cell->len == 0)
+          g_hash_table_remove (self->cells, cell_key (x, y));
+      }
+}
+
+/* Called whenever @child got allocated, with its bounds in the
+ * coordinates of the indexed widget.
+ */
+void
+gtk_pick_index_update (GtkPickIndex          *self,
+                       GtkWidget             *child,
+                       const graphene_rect_t *bounds)
+{
+  GtkPickIndexEntry *entry;
+
+  entry = g_hash_table_lookup (self->entries, child);
+  if (entry == NULL)
+    {
+      entry = g_new0 (GtkPickIndexEntry, 1);
+      entry->child = child;
+      g_hash_table_insert (self->entries, child, entry);
+      self->order_dirty = TRUE;
+    }
+  else
+    {
+      if (graphene_rect_equal (&entry->bounds, bounds))
+        return;
+
+      gtk_pick_index_unlink (self, entry);
+    }
+
+  entry->bounds = *bounds;
+  gtk_pick_index_link (self, entry);
+}
+
+void
+gtk_pick_index_remove (GtkPickIndex *self,
+                       GtkWidget    *child)
+{
+  GtkPickIndexEntry *entry;
+
+  entry = g_hash_table_lookup (self->entries, child);
+  if (entry == NULL)
+    return;
+
+  gtk_pick_index_unlink (self, entry);
+  g_hash_table_remove (self->entries, child);
+}
+
+/* Called when the children changed their stacking order */
+void
+gtk_pick_index_reorder (GtkPickIndex *self)
+{
+  self->order_dirty = TRUE;
+}
+
+static int
+compare_entries (gconstpointer a,
+                 gconstpointer b)
+{
+  const GtkPickIndexEntry *entry_a = *(const GtkPickIndexEntry **) a;
+  const GtkPickIndexEntry *entry_b = *(const GtkPickIndexEntry **) b;
+
+  /* topmost first */
+  if (entry_a->order == entry_b->order)
+    return 0;
+
+  return entry_a->order < entry_b->order ? 1 : -1;
+}
+
+static void
+add_candidates (GPtrArray       *candidates,
+                GPtrArray       *entries,
+                const graphene_point_t *p)
+{
+  guint i;
+
+  for (i = 0; i < entries->len; i++)
+    {
+      GtkPickIndexEntry *entry = g_ptr_array_index (entries, i);
+
+      if (graphene_rect_contains_point (&entry->bounds, p))
+        g_ptr_array_add (candidates, entry);
+    }
+}
+
+/*
+ * gtk_pick_index_query:
+ * @self: the index
+ * @parent: the widget that @self indexes
+ * @x: X coordinate in @parent's coordinates
+ * @y: Y coordinate in @parent's coordinates
+ * @children: array to add the children to
+ *
+ * Adds the children of @parent whose bounds contain the point
+ * to @children, in the order they need to be picked.
+ */
+void
+gtk_pick_index_query (GtkPickIndex *self,
+                      GtkWidget    *parent,
+                      double        x,
+                      double        y,
+                      GPtrArray    *children)
+{
+  graphene_point_t p = GRAPHENE_POINT_INIT (x, y);
+  GPtrArray *cell;
+  guint i, first;
+
+  if (self->order_dirty)
+    {
+      GtkWidget *child;
+      guint order = 0;
+
+      for (child = _gtk_widget_get_first_child (parent);
+           child;
+           child = _gtk_widget_get_next_sibling (child))
+        {
+          GtkPickIndexEntry *entry = g_hash_table_lookup (self->entries, child);
+
+          if (entry)
+            entry->order = order;
+
+          order++;
+        }
+
+      self->order_dirty = FALSE;
+    }
+
+  first = children->len;
+
+  cell = g_hash_table_lookup (self->cells, cell_key (cell_coord (x), cell_coord (y)));
+  if (cell)
+    add_candidates (children, cell, &p);
+  add_candidates (children, self->large, &p);
+
+  g_qsort_with_data (children->pdata + first,
+                     children->len - first,
+                     sizeof (gpointer),
+                     (GCompareDataFunc) compare_entries,
+                     NULL);
+
+  for (i = first; i < children->len; i++)
+    {
+      GtkPickIndexEntry *entry = g_ptr_array_index (children, i);
+
+      g_ptr_array_index (children, i) = entry->child;
+    }
+}
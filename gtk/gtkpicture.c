@@ -30,6 +30,8 @@
 #include "gtksnapshot.h"
 #include "gtkwidgetprivate.h"
 
+#include "gdk/gdktextureprivate.h"
+
 /**
  * SECTION:gtkpicture
  * @Short_description: A widget displaying a #GdkPaintable
@@ -83,9 +85,17 @@ struct _GtkPicture
   GdkPaintable *paintable;
   GFile *file;
 
+  /* State of loading the image from @file */
+  GCancellable *load_cancellable;
+  int original_width;
+  int original_height;
+  double loaded_scale;
+
   char *alternative_text;
   guint keep_aspect_ratio : 1;
   guint can_shrink : 1;
+  guint paintable_from_file : 1;
+  guint file_scalable : 1;
 };
 
 struct _GtkPictureClass
@@ -97,6 +107,13 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 G_DEFINE_TYPE (GtkPicture, gtk_picture, GTK_TYPE_WIDGET)
 
+static void gtk_picture_update_paintable (GtkPicture   *self,
+                                          GdkPaintable *paintable);
+static void gtk_picture_size_allocate    (GtkWidget    *widget,
+                                          int           width,
+                                          int           height,
+                                          int           baseline);
+
 static void
 gtk_picture_snapshot (GtkWidget   *widget,
                       GtkSnapshot *snapshot)
@@ -304,6 +321,7 @@ gtk_picture_class_init (GtkPictureClass *class)
   widget_class->snapshot = gtk_picture_snapshot;
   widget_class->get_request_mode = gtk_picture_get_request_mode;
   widget_class->measure = gtk_picture_measure;
+  widget_class->size_allocate = gtk_picture_size_allocate;
 
   /**
    * GtkPicture:paintable:
@@ -542,75 +560,131 @@ gtk_picture_new_for_resource (const char *resource_path)
   return result;
 }
 
-typedef struct {
-  int scale_factor;
-} LoaderData;
-
 static void
-on_loader_size_prepared (GdkPixbufLoader *loader,
-			 int              width,
-			 int              height,
-			 gpointer         user_data)
+gtk_picture_cancel_load (GtkPicture *self)
 {
-  LoaderData *loader_data = user_data;
-  GdkPixbufFormat *format;
+  if (self->load_cancellable)
+    {
+      g_cancellable_cancel (self->load_cancellable);
+      g_clear_object (&self->load_cancellable);
+    }
+}
 
-  /* Let the regular icon helper code path handle non-scalable pictures */
-  format = gdk_pixbuf_loader_get_format (loader);
-  if (!gdk_pixbuf_format_is_scalable (format))
+static void
+gtk_picture_file_loaded (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      data)
+{
+  GtkPicture *self = data;
+  GdkTexture *texture;
+  GdkPaintable *paintable;
+  int original_width, original_height;
+  gboolean scalable;
+  GError *error = NULL;
+
+  texture = gdk_texture_new_from_file_finish_full (result,
+                                                   &original_width,
+                                                   &original_height,
+                                                   &scalable,
+                                                   &error);
+  if (texture == NULL)
     {
-      loader_data->scale_factor = 1;
+      /* A newer load or the paintable replaced this one */
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_clear_object (&self->load_cancellable);
+          gtk_picture_update_paintable (self, NULL);
+        }
+
+      g_error_free (error);
+      g_object_unref (self);
       return;
     }
 
-  gdk_pixbuf_loader_set_size (loader,
-                              width * loader_data->scale_factor,
-                              height * loader_data->scale_factor);
+  g_clear_object (&self->load_cancellable);
+
+  self->original_width = original_width;
+  self->original_height = original_height;
+  self->file_scalable = scalable;
+
+  if (original_width > 0 && gdk_texture_get_width (texture) != original_width)
+    {
+      /* Keep the size of the image in the file as the intrinsic size,
+       * no matter at which size it was loaded.
+       */
+      self->loaded_scale = (double) gdk_texture_get_width (texture) / original_width;
+      paintable = gtk_scaler_new (GDK_PAINTABLE (texture), self->loaded_scale);
+    }
+  else
+    {
+      self->loaded_scale = 1.0;
+      paintable = g_object_ref (GDK_PAINTABLE (texture));
+    }
+
+  self->paintable_from_file = TRUE;
+  gtk_picture_update_paintable (self, paintable);
+
+  g_object_unref (paintable);
+  g_object_unref (texture);
+  g_object_unref (self);
 }
 
-static GdkPaintable *
-load_scalable_with_loader (GFile *file,
-                           int    scale_factor)
+/* Loads the file in a thread, at a size fitting into width x height
+ * device pixels. The current paintable stays until the load is done.
+ */
+static void
+gtk_picture_load_file (GtkPicture *self,
+                       int         width,
+                       int         height)
 {
-  GdkPixbufLoader *loader;
-  GBytes *bytes;
-  GdkPixbufAnimation *animation;
-  GdkPaintable *result, *scaler;
-  LoaderData loader_data;
-
-  result = NULL;
+  gtk_picture_cancel_load (self);
 
-  loader = gdk_pixbuf_loader_new ();
-  loader_data.scale_factor = scale_factor;
+  self->load_cancellable = g_cancellable_new ();
 
-  g_signal_connect (loader, "size-prepared", G_CALLBACK (on_loader_size_prepared), &loader_data);
+  gdk_texture_new_from_file_async (self->file,
+                                   width, height,
+                                   self->load_cancellable,
+                                   gtk_picture_file_loaded,
+                                   g_object_ref (self));
+}
 
-  bytes = g_file_load_bytes (file, NULL, NULL, NULL);
-  if (bytes == NULL)
-    goto out1;
+static void
+gtk_picture_size_allocate (GtkWidget *widget,
+                           int        width,
+                           int        height,
+                           int        baseline)
+{
+  GtkPicture *self = GTK_PICTURE (widget);
+  double x_scale, y_scale, needed_scale;
 
-  if (!gdk_pixbuf_loader_write_bytes (loader, bytes, NULL))
-    goto out2;
+  if (!self->paintable_from_file ||
+      self->load_cancellable != NULL ||
+      self->original_width <= 0 || self->original_height <= 0 ||
+      width <= 0 || height <= 0)
+    return;
 
-  if (!gdk_pixbuf_loader_close (loader, NULL))
-    goto out2;
+  x_scale = (double) width / self->original_width;
+  y_scale = (double) height / self->original_height;
 
-  animation = gdk_pixbuf_loader_get_animation (loader);
-  if (animation == NULL)
-    goto out2;
+  if (self->keep_aspect_ratio)
+    needed_scale = MIN (x_scale, y_scale);
+  else
+    needed_scale = MAX (x_scale, y_scale);
 
-  result = GDK_PAINTABLE (gdk_texture_new_for_pixbuf (gdk_pixbuf_animation_get_static_image (animation)));
-  scaler = gtk_scaler_new (result, loader_data.scale_factor);
-  g_object_unref (result);
-  result = scaler;
+  needed_scale *= gtk_widget_get_scale_factor (widget);
 
-out2:
-  g_bytes_unref (bytes);
-out1:
-  gdk_pixbuf_loader_close (loader, NULL);
-  g_object_unref (loader);
+  if (!self->file_scalable)
+    needed_scale = MIN (needed_scale, 1.0);
 
-  return result;
+  /* Reload when the image got a lot smaller, to save memory, or when
+   * it got bigger and the loaded image has too little detail.
+   */
+  if (needed_scale < self->loaded_scale / 2 ||
+      (needed_scale > self->loaded_scale * 1.25 &&
+       (self->loaded_scale < 1.0 || self->file_scalable)))
+    gtk_picture_load_file (self,
+                           ceil (self->original_width * needed_scale),
+                           ceil (self->original_height * needed_scale));
 }
 
 /**
@@ -620,14 +694,16 @@ out1:
  *
  * Makes @self load and display @file.
  *
+ * The file is loaded in a thread, so @self stays empty until
+ * loading is done. The image is loaded at the size it is displayed
+ * at, and reloaded when that size changes a lot.
+ *
  * See gtk_picture_new_for_file() for details.
  **/
 void
 gtk_picture_set_file (GtkPicture *self,
                       GFile      *file)
 {
-  GdkPaintable *paintable;
-
   g_return_if_fail (GTK_IS_PICTURE (self));
   g_return_if_fail (file == NULL || G_IS_FILE (file));
 
@@ -639,9 +715,20 @@ gtk_picture_set_file (GtkPicture *self,
   g_set_object (&self->file, file);
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_FILE]);
 
-  paintable = load_scalable_with_loader (file, gtk_widget_get_scale_factor (GTK_WIDGET (self)));
-  gtk_picture_set_paintable (self, paintable);
-  g_clear_object (&paintable);
+  gtk_picture_set_paintable (self, NULL);
+
+  if (file)
+    {
+      GtkWidget *widget = GTK_WIDGET (self);
+      int scale = gtk_widget_get_scale_factor (widget);
+
+      if (gtk_widget_get_width (widget) > 0 && gtk_widget_get_height (widget) > 0)
+        gtk_picture_load_file (self,
+                               gtk_widget_get_width (widget) * scale,
+                               gtk_widget_get_height (widget) * scale);
+      else
+        gtk_picture_load_file (self, -1, -1);
+    }
 
   g_object_thaw_notify (G_OBJECT (self));
 }
@@ -776,23 +863,10 @@ gtk_picture_paintable_invalidate_size (GdkPaintable *paintable,
   gtk_widget_queue_resize (GTK_WIDGET (self));
 }
 
-/**
- * gtk_picture_set_paintable:
- * @self: a #GtkPicture
- * @paintable: (nullable): a #GdkPaintable or %NULL
- *
- * Makes @self display the given @paintable. If @paintable is %NULL,
- * nothing will be displayed.
- *
- * See gtk_picture_new_for_paintable() for details.
- **/
-void
-gtk_picture_set_paintable (GtkPicture   *self,
-                           GdkPaintable *paintable)
+static void
+gtk_picture_update_paintable (GtkPicture   *self,
+                              GdkPaintable *paintable)
 {
-  g_return_if_fail (GTK_IS_PICTURE (self));
-  g_return_if_fail (paintable == NULL || GDK_IS_PAINTABLE (paintable));
-
   if (self->paintable == paintable)
     return;
 
@@ -844,6 +918,29 @@ gtk_picture_set_paintable (GtkPicture   *self,
   g_object_thaw_notify (G_OBJECT (self));
 }
 
+/**
+ * gtk_picture_set_paintable:
+ * @self: a #GtkPicture
+ * @paintable: (nullable): a #GdkPaintable or %NULL
+ *
+ * Makes @self display the given @paintable. If @paintable is %NULL,
+ * nothing will be displayed.
+ *
+ * See gtk_picture_new_for_paintable() for details.
+ **/
+void
+gtk_picture_set_paintable (GtkPicture   *self,
+                           GdkPaintable *paintable)
+{
+  g_return_if_fail (GTK_IS_PICTURE (self));
+  g_return_if_fail (paintable == NULL || GDK_IS_PAINTABLE (paintable));
+
+  gtk_picture_cancel_load (self);
+  self->paintable_from_file = FALSE;
+
+  gtk_picture_update_paintable (self, paintable);
+}
+
 /**
  * gtk_picture_get_paintable:
  * @self: a #GtkPicture
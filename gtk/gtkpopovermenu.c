@@ -136,6 +136,8 @@ struct _GtkPopoverMenu
   GtkWidget *parent_menu;
   GMenuModel *model;
   GtkPopoverMenuFlags flags;
+  gboolean needs_populate;
+  guint prewarm_id;
 };
 
 struct _GtkPopoverMenuClass
@@ -310,10 +312,20 @@ gtk_popover_menu_dispose (GObject *object)
     }
 
   g_clear_object (&popover->model);
+  g_clear_handle_id (&popover->prewarm_id, g_source_remove);
 
   G_OBJECT_CLASS (gtk_popover_menu_parent_class)->dispose (object);
 }
 
+static void
+gtk_popover_menu_show (GtkWidget *widget)
+{
+  /* Submenus are populated here, before the popover is sized */
+  gtk_popover_menu_populate (GTK_POPOVER_MENU (widget));
+
+  GTK_WIDGET_CLASS (gtk_popover_menu_parent_class)->show (widget);
+}
+
 static void
 gtk_popover_menu_map (GtkWidget *widget)
 {
@@ -504,6 +516,7 @@ gtk_popover_menu_class_init (GtkPopoverMenuClass *klass)
   object_class->set_property = gtk_popover_menu_set_property;
   object_class->get_property = gtk_popover_menu_get_property;
 
+  widget_class->show = gtk_popover_menu_show;
   widget_class->map = gtk_popover_menu_map;
   widget_class->unmap = gtk_popover_menu_unmap;
   widget_class->focus = gtk_popover_menu_focus;
@@ -689,6 +702,8 @@ gtk_popover_menu_set_menu_model (GtkPopoverMenu *popover,
       GtkWidget *stack;
       GtkWidget *child;
 
+      popover->needs_populate = FALSE;
+
       stack = gtk_popover_get_child (GTK_POPOVER (popover));
       while ((child = gtk_widget_get_first_child (stack)))
         gtk_stack_remove (GTK_STACK (stack), child);
@@ -715,3 +730,84 @@ gtk_popover_menu_get_menu_model (GtkPopoverMenu *popover)
 
   return popover->model;
 }
+
+/*<private>
+ * gtk_popover_menu_new_submenu:
+ * @model: a #GMenuModel
+ * @flags: flags that affect how the menu is created
+ *
+ * Creates a #GtkPopoverMenu for a submenu. Unlike with
+ * gtk_popover_menu_new_from_model_full(), its contents are
+ * only created when it is first shown, or prewarmed.
+ *
+ * Returns: (transfer full): the new #GtkPopoverMenu
+ */
+GtkWidget *
+gtk_popover_menu_new_submenu (GMenuModel          *model,
+                              GtkPopoverMenuFlags  flags)
+{
+  GtkPopoverMenu *popover;
+
+  popover = GTK_POPOVER_MENU (gtk_popover_menu_new ());
+  popover->flags = flags;
+  popover->model = g_object_ref (model);
+  popover->needs_populate = TRUE;
+
+  return GTK_WIDGET (popover);
+}
+
+/*<private>
+ * gtk_popover_menu_populate:
+ * @popover: a #GtkPopoverMenu
+ *
+ * Creates the contents of a popover that was created with
+ * gtk_popover_menu_new_submenu(), if that did not happen yet.
+ */
+void
+gtk_popover_menu_populate (GtkPopoverMenu *popover)
+{
+  if (!popover->needs_populate)
+    return;
+
+  popover->needs_populate = FALSE;
+  gtk_menu_section_box_new_toplevel (popover, popover->model, popover->flags);
+}
+
+static gboolean
+gtk_popover_menu_prewarm_cb (gpointer data)
+{
+  GtkPopoverMenu *popover = data;
+
+  popover->prewarm_id = 0;
+
+  gtk_popover_menu_populate (popover);
+  gtk_menu_section_box_populate_submenus (popover);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * gtk_popover_menu_prewarm:
+ * @popover: a #GtkPopoverMenu
+ *
+ * Creates the submenus directly below the main menu of @popover
+ * once the main loop is idle.
+ *
+ * Submenus are normally only created when they are first shown.
+ * For menus with large submenus, this can be used to avoid that
+ * work when the user opens them.
+ */
+void
+gtk_popover_menu_prewarm (GtkPopoverMenu *popover)
+{
+  g_return_if_fail (GTK_IS_POPOVER_MENU (popover));
+
+  if (popover->prewarm_id != 0)
+    return;
+
+  popover->prewarm_id = g_idle_add_full (G_PRIORITY_LOW,
+                                         gtk_popover_menu_prewarm_cb,
+                                         popover,
+                                         NULL);
+  g_source_set_name_by_id (popover->prewarm_id, "[gtk] gtk_popover_menu_prewarm_cb");
+}
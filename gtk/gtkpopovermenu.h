@@ -61,6 +61,9 @@ void        gtk_popover_menu_set_menu_model (GtkPopoverMenu *popover,
 GDK_AVAILABLE_IN_ALL
 GMenuModel *gtk_popover_menu_get_menu_model (GtkPopoverMenu *popover);
 
+GDK_AVAILABLE_IN_ALL
+void        gtk_popover_menu_prewarm        (GtkPopoverMenu *popover);
+
 
 G_END_DECLS
 
@@ -33,6 +33,9 @@ void       gtk_popover_menu_set_parent_menu  (GtkPopoverMenu *menu,
                                               GtkWidget      *parent);
 
 GtkWidget * gtk_popover_menu_new (void);
+GtkWidget * gtk_popover_menu_new_submenu (GMenuModel          *model,
+                                          GtkPopoverMenuFlags  flags);
+void        gtk_popover_menu_populate    (GtkPopoverMenu      *popover);
 
 void  gtk_popover_menu_add_submenu (GtkPopoverMenu *popover,
                                     GtkWidget      *submenu,
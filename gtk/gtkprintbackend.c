@@ -27,6 +27,7 @@
 #include "gtkmarshalers.h"
 #include "gtkprivate.h"
 #include "gtkprintbackendprivate.h"
+#include "gdk/gdkprofilerprivate.h"
 
 
 static void gtk_print_backend_finalize     (GObject      *object);
@@ -83,10 +84,19 @@ gtk_print_backend_error_quark (void)
 void
 gtk_print_backends_init (void)
 {
+  static gboolean initialized = FALSE;
   GIOExtensionPoint *ep;
   GIOModuleScope *scope;
   char **paths;
   int i;
+  gint64 before;
+
+  if (initialized)
+    return;
+
+  initialized = TRUE;
+
+  before = GDK_PROFILER_CURRENT_TIME;
 
   GTK_NOTE (MODULES,
             g_print ("Registering extension point %s\n", GTK_PRINT_BACKEND_EXTENSION_POINT_NAME));
@@ -120,6 +130,8 @@ gtk_print_backends_init (void)
                    g_type_name (g_io_extension_get_type (ext)));
         }
     }
+
+  gdk_profiler_end_mark (before, "print backends init", NULL);
 }
 
 /**
@@ -140,6 +152,8 @@ gtk_print_backend_load_modules (void)
 
   result = NULL;
 
+  gtk_print_backends_init ();
+
   ep = g_io_extension_point_lookup (GTK_PRINT_BACKEND_EXTENSION_POINT_NAME);
 
   settings = gtk_settings_get_default ();
@@ -58,6 +58,10 @@ struct _GtkPrintOperationPrivate
 
   GtkPageDrawingState      page_drawing_state;
 
+  GtkPrintOperationDrawPageFunc draw_page_func;
+  gpointer draw_page_data;
+  GDestroyNotify draw_page_destroy;
+
   guint print_pages_idle_id;
   guint show_progress_timeout_id;
 
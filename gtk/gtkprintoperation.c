@@ -151,7 +151,8 @@ typedef struct _PrintPagesData PrintPagesData;
 static void          preview_iface_init      (GtkPrintOperationPreviewIface *iface);
 static GtkPageSetup *create_page_setup       (GtkPrintOperation             *op);
 static void          common_render_page      (GtkPrintOperation             *op,
-					      int                            page_nr);
+					      int                            page_nr,
+					      cairo_surface_t               *recording);
 static void          increment_page_sequence (PrintPagesData *data);
 static void          prepare_data            (PrintPagesData *data);
 static void          clamp_page_ranges       (PrintPagesData *data);
@@ -213,6 +214,9 @@ gtk_print_operation_finalize (GObject *object)
 
   if (priv->error)
     g_error_free (priv->error);
+
+  if (priv->draw_page_destroy)
+    priv->draw_page_destroy (priv->draw_page_data);
   
   G_OBJECT_CLASS (gtk_print_operation_parent_class)->finalize (object);
 }
@@ -264,7 +268,7 @@ preview_iface_render_page (GtkPrintOperationPreview *preview,
   GtkPrintOperation *op;
 
   op = GTK_PRINT_OPERATION (preview);
-  common_render_page (op, page_nr);
+  common_render_page (op, page_nr, NULL);
 }
 
 static void
@@ -520,8 +524,21 @@ struct _PrintPagesData
   gboolean initialized;
   gboolean is_preview;
   gboolean done;
+
+  /* Pages drawn by the draw-page function, in print order */
+  GThreadPool *pool;
+  GQueue jobs;
+  GMutex lock;
+  GCond cond;
 };
 
+typedef struct
+{
+  int page;
+  int page_position;
+  cairo_surface_t *recording; /* set once the page is drawn */
+} PageJob;
+
 typedef struct
 {
   GtkPrintOperationPreview *preview;
@@ -2186,6 +2203,13 @@ increment_page_sequence (PrintPagesData *data)
   data->total++;
 }
 
+static void
+free_page_job (PageJob *job)
+{
+  g_clear_pointer (&job->recording, cairo_surface_destroy);
+  g_free (job);
+}
+
 static void
 print_pages_idle_done (gpointer user_data)
 {
@@ -2205,6 +2229,15 @@ print_pages_idle_done (gpointer user_data)
   if (data->progress)
     gtk_window_destroy (GTK_WINDOW (data->progress));
 
+  if (data->pool)
+    {
+      /* Drops the pages that weren't started yet */
+      g_thread_pool_free (data->pool, TRUE, TRUE);
+      g_queue_clear_full (&data->jobs, (GDestroyNotify) free_page_job);
+      g_mutex_clear (&data->lock);
+      g_cond_clear (&data->cond);
+    }
+
   if (priv->rloop && !data->is_preview) 
     g_main_loop_quit (priv->rloop);
 
@@ -2273,6 +2306,47 @@ gtk_print_operation_set_defer_drawing (GtkPrintOperation *op)
   priv->page_drawing_state = GTK_PAGE_DRAWING_STATE_DEFERRED_DRAWING;
 }
 
+/**
+ * gtk_print_operation_set_draw_page_func:
+ * @op: a #GtkPrintOperation
+ * @func: (nullable): the function to draw pages with
+ * @user_data: (closure): user data for @func
+ * @destroy: destroy notify for @user_data
+ *
+ * Sets a function to draw pages with, instead of emitting the
+ * #GtkPrintOperation::draw-page signal.
+ *
+ * When printing, @func is called on worker threads, for several
+ * pages at the same time and ahead of the page that is being
+ * printed. The pages are recorded and sent to the printer in order.
+ * This is useful for long documents, where drawing the pages one
+ * after another takes a long time.
+ *
+ * @func must not use GTK or the print context of @op. The
+ * units of @cr are the same as in a #GtkPrintOperation::draw-page
+ * handler, so the size of the page should be taken from the print
+ * context in a #GtkPrintOperation::begin-print handler. For a print
+ * preview, @func is called on the main thread.
+ **/
+void
+gtk_print_operation_set_draw_page_func (GtkPrintOperation             *op,
+                                        GtkPrintOperationDrawPageFunc  func,
+                                        gpointer                       user_data,
+                                        GDestroyNotify                 destroy)
+{
+  GtkPrintOperationPrivate *priv = gtk_print_operation_get_instance_private (op);
+
+  g_return_if_fail (GTK_IS_PRINT_OPERATION (op));
+  g_return_if_fail (priv->print_pages_idle_id == 0);
+
+  if (priv->draw_page_destroy)
+    priv->draw_page_destroy (priv->draw_page_data);
+
+  priv->draw_page_func = func;
+  priv->draw_page_data = user_data;
+  priv->draw_page_destroy = destroy;
+}
+
 /**
  * gtk_print_operation_set_embed_page_setup:
  * @op: a #GtkPrintOperation
@@ -2351,7 +2425,8 @@ gtk_print_operation_draw_page_finish (GtkPrintOperation *op)
 
 static void
 common_render_page (GtkPrintOperation *op,
-		    int                page_nr)
+		    int                page_nr,
+		    cairo_surface_t   *recording)
 {
   GtkPrintOperationPrivate *priv = gtk_print_operation_get_instance_private (op);
   GtkPageSetup *page_setup;
@@ -2569,8 +2644,16 @@ common_render_page (GtkPrintOperation *op,
   
   priv->page_drawing_state = GTK_PAGE_DRAWING_STATE_DRAWING;
 
-  g_signal_emit (op, signals[DRAW_PAGE], 0, 
-		 print_context, page_nr);
+  if (recording)
+    {
+      cairo_set_source_surface (cr, recording, 0, 0);
+      cairo_paint (cr);
+    }
+  else if (priv->draw_page_func)
+    priv->draw_page_func (op, cr, page_nr, priv->draw_page_data);
+  else
+    g_signal_emit (op, signals[DRAW_PAGE], 0, 
+		   print_context, page_nr);
 
   if (priv->page_drawing_state == GTK_PAGE_DRAWING_STATE_DRAWING)
     gtk_print_operation_draw_page_finish (op);
@@ -2743,6 +2826,104 @@ prepare_data (PrintPagesData *data)
                                    NULL);
 }
 
+/* With a draw-page function, pages are drawn on worker threads
+ * into recording surfaces, ahead of the page that is printed. They
+ * are replayed on the print context in order, so only a few pages
+ * are kept in memory at any time.
+ */
+static void
+draw_page_thread (gpointer job_data,
+                  gpointer user_data)
+{
+  PageJob *job = job_data;
+  PrintPagesData *data = user_data;
+  GtkPrintOperationPrivate *priv = gtk_print_operation_get_instance_private (data->op);
+  cairo_surface_t *recording;
+  cairo_t *cr;
+
+  recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, NULL);
+  cr = cairo_create (recording);
+  priv->draw_page_func (data->op, cr, job->page, priv->draw_page_data);
+  cairo_destroy (cr);
+
+  g_mutex_lock (&data->lock);
+  job->recording = recording;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+queue_page_jobs (PrintPagesData *data)
+{
+  GtkPrintOperationPrivate *priv = gtk_print_operation_get_instance_private (data->op);
+  guint n_threads = g_get_num_processors ();
+
+  if (data->pool == NULL)
+    {
+      g_mutex_init (&data->lock);
+      g_cond_init (&data->cond);
+      data->pool = g_thread_pool_new (draw_page_thread, data, n_threads, FALSE, NULL);
+    }
+
+  while (!data->done && data->jobs.length < 2 * n_threads)
+    {
+      PageJob *job;
+
+      increment_page_sequence (data);
+      if (data->done)
+        break;
+
+      job = g_new0 (PageJob, 1);
+      job->page = data->page;
+      job->page_position = priv->page_position;
+      g_queue_push_tail (&data->jobs, job);
+      g_thread_pool_push (data->pool, job, NULL);
+    }
+}
+
+/* Returns TRUE when all pages have been printed */
+static gboolean
+print_next_page_job (PrintPagesData *data)
+{
+  GtkPrintOperationPrivate *priv = gtk_print_operation_get_instance_private (data->op);
+  cairo_surface_t *recording;
+  PageJob *job;
+  int position;
+
+  queue_page_jobs (data);
+
+  job = g_queue_peek_head (&data->jobs);
+  if (job == NULL)
+    return TRUE;
+
+  /* Don't spin while the page is being drawn, but keep
+   * the main loop responsive.
+   */
+  g_mutex_lock (&data->lock);
+  if (job->recording == NULL)
+    g_cond_wait_until (&data->cond, &data->lock,
+                       g_get_monotonic_time () + 10 * G_TIME_SPAN_MILLISECOND);
+  recording = job->recording;
+  g_mutex_unlock (&data->lock);
+
+  if (recording == NULL)
+    return FALSE;
+
+  g_queue_pop_head (&data->jobs);
+
+  /* The page sequence has moved ahead, but the number-up
+   * layout needs the position of this page.
+   */
+  position = priv->page_position;
+  priv->page_position = job->page_position;
+  common_render_page (data->op, job->page, recording);
+  priv->page_position = position;
+
+  free_page_job (job);
+
+  return FALSE;
+}
+
 static gboolean
 print_pages_idle (gpointer user_data)
 {
@@ -2766,10 +2947,16 @@ print_pages_idle (gpointer user_data)
           goto out;
         }
 
+      if (priv->draw_page_func)
+        {
+          done = print_next_page_job (data);
+          goto out;
+        }
+
       increment_page_sequence (data);
 
       if (!data->done)
-        common_render_page (data->op, data->page);
+        common_render_page (data->op, data->page, NULL);
       else
         done = priv->page_drawing_state == GTK_PAGE_DRAWING_STATE_READY;
 
@@ -282,6 +282,30 @@ GDK_AVAILABLE_IN_ALL
 void                    gtk_print_operation_draw_page_finish       (GtkPrintOperation  *op);
 GDK_AVAILABLE_IN_ALL
 void                    gtk_print_operation_set_defer_drawing      (GtkPrintOperation  *op);
+
+/**
+ * GtkPrintOperationDrawPageFunc:
+ * @operation: the #GtkPrintOperation
+ * @cr: the cairo context to draw the page on
+ * @page_nr: the number of the page to draw, 0-based
+ * @user_data: (closure): user data that has been passed to
+ *     gtk_print_operation_set_draw_page_func()
+ *
+ * The type of function that is passed to
+ * gtk_print_operation_set_draw_page_func().
+ *
+ * This function may be called on a worker thread.
+ */
+typedef void (* GtkPrintOperationDrawPageFunc) (GtkPrintOperation *operation,
+                                                cairo_t           *cr,
+                                                int                page_nr,
+                                                gpointer           user_data);
+
+GDK_AVAILABLE_IN_ALL
+void                    gtk_print_operation_set_draw_page_func     (GtkPrintOperation             *op,
+                                                                    GtkPrintOperationDrawPageFunc  func,
+                                                                    gpointer                       user_data,
+                                                                    GDestroyNotify                 destroy);
 GDK_AVAILABLE_IN_ALL
 void                    gtk_print_operation_set_support_selection  (GtkPrintOperation  *op,
                                                                     gboolean            support_selection);
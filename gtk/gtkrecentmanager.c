@@ -174,6 +174,12 @@ struct _GtkRecentManagerPrivate
 
   guint changed_timeout;
   guint changed_age;
+
+  /* identifies the version of the file that recent_items was loaded from */
+  guint stamp_valid : 1;
+  guint64 stamp_inode;
+  gint64 stamp_size;
+  gint64 stamp_mtime;
 };
 
 enum
@@ -504,6 +510,11 @@ gtk_recent_manager_real_changed (GtkRecentManager *manager)
                          g_strerror (errno));
               g_free (utf8);
             }
+
+          /* The monitor will tell us about this write, but there
+           * is no need to read back what we just wrote.
+           */
+          gtk_recent_manager_update_stamp (manager);
         }
 
       /* mark us as clean */
@@ -642,9 +653,45 @@ gtk_recent_manager_set_filename (GtkRecentManager *manager,
       g_object_unref (file);
     }
 
+  priv->stamp_valid = FALSE;
   build_recent_items_list (manager);
 }
 
+/* Records the version of the recently used resources file on disk,
+ * and returns whether it differs from the one recorded before.
+ *
+ * The file is replaced atomically when written, so its inode changes
+ * with every write. Together with the size and modification time, this
+ * lets us skip parsing the file again when the monitor reports our own
+ * writes, or when several change notifications arrive for one write.
+ */
+static gboolean
+gtk_recent_manager_update_stamp (GtkRecentManager *manager)
+{
+  GtkRecentManagerPrivate *priv = manager->priv;
+  GStatBuf buf;
+  gboolean changed;
+
+  if (priv->filename == NULL || g_stat (priv->filename, &buf) < 0)
+    {
+      changed = priv->stamp_valid;
+      priv->stamp_valid = FALSE;
+      return changed;
+    }
+
+  changed = !priv->stamp_valid ||
+            priv->stamp_inode != (guint64) buf.st_ino ||
+            priv->stamp_size != (gint64) buf.st_size ||
+            priv->stamp_mtime != (gint64) buf.st_mtime;
+
+  priv->stamp_valid = TRUE;
+  priv->stamp_inode = buf.st_ino;
+  priv->stamp_size = buf.st_size;
+  priv->stamp_mtime = buf.st_mtime;
+
+  return changed;
+}
+
 /* reads the recently used resources file and builds the items list.
  * we keep the items list inside the parser object, and build the
  * RecentInfo object only on user’s demand to avoid useless replication.
@@ -657,6 +704,15 @@ build_recent_items_list (GtkRecentManager *manager)
   GError *read_error;
   int size;
 
+  /* Stamp before loading, so that a write racing with the load can
+   * only cause an unneeded reload later, never a missed one.
+   */
+  if (!gtk_recent_manager_update_stamp (manager) && priv->recent_items)
+    {
+      priv->is_dirty = FALSE;
+      return;
+    }
+
   if (!priv->recent_items)
     {
       priv->recent_items = g_bookmark_file_new ();
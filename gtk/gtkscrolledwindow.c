@@ -270,6 +270,11 @@ typedef struct
 
   guint scroll_events_overshoot_id;
 
+  /* Scroll deltas waiting for the next frame */
+  guint  pending_scroll_id;
+  double pending_scroll_dx;
+  double pending_scroll_dy;
+
   /* Kinetic scrolling */
   GtkGesture *long_press_gesture;
   GtkGesture *swipe_gesture;
@@ -387,6 +392,7 @@ static void _gtk_scrolled_window_set_adjustment_value  (GtkScrolledWindow *scrol
                                                         double             value);
 
 static void gtk_scrolled_window_cancel_deceleration (GtkScrolledWindow *scrolled_window);
+static void gtk_scrolled_window_flush_pending_scroll (GtkScrolledWindow *scrolled_window);
 
 static gboolean _gtk_scrolled_window_get_overshoot (GtkScrolledWindow *scrolled_window,
                                                     int               *overshoot_x,
@@ -1002,6 +1008,8 @@ gtk_scrolled_window_decelerate (GtkScrolledWindow *scrolled_window,
   GtkScrolledWindowPrivate *priv = gtk_scrolled_window_get_instance_private (scrolled_window);
   gboolean overshoot;
 
+  gtk_scrolled_window_flush_pending_scroll (scrolled_window);
+
   overshoot = _gtk_scrolled_window_get_overshoot (scrolled_window, NULL, NULL);
   priv->x_velocity = x_velocity;
   priv->y_velocity = y_velocity;
@@ -1304,6 +1312,61 @@ start_scroll_deceleration_cb (gpointer user_data)
   return FALSE;
 }
 
+static void
+gtk_scrolled_window_flush_pending_scroll (GtkScrolledWindow *scrolled_window)
+{
+  GtkScrolledWindowPrivate *priv = gtk_scrolled_window_get_instance_private (scrolled_window);
+  GtkAdjustment *adj;
+
+  if (priv->pending_scroll_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (scrolled_window),
+                                       priv->pending_scroll_id);
+      priv->pending_scroll_id = 0;
+    }
+
+  if (priv->pending_scroll_dx != 0.0)
+    {
+      adj = gtk_scrollbar_get_adjustment (GTK_SCROLLBAR (priv->hscrollbar));
+      _gtk_scrolled_window_set_adjustment_value (scrolled_window, adj,
+                                                 priv->unclamped_hadj_value + priv->pending_scroll_dx);
+    }
+
+  if (priv->pending_scroll_dy != 0.0)
+    {
+      adj = gtk_scrollbar_get_adjustment (GTK_SCROLLBAR (priv->vscrollbar));
+      _gtk_scrolled_window_set_adjustment_value (scrolled_window, adj,
+                                                 priv->unclamped_vadj_value + priv->pending_scroll_dy);
+    }
+
+  priv->pending_scroll_dx = priv->pending_scroll_dy = 0.0;
+}
+
+static gboolean
+pending_scroll_cb (GtkWidget     *widget,
+                   GdkFrameClock *frame_clock,
+                   gpointer       user_data)
+{
+  GtkScrolledWindow *scrolled_window = GTK_SCROLLED_WINDOW (widget);
+  GtkScrolledWindowPrivate *priv = gtk_scrolled_window_get_instance_private (scrolled_window);
+
+  priv->pending_scroll_id = 0;
+  gtk_scrolled_window_invalidate_overshoot (scrolled_window);
+  gtk_scrolled_window_flush_pending_scroll (scrolled_window);
+
+  if (!priv->smooth_scroll &&
+      priv->scroll_events_overshoot_id == 0 &&
+      _gtk_scrolled_window_get_overshoot (scrolled_window, NULL, NULL))
+    {
+      priv->scroll_events_overshoot_id =
+        g_timeout_add (50, start_scroll_deceleration_cb, scrolled_window);
+      g_source_set_name_by_id (priv->scroll_events_overshoot_id,
+                               "[gtk] start_scroll_deceleration_cb");
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 scroll_controller_scroll_begin (GtkEventControllerScroll *scroll,
                                 GtkScrolledWindow        *scrolled_window)
@@ -1338,35 +1401,16 @@ scroll_controller_scroll (GtkEventControllerScroll *scroll,
       delta_y = delta;
     }
 
+  /* High frequency devices send several events per frame; accumulate
+   * their deltas and apply them once, in the frame's update phase.
+   */
   if (delta_x != 0.0 &&
       may_hscroll (scrolled_window))
-    {
-      GtkAdjustment *adj;
-      double new_value;
-      double scroll_unit;
-
-      adj = gtk_scrollbar_get_adjustment (GTK_SCROLLBAR (priv->hscrollbar));
-      scroll_unit = get_scroll_unit (scrolled_window, GTK_ORIENTATION_HORIZONTAL);
-
-      new_value = priv->unclamped_hadj_value + delta_x * scroll_unit;
-      _gtk_scrolled_window_set_adjustment_value (scrolled_window, adj,
-                                                 new_value);
-    }
+    priv->pending_scroll_dx += delta_x * get_scroll_unit (scrolled_window, GTK_ORIENTATION_HORIZONTAL);
 
   if (delta_y != 0.0 &&
       may_vscroll (scrolled_window))
-    {
-      GtkAdjustment *adj;
-      double new_value;
-      double scroll_unit;
-
-      adj = gtk_scrollbar_get_adjustment (GTK_SCROLLBAR (priv->vscrollbar));
-      scroll_unit = get_scroll_unit (scrolled_window, GTK_ORIENTATION_VERTICAL);
-
-      new_value = priv->unclamped_vadj_value + delta_y * scroll_unit;
-      _gtk_scrolled_window_set_adjustment_value (scrolled_window, adj,
-                                                 new_value);
-    }
+    priv->pending_scroll_dy += delta_y * get_scroll_unit (scrolled_window, GTK_ORIENTATION_VERTICAL);
 
   if (priv->scroll_events_overshoot_id)
     {
@@ -1374,14 +1418,10 @@ scroll_controller_scroll (GtkEventControllerScroll *scroll,
       priv->scroll_events_overshoot_id = 0;
     }
 
-  if (!priv->smooth_scroll &&
-      _gtk_scrolled_window_get_overshoot (scrolled_window, NULL, NULL))
-    {
-      priv->scroll_events_overshoot_id =
-        g_timeout_add (50, start_scroll_deceleration_cb, scrolled_window);
-      g_source_set_name_by_id (priv->scroll_events_overshoot_id,
-                               "[gtk] start_scroll_deceleration_cb");
-    }
+  if (priv->pending_scroll_id == 0)
+    priv->pending_scroll_id = gtk_widget_add_tick_callback (GTK_WIDGET (scrolled_window),
+                                                            pending_scroll_cb,
+                                                            NULL, NULL);
 
   return GDK_EVENT_STOP;
 }
@@ -2636,6 +2676,12 @@ gtk_scrolled_window_dispose (GObject *object)
       priv->deceleration_id = 0;
     }
 
+  if (priv->pending_scroll_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), priv->pending_scroll_id);
+      priv->pending_scroll_id = 0;
+    }
+
   if (priv->scroll_events_overshoot_id)
     {
       g_source_remove (priv->scroll_events_overshoot_id);
@@ -3246,6 +3292,21 @@ _gtk_scrolled_window_set_adjustment_value (GtkScrolledWindow *scrolled_window,
   g_signal_emit (scrolled_window, signals[EDGE_OVERSHOT], 0, edge_pos);
 }
 
+static gint64
+get_predicted_presentation_time (GdkFrameClock *frame_clock)
+{
+  gint64 frame_time, refresh_interval, presentation_time;
+
+  frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+  gdk_frame_clock_get_refresh_info (frame_clock, frame_time,
+                                    &refresh_interval, &presentation_time);
+
+  if (presentation_time != 0)
+    return presentation_time;
+
+  return frame_time + refresh_interval;
+}
+
 static gboolean
 scrolled_window_deceleration_cb (GtkWidget         *widget,
                                  GdkFrameClock     *frame_clock,
@@ -3258,7 +3319,13 @@ scrolled_window_deceleration_cb (GtkWidget         *widget,
   gint64 current_time;
   double position, elapsed;
 
-  current_time = gdk_frame_clock_get_frame_time (frame_clock);
+  /* Place the content where it needs to be when the frame reaches
+   * the screen, not where it was when the frame started.
+   */
+  current_time = get_predicted_presentation_time (frame_clock);
+  if (current_time <= data->last_deceleration_time)
+    return G_SOURCE_CONTINUE;
+
   elapsed = (current_time - data->last_deceleration_time) / 1000000.0;
   data->last_deceleration_time = current_time;
 
@@ -3582,6 +3649,7 @@ gtk_scrolled_window_unmap (GtkWidget *widget)
 
   GTK_WIDGET_CLASS (gtk_scrolled_window_parent_class)->unmap (widget);
 
+  gtk_scrolled_window_flush_pending_scroll (scrolled_window);
   gtk_scrolled_window_update_animating (scrolled_window);
 
   indicator_reset (&priv->hindicator);
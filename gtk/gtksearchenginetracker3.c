@@ -51,6 +51,9 @@
   "} "                                                                 \
   "ORDER BY DESC(fts:rank(?urn)) DESC(?url)"
 
+/* Number of hits to read from the cursor before handing them out */
+#define HITS_BATCH_SIZE 100
+
 #define SEARCH_QUERY SEARCH_QUERY_BASE("")
 #define SEARCH_RECURSIVE_QUERY SEARCH_QUERY_BASE("?urn (nfo:belongsToContainer/nie:isStoredAs)+/nie:url ~location")
 #define SEARCH_LOCATION_QUERY SEARCH_QUERY_BASE("?urn nfo:belongsToContainer/nie:isStoredAs/nie:url ~location")
@@ -72,6 +75,15 @@ struct _GtkSearchEngineTracker3Class
   GtkSearchEngineClass parent_class;
 };
 
+typedef struct
+{
+  GtkSearchEngineTracker3 *engine;
+  GCancellable *cancellable;
+  GList *hits;
+  guint n_hits;
+  gboolean got_results;
+} QueryData;
+
 static void gtk_search_engine_tracker3_initable_iface_init (GInitableIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (GtkSearchEngineTracker3,
@@ -127,7 +139,13 @@ create_file_info (TrackerSparqlCursor *cursor)
 
   str = tracker_sparql_cursor_get_string (cursor, 2, NULL);
   if (str)
-    g_file_info_set_content_type (info, str);
+    {
+      g_file_info_set_content_type (info, str);
+      g_file_info_set_file_type (info,
+                                 strcmp (str, "inode/directory") == 0
+                                 ? G_FILE_TYPE_DIRECTORY
+                                 : G_FILE_TYPE_REGULAR);
+    }
 
   g_file_info_set_size (info,
                         tracker_sparql_cursor_get_integer (cursor, 3));
@@ -143,50 +161,109 @@ create_file_info (TrackerSparqlCursor *cursor)
   return info;
 }
 
+static void
+query_data_free (QueryData *data)
+{
+  g_list_free_full (data->hits, free_hit);
+  g_object_unref (data->cancellable);
+  g_object_unref (data->engine);
+  g_free (data);
+}
+
+static void
+flush_hits (QueryData *data)
+{
+  if (data->hits == NULL)
+    return;
+
+  _gtk_search_engine_hits_added (GTK_SEARCH_ENGINE (data->engine), data->hits);
+  g_list_free_full (data->hits, free_hit);
+  data->hits = NULL;
+  data->n_hits = 0;
+  data->got_results = TRUE;
+}
+
+/* The cursor is read asynchronously, and hits are handed out in
+ * batches as they come in, so the first results show up before all
+ * of them have been read.
+ */
+static void
+cursor_next_callback (TrackerSparqlCursor *cursor,
+                      GAsyncResult        *res,
+                      gpointer             user_data)
+{
+  QueryData *data = user_data;
+  GError *error = NULL;
+  GtkSearchHit *hit;
+  const char *url;
+
+  if (!tracker_sparql_cursor_next_finish (cursor, res, &error))
+    {
+      tracker_sparql_cursor_close (cursor);
+
+      if (error)
+        {
+          if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+              data->engine->query_pending = FALSE;
+              _gtk_search_engine_error (GTK_SEARCH_ENGINE (data->engine), error->message);
+            }
+        }
+      else
+        {
+          data->engine->query_pending = FALSE;
+          flush_hits (data);
+          _gtk_search_engine_finished (GTK_SEARCH_ENGINE (data->engine), data->got_results);
+        }
+
+      g_clear_error (&error);
+      g_object_unref (cursor);
+      query_data_free (data);
+      return;
+    }
+
+  url = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+  hit = g_slice_new0 (GtkSearchHit);
+  hit->file = g_file_new_for_uri (url);
+  hit->info = create_file_info (cursor);
+  data->hits = g_list_prepend (data->hits, hit);
+  data->n_hits++;
+
+  if (data->n_hits >= HITS_BATCH_SIZE)
+    flush_hits (data);
+
+  tracker_sparql_cursor_next_async (cursor, data->cancellable,
+                                    (GAsyncReadyCallback) cursor_next_callback,
+                                    data);
+}
+
 static void
 query_callback (TrackerSparqlStatement *statement,
                 GAsyncResult           *res,
                 gpointer                user_data)
 {
-  GtkSearchEngineTracker3 *engine;
+  QueryData *data = user_data;
   TrackerSparqlCursor *cursor;
-  GList *hits = NULL;
   GError *error = NULL;
-  GtkSearchHit *hit;
-
-  engine = GTK_SEARCH_ENGINE_TRACKER3 (user_data);
-
-  engine->query_pending = FALSE;
 
   cursor = tracker_sparql_statement_execute_finish (statement, res, &error);
 
   if (!cursor)
     {
-      _gtk_search_engine_error (GTK_SEARCH_ENGINE (engine), error->message);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          data->engine->query_pending = FALSE;
+          _gtk_search_engine_error (GTK_SEARCH_ENGINE (data->engine), error->message);
+        }
+
       g_error_free (error);
-      g_object_unref (engine);
+      query_data_free (data);
       return;
     }
 
-  while (tracker_sparql_cursor_next (cursor, NULL, NULL))
-    {
-      const char *url;
-
-      url = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-      hit = g_slice_new0 (GtkSearchHit);
-      hit->file = g_file_new_for_uri (url);
-      hit->info = create_file_info (cursor);
-      hits = g_list_prepend (hits, hit);
-    }
-
-  tracker_sparql_cursor_close (cursor);
-
-  _gtk_search_engine_hits_added (GTK_SEARCH_ENGINE (engine), hits);
-  _gtk_search_engine_finished (GTK_SEARCH_ENGINE (engine), hits != NULL);
-
-  g_list_free_full (hits, free_hit);
-  g_object_unref (engine);
-  g_object_unref (cursor);
+  tracker_sparql_cursor_next_async (cursor, data->cancellable,
+                                    (GAsyncReadyCallback) cursor_next_callback,
+                                    data);
 }
 
 static void
@@ -194,6 +271,7 @@ gtk_search_engine_tracker3_start (GtkSearchEngine *engine)
 {
   GtkSearchEngineTracker3 *tracker;
   TrackerSparqlStatement *statement;
+  QueryData *data;
   const char *search_text;
   char *match;
   GFile *location;
@@ -244,12 +322,16 @@ gtk_search_engine_tracker3_start (GtkSearchEngine *engine)
       statement = tracker->search_query;
     }
 
+  data = g_new0 (QueryData, 1);
+  data->engine = g_object_ref (tracker);
+  data->cancellable = g_object_ref (tracker->cancellable);
+
   match = g_strdup_printf ("%s*", search_text);
   tracker_sparql_statement_bind_string (statement, "match", match);
   g_debug ("search text: %s\n", match);
   tracker_sparql_statement_execute_async (statement, tracker->cancellable,
                                           (GAsyncReadyCallback) query_callback,
-                                          g_object_ref (tracker));
+                                          data);
   g_free (match);
 }
 
@@ -263,6 +345,8 @@ gtk_search_engine_tracker3_stop (GtkSearchEngine *engine)
   if (tracker->query && tracker->query_pending)
     {
       g_cancellable_cancel (tracker->cancellable);
+      g_object_unref (tracker->cancellable);
+      tracker->cancellable = g_cancellable_new ();
       tracker->query_pending = FALSE;
     }
 }
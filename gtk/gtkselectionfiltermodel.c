@@ -142,7 +142,31 @@ gtk_selection_filter_model_selection_changed_cb (GListModel              *model,
                                                  guint                    n_items,
                                                  GtkSelectionFilterModel *self)
 {
-  selection_filter_model_items_changed (self, position, n_items, n_items);
+  GtkBitset *selection, *changed;
+  guint sel_position = 0;
+  guint sel_removed, sel_added;
+
+  /* A change can be reported in multiple ranges, so only the selection
+   * in this range may be updated here.
+   */
+  selection = gtk_selection_model_get_selection (self->model);
+
+  if (position > 0)
+    sel_position = gtk_bitset_get_size_in_range (self->selection, 0, position - 1);
+
+  sel_removed = gtk_bitset_get_size_in_range (self->selection, position, position + n_items - 1);
+  sel_added = gtk_bitset_get_size_in_range (selection, position, position + n_items - 1);
+
+  changed = gtk_bitset_new_range (position, n_items);
+  gtk_bitset_intersect (changed, selection);
+  gtk_bitset_remove_range (self->selection, position, n_items);
+  gtk_bitset_union (self->selection, changed);
+
+  gtk_bitset_unref (changed);
+  gtk_bitset_unref (selection);
+
+  if (sel_removed > 0 || sel_added > 0)
+    g_list_model_items_changed (G_LIST_MODEL (self), sel_position, sel_removed, sel_added);
 }
 
 static void
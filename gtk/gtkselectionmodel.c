@@ -96,14 +96,22 @@ gtk_selection_model_default_get_selection_in_range (GtkSelectionModel *model,
                                                     guint              n_items)
 {
   GtkBitset *bitset;
-  guint i;
+  guint i, start;
 
   bitset = gtk_bitset_new_empty ();
 
   for (i = position; i < position + n_items; i++)
     {
-      if (gtk_selection_model_is_selected (model, i))
-        gtk_bitset_add (bitset, i);
+      if (!gtk_selection_model_is_selected (model, i))
+        continue;
+
+      /* adding ranges is a lot cheaper than adding single values */
+      for (start = i++; i < position + n_items; i++)
+        {
+          if (!gtk_selection_model_is_selected (model, i))
+            break;
+        }
+      gtk_bitset_add_range (bitset, start, i - start);
     }
 
   return bitset;
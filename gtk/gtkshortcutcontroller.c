@@ -82,6 +82,10 @@
 #include "gtkdebug.h"
 
 #include <gdk/gdk.h>
+#include "gdk/gdkeventsprivate.h"
+
+/* Controllers with fewer shortcuts just try all of them */
+#define GTK_SHORTCUT_CONTROLLER_INDEX_MIN_ITEMS 16
 
 struct _GtkShortcutController
 {
@@ -94,6 +98,11 @@ struct _GtkShortcutController
   guint custom_shortcuts : 1;
 
   guint last_activated;
+
+  /* Positions of shortcuts by the keyval of their trigger, built on demand */
+  GHashTable *index;
+  GArray *unindexed; /* positions of shortcuts that can't be indexed */
+  GPtrArray *indexed_shortcuts;
 };
 
 struct _GtkShortcutControllerClass
@@ -186,6 +195,191 @@ gtk_shortcut_controller_is_rooted (GtkShortcutController *self)
   return gtk_widget_get_root (widget) != NULL;
 }
 
+static void
+gtk_shortcut_controller_clear_index (GtkShortcutController *self)
+{
+  guint i;
+
+  if (self->index == NULL)
+    return;
+
+  for (i = 0; i < self->indexed_shortcuts->len; i++)
+    g_signal_handlers_disconnect_by_func (g_ptr_array_index (self->indexed_shortcuts, i),
+                                          gtk_shortcut_controller_clear_index,
+                                          self);
+
+  g_clear_pointer (&self->index, g_hash_table_unref);
+  g_clear_pointer (&self->unindexed, g_array_unref);
+  g_clear_pointer (&self->indexed_shortcuts, g_ptr_array_unref);
+}
+
+/* Shift, Caps Lock and the keymap decide the case of the keyval
+ * in the event, so the index doesn't care about it.
+ */
+static guint
+normalize_keyval (guint keyval)
+{
+  if (keyval == GDK_KEY_ISO_Left_Tab)
+    return GDK_KEY_Tab;
+
+  return gdk_keyval_to_lower (keyval);
+}
+
+static void
+gtk_shortcut_controller_index_add (GtkShortcutController *self,
+                                   guint                  keyval,
+                                   guint                  position)
+{
+  GArray *positions;
+
+  positions = g_hash_table_lookup (self->index, GUINT_TO_POINTER (keyval));
+  if (positions == NULL)
+    {
+      positions = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (self->index, GUINT_TO_POINTER (keyval), positions);
+    }
+
+  if (positions->len == 0 ||
+      g_array_index (positions, guint, positions->len - 1) != position)
+    g_array_append_val (positions, position);
+}
+
+/* Returns FALSE if the trigger may match events that aren't in the index */
+static gboolean
+gtk_shortcut_controller_index_trigger (GtkShortcutController *self,
+                                       GtkShortcutTrigger    *trigger,
+                                       guint                  position)
+{
+  if (GTK_IS_KEYVAL_TRIGGER (trigger))
+    {
+      guint keyval = gtk_keyval_trigger_get_keyval (GTK_KEYVAL_TRIGGER (trigger));
+
+      /* Matching uses the uppercase keyval when Shift is part of the trigger */
+      gtk_shortcut_controller_index_add (self, normalize_keyval (keyval), position);
+      gtk_shortcut_controller_index_add (self, normalize_keyval (gdk_keyval_to_upper (keyval)), position);
+      return TRUE;
+    }
+  else if (GTK_IS_MNEMONIC_TRIGGER (trigger))
+    {
+      gtk_shortcut_controller_index_add (self,
+                                         gtk_mnemonic_trigger_get_keyval (GTK_MNEMONIC_TRIGGER (trigger)),
+                                         position);
+      return TRUE;
+    }
+  else if (GTK_IS_ALTERNATIVE_TRIGGER (trigger))
+    {
+      GtkAlternativeTrigger *alternative = GTK_ALTERNATIVE_TRIGGER (trigger);
+
+      return gtk_shortcut_controller_index_trigger (self, gtk_alternative_trigger_get_first (alternative), position) &&
+             gtk_shortcut_controller_index_trigger (self, gtk_alternative_trigger_get_second (alternative), position);
+    }
+  else if (GTK_IS_NEVER_TRIGGER (trigger))
+    {
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+gtk_shortcut_controller_ensure_index (GtkShortcutController *self)
+{
+  guint i, n_items;
+
+  if (self->index != NULL)
+    return;
+
+  self->index = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+  self->unindexed = g_array_new (FALSE, FALSE, sizeof (guint));
+  self->indexed_shortcuts = g_ptr_array_new_with_free_func (g_object_unref);
+
+  n_items = g_list_model_get_n_items (self->shortcuts);
+  for (i = 0; i < n_items; i++)
+    {
+      GtkShortcut *shortcut = g_list_model_get_item (self->shortcuts, i);
+
+      if (!GTK_IS_SHORTCUT (shortcut))
+        {
+          g_object_unref (shortcut);
+          continue;
+        }
+
+      if (!gtk_shortcut_controller_index_trigger (self, gtk_shortcut_get_trigger (shortcut), i))
+        g_array_append_val (self->unindexed, i);
+
+      g_signal_connect_swapped (shortcut, "notify::trigger", G_CALLBACK (gtk_shortcut_controller_clear_index), self);
+      g_ptr_array_add (self->indexed_shortcuts, shortcut);
+    }
+}
+
+static void
+gtk_shortcut_controller_add_candidates (GtkShortcutController *self,
+                                        GArray                *candidates,
+                                        guint                  keyval)
+{
+  GArray *positions;
+
+  positions = g_hash_table_lookup (self->index, GUINT_TO_POINTER (normalize_keyval (keyval)));
+  if (positions)
+    g_array_append_vals (candidates, positions->data, positions->len);
+}
+
+static int
+compare_candidates (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      data)
+{
+  guint first = GPOINTER_TO_UINT (data);
+  /* Wraps around, so positions before first sort last */
+  guint pos_a = *(const guint *) a - first;
+  guint pos_b = *(const guint *) b - first;
+
+  return pos_a < pos_b ? -1 : pos_a > pos_b;
+}
+
+/* Returns the positions of all shortcuts that may trigger for @event,
+ * in the order they need to be tried, or %NULL if all of them need to
+ * be tried.
+ */
+static GArray *
+gtk_shortcut_controller_get_candidates (GtkShortcutController *self,
+                                        GdkEvent              *event)
+{
+  GdkKeyEvent *key_event = (GdkKeyEvent *) event;
+  GArray *candidates;
+  guint *keyvals;
+  int n_keyvals;
+  guint first, i, j;
+
+  /* Partial matches happen via the other keyvals of the key */
+  if (!gdk_display_map_keycode (gdk_event_get_display (event),
+                                key_event->keycode,
+                                NULL, &keyvals, &n_keyvals))
+    return NULL;
+
+  gtk_shortcut_controller_ensure_index (self);
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (guint));
+  g_array_append_vals (candidates, self->unindexed->data, self->unindexed->len);
+  gtk_shortcut_controller_add_candidates (self, candidates, key_event->translated[0].keyval);
+  gtk_shortcut_controller_add_candidates (self, candidates, key_event->translated[1].keyval);
+  for (i = 0; i < n_keyvals; i++)
+    gtk_shortcut_controller_add_candidates (self, candidates, keyvals[i]);
+  g_free (keyvals);
+
+  first = (self->last_activated + 1) % g_list_model_get_n_items (self->shortcuts);
+  g_array_sort_with_data (candidates, compare_candidates, GUINT_TO_POINTER (first));
+
+  for (i = 0, j = 0; i < candidates->len; i++)
+    {
+      if (j == 0 || g_array_index (candidates, guint, j - 1) != g_array_index (candidates, guint, i))
+        g_array_index (candidates, guint, j++) = g_array_index (candidates, guint, i);
+    }
+  g_array_set_size (candidates, j);
+
+  return candidates;
+}
+
 static void
 gtk_shortcut_controller_set_property (GObject      *object,
                                       guint         prop_id,
@@ -214,6 +408,7 @@ gtk_shortcut_controller_set_property (GObject      *object,
             self->custom_shortcuts = FALSE;
           }
         g_signal_connect_swapped (self->shortcuts, "items-changed", G_CALLBACK (g_list_model_items_changed), self);
+        g_signal_connect_swapped (self->shortcuts, "items-changed", G_CALLBACK (gtk_shortcut_controller_clear_index), self);
       }
       break;
 
@@ -265,7 +460,9 @@ gtk_shortcut_controller_finalize (GObject *object)
 {
   GtkShortcutController *self = GTK_SHORTCUT_CONTROLLER (object);
 
+  gtk_shortcut_controller_clear_index (self);
   g_signal_handlers_disconnect_by_func (self->shortcuts, g_list_model_items_changed, self);
+  g_signal_handlers_disconnect_by_func (self->shortcuts, gtk_shortcut_controller_clear_index, self);
   g_clear_object (&self->shortcuts);
 
   G_OBJECT_CLASS (gtk_shortcut_controller_parent_class)->finalize (object);
@@ -294,11 +491,20 @@ gtk_shortcut_controller_run_controllers (GtkEventController *controller,
 {
   GtkShortcutController *self = GTK_SHORTCUT_CONTROLLER (controller);
   int i, p;
+  GArray *candidates = NULL;
   GArray *shortcuts = NULL;
   gboolean has_exact = FALSE;
   gboolean retval = FALSE;
 
-  for (i = 0, p = g_list_model_get_n_items (self->shortcuts); i < p; i++)
+  p = g_list_model_get_n_items (self->shortcuts);
+  if (p >= GTK_SHORTCUT_CONTROLLER_INDEX_MIN_ITEMS)
+    {
+      candidates = gtk_shortcut_controller_get_candidates (self, event);
+      if (candidates)
+        p = candidates->len;
+    }
+
+  for (i = 0; i < p; i++)
     {
       GtkShortcut *shortcut;
       ShortcutData *data;
@@ -306,7 +512,10 @@ gtk_shortcut_controller_run_controllers (GtkEventController *controller,
       GtkWidget *widget;
       GtkNative *native;
 
-      index = (self->last_activated + 1 + i) % g_list_model_get_n_items (self->shortcuts);
+      if (candidates)
+        index = g_array_index (candidates, guint, i);
+      else
+        index = (self->last_activated + 1 + i) % g_list_model_get_n_items (self->shortcuts);
       shortcut = g_list_model_get_item (self->shortcuts, index);
       if (!GTK_IS_SHORTCUT (shortcut))
         {
@@ -387,6 +596,8 @@ gtk_shortcut_controller_run_controllers (GtkEventController *controller,
     }
 #endif
 
+  g_clear_pointer (&candidates, g_array_unref);
+
   if (!shortcuts)
     return retval;
 
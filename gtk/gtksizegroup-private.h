@@ -24,7 +24,20 @@
 G_BEGIN_DECLS
 
 GHashTable * _gtk_size_group_get_widget_peers (GtkWidget           *for_widget,
-                                               GtkOrientation       orientation);
+                                               GtkOrientation       orientation,
+                                               GHashTable         **out_groups);
+
+gboolean     _gtk_size_group_lookup_request   (GtkWidget           *widget,
+                                               GtkOrientation       orientation,
+                                               int                  for_size,
+                                               int                 *minimum,
+                                               int                 *natural);
+void         _gtk_size_group_store_request    (GHashTable          *groups,
+                                               GtkOrientation       orientation,
+                                               int                  for_size,
+                                               int                  minimum,
+                                               int                  natural);
+void         _gtk_size_group_invalidate       (GtkSizeGroup        *size_group);
 
 G_END_DECLS
 
@@ -28,6 +28,8 @@
 #include "gtksizegroup-private.h"
 #include "gtkwidgetprivate.h"
 
+#include "gdk/gdkprofilerprivate.h"
+
 
 /**
  * SECTION:gtksizegroup
@@ -109,13 +111,28 @@ struct _GtkSizeGroupClass
   GObjectClass parent_class;
 };
 
+typedef struct
+{
+  int  for_size;
+  int  minimum;
+  int  natural;
+  guint valid : 1;
+} GtkSizeGroupRequest;
+
 struct _GtkSizeGroupPrivate
 {
   GSList         *widgets;
 
   guint8          mode;
+
+  /* The requisition of all widgets reachable from this group,
+   * per orientation. It is valid until a member queues a resize. */
+  GtkSizeGroupRequest requests[2];
 };
 
+static guint group_measures;
+static guint group_measures_counter;
+
 enum {
   PROP_0,
   PROP_MODE
@@ -185,8 +202,9 @@ add_widget_to_closure (GHashTable *widgets,
 }
 
 GHashTable *
-_gtk_size_group_get_widget_peers (GtkWidget      *for_widget,
-                                  GtkOrientation  orientation)
+_gtk_size_group_get_widget_peers (GtkWidget       *for_widget,
+                                  GtkOrientation   orientation,
+                                  GHashTable     **out_groups)
 {
   GHashTable *widgets, *groups;
 
@@ -195,17 +213,95 @@ _gtk_size_group_get_widget_peers (GtkWidget      *for_widget,
 
   add_widget_to_closure (widgets, groups, for_widget, orientation);
 
-  g_hash_table_unref (groups);
+  if (out_groups)
+    *out_groups = groups;
+  else
+    g_hash_table_unref (groups);
 
   return widgets;
 }
 
+/* Looks up the requisition of the widgets grouped with @widget
+ * in the cache of its first size group for @orientation */
+gboolean
+_gtk_size_group_lookup_request (GtkWidget      *widget,
+                                GtkOrientation  orientation,
+                                int             for_size,
+                                int            *minimum,
+                                int            *natural)
+{
+  GSList *l;
+
+  for (l = _gtk_widget_get_sizegroups (widget); l; l = l->next)
+    {
+      GtkSizeGroupPrivate *priv = gtk_size_group_get_instance_private (l->data);
+      GtkSizeGroupRequest *request = &priv->requests[orientation];
+
+      if (!(priv->mode & (1 << orientation)))
+        continue;
+
+      if (!request->valid || request->for_size != for_size)
+        return FALSE;
+
+      *minimum = request->minimum;
+      *natural = request->natural;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Stores the requisition of a set of grouped widgets in all
+ * the @groups that connect them */
+void
+_gtk_size_group_store_request (GHashTable     *groups,
+                               GtkOrientation  orientation,
+                               int             for_size,
+                               int             minimum,
+                               int             natural)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  g_hash_table_iter_init (&iter, groups);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      GtkSizeGroupPrivate *priv = gtk_size_group_get_instance_private (key);
+      GtkSizeGroupRequest *request = &priv->requests[orientation];
+
+      request->for_size = for_size;
+      request->minimum = minimum;
+      request->natural = natural;
+      request->valid = TRUE;
+    }
+
+  group_measures++;
+
+  if (GDK_PROFILER_IS_RUNNING)
+    {
+      if (group_measures_counter == 0)
+        group_measures_counter = gdk_profiler_define_int_counter ("size-group-measures", "Size Group Measures");
+      gdk_profiler_set_int_counter (group_measures_counter, group_measures);
+    }
+}
+
+void
+_gtk_size_group_invalidate (GtkSizeGroup *size_group)
+{
+  GtkSizeGroupPrivate *priv = gtk_size_group_get_instance_private (size_group);
+
+  priv->requests[GTK_ORIENTATION_HORIZONTAL].valid = FALSE;
+  priv->requests[GTK_ORIENTATION_VERTICAL].valid = FALSE;
+}
+
 static void
 queue_resize_on_group (GtkSizeGroup *size_group)
 {
   GtkSizeGroupPrivate *priv = gtk_size_group_get_instance_private (size_group);
   GSList *list;
 
+  _gtk_size_group_invalidate (size_group);
+
   for (list = priv->widgets; list; list = list->next)
     {
       gtk_widget_queue_resize (list->data);
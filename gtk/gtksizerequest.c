@@ -506,27 +506,37 @@ gtk_widget_measure (GtkWidget        *widget,
     }
   else
     {
-      GHashTable *widgets;
+      GHashTable *widgets, *groups;
       GHashTableIter iter;
       gpointer key;
       int min_result = 0, nat_result = 0;
 
-      widgets = _gtk_size_group_get_widget_peers (widget, orientation);
-
-      g_hash_table_iter_init (&iter, widgets);
-      while (g_hash_table_iter_next (&iter, &key, NULL))
+      /* Measuring all grouped widgets is expensive for big groups,
+       * so the result is cached in the groups until one of the
+       * widgets queues a resize.
+       */
+      if (!_gtk_size_group_lookup_request (widget, orientation, for_size, &min_result, &nat_result))
         {
-          GtkWidget *tmp_widget = key;
-          int min_dimension, nat_dimension;
+          widgets = _gtk_size_group_get_widget_peers (widget, orientation, &groups);
 
-          gtk_widget_query_size_for_orientation (tmp_widget, orientation, for_size,
-                                                 &min_dimension, &nat_dimension, NULL, NULL);
+          g_hash_table_iter_init (&iter, widgets);
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            {
+              GtkWidget *tmp_widget = key;
+              int min_dimension, nat_dimension;
 
-          min_result = MAX (min_result, min_dimension);
-          nat_result = MAX (nat_result, nat_dimension);
-        }
+              gtk_widget_query_size_for_orientation (tmp_widget, orientation, for_size,
+                                                     &min_dimension, &nat_dimension, NULL, NULL);
 
-      g_hash_table_destroy (widgets);
+              min_result = MAX (min_result, min_dimension);
+              nat_result = MAX (nat_result, nat_dimension);
+            }
+
+          _gtk_size_group_store_request (groups, orientation, for_size, min_result, nat_result);
+
+          g_hash_table_destroy (widgets);
+          g_hash_table_destroy (groups);
+        }
 
       /* Baselines make no sense with sizegroups really */
       if (minimum_baseline)
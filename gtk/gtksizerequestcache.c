@@ -31,35 +31,15 @@ _gtk_size_request_cache_init (SizeRequestCache *cache)
   memset (cache, 0, sizeof (SizeRequestCache));
 }
 
-static void
-free_sizes_x (SizeRequestX **sizes)
-{
-  int i;
-
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestX, sizes[i]);
-
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
-}
-
-static void
-free_sizes_y (SizeRequestY **sizes)
-{
-  int i;
-
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestY, sizes[i]);
-
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
-}
+G_STATIC_ASSERT (GTK_SIZE_REQUEST_CACHED_SIZES < 32);
 
 void
 _gtk_size_request_cache_free (SizeRequestCache *cache)
 {
   if (cache->requests_x)
-    free_sizes_x (cache->requests_x);
+    g_slice_free1 (sizeof (SizeRequestX) * GTK_SIZE_REQUEST_CACHED_SIZES, cache->requests_x);
   if (cache->requests_y)
-    free_sizes_y (cache->requests_y);
+    g_slice_free1 (sizeof (SizeRequestY) * GTK_SIZE_REQUEST_CACHED_SIZES, cache->requests_y);
 }
 
 void
@@ -115,16 +95,16 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-      SizeRequestX **cached_sizes = cache->requests_x;
-      SizeRequestX  *cached_size;
+      SizeRequestX *cached_sizes = cache->requests_x;
+      SizeRequestX *cached_size;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size)
+	  if (cached_sizes[i].cached_size.minimum_size == minimum_size &&
+	      cached_sizes[i].cached_size.natural_size == natural_size)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
+	      cached_sizes[i].lower_for_size = MIN (cached_sizes[i].lower_for_size, for_size);
+	      cached_sizes[i].upper_for_size = MAX (cached_sizes[i].upper_for_size, for_size);
 	      return;
 	    }
 	}
@@ -144,12 +124,9 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 	}
 
       if (cache->requests_x == NULL)
-	cache->requests_x = g_slice_alloc0 (sizeof (SizeRequestX *) * GTK_SIZE_REQUEST_CACHED_SIZES);
+	cache->requests_x = g_slice_alloc (sizeof (SizeRequestX) * GTK_SIZE_REQUEST_CACHED_SIZES);
 
-      if (cache->requests_x[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_x[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestX);
-
-      cached_size = cache->requests_x[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_x[cache->flags[orientation].last_cached_request];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -157,18 +134,18 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
     }
   else
     {
-      SizeRequestY **cached_sizes = cache->requests_y;
-      SizeRequestY  *cached_size;
+      SizeRequestY *cached_sizes = cache->requests_y;
+      SizeRequestY *cached_size;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size &&
-	      cached_sizes[i]->cached_size.minimum_baseline == minimum_baseline &&
-	      cached_sizes[i]->cached_size.natural_baseline == natural_baseline)
+	  if (cached_sizes[i].cached_size.minimum_size == minimum_size &&
+	      cached_sizes[i].cached_size.natural_size == natural_size &&
+	      cached_sizes[i].cached_size.minimum_baseline == minimum_baseline &&
+	      cached_sizes[i].cached_size.natural_baseline == natural_baseline)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
+	      cached_sizes[i].lower_for_size = MIN (cached_sizes[i].lower_for_size, for_size);
+	      cached_sizes[i].upper_for_size = MAX (cached_sizes[i].upper_for_size, for_size);
 	      return;
 	    }
 	}
@@ -188,12 +165,9 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 	}
 
       if (cache->requests_y == NULL)
-	cache->requests_y = g_slice_alloc0 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES);
-
-      if (cache->requests_y[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_y[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestY);
+	cache->requests_y = g_slice_alloc (sizeof (SizeRequestY) * GTK_SIZE_REQUEST_CACHED_SIZES);
 
-      cached_size = cache->requests_y[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_y[cache->flags[orientation].last_cached_request];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -239,7 +213,7 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 	  /* Search for an already cached size */
           for (i = 0, p = cache->flags[GTK_ORIENTATION_HORIZONTAL].n_cached_requests; i < p; i++)
             {
-              const SizeRequestX *cur = cache->requests_x[i];
+              const SizeRequestX *cur = &cache->requests_x[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -278,7 +252,7 @@ _gtk_size_request_cache_lookup (const SizeRequestCache *cache,
 	  /* Search for an already cached size */
           for (i = 0, p = cache->flags[GTK_ORIENTATION_VERTICAL].n_cached_requests; i < p; i++)
             {
-              const SizeRequestY *cur = cache->requests_y[i];
+              const SizeRequestY *cur = &cache->requests_y[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -35,8 +35,18 @@ G_BEGIN_DECLS
  * for a said widget to have, if a label can
  * only wrap to 3 lines, only 3 caches will
  * ever be allocated for it.
+ *
+ * Containers of wrapping children, like
+ * GtkFlowBox, can have many more results
+ * while being resized, and measure their
+ * children again for all of them once the
+ * cache starts evicting.
+ *
+ * This must fit into the bitfields below.
  */
-#define GTK_SIZE_REQUEST_CACHED_SIZES   (5)
+#ifndef GTK_SIZE_REQUEST_CACHED_SIZES
+#define GTK_SIZE_REQUEST_CACHED_SIZES   (16)
+#endif
 
 typedef struct {
   int minimum_size;
@@ -65,8 +75,8 @@ typedef struct
 } SizeRequestY;
 
 typedef struct {
-  SizeRequestX **requests_x;
-  SizeRequestY **requests_y;
+  SizeRequestX *requests_x; /* GTK_SIZE_REQUEST_CACHED_SIZES entries */
+  SizeRequestY *requests_y; /* GTK_SIZE_REQUEST_CACHED_SIZES entries */
 
   CachedSizeX  cached_size_x;
   CachedSizeY  cached_size_y;
@@ -74,8 +84,8 @@ typedef struct {
   GtkSizeRequestMode request_mode   : 3;
   guint       request_mode_valid    : 1;
   struct {
-    guint       n_cached_requests   : 3;
-    guint       last_cached_request : 3;
+    guint       n_cached_requests   : 5;
+    guint       last_cached_request : 5;
     guint       cached_size_valid   : 1;
   }           flags[2];
 } SizeRequestCache;
@@ -22,6 +22,7 @@
 #include "gtkslicelistmodel.h"
 
 #include "gtkintl.h"
+#include "gtklistmodelbulkprivate.h"
 #include "gtkprivate.h"
 
 /**
@@ -114,8 +115,28 @@ gtk_slice_list_model_model_init (GListModelInterface *iface)
   iface->get_item = gtk_slice_list_model_get_item;
 }
 
+static gboolean
+gtk_slice_list_model_get_items (GtkListModelBulk *list,
+                                guint             position,
+                                guint             n_items,
+                                gpointer         *items)
+{
+  GtkSliceListModel *self = GTK_SLICE_LIST_MODEL (list);
+
+  g_assert (position + n_items <= self->size);
+
+  return gtk_list_model_get_items (self->model, position + self->offset, n_items, items);
+}
+
+static void
+gtk_slice_list_model_bulk_init (GtkListModelBulkInterface *iface)
+{
+  iface->get_items = gtk_slice_list_model_get_items;
+}
+
 G_DEFINE_TYPE_WITH_CODE (GtkSliceListModel, gtk_slice_list_model, G_TYPE_OBJECT,
-                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_slice_list_model_model_init))
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, gtk_slice_list_model_model_init)
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_LIST_MODEL_BULK, gtk_slice_list_model_bulk_init))
 
 static void
 gtk_slice_list_model_items_changed_cb (GListModel        *model,
@@ -34,10 +34,15 @@
 
 #include "gtk/gskpango.h"
 
+/* A snapshot is made for every frame, and most of them never get
+ * deeper than this, so the stacks below don't need to be allocated
+ * and grown again every time.
+ */
 #define GDK_ARRAY_NAME gtk_snapshot_nodes
 #define GDK_ARRAY_TYPE_NAME GtkSnapshotNodes
 #define GDK_ARRAY_ELEMENT_TYPE GskRenderNode *
 #define GDK_ARRAY_FREE_FUNC gsk_render_node_unref
+#define GDK_ARRAY_PREALLOC 64
 #include "gdk/gdkarrayimpl.c"
 
 /**
@@ -70,7 +75,19 @@ struct _GtkSnapshotState {
   guint                  start_node_index;
   guint                  n_nodes;
 
+  /* The transform is followed by a translation by dx, dy. We track
+   * the translation separately, so that translating, which is what
+   * most widgets do, doesn't need to allocate a new GskTransform.
+   */
   GskTransform *         transform;
+  float                  dx;
+  float                  dy;
+
+  /* The area that ends up visible, in the coordinate system the
+   * nodes get collected in. Only valid if has_clip is set.
+   */
+  graphene_rect_t        clip;
+  guint                  has_clip : 1;
 
   GtkSnapshotCollectFunc collect_func;
   union {
@@ -120,6 +137,7 @@ static void gtk_snapshot_state_clear (GtkSnapshotState *state);
 #define GDK_ARRAY_ELEMENT_TYPE GtkSnapshotState
 #define GDK_ARRAY_FREE_FUNC gtk_snapshot_state_clear
 #define GDK_ARRAY_BY_VALUE 1
+#define GDK_ARRAY_PREALLOC 16
 #include "gdk/gdkarrayimpl.c"
 
 /* This is a nasty little hack. We typedef GtkSnapshot to the fake object GdkSnapshot
@@ -191,18 +209,72 @@ gtk_snapshot_collect_default (GtkSnapshot       *snapshot,
   return node;
 }
 
+static gboolean
+gtk_snapshot_untransform_bounds (GskTransform          *transform,
+                                 float                  translate_x,
+                                 float                  translate_y,
+                                 const graphene_rect_t *bounds,
+                                 graphene_rect_t       *out_bounds)
+{
+  float scale_x, scale_y, dx, dy;
+
+  if (gsk_transform_get_category (transform) < GSK_TRANSFORM_CATEGORY_2D_AFFINE)
+    return FALSE;
+
+  gsk_transform_to_affine (transform, &scale_x, &scale_y, &dx, &dy);
+  dx += scale_x * translate_x;
+  dy += scale_y * translate_y;
+  if (scale_x == 0 || scale_y == 0)
+    return FALSE;
+
+  graphene_rect_init (out_bounds,
+                      (bounds->origin.x - dx) / scale_x,
+                      (bounds->origin.y - dy) / scale_y,
+                      bounds->size.width / scale_x,
+                      bounds->size.height / scale_y);
+  graphene_rect_normalize (out_bounds);
+
+  return TRUE;
+}
+
 static GtkSnapshotState *
 gtk_snapshot_push_state (GtkSnapshot            *snapshot,
                          GskTransform           *transform,
+                         float                   dx,
+                         float                   dy,
                          GtkSnapshotCollectFunc  collect_func)
 {
   const gsize n_states = gtk_snapshot_states_get_size (&snapshot->state_stack);
   GtkSnapshotState *state;
+  graphene_rect_t clip;
+  gboolean has_clip = FALSE;
+
+  if (n_states > 0)
+    {
+      const GtkSnapshotState *previous = gtk_snapshot_states_get (&snapshot->state_stack, n_states - 1);
+
+      /* States that don't continue with the previous state's transform
+       * collect their nodes in its transformed coordinate system */
+      if (previous->has_clip && transform == previous->transform &&
+          dx == previous->dx && dy == previous->dy)
+        {
+          clip = previous->clip;
+          has_clip = TRUE;
+        }
+      else if (previous->has_clip)
+        has_clip = gtk_snapshot_untransform_bounds (previous->transform, previous->dx, previous->dy,
+                                                    &previous->clip, &clip);
+    }
 
   gtk_snapshot_states_set_size (&snapshot->state_stack, n_states + 1);
   state = gtk_snapshot_states_get (&snapshot->state_stack, n_states);
 
   state->transform = gsk_transform_ref (transform);
+  state->dx = dx;
+  state->dy = dy;
+  state->has_clip = has_clip;
+  if (has_clip)
+    state->clip = clip;
   state->collect_func = collect_func;
   state->start_node_index = gtk_snapshot_nodes_get_size (&snapshot->nodes);
   state->n_nodes = 0;
@@ -236,6 +308,21 @@ gtk_snapshot_state_clear (GtkSnapshotState *state)
   gsk_transform_unref (state->transform);
 }
 
+/* Folds the pending translation into the state's transform, so
+ * that it can be combined with other transforms.
+ */
+static void
+gtk_snapshot_state_flush_translation (GtkSnapshotState *state)
+{
+  if (state->dx == 0 && state->dy == 0)
+    return;
+
+  state->transform = gsk_transform_translate (state->transform,
+                                              &GRAPHENE_POINT_INIT (state->dx, state->dy));
+  state->dx = 0;
+  state->dy = 0;
+}
+
 /**
  * gtk_snapshot_new:
  *
@@ -254,7 +341,7 @@ gtk_snapshot_new (void)
   gtk_snapshot_nodes_init (&snapshot->nodes);
 
   gtk_snapshot_push_state (snapshot,
-                           NULL,
+                           NULL, 0, 0,
                            gtk_snapshot_collect_default);
 
   return snapshot;
@@ -318,6 +405,7 @@ gtk_snapshot_collect_autopush_transform (GtkSnapshot      *snapshot,
   if (node == NULL)
     return NULL;
 
+  gtk_snapshot_state_flush_translation (previous_state);
   transform_node = gsk_transform_node_new (node, previous_state->transform);
 
   gsk_render_node_unref (node);
@@ -329,7 +417,7 @@ static void
 gtk_snapshot_autopush_transform (GtkSnapshot *snapshot)
 {
   gtk_snapshot_push_state (snapshot,
-                           NULL,
+                           NULL, 0, 0,
                            gtk_snapshot_collect_autopush_transform);
 }
 
@@ -381,7 +469,7 @@ gtk_snapshot_push_debug (GtkSnapshot *snapshot,
       GtkSnapshotState *state;
 
       state = gtk_snapshot_push_state (snapshot,
-                                       current_state->transform,
+                                       current_state->transform, current_state->dx, current_state->dy,
                                        gtk_snapshot_collect_debug);
 
 
@@ -393,7 +481,7 @@ gtk_snapshot_push_debug (GtkSnapshot *snapshot,
   else
     {
       gtk_snapshot_push_state (snapshot,
-                               current_state->transform,
+                               current_state->transform, current_state->dx, current_state->dy,
                                gtk_snapshot_collect_default);
     }
 }
@@ -445,7 +533,7 @@ gtk_snapshot_push_opacity (GtkSnapshot *snapshot,
   GtkSnapshotState *state;
 
   state = gtk_snapshot_push_state (snapshot,
-                                   current_state->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_opacity);
   state->data.opacity.opacity = CLAMP (opacity, 0.0, 1.0);
 }
@@ -492,9 +580,11 @@ gtk_snapshot_push_blur (GtkSnapshot *snapshot,
   GtkSnapshotState *state;
 
   state = gtk_snapshot_push_state (snapshot,
-                                   current_state->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_blur);
   state->data.blur.radius = radius;
+  /* Content outside of the clip can be blurred into it */
+  state->has_clip = FALSE;
 }
 
 static GskRenderNode *
@@ -602,7 +692,7 @@ gtk_snapshot_push_color_matrix (GtkSnapshot             *snapshot,
   GtkSnapshotState *state;
 
   state = gtk_snapshot_push_state (snapshot,
-                                   current_state->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_color_matrix);
 
   graphene_matrix_init_from_matrix (&state->data.color_matrix.matrix, color_matrix);
@@ -700,6 +790,8 @@ gtk_snapshot_ensure_affine (GtkSnapshot *snapshot,
     }
   
   gsk_transform_to_affine (state->transform, scale_x, scale_y, dx, dy);
+  *dx += *scale_x * state->dx;
+  *dy += *scale_y * state->dy;
 }
 
 static void
@@ -716,6 +808,8 @@ gtk_snapshot_ensure_translate (GtkSnapshot *snapshot,
     }
   
   gsk_transform_to_translate (state->transform, dx, dy);
+  *dx += state->dx;
+  *dy += state->dy;
 }
 
 static void
@@ -723,7 +817,8 @@ gtk_snapshot_ensure_identity (GtkSnapshot *snapshot)
 {
   const GtkSnapshotState *state = gtk_snapshot_get_current_state (snapshot);
 
-  if (gsk_transform_get_category (state->transform) < GSK_TRANSFORM_CATEGORY_IDENTITY)
+  if (gsk_transform_get_category (state->transform) < GSK_TRANSFORM_CATEGORY_IDENTITY ||
+      state->dx != 0 || state->dy != 0)
     gtk_snapshot_autopush_transform (snapshot);
 }
 
@@ -743,6 +838,7 @@ gtk_snapshot_push_repeat (GtkSnapshot           *snapshot,
                           const graphene_rect_t *bounds,
                           const graphene_rect_t *child_bounds)
 {
+  GtkSnapshotState *current_state;
   GtkSnapshotState *state;
   graphene_rect_t real_child_bounds = { { 0 } };
   float scale_x, scale_y, dx, dy;
@@ -752,12 +848,16 @@ gtk_snapshot_push_repeat (GtkSnapshot           *snapshot,
   if (child_bounds)
     gtk_graphene_rect_scale_affine (child_bounds, scale_x, scale_y, dx, dy, &real_child_bounds);
 
+  current_state = gtk_snapshot_get_current_state (snapshot);
+
   state = gtk_snapshot_push_state (snapshot,
-                                   gtk_snapshot_get_current_state (snapshot)->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_repeat);
 
   gtk_graphene_rect_scale_affine (bounds, scale_x, scale_y, dx, dy, &state->data.repeat.bounds);
   state->data.repeat.child_bounds = real_child_bounds;
+  /* The child is repeated into places it wasn't drawn at */
+  state->has_clip = FALSE;
 }
 
 static GskRenderNode *
@@ -800,16 +900,25 @@ void
 gtk_snapshot_push_clip (GtkSnapshot           *snapshot,
                         const graphene_rect_t *bounds)
 {
+  GtkSnapshotState *current_state;
   GtkSnapshotState *state;
   float scale_x, scale_y, dx, dy;
  
   gtk_snapshot_ensure_affine (snapshot, &scale_x, &scale_y, &dx, &dy);
 
+  current_state = gtk_snapshot_get_current_state (snapshot);
+
   state = gtk_snapshot_push_state (snapshot,
-                                   gtk_snapshot_get_current_state (snapshot)->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_clip);
 
   gtk_graphene_rect_scale_affine (bounds, scale_x, scale_y, dx, dy, &state->data.clip.bounds);
+
+  if (state->has_clip)
+    graphene_rect_intersection (&state->clip, &state->data.clip.bounds, &state->clip);
+  else
+    state->clip = state->data.clip.bounds;
+  state->has_clip = TRUE;
 }
 
 static GskRenderNode *
@@ -867,16 +976,25 @@ void
 gtk_snapshot_push_rounded_clip (GtkSnapshot          *snapshot,
                                 const GskRoundedRect *bounds)
 {
+  GtkSnapshotState *current_state;
   GtkSnapshotState *state;
   float scale_x, scale_y, dx, dy;
 
   gtk_snapshot_ensure_affine (snapshot, &scale_x, &scale_y, &dx, &dy);
 
+  current_state = gtk_snapshot_get_current_state (snapshot);
+
   state = gtk_snapshot_push_state (snapshot,
-                                   gtk_snapshot_get_current_state (snapshot)->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_rounded_clip);
 
   gtk_rounded_rect_scale_affine (&state->data.rounded_clip.bounds, bounds, scale_x, scale_y, dx, dy);
+
+  if (state->has_clip)
+    graphene_rect_intersection (&state->clip, &state->data.rounded_clip.bounds.bounds, &state->clip);
+  else
+    state->clip = state->data.rounded_clip.bounds.bounds;
+  state->has_clip = TRUE;
 }
 
 static GskRenderNode *
@@ -922,7 +1040,7 @@ gtk_snapshot_push_shadow (GtkSnapshot     *snapshot,
   GtkSnapshotState *state;
 
   state = gtk_snapshot_push_state (snapshot,
-                                   current_state->transform,
+                                   current_state->transform, current_state->dx, current_state->dy,
                                    gtk_snapshot_collect_shadow);
 
   state->data.shadow.n_shadows = n_shadows;
@@ -937,6 +1055,8 @@ gtk_snapshot_push_shadow (GtkSnapshot     *snapshot,
       memcpy (state->data.shadow.shadows, shadow, sizeof (GskShadow) * n_shadows);
     }
 
+  /* Content outside of the clip can cast shadows into it */
+  state->has_clip = FALSE;
 }
 
 static GskRenderNode *
@@ -1003,12 +1123,12 @@ gtk_snapshot_push_blend (GtkSnapshot  *snapshot,
   GtkSnapshotState *top_state;
 
   top_state = gtk_snapshot_push_state (snapshot,
-                                       current_state->transform,
+                                       current_state->transform, current_state->dx, current_state->dy,
                                        gtk_snapshot_collect_blend_top);
   top_state->data.blend.blend_mode = blend_mode;
 
   gtk_snapshot_push_state (snapshot,
-                           top_state->transform,
+                           top_state->transform, top_state->dx, top_state->dy,
                            gtk_snapshot_collect_blend_bottom);
 }
 
@@ -1101,12 +1221,12 @@ gtk_snapshot_push_cross_fade (GtkSnapshot *snapshot,
   GtkSnapshotState *end_state;
 
   end_state = gtk_snapshot_push_state (snapshot,
-                                       current_state->transform,
+                                       current_state->transform, current_state->dx, current_state->dy,
                                        gtk_snapshot_collect_cross_fade_end);
   end_state->data.cross_fade.progress = progress;
 
   gtk_snapshot_push_state (snapshot,
-                           end_state->transform,
+                           end_state->transform, end_state->dx, end_state->dy,
                            gtk_snapshot_collect_cross_fade_start);
 }
 
@@ -1216,7 +1336,7 @@ void
 gtk_snapshot_push_collect (GtkSnapshot *snapshot)
 {
   gtk_snapshot_push_state (snapshot,
-                           NULL,
+                           NULL, 0, 0,
                            gtk_snapshot_collect_default);
 }
 
@@ -1228,6 +1348,49 @@ gtk_snapshot_pop_collect (GtkSnapshot *snapshot)
   return result;
 }
 
+/*
+ * gtk_snapshot_get_clip_bounds:
+ * @snapshot: a #GtkSnapshot
+ * @out_bounds: (out caller-allocates): return location for the clip
+ *
+ * PRIVATE.
+ *
+ * Gets the bounds of the area that the clips pushed so far leave
+ * visible, in the current coordinate system. Nodes that are appended
+ * outside of it will not be visible.
+ *
+ * Returns: %FALSE if nothing clips the snapshot, or the clip can't
+ *   be expressed as a rectangle in the current coordinate system
+ */
+gboolean
+gtk_snapshot_get_clip_bounds (GtkSnapshot     *snapshot,
+                              graphene_rect_t *out_bounds)
+{
+  const GtkSnapshotState *state = gtk_snapshot_get_current_state (snapshot);
+
+  if (!state->has_clip)
+    return FALSE;
+
+  return gtk_snapshot_untransform_bounds (state->transform, state->dx, state->dy,
+                                          &state->clip, out_bounds);
+}
+
+/*
+ * gtk_snapshot_unset_clip:
+ * @snapshot: a #GtkSnapshot
+ *
+ * PRIVATE.
+ *
+ * Makes gtk_snapshot_get_clip_bounds() ignore the clips pushed so
+ * far, until the current state is popped. This does not change what
+ * ends up visible.
+ */
+void
+gtk_snapshot_unset_clip (GtkSnapshot *snapshot)
+{
+  gtk_snapshot_get_current_state (snapshot)->has_clip = FALSE;
+}
+
 /**
  * gtk_snapshot_to_node:
  * @snapshot: a #GtkSnapshot
@@ -1338,10 +1501,14 @@ gtk_snapshot_pop (GtkSnapshot *snapshot)
 void
 gtk_snapshot_save (GtkSnapshot *snapshot)
 {
+  GtkSnapshotState *current_state;
+
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
+  current_state = gtk_snapshot_get_current_state (snapshot);
+
   gtk_snapshot_push_state (snapshot,
-                           gtk_snapshot_get_current_state (snapshot)->transform,
+                           current_state->transform, current_state->dx, current_state->dy,
                            NULL);
 }
 
@@ -1394,6 +1561,18 @@ gtk_snapshot_transform (GtkSnapshot  *snapshot,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
   state = gtk_snapshot_get_current_state (snapshot);
+
+  if (gsk_transform_get_category (transform) >= GSK_TRANSFORM_CATEGORY_2D_TRANSLATE)
+    {
+      float dx, dy;
+
+      gsk_transform_to_translate (transform, &dx, &dy);
+      state->dx += dx;
+      state->dy += dy;
+      return;
+    }
+
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_transform (state->transform, transform);
 }
 
@@ -1414,6 +1593,7 @@ gtk_snapshot_transform_matrix (GtkSnapshot             *snapshot,
   g_return_if_fail (matrix != NULL);
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_matrix (state->transform, matrix);
 }
 
@@ -1434,7 +1614,8 @@ gtk_snapshot_translate (GtkSnapshot            *snapshot,
   g_return_if_fail (point != NULL);
 
   state = gtk_snapshot_get_current_state (snapshot);
-  state->transform = gsk_transform_translate (state->transform, point);
+  state->dx += point->x;
+  state->dy += point->y;
 }
 
 /**
@@ -1454,6 +1635,7 @@ gtk_snapshot_translate_3d (GtkSnapshot              *snapshot,
   g_return_if_fail (point != NULL);
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_translate_3d (state->transform, point);
 }
 
@@ -1474,6 +1656,7 @@ gtk_snapshot_rotate (GtkSnapshot *snapshot,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_rotate (state->transform, angle);
 }
 
@@ -1498,6 +1681,7 @@ gtk_snapshot_rotate_3d (GtkSnapshot           *snapshot,
   g_return_if_fail (axis != NULL);
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_rotate_3d (state->transform, angle, axis);
 }
 
@@ -1522,6 +1706,7 @@ gtk_snapshot_scale (GtkSnapshot *snapshot,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_scale (state->transform, factor_x, factor_y);
 }
 
@@ -1545,6 +1730,7 @@ gtk_snapshot_scale_3d (GtkSnapshot *snapshot,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_scale_3d (state->transform, factor_x, factor_y, factor_z);
 }
 
@@ -1566,6 +1752,7 @@ gtk_snapshot_perspective (GtkSnapshot *snapshot,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
 
   state = gtk_snapshot_get_current_state (snapshot);
+  gtk_snapshot_state_flush_translation (state);
   state->transform = gsk_transform_perspective (state->transform, depth);
 }
 
@@ -34,6 +34,10 @@ void                    gtk_snapshot_append_text                (GtkSnapshot
 void                    gtk_snapshot_push_collect               (GtkSnapshot            *snapshot);
 GskRenderNode *         gtk_snapshot_pop_collect                (GtkSnapshot            *snapshot);
 
+gboolean                gtk_snapshot_get_clip_bounds            (GtkSnapshot            *snapshot,
+                                                                 graphene_rect_t        *out_bounds);
+void                    gtk_snapshot_unset_clip                 (GtkSnapshot            *snapshot);
+
 G_END_DECLS
 
 #endif /* __GTK_SNAPSHOT_PRIVATE_H__ */
@@ -298,6 +298,8 @@ gtk_sorter_get_keys (GtkSorter *self)
 
   fallback = gtk_sort_keys_new (GtkDefaultSortKeys, &GTK_DEFAULT_SORT_KEYS_CLASS, sizeof (gpointer), sizeof (gpointer));
   fallback->sorter = g_object_ref (self);
+  /* gtk_sorter_compare() can be anything */
+  fallback->keys.thread_unsafe = TRUE;
 
   return (GtkSortKeys *) fallback;
 }
@@ -95,6 +95,38 @@ gtk_sort_keys_needs_clear_key (GtkSortKeys *self)
   return self->klass->clear_key != NULL;
 }
 
+/*<private>
+ * gtk_sort_keys_is_thread_safe:
+ * @self: a #GtkSortKeys
+ *
+ * Checks if keys can be initialized and compared in a thread, while
+ * the main thread keeps running. The items are kept alive for as long
+ * as that happens.
+ *
+ * Returns: %TRUE if @self can be used from other threads
+ **/
+gboolean
+gtk_sort_keys_is_thread_safe (GtkSortKeys *self)
+{
+  return !self->thread_unsafe;
+}
+
+/*<private>
+ * gtk_sort_keys_has_prefix:
+ * @self: a #GtkSortKeys
+ *
+ * Checks if @self can provide key prefixes with
+ * gtk_sort_keys_get_prefix(). Those allow sorting by radix
+ * instead of calling the compare function for every comparison.
+ *
+ * Returns: %TRUE if @self has key prefixes
+ **/
+gboolean
+gtk_sort_keys_has_prefix (GtkSortKeys *self)
+{
+  return self->klass->key_prefix != NULL;
+}
+
 static void
 gtk_equal_sort_keys_free (GtkSortKeys *keys)
 {
@@ -32,6 +32,12 @@ struct _GtkSortKeys
 
   gsize key_size;
   gsize key_align; /* must be power of 2 */
+
+  /* Set by keys whose init_key or key_compare may only be called on
+   * the main thread, like ones that call out to application code. */
+  gboolean thread_unsafe;
+  /* Set if keys with equal prefixes are always equal */
+  gboolean prefix_is_key;
 };
 
 struct _GtkSortKeysClass
@@ -48,6 +54,10 @@ struct _GtkSortKeysClass
                                                                  gpointer                key_memory);
   void                  (* clear_key)                           (GtkSortKeys            *self,
                                                                  gpointer                key_memory);
+
+  /* optional, see gtk_sort_keys_get_prefix() */
+  guint64               (* key_prefix)                          (GtkSortKeys            *self,
+                                                                 gconstpointer           key_memory);
 };
 
 GtkSortKeys *           gtk_sort_keys_alloc                     (const GtkSortKeysClass *klass,
@@ -67,6 +77,8 @@ GCompareDataFunc        gtk_sort_keys_get_key_compare_func      (GtkSortKeys
 gboolean                gtk_sort_keys_is_compatible             (GtkSortKeys            *self,
                                                                  GtkSortKeys            *other);
 gboolean                gtk_sort_keys_needs_clear_key           (GtkSortKeys            *self);
+gboolean                gtk_sort_keys_is_thread_safe            (GtkSortKeys            *self);
+gboolean                gtk_sort_keys_has_prefix                (GtkSortKeys            *self);
 
 #define GTK_SORT_KEYS_ALIGN(_size,_align) (((_size) + (_align) - 1) & ~((_align) - 1))
 static inline int
@@ -85,6 +97,17 @@ gtk_sort_keys_init_key (GtkSortKeys *self,
   self->klass->init_key (self, item, key_memory);
 }
 
+/* Returns a number that sorts like the key, so that if a key is
+ * smaller than another, its prefix is smaller or equal. If prefixes
+ * are equal, the keys need to be compared, unless prefix_is_key is set.
+ */
+static inline guint64
+gtk_sort_keys_get_prefix (GtkSortKeys   *self,
+                          gconstpointer  key_memory)
+{
+  return self->klass->key_prefix (self, key_memory);
+}
+
 static inline void
 gtk_sort_keys_clear_key (GtkSortKeys *self,
                          gpointer       key_memory)
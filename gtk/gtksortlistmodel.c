@@ -23,6 +23,7 @@
 
 #include "gtkbitset.h"
 #include "gtkintl.h"
+#include "gtklistmodelbulkprivate.h"
 #include "gtkprivate.h"
 #include "gtksorterprivate.h"
 #include "timsort/gtktimsortprivate.h"
@@ -52,6 +53,35 @@
  */
 #define GTK_SORT_STEP_TIME_US (1000) /* 1 millisecond */
 
+/* The minimum number of items to sort in threads
+ *
+ * When sorting incrementally and the sort keys are thread-safe, models
+ * with at least this many items get their keys created and sorted in
+ * threads instead of in steps in the main thread. Below this size,
+ * handing the work to threads isn't worth it.
+ */
+#define GTK_SORT_THREAD_MIN_ITEMS (50000)
+
+/* The minimum number of items to sort by key prefix
+ *
+ * When the sort keys provide prefixes, a complete sort is done as a
+ * radix sort of the prefixes, and only items with equal prefixes get
+ * compared. For small models, that's not faster than just comparing.
+ */
+#define GTK_SORT_PREFIX_MIN_ITEMS (1024)
+
+/* The maximum ratio of added to sorted items to insert directly
+ *
+ * When items are added to a sorted model, they are sorted by themselves
+ * and then inserted at the positions found by binary search, which
+ * takes O(k log n) comparisons. When more items are added, merging them
+ * as a run with the existing items is not slower.
+ */
+#define GTK_SORT_INSERT_MAX_RATIO (8)
+
+/* The maximum number of threads to sort in */
+#define GTK_SORT_MAX_THREADS (8)
+
 /**
  * SECTION:gtksortlistmodel
  * @title: GtkSortListModel
@@ -81,6 +111,53 @@ enum {
   NUM_PROPERTIES
 };
 
+typedef struct _GtkSortJob GtkSortJob;
+typedef struct _GtkSortJobChunk GtkSortJobChunk;
+
+/* A sort running in threads.
+ *
+ * Every chunk creates the missing keys for a range of items and sorts
+ * that range. The last chunk to finish merges the sorted ranges. All of
+ * this happens on a copy of the positions, which replaces the model's
+ * positions in one go when the sort is done, so there's only one
+ * ::items-changed emission.
+ *
+ * While a job is running, the main thread must not touch the keys.
+ * Everything that would has to stop the sort first.
+ */
+struct _GtkSortJobChunk
+{
+  GtkSortJob *job;
+  guint start;
+  guint end;
+  guint n_done; /* items from start that have a key */
+};
+
+struct _GtkSortJob
+{
+  GtkSortListModel *model; /* only used in the main thread */
+  GtkSortKeys *sort_keys;
+  gpointer keys;
+  gsize key_size;
+
+  guint n_items;
+  gpointer *items; /* for every missing key, NULL otherwise */
+  guint n_missing;
+  gpointer *positions;
+
+  guint n_chunks;
+  GtkSortJobChunk chunks[GTK_SORT_MAX_THREADS];
+
+  int n_running; /* atomic */
+  int n_done_keys; /* atomic, for progress */
+  int cancelled; /* atomic */
+
+  GMutex lock;
+  GCond cond;
+  gboolean finished; /* protected by lock */
+  guint done_cb; /* protected by lock */
+};
+
 struct _GtkSortListModel
 {
   GObject parent_instance;
@@ -91,6 +168,8 @@ struct _GtkSortListModel
 
   GtkTimSort sort; /* ongoing sort operation */
   guint sort_cb; /* 0 or current ongoing sort callback */
+  gboolean sort_by_prefix; /* the sort to finish is done by prefix */
+  GtkSortJob *sort_job; /* NULL or current sort in threads */
 
   guint n_items;
   GtkSortKeys *sort_keys;
@@ -175,13 +254,370 @@ G_DEFINE_TYPE_WITH_CODE (GtkSortListModel, gtk_sort_list_model, G_TYPE_OBJECT,
 static gboolean
 gtk_sort_list_model_is_sorting (GtkSortListModel *self)
 {
-  return self->sort_cb != 0;
+  return self->sort_cb != 0 || self->sort_job != NULL;
+}
+
+static int sort_func (gconstpointer a,
+                      gconstpointer b,
+                      gpointer      data);
+
+static gboolean
+gtk_sort_job_is_cancelled (GtkSortJob *job)
+{
+  return g_atomic_int_get (&job->cancelled);
+}
+
+static gboolean gtk_sort_list_model_sort_job_done_cb (gpointer data);
+
+typedef struct
+{
+  guint64 prefix;
+  gpointer key;
+} PrefixItem;
+
+/* Sorts @positions by doing a LSD radix sort of the key prefixes,
+ * and then comparing keys with equal prefixes. @positions must be
+ * sorted by address, so equal keys stay in the order sort_func()
+ * wants them.
+ */
+static void
+sort_by_prefix (GtkSortKeys *sort_keys,
+                gpointer    *positions,
+                gsize        n_items)
+{
+  gsize counts[8][256] = { { 0, }, };
+  PrefixItem *items, *tmp, *swap;
+  gsize i, start;
+  guint byte;
+
+  if (n_items < 2)
+    return;
+
+  items = g_new (PrefixItem, n_items);
+  tmp = g_new (PrefixItem, n_items);
+
+  for (i = 0; i < n_items; i++)
+    {
+      items[i].prefix = gtk_sort_keys_get_prefix (sort_keys, positions[i]);
+      items[i].key = positions[i];
+      for (byte = 0; byte < 8; byte++)
+        counts[byte][(items[i].prefix >> (byte * 8)) & 0xFF]++;
+    }
+
+  for (byte = 0; byte < 8; byte++)
+    {
+      gsize offsets[256];
+      gsize sum = 0;
+      guint shift = byte * 8;
+      guint b;
+
+      /* all items have the same value in this byte */
+      if (counts[byte][(items[0].prefix >> shift) & 0xFF] == n_items)
+        continue;
+
+      for (b = 0; b < 256; b++)
+        {
+          offsets[b] = sum;
+          sum += counts[byte][b];
+        }
+
+      for (i = 0; i < n_items; i++)
+        tmp[offsets[(items[i].prefix >> shift) & 0xFF]++] = items[i];
+
+      swap = items;
+      items = tmp;
+      tmp = swap;
+    }
+
+  for (i = 0; i < n_items; i++)
+    positions[i] = items[i].key;
+
+  if (!sort_keys->prefix_is_key)
+    {
+      for (start = 0; start < n_items; start = i)
+        {
+          for (i = start + 1; i < n_items && items[i].prefix == items[start].prefix; i++)
+            ;
+          if (i - start > 1)
+            gtk_tim_sort (positions + start, i - start, sizeof (gpointer), sort_func, sort_keys);
+        }
+    }
+
+  g_free (items);
+  g_free (tmp);
+}
+
+static void
+gtk_sort_job_merge (GtkSortJob *job)
+{
+  gsize runs[GTK_SORT_MAX_THREADS + 1];
+  GtkTimSortRun change;
+  GtkTimSort sort;
+  guint i;
+
+  for (i = 0; i < job->n_chunks; i++)
+    runs[i] = job->chunks[i].end - job->chunks[i].start;
+  runs[i] = 0;
+
+  gtk_tim_sort_init (&sort, job->positions, job->n_items, sizeof (gpointer), sort_func, job->sort_keys);
+  gtk_tim_sort_set_runs (&sort, runs);
+  /* limit merges, so cancelling doesn't have to wait long */
+  gtk_tim_sort_set_max_merge_size (&sort, GTK_SORT_MAX_MERGE_SIZE * 64);
+  while (!gtk_sort_job_is_cancelled (job) && gtk_tim_sort_step (&sort, &change))
+    ;
+  gtk_tim_sort_finish (&sort);
+}
+
+static void
+gtk_sort_job_chunk_run (gpointer data,
+                        gpointer unused)
+{
+  GtkSortJobChunk *chunk = data;
+  GtkSortJob *job = chunk->job;
+  GtkTimSortRun change;
+  GtkTimSort sort;
+  guint i;
+
+  for (i = chunk->start; i < chunk->end; i++)
+    {
+      if (i % 1024 == 0 && gtk_sort_job_is_cancelled (job))
+        break;
+
+      if (job->items[i])
+        {
+          gtk_sort_keys_init_key (job->sort_keys, job->items[i], (char *) job->keys + job->key_size * i);
+          g_atomic_int_inc (&job->n_done_keys);
+        }
+    }
+  chunk->n_done = i - chunk->start;
+
+  if (gtk_sort_job_is_cancelled (job))
+    {
+      /* nothing to do */
+    }
+  else if (gtk_sort_keys_has_prefix (job->sort_keys))
+    {
+      sort_by_prefix (job->sort_keys, job->positions + chunk->start, chunk->end - chunk->start);
+    }
+  else
+    {
+      gtk_tim_sort_init (&sort,
+                         job->positions + chunk->start,
+                         chunk->end - chunk->start,
+                         sizeof (gpointer),
+                         sort_func,
+                         job->sort_keys);
+      gtk_tim_sort_set_max_merge_size (&sort, GTK_SORT_MAX_MERGE_SIZE * 64);
+      while (!gtk_sort_job_is_cancelled (job) && gtk_tim_sort_step (&sort, &change))
+        ;
+      gtk_tim_sort_finish (&sort);
+    }
+
+  if (!g_atomic_int_dec_and_test (&job->n_running))
+    return;
+
+  if (!gtk_sort_job_is_cancelled (job))
+    gtk_sort_job_merge (job);
+
+  g_mutex_lock (&job->lock);
+  job->finished = TRUE;
+  if (!gtk_sort_job_is_cancelled (job))
+    job->done_cb = g_idle_add (gtk_sort_list_model_sort_job_done_cb, job);
+  g_cond_broadcast (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static GThreadPool *
+get_sort_pool (void)
+{
+  static GThreadPool *pool;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new (gtk_sort_job_chunk_run, NULL,
+                                    CLAMP (g_get_num_processors (), 1, GTK_SORT_MAX_THREADS),
+                                    FALSE, NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  return pool;
+}
+
+static gboolean
+gtk_sort_list_model_should_sort_in_threads (GtkSortListModel *self,
+                                            gsize            *runs)
+{
+  /* With existing runs, the incremental sort has less work to do */
+  return self->incremental &&
+         runs == NULL &&
+         self->n_items >= GTK_SORT_THREAD_MIN_ITEMS &&
+         gtk_sort_keys_is_thread_safe (self->sort_keys);
+}
+
+static void
+gtk_sort_list_model_start_sort_job (GtkSortListModel *self)
+{
+  GtkSortJob *job;
+  GtkBitsetIter iter;
+  GtkListModelReader reader;
+  guint i, pos, chunk_size;
+
+  g_assert (self->sort_job == NULL);
+
+  job = g_new0 (GtkSortJob, 1);
+  job->model = self;
+  job->sort_keys = gtk_sort_keys_ref (self->sort_keys);
+  job->keys = self->keys;
+  job->key_size = self->key_size;
+  job->n_items = self->n_items;
+  g_mutex_init (&job->lock);
+  g_cond_init (&job->cond);
+
+  /* The model and its items may only be accessed in the main thread */
+  job->items = g_new0 (gpointer, self->n_items);
+  gtk_list_model_reader_init (&reader, self->model);
+  for (gtk_bitset_iter_init_first (&iter, self->missing_keys, &pos);
+       gtk_bitset_iter_is_valid (&iter);
+       gtk_bitset_iter_next (&iter, &pos))
+    {
+      job->items[pos] = g_object_ref (gtk_list_model_reader_get (&reader, pos));
+      job->n_missing++;
+    }
+  gtk_list_model_reader_clear (&reader);
+
+  /* Ties are broken by position, so the result doesn't depend on
+   * the order we start with, and chunks can sort their own keys.
+   */
+  job->positions = g_new (gpointer, self->n_items);
+  for (i = 0; i < self->n_items; i++)
+    job->positions[i] = key_from_pos (self, i);
+
+  job->n_chunks = CLAMP (g_get_num_processors (), 1, GTK_SORT_MAX_THREADS);
+  chunk_size = (self->n_items + job->n_chunks - 1) / job->n_chunks;
+  job->n_chunks = (self->n_items + chunk_size - 1) / chunk_size;
+  job->n_running = job->n_chunks;
+
+  self->sort_job = job;
+
+  for (i = 0; i < job->n_chunks; i++)
+    {
+      job->chunks[i].job = job;
+      job->chunks[i].start = i * chunk_size;
+      job->chunks[i].end = MIN ((i + 1) * chunk_size, self->n_items);
+      g_thread_pool_push (get_sort_pool (), &job->chunks[i], NULL);
+    }
+}
+
+static void
+gtk_sort_job_wait (GtkSortJob *job)
+{
+  g_mutex_lock (&job->lock);
+  while (!job->finished)
+    g_cond_wait (&job->cond, &job->lock);
+  g_clear_handle_id (&job->done_cb, g_source_remove);
+  g_mutex_unlock (&job->lock);
+}
+
+static void
+gtk_sort_job_free (GtkSortJob *job)
+{
+  guint i;
+
+  for (i = 0; i < job->n_items; i++)
+    g_clear_object (&job->items[i]);
+  g_free (job->items);
+  g_free (job->positions);
+  gtk_sort_keys_unref (job->sort_keys);
+  g_mutex_clear (&job->lock);
+  g_cond_clear (&job->cond);
+  g_free (job);
+}
+
+/* Cancels the job and keeps the keys that were created, but not the
+ * sorting done so far.
+ */
+static void
+gtk_sort_list_model_cancel_sort_job (GtkSortListModel *self)
+{
+  GtkSortJob *job = self->sort_job;
+  guint i;
+
+  g_atomic_int_set (&job->cancelled, TRUE);
+  gtk_sort_job_wait (job);
+
+  for (i = 0; i < job->n_chunks; i++)
+    {
+      if (job->chunks[i].n_done)
+        gtk_bitset_remove_range (self->missing_keys, job->chunks[i].start, job->chunks[i].n_done);
+    }
+
+  self->sort_job = NULL;
+  gtk_sort_job_free (job);
+}
+
+/* Replaces the positions with the sorted @positions and
+ * returns the range that changed.
+ */
+static void
+gtk_sort_list_model_replace_positions (GtkSortListModel *self,
+                                       gpointer         *positions,
+                                       guint            *out_position,
+                                       guint            *out_n_items)
+{
+  guint start, end;
+
+  for (start = 0; start < self->n_items; start++)
+    {
+      if (self->positions[start] != positions[start])
+        break;
+    }
+  for (end = self->n_items; end > start; end--)
+    {
+      if (self->positions[end - 1] != positions[end - 1])
+        break;
+    }
+
+  *out_position = end > start ? start : 0;
+  *out_n_items = end - start;
+
+  g_free (self->positions);
+  self->positions = positions;
+}
+
+static void
+gtk_sort_list_model_finish_sort_job (GtkSortListModel *self,
+                                     guint            *out_position,
+                                     guint            *out_n_items)
+{
+  GtkSortJob *job = self->sort_job;
+
+  gtk_sort_job_wait (job);
+
+  gtk_sort_list_model_replace_positions (self, g_steal_pointer (&job->positions), out_position, out_n_items);
+  gtk_bitset_remove_all (self->missing_keys);
+
+  self->sort_job = NULL;
+  gtk_sort_job_free (job);
 }
 
 static void
 gtk_sort_list_model_stop_sorting (GtkSortListModel *self,
                                   gsize            *runs)
 {
+  if (self->sort_job)
+    {
+      /* The positions are still in the order from before the sort */
+      gtk_sort_list_model_cancel_sort_job (self);
+      if (runs)
+        runs[0] = 0;
+
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+      return;
+    }
+
   if (self->sort_cb == 0)
     {
       if (runs)
@@ -216,24 +652,27 @@ gtk_sort_list_model_sort_step (GtkSortListModel *self,
   if (!gtk_bitset_is_empty (self->missing_keys))
     {
       GtkBitsetIter iter;
+      GtkListModelReader reader;
       guint pos;
 
+      gtk_list_model_reader_init (&reader, self->model);
       for (gtk_bitset_iter_init_first (&iter, self->missing_keys, &pos);
            gtk_bitset_iter_is_valid (&iter);
            gtk_bitset_iter_next (&iter, &pos))
         {
-          gpointer item = g_list_model_get_item (self->model, pos);
+          gpointer item = gtk_list_model_reader_get (&reader, pos);
           gtk_sort_keys_init_key (self->sort_keys, item, key_from_pos (self, pos));
-          g_object_unref (item);
 
           if (g_get_monotonic_time () >= end_time && !finish)
             {
+              gtk_list_model_reader_clear (&reader);
               gtk_bitset_remove_range_closed (self->missing_keys, 0, pos);
               *out_position = 0;
               *out_n_items = 0;
               return TRUE;
             }
         }
+      gtk_list_model_reader_clear (&reader);
       result = TRUE;
       gtk_bitset_remove_all (self->missing_keys);
     }
@@ -268,6 +707,31 @@ gtk_sort_list_model_sort_step (GtkSortListModel *self,
   return result;
 }
 
+static gboolean
+gtk_sort_list_model_sort_job_done_cb (gpointer data)
+{
+  GtkSortJob *job = data;
+  GtkSortListModel *self = job->model;
+  guint pos, n_items;
+
+  /* Everything that gets rid of the job before it is done
+   * removes this callback first.
+   */
+  g_assert (self->sort_job == job);
+
+  g_mutex_lock (&job->lock);
+  job->done_cb = 0;
+  g_mutex_unlock (&job->lock);
+
+  gtk_sort_list_model_finish_sort_job (self, &pos, &n_items);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+  if (n_items)
+    g_list_model_items_changed (G_LIST_MODEL (self), pos, n_items, n_items);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean
 gtk_sort_list_model_sort_cb (gpointer data)
 {
@@ -307,6 +771,23 @@ gtk_sort_list_model_start_sorting (GtkSortListModel *self,
                                    gsize            *runs)
 {
   g_assert (self->sort_cb == 0);
+  g_assert (self->sort_job == NULL);
+
+  if (gtk_sort_list_model_should_sort_in_threads (self, runs))
+    {
+      gtk_sort_list_model_start_sort_job (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+      return TRUE;
+    }
+
+  if (!self->incremental &&
+      runs == NULL &&
+      self->n_items >= GTK_SORT_PREFIX_MIN_ITEMS &&
+      gtk_sort_keys_has_prefix (self->sort_keys))
+    {
+      self->sort_by_prefix = TRUE;
+      return FALSE;
+    }
 
   gtk_tim_sort_init (&self->sort,
                      self->positions,
@@ -327,11 +808,55 @@ gtk_sort_list_model_start_sorting (GtkSortListModel *self,
   return TRUE;
 }
 
+static void
+gtk_sort_list_model_sort_by_prefix (GtkSortListModel *self,
+                                    guint            *pos,
+                                    guint            *n_items)
+{
+  GtkBitsetIter iter;
+  GtkListModelReader reader;
+  gpointer *positions;
+  guint i;
+
+  gtk_list_model_reader_init (&reader, self->model);
+  for (gtk_bitset_iter_init_first (&iter, self->missing_keys, &i);
+       gtk_bitset_iter_is_valid (&iter);
+       gtk_bitset_iter_next (&iter, &i))
+    {
+      gpointer item = gtk_list_model_reader_get (&reader, i);
+      gtk_sort_keys_init_key (self->sort_keys, item, key_from_pos (self, i));
+    }
+  gtk_list_model_reader_clear (&reader);
+  gtk_bitset_remove_all (self->missing_keys);
+
+  positions = g_new (gpointer, self->n_items);
+  for (i = 0; i < self->n_items; i++)
+    positions[i] = key_from_pos (self, i);
+
+  sort_by_prefix (self->sort_keys, positions, self->n_items);
+
+  gtk_sort_list_model_replace_positions (self, positions, pos, n_items);
+}
+
 static void
 gtk_sort_list_model_finish_sorting (GtkSortListModel *self,
                                     guint            *pos,
                                     guint            *n_items)
 {
+  if (self->sort_by_prefix)
+    {
+      self->sort_by_prefix = FALSE;
+      gtk_sort_list_model_sort_by_prefix (self, pos, n_items);
+      return;
+    }
+
+  if (self->sort_job)
+    {
+      gtk_sort_list_model_finish_sort_job (self, pos, n_items);
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PENDING]);
+      return;
+    }
+
   gtk_tim_sort_set_max_merge_size (&self->sort, 0);
 
   gtk_sort_list_model_sort_step (self, TRUE, pos, n_items);
@@ -558,6 +1083,85 @@ gtk_sort_list_model_update_items (GtkSortListModel *self,
   *unmodified_end = end;
 }
 
+static gboolean
+gtk_sort_list_model_can_insert_sorted (GtkSortListModel *self,
+                                       gsize            *runs,
+                                       guint             added)
+{
+  guint n_sorted = self->n_items - added;
+
+  return n_sorted > 0 &&
+         runs[0] == n_sorted &&
+         added <= n_sorted / GTK_SORT_INSERT_MAX_RATIO &&
+         gtk_bitset_get_size (self->missing_keys) == added;
+}
+
+/* Inserts the items added at @position into the sorted positions
+ * without sorting them again. update_items() has put the added items
+ * at the end of the positions, and all other items must be sorted and
+ * have keys.
+ *
+ * Returns the first and last positions that items were inserted at.
+ */
+static void
+gtk_sort_list_model_insert_sorted (GtkSortListModel *self,
+                                   guint             position,
+                                   guint             added,
+                                   guint            *out_first,
+                                   guint            *out_last)
+{
+  GtkListModelReader reader;
+  gpointer *batch;
+  guint *insert;
+  guint i, lo, hi, n_sorted, end;
+
+  n_sorted = self->n_items - added;
+
+  gtk_list_model_reader_init (&reader, self->model);
+  for (i = position; i < position + added; i++)
+    gtk_sort_keys_init_key (self->sort_keys, gtk_list_model_reader_get (&reader, i), key_from_pos (self, i));
+  gtk_list_model_reader_clear (&reader);
+  gtk_bitset_remove_range (self->missing_keys, position, added);
+
+  batch = g_memdup (self->positions + n_sorted, sizeof (gpointer) * added);
+  g_qsort_with_data (batch, added, sizeof (gpointer), sort_func, self->sort_keys);
+
+  /* The batch is sorted, so every insertion point is at or after the previous one */
+  insert = g_new (guint, added);
+  lo = 0;
+  for (i = 0; i < added; i++)
+    {
+      hi = n_sorted;
+      while (lo < hi)
+        {
+          guint mid = lo + (hi - lo) / 2;
+
+          if (sort_func (&self->positions[mid], &batch[i], self->sort_keys) < 0)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+      insert[i] = lo;
+    }
+
+  /* Merge from the back, so every item is moved only once */
+  end = n_sorted;
+  for (i = added; i-- > 0;)
+    {
+      memmove (&self->positions[insert[i] + i + 1],
+               &self->positions[insert[i]],
+               sizeof (gpointer) * (end - insert[i]));
+      self->positions[insert[i] + i] = batch[i];
+      end = insert[i];
+    }
+
+  *out_first = insert[0];
+  *out_last = insert[added - 1] + added - 1;
+
+  g_free (insert);
+  g_free (batch);
+}
+
 static void
 gtk_sort_list_model_items_changed_cb (GListModel       *model,
                                       guint             position,
@@ -586,7 +1190,15 @@ gtk_sort_list_model_items_changed_cb (GListModel       *model,
 
   if (added > 0)
     {
-      if (gtk_sort_list_model_start_sorting (self, runs))
+      if (!was_sorting && gtk_sort_list_model_can_insert_sorted (self, runs, added))
+        {
+          guint first, last;
+
+          gtk_sort_list_model_insert_sorted (self, position, added, &first, &last);
+          start = MIN (start, first);
+          end = MIN (end, self->n_items - last - 1);
+        }
+      else if (gtk_sort_list_model_start_sorting (self, runs))
         {
           end = 0;
         }
@@ -981,6 +1593,11 @@ gtk_sort_list_model_get_sorter (GtkSortListModel *self)
  * turning this on. Depending on your model and sorters, this may become
  * interesting around 10,000 to 100,000 items.
  *
+ * For large models, the sort keys of string and numeric sorters are
+ * created and sorted in threads, and the sorted items appear all at
+ * once. Their expressions are then evaluated in those threads, so the
+ * properties they read must not change while sorting.
+ *
  * By default, incremental sorting is disabled.
  *
  * See gtk_sort_list_model_get_pending() for progress information
@@ -1054,6 +1671,9 @@ gtk_sort_list_model_get_pending (GtkSortListModel *self)
 {
   g_return_val_if_fail (GTK_IS_SORT_LIST_MODEL (self), FALSE);
 
+  if (self->sort_job)
+    return (self->n_items + self->sort_job->n_missing - g_atomic_int_get (&self->sort_job->n_done_keys)) / 2;
+
   if (self->sort_cb == 0)
     return 0;
 
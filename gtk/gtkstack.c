@@ -25,6 +25,7 @@
 #include "gtkstack.h"
 #include "gtkprivate.h"
 #include "gtkintl.h"
+#include "gtklazypageprivate.h"
 #include "gtkprogresstrackerprivate.h"
 #include "gtksettingsprivate.h"
 #include "gtksnapshot.h"
@@ -1266,6 +1267,41 @@ stack_child_visibility_notify_cb (GObject    *obj,
   update_child_visible (stack, child_info);
 }
 
+/**
+ * gtk_stack_add_lazy:
+ * @stack: a #GtkStack
+ * @create_func: function that creates the child
+ * @user_data: (closure): user data passed to @create_func
+ * @user_data_free_func: function for freeing @user_data
+ * @name: (nullable): the name for the page or %NULL
+ *
+ * Adds a page to @stack whose child is only created when
+ * the page is shown for the first time.
+ *
+ * Pages that are never shown don't need to be styled or
+ * measured, which makes stacks with many pages cheaper.
+ * Until it is shown, the page is empty and has no size.
+ *
+ * The child of the returned page is a container for the
+ * widget that @create_func returns, not the widget itself.
+ *
+ * Returns: (transfer none): the #GtkStackPage for the page
+ */
+GtkStackPage *
+gtk_stack_add_lazy (GtkStack                *stack,
+                    GtkStackCreateChildFunc  create_func,
+                    gpointer                 user_data,
+                    GDestroyNotify           user_data_free_func,
+                    const char              *name)
+{
+  g_return_val_if_fail (GTK_IS_STACK (stack), NULL);
+  g_return_val_if_fail (create_func != NULL, NULL);
+
+  return gtk_stack_add_internal (stack,
+                                 gtk_lazy_page_new (create_func, user_data, user_data_free_func),
+                                 name, NULL);
+}
+
 /**
  * gtk_stack_add_titled:
  * @stack: a #GtkStack
@@ -2021,6 +2057,31 @@ gtk_stack_get_request_mode (GtkWidget *widget)
         GTK_SIZE_REQUEST_HEIGHT_FOR_WIDTH;
 }
 
+/* During transitions, pages are snapshotted without the clip of
+ * the stack. Their render nodes then contain all of the page and
+ * can be reused for every frame of the transition, instead of
+ * being recreated whenever the part of the page that is visible
+ * changes. Pages that queue a draw are still snapshotted again.
+ */
+static void
+gtk_stack_snapshot_page (GtkWidget   *widget,
+                         GtkWidget   *page,
+                         GtkSnapshot *snapshot)
+{
+  GtkSnapshot *page_snapshot;
+  GskRenderNode *node;
+
+  page_snapshot = gtk_snapshot_new ();
+  gtk_widget_snapshot_child (widget, page, page_snapshot);
+  node = gtk_snapshot_free_to_node (page_snapshot);
+
+  if (node)
+    {
+      gtk_snapshot_append_node (snapshot, node);
+      gsk_render_node_unref (node);
+    }
+}
+
 static void
 gtk_stack_snapshot_crossfade (GtkWidget   *widget,
                               GtkSnapshot *snapshot)
@@ -2033,15 +2094,15 @@ gtk_stack_snapshot_crossfade (GtkWidget   *widget,
 
   if (priv->last_visible_child)
     {
-      gtk_widget_snapshot_child (widget,
-                                 priv->last_visible_child->widget,
-                                 snapshot);
+      gtk_stack_snapshot_page (widget,
+                               priv->last_visible_child->widget,
+                               snapshot);
     }
   gtk_snapshot_pop (snapshot);
 
-  gtk_widget_snapshot_child (widget,
-                             priv->visible_child->widget,
-                             snapshot);
+  gtk_stack_snapshot_page (widget,
+                           priv->visible_child->widget,
+                           snapshot);
   gtk_snapshot_pop (snapshot);
 }
 
@@ -2089,9 +2150,9 @@ gtk_stack_snapshot_under (GtkWidget   *widget,
 
   gtk_snapshot_push_clip (snapshot, &GRAPHENE_RECT_INIT(x, y, width, height));
 
-  gtk_widget_snapshot_child (widget,
-                             priv->visible_child->widget,
-                             snapshot);
+  gtk_stack_snapshot_page (widget,
+                           priv->visible_child->widget,
+                           snapshot);
 
   gtk_snapshot_pop (snapshot);
 
@@ -2099,7 +2160,7 @@ gtk_stack_snapshot_under (GtkWidget   *widget,
     {
       gtk_snapshot_save (snapshot);
       gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (pos_x, pos_y));
-      gtk_widget_snapshot_child (widget, priv->last_visible_child->widget, snapshot);
+      gtk_stack_snapshot_page (widget, priv->last_visible_child->widget, snapshot);
       gtk_snapshot_restore (snapshot);
     }
 }
@@ -2132,9 +2193,9 @@ gtk_stack_snapshot_cube (GtkWidget   *widget,
                                  - gtk_widget_get_height (widget) / 2.f,
                                  gtk_widget_get_width (widget) / 2.f));
       if (priv->active_transition_type == GTK_STACK_TRANSITION_TYPE_ROTATE_LEFT)
-        gtk_widget_snapshot_child (widget, priv->last_visible_child->widget, snapshot);
+        gtk_stack_snapshot_page (widget, priv->last_visible_child->widget, snapshot);
       else
-        gtk_widget_snapshot_child (widget, priv->visible_child->widget, snapshot);
+        gtk_stack_snapshot_page (widget, priv->visible_child->widget, snapshot);
       gtk_snapshot_restore (snapshot);
     }
 
@@ -2154,9 +2215,9 @@ gtk_stack_snapshot_cube (GtkWidget   *widget,
                              gtk_widget_get_width (widget) / 2.f));
 
   if (priv->active_transition_type == GTK_STACK_TRANSITION_TYPE_ROTATE_LEFT)
-    gtk_widget_snapshot_child (widget, priv->visible_child->widget, snapshot);
+    gtk_stack_snapshot_page (widget, priv->visible_child->widget, snapshot);
   else
-    gtk_widget_snapshot_child (widget, priv->last_visible_child->widget, snapshot);
+    gtk_stack_snapshot_page (widget, priv->last_visible_child->widget, snapshot);
   gtk_snapshot_restore (snapshot);
 
   if (priv->last_visible_child && progress <= 0.5)
@@ -2176,9 +2237,9 @@ gtk_stack_snapshot_cube (GtkWidget   *widget,
                                  - gtk_widget_get_height (widget) / 2.f,
                                  gtk_widget_get_width (widget) / 2.f));
       if (priv->active_transition_type == GTK_STACK_TRANSITION_TYPE_ROTATE_LEFT)
-        gtk_widget_snapshot_child (widget, priv->last_visible_child->widget, snapshot);
+        gtk_stack_snapshot_page (widget, priv->last_visible_child->widget, snapshot);
       else
-        gtk_widget_snapshot_child (widget, priv->visible_child->widget, snapshot);
+        gtk_stack_snapshot_page (widget, priv->visible_child->widget, snapshot);
       gtk_snapshot_restore (snapshot);
     }
 }
@@ -2239,13 +2300,13 @@ gtk_stack_snapshot_slide (GtkWidget   *widget,
 
       gtk_snapshot_save (snapshot);
       gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, y));
-      gtk_widget_snapshot_child (widget, priv->last_visible_child->widget, snapshot);
+      gtk_stack_snapshot_page (widget, priv->last_visible_child->widget, snapshot);
       gtk_snapshot_restore (snapshot);
      }
 
-  gtk_widget_snapshot_child (widget,
-                             priv->visible_child->widget,
-                             snapshot);
+  gtk_stack_snapshot_page (widget,
+                           priv->visible_child->widget,
+                           snapshot);
 }
 
 static void
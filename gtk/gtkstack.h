@@ -107,6 +107,17 @@ void                   gtk_stack_page_set_icon_name       (GtkStackPage
 
 
 
+/**
+ * GtkStackCreateChildFunc:
+ * @user_data: (closure): user data
+ *
+ * Called by #GtkStack to create the child of a page that was
+ * added with gtk_stack_add_lazy(), the first time it is shown.
+ *
+ * Returns: (transfer full) (nullable): the child of the page
+ */
+typedef GtkWidget * (*GtkStackCreateChildFunc) (gpointer user_data);
+
 GDK_AVAILABLE_IN_ALL
 GType                  gtk_stack_get_type                (void) G_GNUC_CONST;
 
@@ -125,6 +136,12 @@ GtkStackPage *         gtk_stack_add_titled              (GtkStack
                                                           const char             *name,
                                                           const char             *title);
 GDK_AVAILABLE_IN_ALL
+GtkStackPage *         gtk_stack_add_lazy                (GtkStack               *stack,
+                                                          GtkStackCreateChildFunc create_func,
+                                                          gpointer                user_data,
+                                                          GDestroyNotify          user_data_free_func,
+                                                          const char             *name);
+GDK_AVAILABLE_IN_ALL
 void                   gtk_stack_remove                  (GtkStack               *stack,
                                                           GtkWidget              *child);
 
@@ -343,6 +343,47 @@ gtk_string_filter_get_search (GtkStringFilter *self)
   return self->search;
 }
 
+/* Compares the prepared strings, because normalizing can make
+ * a prefix of the search string not be a prefix anymore and an
+ * exact match for a longer string doesn't match less items.
+ */
+static GtkFilterChange
+gtk_string_filter_get_search_change (GtkStringFilter *self,
+                                     const char      *old_prepared,
+                                     const char      *new_prepared)
+{
+  if (new_prepared == NULL)
+    return GTK_FILTER_CHANGE_LESS_STRICT;
+  else if (old_prepared == NULL)
+    return GTK_FILTER_CHANGE_MORE_STRICT;
+
+  switch (self->match_mode)
+    {
+    case GTK_STRING_FILTER_MATCH_MODE_EXACT:
+      return GTK_FILTER_CHANGE_DIFFERENT;
+
+    case GTK_STRING_FILTER_MATCH_MODE_SUBSTRING:
+      if (strstr (new_prepared, old_prepared))
+        return GTK_FILTER_CHANGE_MORE_STRICT;
+      else if (strstr (old_prepared, new_prepared))
+        return GTK_FILTER_CHANGE_LESS_STRICT;
+      else
+        return GTK_FILTER_CHANGE_DIFFERENT;
+
+    case GTK_STRING_FILTER_MATCH_MODE_PREFIX:
+      if (g_str_has_prefix (new_prepared, old_prepared))
+        return GTK_FILTER_CHANGE_MORE_STRICT;
+      else if (g_str_has_prefix (old_prepared, new_prepared))
+        return GTK_FILTER_CHANGE_LESS_STRICT;
+      else
+        return GTK_FILTER_CHANGE_DIFFERENT;
+
+    default:
+      g_assert_not_reached ();
+      return GTK_FILTER_CHANGE_DIFFERENT;
+    }
+}
+
 /**
  * gtk_string_filter_set_search:
  * @self: a #GtkStringFilter
@@ -355,31 +396,34 @@ void
 gtk_string_filter_set_search (GtkStringFilter *self,
                               const char      *search)
 {
-  GtkFilterChange change;
+  char *prepared;
 
   g_return_if_fail (GTK_IS_STRING_FILTER (self));
 
   if (g_strcmp0 (self->search, search) == 0)
     return;
 
-  if (search == NULL || search[0] == 0)
-    change = GTK_FILTER_CHANGE_LESS_STRICT;
-  else if (!gtk_string_filter_has_search (self))
-    change = GTK_FILTER_CHANGE_MORE_STRICT;
-  else if (g_str_has_prefix (search, self->search))
-    change = GTK_FILTER_CHANGE_MORE_STRICT;
-  else if (g_str_has_prefix (self->search, search))
-    change = GTK_FILTER_CHANGE_LESS_STRICT;
-  else
-    change = GTK_FILTER_CHANGE_DIFFERENT;
+  prepared = gtk_string_filter_prepare (self, search);
 
   g_free (self->search);
-  g_free (self->search_prepared);
-
   self->search = g_strdup (search);
-  self->search_prepared = gtk_string_filter_prepare (self, search);
 
-  gtk_filter_changed (GTK_FILTER (self), change);
+  if (g_strcmp0 (prepared, self->search_prepared) == 0)
+    {
+      /* matches the same items */
+      g_free (prepared);
+    }
+  else
+    {
+      GtkFilterChange change;
+
+      change = gtk_string_filter_get_search_change (self, self->search_prepared, prepared);
+
+      g_free (self->search_prepared);
+      self->search_prepared = prepared;
+
+      gtk_filter_changed (GTK_FILTER (self), change);
+    }
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SEARCH]);
 }
@@ -19,13 +19,16 @@
 
 #include "config.h"
 
-#include "gtkstringlist.h"
+#include "gtkstringlistprivate.h"
 
 #include "gtkbuildable.h"
 #include "gtkbuilderprivate.h"
 #include "gtkintl.h"
+#include "gtklistmodelbulkprivate.h"
 #include "gtkprivate.h"
 
+#include <string.h>
+
 /**
  * SECTION:gtkstringlist
  * @title: GtkStringList
@@ -57,19 +60,37 @@
  *   </items>
  * </object>
  * ]|
+ *
+ * # Searching large lists
+ *
+ * When filtering a GtkStringList with a #GtkStringFilter, every
+ * string needs to be compared to the search string. For large lists,
+ * gtk_string_list_set_indexed() can be used to keep an index of the
+ * strings, so that only the strings that can possibly contain the
+ * search string need to be compared.
+ */
 
+/* The strings are kept one after another, each with its terminating
+ * nul, in a single pool, and items are offsets into it. Removing
+ * strings leaves holes in the pool that are compacted once they make
+ * up half of it.
+ *
+ * The GtkStringObjects are only created when an item is requested.
+ * The list only keeps a weak reference to them, so that getting the
+ * same item twice returns the same object, as long as somebody still
+ * holds on to it.
  */
 
-#define GDK_ARRAY_ELEMENT_TYPE GtkStringObject *
-#define GDK_ARRAY_NAME objects
-#define GDK_ARRAY_TYPE_NAME Objects
-#define GDK_ARRAY_FREE_FUNC g_object_unref
+#define GDK_ARRAY_ELEMENT_TYPE gsize
+#define GDK_ARRAY_NAME offsets
+#define GDK_ARRAY_TYPE_NAME Offsets
 #include "gdk/gdkarrayimpl.c"
 
 struct _GtkStringObject
 {
   GObject parent_instance;
   char *string;
+  gsize offset; /* in the pool of the list that caches us */
 };
 
 enum {
@@ -199,7 +220,13 @@ struct _GtkStringList
 {
   GObject parent_instance;
 
-  Objects items;
+  GString *pool;
+  gsize pool_waste; /* bytes in the pool not used by any item */
+  Offsets items;
+  GHashTable *objects; /* offset => GtkStringObject, weak */
+
+  gboolean indexed;
+  GHashTable *index; /* trigram => GtkBitset of positions, NULL if not built */
 };
 
 struct _GtkStringListClass
@@ -218,7 +245,43 @@ gtk_string_list_get_n_items (GListModel *list)
 {
   GtkStringList *self = GTK_STRING_LIST (list);
 
-  return objects_get_size (&self->items);
+  return offsets_get_size (&self->items);
+}
+
+static inline const char *
+gtk_string_list_get_string_at (GtkStringList *self,
+                               guint          position)
+{
+  return self->pool->str + offsets_get (&self->items, position);
+}
+
+static void
+gtk_string_list_object_finalized (gpointer  data,
+                                  GObject  *where_the_object_was)
+{
+  GtkStringList *self = data;
+  GtkStringObject *object = (GtkStringObject *) where_the_object_was;
+
+  g_hash_table_remove (self->objects, GSIZE_TO_POINTER (object->offset));
+}
+
+static GtkStringObject *
+gtk_string_list_get_object (GtkStringList *self,
+                            guint          position)
+{
+  gsize offset = offsets_get (&self->items, position);
+  GtkStringObject *object;
+
+  object = g_hash_table_lookup (self->objects, GSIZE_TO_POINTER (offset));
+  if (object)
+    return g_object_ref (object);
+
+  object = gtk_string_object_new (self->pool->str + offset);
+  object->offset = offset;
+  g_object_weak_ref (G_OBJECT (object), gtk_string_list_object_finalized, self);
+  g_hash_table_insert (self->objects, GSIZE_TO_POINTER (offset), object);
+
+  return object;
 }
 
 static gpointer
@@ -227,10 +290,10 @@ gtk_string_list_get_item (GListModel *list,
 {
   GtkStringList *self = GTK_STRING_LIST (list);
 
-  if (position >= objects_get_size (&self->items))
+  if (position >= offsets_get_size (&self->items))
     return NULL;
 
-  return g_object_ref (objects_get (&self->items, position));
+  return gtk_string_list_get_object (self, position);
 }
 
 static void
@@ -241,6 +304,30 @@ gtk_string_list_model_init (GListModelInterface *iface)
   iface->get_item = gtk_string_list_get_item;
 }
 
+static gboolean
+gtk_string_list_get_items (GtkListModelBulk *list,
+                           guint             position,
+                           guint             n_items,
+                           gpointer         *items)
+{
+  GtkStringList *self = GTK_STRING_LIST (list);
+  guint i;
+
+  g_assert (position + n_items <= offsets_get_size (&self->items));
+
+  /* The objects are created on demand, so they can't be borrowed */
+  for (i = 0; i < n_items; i++)
+    items[i] = gtk_string_list_get_object (self, position + i);
+
+  return FALSE;
+}
+
+static void
+gtk_string_list_bulk_init (GtkListModelBulkInterface *iface)
+{
+  iface->get_items = gtk_string_list_get_items;
+}
+
 typedef struct
 {
   GtkBuilder    *builder;
@@ -410,30 +497,283 @@ G_DEFINE_TYPE_WITH_CODE (GtkStringList, gtk_string_list, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (GTK_TYPE_BUILDABLE,
                                                 gtk_string_list_buildable_init)
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
-                                                gtk_string_list_model_init))
+                                                gtk_string_list_model_init)
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_LIST_MODEL_BULK,
+                                                gtk_string_list_bulk_init))
+
+static void
+gtk_string_list_forget_objects (GtkStringList *self)
+{
+  GHashTableIter iter;
+  gpointer object;
+
+  g_hash_table_iter_init (&iter, self->objects);
+  while (g_hash_table_iter_next (&iter, NULL, &object))
+    g_object_weak_unref (object, gtk_string_list_object_finalized, self);
+  g_hash_table_remove_all (self->objects);
+}
 
 static void
 gtk_string_list_dispose (GObject *object)
 {
   GtkStringList *self = GTK_STRING_LIST (object);
 
-  objects_clear (&self->items);
+  gtk_string_list_forget_objects (self);
+  offsets_clear (&self->items);
+  g_string_truncate (self->pool, 0);
+  self->pool_waste = 0;
+  g_clear_pointer (&self->index, g_hash_table_unref);
 
   G_OBJECT_CLASS (gtk_string_list_parent_class)->dispose (object);
 }
 
+static void
+gtk_string_list_finalize (GObject *object)
+{
+  GtkStringList *self = GTK_STRING_LIST (object);
+
+  g_hash_table_unref (self->objects);
+  g_string_free (self->pool, TRUE);
+
+  G_OBJECT_CLASS (gtk_string_list_parent_class)->finalize (object);
+}
+
 static void
 gtk_string_list_class_init (GtkStringListClass *class)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (class);
 
   gobject_class->dispose = gtk_string_list_dispose;
+  gobject_class->finalize = gtk_string_list_finalize;
 }
 
 static void
 gtk_string_list_init (GtkStringList *self)
 {
-  objects_init (&self->items);
+  self->pool = g_string_new (NULL);
+  offsets_init (&self->items);
+  self->objects = g_hash_table_new (NULL, NULL);
+}
+
+static gsize
+add_to_pool (GString    *pool,
+             const char *string)
+{
+  gsize offset = pool->len;
+
+  g_string_append_len (pool, string, strlen (string) + 1);
+
+  return offset;
+}
+
+/* Moves the strings of all items to the start of the pool, in order */
+static void
+gtk_string_list_compact_pool (GtkStringList *self)
+{
+  GString *pool;
+  GHashTable *objects;
+  guint i;
+
+  pool = g_string_sized_new (self->pool->len - self->pool_waste);
+  objects = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < offsets_get_size (&self->items); i++)
+    {
+      gsize *offset = offsets_index (&self->items, i);
+      GtkStringObject *object;
+
+      object = g_hash_table_lookup (self->objects, GSIZE_TO_POINTER (*offset));
+      *offset = add_to_pool (pool, self->pool->str + *offset);
+      if (object)
+        {
+          object->offset = *offset;
+          g_hash_table_insert (objects, GSIZE_TO_POINTER (*offset), object);
+        }
+    }
+
+  g_string_free (self->pool, TRUE);
+  self->pool = pool;
+  self->pool_waste = 0;
+  g_hash_table_unref (self->objects);
+  self->objects = objects;
+}
+
+/* Drops the strings of the given items from the pool. Objects that
+ * were created for them keep their own copy of the string.
+ */
+static void
+gtk_string_list_release_items (GtkStringList *self,
+                               guint          position,
+                               guint          n_items)
+{
+  guint i;
+
+  for (i = position; i < position + n_items; i++)
+    {
+      gsize offset = offsets_get (&self->items, i);
+      GtkStringObject *object;
+
+      object = g_hash_table_lookup (self->objects, GSIZE_TO_POINTER (offset));
+      if (object)
+        {
+          g_object_weak_unref (G_OBJECT (object), gtk_string_list_object_finalized, self);
+          g_hash_table_remove (self->objects, GSIZE_TO_POINTER (offset));
+        }
+
+      self->pool_waste += strlen (self->pool->str + offset) + 1;
+    }
+}
+
+/* The index maps every 3 byte sequence of the normalized and
+ * casefolded strings to the positions of the strings containing it.
+ * Casefolding works character by character, so if a normalized
+ * search string is contained in a normalized string, the same is
+ * true after casefolding both. So only the strings that have all
+ * the sequences of the casefolded search string are candidates.
+ *
+ * It is built when it is first needed and kept up to date when
+ * strings are appended. Other changes drop it.
+ */
+static char *
+gtk_string_list_prepare (const char *string)
+{
+  char *normalized, *result;
+
+  if (string == NULL)
+    return NULL;
+
+  normalized = g_utf8_normalize (string, -1, G_NORMALIZE_ALL);
+  if (normalized == NULL)
+    return NULL;
+
+  result = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  return result;
+}
+
+static inline guint
+get_trigram (const char *s)
+{
+  return ((guchar) s[0] << 16) | ((guchar) s[1] << 8) | (guchar) s[2];
+}
+
+static void
+gtk_string_list_index_items (GtkStringList *self,
+                             guint          position,
+                             guint          n_items)
+{
+  guint i;
+
+  for (i = position; i < position + n_items; i++)
+    {
+      char *prepared;
+      gsize j, len;
+
+      prepared = gtk_string_list_prepare (gtk_string_list_get_string_at (self, i));
+      if (prepared == NULL)
+        continue;
+
+      len = strlen (prepared);
+      for (j = 0; j + 3 <= len; j++)
+        {
+          gpointer trigram = GUINT_TO_POINTER (get_trigram (prepared + j));
+          GtkBitset *set;
+
+          set = g_hash_table_lookup (self->index, trigram);
+          if (set == NULL)
+            {
+              set = gtk_bitset_new_empty ();
+              g_hash_table_insert (self->index, trigram, set);
+            }
+          gtk_bitset_add (set, i);
+        }
+
+      g_free (prepared);
+    }
+}
+
+static void
+gtk_string_list_items_added (GtkStringList *self,
+                             guint          position,
+                             guint          n_removals,
+                             guint          n_additions)
+{
+  if (self->index == NULL || (n_removals == 0 && n_additions == 0))
+    return;
+
+  if (n_removals == 0 && position + n_additions == offsets_get_size (&self->items))
+    gtk_string_list_index_items (self, position, n_additions);
+  else
+    g_clear_pointer (&self->index, g_hash_table_unref);
+}
+
+/*<private>
+ * gtk_string_list_find_substring:
+ * @self: a #GtkStringList
+ * @search: the search string, normalized with %G_NORMALIZE_ALL
+ *
+ * Uses the index of @self to find the strings that may contain
+ * @search, with or without ignoring case, after normalizing them
+ * with %G_NORMALIZE_ALL. Strings not in the result can't contain
+ * @search, the others need to be checked.
+ *
+ * Returns: (nullable) (transfer full): the positions of the
+ *     candidates or %NULL if @self isn't indexed or @search
+ *     is too short to use the index
+ */
+GtkBitset *
+gtk_string_list_find_substring (GtkStringList *self,
+                                const char    *search)
+{
+  GtkBitset *result;
+  char *prepared;
+  gsize i, len;
+
+  g_return_val_if_fail (GTK_IS_STRING_LIST (self), NULL);
+  g_return_val_if_fail (search != NULL, NULL);
+
+  if (!self->indexed)
+    return NULL;
+
+  prepared = g_utf8_casefold (search, -1);
+  len = strlen (prepared);
+  if (len < 3)
+    {
+      g_free (prepared);
+      return NULL;
+    }
+
+  if (self->index == NULL)
+    {
+      self->index = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) gtk_bitset_unref);
+      gtk_string_list_index_items (self, 0, offsets_get_size (&self->items));
+    }
+
+  result = NULL;
+  for (i = 0; i + 3 <= len; i++)
+    {
+      GtkBitset *set = g_hash_table_lookup (self->index, GUINT_TO_POINTER (get_trigram (prepared + i)));
+
+      if (set == NULL)
+        {
+          g_clear_pointer (&result, gtk_bitset_unref);
+          result = gtk_bitset_new_empty ();
+          break;
+        }
+
+      if (result == NULL)
+        result = gtk_bitset_copy (set);
+      else
+        gtk_bitset_intersect (result, set);
+
+      if (gtk_bitset_is_empty (result))
+        break;
+    }
+
+  g_free (prepared);
+
+  return result;
 }
 
 /**
@@ -486,20 +826,26 @@ gtk_string_list_splice (GtkStringList      *self,
 
   g_return_if_fail (GTK_IS_STRING_LIST (self));
   g_return_if_fail (position + n_removals >= position); /* overflow */
-  g_return_if_fail (position + n_removals <= objects_get_size (&self->items));
+  g_return_if_fail (position + n_removals <= offsets_get_size (&self->items));
 
   if (additions)
     n_additions = g_strv_length ((char **) additions);
   else
     n_additions = 0;
 
-  objects_splice (&self->items, position, n_removals, NULL, n_additions);
+  gtk_string_list_release_items (self, position, n_removals);
+  offsets_splice (&self->items, position, n_removals, NULL, n_additions);
 
   for (i = 0; i < n_additions; i++)
     {
-      *objects_index (&self->items, position + i) = gtk_string_object_new (additions[i]);
+      *offsets_index (&self->items, position + i) = add_to_pool (self->pool, additions[i]);
     }
 
+  if (self->pool_waste > self->pool->len / 2)
+    gtk_string_list_compact_pool (self);
+
+  gtk_string_list_items_added (self, position, n_removals, n_additions);
+
   if (n_removals || n_additions)
     g_list_model_items_changed (G_LIST_MODEL (self), position, n_removals, n_additions);
 }
@@ -520,9 +866,10 @@ gtk_string_list_append (GtkStringList *self,
 {
   g_return_if_fail (GTK_IS_STRING_LIST (self));
 
-  objects_append (&self->items, gtk_string_object_new (string));
+  offsets_append (&self->items, add_to_pool (self->pool, string));
+  gtk_string_list_items_added (self, offsets_get_size (&self->items) - 1, 0, 1);
 
-  g_list_model_items_changed (G_LIST_MODEL (self), objects_get_size (&self->items) - 1, 0, 1);
+  g_list_model_items_changed (G_LIST_MODEL (self), offsets_get_size (&self->items) - 1, 0, 1);
 }
 
 /**
@@ -546,9 +893,11 @@ gtk_string_list_take (GtkStringList *self,
 {
   g_return_if_fail (GTK_IS_STRING_LIST (self));
 
-  objects_append (&self->items, gtk_string_object_new_take (string));
+  offsets_append (&self->items, add_to_pool (self->pool, string));
+  g_free (string);
+  gtk_string_list_items_added (self, offsets_get_size (&self->items) - 1, 0, 1);
 
-  g_list_model_items_changed (G_LIST_MODEL (self), objects_get_size (&self->items) - 1, 0, 1);
+  g_list_model_items_changed (G_LIST_MODEL (self), offsets_get_size (&self->items) - 1, 0, 1);
 }
 
 /**
@@ -579,6 +928,8 @@ gtk_string_list_remove (GtkStringList *self,
  * This function returns the const char *. To get the
  * object wrapping it, use g_list_model_get_item().
  *
+ * The string is only valid until @self is changed.
+ *
  * Returns: the string at the given position
  */
 const char *
@@ -587,8 +938,53 @@ gtk_string_list_get_string (GtkStringList *self,
 {
   g_return_val_if_fail (GTK_IS_STRING_LIST (self), NULL);
 
-  if (position >= objects_get_size (&self->items))
+  if (position >= offsets_get_size (&self->items))
     return NULL;
 
-  return objects_get (&self->items, position)->string;
+  return gtk_string_list_get_string_at (self, position);
+}
+
+/**
+ * gtk_string_list_set_indexed:
+ * @self: a #GtkStringList
+ * @indexed: %TRUE to keep an index of the strings
+ *
+ * Sets whether @self keeps an index of its strings to speed
+ * up searching them with a #GtkStringFilter.
+ *
+ * The index is created on the first search and takes memory
+ * proportional to the total length of the strings. It is kept
+ * up to date when strings are appended, but other changes
+ * require it to be recreated. So it is most useful for large
+ * lists that don't change a lot.
+ *
+ * By default, no index is kept.
+ */
+void
+gtk_string_list_set_indexed (GtkStringList *self,
+                             gboolean       indexed)
+{
+  g_return_if_fail (GTK_IS_STRING_LIST (self));
+
+  self->indexed = indexed;
+
+  if (!indexed)
+    g_clear_pointer (&self->index, g_hash_table_unref);
+}
+
+/**
+ * gtk_string_list_get_indexed:
+ * @self: a #GtkStringList
+ *
+ * Returns whether @self keeps an index of its strings.
+ * See gtk_string_list_set_indexed().
+ *
+ * Returns: %TRUE if @self keeps an index
+ */
+gboolean
+gtk_string_list_get_indexed (GtkStringList *self)
+{
+  g_return_val_if_fail (GTK_IS_STRING_LIST (self), FALSE);
+
+  return self->indexed;
 }
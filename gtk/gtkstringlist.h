@@ -71,6 +71,12 @@ GDK_AVAILABLE_IN_ALL
 const char *    gtk_string_list_get_string      (GtkStringList         *self,
                                                  guint                  position);
 
+GDK_AVAILABLE_IN_ALL
+void            gtk_string_list_set_indexed     (GtkStringList         *self,
+                                                 gboolean               indexed);
+GDK_AVAILABLE_IN_ALL
+gboolean        gtk_string_list_get_indexed     (GtkStringList         *self);
+
 G_END_DECLS
 
 #endif /* __GTK_STRING_LIST_H__ */
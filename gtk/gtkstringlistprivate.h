@@ -0,0 +1,32 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_STRING_LIST_PRIVATE_H__
+#define __GTK_STRING_LIST_PRIVATE_H__
+
+#include "gtkstringlist.h"
+
+#include "gtkbitset.h"
+
+G_BEGIN_DECLS
+
+GtkBitset *     gtk_string_list_find_substring  (GtkStringList         *self,
+                                                 const char            *search);
+
+G_END_DECLS
+
+#endif /* __GTK_STRING_LIST_PRIVATE_H__ */
@@ -21,6 +21,7 @@
 
 #include "gtkstringsorter.h"
 
+#include "gtkexpressionprivate.h"
 #include "gtkintl.h"
 #include "gtksorterprivate.h"
 #include "gtktypebuiltins.h"
@@ -187,6 +188,28 @@ gtk_string_sort_keys_clear_key (GtkSortKeys *keys,
   g_free (*key);
 }
 
+/* The first 8 bytes, in the order strcmp() compares them */
+static guint64
+gtk_string_sort_keys_prefix (GtkSortKeys   *keys,
+                             gconstpointer  key_memory)
+{
+  const char *key = *(const char **) key_memory;
+  guint64 prefix = 0;
+  guint i;
+
+  if (key == NULL)
+    return G_MAXUINT64;
+
+  for (i = 0; i < 8; i++)
+    {
+      prefix <<= 8;
+      if (*key)
+        prefix |= (guchar) *key++;
+    }
+
+  return prefix;
+}
+
 static const GtkSortKeysClass GTK_STRING_SORT_KEYS_CLASS =
 {
   gtk_string_sort_keys_free,
@@ -194,6 +217,7 @@ static const GtkSortKeysClass GTK_STRING_SORT_KEYS_CLASS =
   gtk_string_sort_keys_is_compatible,
   gtk_string_sort_keys_init_key,
   gtk_string_sort_keys_clear_key,
+  gtk_string_sort_keys_prefix,
 };
 
 static GtkSortKeys *
@@ -211,6 +235,7 @@ gtk_string_sort_keys_new (GtkStringSorter *self)
 
   result->expression = gtk_expression_ref (self->expression);
   result->ignore_case = self->ignore_case;
+  result->keys.thread_unsafe = !gtk_expression_is_thread_safe (self->expression);
 
   return (GtkSortKeys *) result;
 }
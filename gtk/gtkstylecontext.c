@@ -168,7 +168,12 @@ static void
 gtk_style_context_cascade_changed (GtkStyleCascade *cascade,
                                    GtkStyleContext *context)
 {
-  gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
+  const GtkCssSelectorTree *selectors = gtk_style_provider_get_changed_selectors ();
+
+  if (selectors)
+    gtk_css_node_invalidate_style_provider_selectors (gtk_style_context_get_root (context), selectors);
+  else
+    gtk_css_node_invalidate_style_provider (gtk_style_context_get_root (context));
 }
 
 static void
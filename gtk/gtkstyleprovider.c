@@ -123,6 +123,52 @@ gtk_style_provider_changed (GtkStyleProvider *provider)
   g_signal_emit (provider, signals[CHANGED], 0);
 }
 
+/* Set while emitting a change that only affects some selectors */
+static const GtkCssSelectorTree *changed_selectors;
+
+/*
+ * gtk_style_provider_changed_selectors:
+ * @provider: a style provider
+ * @selectors: the selectors of all rulesets that were added,
+ *     removed or modified
+ *
+ * Like gtk_style_provider_changed(), but tells handlers that
+ * only nodes that one of @selectors may match need a new style.
+ * Cascades forward the signal with gtk_style_provider_changed(),
+ * so handlers get @selectors from
+ * gtk_style_provider_get_changed_selectors().
+ */
+void
+gtk_style_provider_changed_selectors (GtkStyleProvider         *provider,
+                                      const GtkCssSelectorTree *selectors)
+{
+  const GtkCssSelectorTree *saved;
+
+  gtk_internal_return_if_fail (GTK_IS_STYLE_PROVIDER (provider));
+
+  saved = changed_selectors;
+  changed_selectors = selectors;
+
+  g_signal_emit (provider, signals[CHANGED], 0);
+
+  changed_selectors = saved;
+}
+
+/*
+ * gtk_style_provider_get_changed_selectors:
+ *
+ * Gets the selectors that a change is limited to. This is only
+ * meaningful in handlers of the ::gtk-private-changed signal.
+ *
+ * Returns: (nullable): the changed selectors, or %NULL if
+ *     everything may have changed
+ */
+const GtkCssSelectorTree *
+gtk_style_provider_get_changed_selectors (void)
+{
+  return changed_selectors;
+}
+
 GtkSettings *
 gtk_style_provider_get_settings (GtkStyleProvider *provider)
 {
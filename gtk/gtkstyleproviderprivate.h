@@ -67,6 +67,10 @@ void                    gtk_style_provider_lookup                (GtkStyleProvid
                                                                   GtkCssChange            *out_change);
 
 void                    gtk_style_provider_changed               (GtkStyleProvider        *provider);
+void                    gtk_style_provider_changed_selectors     (GtkStyleProvider        *provider,
+                                                                  const GtkCssSelectorTree *selectors);
+const GtkCssSelectorTree *
+                        gtk_style_provider_get_changed_selectors (void);
 
 void                    gtk_style_provider_emit_error            (GtkStyleProvider        *provider,
                                                                   GtkCssSection           *section,
@@ -130,6 +130,7 @@
 #define UNDERSHOOT_SIZE 20
 
 #define DEFAULT_MAX_UNDO 200
+#define DEFAULT_MAX_UNDO_BYTES (64 * 1024 * 1024)
 
 static GQuark          quark_password_hint  = 0;
 
@@ -1835,6 +1836,7 @@ gtk_text_init (GtkText *self)
   priv->history = gtk_text_history_new (&history_funcs, self);
 
   gtk_text_history_set_max_undo_levels (priv->history, DEFAULT_MAX_UNDO);
+  gtk_text_history_set_max_undo_bytes (priv->history, DEFAULT_MAX_UNDO_BYTES);
 
   priv->selection_content = g_object_new (GTK_TYPE_TEXT_CONTENT, NULL);
   GTK_TEXT_CONTENT (priv->selection_content)->self = self;
@@ -216,6 +216,16 @@ struct _GtkTextBTree {
   guint end_iter_segment_stamp;
   
   GHashTable *child_anchor_table;
+
+  /* While tag changes are batched, the region that needs to be
+   * redisplayed is collected as character offsets and queued
+   * once at the end of the batch.
+   */
+  guint tag_batch_depth;
+  int tag_batch_start;
+  int tag_batch_end;
+  guint tag_batch_affects_size : 1;
+  guint tag_batch_affects_appearance : 1;
 };
 
 
@@ -360,6 +370,20 @@ chars_changed (GtkTextBTree *tree)
   tree->chars_changed_stamp += 1;
 }
 
+/* Lines that were never laid out for a view have no line data. They
+ * count with an estimated height, so that the size of the view and the
+ * positions of lines are roughly right before validation gets to them.
+ */
+static inline int
+line_data_get_height (GtkTextLineData *ld,
+                      gpointer         view_id)
+{
+  if (ld)
+    return ld->height;
+
+  return gtk_text_layout_get_estimated_line_height (view_id);
+}
+
 /*
  * BTree operations
  */
@@ -1007,10 +1031,8 @@ _gtk_text_btree_delete (GtkTextIter *start,
               ld = _gtk_text_line_get_data (line, view->view_id);
 
               if (ld)
-                {
-                  deleted_width = MAX (deleted_width, ld->width);
-                  deleted_height += ld->height;
-                }
+                deleted_width = MAX (deleted_width, ld->width);
+              deleted_height += line_data_get_height (ld, view->view_id);
 
               line = next_line;
             }
@@ -1024,12 +1046,12 @@ _gtk_text_btree_delete (GtkTextIter *start,
                   /* This means that start_line has never been validated.
                    * We don't really want to do the validation here but
                    * we do need to store our temporary sizes. So we
-                   * create the line data and assume a line w/h of 0.
+                   * create the line data and keep the estimated height.
                    */
                   ld = _gtk_text_line_data_new (view->layout, start_line);
                   _gtk_text_line_add_data (start_line, ld);
                   ld->width = 0;
-                  ld->height = 0;
+                  ld->height = gtk_text_layout_get_estimated_line_height (view->layout);
                   ld->valid = FALSE;
                 }
               
@@ -1090,6 +1112,93 @@ _gtk_text_btree_delete (GtkTextIter *start,
   gtk_text_btree_resolve_bidi (start, end);
 }
 
+/* Word-at-a-time helpers for find_paragraph_boundary(). A byte in
+ * a word is selected by setting its high bit.
+ */
+#define WORD_ONES  ((gsize) -1 / 0xff)
+#define WORD_HIGHS (WORD_ONES * 0x80)
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define WORD_HAS_BYTE(w, b) WORD_HAS_ZERO ((w) ^ (WORD_ONES * (b)))
+
+/* Number of UTF-8 continuation bytes (10xxxxxx) in @w */
+static inline guint
+word_count_continuation_bytes (gsize w)
+{
+  gsize cont = w & ~(w << 1) & WORD_HIGHS;
+
+  /* Sums up the 0/1 bytes into the top byte */
+  return ((cont >> 7) * WORD_ONES) >> ((sizeof (gsize) - 1) * 8);
+}
+
+/* Same as pango_find_paragraph_boundary() for valid UTF-8, but
+ * also counts the characters up to the start of the next paragraph.
+ * Words without any of the bytes that can start a paragraph
+ * separator are skipped as a whole, which makes this a lot faster
+ * for large inserts than going character by character.
+ */
+static void
+find_paragraph_boundary (const char *text,
+                         int         len,
+                         int        *delim,
+                         int        *eol,
+                         int        *n_chars)
+{
+  const guchar *start = (const guchar *) text;
+  const guchar *end = start + len;
+  const guchar *p = start;
+  int chars = 0;
+
+  while (p < end)
+    {
+      guchar c;
+
+      while (end - p >= (gssize) sizeof (gsize))
+        {
+          gsize w;
+
+          memcpy (&w, p, sizeof (gsize));
+          if (WORD_HAS_BYTE (w, '\n') ||
+              WORD_HAS_BYTE (w, '\r') ||
+              WORD_HAS_BYTE (w, 0xe2))
+            break;
+
+          chars += sizeof (gsize) - word_count_continuation_bytes (w);
+          p += sizeof (gsize);
+        }
+
+      if (p == end)
+        break;
+
+      c = *p;
+
+      if (c == '\n' ||
+          c == '\r' ||
+          (c == 0xe2 && end - p >= 3 && p[1] == 0x80 && p[2] == 0xa9))
+        {
+          *delim = p - start;
+
+          if (c == 0xe2)
+            p += 3;
+          else if (c == '\r' && end - p >= 2 && p[1] == '\n')
+            p += 2;
+          else
+            p += 1;
+
+          *eol = p - start;
+          *n_chars = chars + (c == '\r' && *eol - *delim == 2 ? 2 : 1);
+          return;
+        }
+
+      if ((c & 0xc0) != 0x80)
+        chars++;
+      p++;
+    }
+
+  *delim = len;
+  *eol = len;
+  *n_chars = chars;
+}
+
 void
 _gtk_text_btree_insert (GtkTextIter *iter,
                         const char *text,
@@ -1106,7 +1215,8 @@ _gtk_text_btree_insert (GtkTextIter *iter,
                                 * added to this line). */
   GtkTextLineSegment *seg;
   GtkTextLine *newline;
-  int chunk_len;                        /* # characters in current chunk. */
+  int chunk_len;                        /* # bytes in current chunk. */
+  int chunk_chars;                      /* # characters in current chunk. */
   int sol;                           /* start of line */
   int eol;                           /* Pointer to character just after last
                                        * one in current chunk.
@@ -1119,6 +1229,8 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   int char_count_delta;                /* change to number of chars */
   GtkTextBTree *tree;
   int start_byte_index;
+  int end_byte_index;                  /* byte index of the end of the
+                                        * inserted text in line */
   GtkTextLine *start_line;
 
   g_return_if_fail (text != NULL);
@@ -1156,14 +1268,16 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   sol = 0;
   line_count_delta = 0;
   char_count_delta = 0;
+  end_byte_index = start_byte_index;
   while (eol < len)
     {
       sol = eol;
       
-      pango_find_paragraph_boundary (text + sol,
-                                     len - sol,
-                                     &delim,
-                                     &eol);      
+      find_paragraph_boundary (text + sol,
+                               len - sol,
+                               &delim,
+                               &eol,
+                               &chunk_chars);
 
       /* make these relative to the start of the text */
       delim += sol;
@@ -1177,10 +1291,17 @@ _gtk_text_btree_insert (GtkTextIter *iter,
       
       chunk_len = eol - sol;
 
-      g_assert (g_utf8_validate (&text[sol], chunk_len, NULL));
-      seg = _gtk_char_segment_new (&text[sol], chunk_len);
+#ifdef G_ENABLE_DEBUG
+      if (GTK_DEBUG_CHECK (TEXT))
+        {
+          g_assert (g_utf8_validate (&text[sol], chunk_len, NULL));
+          g_assert (g_utf8_strlen (&text[sol], chunk_len) == chunk_chars);
+        }
+#endif
+      seg = _gtk_char_segment_new_with_chars (&text[sol], chunk_len, chunk_chars);
 
       char_count_delta += seg->char_count;
+      end_byte_index += chunk_len;
 
       if (cur_seg == NULL)
         {
@@ -1213,6 +1334,7 @@ _gtk_text_btree_insert (GtkTextIter *iter,
       seg->next = NULL;
       line = newline;
       cur_seg = NULL;
+      end_byte_index = 0;
       line_count_delta++;
     }
 
@@ -1240,12 +1362,14 @@ _gtk_text_btree_insert (GtkTextIter *iter,
                                       &start,
                                       start_line,
                                       start_byte_index);
-    end = start;
 
-    /* We could almost certainly be more efficient here
-       by saving the information from the insertion loop
-       above. FIXME */
-    gtk_text_iter_forward_chars (&end, char_count_delta);
+    /* The insertion loop knows where the text ended, so don't walk
+     * over all of it again, which is slow for large inserts.
+     */
+    _gtk_text_btree_get_iter_at_line (tree,
+                                      &end,
+                                      line,
+                                      end_byte_index);
 
     DV (g_print ("invalidating due to inserting some text (%s)\n", G_STRLOC));
     _gtk_text_btree_invalidate_region (tree, &start, &end, FALSE);
@@ -1378,16 +1502,16 @@ find_line_by_y (GtkTextBTree *tree, BTreeView *view,
         {
           GtkTextLineData *ld;
 
+          int height;
+
           ld = _gtk_text_line_get_data (line, view->view_id);
+          height = line_data_get_height (ld, view->view_id);
 
-          if (ld)
-            {
-              if (y < (current_y + ld->height))
-                return line;
+          if (y < (current_y + height))
+            return line;
 
-              current_y += ld->height;
-              *line_top += ld->height;
-            }
+          current_y += height;
+          *line_top += height;
 
           line = line->next;
         }
@@ -1462,8 +1586,7 @@ find_line_top_in_line_list (GtkTextBTree *tree,
         return y;
 
       ld = _gtk_text_line_get_data (line, view->view_id);
-      if (ld)
-        y += ld->height;
+      y += line_data_get_height (ld, view->view_id);
 
       line = line->next;
     }
@@ -1583,8 +1706,29 @@ _gtk_text_btree_add_view (GtkTextBTree *tree,
   line_data->width = 0;
   line_data->height = 0;
   line_data->valid = TRUE;
+  line_data->estimated = FALSE;
 
   _gtk_text_line_add_data (last_line, line_data);
+
+  _gtk_text_btree_update_view_size (tree, layout);
+}
+
+/**
+ * _gtk_text_btree_update_view_size:
+ * @tree: a #GtkTextBTree
+ * @view_id: view ID
+ *
+ * Recomputes the size of all nodes for the given view, so that the
+ * sizes include the current estimate for lines without line data.
+ **/
+void
+_gtk_text_btree_update_view_size (GtkTextBTree *tree,
+                                  gpointer      view_id)
+{
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (view_id != NULL);
+
+  gtk_text_btree_node_check_valid_downward (tree->root_node, view_id);
 }
 
 void
@@ -1750,6 +1894,34 @@ queue_tag_redisplay (GtkTextBTree      *tree,
                      const GtkTextIter *start,
                      const GtkTextIter *end)
 {
+  if (tree->tag_batch_depth > 0)
+    {
+      gboolean affects_size = _gtk_text_tag_affects_size (tag);
+      gboolean affects_appearance = _gtk_text_tag_affects_nonsize_appearance (tag);
+
+      if (affects_size || affects_appearance)
+        {
+          int start_offset = gtk_text_iter_get_offset (start);
+          int end_offset = gtk_text_iter_get_offset (end);
+
+          if (!tree->tag_batch_affects_size && !tree->tag_batch_affects_appearance)
+            {
+              tree->tag_batch_start = start_offset;
+              tree->tag_batch_end = end_offset;
+            }
+          else
+            {
+              tree->tag_batch_start = MIN (tree->tag_batch_start, start_offset);
+              tree->tag_batch_end = MAX (tree->tag_batch_end, end_offset);
+            }
+
+          tree->tag_batch_affects_size |= affects_size;
+          tree->tag_batch_affects_appearance |= affects_appearance;
+        }
+
+      return;
+    }
+
   if (_gtk_text_tag_affects_size (tag))
     {
       DV (g_print ("invalidating due to size-affecting tag (%s)\n", G_STRLOC));
@@ -1764,6 +1936,51 @@ queue_tag_redisplay (GtkTextBTree      *tree,
   /* We don't need to do anything if the tag doesn't affect display */
 }
 
+/*
+ * _gtk_text_btree_begin_tag_batch:
+ * @tree: a #GtkTextBTree
+ *
+ * Starts collecting the regions changed by _gtk_text_btree_tag(),
+ * so that they are redisplayed once in _gtk_text_btree_end_tag_batch()
+ * instead of for every change. Batches can be nested.
+ */
+void
+_gtk_text_btree_begin_tag_batch (GtkTextBTree *tree)
+{
+  tree->tag_batch_depth++;
+}
+
+void
+_gtk_text_btree_end_tag_batch (GtkTextBTree *tree)
+{
+  GtkTextIter start, end;
+  int n_chars;
+
+  g_return_if_fail (tree->tag_batch_depth > 0);
+
+  tree->tag_batch_depth--;
+
+  if (tree->tag_batch_depth > 0 ||
+      (!tree->tag_batch_affects_size && !tree->tag_batch_affects_appearance))
+    return;
+
+  /* The text may have changed in a signal handler */
+  n_chars = _gtk_text_btree_char_count (tree);
+  _gtk_text_btree_get_iter_at_char (tree, &start, MIN (tree->tag_batch_start, n_chars));
+  _gtk_text_btree_get_iter_at_char (tree, &end, MIN (tree->tag_batch_end, n_chars));
+
+  if (tree->tag_batch_affects_size)
+    {
+      DV (g_print ("invalidating due to size-affecting tags (%s)\n", G_STRLOC));
+      _gtk_text_btree_invalidate_region (tree, &start, &end, FALSE);
+    }
+  else
+    redisplay_region (tree, &start, &end, FALSE);
+
+  tree->tag_batch_affects_size = FALSE;
+  tree->tag_batch_affects_appearance = FALSE;
+}
+
 void
 _gtk_text_btree_tag (const GtkTextIter *start_orig,
                      const GtkTextIter *end_orig,
@@ -2661,8 +2878,9 @@ redisplay_region (GtkTextBTree      *tree,
         start_y -= ld->top_ink;
 
       ld = _gtk_text_line_get_data (end_line, view->view_id);
+      end_y += line_data_get_height (ld, view->view_id);
       if (ld)
-        end_y += ld->height + ld->bottom_ink;
+        end_y += ld->bottom_ink;
 
       if (cursors_only)
 	gtk_text_layout_cursors_changed (view->layout, start_y,
@@ -3631,6 +3849,7 @@ _gtk_text_line_data_new (GtkTextLayout *layout,
   line_data->top_ink = 0;
   line_data->bottom_ink = 0;
   line_data->valid = FALSE;
+  line_data->estimated = FALSE;
 
   return line_data;
 }
@@ -3977,7 +4196,7 @@ _gtk_text_line_byte_to_char (GtkTextLine *line,
   else
     {
       if (seg->type == &gtk_text_char_type)
-        return char_offset + g_utf8_strlen (seg->body.chars, byte_offset);
+        return char_offset + _gtk_char_segment_byte_to_char (seg, byte_offset);
       else
         {
           g_assert (seg->char_count == 1);
@@ -4184,7 +4403,7 @@ _gtk_text_line_byte_to_char_offsets (GtkTextLine *line,
 
   if (seg->type == &gtk_text_char_type)
     {
-      *seg_char_offset = g_utf8_strlen (seg->body.chars, offset);
+      *seg_char_offset = _gtk_char_segment_byte_to_char (seg, offset);
 
       g_assert (*seg_char_offset < seg->char_count);
 
@@ -4229,16 +4448,7 @@ _gtk_text_line_char_to_byte_offsets (GtkTextLine *line,
 
   if (seg->type == &gtk_text_char_type)
     {
-      const char *p;
-
-      /* if in the last fourth of the segment walk backwards */
-      if (seg->char_count - offset < seg->char_count / 4)
-        p = g_utf8_offset_to_pointer (seg->body.chars + seg->byte_count, 
-                                      offset - seg->char_count);
-      else
-        p = g_utf8_offset_to_pointer (seg->body.chars, offset);
-
-      *seg_byte_offset = p - seg->body.chars;
+      *seg_byte_offset = _gtk_char_segment_char_to_byte (seg, offset);
 
       g_assert (*seg_byte_offset < seg->byte_count);
 
@@ -5132,8 +5342,7 @@ gtk_text_btree_node_validate (BTreeView         *view,
             break;
           else
             {
-              if (ld)
-                state->old_height += ld->height;
+              state->old_height += line_data_get_height (ld, view_id);
               ld = gtk_text_layout_wrap (view->layout, line, ld);
               state->new_height += ld->height;
 
@@ -5161,10 +5370,8 @@ gtk_text_btree_node_validate (BTreeView         *view,
             node_valid = FALSE;
 
           if (ld)
-            {
-              node_width = MAX (ld->width, node_width);
-              node_height += ld->height;
-            }
+            node_width = MAX (ld->width, node_width);
+          node_height += line_data_get_height (ld, view_id);
 
           line = line->next;
         }
@@ -5331,10 +5538,8 @@ gtk_text_btree_node_compute_view_aggregates (GtkTextBTreeNode *node,
             valid = FALSE;
 
           if (ld)
-            {
-              width = MAX (ld->width, width);
-              height += ld->height;
-            }
+            width = MAX (ld->width, width);
+          height += line_data_get_height (ld, view_id);
 
           line = line->next;
         }
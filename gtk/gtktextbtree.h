@@ -96,6 +96,8 @@ void         _gtk_text_btree_get_view_size     (GtkTextBTree      *tree,
                                                 gpointer           view_id,
                                                 int               *width,
                                                 int               *height);
+void         _gtk_text_btree_update_view_size  (GtkTextBTree      *tree,
+                                                gpointer           view_id);
 gboolean     _gtk_text_btree_is_valid          (GtkTextBTree      *tree,
                                                 gpointer           view_id);
 gboolean     _gtk_text_btree_validate          (GtkTextBTree      *tree,
@@ -114,6 +116,8 @@ void _gtk_text_btree_tag (const GtkTextIter *start,
                           const GtkTextIter *end,
                           GtkTextTag        *tag,
                           gboolean           apply);
+void _gtk_text_btree_begin_tag_batch (GtkTextBTree *tree);
+void _gtk_text_btree_end_tag_batch   (GtkTextBTree *tree);
 
 /* "Getters" */
 
@@ -227,6 +231,7 @@ struct _GtkTextLineData {
   int bottom_ink : 16;
   signed int width : 24;
   guint valid : 8;		/* Actually a boolean */
+  guint estimated : 1;		/* Size is a guess, the line was not laid out */
 };
 
 /*
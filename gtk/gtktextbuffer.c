@@ -39,6 +39,7 @@
 #include "gtkintl.h"
 
 #define DEFAULT_MAX_UNDO 200
+#define DEFAULT_MAX_UNDO_BYTES (64 * 1024 * 1024)
 
 /**
  * SECTION:gtktextbuffer
@@ -958,6 +959,7 @@ gtk_text_buffer_init (GtkTextBuffer *buffer)
   buffer->priv->history = gtk_text_history_new (&history_funcs, buffer);
 
   gtk_text_history_set_max_undo_levels (buffer->priv->history, DEFAULT_MAX_UNDO);
+  gtk_text_history_set_max_undo_bytes (buffer->priv->history, DEFAULT_MAX_UNDO_BYTES);
 }
 
 static void
@@ -1172,6 +1174,11 @@ gtk_text_buffer_get_tag_table (GtkTextBuffer *buffer)
  *
  * Deletes current contents of @buffer, and inserts @text instead. If
  * @len is -1, @text must be nul-terminated. @text must be valid UTF-8.
+ *
+ * The text is copied into @buffer, so @text does not need to stay
+ * around. When loading large files, consider mapping them with
+ * g_mapped_file_new() instead of reading them into memory, to avoid
+ * holding a second copy of the contents while they are inserted.
  **/
 void
 gtk_text_buffer_set_text (GtkTextBuffer *buffer,
@@ -2974,6 +2981,50 @@ gtk_text_buffer_apply_tag (GtkTextBuffer     *buffer,
   gtk_text_buffer_emit_tag (buffer, tag, TRUE, start, end);
 }
 
+/**
+ * gtk_text_buffer_apply_tag_spans:
+ * @buffer: a #GtkTextBuffer
+ * @tag: a #GtkTextTag
+ * @offsets: (array): pairs of character offsets for the start and
+ *   end of each span
+ * @n_spans: the number of spans in @offsets
+ *
+ * Applies @tag to many spans of text at once. This is the same as
+ * calling gtk_text_buffer_apply_tag() for each span, and emits the
+ * “apply-tag” signal for each of them, but the views of @buffer are
+ * only updated once at the end. This is a lot faster when applying
+ * tags to many small ranges, for example when highlighting syntax.
+ *
+ * @offsets has to contain 2 * @n_spans offsets. The start and end
+ * of a span do not have to be in order.
+ **/
+void
+gtk_text_buffer_apply_tag_spans (GtkTextBuffer *buffer,
+                                 GtkTextTag    *tag,
+                                 const int     *offsets,
+                                 guint          n_spans)
+{
+  GtkTextIter start, end;
+  guint i;
+
+  g_return_if_fail (GTK_IS_TEXT_BUFFER (buffer));
+  g_return_if_fail (GTK_IS_TEXT_TAG (tag));
+  g_return_if_fail (offsets != NULL || n_spans == 0);
+  g_return_if_fail (tag->priv->table == buffer->priv->tag_table);
+
+  _gtk_text_btree_begin_tag_batch (get_btree (buffer));
+
+  for (i = 0; i < n_spans; i++)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &start, offsets[2 * i]);
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, offsets[2 * i + 1]);
+
+      gtk_text_buffer_emit_tag (buffer, tag, TRUE, &start, &end);
+    }
+
+  _gtk_text_btree_end_tag_batch (get_btree (buffer));
+}
+
 /**
  * gtk_text_buffer_remove_tag:
  * @buffer: a #GtkTextBuffer
@@ -336,6 +336,11 @@ void gtk_text_buffer_apply_tag             (GtkTextBuffer     *buffer,
                                             const GtkTextIter *start,
                                             const GtkTextIter *end);
 GDK_AVAILABLE_IN_ALL
+void gtk_text_buffer_apply_tag_spans       (GtkTextBuffer     *buffer,
+                                            GtkTextTag        *tag,
+                                            const int         *offsets,
+                                            guint              n_spans);
+GDK_AVAILABLE_IN_ALL
 void gtk_text_buffer_remove_tag            (GtkTextBuffer     *buffer,
                                             GtkTextTag        *tag,
                                             const GtkTextIter *start,
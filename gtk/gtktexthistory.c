@@ -19,6 +19,8 @@
 #include "gtkistringprivate.h"
 #include "gtktexthistoryprivate.h"
 
+#include <gio/gio.h>
+
 /*
  * The GtkTextHistory works in a way that allows text widgets to deliver
  * information about changes to the underlying text at given offsets within
@@ -36,8 +38,17 @@
  * gtk_text_history_end_irreversible_action() can be used to denote a
  * section of operations that cannot be undone. This will cause all previous
  * changes tracked by the GtkTextHistory to be discarded.
+ *
+ * Besides the number of undo levels, the history can be limited by the
+ * number of bytes of text it keeps. To make large pastes and replaces
+ * cheaper to keep around, the text of actions that are more than
+ * COLD_ACTIONS actions away from the newest one gets compressed. It is
+ * uncompressed again only while the action is undone or redone.
  */
 
+#define COLD_ACTIONS        8
+#define MIN_COMPRESS_BYTES  4096
+
 typedef struct _Action     Action;
 typedef enum   _ActionKind ActionKind;
 
@@ -58,6 +69,7 @@ struct _Action
   GList link;
   guint is_modified : 1;
   guint is_modified_set : 1;
+  guint n_compressed_bytes; /* 0 unless the text is compressed */
   union {
     struct {
       IString istr;
@@ -98,6 +110,8 @@ struct _GtkTextHistory
   guint               irreversible;
   guint               in_user;
   guint               max_undo_levels;
+  gsize               max_undo_bytes;
+  gsize               n_bytes;
 
   guint               can_undo : 1;
   guint               can_redo : 1;
@@ -139,6 +153,144 @@ uint_order (guint *a,
     }
 }
 
+/* The insert and delete actions keep their text at the same place */
+static inline IString *
+action_get_istr (Action *action)
+{
+  switch (action->kind)
+    {
+    case ACTION_KIND_INSERT:
+      return &action->u.insert.istr;
+
+    case ACTION_KIND_DELETE_BACKSPACE:
+    case ACTION_KIND_DELETE_KEY:
+    case ACTION_KIND_DELETE_PROGRAMMATIC:
+    case ACTION_KIND_DELETE_SELECTION:
+      return &action->u.delete.istr;
+
+    case ACTION_KIND_BARRIER:
+    case ACTION_KIND_GROUP:
+    default:
+      return NULL;
+    }
+}
+
+/* The number of bytes of text kept for @action */
+static gsize
+action_get_size (Action *action)
+{
+  IString *istr;
+
+  if (action->kind == ACTION_KIND_GROUP)
+    {
+      gsize size = 0;
+
+      for (const GList *iter = action->u.group.actions.head; iter; iter = iter->next)
+        size += action_get_size (iter->data);
+
+      return size;
+    }
+
+  istr = action_get_istr (action);
+  if (istr == NULL)
+    return 0;
+
+  if (action->n_compressed_bytes > 0)
+    return action->n_compressed_bytes;
+
+  return istr->n_bytes;
+}
+
+/* Compresses the text of @action, if that is worth it.
+ * Returns the change in the number of bytes kept.
+ */
+static gssize
+action_compress (Action *action)
+{
+  GConverter *compressor;
+  GConverterResult result;
+  IString *istr;
+  gsize bytes_read, bytes_written;
+  char *compressed;
+
+  if (action->kind == ACTION_KIND_GROUP)
+    {
+      gssize delta = 0;
+
+      for (const GList *iter = action->u.group.actions.head; iter; iter = iter->next)
+        delta += action_compress (iter->data);
+
+      return delta;
+    }
+
+  istr = action_get_istr (action);
+  if (istr == NULL ||
+      action->n_compressed_bytes > 0 ||
+      istr->n_bytes < MIN_COMPRESS_BYTES)
+    return 0;
+
+  /* Anything that doesn't shrink to 3/4 is kept as it is */
+  compressed = g_malloc (istr->n_bytes * 3 / 4);
+  compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, 1));
+  result = g_converter_convert (compressor,
+                                istring_str (istr), istr->n_bytes,
+                                compressed, istr->n_bytes * 3 / 4,
+                                G_CONVERTER_INPUT_AT_END,
+                                &bytes_read, &bytes_written,
+                                NULL);
+  g_object_unref (compressor);
+
+  if (result != G_CONVERTER_FINISHED)
+    {
+      g_free (compressed);
+      return 0;
+    }
+
+  g_free (istr->u.str);
+  istr->u.str = g_realloc (compressed, bytes_written);
+  action->n_compressed_bytes = bytes_written;
+
+  return (gssize) bytes_written - (gssize) istr->n_bytes;
+}
+
+/* Returns the text of an insert or delete action. If it is
+ * compressed, it is uncompressed into @text_to_free.
+ */
+static const char *
+action_get_text (Action  *action,
+                 char   **text_to_free)
+{
+  IString *istr = action_get_istr (action);
+  GConverter *decompressor;
+  GConverterResult result;
+  gsize bytes_read, bytes_written;
+  char *text;
+
+  g_assert (istr != NULL);
+
+  *text_to_free = NULL;
+
+  if (action->n_compressed_bytes == 0)
+    return istring_str (istr);
+
+  text = g_malloc (istr->n_bytes + 1);
+  decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+  result = g_converter_convert (decompressor,
+                                istr->u.str, action->n_compressed_bytes,
+                                text, istr->n_bytes + 1,
+                                G_CONVERTER_INPUT_AT_END,
+                                &bytes_read, &bytes_written,
+                                NULL);
+  g_object_unref (decompressor);
+
+  g_warn_if_fail (result == G_CONVERTER_FINISHED && bytes_written == istr->n_bytes);
+  text[istr->n_bytes] = '\0';
+
+  *text_to_free = text;
+
+  return text;
+}
+
 static void
 clear_action_queue (GQueue *queue)
 {
@@ -232,6 +384,10 @@ action_chain (Action   *action,
   if (action->kind != other->kind)
     return FALSE;
 
+  /* Compressed text can't be extended */
+  if (action->n_compressed_bytes > 0)
+    return FALSE;
+
   switch (action->kind)
     {
     case ACTION_KIND_INSERT: {
@@ -384,6 +540,27 @@ gtk_text_history_do_select (GtkTextHistory *self,
   self->funcs.select (self->funcs_data, selection_insert, selection_bound);
 }
 
+/* Frees an action that has been unlinked from the queues */
+static void
+gtk_text_history_discard (GtkTextHistory *self,
+                          Action         *action)
+{
+  self->n_bytes -= MIN (action_get_size (action), self->n_bytes);
+  action_free (action);
+}
+
+static void
+gtk_text_history_clear_queue (GtkTextHistory *self,
+                              GQueue         *queue)
+{
+  while (queue->length > 0)
+    {
+      Action *action = g_queue_peek_head (queue);
+      g_queue_unlink (queue, &action->link);
+      gtk_text_history_discard (self, action);
+    }
+}
+
 static void
 gtk_text_history_truncate_one (GtkTextHistory *self)
 {
@@ -391,13 +568,13 @@ gtk_text_history_truncate_one (GtkTextHistory *self)
     {
       Action *action = g_queue_peek_head (&self->undo_queue);
       g_queue_unlink (&self->undo_queue, &action->link);
-      action_free (action);
+      gtk_text_history_discard (self, action);
     }
   else if (self->redo_queue.length > 0)
     {
       Action *action = g_queue_peek_tail (&self->redo_queue);
       g_queue_unlink (&self->redo_queue, &action->link);
-      action_free (action);
+      gtk_text_history_discard (self, action);
     }
   else
     {
@@ -410,11 +587,33 @@ gtk_text_history_truncate (GtkTextHistory *self)
 {
   g_assert (GTK_IS_TEXT_HISTORY (self));
 
-  if (self->max_undo_levels == 0)
-    return;
+  if (self->max_undo_levels > 0)
+    {
+      while (self->undo_queue.length + self->redo_queue.length > self->max_undo_levels)
+        gtk_text_history_truncate_one (self);
+    }
+
+  /* The newest action is always kept, so it can be undone */
+  if (self->max_undo_bytes > 0)
+    {
+      while (self->n_bytes > self->max_undo_bytes &&
+             self->undo_queue.length + self->redo_queue.length > 1)
+        gtk_text_history_truncate_one (self);
+    }
+}
+
+/* Compresses the action that just went cold */
+static void
+gtk_text_history_compress_cold (GtkTextHistory *self)
+{
+  GList *link = self->undo_queue.tail;
+  guint i;
+
+  for (i = 0; link != NULL && i < COLD_ACTIONS; i++)
+    link = link->prev;
 
-  while (self->undo_queue.length + self->redo_queue.length > self->max_undo_levels)
-    gtk_text_history_truncate_one (self);
+  if (link != NULL)
+    self->n_bytes += action_compress (link->data);
 }
 
 static void
@@ -422,8 +621,8 @@ gtk_text_history_finalize (GObject *object)
 {
   GtkTextHistory *self = (GtkTextHistory *)object;
 
-  clear_action_queue (&self->undo_queue);
-  clear_action_queue (&self->redo_queue);
+  gtk_text_history_clear_queue (self, &self->undo_queue);
+  gtk_text_history_clear_queue (self, &self->redo_queue);
 
   G_OBJECT_CLASS (gtk_text_history_parent_class)->finalize (object);
 }
@@ -498,18 +697,18 @@ gtk_text_history_push (GtkTextHistory *self,
   g_assert (self->enabled);
   g_assert (action != NULL);
 
-  while (self->redo_queue.length > 0)
-    {
-      peek = g_queue_peek_head (&self->redo_queue);
-      g_queue_unlink (&self->redo_queue, &peek->link);
-      action_free (peek);
-    }
+  gtk_text_history_clear_queue (self, &self->redo_queue);
+
+  self->n_bytes += action_get_size (action);
 
   peek = g_queue_peek_tail (&self->undo_queue);
   in_user_action = self->in_user > 0;
 
   if (peek == NULL || !action_chain (peek, action, in_user_action))
-    g_queue_push_tail_link (&self->undo_queue, &action->link);
+    {
+      g_queue_push_tail_link (&self->undo_queue, &action->link);
+      gtk_text_history_compress_cold (self);
+    }
 
   gtk_text_history_truncate (self);
   gtk_text_history_update_state (self);
@@ -551,6 +750,8 @@ gtk_text_history_apply (GtkTextHistory *self,
                         Action         *action,
                         Action         *peek)
 {
+  char *text = NULL;
+
   g_assert (GTK_IS_TEXT_HISTORY (self));
   g_assert (action != NULL);
 
@@ -560,7 +761,7 @@ gtk_text_history_apply (GtkTextHistory *self,
       gtk_text_history_do_insert (self,
                                   action->u.insert.begin,
                                   action->u.insert.end,
-                                  istring_str (&action->u.insert.istr),
+                                  action_get_text (action, &text),
                                   action->u.insert.istr.n_bytes);
 
       /* If the next item is a DELETE_SELECTION, then we want to
@@ -585,7 +786,7 @@ gtk_text_history_apply (GtkTextHistory *self,
       gtk_text_history_do_delete (self,
                                   action->u.delete.begin,
                                   action->u.delete.end,
-                                  istring_str (&action->u.delete.istr),
+                                  action_get_text (action, &text),
                                   action->u.delete.istr.n_bytes);
       gtk_text_history_do_select (self,
                                   action->u.delete.begin,
@@ -610,12 +811,16 @@ gtk_text_history_apply (GtkTextHistory *self,
 
   if (action->is_modified_set)
     self->is_modified = action->is_modified;
+
+  g_free (text);
 }
 
 static void
 gtk_text_history_reverse (GtkTextHistory *self,
                           Action         *action)
 {
+  char *text = NULL;
+
   g_assert (GTK_IS_TEXT_HISTORY (self));
   g_assert (action != NULL);
 
@@ -625,7 +830,7 @@ gtk_text_history_reverse (GtkTextHistory *self,
       gtk_text_history_do_delete (self,
                                   action->u.insert.begin,
                                   action->u.insert.end,
-                                  istring_str (&action->u.insert.istr),
+                                  action_get_text (action, &text),
                                   action->u.insert.istr.n_bytes);
       gtk_text_history_do_select (self,
                                   action->u.insert.begin,
@@ -639,7 +844,7 @@ gtk_text_history_reverse (GtkTextHistory *self,
       gtk_text_history_do_insert (self,
                                   action->u.delete.begin,
                                   action->u.delete.end,
-                                  istring_str (&action->u.delete.istr),
+                                  action_get_text (action, &text),
                                   action->u.delete.istr.n_bytes);
       if (action->u.delete.selection.insert != -1 &&
           action->u.delete.selection.bound != -1)
@@ -670,6 +875,8 @@ gtk_text_history_reverse (GtkTextHistory *self,
 
   if (action->is_modified_set)
     self->is_modified = !action->is_modified;
+
+  g_free (text);
 }
 
 static void
@@ -791,7 +998,7 @@ gtk_text_history_end_user_action (GtkTextHistory *self)
   return_if_applying (self);
   return_if_irreversible (self);
 
-  clear_action_queue (&self->redo_queue);
+  gtk_text_history_clear_queue (self, &self->redo_queue);
 
   peek = g_queue_peek_tail (&self->undo_queue);
 
@@ -814,7 +1021,7 @@ gtk_text_history_end_user_action (GtkTextHistory *self)
   if (action_group_is_empty (peek))
     {
       g_queue_unlink (&self->undo_queue, &peek->link);
-      action_free (peek);
+      gtk_text_history_discard (self, peek);
       goto update_state;
     }
 
@@ -843,8 +1050,8 @@ gtk_text_history_begin_irreversible_action (GtkTextHistory *self)
 
   self->irreversible++;
 
-  clear_action_queue (&self->undo_queue);
-  clear_action_queue (&self->redo_queue);
+  gtk_text_history_clear_queue (self, &self->undo_queue);
+  gtk_text_history_clear_queue (self, &self->redo_queue);
 
   gtk_text_history_update_state (self);
 }
@@ -865,8 +1072,8 @@ gtk_text_history_end_irreversible_action (GtkTextHistory *self)
 
   self->irreversible--;
 
-  clear_action_queue (&self->undo_queue);
-  clear_action_queue (&self->redo_queue);
+  gtk_text_history_clear_queue (self, &self->undo_queue);
+  gtk_text_history_clear_queue (self, &self->redo_queue);
 
   gtk_text_history_update_state (self);
 }
@@ -1034,8 +1241,8 @@ gtk_text_history_set_enabled (GtkTextHistory *self,
         {
           self->irreversible = 0;
           self->in_user = 0;
-          clear_action_queue (&self->undo_queue);
-          clear_action_queue (&self->redo_queue);
+          gtk_text_history_clear_queue (self, &self->undo_queue);
+          gtk_text_history_clear_queue (self, &self->redo_queue);
         }
 
       gtk_text_history_update_state (self);
@@ -1062,3 +1269,28 @@ gtk_text_history_set_max_undo_levels (GtkTextHistory *self,
       gtk_text_history_truncate (self);
     }
 }
+
+gsize
+gtk_text_history_get_max_undo_bytes (GtkTextHistory *self)
+{
+  g_return_val_if_fail (GTK_IS_TEXT_HISTORY (self), 0);
+
+  return self->max_undo_bytes;
+}
+
+/* Limits the number of bytes of text kept for undo and redo,
+ * counting compressed text with its compressed size. 0 means
+ * no limit.
+ */
+void
+gtk_text_history_set_max_undo_bytes (GtkTextHistory *self,
+                                     gsize           max_undo_bytes)
+{
+  g_return_if_fail (GTK_IS_TEXT_HISTORY (self));
+
+  if (self->max_undo_bytes != max_undo_bytes)
+    {
+      self->max_undo_bytes = max_undo_bytes;
+      gtk_text_history_truncate (self);
+    }
+}
@@ -61,6 +61,9 @@ void            gtk_text_history_redo                      (GtkTextHistory
 guint           gtk_text_history_get_max_undo_levels       (GtkTextHistory            *self);
 void            gtk_text_history_set_max_undo_levels       (GtkTextHistory            *self,
                                                             guint                      max_undo_levels);
+gsize           gtk_text_history_get_max_undo_bytes        (GtkTextHistory            *self);
+void            gtk_text_history_set_max_undo_bytes        (GtkTextHistory            *self,
+                                                            gsize                      max_undo_bytes);
 void            gtk_text_history_modified_changed          (GtkTextHistory            *self,
                                                             gboolean                   modified);
 void            gtk_text_history_selection_changed         (GtkTextHistory            *self,
@@ -2378,15 +2378,17 @@ gtk_text_iter_backward_chars (GtkTextIter *iter, int count)
           const char *p;
           int new_byte_offset;
 
-          /* if in the last fourth of the segment walk backwards */
-          if (count < real->segment_char_offset / 4)
-            p = g_utf8_offset_to_pointer (real->segment->body.chars + real->segment_byte_offset, 
-                                          -count);
+          /* short distances are walked backwards */
+          if (count < MIN (real->segment_char_offset / 4, MAX_LINEAR_SCAN))
+            {
+              p = g_utf8_offset_to_pointer (real->segment->body.chars + real->segment_byte_offset,
+                                            -count);
+              new_byte_offset = p - real->segment->body.chars;
+            }
           else
-            p = g_utf8_offset_to_pointer (real->segment->body.chars,
-                                          real->segment_char_offset - count);
+            new_byte_offset = _gtk_char_segment_char_to_byte (real->segment,
+                                                              real->segment_char_offset - count);
 
-          new_byte_offset = p - real->segment->body.chars;
           real->line_byte_offset -= (real->segment_byte_offset - new_byte_offset);
           real->segment_byte_offset = new_byte_offset;
         }
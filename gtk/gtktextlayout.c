@@ -109,6 +109,9 @@ struct _GtkTextLayoutPrivate
 
   /* Cache for GtkTextLineDisplay to reduce overhead creating layouts */
   GtkTextLineDisplayCache *cache;
+
+  /* Height used for lines that were never laid out, -1 if unknown */
+  int estimated_line_height;
 };
 
 static void gtk_text_layout_invalidated     (GtkTextLayout     *layout);
@@ -124,6 +127,7 @@ static void gtk_text_layout_emit_changed           (GtkTextLayout     *layout,
 						    int                new_height);
 
 static void gtk_text_layout_invalidate_all (GtkTextLayout *layout);
+static void update_layout_size (GtkTextLayout *layout);
 
 static PangoAttribute *gtk_text_attr_appearance_new (const GtkTextAppearance *appearance);
 
@@ -281,6 +285,7 @@ gtk_text_layout_init (GtkTextLayout *text_layout)
 
   text_layout->cursor_visible = TRUE;
   priv->cache = gtk_text_line_display_cache_new ();
+  priv->estimated_line_height = -1;
 }
 
 GtkTextLayout*
@@ -307,6 +312,8 @@ void
 gtk_text_layout_set_buffer (GtkTextLayout *layout,
                             GtkTextBuffer *buffer)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
   g_return_if_fail (buffer == NULL || GTK_IS_TEXT_BUFFER (buffer));
 
@@ -315,6 +322,9 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
 
   free_style_cache (layout);
 
+  if (priv->cache != NULL)
+    gtk_text_line_display_cache_set_buffer (priv->cache, buffer);
+
   if (layout->buffer)
     {
       _gtk_text_btree_remove_view (_gtk_text_buffer_get_btree (layout->buffer),
@@ -371,11 +381,64 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
     }
 }
 
+/**
+ * gtk_text_layout_get_estimated_line_height:
+ * @layout: a #GtkTextLayout
+ *
+ * Gets the height that is assumed for lines that have not been laid
+ * out yet. This is the height of a line with the default style, so
+ * that the size of the layout is close to its final size long before
+ * all lines have been validated.
+ *
+ * Returns: the estimated line height in pixels
+ **/
+int
+gtk_text_layout_get_estimated_line_height (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  PangoFontMetrics *metrics;
+  GtkTextAttributes *style;
+
+  if (priv->estimated_line_height >= 0)
+    return priv->estimated_line_height;
+
+  style = layout->default_style;
+  if (layout->ltr_context == NULL || style == NULL || style->font == NULL)
+    return 0;
+
+  metrics = pango_context_get_metrics (layout->ltr_context, style->font, style->language);
+  priv->estimated_line_height = PANGO_PIXELS (pango_font_metrics_get_ascent (metrics) +
+                                              pango_font_metrics_get_descent (metrics)) +
+                                style->pixels_above_lines + style->pixels_below_lines;
+  pango_font_metrics_unref (metrics);
+
+  return priv->estimated_line_height;
+}
+
+/* The estimate is included in the sizes stored in the btree, so those
+ * need to be recomputed when it changes.
+ */
+static void
+gtk_text_layout_reset_estimated_line_height (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  priv->estimated_line_height = -1;
+
+  if (layout->buffer == NULL)
+    return;
+
+  _gtk_text_btree_update_view_size (_gtk_text_buffer_get_btree (layout->buffer), layout);
+  update_layout_size (layout);
+}
+
 void
 gtk_text_layout_default_style_changed (GtkTextLayout *layout)
 {
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
 
+  gtk_text_layout_reset_estimated_line_height (layout);
+
   DV (g_print ("invalidating all due to default style change (%s)\n", G_STRLOC));
   gtk_text_layout_invalidate_all (layout);
 }
@@ -425,6 +488,8 @@ gtk_text_layout_set_contexts (GtkTextLayout *layout,
       g_object_ref (layout->rtl_context);
     }
 
+  gtk_text_layout_reset_estimated_line_height (layout);
+
   DV (g_print ("invalidating all due to new pango contexts (%s)\n", G_STRLOC));
   gtk_text_layout_invalidate_all (layout);
 }
@@ -929,6 +994,19 @@ update_layout_size (GtkTextLayout *layout)
 				&layout->width, &layout->height);
 }
 
+/* Lines are laid out for real once they are validated onscreen.
+ * The display gets cached, so gtk_text_layout_wrap() can take the
+ * size from it.
+ */
+static void
+lay_out_estimated_line (GtkTextLayout   *layout,
+                        GtkTextLine     *line,
+                        GtkTextLineData *line_data)
+{
+  gtk_text_line_display_unref (gtk_text_layout_get_line_display (layout, line, FALSE));
+  line_data->valid = FALSE;
+}
+
 /**
  * gtk_text_layout_validate_yrange:
  * @layout: a #GtkTextLayout
@@ -973,7 +1051,7 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
   while (line && seen < -y0)
     {
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
-      if (!line_data || !line_data->valid)
+      if (!line_data || !line_data->valid || line_data->estimated)
         {
           int old_height, new_height;
           int top_ink, bottom_ink;
@@ -982,6 +1060,9 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
           top_ink = line_data ? line_data->top_ink : 0;
           bottom_ink = line_data ? line_data->bottom_ink : 0;
 
+          if (line_data && line_data->estimated)
+            lay_out_estimated_line (layout, line, line_data);
+
           _gtk_text_btree_validate_line (_gtk_text_buffer_get_btree (layout->buffer),
                                          line, layout);
           line_data = _gtk_text_line_get_data (line, layout);
@@ -1014,7 +1095,7 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
   while (line && seen < y1)
     {
       GtkTextLineData *line_data = _gtk_text_line_get_data (line, layout);
-      if (!line_data || !line_data->valid)
+      if (!line_data || !line_data->valid || line_data->estimated)
         {
           int old_height, new_height;
           int top_ink, bottom_ink;
@@ -1023,6 +1104,9 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
           top_ink = line_data ? line_data->top_ink : 0;
           bottom_ink = line_data ? line_data->bottom_ink : 0;
 
+          if (line_data && line_data->estimated)
+            lay_out_estimated_line (layout, line, line_data);
+
           _gtk_text_btree_validate_line (_gtk_text_buffer_get_btree (layout->buffer),
                                          line, layout);
           line_data = _gtk_text_line_get_data (line, layout);
@@ -1096,6 +1180,72 @@ gtk_text_layout_validate (GtkTextLayout *layout,
     }
 }
 
+/* Lines with more bytes than this are not laid out when they are
+ * validated offscreen. Their size is estimated from the font metrics
+ * of the default style, which is a lot cheaper than shaping the
+ * whole paragraph. They get laid out once they are validated
+ * onscreen, see gtk_text_layout_validate_yrange().
+ */
+#define LONG_LINE_BYTES (64 * 1024)
+
+static gboolean
+estimate_long_line (GtkTextLayout   *layout,
+                    GtkTextLine     *line,
+                    GtkTextLineData *line_data)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextAttributes *style = layout->default_style;
+  PangoFontMetrics *metrics;
+  gint64 text_width;
+  int line_height, wrap_line_height;
+  int char_width;
+  int h_margin, h_padding;
+
+  if (_gtk_text_line_byte_count (line) < LONG_LINE_BYTES ||
+      line == priv->cursor_line ||
+      gtk_text_line_display_cache_contains (priv->cache, line))
+    return FALSE;
+
+  line_height = gtk_text_layout_get_estimated_line_height (layout);
+  if (line_height <= 0)
+    return FALSE;
+
+  metrics = pango_context_get_metrics (layout->ltr_context, style->font, style->language);
+  char_width = MAX (PANGO_PIXELS_CEIL (pango_font_metrics_get_approximate_char_width (metrics)), 1);
+  pango_font_metrics_unref (metrics);
+
+  text_width = (gint64) _gtk_text_line_char_count (line) * char_width;
+  h_margin = style->left_margin + style->right_margin;
+  h_padding = layout->left_padding + layout->right_padding;
+
+  if (style->wrap_mode == GTK_WRAP_NONE)
+    {
+      line_data->width = MIN (text_width + h_margin + h_padding, (1 << 23) - 1);
+      line_data->height = line_height;
+    }
+  else
+    {
+      int wrap_width = MAX (layout->screen_width - h_margin - h_padding, char_width);
+      gint64 n_lines = (text_width + wrap_width - 1) / wrap_width;
+
+      /* The estimated line height includes the space above and below
+       * the paragraph, which is only added once.
+       */
+      wrap_line_height = line_height - style->pixels_above_lines - style->pixels_below_lines +
+                         style->pixels_inside_wrap;
+
+      line_data->width = MIN (text_width, wrap_width) + h_margin + h_padding;
+      line_data->height = MIN (line_height + (n_lines - 1) * wrap_line_height, G_MAXINT / 2);
+    }
+
+  line_data->top_ink = 0;
+  line_data->bottom_ink = 0;
+  line_data->valid = TRUE;
+  line_data->estimated = TRUE;
+
+  return TRUE;
+}
+
 GtkTextLineData *
 gtk_text_layout_wrap (GtkTextLayout   *layout,
                       GtkTextLine     *line,
@@ -1114,10 +1264,14 @@ gtk_text_layout_wrap (GtkTextLayout   *layout,
       _gtk_text_line_add_data (line, line_data);
     }
 
+  if (estimate_long_line (layout, line, line_data))
+    return line_data;
+
   display = gtk_text_layout_get_line_display (layout, line, TRUE);
   line_data->width = display->width;
   line_data->height = display->height;
   line_data->valid = TRUE;
+  line_data->estimated = FALSE;
   pango_layout_get_pixel_extents (display->layout, &ink_rect, &logical_rect);
   line_data->top_ink = MAX (0, logical_rect.x - ink_rect.x);
   line_data->bottom_ink = MAX (0, logical_rect.x + logical_rect.width - ink_rect.x - ink_rect.width);
@@ -2610,6 +2764,21 @@ gtk_text_layout_create_display (GtkTextLayout *layout,
   pango_layout_set_text (display->layout, text, layout_byte_offset);
   pango_layout_set_attributes (display->layout, attrs);
 
+  /* Another view of the buffer may have laid out the same
+   * paragraph already, for example in a split editor.
+   */
+  if (priv->cache != NULL)
+    {
+      PangoLayout *shared;
+
+      shared = gtk_text_line_display_cache_find_layout (priv->cache, line, display->layout);
+      if (shared != NULL)
+        {
+          g_object_unref (display->layout);
+          display->layout = shared;
+        }
+    }
+
   tmp_list1 = cursor_byte_offsets;
   tmp_list2 = cursor_segs;
   while (tmp_list1)
@@ -3900,8 +4069,7 @@ render_para (GskPangoRenderer   *crenderer,
              int                 offset_y,
              GtkTextLineDisplay *line_display,
              int                 selection_start_index,
-             int                 selection_end_index,
-             float               cursor_alpha)
+             int                 selection_end_index)
 {
   GtkStyleContext *context;
   PangoLayout *layout = line_display->layout;
@@ -4065,40 +4233,6 @@ render_para (GskPangoRenderer   *crenderer,
                                                                   selection_height));
                 }
             }
-          else if (line_display->has_block_cursor &&
-                   gtk_widget_has_focus (crenderer->widget) &&
-                   byte_offset <= line_display->insert_index &&
-                   (line_display->insert_index < byte_offset + line->length ||
-                    (at_last_line && line_display->insert_index == byte_offset + line->length)))
-            {
-              GdkRGBA cursor_color;
-              graphene_rect_t bounds = {
-                .origin.x = line_display->x_offset + line_display->block_cursor.x,
-                .origin.y = line_display->block_cursor.y + line_display->top_margin,
-                .size.width = line_display->block_cursor.width,
-                .size.height = line_display->block_cursor.height,
-              };
-
-              /* we draw text using base color on filled cursor rectangle of cursor color
-               * (normally white on black) */
-              _gtk_style_context_get_cursor_color (context, &cursor_color, NULL);
-
-              gtk_snapshot_push_opacity (crenderer->snapshot, cursor_alpha);
-              gtk_snapshot_append_color (crenderer->snapshot, &cursor_color, &bounds);
-
-              /* draw text under the cursor if any */
-              if (!line_display->cursor_at_line_end)
-                {
-                  gsk_pango_renderer_set_state (crenderer, GSK_PANGO_RENDERER_CURSOR);
-                  gtk_snapshot_push_clip (crenderer->snapshot, &bounds);
-                  pango_renderer_draw_layout_line (PANGO_RENDERER (crenderer),
-                                                   line,
-                                                   line_rect.x,
-                                                   baseline);
-                  gtk_snapshot_pop (crenderer->snapshot);
-                }
-              gtk_snapshot_pop (crenderer->snapshot);
-            }
         }
 
       byte_offset += line->length;
@@ -4111,6 +4245,88 @@ render_para (GskPangoRenderer   *crenderer,
   pango_layout_iter_free (iter);
 }
 
+/* The block cursor is drawn separately from render_para(), so that
+ * the render node of the paragraph can be reused while the cursor
+ * blinks or the focus changes.
+ */
+static void
+render_para_block_cursor (GskPangoRenderer   *crenderer,
+                          GtkTextLineDisplay *line_display,
+                          int                 selection_start_index,
+                          int                 selection_end_index,
+                          float               cursor_alpha)
+{
+  GtkStyleContext *context;
+  PangoLayoutIter *iter;
+  int byte_offset = 0;
+
+  context = _gtk_widget_get_style_context (crenderer->widget);
+  iter = pango_layout_get_iter (line_display->layout);
+
+  do
+    {
+      PangoLayoutLine *line = pango_layout_iter_get_line_readonly (iter);
+      PangoRectangle line_rect;
+      int baseline;
+      gboolean at_last_line;
+      gboolean selected;
+
+      pango_layout_iter_get_line_extents (iter, NULL, &line_rect);
+      baseline = pango_layout_iter_get_baseline (iter);
+
+      line_rect.x += line_display->x_offset * PANGO_SCALE;
+      baseline += line_display->top_margin * PANGO_SCALE;
+
+      at_last_line = pango_layout_iter_at_last_line (iter);
+
+      /* Like in render_para(), there is no block cursor on
+       * lines that are partially or completely selected
+       */
+      selected = (selection_start_index < byte_offset + line->length ||
+                  (selection_start_index == byte_offset + line->length && at_last_line)) &&
+                 selection_end_index > byte_offset;
+
+      if (!selected &&
+          byte_offset <= line_display->insert_index &&
+          (line_display->insert_index < byte_offset + line->length ||
+           (at_last_line && line_display->insert_index == byte_offset + line->length)))
+        {
+          GdkRGBA cursor_color;
+          graphene_rect_t bounds = {
+            .origin.x = line_display->x_offset + line_display->block_cursor.x,
+            .origin.y = line_display->block_cursor.y + line_display->top_margin,
+            .size.width = line_display->block_cursor.width,
+            .size.height = line_display->block_cursor.height,
+          };
+
+          /* we draw text using base color on filled cursor rectangle of cursor color
+           * (normally white on black) */
+          _gtk_style_context_get_cursor_color (context, &cursor_color, NULL);
+
+          gtk_snapshot_push_opacity (crenderer->snapshot, cursor_alpha);
+          gtk_snapshot_append_color (crenderer->snapshot, &cursor_color, &bounds);
+
+          /* draw text under the cursor if any */
+          if (!line_display->cursor_at_line_end)
+            {
+              gsk_pango_renderer_set_state (crenderer, GSK_PANGO_RENDERER_CURSOR);
+              gtk_snapshot_push_clip (crenderer->snapshot, &bounds);
+              pango_renderer_draw_layout_line (PANGO_RENDERER (crenderer),
+                                               line,
+                                               line_rect.x,
+                                               baseline);
+              gtk_snapshot_pop (crenderer->snapshot);
+            }
+          gtk_snapshot_pop (crenderer->snapshot);
+        }
+
+      byte_offset += line->length;
+    }
+  while (pango_layout_iter_next_line (iter));
+
+  pango_layout_iter_free (iter);
+}
+
 static gboolean
 snapshot_shape (PangoAttrShape         *attr,
                 GdkSnapshot            *snapshot,
@@ -4240,18 +4456,29 @@ gtk_text_layout_snapshot (GtkTextLayout      *layout,
             {
               gtk_snapshot_push_collect (snapshot);
               render_para (crenderer, 0, line_display,
-                           selection_start_index, selection_end_index,
-                           cursor_alpha);
+                           selection_start_index, selection_end_index);
 
               line_display->node = gtk_snapshot_pop_collect (snapshot);
             }
 
-          if (line_display->node != NULL)
+          if (line_display->node != NULL ||
+              (line_display->has_block_cursor && gtk_widget_has_focus (widget)))
             {
               gtk_snapshot_save (crenderer->snapshot);
               gtk_snapshot_translate (crenderer->snapshot,
                                       &GRAPHENE_POINT_INIT (0, offset_y));
-              gtk_snapshot_append_node (crenderer->snapshot, line_display->node);
+
+              if (line_display->node != NULL)
+                gtk_snapshot_append_node (crenderer->snapshot, line_display->node);
+
+              /* The block cursor is not part of the cached node, as it
+               * changes with the blinking and the focus
+               */
+              if (line_display->has_block_cursor && gtk_widget_has_focus (widget))
+                render_para_block_cursor (crenderer, line_display,
+                                          selection_start_index, selection_end_index,
+                                          cursor_alpha);
+
               gtk_snapshot_restore (crenderer->snapshot);
             }
 
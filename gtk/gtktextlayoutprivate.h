@@ -312,6 +312,7 @@ void     gtk_text_layout_validate        (GtkTextLayout *layout,
 GtkTextLineData* gtk_text_layout_wrap  (GtkTextLayout   *layout,
                                         GtkTextLine     *line,
                                         GtkTextLineData *line_data);
+int      gtk_text_layout_get_estimated_line_height (GtkTextLayout *layout);
 void     gtk_text_layout_changed              (GtkTextLayout     *layout,
                                                int                y,
                                                int                old_height,
@@ -23,11 +23,29 @@
 #include "gtktextbufferprivate.h"
 #include "gtktextiterprivate.h"
 #include "gtktextlinedisplaycacheprivate.h"
+#include "gtkpango.h"
+
+#include "gdk/gdkprofilerprivate.h"
 
 #define DEFAULT_MRU_SIZE         250
 #define BLOW_CACHE_TIMEOUT_SEC   20
 #define DEBUG_LINE_DISPLAY_CACHE 0
 
+/* All caches for views of the same buffer are in a group. They
+ * share a budget for the memory used by their displays, and the
+ * PangoLayouts of displays that come out the same. The memory used
+ * by a display is estimated from the number of characters in its
+ * layout, as shaping results and log attributes take up most of it.
+ */
+#define BUFFER_BUDGET_BYTES      (16 * 1024 * 1024)
+#define BYTES_PER_CHAR           48
+
+typedef struct
+{
+  GList *caches;
+  gsize  n_bytes;
+} GtkTextLineDisplayCacheGroup;
+
 struct _GtkTextLineDisplayCache
 {
   GSequence   *sorted_by_line;
@@ -37,6 +55,14 @@ struct _GtkTextLineDisplayCache
   GSource     *evict_source;
   guint        mru_size;
 
+  GtkTextLineDisplayCacheGroup *group;
+  gsize        n_bytes;
+  /* Displays used in the current and last frame, the cache
+   * isn't shrunk below that to fit the budget
+   */
+  guint        frame_lines;
+  guint        last_frame_lines;
+
 #if DEBUG_LINE_DISPLAY_CACHE
   guint       log_source;
   int         hits;
@@ -71,6 +97,32 @@ dump_stats (gpointer data)
 # define STAT_INC(val)
 #endif
 
+static guint hits_counter;
+static guint misses_counter;
+static guint bytes_counter;
+static int frame_hits;
+static int frame_misses;
+static gsize total_bytes;
+
+static gsize
+gtk_text_line_display_get_cost (GtkTextLineDisplay *display)
+{
+  gsize cost = sizeof (GtkTextLineDisplay);
+
+  if (display->layout != NULL)
+    cost += (gsize) pango_layout_get_character_count (display->layout) * BYTES_PER_CHAR;
+
+  return cost;
+}
+
+static gboolean
+gtk_text_line_display_cache_over_budget (GtkTextLineDisplayCache *cache)
+{
+  return cache->group != NULL &&
+         cache->group->n_bytes > BUFFER_BUDGET_BYTES &&
+         cache->mru.length > MAX (cache->frame_lines, cache->last_frame_lines);
+}
+
 GtkTextLineDisplayCache *
 gtk_text_line_display_cache_new (void)
 {
@@ -85,6 +137,13 @@ gtk_text_line_display_cache_new (void)
   ret->log_source = g_timeout_add_seconds (1, dump_stats, ret);
 #endif
 
+  if (hits_counter == 0)
+    {
+      hits_counter = gdk_profiler_define_int_counter ("text-line-display-hits", "Text Line Display Cache Hits");
+      misses_counter = gdk_profiler_define_int_counter ("text-line-display-misses", "Text Line Display Cache Misses");
+      bytes_counter = gdk_profiler_define_int_counter ("text-line-display-bytes", "Estimated Text Line Display Cache Size");
+    }
+
   return g_steal_pointer (&ret);
 }
 
@@ -97,6 +156,11 @@ gtk_text_line_display_cache_free (GtkTextLineDisplayCache *cache)
 
   gtk_text_line_display_cache_invalidate (cache);
 
+  g_assert (cache->n_bytes == 0);
+
+  if (cache->group != NULL)
+    cache->group->caches = g_list_remove (cache->group->caches, cache);
+
   g_clear_pointer (&cache->evict_source, g_source_destroy);
   g_clear_pointer (&cache->sorted_by_line, g_sequence_free);
   g_clear_pointer (&cache->line_to_display, g_hash_table_unref);
@@ -121,11 +185,30 @@ gtk_text_line_display_cache_blow_cb (gpointer data)
   return G_SOURCE_REMOVE;
 }
 
+/*
+ * gtk_text_line_display_cache_delay_eviction:
+ * @cache: a GtkTextLineDisplayCache
+ *
+ * Called once per frame by the layout after drawing the lines
+ * it got from @cache.
+ */
 void
 gtk_text_line_display_cache_delay_eviction (GtkTextLineDisplayCache *cache)
 {
   g_assert (cache != NULL);
 
+  cache->last_frame_lines = cache->frame_lines;
+  cache->frame_lines = 0;
+
+  if (GDK_PROFILER_IS_RUNNING)
+    {
+      gdk_profiler_set_int_counter (hits_counter, frame_hits);
+      gdk_profiler_set_int_counter (misses_counter, frame_misses);
+      gdk_profiler_set_int_counter (bytes_counter, total_bytes);
+      frame_hits = 0;
+      frame_misses = 0;
+    }
+
   if (cache->evict_source != NULL)
     {
       gint64 deadline;
@@ -180,6 +263,8 @@ gtk_text_line_display_cache_take_display (GtkTextLineDisplayCache *cache,
                                           GtkTextLineDisplay      *display,
                                           GtkTextLayout           *layout)
 {
+  gsize cost;
+
   g_assert (cache != NULL);
   g_assert (display != NULL);
   g_assert (display->line != NULL);
@@ -201,8 +286,15 @@ gtk_text_line_display_cache_take_display (GtkTextLineDisplayCache *cache,
   g_hash_table_insert (cache->line_to_display, display->line, display);
   g_queue_push_head_link (&cache->mru, &display->mru_link);
 
+  cost = gtk_text_line_display_get_cost (display);
+  cache->n_bytes += cost;
+  total_bytes += cost;
+  if (cache->group)
+    cache->group->n_bytes += cost;
+
   /* Cull the cache if we're at capacity */
-  while (cache->mru.length > cache->mru_size)
+  while (cache->mru.length > cache->mru_size ||
+         gtk_text_line_display_cache_over_budget (cache))
     {
       display = g_queue_peek_tail (&cache->mru);
 
@@ -241,6 +333,12 @@ gtk_text_line_display_cache_invalidate_display (GtkTextLineDisplayCache *cache,
   else
     {
       GSequenceIter *iter = g_steal_pointer (&display->cache_iter);
+      gsize cost = gtk_text_line_display_get_cost (display);
+
+      cache->n_bytes -= cost;
+      total_bytes -= cost;
+      if (cache->group)
+        cache->group->n_bytes -= cost;
 
       if (cache->cursor_line == display->line)
         cache->cursor_line = NULL;
@@ -290,6 +388,9 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
       if (size_only || !display->size_only)
         {
           STAT_INC (cache->hits);
+          frame_hits++;
+          if (!size_only)
+            cache->frame_lines++;
 
           if (!size_only && display->line == cache->cursor_line)
             gtk_text_layout_update_display_cursors (layout, display->line, display);
@@ -309,6 +410,7 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
     }
 
   STAT_INC (cache->misses);
+  frame_misses++;
 
   g_assert (!g_hash_table_lookup (cache->line_to_display, line));
 
@@ -322,6 +424,7 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
       if (line == cache->cursor_line)
         gtk_text_layout_update_display_cursors (layout, line, display);
 
+      cache->frame_lines++;
       gtk_text_line_display_cache_take_display (cache,
                                                 gtk_text_line_display_ref (display),
                                                 layout);
@@ -330,6 +433,19 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
   return g_steal_pointer (&display);
 }
 
+/* Whether a display for @line is cached. Only displays that are
+ * not size-only get cached.
+ */
+gboolean
+gtk_text_line_display_cache_contains (GtkTextLineDisplayCache *cache,
+                                      GtkTextLine             *line)
+{
+  g_assert (cache != NULL);
+  g_assert (line != NULL);
+
+  return g_hash_table_contains (cache->line_to_display, line);
+}
+
 void
 gtk_text_line_display_cache_invalidate (GtkTextLineDisplayCache *cache)
 {
@@ -755,3 +871,81 @@ gtk_text_line_display_cache_set_mru_size (GtkTextLineDisplayCache *cache,
         }
     }
 }
+
+/*
+ * gtk_text_line_display_cache_set_buffer:
+ * @cache: a GtkTextLineDisplayCache
+ * @buffer: (nullable): the buffer displayed by the layout of @cache
+ *
+ * Drops all displays and makes @cache share its memory budget with
+ * the caches of other views of @buffer.
+ */
+void
+gtk_text_line_display_cache_set_buffer (GtkTextLineDisplayCache *cache,
+                                        GtkTextBuffer           *buffer)
+{
+  g_assert (cache != NULL);
+
+  gtk_text_line_display_cache_invalidate (cache);
+
+  if (cache->group != NULL)
+    {
+      cache->group->caches = g_list_remove (cache->group->caches, cache);
+      cache->group = NULL;
+    }
+
+  if (buffer != NULL)
+    {
+      cache->group = g_object_get_data (G_OBJECT (buffer), "gtk-text-line-display-cache-group");
+      if (cache->group == NULL)
+        {
+          cache->group = g_new0 (GtkTextLineDisplayCacheGroup, 1);
+          g_object_set_data_full (G_OBJECT (buffer), "gtk-text-line-display-cache-group",
+                                  cache->group, g_free);
+        }
+      cache->group->caches = g_list_prepend (cache->group->caches, cache);
+    }
+}
+
+/*
+ * gtk_text_line_display_cache_find_layout:
+ * @cache: a GtkTextLineDisplayCache
+ * @line: a GtkTextLine
+ * @layout: the PangoLayout for @line, before it has been laid out
+ *
+ * Looks for a display of @line in the caches of other views of the
+ * same buffer with a PangoLayout that would come out the same as
+ * @layout, so that the work of laying it out can be shared.
+ *
+ * Returns: (transfer full) (nullable): an equivalent PangoLayout
+ */
+PangoLayout *
+gtk_text_line_display_cache_find_layout (GtkTextLineDisplayCache *cache,
+                                         GtkTextLine             *line,
+                                         PangoLayout             *layout)
+{
+  GList *l;
+
+  g_assert (cache != NULL);
+  g_assert (line != NULL);
+
+  if (cache->group == NULL)
+    return NULL;
+
+  for (l = cache->group->caches; l; l = l->next)
+    {
+      GtkTextLineDisplayCache *other = l->data;
+      GtkTextLineDisplay *display;
+
+      if (other == cache)
+        continue;
+
+      display = g_hash_table_lookup (other->line_to_display, line);
+      if (display != NULL &&
+          display->layout != NULL &&
+          gtk_pango_layout_equivalent (display->layout, layout))
+        return g_object_ref (display->layout);
+    }
+
+  return NULL;
+}
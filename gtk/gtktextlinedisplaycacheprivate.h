@@ -32,6 +32,8 @@ GtkTextLineDisplay      *gtk_text_line_display_cache_get                (GtkText
                                                                          GtkTextLayout           *layout,
                                                                          GtkTextLine             *line,
                                                                          gboolean                 size_only);
+gboolean                 gtk_text_line_display_cache_contains           (GtkTextLineDisplayCache *cache,
+                                                                         GtkTextLine             *line);
 void                     gtk_text_line_display_cache_delay_eviction     (GtkTextLineDisplayCache *cache);
 void                     gtk_text_line_display_cache_set_cursor_line    (GtkTextLineDisplayCache *cache,
                                                                          GtkTextLine             *line);
@@ -56,6 +58,11 @@ void                     gtk_text_line_display_cache_invalidate_y_range (GtkText
                                                                          gboolean                 cursors_only);
 void                     gtk_text_line_display_cache_set_mru_size       (GtkTextLineDisplayCache *cache,
                                                                          guint                    mru_size);
+void                     gtk_text_line_display_cache_set_buffer         (GtkTextLineDisplayCache *cache,
+                                                                         GtkTextBuffer           *buffer);
+PangoLayout             *gtk_text_line_display_cache_find_layout        (GtkTextLineDisplayCache *cache,
+                                                                         GtkTextLine             *line,
+                                                                         PangoLayout             *layout);
 
 G_END_DECLS
 
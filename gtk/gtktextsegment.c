@@ -157,6 +157,142 @@ gtk_text_line_segment_split (const GtkTextIter *iter)
 #define TSEG_SIZE ((unsigned) (G_STRUCT_OFFSET (GtkTextLineSegment, body) \
         + sizeof (GtkTextToggleBody)))
 
+/*
+ * Char offset index
+ *
+ * Converting between char and byte offsets in a char segment with
+ * multibyte characters means walking its UTF-8. For long segments,
+ * such as a long line inserted in one go, we keep the byte offset of
+ * every CHAR_INDEX_INTERVAL-th character, so a conversion only walks
+ * from the closest checkpoint. Char segments are never modified, they
+ * get replaced when split or merged, so an index stays valid until
+ * its segment is freed.
+ */
+
+#define CHAR_INDEX_MIN_CHARS 4096
+#define CHAR_INDEX_INTERVAL  256
+
+G_LOCK_DEFINE_STATIC (char_indexes);
+static GHashTable *char_indexes = NULL;
+
+static inline gboolean
+char_segment_wants_index (const GtkTextLineSegment *seg)
+{
+  return seg->char_count >= CHAR_INDEX_MIN_CHARS &&
+         seg->byte_count != seg->char_count;
+}
+
+static const int *
+char_segment_get_index (GtkTextLineSegment *seg)
+{
+  const char *p;
+  int *index;
+  int i, n;
+
+  G_LOCK (char_indexes);
+
+  if (char_indexes == NULL)
+    char_indexes = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  index = g_hash_table_lookup (char_indexes, seg);
+  if (index == NULL)
+    {
+      n = seg->char_count / CHAR_INDEX_INTERVAL + 1;
+      index = g_new (int, n);
+
+      p = seg->body.chars;
+      index[0] = 0;
+      for (i = 1; i < n; i++)
+        {
+          p = g_utf8_offset_to_pointer (p, CHAR_INDEX_INTERVAL);
+          index[i] = p - seg->body.chars;
+        }
+
+      g_hash_table_insert (char_indexes, seg, index);
+    }
+
+  G_UNLOCK (char_indexes);
+
+  return index;
+}
+
+static void
+char_segment_drop_index (GtkTextLineSegment *seg)
+{
+  G_LOCK (char_indexes);
+  if (char_indexes != NULL)
+    g_hash_table_remove (char_indexes, seg);
+  G_UNLOCK (char_indexes);
+}
+
+/* Returns the byte offset of the character at @char_offset in @seg */
+int
+_gtk_char_segment_char_to_byte (GtkTextLineSegment *seg,
+                                int                 char_offset)
+{
+  const int *index;
+  const char *p;
+  int i;
+
+  g_assert (seg->type == &gtk_text_char_type);
+  g_assert (char_offset >= 0 && char_offset <= seg->char_count);
+
+  if (seg->byte_count == seg->char_count)
+    return char_offset;
+
+  if (char_segment_wants_index (seg))
+    {
+      index = char_segment_get_index (seg);
+      i = char_offset / CHAR_INDEX_INTERVAL;
+      p = g_utf8_offset_to_pointer (seg->body.chars + index[i],
+                                    char_offset - i * CHAR_INDEX_INTERVAL);
+    }
+  /* if in the last fourth of the segment walk backwards */
+  else if (seg->char_count - char_offset < seg->char_count / 4)
+    p = g_utf8_offset_to_pointer (seg->body.chars + seg->byte_count,
+                                  char_offset - seg->char_count);
+  else
+    p = g_utf8_offset_to_pointer (seg->body.chars, char_offset);
+
+  return p - seg->body.chars;
+}
+
+/* Returns the number of characters before @byte_offset in @seg */
+int
+_gtk_char_segment_byte_to_char (GtkTextLineSegment *seg,
+                                int                 byte_offset)
+{
+  const int *index;
+  int lo, hi;
+
+  g_assert (seg->type == &gtk_text_char_type);
+  g_assert (byte_offset >= 0 && byte_offset <= seg->byte_count);
+
+  if (seg->byte_count == seg->char_count)
+    return byte_offset;
+
+  if (!char_segment_wants_index (seg))
+    return g_utf8_strlen (seg->body.chars, byte_offset);
+
+  index = char_segment_get_index (seg);
+
+  /* Find the last checkpoint at or before byte_offset */
+  lo = 0;
+  hi = seg->char_count / CHAR_INDEX_INTERVAL;
+  while (lo < hi)
+    {
+      int mid = (lo + hi + 1) / 2;
+
+      if (index[mid] <= byte_offset)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+
+  return lo * CHAR_INDEX_INTERVAL +
+         g_utf8_strlen (seg->body.chars + index[lo], byte_offset - index[lo]);
+}
+
 /*
  * Type functions
  */
@@ -188,6 +324,17 @@ char_segment_self_check (GtkTextLineSegment *seg)
 
 GtkTextLineSegment*
 _gtk_char_segment_new (const char *text, guint len)
+{
+  return _gtk_char_segment_new_with_chars (text, len, g_utf8_strlen (text, len));
+}
+
+/* Like _gtk_char_segment_new(), for callers that already
+ * counted the characters in @text.
+ */
+GtkTextLineSegment*
+_gtk_char_segment_new_with_chars (const char *text,
+                                  guint       len,
+                                  guint       chars)
 {
   GtkTextLineSegment *seg;
 
@@ -200,7 +347,7 @@ _gtk_char_segment_new (const char *text, guint len)
   memcpy (seg->body.chars, text, len);
   seg->body.chars[len] = '\0';
 
-  seg->char_count = g_utf8_strlen (seg->body.chars, seg->byte_count);
+  seg->char_count = chars;
 
   if (GTK_DEBUG_CHECK (TEXT))
     char_segment_self_check (seg);
@@ -245,6 +392,9 @@ _gtk_char_segment_free (GtkTextLineSegment *seg)
 
   g_assert (seg->type == &gtk_text_char_type);
 
+  if (char_segment_wants_index (seg))
+    char_segment_drop_index (seg);
+
   g_slice_free1 (CSEG_SIZE (seg->byte_count), seg);
 }
 
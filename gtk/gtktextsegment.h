@@ -154,12 +154,19 @@ GtkTextLineSegment  *gtk_text_line_segment_split (const GtkTextIter *iter);
 
 GtkTextLineSegment *_gtk_char_segment_new                  (const char     *text,
                                                             guint           len);
+GtkTextLineSegment *_gtk_char_segment_new_with_chars       (const char     *text,
+                                                            guint           len,
+                                                            guint           chars);
 GtkTextLineSegment *_gtk_char_segment_new_from_two_strings (const char     *text1,
                                                             guint           len1,
 							    guint           chars1,
                                                             const char     *text2,
                                                             guint           len2,
 							    guint           chars2);
+int                 _gtk_char_segment_char_to_byte         (GtkTextLineSegment *seg,
+                                                            int                 char_offset);
+int                 _gtk_char_segment_byte_to_char         (GtkTextLineSegment *seg,
+                                                            int                 byte_offset);
 GtkTextLineSegment *_gtk_toggle_segment_new                (GtkTextTagInfo *info,
                                                             gboolean        on);
 
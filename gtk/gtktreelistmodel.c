@@ -439,6 +439,7 @@ gtk_tree_list_model_items_changed_cb (GListModel *model,
 }
 
 static void gtk_tree_list_row_destroy (GtkTreeListRow *row);
+static void gtk_tree_list_row_notify_expanded (GtkTreeListRow *row);
 
 static void
 gtk_tree_list_model_clear_node (gpointer data)
@@ -920,6 +921,76 @@ gtk_tree_list_model_get_child_row (GtkTreeListModel *self,
   return tree_node_get_row (child);
 }
 
+static void
+gtk_tree_list_model_expand_all_nodes (GtkTreeListModel  *self,
+                                      TreeNode          *node,
+                                      TreeNode         **first_expanded,
+                                      GPtrArray         *rows)
+{
+  TreeNode *child;
+
+  for (child = gtk_rb_tree_get_first (node->children);
+       child != NULL;
+       child = gtk_rb_tree_node_get_next (child))
+    {
+      if (child->children == NULL)
+        {
+          gtk_tree_list_model_expand_node (self, child);
+          if (child->children == NULL)
+            continue;
+
+          if (*first_expanded == NULL)
+            *first_expanded = child;
+          if (child->row)
+            g_ptr_array_add (rows, g_object_ref (child->row));
+        }
+
+      gtk_tree_list_model_expand_all_nodes (self, child, first_expanded, rows);
+    }
+}
+
+/**
+ * gtk_tree_list_model_expand_all:
+ * @self: a #GtkTreeListModel
+ *
+ * Recursively expands all rows in @self.
+ *
+ * This is the same as calling gtk_tree_list_row_set_expanded() on
+ * every row, but it emits a single #GListModel::items-changed signal
+ * for all the rows that get added instead of one for every row that
+ * gets expanded, which is a lot faster for big trees.
+ *
+ * Note that this does not terminate if the
+ * #GtkTreeListModelCreateModelFunc always creates new children.
+ **/
+void
+gtk_tree_list_model_expand_all (GtkTreeListModel *self)
+{
+  TreeNode *first_expanded = NULL;
+  GPtrArray *rows;
+  guint i, position, n_before, n_after;
+
+  g_return_if_fail (GTK_IS_TREE_LIST_MODEL (self));
+
+  n_before = g_list_model_get_n_items (G_LIST_MODEL (self));
+  rows = g_ptr_array_new_with_free_func (g_object_unref);
+
+  gtk_tree_list_model_expand_all_nodes (self, &self->root_node, &first_expanded, rows);
+
+  if (first_expanded)
+    {
+      position = tree_node_get_position (first_expanded) + 1;
+      n_after = g_list_model_get_n_items (G_LIST_MODEL (self));
+      if (n_after > n_before)
+        g_list_model_items_changed (G_LIST_MODEL (self), position, n_before - position, n_after - position);
+
+      for (i = 0; i < rows->len; i++)
+        gtk_tree_list_row_notify_expanded (g_ptr_array_index (rows, i));
+    }
+
+  g_ptr_array_unref (rows);
+}
+
 /**
  * SECTION:gtktreelistrow
  * @Short_description: A  row in a GtkTreeListModel
@@ -1165,6 +1236,13 @@ gtk_tree_list_row_get_depth (GtkTreeListRow *self)
   return depth;
 }
 
+static void
+gtk_tree_list_row_notify_expanded (GtkTreeListRow *self)
+{
+  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_EXPANDED]);
+  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_CHILDREN]);
+}
+
 /**
  * gtk_tree_list_row_set_expanded:
  * @self: a #GtkTreeListRow
@@ -1211,8 +1289,7 @@ gtk_tree_list_row_set_expanded (GtkTreeListRow *self,
         g_list_model_items_changed (G_LIST_MODEL (list), tree_node_get_position (self->node) + 1, n_items, 0);
     }
 
-  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_EXPANDED]);
-  g_object_notify_by_pspec (G_OBJECT (self), row_properties[ROW_PROP_CHILDREN]);
+  gtk_tree_list_row_notify_expanded (self);
 }
 
 /**
@@ -52,6 +52,11 @@ G_DECLARE_FINAL_TYPE (GtkTreeListRow, gtk_tree_list_row, GTK, TREE_LIST_ROW, GOb
  * If it does not have children but may get children later, it should return
  * an empty model that is filled once children arrive.
  *
+ * This is also the way to create children asynchronously: Return an empty
+ * model right away and fill it once loading the children is done. The
+ * children get added with a single #GListModel::items-changed signal if
+ * they are added to the model in one go, too.
+ *
  * Returns: (nullable) (transfer full): The model tracking the children of @item or %NULL if
  *     @item can never have children
  */
@@ -74,6 +79,8 @@ void                    gtk_tree_list_model_set_autoexpand      (GtkTreeListMode
                                                                  gboolean                autoexpand);
 GDK_AVAILABLE_IN_ALL
 gboolean                gtk_tree_list_model_get_autoexpand      (GtkTreeListModel       *self);
+GDK_AVAILABLE_IN_ALL
+void                    gtk_tree_list_model_expand_all          (GtkTreeListModel       *self);
 
 GDK_AVAILABLE_IN_ALL
 GtkTreeListRow *        gtk_tree_list_model_get_child_row       (GtkTreeListModel       *self,
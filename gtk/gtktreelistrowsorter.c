@@ -356,6 +356,8 @@ gtk_tree_list_row_sort_keys_new (GtkTreeListRowSorter *self)
   if (self->sorter)
     result->sort_keys = gtk_sorter_get_keys (self->sorter);
   result->cached_keys = g_hash_table_new (NULL, NULL);
+  /* init_key() walks the tree and updates cached_keys */
+  result->keys.thread_unsafe = TRUE;
 
   return (GtkSortKeys *) result;
 }
@@ -21,6 +21,7 @@
 #include "gtkintl.h"
 #include "gtktreednd.h"
 #include "gtkprivate.h"
+#include "gtkbitset.h"
 #include <string.h>
 
 
@@ -284,6 +285,7 @@ struct _GtkTreeModelFilterPrivate
 
   guint visible_method_set   : 1;
   guint modify_func_set      : 1;
+  guint thread_safe          : 1;
 
   guint in_row_deleted       : 1;
   guint virtual_root_deleted : 1;
@@ -304,6 +306,12 @@ enum
   PROP_VIRTUAL_ROOT
 };
 
+/* Refiltering lists with at least this many rows evaluates the
+ * visible function on multiple threads, if it is thread-safe.
+ */
+#define REFILTER_THREADED_MIN_ROWS 4096
+#define MAX_REFILTER_THREADS 8
+
 /* Set this to 0 to disable caching of child iterators.  This
  * allows for more stringent testing.  It is recommended to set this
  * to one when refactoring this code and running the unit tests to
@@ -3922,6 +3930,30 @@ gtk_tree_model_filter_set_visible_column (GtkTreeModelFilter *filter,
   filter->priv->visible_method_set = TRUE;
 }
 
+/**
+ * gtk_tree_model_filter_set_thread_safe:
+ * @filter: A #GtkTreeModelFilter
+ * @thread_safe: whether the visible function is thread-safe
+ *
+ * Declares whether the function set with
+ * gtk_tree_model_filter_set_visible_func() may be called from other
+ * threads, with several rows of the child model at the same time.
+ * When the visible column is used instead, this declares that reading
+ * values from the child model is thread-safe.
+ *
+ * This allows gtk_tree_model_filter_refilter() to check the rows of
+ * large lists in parallel. The child model is not modified while that
+ * happens.
+ */
+void
+gtk_tree_model_filter_set_thread_safe (GtkTreeModelFilter *filter,
+                                       gboolean            thread_safe)
+{
+  g_return_if_fail (GTK_IS_TREE_MODEL_FILTER (filter));
+
+  filter->priv->thread_safe = thread_safe;
+}
+
 /* conversion */
 
 /**
@@ -4230,18 +4262,245 @@ gtk_tree_model_filter_refilter_helper (GtkTreeModel *model,
   return FALSE;
 }
 
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint n_pending;
+} RefilterBatch;
+
+typedef struct
+{
+  GtkTreeModelFilter *filter;
+  GtkTreeIter *iters;
+  guint start;
+  guint n_rows;
+  GtkBitset *visible;
+  RefilterBatch *batch;
+} RefilterJob;
+
+static void
+refilter_job_run (RefilterJob *job)
+{
+  GtkTreeModelFilter *filter = job->filter;
+  guint i;
+
+  job->visible = gtk_bitset_new_empty ();
+
+  for (i = 0; i < job->n_rows; i++)
+    {
+      if (gtk_tree_model_filter_real_visible (filter,
+                                              filter->priv->child_model,
+                                              &job->iters[job->start + i]))
+        gtk_bitset_add (job->visible, job->start + i);
+    }
+}
+
+static void
+refilter_job_threaded (gpointer data,
+                       gpointer user_data)
+{
+  RefilterJob *job = data;
+  RefilterBatch *batch = job->batch;
+
+  refilter_job_run (job);
+
+  g_mutex_lock (&batch->lock);
+  batch->n_pending--;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+}
+
+static GThreadPool *
+get_refilter_pool (guint *n_threads)
+{
+  static GThreadPool *pool = NULL;
+  static guint max_threads = 0;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *result;
+
+      max_threads = CLAMP (g_get_num_processors () - 1, 1, MAX_REFILTER_THREADS);
+      result = g_thread_pool_new (refilter_job_threaded, NULL, max_threads, FALSE, NULL);
+
+      g_once_init_leave (&pool, result);
+    }
+
+  *n_threads = max_threads;
+
+  return pool;
+}
+
+/* Returns the child rows of a list that are visible */
+static GtkBitset *
+gtk_tree_model_filter_get_visible_rows (GtkTreeModelFilter *filter,
+                                        guint               n_rows)
+{
+  GtkTreeModelFilterPrivate *priv = filter->priv;
+  RefilterJob jobs[MAX_REFILTER_THREADS + 1];
+  RefilterBatch batch;
+  GtkTreeIter *iters;
+  GtkTreeIter iter;
+  GtkBitset *visible;
+  GThreadPool *pool;
+  guint n_threads, n_jobs, rows_per_job, i;
+
+  if (!priv->thread_safe ||
+      GTK_TREE_MODEL_FILTER_GET_CLASS (filter)->visible != gtk_tree_model_filter_real_visible ||
+      !GTK_TREE_MODEL_FILTER_CACHE_CHILD_ITERS (filter) ||
+      n_rows < REFILTER_THREADED_MIN_ROWS ||
+      g_get_num_processors () < 2)
+    {
+      visible = gtk_bitset_new_empty ();
+
+      if (gtk_tree_model_get_iter_first (priv->child_model, &iter))
+        {
+          i = 0;
+          do
+            {
+              if (gtk_tree_model_filter_visible (filter, &iter))
+                gtk_bitset_add (visible, i);
+              i++;
+            }
+          while (gtk_tree_model_iter_next (priv->child_model, &iter));
+        }
+
+      return visible;
+    }
+
+  /* The iters persist, so the workers only need to read the rows */
+  iters = g_new (GtkTreeIter, n_rows);
+  i = 0;
+  if (gtk_tree_model_get_iter_first (priv->child_model, &iter))
+    {
+      do
+        iters[i++] = iter;
+      while (i < n_rows && gtk_tree_model_iter_next (priv->child_model, &iter));
+    }
+  n_rows = i;
+
+  pool = get_refilter_pool (&n_threads);
+
+  /* The calling thread checks a range, too */
+  n_jobs = MIN (n_threads + 1, n_rows);
+  rows_per_job = (n_rows + n_jobs - 1) / n_jobs;
+
+  g_mutex_init (&batch.lock);
+  g_cond_init (&batch.cond);
+
+  for (i = 0; i * rows_per_job < n_rows; i++)
+    {
+      jobs[i].filter = filter;
+      jobs[i].iters = iters;
+      jobs[i].start = i * rows_per_job;
+      jobs[i].n_rows = MIN (rows_per_job, n_rows - jobs[i].start);
+      jobs[i].visible = NULL;
+      jobs[i].batch = &batch;
+    }
+  n_jobs = i;
+
+  g_mutex_lock (&batch.lock);
+  batch.n_pending = n_jobs - 1;
+  g_mutex_unlock (&batch.lock);
+
+  for (i = 1; i < n_jobs; i++)
+    g_thread_pool_push (pool, &jobs[i], NULL);
+
+  refilter_job_run (&jobs[0]);
+
+  g_mutex_lock (&batch.lock);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.lock);
+  g_mutex_unlock (&batch.lock);
+
+  g_mutex_clear (&batch.lock);
+  g_cond_clear (&batch.cond);
+
+  visible = jobs[0].visible;
+  for (i = 1; i < n_jobs; i++)
+    {
+      gtk_bitset_union (visible, jobs[i].visible);
+      gtk_bitset_unref (jobs[i].visible);
+    }
+
+  g_free (iters);
+
+  return visible;
+}
+
+/* Refilters a flat child model by comparing the visible rows with
+ * the ones we have, so only rows that changed need to be looked at.
+ */
+static gboolean
+gtk_tree_model_filter_refilter_list (GtkTreeModelFilter *filter)
+{
+  GtkTreeModelFilterPrivate *priv = filter->priv;
+  FilterLevel *level = priv->root;
+  GSequenceIter *siter, *end_siter;
+  GtkBitset *visible, *changed;
+  GtkBitsetIter bitset_iter;
+  guint offset;
+  gboolean more;
+
+  if (level == NULL ||
+      priv->virtual_root != NULL ||
+      !(gtk_tree_model_get_flags (priv->child_model) & GTK_TREE_MODEL_LIST_ONLY))
+    return FALSE;
+
+  visible = gtk_tree_model_filter_get_visible_rows (filter,
+                                                    gtk_tree_model_iter_n_children (priv->child_model, NULL));
+
+  changed = gtk_bitset_new_empty ();
+  end_siter = g_sequence_get_end_iter (level->visible_seq);
+  for (siter = g_sequence_get_begin_iter (level->visible_seq);
+       siter != end_siter;
+       siter = g_sequence_iter_next (siter))
+    gtk_bitset_add (changed, GET_ELT (siter)->offset);
+
+  gtk_bitset_difference (changed, visible);
+  gtk_bitset_unref (visible);
+
+  /* The row-changed handler inserts or removes the rows */
+  for (more = gtk_bitset_iter_init_first (&bitset_iter, changed, &offset);
+       more;
+       more = gtk_bitset_iter_next (&bitset_iter, &offset))
+    {
+      GtkTreePath *c_path;
+      GtkTreeIter c_iter;
+
+      c_path = gtk_tree_path_new_from_indices (offset, -1);
+      if (gtk_tree_model_get_iter (priv->child_model, &c_iter, c_path))
+        gtk_tree_model_filter_row_changed (priv->child_model, c_path, &c_iter, filter);
+      gtk_tree_path_free (c_path);
+    }
+
+  gtk_bitset_unref (changed);
+
+  return TRUE;
+}
+
 /**
  * gtk_tree_model_filter_refilter:
  * @filter: A #GtkTreeModelFilter.
  *
- * Emits ::row_changed for each row in the child model, which causes
- * the filter to re-evaluate whether a row is visible or not.
+ * Re-evaluates whether the rows of the child model are visible or not.
+ *
+ * For a tree, this emits ::row_changed for each row in the child
+ * model. When the child model is a list, only rows whose visibility
+ * changed are inserted or removed, and no ::row_changed signals are
+ * emitted. Lists can be checked on multiple threads, see
+ * gtk_tree_model_filter_set_thread_safe().
  */
 void
 gtk_tree_model_filter_refilter (GtkTreeModelFilter *filter)
 {
   g_return_if_fail (GTK_IS_TREE_MODEL_FILTER (filter));
 
+  if (gtk_tree_model_filter_refilter_list (filter))
+    return;
+
   /* S L O W */
   gtk_tree_model_foreach (filter->priv->child_model,
                           gtk_tree_model_filter_refilter_helper,
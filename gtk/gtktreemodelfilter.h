@@ -123,6 +123,9 @@ void          gtk_tree_model_filter_set_modify_func            (GtkTreeModelFilt
 GDK_AVAILABLE_IN_ALL
 void          gtk_tree_model_filter_set_visible_column         (GtkTreeModelFilter           *filter,
                                                                 int                           column);
+GDK_AVAILABLE_IN_ALL
+void          gtk_tree_model_filter_set_thread_safe            (GtkTreeModelFilter           *filter,
+                                                                gboolean                      thread_safe);
 
 GDK_AVAILABLE_IN_ALL
 GtkTreeModel *gtk_tree_model_filter_get_model                  (GtkTreeModelFilter           *filter);
@@ -26,6 +26,7 @@
 #include "gtkintl.h"
 #include "gtkprivate.h"
 #include "gtktreednd.h"
+#include "timsort/gtktimsortprivate.h"
 
 
 /**
@@ -216,6 +217,7 @@
 typedef struct _SortElt SortElt;
 typedef struct _SortLevel SortLevel;
 typedef struct _SortData SortData;
+typedef struct _SortKey SortKey;
 
 struct _SortElt
 {
@@ -247,6 +249,15 @@ struct _SortData
   int parent_path_depth;
 };
 
+/* Used when sorting a whole level, so the child iter of each
+ * element only needs to be looked up once.
+ */
+struct _SortKey
+{
+  SortElt     *elt;
+  GtkTreeIter  iter;
+};
+
 /* Properties */
 enum {
   PROP_0,
@@ -435,6 +446,9 @@ static GtkTreePath *gtk_real_tree_model_sort_convert_child_path_to_path (GtkTree
 static int          gtk_tree_model_sort_compare_func        (gconstpointer     a,
                                                              gconstpointer     b,
                                                              gpointer          user_data);
+static int          gtk_tree_model_sort_key_compare_func    (gconstpointer     a,
+                                                             gconstpointer     b,
+                                                             gpointer          user_data);
 static int          gtk_tree_model_sort_offset_compare_func (gconstpointer     a,
                                                              gconstpointer     b,
                                                              gpointer          user_data);
@@ -731,6 +745,29 @@ lookup_elt_with_offset (GtkTreeModelSort *tree_model_sort,
 }
 
 
+static gboolean
+gtk_tree_model_sort_elt_is_sorted (SortElt  *elt,
+                                   SortData *data)
+{
+  GSequenceIter *siter;
+
+  if (!g_sequence_iter_is_begin (elt->siter))
+    {
+      siter = g_sequence_iter_prev (elt->siter);
+      if (gtk_tree_model_sort_compare_func (g_sequence_get (siter), elt, data) > 0)
+        return FALSE;
+    }
+
+  siter = g_sequence_iter_next (elt->siter);
+  if (!g_sequence_iter_is_end (siter))
+    {
+      if (gtk_tree_model_sort_compare_func (elt, g_sequence_get (siter), data) > 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static void
 gtk_tree_model_sort_row_changed (GtkTreeModel *s_model,
 				 GtkTreePath  *start_s_path,
@@ -799,9 +836,13 @@ gtk_tree_model_sort_row_changed (GtkTreeModel *s_model,
   old_index = g_sequence_iter_get_position (elt->siter);
 
   fill_sort_data (&sort_data, tree_model_sort, level);
-  g_sequence_sort_changed (elt->siter,
-                           gtk_tree_model_sort_compare_func,
-                           &sort_data);
+  /* Most changes don't affect the order, so only search for a new
+   * position if the row isn't sorted relative to its neighbors anymore
+   */
+  if (!gtk_tree_model_sort_elt_is_sorted (elt, &sort_data))
+    g_sequence_sort_changed (elt->siter,
+                             gtk_tree_model_sort_compare_func,
+                             &sort_data);
   free_sort_data (&sort_data);
 
   index = g_sequence_iter_get_position (elt->siter);
@@ -1854,6 +1895,36 @@ gtk_tree_model_sort_compare_func (gconstpointer a,
   return retval;
 }
 
+static int
+gtk_tree_model_sort_key_compare_func (gconstpointer a,
+                                      gconstpointer b,
+                                      gpointer      user_data)
+{
+  SortData *data = (SortData *)user_data;
+  GtkTreeModelSortPrivate *priv = data->tree_model_sort->priv;
+  const SortKey *ka = a;
+  const SortKey *kb = b;
+  int retval;
+
+  if (data->sort_func == NO_SORT_FUNC)
+    return gtk_tree_model_sort_offset_compare_func (ka->elt, kb->elt, data);
+
+  retval = (* data->sort_func) (GTK_TREE_MODEL (priv->child_model),
+				(GtkTreeIter *) &ka->iter,
+				(GtkTreeIter *) &kb->iter,
+				data->sort_data);
+
+  if (priv->order == GTK_SORT_DESCENDING)
+    {
+      if (retval > 0)
+	retval = -1;
+      else if (retval < 0)
+	retval = 1;
+    }
+
+  return retval;
+}
+
 static int
 gtk_tree_model_sort_offset_compare_func (gconstpointer a,
 					 gconstpointer b,
@@ -1891,9 +1962,11 @@ gtk_tree_model_sort_sort_level (GtkTreeModelSort *tree_model_sort,
 				gboolean          emit_reordered)
 {
   GtkTreeModelSortPrivate *priv = tree_model_sort->priv;
-  int i;
+  int i, length;
   GSequenceIter *begin_siter, *end_siter, *siter;
   SortElt *begin_elt;
+  SortKey *keys;
+  gboolean changed;
   int *new_order;
 
   GtkTreeIter iter;
@@ -1915,6 +1988,15 @@ gtk_tree_model_sort_sort_level (GtkTreeModelSort *tree_model_sort,
 
   gtk_tree_model_sort_ref_node (GTK_TREE_MODEL (tree_model_sort), &iter);
 
+  fill_sort_data (&data, tree_model_sort, level);
+
+  /* Sort an array instead of the sequence: timsort makes use of the
+   * existing order, which usually is mostly intact, and the child iters
+   * only need to be looked up once instead of for every comparison.
+   */
+  length = g_sequence_get_length (level->seq);
+  keys = g_new (SortKey, length);
+
   i = 0;
   end_siter = g_sequence_get_end_iter (level->seq);
   for (siter = g_sequence_get_begin_iter (level->seq);
@@ -1924,32 +2006,47 @@ gtk_tree_model_sort_sort_level (GtkTreeModelSort *tree_model_sort,
       SortElt *elt = g_sequence_get (siter);
 
       elt->old_index = i;
+      keys[i].elt = elt;
+
+      if (data.sort_func == NO_SORT_FUNC)
+        ;
+      else if (GTK_TREE_MODEL_SORT_CACHE_CHILD_ITERS (tree_model_sort))
+        keys[i].iter = elt->iter;
+      else
+        {
+          data.parent_path_indices[data.parent_path_depth - 1] = elt->offset;
+          gtk_tree_model_get_iter (priv->child_model, &keys[i].iter, data.parent_path);
+        }
+
       i++;
     }
 
-  fill_sort_data (&data, tree_model_sort, level);
-
-  if (data.sort_func == NO_SORT_FUNC)
-    g_sequence_sort (level->seq, gtk_tree_model_sort_offset_compare_func,
-                     &data);
-  else
-    g_sequence_sort (level->seq, gtk_tree_model_sort_compare_func, &data);
+  gtk_tim_sort (keys, length, sizeof (SortKey),
+                gtk_tree_model_sort_key_compare_func, &data);
 
   free_sort_data (&data);
 
-  new_order = g_new (int, g_sequence_get_length (level->seq));
+  new_order = g_new (int, length);
+  changed = FALSE;
 
-  i = 0;
-  end_siter = g_sequence_get_end_iter (level->seq);
-  for (siter = g_sequence_get_begin_iter (level->seq);
-       siter != end_siter;
-       siter = g_sequence_iter_next (siter))
+  for (i = 0; i < length; i++)
     {
-      SortElt *elt = g_sequence_get (siter);
+      new_order[i] = keys[i].elt->old_index;
+      if (new_order[i] != i)
+        changed = TRUE;
+    }
 
-      new_order[i++] = elt->old_index;
+  /* Moving every row to the end in the new order sorts the sequence
+   * while keeping the elements' sequence iters valid
+   */
+  if (changed)
+    {
+      for (i = 0; i < length; i++)
+        g_sequence_move (keys[i].elt->siter, end_siter);
     }
 
+  g_free (keys);
+
   if (emit_reordered)
     {
       gtk_tree_model_sort_increment_stamp (tree_model_sort);
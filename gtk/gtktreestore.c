@@ -1648,6 +1648,132 @@ gtk_tree_store_insert_with_valuesv (GtkTreeStore *tree_store,
   validate_tree ((GtkTreeStore *)tree_store);
 }
 
+/**
+ * gtk_tree_store_insert_rows_with_valuesv:
+ * @tree_store: A #GtkTreeStore
+ * @parent: (allow-none): A valid #GtkTreeIter, or %NULL
+ * @position: position to insert the new rows, or -1 for last
+ * @n_rows: the number of rows to insert
+ * @columns: (array length=n_values): an array of column numbers
+ * @values: (array): an array of @n_rows times @n_values GValues,
+ *     holding the values of the first row, followed by those of
+ *     the second row and so on
+ * @n_values: the length of the @columns array
+ *
+ * Inserts @n_rows new rows at @position as children of @parent,
+ * filled with the given values.
+ *
+ * This has the same effect as calling
+ * gtk_tree_store_insert_with_valuesv() for every row, but is much
+ * faster when adding many children to the same parent, since the
+ * insertion position and the path of the rows only need to be looked
+ * up once. A #GtkTreeModel::row-inserted signal is still emitted for
+ * every row, and handlers of it must not modify @tree_store.
+ */
+void
+gtk_tree_store_insert_rows_with_valuesv (GtkTreeStore *tree_store,
+                                         GtkTreeIter  *parent,
+                                         int           position,
+                                         int           n_rows,
+                                         int          *columns,
+                                         GValue       *values,
+                                         int           n_values)
+{
+  GtkTreeStorePrivate *priv = tree_store->priv;
+  GtkTreePath *path;
+  GNode *parent_node;
+  GNode *sibling;
+  GNode *prev;
+  GtkTreeIter iter;
+  gboolean had_children;
+  int i;
+
+  g_return_if_fail (GTK_IS_TREE_STORE (tree_store));
+  g_return_if_fail (n_rows >= 0);
+  g_return_if_fail (n_values == 0 || (columns != NULL && values != NULL));
+
+  if (parent)
+    g_return_if_fail (VALID_ITER (parent, tree_store));
+
+  if (n_rows == 0)
+    return;
+
+  if (parent)
+    parent_node = parent->user_data;
+  else
+    parent_node = priv->root;
+
+  priv->columns_dirty = TRUE;
+
+  had_children = parent_node->children != NULL;
+
+  /* Find the position once, then link the new rows one after the other */
+  sibling = position < 0 ? NULL : g_node_nth_child (parent_node, position);
+  if (sibling)
+    prev = sibling->prev;
+  else
+    prev = g_node_last_child (parent_node);
+
+  if (parent)
+    path = gtk_tree_store_get_path (GTK_TREE_MODEL (tree_store), parent);
+  else
+    path = gtk_tree_path_new ();
+  gtk_tree_path_append_index (path, prev ? g_node_child_position (parent_node, prev) + 1 : 0);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      gboolean changed = FALSE;
+      gboolean maybe_need_sort = FALSE;
+      GNode *new_node;
+
+      new_node = g_node_new (NULL);
+      g_node_insert_after (parent_node, prev, new_node);
+      prev = new_node;
+
+      iter.stamp = priv->stamp;
+      iter.user_data = new_node;
+
+      gtk_tree_store_set_vector_internal (tree_store, &iter,
+                                          &changed, &maybe_need_sort,
+                                          columns, values + i * n_values, n_values);
+
+      if (GTK_TREE_STORE_IS_SORTED (tree_store))
+        {
+          GtkTreePath *sorted_path;
+
+          if (maybe_need_sort)
+            gtk_tree_store_sort_iter_changed (tree_store, &iter, priv->sort_column_id, FALSE);
+
+          /* Sorting may have moved the row, keep appending after
+           * the unsorted ones
+           */
+          prev = sibling ? sibling->prev : g_node_last_child (parent_node);
+
+          sorted_path = gtk_tree_store_get_path (GTK_TREE_MODEL (tree_store), &iter);
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (tree_store), sorted_path, &iter);
+          gtk_tree_path_free (sorted_path);
+        }
+      else
+        {
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (tree_store), path, &iter);
+          gtk_tree_path_next (path);
+        }
+
+      if (i == 0 && !had_children && parent_node != priv->root)
+        {
+          GtkTreePath *parent_path;
+
+          parent_path = gtk_tree_store_get_path (GTK_TREE_MODEL (tree_store), parent);
+          gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (tree_store), parent_path, parent);
+          gtk_tree_path_free (parent_path);
+        }
+    }
+
+  gtk_tree_path_free (path);
+
+  validate_tree ((GtkTreeStore *)tree_store);
+}
+
 /**
  * gtk_tree_store_prepend:
  * @tree_store: A #GtkTreeStore
@@ -125,6 +125,14 @@ void          gtk_tree_store_insert_with_valuesv (GtkTreeStore *tree_store,
 						  GValue       *values,
 						  int           n_values);
 GDK_AVAILABLE_IN_ALL
+void          gtk_tree_store_insert_rows_with_valuesv (GtkTreeStore *tree_store,
+                                                       GtkTreeIter  *parent,
+                                                       int           position,
+                                                       int           n_rows,
+                                                       int          *columns,
+                                                       GValue       *values,
+                                                       int           n_values);
+GDK_AVAILABLE_IN_ALL
 void          gtk_tree_store_prepend          (GtkTreeStore *tree_store,
 					       GtkTreeIter  *iter,
 					       GtkTreeIter  *parent);
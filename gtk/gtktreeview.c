@@ -260,6 +260,11 @@ typedef enum {
 #define GTK_TREE_VIEW_PRIORITY_SCROLL_SYNC (GTK_TREE_VIEW_PRIORITY_VALIDATE + 2)
 /* 3/5 of gdkframeclockidle.c's FRAME_INTERVAL (16667 microsecs) */
 #define GTK_TREE_VIEW_TIME_MS_PER_IDLE 10
+/* Trees with more rows than this only get their visible rows validated,
+ * the height of all other rows is estimated from a few samples.
+ */
+#define GTK_TREE_VIEW_LAZY_VALIDATE_ROWS 10000
+#define GTK_TREE_VIEW_HEIGHT_SAMPLES 32
 #define SCROLL_EDGE_SIZE 15
 #define GTK_TREE_VIEW_SEARCH_DIALOG_TIMEOUT 5000
 #define AUTO_EXPAND_TIMEOUT 500
@@ -423,6 +428,7 @@ typedef struct
 
   /* fixed height */
   int fixed_height;
+  int estimated_height;
 
   GtkTreeRBNode *rubber_band_start_node;
   GtkTreeRBTree *rubber_band_start_tree;
@@ -1646,6 +1652,7 @@ gtk_tree_view_init (GtkTreeView *tree_view)
   priv->presize_handler_tick_cb = 0;
   priv->scroll_sync_timer = 0;
   priv->fixed_height = -1;
+  priv->estimated_height = -1;
   priv->fixed_height_mode = FALSE;
   priv->fixed_height_check = 0;
   priv->selection = _gtk_tree_selection_new_with_tree_view (tree_view);
@@ -6095,6 +6102,59 @@ initialize_fixed_height_mode (GtkTreeView *tree_view)
                                  priv->fixed_height, TRUE);
 }
 
+static gboolean
+gtk_tree_view_validates_lazily (GtkTreeView *tree_view)
+{
+  GtkTreeViewPrivate *priv = gtk_tree_view_get_instance_private (tree_view);
+
+  return !priv->fixed_height_mode &&
+         priv->tree != NULL &&
+         priv->tree->root->total_count > GTK_TREE_VIEW_LAZY_VALIDATE_ROWS;
+}
+
+/* Validates rows spread evenly over the whole tree and gives all
+ * other rows their average height, so the scrollable height is
+ * about right without measuring every row. The estimates get
+ * replaced by the real heights when the rows become visible.
+ */
+static void
+estimate_row_height (GtkTreeView *tree_view)
+{
+  GtkTreeViewPrivate *priv = gtk_tree_view_get_instance_private (tree_view);
+  guint n_rows = priv->tree->root->total_count;
+  int total_height = 0;
+  int n_samples = 0;
+  guint i;
+
+  for (i = 0; i < GTK_TREE_VIEW_HEIGHT_SAMPLES; i++)
+    {
+      GtkTreeRBTree *tree;
+      GtkTreeRBNode *node;
+      GtkTreePath *path;
+      GtkTreeIter iter;
+
+      if (!gtk_tree_rbtree_find_index (priv->tree,
+                                       (guint64) n_rows * i / GTK_TREE_VIEW_HEIGHT_SAMPLES,
+                                       &tree, &node))
+        continue;
+
+      path = _gtk_tree_path_new_from_rbtree (tree, node);
+      if (gtk_tree_model_get_iter (priv->model, &iter, path))
+        {
+          validate_row (tree_view, tree, node, &iter, path);
+          total_height += gtk_tree_view_get_row_height (tree_view, node);
+          n_samples++;
+        }
+      gtk_tree_path_free (path);
+    }
+
+  if (n_samples == 0)
+    return;
+
+  priv->estimated_height = (total_height + n_samples / 2) / n_samples;
+  gtk_tree_rbtree_set_fixed_height (priv->tree, priv->estimated_height, FALSE);
+}
+
 /* Our strategy for finding nodes to validate is a little convoluted.  We find
  * the left-most uninvalidated node.  We then try walking right, validating
  * nodes.  Once we find a valid node, we repeat the previous process of finding
@@ -6118,6 +6178,7 @@ do_validate_rows (GtkTreeView *tree_view, gboolean queue_resize)
 
   int y = -1;
   int prev_height = -1;
+  int total_height = 0;
   gboolean fixed_height = TRUE;
 
   g_assert (tree_view);
@@ -6137,6 +6198,21 @@ do_validate_rows (GtkTreeView *tree_view, gboolean queue_resize)
       return FALSE;
     }
 
+  /* Large trees only validate rows in validate_visible_area() */
+  if (gtk_tree_view_validates_lazily (tree_view))
+    {
+      if (!priv->fixed_height_check)
+        {
+          estimate_row_height (tree_view);
+          priv->fixed_height_check = 1;
+
+          if (queue_resize)
+            gtk_widget_queue_resize (GTK_WIDGET (tree_view));
+        }
+
+      return FALSE;
+    }
+
   timer = g_timer_new ();
   g_timer_start (timer);
 
@@ -6219,6 +6295,7 @@ do_validate_rows (GtkTreeView *tree_view, gboolean queue_resize)
 	  int height;
 
 	  height = gtk_tree_view_get_row_height (tree_view, node);
+	  total_height += height;
 	  if (prev_height < 0)
 	    prev_height = height;
 	  else if (prev_height != height)
@@ -6231,8 +6308,15 @@ do_validate_rows (GtkTreeView *tree_view, gboolean queue_resize)
 
   if (!priv->fixed_height_check)
    {
+     /* Guess the height of the remaining rows from the ones we just
+      * validated, so the scrollbar doesn't keep growing while we go
+      */
      if (fixed_height)
-       gtk_tree_rbtree_set_fixed_height (priv->tree, prev_height, FALSE);
+       priv->estimated_height = prev_height;
+     else
+       priv->estimated_height = (total_height + i / 2) / i;
+
+     gtk_tree_rbtree_set_fixed_height (priv->tree, priv->estimated_height, FALSE);
 
      priv->fixed_height_check = 1;
    }
@@ -8115,6 +8199,8 @@ gtk_tree_view_row_inserted (GtkTreeModel *model,
   if (priv->fixed_height_mode
       && priv->fixed_height >= 0)
     height = priv->fixed_height;
+  else if (priv->estimated_height > 0)
+    height = priv->estimated_height;
   else
     height = 0;
 
@@ -8603,6 +8689,8 @@ gtk_tree_view_build_tree (GtkTreeView   *tree_view,
 	      gtk_tree_rbtree_node_mark_valid (tree, temp);
 	    }
         }
+      else if (priv->estimated_height > 0)
+        gtk_tree_rbtree_node_set_height (tree, temp, priv->estimated_height);
 
       if (priv->is_list)
         continue;
@@ -10168,6 +10256,12 @@ gtk_tree_view_adjustment_changed (GtkAdjustment *adjustment,
           if (!priv->in_top_row_to_dy)
             gtk_tree_view_dy_to_top_row (tree_view);
 
+          /* Rows that scrolled into view may only have an estimated height */
+          if (gtk_tree_view_validates_lazily (tree_view) &&
+              GTK_TREE_RBNODE_FLAG_SET (priv->tree->root, GTK_TREE_RBNODE_DESCENDANTS_INVALID) &&
+              priv->presize_handler_tick_cb == 0)
+            priv->presize_handler_tick_cb =
+              gtk_widget_add_tick_callback (GTK_WIDGET (tree_view), presize_handler_callback, NULL, NULL);
         }
     }
 
@@ -10305,6 +10399,7 @@ gtk_tree_view_set_model (GtkTreeView  *tree_view,
       priv->search_column = -1;
       priv->fixed_height_check = 0;
       priv->fixed_height = -1;
+      priv->estimated_height = -1;
       priv->dy = priv->top_row_dy = 0;
     }
 
@@ -38,9 +38,13 @@
 #include "gtkcsstransformvalueprivate.h"
 #include "gtkcssfontvariationsvalueprivate.h"
 #include "gtkcssnumbervalueprivate.h"
+#include "gtkcssshadowvalueprivate.h"
 #include "gtkcssstylepropertyprivate.h"
 #include "gtkcsswidgetnodeprivate.h"
 #include "gtkdebug.h"
+#include "gtkeventcontrollerfocus.h"
+#include "gtkeventcontrollerkey.h"
+#include "gtkeventcontrollerscroll.h"
 #include "gtkgesturedrag.h"
 #include "gtkgestureprivate.h"
 #include "gtkgesturesingle.h"
@@ -569,6 +573,7 @@ static void     gtk_widget_real_css_changed      (GtkWidget         *widget,
                                                   GtkCssStyleChange *change);
 static void     gtk_widget_real_system_setting_changed (GtkWidget         *widget,
                                                         GtkSystemSetting   setting);
+static void     gtk_widget_clear_decoration_nodes (GtkWidget        *widget);
 
 static void             gtk_widget_real_set_focus_child         (GtkWidget        *widget,
                                                                  GtkWidget        *child);
@@ -661,6 +666,16 @@ static GQuark           quark_auto_children = 0;
 static GQuark           quark_action_muxer = 0;
 static GQuark           quark_font_options = 0;
 static GQuark           quark_font_map = 0;
+static GQuark           quark_tick_scheduler = 0;
+
+static int              snapshotted_widgets;
+static int              reused_widgets;
+static int              culled_widgets;
+static guint            snapshotted_widgets_counter;
+static guint            reused_widgets_counter;
+static guint            culled_widgets_counter;
+static guint            tick_callbacks_counter;
+static guint            ticking_widgets_counter;
 
 /* --- functions --- */
 GType
@@ -870,6 +885,13 @@ gtk_widget_class_init (GtkWidgetClass *klass)
   quark_action_muxer = g_quark_from_static_string ("gtk-widget-action-muxer");
   quark_font_options = g_quark_from_static_string ("gtk-widget-font-options");
   quark_font_map = g_quark_from_static_string ("gtk-widget-font-map");
+  quark_tick_scheduler = g_quark_from_static_string ("gtk-widget-tick-scheduler");
+
+  snapshotted_widgets_counter = gdk_profiler_define_int_counter ("snapshotted-widgets", "Widgets Snapshotted Per Frame");
+  reused_widgets_counter = gdk_profiler_define_int_counter ("reused-widgets", "Widget Render Nodes Reused Per Frame");
+  culled_widgets_counter = gdk_profiler_define_int_counter ("culled-widgets", "Widgets Culled Per Frame");
+  tick_callbacks_counter = gdk_profiler_define_int_counter ("tick-callbacks", "Tick Callbacks Per Frame");
+  ticking_widgets_counter = gdk_profiler_define_int_counter ("ticking-widgets", "Widgets With Tick Callbacks Per Frame");
 
   gobject_class->constructed = gtk_widget_constructed;
   gobject_class->dispose = gtk_widget_dispose;
@@ -1739,8 +1761,8 @@ gtk_widget_get_property (GObject         *object,
   switch (prop_id)
     {
     case PROP_NAME:
-      if (priv->name)
-	g_value_set_string (value, priv->name);
+      if (priv->extra && priv->extra->name)
+	g_value_set_string (value, priv->extra->name);
       else
 	g_value_set_static_string (value, "");
       break;
@@ -2216,7 +2238,6 @@ gtk_widget_init (GTypeInstance *instance, gpointer g_class)
 
   priv->visible = gtk_widget_class_get_visible_by_default (g_class);
   priv->child_visible = TRUE;
-  priv->name = NULL;
   priv->user_alpha = 255;
   priv->parent = NULL;
   priv->first_child = NULL;
@@ -2294,6 +2315,20 @@ gtk_widget_init (GTypeInstance *instance, gpointer g_class)
     }
 }
 
+/* Most widgets never get a name, cursor, tooltip or observer, so
+ * these live in a separate block that is allocated on first use.
+ */
+GtkWidgetExtra *
+gtk_widget_ensure_extra (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  if (priv->extra == NULL)
+    priv->extra = g_new0 (GtkWidgetExtra, 1);
+
+  return priv->extra;
+}
+
 void
 gtk_widget_root (GtkWidget *widget)
 {
@@ -2427,6 +2462,9 @@ gtk_widget_unparent (GtkWidget *widget)
   old_parent = priv->parent;
   if (old_parent)
     {
+      if (old_parent->priv->pick_index)
+        gtk_pick_index_remove (old_parent->priv->pick_index, widget);
+
       if (old_parent->priv->first_child == widget)
         old_parent->priv->first_child = priv->next_sibling;
 
@@ -2461,8 +2499,8 @@ gtk_widget_unparent (GtkWidget *widget)
 
   _gtk_widget_update_parent_muxer (widget);
 
-  if (old_parent->priv->children_observer)
-    gtk_list_list_model_item_removed (old_parent->priv->children_observer, old_prev_sibling);
+  if (old_parent->priv->extra && old_parent->priv->extra->children_observer)
+    gtk_list_list_model_item_removed (old_parent->priv->extra->children_observer, old_prev_sibling);
 
   if (old_parent->priv->layout_manager)
     gtk_layout_manager_remove_layout_child (old_parent->priv->layout_manager, widget);
@@ -2480,7 +2518,7 @@ gtk_widget_update_paintables (GtkWidget *widget)
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GSList *l;
 
-  for (l = priv->paintables; l; l = l->next)
+  for (l = priv->extra ? priv->extra->paintables : NULL; l; l = l->next)
     gtk_widget_paintable_update_image (l->data);
 }
 
@@ -2490,7 +2528,7 @@ gtk_widget_push_paintables (GtkWidget *widget)
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GSList *l;
 
-  for (l = priv->paintables; l; l = l->next)
+  for (l = priv->extra ? priv->extra->paintables : NULL; l; l = l->next)
     gtk_widget_paintable_push_snapshot_count (l->data);
 }
 
@@ -2500,7 +2538,7 @@ gtk_widget_pop_paintables (GtkWidget *widget)
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GSList *l;
 
-  for (l = priv->paintables; l; l = l->next)
+  for (l = priv->extra ? priv->extra->paintables : NULL; l; l = l->next)
     gtk_widget_paintable_pop_snapshot_count (l->data);
 }
 
@@ -2711,6 +2749,7 @@ gtk_widget_unmap (GtkWidget *widget)
       gtk_widget_push_verify_invariants (widget);
 
       gtk_widget_queue_draw (widget);
+      gtk_widget_clear_decoration_nodes (widget);
       _gtk_tooltip_hide (widget);
 
       g_signal_emit (widget, widget_signals[UNMAP], 0);
@@ -2722,6 +2761,8 @@ gtk_widget_unmap (GtkWidget *widget)
     }
 }
 
+static void gtk_widget_disconnect_tick_scheduler (GtkWidget *widget);
+
 typedef struct _GtkTickCallbackInfo GtkTickCallbackInfo;
 
 struct _GtkTickCallbackInfo
@@ -2758,13 +2799,8 @@ unref_tick_callback_info (GtkWidget           *widget,
       g_slice_free (GtkTickCallbackInfo, info);
     }
 
-  if (priv->tick_callbacks == NULL && priv->clock_tick_id)
-    {
-      GdkFrameClock *frame_clock = gtk_widget_get_frame_clock (widget);
-      g_signal_handler_disconnect (frame_clock, priv->clock_tick_id);
-      priv->clock_tick_id = 0;
-      gdk_frame_clock_end_updating (frame_clock);
-    }
+  if (priv->tick_callbacks == NULL)
+    gtk_widget_disconnect_tick_scheduler (widget);
 }
 
 static void
@@ -2793,12 +2829,13 @@ destroy_tick_callbacks (GtkWidget *widget)
     }
 }
 
-static void
-gtk_widget_on_frame_clock_update (GdkFrameClock *frame_clock,
-                                  GtkWidget     *widget)
+static int
+gtk_widget_run_tick_callbacks (GtkWidget     *widget,
+                               GdkFrameClock *frame_clock)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GList *l;
+  int n_callbacks = 0;
 
   g_object_ref (widget);
 
@@ -2810,6 +2847,7 @@ gtk_widget_on_frame_clock_update (GdkFrameClock *frame_clock,
       ref_tick_callback_info (info);
       if (!info->destroyed)
         {
+          n_callbacks++;
           if (info->callback (widget,
                               frame_clock,
                               info->user_data) == G_SOURCE_REMOVE)
@@ -2824,6 +2862,120 @@ gtk_widget_on_frame_clock_update (GdkFrameClock *frame_clock,
     }
 
   g_object_unref (widget);
+
+  return n_callbacks;
+}
+
+/* All mapped widgets with tick callbacks are run from a single
+ * handler of the ::update signal of their frame clock, instead of
+ * one handler per widget. Widgets that are not mapped are not on
+ * the list, so their animations pause until they are shown again.
+ */
+typedef struct _GtkTickScheduler GtkTickScheduler;
+
+struct _GtkTickScheduler
+{
+  GQueue widgets;
+  GList *dispatch_next; /* the next widget to tick, while dispatching */
+  gulong update_id;
+};
+
+static void
+gtk_tick_scheduler_free (gpointer data)
+{
+  GtkTickScheduler *scheduler = data;
+
+  g_queue_clear (&scheduler->widgets);
+  g_slice_free (GtkTickScheduler, scheduler);
+}
+
+static void
+gtk_tick_scheduler_update (GdkFrameClock    *frame_clock,
+                           GtkTickScheduler *scheduler)
+{
+  int n_widgets = 0;
+  int n_callbacks = 0;
+  GList *l;
+
+  /* Widgets that get added while we dispatch go to the head of the
+   * list, so like signal handlers, they first run on the next frame.
+   * Widgets that get removed move dispatch_next along.
+   */
+  for (l = scheduler->widgets.head; l; l = scheduler->dispatch_next)
+    {
+      scheduler->dispatch_next = l->next;
+      n_callbacks += gtk_widget_run_tick_callbacks (l->data, frame_clock);
+      n_widgets++;
+    }
+
+  scheduler->dispatch_next = NULL;
+
+  if (GDK_PROFILER_IS_RUNNING)
+    {
+      gdk_profiler_set_int_counter (ticking_widgets_counter, n_widgets);
+      gdk_profiler_set_int_counter (tick_callbacks_counter, n_callbacks);
+    }
+}
+
+static void
+gtk_widget_connect_tick_scheduler (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkTickScheduler *scheduler;
+  GdkFrameClock *frame_clock;
+
+  if (priv->tick_link != NULL)
+    return;
+
+  frame_clock = gtk_widget_get_frame_clock (widget);
+  if (frame_clock == NULL)
+    return;
+
+  scheduler = g_object_get_qdata (G_OBJECT (frame_clock), quark_tick_scheduler);
+  if (scheduler == NULL)
+    {
+      scheduler = g_slice_new0 (GtkTickScheduler);
+      g_object_set_qdata_full (G_OBJECT (frame_clock), quark_tick_scheduler,
+                               scheduler, gtk_tick_scheduler_free);
+    }
+
+  priv->tick_link = g_list_alloc ();
+  priv->tick_link->data = widget;
+  g_queue_push_head_link (&scheduler->widgets, priv->tick_link);
+
+  if (scheduler->update_id == 0)
+    {
+      scheduler->update_id = g_signal_connect (frame_clock, "update",
+                                               G_CALLBACK (gtk_tick_scheduler_update),
+                                               scheduler);
+      gdk_frame_clock_begin_updating (frame_clock);
+    }
+}
+
+static void
+gtk_widget_disconnect_tick_scheduler (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkTickScheduler *scheduler;
+  GdkFrameClock *frame_clock;
+
+  if (priv->tick_link == NULL)
+    return;
+
+  frame_clock = gtk_widget_get_frame_clock (widget);
+  scheduler = g_object_get_qdata (G_OBJECT (frame_clock), quark_tick_scheduler);
+
+  if (scheduler->dispatch_next == priv->tick_link)
+    scheduler->dispatch_next = priv->tick_link->next;
+
+  g_queue_delete_link (&scheduler->widgets, priv->tick_link);
+  priv->tick_link = NULL;
+
+  if (g_queue_is_empty (&scheduler->widgets))
+    {
+      g_clear_signal_handler (&scheduler->update_id, frame_clock);
+      gdk_frame_clock_end_updating (frame_clock);
+    }
 }
 
 static guint tick_callback_id;
@@ -2856,6 +3008,9 @@ static guint tick_callback_id;
  * #GdkFrameClock::update signal of #GdkFrameClock, since you don't
  * have to worry about when a #GdkFrameClock is assigned to a widget.
  *
+ * Tick callbacks are only called while the widget is mapped. If the
+ * widget is hidden, the callback is paused until it is shown again.
+ *
  * Returns: an id for the connection of this callback. Remove the callback
  *     by passing the id returned from this function to
  *     gtk_widget_remove_tick_callback()
@@ -2868,22 +3023,11 @@ gtk_widget_add_tick_callback (GtkWidget       *widget,
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GtkTickCallbackInfo *info;
-  GdkFrameClock *frame_clock;
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), 0);
 
-  if (priv->realized && !priv->clock_tick_id)
-    {
-      frame_clock = gtk_widget_get_frame_clock (widget);
-
-      if (frame_clock)
-        {
-          priv->clock_tick_id = g_signal_connect (frame_clock, "update",
-                                                  G_CALLBACK (gtk_widget_on_frame_clock_update),
-                                                  widget);
-          gdk_frame_clock_begin_updating (frame_clock);
-        }
-    }
+  if (priv->mapped)
+    gtk_widget_connect_tick_scheduler (widget);
 
   info = g_slice_new0 (GtkTickCallbackInfo);
 
@@ -3358,7 +3502,15 @@ gtk_widget_queue_draw (GtkWidget *widget)
       GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
 
       if (priv->draw_needed)
-        break;
+        {
+          /* A culled widget may have grown into the visible area, so
+           * its ancestors need to check it again. */
+          if (!priv->culled)
+            break;
+
+          priv->culled = FALSE;
+          continue;
+        }
 
       priv->draw_needed = TRUE;
       g_clear_pointer (&priv->render_node, gsk_render_node_unref);
@@ -3406,42 +3558,52 @@ gtk_widget_get_resize_needed (GtkWidget *widget)
  * @widget: a #GtkWidget
  * 
  * Queue a resize on a widget, and on all other widgets grouped with this widget.
+ *
+ * The walk up the tree stops at the first ancestor that already has a
+ * resize queued, so however many children queue a resize in a frame,
+ * each ancestor is only visited once.
  */
 static void
 gtk_widget_queue_resize_internal (GtkWidget *widget)
 {
-  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
-  GSList *groups, *l, *widgets;
+  while (widget != NULL)
+    {
+      GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+      GSList *groups, *l, *widgets;
+      GtkWidget *parent;
 
-  if (gtk_widget_get_resize_needed (widget))
-    return;
+      if (gtk_widget_get_resize_needed (widget))
+        return;
 
-  priv->resize_needed = TRUE;
-  gtk_widget_set_alloc_needed (widget);
+      priv->resize_needed = TRUE;
+      gtk_widget_set_alloc_needed (widget);
 
-  if (priv->resize_func)
-    priv->resize_func (widget);
+      if (priv->resize_func)
+        priv->resize_func (widget);
 
-  groups = _gtk_widget_get_sizegroups (widget);
+      groups = _gtk_widget_get_sizegroups (widget);
 
-  for (l = groups; l; l = l->next)
-  {
-    for (widgets = gtk_size_group_get_widgets (l->data); widgets; widgets = widgets->next)
+      for (l = groups; l; l = l->next)
       {
-        gtk_widget_queue_resize_internal (widgets->data);
+        _gtk_size_group_invalidate (l->data);
+
+        for (widgets = gtk_size_group_get_widgets (l->data); widgets; widgets = widgets->next)
+          {
+            gtk_widget_queue_resize_internal (widgets->data);
+          }
       }
-  }
 
-  if (_gtk_widget_get_visible (widget))
-    {
-      GtkWidget *parent = _gtk_widget_get_parent (widget);
-      if (parent)
+      if (!_gtk_widget_get_visible (widget))
+        return;
+
+      parent = _gtk_widget_get_parent (widget);
+      if (parent && GTK_IS_NATIVE (widget))
         {
-          if (GTK_IS_NATIVE (widget))
-            gtk_widget_queue_allocate (parent);
-          else
-            gtk_widget_queue_resize_internal (parent);
+          gtk_widget_queue_allocate (parent);
+          return;
         }
+
+      widget = parent;
     }
 }
 
@@ -3700,6 +3862,66 @@ gtk_widget_adjust_size_allocation (GtkWidget     *widget,
                     &allocation->height);
 }
 
+static void
+gtk_widget_update_in_pick_index (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkCssBoxes boxes;
+  graphene_rect_t bounds;
+
+  gtk_css_boxes_init (&boxes, widget);
+  gsk_transform_transform_bounds (priv->transform,
+                                  gtk_css_boxes_get_border_rect (&boxes),
+                                  &bounds);
+
+  gtk_pick_index_update (priv->parent->priv->pick_index, widget, &bounds);
+}
+
+/*
+ * gtk_widget_set_pick_index_enabled:
+ * @widget: a #GtkWidget
+ * @enabled: whether to index the children
+ *
+ * Makes gtk_widget_pick() look up the children of @widget in
+ * a spatial index instead of trying all of them. This speeds up
+ * picking in widgets with many children.
+ *
+ * Children are only picked inside the bounds of their border box,
+ * so this must not be enabled if children can pick descendants
+ * outside of their own bounds.
+ */
+void
+gtk_widget_set_pick_index_enabled (GtkWidget *widget,
+                                   gboolean   enabled)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkWidget *child;
+
+  if (enabled == (priv->pick_index != NULL))
+    return;
+
+  if (!enabled)
+    {
+      g_clear_pointer (&priv->pick_index, gtk_pick_index_free);
+      return;
+    }
+
+  priv->pick_index = gtk_pick_index_new ();
+
+  for (child = _gtk_widget_get_first_child (widget);
+       child;
+       child = _gtk_widget_get_next_sibling (child))
+    gtk_widget_update_in_pick_index (child);
+}
+
+gboolean
+gtk_widget_get_pick_index_enabled (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  return priv->pick_index != NULL;
+}
+
 /**
  * gtk_widget_allocate:
  * @widget: A #GtkWidget
@@ -3895,6 +4117,9 @@ gtk_widget_allocate (GtkWidget    *widget,
   gtk_widget_update_paintables (widget);
 
 skip_allocate:
+  if (priv->parent && priv->parent->priv->pick_index)
+    gtk_widget_update_in_pick_index (widget);
+
   if (size_changed || baseline_changed)
     gtk_widget_queue_draw (widget);
   else if (transform_changed && priv->parent)
@@ -4657,6 +4882,52 @@ gtk_widget_real_state_flags_changed (GtkWidget     *widget,
 {
 }
 
+/* Queues a redraw for a change of the widget's opacity. The opacity is
+ * applied when the parent appends the widget's render node, so the render
+ * node itself stays valid. Widgets that were fully transparent when they
+ * were last drawn did not create one, so they need to be drawn again.
+ * Widgets that were faded out keep theirs though, and can be faded in
+ * again without being drawn.
+ */
+static void
+gtk_widget_queue_draw_opacity (GtkWidget *widget,
+                               double     old_opacity)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  if (priv->parent && !GTK_IS_NATIVE (widget) &&
+      (old_opacity > 0.0 || (!priv->draw_needed && priv->render_node != NULL)))
+    gtk_widget_queue_draw (priv->parent);
+  else
+    gtk_widget_queue_draw (widget);
+}
+
+/* Applies a changed CSS transform by allocating the widget at its current
+ * size again, which skips the allocation of its children. This only works
+ * if no relayout is pending anyway, otherwise it returns %FALSE.
+ */
+static gboolean
+gtk_widget_update_css_transform (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  if (priv->parent == NULL ||
+      priv->alloc_needed ||
+      priv->alloc_needed_on_child ||
+      gtk_widget_get_resize_needed (widget) ||
+      _gtk_widget_get_alloc_needed (priv->parent))
+    return FALSE;
+
+  gtk_widget_allocate (widget,
+                       priv->allocated_width,
+                       priv->allocated_height,
+                       priv->allocated_size_baseline,
+                       gsk_transform_ref (priv->allocated_transform));
+  gtk_widget_queue_draw (priv->parent);
+
+  return TRUE;
+}
+
 static void
 gtk_widget_real_css_changed (GtkWidget         *widget,
                              GtkCssStyleChange *change)
@@ -4679,14 +4950,27 @@ gtk_widget_real_css_changed (GtkWidget         *widget,
             }
           else if (gtk_css_style_change_affects (change, GTK_CSS_AFFECTS_TRANSFORM))
             {
-              gtk_widget_queue_allocate (priv->parent);
+              if (!gtk_widget_update_css_transform (widget))
+                gtk_widget_queue_allocate (priv->parent);
             }
 
-          if (gtk_css_style_change_affects (change, GTK_CSS_AFFECTS_REDRAW) ||
+          /* Animated opacity is common and does not need the
+           * widget's contents to be redrawn */
+          if (gtk_css_style_change_affects (change, GTK_CSS_AFFECTS_REDRAW & ~GTK_CSS_AFFECTS_POSTEFFECT) ||
+              gtk_css_style_change_changes_property (change, GTK_CSS_PROPERTY_FILTER) ||
               (has_text && gtk_css_style_change_affects (change, GTK_CSS_AFFECTS_TEXT_CONTENT)))
             {
               gtk_widget_queue_draw (widget);
             }
+          else if (gtk_css_style_change_changes_property (change, GTK_CSS_PROPERTY_OPACITY))
+            {
+              GtkCssStyle *old_style = gtk_css_style_change_get_old_style (change);
+              double old_opacity;
+
+              old_opacity = CLAMP (_gtk_css_number_value_get (old_style->other->opacity, 100), 0.0, 1.0)
+                            * priv->user_alpha / 255.0;
+              gtk_widget_queue_draw_opacity (widget, old_opacity);
+            }
         }
     }
   else
@@ -5223,10 +5507,13 @@ gtk_widget_set_name (GtkWidget	 *widget,
 
   g_return_if_fail (GTK_IS_WIDGET (widget));
 
-  g_free (priv->name);
-  priv->name = g_strdup (name);
+  if (name == NULL && priv->extra == NULL)
+    return;
+
+  g_free (gtk_widget_ensure_extra (widget)->name);
+  priv->extra->name = g_strdup (name);
 
-  gtk_css_node_set_id (priv->cssnode, g_quark_from_string (priv->name));
+  gtk_css_node_set_id (priv->cssnode, g_quark_from_string (priv->extra->name));
 
   g_object_notify_by_pspec (G_OBJECT (widget), widget_props[PROP_NAME]);
 }
@@ -5248,8 +5535,8 @@ gtk_widget_get_name (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  if (priv->name)
-    return priv->name;
+  if (priv->extra && priv->extra->name)
+    return priv->extra->name;
   return G_OBJECT_TYPE_NAME (widget);
 }
 
@@ -5732,12 +6019,15 @@ gtk_widget_reposition_after (GtkWidget *widget,
 
   _gtk_widget_update_parent_muxer (widget);
 
-  if (parent->priv->children_observer)
+  if (parent->priv->pick_index)
+    gtk_pick_index_reorder (parent->priv->pick_index);
+
+  if (parent->priv->extra && parent->priv->extra->children_observer)
     {
       if (prev_previous)
-        gtk_list_list_model_item_moved (parent->priv->children_observer, widget, prev_previous);
+        gtk_list_list_model_item_moved (parent->priv->extra->children_observer, widget, prev_previous);
       else
-        gtk_list_list_model_item_added (parent->priv->children_observer, widget);
+        gtk_list_list_model_item_added (parent->priv->extra->children_observer, widget);
     }
 
   if (parent->priv->root && priv->root == NULL)
@@ -7001,18 +7291,21 @@ gtk_widget_dispose (GObject *object)
   if (muxer != NULL)
     g_object_run_dispose (G_OBJECT (muxer));
 
-  if (priv->children_observer)
-    gtk_list_list_model_clear (priv->children_observer);
-  if (priv->controller_observer)
-    gtk_list_list_model_clear (priv->controller_observer);
+  if (priv->extra)
+    {
+      if (priv->extra->children_observer)
+        gtk_list_list_model_clear (priv->extra->children_observer);
+      if (priv->extra->controller_observer)
+        gtk_list_list_model_clear (priv->extra->controller_observer);
+    }
 
   if (priv->parent)
     gtk_widget_unparent (widget);
   else if (_gtk_widget_get_visible (widget))
     gtk_widget_hide (widget);
 
-  while (priv->paintables)
-    gtk_widget_paintable_set_widget (priv->paintables->data, NULL);
+  while (priv->extra && priv->extra->paintables)
+    gtk_widget_paintable_set_widget (priv->extra->paintables->data, NULL);
 
   if (priv->layout_manager != NULL)
     gtk_layout_manager_set_widget (priv->layout_manager, NULL);
@@ -7024,7 +7317,8 @@ gtk_widget_dispose (GObject *object)
   if (_gtk_widget_get_realized (widget))
     gtk_widget_unrealize (widget);
 
-  g_clear_object (&priv->cursor);
+  if (priv->extra)
+    g_clear_object (&priv->extra->cursor);
 
   if (!priv->in_destruction)
     {
@@ -7194,12 +7488,18 @@ gtk_widget_finalize (GObject *object)
 
   gtk_grab_remove (widget);
 
-  g_free (priv->name);
-  g_free (priv->tooltip_markup);
-  g_free (priv->tooltip_text);
+  if (priv->extra)
+    {
+      g_free (priv->extra->name);
+      g_free (priv->extra->tooltip_markup);
+      g_free (priv->extra->tooltip_text);
+      g_free (priv->extra);
+    }
 
   g_clear_pointer (&priv->transform, gsk_transform_unref);
   g_clear_pointer (&priv->allocated_transform, gsk_transform_unref);
+  g_clear_pointer (&priv->pick_index, gtk_pick_index_free);
+  gtk_widget_clear_decoration_nodes (widget);
 
   gtk_css_widget_node_widget_destroyed (GTK_CSS_WIDGET_NODE (priv->cssnode));
   g_object_unref (priv->cssnode);
@@ -7263,6 +7563,9 @@ gtk_widget_real_map (GtkWidget *widget)
       GtkWidget *p;
       priv->mapped = TRUE;
 
+      if (priv->tick_callbacks != NULL)
+        gtk_widget_connect_tick_scheduler (widget);
+
       for (p = gtk_widget_get_first_child (widget);
            p != NULL;
            p = gtk_widget_get_next_sibling (p))
@@ -7293,6 +7596,8 @@ gtk_widget_real_unmap (GtkWidget *widget)
       GtkWidget *child;
       priv->mapped = FALSE;
 
+      gtk_widget_disconnect_tick_scheduler (widget);
+
       for (child = _gtk_widget_get_first_child (widget);
            child != NULL;
            child = _gtk_widget_get_next_sibling (child))
@@ -7323,17 +7628,6 @@ gtk_widget_real_realize (GtkWidget *widget)
 
   priv->realized = TRUE;
 
-  /* Connect frame clock */
-  if (priv->tick_callbacks != NULL && !priv->clock_tick_id)
-    {
-      GdkFrameClock *frame_clock = gtk_widget_get_frame_clock (widget);
-
-      priv->clock_tick_id = g_signal_connect (frame_clock, "update",
-                                              G_CALLBACK (gtk_widget_on_frame_clock_update),
-                                              widget);
-      gdk_frame_clock_begin_updating (frame_clock);
-    }
-
   gtk_css_node_invalidate_frame_clock (priv->cssnode, FALSE);
 }
 
@@ -7363,15 +7657,6 @@ gtk_widget_real_unrealize (GtkWidget *widget)
   /* Disconnect frame clock */
   gtk_css_node_invalidate_frame_clock (priv->cssnode, FALSE);
 
-  if (priv->clock_tick_id)
-    {
-      GdkFrameClock *frame_clock = gtk_widget_get_frame_clock (widget);
-
-      g_signal_handler_disconnect (frame_clock, priv->clock_tick_id);
-      priv->clock_tick_id = 0;
-      gdk_frame_clock_end_updating (frame_clock);
-    }
-
   priv->realized = FALSE;
 }
 
@@ -9022,8 +9307,8 @@ void
 gtk_widget_set_tooltip_text (GtkWidget  *widget,
                              const char *text)
 {
-  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GObject *object = G_OBJECT (widget);
+  GtkWidgetExtra *extra;
   char *tooltip_text, *tooltip_markup;
 
   g_return_if_fail (GTK_IS_WIDGET (widget));
@@ -9044,13 +9329,14 @@ gtk_widget_set_tooltip_text (GtkWidget  *widget,
       tooltip_markup = text != NULL ? g_markup_escape_text (text, -1) : NULL;
     }
 
-  g_clear_pointer (&priv->tooltip_markup, g_free);
-  g_clear_pointer (&priv->tooltip_text, g_free);
+  extra = gtk_widget_ensure_extra (widget);
+  g_clear_pointer (&extra->tooltip_markup, g_free);
+  g_clear_pointer (&extra->tooltip_text, g_free);
 
-  priv->tooltip_text = tooltip_text;
-  priv->tooltip_markup = tooltip_markup;
+  extra->tooltip_text = tooltip_text;
+  extra->tooltip_markup = tooltip_markup;
 
-  gtk_widget_set_has_tooltip (widget, priv->tooltip_text != NULL);
+  gtk_widget_set_has_tooltip (widget, extra->tooltip_text != NULL);
   if (_gtk_widget_get_visible (widget))
     gtk_widget_trigger_tooltip_query (widget);
 
@@ -9079,7 +9365,7 @@ gtk_widget_get_tooltip_text (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  return priv->tooltip_text;
+  return priv->extra ? priv->extra->tooltip_text : NULL;
 }
 
 /**
@@ -9100,8 +9386,8 @@ void
 gtk_widget_set_tooltip_markup (GtkWidget  *widget,
                                const char *markup)
 {
-  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GObject *object = G_OBJECT (widget);
+  GtkWidgetExtra *extra;
   char *tooltip_markup;
 
   g_return_if_fail (GTK_IS_WIDGET (widget));
@@ -9116,18 +9402,19 @@ gtk_widget_set_tooltip_markup (GtkWidget  *widget,
   else
     tooltip_markup = g_strdup (markup);
 
-  g_clear_pointer (&priv->tooltip_text, g_free);
-  g_clear_pointer (&priv->tooltip_markup, g_free);
+  extra = gtk_widget_ensure_extra (widget);
+  g_clear_pointer (&extra->tooltip_text, g_free);
+  g_clear_pointer (&extra->tooltip_markup, g_free);
 
-  priv->tooltip_markup = tooltip_markup;
+  extra->tooltip_markup = tooltip_markup;
 
   /* Store the tooltip without markup, as we might end up using
    * it for widget descriptions in the accessibility layer
    */
-  if (priv->tooltip_markup != NULL)
+  if (extra->tooltip_markup != NULL)
     {
-      pango_parse_markup (priv->tooltip_markup, -1, 0, NULL,
-                          &priv->tooltip_text,
+      pango_parse_markup (extra->tooltip_markup, -1, 0, NULL,
+                          &extra->tooltip_text,
                           NULL,
                           NULL);
     }
@@ -9159,7 +9446,7 @@ gtk_widget_get_tooltip_markup (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  return priv->tooltip_markup;
+  return priv->extra ? priv->extra->tooltip_markup : NULL;
 }
 
 /**
@@ -9299,6 +9586,69 @@ gtk_widget_can_be_picked (GtkWidget    *widget,
   return TRUE;
 }
 
+static GtkWidget *
+gtk_widget_do_pick (GtkWidget    *widget,
+                    double        x,
+                    double        y,
+                    GtkPickFlags  flags);
+
+static GtkWidget *
+gtk_widget_pick_child (GtkWidget    *child,
+                       double        x,
+                       double        y,
+                       GtkPickFlags  flags)
+{
+  GtkWidgetPrivate *child_priv = gtk_widget_get_instance_private (child);
+  graphene_point3d_t res;
+
+  if (!gtk_widget_can_be_picked (child, flags))
+    return NULL;
+
+  if (GTK_IS_NATIVE (child))
+    return NULL;
+
+  if (child_priv->transform)
+    {
+      if (gsk_transform_get_category (child_priv->transform) >= GSK_TRANSFORM_CATEGORY_2D_AFFINE)
+        {
+          graphene_point_t transformed_p;
+
+          gsk_transform_transform_point (child_priv->transform,
+                                         &(graphene_point_t) { 0, 0 },
+                                         &transformed_p);
+
+          graphene_point3d_init (&res, x - transformed_p.x, y - transformed_p.y, 0.);
+        }
+      else
+        {
+          GskTransform *transform;
+          graphene_matrix_t inv;
+          graphene_point3d_t p0, p1;
+
+          transform = gsk_transform_invert (gsk_transform_ref (child_priv->transform));
+          if (transform == NULL)
+            return NULL;
+
+          gsk_transform_to_matrix (transform, &inv);
+          gsk_transform_unref (transform);
+          graphene_point3d_init (&p0, x, y, 0);
+          graphene_point3d_init (&p1, x, y, 1);
+          graphene_matrix_transform_point3d (&inv, &p0, &p0);
+          graphene_matrix_transform_point3d (&inv, &p1, &p1);
+          if (fabs (p0.z - p1.z) < 1.f / 4096)
+            return NULL;
+
+          graphene_point3d_interpolate (&p0, &p1, p0.z / (p0.z - p1.z), &res);
+        }
+    }
+  else
+    {
+      graphene_point3d_init (&res, x, y, 0);
+    }
+
+  return gtk_widget_do_pick (child, res.x, res.y, flags);
+}
+
 static GtkWidget *
 gtk_widget_do_pick (GtkWidget    *widget,
                     double        x,
@@ -9319,63 +9669,36 @@ gtk_widget_do_pick (GtkWidget    *widget,
         return NULL;
     }
 
-  for (child = _gtk_widget_get_last_child (widget);
-       child;
-       child = _gtk_widget_get_prev_sibling (child))
+  if (priv->pick_index)
     {
-      GtkWidgetPrivate *child_priv = gtk_widget_get_instance_private (child);
-      GtkWidget *picked;
-      graphene_point3d_t res;
+      GPtrArray *children;
+      GtkWidget *picked = NULL;
+      guint i;
 
-      if (!gtk_widget_can_be_picked (child, flags))
-        continue;
+      children = g_ptr_array_new ();
+      gtk_pick_index_query (priv->pick_index, widget, x, y, children);
 
-      if (GTK_IS_NATIVE (child))
-        continue;
+      for (i = 0; i < children->len && picked == NULL; i++)
+        picked = gtk_widget_pick_child (g_ptr_array_index (children, i), x, y, flags);
 
-      if (child_priv->transform)
-        {
-          if (gsk_transform_get_category (child_priv->transform) >= GSK_TRANSFORM_CATEGORY_2D_AFFINE)
-            {
-              graphene_point_t transformed_p;
+      g_ptr_array_unref (children);
 
-              gsk_transform_transform_point (child_priv->transform,
-                                             &(graphene_point_t) { 0, 0 },
-                                             &transformed_p);
-
-              graphene_point3d_init (&res, x - transformed_p.x, y - transformed_p.y, 0.);
-            }
-          else
-            {
-              GskTransform *transform;
-              graphene_matrix_t inv;
-              graphene_point3d_t p0, p1;
-
-              transform = gsk_transform_invert (gsk_transform_ref (child_priv->transform));
-              if (transform == NULL)
-                continue;
-
-              gsk_transform_to_matrix (transform, &inv);
-              gsk_transform_unref (transform);
-              graphene_point3d_init (&p0, x, y, 0);
-              graphene_point3d_init (&p1, x, y, 1);
-              graphene_matrix_transform_point3d (&inv, &p0, &p0);
-              graphene_matrix_transform_point3d (&inv, &p1, &p1);
-              if (fabs (p0.z - p1.z) < 1.f / 4096)
-                continue;
-
-              graphene_point3d_interpolate (&p0, &p1, p0.z / (p0.z - p1.z), &res);
-            }
-        }
-      else
-        {
-          graphene_point3d_init (&res, x, y, 0);
-        }
-
-      picked = gtk_widget_do_pick (child, res.x, res.y, flags);
       if (picked)
         return picked;
     }
+  else
+    {
+      for (child = _gtk_widget_get_last_child (widget);
+           child;
+           child = _gtk_widget_get_prev_sibling (child))
+        {
+          GtkWidget *picked;
+
+          picked = gtk_widget_pick_child (child, x, y, flags);
+          if (picked)
+            return picked;
+        }
+    }
 
   if (!GTK_WIDGET_GET_CLASS (widget)->contains (widget, x, y))
     return NULL;
@@ -9638,6 +9961,7 @@ gtk_widget_set_opacity (GtkWidget *widget,
                         double     opacity)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  double old_opacity;
   guint8 alpha;
 
   g_return_if_fail (GTK_IS_WIDGET (widget));
@@ -9649,9 +9973,10 @@ gtk_widget_set_opacity (GtkWidget *widget,
   if (alpha == priv->user_alpha)
     return;
 
+  old_opacity = gtk_widget_get_effective_opacity (widget);
   priv->user_alpha = alpha;
 
-  gtk_widget_queue_draw (widget);
+  gtk_widget_queue_draw_opacity (widget, old_opacity);
 
   g_object_notify_by_pspec (G_OBJECT (widget), widget_props[PROP_OPACITY]);
 }
@@ -9858,6 +10183,9 @@ gtk_widget_ensure_resize (GtkWidget *widget)
 
   priv->resize_needed = FALSE;
   _gtk_size_request_cache_clear (&priv->requests);
+
+  if (priv->layout_manager)
+    gtk_layout_manager_invalidate (priv->layout_manager);
 }
 
 void
@@ -10719,6 +11047,18 @@ gtk_widget_cancel_event_sequence (GtkWidget             *widget,
  * usually want to call this function right after creating any kind of
  * #GtkEventController.
  **/
+/* Controllers that only look at keys, focus or scrolling never handle
+ * motion events, so motion can skip widgets with only those.
+ */
+static gboolean
+controller_handles_motion (GtkEventController *controller)
+{
+  return !GTK_IS_EVENT_CONTROLLER_KEY (controller) &&
+         !GTK_IS_EVENT_CONTROLLER_FOCUS (controller) &&
+         !GTK_IS_EVENT_CONTROLLER_SCROLL (controller) &&
+         !GTK_IS_SHORTCUT_CONTROLLER (controller);
+}
+
 void
 gtk_widget_add_controller (GtkWidget          *widget,
                            GtkEventController *controller)
@@ -10732,9 +11072,11 @@ gtk_widget_add_controller (GtkWidget          *widget,
   GTK_EVENT_CONTROLLER_GET_CLASS (controller)->set_widget (controller, widget);
 
   priv->event_controllers = g_list_prepend (priv->event_controllers, controller);
+  if (controller_handles_motion (controller))
+    priv->n_motion_controllers++;
 
-  if (priv->controller_observer)
-    gtk_list_list_model_item_added_at (priv->controller_observer, 0);
+  if (priv->extra && priv->extra->controller_observer)
+    gtk_list_list_model_item_added_at (priv->extra->controller_observer, 0);
 }
 
 /**
@@ -10764,10 +11106,12 @@ gtk_widget_remove_controller (GtkWidget          *widget,
   list = g_list_find (priv->event_controllers, controller);
   before = list->prev;
   priv->event_controllers = g_list_delete_link (priv->event_controllers, list);
+  if (controller_handles_motion (controller))
+    priv->n_motion_controllers--;
   g_object_unref (controller);
 
-  if (priv->controller_observer)
-    gtk_list_list_model_item_removed (priv->controller_observer, before);
+  if (priv->extra && priv->extra->controller_observer)
+    gtk_list_list_model_item_removed (priv->extra->controller_observer, before);
 }
 
 gboolean
@@ -10845,6 +11189,65 @@ gtk_widget_list_controllers (GtkWidget           *widget,
   return (GtkEventController **)g_ptr_array_free (controllers, FALSE);
 }
 
+/* The opacity is not part of the widget's render node, but applied
+ * by gtk_widget_snapshot(). This way, changing it only requires the
+ * parent to be redrawn.
+ */
+double
+gtk_widget_get_effective_opacity (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkCssStyle *style = gtk_css_node_get_style (priv->cssnode);
+  double css_opacity;
+
+  css_opacity = _gtk_css_number_value_get (style->other->opacity, 100);
+
+  return CLAMP (css_opacity, 0.0, 1.0) * priv->user_alpha / 255.0;
+}
+
+static void
+gtk_widget_clear_decoration_nodes (GtkWidget *widget)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  g_clear_pointer (&priv->background_node, gsk_render_node_unref);
+  g_clear_pointer (&priv->outline_node, gsk_render_node_unref);
+  g_clear_object (&priv->decoration_style);
+}
+
+/* Widgets are mostly redrawn for changes to their contents, so the
+ * nodes for their CSS background, border and outline are kept for
+ * as long as their style and size stay the same.
+ */
+static void
+gtk_widget_ensure_decoration_nodes (GtkWidget   *widget,
+                                    GtkCssBoxes *boxes)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkCssStyle *style = gtk_css_node_get_style (priv->cssnode);
+  GtkSnapshot *snapshot;
+
+  if (priv->decoration_style == style &&
+      priv->decoration_width == priv->width &&
+      priv->decoration_height == priv->height)
+    return;
+
+  gtk_widget_clear_decoration_nodes (widget);
+
+  snapshot = gtk_snapshot_new ();
+  gtk_css_style_snapshot_background (boxes, snapshot);
+  gtk_css_style_snapshot_border (boxes, snapshot);
+  priv->background_node = gtk_snapshot_free_to_node (snapshot);
+
+  snapshot = gtk_snapshot_new ();
+  gtk_css_style_snapshot_outline (boxes, snapshot);
+  priv->outline_node = gtk_snapshot_free_to_node (snapshot);
+
+  priv->decoration_style = g_object_ref (style);
+  priv->decoration_width = priv->width;
+  priv->decoration_height = priv->height;
+}
+
 static GskRenderNode *
 gtk_widget_create_render_node (GtkWidget   *widget,
                                GtkSnapshot *snapshot)
@@ -10853,20 +11256,19 @@ gtk_widget_create_render_node (GtkWidget   *widget,
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GtkCssBoxes boxes;
   GtkCssValue *filter_value;
-  double css_opacity, opacity;
   GtkCssStyle *style;
 
   style = gtk_css_node_get_style (priv->cssnode);
 
-  css_opacity = _gtk_css_number_value_get (style->other->opacity, 100);
-  opacity = CLAMP (css_opacity, 0.0, 1.0) * priv->user_alpha / 255.0;
-
-  if (opacity <= 0.0)
+  if (gtk_widget_get_effective_opacity (widget) <= 0.0)
     return NULL;
 
   gtk_css_boxes_init (&boxes, widget);
+  gtk_widget_ensure_decoration_nodes (widget, &boxes);
 
   gtk_snapshot_push_collect (snapshot);
+  if (priv->extra && priv->extra->paintables)
+    gtk_snapshot_unset_clip (snapshot);
   gtk_snapshot_push_debug (snapshot,
                            "RenderNode for %s %p",
                            G_OBJECT_TYPE_NAME (widget), widget);
@@ -10874,11 +11276,8 @@ gtk_widget_create_render_node (GtkWidget   *widget,
   filter_value = style->other->filter;
   gtk_css_filter_value_push_snapshot (filter_value, snapshot);
 
-  if (opacity < 1.0)
-    gtk_snapshot_push_opacity (snapshot, opacity);
-
-  gtk_css_style_snapshot_background (&boxes, snapshot);
-  gtk_css_style_snapshot_border (&boxes, snapshot);
+  if (priv->background_node)
+    gtk_snapshot_append_node (snapshot, priv->background_node);
 
   if (priv->overflow == GTK_OVERFLOW_HIDDEN)
     {
@@ -10891,10 +11290,8 @@ gtk_widget_create_render_node (GtkWidget   *widget,
       klass->snapshot (widget, snapshot);
     }
 
-  gtk_css_style_snapshot_outline (&boxes, snapshot);
-
-  if (opacity < 1.0)
-    gtk_snapshot_pop (snapshot);
+  if (priv->outline_node)
+    gtk_snapshot_append_node (snapshot, priv->outline_node);
 
   gtk_css_filter_value_pop_snapshot (filter_value, snapshot);
 
@@ -10903,15 +11300,91 @@ gtk_widget_create_render_node (GtkWidget   *widget,
   return gtk_snapshot_pop_collect (snapshot);
 }
 
+/* Estimates the area @widget draws to, in its own coordinate system,
+ * without snapshotting it. That is its border box, grown by its box
+ * shadows and outline. Children that are allocated outside of their
+ * parent are not taken into account.
+ */
+static void
+gtk_widget_get_ink_bounds (GtkWidget       *widget,
+                           graphene_rect_t *bounds)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+  GtkCssStyle *style = gtk_css_node_get_style (priv->cssnode);
+  GtkCssBoxes boxes;
+  GtkBorder extents;
+  double outline;
+
+  gtk_css_boxes_init (&boxes, widget);
+  *bounds = gtk_css_boxes_get_border_box (&boxes)->bounds;
+
+  gtk_css_shadow_value_get_extents (style->background->box_shadow, &extents);
+  outline = MAX (0, _gtk_css_number_value_get (style->outline->outline_width, 100) +
+                    _gtk_css_number_value_get (style->outline->outline_offset, 100));
+
+  bounds->origin.x -= MAX (extents.left, outline);
+  bounds->origin.y -= MAX (extents.top, outline);
+  bounds->size.width += MAX (extents.left, outline) + MAX (extents.right, outline);
+  bounds->size.height += MAX (extents.top, outline) + MAX (extents.bottom, outline);
+}
+
+/* Whether culling against @clip would not leave out anything that wasn't
+ * already left out when the widget's render node was created.
+ */
+static gboolean
+gtk_widget_snapshot_clip_covers (GtkWidget             *widget,
+                                 gboolean               has_clip,
+                                 const graphene_rect_t *clip)
+{
+  GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
+
+  if (!priv->has_snapshot_clip)
+    return TRUE;
+
+  if (!has_clip)
+    return FALSE;
+
+  return graphene_rect_contains_rect (&priv->snapshot_clip, clip);
+}
+
+/* Must be called with @snapshot in @widget's coordinate system, so
+ * that the clip can be compared to the widget.
+ */
 static void
 gtk_widget_do_snapshot (GtkWidget *widget,
                         GtkSnapshot *snapshot)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
   GskRenderNode *render_node;
+  graphene_rect_t clip;
+  gboolean has_clip;
+  int culled_before;
+
+  /* Paintables show all of the widget, not just what is visible here */
+  if (priv->extra && priv->extra->paintables)
+    has_clip = FALSE;
+  else
+    has_clip = gtk_snapshot_get_clip_bounds (snapshot, &clip);
+
+  /* Render nodes of widgets that culled some of their descendants can
+   * only be reused as long as those stay outside of the clip. */
+  if (!priv->draw_needed && priv->culled_children &&
+      !gtk_widget_snapshot_clip_covers (widget, has_clip, &clip))
+    {
+      priv->draw_needed = TRUE;
+      g_clear_pointer (&priv->render_node, gsk_render_node_unref);
+    }
 
+  /* Widgets that haven't queued a draw keep their render node, and
+   * their snapshot vfunc isn't called. Ancestors of widgets that did
+   * have to be snapshotted again, because their render node contains
+   * the ones of their children.
+   */
   if (!priv->draw_needed)
-    return;
+    {
+      reused_widgets++;
+      return;
+    }
 
   g_assert (priv->mapped);
 
@@ -10921,8 +11394,27 @@ gtk_widget_do_snapshot (GtkWidget *widget,
       return;
     }
 
+  /* Widgets that are entirely clipped away are not snapshotted at all.
+   * They stay in need of a draw, and their ancestors remember the clip,
+   * see above. */
+  if (has_clip)
+    {
+      graphene_rect_t bounds;
+
+      gtk_widget_get_ink_bounds (widget, &bounds);
+      if (!graphene_rect_intersection (&bounds, &clip, NULL))
+        {
+          g_clear_pointer (&priv->render_node, gsk_render_node_unref);
+          priv->culled = TRUE;
+          culled_widgets++;
+          return;
+        }
+    }
+
   gtk_widget_push_paintables (widget);
 
+  snapshotted_widgets++;
+  culled_before = culled_widgets;
   render_node = gtk_widget_create_render_node (widget, snapshot);
   /* This can happen when nested drawing happens and a widget contains itself
    * or when we replace a clipped area */
@@ -10930,6 +11422,11 @@ gtk_widget_do_snapshot (GtkWidget *widget,
   priv->render_node = render_node;
 
   priv->draw_needed = FALSE;
+  priv->culled = FALSE;
+  priv->culled_children = culled_widgets != culled_before;
+  priv->has_snapshot_clip = priv->culled_children && has_clip;
+  if (priv->has_snapshot_clip)
+    priv->snapshot_clip = clip;
 
   gtk_widget_pop_paintables (widget);
   gtk_widget_update_paintables (widget);
@@ -10947,7 +11444,20 @@ gtk_widget_snapshot (GtkWidget   *widget,
   gtk_widget_do_snapshot (widget, snapshot);
 
   if (priv->render_node)
-    gtk_snapshot_append_node (snapshot, priv->render_node);
+    {
+      double opacity = gtk_widget_get_effective_opacity (widget);
+
+      if (opacity <= 0.0)
+        return;
+
+      if (opacity < 1.0)
+        gtk_snapshot_push_opacity (snapshot, opacity);
+
+      gtk_snapshot_append_node (snapshot, priv->render_node);
+
+      if (opacity < 1.0)
+        gtk_snapshot_pop (snapshot);
+    }
 }
 
 void
@@ -10962,7 +11472,7 @@ gtk_widget_render (GtkWidget            *widget,
   gint64 before_snapshot G_GNUC_UNUSED;
   gint64 before_render G_GNUC_UNUSED;
 
-  before_snapshot = GDK_PROFILER_CURRENT_TIME;
+  before_snapshot = gdk_profiler_trace_begin ();
   before_render = 0;
 
   if (!GTK_IS_NATIVE (widget))
@@ -10982,8 +11492,15 @@ gtk_widget_render (GtkWidget            *widget,
     {
       before_render = GDK_PROFILER_CURRENT_TIME;
       gdk_profiler_add_mark (before_snapshot, (before_render - before_snapshot), "widget snapshot", "");
+      gdk_profiler_set_int_counter (snapshotted_widgets_counter, snapshotted_widgets);
+      gdk_profiler_set_int_counter (reused_widgets_counter, reused_widgets);
+      gdk_profiler_set_int_counter (culled_widgets_counter, culled_widgets);
     }
 
+  snapshotted_widgets = 0;
+  reused_widgets = 0;
+  culled_widgets = 0;
+
   if (root != NULL)
     {
       root = gtk_inspector_prepare_render (widget,
@@ -10996,7 +11513,7 @@ gtk_widget_render (GtkWidget            *widget,
 
       gsk_render_node_unref (root);
 
-      gdk_profiler_end_mark (before_render, "widget render", "");
+      gdk_profiler_trace_end (before_render, "widget render");
     }
 }
 
@@ -11005,7 +11522,7 @@ gtk_widget_child_observer_destroyed (gpointer widget)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
 
-  priv->children_observer = NULL;
+  priv->extra->children_observer = NULL;
 }
 
 /**
@@ -11031,10 +11548,10 @@ gtk_widget_observe_children (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  if (priv->children_observer)
-    return g_object_ref (G_LIST_MODEL (priv->children_observer));
+  if (priv->extra && priv->extra->children_observer)
+    return g_object_ref (G_LIST_MODEL (priv->extra->children_observer));
 
-  priv->children_observer = gtk_list_list_model_new ((gpointer) gtk_widget_get_first_child,
+  gtk_widget_ensure_extra (widget)->children_observer = gtk_list_list_model_new ((gpointer) gtk_widget_get_first_child,
                                                      (gpointer) gtk_widget_get_next_sibling,
                                                      (gpointer) gtk_widget_get_prev_sibling,
                                                      (gpointer) gtk_widget_get_last_child,
@@ -11042,7 +11559,7 @@ gtk_widget_observe_children (GtkWidget *widget)
                                                      widget,
                                                      gtk_widget_child_observer_destroyed);
 
-  return G_LIST_MODEL (priv->children_observer);
+  return G_LIST_MODEL (priv->extra->children_observer);
 }
 
 static void
@@ -11050,7 +11567,7 @@ gtk_widget_controller_observer_destroyed (gpointer widget)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (widget);
 
-  priv->controller_observer = NULL;
+  priv->extra->controller_observer = NULL;
 }
 
 static gpointer
@@ -11103,10 +11620,10 @@ gtk_widget_observe_controllers (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  if (priv->controller_observer)
-    return g_object_ref (G_LIST_MODEL (priv->controller_observer));
+  if (priv->extra && priv->extra->controller_observer)
+    return g_object_ref (G_LIST_MODEL (priv->extra->controller_observer));
 
-  priv->controller_observer = gtk_list_list_model_new (gtk_widget_controller_list_get_first,
+  gtk_widget_ensure_extra (widget)->controller_observer = gtk_list_list_model_new (gtk_widget_controller_list_get_first,
                                                        gtk_widget_controller_list_get_next,
                                                        gtk_widget_controller_list_get_prev,
                                                        NULL,
@@ -11114,7 +11631,7 @@ gtk_widget_observe_controllers (GtkWidget *widget)
                                                        widget,
                                                        gtk_widget_controller_observer_destroyed);
 
-  return G_LIST_MODEL (priv->controller_observer);
+  return G_LIST_MODEL (priv->extra->controller_observer);
 }
 
 /**
@@ -11326,6 +11843,8 @@ gtk_widget_snapshot_child (GtkWidget   *widget,
                            GtkSnapshot *snapshot)
 {
   GtkWidgetPrivate *priv = gtk_widget_get_instance_private (child);
+  GskRenderNode *node;
+  double opacity;
 
   g_return_if_fail (_gtk_widget_get_parent (child) == widget);
   g_return_if_fail (snapshot != NULL);
@@ -11336,23 +11855,43 @@ gtk_widget_snapshot_child (GtkWidget   *widget,
   if (GTK_IS_NATIVE (child))
     return;
 
-  gtk_widget_do_snapshot (child, snapshot);
+  if (priv->draw_needed || priv->culled_children)
+    {
+      gtk_snapshot_save (snapshot);
+      gtk_snapshot_transform (snapshot, priv->transform);
+      gtk_widget_do_snapshot (child, snapshot);
+      gtk_snapshot_restore (snapshot);
+    }
+  else
+    {
+      gtk_widget_do_snapshot (child, snapshot);
+    }
 
   if (!priv->render_node)
     return;
 
+  opacity = gtk_widget_get_effective_opacity (child);
+  if (opacity <= 0.0)
+    return;
+
+  if (opacity < 1.0)
+    node = gsk_opacity_node_new (priv->render_node, opacity);
+  else
+    node = gsk_render_node_ref (priv->render_node);
+
   if (priv->transform)
     {
-      GskRenderNode *transform_node = gsk_transform_node_new (priv->render_node,
-                                                              priv->transform);
+      GskRenderNode *transform_node = gsk_transform_node_new (node, priv->transform);
 
       gtk_snapshot_append_node (snapshot, transform_node);
       gsk_render_node_unref (transform_node);
     }
   else
     {
-      gtk_snapshot_append_node (snapshot, priv->render_node);
+      gtk_snapshot_append_node (snapshot, node);
     }
+
+  gsk_render_node_unref (node);
 }
 
 /**
@@ -11432,7 +11971,10 @@ gtk_widget_set_cursor (GtkWidget *widget,
   g_return_if_fail (GTK_IS_WIDGET (widget));
   g_return_if_fail (cursor == NULL || GDK_IS_CURSOR (cursor));
 
-  if (!g_set_object (&priv->cursor, cursor))
+  if (cursor == NULL && priv->extra == NULL)
+    return;
+
+  if (!g_set_object (&gtk_widget_ensure_extra (widget)->cursor, cursor))
     return;
 
   root = _gtk_widget_get_root (widget);
@@ -11494,7 +12036,7 @@ gtk_widget_get_cursor (GtkWidget *widget)
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
 
-  return priv->cursor;
+  return priv->extra ? priv->extra->cursor : NULL;
 }
 
 /**
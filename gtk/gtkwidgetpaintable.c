@@ -21,7 +21,10 @@
 
 #include "gtkwidgetpaintableprivate.h"
 
+#include <math.h>
+
 #include "gtkintl.h"
+#include "gtknative.h"
 #include "gtksnapshot.h"
 #include "gtkrendernodepaintableprivate.h"
 #include "gtkwidgetprivate.h"
@@ -52,6 +55,11 @@
  * The paintable will take care of recursion when this happens. If you do
  * this however, ensure the #GtkPicture:can-shrink property is set to
  * %TRUE or you might end up with an infinitely growing widget.
+ *
+ * The contents only change when the widget's rendering changes. If a
+ * GtkWidgetPaintable is used for small previews of a large widget, setting
+ * #GtkWidgetPaintable:cache-texture makes it draw a downscaled texture
+ * instead of all of the widget's rendering.
  */
 struct _GtkWidgetPaintable
 {
@@ -64,6 +72,14 @@ struct _GtkWidgetPaintable
 
   GdkPaintable *current_image;          /* the image that we are presenting */
   GdkPaintable *pending_image;          /* the image that we should be presenting */
+
+  /* What the latest image was created from */
+  GskRenderNode *node;
+  graphene_rect_t bounds;
+  double opacity;
+
+  gboolean cache_texture;
+  GdkTexture *texture;                  /* current_image, downscaled */
 };
 
 struct _GtkWidgetPaintableClass
@@ -74,12 +90,63 @@ struct _GtkWidgetPaintableClass
 enum {
   PROP_0,
   PROP_WIDGET,
+  PROP_CACHE_TEXTURE,
 
   N_PROPS,
 };
 
 static GParamSpec *properties[N_PROPS] = { NULL, };
 
+/* Renders the current image into a texture of the given size, unless
+ * that wouldn't make it any smaller.
+ */
+static GdkTexture *
+gtk_widget_paintable_get_texture (GtkWidgetPaintable *self,
+                                  double              width,
+                                  double              height)
+{
+  GtkSnapshot *snapshot;
+  GskRenderNode *node;
+  GtkNative *native;
+  int scale, texture_width, texture_height;
+
+  if (self->widget == NULL)
+    return NULL;
+
+  scale = gtk_widget_get_scale_factor (self->widget);
+  texture_width = ceil (width * scale);
+  texture_height = ceil (height * scale);
+
+  if (self->texture &&
+      gdk_texture_get_width (self->texture) == texture_width &&
+      gdk_texture_get_height (self->texture) == texture_height)
+    return self->texture;
+
+  g_clear_object (&self->texture);
+
+  if (texture_width <= 0 || texture_height <= 0 ||
+      texture_width >= gdk_paintable_get_intrinsic_width (self->current_image) * scale ||
+      texture_height >= gdk_paintable_get_intrinsic_height (self->current_image) * scale)
+    return NULL;
+
+  native = gtk_widget_get_native (self->widget);
+  if (native == NULL || gtk_native_get_renderer (native) == NULL)
+    return NULL;
+
+  snapshot = gtk_snapshot_new ();
+  gdk_paintable_snapshot (self->current_image, snapshot, texture_width, texture_height);
+  node = gtk_snapshot_free_to_node (snapshot);
+  if (node == NULL)
+    return NULL;
+
+  self->texture = gsk_renderer_render_texture (gtk_native_get_renderer (native),
+                                               node,
+                                               &GRAPHENE_RECT_INIT (0, 0, texture_width, texture_height));
+  gsk_render_node_unref (node);
+
+  return self->texture;
+}
+
 static void
 gtk_widget_paintable_paintable_snapshot (GdkPaintable *paintable,
                                          GdkSnapshot  *snapshot,
@@ -109,7 +176,15 @@ gtk_widget_paintable_paintable_snapshot (GdkPaintable *paintable,
     }
   else
     {
-      gdk_paintable_snapshot (self->current_image, snapshot, width, height);
+      GdkTexture *texture = NULL;
+
+      if (self->cache_texture)
+        texture = gtk_widget_paintable_get_texture (self, width, height);
+
+      if (texture)
+        gtk_snapshot_append_texture (snapshot, texture, &GRAPHENE_RECT_INIT (0, 0, width, height));
+      else
+        gdk_paintable_snapshot (self->current_image, snapshot, width, height);
     }
 }
 
@@ -165,6 +240,10 @@ gtk_widget_paintable_set_property (GObject      *object,
       gtk_widget_paintable_set_widget (self, g_value_get_object (value));
       break;
 
+    case PROP_CACHE_TEXTURE:
+      gtk_widget_paintable_set_cache_texture (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -185,6 +264,10 @@ gtk_widget_paintable_get_property (GObject    *object,
       g_value_set_object (value, self->widget);
       break;
 
+    case PROP_CACHE_TEXTURE:
+      g_value_set_boolean (value, self->cache_texture);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -197,11 +280,12 @@ gtk_widget_paintable_unset_widget (GtkWidgetPaintable *self)
   if (self->widget == NULL)
     return;
 
-  self->widget->priv->paintables = g_slist_remove (self->widget->priv->paintables,
-                                                   self);
+  self->widget->priv->extra->paintables = g_slist_remove (self->widget->priv->extra->paintables,
+                                                          self);
 
   self->widget = NULL;
 
+  g_clear_pointer (&self->node, gsk_render_node_unref);
   g_clear_object (&self->pending_image);
   if (self->pending_update_cb)
     {
@@ -226,6 +310,7 @@ gtk_widget_paintable_finalize (GObject *object)
   GtkWidgetPaintable *self = GTK_WIDGET_PAINTABLE (object);
 
   g_object_unref (self->current_image);
+  g_clear_object (&self->texture);
 
   G_OBJECT_CLASS (gtk_widget_paintable_parent_class)->finalize (object);
 }
@@ -252,6 +337,19 @@ gtk_widget_paintable_class_init (GtkWidgetPaintableClass *klass)
                          GTK_TYPE_WIDGET,
                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GtkWidgetPaintable:cache-texture
+   *
+   * Whether to draw a downscaled texture of the widget when drawn at
+   * a smaller size than its intrinsic size.
+   */
+  properties[PROP_CACHE_TEXTURE] =
+    g_param_spec_boolean ("cache-texture",
+                          P_("Cache texture"),
+                          P_("Whether to draw a downscaled texture of the widget"),
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, N_PROPS, properties);
 }
 
@@ -279,21 +377,56 @@ gtk_widget_paintable_new (GtkWidget *widget)
                        NULL);
 }
 
+static void
+gtk_widget_paintable_get_widget_state (GtkWidgetPaintable *self,
+                                       GskRenderNode     **node,
+                                       graphene_rect_t    *bounds,
+                                       double             *opacity)
+{
+  if (self->widget == NULL ||
+      !gtk_widget_compute_bounds (self->widget, self->widget, bounds))
+    {
+      *node = NULL;
+      graphene_rect_init (bounds, 0, 0, 0, 0);
+      *opacity = 1.0;
+      return;
+    }
+
+  *node = self->widget->priv->render_node;
+  *opacity = gtk_widget_get_effective_opacity (self->widget);
+}
+
 static GdkPaintable *
 gtk_widget_paintable_snapshot_widget (GtkWidgetPaintable *self)
 {
+  GskRenderNode *node;
   graphene_rect_t bounds;
+  double opacity;
 
-  if (self->widget == NULL)
-    return gdk_paintable_new_empty (0, 0);
+  gtk_widget_paintable_get_widget_state (self, &node, &bounds, &opacity);
 
-  if (!gtk_widget_compute_bounds (self->widget, self->widget, &bounds))
-    return gdk_paintable_new_empty (0, 0);
+  g_clear_pointer (&self->node, gsk_render_node_unref);
+  if (node)
+    self->node = gsk_render_node_ref (node);
+  self->bounds = bounds;
+  self->opacity = opacity;
 
-  if (self->widget->priv->render_node == NULL)
+  if (node == NULL)
     return gdk_paintable_new_empty (bounds.size.width, bounds.size.height);
-  
-  return gtk_render_node_paintable_new (self->widget->priv->render_node, &bounds);
+
+  if (opacity < 1.0)
+    {
+      GdkPaintable *paintable;
+
+      /* The widget's render node does not include its opacity */
+      node = gsk_opacity_node_new (node, opacity);
+      paintable = gtk_render_node_paintable_new (node, &bounds);
+      gsk_render_node_unref (node);
+
+      return paintable;
+    }
+
+  return gtk_render_node_paintable_new (node, &bounds);
 }
 
 /**
@@ -339,10 +472,15 @@ gtk_widget_paintable_set_widget (GtkWidgetPaintable *self,
   self->widget = widget;
 
   if (widget)
-    widget->priv->paintables = g_slist_prepend (widget->priv->paintables, self);
+    {
+      GtkWidgetExtra *extra = gtk_widget_ensure_extra (widget);
+
+      extra->paintables = g_slist_prepend (extra->paintables, self);
+    }
 
   g_object_unref (self->current_image);
   self->current_image = gtk_widget_paintable_snapshot_widget (self);
+  g_clear_object (&self->texture);
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_WIDGET]);
   gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
@@ -361,6 +499,7 @@ gtk_widget_paintable_update_func (gpointer data)
       self->current_image = self->pending_image;
       self->pending_image = NULL;
       self->pending_update_cb = 0;
+      g_clear_object (&self->texture);
 
       if (gdk_paintable_get_intrinsic_width (self->current_image) != gdk_paintable_get_intrinsic_width (old_image) ||
           gdk_paintable_get_intrinsic_height (self->current_image) != gdk_paintable_get_intrinsic_height (old_image))
@@ -379,10 +518,66 @@ gtk_widget_paintable_update_func (gpointer data)
   return G_SOURCE_REMOVE;
 }
 
+/**
+ * gtk_widget_paintable_get_cache_texture:
+ * @self: a #GtkWidgetPaintable
+ *
+ * Returns whether @self draws a downscaled texture of the widget.
+ *
+ * Returns: %TRUE if a texture is cached
+ **/
+gboolean
+gtk_widget_paintable_get_cache_texture (GtkWidgetPaintable *self)
+{
+  g_return_val_if_fail (GTK_IS_WIDGET_PAINTABLE (self), FALSE);
+
+  return self->cache_texture;
+}
+
+/**
+ * gtk_widget_paintable_set_cache_texture:
+ * @self: a #GtkWidgetPaintable
+ * @cache_texture: whether to cache a texture
+ *
+ * Sets whether @self draws a downscaled texture of the widget when
+ * it is drawn at a smaller size than its intrinsic size.
+ *
+ * The texture is rendered again whenever the widget changes or the
+ * paintable is drawn at a different size, so this is useful for small
+ * previews of large widgets that change rarely.
+ **/
+void
+gtk_widget_paintable_set_cache_texture (GtkWidgetPaintable *self,
+                                        gboolean            cache_texture)
+{
+  g_return_if_fail (GTK_IS_WIDGET_PAINTABLE (self));
+
+  cache_texture = !!cache_texture;
+  if (self->cache_texture == cache_texture)
+    return;
+
+  self->cache_texture = cache_texture;
+  g_clear_object (&self->texture);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_CACHE_TEXTURE]);
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+}
+
 void
 gtk_widget_paintable_update_image (GtkWidgetPaintable *self)
 {
   GdkPaintable *pending_image;
+  GskRenderNode *node;
+  graphene_rect_t bounds;
+  double opacity;
+
+  /* Widgets update their paintables whenever they are snapshotted, but
+   * most of the time they didn't change since the latest image. */
+  gtk_widget_paintable_get_widget_state (self, &node, &bounds, &opacity);
+  if (node == self->node &&
+      opacity == self->opacity &&
+      graphene_rect_equal (&bounds, &self->bounds))
+    return;
 
   if (self->pending_update_cb == 0)
     {
@@ -37,6 +37,11 @@ GtkWidget *     gtk_widget_paintable_get_widget         (GtkWidgetPaintable
 GDK_AVAILABLE_IN_ALL
 void            gtk_widget_paintable_set_widget         (GtkWidgetPaintable     *self,
                                                          GtkWidget              *widget);
+GDK_AVAILABLE_IN_ALL
+gboolean        gtk_widget_paintable_get_cache_texture  (GtkWidgetPaintable     *self);
+GDK_AVAILABLE_IN_ALL
+void            gtk_widget_paintable_set_cache_texture  (GtkWidgetPaintable     *self,
+                                                         gboolean                cache_texture);
 
 G_END_DECLS
 
@@ -32,6 +32,7 @@
 #include "gtkcsstypesprivate.h"
 #include "gtkeventcontrollerprivate.h"
 #include "gtklistlistmodelprivate.h"
+#include "gtkpickindexprivate.h"
 #include "gtkrootprivate.h"
 #include "gtksizerequestcacheprivate.h"
 #include "gtkwindowprivate.h"
@@ -58,6 +59,31 @@ typedef struct _GtkWidgetSurfaceTransformData
   GList *callbacks;
 } GtkWidgetSurfaceTransformData;
 
+/* Only allocated once one of these is set, see gtk_widget_ensure_extra() */
+typedef struct
+{
+  /* The widget's name. If the widget does not have a name
+   * (the name is NULL), then its name (as returned by
+   * "gtk_widget_get_name") is its class's name.
+   * Among other things, the widget name is used to determine
+   * the style to use for a widget.
+   */
+  char *name;
+
+  /* Pointer cursor */
+  GdkCursor *cursor;
+
+  /* Tooltip */
+  char *tooltip_markup;
+  char *tooltip_text;
+
+  GSList *paintables;
+
+  /* only created on-demand */
+  GtkListListModel *children_observer;
+  GtkListListModel *controller_observer;
+} GtkWidgetExtra;
+
 struct _GtkWidgetPrivate
 {
   /* The state of the widget. Needs to be able to hold all GtkStateFlags bits
@@ -89,6 +115,9 @@ struct _GtkWidgetPrivate
 
   /* Queue-draw related flags */
   guint draw_needed           : 1;
+  guint culled                : 1; /* skipped because it was outside of the clip */
+  guint culled_children       : 1; /* render_node misses descendants that were culled */
+  guint has_snapshot_clip     : 1;
   /* Expand-related flags */
   guint need_compute_expand   : 1; /* Need to recompute computed_[hv]_expand */
   guint computed_hexpand      : 1; /* computed results (composite of child flags) */
@@ -115,39 +144,17 @@ struct _GtkWidgetPrivate
   guint8 verifying_invariants_count;
 #endif
 
-  int width_request;
-  int height_request;
-
-  /* Animations and other things to update on clock ticks */
-  guint clock_tick_id;
-  GList *tick_callbacks;
-
-  void (* resize_func) (GtkWidget *);
-  GtkBorder margin;
-
-  /* Surface relative transform updates callbacks */
-  GtkWidgetSurfaceTransformData *surface_transform_data;
-
-  /* The widget's name. If the widget does not have a name
-   * (the name is NULL), then its name (as returned by
-   * "gtk_widget_get_name") is its class's name.
-   * Among other things, the widget name is used to determine
-   * the style to use for a widget.
-   */
-  char *name;
-
-  /* The root this widget belongs to or %NULL if widget is not
-   * rooted or is a #GtkRoot itself.
+  /* Fields used when walking the tree to measure, allocate and
+   * snapshot come first, so that they share as few cache lines as
+   * possible.
    */
-  GtkRoot *root;
 
-  /* The style for the widget. The style contains the
-   * colors the widget should be drawn in for each state
-   * along with graphics contexts used to draw with and
-   * the font to use for text.
-   */
-  GtkCssNode *cssnode;
-  GtkStyleContext *context;
+  /* Widget tree */
+  GtkWidget *parent;
+  GtkWidget *prev_sibling;
+  GtkWidget *next_sibling;
+  GtkWidget *first_child;
+  GtkWidget *last_child;
 
   /* The widget's allocated size */
   GskTransform *allocated_transform;
@@ -160,42 +167,67 @@ struct _GtkWidgetPrivate
   int baseline;
   GskTransform *transform;
 
-  /* The widget's requested sizes */
-  SizeRequestCache requests;
-
   /* The render node we draw or %NULL if not yet created.*/
   GskRenderNode *render_node;
 
+  /* The style for the widget. The style contains the
+   * colors the widget should be drawn in for each state
+   * along with graphics contexts used to draw with and
+   * the font to use for text.
+   */
+  GtkCssNode *cssnode;
+
   /* The layout manager, or %NULL */
   GtkLayoutManager *layout_manager;
 
-  GSList *paintables;
+  /* The widget's requested sizes */
+  SizeRequestCache requests;
 
-  GList *event_controllers;
+  GtkBorder margin;
+  int width_request;
+  int height_request;
 
-  /* Widget tree */
-  GtkWidget *parent;
-  GtkWidget *prev_sibling;
-  GtkWidget *next_sibling;
-  GtkWidget *first_child;
-  GtkWidget *last_child;
+  /* The CSS background and border, and the outline, as drawn for
+   * decoration_style at decoration_width x decoration_height */
+  GskRenderNode *background_node;
+  GskRenderNode *outline_node;
+  GtkCssStyle *decoration_style;
+  int decoration_width;
+  int decoration_height;
+  /* The clip render_node was created with, if culled_children is set */
+  graphene_rect_t snapshot_clip;
 
-  /* only created on-demand */
-  GtkListListModel *children_observer;
-  GtkListListModel *controller_observer;
+  /* The root this widget belongs to or %NULL if widget is not
+   * rooted or is a #GtkRoot itself.
+   */
+  GtkRoot *root;
 
-  GtkWidget *focus_child;
+  GtkStyleContext *context;
 
-  /* Pointer cursor */
-  GdkCursor *cursor;
+  /* Animations and other things to update on clock ticks */
+  GList *tick_link;          /* in the tick scheduler of the frame clock, while mapped */
+  GList *tick_callbacks;
 
-  /* Tooltip */
-  char *tooltip_markup;
-  char *tooltip_text;
+  void (* resize_func) (GtkWidget *);
+
+  /* Surface relative transform updates callbacks */
+  GtkWidgetSurfaceTransformData *surface_transform_data;
+
+  GList *event_controllers;
+  /* Number of controllers that may handle motion events */
+  guint n_motion_controllers;
+
+  /* Spatial index of the children for picking, or %NULL */
+  GtkPickIndex *pick_index;
+
+  GtkWidget *focus_child;
 
   /* Accessibility */
   GtkAccessibleRole accessible_role;
   GtkATContext *at_context;
+
+  /* State most widgets never set, or %NULL */
+  GtkWidgetExtra *extra;
 };
 
 typedef struct
@@ -215,6 +247,8 @@ struct _GtkWidgetClassPrivate
   GtkAccessibleRole accessible_role;
 };
 
+GtkWidgetExtra * gtk_widget_ensure_extra   (GtkWidget *widget);
+
 void          gtk_widget_root               (GtkWidget *widget);
 void          gtk_widget_unroot             (GtkWidget *widget);
 GtkCssNode *  gtk_widget_get_css_node       (GtkWidget *widget);
@@ -298,6 +332,7 @@ gboolean          gtk_widget_query_tooltip                 (GtkWidget  *widget,
 
 void              gtk_widget_snapshot                      (GtkWidget            *widget,
                                                             GtkSnapshot          *snapshot);
+double            gtk_widget_get_effective_opacity         (GtkWidget            *widget);
 void              gtk_widget_adjust_size_request           (GtkWidget      *widget,
                                                             GtkOrientation  orientation,
                                                             int            *minimum_size,
@@ -366,6 +401,10 @@ gboolean gtk_widget_focus_self       (GtkWidget        *widget,
 void    gtk_widget_update_orientation   (GtkWidget      *widget,
                                          GtkOrientation  orientation);
 
+void     gtk_widget_set_pick_index_enabled (GtkWidget *widget,
+                                            gboolean   enabled);
+gboolean gtk_widget_get_pick_index_enabled (GtkWidget *widget);
+
 /* inline getters */
 
 static inline GtkWidget *
@@ -392,6 +431,12 @@ _gtk_widget_get_mapped (GtkWidget *widget)
   return widget->priv->mapped;
 }
 
+static inline gboolean
+_gtk_widget_has_motion_controllers (GtkWidget *widget)
+{
+  return widget->priv->n_motion_controllers > 0;
+}
+
 static inline gboolean
 _gtk_widget_get_realized (GtkWidget *widget)
 {
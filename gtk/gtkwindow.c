@@ -1875,14 +1875,14 @@ gtk_window_native_check_resize (GtkNative *native)
   GtkWidget *widget = GTK_WIDGET (native);
   gint64 before G_GNUC_UNUSED;
 
-  before = GDK_PROFILER_CURRENT_TIME;
+  before = gdk_profiler_trace_begin ();
 
   if (!_gtk_widget_get_alloc_needed (widget))
     gtk_widget_ensure_allocate (widget);
   else if (gtk_widget_get_visible (widget))
     gtk_window_move_resize (GTK_WINDOW (native));
 
-  gdk_profiler_end_mark (before, "size allocation", "");
+  gdk_profiler_trace_end (before, "size allocation");
 }
 
 static void
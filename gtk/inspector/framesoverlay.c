@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2020 GNOME Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "framesoverlay.h"
+
+#include "gtkintl.h"
+#include "gtkwidget.h"
+#include "gtkwindow.h"
+#include "gtknative.h"
+
+#include <string.h>
+
+/* Shows where the time of the last frames went, as a bar per frame,
+ * stacked by frame clock phase.
+ */
+
+#define N_FRAMES 60
+#define BAR_WIDTH 4
+#define GRAPH_HEIGHT 100
+/* The height of the graph, in us */
+#define GRAPH_DURATION (2 * G_USEC_PER_SEC / 60)
+
+enum {
+  SEGMENT_EVENTS,
+  SEGMENT_UPDATE,
+  SEGMENT_LAYOUT,
+  SEGMENT_PAINT,
+  SEGMENT_RENDER,
+  N_SEGMENTS
+};
+
+static const struct {
+  const char *name;
+  GdkRGBA color;
+} segments[N_SEGMENTS] = {
+  { "events", { 0.45, 0.62, 0.81, 1 } },
+  { "update", { 0.68, 0.50, 0.66, 1 } },
+  { "layout", { 0.93, 0.83, 0.00, 1 } },
+  { "snapshot", { 0.45, 0.82, 0.09, 1 } },
+  { "render", { 0.96, 0.47, 0.00, 1 } },
+};
+
+struct _GtkFramesOverlay
+{
+  GtkInspectorOverlay parent_instance;
+};
+
+struct _GtkFramesOverlayClass
+{
+  GtkInspectorOverlayClass parent_class;
+};
+
+G_DEFINE_TYPE (GtkFramesOverlay, gtk_frames_overlay, GTK_TYPE_INSPECTOR_OVERLAY)
+
+static void
+get_segments (GdkFrameTimings *timings,
+              gint64           durations[N_SEGMENTS])
+{
+  gint64 paint, render;
+
+  durations[SEGMENT_EVENTS] = gdk_frame_timings_get_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS);
+  durations[SEGMENT_UPDATE] = gdk_frame_timings_get_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_UPDATE);
+  durations[SEGMENT_LAYOUT] = gdk_frame_timings_get_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_LAYOUT);
+
+  /* Rendering happens during the paint phase */
+  paint = gdk_frame_timings_get_phase_duration (timings, GDK_FRAME_CLOCK_PHASE_PAINT);
+  render = MIN (gdk_frame_timings_get_render_cpu_time (timings), paint);
+  durations[SEGMENT_PAINT] = paint - render;
+  durations[SEGMENT_RENDER] = render;
+}
+
+static gboolean
+gtk_frames_overlay_force_redraw (GtkWidget     *widget,
+                                 GdkFrameClock *clock,
+                                 gpointer       unused)
+{
+  gdk_surface_queue_render (gtk_native_get_surface (gtk_widget_get_native (widget)));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_frames_overlay_snapshot (GtkInspectorOverlay *overlay,
+                             GtkSnapshot         *snapshot,
+                             GskRenderNode       *node,
+                             GtkWidget           *widget)
+{
+  GdkFrameClock *clock;
+  GdkFrameTimings *timings;
+  gint64 durations[N_SEGMENTS];
+  gint64 counter, history_start;
+  gint64 gpu_time = 0;
+  GString *text;
+  PangoLayout *layout;
+  PangoAttrList *attrs;
+  graphene_rect_t bounds;
+  int width, height;
+  int i, s;
+
+  if (!GTK_IS_NATIVE (widget))
+    return;
+
+  clock = gtk_widget_get_frame_clock (widget);
+  if (clock == NULL)
+    return;
+
+  if (!gtk_widget_compute_bounds (widget, widget, &bounds))
+    return;
+
+  /* The current frame is still being painted */
+  counter = gdk_frame_clock_get_frame_counter (clock) - 1;
+  history_start = gdk_frame_clock_get_history_start (clock);
+
+  gtk_snapshot_save (snapshot);
+  gtk_snapshot_translate (snapshot,
+                          &GRAPHENE_POINT_INIT (bounds.origin.x,
+                                                bounds.origin.y + bounds.size.height - GRAPH_HEIGHT));
+
+  gtk_snapshot_append_color (snapshot,
+                             &(GdkRGBA) { 0, 0, 0, 0.5 },
+                             &GRAPHENE_RECT_INIT (0, 0, N_FRAMES * BAR_WIDTH, GRAPH_HEIGHT));
+
+  /* One frame at 60 Hz */
+  gtk_snapshot_append_color (snapshot,
+                             &(GdkRGBA) { 1, 1, 1, 0.5 },
+                             &GRAPHENE_RECT_INIT (0, GRAPH_HEIGHT / 2, N_FRAMES * BAR_WIDTH, 1));
+
+  for (i = 0; i < N_FRAMES && counter - i >= history_start; i++)
+    {
+      float x = (N_FRAMES - 1 - i) * BAR_WIDTH;
+      float y = GRAPH_HEIGHT;
+
+      timings = gdk_frame_clock_get_timings (clock, counter - i);
+      if (timings == NULL)
+        break;
+
+      get_segments (timings, durations);
+
+      for (s = 0; s < N_SEGMENTS && y > 0; s++)
+        {
+          float h = (float) durations[s] * GRAPH_HEIGHT / GRAPH_DURATION;
+
+          h = MIN (h, y);
+          y -= h;
+          gtk_snapshot_append_color (snapshot,
+                                     &segments[s].color,
+                                     &GRAPHENE_RECT_INIT (x, y, BAR_WIDTH - 1, h));
+        }
+    }
+
+  /* Print the numbers for the last frame that has them */
+  text = g_string_new ("");
+  timings = counter >= history_start ? gdk_frame_clock_get_timings (clock, counter) : NULL;
+  if (timings)
+    {
+      get_segments (timings, durations);
+      gpu_time = gdk_frame_timings_get_render_gpu_time (timings);
+    }
+  else
+    memset (durations, 0, sizeof (durations));
+
+  for (s = 0; s < N_SEGMENTS; s++)
+    {
+      char *color = gdk_rgba_to_string (&segments[s].color);
+
+      g_string_append_printf (text, "<span foreground='%s'>■</span> %s %.1f ms\n",
+                              color, segments[s].name, durations[s] / 1000.);
+      g_free (color);
+    }
+  g_string_append_printf (text, "gpu %.1f ms", gpu_time / 1000.);
+
+  layout = gtk_widget_create_pango_layout (widget, NULL);
+  pango_layout_set_markup (layout, text->str, -1);
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_font_features_new ("tnum=1"));
+  pango_layout_set_attributes (layout, attrs);
+  pango_attr_list_unref (attrs);
+  pango_layout_get_pixel_size (layout, &width, &height);
+
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (N_FRAMES * BAR_WIDTH, GRAPH_HEIGHT - height));
+  gtk_snapshot_append_color (snapshot,
+                             &(GdkRGBA) { 0, 0, 0, 0.5 },
+                             &GRAPHENE_RECT_INIT (0, 0, width + 4, height));
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (2, 0));
+  gtk_snapshot_append_layout (snapshot,
+                              layout,
+                              &(GdkRGBA) { 1, 1, 1, 1 });
+  gtk_snapshot_restore (snapshot);
+
+  g_object_unref (layout);
+  g_string_free (text, TRUE);
+
+  gtk_widget_add_tick_callback (widget, gtk_frames_overlay_force_redraw, NULL, NULL);
+}
+
+static void
+gtk_frames_overlay_class_init (GtkFramesOverlayClass *klass)
+{
+  GtkInspectorOverlayClass *overlay_class = GTK_INSPECTOR_OVERLAY_CLASS (klass);
+
+  overlay_class->snapshot = gtk_frames_overlay_snapshot;
+}
+
+static void
+gtk_frames_overlay_init (GtkFramesOverlay *self)
+{
+}
+
+GtkInspectorOverlay *
+gtk_frames_overlay_new (void)
+{
+  return g_object_new (GTK_TYPE_FRAMES_OVERLAY, NULL);
+}
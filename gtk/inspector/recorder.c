@@ -1013,9 +1013,17 @@ render_node_save_response (GtkWidget     *dialog,
 
   if (response == GTK_RESPONSE_ACCEPT)
     {
-      GBytes *bytes = gsk_render_node_serialize (node);
+      GskSerializationFormat format;
+      GBytes *bytes;
       GError *error = NULL;
 
+      if (g_strcmp0 (gtk_file_chooser_get_choice (GTK_FILE_CHOOSER (dialog), "format"), "binary") == 0)
+        format = GSK_SERIALIZATION_FORMAT_BINARY;
+      else
+        format = GSK_SERIALIZATION_FORMAT_TEXT;
+
+      bytes = gsk_render_node_serialize_to_format (node, format);
+
       if (!g_file_replace_contents (gtk_file_chooser_get_file (GTK_FILE_CHOOSER (dialog)),
                                     g_bytes_get_data (bytes, NULL),
                                     g_bytes_get_size (bytes),
@@ -1069,6 +1077,10 @@ render_node_save (GtkButton            *button,
   g_free (nodename);
   gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog), filename);
   g_free (filename);
+  gtk_file_chooser_add_choice (GTK_FILE_CHOOSER (dialog), "format", _("Format"),
+                               (const char *[]) { "text", "binary", NULL },
+                               (const char *[]) { _("Text"), _("Binary"), NULL });
+  gtk_file_chooser_set_choice (GTK_FILE_CHOOSER (dialog), "format", "text");
   gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_ACCEPT);
   gtk_window_set_modal (GTK_WINDOW (dialog), TRUE);
   g_signal_connect (dialog, "response", G_CALLBACK (render_node_save_response), node);
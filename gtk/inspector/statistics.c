@@ -32,6 +32,8 @@
 #include "gtkeventcontrollerkey.h"
 #include "gtkmain.h"
 #include "gtkliststore.h"
+#include "gtkcssnodeprivate.h"
+#include "gtkcssselectorprivate.h"
 
 #include <glib/gi18n-lib.h>
 
@@ -61,6 +63,7 @@ struct _GtkInspectorStatisticsPrivate
   guint update_source_id;
   GtkWidget *search_entry;
   GtkWidget *search_bar;
+  GtkWidget *style_cache_label;
 };
 
 typedef struct {
@@ -132,12 +135,34 @@ add_type_count (GtkInspectorStatistics *sl, GType type)
   return cumulative;
 }
 
+static void
+update_style_cache_statistics (GtkInspectorStatistics *sl)
+{
+  guint hits, misses, shared;
+  guint roots_total, roots_checked, filter_checks, filter_rejections;
+  char *text;
+
+  gtk_css_node_get_style_cache_statistics (&hits, &misses, &shared);
+  gtk_css_selector_tree_get_statistics (&roots_total, &roots_checked,
+                                        &filter_checks, &filter_rejections);
+
+  text = g_strdup_printf (_("Style cache: %u hits, %u misses, %u shared between siblings\n"
+                            "Selectors: %.1f%% skipped by the index, %.1f%% rejected by the bloom filter"),
+                          hits, misses, shared,
+                          roots_total ? 100.0 * (roots_total - roots_checked) / roots_total : 0.0,
+                          filter_checks ? 100.0 * filter_rejections / filter_checks : 0.0);
+  gtk_label_set_text (GTK_LABEL (sl->priv->style_cache_label), text);
+  g_free (text);
+}
+
 static gboolean
 update_type_counts (gpointer data)
 {
   GtkInspectorStatistics *sl = data;
   GType type;
 
+  update_style_cache_statistics (sl);
+
   for (type = G_TYPE_INTERFACE; type <= G_TYPE_FUNDAMENTAL_MAX; type += (1 << G_TYPE_FUNDAMENTAL_SHIFT))
     {
       if (!G_TYPE_IS_INSTANTIATABLE (type))
@@ -392,6 +417,8 @@ constructed (GObject *object)
   g_signal_connect (sl->priv->button, "toggled",
                     G_CALLBACK (toggle_record), sl);
 
+  update_style_cache_statistics (sl);
+
   if (has_instance_counts ())
     update_type_counts (sl);
   else
@@ -489,6 +516,7 @@ gtk_inspector_statistics_class_init (GtkInspectorStatisticsClass *klass)
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, search_entry);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, search_bar);
   gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, excuse);
+  gtk_widget_class_bind_template_child_private (widget_class, GtkInspectorStatistics, style_cache_label);
 
 }
 
@@ -26,6 +26,7 @@
 #include "gtknative.h"
 
 #include "gsk/gskrendernodeprivate.h"
+#include "gdk/gdk-private.h"
 
 /* duration before we start fading in us */
 #define GDK_DRAW_REGION_MIN_DURATION 50 * 1000
@@ -170,9 +171,11 @@ gtk_updates_overlay_snapshot (GtkInspectorOverlay *overlay,
   GtkUpdatesOverlay *self = GTK_UPDATES_OVERLAY (overlay);
   GtkWidgetUpdates *updates;
   GtkUpdate *draw;
+  const cairo_region_t *repainted;
   gint64 now;
   GList *l;
   double native_x, native_y;
+  guint i;
 
   if (!GTK_IS_NATIVE (widget))
     return;
@@ -215,7 +218,6 @@ gtk_updates_overlay_snapshot (GtkInspectorOverlay *overlay,
   for (l = g_queue_peek_head_link (updates->updates); l != NULL; l = l->next)
     {
       double progress;
-      guint i;
 
       draw = l->data;
 
@@ -238,6 +240,33 @@ gtk_updates_overlay_snapshot (GtkInspectorOverlay *overlay,
                                                          rect.width, rect.height));
         }
     }
+
+  /* Outline what the previous frame really repainted. Where that is
+   * more than the updates, the back buffer had to be brought up to
+   * date because its age was unknown or old.
+   */
+  repainted = gdk_surface_get_repaint_region (gtk_native_get_surface (GTK_NATIVE (widget)));
+  if (repainted)
+    {
+      for (i = 0; i < cairo_region_num_rectangles (repainted); i++)
+        {
+          GdkRectangle rect;
+          GskRoundedRect outline;
+
+          cairo_region_get_rectangle (repainted, i, &rect);
+          gsk_rounded_rect_init_from_rect (&outline,
+                                           &GRAPHENE_RECT_INIT(rect.x - native_x, rect.y - native_y,
+                                                               rect.width, rect.height),
+                                           0);
+          gtk_snapshot_append_border (snapshot,
+                                      &outline,
+                                      (float[4]) { 1, 1, 1, 1 },
+                                      (GdkRGBA[4]) {
+                                        { 0, 0, 1, 0.6 }, { 0, 0, 1, 0.6 },
+                                        { 0, 0, 1, 0.6 }, { 0, 0, 1, 0.6 }
+                                      });
+        }
+    }
 }
 
 static void
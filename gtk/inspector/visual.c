@@ -21,6 +21,7 @@
 #include "visual.h"
 
 #include "fpsoverlay.h"
+#include "framesoverlay.h"
 #include "updatesoverlay.h"
 #include "layoutoverlay.h"
 #include "focusoverlay.h"
@@ -82,6 +83,7 @@ struct _GtkInspectorVisual
 
   GtkWidget *debug_box;
   GtkWidget *fps_switch;
+  GtkWidget *frames_switch;
   GtkWidget *updates_switch;
   GtkWidget *fallback_switch;
   GtkWidget *baselines_switch;
@@ -93,6 +95,7 @@ struct _GtkInspectorVisual
   GtkWidget *software_gl_switch;
 
   GtkInspectorOverlay *fps_overlay;
+  GtkInspectorOverlay *frames_overlay;
   GtkInspectorOverlay *updates_overlay;
   GtkInspectorOverlay *layout_overlay;
   GtkInspectorOverlay *focus_overlay;
@@ -281,6 +284,38 @@ fps_activate (GtkSwitch          *sw,
   redraw_everything ();
 }
 
+static void
+frames_activate (GtkSwitch          *sw,
+                 GParamSpec         *pspec,
+                 GtkInspectorVisual *vis)
+{
+  GtkInspectorWindow *iw;
+
+  iw = GTK_INSPECTOR_WINDOW (gtk_widget_get_root (GTK_WIDGET (vis)));
+  if (iw == NULL)
+    return;
+
+  if (gtk_switch_get_active (sw))
+    {
+      if (vis->frames_overlay == NULL)
+        {
+          vis->frames_overlay = gtk_frames_overlay_new ();
+          gtk_inspector_window_add_overlay (iw, vis->frames_overlay);
+          g_object_unref (vis->frames_overlay);
+        }
+    }
+  else
+    {
+      if (vis->frames_overlay != NULL)
+        {
+          gtk_inspector_window_remove_overlay (iw, vis->frames_overlay);
+          vis->frames_overlay = NULL;
+        }
+    }
+
+  redraw_everything ();
+}
+
 static void
 updates_activate (GtkSwitch          *sw,
                   GParamSpec         *pspec,
@@ -970,6 +1005,11 @@ row_activated (GtkListBox         *box,
       GtkSwitch *sw = GTK_SWITCH (vis->fps_switch);
       gtk_switch_set_active (sw, !gtk_switch_get_active (sw));
     }
+  else if (gtk_widget_is_ancestor (vis->frames_switch, GTK_WIDGET (row)))
+    {
+      GtkSwitch *sw = GTK_SWITCH (vis->frames_switch);
+      gtk_switch_set_active (sw, !gtk_switch_get_active (sw));
+    }
   else if (gtk_widget_is_ancestor (vis->updates_switch, GTK_WIDGET (row)))
     {
       GtkSwitch *sw = GTK_SWITCH (vis->updates_switch);
@@ -1091,6 +1131,11 @@ gtk_inspector_visual_dispose (GObject *object)
       gtk_inspector_window_remove_overlay (iw, vis->fps_overlay);
       vis->fps_overlay = NULL;
     }
+  if (vis->frames_overlay)
+    {
+      gtk_inspector_window_remove_overlay (iw, vis->frames_overlay);
+      vis->frames_overlay = NULL;
+    }
   if (vis->focus_overlay)
     {
       gtk_inspector_window_remove_overlay (iw, vis->focus_overlay);
@@ -1133,6 +1178,7 @@ gtk_inspector_visual_class_init (GtkInspectorVisualClass *klass)
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, font_scale_entry);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, font_scale_adjustment);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, fps_switch);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, frames_switch);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, updates_switch);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, fallback_switch);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, baselines_switch);
@@ -1140,6 +1186,7 @@ gtk_inspector_visual_class_init (GtkInspectorVisualClass *klass)
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorVisual, focus_switch);
 
   gtk_widget_class_bind_template_callback (widget_class, fps_activate);
+  gtk_widget_class_bind_template_callback (widget_class, frames_activate);
   gtk_widget_class_bind_template_callback (widget_class, updates_activate);
   gtk_widget_class_bind_template_callback (widget_class, fallback_activate);
   gtk_widget_class_bind_template_callback (widget_class, direction_changed);
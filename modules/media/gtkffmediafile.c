@@ -30,7 +30,14 @@
 #include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 
+/* Number of decoded frames the decoder thread keeps ahead of playback */
+#define GTK_FF_MEDIA_FILE_QUEUE_SIZE 4
+/* How long to wait for the decoder when it hasn't caught up yet */
+#define GTK_FF_MEDIA_FILE_POLL_MSEC 5
+
 typedef struct _GtkVideoFrameFFMpeg GtkVideoFrameFFMpeg;
+typedef struct _GtkFfFramePool GtkFfFramePool;
+typedef struct _GtkFfFrameBuffer GtkFfFrameBuffer;
 
 struct _GtkVideoFrameFFMpeg
 {
@@ -38,6 +45,26 @@ struct _GtkVideoFrameFFMpeg
   gint64 timestamp;
 };
 
+/* The pixel data of frames is recycled once the textures using it are
+ * gone. The pool is shared between the decoder thread, which takes
+ * buffers, and whoever drops the last reference to a texture.
+ */
+struct _GtkFfFramePool
+{
+  grefcount ref_count;
+  GMutex lock;
+  gsize size;
+  GSList *buffers;
+  guint n_buffers;
+};
+
+struct _GtkFfFrameBuffer
+{
+  GtkFfFramePool *pool;
+  guchar *data;
+  gsize size;
+};
+
 struct _GtkFfMediaFile
 {
   GtkMediaFile parent_instance;
@@ -45,18 +72,35 @@ struct _GtkFfMediaFile
   GFile *file;
   GInputStream *input_stream;
 
+  /* owned by the decoder thread while it is running */
   AVFormatContext *format_ctx;
   AVCodecContext *codec_ctx;
   int stream_id;
   struct SwsContext *sws_ctx;
   enum AVPixelFormat sws_pix_fmt;
   GdkMemoryFormat memory_format;
+  GError *read_error;
+
+  GThread *decode_thread;
+  GMutex lock;
+  GCond cond;
+  /* protected by lock */
+  GQueue frames; /* GtkVideoFrameFFMpeg, in presentation order */
+  guint decode_stop : 1;
+  guint decode_done : 1;
+  int decode_errnum;
+
+  GtkFfFramePool *pool;
 
   GtkVideoFrameFFMpeg current_frame;
-  GtkVideoFrameFFMpeg next_frame;
 
-  gint64 start_time; /* monotonic time when we displayed the last frame */
+  gint64 start_time; /* monotonic time of timestamp 0, or 0 to sync to the next frame */
   guint next_frame_cb; /* Source ID of next frame callback */
+
+  GdkSurface *surface;
+  GdkFrameClock *frame_clock;
+  gulong frame_clock_update_id;
+  guint updating : 1;
 };
 
 struct _GtkFfMediaFileClass
@@ -64,6 +108,99 @@ struct _GtkFfMediaFileClass
   GtkMediaFileClass parent_class;
 };
 
+static GtkFfFramePool *
+gtk_ff_frame_pool_new (void)
+{
+  GtkFfFramePool *pool;
+
+  pool = g_new0 (GtkFfFramePool, 1);
+  g_ref_count_init (&pool->ref_count);
+  g_mutex_init (&pool->lock);
+
+  return pool;
+}
+
+static GtkFfFramePool *
+gtk_ff_frame_pool_ref (GtkFfFramePool *pool)
+{
+  g_ref_count_inc (&pool->ref_count);
+
+  return pool;
+}
+
+static void
+gtk_ff_frame_pool_unref (GtkFfFramePool *pool)
+{
+  if (!g_ref_count_dec (&pool->ref_count))
+    return;
+
+  g_slist_free_full (pool->buffers, g_free);
+  g_mutex_clear (&pool->lock);
+  g_free (pool);
+}
+
+static void
+gtk_ff_frame_pool_release (gpointer data)
+{
+  GtkFfFrameBuffer *buffer = data;
+  GtkFfFramePool *pool = buffer->pool;
+
+  g_mutex_lock (&pool->lock);
+  if (buffer->size == pool->size &&
+      pool->n_buffers < GTK_FF_MEDIA_FILE_QUEUE_SIZE + 2)
+    {
+      pool->buffers = g_slist_prepend (pool->buffers, buffer->data);
+      pool->n_buffers++;
+      buffer->data = NULL;
+    }
+  g_mutex_unlock (&pool->lock);
+
+  g_free (buffer->data);
+  g_free (buffer);
+  gtk_ff_frame_pool_unref (pool);
+}
+
+/* Returns bytes of @size that hand their memory back to @pool when
+ * they are freed, or %NULL if we ran out of memory.
+ */
+static GBytes *
+gtk_ff_frame_pool_acquire (GtkFfFramePool *pool,
+                           gsize           size)
+{
+  GtkFfFrameBuffer *buffer;
+  guchar *data = NULL;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->size != size)
+    {
+      g_slist_free_full (pool->buffers, g_free);
+      pool->buffers = NULL;
+      pool->n_buffers = 0;
+      pool->size = size;
+    }
+  if (pool->buffers)
+    {
+      data = pool->buffers->data;
+      pool->buffers = g_slist_delete_link (pool->buffers, pool->buffers);
+      pool->n_buffers--;
+    }
+  g_mutex_unlock (&pool->lock);
+
+  if (data == NULL)
+    {
+      data = g_try_malloc (size);
+      if (data == NULL)
+        return NULL;
+    }
+
+  buffer = g_new (GtkFfFrameBuffer, 1);
+  buffer->pool = gtk_ff_frame_pool_ref (pool);
+  buffer->data = data;
+  buffer->size = size;
+
+  return g_bytes_new_with_free_func (data, size, gtk_ff_frame_pool_release, buffer);
+}
+
 static void
 gtk_video_frame_ffmpeg_init (GtkVideoFrameFFMpeg *frame,
                              GdkTexture          *texture,
@@ -226,6 +363,31 @@ gtk_ff_media_file_set_ffmpeg_error (GtkFfMediaFile *video,
                           s);
 }
 
+/* Reports errors from decoding to the stream. Decoding may happen
+ * in the decoder thread, so errors are only collected there.
+ */
+static void
+gtk_ff_media_file_report_error (GtkFfMediaFile *video,
+                                int             av_errnum)
+{
+  if (video->read_error)
+    {
+      gtk_media_stream_gerror (GTK_MEDIA_STREAM (video), g_steal_pointer (&video->read_error));
+      return;
+    }
+
+  if (av_errnum == AVERROR_EOF)
+    return;
+
+  if (av_errnum == AVERROR (ENOMEM))
+    gtk_media_stream_error (GTK_MEDIA_STREAM (video),
+                            G_IO_ERROR,
+                            G_IO_ERROR_FAILED,
+                            _("Not enough memory"));
+  else
+    gtk_ff_media_file_set_ffmpeg_error (video, av_errnum);
+}
+
 static int
 gtk_ff_media_file_read_packet_cb (void    *data,
                                   uint8_t *buf,
@@ -242,7 +404,11 @@ gtk_ff_media_file_read_packet_cb (void    *data,
                                 &error);
   if (n_read < 0)
     {
-      gtk_media_stream_gerror (GTK_MEDIA_STREAM (video), error);
+      if (video->read_error == NULL)
+        video->read_error = error;
+      else
+        g_error_free (error);
+      n_read = AVERROR (EIO);
     }
   else if (n_read == 0)
     {
@@ -267,62 +433,19 @@ memory_format_from_pix_fmt (enum AVPixelFormat pix_fmt)
     }
 }
 
-static gboolean
-gtk_ff_media_file_decode_frame (GtkFfMediaFile      *video,
-                                GtkVideoFrameFFMpeg *result)
+static int
+gtk_ff_media_file_convert_frame (GtkFfMediaFile      *video,
+                                 AVFrame             *frame,
+                                 GtkVideoFrameFFMpeg *result)
 {
   GdkTexture *texture;
-  AVPacket packet;
-  AVFrame *frame;
-  int errnum;
   GBytes *bytes;
-  guchar *data;
+  gsize stride;
 
-  frame = av_frame_alloc ();
-
-  for (errnum = av_read_frame (video->format_ctx, &packet);
-       errnum >= 0;
-       errnum = av_read_frame (video->format_ctx, &packet))
-    {
-      if (packet.stream_index == video->stream_id)
-        {
-          errnum = avcodec_send_packet (video->codec_ctx, &packet);
-              if (errnum < 0)
-                G_BREAKPOINT();
-          if (errnum >= 0)
-            {
-              errnum = avcodec_receive_frame (video->codec_ctx, frame);
-              if (errnum < 0)
-                G_BREAKPOINT();
-              if (errnum >= 0)
-                {
-                  av_packet_unref (&packet);
-                  break;
-                }
-            }
-        }
-
-      av_packet_unref (&packet);
-    }
-
-  if (errnum < 0)
-    {
-      if (errnum != AVERROR_EOF)
-        gtk_ff_media_file_set_ffmpeg_error (video, errnum);
-      av_frame_free (&frame);
-      return FALSE;
-    }
-
-  data = g_try_malloc0 (video->codec_ctx->width * video->codec_ctx->height * 4);
-  if (data == NULL)
-    {
-      gtk_media_stream_error (GTK_MEDIA_STREAM (video),
-                              G_IO_ERROR,
-                              G_IO_ERROR_FAILED,
-                              _("Not enough memory"));
-      av_frame_free (&frame);
-      return FALSE;
-    }
+  stride = video->codec_ctx->width * 4;
+  bytes = gtk_ff_frame_pool_acquire (video->pool, stride * video->codec_ctx->height);
+  if (bytes == NULL)
+    return AVERROR (ENOMEM);
 
   if (video->sws_ctx == NULL ||
       video->sws_pix_fmt != frame->format)
@@ -356,14 +479,13 @@ gtk_ff_media_file_decode_frame (GtkFfMediaFile      *video,
   sws_scale(video->sws_ctx,
             (const uint8_t * const *) frame->data, frame->linesize,
             0, video->codec_ctx->height,
-            (uint8_t *[1]) { data }, (int[1]) { video->codec_ctx->width * 4 });
+            (uint8_t *[1]) { (uint8_t *) g_bytes_get_data (bytes, NULL) }, (int[1]) { stride });
 
-  bytes = g_bytes_new_take (data, video->codec_ctx->width * video->codec_ctx->height * 4);
   texture = gdk_memory_texture_new (video->codec_ctx->width,
                                     video->codec_ctx->height,
                                     video->memory_format,
                                     bytes,
-                                    video->codec_ctx->width * 4);
+                                    stride);
 
   g_bytes_unref (bytes);
 
@@ -373,9 +495,132 @@ gtk_ff_media_file_decode_frame (GtkFfMediaFile      *video,
                                              video->format_ctx->streams[video->stream_id]->time_base,
                                              (AVRational) { 1, G_USEC_PER_SEC }));
 
+  return 0;
+}
+
+/* Decodes and converts the next frame. This runs in the decoder thread,
+ * or in the main thread while the decoder thread isn't running, so it
+ * must not touch the media stream.
+ *
+ * Returns: 0 on success, or a negative AVERROR
+ */
+static int
+gtk_ff_media_file_decode_frame (GtkFfMediaFile      *video,
+                                GtkVideoFrameFFMpeg *result)
+{
+  AVPacket packet;
+  AVFrame *frame;
+  int errnum;
+
+  frame = av_frame_alloc ();
+  if (frame == NULL)
+    return AVERROR (ENOMEM);
+
+  for (errnum = avcodec_receive_frame (video->codec_ctx, frame);
+       errnum == AVERROR (EAGAIN);
+       errnum = avcodec_receive_frame (video->codec_ctx, frame))
+    {
+      errnum = av_read_frame (video->format_ctx, &packet);
+      if (errnum == AVERROR_EOF)
+        {
+          /* Drain the frames the decoder is still holding on to */
+          errnum = avcodec_send_packet (video->codec_ctx, NULL);
+        }
+      else if (errnum >= 0)
+        {
+          if (packet.stream_index == video->stream_id)
+            errnum = avcodec_send_packet (video->codec_ctx, &packet);
+          av_packet_unref (&packet);
+        }
+
+      if (errnum < 0)
+        break;
+    }
+
+  if (errnum >= 0)
+    errnum = gtk_ff_media_file_convert_frame (video, frame, result);
+
   av_frame_free (&frame);
 
-  return TRUE;
+  return errnum;
+}
+
+static gpointer
+gtk_ff_media_file_decode_thread (gpointer data)
+{
+  GtkFfMediaFile *video = data;
+  GtkVideoFrameFFMpeg frame;
+  int errnum;
+
+  g_mutex_lock (&video->lock);
+
+  while (TRUE)
+    {
+      while (!video->decode_stop &&
+             g_queue_get_length (&video->frames) >= GTK_FF_MEDIA_FILE_QUEUE_SIZE)
+        g_cond_wait (&video->cond, &video->lock);
+
+      if (video->decode_stop)
+        break;
+
+      g_mutex_unlock (&video->lock);
+
+      errnum = gtk_ff_media_file_decode_frame (video, &frame);
+
+      g_mutex_lock (&video->lock);
+
+      if (errnum < 0)
+        {
+          video->decode_errnum = errnum;
+          video->decode_done = TRUE;
+          break;
+        }
+
+      g_queue_push_tail (&video->frames, g_memdup (&frame, sizeof (GtkVideoFrameFFMpeg)));
+    }
+
+  g_mutex_unlock (&video->lock);
+
+  return NULL;
+}
+
+static void
+gtk_ff_media_file_start_decoding (GtkFfMediaFile *video)
+{
+  g_assert (video->decode_thread == NULL);
+
+  video->decode_stop = FALSE;
+  video->decode_done = FALSE;
+  video->decode_errnum = 0;
+  video->decode_thread = g_thread_new ("ffmpeg decoder",
+                                       gtk_ff_media_file_decode_thread,
+                                       video);
+}
+
+/* Joins the decoder thread and drops the frames it queued. Afterwards
+ * the main thread is free to use the ffmpeg contexts.
+ */
+static void
+gtk_ff_media_file_stop_decoding (GtkFfMediaFile *video)
+{
+  GtkVideoFrameFFMpeg *frame;
+
+  if (video->decode_thread == NULL)
+    return;
+
+  g_mutex_lock (&video->lock);
+  video->decode_stop = TRUE;
+  g_cond_signal (&video->cond);
+  g_mutex_unlock (&video->lock);
+
+  g_thread_join (video->decode_thread);
+  video->decode_thread = NULL;
+
+  while ((frame = g_queue_pop_head (&video->frames)))
+    {
+      gtk_video_frame_ffmpeg_clear (frame);
+      g_free (frame);
+    }
 }
 
 static int64_t
@@ -499,14 +744,14 @@ gtk_ff_media_file_open (GtkMediaFile *file)
   errnum = avformat_open_input (&video->format_ctx, NULL, NULL, NULL);
   if (errnum != 0)
     {
-      gtk_ff_media_file_set_ffmpeg_error (video, errnum);
+      gtk_ff_media_file_report_error (video, errnum);
       return;
     }
 
   errnum = avformat_find_stream_info (video->format_ctx, NULL);
   if (errnum < 0)
     {
-      gtk_ff_media_file_set_ffmpeg_error (video, errnum);
+      gtk_ff_media_file_report_error (video, errnum);
       return;
     }
 
@@ -563,9 +808,18 @@ gtk_ff_media_file_open (GtkMediaFile *file)
 
   gdk_paintable_invalidate_size (GDK_PAINTABLE (video));
 
-  if (gtk_ff_media_file_decode_frame (video, &video->current_frame))
+  errnum = gtk_ff_media_file_decode_frame (video, &video->current_frame);
+  if (errnum < 0)
+    {
+      gtk_ff_media_file_report_error (video, errnum);
+      if (gtk_media_stream_get_error (GTK_MEDIA_STREAM (video)))
+        return;
+    }
+  else
     gdk_paintable_invalidate_contents (GDK_PAINTABLE (video));
 
+  gtk_ff_media_file_start_decoding (video);
+
   if (gtk_media_stream_get_playing (GTK_MEDIA_STREAM (video)))
     gtk_ff_media_file_play (GTK_MEDIA_STREAM (video));
 }
@@ -575,37 +829,79 @@ gtk_ff_media_file_close (GtkMediaFile *file)
 {
   GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (file);
 
+  gtk_ff_media_file_stop_decoding (video);
+
   g_clear_object (&video->input_stream);
 
   g_clear_pointer (&video->sws_ctx, sws_freeContext);
   g_clear_pointer (&video->codec_ctx, avcodec_close);
   avformat_close_input (&video->format_ctx);
   video->stream_id = -1;
-  gtk_video_frame_ffmpeg_clear (&video->next_frame);
+  g_clear_error (&video->read_error);
   gtk_video_frame_ffmpeg_clear (&video->current_frame);
 
   gdk_paintable_invalidate_size (GDK_PAINTABLE (video));
   gdk_paintable_invalidate_contents (GDK_PAINTABLE (video));
 }
 
+/* Shows the last queued frame that is due at monotonic time @now,
+ * dropping the ones before it. With @tolerance, frames are shown on
+ * the tick closest to their timestamp instead of the one after it.
+ *
+ * Returns: %FALSE if the decoder has run out of frames
+ */
 static gboolean
-gtk_ff_media_file_next_frame_cb (gpointer data);
-static void
-gtk_ff_media_file_queue_frame (GtkFfMediaFile *video)
+gtk_ff_media_file_present (GtkFfMediaFile *video,
+                           gint64          now,
+                           gint64          tolerance)
 {
-  gint64 time, frame_time;
-  guint delay;
+  GtkVideoFrameFFMpeg *frame, *due = NULL;
+  gboolean done;
 
-  time = g_get_monotonic_time ();
-  frame_time = video->start_time + video->next_frame.timestamp;
-  delay = time > frame_time ? 0 : (frame_time - time) / 1000;
+  g_mutex_lock (&video->lock);
 
-  video->next_frame_cb = g_timeout_add (delay, gtk_ff_media_file_next_frame_cb, video);
+  frame = g_queue_peek_head (&video->frames);
+  if (video->start_time == 0 && frame != NULL)
+    video->start_time = now - frame->timestamp;
+
+  while ((frame = g_queue_peek_head (&video->frames)) &&
+         video->start_time + frame->timestamp <= now + tolerance)
+    {
+      g_queue_pop_head (&video->frames);
+      if (due)
+        {
+          gtk_video_frame_ffmpeg_clear (due);
+          g_free (due);
+        }
+      due = frame;
+    }
+
+  done = video->decode_done && g_queue_is_empty (&video->frames);
+
+  if (due)
+    g_cond_signal (&video->cond);
+
+  g_mutex_unlock (&video->lock);
+
+  if (due)
+    {
+      gtk_video_frame_ffmpeg_clear (&video->current_frame);
+      gtk_video_frame_ffmpeg_move (&video->current_frame, due);
+      g_free (due);
+
+      gtk_media_stream_update (GTK_MEDIA_STREAM (video),
+                               video->current_frame.timestamp);
+      gdk_paintable_invalidate_contents (GDK_PAINTABLE (video));
+    }
+
+  return due != NULL || !done;
 }
 
 static gboolean
 gtk_ff_media_file_restart (GtkFfMediaFile *video)
 {
+  gtk_ff_media_file_stop_decoding (video);
+
   if (av_seek_frame (video->format_ctx,
                      video->stream_id,
                      av_rescale_q (0,
@@ -614,12 +910,64 @@ gtk_ff_media_file_restart (GtkFfMediaFile *video)
                      AVSEEK_FLAG_BACKWARD) < 0)
     return FALSE;
 
-  if (!gtk_ff_media_file_decode_frame (video, &video->next_frame))
-    return FALSE;
+  avcodec_flush_buffers (video->codec_ctx);
+  video->start_time = 0;
+
+  gtk_ff_media_file_start_decoding (video);
 
   return TRUE;
 }
 
+static void
+gtk_ff_media_file_advance (GtkFfMediaFile *video,
+                           gint64          now,
+                           gint64          tolerance)
+{
+  if (gtk_ff_media_file_present (video, now, tolerance))
+    return;
+
+  gtk_ff_media_file_report_error (video, video->decode_errnum);
+  if (gtk_media_stream_get_error (GTK_MEDIA_STREAM (video)))
+    return;
+
+  if (!gtk_media_stream_get_loop (GTK_MEDIA_STREAM (video)) ||
+      !gtk_ff_media_file_restart (video))
+    gtk_media_stream_ended (GTK_MEDIA_STREAM (video));
+}
+
+static gboolean
+gtk_ff_media_file_next_frame_cb (gpointer data);
+static void
+gtk_ff_media_file_queue_frame (GtkFfMediaFile *video)
+{
+  GtkVideoFrameFFMpeg *frame;
+  gint64 time, frame_time;
+  guint delay;
+
+  g_mutex_lock (&video->lock);
+
+  frame = g_queue_peek_head (&video->frames);
+  if (frame == NULL)
+    {
+      /* The decoder hasn't caught up, check back soon */
+      delay = GTK_FF_MEDIA_FILE_POLL_MSEC;
+    }
+  else if (video->start_time == 0)
+    {
+      delay = 0;
+    }
+  else
+    {
+      time = g_get_monotonic_time ();
+      frame_time = video->start_time + frame->timestamp;
+      delay = time > frame_time ? 0 : (frame_time - time) / 1000;
+    }
+
+  g_mutex_unlock (&video->lock);
+
+  video->next_frame_cb = g_timeout_add (delay, gtk_ff_media_file_next_frame_cb, video);
+}
+
 static gboolean
 gtk_ff_media_file_next_frame_cb (gpointer data)
 {
@@ -627,38 +975,106 @@ gtk_ff_media_file_next_frame_cb (gpointer data)
 
   video->next_frame_cb = 0;
 
-  if (gtk_video_frame_ffmpeg_is_empty (&video->next_frame))
+  gtk_ff_media_file_advance (video, g_get_monotonic_time (), 0);
+
+  if (gtk_media_stream_get_playing (GTK_MEDIA_STREAM (video)))
+    gtk_ff_media_file_queue_frame (video);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_ff_media_file_frame_clock_update (GdkFrameClock  *frame_clock,
+                                      GtkFfMediaFile *video)
+{
+  gint64 frame_time, refresh_interval, presentation_time;
+
+  if (!video->updating)
+    return;
+
+  frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+  gdk_frame_clock_get_refresh_info (frame_clock,
+                                    frame_time,
+                                    &refresh_interval,
+                                    &presentation_time);
+  if (refresh_interval == 0)
+    refresh_interval = G_USEC_PER_SEC / 60;
+
+  gtk_ff_media_file_advance (video, frame_time, refresh_interval / 2);
+}
+
+/* Frames are shown in sync with the frame clock of the surface we are
+ * realized on. Without one, we fall back to timeouts.
+ */
+static void
+gtk_ff_media_file_start_presenting (GtkFfMediaFile *video)
+{
+  if (video->frame_clock)
     {
-      if (!gtk_media_stream_get_loop (GTK_MEDIA_STREAM (video)) ||
-          !gtk_ff_media_file_restart (video))
+      if (!video->updating)
         {
-          gtk_media_stream_ended (GTK_MEDIA_STREAM (video));
-          return G_SOURCE_REMOVE;
+          video->updating = TRUE;
+          gdk_frame_clock_begin_updating (video->frame_clock);
         }
+    }
+  else if (video->next_frame_cb == 0)
+    {
+      gtk_ff_media_file_queue_frame (video);
+    }
+}
 
-      video->start_time += video->current_frame.timestamp - video->next_frame.timestamp;
+static void
+gtk_ff_media_file_stop_presenting (GtkFfMediaFile *video)
+{
+  if (video->next_frame_cb)
+    {
+      g_source_remove (video->next_frame_cb);
+      video->next_frame_cb = 0;
     }
 
-  gtk_video_frame_ffmpeg_clear (&video->current_frame);
-  gtk_video_frame_ffmpeg_move (&video->current_frame,
-                               &video->next_frame);
+  if (video->updating)
+    {
+      video->updating = FALSE;
+      gdk_frame_clock_end_updating (video->frame_clock);
+    }
+}
 
-  gtk_media_stream_update (GTK_MEDIA_STREAM (video),
-                           video->current_frame.timestamp);
-  gdk_paintable_invalidate_contents (GDK_PAINTABLE (video));
+static void
+gtk_ff_media_file_set_surface (GtkFfMediaFile *video,
+                               GdkSurface     *surface)
+{
+  gboolean presenting;
 
-  /* ignore failure here, we'll handle the empty frame case above
-   * the next time we're called. */
-  gtk_ff_media_file_decode_frame (video, &video->next_frame);
-  gtk_ff_media_file_queue_frame (video);
+  presenting = video->next_frame_cb != 0 || video->updating;
+  if (presenting)
+    gtk_ff_media_file_stop_presenting (video);
 
-  return G_SOURCE_REMOVE;
+  if (video->frame_clock)
+    {
+      g_signal_handler_disconnect (video->frame_clock, video->frame_clock_update_id);
+      video->frame_clock_update_id = 0;
+      g_clear_object (&video->frame_clock);
+    }
+  g_clear_object (&video->surface);
+
+  if (surface)
+    {
+      video->surface = g_object_ref (surface);
+      video->frame_clock = g_object_ref (gdk_surface_get_frame_clock (surface));
+      video->frame_clock_update_id = g_signal_connect (video->frame_clock, "update",
+                                                       G_CALLBACK (gtk_ff_media_file_frame_clock_update),
+                                                       video);
+    }
+
+  if (presenting)
+    gtk_ff_media_file_start_presenting (video);
 }
 
 static gboolean
 gtk_ff_media_file_play (GtkMediaStream *stream)
 {
   GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (stream);
+  gboolean done;
 
   if (video->format_ctx == NULL)
     return FALSE;
@@ -666,24 +1082,25 @@ gtk_ff_media_file_play (GtkMediaStream *stream)
   if (!gtk_media_stream_is_prepared (stream))
     return TRUE;
 
-  if (gtk_video_frame_ffmpeg_is_empty (&video->next_frame) &&
-      !gtk_ff_media_file_decode_frame (video, &video->next_frame))
+  g_mutex_lock (&video->lock);
+  done = video->decode_done && g_queue_is_empty (&video->frames);
+  g_mutex_unlock (&video->lock);
+
+  if (done)
     {
-      if (gtk_ff_media_file_restart (video))
-        {
-          video->start_time = g_get_monotonic_time () - video->next_frame.timestamp;
-        }
-      else
-        {
-          return FALSE;
-        }
+      if (!gtk_ff_media_file_restart (video))
+        return FALSE;
     }
-  else
+  else if (!gtk_video_frame_ffmpeg_is_empty (&video->current_frame))
     {
       video->start_time = g_get_monotonic_time () - video->current_frame.timestamp;
     }
+  else
+    {
+      video->start_time = 0;
+    }
 
-  gtk_ff_media_file_queue_frame (video);
+  gtk_ff_media_file_start_presenting (video);
 
   return TRUE;
 }
@@ -693,11 +1110,7 @@ gtk_ff_media_file_pause (GtkMediaStream *stream)
 {
   GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (stream);
 
-  if (video->next_frame_cb)
-    {
-      g_source_remove (video->next_frame_cb);
-      video->next_frame_cb = 0;
-    }
+  gtk_ff_media_file_stop_presenting (video);
 
   video->start_time = 0;
 }
@@ -709,6 +1122,8 @@ gtk_ff_media_file_seek (GtkMediaStream *stream,
   GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (stream);
   int errnum;
 
+  gtk_ff_media_file_stop_decoding (video);
+
   errnum = av_seek_frame (video->format_ctx,
                           video->stream_id,
                           av_rescale_q (timestamp,
@@ -717,18 +1132,30 @@ gtk_ff_media_file_seek (GtkMediaStream *stream,
                                         AVSEEK_FLAG_BACKWARD);
   if (errnum < 0)
     {
+      gtk_ff_media_file_start_decoding (video);
       gtk_media_stream_seek_failed (stream);
       return;
     }
 
+  avcodec_flush_buffers (video->codec_ctx);
+
   gtk_media_stream_seek_success (stream);
 
-  gtk_video_frame_ffmpeg_clear (&video->next_frame);
   gtk_video_frame_ffmpeg_clear (&video->current_frame);
-  if (gtk_ff_media_file_decode_frame (video, &video->current_frame))
+  errnum = gtk_ff_media_file_decode_frame (video, &video->current_frame);
+  if (errnum >= 0)
     gtk_media_stream_update (stream, video->current_frame.timestamp);
   gdk_paintable_invalidate_contents (GDK_PAINTABLE (video));
 
+  gtk_ff_media_file_start_decoding (video);
+
+  if (errnum < 0)
+    {
+      gtk_ff_media_file_report_error (video, errnum);
+      if (gtk_media_stream_get_error (stream))
+        return;
+    }
+
   if (gtk_media_stream_get_playing (stream))
     {
       gtk_ff_media_file_pause (stream);
@@ -737,17 +1164,55 @@ gtk_ff_media_file_seek (GtkMediaStream *stream,
     }
 }
 
+static void
+gtk_ff_media_file_realize (GtkMediaStream *stream,
+                           GdkSurface     *surface)
+{
+  GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (stream);
+
+  /* One frame clock is enough to pace playback */
+  if (video->surface)
+    return;
+
+  gtk_ff_media_file_set_surface (video, surface);
+}
+
+static void
+gtk_ff_media_file_unrealize (GtkMediaStream *stream,
+                             GdkSurface     *surface)
+{
+  GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (stream);
+
+  if (video->surface != surface)
+    return;
+
+  gtk_ff_media_file_set_surface (video, NULL);
+}
+
 static void
 gtk_ff_media_file_dispose (GObject *object)
 {
   GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (object);
 
   gtk_ff_media_file_pause (GTK_MEDIA_STREAM (video));
+  gtk_ff_media_file_set_surface (video, NULL);
   gtk_ff_media_file_close (GTK_MEDIA_FILE (video));
 
   G_OBJECT_CLASS (gtk_ff_media_file_parent_class)->dispose (object);
 }
 
+static void
+gtk_ff_media_file_finalize (GObject *object)
+{
+  GtkFfMediaFile *video = GTK_FF_MEDIA_FILE (object);
+
+  gtk_ff_frame_pool_unref (video->pool);
+  g_cond_clear (&video->cond);
+  g_mutex_clear (&video->lock);
+
+  G_OBJECT_CLASS (gtk_ff_media_file_parent_class)->finalize (object);
+}
+
 static void
 gtk_ff_media_file_class_init (GtkFfMediaFileClass *klass)
 {
@@ -760,14 +1225,19 @@ gtk_ff_media_file_class_init (GtkFfMediaFileClass *klass)
   stream_class->play = gtk_ff_media_file_play;
   stream_class->pause = gtk_ff_media_file_pause;
   stream_class->seek = gtk_ff_media_file_seek;
+  stream_class->realize = gtk_ff_media_file_realize;
+  stream_class->unrealize = gtk_ff_media_file_unrealize;
 
   gobject_class->dispose = gtk_ff_media_file_dispose;
+  gobject_class->finalize = gtk_ff_media_file_finalize;
 }
 
 static void
 gtk_ff_media_file_init (GtkFfMediaFile *video)
 {
   video->stream_id = -1;
+  video->pool = gtk_ff_frame_pool_new ();
+  g_mutex_init (&video->lock);
+  g_cond_init (&video->cond);
+  g_queue_init (&video->frames);
 }
-
-
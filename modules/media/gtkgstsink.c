@@ -25,6 +25,10 @@
 #include "gtkgstpaintableprivate.h"
 #include "gtkintl.h"
 
+#include "gdk/gdkdmabuftextureprivate.h"
+
+#include <gst/allocators/gstdmabuf.h>
+
 enum {
   PROP_0,
   PROP_PAINTABLE,
@@ -36,12 +40,16 @@ GST_DEBUG_CATEGORY (gtk_debug_gst_sink);
 #define GST_CAT_DEFAULT gtk_debug_gst_sink
 
 #define FORMATS "{ BGRA, ARGB, RGBA, ABGR, RGB, BGR }"
+/* The formats that GdkDmabufTexture supports */
+#define DMABUF_FORMATS "{ BGRA, BGRx }"
 
+/* dma-bufs are preferred, their frames never get copied */
 static GstStaticPadTemplate gtk_gst_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (FORMATS))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE_WITH_FEATURES (GST_CAPS_FEATURE_MEMORY_DMABUF, DMABUF_FORMATS) "; "
+                     GST_VIDEO_CAPS_MAKE (FORMATS))
     );
 
 G_DEFINE_TYPE_WITH_CODE (GtkGstSink, gtk_gst_sink,
@@ -85,6 +93,20 @@ gtk_gst_sink_set_caps (GstBaseSink * bsink, GstCaps * caps)
   if (!gst_video_info_from_caps (&self->v_info, caps))
     return FALSE;
 
+  self->uses_dmabuf = gst_caps_features_contains (gst_caps_get_features (caps, 0),
+                                                  GST_CAPS_FEATURE_MEMORY_DMABUF);
+
+  return TRUE;
+}
+
+static gboolean
+gtk_gst_sink_propose_allocation (GstBaseSink *bsink,
+                                 GstQuery    *query)
+{
+  /* With video meta, upstream can hand us its buffers with any
+   * stride and offset, instead of copying them to fit ours */
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
   return TRUE;
 }
 
@@ -111,6 +133,65 @@ gtk_gst_memory_format_from_video (GstVideoFormat format)
   }
 }
 
+/*
+ * The texture keeps a reference to the buffer, so its dma-buf stays
+ * valid and unmodified while it is being drawn. The buffer only goes
+ * back to upstream's pool when the renderers are done with the
+ * texture.
+ */
+static GdkTexture *
+gtk_gst_sink_texture_from_dmabuf (GtkGstSink *self,
+                                  GstBuffer  *buffer)
+{
+  GstVideoMeta *meta;
+  GstMemory *mem;
+  guint32 fourcc;
+  gsize offset;
+  int stride;
+
+  if (gst_buffer_n_memory (buffer) != 1)
+    return NULL;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_is_dmabuf_memory (mem))
+    return NULL;
+
+  switch ((guint) GST_VIDEO_INFO_FORMAT (&self->v_info))
+    {
+    case GST_VIDEO_FORMAT_BGRA:
+      fourcc = GDK_DRM_FORMAT_ARGB8888;
+      break;
+    case GST_VIDEO_FORMAT_BGRx:
+      fourcc = GDK_DRM_FORMAT_XRGB8888;
+      break;
+    default:
+      return NULL;
+    }
+
+  meta = gst_buffer_get_video_meta (buffer);
+  if (meta)
+    {
+      offset = meta->offset[0];
+      stride = meta->stride[0];
+    }
+  else
+    {
+      offset = GST_VIDEO_INFO_PLANE_OFFSET (&self->v_info, 0);
+      stride = GST_VIDEO_INFO_PLANE_STRIDE (&self->v_info, 0);
+    }
+
+  /* DMABuf caps don't negotiate modifiers, those buffers are linear */
+  return gdk_dmabuf_texture_new (GST_VIDEO_INFO_WIDTH (&self->v_info),
+                                 GST_VIDEO_INFO_HEIGHT (&self->v_info),
+                                 fourcc,
+                                 GDK_DRM_FORMAT_MOD_LINEAR,
+                                 gst_dmabuf_memory_get_fd (mem),
+                                 mem->offset + offset,
+                                 stride,
+                                 (GDestroyNotify) gst_buffer_unref,
+                                 gst_buffer_ref (buffer));
+}
+
 static GdkTexture *
 gtk_gst_sink_texture_from_buffer (GtkGstSink *self,
                                   GstBuffer  *buffer)
@@ -119,11 +200,14 @@ gtk_gst_sink_texture_from_buffer (GtkGstSink *self,
   GdkTexture *texture;
   GBytes *bytes;
 
+  if (self->uses_dmabuf)
+    return gtk_gst_sink_texture_from_dmabuf (self, buffer);
+
   if (!gst_video_frame_map (&frame, &self->v_info, buffer, GST_MAP_READ))
     return NULL;
 
   bytes = g_bytes_new_with_free_func (frame.data[0],
-                                      frame.info.width * frame.info.stride[0],
+                                      frame.info.height * frame.info.stride[0],
                                       (GDestroyNotify) gst_buffer_unref,
                                       gst_buffer_ref (buffer));
   texture = gdk_memory_texture_new (frame.info.width,
@@ -228,6 +312,7 @@ gtk_gst_sink_class_init (GtkGstSinkClass * klass)
 
   gstbasesink_class->set_caps = gtk_gst_sink_set_caps;
   gstbasesink_class->get_times = gtk_gst_sink_get_times;
+  gstbasesink_class->propose_allocation = gtk_gst_sink_propose_allocation;
 
   gstvideosink_class->show_frame = gtk_gst_sink_show_frame;
 
@@ -46,6 +46,7 @@ struct _GtkGstSink
   GstVideoSink         parent;
 
   GstVideoInfo         v_info;
+  gboolean             uses_dmabuf;
   GtkGstPaintable *    paintable;
 };
 
@@ -16,24 +16,23 @@ init_surface (cairo_t *cr)
   cairo_fill (cr);
 }
 
-int
-main (int argc, char **argv)
+static void
+run_benchmark (int size)
 {
   cairo_surface_t *surface;
   cairo_t *cr;
   GTimer *timer;
   double msec;
   int i, j;
-  int size;
 
   timer = g_timer_new ();
 
-  size = 2000;
-
   surface = cairo_image_surface_create (CAIRO_FORMAT_A8, size, size);
 
   cr = cairo_create (surface);
 
+  g_print ("%d x %d:\n", size, size);
+
   /* We do everything three times, first two as warmup */
   for (j = 0; j < 2; j++)
     {
@@ -48,7 +47,19 @@ main (int argc, char **argv)
 	}
     }
 
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
   g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  /* A typical large shadow, which is blurred on one thread,
+   * and a big surface, which gets split across threads.
+   */
+  run_benchmark (200);
+  run_benchmark (2000);
 
   return 0;
 }
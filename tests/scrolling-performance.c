@@ -90,6 +90,14 @@ static GOptionEntry options[] = {
   { NULL }
 };
 
+static gboolean
+auto_quit_cb (gpointer data)
+{
+  gtk_window_destroy (GTK_WINDOW (data));
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 quit_cb (GtkWidget *widget,
          gpointer   data)
@@ -154,6 +162,10 @@ main (int argc, char **argv)
   g_signal_connect (window, "destroy",
                     G_CALLBACK (quit_cb), &done);
 
+  /* Scroll for a while, for test-performance */
+  if (g_getenv ("GTK_DEBUG_AUTO_QUIT"))
+    g_timeout_add_seconds (5, auto_quit_cb, window);
+
   while (!done)
     g_main_context_iteration (NULL, TRUE);
 
@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <gtk/gtk.h>
+
+/* Times the phases of the CSS machinery on a large widget tree:
+ *
+ *  - parsing the Adwaita and HighContrast themes
+ *  - styling a freshly created tree, which includes selector matching
+ *  - restyling after :hover changes on every button
+ *  - restyling after the window goes :backdrop
+ *  - switching the theme from Adwaita to HighContrast
+ *
+ * Styles are computed on demand, so every phase ends with a walk over
+ * the tree that looks up the color of each widget. The walk itself is
+ * cheap once all styles are valid.
+ */
+
+static int arg_runs = 10;
+static int arg_rows = 10000;
+static char *arg_output = NULL;
+
+static const GOptionEntry options[] = {
+  { "runs", 0, 0, G_OPTION_ARG_INT, &arg_runs,
+    "Number of measured runs per phase", "N" },
+  { "rows", 0, 0, G_OPTION_ARG_INT, &arg_rows,
+    "Number of rows in the widget tree", "N" },
+  { "output", 0, 0, G_OPTION_ARG_FILENAME, &arg_output,
+    "Write results as JSON to FILE", "FILE" },
+  { NULL }
+};
+
+typedef struct
+{
+  gint64 min;
+  gint64 max;
+  gint64 median;
+  double mean;
+} Stats;
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 ta = *(const gint64 *) a;
+  gint64 tb = *(const gint64 *) b;
+
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static void
+compute_stats (gint64 *times,
+               int     n_times,
+               Stats  *stats)
+{
+  gint64 sum = 0;
+  int i;
+
+  qsort (times, n_times, sizeof (gint64), compare_times);
+
+  for (i = 0; i < n_times; i++)
+    sum += times[i];
+
+  stats->min = times[0];
+  stats->max = times[n_times - 1];
+  stats->median = times[n_times / 2];
+  stats->mean = (double) sum / n_times;
+}
+
+static void
+report (GString    *json,
+        const char *phase,
+        gint64     *times)
+{
+  Stats stats;
+
+  compute_stats (times, arg_runs, &stats);
+
+  g_print ("%-24s %10.1f µs (median %" G_GINT64_FORMAT ", min %" G_GINT64_FORMAT ", max %" G_GINT64_FORMAT ")\n",
+           phase, stats.mean, stats.median, stats.min, stats.max);
+
+  if (json->len > 0)
+    g_string_append (json, ",\n");
+  g_string_append_printf (json,
+                          "    \"%s\": { \"min\": %" G_GINT64_FORMAT
+                          ", \"median\": %" G_GINT64_FORMAT
+                          ", \"mean\": %.1f, \"max\": %" G_GINT64_FORMAT " }",
+                          phase, stats.min, stats.median, stats.mean, stats.max);
+}
+
+static void
+ensure_styles (GtkWidget *widget)
+{
+  GtkWidget *child;
+  GdkRGBA color;
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget), &color);
+
+  for (child = gtk_widget_get_first_child (widget);
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
+    ensure_styles (child);
+}
+
+static GtkWidget *
+create_window (GPtrArray *buttons)
+{
+  GtkWidget *window, *list;
+  int i;
+
+  window = gtk_window_new ();
+  list = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_widget_add_css_class (list, "view");
+  gtk_window_set_child (GTK_WINDOW (window), list);
+
+  for (i = 0; i < arg_rows; i++)
+    {
+      GtkWidget *row, *label, *button;
+      char *text;
+
+      row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+      gtk_widget_add_css_class (row, "row");
+      if (i % 2)
+        gtk_widget_add_css_class (row, "odd");
+
+      text = g_strdup_printf ("Row %d", i);
+      label = gtk_label_new (text);
+      g_free (text);
+      gtk_widget_set_hexpand (label, TRUE);
+      gtk_box_append (GTK_BOX (row), label);
+
+      button = gtk_button_new_with_label ("Remove");
+      if (i % 3 == 0)
+        gtk_widget_add_css_class (button, "destructive-action");
+      gtk_box_append (GTK_BOX (row), button);
+      g_ptr_array_add (buttons, button);
+
+      gtk_box_append (GTK_BOX (list), row);
+    }
+
+  return window;
+}
+
+static void
+set_theme (const char *name)
+{
+  g_object_set (gtk_settings_get_default (), "gtk-theme-name", name, NULL);
+}
+
+static void
+benchmark_parse (GString    *json,
+                 const char *theme)
+{
+  gint64 *times;
+  char *phase;
+  int i;
+
+  times = g_new (gint64, arg_runs);
+
+  for (i = 0; i < arg_runs; i++)
+    {
+      GtkCssProvider *provider = gtk_css_provider_new ();
+      gint64 start;
+
+      start = g_get_monotonic_time ();
+      gtk_css_provider_load_named (provider, theme, NULL);
+      times[i] = g_get_monotonic_time () - start;
+
+      g_object_unref (provider);
+    }
+
+  phase = g_strdup_printf ("parse %s", theme);
+  report (json, phase, times);
+  g_free (phase);
+  g_free (times);
+}
+
+static void
+benchmark_tree (GString *json)
+{
+  gint64 *style_times, *hover_times, *backdrop_times, *theme_times;
+  int i;
+
+  style_times = g_new (gint64, arg_runs);
+  hover_times = g_new (gint64, arg_runs);
+  backdrop_times = g_new (gint64, arg_runs);
+  theme_times = g_new (gint64, arg_runs);
+
+  for (i = 0; i < arg_runs; i++)
+    {
+      GPtrArray *buttons;
+      GtkWidget *window;
+      gint64 start;
+      guint j;
+
+      buttons = g_ptr_array_new ();
+      window = create_window (buttons);
+
+      start = g_get_monotonic_time ();
+      ensure_styles (window);
+      style_times[i] = g_get_monotonic_time () - start;
+
+      start = g_get_monotonic_time ();
+      for (j = 0; j < buttons->len; j++)
+        gtk_widget_set_state_flags (g_ptr_array_index (buttons, j), GTK_STATE_FLAG_PRELIGHT, FALSE);
+      ensure_styles (window);
+      hover_times[i] = g_get_monotonic_time () - start;
+
+      for (j = 0; j < buttons->len; j++)
+        gtk_widget_unset_state_flags (g_ptr_array_index (buttons, j), GTK_STATE_FLAG_PRELIGHT);
+      ensure_styles (window);
+
+      start = g_get_monotonic_time ();
+      gtk_widget_set_state_flags (window, GTK_STATE_FLAG_BACKDROP, FALSE);
+      ensure_styles (window);
+      backdrop_times[i] = g_get_monotonic_time () - start;
+
+      gtk_widget_unset_state_flags (window, GTK_STATE_FLAG_BACKDROP);
+      ensure_styles (window);
+
+      start = g_get_monotonic_time ();
+      set_theme ("HighContrast");
+      ensure_styles (window);
+      theme_times[i] = g_get_monotonic_time () - start;
+
+      set_theme ("Adwaita");
+      ensure_styles (window);
+
+      gtk_window_destroy (GTK_WINDOW (window));
+      g_ptr_array_unref (buttons);
+    }
+
+  report (json, "style", style_times);
+  report (json, "restyle hover", hover_times);
+  report (json, "restyle backdrop", backdrop_times);
+  report (json, "switch theme", theme_times);
+
+  g_free (style_times);
+  g_free (hover_times);
+  g_free (backdrop_times);
+  g_free (theme_times);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GString *results;
+  gboolean success = TRUE;
+
+  context = g_option_context_new ("- benchmark the CSS machinery");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  else if (argc > 1 || arg_runs < 1 || arg_rows < 1)
+    {
+      char *help = g_option_context_get_help (context, TRUE, NULL);
+      g_print ("%s", help);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  /* We switch themes ourselves */
+  g_unsetenv ("GTK_THEME");
+
+  gtk_init ();
+
+  set_theme ("Adwaita");
+
+  results = g_string_new (NULL);
+
+  benchmark_parse (results, "Adwaita");
+  benchmark_parse (results, "HighContrast");
+  benchmark_tree (results);
+
+  if (arg_output)
+    {
+      char *json;
+
+      json = g_strdup_printf ("{\n  \"rows\": %d,\n  \"runs\": %d,\n  \"results\": {\n%s\n  }\n}\n",
+                              arg_rows, arg_runs, results->str);
+
+      if (!g_file_set_contents (arg_output, json, -1, &error))
+        {
+          g_printerr ("Could not write results: %s\n", error->message);
+          g_clear_error (&error);
+          success = FALSE;
+        }
+
+      g_free (json);
+    }
+
+  g_string_free (results, TRUE);
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../gtk/css/gtkcsstokenizerprivate.h"
+
+#include <locale.h>
+#include <string.h>
+
+typedef struct _Test Test;
+
+struct _Test
+{
+  const char *name;
+  const char *css;
+};
+
+Test tests[] = {
+  { "empty", "" },
+  { "selectors",
+    "window > box.horizontal:not(:first-child) ~ label#title,\n"
+    "button:hover:backdrop { color: red; }\n" },
+  { "numbers",
+    "a { margin: -1px +2.5em 0 .5%; opacity: 1e3; x: 12e-2px 7; }" },
+  { "strings",
+    "@import url(\"foo.css\");\n"
+    "@import url(bar.css);\n"
+    "a { font-family: \"Cantarell\", 'Sans \\\"x\\\"'; }\n" },
+  { "escapes",
+    ".\\31 23 { content: \"\\2764\"; }" },
+  { "unicode",
+    "/* äöü */\r\n.grüße\t{ content: \"Руслан\"; }\r\n" },
+  { "matches",
+    "[a~=b] [a|=b] [a^=b] [a$=b] [a*=b] a||b <!-- -->" },
+  { "functions",
+    "a { background: linear-gradient(to top, alpha(@bg, 0.5), shade(#fff, 1.2)); }" },
+  { "runs",
+    "/* A long comment, with * stars ** and\nnon-ASCII äöü text */\r\n"
+    "\t  .some-long-name-1 { content: \"a long string with \\\"escapes\\\" and ü in it\"; }\n"
+    "\n    \\2e name" },
+};
+
+static GPtrArray *
+tokenize (GBytes *bytes)
+{
+  GtkCssTokenizer *tokenizer;
+  GPtrArray *result;
+  GtkCssToken token;
+  GError *error = NULL;
+
+  tokenizer = gtk_css_tokenizer_new (bytes);
+  result = g_ptr_array_new_with_free_func (g_free);
+
+  while (TRUE)
+    {
+      const GtkCssLocation *location;
+      char *string;
+
+      if (!gtk_css_tokenizer_read_token (tokenizer, &token, &error))
+        g_error ("%s", error->message);
+
+      if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+        break;
+
+      location = gtk_css_tokenizer_get_location (tokenizer);
+      string = gtk_css_token_to_string (&token);
+      g_ptr_array_add (result,
+                       g_strdup_printf ("%u %s %" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT
+                                        ":%" G_GSIZE_FORMAT ":%" G_GSIZE_FORMAT
+                                        ":%" G_GSIZE_FORMAT,
+                                        token.type, string,
+                                        location->bytes, location->chars,
+                                        location->lines, location->line_bytes,
+                                        location->line_chars));
+      g_free (string);
+      gtk_css_token_clear (&token);
+    }
+
+  gtk_css_tokenizer_unref (tokenizer);
+
+  return result;
+}
+
+static void
+test_precompile (gconstpointer data)
+{
+  const Test *test = data;
+  GError *error = NULL;
+  GBytes *bytes, *precompiled, *again;
+  GPtrArray *expected, *replayed;
+  guint i;
+
+  bytes = g_bytes_new_static (test->css, strlen (test->css));
+  g_assert_false (gtk_css_tokenizer_is_precompiled (bytes));
+
+  precompiled = gtk_css_tokenizer_precompile (bytes, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (precompiled);
+  g_assert_true (gtk_css_tokenizer_is_precompiled (precompiled));
+
+  again = gtk_css_tokenizer_precompile (precompiled, &error);
+  g_assert_no_error (error);
+  g_assert_true (again == precompiled);
+  g_bytes_unref (again);
+
+  expected = tokenize (bytes);
+  replayed = tokenize (precompiled);
+
+  g_assert_cmpuint (replayed->len, ==, expected->len);
+  for (i = 0; i < expected->len; i++)
+    g_assert_cmpstr (g_ptr_array_index (replayed, i), ==, g_ptr_array_index (expected, i));
+
+  g_ptr_array_unref (expected);
+  g_ptr_array_unref (replayed);
+  g_bytes_unref (precompiled);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_truncated (gconstpointer data)
+{
+  const Test *test = data;
+  GBytes *bytes, *precompiled;
+  gsize i;
+
+  bytes = g_bytes_new_static (test->css, strlen (test->css));
+  precompiled = gtk_css_tokenizer_precompile (bytes, NULL);
+
+  /* Every prefix of the data must end in an EOF token without
+   * reading beyond the end.
+   */
+  for (i = 4; i < g_bytes_get_size (precompiled); i++)
+    {
+      GBytes *truncated = g_bytes_new_from_bytes (precompiled, 0, i);
+      GtkCssTokenizer *tokenizer = gtk_css_tokenizer_new (truncated);
+      GtkCssToken token;
+
+      while (TRUE)
+        {
+          GError *error = NULL;
+
+          if (!gtk_css_tokenizer_read_token (tokenizer, &token, &error))
+            {
+              g_assert_true (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF));
+              g_clear_error (&error);
+            }
+
+          if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+            break;
+
+          gtk_css_token_clear (&token);
+        }
+
+      gtk_css_tokenizer_unref (tokenizer);
+      g_bytes_unref (truncated);
+    }
+
+  g_bytes_unref (precompiled);
+  g_bytes_unref (bytes);
+}
+
+static void
+test_location (void)
+{
+  const Test *test = &tests[G_N_ELEMENTS (tests) - 1];
+  const GtkCssLocation *location;
+  GtkCssTokenizer *tokenizer;
+  GBytes *bytes;
+  GtkCssToken token;
+
+  g_assert_cmpstr (test->name, ==, "runs");
+
+  bytes = g_bytes_new_static (test->css, strlen (test->css));
+  tokenizer = gtk_css_tokenizer_new (bytes);
+
+  while (TRUE)
+    {
+      g_assert_true (gtk_css_tokenizer_read_token (tokenizer, &token, NULL));
+
+      if (gtk_css_token_is (&token, GTK_CSS_TOKEN_EOF))
+        break;
+
+      gtk_css_token_clear (&token);
+    }
+
+  location = gtk_css_tokenizer_get_location (tokenizer);
+  g_assert_cmpuint (location->bytes, ==, 159);
+  g_assert_cmpuint (location->chars, ==, 155);
+  g_assert_cmpuint (location->lines, ==, 4);
+  g_assert_cmpuint (location->line_bytes, ==, 12);
+  g_assert_cmpuint (location->line_chars, ==, 12);
+
+  gtk_css_tokenizer_unref (tokenizer);
+  g_bytes_unref (bytes);
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint i;
+
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  for (i = 0; i < G_N_ELEMENTS (tests); i++)
+    {
+      char *name = g_strdup_printf ("/css/tokenizer/precompile/%s", tests[i].name);
+      g_test_add_data_func (name, &tests[i], test_precompile);
+      g_free (name);
+
+      name = g_strdup_printf ("/css/tokenizer/truncated/%s", tests[i].name);
+      g_test_add_data_func (name, &tests[i], test_truncated);
+      g_free (name);
+    }
+
+  g_test_add_func ("/css/tokenizer/location", test_location);
+
+  return g_test_run ();
+}
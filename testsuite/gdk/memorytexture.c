@@ -172,6 +172,88 @@ test_download_4x4_with_stride (gconstpointer data)
   g_object_unref (test);
 }
 
+/* Compares downloading a whole texture of random pixels to downloading
+ * its pixels one by one, so that both the converters for long rows and
+ * the ones for single pixels get exercised */
+static void
+test_download_random (gconstpointer data)
+{
+  const TestData *test_data = data;
+  gsize bpp = tests[test_data->format].bytes_per_pixel;
+  const int width = 37, height = 7;
+  gsize stride = width * bpp + 3;
+  GdkTexture *test;
+  GBytes *bytes;
+  guchar *pixels;
+  guint32 *downloaded;
+  gsize i;
+  int x, y;
+
+  pixels = g_malloc (height * stride);
+  for (i = 0; i < height * stride; i++)
+    pixels[i] = g_test_rand_int_range (0, 256);
+
+  bytes = g_bytes_new (pixels, height * stride);
+  test = gdk_memory_texture_new (width, height, test_data->format, bytes, stride);
+  g_bytes_unref (bytes);
+
+  downloaded = g_new (guint32, width * height);
+  gdk_texture_download (test, (guchar *) downloaded, width * 4);
+
+  for (y = 0; y < height; y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          GdkTexture *pixel;
+          guint32 expected;
+
+          bytes = g_bytes_new (&pixels[y * stride + x * bpp], bpp);
+          pixel = gdk_memory_texture_new (1, 1, test_data->format, bytes, bpp);
+          g_bytes_unref (bytes);
+
+          gdk_texture_download (pixel, (guchar *) &expected, 4);
+          g_assert_cmphex (downloaded[y * width + x], ==, expected);
+
+          g_object_unref (pixel);
+        }
+    }
+
+  g_free (downloaded);
+  g_free (pixels);
+  g_object_unref (test);
+}
+
+static void
+test_download_performance (gconstpointer data)
+{
+  const TestData *test_data = data;
+  gsize bpp = tests[test_data->format].bytes_per_pixel;
+  const int width = 3840, height = 2160;
+  const int runs = 20;
+  GdkTexture *test;
+  GBytes *bytes;
+  guchar *downloaded;
+  double elapsed;
+  int i;
+
+  bytes = g_bytes_new_take (g_malloc0 (width * height * bpp), width * height * bpp);
+  test = gdk_memory_texture_new (width, height, test_data->format, bytes, width * bpp);
+  g_bytes_unref (bytes);
+
+  downloaded = g_malloc (width * height * 4);
+
+  g_test_timer_start ();
+  for (i = 0; i < runs; i++)
+    gdk_texture_download (test, downloaded, width * 4);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_maximized_result (runs * (double) width * height / elapsed / 1000000,
+                           "%.1f Mpixels/s", runs * (double) width * height / elapsed / 1000000);
+
+  g_free (downloaded);
+  g_object_unref (test);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -223,6 +305,25 @@ main (int argc, char *argv[])
           g_test_add_data_func_full (test_name, test_data, test_download_4x4_with_stride, g_free);
           g_free (test_name);
         }
+
+      TestData *test_data = g_new (TestData, 1);
+      char *test_name = g_strdup_printf ("/memorytexture/download_random/%s",
+                                         g_enum_get_value (enum_class, format)->value_nick);
+      test_data->format = format;
+      test_data->color = 0;
+      g_test_add_data_func_full (test_name, test_data, test_download_random, g_free);
+      g_free (test_name);
+
+      if (g_test_perf ())
+        {
+          test_data = g_new (TestData, 1);
+          test_name = g_strdup_printf ("/memorytexture/download_performance/%s",
+                                       g_enum_get_value (enum_class, format)->value_nick);
+          test_data->format = format;
+          test_data->color = 0;
+          g_test_add_data_func_full (test_name, test_data, test_download_performance, g_free);
+          g_free (test_name);
+        }
     }
 
   return g_test_run ();
@@ -149,6 +149,35 @@ deserialize_error_func (const GtkCssSection *section,
   g_string_append_c (errors, '\n');
 }
 
+/* Checks that loading the binary format gives back the same node */
+static gboolean
+binary_roundtrip (GskRenderNode *node)
+{
+  GskRenderNode *loaded;
+  GBytes *bytes, *reloaded_bytes;
+  gboolean result;
+
+  bytes = gsk_render_node_serialize_to_format (node, GSK_SERIALIZATION_FORMAT_BINARY);
+  loaded = gsk_render_node_deserialize (bytes, NULL, NULL);
+  if (loaded == NULL)
+    {
+      g_print ("Could not load binary serialization\n");
+      g_bytes_unref (bytes);
+      return FALSE;
+    }
+
+  reloaded_bytes = gsk_render_node_serialize_to_format (loaded, GSK_SERIALIZATION_FORMAT_BINARY);
+  result = g_bytes_equal (bytes, reloaded_bytes);
+  if (!result)
+    g_print ("Binary serialization does not roundtrip\n");
+
+  g_bytes_unref (reloaded_bytes);
+  g_bytes_unref (bytes);
+  gsk_render_node_unref (loaded);
+
+  return result;
+}
+
 static gboolean
 parse_node_file (GFile *file, gboolean generate)
 {
@@ -172,6 +201,10 @@ parse_node_file (GFile *file, gboolean generate)
 
   node = gsk_render_node_deserialize (bytes, deserialize_error_func, errors);
   g_bytes_unref (bytes);
+
+  if (!generate && !binary_roundtrip (node))
+    result = FALSE;
+
   bytes = gsk_render_node_serialize (node);
   gsk_render_node_unref (node);
 
@@ -0,0 +1,288 @@
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+/* Replays serialized render nodes with the renderer selected via
+ * GSK_RENDERER and reports how long rendering them takes.
+ *
+ * For every node file, the render time is the time it takes
+ * gsk_renderer_render_texture() to return, which is mostly the CPU
+ * side of the renderer. The download time is the time it then takes
+ * to get the pixels back, which includes waiting for the GPU.
+ */
+
+static int arg_runs = 20;
+static int arg_warmup = 2;
+static char *arg_output = NULL;
+
+static const GOptionEntry options[] = {
+  { "runs", 0, 0, G_OPTION_ARG_INT, &arg_runs,
+    "Number of measured renders per node", "N" },
+  { "warmup", 0, 0, G_OPTION_ARG_INT, &arg_warmup,
+    "Number of renders to do before measuring", "N" },
+  { "output", 0, 0, G_OPTION_ARG_FILENAME, &arg_output,
+    "Write results as JSON to FILE", "FILE" },
+  { NULL }
+};
+
+typedef struct
+{
+  gint64 min;
+  gint64 max;
+  gint64 median;
+  double mean;
+} Stats;
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 ta = *(const gint64 *) a;
+  gint64 tb = *(const gint64 *) b;
+
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static void
+compute_stats (gint64 *times,
+               int     n_times,
+               Stats  *stats)
+{
+  gint64 sum = 0;
+  int i;
+
+  qsort (times, n_times, sizeof (gint64), compare_times);
+
+  for (i = 0; i < n_times; i++)
+    sum += times[i];
+
+  stats->min = times[0];
+  stats->max = times[n_times - 1];
+  stats->median = times[n_times / 2];
+  stats->mean = (double) sum / n_times;
+}
+
+static void
+deserialize_error_func (const GtkCssSection *section,
+                        const GError        *error,
+                        gpointer             user_data)
+{
+  char *section_str = gtk_css_section_to_string (section);
+
+  g_printerr ("Error at %s: %s\n", section_str, error->message);
+
+  g_free (section_str);
+}
+
+static GskRenderNode *
+load_node_file (const char *filename)
+{
+  GError *error = NULL;
+  GskRenderNode *node;
+  GBytes *bytes;
+  char *contents;
+  gsize len;
+
+  if (!g_file_get_contents (filename, &contents, &len, &error))
+    {
+      g_printerr ("Could not open node file: %s\n", error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  bytes = g_bytes_new_take (contents, len);
+  node = gsk_render_node_deserialize (bytes, deserialize_error_func, NULL);
+  g_bytes_unref (bytes);
+
+  return node;
+}
+
+static gboolean
+render_once (GskRenderer   *renderer,
+             GskRenderNode *node,
+             guchar        *data,
+             gsize          data_size,
+             gint64        *render_time,
+             gint64        *download_time)
+{
+  GdkTexture *texture;
+  gint64 start, rendered;
+  gsize stride;
+
+  start = g_get_monotonic_time ();
+  texture = gsk_renderer_render_texture (renderer, node, NULL);
+  rendered = g_get_monotonic_time ();
+
+  if (texture == NULL)
+    return FALSE;
+
+  stride = gdk_texture_get_width (texture) * 4;
+  g_assert (stride * gdk_texture_get_height (texture) <= data_size);
+  gdk_texture_download (texture, data, stride);
+
+  *render_time = rendered - start;
+  *download_time = g_get_monotonic_time () - rendered;
+
+  g_object_unref (texture);
+
+  return TRUE;
+}
+
+static void
+append_stats (GString     *json,
+              const char  *name,
+              const Stats *stats)
+{
+  g_string_append_printf (json,
+                          "      \"%s\": { \"min\": %" G_GINT64_FORMAT
+                          ", \"median\": %" G_GINT64_FORMAT
+                          ", \"mean\": %.1f, \"max\": %" G_GINT64_FORMAT " }",
+                          name, stats->min, stats->median, stats->mean, stats->max);
+}
+
+static gboolean
+benchmark_node_file (GskRenderer *renderer,
+                     const char  *filename,
+                     GString     *json)
+{
+  GskRenderNode *node;
+  graphene_rect_t bounds;
+  gint64 *render_times, *download_times;
+  Stats render_stats, download_stats;
+  guchar *data;
+  gsize data_size;
+  char *basename;
+  int i;
+
+  node = load_node_file (filename);
+  if (node == NULL)
+    return FALSE;
+
+  gsk_render_node_get_bounds (node, &bounds);
+  data_size = (gsize) ceil (bounds.size.width) * (gsize) ceil (bounds.size.height) * 4;
+  data = g_malloc (MAX (data_size, 4));
+
+  render_times = g_new (gint64, arg_runs);
+  download_times = g_new (gint64, arg_runs);
+
+  for (i = 0; i < arg_warmup + arg_runs; i++)
+    {
+      gint64 render_time, download_time;
+
+      if (!render_once (renderer, node, data, MAX (data_size, 4), &render_time, &download_time))
+        {
+          g_printerr ("%s: Rendering failed\n", filename);
+          break;
+        }
+
+      if (i >= arg_warmup)
+        {
+          render_times[i - arg_warmup] = render_time;
+          download_times[i - arg_warmup] = download_time;
+        }
+    }
+
+  if (i == arg_warmup + arg_runs)
+    {
+      compute_stats (render_times, arg_runs, &render_stats);
+      compute_stats (download_times, arg_runs, &download_stats);
+
+      basename = g_path_get_basename (filename);
+      g_print ("%-40s render %8.1f µs (median %" G_GINT64_FORMAT ")  download %8.1f µs\n",
+               basename, render_stats.mean, render_stats.median, download_stats.mean);
+
+      if (json->len > 0)
+        g_string_append (json, ",\n");
+      g_string_append_printf (json, "    {\n      \"node\": \"%s\",\n      \"size\": [%g, %g],\n",
+                              basename, bounds.size.width, bounds.size.height);
+      append_stats (json, "render-us", &render_stats);
+      g_string_append (json, ",\n");
+      append_stats (json, "download-us", &download_stats);
+      g_string_append (json, "\n    }");
+
+      g_free (basename);
+    }
+
+  g_free (render_times);
+  g_free (download_times);
+  g_free (data);
+  gsk_render_node_unref (node);
+
+  return i == arg_warmup + arg_runs;
+}
+
+/*
+ * Non-option arguments:
+ *   .node files to benchmark
+ */
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GskRenderer *renderer;
+  GdkSurface *surface;
+  GString *results;
+  gboolean success = TRUE;
+  int i;
+
+  context = g_option_context_new ("NODE... - benchmark GSK renderers");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  else if (argc < 2 || arg_runs < 1 || arg_warmup < 0)
+    {
+      char *help = g_option_context_get_help (context, TRUE, NULL);
+      g_print ("%s", help);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  gtk_init ();
+
+  surface = gdk_surface_new_toplevel (gdk_display_get_default ());
+  renderer = gsk_renderer_new_for_surface (surface);
+  if (renderer == NULL)
+    {
+      g_printerr ("Could not create a renderer\n");
+      return 1;
+    }
+
+  g_print ("Renderer: %s\n", G_OBJECT_TYPE_NAME (renderer));
+
+  results = g_string_new (NULL);
+
+  for (i = 1; i < argc; i++)
+    success &= benchmark_node_file (renderer, argv[i], results);
+
+  if (arg_output)
+    {
+      char *json;
+
+      json = g_strdup_printf ("{\n  \"renderer\": \"%s\",\n  \"runs\": %d,\n  \"results\": [\n%s\n  ]\n}\n",
+                              G_OBJECT_TYPE_NAME (renderer), arg_runs, results->str);
+
+      if (!g_file_set_contents (arg_output, json, -1, &error))
+        {
+          g_printerr ("Could not write results: %s\n", error->message);
+          g_clear_error (&error);
+          success = FALSE;
+        }
+
+      g_free (json);
+    }
+
+  g_string_free (results, TRUE);
+
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+  gdk_surface_destroy (surface);
+
+  return success ? 0 : 1;
+}
@@ -555,6 +555,28 @@ test_splice_overflow (void)
   g_assert_true (gtk_bitset_equals (set, compare));
 }
 
+static void
+test_shift_overflow (void)
+{
+  GtkBitset *set, *compare;
+
+  set = gtk_bitset_new_range (G_MAXUINT - 9, 10);
+  gtk_bitset_add (set, 5);
+  gtk_bitset_shift_right (set, 5);
+
+  compare = gtk_bitset_new_range (G_MAXUINT - 4, 5);
+  gtk_bitset_add (compare, 10);
+  g_assert_true (gtk_bitset_equals (set, compare));
+
+  gtk_bitset_shift_left (set, G_MAXUINT - 4);
+  gtk_bitset_remove_all (compare);
+  gtk_bitset_add_range (compare, 0, 5);
+  g_assert_true (gtk_bitset_equals (set, compare));
+
+  gtk_bitset_unref (compare);
+  gtk_bitset_unref (set);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -571,6 +593,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/bitset/subtract", test_subtract);
   g_test_add_func ("/bitset/shift-left", test_shift_left);
   g_test_add_func ("/bitset/shift-right", test_shift_right);
+  g_test_add_func ("/bitset/shift-overflow", test_shift_overflow);
   g_test_add_func ("/bitset/slice", test_slice);
   g_test_add_func ("/bitset/rectangle", test_rectangle);
   g_test_add_func ("/bitset/iter", test_iter);
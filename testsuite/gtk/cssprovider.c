@@ -33,6 +33,112 @@ test_section_load_nonexisting_file (void)
   g_object_unref (provider);
 }
 
+static void
+assert_color (GtkWidget  *widget,
+              const char *expected)
+{
+  GdkRGBA color, expected_color;
+
+  gdk_rgba_parse (&expected_color, expected);
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget), &color);
+
+  g_assert_true (gdk_rgba_equal (&color, &expected_color));
+}
+
+static void
+test_reload_changed_rulesets (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *accent, *plain;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   "label.accent { color: red; }\n"
+                                   "label { color: blue; }", -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  accent = g_object_ref_sink (gtk_label_new ("accent"));
+  gtk_widget_add_css_class (accent, "accent");
+  plain = g_object_ref_sink (gtk_label_new ("plain"));
+
+  assert_color (accent, "red");
+  assert_color (plain, "blue");
+
+  /* Only restyles the accent label */
+  gtk_css_provider_load_from_data (provider,
+                                   "label.accent { color: green; }\n"
+                                   "label { color: blue; }", -1);
+  assert_color (accent, "green");
+  assert_color (plain, "blue");
+
+  /* A new rule for a state the label is not in yet */
+  gtk_css_provider_load_from_data (provider,
+                                   "label.accent { color: green; }\n"
+                                   "label { color: blue; }\n"
+                                   "label:hover { color: yellow; }", -1);
+  assert_color (plain, "blue");
+  gtk_widget_set_state_flags (plain, GTK_STATE_FLAG_PRELIGHT, FALSE);
+  assert_color (plain, "yellow");
+
+  /* Removing rules */
+  gtk_css_provider_load_from_data (provider, "label { color: blue; }", -1);
+  assert_color (accent, "blue");
+  assert_color (plain, "blue");
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (accent);
+  g_object_unref (plain);
+  g_object_unref (provider);
+}
+
+static void
+test_insert_restyles_positions (void)
+{
+  GtkCssProvider *provider;
+  GtkWidget *box, *first, *button, *button_label, *last, *inserted;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   "label { color: blue; }\n"
+                                   "box > label:nth-child(2) { color: red; }\n"
+                                   "box > :nth-child(2) label { color: green; }", -1);
+  gtk_style_context_add_provider_for_display (gdk_display_get_default (),
+                                              GTK_STYLE_PROVIDER (provider),
+                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  box = g_object_ref_sink (gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0));
+  first = gtk_label_new ("first");
+  gtk_box_append (GTK_BOX (box), first);
+  button = gtk_button_new_with_label ("button");
+  button_label = gtk_button_get_child (GTK_BUTTON (button));
+  gtk_box_append (GTK_BOX (box), button);
+  last = gtk_label_new ("last");
+  gtk_box_append (GTK_BOX (box), last);
+
+  assert_color (first, "blue");
+  assert_color (button_label, "green");
+  assert_color (last, "blue");
+
+  /* Moves every child one position further, including the button,
+   * whose own style does not depend on its position.
+   */
+  inserted = gtk_label_new ("inserted");
+  gtk_box_prepend (GTK_BOX (box), inserted);
+
+  assert_color (inserted, "blue");
+  assert_color (first, "red");
+  assert_color (button_label, "blue");
+  assert_color (last, "blue");
+
+  gtk_style_context_remove_provider_for_display (gdk_display_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider));
+  g_object_unref (box);
+  g_object_unref (provider);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -41,6 +147,8 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/cssprovider/section-in-load-from-data", test_section_in_load_from_data);
   g_test_add_func ("/cssprovider/load-nonexisting-file", test_section_load_nonexisting_file);
+  g_test_add_func ("/cssprovider/reload-changed-rulesets", test_reload_changed_rulesets);
+  g_test_add_func ("/cssprovider/insert-restyles-positions", test_insert_restyles_positions);
 
   return g_test_run ();
 }
@@ -306,6 +306,63 @@ test_delete (void)
   g_object_unref (entry);
 }
 
+static char *
+complete (GtkEntryCompletion *completion,
+          GtkWidget          *entry,
+          const char         *text)
+{
+  gtk_editable_set_text (GTK_EDITABLE (entry), text);
+  gtk_entry_completion_complete (completion);
+
+  return gtk_entry_completion_compute_prefix (completion, text);
+}
+
+static void
+test_completion (void)
+{
+  GtkWidget *entry;
+  GtkEntryCompletion *completion;
+  GtkListStore *store;
+  char *prefix;
+
+  store = gtk_list_store_new (1, G_TYPE_STRING);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "banana", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "apricots", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "apple", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "apricot", -1);
+
+  entry = gtk_entry_new ();
+  g_object_ref_sink (entry);
+
+  completion = gtk_entry_completion_new ();
+  gtk_entry_completion_set_model (completion, GTK_TREE_MODEL (store));
+  gtk_entry_completion_set_text_column (completion, 0);
+  gtk_entry_set_completion (GTK_ENTRY (entry), completion);
+
+  prefix = complete (completion, entry, "ap");
+  g_assert_cmpstr (prefix, ==, "ap");
+  g_free (prefix);
+
+  /* Extending the key narrows the previous matches */
+  prefix = complete (completion, entry, "apr");
+  g_assert_cmpstr (prefix, ==, "apricot");
+  g_free (prefix);
+
+  prefix = complete (completion, entry, "b");
+  g_assert_cmpstr (prefix, ==, "banana");
+  g_free (prefix);
+
+  /* Changes to the model are picked up */
+  gtk_list_store_insert_with_values (store, NULL, 0, 0, "aprium", -1);
+  prefix = complete (completion, entry, "apr");
+  g_assert_cmpstr (prefix, ==, "apri");
+  g_free (prefix);
+
+  g_object_unref (completion);
+  g_object_unref (entry);
+  g_object_unref (store);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -314,6 +371,7 @@ main (int   argc,
 
   g_test_add_func ("/entry/delete", test_delete);
   g_test_add_func ("/entry/insert", test_insert);
+  g_test_add_func ("/entry/completion", test_completion);
 
   return g_test_run();
 }
@@ -309,6 +309,43 @@ test_string_properties (void)
   g_object_unref (filter);
 }
 
+static void
+test_string_search_change (void)
+{
+  GtkFilterListModel *model;
+  GtkFilter *filter;
+
+  filter = GTK_FILTER (gtk_string_filter_new (
+               gtk_cclosure_expression_new (G_TYPE_STRING,
+                                            NULL,
+                                            0, NULL,
+                                            G_CALLBACK (get_string),
+                                            NULL, NULL)));
+  gtk_string_filter_set_match_mode (GTK_STRING_FILTER (filter), GTK_STRING_FILTER_MATCH_MODE_EXACT);
+
+  model = new_model (20, filter);
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "1");
+  assert_model (model, "1");
+
+  /* a longer exact search is not more strict */
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "11");
+  assert_model (model, "11");
+
+  gtk_string_filter_set_match_mode (GTK_STRING_FILTER (filter), GTK_STRING_FILTER_MATCH_MODE_SUBSTRING);
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "2");
+  assert_model (model, "2 12 20");
+
+  /* containing the old search is more strict */
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "12");
+  assert_model (model, "12");
+
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "1");
+  assert_model (model, "1 10 11 12 13 14 15 16 17 18 19");
+
+  g_object_unref (model);
+  g_object_unref (filter);
+}
+
 static void
 test_bool_simple (void)
 {
@@ -387,6 +424,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/filter/any/simple", test_any_simple);
   g_test_add_func ("/filter/string/simple", test_string_simple);
   g_test_add_func ("/filter/string/properties", test_string_properties);
+  g_test_add_func ("/filter/string/search-change", test_string_search_change);
   g_test_add_func ("/filter/bool/simple", test_bool_simple);
   g_test_add_func ("/filter/every/dispose", test_every_dispose);
 
@@ -18,6 +18,7 @@
  */
 
 #include <locale.h>
+#include <string.h>
 
 #include <gtk/gtk.h>
 
@@ -376,6 +377,125 @@ test_incremental (void)
   g_object_unref (filter);
 }
 
+static guint
+count_matches (GListModel *model,
+               const char *search)
+{
+  guint i, n_matches;
+
+  n_matches = 0;
+  for (i = 0; i < g_list_model_get_n_items (model); i++)
+    {
+      GtkStringObject *object = g_list_model_get_item (model, i);
+
+      if (strstr (gtk_string_object_get_string (object), search))
+        n_matches++;
+
+      g_object_unref (object);
+    }
+
+  return n_matches;
+}
+
+static void
+test_incremental_threads (void)
+{
+  GtkFilterListModel *filter;
+  GtkStringFilter *string_filter;
+  GListStore *store;
+  const guint n_items = 50000;
+  guint i;
+
+  store = g_list_store_new (GTK_TYPE_STRING_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      char *string = g_strdup_printf ("%05u", i);
+      GtkStringObject *object = gtk_string_object_new (string);
+      g_list_store_append (store, object);
+      g_object_unref (object);
+      g_free (string);
+    }
+
+  string_filter = gtk_string_filter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string"));
+  filter = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (store)), g_object_ref (GTK_FILTER (string_filter)));
+  gtk_filter_list_model_set_incremental (filter, TRUE);
+
+  gtk_string_filter_set_search (string_filter, "7");
+  while (gtk_filter_list_model_get_pending (filter) != 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (filter), "7"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (store), "7"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+
+  /* change the filter and the items while filtering */
+  gtk_string_filter_set_search (string_filter, "77");
+  while (gtk_filter_list_model_get_pending (filter) != 0)
+    {
+      if (g_list_model_get_n_items (G_LIST_MODEL (store)) > n_items - 100)
+        g_list_store_splice (store, g_random_int_range (0, n_items - 110), 10, NULL, 0);
+      else if (g_list_model_get_n_items (G_LIST_MODEL (store)) < n_items)
+        {
+          GtkStringObject *object = gtk_string_object_new ("77777");
+          g_list_store_append (store, object);
+          g_object_unref (object);
+        }
+      g_main_context_iteration (NULL, FALSE);
+    }
+
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (filter), "77"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (store), "77"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+
+  g_object_unref (string_filter);
+  g_object_unref (store);
+  g_object_unref (filter);
+}
+
+/* More strict filters only need to check the current matches,
+ * and do so without removing them all first.
+ */
+static void
+test_incremental_more_strict (void)
+{
+  GtkFilterListModel *filter;
+  GtkStringFilter *string_filter;
+  GListStore *store;
+  guint i, n_before;
+
+  store = g_list_store_new (GTK_TYPE_STRING_OBJECT);
+  for (i = 0; i < 2000; i++)
+    {
+      char *string = g_strdup_printf ("%u", i);
+      GtkStringObject *object = gtk_string_object_new (string);
+      g_list_store_append (store, object);
+      g_object_unref (object);
+      g_free (string);
+    }
+
+  string_filter = gtk_string_filter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string"));
+  gtk_string_filter_set_search (string_filter, "1");
+  filter = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (store)), g_object_ref (GTK_FILTER (string_filter)));
+  n_before = g_list_model_get_n_items (G_LIST_MODEL (filter));
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (store), "1"), ==, n_before);
+
+  gtk_filter_list_model_set_incremental (filter, TRUE);
+  gtk_string_filter_set_search (string_filter, "11");
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, n_before);
+  g_assert_cmpuint (gtk_filter_list_model_get_pending (filter), ==, n_before);
+
+  while (gtk_filter_list_model_get_pending (filter) != 0)
+    {
+      g_main_context_iteration (NULL, TRUE);
+      g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (filter)), <=, n_before);
+    }
+
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (filter), "11"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+  g_assert_cmpuint (count_matches (G_LIST_MODEL (store), "11"), ==, g_list_model_get_n_items (G_LIST_MODEL (filter)));
+
+  g_object_unref (string_filter);
+  g_object_unref (store);
+  g_object_unref (filter);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -389,6 +509,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/filterlistmodel/empty_set_filter", test_empty_set_filter);
   g_test_add_func ("/filterlistmodel/change_filter", test_change_filter);
   g_test_add_func ("/filterlistmodel/incremental", test_incremental);
+  g_test_add_func ("/filterlistmodel/incremental/threads", test_incremental_threads);
+  g_test_add_func ("/filterlistmodel/incremental/more-strict", test_incremental_more_strict);
 
   return g_test_run ();
 }
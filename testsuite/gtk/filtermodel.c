@@ -6826,6 +6826,79 @@ test_row_changed (void)
   g_object_unref (store);
 }
 
+static gboolean
+refilter_list_visible_func (GtkTreeModel *model,
+                            GtkTreeIter  *iter,
+                            gpointer      data)
+{
+  int *threshold = data;
+  int value;
+
+  gtk_tree_model_get (model, iter, 0, &value, -1);
+
+  return value >= *threshold;
+}
+
+static void
+row_deleted (GtkTreeModel *model,
+             GtkTreePath  *path,
+             gpointer      data)
+{
+  int *count = data;
+
+  (*count)++;
+}
+
+static void
+test_refilter_list (gconstpointer data)
+{
+  const int n_rows = 10000;
+  GtkTreeModel *filter;
+  GtkListStore *store;
+  GtkTreeIter iter;
+  int threshold, value, i;
+  int changed = 0, inserted = 0, deleted = 0;
+
+  store = gtk_list_store_new (1, G_TYPE_INT);
+  for (i = 0; i < n_rows; i++)
+    gtk_list_store_insert_with_values (store, NULL, -1, 0, i, -1);
+
+  threshold = n_rows / 2;
+  filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter),
+                                          refilter_list_visible_func,
+                                          &threshold, NULL);
+  gtk_tree_model_filter_set_thread_safe (GTK_TREE_MODEL_FILTER (filter),
+                                         GPOINTER_TO_INT (data));
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, n_rows / 2);
+
+  g_signal_connect (filter, "row-changed", G_CALLBACK (row_changed), &changed);
+  g_signal_connect (filter, "row-inserted", G_CALLBACK (row_changed), &inserted);
+  g_signal_connect (filter, "row-deleted", G_CALLBACK (row_deleted), &deleted);
+
+  threshold = n_rows / 4;
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (filter));
+
+  g_assert_cmpint (changed, ==, 0);
+  g_assert_cmpint (inserted, ==, n_rows / 4);
+  g_assert_cmpint (deleted, ==, 0);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, n_rows - n_rows / 4);
+
+  threshold = n_rows - 10;
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (filter));
+
+  g_assert_cmpint (changed, ==, 0);
+  g_assert_cmpint (deleted, ==, n_rows - n_rows / 4 - 10);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 10);
+
+  g_assert_true (gtk_tree_model_get_iter_first (filter, &iter));
+  gtk_tree_model_get (filter, &iter, 0, &value, -1);
+  g_assert_cmpint (value, ==, n_rows - 10);
+
+  g_object_unref (filter);
+  g_object_unref (store);
+}
 
 /* main */
 
@@ -7190,4 +7263,8 @@ register_filter_model_tests (void)
                    specific_bug_679910);
 
   g_test_add_func ("/TreeModelFilter/signal/row-changed", test_row_changed);
+  g_test_add_data_func ("/TreeModelFilter/refilter/list",
+                        GINT_TO_POINTER (FALSE), test_refilter_list);
+  g_test_add_data_func ("/TreeModelFilter/refilter/list-threaded",
+                        GINT_TO_POINTER (TRUE), test_refilter_list);
 }
@@ -0,0 +1,702 @@
+/*
+ * Copyright © 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <locale.h>
+
+#include <gtk/gtk.h>
+
+/* Times common operations on the list models and GtkBitset for
+ * various numbers of items. Setting up the models is not included
+ * in the times, only the operation itself.
+ *
+ * The items are GtkStringObjects holding random numbers, so they
+ * can be sorted with a numeric sorter and filtered with a string
+ * filter.
+ */
+
+#define N_CHANGES 1000
+
+static int arg_runs = 5;
+static char **arg_sizes = NULL;
+static int arg_seed = 42;
+static char *arg_output = NULL;
+
+static const GOptionEntry options[] = {
+  { "runs", 0, 0, G_OPTION_ARG_INT, &arg_runs,
+    "Number of measured runs per benchmark", "N" },
+  { "size", 0, 0, G_OPTION_ARG_STRING_ARRAY, &arg_sizes,
+    "Number of items, can be given multiple times", "N" },
+  { "seed", 0, 0, G_OPTION_ARG_INT, &arg_seed,
+    "Seed for the random numbers", "N" },
+  { "output", 0, 0, G_OPTION_ARG_FILENAME, &arg_output,
+    "Write results as JSON to FILE", "FILE" },
+  { NULL }
+};
+
+static GRand *rng;
+
+static GtkStringList *
+create_string_list (guint size)
+{
+  GtkStringList *list;
+  char **strings;
+  guint i;
+
+  strings = g_new (char *, size + 1);
+  for (i = 0; i < size; i++)
+    strings[i] = g_strdup_printf ("%u", g_rand_int (rng));
+  strings[size] = NULL;
+
+  list = gtk_string_list_new ((const char * const *) strings);
+
+  g_strfreev (strings);
+
+  return list;
+}
+
+static guint
+get_number (GtkStringObject *object)
+{
+  return strtoul (gtk_string_object_get_string (object), NULL, 10);
+}
+
+static GtkSorter *
+create_sorter (void)
+{
+  return GTK_SORTER (gtk_numeric_sorter_new (gtk_cclosure_expression_new (G_TYPE_UINT,
+                                                                          NULL,
+                                                                          0, NULL,
+                                                                          G_CALLBACK (get_number),
+                                                                          NULL, NULL)));
+}
+
+static GtkFilter *
+create_filter (const char *search)
+{
+  GtkStringFilter *filter;
+
+  filter = gtk_string_filter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string"));
+  gtk_string_filter_set_search (filter, search);
+
+  return GTK_FILTER (filter);
+}
+
+static void
+splice_randomly (GtkStringList *list)
+{
+  guint i, n_items;
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (list));
+
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      char *added[2] = { NULL, NULL };
+
+      added[0] = g_strdup_printf ("%u", g_rand_int (rng));
+      gtk_string_list_splice (list,
+                              g_rand_int_range (rng, 0, n_items),
+                              1,
+                              (const char * const *) added);
+      g_free (added[0]);
+    }
+}
+
+static void
+append_many (GtkStringList *list)
+{
+  guint i;
+
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      char *s = g_strdup_printf ("%u", g_rand_int (rng));
+      gtk_string_list_append (list, s);
+      g_free (s);
+    }
+}
+
+static void
+access_randomly (GListModel *model)
+{
+  guint i, n_items;
+
+  n_items = g_list_model_get_n_items (model);
+  if (n_items == 0)
+    return;
+
+  for (i = 0; i < N_CHANGES; i++)
+    g_object_unref (g_list_model_get_item (model, g_rand_int_range (rng, 0, n_items)));
+}
+
+static gint64
+sort_build (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkSortListModel *model;
+
+  start = g_get_monotonic_time ();
+  model = gtk_sort_list_model_new (G_LIST_MODEL (list), create_sorter ());
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+sort_splice (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkSortListModel *model = gtk_sort_list_model_new (g_object_ref (G_LIST_MODEL (list)), create_sorter ());
+
+  start = g_get_monotonic_time ();
+  splice_randomly (list);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (list);
+  return result;
+}
+
+static gint64
+sort_append (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkSortListModel *model = gtk_sort_list_model_new (g_object_ref (G_LIST_MODEL (list)), create_sorter ());
+
+  start = g_get_monotonic_time ();
+  append_many (list);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (list);
+  return result;
+}
+
+static gint64
+sort_change_sorter (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkSorter *sorter = create_sorter ();
+  GtkSortListModel *model = gtk_sort_list_model_new (G_LIST_MODEL (list), g_object_ref (sorter));
+
+  start = g_get_monotonic_time ();
+  gtk_numeric_sorter_set_sort_order (GTK_NUMERIC_SORTER (sorter), GTK_SORT_DESCENDING);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (sorter);
+  return result;
+}
+
+static gint64
+filter_build (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkFilterListModel *model;
+
+  start = g_get_monotonic_time ();
+  model = gtk_filter_list_model_new (G_LIST_MODEL (list), create_filter ("1"));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+filter_splice (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkFilterListModel *model = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (list)), create_filter ("1"));
+
+  start = g_get_monotonic_time ();
+  splice_randomly (list);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (list);
+  return result;
+}
+
+static gint64
+filter_append (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkFilterListModel *model = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (list)), create_filter ("1"));
+
+  start = g_get_monotonic_time ();
+  append_many (list);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (list);
+  return result;
+}
+
+static gint64
+filter_change_filter (guint size)
+{
+  gint64 start, result;
+  GtkStringList *list = create_string_list (size);
+  GtkFilter *filter = create_filter ("1");
+  GtkFilterListModel *model = gtk_filter_list_model_new (G_LIST_MODEL (list), g_object_ref (filter));
+
+  start = g_get_monotonic_time ();
+  /* more strict */
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "12");
+  /* less strict */
+  gtk_string_filter_set_search (GTK_STRING_FILTER (filter), "2");
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (filter);
+  return result;
+}
+
+/* Splits @size items into lists of 1000 items */
+static GListStore *
+create_list_of_lists (guint size)
+{
+  GListStore *store;
+  guint i;
+
+  store = g_list_store_new (G_TYPE_LIST_MODEL);
+  for (i = 0; i < size; i += 1000)
+    {
+      GtkStringList *list = create_string_list (MIN (1000, size - i));
+      g_list_store_append (store, list);
+      g_object_unref (list);
+    }
+
+  return store;
+}
+
+static gint64
+flatten_build (guint size)
+{
+  gint64 start, result;
+  GListStore *store = create_list_of_lists (size);
+  GtkFlattenListModel *model;
+
+  start = g_get_monotonic_time ();
+  model = gtk_flatten_list_model_new (G_LIST_MODEL (store));
+  g_list_model_get_n_items (G_LIST_MODEL (model));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+flatten_access (guint size)
+{
+  gint64 start, result;
+  GtkFlattenListModel *model = gtk_flatten_list_model_new (G_LIST_MODEL (create_list_of_lists (size)));
+
+  start = g_get_monotonic_time ();
+  access_randomly (G_LIST_MODEL (model));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+flatten_splice (guint size)
+{
+  gint64 start, result;
+  GListStore *store = create_list_of_lists (size);
+  GtkFlattenListModel *model = gtk_flatten_list_model_new (g_object_ref (G_LIST_MODEL (store)));
+  guint i, n_lists;
+
+  start = g_get_monotonic_time ();
+  n_lists = g_list_model_get_n_items (G_LIST_MODEL (store));
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      guint pos = g_rand_int_range (rng, 0, n_lists);
+      GListModel *list = g_list_model_get_item (G_LIST_MODEL (store), pos);
+
+      g_list_store_remove (store, pos);
+      g_list_store_insert (store, g_rand_int_range (rng, 0, n_lists), list);
+      g_object_unref (list);
+    }
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  g_object_unref (store);
+  return result;
+}
+
+static GListModel *
+create_tree_children (gpointer item,
+                      gpointer unused)
+{
+  if (GTK_IS_STRING_LIST (item))
+    return g_object_ref (item);
+
+  return NULL;
+}
+
+static gint64
+tree_build (guint size)
+{
+  gint64 start, result;
+  GListStore *store = create_list_of_lists (size);
+  GtkTreeListModel *model;
+
+  start = g_get_monotonic_time ();
+  model = gtk_tree_list_model_new (G_LIST_MODEL (store), FALSE, TRUE, create_tree_children, NULL, NULL);
+  g_list_model_get_n_items (G_LIST_MODEL (model));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+tree_access (guint size)
+{
+  gint64 start, result;
+  GtkTreeListModel *model = gtk_tree_list_model_new (G_LIST_MODEL (create_list_of_lists (size)),
+                                                     FALSE, TRUE, create_tree_children, NULL, NULL);
+
+  start = g_get_monotonic_time ();
+  access_randomly (G_LIST_MODEL (model));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+tree_collapse_expand (guint size)
+{
+  gint64 start, result;
+  GtkTreeListModel *model = gtk_tree_list_model_new (G_LIST_MODEL (create_list_of_lists (size)),
+                                                     FALSE, FALSE, create_tree_children, NULL, NULL);
+  guint i, n_roots;
+
+  start = g_get_monotonic_time ();
+  n_roots = g_list_model_get_n_items (gtk_tree_list_model_get_model (model));
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      GtkTreeListRow *row = gtk_tree_list_model_get_child_row (model, g_rand_int_range (rng, 0, n_roots));
+
+      gtk_tree_list_row_set_expanded (row, !gtk_tree_list_row_get_expanded (row));
+      g_object_unref (row);
+    }
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+selection_select_all (guint size)
+{
+  gint64 start, result;
+  GtkMultiSelection *model = gtk_multi_selection_new (G_LIST_MODEL (create_string_list (size)));
+
+  start = g_get_monotonic_time ();
+  gtk_selection_model_select_all (GTK_SELECTION_MODEL (model));
+  gtk_selection_model_unselect_all (GTK_SELECTION_MODEL (model));
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+selection_select_ranges (guint size)
+{
+  gint64 start, result;
+  GtkMultiSelection *model = gtk_multi_selection_new (G_LIST_MODEL (create_string_list (size)));
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CHANGES; i++)
+    {
+      guint pos = g_rand_int_range (rng, 0, size);
+
+      gtk_selection_model_select_range (GTK_SELECTION_MODEL (model),
+                                        pos,
+                                        g_rand_int_range (rng, 1, 100),
+                                        FALSE);
+    }
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static gint64
+selection_query (guint size)
+{
+  gint64 start, result;
+  GtkMultiSelection *model = gtk_multi_selection_new (G_LIST_MODEL (create_string_list (size)));
+  GtkBitset *selection;
+  guint i;
+
+  for (i = 0; i < N_CHANGES; i++)
+    gtk_selection_model_select_item (GTK_SELECTION_MODEL (model), g_rand_int_range (rng, 0, size), FALSE);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CHANGES; i++)
+    gtk_selection_model_is_selected (GTK_SELECTION_MODEL (model), g_rand_int_range (rng, 0, size));
+  selection = gtk_selection_model_get_selection (GTK_SELECTION_MODEL (model));
+  gtk_bitset_unref (selection);
+
+  result = g_get_monotonic_time () - start;
+  g_object_unref (model);
+  return result;
+}
+
+static GtkBitset *
+create_bitset (guint size)
+{
+  GtkBitset *set;
+  guint i;
+
+  set = gtk_bitset_new_empty ();
+  for (i = 0; i < size / 2; i++)
+    gtk_bitset_add (set, g_rand_int_range (rng, 0, size));
+
+  return set;
+}
+
+static gint64
+bitset_build (guint size)
+{
+  gint64 start, result;
+  GtkBitset *set = gtk_bitset_new_empty ();
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < size / 2; i++)
+    gtk_bitset_add (set, g_rand_int_range (rng, 0, size));
+
+  result = g_get_monotonic_time () - start;
+  gtk_bitset_unref (set);
+  return result;
+}
+
+static gint64
+bitset_set_operations (guint size)
+{
+  gint64 start, result;
+  GtkBitset *a = create_bitset (size);
+  GtkBitset *b = create_bitset (size);
+
+  start = g_get_monotonic_time ();
+  gtk_bitset_union (a, b);
+  gtk_bitset_intersect (a, b);
+  gtk_bitset_subtract (a, b);
+  gtk_bitset_difference (a, b);
+
+  result = g_get_monotonic_time () - start;
+  gtk_bitset_unref (a);
+  gtk_bitset_unref (b);
+  return result;
+}
+
+static gint64
+bitset_splice (guint size)
+{
+  gint64 start, result;
+  GtkBitset *set = create_bitset (size);
+  guint i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_CHANGES; i++)
+    gtk_bitset_splice (set, g_rand_int_range (rng, 0, size), 1, 1);
+
+  result = g_get_monotonic_time () - start;
+  gtk_bitset_unref (set);
+  return result;
+}
+
+static gint64
+bitset_iterate (guint size)
+{
+  gint64 start, result;
+  GtkBitset *set = create_bitset (size);
+  GtkBitsetIter iter;
+  guint value;
+
+  start = g_get_monotonic_time ();
+  for (gtk_bitset_iter_init_first (&iter, set, &value);
+       gtk_bitset_iter_is_valid (&iter);
+       gtk_bitset_iter_next (&iter, &value))
+    ;
+
+  result = g_get_monotonic_time () - start;
+  gtk_bitset_unref (set);
+  return result;
+}
+
+static const struct {
+  const char *model;
+  const char *operation;
+  gint64 (* run) (guint size);
+} benchmarks[] = {
+  { "sortlistmodel", "build", sort_build },
+  { "sortlistmodel", "splice", sort_splice },
+  { "sortlistmodel", "append", sort_append },
+  { "sortlistmodel", "change-sorter", sort_change_sorter },
+  { "filterlistmodel", "build", filter_build },
+  { "filterlistmodel", "splice", filter_splice },
+  { "filterlistmodel", "append", filter_append },
+  { "filterlistmodel", "change-filter", filter_change_filter },
+  { "flattenlistmodel", "build", flatten_build },
+  { "flattenlistmodel", "access", flatten_access },
+  { "flattenlistmodel", "splice", flatten_splice },
+  { "treelistmodel", "build", tree_build },
+  { "treelistmodel", "access", tree_access },
+  { "treelistmodel", "collapse-expand", tree_collapse_expand },
+  { "multiselection", "select-all", selection_select_all },
+  { "multiselection", "select-ranges", selection_select_ranges },
+  { "multiselection", "query", selection_query },
+  { "bitset", "build", bitset_build },
+  { "bitset", "set-operations", bitset_set_operations },
+  { "bitset", "splice", bitset_splice },
+  { "bitset", "iterate", bitset_iterate },
+};
+
+static int
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 ta = *(const gint64 *) a;
+  gint64 tb = *(const gint64 *) b;
+
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static void
+run_benchmark (guint    i,
+               guint    size,
+               GString *json)
+{
+  gint64 *times;
+  gint64 sum = 0;
+  int run;
+
+  times = g_new (gint64, arg_runs);
+
+  for (run = 0; run < arg_runs; run++)
+    {
+      times[run] = benchmarks[i].run (size);
+      sum += times[run];
+    }
+
+  qsort (times, arg_runs, sizeof (gint64), compare_times);
+
+  g_print ("%-18s %-16s %9u  %12.1f µs (median %" G_GINT64_FORMAT ")\n",
+           benchmarks[i].model, benchmarks[i].operation, size,
+           (double) sum / arg_runs, times[arg_runs / 2]);
+
+  if (json->len > 0)
+    g_string_append (json, ",\n");
+  g_string_append_printf (json,
+                          "    { \"model\": \"%s\", \"operation\": \"%s\", \"size\": %u"
+                          ", \"min\": %" G_GINT64_FORMAT
+                          ", \"median\": %" G_GINT64_FORMAT
+                          ", \"mean\": %.1f, \"max\": %" G_GINT64_FORMAT " }",
+                          benchmarks[i].model, benchmarks[i].operation, size,
+                          times[0], times[arg_runs / 2], (double) sum / arg_runs, times[arg_runs - 1]);
+
+  g_free (times);
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *default_sizes[] = { "10000", "1000000", "10000000", NULL };
+  GOptionContext *context;
+  GError *error = NULL;
+  GString *results;
+  const char * const *sizes;
+  gboolean success = TRUE;
+  guint i, j;
+
+  context = g_option_context_new ("- benchmark list models");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  else if (argc > 1 || arg_runs < 1)
+    {
+      char *help = g_option_context_get_help (context, TRUE, NULL);
+      g_print ("%s", help);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  gtk_init ();
+  setlocale (LC_ALL, "C");
+
+  rng = g_rand_new_with_seed (arg_seed);
+  results = g_string_new (NULL);
+  sizes = arg_sizes ? (const char * const *) arg_sizes : default_sizes;
+
+  for (i = 0; sizes[i]; i++)
+    {
+      guint size = strtoul (sizes[i], NULL, 10);
+
+      if (size == 0)
+        {
+          g_printerr ("Invalid size: %s\n", sizes[i]);
+          success = FALSE;
+          continue;
+        }
+
+      for (j = 0; j < G_N_ELEMENTS (benchmarks); j++)
+        run_benchmark (j, size, results);
+    }
+
+  if (arg_output)
+    {
+      char *json;
+
+      json = g_strdup_printf ("{\n  \"runs\": %d,\n  \"seed\": %d,\n  \"results\": [\n%s\n  ]\n}\n",
+                              arg_runs, arg_seed, results->str);
+
+      if (!g_file_set_contents (arg_output, json, -1, &error))
+        {
+          g_printerr ("Could not write results: %s\n", error->message);
+          g_clear_error (&error);
+          success = FALSE;
+        }
+
+      g_free (json);
+    }
+
+  g_string_free (results, TRUE);
+  g_rand_free (rng);
+
+  return success ? 0 : 1;
+}
@@ -1012,6 +1012,84 @@ list_store_test_iter_parent_invalid (ListStore     *fixture,
   g_assert (iter.stamp == 0);
 }
 
+static void
+record_inserted (GtkTreeModel *model,
+                 GtkTreePath  *path,
+                 GtkTreeIter  *iter,
+                 GArray       *indices)
+{
+  int index = gtk_tree_path_get_indices (path)[0];
+
+  g_array_append_val (indices, index);
+}
+
+static void
+list_store_test_insert_rows (void)
+{
+  const int expected[5] = { 0, 10, 11, 12, 1 };
+  GValue values[3] = { G_VALUE_INIT, G_VALUE_INIT, G_VALUE_INIT };
+  int columns[1] = { 0 };
+  GtkListStore *store;
+  GtkTreeIter iter;
+  GArray *indices;
+  int i, value;
+
+  store = gtk_list_store_new (1, G_TYPE_INT);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, 0, -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, 1, -1);
+
+  indices = g_array_new (FALSE, FALSE, sizeof (int));
+  g_signal_connect (store, "row-inserted", G_CALLBACK (record_inserted), indices);
+
+  for (i = 0; i < 3; i++)
+    {
+      g_value_init (&values[i], G_TYPE_INT);
+      g_value_set_int (&values[i], 10 + i);
+    }
+
+  gtk_list_store_insert_rows_with_valuesv (store, 1, 3, columns, values, 1);
+
+  g_assert_cmpint (indices->len, ==, 3);
+  for (i = 0; i < 3; i++)
+    g_assert_cmpint (g_array_index (indices, int, i), ==, 1 + i);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 5);
+  g_assert (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter));
+  for (i = 0; i < 5; i++)
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, 0, &value, -1);
+      g_assert_cmpint (value, ==, expected[i]);
+      g_assert (iter_position (store, &iter, i));
+      gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter);
+    }
+
+  for (i = 0; i < 3; i++)
+    g_value_unset (&values[i]);
+  g_array_unref (indices);
+  g_object_unref (store);
+}
+
+static void
+list_store_test_remove_rows (ListStore     *fixture,
+                             gconstpointer  user_data)
+{
+  GtkTreeIter iter;
+
+  gtk_list_store_remove_rows (fixture->store, 1, 2);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (fixture->store), NULL), ==, 3);
+  g_assert (!gtk_list_store_iter_is_valid (fixture->store, &fixture->iter[1]));
+  g_assert (!gtk_list_store_iter_is_valid (fixture->store, &fixture->iter[2]));
+
+  g_assert (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (fixture->store), &iter, NULL, 1));
+  g_assert (iters_equal (&iter, &fixture->iter[3]));
+
+  /* Rows past the end are ignored */
+  gtk_list_store_remove_rows (fixture->store, 1, 10);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (fixture->store), NULL), ==, 1);
+  g_assert (gtk_list_store_iter_is_valid (fixture->store, &fixture->iter[0]));
+}
 
 /* main */
 
@@ -1033,6 +1111,8 @@ register_list_store_tests (void)
 		   list_store_test_insert_before);
   g_test_add_func ("/ListStore/insert-before-NULL",
 		   list_store_test_insert_before_NULL);
+  g_test_add_func ("/ListStore/insert-rows",
+                   list_store_test_insert_rows);
 
   /* setting values (FIXME) */
   g_test_add_func ("/ListStore/set-gvalue-to-transform",
@@ -1049,6 +1129,10 @@ register_list_store_tests (void)
 	      list_store_setup, list_store_test_remove_end,
 	      list_store_teardown);
 
+  g_test_add ("/ListStore/remove-rows", ListStore, NULL,
+              list_store_setup, list_store_test_remove_rows,
+              list_store_teardown);
+
   g_test_add ("/ListStore/clear", ListStore, NULL,
 	      list_store_setup, list_store_test_clear,
 	      list_store_teardown);
@@ -286,6 +286,82 @@ test_set_map_func (void)
   g_object_unref (map);
 }
 
+static int n_mapped;
+
+static gpointer
+map_count (gpointer item,
+           gpointer factor)
+{
+  g_atomic_int_inc (&n_mapped);
+
+  return map_multiply (item, factor);
+}
+
+static void
+test_cache (void)
+{
+  GtkMapListModel *map;
+  GListStore *store;
+  GObject *item;
+  
+  store = new_store (1, 5, 1);
+  map = gtk_map_list_model_new (G_LIST_MODEL (store), map_count, GUINT_TO_POINTER (2), NULL);
+
+  n_mapped = 0;
+  item = g_list_model_get_item (G_LIST_MODEL (map), 0);
+  g_object_unref (item);
+  item = g_list_model_get_item (G_LIST_MODEL (map), 0);
+  g_object_unref (item);
+  g_assert_cmpint (n_mapped, ==, 2);
+
+  gtk_map_list_model_set_cache_size (map, 1);
+  n_mapped = 0;
+  item = g_list_model_get_item (G_LIST_MODEL (map), 0);
+  g_object_unref (item);
+  item = g_list_model_get_item (G_LIST_MODEL (map), 0);
+  g_object_unref (item);
+  g_assert_cmpint (n_mapped, ==, 1);
+
+  /* item 0 gets evicted */
+  item = g_list_model_get_item (G_LIST_MODEL (map), 1);
+  g_object_unref (item);
+  item = g_list_model_get_item (G_LIST_MODEL (map), 0);
+  g_object_unref (item);
+  g_assert_cmpint (n_mapped, ==, 3);
+
+  g_object_unref (map);
+}
+
+static gboolean
+is_multiple_of_four (gpointer item,
+                     gpointer unused)
+{
+  return GPOINTER_TO_UINT (g_object_get_qdata (item, number_quark)) % 4 == 0;
+}
+
+static void
+test_map_in_threads (void)
+{
+  GtkMapListModel *map;
+  GtkFilterListModel *filter;
+  GListStore *store;
+  
+  store = new_store (1, 1000, 1);
+  map = gtk_map_list_model_new (G_LIST_MODEL (store), map_count, GUINT_TO_POINTER (2), NULL);
+  gtk_map_list_model_set_map_in_threads (map, TRUE);
+  g_assert_true (gtk_map_list_model_get_map_in_threads (map));
+
+  n_mapped = 0;
+  filter = gtk_filter_list_model_new (G_LIST_MODEL (map),
+                                      GTK_FILTER (gtk_custom_filter_new (is_multiple_of_four, NULL, NULL)));
+  g_assert_cmpint (n_mapped, ==, 1000);
+  g_assert_cmpint (g_list_model_get_n_items (G_LIST_MODEL (filter)), ==, 500);
+  g_assert_cmpuint (get (G_LIST_MODEL (filter), 0), ==, 4);
+  g_assert_cmpuint (get (G_LIST_MODEL (filter), 499), ==, 2000);
+
+  g_object_unref (filter);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -299,6 +375,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/maplistmodel/create", test_create);
   g_test_add_func ("/maplistmodel/set-model", test_set_model);
   g_test_add_func ("/maplistmodel/set-map-func", test_set_map_func);
+  g_test_add_func ("/maplistmodel/cache", test_cache);
+  g_test_add_func ("/maplistmodel/map-in-threads", test_map_in_threads);
 
   return g_test_run ();
 }
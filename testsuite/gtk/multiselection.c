@@ -391,7 +391,7 @@ test_selection (void)
   ret = gtk_selection_model_select_all (selection);
   g_assert_true (ret);
   assert_selection (selection, "1 2 3 4 5");
-  assert_selection_changes (selection, "0:5");
+  assert_selection_changes (selection, "0:1, 2:3");
 
   ret = gtk_selection_model_unselect_all (selection);
   g_assert_true (ret);
@@ -403,7 +403,7 @@ test_selection (void)
 }
 
 /* Verify that select_range with exclusive = TRUE
- * sends a selection-changed signal that covers
+ * sends selection-changed signals that cover
  * preexisting items that got unselected
  */
 static void
@@ -431,7 +431,7 @@ test_select_range (void)
   ret = gtk_selection_model_select_range (selection, 0, 1, TRUE);
   g_assert_true (ret);
   assert_selection (selection, "1");
-  assert_selection_changes (selection, "0:5");
+  assert_selection_changes (selection, "0:1, 2:3");
 
   g_object_unref (store);
   g_object_unref (selection);
@@ -493,7 +493,7 @@ test_set_selection (void)
   gtk_bitset_unref (selected);
   gtk_bitset_unref (mask);
   assert_selection (selection, "3 4 5 7 8 9");
-  assert_selection_changes (selection, "2:7");
+  assert_selection_changes (selection, "2:3, 6:3");
 
   selected = gtk_bitset_new_empty ();
   mask = gtk_bitset_new_empty ();
@@ -504,7 +504,7 @@ test_set_selection (void)
   gtk_bitset_unref (selected);
   gtk_bitset_unref (mask);
   assert_selection (selection, "3 5 7 9");
-  assert_selection_changes (selection, "3:5");
+  assert_selection_changes (selection, "3:1, 7:1");
 
   g_object_unref (store);
   g_object_unref (selection);
@@ -579,9 +579,9 @@ test_selection_filter (void)
   ret = gtk_selection_model_select_all (selection);
   g_assert_true (ret);
   assert_selection (selection, "1 2 3 4 5");
-  assert_selection_changes (selection, "0:5");
+  assert_selection_changes (selection, "0:1, 2:3");
   assert_model (filter, "1 2 3 4 5");
-  assert_changes (filter, "0-1+5");
+  assert_changes (filter, "+0, 2+3");
 
   ret = gtk_selection_model_unselect_all (selection);
   g_assert_true (ret);
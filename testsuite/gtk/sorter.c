@@ -440,6 +440,47 @@ test_multi (void)
   g_object_unref (sorter);
 }
 
+static char *
+get_string_mod_5 (gpointer object)
+{
+  return g_strdup_printf ("%u", get_number (object) % 5);
+}
+
+/* Large enough to sort by the prefixes of the string sorter's keys */
+static void
+test_multi_prefix (void)
+{
+  GtkSortListModel *model;
+  GtkSorter *sorter;
+  GtkSorter *sorter1;
+  GtkSorter *sorter2;
+  guint i;
+
+  model = new_model (2000, NULL);
+
+  sorter1 = GTK_SORTER (gtk_string_sorter_new (gtk_cclosure_expression_new (G_TYPE_STRING, NULL, 0, NULL, (GCallback)get_string_mod_5, NULL, NULL)));
+  sorter2 = GTK_SORTER (gtk_numeric_sorter_new (gtk_cclosure_expression_new (G_TYPE_UINT, NULL, 0, NULL, (GCallback)get_number, NULL, NULL)));
+  gtk_numeric_sorter_set_sort_order (GTK_NUMERIC_SORTER (sorter2), GTK_SORT_DESCENDING);
+
+  sorter = GTK_SORTER (gtk_multi_sorter_new ());
+  gtk_multi_sorter_append (GTK_MULTI_SORTER (sorter), sorter1);
+  gtk_multi_sorter_append (GTK_MULTI_SORTER (sorter), sorter2);
+  gtk_sort_list_model_set_sorter (model, sorter);
+
+  for (i = 1; i < 2000; i++)
+    {
+      guint a = get (G_LIST_MODEL (model), i - 1);
+      guint b = get (G_LIST_MODEL (model), i);
+
+      g_assert_cmpuint (a % 5, <=, b % 5);
+      if (a % 5 == b % 5)
+        g_assert_cmpuint (a, >, b);
+    }
+
+  g_object_unref (model);
+  g_object_unref (sorter);
+}
+
 /* Check that the multi sorter properly disconnects its changed signal */
 static void
 test_multi_destruct (void)
@@ -665,6 +706,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/sorter/change", test_change);
   g_test_add_func ("/sorter/numeric", test_numeric);
   g_test_add_func ("/sorter/multi", test_multi);
+  g_test_add_func ("/sorter/multi-prefix", test_multi_prefix);
   g_test_add_func ("/sorter/multi-destruct", test_multi_destruct);
   g_test_add_func ("/sorter/multi-changes", test_multi_changes);
   g_test_add_func ("/sorter/stable", test_stable);
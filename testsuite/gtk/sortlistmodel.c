@@ -372,6 +372,40 @@ test_add_items (void)
   g_object_unref (sort);
 }
 
+/* Few items added to a large sorted model are inserted directly */
+static void
+test_insert_sorted (void)
+{
+  GtkSortListModel *sort;
+  GListStore *store;
+  guint i;
+
+  store = new_empty_store ();
+  for (i = 500; i > 0; i--)
+    add (store, 2 * i);
+  sort = new_model (store);
+  assert_changes (sort, "");
+
+  /* add end */
+  splice (store, 500, 0, (guint[]) { 1003, 1001 }, 2);
+  assert_changes (sort, "500+2");
+
+  /* add middle, in different places */
+  splice (store, 0, 0, (guint[]) { 13, 11 }, 2);
+  assert_changes (sort, "5-1+3");
+
+  /* remove */
+  splice (store, 2, 1, NULL, 0);
+  assert_changes (sort, "-501");
+
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (sort)), ==, 503);
+  for (i = 1; i < 503; i++)
+    g_assert_cmpuint (get (G_LIST_MODEL (sort), i - 1), <, get (G_LIST_MODEL (sort), i));
+
+  g_object_unref (store);
+  g_object_unref (sort);
+}
+
 static void
 test_remove_items (void)
 {
@@ -517,6 +551,113 @@ test_incremental_remove (void)
   g_object_unref (removed);
 }
 
+static void
+check_string_order (GListModel *model)
+{
+  char *prev = NULL;
+  guint i;
+
+  for (i = 0; i < g_list_model_get_n_items (model); i++)
+    {
+      GtkStringObject *object = g_list_model_get_item (model, i);
+      const char *string = gtk_string_object_get_string (object);
+
+      if (prev)
+        g_assert_cmpstr (prev, <=, string);
+      g_free (prev);
+      prev = g_strdup (string);
+      g_object_unref (object);
+    }
+
+  g_free (prev);
+}
+
+/* Test that sorting in threads produces a single change, and that
+ * changing the model while sorting in threads works.
+ */
+static void
+test_incremental_threads (void)
+{
+  GtkSortListModel *model;
+  GtkStringSorter *sorter;
+  GListStore *store;
+  const guint n_items = 100000;
+  guint i;
+
+  store = g_list_store_new (GTK_TYPE_STRING_OBJECT);
+  for (i = 0; i < n_items; i++)
+    {
+      char *string = g_strdup_printf ("%06u", n_items - i);
+      GtkStringObject *object = gtk_string_object_new (string);
+      g_list_store_append (store, object);
+      g_object_unref (object);
+      g_free (string);
+    }
+
+  model = new_model (NULL);
+  gtk_sort_list_model_set_incremental (model, TRUE);
+  gtk_sort_list_model_set_model (model, G_LIST_MODEL (store));
+  assert_changes (model, "0+100000");
+
+  sorter = gtk_string_sorter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string"));
+  gtk_sort_list_model_set_sorter (model, GTK_SORTER (sorter));
+
+  while (gtk_sort_list_model_get_pending (model) != 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  assert_changes (model, "0-100000+100000");
+
+  /* new keys, and remove items while that sort is ongoing */
+  gtk_string_sorter_set_ignore_case (sorter, FALSE);
+  while (gtk_sort_list_model_get_pending (model) != 0)
+    {
+      if (g_list_model_get_n_items (G_LIST_MODEL (store)) > n_items - 100)
+        g_list_store_splice (store, g_random_int_range (0, n_items - 110), 10, NULL, 0);
+      g_main_context_iteration (NULL, FALSE);
+    }
+
+  check_string_order (G_LIST_MODEL (model));
+
+  ignore_changes (model);
+
+  g_object_unref (sorter);
+  g_object_unref (store);
+  g_object_unref (model);
+}
+
+/* Test sorting by key prefixes, with prefixes that are unique
+ * and ones that are all the same.
+ */
+static void
+test_prefix_sort (void)
+{
+  const char *formats[] = { "%06u", "same-prefix-%06u" };
+  GtkSortListModel *model;
+  GListStore *store;
+  GtkSorter *sorter;
+  guint i, j;
+
+  for (j = 0; j < G_N_ELEMENTS (formats); j++)
+    {
+      store = g_list_store_new (GTK_TYPE_STRING_OBJECT);
+      for (i = 0; i < 10000; i++)
+        {
+          char *string = g_strdup_printf (formats[j], g_random_int_range (0, 1000000));
+          GtkStringObject *object = gtk_string_object_new (string);
+          g_list_store_append (store, object);
+          g_object_unref (object);
+          g_free (string);
+        }
+
+      sorter = GTK_SORTER (gtk_string_sorter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string")));
+      model = gtk_sort_list_model_new (G_LIST_MODEL (store), sorter);
+
+      check_string_order (G_LIST_MODEL (model));
+
+      g_object_unref (model);
+    }
+}
+
 static void
 test_out_of_bounds_access (void)
 {
@@ -549,10 +690,13 @@ main (int argc, char *argv[])
   g_test_add_func ("/sortlistmodel/set-sorter", test_set_sorter);
 #if GLIB_CHECK_VERSION (2, 58, 0) /* g_list_store_splice() is broken before 2.58 */
   g_test_add_func ("/sortlistmodel/add_items", test_add_items);
+  g_test_add_func ("/sortlistmodel/insert_sorted", test_insert_sorted);
   g_test_add_func ("/sortlistmodel/remove_items", test_remove_items);
 #endif
   g_test_add_func ("/sortlistmodel/stability", test_stability);
   g_test_add_func ("/sortlistmodel/incremental/remove", test_incremental_remove);
+  g_test_add_func ("/sortlistmodel/incremental/threads", test_incremental_threads);
+  g_test_add_func ("/sortlistmodel/prefix-sort", test_prefix_sort);
   g_test_add_func ("/sortlistmodel/oob-access", test_out_of_bounds_access);
 
   return g_test_run ();
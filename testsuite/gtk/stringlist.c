@@ -230,6 +230,120 @@ test_take (void)
   g_object_unref (list);
 }
 
+static char *
+filtered_to_string (GListModel *model)
+{
+  GString *string = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < g_list_model_get_n_items (model); i++)
+    {
+      GtkStringObject *object = g_list_model_get_item (model, i);
+
+      if (i > 0)
+        g_string_append (string, " ");
+      g_string_append (string, gtk_string_object_get_string (object));
+      g_object_unref (object);
+    }
+
+  return g_string_free (string, FALSE);
+}
+
+static void
+test_indexed (void)
+{
+  const char *strings[] = { "Gtk", "GtkWidget", "gtk_widget_show", "GdkSurface",
+                            "gdk_surface_new", "Gsk", "ﬁle", "file", "Stra\u00dfe", NULL };
+  const char *searches[] = { "widget", "WIDGET", "gtk_", "surf", "gdk", "fil", "FILE",
+                             "strasse", "xyz", "k", NULL };
+  GtkStringList *list, *indexed;
+  GtkFilterListModel *filter, *indexed_filter;
+  GtkStringFilter *string_filter;
+  guint i, mode;
+
+  list = gtk_string_list_new (strings);
+  indexed = gtk_string_list_new (strings);
+  gtk_string_list_set_indexed (indexed, TRUE);
+  g_assert_true (gtk_string_list_get_indexed (indexed));
+
+  string_filter = gtk_string_filter_new (gtk_property_expression_new (GTK_TYPE_STRING_OBJECT, NULL, "string"));
+  filter = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (list)), g_object_ref (GTK_FILTER (string_filter)));
+  indexed_filter = gtk_filter_list_model_new (g_object_ref (G_LIST_MODEL (indexed)), g_object_ref (GTK_FILTER (string_filter)));
+
+  for (mode = GTK_STRING_FILTER_MATCH_MODE_EXACT; mode <= GTK_STRING_FILTER_MATCH_MODE_PREFIX; mode++)
+    {
+      gtk_string_filter_set_match_mode (string_filter, mode);
+
+      for (i = 0; searches[i]; i++)
+        {
+          char *expected, *result;
+
+          gtk_string_filter_set_ignore_case (string_filter, i % 2 == 0);
+          gtk_string_filter_set_search (string_filter, searches[i]);
+
+          expected = filtered_to_string (G_LIST_MODEL (filter));
+          result = filtered_to_string (G_LIST_MODEL (indexed_filter));
+          g_assert_cmpstr (result, ==, expected);
+          g_free (expected);
+          g_free (result);
+
+          /* the index is updated for appended strings */
+          gtk_string_list_append (list, searches[i]);
+          gtk_string_list_append (indexed, searches[i]);
+        }
+
+      /* and recreated after other changes */
+      gtk_string_list_remove (list, 0);
+      gtk_string_list_remove (indexed, 0);
+    }
+
+  g_object_unref (filter);
+  g_object_unref (indexed_filter);
+  g_object_unref (string_filter);
+  g_object_unref (list);
+  g_object_unref (indexed);
+}
+
+static void
+test_objects (void)
+{
+  GtkStringList *list;
+  GtkStringObject *a, *b, *c;
+  guint i;
+
+  list = gtk_string_list_new ((const char *[]) { "a", "b", "c", NULL });
+
+  /* the same object is returned while it is alive */
+  a = g_list_model_get_item (G_LIST_MODEL (list), 0);
+  b = g_list_model_get_item (G_LIST_MODEL (list), 0);
+  g_assert_true (a == b);
+  g_object_unref (b);
+
+  c = g_list_model_get_item (G_LIST_MODEL (list), 2);
+  g_assert_cmpstr (gtk_string_object_get_string (c), ==, "c");
+
+  /* objects keep their string when it is removed from the list */
+  gtk_string_list_remove (list, 0);
+  g_assert_cmpstr (gtk_string_object_get_string (a), ==, "a");
+  g_object_unref (a);
+
+  /* and stay cached when the pool is compacted */
+  for (i = 0; i < 100; i++)
+    gtk_string_list_append (list, "x");
+  gtk_string_list_splice (list, 2, 100, NULL);
+  assert_model (list, "b c");
+  b = g_list_model_get_item (G_LIST_MODEL (list), 1);
+  g_assert_true (b == c);
+  g_object_unref (b);
+  g_object_unref (c);
+
+  /* objects may outlive the list */
+  a = g_list_model_get_item (G_LIST_MODEL (list), 0);
+  g_object_unref (list);
+  g_assert_cmpstr (gtk_string_object_get_string (a), ==, "b");
+  g_object_unref (a);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -244,6 +358,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/stringlist/splice", test_splice);
   g_test_add_func ("/stringlist/add_remove", test_add_remove);
   g_test_add_func ("/stringlist/take", test_take);
+  g_test_add_func ("/stringlist/indexed", test_indexed);
+  g_test_add_func ("/stringlist/objects", test_objects);
 
   return g_test_run ();
 }
@@ -919,6 +919,60 @@ test_line_separator (void)
   split_r_n_separators_test ();
 }
 
+/* Long lines, so that line splitting goes over whole words, with
+ * multibyte characters and bytes that start paragraph separators.
+ */
+static void
+test_insert_long_lines (void)
+{
+  const char *lines[] = {
+    "a fairly long line of plain ascii text without multibyte characters",
+    "\xe2\x80\x9cquoted\xe2\x80\x9d text with stra\xc3\x9f""e and \xf0\x9f\x98\x80 in the middle of it",
+    "",
+    "\xe2\x80\xa8 line separator is not a paragraph separator \xe2\x80\xa8",
+    "0123456789abcdef0123456789abcdef",
+  };
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  GString *text;
+  char *contents;
+  int i, j, n_chars;
+
+  text = g_string_new (NULL);
+  n_chars = 0;
+  for (i = 0; i < 50; i++)
+    for (j = 0; j < G_N_ELEMENTS (lines); j++)
+      {
+        g_string_append (text, lines[j]);
+        g_string_append (text, j % 2 ? "\r\n" : "\n");
+        n_chars += g_utf8_strlen (lines[j], -1) + (j % 2 ? 2 : 1);
+      }
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, text->str, text->len);
+
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==, n_chars);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 50 * G_N_ELEMENTS (lines) + 1);
+
+  for (i = 0; i < 50 * G_N_ELEMENTS (lines); i++)
+    {
+      gtk_text_buffer_get_iter_at_line (buffer, &start, i);
+      end = start;
+      if (!gtk_text_iter_ends_line (&end))
+        gtk_text_iter_forward_to_line_end (&end);
+      g_assert_cmpint (gtk_text_iter_get_line_offset (&end), ==,
+                       g_utf8_strlen (lines[i % G_N_ELEMENTS (lines)], -1));
+    }
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  contents = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+  g_assert_cmpstr (contents, ==, text->str);
+  g_free (contents);
+
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+}
+
 static void
 test_backspace (void)
 {
@@ -1348,6 +1402,49 @@ test_tag (void)
   g_object_unref (buffer);
 }
 
+static void
+count_apply_tag (GtkTextBuffer     *buffer,
+                 GtkTextTag        *tag,
+                 const GtkTextIter *start,
+                 const GtkTextIter *end,
+                 gpointer           data)
+{
+  int *n_applied = data;
+
+  (*n_applied)++;
+}
+
+static void
+test_tag_spans (void)
+{
+  const int offsets[] = { 0, 2, 7, 5, 8, 10, 9, 12 };
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter iter;
+  int n_applied = 0;
+  int i;
+
+  buffer = gtk_text_buffer_new (NULL);
+  tag = gtk_text_buffer_create_tag (buffer, "bold", "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_text_buffer_set_text (buffer, "0123456789abcdef", -1);
+
+  g_signal_connect (buffer, "apply-tag", G_CALLBACK (count_apply_tag), &n_applied);
+
+  gtk_text_buffer_apply_tag_spans (buffer, tag, offsets, G_N_ELEMENTS (offsets) / 2);
+
+  g_assert_cmpint (n_applied, ==, G_N_ELEMENTS (offsets) / 2);
+
+  for (i = 0; i < 16; i++)
+    {
+      gboolean tagged = i < 2 || (i >= 5 && i < 7) || (i >= 8 && i < 12);
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, i);
+      g_assert_cmpint (gtk_text_iter_has_tag (&iter, tag), ==, tagged);
+    }
+
+  g_object_unref (buffer);
+}
+
 static void
 check_buffer_contents (GtkTextBuffer *buffer,
                        const char    *contents)
@@ -1581,6 +1678,53 @@ test_get_iter (void)
   g_object_unref (buffer);
 }
 
+/* Large inserts go cold and get their text compressed */
+static void
+test_undo_large_inserts (void)
+{
+  GtkTextBuffer *buffer;
+  GString *expected;
+  char *text;
+  int i, j;
+
+  buffer = gtk_text_buffer_new (NULL);
+  expected = g_string_new (NULL);
+
+  for (i = 0; i < 20; i++)
+    {
+      GString *chunk = g_string_new (NULL);
+
+      for (j = 0; j < 1000; j++)
+        g_string_append_printf (chunk, "paste %d, line %d\n", i, j);
+
+      gtk_text_buffer_insert_at_cursor (buffer, chunk->str, chunk->len);
+
+      g_string_append_len (expected, chunk->str, chunk->len);
+      g_string_free (chunk, TRUE);
+    }
+
+  for (i = 0; i < 20; i++)
+    {
+      g_assert_true (gtk_text_buffer_get_can_undo (buffer));
+      gtk_text_buffer_undo (buffer);
+    }
+
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==, 0);
+
+  for (i = 0; i < 20; i++)
+    {
+      g_assert_true (gtk_text_buffer_get_can_redo (buffer));
+      gtk_text_buffer_redo (buffer);
+    }
+
+  g_object_get (buffer, "text", &text, NULL);
+  g_assert_cmpstr (text, ==, expected->str);
+  g_free (text);
+
+  g_string_free (expected, TRUE);
+  g_object_unref (buffer);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -1591,6 +1735,7 @@ main (int argc, char** argv)
 
   g_test_add_func ("/TextBuffer/UTF8 unknown char", test_utf8);
   g_test_add_func ("/TextBuffer/Line separator", test_line_separator);
+  g_test_add_func ("/TextBuffer/Insert long lines", test_insert_long_lines);
   g_test_add_func ("/TextBuffer/Backspace", test_backspace);
   g_test_add_func ("/TextBuffer/Logical motion", test_logical_motion);
   g_test_add_func ("/TextBuffer/Marks", test_marks);
@@ -1598,8 +1743,10 @@ main (int argc, char** argv)
   g_test_add_func ("/TextBuffer/Get and Set", test_get_set);
   g_test_add_func ("/TextBuffer/Fill and Empty", test_fill_empty);
   g_test_add_func ("/TextBuffer/Tag", test_tag);
+  g_test_add_func ("/TextBuffer/Tag spans", test_tag_spans);
   g_test_add_func ("/TextBuffer/Clipboard", test_clipboard);
   g_test_add_func ("/TextBuffer/Get iter", test_get_iter);
+  g_test_add_func ("/TextBuffer/Undo large inserts", test_undo_large_inserts);
 
   return g_test_run();
 }
@@ -780,6 +780,48 @@ test_backward_line (void)
   g_object_unref (buffer);
 }
 
+static void
+test_long_line_offsets (void)
+{
+  /* byte offsets of the chars in "aé€" */
+  const int index_in_run[] = { 0, 1, 3 };
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *text;
+  int i;
+
+  /* Long enough for the segment to get a char offset index,
+   * with 1, 2 and 3 byte characters mixed.
+   */
+  text = g_string_new (NULL);
+  for (i = 0; i < 10000; i++)
+    g_string_append (text, "aé€");
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, text->str, text->len);
+
+  for (i = 0; i < 30000; i += 997)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, i);
+      g_assert_cmpint (gtk_text_iter_get_line_index (&iter), ==, (i / 3) * 6 + index_in_run[i % 3]);
+
+      gtk_text_buffer_get_iter_at_line_index (buffer, &iter, 0, (i / 3) * 6 + 3);
+      g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, (i / 3) * 3 + 2);
+    }
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  gtk_text_iter_backward_chars (&iter, 12345);
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 30000 - 12345);
+  g_assert_cmpint (gtk_text_iter_get_line_index (&iter), ==, 10000 * 6 - (12345 / 3) * 6);
+
+  gtk_text_iter_set_line_offset (&iter, 29999);
+  g_assert_cmpint (gtk_text_iter_get_char (&iter), ==, 0x20ac);
+  g_assert_cmpint (gtk_text_iter_get_line_index (&iter), ==, 10000 * 6 - 3);
+
+  g_object_unref (buffer);
+  g_string_free (text, TRUE);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -797,6 +839,7 @@ main (int argc, char** argv)
   g_test_add_func ("/TextIter/Visible Cursor Positions", test_visible_cursor_positions);
   g_test_add_func ("/TextIter/Sentence Boundaries", test_sentence_boundaries);
   g_test_add_func ("/TextIter/Backward line", test_backward_line);
+  g_test_add_func ("/TextIter/Long line offsets", test_long_line_offsets);
 
   return g_test_run();
 }
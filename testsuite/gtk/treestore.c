@@ -1074,6 +1074,70 @@ specific_bug_698396 (void)
 
   g_object_unref (tree_store);
 }
+static void
+count_toggled (GtkTreeModel *model,
+               GtkTreePath  *path,
+               GtkTreeIter  *iter,
+               int          *count)
+{
+  (*count)++;
+}
+
+static void
+tree_store_test_insert_rows (void)
+{
+  GValue values[3] = { G_VALUE_INIT, G_VALUE_INIT, G_VALUE_INIT };
+  int columns[1] = { 0 };
+  GtkTreeStore *store;
+  GtkTreeIter parent, iter;
+  GtkTreePath *path;
+  int toggled = 0;
+  int i, value;
+
+  store = gtk_tree_store_new (1, G_TYPE_INT);
+  gtk_tree_store_insert_with_values (store, NULL, NULL, -1, 0, 0, -1);
+  gtk_tree_store_insert_with_values (store, &parent, NULL, -1, 0, 1, -1);
+
+  g_signal_connect (store, "row-has-child-toggled", G_CALLBACK (count_toggled), &toggled);
+
+  for (i = 0; i < 3; i++)
+    {
+      g_value_init (&values[i], G_TYPE_INT);
+      g_value_set_int (&values[i], 10 + i);
+    }
+
+  gtk_tree_store_insert_rows_with_valuesv (store, &parent, -1, 3, columns, values, 1);
+
+  g_assert_cmpint (toggled, ==, 1);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), &parent), ==, 3);
+
+  g_assert (gtk_tree_model_iter_children (GTK_TREE_MODEL (store), &iter, &parent));
+  for (i = 0; i < 3; i++)
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, 0, &value, -1);
+      g_assert_cmpint (value, ==, 10 + i);
+
+      path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
+      g_assert_cmpint (gtk_tree_path_get_depth (path), ==, 2);
+      g_assert_cmpint (gtk_tree_path_get_indices (path)[0], ==, 1);
+      g_assert_cmpint (gtk_tree_path_get_indices (path)[1], ==, i);
+      gtk_tree_path_free (path);
+
+      gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter);
+    }
+
+  /* Insert at the top level, between the existing rows */
+  gtk_tree_store_insert_rows_with_valuesv (store, NULL, 1, 2, columns, values, 1);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 4);
+  g_assert (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, 3));
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, 0, &value, -1);
+  g_assert_cmpint (value, ==, 1);
+
+  for (i = 0; i < 3; i++)
+    g_value_unset (&values[i]);
+  g_object_unref (store);
+}
 
 /* main */
 
@@ -1095,6 +1159,8 @@ register_tree_store_tests (void)
 		   tree_store_test_insert_before);
   g_test_add_func ("/TreeStore/insert-before-NULL",
 		   tree_store_test_insert_before_NULL);
+  g_test_add_func ("/TreeStore/insert-rows",
+                   tree_store_test_insert_rows);
 
   /* setting values (FIXME) */
   g_test_add_func ("/TreeStore/set-gvalue-to-transform",
@@ -1,5 +1,7 @@
 #include <errno.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -11,8 +13,11 @@ typedef struct {
   const char *mark;
   const char *detail;
   gboolean do_start;
+  gboolean do_average;
   gint64 start_time;
   gint64 value;
+  gint64 total;
+  int count;
 } Data;
 
 static bool
@@ -30,6 +35,14 @@ callback (const SysprofCaptureFrame *frame,
         {
           if (data->do_start)
             data->value = frame->time - data->start_time;
+          else if (data->do_average)
+            {
+              /* Keep going, to average over all the marks */
+              data->total += mark->duration;
+              data->count++;
+              data->value = data->total / data->count;
+              return TRUE;
+            }
           else
             data->value = mark->duration;
           return FALSE;
@@ -46,7 +59,9 @@ static char *opt_mark;
 static char *opt_detail;
 static char *opt_name;
 static char *opt_output;
+static char *opt_json;
 static gboolean opt_start_time;
+static gboolean opt_average;
 static GMainLoop *main_loop;
 static GError *failure;
 
@@ -54,12 +69,24 @@ static GOptionEntry options[] = {
   { "mark", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &opt_mark, "Name of the mark", "NAME" },
   { "detail", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &opt_detail, "Detail of the mark", "DETAIL" },
   { "start", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &opt_start_time, "Measure the start time", NULL },
+  { "average", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &opt_average, "Average over all occurrences of the mark", NULL },
   { "runs", '0', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &opt_rep, "Number of runs", "COUNT" },
   { "name", '0', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &opt_name, "Name of this test", "NAME" },
   { "output", '0', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &opt_output, "Directory to save syscap files", "DIRECTORY" },
+  { "json", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &opt_json, "Write results as JSON to FILE", "FILE" },
   { NULL, }
 };
 
+static int
+compare_values (gconstpointer a,
+                gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a;
+  gint64 vb = *(const gint64 *) b;
+
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
 static gboolean
 start_in_main (gpointer data)
 {
@@ -91,7 +118,8 @@ main (int argc, char *argv[])
   Data data;
   SysprofCaptureFrameType type;
   gint64 *values;
-  gint64 min, max, total;
+  gint64 min, max, median, total;
+  double mean, variance;
   int count;
   char *output_dir = NULL;
   char **spawn_env;
@@ -201,8 +229,11 @@ main (int argc, char *argv[])
       data.mark = opt_mark ? opt_mark : "css validation";
       data.detail = opt_detail ? opt_detail : NULL;
       data.do_start = opt_start_time;
+      data.do_average = opt_average;
       data.start_time = sysprof_capture_reader_get_start_time (reader);
       data.value = 0;
+      data.total = 0;
+      data.count = 0;
 
       cursor = sysprof_capture_cursor_new (reader);
 
@@ -260,9 +291,52 @@ main (int argc, char *argv[])
       total += values[i];
     }
 
-  g_print ("%d runs, min %g, max %g, avg %g\n",
+  mean = (double) total / count;
+  variance = 0;
+  for (i = 1; i < opt_rep; i++)
+    variance += (values[i] - mean) * (values[i] - mean);
+  variance /= count;
+
+  qsort (values + 1, count, sizeof (gint64), compare_values);
+  median = values[1 + count / 2];
+
+  g_print ("%d runs, min %g, max %g, avg %g, median %g, stddev %g\n",
            count,
            MILLISECONDS (min),
            MILLISECONDS (max),
-           MILLISECONDS (total / count));
+           MILLISECONDS (mean),
+           MILLISECONDS (median),
+           MILLISECONDS (sqrt (variance)));
+
+  if (opt_json)
+    {
+      char *json;
+
+      /* Times are in milliseconds, the variance in milliseconds squared */
+      json = g_strdup_printf ("{\n"
+                              "  \"name\": \"%s\",\n"
+                              "  \"mark\": \"%s\",\n"
+                              "  \"runs\": %d,\n"
+                              "  \"min\": %g,\n"
+                              "  \"max\": %g,\n"
+                              "  \"mean\": %g,\n"
+                              "  \"median\": %g,\n"
+                              "  \"variance\": %g\n"
+                              "}\n",
+                              opt_name ? opt_name : "gtk",
+                              opt_mark ? opt_mark : "css validation",
+                              count,
+                              MILLISECONDS (min),
+                              MILLISECONDS (max),
+                              MILLISECONDS (mean),
+                              MILLISECONDS (median),
+                              MILLISECONDS (MILLISECONDS (variance)));
+
+      if (!g_file_set_contents (opt_json, json, -1, &error))
+        g_error ("Writing %s: %s", opt_json, error->message);
+
+      g_free (json);
+    }
+
+  g_free (values);
 }